@@ -1,6 +1,30 @@
-# Run with: python3 build.py
+# Run with: python3 build.py [target]
+#   python3 build.py            builds the game (prog)
+#   python3 build.py --embed-assets  builds the game with the assets inside it,
+#                               from the include/EmbeddedAssets.inc that
+#                               ./dinopack --embed=include/EmbeddedAssets.inc writes
+#   python3 build.py dmeshconv  builds the .obj -> .dmesh converter
+#   python3 build.py dinoserve  builds the headless shared-memory training server
+#   python3 build.py dinopy     builds the in-process Python module (import dino),
+#                               for the python3 that runs this script
+#   python3 build.py dinoreplay builds the headless input log player
+#   python3 build.py dinoverify builds the lockstep check of the scalar and
+#                               SIMD simulation (per-step state hashes)
+#   python3 build.py dinoeval   builds the distributed seed-sharded policy evaluator
+#   python3 build.py dinolog    builds the gameplay log summary
+#   python3 build.py dinoinspect builds the live inspector of a running game
+#   python3 build.py bench      builds the microbenchmarks (JSON results;
+#                               ./bench --corpus=<dir> adds the loader scaling runs)
+#   python3 build.py dinopack   builds the asset packer (assets.dpak)
+#   python3 build.py texconv    builds the .ppm -> compressed .ktx converter
+#   python3 build.py dinocook   builds the parallel incremental asset cooker
+#                               (every .dmesh, .bc1.ktx and shader variant)
+#   python3 build.py heuristicpolicy builds the example policy library that
+#                               ./prog --bots and ./dinoeval load in process
 import os
 import platform
+import sys
+import sysconfig
 
 # (1)==================== COMMON CONFIGURATION OPTIONS ======================= #
 COMPILER="g++ -g -std=c++17"   # The compiler we want to use 
@@ -18,7 +42,7 @@ LIBRARIES=""            # What libraries do we want to include
 if platform.system()=="Linux":
     ARGUMENTS="-D LINUX" # -D is a #define sent to preprocessor
     INCLUDE_DIR="-I ./include/ -I ./common/thirdparty/glm/"
-    LIBRARIES="-lSDL2 -ldl"
+    LIBRARIES="-lSDL2 -ldl -lpthread -lrt"
 elif platform.system()=="Darwin":
     ARGUMENTS="-D MAC" # -D is a #define sent to the preprocessor.
     INCLUDE_DIR="-I ./include/ -I/Library/Frameworks/SDL2.framework/Headers -I./common/thirdparty/old/glm"
@@ -30,6 +54,69 @@ elif platform.system()=="Windows":
     LIBRARIES="-lmingw32 -lSDL2main -lSDL2 -mwindows"
 # (2)=================== Platform specific configuration ===================== #
 
+# Extra tools build from a few sources and need neither SDL nor OpenGL.
+TOOL_TARGETS={
+    "dmeshconv": "./tools/dmeshconv.cpp ./src/ObjLoader.cpp ./src/MeshNormals.cpp ./src/MaterialTable.cpp ./src/JobSystem.cpp ./src/ThreadAffinity.cpp ./src/FileView.cpp ./src/MeshFile.cpp ./src/MeshSimplifier.cpp ./src/MeshOptimizer.cpp ./src/MemoryTags.cpp",
+    "dinoserve": "./tools/dinoserve.cpp ./src/GameState.cpp ./src/SpawnScript.cpp ./src/Collision.cpp ./src/ObstacleLane.cpp ./src/GameStateBatch.cpp ./src/SpawnSchedule.cpp ./src/HugePages.cpp ./src/ThreadPool.cpp ./src/ThreadAffinity.cpp ./src/EnvironmentPool.cpp ./src/Telemetry.cpp ./src/SharedEnvironment.cpp ./src/FeatureObservation.cpp ./src/SoftwareRasterizer.cpp ./src/AssetPack.cpp ./src/LZ4Block.cpp ./src/Camera.cpp ./src/Logger.cpp ./src/ObjLoader.cpp ./src/MeshNormals.cpp ./src/MaterialTable.cpp ./src/JobSystem.cpp ./src/FileView.cpp ./src/Image.cpp ./src/TcpSocket.cpp ./src/MemoryTags.cpp",
+    "dinopy": "./tools/dinopy.cpp ./src/GameState.cpp ./src/SpawnScript.cpp ./src/Collision.cpp ./src/ObstacleLane.cpp ./src/GameStateBatch.cpp ./src/SpawnSchedule.cpp ./src/HugePages.cpp ./src/SharedEnvironment.cpp ./src/FeatureObservation.cpp ./src/MemoryTags.cpp",
+    "dinoreplay": "./tools/dinoreplay.cpp ./src/GameState.cpp ./src/SpawnScript.cpp ./src/Collision.cpp ./src/ObstacleLane.cpp ./src/InputLog.cpp",
+    "dinoverify": "./tools/dinoverify.cpp ./src/GameState.cpp ./src/SpawnScript.cpp ./src/Collision.cpp ./src/ObstacleLane.cpp ./src/GameStateBatch.cpp ./src/SpawnSchedule.cpp ./src/HugePages.cpp ./src/MemoryTags.cpp",
+    "dinoeval": "./tools/dinoeval.cpp ./src/GameState.cpp ./src/SpawnScript.cpp ./src/Collision.cpp ./src/ObstacleLane.cpp ./src/GameStateBatch.cpp ./src/SpawnSchedule.cpp ./src/HugePages.cpp ./src/FeatureObservation.cpp ./src/ScoreDistribution.cpp ./src/TcpSocket.cpp ./src/PolicyPlugin.cpp ./src/MemoryTags.cpp",
+    "dinolog": "./tools/dinolog.cpp",
+    "dinoinspect": "./tools/dinoinspect.cpp ./src/LiveInspector.cpp",
+    "dinopack": "./tools/dinopack.cpp ./src/SoftwareRasterizer.cpp ./src/ThreadPool.cpp ./src/Image.cpp ./src/AssetPack.cpp ./src/LZ4Block.cpp ./src/HugePages.cpp ./src/ObjLoader.cpp ./src/MeshNormals.cpp ./src/MaterialTable.cpp ./src/JobSystem.cpp ./src/ThreadAffinity.cpp ./src/FileView.cpp ./src/MeshFile.cpp ./src/MeshSimplifier.cpp ./src/MeshOptimizer.cpp ./src/MemoryTags.cpp",
+    "heuristicpolicy": "./tools/heuristicpolicy.cpp",
+    "texconv": "./tools/texconv.cpp ./src/BC1Encoder.cpp ./src/Image.cpp ./src/FileView.cpp ./src/KTXFile.cpp ./src/MemoryTags.cpp",
+    "dinocook": "./tools/dinocook.cpp ./src/BC1Encoder.cpp ./src/Image.cpp ./src/KTXFile.cpp ./src/ShaderPreprocessor.cpp ./src/ObjLoader.cpp ./src/MeshNormals.cpp ./src/MaterialTable.cpp ./src/JobSystem.cpp ./src/ThreadAffinity.cpp ./src/FileView.cpp ./src/MeshFile.cpp ./src/MeshSimplifier.cpp ./src/MeshOptimizer.cpp ./src/MemoryTags.cpp",
+    "bench": "./tools/bench.cpp ./src/ObjLoader.cpp ./src/MeshNormals.cpp ./src/MaterialTable.cpp ./src/MeshFile.cpp ./src/MeshSimplifier.cpp ./src/MeshOptimizer.cpp ./src/JobSystem.cpp ./src/ThreadAffinity.cpp ./src/FileView.cpp ./src/Image.cpp ./src/VertexFormat.cpp ./src/GameState.cpp ./src/SpawnScript.cpp ./src/Collision.cpp ./src/ObstacleLane.cpp ./src/GameStateBatch.cpp ./src/SpawnSchedule.cpp ./src/HugePages.cpp ./src/MemoryTags.cpp",
+}
+# Libraries a tool needs on Linux (tools link nothing else)
+TOOL_LIBRARIES={
+    "dinoserve": "-lpthread -lrt",
+    "dinopy": "-lpthread -lrt",
+    "dinoinspect": "-lpthread -lrt",
+    "dinoeval": "-ldl",
+    "dmeshconv": "-lpthread",
+    "dinopack": "-lpthread",
+    "dinocook": "-lpthread",
+    "bench": "-lpthread",
+}
+# Extra compiler flags of a tool; benchmarks are only meaningful optimized
+TOOL_FLAGS={
+    "bench": "-O2",
+    "dinoverify": "-O2",
+    "dinocook": "-O2",
+    "dinopy": "-O2 -shared -fPIC -I"+sysconfig.get_paths()["include"],
+    "heuristicpolicy": "-O2 -shared -fPIC",
+}
+# Tools that are not executables, by the file they are written to
+TOOL_OUTPUTS={
+    "dinopy": "dino"+(sysconfig.get_config_var("EXT_SUFFIX") or ".so"),
+    "heuristicpolicy": "heuristicpolicy"+(".dll" if platform.system()=="Windows" else ".so"),
+}
+OPTIONS = [argument for argument in sys.argv[1:] if argument.startswith("--")]
+TARGETS = [argument for argument in sys.argv[1:] if not argument.startswith("--")]
+TARGET = TARGETS[0] if TARGETS else "prog"
+for option in OPTIONS:
+    if option == "--embed-assets" and TARGET == "prog":
+        if not os.path.exists("./include/EmbeddedAssets.inc"):
+            print("Run ./dinopack --embed=include/EmbeddedAssets.inc first to embed the assets")
+            exit(1)
+        ARGUMENTS = ARGUMENTS + " -D EMBED_ASSETS"
+    else:
+        print("Unknown option: "+option+" (expected --embed-assets, for prog)")
+        exit(1)
+if TARGET in TOOL_TARGETS:
+    SOURCE = TOOL_TARGETS[TARGET]
+    EXECUTABLE = TOOL_OUTPUTS.get(TARGET, TARGET + (".exe" if platform.system()=="Windows" else ""))
+    LIBRARIES = TOOL_LIBRARIES.get(TARGET, "") if platform.system()=="Linux" else ""
+    COMPILER = COMPILER + " " + TOOL_FLAGS.get(TARGET, "")
+    if platform.system()=="Windows":
+        ARGUMENTS = "-D MINGW -static-libgcc -static-libstdc++"
+elif TARGET != "prog":
+    print("Unknown target: "+TARGET+" (expected prog or one of "+", ".join(TOOL_TARGETS)+")")
+    exit(1)
+
 # (3)====================== Building the Executable ========================== #
 # Build a string of our compile commands that we run in the terminal
 compileString=COMPILER+" "+ARGUMENTS+" "+SOURCE+" -o "+EXECUTABLE+" "+" "+INCLUDE_DIR+" "+LIBRARIES
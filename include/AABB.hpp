@@ -0,0 +1,36 @@
+/** @file AABB.hpp
+ *  @brief Axis-aligned bounding box of mesh positions.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef AABB_HPP
+#define AABB_HPP
+
+#include <cfloat>
+
+struct AABB{
+    // An empty box, anything extended into it replaces it
+    float min[3] = {FLT_MAX, FLT_MAX, FLT_MAX};
+    float max[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+
+    inline bool IsEmpty() const{
+        return min[0] > max[0];
+    }
+    // Grows the box to contain a point
+    inline void Extend(float x, float y, float z){
+        const float p[3] = {x, y, z};
+        for(int axis = 0; axis < 3; ++axis){
+            if(p[axis] < min[axis]){ min[axis] = p[axis]; }
+            if(p[axis] > max[axis]){ max[axis] = p[axis]; }
+        }
+    }
+    // Grows the box to contain another box
+    inline void Extend(const AABB& other){
+        if(!other.IsEmpty()){
+            Extend(other.min[0], other.min[1], other.min[2]);
+            Extend(other.max[0], other.max[1], other.max[2]);
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,87 @@
+/** @file AllocationCounter.hpp
+ *  @brief Heap allocations per frame, broken down by profiler zone.
+ *
+ *  AllocationCounter.cpp replaces the global operator new and delete
+ *  of the game (the tools do not link it). Every allocation adds one
+ *  to a counter, and its size to another, of the CPU profiler zone the
+ *  allocating thread is in, or of "outside zones". The counters are
+ *  relaxed atomics, so counting costs next to nothing and is always on.
+ *
+ *  EndFrame() turns the counters into the allocations of that frame.
+ *  With a budget set, a frame allocating more than it gets a warning
+ *  with its per-zone breakdown, so a zero-allocation steady state can
+ *  be enforced. Report() prints the per-zone averages and peaks since
+ *  the last report. Frees are counted too, but without sizes, since a
+ *  plain operator delete is not told one.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef ALLOCATIONCOUNTER_HPP
+#define ALLOCATIONCOUNTER_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+class AllocationCounter{
+public:
+    // Zones with counters of their own, by CPUProfiler id; allocations in
+    // later zones count as outside zones
+    static const int MAX_ZONES = 32;
+
+    // The counter the allocation hooks count into
+    static AllocationCounter& Get();
+
+    // Allocations allowed per frame before a warning, negative for none
+    void SetBudget(int allocationsPerFrame);
+    // Ends a frame: its allocations are the ones counted since the last call
+    void EndFrame();
+    // Prints allocations and bytes per frame by zone since the last report
+    void Report();
+    // Allocations and their bytes of the frame EndFrame() ended last
+    inline uint64_t GetFrameAllocations() const{
+        return m_frameAllocations;
+    }
+    inline uint64_t GetFrameBytes() const{
+        return m_frameBytes;
+    }
+    // Allocations and frees since startup
+    uint64_t GetAllocationCount() const;
+    uint64_t GetFreeCount() const;
+private:
+    // Constructor
+    AllocationCounter();
+    // Destructor
+    ~AllocationCounter();
+
+    // Frames at startup not held to the budget, while buffers first grow
+    static const int WARMUP_FRAMES = 60;
+    // Frames between two over-budget warnings
+    static const int WARNING_INTERVAL = 600;
+
+    struct ZoneTotals{
+        uint64_t allocations;
+        uint64_t bytes;
+        // Most allocations in one frame
+        uint64_t peak;
+    };
+
+    // Reads the counters and returns what was allocated since the last read
+    void TakeDeltas(uint64_t* allocations, uint64_t* bytes);
+    // Prints the non-zero entries of a per-zone list
+    void PrintZones(const uint64_t* allocations, const uint64_t* bytes) const;
+
+    int m_budget{-1};
+    uint64_t m_frame{0};
+    uint64_t m_lastWarning{0};
+    bool m_warned{false};
+    uint64_t m_overBudgetFrames{0};
+    uint64_t m_reportFrames{0};
+    uint64_t m_frameAllocations{0};
+    uint64_t m_frameBytes{0};
+    // Counter values at the last read, one slot per zone plus outside
+    uint64_t m_seenAllocations[MAX_ZONES + 1];
+    uint64_t m_seenBytes[MAX_ZONES + 1];
+    ZoneTotals m_totals[MAX_ZONES + 1];
+};
+
+#endif
@@ -0,0 +1,87 @@
+/** @file AssetFuture.hpp
+ *  @brief An asset that is still loading, and what to do once it is in.
+ *
+ *  AssetLoader::Request() returns one of these right away; the asset is
+ *  parsed as a job and uploaded on the GL thread like any other, and the
+ *  future becomes ready when its upload finishes. Nothing waits for it:
+ *  the frame loop asks IsReady() and keeps drawing what it has until
+ *  then, or hands Then() what to do with the asset, which runs on the GL
+ *  thread right after the upload (or right away if it is in already).
+ *  Continuations run in the order they were added, so they chain.
+ *
+ *  Copies share the one asset. A future is only used on the GL thread.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef ASSETFUTURE_HPP
+#define ASSETFUTURE_HPP
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+class AssetLoader;
+
+template<typename T>
+class AssetFuture{
+public:
+    // Runs on the GL thread once the asset is in
+    typedef std::function<void(T&)> Continuation;
+
+    // Constructor, of a future no asset was requested for
+    AssetFuture(){
+
+    }
+    // Destructor
+    ~AssetFuture(){
+
+    }
+    // True if an asset was requested for this future
+    inline bool IsValid() const{
+        return m_state != nullptr;
+    }
+    // True once the asset is parsed and uploaded
+    inline bool IsReady() const{
+        return m_state != nullptr && m_state->ready;
+    }
+    // The asset; only complete once IsReady()
+    inline T& Get() const{
+        return m_state->value;
+    }
+    // Calls continuation with the asset once it is ready, after the ones
+    // added before it. Returns this future, to chain the next one.
+    AssetFuture& Then(Continuation continuation){
+        if(m_state->ready){
+            continuation(m_state->value);
+        }else{
+            m_state->continuations.push_back(std::move(continuation));
+        }
+        return *this;
+    }
+private:
+    friend class AssetLoader;
+
+    struct State{
+        T value;
+        bool ready{false};
+        std::vector<Continuation> continuations;
+    };
+
+    explicit AssetFuture(const std::shared_ptr<State>& state) : m_state(state){
+
+    }
+    // Marks the asset ready and runs what waited for it
+    static void Complete(State& state){
+        state.ready = true;
+        // A continuation may add more, which then run right away
+        std::vector<Continuation> continuations;
+        continuations.swap(state.continuations);
+        for(Continuation& continuation : continuations){
+            continuation(state.value);
+        }
+    }
+
+    std::shared_ptr<State> m_state;
+};
+
+#endif
@@ -0,0 +1,167 @@
+/** @file AssetLoader.hpp
+ *  @brief Parses assets as jobs, uploads them on the GL thread.
+ *
+ *  An asset is loaded in two halves. Its parse function runs as a job
+ *  of the JobSystem, so assets decode on every core at once: it reads
+ *  and decodes files (OBJ, .dmesh, PPM) into staging memory the asset
+ *  owns. Its upload function runs on the GL thread
+ *  from Update(), which is called once per frame with a byte budget.
+ *  An upload may take a slice of its data per call (a texture uploads
+ *  whole rows at a time), so one large asset is spread over several
+ *  frames instead of stalling one.
+ *
+ *  Parses run in any order and at the same time as each other. Uploads
+ *  run in the order the assets were queued, once they are parsed, so
+ *  an asset can rely on everything queued before it. An
+ *  upload may queue further assets (a mesh queueing its texture).
+ *
+ *  Request() does the same for an asset of type T and returns an
+ *  AssetFuture for it, so code asks for an asset ahead of time and
+ *  checks (or chains onto) the future instead of waiting on a load.
+ *
+ *  An asset may name the files its parse opens. They are read into
+ *  memory together ahead of the parse, through io_uring where there is
+ *  one (see FileReader.hpp), and freed after it, so a parse does not
+ *  block its worker on the disk.
+ *
+ *  Parse functions must not touch GL or the trace recorder. The time
+ *  each parse took is added to the trace, if one is attached, when its
+ *  upload finishes.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef ASSETLOADER_HPP
+#define ASSETLOADER_HPP
+
+#include "AssetFuture.hpp"
+#include "JobSystem.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+class Texture;
+class TraceRecorder;
+
+// Runs as a job, fills the asset's staging memory
+typedef std::function<void()> AssetParse;
+// Runs on the GL thread with what is left of the frame's budget; uploads
+// some or all of what is left, takes it off budget and returns true once
+// the asset is completely uploaded
+typedef std::function<bool(size_t& budget)> AssetUpload;
+
+class AssetLoader{
+public:
+    // Constructor
+    AssetLoader();
+    // Destructor, stops parsing
+    ~AssetLoader();
+    // Starts parsing the assets queued so far and every later one
+    void Start();
+    // Waits for the parses that started; the rest and every unfinished
+    // asset are dropped
+    void Stop();
+    // Queues an asset. Call from the GL thread.
+    void Load(const std::string& name, AssetParse parse, AssetUpload upload);
+    // Queues an asset whose parse opens files, which are read first
+    void Load(const std::string& name, std::vector<std::string> files, AssetParse parse, AssetUpload upload);
+    // Queues an asset of type T: parse fills it in a job, upload takes it
+    // to the GPU as Load() does. Call from the GL thread.
+    template<typename T>
+    AssetFuture<T> Request(const std::string& name,
+                           std::function<void(T&)> parse,
+                           std::function<bool(T&, size_t& budget)> upload,
+                           std::vector<std::string> files = std::vector<std::string>());
+    // Decodes the .ppm or .ktx at filepath in a job and uploads it whole;
+    // a file that cannot be used gives a texture that is not loaded
+    AssetFuture<Texture> RequestTexture(const std::string& filepath);
+    // Runs parsed uploads in queue order until budgetBytes are spent or
+    // the next asset is not parsed yet. Returns the bytes uploaded.
+    size_t Update(size_t budgetBytes);
+    // Assets queued so far, and those fully uploaded
+    inline size_t GetQueuedCount() const{
+        return m_queued;
+    }
+    inline size_t GetLoadedCount() const{
+        return m_loaded;
+    }
+    // Assets timed from being queued to the end of their upload, and
+    // those times added up in seconds; safe from any thread
+    inline uint64_t GetTimedLoadCount() const{
+        return m_timedLoads.load(std::memory_order_relaxed);
+    }
+    double GetLoadSeconds() const;
+    // True when every queued asset is uploaded
+    inline bool IsIdle() const{
+        return m_loaded == m_queued;
+    }
+    // Records every parse as an asset load of trace
+    inline void SetTrace(TraceRecorder* trace){
+        m_trace = trace;
+    }
+private:
+    AssetLoader(const AssetLoader&) = delete;
+    AssetLoader& operator=(const AssetLoader&) = delete;
+
+    struct Asset{
+        std::string name;
+        AssetParse parse;
+        AssetUpload upload;
+        // Read before the parse, released after it
+        std::vector<std::string> files;
+        // Set by the parse job
+        std::atomic<bool> parsed{false};
+        uint64_t queued{0};
+        uint64_t parseStart{0};
+        uint64_t parseEnd{0};
+    };
+
+    // Submits the parse job of an asset
+    void SubmitParse(Asset* asset);
+    // The parse job
+    void Parse(Asset* asset);
+
+    // Parse jobs not finished yet
+    JobCounter m_parses;
+    // Queued before Start()
+    std::vector<Asset*> m_waiting;
+    bool m_started{false};
+    // Parses that did not start by now are skipped
+    std::atomic<bool> m_stop{false};
+    // Owned here, touched only by the GL thread
+    std::deque<std::unique_ptr<Asset>> m_uploadQueue;
+    size_t m_queued{0};
+    size_t m_loaded{0};
+    // Written only by the GL thread
+    std::atomic<uint64_t> m_timedLoads{0};
+    std::atomic<uint64_t> m_loadCounts{0};
+    TraceRecorder* m_trace{nullptr};
+};
+
+template<typename T>
+AssetFuture<T> AssetLoader::Request(const std::string& name,
+                                    std::function<void(T&)> parse,
+                                    std::function<bool(T&, size_t& budget)> upload,
+                                    std::vector<std::string> files){
+    typedef typename AssetFuture<T>::State State;
+    std::shared_ptr<State> state = std::make_shared<State>();
+    Load(name, std::move(files),
+        [state, parse]{
+            parse(state->value);
+        },
+        [state, upload](size_t& budget){
+            if(!upload(state->value, budget)){
+                return false;
+            }
+            AssetFuture<T>::Complete(*state);
+            return true;
+        });
+    return AssetFuture<T>(state);
+}
+
+#endif
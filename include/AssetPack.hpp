@@ -0,0 +1,161 @@
+/** @file AssetPack.hpp
+ *  @brief One file holding every asset, mapped once and read in place.
+ *
+ *  A pack bundles the game's meshes (as .dmesh), textures, materials
+ *  and shader sources under their paths relative to the repository
+ *  root. It is opened with a single mmap; after that, every FileView
+ *  of a packed path is a zero-copy view into the mapping, so the
+ *  loaders that read through FileView (meshes, OBJ/MTL, PPM, shaders)
+ *  find their files without any further open or path lookup on disk.
+ *  Paths that are not in the pack still open from disk. The mapping is
+ *  advised for transparent huge pages (see HugePages.hpp).
+ *
+ *  The mapping stays for the rest of the run: views into it are handed
+ *  out freely and are never tracked.
+ *
+ *  Large files can be stored compressed, for storage where reading a
+ *  byte costs more than decoding it (SD cards, eMMC): cut into blocks of
+ *  blockBytes, each compressed on its own in the LZ4 block format (see
+ *  LZ4Block.hpp). Decompress() decodes the blocks of a file in parallel
+ *  on the JobSystem into any memory, the read-ahead memory of FileReader
+ *  or a mapped pixel unpack buffer say; a FileView of a compressed file
+ *  gets it decompressed into memory of its own, which lives as long as
+ *  the view. Find() only knows the files stored as they are, which stay
+ *  zero-copy. A block that would not shrink is stored as it is.
+ *
+ *  A build with EMBED_ASSETS defined (python3 build.py --embed-assets)
+ *  also carries a pack inside the executable, EMBEDDED_ASSET_PACK in
+ *  the include/EmbeddedAssets.inc that ./dinopack --embed writes.
+ *  OpenEmbedded() reads it in place just like a mapped one, so the game
+ *  starts without looking up a single asset path on disk.
+ *
+ *  Layout (little endian), built by tools/dinopack.cpp:
+ *      AssetPackHeader
+ *      AssetPackEntry[entryCount], sorted by name
+ *      names (namesBytes bytes, not null-terminated)
+ *      file data, every file starting on a DATA_ALIGNMENT boundary
+ *  and a compressed file's data is
+ *      uint32_t blockEnds[blockCount], where each block's bytes end,
+ *          counted from the end of this table
+ *      the blocks, back to back
+ *
+ *  @bug No known bugs.
+ */
+#ifndef ASSETPACK_HPP
+#define ASSETPACK_HPP
+
+#include "FileView.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct AssetPackHeader{
+    char magic[4];          // "DPAK"
+    uint32_t version;       // ASSET_PACK_VERSION
+    uint32_t entryCount;    // Files in the pack
+    uint32_t namesBytes;    // Size of the name block after the entries
+    uint32_t blockBytes;    // Bytes a block of a compressed file decodes to
+    uint32_t reserved;
+};
+
+struct AssetPackEntry{
+    uint64_t offset;        // From the start of the pack
+    uint64_t storedSize;    // Bytes in the pack
+    uint64_t size;          // Bytes of the file
+    uint32_t nameOffset;    // Into the name block
+    uint32_t nameLength;
+    uint32_t codec;         // ASSET_CODEC_*
+    uint32_t reserved;
+};
+
+const uint32_t ASSET_PACK_VERSION = 2;
+
+// How a packed file is stored
+const uint32_t ASSET_CODEC_NONE = 0;
+const uint32_t ASSET_CODEC_LZ4 = 1;
+
+// How AssetPack::Build() stores the files
+struct AssetPackOptions{
+    uint32_t codec{ASSET_CODEC_LZ4};
+    uint32_t blockBytes{64u << 10};
+    // Smaller files are stored as they are
+    size_t minimumBytes{16u << 10};
+};
+
+class AssetPack{
+public:
+    // A file to pack under a name
+    struct File{
+        std::string name;
+        std::vector<char> data;
+        // Stored as it is even when compressing, for files read in place
+        bool raw{false};
+    };
+
+
+    // The pack FileView reads through
+    static AssetPack& Get();
+    // Maps a pack and routes FileView through it, false if it is missing
+    // or invalid
+    bool Open(const std::string& filepath);
+    // Routes FileView through the pack built into the executable, false
+    // in builds without one
+    bool OpenEmbedded();
+    // Stops routing FileView through the pack
+    void Close();
+    inline bool IsOpen() const{
+        return m_data != nullptr;
+    }
+    // Files in the pack
+    inline size_t GetEntryCount() const{
+        return m_entryCount;
+    }
+    // The bytes of a packed file, false if the pack does not hold it or
+    // holds it compressed
+    bool Find(const std::string& filepath, const char*& data, size_t& size) const;
+    // The decompressed size of a packed file and whether it is stored
+    // compressed, false if the pack does not hold it
+    bool Stat(const std::string& filepath, size_t& size, bool& compressed) const;
+    // Decodes a packed file into the size bytes at destination, its
+    // blocks in parallel on the JobSystem; false if the pack does not
+    // hold it, size is not its size or a block is corrupt
+    bool Decompress(const std::string& filepath, char* destination, size_t size) const;
+    // The name a path is packed under: no leading "./" and no "/./"
+    static std::string NormalizePath(const std::string& filepath);
+    // The bytes of a pack of files
+    static std::vector<char> Build(std::vector<File> files, const AssetPackOptions& options = AssetPackOptions());
+    // Writes a pack of files, returns false on I/O failure
+    static bool Write(const std::string& filepath, std::vector<File> files,
+                      const AssetPackOptions& options = AssetPackOptions());
+private:
+    // Files start on this boundary, enough for the floats of a .dmesh
+    static const size_t DATA_ALIGNMENT = 16;
+
+    // Constructor
+    AssetPack();
+    // Destructor
+    ~AssetPack();
+    // Checks the pack in data and routes FileView through it; name is
+    // what messages call it
+    bool Parse(const char* data, size_t size, const std::string& name);
+    // The entry of a path, nullptr if the pack does not hold it
+    const AssetPackEntry* FindEntry(const std::string& filepath) const;
+    // Decodes the blocks [first, last) of a compressed entry
+    bool DecompressBlocks(const AssetPackEntry& entry, size_t first, size_t last, char* destination) const;
+    // FileViewLookup into the open pack
+    static bool Lookup(const std::string& filepath, const char*& data, size_t& size,
+                       std::shared_ptr<const void>& owner);
+
+    // The mapped pack file, closed for the embedded one
+    FileView m_file;
+    const char* m_data{nullptr};
+    const AssetPackEntry* m_entries{nullptr};
+    size_t m_entryCount{0};
+    const char* m_names{nullptr};
+    size_t m_blockBytes{0};
+};
+
+#endif
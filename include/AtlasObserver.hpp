@@ -0,0 +1,171 @@
+/** @file AtlasObserver.hpp
+ *  @brief Pixel observations of many environments rendered in one pass.
+ *
+ *  Every environment of a GameStateBatch gets a tile of one atlas
+ *  framebuffer, cols x rows tiles of the observation size with cols
+ *  the ceiling of the square root of the count. The whole atlas is
+ *  then one batch of instanced draws: an instance per background, dino
+ *  and cactus of every environment, five commands in all (the day and
+ *  the night background, the two run frames and the cactus) whatever
+ *  the number of environments.
+ *
+ *  Each instance carries its environment's index where the scene's
+ *  instances carry a palette column, and shaders/atlas_vert.glsl moves
+ *  it into that environment's tile: the vertex is projected with the
+ *  tile camera, clipped against the tile camera's own view with four
+ *  user clip planes, and its clip space squeezed into the tile. This
+ *  is what gl_ViewportIndex would do, without needing
+ *  GL_ARB_shader_viewport_layer_array to set it from a vertex shader.
+ *
+ *  The atlas is read back like a PixelObserver frame: one asynchronous
+ *  glReadPixels into a ring of pixel buffer objects, mapped once its
+ *  fence has signalled. GetLatest() holds every environment's frame,
+ *  environment after environment, each tightly packed 8-bit grayscale
+ *  or RGB rows, bottom row first, the layout dinoserve serves.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef ATLASOBSERVER_HPP
+#define ATLASOBSERVER_HPP
+
+#include "Camera.hpp"
+#include "DrawBatch.hpp"
+#include "GameStateBatch.hpp"
+#include "MeshRegistry.hpp"
+#include "ShaderProgram.hpp"
+#include "TextureArray.hpp"
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// What the environments are drawn with, ranges of one shared mesh
+struct AtlasScene{
+    DrawRange dayBackground;
+    DrawRange nightBackground;
+    DrawRange dinoFrames[2];
+    DrawRange cactus;
+    // Texture array layers of the background by day and by night
+    float dayLayer{0.0f};
+    float nightLayer{0.0f};
+    // The PaletteTexture the dino and the cacti are coloured from
+    GLuint palette{0};
+};
+
+class AtlasObserver{
+public:
+    // Constructor
+    AtlasObserver();
+    // Destructor
+    // Note: Call Release() while the GL context is alive.
+    ~AtlasObserver();
+    // Creates the atlas of count tiles of width x height, the readback
+    // ring and the shaders. Fails if the atlas is larger than the
+    // driver's largest renderbuffer.
+    bool Initialize(size_t count, int width, int height, bool grayscale,
+                    const std::string& vertexPath, const std::string& fragmentPath, unsigned int ringSize=3);
+    // True once Initialize() succeeded
+    inline bool IsReady() const{
+        return m_framebuffer != 0;
+    }
+    // Draws the environments of environments from first on (up to the
+    // count given to Initialize()) into their tiles from mesh, sampling
+    // textures, then starts reading the atlas back and collects finished
+    // readbacks. Leaves the atlas bound for drawing.
+    void Render(const GameStateBatch& environments, const AtlasScene& scene,
+                MeshRegistry& registry, MeshHandle mesh, const TextureArray& textures, size_t first = 0);
+    // Shows the whole atlas scaled up in the window's framebuffer
+    void BlitToWindow(int windowWidth, int windowHeight) const;
+
+    inline size_t GetCount() const{
+        return m_count;
+    }
+    inline int GetWidth() const{
+        return m_width;
+    }
+    inline int GetHeight() const{
+        return m_height;
+    }
+    // 1 for grayscale, 3 for RGB
+    inline int GetChannels() const{
+        return m_grayscale ? 1 : 3;
+    }
+    // Tiles across and down the atlas
+    inline int GetColumns() const{
+        return m_columns;
+    }
+    inline int GetRows() const{
+        return m_rows;
+    }
+    // The newest completed frames, GetCount() frames of
+    // GetWidth()*GetHeight()*GetChannels() bytes each
+    inline const uint8_t* GetLatest() const{
+        return m_latest.data();
+    }
+    // Render() count of the newest completed frames, -1 before the first
+    inline long GetLatestFrame() const{
+        return m_latestFrame;
+    }
+    // Atlases read back so far, and how often Render() had to wait
+    inline unsigned long GetReadbackCount() const{
+        return m_readbacks;
+    }
+    inline unsigned long GetStallCount() const{
+        return m_stalls;
+    }
+    // Draw calls of the last Render()
+    inline size_t GetDrawCallCount() const{
+        return m_batch.GetDrawCallCount();
+    }
+    // Deletes the framebuffer, buffers and shaders
+    void Release();
+private:
+    struct Slot{
+        GLuint buffer;
+        GLsync fence;   // Set while a readback is in flight
+        long frame;
+    };
+    // Queues the instances of every environment
+    void AddInstances(const GameStateBatch& environments, const AtlasScene& scene, size_t first);
+    // Starts reading the atlas back and collects finished readbacks
+    void Capture();
+    // Splits a slot's finished readback into m_latest. With wait set it
+    // blocks until the GPU is done, otherwise it gives up if not done yet.
+    bool Collect(Slot& slot, bool wait);
+
+    GLuint m_framebuffer{0};
+    GLuint m_colorBuffer{0};
+    GLuint m_depthBuffer{0};
+    std::vector<Slot> m_slots;
+    unsigned int m_nextSlot{0};
+    ShaderProgram m_program;
+    GLint m_viewProjectionLocation{-1};
+    GLint m_gridLocation{-1};
+    GLint m_textureLocation{-1};
+    GLint m_paletteIndexLocation{-1};
+    GLint m_paletteLocation{-1};
+    GLint m_uvOffsetLocation{-1};
+    GLint m_timeOfDayLocation{-1};
+    GLint m_opacityLocation{-1};
+    DrawBatch m_batch;
+    // Projects one tile, the observation size
+    Camera m_camera;
+    // Instances of each command, refilled every Render()
+    std::vector<InstanceData> m_instances[5];
+    size_t m_count{0};
+    int m_width{0};
+    int m_height{0};
+    int m_columns{0};
+    int m_rows{0};
+    bool m_grayscale{true};
+    long m_frame{0};
+    std::vector<uint8_t> m_latest;
+    long m_latestFrame{-1};
+    unsigned long m_readbacks{0};
+    unsigned long m_stalls{0};
+};
+
+#endif
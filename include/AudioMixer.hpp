@@ -0,0 +1,119 @@
+/** @file AudioMixer.hpp
+ *  @brief Sound effects mixed in the SDL audio callback.
+ *
+ *  Every sound is decoded once, before Start(), into mono float samples
+ *  at the device's rate, and never changes after that. The game plays
+ *  one with Play(), which only pushes a command into an SpscQueue. The
+ *  callback runs on SDL's audio thread. At the start of every buffer it
+ *  pops the queued commands, gives each one a voice from a fixed pool,
+ *  and adds the voices up into the buffer.
+ *
+ *  Neither side takes a lock or allocates. SDL_LockAudioDevice() is
+ *  never called, so a slow frame cannot delay a buffer and the callback
+ *  never waits on the frame loop. Buffers are small, 256 frames by
+ *  default (about 5 ms at 48 kHz), so a sound starts a buffer or two
+ *  after Play().
+ *
+ *  One thread plays sounds, the one that called Start(). A full queue
+ *  or a full voice pool drops the newest sound, never the buffer.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef AUDIOMIXER_HPP
+#define AUDIOMIXER_HPP
+
+#include "SpscQueue.hpp"
+
+#include <SDL2/SDL.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class AudioMixer{
+public:
+    // Sounds playing at once; one more Play() is dropped
+    static const int MAX_VOICES = 16;
+
+    // Constructor
+    AudioMixer();
+    // Destructor
+    ~AudioMixer();
+    // Opens the default output device, paused, with bufferFrames frames
+    // per callback. Returns false, after saying why, if there is none.
+    bool Open(int bufferFrames);
+    // Decodes a WAV file into a sound at the device's rate. Returns its
+    // id, or -1 if the file is missing or cannot be converted. Only
+    // before Start().
+    int LoadWav(const std::string& filepath);
+    // Adds mono samples, already at the device's rate, as a sound and
+    // returns its id. Only before Start().
+    int AddSound(const std::vector<float>& samples);
+    // Unpauses the device; the sounds are fixed from here on
+    void Start();
+    // Queues sound to start at volume (1 as recorded). Returns false if
+    // the mixer is not running or the queue is full.
+    bool Play(int sound, float volume = 1.0f);
+    // Stops the callback and closes the device
+    void Close();
+
+    inline bool IsRunning() const{
+        return m_started;
+    }
+    // Frames per second of the device, 0 before Open()
+    inline int GetSampleRate() const{
+        return m_spec.freq;
+    }
+    // Frames per buffer, as the device granted them
+    inline int GetBufferFrames() const{
+        return m_spec.samples;
+    }
+    // Buffers mixed so far, read from any thread
+    inline uint64_t GetMixedBuffers() const{
+        return m_mixedBuffers.load(std::memory_order_relaxed);
+    }
+    // Plays that never started: a full queue or every voice busy
+    inline uint64_t GetDroppedSounds() const{
+        return m_droppedSounds + m_droppedVoices.load(std::memory_order_relaxed);
+    }
+
+    // A decaying sweep from fromHertz to toHertz over seconds at
+    // sampleRate, noise (0 to 1) of it white noise; what the game plays
+    // when it has no WAV file for a sound
+    static std::vector<float> MakeSweep(int sampleRate, float fromHertz, float toHertz, float seconds, float noise);
+private:
+    struct Command{
+        int sound;
+        float volume;
+    };
+    struct Voice{
+        const float* samples = nullptr;
+        size_t length = 0;
+        size_t position = 0;
+        float volume = 0.0f;
+    };
+
+    AudioMixer(const AudioMixer&) = delete;
+    AudioMixer& operator=(const AudioMixer&) = delete;
+
+    static void SDLCALL Callback(void* userdata, Uint8* stream, int bytes);
+    // The audio thread's side: starts the queued voices and mixes frames
+    // stereo frames into output
+    void Mix(float* output, int frames);
+
+    SpscQueue<Command, 64> m_commands;
+    // Only the callback touches the voices
+    Voice m_voices[MAX_VOICES];
+    std::vector<std::vector<float>> m_sounds;
+    SDL_AudioDeviceID m_device{0};
+    SDL_AudioSpec m_spec{};
+    bool m_started{false};
+    // Counted by the game thread and by the callback
+    uint64_t m_droppedSounds{0};
+    std::atomic<uint64_t> m_droppedVoices{0};
+    std::atomic<uint64_t> m_mixedBuffers{0};
+};
+
+#endif
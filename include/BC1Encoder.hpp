@@ -0,0 +1,32 @@
+/** @file BC1Encoder.hpp
+ *  @brief BC1 (S3TC DXT1) block compression of RGBA images.
+ *
+ *  The encoder texconv and dinocook write .bc1.ktx files with. Each 4x4
+ *  block takes the extremes of its opaque texels along their principal
+ *  axis as endpoints; a block with a texel of less than half alpha uses
+ *  BC1's three color mode, whose fourth index is transparent, so the
+ *  game's magenta keyed texels stay transparent. Mips are box filtered
+ *  in linear light, the alpha as it is.
+ *
+ *  Images are tightly packed RGBA rows, in whatever row order the
+ *  texture is uploaded in; blocks follow the rows as given.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef BC1ENCODER_HPP
+#define BC1ENCODER_HPP
+
+#include <cstdint>
+#include <vector>
+
+// The BC1 blocks of a width by height image; blocks over the edge repeat
+// the last row or column
+std::vector<uint8_t> EncodeBC1(const uint8_t* rgba, int width, int height);
+// Halves an image with a 2x2 box filter, width and height set to the
+// size of the level returned. An odd row or column is averaged with
+// itself, a size of 1 stays 1.
+std::vector<uint8_t> HalveImage(const std::vector<uint8_t>& rgba, int& width, int& height);
+// Every level of the image down to 1x1, BC1 encoded, the full one first
+std::vector<std::vector<uint8_t>> EncodeBC1MipChain(const uint8_t* rgba, int width, int height);
+
+#endif
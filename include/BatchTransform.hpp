@@ -0,0 +1,27 @@
+/** @file BatchTransform.hpp
+ *  @brief Places many bounding volumes by their transforms at once.
+ *
+ *  Entities are placed by an offset and a uniform scale, a vec4 of
+ *  {x, y, z, scale}, and carry a model space bounding sphere, a vec4
+ *  of {x, y, z, radius}. Both are 16-byte aligned records inside the
+ *  component arrays. PlaceSpheres() loads four of each with SSE on
+ *  x86-64 or NEON on AArch64, transposes them into lanes and writes
+ *  the world space spheres as the structure of arrays CullSpheres()
+ *  takes; the remainder, and other targets, go one at a time.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef BATCHTRANSFORM_HPP
+#define BATCHTRANSFORM_HPP
+
+#include <cstddef>
+
+// Places count spheres: center becomes offset + center*scale and radius
+// radius*scale. transforms and spheres point at the first vec4 of each
+// record, the records transformStride and sphereStride bytes apart; both
+// must be 16-byte aligned, strides included.
+void PlaceSpheres(const float* transforms, size_t transformStride,
+                  const float* spheres, size_t sphereStride, size_t count,
+                  float* x, float* y, float* z, float* radius);
+
+#endif
@@ -0,0 +1,147 @@
+/** @file CPUProfiler.hpp
+ *  @brief CPU timings of named code zones, from any thread.
+ *
+ *  A zone is timed by a ProfileZone on the stack: it reads
+ *  SDL_GetPerformanceCounter() when it is created and again when it
+ *  goes out of scope. The pair is pushed into a ring owned by the
+ *  calling thread, with a single writer and a single reader, so
+ *  recording never takes a lock or allocates. The first zone a thread
+ *  records registers its ring, which is the only time a lock is taken.
+ *  A full ring drops samples rather than wait.
+ *
+ *  Collect() moves every thread's samples into a rolling window per
+ *  zone, from which Report() prints the min, mean, p95 and p99, the
+ *  same way GPUProfiler does for render passes. With a TraceRecorder
+ *  attached, Collect() also hands it every sample, and so it does to a
+ *  FlightRecorder.
+ *
+ *  Each thread also tracks the innermost ProfileZone it is in, so
+ *  other instrumentation (the allocation counter) can tell which zone
+ *  it runs in.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef CPUPROFILER_HPP
+#define CPUPROFILER_HPP
+
+#include <SDL2/SDL.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class FlightRecorder;
+class TraceRecorder;
+
+class CPUProfiler{
+public:
+    // The profiler every ProfileZone records into
+    static CPUProfiler& Get();
+
+    // Registers a zone and returns its id. Add zones before any thread
+    // records them.
+    int AddZone(const std::string& name);
+    // Records one run of a zone on the calling thread, performance
+    // counter values as taken by ProfileZone
+    void Record(int zone, uint64_t start, uint64_t end);
+    // Moves the samples recorded so far into the rolling windows
+    void Collect();
+    // Prints the rolling min, mean, p95 and p99 of every zone that ran
+    void Report() const;
+    // Also passes every collected sample to trace while it records, with
+    // the thread as its track. Call after every zone is added.
+    void SetTrace(TraceRecorder* trace);
+    // Also passes every collected sample to flight while it records.
+    // Call after every zone is added.
+    void SetFlightRecorder(FlightRecorder* flight);
+    // Zones registered so far, and their names
+    inline int GetZoneCount() const{
+        return (int)m_zones.size();
+    }
+    inline const std::string& GetZoneName(int zone) const{
+        return m_zones[zone].name;
+    }
+    // Rolling mean of a zone in milliseconds, negative if it never ran
+    double GetZoneMean(int zone) const;
+    // The innermost ProfileZone the calling thread is in, -1 if none
+    static int GetCurrentZone();
+    // Makes zone the calling thread's current zone, returns the previous
+    static int EnterZone(int zone);
+    // Goes back to the zone EnterZone() returned
+    static void LeaveZone(int previous);
+    // Samples lost to full rings so far
+    inline uint64_t GetDroppedCount() const{
+        return m_dropped.load(std::memory_order_relaxed);
+    }
+private:
+    // Constructor
+    CPUProfiler();
+    // Destructor
+    ~CPUProfiler();
+
+    // Samples a thread can have waiting for Collect(), a power of two
+    static const uint32_t RING_SIZE = 1024;
+    // Samples kept per zone for the rolling statistics
+    static const size_t WINDOW_SIZE = 600;
+
+    struct Sample{
+        int zone;
+        uint64_t start;
+        uint64_t end;
+    };
+    // Written only by its thread, read only by Collect()
+    struct ThreadRing{
+        Sample samples[RING_SIZE];
+        std::atomic<uint32_t> head{0};  // Next slot to write
+        std::atomic<uint32_t> tail{0};  // Next slot to read
+    };
+    struct Zone{
+        std::string name;
+        // Rolling window of times in milliseconds
+        std::vector<double> samples;
+        size_t nextSample{0};
+        // Name id in the trace
+        int traceName{-1};
+        // Name id in the flight recorder
+        int flightName{-1};
+    };
+
+    // The calling thread's ring, registered on first use
+    ThreadRing& GetThreadRing();
+
+    std::vector<Zone> m_zones;
+    // Guards m_rings; taken when a thread registers and by Collect()
+    std::mutex m_ringsMutex;
+    std::vector<std::unique_ptr<ThreadRing>> m_rings;
+    std::atomic<uint64_t> m_dropped{0};
+    double m_millisecondsPerCount{0.0};
+    TraceRecorder* m_trace{nullptr};
+    FlightRecorder* m_flight{nullptr};
+};
+
+// Times the scope it lives in as one run of a zone
+class ProfileZone{
+public:
+    // Constructor
+    explicit ProfileZone(int zone)
+        : m_zone(zone), m_parent(CPUProfiler::EnterZone(zone)), m_start(SDL_GetPerformanceCounter()){
+
+    }
+    // Destructor
+    ~ProfileZone(){
+        CPUProfiler::Get().Record(m_zone, m_start, SDL_GetPerformanceCounter());
+        CPUProfiler::LeaveZone(m_parent);
+    }
+    ProfileZone(const ProfileZone&) = delete;
+    ProfileZone& operator=(const ProfileZone&) = delete;
+private:
+    int m_zone;
+    int m_parent;
+    uint64_t m_start;
+};
+
+#endif
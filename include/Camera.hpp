@@ -3,7 +3,10 @@
  *  @brief Sets up an OpenGL camera.
  *  
  *  Sets up an OpenGL Camera. The camera is what
- *  sets up our 'view' matrix.
+ *  sets up our 'view' and 'projection' matrices.
+ *  Both are cached, together with their product, and
+ *  only rebuilt after the camera moves or the viewport
+ *  or lens changes.
  *
  *  @author Mike
  *  @bug No known bugs.
@@ -19,7 +22,15 @@ public:
     Camera();
     // Return a 'view' matrix with our
     // camera transformation applied.
-    glm::mat4 GetViewMatrix() const;
+    const glm::mat4& GetViewMatrix() const;
+    // Return the perspective 'projection' matrix
+    const glm::mat4& GetProjectionMatrix() const;
+    // Return projection * view, for culling and the shaders
+    const glm::mat4& GetViewProjectionMatrix() const;
+    // Set the size in pixels of what the camera draws into
+    void SetViewportSize(int width, int height);
+    // Set the vertical field of view (in degrees) and the clip planes
+    void SetPerspective(float fovDegrees, float nearPlane, float farPlane);
     // Move the camera around
     void MouseLook(int mouseX, int mouseY);
     void MoveForward(float speed);
@@ -30,6 +41,8 @@ public:
     void MoveDown(float speed);
     // Set the position for the camera
     void SetCameraEyePosition(float x, float y, float z);
+    // Set the direction the camera looks in
+    void SetViewDirection(float x, float y, float z);
     // Returns the Camera X Position where the eye is 
     float GetEyeXPosition();
     // Returns the Camera Y Position where the eye is 
@@ -55,6 +68,20 @@ private:
     // to 'rock' or 'rattle' the camera you might play
     // with modifying this value.
     glm::vec3 m_upVector;
+
+    // Lens and viewport of the projection
+    float m_fovDegrees{45.0f};
+    float m_nearPlane{0.1f};
+    float m_farPlane{20.0f};
+    float m_aspectRatio{1.0f};
+
+    // Cached matrices, rebuilt on first use after a change
+    mutable glm::mat4 m_viewMatrix;
+    mutable glm::mat4 m_projectionMatrix;
+    mutable glm::mat4 m_viewProjectionMatrix;
+    mutable bool m_viewDirty{true};
+    mutable bool m_projectionDirty{true};
+    mutable bool m_viewProjectionDirty{true};
 };
 
 
@@ -0,0 +1,151 @@
+/** @file Collision.hpp
+ *  @brief Hit boxes in game units, derived from mesh bounds.
+ *
+ *  The simulation works in integer lane units: an obstacle at screen
+ *  position p is drawn offset by p*0.01 along x, and the dino at
+ *  height h is drawn raised by h*0.01. A CollisionBox is a mesh's x/y
+ *  bounds converted to those units and shrunk by an inset, so hits
+ *  follow the meshes while brushing a corner stays forgiving. A hit
+ *  is an overlap of two boxes placed at their objects' positions.
+ *
+ *  Step() reads the dino and obstacle boxes from GetCollisionRules().
+ *  The defaults were derived from the shipped meshes, so headless tools
+ *  that never load a mesh collide exactly like the game; the game sets
+ *  the rules from the meshes it actually loaded, once at startup and
+ *  before any simulation thread starts.
+ *
+ *  Moving objects are tested swept: SegmentInRange() checks the whole
+ *  straight path of one box relative to another during a step, not
+ *  just where the step ends.
+ *
+ *  FindFirstOverlap() tests one box against a whole array of obstacles,
+ *  several at a time with SIMD (see SimdLanes.hpp).
+ *
+ *  A box is only the broad phase. Each box also has a silhouette, the
+ *  cells of it that its mesh covers seen from the side, one bit per game
+ *  unit and a 64-bit word per row. Where the boxes of a sweep overlap,
+ *  SweptHit() walks the path a unit at a time and tests the
+ *  overlapping rows, a shift and an AND each, so tails and arms hit and
+ *  the gaps between them do not. The default silhouettes were baked from
+ *  the shipped meshes like the boxes; SetCollisionRules() with boxes
+ *  alone turns the narrow phase off.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef COLLISION_HPP
+#define COLLISION_HPP
+
+#include "AABB.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+// Game units per world unit
+const float GAME_UNITS_PER_WORLD_UNIT = 100.0f;
+// Fraction of a mesh's extent trimmed off each side of its hit box
+const float HITBOX_INSET = 0.25f;
+
+// Inclusive x/y extent in game units, relative to the object's position
+struct CollisionBox{
+    int minX;
+    int maxX;
+    int minY;
+    int maxY;
+};
+
+// Hit boxes of dino.obj/dino2.obj and cactus.obj with HITBOX_INSET
+const CollisionBox DEFAULT_DINO_BOX = {-167, -123, -80, -43};
+const CollisionBox DEFAULT_OBSTACLE_BOX = {-18, 15, -71, -22};
+
+// Widest and tallest box a silhouette covers, in game units
+const int SILHOUETTE_SIZE = 64;
+
+// The cells of box its mesh covers: bit i of rows[j] is the game unit at
+// (box.minX + i, box.minY + j). Rows and bits past the box stay 0.
+struct CollisionSilhouette{
+    CollisionBox box;
+    uint64_t rows[SILHOUETTE_SIZE];
+};
+
+// Silhouettes of DEFAULT_DINO_BOX (both run-cycle frames) and
+// DEFAULT_OBSTACLE_BOX
+extern const CollisionSilhouette DEFAULT_DINO_SILHOUETTE;
+extern const CollisionSilhouette DEFAULT_OBSTACLE_SILHOUETTE;
+
+// Converts mesh bounds to a hit box, rounding inwards. Computed in
+// Q16.16 fixed point, so every platform gets the same box.
+CollisionBox MakeCollisionBox(const AABB& bounds, float inset = HITBOX_INSET);
+
+// True if box is small enough for a silhouette
+bool FitsSilhouette(const CollisionBox& box);
+
+// An empty silhouette of box, one that fits
+CollisionSilhouette MakeCollisionSilhouette(const CollisionBox& box);
+
+// Marks the cells of silhouette covered by triangleCount triangles, given
+// as x, y pairs in world units, three corners each; call once per mesh
+// for a silhouette of several. A cell is covered if its game unit lies
+// in a triangle, edges included, tested in Q16.16 fixed point like
+// MakeCollisionBox().
+void AddSilhouetteTriangles(CollisionSilhouette& silhouette, const float* corners, size_t triangleCount);
+
+// The offsets of b's position from a's at which the two boxes overlap.
+// Turns every overlap test against a fixed pair into a range check.
+inline CollisionBox OverlapRange(const CollisionBox& a, const CollisionBox& b){
+    CollisionBox range = {a.minX - b.maxX, a.maxX - b.minX, a.minY - b.maxY, a.maxY - b.minY};
+    return range;
+}
+
+// True if the offset (x, y) lies within range
+inline bool InRange(const CollisionBox& range, int x, int y){
+    return range.minX <= x && x <= range.maxX && range.minY <= y && y <= range.maxY;
+}
+
+// True if an offset moving in a straight line from (x0, y0) to (x1, y1)
+// passes through range at any point, ends included. Exact in integers,
+// so nothing can tunnel through a range however far it moves at once.
+bool SegmentInRange(const CollisionBox& range, int x0, int y0, int x1, int y1);
+
+// True if box a at (ax, ay) overlaps box b at (bx, by)
+inline bool Overlaps(const CollisionBox& a, int ax, int ay, const CollisionBox& b, int bx, int by){
+    return InRange(OverlapRange(a, b), bx - ax, by - ay);
+}
+
+// True if silhouette b, its box at offset (x, y) from a's, shares a cell
+// with a
+bool SilhouettesOverlap(const CollisionSilhouette& a, const CollisionSilhouette& b, int x, int y);
+
+// The boxes the simulation collides with. On screen the dino box sits
+// at (0, dinoHeight), an obstacle's box at (its position, 0).
+struct CollisionRules{
+    CollisionBox dino;
+    CollisionBox obstacle;
+    // OverlapRange(dino, obstacle), kept with the boxes
+    CollisionBox hitRange;
+    // Whether hits within hitRange are narrowed to the silhouettes
+    bool silhouettes;
+    CollisionSilhouette dinoSilhouette;
+    CollisionSilhouette obstacleSilhouette;
+};
+
+const CollisionRules& GetCollisionRules();
+// Not thread safe: call before any GameStateBatch is filled, it caches
+// each game's lead obstacle against these rules. With boxes alone every
+// overlap of the boxes is a hit.
+void SetCollisionRules(const CollisionBox& dino, const CollisionBox& obstacle);
+// Collides the silhouettes' boxes, then the silhouettes
+void SetCollisionRules(const CollisionSilhouette& dino, const CollisionSilhouette& obstacle);
+
+// True if an obstacle offset moving in a straight line from (x0, y0) to
+// (x1, y1) from the dino hits it under rules: SegmentInRange() of the
+// hit range, then, with silhouettes, the silhouettes at every game unit
+// of the path where the boxes overlap.
+bool SweptHit(const CollisionRules& rules, int x0, int y0, int x1, int y1);
+
+// Index of the first of count obstacles (all using obstacleBox, placed at
+// obstacleX[i], obstacleY[i]) that overlaps box at (x, y), or count if none
+size_t FindFirstOverlap(const CollisionBox& box, int x, int y,
+                        const CollisionBox& obstacleBox, const int* obstacleX, const int* obstacleY,
+                        size_t count);
+
+#endif
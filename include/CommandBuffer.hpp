@@ -0,0 +1,159 @@
+/** @file CommandBuffer.hpp
+ *  @brief Render commands recorded as plain data and replayed on the GL
+ *  thread.
+ *
+ *  Recording makes no GL call: each call below appends one RenderCommand,
+ *  a 32-byte POD holding the GL names, locations and values it will need,
+ *  to a vector. A buffer can therefore be filled on any thread, by
+ *  whatever walks and culls the scene, while the thread that owns the
+ *  context only runs Execute(). Jobs that record in parallel each fill a
+ *  buffer of their own; the render thread executes them, or Append()s
+ *  them into one, in the order they are to be drawn.
+ *
+ *  Execute() goes through the calling thread's GLStateCache, so repeated
+ *  binds cost nothing. What a command names has to outlive its
+ *  execution: programs and buffers stay as they were recorded, and a
+ *  DrawBatch must have been uploaded by then (its DrawCommands() skip
+ *  nothing else). Code that rebuilds programs records its buffers again.
+ *
+ *  Draws not yet expressed as commands are recorded as Call()s of a
+ *  plain function, run in their place. The command list is all a
+ *  backend other than this one (DSA-only, Vulkan) would have to
+ *  translate; only Execute() knows GL.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef COMMANDBUFFER_HPP
+#define COMMANDBUFFER_HPP
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class DrawBatch;
+class GPUProfiler;
+
+enum RenderCommandType : uint8_t{
+    RENDER_COMMAND_USE_PROGRAM,
+    RENDER_COMMAND_BIND_UNIFORM_BLOCK,
+    RENDER_COMMAND_SET_UNIFORM,
+    RENDER_COMMAND_SET_CAPABILITY,
+    RENDER_COMMAND_BLEND_FUNC,
+    RENDER_COMMAND_DEPTH_MASK,
+    RENDER_COMMAND_DRAW_BATCH,
+    RENDER_COMMAND_BEGIN_PASS,
+    RENDER_COMMAND_END_PASS,
+    RENDER_COMMAND_CALL
+};
+
+// A function a Call() command runs on the GL thread
+typedef void (*RenderCallFunction)(void* data);
+
+// One recorded command; which member of the union is set depends on type
+struct RenderCommand{
+    RenderCommandType type;
+    union{
+        struct{
+            GLuint program;
+        } program;
+        struct{
+            GLuint binding;
+            GLuint buffer;
+            uint32_t offset;
+            uint32_t size;
+        } block;
+        struct{
+            GLint location;
+            // Floats of value used, 1 to 4
+            GLint count;
+            GLfloat value[4];
+        } uniform;
+        struct{
+            GLenum capability;
+            GLboolean enabled;
+        } capability;
+        struct{
+            GLenum source;
+            GLenum destination;
+        } blend;
+        struct{
+            GLboolean write;
+        } depth;
+        struct{
+            DrawBatch* batch;
+            uint32_t first;
+            uint32_t count;
+        } draw;
+        struct{
+            int pass;
+        } pass;
+        struct{
+            RenderCallFunction function;
+            void* data;
+        } call;
+    };
+};
+
+static_assert(sizeof(RenderCommand) <= 32, "RenderCommand should stay a compact POD");
+
+class CommandBuffer{
+public:
+    // Constructor
+    CommandBuffer();
+    // Destructor
+    ~CommandBuffer();
+    // Room for count commands without allocating
+    void Reserve(size_t count);
+    // Forgets the commands recorded so far
+    void Clear();
+
+    // glUseProgram
+    void UseProgram(GLuint program);
+    // glBindBufferRange(GL_UNIFORM_BUFFER, ...) of a uniform block
+    void BindUniformBlock(GLuint binding, GLuint buffer, size_t offset, size_t size);
+    // glUniform1f to glUniform4f of the program in use, count floats of
+    // value; locations of -1 are recorded and ignored, as GL does
+    void SetUniform(GLint location, const GLfloat* value, int count);
+    inline void SetUniform(GLint location, GLfloat value){
+        SetUniform(location, &value, 1);
+    }
+    // glEnable / glDisable
+    void SetCapability(GLenum capability, bool enabled);
+    // glBlendFunc
+    void BlendFunc(GLenum source, GLenum destination);
+    // glDepthMask
+    void DepthMask(bool write);
+    // DrawBatch::DrawCommands(first, count) of batch
+    void DrawBatchCommands(DrawBatch& batch, size_t first, size_t count);
+    // GPUProfiler::BeginPass and EndPass of the profiler Execute() gets
+    void BeginPass(int pass);
+    void EndPass(int pass);
+    // Runs function(data) in this place
+    void Call(RenderCallFunction function, void* data = nullptr);
+    // Appends the commands of other, after those recorded here
+    void Append(const CommandBuffer& other);
+
+    // Issues every command in order. Must be called on the thread of the
+    // GL context; passes are only timed with a profiler.
+    void Execute(GPUProfiler* profiler = nullptr) const;
+
+    inline size_t GetCount() const{
+        return m_commands.size();
+    }
+    inline const std::vector<RenderCommand>& GetCommands() const{
+        return m_commands;
+    }
+private:
+    inline RenderCommand& Add(RenderCommandType type){
+        m_commands.emplace_back();
+        RenderCommand& command = m_commands.back();
+        command.type = type;
+        return command;
+    }
+
+    std::vector<RenderCommand> m_commands;
+};
+
+#endif
@@ -0,0 +1,147 @@
+/** @file DrawBatch.hpp
+ *  @brief Collects the draws of one frame and submits them together.
+ *
+ *  Every queued draw is an index range of one shared mesh plus the
+ *  InstanceData of its instances. On Submit() the instances and the
+ *  draw commands are streamed into the next region of a RingBuffer.
+ *  When the driver exposes GL_ARB_multi_draw_indirect and
+ *  GL_ARB_base_instance, the whole batch is then drawn by one
+ *  glMultiDrawElementsIndirect call. Otherwise
+ *  the commands are replayed as a loop of instanced base-vertex draws.
+ *
+ *  Every draw may carry a RenderQueue sort key. Upload() orders the
+ *  commands by it, so a frame may queue its draws in whatever order it
+ *  finds them; draws with equal keys, and every draw without a key,
+ *  keep the order they were added in.
+ *
+ *  Once uploaded, the streams may be read by other passes too: a
+ *  GPUInstanceCuller compacts the instances of some commands into
+ *  buffers of its own and DrawCommandsFrom() draws them from there.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef DRAWBATCH_HPP
+#define DRAWBATCH_HPP
+
+#include "MeshRegistry.hpp"
+#include "RenderQueue.hpp"
+#include "RingBuffer.hpp"
+#include "VertexFormat.hpp"
+
+#include <glad/glad.h>
+
+#include <vector>
+#include <cstddef>
+
+// A sub-range of a shared mesh
+struct DrawRange{
+    GLsizei indexCount{0};      // Indices drawn
+    GLsizei firstIndex{0};      // First index of the range in the element buffer
+    GLint baseVertex{0};        // Added to every index of the range
+};
+
+// Layout read by glMultiDrawElementsIndirect
+struct DrawElementsIndirectCommand{
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+
+class DrawBatch{
+public:
+    // Constructor
+    DrawBatch();
+    // Destructor
+    // Note: Call Release() while the GL context is alive.
+    ~DrawBatch();
+    // Picks the submission path and creates the ring buffer with room for
+    // maxInstances instances and maxCommands draws per frame.
+    // Must be called after the GL loader is initialized.
+    void Initialize(size_t maxInstances, size_t maxCommands);
+    // Clears the commands queued for the previous frame
+    void Begin();
+    // Queues instanceCount instances of a range, ordered by sortKey (see
+    // RenderQueue.hpp). Ranges with no instances, and draws that exceed
+    // the batch capacity, are skipped.
+    void Add(const DrawRange& range, const InstanceData* instances, size_t instanceCount,
+             uint64_t sortKey = 0);
+    // Streams the queued instances and commands and draws every command
+    // from the given mesh. Same as Upload(), DrawCommands() and Finish().
+    void Submit(MeshRegistry& registry, MeshHandle mesh);
+    // Sorts the queued commands by key and streams them with the
+    // instances of this frame. Returns false if nothing can be drawn.
+    bool Upload(MeshRegistry& registry, MeshHandle mesh);
+    // Draws count commands starting at first, in sort key order. Lets a
+    // frame be split into passes, the pass field of the keys, without
+    // re-uploading anything.
+    void DrawCommands(size_t first, size_t count);
+    // DrawCommands() with multi-draw-indirect, from the commands in
+    // commandBuffer instead and their instances in instanceBuffer, laid
+    // out as uploaded: command i at i records, each baseInstance counting
+    // from the start of instanceBuffer. False, drawing nothing, without
+    // multi-draw-indirect or an upload.
+    bool DrawCommandsFrom(GLuint instanceBuffer, GLuint commandBuffer, size_t first, size_t count);
+    // Fences the streamed data once every command has been drawn
+    void Finish();
+    // True if Submit() uses a single multi-draw-indirect call
+    inline bool UsesMultiDrawIndirect() const{
+        return m_multiDrawIndirect;
+    }
+    // True between an Upload() that succeeded and Finish()
+    inline bool IsUploaded() const{
+        return m_uploaded;
+    }
+    // The ring buffer holding the uploaded streams, and where in it this
+    // frame's instances and commands start (the latter with
+    // multi-draw-indirect only)
+    inline GLuint GetBuffer() const{
+        return m_ring.GetBuffer();
+    }
+    inline size_t GetInstanceOffset() const{
+        return m_instanceOffset;
+    }
+    inline size_t GetCommandOffset() const{
+        return m_commandOffset;
+    }
+    // Command i in sort key order, once uploaded
+    inline const DrawElementsIndirectCommand& GetCommand(size_t i) const{
+        return m_commands[i];
+    }
+    // Number of draws queued since Begin()
+    inline size_t GetCommandCount() const{
+        return m_commands.size();
+    }
+    // Number of instances queued since Begin()
+    inline size_t GetInstanceCount() const{
+        return m_instances.size();
+    }
+    // Draw calls issued since Begin(): one per DrawCommands() with
+    // multi-draw-indirect, one per command otherwise
+    inline size_t GetDrawCallCount() const{
+        return m_drawCalls;
+    }
+    // Deletes the ring buffer
+    void Release();
+private:
+    std::vector<DrawElementsIndirectCommand> m_commands;
+    // Key and index of every command, and the commands in key order
+    RenderQueue m_queue;
+    std::vector<DrawElementsIndirectCommand> m_sortedCommands;
+    bool m_sorted{false};
+    std::vector<InstanceData> m_instances;
+    RingBuffer m_ring;
+    // Set by Upload() for the DrawCommands() that follow
+    MeshRegistry* m_registry{nullptr};
+    MeshHandle m_mesh{INVALID_MESH};
+    size_t m_instanceOffset{0};
+    size_t m_commandOffset{0};
+    bool m_uploaded{false};
+    size_t m_maxInstances{0};
+    size_t m_maxCommands{0};
+    bool m_multiDrawIndirect{false};
+    size_t m_drawCalls{0};
+};
+
+#endif
@@ -0,0 +1,81 @@
+/** @file DynamicResolution.hpp
+ *  @brief Scene resolution that follows the measured GPU frame time.
+ *
+ *  The scene is rendered into an offscreen color and depth target as
+ *  large as the window, but only into the lower left GetWidth() by
+ *  GetHeight() of it, a fraction GetScale() of the window on each side.
+ *  BlitToWindow() then stretches that part over the window with one
+ *  linear blit, and the overlay is drawn on top at full resolution.
+ *
+ *  Update() takes the GPU time of every frame from the timer queries
+ *  (see GPUProfiler::GetCollectedFrameTime()). Over budget, the scale
+ *  drops at once to about where the frame would fit, as the cost of
+ *  the scene goes with its area; well under budget, it climbs back one
+ *  step at a time. Scales are whole steps and hold for a few frames
+ *  after every change, because the timings arrive frames late and a
+ *  resolution that moves every frame shimmers. Nothing is reallocated
+ *  when the scale changes.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef DYNAMICRESOLUTION_HPP
+#define DYNAMICRESOLUTION_HPP
+
+#include <glad/glad.h>
+
+class DynamicResolution{
+public:
+    // Scales move by this much, and are multiples of it
+    static constexpr float SCALE_STEP = 0.05f;
+
+    // Constructor
+    DynamicResolution();
+    // Destructor
+    // Note: Call Release() while the GL context is alive.
+    ~DynamicResolution();
+    // Creates the target for a window of width by height pixels. The
+    // scale starts at maxScale and stays between minScale and maxScale,
+    // aiming for a GPU frame time of budgetMilliseconds.
+    bool Initialize(int width, int height, float minScale, double budgetMilliseconds, float maxScale = 1.0f);
+    // Feeds the GPU time of a frame in milliseconds (negative when no
+    // result was available) and picks the scale of the next frames
+    void Update(double gpuMilliseconds);
+    // Directs rendering (and the viewport) to the scaled part of the target
+    void Bind() const;
+    // Stretches the scaled frame over the window's framebuffer and
+    // directs rendering back to the window
+    void BlitToWindow() const;
+
+    // Size the scene is rendered at this frame
+    inline int GetWidth() const{
+        return m_renderWidth;
+    }
+    inline int GetHeight() const{
+        return m_renderHeight;
+    }
+    inline float GetScale() const{
+        return m_scale;
+    }
+    // Deletes the target
+    void Release();
+private:
+    // Sets the scale and the render size that goes with it
+    void SetScale(float scale);
+
+    GLuint m_framebuffer{0};
+    GLuint m_colorBuffer{0};
+    GLuint m_depthBuffer{0};
+    int m_width{0};
+    int m_height{0};
+    int m_renderWidth{0};
+    int m_renderHeight{0};
+    float m_scale{1.0f};
+    float m_minScale{1.0f};
+    float m_maxScale{1.0f};
+    double m_budget{0.0};
+    // Smoothed GPU time at the current scale, negative before a sample
+    double m_smoothed{-1.0};
+    int m_framesSinceChange{0};
+};
+
+#endif
@@ -0,0 +1,73 @@
+/** @file EnergyMeter.hpp
+ *  @brief Energy the machine draws, read from its power counters.
+ *
+ *  For --benchmark and --stress, so optimisations can be judged on the
+ *  joules they cost as well as on speed. On Linux the CPU side is the
+ *  RAPL package counters of powercap
+ *  (/sys/class/powercap/intel-rapl:<n>/energy_uj, which AMD processors
+ *  expose too), one per package; an integrated GPU is part of its
+ *  package. The GPU side is the hwmon sensors of the DRM cards
+ *  (/sys/class/drm/card<n>/device/hwmon/hwmon<m>): energy1_input where
+ *  the driver counts energy, otherwise power1_average or power1_input,
+ *  integrated over the time between samples. Counters wrap at their
+ *  max_energy_range_uj and are unwrapped here.
+ *
+ *  Newer kernels only let root read energy_uj; where nothing can be
+ *  read, or on other systems, Open() finds no counters and the reports
+ *  say energy was not measured. NVIDIA cards publish no hwmon sensor
+ *  and are not covered.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef ENERGYMETER_HPP
+#define ENERGYMETER_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class EnergyMeter{
+public:
+    // Constructor
+    EnergyMeter();
+    // Destructor
+    ~EnergyMeter();
+    EnergyMeter(const EnergyMeter&) = delete;
+    EnergyMeter& operator=(const EnergyMeter&) = delete;
+    // Finds and reads every counter, false if there is none
+    bool Open();
+    // Closes the counters
+    void Close();
+    inline bool IsOpen() const{
+        return !m_counters.empty();
+    }
+    // Joules used since Open() or the last Sample(), by the CPU packages
+    // and by the GPUs
+    void Sample(double& cpuJoules, double& gpuJoules);
+    // The counters found, one per line
+    std::string Describe() const;
+private:
+    enum CounterKind{
+        COUNTER_ENERGY,     // Microjoules, wrapping at range
+        COUNTER_POWER       // Microwatts, integrated between samples
+    };
+    struct Counter{
+        std::string path;
+        int file{-1};
+        CounterKind kind{COUNTER_ENERGY};
+        bool gpu{false};
+        uint64_t range{0};
+        uint64_t last{0};
+    };
+
+    // Adds the counter at path, false if it cannot be read
+    bool AddCounter(const std::string& path, CounterKind kind, bool gpu, uint64_t range);
+    // The counter's value now, false if the read failed
+    static bool Read(const Counter& counter, uint64_t& value);
+
+    std::vector<Counter> m_counters;
+    std::chrono::steady_clock::time_point m_lastSample;
+};
+
+#endif
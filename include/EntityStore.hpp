@@ -0,0 +1,195 @@
+/** @file EntityStore.hpp
+ *  @brief Scene entities stored by archetype, one array per component.
+ *
+ *  An archetype is a fixed set of components. Every archetype keeps its
+ *  entities in rows, and each component in its own contiguous array
+ *  indexed by row, so a system walks exactly the arrays it needs and
+ *  nothing else. A new kind of entity is a new archetype and some rows,
+ *  not another branch in a per-object loop.
+ *
+ *  Rows are reserved up front when an archetype is created, and drawing
+ *  takes its scratch from the frame arena, so adding, removing and
+ *  drawing entities never allocates once the scene is set up. Removing
+ *  a row moves the last row into its place.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef ENTITYSTORE_HPP
+#define ENTITYSTORE_HPP
+
+#include "AABB.hpp"
+#include "DrawBatch.hpp"
+#include "FrameArena.hpp"
+#include "Frustum.hpp"
+#include "MeshSimplifier.hpp"
+#include "VertexFormat.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Components an archetype can be made of, combined as bit flags
+enum Component : uint32_t{
+    COMPONENT_TRANSFORM  = 1 << 0,
+    COMPONENT_RENDERABLE = 1 << 1,
+    COMPONENT_COLLIDER   = 1 << 2,
+    COMPONENT_SCROLL     = 1 << 3,
+    COMPONENT_LOD        = 1 << 4,
+    COMPONENT_NODE       = 1 << 5
+};
+
+// Offset and uniform scale of the mesh, in world units. Aligned, so
+// batches of transforms load as vec4s.
+struct alignas(16) Transform{
+    float x = 0.0f;
+    float y = 0.0f;
+    float z = 0.0f;
+    float scale = 1.0f;
+};
+
+// What an entity draws: a range of the scene arena and its material
+struct Renderable{
+    DrawRange range;
+    // Model space bounds of the range, for culling
+    BoundingSphere sphere;
+    // Palette column and texture U offset added to the uniforms
+    float palette = 0.0f;
+    float uOffset = 0.0f;
+    // Texture array layers by day and by night, crossfaded by the shader;
+    // negative ones are palette rows, see PaletteTexture.hpp
+    float layer = 0.0f;
+    float nightLayer = 0.0f;
+    // Vertex shader animation, see InstanceData
+    float jumpStart = 0.0f;
+    float jumpSpeed = 0.0f;
+    float bobHeight = 0.0f;
+    float squash = 0.0f;
+    bool visible = true;
+};
+
+// What AppendDraws() puts in the sort keys of its draws, see
+// RenderQueue.hpp. The material is the run's day texture layer, the mesh
+// its base vertex and the depth how far its first entity is from eye.
+struct DrawSortKeys{
+    uint32_t pass = 0;
+    uint32_t program = 0;
+    glm::vec3 eye = glm::vec3(0.0f);
+    // Blended draws go far to near
+    bool backToFront = false;
+};
+
+// Model space bounds, the source of the entity's hit box
+struct Collider{
+    AABB bounds;
+};
+
+// Texture scrolling: uOffset moves by -uPerTick every tick and wraps
+// every periodTicks ticks
+struct TextureScroll{
+    float uPerTick = 0.0f;
+    int periodTicks = 1;
+};
+
+// Levels of detail of what an entity draws, the full mesh first. The LOD
+// system picks one level per entity and puts its range in the Renderable.
+struct LodRanges{
+    DrawRange ranges[MAX_MESH_LODS];
+    // Furthest each level strays from the full mesh, in model units
+    float errors[MAX_MESH_LODS] = {};
+    uint32_t count = 0;
+    // Level picked for this frame
+    uint32_t selected = 0;
+};
+
+typedef uint32_t ArchetypeId;
+
+class TransformHierarchy;
+
+class EntityStore{
+public:
+    // Constructor
+    EntityStore();
+    // Destructor
+    ~EntityStore();
+    // Adds an archetype made of components with room for capacity rows
+    ArchetypeId CreateArchetype(uint32_t components, size_t capacity);
+    // Adds a row with default components and returns it, or returns
+    // GetCapacity() if the archetype is full
+    size_t Add(ArchetypeId archetype);
+    // Removes a row; the last row takes its place
+    void Remove(ArchetypeId archetype, size_t row);
+    // Sets the number of rows, new rows get default components.
+    // Never grows past the capacity.
+    void Resize(ArchetypeId archetype, size_t count);
+
+    inline size_t GetCount(ArchetypeId archetype) const{
+        return m_archetypes[archetype].count;
+    }
+    inline size_t GetCapacity(ArchetypeId archetype) const{
+        return m_archetypes[archetype].capacity;
+    }
+    inline bool Has(ArchetypeId archetype, uint32_t components) const{
+        return (m_archetypes[archetype].components & components) == components;
+    }
+    // Component arrays, GetCount() entries each. Only valid for archetypes
+    // that have the component.
+    inline Transform* GetTransforms(ArchetypeId archetype){
+        return m_archetypes[archetype].transforms.data();
+    }
+    inline Renderable* GetRenderables(ArchetypeId archetype){
+        return m_archetypes[archetype].renderables.data();
+    }
+    inline Collider* GetColliders(ArchetypeId archetype){
+        return m_archetypes[archetype].colliders.data();
+    }
+    inline TextureScroll* GetScrolls(ArchetypeId archetype){
+        return m_archetypes[archetype].scrolls.data();
+    }
+    inline LodRanges* GetLods(ArchetypeId archetype){
+        return m_archetypes[archetype].lods.data();
+    }
+    // The TransformHierarchy node placing each row, NO_TRANSFORM_NODE for
+    // rows placed by hand
+    inline uint32_t* GetNodes(ArchetypeId archetype){
+        return m_archetypes[archetype].nodes.data();
+    }
+
+    // Scroll system: sets the texture offset of every scrolling entity
+    // for a fraction of a step past tick
+    void UpdateTextureScroll(int tick, float fraction);
+    // Hierarchy system: copies the world transform of every node the last
+    // TransformHierarchy::Update() changed into the rows it places. Does
+    // nothing when that update changed nothing.
+    void ApplyHierarchy(ArchetypeId archetype, const TransformHierarchy& hierarchy);
+    // LOD system: gives every entity of an archetype the coarsest level
+    // whose error, projected from the entity's placed sphere, stays within
+    // maxPixelError pixels. pixelsPerUnit is the size in pixels of one
+    // world unit at distance 1 from the eye; 0 always picks level 0.
+    void SelectLods(ArchetypeId archetype, const glm::vec3& eye, float pixelsPerUnit, float maxPixelError);
+    // Render system: queues the visible entities of one archetype, one
+    // draw per run of consecutive rows that share a range. Entities with
+    // levels of detail are queued level by level, so rows that picked the
+    // same level share a draw wherever they are in the archetype. With a
+    // frustum, entities whose placed sphere lies outside it are skipped
+    // before any instance data is written; large archetypes are culled
+    // on the job threads. The culling results and the instances are
+    // scratch allocated from arena. With keys, every draw gets a sort key
+    // the batch orders its draws by; without, they keep their order.
+    void AppendDraws(ArchetypeId archetype, DrawBatch& batch, FrameArena& arena, const Frustum* frustum = nullptr,
+                     const DrawSortKeys* keys = nullptr);
+private:
+    struct Archetype{
+        uint32_t components = 0;
+        size_t count = 0;
+        size_t capacity = 0;
+        std::vector<Transform> transforms;
+        std::vector<Renderable> renderables;
+        std::vector<Collider> colliders;
+        std::vector<TextureScroll> scrolls;
+        std::vector<LodRanges> lods;
+        std::vector<uint32_t> nodes;
+    };
+    std::vector<Archetype> m_archetypes;
+};
+
+#endif
@@ -0,0 +1,122 @@
+/** @file EnvironmentPool.hpp
+ *  @brief Many games stepped in parallel on every core.
+ *
+ *  The environments are split into shards of shardSize, each a
+ *  GameStateBatch that one thread steps with the SIMD kernel. StepAll()
+ *  runs one ThreadPool task per shard and returns when every shard has
+ *  advanced, so the caller sees all environments one tick later.
+ *  Environment i is lane i % shardSize of shard i / shardSize, and the
+ *  actions array is laid out the same way.
+ *
+ *  Every shard is allocated by the thread that steps it, with its
+ *  columns first touched there, so with pinned threads (see
+ *  ThreadAffinity.hpp) its pages sit on that thread's NUMA node. Shards
+ *  go to threads in contiguous runs, the way ThreadPool::Run() hands
+ *  out tasks, and a thread steals another's shard only once its own are
+ *  done. Resize() and LoadCheckpoint() place the shards afresh.
+ *
+ *  Every task counts the steps it took and the games that ended into
+ *  its thread's Telemetry block, so statistics over all environments
+ *  cost no shared writes. Steps of a shard stepped on another node than
+ *  its own, after a steal or with unpinned threads, are counted as
+ *  remote.
+ *
+ *  A checkpoint is every shard's GameStateBatch::Save() after a header:
+ *    "DENV", uint32 version, uint64 count, uint64 shardSize, uint64 tag.
+ *  It is written to a temporary file that is then renamed over the old
+ *  one, so a process stopped while saving leaves the last checkpoint
+ *  whole.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef ENVIRONMENTPOOL_HPP
+#define ENVIRONMENTPOOL_HPP
+
+#include "GameStateBatch.hpp"
+#include "ThreadPool.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+class EnvironmentPool{
+public:
+    // Constructor, threadCount 0 uses every hardware thread; affinity
+    // pins them, see ThreadAffinity.hpp
+    explicit EnvironmentPool(unsigned int threadCount = 0, const AffinityConfig& affinity = AffinityConfig());
+    // Destructor
+    ~EnvironmentPool();
+    // Changes the number of environments. Small shards balance better,
+    // large ones have less overhead; keep them a multiple of 8.
+    void Resize(size_t count, size_t shardSize = 1024);
+    inline size_t GetCount() const{
+        return m_count;
+    }
+    // Resets every environment with seed, environment i uses stream i
+    void ResetAll(uint64_t seed);
+    // Resets one environment (see GameStateBatch::Reset())
+    void Reset(size_t index, uint64_t seed, uint64_t stream);
+    // Plays script in every environment from its next reset on, see
+    // GameStateBatch::SetSpawnScript()
+    void SetSpawnScript(uint16_t script);
+    // Copies an environment in or out
+    GameState Get(size_t index) const;
+    void Set(size_t index, const GameState& state);
+    // Advances every environment by ticks ticks and waits for all of
+    // them. actions has GetCount() entries.
+    void StepAll(const GameAction* actions, int ticks = 1);
+    // Repeats actions for repeat steps of ticks ticks in one task per
+    // shard (see GameStateBatch::StepRepeated()), so the workers are
+    // started and waited for once
+    void StepAllRepeated(const GameAction* actions, int repeat, int ticks = 1);
+
+    // Saves every environment, and tag for the caller (dinoserve keeps
+    // its next obstacle stream there)
+    bool SaveCheckpoint(const std::string& filepath, uint64_t tag) const;
+    // Replaces every environment, count and shard size included, with a
+    // checkpoint's and returns its tag through tag
+    bool LoadCheckpoint(const std::string& filepath, uint64_t& tag);
+
+    inline size_t GetShardCount() const{
+        return m_shards.size();
+    }
+    inline size_t GetShardSize() const{
+        return m_shardSize;
+    }
+    // Observations and events are read per shard
+    inline const GameStateBatch& GetShard(size_t shard) const{
+        return m_shards[shard];
+    }
+    inline unsigned int GetThreadCount() const{
+        return m_pool.GetThreadCount();
+    }
+    // The workers, free for other work between steps
+    inline ThreadPool& GetThreadPool(){
+        return m_pool;
+    }
+    // Calls task(shard) for every shard on the thread that owns it, so
+    // what it first touches for the shard lands on the shard's node
+    void ForEachShard(const std::function<void(size_t)>& task);
+    // NUMA node a shard was allocated on, -1 if unknown
+    inline int GetShardNode(size_t shard) const{
+        return m_shardNodes[shard];
+    }
+private:
+    // Counts a shard's finished games after a step
+    void RecordEpisodes(size_t shard);
+    // Counts steps taken away from a shard's node as remote
+    void RecordNode(size_t shard, size_t steps);
+    // Copies every shard, resized to its share of m_count, on the thread
+    // that owns it
+    void PlaceShards();
+
+    ThreadPool m_pool;
+    std::vector<GameStateBatch> m_shards;
+    std::vector<int> m_shardNodes;
+    size_t m_shardSize{1024};
+    size_t m_count{0};
+};
+
+#endif
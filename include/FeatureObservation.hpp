@@ -0,0 +1,46 @@
+/** @file FeatureObservation.hpp
+ *  @brief A game state as a short vector of floats, for agents that do
+ *  not look at pixels.
+ *
+ *  One row per environment: the dino's height, vertical velocity and
+ *  jump phase, the scroll speed of the obstacles, the time of day and
+ *  the distances to the next few obstacles the dino has to clear, in
+ *  that order (see FeatureField). Everything is scaled to around 0..1,
+ *  so rows can be fed to a network as they are: lengths along the lane
+ *  in units of OBSTACLE_SPAWN_X (the lane ahead of the dino), heights
+ *  in units of JUMP_APEX, speeds in those units per second of play.
+ *  Written straight from the state, no rendering involved.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef FEATUREOBSERVATION_HPP
+#define FEATUREOBSERVATION_HPP
+
+#include "GameState.hpp"
+
+#include <cstddef>
+
+// Columns of one feature row, the obstacle distances last
+enum FeatureField{
+    FEATURE_DINO_HEIGHT,        // 0 on the ground, 1 at the apex
+    FEATURE_DINO_VELOCITY,      // Positive while rising, 0 on the ground
+    FEATURE_JUMP_PHASE,         // 0 on the ground, 0.5 at the apex, 1 on landing
+    FEATURE_OBSTACLE_SPEED,
+    FEATURE_TIME_OF_DAY,        // Through a day and a night, 0 up to 1
+    FEATURE_OBSTACLES           // Distance to the next obstacle, then the one after
+};
+
+// Most obstacles a row can hold, every one a lane can have
+const size_t MAX_FEATURE_OBSTACLES = OBSTACLE_LANE_CAPACITY;
+// Distance of an obstacle that is not there, further than any spawns
+const float FEATURE_NO_OBSTACLE = 2.0f;
+
+// Floats in a row with obstacleCount obstacle distances
+inline size_t GetFeatureSize(size_t obstacleCount){
+    return FEATURE_OBSTACLES + obstacleCount;
+}
+
+// Writes the GetFeatureSize(obstacleCount) floats of state into row
+void WriteFeatureObservation(const GameState& state, size_t obstacleCount, float* row);
+
+#endif
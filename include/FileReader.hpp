@@ -0,0 +1,194 @@
+/** @file FileReader.hpp
+ *  @brief Reads batches of whole files into memory ahead of their parse.
+ *
+ *  A parse job that maps its file with FileView blocks its worker on
+ *  every page fault of a cold file, one file and one blocked thread at
+ *  a time. Read() instead takes every file a job is going to open and
+ *  reads them all into memory first; the job runs once the last one is
+ *  in, and its FileViews open them from there through FileView's read
+ *  lookup, without touching the disk. Release() lets go of them once
+ *  the parse is done; a view still open keeps its file's memory.
+ *
+ *  On Linux the reads go through io_uring: one thread owns the ring
+ *  and submits every read queued since it last woke with a single
+ *  io_uring_enter(), a batch of dozens of files costing one syscall and
+ *  no blocked worker. Files that fit into a slot of a buffer registered
+ *  with the ring are read there with IORING_OP_READ_FIXED, the others
+ *  into memory of their own. With direct set the files are opened with
+ *  O_DIRECT and skip the page cache, where the filesystem allows it.
+ *  Elsewhere, on kernels older than 5.7 or when the ring cannot be set
+ *  up, every file is read by a job of the JobSystem instead.
+ *
+ *  Files in the open asset pack are mapped already and are not read;
+ *  the ones it stores compressed are decompressed instead, each by a
+ *  job that decodes its blocks in parallel, into memory served the same
+ *  way. A file that cannot be read is simply left out; FileView then
+ *  maps it from disk, or decompresses it from the pack, as it always
+ *  did.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef FILEREADER_HPP
+#define FILEREADER_HPP
+
+#include "JobSystem.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+struct FileReaderConfig{
+    // Reads through io_uring where the kernel has it
+    bool ioUring{true};
+    // Opens the files with O_DIRECT
+    bool direct{false};
+    // Reads in flight at once
+    unsigned int queueDepth{64};
+    // The buffer registered with the ring, in slots of slotBytes
+    size_t slotBytes{1u << 20};
+    size_t slotCount{8};
+};
+
+class FileReader{
+public:
+    // The reader FileView reads through
+    static FileReader& Get();
+    // Sets up the ring, or the job reads, and routes FileView through
+    // the files read. Returns false if io_uring is not used.
+    bool Start(const FileReaderConfig& config = FileReaderConfig());
+    // Finishes the reads in flight and frees every file; call once no
+    // FileView of them is open, the registered buffer goes with it
+    void Stop();
+    inline bool IsStarted() const{
+        return m_started;
+    }
+    inline bool UsesIoUring() const{
+        return m_ring != -1;
+    }
+    // Reads the files of paths and submits done as a job once every one
+    // of them is in memory or failed; counter counts done from now on.
+    // Before Start() done is submitted right away.
+    void Read(const std::vector<std::string>& paths, Job done, JobCounter* counter = nullptr);
+    // Frees the files of a Read() once nothing views them anymore
+    void Release(const std::vector<std::string>& paths);
+    // Files read and their bytes, and the io_uring_enter() calls that
+    // submitted them
+    inline uint64_t GetFileCount() const{
+        return m_fileCount.load(std::memory_order_relaxed);
+    }
+    inline uint64_t GetByteCount() const{
+        return m_byteCount.load(std::memory_order_relaxed);
+    }
+    inline uint64_t GetSubmitCount() const{
+        return m_submitCount.load(std::memory_order_relaxed);
+    }
+private:
+    struct File{
+        std::string path;
+        // Shared with the FileViews of the file
+        std::shared_ptr<char> memory;
+        char* data{nullptr};
+        size_t size{0};
+        // Bytes allocated, size rounded up for O_DIRECT
+        size_t capacity{0};
+        // Slot of the registered buffer, -1 for memory of its own
+        int slot{-1};
+        int descriptor{-1};
+        // Stored compressed in the asset pack, decompressed from there
+        bool packed{false};
+        size_t bytesRead{0};
+        bool ready{false};
+        bool failed{false};
+        // Read() calls holding it
+        int references{0};
+        // The batches that wait for it
+        std::vector<JobCounter*> waiters;
+    };
+    // The reads of one Read(), done runs once reads drops to zero
+    struct Batch{
+        JobCounter reads;
+        Job done;
+    };
+
+    // Constructor
+    FileReader();
+    // Destructor
+    ~FileReader();
+    FileReader(const FileReader&) = delete;
+    FileReader& operator=(const FileReader&) = delete;
+
+    // Opens a file found by Read() and allocates its memory; false if it
+    // cannot be read. Called with m_mutex held.
+    bool OpenFile(File& file);
+    // The disk half of OpenFile(): opens and sizes the file
+    bool OpenOnDisk(File& file);
+    // Lets go of a file's memory and closes it. Called with m_mutex held.
+    void FreeFile(File& file);
+    // Marks a file read or failed and releases its waiters
+    void Complete(File* file, bool ok);
+    // The read of one file by a job, without io_uring
+    void ReadInJob(File* file);
+    // Creates the ring and maps its queues, false if the kernel has none
+    bool CreateRing(unsigned int entries);
+    void DestroyRing();
+    // The thread that owns the ring
+    void RingMain();
+    // Queues a read onto the submission queue, data being what its
+    // completion carries
+    void PrepareRead(int descriptor, void* buffer, unsigned int bytes, uint64_t offset, int slot, uint64_t data);
+    // FileViewLookup into the files read
+    static bool Lookup(const std::string& filepath, const char*& data, size_t& size,
+                       std::shared_ptr<const void>& owner);
+
+    FileReaderConfig m_config;
+    bool m_started{false};
+    std::mutex m_mutex;
+    std::unordered_map<std::string, std::unique_ptr<File>> m_files;
+    // Read() queues files here for the ring thread
+    std::deque<File*> m_queue;
+    bool m_stop{false};
+    // Set if io_uring_enter() failed, the ring takes no more reads
+    bool m_ringFailed{false};
+
+    // The ring's file descriptor and its mapped queues
+    int m_ring{-1};
+    int m_wake{-1};
+    uint64_t m_wakeValue{0};
+    void* m_submitMap{nullptr};
+    size_t m_submitMapBytes{0};
+    void* m_completeMap{nullptr};
+    size_t m_completeMapBytes{0};
+    void* m_entries{nullptr};
+    size_t m_entryBytes{0};
+    unsigned int m_entryCount{0};
+    unsigned int* m_submitHead{nullptr};
+    unsigned int* m_submitTail{nullptr};
+    unsigned int m_submitMask{0};
+    unsigned int* m_submitArray{nullptr};
+    unsigned int* m_completeHead{nullptr};
+    unsigned int* m_completeTail{nullptr};
+    unsigned int m_completeMask{0};
+    void* m_completions{nullptr};
+    // Entries filled since the last io_uring_enter()
+    unsigned int m_prepared{0};
+    std::thread m_thread;
+
+    // The registered buffer and which of its slots hold a file; a slot
+    // is free again once the last view of its file closes
+    char* m_slots{nullptr};
+    std::mutex m_slotMutex;
+    std::vector<bool> m_slotUsed;
+
+    std::atomic<uint64_t> m_fileCount{0};
+    std::atomic<uint64_t> m_byteCount{0};
+    std::atomic<uint64_t> m_submitCount{0};
+};
+
+#endif
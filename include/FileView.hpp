@@ -0,0 +1,80 @@
+/** @file FileView.hpp
+ *  @brief Read-only memory-mapped view of a file.
+ *
+ *  Maps a whole file into the address space (mmap on Linux/Mac,
+ *  MapViewOfFile on MINGW) so parsers can scan the bytes in place
+ *  without copying them into stream buffers or per-line strings.
+ *  The data is not null-terminated; always use Size().
+ *
+ *  A lookup can be installed (the asset pack does) that is asked for
+ *  every path. A path it knows opens as a view into memory the lookup
+ *  owns, without touching the filesystem; anything else is mapped from
+ *  disk as usual. A second lookup, asked before the first, serves the
+ *  files FileReader read into memory ahead of their parse. A lookup can
+ *  hand out memory of the view's own, a file read ahead or decompressed
+ *  from the pack; the view shares it, and it lives as long as the view.
+ *  Mapped files count as MEMORY_ASSETS (MemoryTags.hpp) while they are
+ *  open, views into a lookup do not.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef FILEVIEW_HPP
+#define FILEVIEW_HPP
+
+#include <memory>
+#include <string>
+#include <cstddef>
+
+// Finds a path in memory that owner keeps alive, or that outlives every
+// view of it if owner is left empty; false if unknown
+typedef bool (*FileViewLookup)(const std::string& filepath, const char*& data, size_t& size,
+                               std::shared_ptr<const void>& owner);
+
+class FileView{
+public:
+    // Constructor for an empty view
+    FileView();
+    // Constructor that maps a file right away, check IsOpen()
+    explicit FileView(const std::string& filepath);
+    // Destructor, unmaps the file
+    ~FileView();
+    // Views are movable but not copyable
+    FileView(FileView&& other) noexcept;
+    FileView& operator=(FileView&& other) noexcept;
+    FileView(const FileView&) = delete;
+    FileView& operator=(const FileView&) = delete;
+    // Maps a file, returns false if it could not be opened
+    bool Open(const std::string& filepath);
+    // Unmaps the current file
+    void Close();
+    // True if a file is mapped (an empty file is open with Size() 0)
+    inline bool IsOpen() const{
+        return m_isOpen;
+    }
+    // First byte of the file
+    inline const char* Data() const{
+        return m_data;
+    }
+    // Size of the file in bytes
+    inline size_t Size() const{
+        return m_size;
+    }
+    // Asks lookup for every path opened from now on, nullptr for none
+    static void SetLookup(FileViewLookup lookup);
+    // Asks lookup for every path before the first lookup
+    static void SetReadLookup(FileViewLookup lookup);
+private:
+    const char* m_data{nullptr};
+    size_t m_size{0};
+    bool m_isOpen{false};
+    // The data belongs to the lookup and is not unmapped
+    bool m_borrowed{false};
+    // Keeps the data of a lookup alive
+    std::shared_ptr<const void> m_owner;
+#if defined(MINGW) || defined(_WIN32)
+    void* m_fileHandle{nullptr};    // HANDLE from CreateFile
+    void* m_mappingHandle{nullptr}; // HANDLE from CreateFileMapping
+#endif
+};
+
+#endif
@@ -0,0 +1,89 @@
+/** @file FileWatcher.hpp
+ *  @brief Calls back when watched files change on disk, for hot reload.
+ *
+ *  The directories of the watched files are registered with the
+ *  operating system once: inotify on Linux, ReadDirectoryChangesW on
+ *  Windows (MINGW). Poll() is called once per frame and only drains
+ *  what the kernel queued, a single non-blocking read when nothing
+ *  changed, so an unchanged tree costs the frame nothing measurable.
+ *  Elsewhere (macOS) the modification times are compared instead, at
+ *  most every POLL_INTERVAL_MS.
+ *
+ *  Editors often save in several steps (truncate and write, or write a
+ *  temporary file and rename it over the original). A changed file is
+ *  therefore reported once, SETTLE_MS after its last event, and every
+ *  file is reported at most once per Poll().
+ *
+ *  @bug No known bugs.
+ */
+#ifndef FILEWATCHER_HPP
+#define FILEWATCHER_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Called on the thread that runs Poll()
+typedef std::function<void()> FileChanged;
+
+class FileWatcher{
+public:
+    // Constructor
+    FileWatcher();
+    // Destructor
+    ~FileWatcher();
+    // File watchers own operating system handles, so they are not copyable.
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+    // Starts watching; false if the operating system refuses
+    bool Start();
+    inline bool IsRunning() const{
+        return m_running;
+    }
+    // Calls onChange whenever filepath is written, replaced or created.
+    // The file need not exist yet, but its directory must.
+    void Watch(const std::string& filepath, FileChanged onChange);
+    // Calls back for the files that changed and settled since the last
+    // call; returns how many
+    size_t Poll();
+    // Stops watching and forgets every file
+    void Stop();
+private:
+    // Time a file must go without events before it is reported
+    static constexpr int SETTLE_MS = 100;
+    // Time between two scans of the modification times where the
+    // operating system cannot notify us
+    static constexpr int POLL_INTERVAL_MS = 500;
+
+    typedef std::chrono::steady_clock Clock;
+
+    struct Entry{
+        size_t directory;
+        std::string name;
+        FileChanged onChange;
+        bool pending{false};
+        Clock::time_point lastEvent;
+        // Only used when scanning modification times
+        long long modified{0};
+    };
+    // Index of a watched directory, registering it if it is new
+    size_t AddDirectory(const std::string& directory);
+    // Marks the entries of a directory named name as changed, all of
+    // them with an empty name
+    void MarkChanged(size_t directory, const std::string& name);
+    // Reads what the operating system reported since the last call
+    void ReadEvents();
+
+    bool m_running{false};
+    std::vector<std::string> m_directories;
+    std::vector<Entry> m_entries;
+    Clock::time_point m_lastScan;
+    // Platform handles, see FileWatcher.cpp
+    struct Platform;
+    std::unique_ptr<Platform> m_platform;
+};
+
+#endif
@@ -0,0 +1,79 @@
+/** @file FixedPoint.hpp
+ *  @brief Q16.16 fixed-point numbers for the simulation's inputs.
+ *
+ *  Step() only ever adds, compares and multiplies integers, so two
+ *  machines stepping the same game agree bit for bit, whatever their
+ *  instruction set, compiler or vector width. Floating point would not:
+ *  a compiler may fuse a multiply and an add into one FMA on AArch64 and
+ *  not on x86-64, or keep intermediates wider, and a rounding that lands
+ *  on the other side of an integer moves a hit box by a unit. Lockstep
+ *  versus races, replays and batched states would all drift apart.
+ *
+ *  Values that start out as floats (mesh bounds) are therefore turned
+ *  into Fixed once, with FixedFromFloat(), which is exact for any float
+ *  of that range up to its last rounding, and everything derived from
+ *  them after that is integer arithmetic. A Fixed is an int32_t counting
+ *  1/65536ths; products go through 64 bits and shifts round towards
+ *  negative infinity on every target.
+ *
+ *  Game units themselves stay whole ints: GameState positions and speeds
+ *  already move a whole unit or more per tick. Anything that ever needs
+ *  sub-unit motion should be a Fixed rather than a float.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef FIXEDPOINT_HPP
+#define FIXEDPOINT_HPP
+
+#include <cmath>
+#include <cstdint>
+
+typedef int32_t Fixed;
+
+const int FIXED_SHIFT = 16;
+const Fixed FIXED_ONE = (Fixed)1 << FIXED_SHIFT;
+// Largest magnitude FixedFromFloat() keeps; beyond it values saturate
+const float FIXED_LIMIT = 32767.0f;
+
+// Floor division by 2^shift, the same on every target
+inline int64_t FixedShiftDown(int64_t value, int shift){
+    return (value >= 0) ? (value >> shift) : -((-value + ((int64_t)1 << shift) - 1) >> shift);
+}
+
+// value rounded to the nearest 1/65536; scaling by a power of two is
+// exact, so only the one rounding to an integer happens
+inline Fixed FixedFromFloat(float value){
+    if(!(value > -FIXED_LIMIT)){
+        return -(Fixed)(FIXED_LIMIT * FIXED_ONE);
+    }
+    if(!(value < FIXED_LIMIT)){
+        return (Fixed)(FIXED_LIMIT * FIXED_ONE);
+    }
+    return (Fixed)std::lround(value * (float)FIXED_ONE);
+}
+
+inline Fixed FixedFromInt(int value){
+    return (Fixed)(value * FIXED_ONE);
+}
+
+// a * b, rounded down
+inline Fixed FixedMul(Fixed a, Fixed b){
+    return (Fixed)FixedShiftDown((int64_t)a * b, FIXED_SHIFT);
+}
+
+// a * scale for an integer scale, in 64 bits so it cannot overflow
+inline int64_t FixedScale(Fixed a, int scale){
+    return (int64_t)a * scale;
+}
+
+// Largest int not above, and smallest int not below, a fixed value held
+// in 64 bits
+inline int FixedFloor(int64_t value){
+    return (int)FixedShiftDown(value, FIXED_SHIFT);
+}
+
+inline int FixedCeil(int64_t value){
+    return (int)-FixedShiftDown(-value, FIXED_SHIFT);
+}
+
+#endif
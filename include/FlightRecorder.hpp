@@ -0,0 +1,148 @@
+/** @file FlightRecorder.hpp
+ *  @brief The last few seconds of profiling, kept all the time and
+ *  written out as a trace when a frame goes over budget,
+ *  --hitch-budget=<ms>.
+ *
+ *  A hitch on a kiosk in the field is rare and does not come back when
+ *  someone looks for it, so the data has to be there already when it
+ *  happens. The recorder holds the newest CPU profiler zones, GPU
+ *  profiler passes and, per frame, the frame time and heap allocations
+ *  in one ring of events allocated up front: a new event overwrites the
+ *  oldest, so recording is a store into a slot and nothing ever grows.
+ *  Times stay raw performance counter values (GPU timestamps for the
+ *  passes) until a dump converts them.
+ *
+ *  EndFrame() holds every frame against the budget. A frame over it is
+ *  dumped DUMP_DELAY_FRAMES later, once the GPU timings of that frame
+ *  have come back: the ring is copied in order, and a job writes the
+ *  copy as a Chrome trace (TraceRecorder), with the frame time and the
+ *  allocations as counter tracks and the hitch marked, so no file is
+ *  written on the frame loop. The first frames after startup are not
+ *  held to the budget, a dump is followed by a window's worth of time
+ *  without another one, and at most MAX_DUMPS are written per run.
+ *
+ *  All calls come from the thread that collects the profilers, the
+ *  main thread.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef FLIGHTRECORDER_HPP
+#define FLIGHTRECORDER_HPP
+
+#include "JobSystem.hpp"
+#include "MemoryTags.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class FlightRecorder{
+public:
+    // Events kept per second of recording, taking 60 frames a second of
+    // about as many events as a trace expects
+    static const size_t EVENTS_PER_SECOND = 60 * 64;
+    // Frames after startup not held to the budget, while things load
+    static const uint64_t WARMUP_FRAMES = 120;
+    // Frames between a hitch and its dump, for its GPU timings to arrive
+    static const uint64_t DUMP_DELAY_FRAMES = 4;
+    static const int MAX_DUMPS = 16;
+
+    // Constructor
+    FlightRecorder();
+    // Destructor
+    ~FlightRecorder();
+
+    // Keeps about seconds of events, and dumps the window to directory
+    // whenever a frame takes longer than budgetMilliseconds
+    void Initialize(double seconds, double budgetMilliseconds, const std::string& directory);
+    inline bool IsRecording() const{
+        return !m_events.empty();
+    }
+    // Names events, returns the id the Add functions take
+    int AddName(const std::string& name);
+    // Pairs a GPU timestamp (nanoseconds) with the CPU clock right now
+    void SyncGPUClock(int64_t gpuNanoseconds);
+    // A CPU zone run on thread, in performance counter values
+    void AddZone(int name, int thread, uint64_t start, uint64_t end);
+    // A GPU pass, in GPU timestamp nanoseconds
+    void AddGPUPass(int name, uint64_t start, uint64_t end);
+    // Ends a frame that ran from start to end, in performance counter
+    // values, making allocations heap allocations of bytes
+    void EndFrame(uint64_t start, uint64_t end, uint64_t allocations, uint64_t bytes);
+
+    // Frames over the budget, and traces written for them
+    inline uint64_t GetHitchCount() const{
+        return m_hitches;
+    }
+    inline int GetDumpCount() const{
+        return m_dumps;
+    }
+    // Waits for the dumps still being written
+    void Release();
+private:
+    enum EventType{
+        EVENT_ZONE,
+        EVENT_GPU_PASS,
+        EVENT_FRAME
+    };
+    struct Event{
+        EventType type;
+        int name;
+        int thread;
+        // A frame's allocations
+        uint32_t allocations;
+        uint64_t start;
+        uint64_t end;
+        // A frame's allocated bytes
+        uint64_t bytes;
+    };
+    // What a dump job writes
+    struct Dump{
+        std::string path;
+        std::vector<std::string> names;
+        std::vector<Event> events;
+        uint64_t hitchStart;
+        uint64_t hitchEnd;
+        int64_t gpuNanoseconds;
+        uint64_t gpuCounter;
+        bool gpuSynced;
+    };
+
+    inline void Push(const Event& event){
+        m_events[m_next] = event;
+        m_next = (m_next + 1 == m_events.size()) ? 0 : m_next + 1;
+        if(m_stored < m_events.size()){
+            ++m_stored;
+        }
+    }
+    // Copies the ring out and hands it to a job
+    void StartDump();
+    static void WriteDump(const Dump& dump);
+
+    TaggedVector<Event, MEMORY_TELEMETRY> m_events;
+    size_t m_next{0};
+    size_t m_stored{0};
+    std::vector<std::string> m_names;
+    std::string m_directory;
+    uint64_t m_budgetCounts{0};
+    // Performance counter ticks a window covers
+    uint64_t m_windowCounts{0};
+    int64_t m_gpuNanoseconds{0};
+    uint64_t m_gpuCounter{0};
+    bool m_gpuSynced{false};
+
+    uint64_t m_frame{0};
+    uint64_t m_hitches{0};
+    int m_dumps{0};
+    // The hitch waiting to be dumped at frame m_dumpFrame
+    bool m_dumpPending{false};
+    uint64_t m_dumpFrame{0};
+    uint64_t m_hitchStart{0};
+    uint64_t m_hitchEnd{0};
+    // No dump before this counter value
+    uint64_t m_quietUntil{0};
+    JobCounter m_writes;
+};
+
+#endif
@@ -0,0 +1,130 @@
+/** @file FrameBenchmark.hpp
+ *  @brief Deterministic end-to-end render benchmark, --benchmark=<n>.
+ *
+ *  A benchmark run plays the same game every time: a fixed seed, one
+ *  simulation step per frame with scripted jumps and collisions off,
+ *  and the camera flown along a fixed path keyed on the frame number.
+ *  Frames run uncapped. After a few warm-up frames, which are not
+ *  measured, every frame's total and CPU time (everything before the
+ *  swap) is kept, together with the GPU time of its render passes once
+ *  the timestamp queries deliver it. At the end Report() prints the
+ *  average, p50, p99 and max of each and the peak resident set size,
+ *  so builds and drivers can be compared on the same work. The startup
+ *  (load) time, the time to the first frame and the simulation steps
+ *  per second of the simulate phase are measured as well, and so is
+ *  the input latency of the scripted jumps, from the step that reads
+ *  the jump to the swap of that frame. Where the machine has readable
+ *  power counters (see EnergyMeter.hpp), the joules of the measured
+ *  frames are reported per frame and per thousand simulation steps.
+ *
+ *  The results can be written as a flat JSON object of named metrics
+ *  and compared with such a file from an earlier run. Three metrics
+ *  gate the comparison: frame_p99_ms, load_ms and sim_steps_per_second.
+ *  Compare() fails if any of them is worse than the baseline by more
+ *  than its tolerance, in percent; every other metric is only reported.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef FRAMEBENCHMARK_HPP
+#define FRAMEBENCHMARK_HPP
+
+#include "GameState.hpp"
+
+#include "glm/glm.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class FrameBenchmark{
+public:
+    // Constructor
+    FrameBenchmark();
+    // Destructor
+    ~FrameBenchmark();
+    // Starts a run of frames measured frames
+    void Begin(int frames);
+    inline bool IsRunning() const{
+        return m_frames > 0;
+    }
+    // True once every measured frame has run
+    inline bool IsFinished() const{
+        return m_frame >= WARMUP_FRAMES + m_frames;
+    }
+    // The scripted input of the next step: jump when an obstacle is close
+    uint8_t GetInput(const GameState& state) const;
+    // Where the camera is in the current frame
+    void GetCameraPose(glm::vec3& eye, glm::vec3& direction) const;
+    // Ends a frame, times in milliseconds
+    void AddFrame(double frameMilliseconds, double cpuMilliseconds);
+    // The GPU time of an earlier frame, as it becomes available
+    void AddGPUFrame(double milliseconds);
+    // Time from a scripted jump to the swap of the frame showing it
+    void AddInputLatency(double milliseconds);
+    // Joules the CPU packages and the GPUs used over the frame just added
+    void AddEnergy(double cpuJoules, double gpuJoules);
+    // Time from startup to the first frame, in milliseconds
+    inline void SetLoadTime(double milliseconds){
+        m_loadMilliseconds = milliseconds;
+    }
+    // Time from startup until the first frame was swapped, in milliseconds
+    inline void SetFirstFrameTime(double milliseconds){
+        m_firstFrameMilliseconds = milliseconds;
+    }
+    // Time spent in the simulate phase of a frame and the steps it ran
+    void AddSimulation(double milliseconds, int steps);
+    // Prints the statistics of the run
+    void Report() const;
+    // Writes the metrics as JSON
+    bool WriteResults(const std::string& filepath) const;
+    // Allowed regression of a gated metric in percent, or of all of them
+    // with an empty name; false if there is no such metric
+    bool SetTolerance(const std::string& metric, double percent);
+    // Prints every metric next to the baseline's and returns false if a
+    // gated metric regressed beyond its tolerance or the file is unreadable
+    bool Compare(const std::string& baselinePath) const;
+    // Most memory the process has had resident so far, 0 if unknown
+    static uint64_t GetPeakResidentBytes();
+private:
+    // Frames run before measuring: shader compiles, first uploads and the
+    // GPU queries filling up would otherwise end up in the max
+    static const int WARMUP_FRAMES = 60;
+
+    // Whether a metric is better lower, better higher or not gated
+    enum MetricKind{
+        LOWER_IS_BETTER,
+        HIGHER_IS_BETTER,
+        INFORMATION
+    };
+    struct Metric{
+        std::string name;
+        double value;
+        MetricKind kind;
+    };
+    // Every metric of the run so far
+    std::vector<Metric> GetMetrics() const;
+    // Tolerance of a gated metric in percent
+    double GetTolerance(const std::string& metric) const;
+
+    int m_frames{0};
+    int m_frame{0};
+    std::vector<double> m_frameTimes;
+    std::vector<double> m_cpuTimes;
+    std::vector<double> m_gpuTimes;
+    std::vector<double> m_inputLatencies;
+    double m_loadMilliseconds{0.0};
+    double m_firstFrameMilliseconds{0.0};
+    double m_simulationMilliseconds{0.0};
+    // Energy of the measured frames, and how many of them had any
+    double m_cpuJoules{0.0};
+    double m_gpuJoules{0.0};
+    int m_energyFrames{0};
+    int64_t m_simulationSteps{0};
+    // Allowed regressions in percent
+    double m_frameTolerance{5.0};
+    double m_loadTolerance{10.0};
+    double m_stepsTolerance{5.0};
+};
+
+#endif
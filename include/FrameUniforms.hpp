@@ -0,0 +1,102 @@
+/** @file FrameUniforms.hpp
+ *  @brief The values every scene program reads in a frame, in one
+ *  uniform buffer bound once.
+ *
+ *  The view, the projection, the inverse of their product, the eye, the
+ *  time of day, the sky's scroll and the pose of the skinned meshes are
+ *  the same for the scene, the sky and the particles. Instead of each program getting its own copy through
+ *  glUniform* after every Use(), Update() writes them once a frame as a
+ *  FrameUniformData into the next region of a RingBuffer and binds that
+ *  range to FRAME_UNIFORM_BINDING, where every program finds it.
+ *
+ *  Shaders declare the block by including shaders/frame_common.glsl,
+ *  whose std140 layout FrameUniformData mirrors; ShaderProgram connects
+ *  a program's FRAME_UNIFORM_BLOCK to the binding point after it links
+ *  or loads from the cache (GLSL 4.10 has no binding layout qualifier).
+ *  What changes between draws of one frame (the opacity and clock of the
+ *  ghost pass, the atlas tiles' cameras) stays a plain uniform.
+ *
+ *  With split screen a frame has one block per view, written together
+ *  into one region; BindView() moves the binding to a view's slice
+ *  before that view is drawn, so the programs never know there is more
+ *  than one camera.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef FRAMEUNIFORMS_HPP
+#define FRAMEUNIFORMS_HPP
+
+#include "RingBuffer.hpp"
+#include "Skeleton.hpp"
+#include "ViewportLayout.hpp"
+
+#include "glm/glm.hpp"
+
+#include <glad/glad.h>
+
+#include <cstddef>
+
+// Where the FrameData block is bound, for every program
+const GLuint FRAME_UNIFORM_BINDING = 0;
+// The block's name in shaders/frame_common.glsl
+const char* const FRAME_UNIFORM_BLOCK = "FrameData";
+
+// std140 layout of FrameData: three column-major mat4, a vec4, the
+// floats, then the joints
+struct FrameUniformData{
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::mat4 inverseViewProjection;
+    // The camera's position, w unused
+    glm::vec4 eye;
+    // 0 by day, 1 by night, in between while one fades into the other
+    float timeOfDay;
+    // Scroll of the sky in texture space, subtracted from U
+    float skyOffset;
+    float padding[2];
+    // Skinning transform of every joint of the skinned meshes, three rows
+    // of its affine matrix each, see Skeleton::Sample(). Joints nothing
+    // is bound to are never read.
+    glm::vec4 joints[MAX_SKIN_JOINTS * 3];
+};
+
+static_assert(sizeof(FrameUniformData) == 224 + MAX_SKIN_JOINTS * 48, "FrameUniformData must match the std140 FrameData block");
+static_assert(offsetof(FrameUniformData, timeOfDay) == 208, "FrameUniformData must match the std140 FrameData block");
+static_assert(offsetof(FrameUniformData, joints) == 224, "FrameUniformData must match the std140 FrameData block");
+
+class FrameUniforms{
+public:
+    // Constructor
+    FrameUniforms();
+    // Destructor
+    // Note: Call Release() while the GL context is alive.
+    ~FrameUniforms();
+    // Creates the ring of per-frame blocks. Must be called after the GL
+    // loader is initialized.
+    bool Initialize();
+    // Writes this frame's data and binds it to FRAME_UNIFORM_BINDING
+    inline void Update(const FrameUniformData& data){
+        Update(&data, 1);
+    }
+    // Writes this frame's data of count views (up to MAX_VIEWPORTS) and
+    // binds the first view's
+    void Update(const FrameUniformData* views, size_t count);
+    // Binds the block of one view of this frame instead
+    void BindView(size_t view);
+    // Fences the frame's block once the draws reading it are submitted
+    void Finish();
+    // Connects program's FrameData block, if it has one, to the binding
+    static void BindBlock(GLuint program);
+    // Deletes the ring buffer
+    void Release();
+private:
+    RingBuffer m_ring;
+    size_t m_alignment{256};
+    // Bytes between two views' blocks, and where this frame's first is
+    size_t m_stride{sizeof(FrameUniformData)};
+    size_t m_offset{0};
+    size_t m_viewCount{0};
+    bool m_open{false};
+};
+
+#endif
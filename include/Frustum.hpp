@@ -0,0 +1,46 @@
+/** @file Frustum.hpp
+ *  @brief View-frustum culling of bounding spheres.
+ *
+ *  The six planes are taken straight from a view-projection matrix
+ *  (Gribb and Hartmann) and normalized, so the signed distance of a
+ *  point to each plane is a dot product. A sphere is culled once it
+ *  lies entirely behind any plane. CullSpheres() tests four spheres
+ *  per instruction with SSE on x86-64 or NEON on AArch64, and one at
+ *  a time elsewhere.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef FRUSTUM_HPP
+#define FRUSTUM_HPP
+
+#include "AABB.hpp"
+
+#include "glm/glm.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+// Aligned, so batches of spheres load as vec4s
+struct alignas(16) BoundingSphere{
+    float center[3] = {0.0f, 0.0f, 0.0f};
+    float radius = 0.0f;
+};
+
+// The sphere around a box, through its corners
+BoundingSphere MakeBoundingSphere(const AABB& bounds);
+
+// Inside is where a*x + b*y + c*z + d >= 0 for every plane (a, b, c, d)
+struct Frustum{
+    float planes[6][4];
+};
+
+// Planes of whatever viewProjection maps into the clip volume,
+// in world space when it is projection * view
+Frustum ExtractFrustum(const glm::mat4& viewProjection);
+
+// Sets visible[i] to 1 for the spheres (x[i], y[i], z[i], radius[i]) that
+// touch the frustum and to 0 for the rest. Returns how many are visible.
+size_t CullSpheres(const Frustum& frustum, const float* x, const float* y, const float* z,
+                   const float* radius, size_t count, uint8_t* visible);
+
+#endif
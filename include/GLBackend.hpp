@@ -0,0 +1,58 @@
+/** @file GLBackend.hpp
+ *  @brief Creates and edits GL objects with or without binding them.
+ *
+ *  With direct state access (GL 4.5, or GL_ARB_direct_state_access on
+ *  older contexts) objects are created with glCreate* and edited by
+ *  name, so an edit never changes what is bound for drawing. Without
+ *  it the same calls bind to edit: buffers through GL_COPY_WRITE_BUFFER,
+ *  which nothing draws from and which is not vertex array state, so an
+ *  edit there cannot disturb the bound vertex array or its index buffer
+ *  either.
+ *
+ *  Code that sets up vertex arrays or textures checks
+ *  HasDirectStateAccess() itself, since the two paths differ in more
+ *  than the call (see VertexLayout and TextureArray).
+ *
+ *  @bug No known bugs.
+ */
+#ifndef GLBACKEND_HPP
+#define GLBACKEND_HPP
+
+#include <glad/glad.h>
+
+#include <cstddef>
+
+class GLBackend{
+public:
+    // The backend of the one GL context
+    static GLBackend& Get();
+    // Picks the backend of the current context; call once glad is loaded.
+    // allowDirectStateAccess false keeps the bind-to-edit path.
+    void Initialize(bool allowDirectStateAccess);
+    // True when objects are edited without binding them
+    inline bool HasDirectStateAccess() const{
+        return m_directStateAccess;
+    }
+
+    // A new buffer, vertex array or texture of target
+    GLuint CreateBuffer();
+    GLuint CreateVertexArray();
+    GLuint CreateTexture(GLenum target);
+
+    // glBufferData, glBufferSubData and glBufferStorage of buffer
+    void BufferData(GLuint buffer, size_t bytes, const void* data, GLenum usage);
+    void BufferSubData(GLuint buffer, size_t offset, size_t bytes, const void* data);
+    void BufferStorage(GLuint buffer, size_t bytes, const void* data, GLbitfield flags);
+    // glMapBufferRange and glUnmapBuffer of buffer
+    void* MapBufferRange(GLuint buffer, size_t offset, size_t bytes, GLbitfield access);
+    bool UnmapBuffer(GLuint buffer);
+private:
+    // Constructor
+    GLBackend();
+    GLBackend(const GLBackend&) = delete;
+    GLBackend& operator=(const GLBackend&) = delete;
+
+    bool m_directStateAccess{false};
+};
+
+#endif
@@ -0,0 +1,54 @@
+/** @file GLDebugOutput.hpp
+ *  @brief Driver error reporting through KHR_debug instead of glGetError.
+ *
+ *  Polling glGetError around calls makes the driver finish its queued
+ *  work to answer, so the game did not check errors at all outside a
+ *  few startup calls. With a debug context (--gl-debug) the driver
+ *  reports errors itself through a callback instead: asynchronously by
+ *  default, so nothing in the frame loop waits on it, or synchronously
+ *  on the offending call with --gl-debug=sync, for breakpoints.
+ *
+ *  Only errors, undefined behavior and high and medium severity
+ *  messages are enabled; notifications and low severity chatter are
+ *  filtered out in the driver. A message that keeps coming back is
+ *  printed MAX_REPEATS times and then muted.
+ *
+ *  Without --gl-debug the context is a normal one and debug output
+ *  stays off, as in release builds.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef GLDEBUGOUTPUT_HPP
+#define GLDEBUGOUTPUT_HPP
+
+#include <glad/glad.h>
+
+#include <cstddef>
+
+class GLDebugOutput{
+public:
+    // The one reporter of the GL context
+    static GLDebugOutput& Get();
+    // Installs the callback and its filters. Needs a current context made
+    // with SDL_GL_CONTEXT_DEBUG_FLAG; false if it has no debug output.
+    bool Enable(bool synchronous);
+    inline bool IsEnabled() const{
+        return m_enabled;
+    }
+    // Messages the driver has reported, muted repeats included
+    size_t GetMessageCount() const;
+private:
+    // Times one message is printed before it is muted
+    static const int MAX_REPEATS = 5;
+
+    // Constructor
+    GLDebugOutput();
+    // Destructor
+    ~GLDebugOutput();
+    static void APIENTRY Callback(GLenum source, GLenum type, GLuint id, GLenum severity,
+                                  GLsizei length, const GLchar* message, const void* userParam);
+
+    bool m_enabled{false};
+};
+
+#endif
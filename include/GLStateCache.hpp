@@ -0,0 +1,111 @@
+/** @file GLStateCache.hpp
+ *  @brief Shadow copy of the GL state the renderer changes.
+ *
+ *  Rendering code binds programs, vertex arrays and textures and
+ *  toggles capabilities through this cache instead of calling GL
+ *  directly. Each call is compared with the last value that was set
+ *  and only reaches the driver when something actually changes, which
+ *  keeps driver validation out of the frame loop. Everything starts
+ *  out unknown, so the first call always goes through.
+ *
+ *  Code that changes tracked state behind the cache's back (or deletes
+ *  a bound object) must call Invalidate().
+ *
+ *  Every thread has a cache of its own, since the state belongs to the
+ *  context current on it (render workers each have one, RenderWorkers).
+ *
+ *  @bug No known bugs.
+ */
+#ifndef GLSTATECACHE_HPP
+#define GLSTATECACHE_HPP
+
+#include <glad/glad.h>
+
+#include <vector>
+
+class GLStateCache{
+public:
+    // The cache of the context current on the calling thread
+    static GLStateCache& Get();
+
+    // glUseProgram
+    void UseProgram(GLuint program);
+    // glBindVertexArray
+    void BindVertexArray(GLuint vao);
+    // glActiveTexture + glBindTexture
+    void BindTexture(unsigned int unit, GLenum target, GLuint texture);
+    // glActiveTexture; BindTexture() leaves another unit active when the
+    // binding was already there, so call this before editing it
+    void ActiveTexture(unsigned int unit);
+    // glEnable / glDisable
+    void SetEnabled(GLenum capability, bool enabled);
+    inline void Enable(GLenum capability){
+        SetEnabled(capability, true);
+    }
+    inline void Disable(GLenum capability){
+        SetEnabled(capability, false);
+    }
+    // glPolygonMode(GL_FRONT_AND_BACK, mode)
+    void PolygonMode(GLenum mode);
+    // glViewport
+    void Viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+    // glScissor; the test itself is Enable(GL_SCISSOR_TEST)
+    void Scissor(GLint x, GLint y, GLsizei width, GLsizei height);
+    // glClearColor
+    void ClearColor(GLfloat r, GLfloat g, GLfloat b, GLfloat a);
+    // Forgets everything, the next call of each kind goes to GL
+    void Invalidate();
+
+    // Number of calls that reached GL, and that were skipped
+    inline unsigned long GetIssuedCount() const{
+        return m_issued;
+    }
+    inline unsigned long GetSkippedCount() const{
+        return m_skipped;
+    }
+private:
+    // Constructor
+    GLStateCache();
+    GLStateCache(const GLStateCache&) = delete;
+    GLStateCache& operator=(const GLStateCache&) = delete;
+
+    // Counts a call, returns true if it has to be issued
+    inline bool Changed(bool changed){
+        if(changed){ ++m_issued; }else{ ++m_skipped; }
+        return changed;
+    }
+
+    struct TextureBinding{
+        bool known;
+        GLenum target;
+        GLuint texture;
+    };
+    struct Capability{
+        GLenum capability;
+        bool enabled;
+    };
+
+    // Each value below is only meaningful while its 'known' flag is set
+    bool m_programKnown{false};
+    GLuint m_program{0};
+    bool m_vaoKnown{false};
+    GLuint m_vao{0};
+    bool m_activeUnitKnown{false};
+    unsigned int m_activeUnit{0};
+    std::vector<TextureBinding> m_textures;
+    // Capabilities not in the list are unknown
+    std::vector<Capability> m_capabilities;
+    bool m_polygonModeKnown{false};
+    GLenum m_polygonMode{0};
+    bool m_viewportKnown{false};
+    GLint m_viewport[4]{0, 0, 0, 0};
+    bool m_scissorKnown{false};
+    GLint m_scissor[4]{0, 0, 0, 0};
+    bool m_clearColorKnown{false};
+    GLfloat m_clearColor[4]{0.0f, 0.0f, 0.0f, 0.0f};
+
+    unsigned long m_issued{0};
+    unsigned long m_skipped{0};
+};
+
+#endif
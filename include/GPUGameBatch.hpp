@@ -0,0 +1,150 @@
+/** @file GPUGameBatch.hpp
+ *  @brief Many games stored and stepped on the GPU.
+ *
+ *  The GPU side of GameStateBatch, for sweeps too large to step on the
+ *  CPU. Every environment is one vertex of a buffer of GPUGameState
+ *  records. A step is one glDrawArrays() of points with rasterization
+ *  off: the vertex shader (shaders/batch_step.glsl) reads an environment,
+ *  its action and its GameParameters, plays StepRepeated() on it, and
+ *  transform feedback writes it into the other buffer of a ping-pong
+ *  pair, as ParticleSystem does with particles. The context has no
+ *  compute shaders. Per step the CPU only sets a few uniforms and uploads
+ *  the actions, 4 bytes per environment; nothing is read back unless
+ *  asked for.
+ *
+ *  The shader is a line by line port of Step() in GameState.cpp. It uses
+ *  integers only, with the 64-bit GameRandom and the 64-bit products of
+ *  the swept collision test and silhouette rows done in 32-bit halves. A game stepped here
+ *  therefore matches the CPU bit for bit, which ./prog --gpu-sim-check
+ *  verifies. Obstacles are kept by their x alone, since the spawner only
+ *  places them at y 0; Load() drops any y.
+ *
+ *  With SetAutoReset() a game starts over on the GPU in the step it
+ *  ends, its events and reward still reporting the end. Episode k of
+ *  environment i plays stream i + k * GetCount(). That is reproducible,
+ *  but it is not the order in which dinoserve hands out streams.
+ *
+ *  GetStateBuffer() is the buffer the last step wrote, for a renderer
+ *  to read its instances from without a round trip through the CPU.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef GPUGAMEBATCH_HPP
+#define GPUGAMEBATCH_HPP
+
+#include "GameStateBatch.hpp"
+#include "ShaderProgram.hpp"
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// GPUGameState::flags
+enum GPUGameFlag : GLint{
+    GPU_GAME_DAYTIME    = 1 << 0,
+    GPU_GAME_JUMPING    = 1 << 1,
+    GPU_GAME_JUMPING_UP = 1 << 2,
+    GPU_GAME_OVER       = 1 << 3,
+    GPU_GAME_INVINCIBLE = 1 << 4
+};
+
+// One environment as the state buffers hold it, six ivec4 attributes
+struct GPUGameState{
+    GLint tick;
+    GLint dayTick;
+    GLint dinoHeight;
+    GLint flags;
+    GLint jumpingSpeed;
+    GLint scroll;
+    GLint spawnDistance;
+    GLint cactusSpeed;
+    // By ring slot, as ObstacleLane::x
+    GLint obstacleX[OBSTACLE_LANE_CAPACITY];
+    // GameRandom state and increment, low halves first
+    GLuint rng[4];
+    // head | count << 8 of the ObstacleLane
+    GLint lane;
+    // GameEvent flags and summed reward of the last step
+    GLint events;
+    GLfloat reward;
+    // Games finished and reset on the GPU
+    GLint episodes;
+};
+
+static_assert(OBSTACLE_LANE_CAPACITY == 8, "batch_step.glsl reads the lane as two ivec4");
+static_assert(sizeof(GPUGameState) == 6 * 16, "GPUGameState must match the attributes of batch_step.glsl");
+
+class GPUGameBatch{
+public:
+    // Constructor
+    GPUGameBatch();
+    // Destructor
+    // Note: Call Release() while the GL context is alive.
+    ~GPUGameBatch();
+    // Builds the step shader. Must be called after the GL loader is
+    // initialized and before anything else.
+    bool Initialize(const std::string& stepPath);
+    // Replaces every environment, parameters included, with those of batch
+    void Load(const GameStateBatch& batch);
+    // Copies every environment and its parameters back into batch,
+    // resized to GetCount(); waits for the steps queued so far
+    void Store(GameStateBatch& batch) const;
+    inline size_t GetCount() const{
+        return m_count;
+    }
+    // Actions of the following steps, GetCount() entries; all
+    // ACTION_NONE after Load()
+    void SetActions(const GameAction* actions);
+    // Whether games that end start over with seed in the same step
+    void SetAutoReset(bool enabled, uint64_t seed = 1);
+    // Queues StepRepeated() of every environment with the actions set
+    void StepRepeated(int repeat, int ticks = 1);
+    // GameEvent flags and summed rewards of the last step, GetCount()
+    // entries each; waits for it
+    void ReadResults(int* events, float* rewards) const;
+    // The buffer of GPUGameState records the last step wrote
+    inline GLuint GetStateBuffer() const{
+        return m_states[m_current];
+    }
+    // Deletes the GL objects
+    void Release();
+private:
+    GPUGameBatch(const GPUGameBatch&) = delete;
+    GPUGameBatch& operator=(const GPUGameBatch&) = delete;
+
+    // Points the attributes of vertex array i at its buffers
+    void SetupVertexArray(int i);
+
+    struct StepLocations{
+        GLint ticks{-1};
+        GLint repeat{-1};
+        GLint autoReset{-1};
+        GLint seed{-1};
+        GLint count{-1};
+        GLint hitRange{-1};
+        GLint silhouettes{-1};
+        GLint dinoBox{-1};
+        GLint obstacleBox{-1};
+        GLint dinoRows{-1};
+        GLint obstacleRows{-1};
+        GLint archetypeCount{-1};
+        GLint archetypes{-1};
+    };
+
+    ShaderProgram m_stepProgram;
+    StepLocations m_step;
+    // Ping-pong pair; m_current holds the environments of the last step
+    GLuint m_states[2] = {0, 0};
+    GLuint m_stepVao[2] = {0, 0};
+    int m_current{0};
+    // Two ivec4 of GameParameters per environment, and the actions
+    GLuint m_parameters{0};
+    GLuint m_actions{0};
+    size_t m_count{0};
+    bool m_autoReset{false};
+    uint64_t m_seed{1};
+};
+
+#endif
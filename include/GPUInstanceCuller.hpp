@@ -0,0 +1,121 @@
+/** @file GPUInstanceCuller.hpp
+ *  @brief Frustum culling of a DrawBatch's instances on the GPU.
+ *
+ *  Made for the thousands of instances of --stress, which the CPU would
+ *  otherwise place and cull one sphere at a time every frame. The batch
+ *  queues them unculled; once it is uploaded, Cull() reads a range of its
+ *  commands' instances straight from the ring buffer, one point each,
+ *  and tests each instance's sphere against a frustum in a vertex
+ *  shader. A geometry shader passes on the instances inside it only,
+ *  and transform feedback writes them, still in order, into a buffer
+ *  laid out like the batch's: the survivors of every command from its
+ *  own baseInstance on. The CPU never looks at an instance.
+ *
+ *  Draw counts stay on the GPU too. The context is GL 4.1, so neither
+ *  glDrawTransformFeedbackInstanced nor query buffers are there, and a
+ *  primitive query read back would stall the frame. Every survivor is
+ *  also drawn as a point, added into a float texel of its command
+ *  instead; End() then runs one vertex per command with rasterization
+ *  off, which copies the command with that count as its instanceCount
+ *  into an indirect buffer through transform feedback. DrawCommands()
+ *  draws from the two buffers with one glMultiDrawElementsIndirect.
+ *
+ *  All of it needs multi-draw-indirect and base instances, which the
+ *  batch must use; without them, or without the shaders, IsReady() is
+ *  false and the instances are culled on the CPU as before.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef GPUINSTANCECULLER_HPP
+#define GPUINSTANCECULLER_HPP
+
+#include "DrawBatch.hpp"
+#include "Frustum.hpp"
+#include "ShaderProgram.hpp"
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// The shaders of the two passes
+struct GPUCullShaders{
+    std::string cullVertex;
+    std::string cullGeometry;
+    std::string cullFragment;
+    std::string commands;
+};
+
+class GPUInstanceCuller{
+public:
+    // Constructor
+    GPUInstanceCuller();
+    // Destructor
+    // Note: Call Release() while the GL context is alive.
+    ~GPUInstanceCuller();
+    GPUInstanceCuller(const GPUInstanceCuller&) = delete;
+    GPUInstanceCuller& operator=(const GPUInstanceCuller&) = delete;
+    // Builds the shaders and creates room for as many instances and
+    // commands as batch holds. False if batch does not use
+    // multi-draw-indirect or something could not be made.
+    bool Initialize(const DrawBatch& batch, size_t maxInstances, size_t maxCommands, const GPUCullShaders& shaders);
+    // Builds the shaders again, keeping the old ones if that fails
+    bool ReloadShaders(const GPUCullShaders& shaders);
+    inline bool IsReady() const{
+        return m_instances != 0;
+    }
+    // Starts culling the uploaded batch: clears the counts and binds
+    // what both passes read
+    void Begin(const DrawBatch& batch);
+    // Culls the instances of count commands from first, all of whose
+    // meshes sit in sphere, against frustum
+    void Cull(const DrawBatch& batch, size_t first, size_t count, const BoundingSphere& sphere, const Frustum& frustum);
+    // Writes the commands of every range culled since Begin() and
+    // restores the state both passes changed
+    void End();
+    // Draws count culled commands from first, as batch.DrawCommands()
+    // would have drawn them all. False if they were not culled.
+    bool DrawCommands(DrawBatch& batch, size_t first, size_t count);
+    // Deletes the buffers, the count target and the programs
+    void Release();
+private:
+    struct CulledRange{
+        size_t first;
+        size_t count;
+    };
+
+    bool BuildShaders(const GPUCullShaders& shaders);
+    // True if every command in [first, first + count) was culled since
+    // the last Begin()
+    bool WasCulled(size_t first, size_t count) const;
+
+    ShaderProgram m_cullProgram;
+    ShaderProgram m_commandProgram;
+    struct CullUniforms{
+        GLint sphere{-1};
+        GLint planes{-1};
+        GLint command{-1};
+        GLint countSize{-1};
+    } m_cull;
+    GLint m_commandCounts{-1};
+    GLint m_commandCountSize{-1};
+    // The culled instances and the commands that draw them
+    GLuint m_instances{0};
+    GLuint m_commands{0};
+    // A texel per command, the survivors added up into it
+    GLuint m_countTexture{0};
+    GLuint m_countFramebuffer{0};
+    GLsizei m_countWidth{0};
+    GLsizei m_countHeight{0};
+    // Read the batch's instances and commands
+    GLuint m_cullVao{0};
+    GLuint m_commandVao{0};
+    size_t m_maxInstances{0};
+    size_t m_maxCommands{0};
+    std::vector<CulledRange> m_ranges;
+    GLint m_previousFramebuffer{0};
+    bool m_culling{false};
+};
+
+#endif
@@ -0,0 +1,101 @@
+/** @file GPUProfiler.hpp
+ *  @brief GPU timings of named render passes from timestamp queries.
+ *
+ *  Each pass is bracketed by two glQueryCounter(GL_TIMESTAMP) queries.
+ *  The query sets are double-buffered: results of a frame are only
+ *  read two frames later, and only if the driver reports them as
+ *  available, so collecting timings never stalls the pipeline.
+ *  Samples are kept in a rolling window per pass, from which Report()
+ *  prints the mean and 99th percentile. A CSV file with one row per
+ *  frame can be written as well, and the raw timestamps can be handed
+ *  to a TraceRecorder.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef GPUPROFILER_HPP
+#define GPUPROFILER_HPP
+
+#include <glad/glad.h>
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+class FlightRecorder;
+class TraceRecorder;
+
+class GPUProfiler{
+public:
+    // Constructor
+    GPUProfiler();
+    // Destructor
+    // Note: Call Release() while the GL context is alive.
+    ~GPUProfiler();
+    // Registers a pass and returns its id. All passes must be added
+    // before Initialize().
+    int AddPass(const std::string& name);
+    // Creates the queries. Must be called after the GL loader is initialized.
+    void Initialize();
+    // Also writes every collected frame to a CSV file
+    bool OpenCSV(const std::string& filepath);
+    // Also passes every collected pass to trace while it records. Call
+    // after every pass is added and before Initialize(), which syncs the
+    // trace with the GPU clock.
+    void SetTrace(TraceRecorder* trace);
+    // The same for a FlightRecorder, which keeps passes all the time
+    void SetFlightRecorder(FlightRecorder* flight);
+    // Collects the results of the frame that used this query set last
+    void BeginFrame();
+    // Brackets the GL commands of a pass
+    void BeginPass(int pass);
+    void EndPass(int pass);
+    // Moves to the other query set
+    void EndFrame();
+    // GPU time of all passes of the frame BeginFrame() collected last, in
+    // milliseconds, negative if none of its results were available
+    double GetCollectedFrameTime() const;
+    // Passes registered, their names and rolling means in milliseconds
+    // (negative while a pass has no samples)
+    inline int GetPassCount() const{
+        return (int)m_passes.size();
+    }
+    inline const std::string& GetPassName(int pass) const{
+        return m_passes[pass].name;
+    }
+    double GetPassMean(int pass) const;
+    // Prints the rolling mean and p99 of every pass
+    void Report() const;
+    // Deletes the queries and closes the CSV file
+    void Release();
+private:
+    // Query sets in flight; results are read QUERY_FRAMES frames later
+    static const int QUERY_FRAMES = 2;
+    // Samples kept per pass for the rolling statistics
+    static const size_t WINDOW_SIZE = 240;
+
+    struct Pass{
+        std::string name;
+        // Begin/end timestamp queries for each query set
+        GLuint queries[QUERY_FRAMES][2];
+        // Whether the pass was issued in each query set
+        bool issued[QUERY_FRAMES];
+        // Rolling window of GPU times in milliseconds
+        std::vector<double> samples;
+        size_t nextSample;
+        // Name id in the trace
+        int traceName;
+        // Name id in the flight recorder
+        int flightName;
+    };
+
+    std::vector<Pass> m_passes;
+    // Time of each pass in the frame being collected, negative if unavailable
+    std::vector<double> m_frameTimes;
+    int m_frame{0};
+    bool m_initialized{false};
+    std::ofstream m_csv;
+    TraceRecorder* m_trace{nullptr};
+    FlightRecorder* m_flight{nullptr};
+};
+
+#endif
@@ -0,0 +1,91 @@
+/** @file GPUResourceTracker.hpp
+ *  @brief Bookkeeping of every GL object the engine creates.
+ *
+ *  The classes that own GL objects (MeshRegistry, Texture, TextureArray,
+ *  ShaderProgram, RingBuffer, PixelObserver, GPUProfiler) report each
+ *  object when they create it, when its storage is (re)allocated and
+ *  when they delete it. That gives a live count and byte total per
+ *  category and overall, printed by Report() in debug mode. Sizes are
+ *  what was asked of the driver (buffer sizes, texel data with its mip
+ *  chain), not what it really allocated, which GL cannot tell.
+ *
+ *  ReportLeaks() lists every object still alive, meant for shutdown,
+ *  after everything should have been released. Render workers
+ *  (RenderWorkers) report the objects of their own contexts too, so the
+ *  calls are serialized by a lock. Vertex arrays, framebuffers and
+ *  queries are not shared between contexts, and the driver hands out
+ *  the same names in each: those are kept apart by the context that
+ *  made them, the one SetContext() named on the calling thread.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef GPURESOURCETRACKER_HPP
+#define GPURESOURCETRACKER_HPP
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+
+enum GPUResourceType{
+    GPU_BUFFER,
+    GPU_TEXTURE,
+    GPU_VERTEX_ARRAY,
+    GPU_PROGRAM,
+    GPU_SHADER,
+    GPU_RENDERBUFFER,
+    GPU_FRAMEBUFFER,
+    GPU_QUERY,
+    GPU_RESOURCE_TYPES
+};
+
+class GPUResourceTracker{
+public:
+    // The tracker every GL owner reports to
+    static GPUResourceTracker& Get();
+    // The context current on the calling thread, 0 (the default) for the
+    // main one
+    static void SetContext(unsigned int context);
+
+    // A new object; label says what it is for and must outlive the object
+    void Created(GPUResourceType type, GLuint name, const char* label, size_t bytes = 0);
+    // The object's storage was (re)allocated to bytes
+    void Resized(GPUResourceType type, GLuint name, size_t bytes);
+    // The object was deleted; name 0 is ignored, as glDelete* does
+    void Deleted(GPUResourceType type, GLuint name);
+
+    // Live objects and bytes of a category, and bytes of all of them
+    size_t GetCount(GPUResourceType type) const;
+    size_t GetBytes(GPUResourceType type) const;
+    size_t GetTotalBytes() const;
+    // Plural name of a category, "buffers" and so on
+    static const char* GetTypeName(GPUResourceType type);
+    // Prints the live count and bytes of every category
+    void Report() const;
+    // Prints every object still alive and returns how many there are
+    size_t ReportLeaks() const;
+private:
+    // Constructor
+    GPUResourceTracker();
+    // Destructor
+    ~GPUResourceTracker();
+
+    struct Resource{
+        const char* label;
+        size_t bytes;
+    };
+    // The name, and for the unshared types the context above it
+    static uint64_t GetKey(GPUResourceType type, GLuint name);
+    // GetTotalBytes() with the lock held
+    size_t SumBytes() const;
+
+    mutable std::mutex m_mutex;
+    std::unordered_map<uint64_t, Resource> m_resources[GPU_RESOURCE_TYPES];
+    size_t m_bytes[GPU_RESOURCE_TYPES];
+    // Objects ever created, to tell leaks apart from churn
+    uint64_t m_created[GPU_RESOURCE_TYPES];
+};
+
+#endif
@@ -0,0 +1,42 @@
+/** @file GameRandom.hpp
+ *  @brief Small seeded random number generator owned by each game.
+ *
+ *  PCG32 (O'Neill, pcg-random.org): 64-bit LCG state, 32-bit output
+ *  through a xorshift and a random rotation. The generator is plain
+ *  data inside GameState, so every game has its own sequence: nothing
+ *  is shared between threads, copying a state copies its future
+ *  obstacles, and the same seed and stream always replay the same game.
+ *  Different streams with the same seed give independent sequences.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef GAMERANDOM_HPP
+#define GAMERANDOM_HPP
+
+#include <cstdint>
+
+struct GameRandom{
+    uint64_t state = 0x853c49e6748fea9bULL;
+    // Stream selector, always odd
+    uint64_t increment = 0xda3e39cb94b95bdbULL;
+};
+
+// Returns the next 32 random bits
+inline uint32_t NextGameRandom(GameRandom& rng){
+    uint64_t old = rng.state;
+    rng.state = old * 6364136223846793005ULL + rng.increment;
+    uint32_t xorshifted = (uint32_t)(((old >> 18) ^ old) >> 27);
+    uint32_t rotation = (uint32_t)(old >> 59);
+    return (xorshifted >> rotation) | (xorshifted << ((32 - rotation) & 31));
+}
+
+// Starts the sequence selected by seed and stream
+inline void SeedGameRandom(GameRandom& rng, uint64_t seed, uint64_t stream = 0){
+    rng.state = 0;
+    rng.increment = (stream << 1) | 1;
+    NextGameRandom(rng);
+    rng.state += seed;
+    NextGameRandom(rng);
+}
+
+#endif
@@ -0,0 +1,279 @@
+/** @file GameState.hpp
+ *  @brief The gameplay simulation, independent of SDL and OpenGL.
+ *
+ *  GameState holds everything the rules need: the score tick, the
+ *  day/night cycle, the dino's jump and the obstacles. Step() advances
+ *  it by one fixed tick given the player's action. Neither touches
+ *  any global (the spawn RNG lives in the state), prints anything or
+ *  needs a window, so the simulation can run headless as fast as the
+ *  CPU allows and two states stepped with the same actions stay equal.
+ *
+ *  Obstacles live in a fixed-size ObstacleLane inside the state and
+ *  are spawned in groups by SpawnObstacles() from the state's RNG, so
+ *  a running game never allocates. A game stepped with a spawn script
+ *  frame (see SpawnScript.hpp) takes its groups from the script until
+ *  it ends; the frame is the caller's, next to the state.
+ *
+ *  The state is plain data of fixed size, 128 bytes, with nothing
+ *  behind a pointer. Saving and restoring a game is a memcpy, so a
+ *  search can branch from any state instead of replaying from the
+ *  start.
+ *
+ *  Stepping is integer arithmetic only: positions, heights and speeds
+ *  are whole game units and a tick is the unit of time, with no float
+ *  dt anywhere. The same game therefore steps bit for bit alike on
+ *  x86-64 and AArch64, in the scalar and in every SIMD batch, which
+ *  versus races, replays and HashGameState() comparisons rely on. The
+ *  one input derived from floats, the hit boxes, is converted through
+ *  fixed point (see FixedPoint.hpp); keep floats out of Step().
+ *
+ *  @bug No known bugs.
+ */
+#ifndef GAMESTATE_HPP
+#define GAMESTATE_HPP
+
+#include "GameRandom.hpp"
+#include "ObstacleLane.hpp"
+#include "SpawnScript.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+// What the player does during a tick. 32 bits wide so batches of
+// actions can be loaded straight into vector lanes.
+enum GameAction : int32_t{
+    ACTION_NONE,
+    ACTION_JUMP     // Starts a jump, ignored while already airborne
+};
+
+// Things that happened during a Step(), combined as bit flags
+enum GameEvent : unsigned int{
+    EVENT_NONE        = 0,
+    EVENT_DAY_CHANGED = 1 << 0,
+    EVENT_GAME_OVER   = 1 << 1
+};
+
+// Reward of a step survived and of the step that ends the game
+const float REWARD_SURVIVED = 1.0f;
+const float REWARD_GAME_OVER = -1.0f;
+
+struct GameState{
+    // Ticks survived, also the score
+    int tick = 0;
+    // Ticks since the last day/night change
+    int dayTick = 0;
+    bool isDaytime = true;
+
+    // Dino height above the ground
+    int dinoHeight = 0;
+    // Whether the dino is in the air; a new jump cannot start until it lands
+    bool isJumping = false;
+    // Whether the jump is still rising
+    bool jumpingUp = true;
+    int jumpingSpeed = 4;
+
+    // Distance the lane has scrolled since the last spawn. Obstacle
+    // positions are relative to it: an obstacle is at x - scroll.
+    int scroll = 0;
+    // Scroll distance left until the next group of obstacles spawns
+    int spawnDistance = 0;
+    // Scroll speed, re-rolled whenever a group spawns
+    int cactusSpeed = 5;
+    ObstacleLane obstacles;
+
+    // Set by a collision, Step() does nothing until the state is reset
+    bool gameOver = false;
+    // Collisions are ignored while this is set (debug mode)
+    bool invincible = false;
+
+    // Obstacle spawn RNG
+    GameRandom rng;
+};
+
+static_assert(std::is_trivially_copyable<GameState>::value, "GameState must stay plain data");
+static_assert(sizeof(GameState) <= 128, "GameState must stay within two cache lines");
+
+// Ticks per day or night
+const int DAY_LENGTH = 1000;
+// Added to both the scroll and the jumping speed at every day change
+const int DAY_SPEEDUP = 2;
+// Height at which a jump turns around
+const int JUMP_APEX = 152;
+
+// The numbers the rules are played with. The defaults are the game as
+// shipped; a batch can give every environment its own (see
+// GameStateBatch::SetParameters()) for sweeps and randomised difficulty.
+// They are not part of GameState: whoever steps a state says which
+// rules it is stepped with. Every field must be at least 1, daySpeedup
+// and spawnGapMin at least 0, and dayLength at least the ticks of a step.
+struct GameParameters{
+    // Scroll and jumping speed a game starts with
+    int cactusSpeed = 5;
+    int jumpingSpeed = 4;
+    int jumpApex = JUMP_APEX;
+    int dayLength = DAY_LENGTH;
+    int daySpeedup = DAY_SPEEDUP;
+    // Clear lane between two groups is spawnGapMin + [0, spawnGapRange)
+    int spawnGapMin = 1000;
+    int spawnGapRange = 800;
+    // A spawn re-rolls the speed to spawnSpeedMin + [0, speed)
+    int spawnSpeedMin = 6;
+};
+
+const GameParameters DEFAULT_GAME_PARAMETERS = GameParameters();
+
+// The rules Step<Rules>() is compiled for. RuntimeGameRules reads every
+// number from the GameParameters passed in, as Step() does. A rules type
+// with FIXED set fixes them at compile time in PARAMETERS instead, and the
+// GameParameters passed in are ignored: the jump apex, the day length and
+// the speed-ups become immediates the compiler folds into the compares
+// and the batch kernel no longer loads their columns. Sweeps keep the
+// runtime rules; runs that never change the rules can use fixed ones.
+struct RuntimeGameRules{
+    static constexpr bool FIXED = false;
+};
+
+// The game as shipped, DEFAULT_GAME_PARAMETERS at compile time
+struct ShippedGameRules{
+    static constexpr bool FIXED = true;
+    static constexpr GameParameters PARAMETERS = GameParameters();
+};
+
+// The numbers Rules plays with: its own when they are fixed, parameters
+// otherwise
+template<typename Rules>
+inline const GameParameters& GetRuleParameters(const GameParameters& parameters){
+    if constexpr(Rules::FIXED){
+        return Rules::PARAMETERS;
+    }else{
+        return parameters;
+    }
+}
+
+// Obstacles spawn at this position, just off the right of the screen
+const int OBSTACLE_SPAWN_X = 400;
+// Obstacles left of this position, well off the screen, are dropped
+const int OBSTACLE_DESPAWN_X = -800;
+// GetLeadObstacle() when there is no obstacle ahead of the dino
+const int NO_OBSTACLE = 1 << 30;
+
+// A formation the spawner can emit: count cacti, spacing apart
+struct ObstacleArchetype{
+    int count;
+    int spacing;
+    // Relative chance of being picked
+    int weight;
+};
+
+class SpawnSchedule;
+
+// The formations SpawnObstacles() picks from, and how many there are
+const ObstacleArchetype* GetObstacleArchetypes(int& count);
+
+// Spawns the groups that are due, once spawnDistance has run out.
+// Positions are first rebased so the new scroll is 0, which keeps them
+// small however long the game runs, and obstacles past
+// OBSTACLE_DESPAWN_X are dropped. Each group picks an archetype, the
+// gap to the next group and a new speed from rng, within the ranges of
+// parameters. Takes the fields one by one so batched states can share it.
+// With a script running in script, each group is the one it yields
+// instead, obstacles at its height; the speed is re-rolled either way.
+// With a schedule, the random groups take their draws from game index of
+// it (see SpawnSchedule.hpp), which leaves rng exactly as drawing them.
+void SpawnObstacles(ObstacleLane& obstacles, int& scroll, int& spawnDistance, int& cactusSpeed, GameRandom& rng,
+                    const GameParameters& parameters = DEFAULT_GAME_PARAMETERS, SpawnScriptFrame* script = nullptr,
+                    SpawnSchedule* schedule = nullptr, size_t index = 0);
+
+// Position of the first obstacle that has not yet passed the dino's hit
+// box, or NO_OBSTACLE. It is the only one that can be hit, and the one
+// an agent has to jump next.
+int GetLeadObstacle(const ObstacleLane& obstacles, int scroll);
+
+// Number of cacti in the formation of the lead obstacle, 0 without one.
+// At the end of a game it is the formation the dino ran into.
+int GetLeadFormation(const ObstacleLane& obstacles, int scroll);
+
+// Puts the state back to the start of a game, at the starting speeds of
+// parameters. The seed and stream select the obstacle spawn sequence.
+void ResetGameState(GameState& state, uint64_t seed = 1, uint64_t stream = 0,
+                    const GameParameters& parameters = DEFAULT_GAME_PARAMETERS);
+
+// Advances the state by ticks ticks and returns the GameEvent flags raised.
+// One tick is the game as played. A longer step moves everything ticks
+// times as far at once, so the jump turns around a step late; it is a
+// coarser approximation for training, at 1/ticks of the cost. Collisions
+// use the boxes and silhouettes of GetCollisionRules() (see Collision.hpp) and are swept
+// over the whole step, so none is missed however far things move.
+// ticks must be between 1 and parameters.dayLength. Spawns resume the
+// script of script, if given (see SpawnObstacles()).
+unsigned int Step(GameState& state, GameAction action, int ticks = 1,
+                  const GameParameters& parameters = DEFAULT_GAME_PARAMETERS, SpawnScriptFrame* script = nullptr);
+
+// Step() compiled for Rules (see RuntimeGameRules). Step<ShippedGameRules>()
+// steps exactly like Step() with the default parameters, only with the
+// rules folded in. Built for RuntimeGameRules and ShippedGameRules.
+template<typename Rules>
+unsigned int Step(GameState& state, GameAction action, int ticks = 1,
+                  const GameParameters& parameters = DEFAULT_GAME_PARAMETERS, SpawnScriptFrame* script = nullptr);
+
+// Repeats action for repeat steps of ticks ticks (frame skip), stopping
+// early at the end of the game, and returns the GameEvent flags of all
+// of them. Unlike a longer step every one follows the rules exactly.
+// Adds the reward of the steps taken, REWARD_SURVIVED each and
+// REWARD_GAME_OVER for the last one of a game, to reward if given.
+unsigned int StepRepeated(GameState& state, GameAction action, int repeat, float* reward = nullptr, int ticks = 1,
+                          const GameParameters& parameters = DEFAULT_GAME_PARAMETERS);
+
+// StepRepeated() of Step<Rules>()
+template<typename Rules>
+unsigned int StepRepeated(GameState& state, GameAction action, int repeat, float* reward = nullptr, int ticks = 1,
+                          const GameParameters& parameters = DEFAULT_GAME_PARAMETERS);
+
+// Ticks the dino spends in the air in a jump started at the next tick,
+// at the state's jumping speed
+int GetJumpTicks(const GameState& state, const GameParameters& parameters = DEFAULT_GAME_PARAMETERS);
+
+// Ticks of ACTION_NONE a dino on the ground (not jumping) can skip at once with
+// FastForward(), stopping short of the first tick a policy has anything
+// to decide at or anything but scrolling happens: the lead obstacle
+// coming within reach of a jump (GetJumpTicks() of scrolling from the
+// dino's hit box), the day changing, or obstacles spawning. 0 in the
+// air, once the game is over or when one of those is due next tick.
+int GetEventHorizon(const GameState& state, const GameParameters& parameters = DEFAULT_GAME_PARAMETERS);
+
+// Advances a dino on the ground by up to ticks ticks of ACTION_NONE in
+// one go, no further than GetEventHorizon(), and returns the ticks
+// taken. The state is bit for bit what as many Step() calls would give;
+// none of them would have raised an event.
+int FastForward(GameState& state, int ticks, const GameParameters& parameters = DEFAULT_GAME_PARAMETERS);
+
+// Saves a game into snapshot and puts it back, byte for byte
+inline void SnapshotGameState(const GameState& state, GameState& snapshot){
+    std::memcpy(&snapshot, &state, sizeof(GameState));
+}
+
+inline void RestoreGameState(GameState& state, const GameState& snapshot){
+    std::memcpy(&state, &snapshot, sizeof(GameState));
+}
+
+// Copies parent into children[0] .. children[count - 1], the children of
+// one node of a tree search. Each child carries the parent's RNG, so all of
+// them see the same obstacles until their actions differ.
+void CloneGameState(const GameState& parent, GameState* children, size_t count);
+
+// Distance the lane scrolls in the next Step() of ticks ticks, 0 once
+// the game is over. Lets a renderer keep track of the total distance.
+int GetStepDistance(const GameState& state, int ticks = 1, const GameParameters& parameters = DEFAULT_GAME_PARAMETERS);
+
+// FNV-1a hash of every field, for checking that two runs ended up equal
+uint64_t HashGameState(const GameState& state);
+
+// The first field HashGameState() covers in which a and b differ, as
+// "<field> <a> vs <b>", or an empty string if they are equal. Says where
+// two backends that stopped agreeing went apart.
+std::string DescribeGameStateDifference(const GameState& a, const GameState& b);
+
+#endif
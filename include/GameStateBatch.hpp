@@ -0,0 +1,244 @@
+/** @file GameStateBatch.hpp
+ *  @brief Many independent games stepped together.
+ *
+ *  Stores N GameStates as structure-of-arrays, one column of 32-bit
+ *  lanes per field, and advances all of them at once. Flags are kept
+ *  as lane masks (0 or ~0) so the step kernel is branch-free: jump
+ *  phase, day change and collision are all computed with compares and
+ *  selects, several environments per instruction. The kernel is
+ *  written once against a small lane wrapper and built for AVX2 (8
+ *  lanes, when compiled with -mavx2), SSE2 (4 lanes, any x86-64) or
+ *  NEON (4 lanes, AArch64), with a scalar tail for the remainder.
+ *
+ *  Obstacles are the exception: each environment's ObstacleLane is
+ *  kept whole, and the kernel only tracks a column with the position
+ *  of its lead obstacle (see GetLeadObstacle()), the first one the dino
+ *  can reach. Spawns, a lead obstacle passing the dino and the exact
+ *  swept collision test, for the environments that could be hit at
+ *  all, are rare and handled one environment at a time.
+ *
+ *  Every environment follows exactly the same rules as Step() in
+ *  GameState.cpp: stepping a batch and stepping each state alone
+ *  gives identical results.
+ *
+ *  Each environment also has its own GameParameters, kept as columns
+ *  like the state and loaded into lanes by the same kernel, so one batch
+ *  can sweep speeds, jump heights, day lengths and spawn gaps, or
+ *  randomise them per environment, at the cost of a uniform one. They
+ *  belong to the environment rather than to its game: Reset(), Set()
+ *  and Clone() keep them, a new environment gets the defaults, and a
+ *  state taken out with Get() steps alone the same way when given
+ *  GetParameters() of its environment, and a copy of GetScriptFrame().
+ *
+ *  An environment can also play a spawn script (see SpawnScript.hpp),
+ *  which like its parameters belongs to the environment and restarts
+ *  with every Reset(). The frame of a running script comes from the
+ *  batch's SpawnScriptPool, which has one per environment from Resize()
+ *  on, so stepping never allocates; an environment whose script ended
+ *  gives its frame back and spawns at random again. Birds a script
+ *  spawns are obstacles above the ground, and the kernel's height test
+ *  reaches up to the highest obstacle of each lane.
+ *
+ *  Random spawns take their draws from the batch's SpawnSchedule, a
+ *  block of upcoming ones per environment drawn ahead of need, instead
+ *  of walking each game's RNG in the middle of the step. A reset only
+ *  moves the environment's RNG; its block no longer matches and is
+ *  drawn again at its first spawn.
+ *
+ *  Save() and Load() checkpoint the whole batch as its columns, each
+ *  written out as one block of raw bytes (in the machine's byte order,
+ *  little endian on every supported target):
+ *    "DBAT", uint32 version, uint32 sizeof(ObstacleLane),
+ *    uint32 sizeof(GameRandom), uint64 count, then every column in
+ *    declaration order, count entries each, parameters and spawn
+ *    scripts included, then every environment's SpawnScriptFrame (an
+ *    empty one where no script runs).
+ *  The sizes guard against loading a checkpoint of another layout.
+ *
+ *  The columns are allocated with HugePageAllocator: those of a large
+ *  batch, or of many shards on one thread, share 2 MB pages and so a
+ *  few TLB entries.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef GAMESTATEBATCH_HPP
+#define GAMESTATEBATCH_HPP
+
+#include "GameState.hpp"
+#include "HugePages.hpp"
+#include "SpawnSchedule.hpp"
+#include "SpawnScript.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+class GameStateBatch{
+public:
+    // Constructor
+    GameStateBatch();
+    // Destructor
+    ~GameStateBatch();
+    // A copy allocates its columns anew; a move takes them along
+    GameStateBatch(const GameStateBatch&) = default;
+    GameStateBatch(GameStateBatch&&) = default;
+    GameStateBatch& operator=(const GameStateBatch&) = default;
+    GameStateBatch& operator=(GameStateBatch&&) = default;
+    // Changes the number of environments, new ones start reset with
+    // seed 1 and their index as the stream
+    void Resize(size_t count);
+    inline size_t GetCount() const{
+        return m_count;
+    }
+    // Resets one environment, at the starting speeds of its parameters
+    void Reset(size_t index, uint64_t seed, uint64_t stream);
+    // Resets every environment with the same seed, environment i uses
+    // stream i so their obstacle sequences are independent
+    void ResetAll(uint64_t seed);
+    // Copies an environment in or out
+    GameState Get(size_t index) const;
+    void Set(size_t index, const GameState& state);
+    // Changes the rules of one environment from its next step on; its
+    // game goes on at the speeds it reached until it is reset
+    void SetParameters(size_t index, const GameParameters& parameters);
+    GameParameters GetParameters(size_t index) const;
+    // Plays script in one environment from its next Reset() on,
+    // SPAWN_SCRIPT_NONE for none. Set() and Clone() leave the frame of
+    // the game running as it is.
+    inline void SetSpawnScript(size_t index, uint16_t script){
+        m_spawnScript[index] = script;
+    }
+    inline uint16_t GetSpawnScript(size_t index) const{
+        return (uint16_t)m_spawnScript[index];
+    }
+    // Where the script of an environment's game is, an empty frame if
+    // it runs none
+    SpawnScriptFrame GetScriptFrame(size_t index) const;
+    // Turns collisions of one environment off or on, as debug mode does
+    inline void SetInvincible(size_t index, bool invincible){
+        m_invincible[index] = invincible ? ~0 : 0;
+    }
+    // Copies one state into environments first .. first + count - 1, to
+    // expand a search node into children stepped together
+    void Clone(const GameState& parent, size_t first, size_t count);
+    // Advances every environment by ticks ticks (see Step() in
+    // GameState.hpp), actions has GetCount() entries
+    void Step(const GameAction* actions, int ticks = 1);
+    // Repeats actions for repeat steps of ticks ticks, as StepRepeated()
+    // in GameState.hpp does for each environment, and returns early once
+    // every game is over. GetEvents() then has the flags of all of them
+    // and GetRewards() the summed rewards. Returns the number of
+    // environment steps taken.
+    size_t StepRepeated(const GameAction* actions, int repeat, int ticks = 1);
+    // Step() and StepRepeated() compiled for Rules (see RuntimeGameRules
+    // in GameState.hpp). With fixed rules every environment is stepped by
+    // Rules::PARAMETERS, whatever SetParameters() gave it, and the kernel
+    // loads no parameter column. Built for RuntimeGameRules and
+    // ShippedGameRules.
+    template<typename Rules>
+    void Step(const GameAction* actions, int ticks = 1);
+    template<typename Rules>
+    size_t StepRepeated(const GameAction* actions, int repeat, int ticks = 1);
+    // Environments whose game is not over
+    size_t CountRunning() const;
+    // HashGameState() of every environment into hashes, GetCount()
+    // entries: what backends stepped in lockstep compare after each step
+    void HashAll(uint64_t* hashes) const;
+
+    // Columns for observations, GetCount() entries each
+    inline const int* GetTicks() const{
+        return m_tick.data();
+    }
+    inline const int* GetDinoHeights() const{
+        return m_dinoHeight.data();
+    }
+    // ~0 while a jump is on its way up, 0 otherwise
+    inline const int* GetJumpingUpMasks() const{
+        return m_jumpingUp.data();
+    }
+    inline const int* GetJumpingSpeeds() const{
+        return m_jumpingSpeed.data();
+    }
+    // NO_OBSTACLE where there is none
+    inline const int* GetLeadObstacles() const{
+        return m_leadObstacle.data();
+    }
+    // ~0 for finished games, 0 otherwise
+    inline const int* GetGameOverMasks() const{
+        return m_gameOver.data();
+    }
+    // GameEvent flags raised by the last Step()
+    inline const int* GetEvents() const{
+        return m_events.data();
+    }
+    // Rewards of the last StepRepeated()
+    inline const float* GetRewards() const{
+        return m_rewards.data();
+    }
+    // Blocks of spawns the schedule drew, see SpawnSchedule.hpp
+    inline uint64_t GetScheduleFillCount() const{
+        return m_schedule.GetFillCount();
+    }
+    // Name of the instruction set Step() was built for
+    static const char* GetInstructionSet();
+
+    // Writes every environment to file, or replaces them all with the
+    // ones read from it; false if the stream failed or is not a
+    // checkpoint of this version. Events and rewards start out empty.
+    bool Save(std::ostream& file) const;
+    bool Load(std::istream& file);
+private:
+    // Calls visit on each column a checkpoint holds, in file order
+    template<typename Batch, typename Visit>
+    static void VisitColumns(Batch& batch, Visit visit);
+
+    // Steps lanes [first, first + Lanes::WIDTH)
+    template<typename Lanes, typename Rules>
+    void StepLanes(size_t first, const GameAction* actions, int ticks);
+
+    // Columns of large batches sit on huge pages, see HugePages.hpp
+    template<typename T>
+    using Column = std::vector<T, HugePageAllocator<T>>;
+
+    size_t m_count{0};
+    Column<int> m_tick;
+    Column<int> m_dayTick;
+    Column<int> m_isDaytime;       // Mask
+    Column<int> m_dinoHeight;
+    Column<int> m_isJumping;       // Mask
+    Column<int> m_jumpingUp;       // Mask
+    Column<int> m_jumpingSpeed;
+    Column<int> m_scroll;
+    Column<int> m_spawnDistance;
+    Column<int> m_cactusSpeed;
+    Column<int> m_leadObstacle;
+    Column<ObstacleLane> m_obstacles;
+    // GetLaneTop() of the obstacles, kept with them
+    Column<int> m_obstacleTop;
+    Column<int> m_gameOver;        // Mask
+    Column<int> m_invincible;      // Mask
+    Column<GameRandom> m_rng;
+    // GameParameters, one column per field
+    Column<int> m_startCactusSpeed;
+    Column<int> m_startJumpingSpeed;
+    Column<int> m_jumpApex;
+    Column<int> m_dayLength;
+    Column<int> m_daySpeedup;
+    Column<int> m_spawnGapMin;
+    Column<int> m_spawnGapRange;
+    Column<int> m_spawnSpeedMin;
+    // Script of the environment and the pool frame of its game's,
+    // SpawnScriptPool::NO_FRAME where none runs
+    Column<int> m_spawnScript;
+    Column<uint32_t> m_scriptFrame;
+    SpawnScriptPool m_scripts;
+    // The random spawns of every game, drawn ahead
+    SpawnSchedule m_schedule;
+    Column<int> m_events;
+    // StepRepeated() sums into these
+    Column<int> m_repeatEvents;
+    Column<float> m_rewards;
+};
+
+#endif
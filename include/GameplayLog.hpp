@@ -0,0 +1,134 @@
+/** @file GameplayLog.hpp
+ *  @brief Fixed-size binary gameplay records, written off the frame loop.
+ *
+ *  Add() stores one 32-byte GameplayRecord into a ring of the calling
+ *  thread's own and returns: no lock, no allocation, no system call.
+ *  A background thread wakes every GAMEPLAY_FLUSH_MILLISECONDS, takes
+ *  whatever each ring holds and writes it to the file in one block per
+ *  ring. Only the owning thread advances a ring's head and only the
+ *  flush thread its tail, so the two never wait for each other; if a
+ *  ring fills up before the flush comes round, records are dropped and
+ *  counted rather than stalling the game.
+ *
+ *  The file is only ever appended to, record after record, so a kiosk
+ *  keeps one log across restarts. Every session starts with a
+ *  GAMEPLAY_SESSION_START record that doubles as the header: its time
+ *  is the wall clock at Open() in microseconds since 1970, values[0]
+ *  GAMEPLAY_LOG_VERSION and values[1] sizeof(GameplayRecord). Later
+ *  records of the session count their time from that moment. Records
+ *  of different threads are written block by block, so they are only
+ *  in time order within a thread. All fields are in the machine's byte
+ *  order, little endian on every supported target. tools/dinolog.cpp
+ *  summarizes a log.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef GAMEPLAYLOG_HPP
+#define GAMEPLAYLOG_HPP
+
+#include "MemoryTags.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+const int32_t GAMEPLAY_LOG_VERSION = 1;
+// Records each thread can hold between two flushes
+const size_t GAMEPLAY_RING_RECORDS = 4096;
+const int GAMEPLAY_FLUSH_MILLISECONDS = 250;
+
+enum GameplayRecordType : uint16_t{
+    // The header of a session, see above
+    GAMEPLAY_SESSION_START,
+    // values: games started, frames drawn
+    GAMEPLAY_SESSION_END,
+    // A game starts. values: seed (low 32 bits), 0, 0
+    GAMEPLAY_RUN_START,
+    // The dino leaves the ground. values: scroll speed, distance to the
+    // lead obstacle (NO_OBSTACLE without one), 0
+    GAMEPLAY_JUMP,
+    // The dino hits a formation, tick is the score. values: scroll speed,
+    // cacti in the formation, 1 by day and 0 by night
+    GAMEPLAY_DEATH,
+    GAMEPLAY_RECORD_TYPES
+};
+
+struct GameplayRecord{
+    // Since the session started, or the wall clock for a session start
+    uint64_t microseconds;
+    uint16_t type;
+    // Index of the writing thread, in the order threads first wrote
+    uint16_t thread;
+    // Game number within the session
+    uint32_t game;
+    int32_t tick;
+    int32_t values[3];
+};
+
+static_assert(sizeof(GameplayRecord) == 32, "GameplayRecord must stay 32 bytes");
+
+class GameplayLog{
+public:
+    // The log of the whole process
+    static GameplayLog& Get();
+
+    // Appends a session to filepath and starts the flush thread
+    bool Open(const std::string& filepath);
+    inline bool IsOpen() const{
+        return m_open.load(std::memory_order_relaxed);
+    }
+    // Records an event from any thread; does nothing unless open
+    void Add(GameplayRecordType type, uint32_t game, int32_t tick,
+             int32_t value0 = 0, int32_t value1 = 0, int32_t value2 = 0);
+    // Stops the flush thread, writes what is left and closes the file.
+    // Records added meanwhile by other threads may be lost.
+    void Close();
+    // Records written and dropped in this session
+    inline uint64_t GetWrittenCount() const{
+        return m_written;
+    }
+    uint64_t GetDroppedCount() const;
+private:
+    // Constructor
+    GameplayLog();
+    // Destructor
+    ~GameplayLog();
+
+    struct alignas(64) Ring{
+        GameplayRecord records[GAMEPLAY_RING_RECORDS];
+        // Records ever added and ever written; head is written only by
+        // the owning thread, tail only by the flush thread
+        alignas(64) std::atomic<uint64_t> head{0};
+        alignas(64) std::atomic<uint64_t> tail{0};
+        std::atomic<uint64_t> dropped{0};
+        uint16_t thread{0};
+    };
+    // The calling thread's ring, registered on first use
+    Ring& GetThreadRing();
+    // Writes everything the rings hold
+    void Flush();
+    void FlushThread();
+
+    std::atomic<bool> m_open{false};
+    std::FILE* m_file{nullptr};
+    TaggedVector<char, MEMORY_TELEMETRY> m_fileBuffer;
+    std::chrono::steady_clock::time_point m_start;
+    uint64_t m_written{0};
+
+    mutable std::mutex m_ringsMutex;
+    std::vector<std::unique_ptr<Ring>> m_rings;
+
+    std::thread m_thread;
+    std::mutex m_stopMutex;
+    std::condition_variable m_stopCondition;
+    bool m_stop{false};
+};
+
+#endif
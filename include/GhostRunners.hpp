@@ -0,0 +1,91 @@
+/** @file GhostRunners.hpp
+ *  @brief Recorded runs replayed alongside the player, --ghosts=<files>.
+ *
+ *  Every ghost is an input log (see InputLog.hpp) played back against
+ *  its own game, one lane of a GameStateBatch each, so hundreds of them
+ *  advance together in one batched step per simulation step rather than
+ *  one Step() call apiece. Logs are followed exactly as a replay would:
+ *  a logged restart starts the ghost's next game, its debug
+ *  invincibility is set on the lane, and the game's rules are the
+ *  player's.
+ *
+ *  Ghosts start with the player: every one is rewound to the first step
+ *  of its log at startup and whenever the player starts a new game. A
+ *  ghost whose log has run out or whose game is over stops running.
+ *
+ *  Nothing here touches GL or the entity store; the game draws the
+ *  ghosts from the columns below.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef GHOSTRUNNERS_HPP
+#define GHOSTRUNNERS_HPP
+
+#include "GameStateBatch.hpp"
+#include "InputLog.hpp"
+#include "JumpTrajectory.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class GhostRunners{
+public:
+    // Logs beyond this many are not loaded
+    static const size_t MAX_GHOSTS = 512;
+
+    // Constructor
+    GhostRunners();
+    // Destructor
+    ~GhostRunners();
+    // Loads a ghost per log file; files that do not load are reported and
+    // skipped. Returns the number of ghosts.
+    size_t Load(const std::vector<std::string>& filepaths);
+    inline size_t GetCount() const{
+        return m_logs.size();
+    }
+    // Puts every ghost back at the first step of its log
+    void Rewind();
+    // Advances every ghost still running by its next logged step
+    void Step();
+
+    // Columns after the last Step(), GetCount() entries each
+    inline const int* GetTicks() const{
+        return m_batch.GetTicks();
+    }
+    inline const int* GetDinoHeights() const{
+        return m_batch.GetDinoHeights();
+    }
+    // Palette of the last logged input
+    inline const uint8_t* GetPalettes() const{
+        return m_palettes.data();
+    }
+    // 1 while the ghost's log has steps left and its game is not over
+    inline const uint8_t* GetRunning() const{
+        return m_running.data();
+    }
+    // Each ghost's jump, anchored on the GetStep() clock, for drawing the
+    // arc without its height
+    inline const JumpAnchor* GetJumpAnchors() const{
+        return m_jumps.data();
+    }
+    // Steps every ghost has taken since the rewind
+    inline size_t GetStep() const{
+        return m_step;
+    }
+private:
+    std::vector<InputLog> m_logs;
+    GameStateBatch m_batch;
+    // Games each ghost has played since the rewind, like gamesPlayed of
+    // StepLoggedInput()
+    std::vector<uint64_t> m_gamesPlayed;
+    std::vector<GameAction> m_actions;
+    std::vector<uint8_t> m_palettes;
+    std::vector<uint8_t> m_running;
+    std::vector<JumpAnchor> m_jumps;
+    // Steps every ghost has taken since the rewind
+    size_t m_step{0};
+};
+
+#endif
@@ -0,0 +1,90 @@
+/** @file GroundStream.hpp
+ *  @brief The track under the lane, streamed in fixed-size chunks.
+ *
+ *  The track is cut into chunks GROUND_CHUNK_LENGTH game units long,
+ *  numbered from the start of the game. Every chunk is generated from
+ *  its number and the game's seed: a strip with a wavy edge and small
+ *  bumps, plus a few pebbles, so no two stretches look the same and
+ *  a chunk that comes back after a restart looks as it did before.
+ *
+ *  Only GROUND_CHUNK_SLOTS chunks exist at a time. Their vertices live
+ *  in a ring of equally sized slots reserved at the end of the scene
+ *  arena, with one shared set of indices. As the track scrolls, the
+ *  chunk that falls behind the camera gives its slot to the one coming
+ *  up ahead, and only that slot is rewritten. Memory is fixed, and an
+ *  update never uploads more than the ring, however far the run goes.
+ *
+ *  Stream() picks the chunks and builds their vertices without
+ *  touching GL; Upload() writes the slots that changed.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef GROUNDSTREAM_HPP
+#define GROUNDSTREAM_HPP
+
+#include "DrawBatch.hpp"
+#include "Frustum.hpp"
+#include "MeshRegistry.hpp"
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Length of one chunk along the lane, in game units
+const int GROUND_CHUNK_LENGTH = 100;
+// Chunks resident at once
+const size_t GROUND_CHUNK_SLOTS = 16;
+// How far behind the dino, in game units, the first resident chunk starts
+const int GROUND_CHUNKS_BEHIND = 600;
+// A slot that holds no chunk
+const int64_t NO_GROUND_CHUNK = INT64_MIN;
+
+class GroundStream{
+public:
+    // Constructor
+    GroundStream();
+    // Destructor
+    ~GroundStream();
+    // Appends the slots to an arena being built and remembers where they
+    // are. Call before the arena is created, and again, before it is
+    // updated, when it is rebuilt; every slot is then built again.
+    void Reserve(std::vector<GLfloat>& vertices, std::vector<uint32_t>& indices);
+    // Starts a new track; every slot is generated again
+    void Reset(uint64_t seed);
+    // Makes the chunks around trackDistance, the game units scrolled
+    // since the start, resident, building the vertices of the ones that
+    // are new. Returns how many were built.
+    size_t Stream(int64_t trackDistance);
+    // Writes the slots built since the last Upload() into the arena
+    void Upload(MeshRegistry& registry, MeshHandle arena);
+
+    // Chunk held by a slot, or NO_GROUND_CHUNK
+    inline int64_t GetSlotChunk(size_t slot) const{
+        return m_slotChunk[slot];
+    }
+    inline const DrawRange& GetSlotRange(size_t slot) const{
+        return m_slotRange[slot];
+    }
+    // Model space bounds of every chunk, placed at its start
+    inline const BoundingSphere& GetChunkSphere() const{
+        return m_chunkSphere;
+    }
+private:
+    // Builds a chunk's vertices into its slot of the staging copy
+    void BuildChunk(size_t slot, int64_t chunk);
+
+    uint64_t m_seed{0};
+    int64_t m_slotChunk[GROUND_CHUNK_SLOTS];
+    DrawRange m_slotRange[GROUND_CHUNK_SLOTS];
+    // One bit per slot built but not yet uploaded
+    uint32_t m_pending{0};
+    // First arena vertex of slot 0, the others follow
+    size_t m_firstVertex{0};
+    BoundingSphere m_chunkSphere;
+    // Vertices of every slot as they are on the GPU
+    std::vector<GLfloat> m_staging;
+};
+
+#endif
@@ -0,0 +1,76 @@
+/** @file HeadlessContext.hpp
+ *  @brief An OpenGL context without a window or display, through EGL,
+ *  for GPU servers that run --headless.
+ *
+ *  SDL only makes GL contexts for windows, and a window needs a display
+ *  server; on a GPU node without one that means running Xvfb. The EGL
+ *  device extensions reach the GPU directly instead: Create() lists the
+ *  EGL devices (EGL_EXT_device_enumeration), opens a display on the one
+ *  asked for (EGL_EXT_platform_device), and falls back to Mesa's
+ *  surfaceless platform or the default display where those are missing.
+ *  The context is a desktop GL core profile one like the windowed game's,
+ *  current on a pbuffer surface of the frame's size. The pbuffer stands
+ *  in for the window's framebuffer, so framebuffer 0 keeps working for
+ *  the passes that end there, and nothing is ever shown.
+ *
+ *  CreateShared() makes another context of the same share group, for a
+ *  render worker (RenderWorkers), current nowhere until the worker's
+ *  thread calls MakeCurrent() on it.
+ *
+ *  libEGL is opened at run time, as glad opens libGL, so neither its
+ *  headers nor the library are needed to build or to run windowed.
+ *  Only implemented on Linux; elsewhere Create() fails.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef HEADLESSCONTEXT_HPP
+#define HEADLESSCONTEXT_HPP
+
+#include <string>
+
+class HeadlessContext{
+public:
+    // Constructor
+    HeadlessContext();
+    // Destructor, destroys the context
+    ~HeadlessContext();
+    HeadlessContext(const HeadlessContext&) = delete;
+    HeadlessContext& operator=(const HeadlessContext&) = delete;
+
+    // Makes a GL major.minor core context current on the calling thread,
+    // on EGL device device (0 for the first), with a width x height
+    // pbuffer as its framebuffer 0
+    bool Create(int device, int major, int minor, bool debug, int width, int height);
+    // Makes a context sharing share's objects, on a surface of its own
+    // too small to draw to, and leaves the calling thread's context be
+    bool CreateShared(const HeadlessContext& share);
+    // Makes the context current on the calling thread, or none if current
+    // is false
+    bool MakeCurrent(bool current);
+    void Destroy();
+    inline bool IsCreated() const{
+        return m_context != nullptr;
+    }
+    // The GL entry point name, for gladLoadGLLoader()
+    static void* GetProcAddress(const char* name);
+    // Ends a frame; a pbuffer presents nothing, so this only flushes
+    void Swap();
+    // Which device and driver the context is on, for the log
+    inline const std::string& GetDescription() const{
+        return m_description;
+    }
+private:
+    void* m_display{nullptr};
+    void* m_config{nullptr};
+    void* m_surface{nullptr};
+    void* m_context{nullptr};
+    // A shared context is on its owner's display, and leaves it open
+    bool m_ownsDisplay{true};
+    // What the context was asked for, for the contexts sharing it
+    int m_major{0};
+    int m_minor{0};
+    bool m_debug{false};
+    std::string m_description;
+};
+
+#endif
@@ -0,0 +1,98 @@
+/** @file HugePages.hpp
+ *  @brief Memory backed by 2 MB pages, for columns of many lanes.
+ *
+ *  A batch of a million environments spans tens of thousands of 4 KB
+ *  pages, far more than the TLB holds, so stepping it misses the TLB
+ *  on almost every column. HugePageAllocator hands vectors memory from
+ *  2 MB regions instead: explicit huge pages (MAP_HUGETLB) when the
+ *  system has some reserved, otherwise 2 MB aligned anonymous memory
+ *  advised with MADV_HUGEPAGE, which transparent huge pages back when
+ *  they are enabled ("always" or "madvise").
+ *
+ *  Allocations smaller than HUGE_PAGE_MIN_BYTES come from the heap as
+ *  usual. Larger ones, up to HUGE_PAGE_OWN_BYTES, are carved out of a
+ *  2 MB chunk of the allocating thread, so the many columns of small
+ *  shards share huge pages rather than each rounding up to one; a chunk
+ *  is unmapped once everything in it was freed, by whichever thread.
+ *  Larger allocations still get a mapping of their own. Memory is first
+ *  touched by whoever fills it, so a pinned thread allocating its own
+ *  shards keeps them on its NUMA node.
+ *
+ *  AdviseHugePages() asks for huge pages over an existing mapping, such
+ *  as a shared memory object or a mapped file; only the whole 2 MB pages
+ *  inside it are advised. Everything falls back to plain memory outside
+ *  Linux. What the allocator holds is reported as MEMORY_SIM, since the
+ *  simulation's columns are all that use it.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef HUGEPAGES_HPP
+#define HUGEPAGES_HPP
+
+#include "MemoryTags.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+const size_t HUGE_PAGE_SIZE = 2u << 20;
+// Smaller allocations come from the heap
+const size_t HUGE_PAGE_MIN_BYTES = 4u << 10;
+// Allocations from this size up are mapped on their own
+const size_t HUGE_PAGE_OWN_BYTES = 1u << 20;
+
+// Memory for bytes from the huge page path, 64-byte aligned; throws
+// std::bad_alloc when out of memory. bytes must be HUGE_PAGE_MIN_BYTES
+// or more.
+void* AllocateHugePages(size_t bytes);
+// Frees what AllocateHugePages(bytes) returned
+void FreeHugePages(void* memory, size_t bytes);
+// Asks for huge pages over the whole 2 MB pages of [data, data + size)
+void AdviseHugePages(const void* data, size_t size);
+// Bytes mapped for huge pages so far, and how many of them are explicit
+// (MAP_HUGETLB) pages rather than advised ones
+uint64_t GetHugePageBytes();
+uint64_t GetExplicitHugePageBytes();
+
+template<typename T>
+class HugePageAllocator{
+public:
+    typedef T value_type;
+
+    // Constructor
+    HugePageAllocator() = default;
+    template<typename U>
+    HugePageAllocator(const HugePageAllocator<U>&){
+
+    }
+
+    T* allocate(size_t count){
+        size_t bytes = count * sizeof(T);
+        MemoryTags::Add(MEMORY_SIM, bytes);
+        if(bytes < HUGE_PAGE_MIN_BYTES){
+            return std::allocator<T>().allocate(count);
+        }
+        return (T*)AllocateHugePages(bytes);
+    }
+    void deallocate(T* memory, size_t count){
+        size_t bytes = count * sizeof(T);
+        MemoryTags::Remove(MEMORY_SIM, bytes);
+        if(bytes < HUGE_PAGE_MIN_BYTES){
+            std::allocator<T>().deallocate(memory, count);
+            return;
+        }
+        FreeHugePages(memory, bytes);
+    }
+};
+
+template<typename T, typename U>
+inline bool operator==(const HugePageAllocator<T>&, const HugePageAllocator<U>&){
+    return true;
+}
+
+template<typename T, typename U>
+inline bool operator!=(const HugePageAllocator<T>&, const HugePageAllocator<U>&){
+    return false;
+}
+
+#endif
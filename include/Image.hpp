@@ -10,6 +10,7 @@
 #define IMAGE_HPP
 
 #include <string>
+#include <cstddef>
 #include <cstdint>
 
 class Image {
@@ -18,8 +19,11 @@ public:
     Image (std::string filepath);
     // Destructor
     ~Image();
-    // Loads a PPM from memory.
-    void LoadPPM(bool flip);
+    // Loads a PPM (P3 or P6) from disk, bottom row first if flip is set and
+    // with an opaque alpha channel if padToRGBA is set. With colorKey as
+    // well, texels of pure magenta (255, 0, 255) are transparent instead.
+    // False, with no pixels, if the file cannot be read or is malformed.
+    bool LoadPPM(bool flip, bool padToRGBA=false, bool colorKey=false);
     // Return the width
     inline int GetWidth(){
         return m_width;
@@ -28,7 +32,7 @@ public:
     inline int GetHeight(){
         return m_height;
     }
-    // Bytes per pixel
+    // Bytes per pixel, 3 or 4 when padded to RGBA
     inline int GetBPP(){
         return m_BPP;
     }
@@ -38,27 +42,42 @@ public:
     void PrintPixels();
     // Retrieve raw array of pixel data
     uint8_t* GetPixelDataPtr();
+    // Writes width x height pixels of channels bytes (3 or 4, alpha left
+    // out) to a binary PPM, flipping rows stored bottom-up
+    static bool SavePPM(const std::string& filepath, const uint8_t* pixels, int width, int height, int channels, bool bottomRowFirst);
+    // The pixels of a binary 8-bit PPM (P6) held in size bytes at data,
+    // 3 bytes each, top row first, and its size; nullptr if it is not one
+    // or is truncated. Nothing is copied.
+    static const uint8_t* FindP6Pixels(const char* data, size_t size, int& width, int& height);
     // Returns the red component of a pixel
     inline unsigned int GetPixelR(int x, int y){
-        return m_pixelData[(x*3)+m_height*(y*3)];
+        return m_pixelData[(y*m_width+x)*m_BPP];
     }
     // Returns the green component of a pixel
     inline unsigned int GetPixelG(int x, int y){
-        return m_pixelData[(x*3)+m_height*(y*3)+1];
+        return m_pixelData[(y*m_width+x)*m_BPP+1];
     }
     // Returns the blue component of a pixel
     inline unsigned int GetPixelB(int x, int y){
-        return m_pixelData[(x*3)+m_height*(y*3)+2];
+        return m_pixelData[(y*m_width+x)*m_BPP+2];
     }
 private:
+    // Gives the transparent texels of an RGBA image the color of the
+    // nearest opaque texel of their column
+    void BleedKeyedColumns();
+    // Frees the pixels and forgets the size, after a load that failed
+    void FreePixels();
+
     // Filepath to the image loaded
     std::string m_filepath;
     // Raw pixel data
-    uint8_t* m_pixelData;
+    uint8_t* m_pixelData{nullptr};
+    // Its size, reported as MEMORY_IMAGES
+    size_t m_pixelBytes{0};
     // Size and format of image
     int m_width{0}; // Width of the image
     int m_height{0}; // Height of the image
-    int m_BPP{0};   // Bits per pixel (i.e. how colorful are our pixels)
+    int m_BPP{0};   // Bytes per pixel (i.e. how colorful are our pixels)
 	std::string magicNumber; // magicNumber if any for image format
 };
 
@@ -0,0 +1,73 @@
+/** @file ImpostorBaker.hpp
+ *  @brief Pictures of a mesh, drawn into texture array layers, that its
+ *  distant copies are drawn as instead of the mesh.
+ *
+ *  An impostor is a quad of two triangles showing a picture of the mesh
+ *  taken along a view direction. AppendQuad() adds the quad to a vertex
+ *  stream: a square around the mesh's bounding sphere, made of offsets
+ *  from its center that the vertex shader turns to face the camera (see
+ *  CROSSFADE in shaders/vert.glsl), textured with the whole layer.
+ *
+ *  Begin() binds a framebuffer of the array's layer size and clears it
+ *  transparent; the caller draws the mesh with the scene program through
+ *  the camera of GetBakeCamera(), which frames the sphere orthographically,
+ *  and End() copies the picture into a layer. The scene program draws it,
+ *  so the picture has the palette and texture layer the mesh would. A
+ *  bake is one draw of one mesh, cheap enough to repeat whenever what
+ *  the mesh looks like changes. Only RGBA8 arrays can be copied into.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef IMPOSTORBAKER_HPP
+#define IMPOSTORBAKER_HPP
+
+#include "DrawBatch.hpp"
+#include "Frustum.hpp"
+#include "TextureArray.hpp"
+
+#include <glad/glad.h>
+#include "glm/glm.hpp"
+
+#include <cstdint>
+#include <vector>
+
+class ImpostorBaker{
+public:
+    // Constructor
+    ImpostorBaker();
+    // Destructor
+    // Note: Call Release() while the GL context is alive.
+    ~ImpostorBaker();
+    // Creates the width x height framebuffer pictures are drawn into.
+    // Must be called after the GL loader is initialized.
+    bool Initialize(int width, int height);
+    // True once Initialize() succeeded
+    inline bool IsReady() const{
+        return m_framebuffer != 0;
+    }
+    // Binds the framebuffer, cleared to transparent, with its viewport
+    void Begin();
+    // Copies the picture into a layer of array and binds the default
+    // framebuffer again
+    void End(TextureArray& array, int layer);
+    // Deletes the GL objects
+    void Release();
+
+    // Appends the impostor quad of a mesh with bounding sphere sphere to
+    // an interleaved (x,y,z,nx,ny,nz,u,v) stream and its indices; the
+    // quad's range in them
+    static DrawRange AppendQuad(const BoundingSphere& sphere, std::vector<float>& vertices,
+                                std::vector<uint32_t>& indices);
+    // View and projection that frame sphere seen along direction, with
+    // the world's +y up in the picture
+    static void GetBakeCamera(const BoundingSphere& sphere, const glm::vec3& direction,
+                              glm::mat4& view, glm::mat4& projection);
+private:
+    GLuint m_framebuffer{0};
+    GLuint m_colorBuffer{0};
+    GLuint m_depthBuffer{0};
+    int m_width{0};
+    int m_height{0};
+};
+
+#endif
@@ -0,0 +1,109 @@
+/** @file InputLatency.hpp
+ *  @brief Time from an input event to the frame that shows it.
+ *
+ *  Every input is stamped with the performance counter of the moment it
+ *  happened and follows the frame pipeline: AddInput() when it is polled,
+ *  Simulated() once a simulation step has taken it into the game state,
+ *  Presented() when the swap of the first frame drawn from that state
+ *  returns. The swap returning is as close to the display as the game
+ *  can see without a camera on the screen, so this is the latency the
+ *  game itself is responsible for; the display's scanout comes on top.
+ *  Inputs wait for the next step when a frame runs none, which is part
+ *  of the latency too. When the steps run on another thread, Submit()
+ *  numbers the inputs handed over with each poll, and Simulated() with
+ *  the number a step read takes in only those.
+ *
+ *  When the frame's fence is waited on anyway (see LatencyLimiter),
+ *  Completed() also measures up to the GPU finishing the frame, which
+ *  includes the frames the driver queued in front of it.
+ *
+ *  The most recent WINDOW samples of each are kept for percentiles.
+ *  Nothing allocates; inputs beyond MAX_INPUTS per frame are not timed.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef INPUTLATENCY_HPP
+#define INPUTLATENCY_HPP
+
+#include <cstdint>
+
+class InputLatency{
+public:
+    // Inputs timed per stage of the pipeline
+    static const int MAX_INPUTS = 16;
+    // Samples the percentiles are taken over
+    static const int WINDOW = 256;
+
+    // Constructor
+    InputLatency();
+    // Destructor
+    ~InputLatency();
+    // Counts per second of the counters passed in
+    void Initialize(uint64_t countsPerSecond);
+    // An input happened at counter and waits for a simulation step
+    void AddInput(uint64_t counter);
+    // The inputs added so far are handed to the simulation. Returns their
+    // sequence number, for Simulated() once a step has read them.
+    uint32_t Submit();
+    // A simulation step ran: the waiting inputs are in the game state now
+    void Simulated();
+    // A step that read the inputs submitted as sequence ran
+    void Simulated(uint32_t sequence);
+    // Forgets the waiting inputs, when no step will take them in
+    void Drop();
+    // The swap of a frame drawn after Simulated() returned at counter
+    void Presented(uint64_t counter);
+    // The GPU finished the frame presented last, seen at counter
+    void Completed(uint64_t counter);
+
+    // Latencies in milliseconds measured by the last Presented()
+    inline int GetPresentedCount() const{
+        return m_presentedCount;
+    }
+    inline double GetPresented(int index) const{
+        return m_presented[index];
+    }
+    // Percentile (0 to 100) of the recent latencies up to the swap or to
+    // the GPU finishing, in milliseconds; negative without samples
+    inline double GetSwapPercentile(double percent) const{
+        return m_swap.GetPercentile(percent);
+    }
+    inline double GetGPUPercentile(double percent) const{
+        return m_gpu.GetPercentile(percent);
+    }
+    // Samples measured so far
+    inline unsigned long GetSwapCount() const{
+        return m_swap.total;
+    }
+    inline unsigned long GetGPUCount() const{
+        return m_gpu.total;
+    }
+private:
+    // The most recent samples of one latency
+    struct Window{
+        double samples[WINDOW] = {};
+        int next{0};
+        int count{0};
+        unsigned long total{0};
+
+        void Add(double milliseconds);
+        double GetPercentile(double percent) const;
+    };
+
+    double m_millisecondsPerCount{0.0};
+    // Input counters of each stage: polled, simulated, swapped
+    uint64_t m_waiting[MAX_INPUTS] = {};
+    uint32_t m_waitingSequence[MAX_INPUTS] = {};
+    int m_waitingCount{0};
+    uint32_t m_sequence{0};
+    uint64_t m_simulated[MAX_INPUTS] = {};
+    int m_simulatedCount{0};
+    uint64_t m_swapped[MAX_INPUTS] = {};
+    int m_swappedCount{0};
+    double m_presented[MAX_INPUTS] = {};
+    int m_presentedCount{0};
+    Window m_swap;
+    Window m_gpu;
+};
+
+#endif
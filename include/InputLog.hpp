@@ -0,0 +1,131 @@
+/** @file InputLog.hpp
+ *  @brief Recording and replay of the player's input, one byte per step.
+ *
+ *  The simulation is deterministic given its seed and the input of
+ *  every fixed step, so that is all a log stores. Each step's input is
+ *  packed into a byte (jump, restart, debug invincibility, palette)
+ *  and the file run-length encodes them, since inputs rarely change
+ *  from one step to the next. A minute of play is typically a few
+ *  hundred bytes.
+ *
+ *  The live game and replays advance the state with the same
+ *  StepLoggedInput(), so a replay follows the recorded game exactly.
+ *
+ *  Saved logs also carry keyframes: the game as it was before every
+ *  KEYFRAME_INTERVAL-th step. Seek() restores the last keyframe at or
+ *  before a step and simulates the rest of the way, never more than an
+ *  interval, so a tool can jump anywhere in an hour-long run at once
+ *  rather than replaying it from the start. The keyframes are the
+ *  table of steps they sit at, searched by step, which is the seek
+ *  index. Logs without them, or written by a build with another
+ *  GameState layout, still load; BuildKeyframes() replays them once to
+ *  make their keyframes before seeking.
+ *
+ *  File layout (little endian):
+ *    "DLOG", uint32 version, uint64 seed, uint64 step count,
+ *    then runs of (uint8 input, LEB128 varint run length),
+ *    then "DKEY", uint32 interval, uint32 sizeof(GameState), uint64
+ *    keyframe count and per keyframe uint64 step, uint64 games played
+ *    and the GameState bytes. Readers that stop after the runs ignore
+ *    the keyframes.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef INPUTLOG_HPP
+#define INPUTLOG_HPP
+
+#include "GameState.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+// Bits of one step's input
+enum LoggedInputBits : uint8_t{
+    INPUT_JUMP          = 1 << 0,   // Jump key held
+    INPUT_RESTART       = 1 << 1,   // Start a new game before stepping
+    INPUT_INVINCIBLE    = 1 << 2,   // Debug mode, collisions off
+    INPUT_PALETTE_SHIFT = 3,        // Bits 3-5: palette index, 0-4
+    INPUT_PALETTE_MASK  = 7 << 3
+};
+
+inline uint8_t EncodeInput(bool jump, bool restart, bool invincible, int palette){
+    return (uint8_t)((jump ? INPUT_JUMP : 0) | (restart ? INPUT_RESTART : 0) |
+                     (invincible ? INPUT_INVINCIBLE : 0) |
+                     ((palette << INPUT_PALETTE_SHIFT) & INPUT_PALETTE_MASK));
+}
+
+inline int GetInputPalette(uint8_t input){
+    return (input & INPUT_PALETTE_MASK) >> INPUT_PALETTE_SHIFT;
+}
+
+// Advances state by one step with a logged input. A restart begins the
+// next game of seed; gamesPlayed counts them and picks its stream.
+// Returns the Step() events.
+unsigned int StepLoggedInput(GameState& state, uint8_t input, uint64_t seed, uint64_t& gamesPlayed);
+
+// The game of a log as it was before step, StepLoggedInput()'s
+// gamesPlayed included
+struct ReplayKeyframe{
+    uint64_t step{0};
+    uint64_t gamesPlayed{0};
+    GameState state;
+};
+
+class InputLog{
+public:
+    // Steps between two keyframes, a minute of play
+    static const size_t KEYFRAME_INTERVAL = 3600;
+
+    // Constructor
+    InputLog();
+    // Destructor
+    ~InputLog();
+    // Starts an empty log for a game seeded with seed
+    void Begin(uint64_t seed);
+    // Appends one step
+    inline void Record(uint8_t input){
+        m_inputs.push_back(input);
+    }
+    // Writes or reads the log file
+    bool Save(const std::string& filepath) const;
+    bool Load(const std::string& filepath);
+
+    inline uint64_t GetSeed() const{
+        return m_seed;
+    }
+    inline size_t GetStepCount() const{
+        return m_inputs.size();
+    }
+    inline uint8_t GetInput(size_t step) const{
+        return m_inputs[step];
+    }
+
+    // Replays the steps since the last keyframe and adds the keyframes
+    // they pass; nothing to do for a log loaded with all of its own.
+    // Save() does the same for what it writes.
+    void BuildKeyframes();
+    inline const std::vector<ReplayKeyframe>& GetKeyframes() const{
+        return m_keyframes;
+    }
+    // Puts state and gamesPlayed as they were before step (up to
+    // GetStepCount(), the end of the log), from the last keyframe at or
+    // before it. Returns the steps simulated to get there.
+    size_t Seek(size_t step, GameState& state, uint64_t& gamesPlayed) const;
+private:
+    // Adds to keyframes, which hold those of a prefix of the log, the ones
+    // of the rest of it
+    void AppendKeyframes(std::vector<ReplayKeyframe>& keyframes) const;
+    // Reads the keyframes after the runs, false if there are none or they
+    // do not fit this log
+    bool LoadKeyframes(std::istream& file, uint64_t stepCount);
+
+    uint64_t m_seed{1};
+    std::vector<uint8_t> m_inputs;
+    std::vector<ReplayKeyframe> m_keyframes;
+    size_t m_keyframeInterval{KEYFRAME_INTERVAL};
+};
+
+#endif
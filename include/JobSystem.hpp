@@ -0,0 +1,170 @@
+/** @file JobSystem.hpp
+ *  @brief The engine's shared worker threads: jobs, counters, GL queue.
+ *
+ *  One set of workers (one per hardware thread, less the main thread)
+ *  runs every job in the program. Each worker has a fixed ring of jobs;
+ *  a job submitted from a worker goes to the back of its own ring, one
+ *  from any other thread to a shared ring. A worker runs jobs from the
+ *  back of its own ring and, when that is empty, steals from the front
+ *  of the others, so related work stays on one core until another one
+ *  is idle. A full ring runs the job right away instead of queueing it.
+ *
+ *  A JobCounter counts the jobs submitted against it that did not
+ *  finish yet. Wait() runs other jobs until it drops to zero, so a job
+ *  may wait on the jobs it submitted without tying up its thread, and
+ *  SubmitAfter() holds a job back until a counter is done, which chains
+ *  jobs by their dependencies without anyone waiting. Hold() counts
+ *  work done outside the jobs, I/O the kernel completes, the same way.
+ *
+ *  Jobs must not touch GL. RunOnMainThread() queues work for the GL
+ *  thread instead, which RunMainThreadJobs() runs once per frame (and
+ *  Wait() whenever the main thread waits).
+ *
+ *  Start() can pin the workers to cores (see ThreadAffinity.hpp); the
+ *  main thread is thread 0 of the order and is pinned only with
+ *  pinCaller; either way the workers leave its core free unless there
+ *  are more threads than cores.
+ *
+ *  Jobs are std::function; keep captures to two pointers or so, which
+ *  the standard library stores without allocating.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef JOBSYSTEM_HPP
+#define JOBSYSTEM_HPP
+
+#include "ThreadAffinity.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+typedef std::function<void()> Job;
+
+class JobCounter{
+public:
+    // Constructor
+    JobCounter();
+    // Destructor
+    ~JobCounter();
+    // True once every job counted here finished
+    inline bool IsDone() const{
+        return m_pending.load(std::memory_order_acquire) == 0;
+    }
+private:
+    friend class JobSystem;
+    JobCounter(const JobCounter&) = delete;
+    JobCounter& operator=(const JobCounter&) = delete;
+
+    struct Continuation{
+        Job job;
+        JobCounter* counter;
+    };
+
+    std::atomic<int> m_pending{0};
+    // Guards the continuations and the last decrement
+    std::mutex m_mutex;
+    std::vector<Continuation> m_continuations;
+};
+
+class JobSystem{
+public:
+    // Jobs a ring holds
+    static const size_t RING_CAPACITY = 1024;
+
+    // The one job system
+    static JobSystem& Get();
+    // Starts the workers; threadCount includes the calling thread, which
+    // becomes the main thread, and 0 uses every hardware thread. Only the
+    // first call counts, and submitting a job makes that call with the
+    // defaults. affinity pins the threads to cores.
+    void Start(unsigned int threadCount = 0, const AffinityConfig& affinity = AffinityConfig());
+    // Runs the remaining jobs and joins the workers
+    void Stop();
+    // Worker threads plus the main thread
+    inline unsigned int GetThreadCount() const{
+        return (unsigned int)m_threads.size() + 1;
+    }
+
+    // Runs job on some worker; counter, if any, counts it until it is done
+    void Submit(Job job, JobCounter* counter = nullptr);
+    // Submits job once dependency is done
+    void SubmitAfter(JobCounter& dependency, Job job, JobCounter* counter = nullptr);
+    // Counts one piece of work that is not a job, a read in flight say,
+    // against counter until Release() is called for it; jobs submitted
+    // after counter wait for it as for a job
+    void Hold(JobCounter& counter);
+    void Release(JobCounter& counter);
+    // Runs other jobs until every job counted by counter is done
+    void Wait(JobCounter& counter);
+    // Calls task(begin, end) over [0, count) in pieces of at least grain
+    // items, the calling thread included, and returns once all are done
+    void ParallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& task);
+
+    // Queues job for the main thread, the only one that may call GL
+    void RunOnMainThread(Job job, JobCounter* counter = nullptr);
+    // Runs the jobs queued for the main thread so far; call from it.
+    // Returns how many ran.
+    size_t RunMainThreadJobs();
+    // True on the thread that called Start()
+    bool IsMainThread() const;
+private:
+    // Constructor
+    JobSystem();
+    // Destructor
+    ~JobSystem();
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    struct Entry{
+        Job job;
+        JobCounter* counter{nullptr};
+    };
+    // Fixed ring of jobs; the owner works at the back, thieves at the front
+    struct Ring{
+        std::mutex mutex;
+        Entry entries[RING_CAPACITY];
+        size_t front{0};
+        size_t count{0};
+    };
+
+    void WorkerMain(unsigned int index);
+    // Queues a job that is counted already
+    void Push(Job job, JobCounter* counter);
+    // Runs one job from the thread's own ring or another's; false if
+    // there was none
+    bool RunOne(unsigned int index);
+    bool Pop(unsigned int index, Entry& entry);
+    bool Steal(unsigned int thief, Entry& entry);
+    // Marks a job of counter finished and releases what waited on it
+    void Finish(JobCounter* counter);
+    // Ring of the calling thread
+    unsigned int GetRingIndex() const;
+
+    // Ring 0 takes the jobs of threads that are not workers
+    std::vector<std::unique_ptr<Ring>> m_rings;
+    std::vector<std::thread> m_threads;
+    AffinityConfig m_affinity;
+    // Core of thread i is m_cores[i % size], empty when nothing is pinned
+    std::vector<unsigned int> m_cores;
+    std::thread::id m_mainThread;
+    std::once_flag m_started;
+
+    std::mutex m_sleepMutex;
+    std::condition_variable m_wake;
+    // Jobs in the rings, so idle workers know when to look
+    std::atomic<size_t> m_queued{0};
+    bool m_stop{false};
+
+    std::mutex m_mainMutex;
+    std::vector<Entry> m_mainJobs;
+    std::vector<Entry> m_mainRunning;
+    bool m_runningMain{false};
+};
+
+#endif
@@ -0,0 +1,99 @@
+/** @file JumpTrajectory.hpp
+ *  @brief The dino's jump and obstacle timing in closed form.
+ *
+ *  Step() moves a jump by jumpingSpeed every step: the step the jump
+ *  starts in puts the dino at 1 + jumpingSpeed, it rises until it
+ *  reaches JUMP_APEX and then falls by the same amount each step until
+ *  it is back on the ground. Everything about that path, and about
+ *  when an obstacle approaching at a constant speed is within reach,
+ *  follows from a few divisions, so a planner can ask "when do I have
+ *  to jump?" in constant time instead of simulating ahead.
+ *
+ *  Steps are counted from now: step 1 is the next Step() call. Speeds
+ *  are per step, so for steps of n ticks pass them multiplied by n.
+ *  Answers hold while the speeds stay the same; a day change or an
+ *  obstacle spawn that re-rolls the speed needs a new query.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef JUMPTRAJECTORY_HPP
+#define JUMPTRAJECTORY_HPP
+
+#include <cstdint>
+
+// The path of one jump at a given jumping speed
+struct JumpProfile{
+    int speed = 0;
+    // Steps spent rising, the last one reaching the peak
+    int riseSteps = 0;
+    int peakHeight = 0;
+    // Steps spent falling, the last one landing
+    int fallSteps = 0;
+    // Height the dino is left at once it lands, 0 or just below
+    int landingHeight = 0;
+};
+
+// Jump steps t (t = 1 is the step the jump starts in) at which the dino is
+// above every obstacle, and whether there are any
+struct JumpHighSteps{
+    int first = 0;
+    int last = -1;
+};
+
+// Steps from now at which starting a jump clears an obstacle: any step
+// from earliest to latest. Empty when earliest > latest.
+struct JumpWindow{
+    int earliest = 1;
+    int latest = 0;
+};
+
+// A window that never runs out, for obstacles that are no threat
+const int ANY_JUMP_STEP = INT32_MAX;
+
+JumpProfile MakeJumpProfile(int jumpingSpeed);
+
+// Steps from starting a jump until another one can start
+inline int GetJumpDuration(const JumpProfile& jump){
+    return jump.riseSteps + jump.fallSteps;
+}
+
+// Dino height t steps into a jump: 0 before it starts, the landing height
+// after it ends
+int GetJumpHeight(const JumpProfile& jump, int t);
+
+// The jump step at which the dino is at height on its way up (rising) or
+// down, the inverse of GetJumpHeight() while in the air. Heights between
+// two steps give a fraction of a step.
+float GetJumpStep(const JumpProfile& jump, int height, bool rising);
+
+// Where a drawn jump is anchored: the step it left the ground at, on some
+// step clock, and its jumping speed, 0 before the first jump. The vertex
+// shader draws the arc from these alone (see instance_common.glsl).
+struct JumpAnchor{
+    float start = 0.0f;
+    int speed = 0;
+};
+
+// Re-anchors a jump after a step that left the dino at height, clock
+// being that step's. In the air the start is recomputed every step, so
+// a speed change halfway carries on from where the dino is; on the
+// ground the last jump is kept and drawn as landed.
+void UpdateJumpAnchor(JumpAnchor& anchor, int clock, int height, bool rising, int speed);
+
+// The jump steps at which the dino is above the obstacle hit range of
+// GetCollisionRules()
+JumpHighSteps GetJumpHighSteps(const JumpProfile& jump);
+
+// Steps until an obstacle at distance (its offset from the dino along
+// the lane, as GetLeadObstacle() gives it) moving speed per step first
+// reaches the hit range, 1 if it already has, or ANY_JUMP_STEP if it
+// never will
+int GetStepsToImpact(int distance, int speed);
+
+// The steps to start a jump at so the dino, standing on the ground now,
+// clears that obstacle. Conservative: the dino is above the hit range
+// the whole time the obstacle is within reach, so Step() can never hit
+// it, swept or not. Clear several obstacles by intersecting windows.
+JumpWindow FindJumpWindow(const JumpProfile& jump, int distance, int speed);
+
+#endif
@@ -0,0 +1,103 @@
+/** @file KTXFile.hpp
+ *  @brief Pre-compressed textures in KTX (version 1) containers.
+ *
+ *  A .ktx holds a texture exactly as glCompressedTexImage2D takes it:
+ *  the GL internal format, the size and the bytes of every mip level,
+ *  so nothing is decoded or generated at load time. Loading maps the file (through
+ *  FileView, so a packed .ktx is read in place) and hands out pointers
+ *  to the levels. Only block-compressed 2D textures are accepted:
+ *  BC1 (S3TC DXT1) and BC7 (BPTC) for desktop GPUs, ETC2 for the ARM
+ *  boards. Images are stored exactly as Image::LoadPPM(true) lays out
+ *  a PPM, which the game's texture coordinates expect: flipped upside
+ *  down, bottom row first and each row left to right.
+ *
+ *  tools/texconv.cpp writes BC1 files; BC7 and ETC2 files come from an
+ *  external encoder. A texture's variants sit next to its .ppm, named
+ *  <name>.bc7.ktx, <name>.bc1.ktx and <name>.etc2.ktx.
+ *
+ *  Layout (little endian): KTXHeader, bytesOfKeyValueData of key/value
+ *  pairs, then per level a uint32 image size and the image, padded
+ *  to 4 bytes.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef KTXFILE_HPP
+#define KTXFILE_HPP
+
+#include "FileView.hpp"
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// On-disk header of a KTX 1.1 file
+struct KTXHeader{
+    uint8_t identifier[12];         // "«KTX 11»\r\n\x1A\n"
+    uint32_t endianness;            // 0x04030201
+    uint32_t glType;                // 0 for compressed data
+    uint32_t glTypeSize;            // 1 for compressed data
+    uint32_t glFormat;              // 0 for compressed data
+    uint32_t glInternalFormat;      // e.g. GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+    uint32_t glBaseInternalFormat;  // GL_RGB or GL_RGBA
+    uint32_t pixelWidth;
+    uint32_t pixelHeight;
+    uint32_t pixelDepth;            // 0 for 2D textures
+    uint32_t numberOfArrayElements; // 0 if not an array
+    uint32_t numberOfFaces;         // 1 if not a cube map
+    uint32_t numberOfMipmapLevels;
+    uint32_t bytesOfKeyValueData;
+};
+
+class KTXFile{
+public:
+    // Constructor
+    KTXFile();
+    // Maps a .ktx, returns false if it is missing or not a supported
+    // block-compressed 2D texture
+    bool Load(const std::string& filepath);
+    inline GLenum GetInternalFormat() const{
+        return m_header.glInternalFormat;
+    }
+    inline int GetWidth() const{
+        return (int)m_header.pixelWidth;
+    }
+    inline int GetHeight() const{
+        return (int)m_header.pixelHeight;
+    }
+    inline int GetLevelCount() const{
+        return (int)m_levels.size();
+    }
+    // Compressed bytes of a level, valid while the KTXFile is alive
+    inline const char* GetLevelData(int level) const{
+        return m_levels[level];
+    }
+    inline size_t GetLevelSize(int level) const{
+        return m_levelSizes[level];
+    }
+    // Bytes of one 4x4 block of a compressed format, 0 if unsupported
+    static size_t GetBlockBytes(GLenum internalFormat);
+    // Bytes of a width x height image in a block format
+    static size_t GetImageBytes(GLenum internalFormat, int width, int height);
+    // Levels of a mip chain from width x height down to 1x1
+    static int GetFullLevelCount(int width, int height);
+    // First of levelCount levels worth loading for a texture that covers
+    // at most footprintWidth x footprintHeight pixels on screen: the
+    // smallest level still at least that large, the larger ones are never
+    // sampled
+    static int GetBaseLevel(int width, int height, int levelCount, int footprintWidth, int footprintHeight);
+    // Path of a compressed variant of an image, e.g. bg.ppm -> bg.bc1.ktx
+    static std::string VariantPathFor(const std::string& imagePath, const std::string& suffix);
+    // Writes a block-compressed texture with one image per level
+    static bool Write(const std::string& filepath, GLenum internalFormat, GLenum baseFormat,
+                      int width, int height, const std::vector<std::vector<uint8_t>>& levels);
+private:
+    FileView m_file;
+    KTXHeader m_header;
+    std::vector<const char*> m_levels;
+    std::vector<size_t> m_levelSizes;
+};
+
+#endif
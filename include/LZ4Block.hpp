@@ -0,0 +1,29 @@
+/** @file LZ4Block.hpp
+ *  @brief Compression of independent blocks in the LZ4 block format.
+ *
+ *  The asset pack stores its large files as blocks of this format, each
+ *  decoded on its own, so the blocks of one file decompress in parallel.
+ *  The format is LZ4's: sequences of a token, literals and a two-byte
+ *  back reference, which decode with nothing but copies, at gigabytes
+ *  per second a core. The compressor spends its time on the packer's
+ *  side instead, searching a hash chain over the block for the longest
+ *  match rather than taking the first one, as LZ4's high compression
+ *  mode does; the blocks it writes are plain LZ4 blocks that any LZ4
+ *  decoder reads.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef LZ4BLOCK_HPP
+#define LZ4BLOCK_HPP
+
+#include <cstddef>
+#include <vector>
+
+// Appends the compressed size bytes of source to out, returns the bytes
+// appended. Blocks above 64 KB only find matches within the last 64 KB.
+size_t LZ4CompressBlock(const char* source, size_t size, std::vector<char>& out);
+// Decodes a whole block into the size bytes at destination; false if it
+// is corrupt or does not decode to exactly size bytes
+bool LZ4DecompressBlock(const char* source, size_t sourceBytes, char* destination, size_t size);
+
+#endif
@@ -0,0 +1,60 @@
+/** @file LatencyLimiter.hpp
+ *  @brief At most one frame queued behind the one being built.
+ *
+ *  A driver may queue several frames ahead of the GPU, and every frame
+ *  in the queue is input sampled that much earlier than it shows up.
+ *  EndFrame() fences the frame just swapped, and WaitForGPU() blocks
+ *  on that fence before the next frame samples its input, so the game
+ *  never runs more than one frame ahead of the display.
+ *
+ *  It also remembers how long recent frames took from sampling input
+ *  to returning from the swap. A frame limiter can then sleep before
+ *  input instead of after the swap and sample input only
+ *  GetPredictedCost() before the frame is due, which leaves input as
+ *  fresh as the frame's own cost allows.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef LATENCYLIMITER_HPP
+#define LATENCYLIMITER_HPP
+
+#include <glad/glad.h>
+
+class LatencyLimiter{
+public:
+    // Frames whose cost the prediction looks back on
+    static constexpr int COST_HISTORY = 32;
+
+    // Constructor
+    LatencyLimiter();
+    // Destructor
+    // Note: Call Release() while the GL context is alive.
+    ~LatencyLimiter();
+    // Blocks until the GPU is done with the frame fenced last. Returns the
+    // milliseconds spent waiting.
+    double WaitForGPU();
+    // Fences the frame just swapped; costMilliseconds is how long it took
+    // from sampling input to the end of the swap
+    void EndFrame(double costMilliseconds);
+    // How long a frame can be expected to take, in milliseconds: the
+    // slowest of the recent ones, plus a margin
+    double GetPredictedCost() const;
+    // Waits that found the GPU still busy, and their total milliseconds
+    inline unsigned long GetWaitCount() const{
+        return m_waits;
+    }
+    inline double GetWaitMilliseconds() const{
+        return m_waitMilliseconds;
+    }
+    // Deletes the pending fence
+    void Release();
+private:
+    GLsync m_fence{nullptr};
+    double m_costs[COST_HISTORY] = {};
+    int m_nextCost{0};
+    int m_costCount{0};
+    unsigned long m_waits{0};
+    double m_waitMilliseconds{0.0};
+};
+
+#endif
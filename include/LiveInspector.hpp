@@ -0,0 +1,131 @@
+/** @file LiveInspector.hpp
+ *  @brief The game's state and performance counters in a shared memory
+ *  block that other processes read while it runs, --inspect[=<name>].
+ *
+ *  A debugger stops the game to show a global, which ruins the timing
+ *  it was attached for. Instead the game copies an InspectorState, plain
+ *  data of a fixed layout, into a POSIX shared memory object once a
+ *  frame: the game state, the frame count and time, the rolling mean of
+ *  every CPU zone and GPU pass, the live GL objects per category, the
+ *  last frame's heap allocations and the run statistics.
+ *  tools/dinoinspect.cpp attaches and shows it.
+ *
+ *  The block is guarded by a sequence lock. Publish() makes the
+ *  sequence odd, copies the state and makes it even again; a reader
+ *  copies the state out between two reads of the sequence and keeps the
+ *  copy only if both read the same even number. The writer never waits
+ *  for a reader and no system call is made per frame, so a reader costs
+ *  the game nothing but the copy; readers only ever map the block read
+ *  only.
+ *
+ *  Layout: an InspectorHeader, then the InspectorState at stateOffset.
+ *  Readers check magic, version and stateSize before using it.
+ *
+ *  Only implemented on Linux; elsewhere Create() and Open() fail.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef LIVEINSPECTOR_HPP
+#define LIVEINSPECTOR_HPP
+
+#include "GameState.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// "DINS"
+const uint32_t INSPECTOR_MAGIC = 0x534e4944;
+const uint32_t INSPECTOR_VERSION = 1;
+const int INSPECTOR_MAX_ZONES = 32;
+const int INSPECTOR_MAX_PASSES = 16;
+const int INSPECTOR_MAX_RESOURCES = 8;
+
+// The rolling mean of a CPU zone or GPU pass
+struct InspectorTiming{
+    char name[28];
+    // Negative while it has no samples
+    float meanMilliseconds;
+};
+
+// The live GL objects of a category
+struct InspectorResource{
+    char name[16];
+    uint64_t count;
+    uint64_t bytes;
+};
+
+struct InspectorState{
+    // Frames drawn, and seconds since startup
+    uint64_t frame;
+    double seconds;
+    // The last frame, and the rolling mean of the frame zone
+    double frameMilliseconds;
+    double meanFrameMilliseconds;
+    // The game being played, as the frame loop last saw it
+    GameState game;
+    uint64_t seed;
+    uint64_t gamesPlayed;
+    uint32_t paused;
+    uint32_t zoneCount;
+    uint32_t passCount;
+    uint32_t resourceCount;
+    InspectorTiming zones[INSPECTOR_MAX_ZONES];
+    InspectorTiming passes[INSPECTOR_MAX_PASSES];
+    InspectorResource resources[INSPECTOR_MAX_RESOURCES];
+    // Heap allocations of the last frame
+    uint64_t frameAllocations;
+    uint64_t frameAllocatedBytes;
+    // Run statistics, see Telemetry.hpp
+    uint64_t episodes;
+    uint64_t steps;
+    uint64_t bestScore;
+};
+
+struct InspectorHeader{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t stateSize;
+    uint32_t stateOffset;
+    // Odd while Publish() is copying; on a cache line of its own
+    alignas(64) uint64_t sequence;
+};
+
+class LiveInspector{
+public:
+    // Constructor
+    LiveInspector();
+    // Destructor, unmaps the block and, for the game, removes it
+    ~LiveInspector();
+    LiveInspector(const LiveInspector&) = delete;
+    LiveInspector& operator=(const LiveInspector&) = delete;
+
+    // The game's side: creates the block called name ("/dino-inspect")
+    bool Create(const std::string& name);
+    // An inspector's side: maps the block read only
+    bool Open(const std::string& name);
+    void Release();
+    inline bool IsOpen() const{
+        return m_header != nullptr;
+    }
+    // The game's state to publish; fill it in, then Publish()
+    inline InspectorState& GetState(){
+        return m_state;
+    }
+    // Copies the state into the block
+    void Publish();
+    // Copies a consistent state out of the block, false if the game kept
+    // publishing through every attempt
+    bool Read(InspectorState& state) const;
+    // Publish() calls so far, as the reader last saw them
+    uint64_t GetSequence() const;
+private:
+    InspectorHeader* m_header{nullptr};
+    InspectorState* m_shared{nullptr};
+    size_t m_size{0};
+    std::string m_name;
+    bool m_owner{false};
+    InspectorState m_state{};
+};
+
+#endif
@@ -0,0 +1,117 @@
+/** @file Logger.hpp
+ *  @brief Levelled console messages written by a thread of their own.
+ *
+ *  LOG_INFO("Restarted game") and the like format the message straight
+ *  into a slot of a fixed-size lock-free queue (bounded, multiple
+ *  producers, one consumer) and return; a writer thread drains the
+ *  queue to stdout and flushes it, so a slow terminal or a redirected
+ *  log never holds up the thread that logged. Formatting allocates
+ *  nothing; messages longer than LOG_MESSAGE_BYTES are cut short, and
+ *  when the queue is full they are dropped and counted rather than
+ *  waited for.
+ *
+ *  Messages below LOG_LEVEL are compiled out entirely, arguments and
+ *  all: build with -D LOG_LEVEL=LOG_LEVEL_DEBUG to see the debug ones,
+ *  or LOG_LEVEL_WARNING for a quiet kiosk build. Everything else the
+ *  program prints goes through std::cout, which shares stdout's
+ *  buffer; call Logger::Get().Flush() before printing something that
+ *  has to come after the queued messages.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef LOGGER_HPP
+#define LOGGER_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+#define LOG_LEVEL_DEBUG   0
+#define LOG_LEVEL_INFO    1
+#define LOG_LEVEL_WARNING 2
+#define LOG_LEVEL_ERROR   3
+#define LOG_LEVEL_NONE    4
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+#if defined(__GNUC__)
+#define LOG_PRINTF_FORMAT(formatIndex, firstIndex) __attribute__((format(printf, formatIndex, firstIndex)))
+#else
+#define LOG_PRINTF_FORMAT(formatIndex, firstIndex)
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) Logger::Get().Write(__VA_ARGS__)
+#else
+#define LOG_DEBUG(...) ((void)0)
+#endif
+#if LOG_LEVEL <= LOG_LEVEL_INFO
+#define LOG_INFO(...) Logger::Get().Write(__VA_ARGS__)
+#else
+#define LOG_INFO(...) ((void)0)
+#endif
+#if LOG_LEVEL <= LOG_LEVEL_WARNING
+#define LOG_WARNING(...) Logger::Get().Write(__VA_ARGS__)
+#else
+#define LOG_WARNING(...) ((void)0)
+#endif
+#if LOG_LEVEL <= LOG_LEVEL_ERROR
+#define LOG_ERROR(...) Logger::Get().Write(__VA_ARGS__)
+#else
+#define LOG_ERROR(...) ((void)0)
+#endif
+
+// Messages the queue holds, a power of two
+const size_t LOG_QUEUE_SLOTS = 1024;
+// Longest message kept, the end of line included
+const size_t LOG_MESSAGE_BYTES = 244;
+// How often the writer looks at the queue
+const int LOG_WRITE_MILLISECONDS = 10;
+
+class Logger{
+public:
+    // The logger of the whole process; the writer starts with it
+    static Logger& Get();
+
+    // Queues one printf-style line; a newline is added. Use the LOG_*
+    // macros, the level only decides whether the call is compiled in.
+    void Write(const char* format, ...) LOG_PRINTF_FORMAT(2, 3);
+    // Returns once every message queued before the call is written
+    void Flush();
+    inline uint64_t GetDroppedCount() const{
+        return m_dropped.load(std::memory_order_relaxed);
+    }
+private:
+    // Constructor
+    Logger();
+    // Destructor
+    // Note: Writes what is still queued.
+    ~Logger();
+
+    struct Slot{
+        // Tells producers and the consumer whose turn the slot is
+        std::atomic<uint64_t> sequence;
+        uint32_t length;
+        char text[LOG_MESSAGE_BYTES];
+    };
+    // Writes out everything queued so far, returns false if nothing was
+    bool Drain();
+    void WriterThread();
+
+    alignas(64) Slot m_slots[LOG_QUEUE_SLOTS];
+    alignas(64) std::atomic<uint64_t> m_enqueue{0};
+    alignas(64) std::atomic<uint64_t> m_dequeue{0};
+    std::atomic<uint64_t> m_dropped{0};
+
+    std::thread m_thread;
+    std::mutex m_wakeMutex;
+    std::condition_variable m_wake;
+    bool m_stop{false};
+};
+
+#endif
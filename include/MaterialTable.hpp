@@ -0,0 +1,69 @@
+/** @file MaterialTable.hpp
+ *  @brief The materials of every loaded mesh, each stored once.
+ *
+ *  A Material is what an .mtl newmtl block says about a surface that
+ *  the renderer can use: the diffuse colour, the opacity and the
+ *  diffuse texture. Loaders add the materials their meshes use and
+ *  refer to them by MaterialId. Adding a material equal to one already
+ *  in the table returns the existing id, so two meshes that share a
+ *  material (the two dino frames share most of theirs) share its id,
+ *  and draws can be grouped by comparing ids.
+ *
+ *  The table belongs to the whole process and takes a lock, so meshes
+ *  can be loaded on any number of threads at once. Ids are never
+ *  reused; materials stay in the table until the process ends.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef MATERIALTABLE_HPP
+#define MATERIALTABLE_HPP
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// Stable index of a material in the table
+typedef uint32_t MaterialId;
+
+// Faces before any usemtl, or a mesh without materials
+const MaterialId NO_MATERIAL = 0xFFFFFFFFu;
+
+struct Material{
+    // Name from newmtl; equal names from different files may differ
+    std::string name;
+    // Kd, white when not given
+    float diffuse[3] = {1.0f, 1.0f, 1.0f};
+    // d (or 1 - Tr), 1 when not given
+    float opacity{1.0f};
+    // map_Kd resolved against the .mtl's directory, empty if none
+    std::string diffuseMap;
+};
+
+class MaterialTable{
+public:
+    // The table of the whole process
+    static MaterialTable& Get();
+    // Returns the id of a material equal to this one, adding it first
+    // if there is none
+    MaterialId Add(const Material& material);
+    // A copy of a material; the default Material for NO_MATERIAL or an
+    // unknown id
+    Material GetMaterial(MaterialId id) const;
+    // Materials in the table
+    size_t GetCount() const;
+private:
+    // Constructor
+    MaterialTable();
+    // Destructor
+    ~MaterialTable();
+
+    mutable std::mutex m_mutex;
+    // Indexed by MaterialId
+    std::deque<Material> m_materials;
+    // Every field of a material, printed -> its id
+    std::unordered_map<std::string, MaterialId> m_lookup;
+};
+
+#endif
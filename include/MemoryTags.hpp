@@ -0,0 +1,92 @@
+/** @file MemoryTags.hpp
+ *  @brief CPU memory by the subsystem that owns it, current and peak.
+ *
+ *  Every tag has a byte counter and its high-water mark. Owners report
+ *  what they hold: containers through TaggedAllocator (TaggedVector),
+ *  which counts what it allocates and frees, and code with memory of its
+ *  own (image pixels, file mappings, huge page columns, the frame arena)
+ *  through MemoryTags::Add() and Remove() with the same sizes. Counters
+ *  are relaxed atomics, so any thread may report at any time.
+ *
+ *  The tags only see what is reported to them; everything else (the
+ *  heap of SDL and the driver, untagged containers) is in neither. The
+ *  peak of a tag is its own, so the tags' peaks need not add up to the
+ *  peak of the whole. Mapped files count their whole size, resident or
+ *  not.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef MEMORYTAGS_HPP
+#define MEMORYTAGS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+enum MemoryTag{
+    MEMORY_ASSETS,      // Mapped asset files and packs
+    MEMORY_MESHES,      // Parsed and converted mesh data
+    MEMORY_IMAGES,      // Decoded texture pixels
+    MEMORY_SIM,         // Simulation batches
+    MEMORY_RENDER,      // Per-frame render scratch
+    MEMORY_TELEMETRY,   // Traces, flight recorder and gameplay logs
+    MEMORY_TAGS
+};
+
+class MemoryTags{
+public:
+    // bytes more, or fewer, are held under tag
+    static void Add(MemoryTag tag, size_t bytes);
+    static void Remove(MemoryTag tag, size_t bytes);
+    // Bytes held under tag now, and the most it held at once
+    static size_t GetCurrent(MemoryTag tag);
+    static size_t GetPeak(MemoryTag tag);
+    // Lowercase name of a tag, "meshes" and so on
+    static const char* GetName(MemoryTag tag);
+    // Prints the current and peak bytes of every tag
+    static void Report();
+};
+
+// Standard allocator counting its memory under TAG
+template<typename T, MemoryTag TAG>
+class TaggedAllocator{
+public:
+    typedef T value_type;
+    template<typename U>
+    struct rebind{
+        typedef TaggedAllocator<U, TAG> other;
+    };
+
+    // Constructor
+    TaggedAllocator() = default;
+    template<typename U>
+    TaggedAllocator(const TaggedAllocator<U, TAG>&){
+
+    }
+
+    T* allocate(size_t count){
+        T* memory = static_cast<T*>(::operator new(count * sizeof(T)));
+        MemoryTags::Add(TAG, count * sizeof(T));
+        return memory;
+    }
+    void deallocate(T* memory, size_t count){
+        MemoryTags::Remove(TAG, count * sizeof(T));
+        ::operator delete(memory);
+    }
+};
+
+template<typename T, typename U, MemoryTag TAG>
+inline bool operator==(const TaggedAllocator<T, TAG>&, const TaggedAllocator<U, TAG>&){
+    return true;
+}
+template<typename T, typename U, MemoryTag TAG>
+inline bool operator!=(const TaggedAllocator<T, TAG>&, const TaggedAllocator<U, TAG>&){
+    return false;
+}
+
+// A vector whose storage counts under TAG
+template<typename T, MemoryTag TAG>
+using TaggedVector = std::vector<T, TaggedAllocator<T, TAG>>;
+
+#endif
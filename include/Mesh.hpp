@@ -0,0 +1,58 @@
+/** @file Mesh.hpp
+ *  @brief A mesh's CPU-side data, owned by exactly one place at a time.
+ *
+ *  Mesh holds what a model contributes to the scene arena before it is
+ *  uploaded: the unique interleaved vertices (x,y,z,nx,ny,nz,u,v), the
+ *  triangle indices of every level of detail, the bounds and the
+ *  diffuse texture. The positions of the vertices are also kept alone,
+ *  for the CPU passes that need nothing else, like baking the collision
+ *  silhouettes. It can be moved but not copied, so passing one by
+ *  value where a reference was meant fails to compile instead of
+ *  quietly copying every vertex. A copy that is really wanted is
+ *  spelled Clone(). Once uploaded, a mesh is referred to by its
+ *  MeshHandle in the MeshRegistry.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef MESH_HPP
+#define MESH_HPP
+
+#include "AABB.hpp"
+#include "MeshSimplifier.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class Mesh{
+public:
+    // Constructor
+    Mesh() = default;
+    Mesh(Mesh&&) = default;
+    Mesh& operator=(Mesh&&) = default;
+    Mesh(const Mesh&) = delete;
+    Mesh& operator=(const Mesh&) = delete;
+    // A deep copy of every array
+    inline Mesh Clone() const{
+        Mesh copy;
+        copy.vertices = vertices;
+        copy.positions = positions;
+        copy.indices = indices;
+        copy.lods = lods;
+        copy.bounds = bounds;
+        copy.texture = texture;
+        return copy;
+    }
+
+    std::vector<float> vertices;
+    // x,y,z of every vertex, see ExtractPositions()
+    std::vector<float> positions;
+    // Every level of detail, the full mesh first, see MeshFile.hpp
+    std::vector<uint32_t> indices;
+    std::vector<MeshLod> lods;
+    AABB bounds;
+    // Diffuse texture from the material, empty if none
+    std::string texture;
+};
+
+#endif
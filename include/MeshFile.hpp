@@ -0,0 +1,143 @@
+/** @file MeshFile.hpp
+ *  @brief Precompiled binary mesh format (.dmesh).
+ *
+ *  A .dmesh stores the deduplicated, interleaved vertex stream
+ *  (x,y,z,nx,ny,nz,u,v) and the 32-bit triangle indices that the
+ *  renderer uploads, together with the mesh bounds and the path of
+ *  its diffuse texture. Loading maps the file once and hands pointers
+ *  straight to glBufferData, so no text is parsed at runtime. Files
+ *  are written little-endian.
+ *
+ *  The indices hold every level of detail of the mesh one after the
+ *  other, the full mesh first, all over the same vertex stream. The
+ *  simplified levels are built when the file is written (see
+ *  MeshSimplifier.hpp), and the LOD table says where each one starts
+ *  and how far it strays from the full mesh. Each level's triangles are
+ *  then ordered for the post-transform cache and overdraw, and the
+ *  vertices for fetch locality (see MeshOptimizer.hpp), so drawing the
+ *  file as stored is already the cheap order.
+ *
+ *  Layout:
+ *      DMeshHeader
+ *      material path (materialLength bytes, padded to 4)
+ *      lodCount MeshLod entries
+ *      vertexCount * floatsPerVertex floats
+ *      indexCount uint32 indices
+ *
+ *  @bug No known bugs.
+ */
+#ifndef MESHFILE_HPP
+#define MESHFILE_HPP
+
+#include "AABB.hpp"
+#include "FileView.hpp"
+#include "MeshSimplifier.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class ObjLoader;
+struct ObjStreamResult;
+
+// On-disk header of a .dmesh file
+struct DMeshHeader{
+    char magic[4];              // "DMSH"
+    uint32_t version;           // DMESH_VERSION
+    uint32_t vertexCount;       // Number of vertices in the stream
+    uint32_t floatsPerVertex;   // Floats per interleaved vertex
+    float boundsMin[3];         // Smallest x,y,z of the mesh
+    float boundsMax[3];         // Largest x,y,z of the mesh
+    uint32_t materialLength;    // Bytes of the material path that follows
+    uint32_t indexCount;        // Number of triangle indices, every LOD
+    uint32_t lodCount;          // Entries of the LOD table, at least 1
+};
+
+// Average cache miss ratio of the full mesh before and after the
+// conversion reordered it (see GetACMR())
+struct DMeshStatistics{
+    float acmrBefore;
+    float acmrAfter;
+};
+
+const uint32_t DMESH_VERSION = 3;
+const uint32_t DMESH_FLOATS_PER_VERTEX = 8;
+
+class MeshFile{
+public:
+    // Constructor
+    MeshFile();
+    // Maps a .dmesh file, returns false if it is missing or invalid
+    bool Load(const std::string& filepath);
+    // Interleaved vertex floats, valid while the MeshFile is alive
+    inline const float* GetVertexData() const{
+        return m_vertexData;
+    }
+    // Number of floats in GetVertexData()
+    inline size_t GetFloatCount() const{
+        return (size_t)m_header.vertexCount * m_header.floatsPerVertex;
+    }
+    // Number of vertices in the stream
+    inline uint32_t GetVertexCount() const{
+        return m_header.vertexCount;
+    }
+    // Triangle indices into the vertex stream
+    inline const uint32_t* GetIndexData() const{
+        return m_indexData;
+    }
+    // Number of indices in GetIndexData()
+    inline uint32_t GetIndexCount() const{
+        return m_header.indexCount;
+    }
+    // Levels of detail, the full mesh first
+    inline const MeshLod* GetLods() const{
+        return m_lods;
+    }
+    inline uint32_t GetLodCount() const{
+        return m_header.lodCount;
+    }
+    // Header fields, including the bounds
+    inline const DMeshHeader& GetHeader() const{
+        return m_header;
+    }
+    // Bounds of the mesh
+    inline AABB GetBounds() const{
+        AABB bounds;
+        for(int axis = 0; axis < 3; ++axis){
+            bounds.min[axis] = m_header.boundsMin[axis];
+            bounds.max[axis] = m_header.boundsMax[axis];
+        }
+        return bounds;
+    }
+    // Path of the diffuse texture, if any
+    inline const std::string& GetMaterial() const{
+        return m_material;
+    }
+
+    // Builds the interleaved stream the renderer expects from an OBJ
+    static std::vector<float> Interleave(const ObjLoader& loader);
+    // The bytes of a .dmesh converted from an OBJ, and optionally how
+    // much the conversion's reordering gained
+    static std::vector<char> EncodeFromObj(const ObjLoader& loader, DMeshStatistics* statistics = nullptr);
+    // Writes a .dmesh converted from an OBJ, returns false on I/O failure
+    static bool WriteFromObj(const ObjLoader& loader, const std::string& filepath,
+                             DMeshStatistics* statistics = nullptr);
+    // Writes a .dmesh straight from the OBJ at objPath in bounded memory
+    // (see StreamObj() in ObjLoader.hpp), for meshes too large to load:
+    // the full mesh only, as imported, without levels of detail or the
+    // reordering, which need all of it at once. result, if given, says
+    // what the import saw. Returns false if the import or a write failed.
+    static bool WriteFromObjStream(const std::string& objPath, const std::string& filepath,
+                                   size_t cacheEntries, ObjStreamResult* result = nullptr);
+    // Returns path with its extension replaced by .dmesh
+    static std::string DMeshPathFor(const std::string& objPath);
+private:
+    FileView m_file;
+    DMeshHeader m_header;
+    std::string m_material;
+    const float* m_vertexData{nullptr};
+    const uint32_t* m_indexData{nullptr};
+    const MeshLod* m_lods{nullptr};
+};
+
+#endif
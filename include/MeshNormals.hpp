@@ -0,0 +1,44 @@
+/** @file MeshNormals.hpp
+ *  @brief Normals and tangents for meshes that come without them.
+ *
+ *  Both work on a structure of arrays, one float array per component,
+ *  so SSE on x86-64 or NEON on AArch64 takes four triangles or vectors
+ *  per instruction; the remainder, and other targets, go one at a time.
+ *
+ *  CrossEdges() gives the normal of a triangle from two of its edges,
+ *  unnormalized so its length is twice the triangle's area: summing
+ *  those of the triangles around a corner weights each by its area,
+ *  which is what a smooth normal is made of. NormalizeVectors() then
+ *  scales the sums, or a flat triangle's own normal, to unit length.
+ *
+ *  GenerateTangents() does the same for the interleaved stream of
+ *  ObjLoader::getIndexedMesh(): every triangle's tangent follows its u
+ *  texture direction, summed per vertex by area, made orthogonal to the
+ *  vertex normal and given the handedness of the bitangent in w, the
+ *  layout normal mapping shaders take.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef MESHNORMALS_HPP
+#define MESHNORMALS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// n = a x b for count vector pairs
+void CrossEdges(const float* ax, const float* ay, const float* az,
+                const float* bx, const float* by, const float* bz, size_t count,
+                float* nx, float* ny, float* nz);
+// Scales count vectors to unit length in place; a vector too short to
+// have a direction (a degenerate triangle, or nothing summed) becomes +y
+void NormalizeVectors(float* x, float* y, float* z, size_t count);
+// True for a normal a shader can use: finite and not close to zero
+bool IsUsableNormal(float x, float y, float z);
+
+// Tangents (x, y, z, handedness) of every vertex of an interleaved
+// stream of (x,y,z,nx,ny,nz,u,v) vertices and its triangle indices
+void GenerateTangents(const std::vector<float>& stream, const std::vector<uint32_t>& indices,
+                      std::vector<float>& tangents);
+
+#endif
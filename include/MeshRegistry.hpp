@@ -0,0 +1,150 @@
+/** @file MeshRegistry.hpp
+ *  @brief Owns every VAO/VBO/EBO used by the renderer.
+ *
+ *  GPU mesh objects are created exactly once and handed out as
+ *  small integer handles. The frame loop only binds (and, where the
+ *  data really changes, re-fills) existing objects, it never creates
+ *  new ones. Meshes are indexed; indices are stored as 16-bit when
+ *  the vertex count allows it and 32-bit otherwise. Vertices are
+ *  converted to the PackedVertex layout (VertexFormat.hpp) on upload.
+ *  A mesh may also carry a per-instance buffer so that many copies
+ *  of it are drawn with a single instanced draw call. Buffers are
+ *  edited through GLBackend, so an edit never disturbs the bound VAO.
+ *
+ *  Meshes do not have vertex arrays of their own. There is one per
+ *  vertex format, PackedVertex alone and PackedVertex with InstanceData,
+ *  shared by every mesh of that format, so switching meshes never
+ *  switches the VAO: Bind() only attaches the mesh's buffers to the
+ *  shared one, and skips whatever is attached already. With direct
+ *  state access (vertex attrib binding) the attribute format is set
+ *  once and attaching is one call per buffer; without it the attribute
+ *  pointers of the shared VAO are re-pointed at the mesh.
+ *
+ *  Vertex arrays are not shared between GL contexts, buffers are. A
+ *  registry of another context in the share group (a render worker's)
+ *  Adopt()s the meshes it draws: it attaches the owner's buffers to its
+ *  own vertex arrays and never edits or deletes them.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef MESHREGISTRY_HPP
+#define MESHREGISTRY_HPP
+
+#include "VertexFormat.hpp"
+
+#include <glad/glad.h>
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+// Stable handle to a mesh owned by the registry.
+typedef unsigned int MeshHandle;
+
+// Returned when a mesh could not be created
+const MeshHandle INVALID_MESH = 0xFFFFFFFFu;
+
+class MeshRegistry{
+public:
+    // Constructor
+    MeshRegistry();
+    // Destructor
+    // Note: GL objects must be freed with Release() while the
+    //       context is still alive, the destructor does not touch GL.
+    ~MeshRegistry();
+    // Creates a VBO/EBO for interleaved x,y,z,nx,ny,nz,u,v data and
+    // triangle indices, and returns a handle to it.
+    MeshHandle Create(const std::vector<GLfloat>& vertexData, const std::vector<uint32_t>& indexData,
+                      GLenum usage=GL_STATIC_DRAW);
+    // Same as above for data that is not in a vector (e.g. a mapped .dmesh)
+    MeshHandle Create(const GLfloat* vertexData, size_t floatCount,
+                      const uint32_t* indexData, size_t indexCount,
+                      GLenum usage=GL_STATIC_DRAW);
+    // Re-fills the buffers of an existing mesh. Buffer storage is
+    // only reallocated if the new data does not fit.
+    void Update(MeshHandle handle, const std::vector<GLfloat>& vertexData, const std::vector<uint32_t>& indexData);
+    // Re-fills only the vertex buffer, the indices stay as they are
+    void UpdateVertices(MeshHandle handle, const std::vector<GLfloat>& vertexData);
+    // Re-fills vertexCount vertices starting at firstVertex, leaving the
+    // rest of the mesh alone. The range must lie inside the mesh.
+    void UpdateVertexRange(MeshHandle handle, size_t firstVertex, const GLfloat* vertexData, size_t vertexCount);
+    // Attaches a per-instance attribute buffer (InstanceData) to a mesh,
+    // with room for maxInstances instances. Instances are drawn with
+    // glDrawElementsInstanced*.
+    void EnableInstancing(MeshHandle handle, size_t maxInstances);
+    // Re-fills the instance buffer of a mesh, growing it if needed
+    void UpdateInstances(MeshHandle handle, const InstanceData* instances, size_t instanceCount);
+    // Number of instances stored by the last UpdateInstances()
+    GLsizei GetInstanceCount(MeshHandle handle) const;
+    // Points the instance attributes of a mesh at instances stored in
+    // another buffer (e.g. a RingBuffer) at byteOffset. Takes effect
+    // right away if the mesh is bound, and at its next Bind() otherwise.
+    void BindInstanceBuffer(MeshHandle handle, GLuint buffer, size_t byteOffset);
+    // Makes a mesh of owner, a registry of a context sharing this one's
+    // objects, drawable here. The buffers stay owner's, who must keep
+    // them alive while this registry draws them.
+    MeshHandle Adopt(const MeshRegistry& owner, MeshHandle handle);
+    // Binds the shared vertex array of the mesh's format with the mesh's
+    // vertex, index and instance buffers attached
+    void Bind(MeshHandle handle);
+    // Number of vertices stored in the mesh
+    GLsizei GetVertexCount(MeshHandle handle) const;
+    // Number of indices to pass to glDrawElements
+    GLsizei GetIndexCount(MeshHandle handle) const;
+    // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+    GLenum GetIndexType(MeshHandle handle) const;
+    // Number of meshes currently alive
+    size_t GetMeshCount() const;
+    // Deletes every GL object owned by the registry
+    void Release();
+private:
+    struct GPUMesh{
+        GLuint vbo{0};              // Vertex buffer object
+        GLuint ebo{0};              // Element (index) buffer object
+        GLsizei vertexCount{0};     // Vertices currently stored
+        GLsizei indexCount{0};      // Indices currently stored
+        GLenum indexType{GL_UNSIGNED_SHORT};
+        size_t vertexCapacity{0};   // Size of the vertex storage in bytes
+        size_t indexCapacity{0};    // Size of the index storage in bytes
+        GLenum usage{GL_STATIC_DRAW};
+        GLuint instanceVbo{0};      // Per-instance attributes, 0 if not instanced
+        GLsizei instanceCount{0};   // Instances currently stored
+        size_t instanceCapacity{0}; // Size of the instance storage in bytes
+        GLuint instanceSource{0};   // Buffer the instance attributes read, 0 if none
+        size_t instanceOffset{0};   // Byte offset of the first instance in it
+        bool adopted{false};        // The buffers belong to another registry
+    };
+    // The vertex formats, one shared VAO each
+    enum VertexArrayFormat{
+        FORMAT_PACKED = 0,          // PackedVertex
+        FORMAT_INSTANCED,           // PackedVertex, then InstanceData per instance
+        FORMAT_COUNT
+    };
+    // A shared VAO and the buffers attached to it right now
+    struct SharedVertexArray{
+        GLuint vao{0};
+        GLuint vertexBuffer{0};
+        GLuint elementBuffer{0};
+        GLuint instanceBuffer{0};
+        size_t instanceOffset{0};
+    };
+    // Creates the shared VAOs and, with direct state access, sets their
+    // attribute formats
+    void CreateVertexArrays();
+    // Attaches the buffers of a mesh to vertexArray, which must be bound
+    // unless there is direct state access
+    void AttachBuffers(SharedVertexArray& vertexArray, const GPUMesh& mesh, bool instanced);
+    // Uploads the index data of a mesh, narrowing to 16-bit when possible
+    void UploadIndices(GPUMesh& mesh, const uint32_t* indexData, size_t indexCount);
+
+    std::vector<GPUMesh> m_meshes;
+    SharedVertexArray m_vertexArrays[FORMAT_COUNT];
+    // Mesh of the last Bind(), INVALID_MESH if none
+    MeshHandle m_boundMesh{INVALID_MESH};
+    // Scratch space for narrowing indices to 16-bit
+    std::vector<uint16_t> m_shortIndices;
+    // Scratch space for packing vertices before upload
+    std::vector<PackedVertex> m_packedVertices;
+};
+
+#endif
@@ -0,0 +1,52 @@
+/** @file MeshSimplifier.hpp
+ *  @brief Quadric error mesh simplification for levels of detail.
+ *
+ *  Simplification collapses edges in order of their quadric error
+ *  (Garland and Heckbert): every position keeps the sum of the squared
+ *  distances to the planes of the triangles around it, and an edge is
+ *  collapsed into whichever end moves the surface least. Only indices
+ *  change. Each collapsed position reuses an existing vertex (a
+ *  half-edge collapse), so every level of detail indexes the same
+ *  vertex stream and can live in the same vertex buffer.
+ *
+ *  Open borders and texture seams get extra planes across them so the
+ *  silhouette and the UV layout hold up, and a collapse that would turn
+ *  a triangle over is skipped. Runs at asset build time (see
+ *  MeshFile::EncodeFromObj()), not in the game.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef MESHSIMPLIFIER_HPP
+#define MESHSIMPLIFIER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Most levels of detail of one mesh, the full mesh included
+const uint32_t MAX_MESH_LODS = 4;
+
+// One level of detail: a run of a mesh's index list
+struct MeshLod{
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    // Furthest the level strays from the full mesh, in model units
+    float error;
+};
+
+// Collapses edges until at most targetIndexCount indices are left or no
+// collapse is possible. Positions are the first three floats of every
+// vertex. Returns the remaining triangles' indices in their original order
+// and sets error to the largest error of a collapse that was made.
+std::vector<uint32_t> SimplifyMesh(const float* vertices, size_t vertexCount, size_t floatsPerVertex,
+                                   const uint32_t* indices, size_t indexCount,
+                                   size_t targetIndexCount, float& error);
+
+// Appends up to MAX_MESH_LODS - 1 simplified copies of indices, each with
+// about half the triangles of the one before, and describes every level
+// in lods (level 0 is the original list). Stops early when a mesh no
+// longer gets meaningfully smaller.
+void BuildMeshLods(const std::vector<float>& vertices, size_t floatsPerVertex,
+                   std::vector<uint32_t>& indices, std::vector<MeshLod>& lods);
+
+#endif
@@ -0,0 +1,97 @@
+/** @file MetricsServer.hpp
+ *  @brief Performance metrics in the Prometheus text format, served over
+ *  HTTP from a thread of their own, --metrics-port=<port>.
+ *
+ *  A GET of /metrics answers with the frame time histogram of the
+ *  Telemetry, the frame rate, GPU frame time and tracked GL memory the
+ *  frame loop last published, the resident set size, and how many assets
+ *  loaded and how long they took from queueing to the end of their
+ *  upload. Started for training (offscreen or headless), it adds the
+ *  simulation steps, the steps per second since the previous scrape, the
+ *  episodes and their mean score.
+ *
+ *  The server thread never waits on the frame loop. The frame loop hands
+ *  its values over with Publish(), a handful of relaxed stores, and the
+ *  server reads them, the asset loader's counts and the Telemetry blocks
+ *  with relaxed loads only; the one lock it takes, the Telemetry's
+ *  registry of blocks, is held by another thread only while that thread
+ *  counts for the first time. The resident set size comes from
+ *  /proc/self/statm. Scrapes are answered one at a time, each connection
+ *  getting a second to send its request.
+ *
+ *  Only implemented on Linux; elsewhere Start() fails.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef METRICSSERVER_HPP
+#define METRICSSERVER_HPP
+
+#include "Telemetry.hpp"
+#include "TcpSocket.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <thread>
+
+class AssetLoader;
+
+class MetricsServer{
+public:
+    // Constructor
+    MetricsServer();
+    // Destructor, stops the server
+    ~MetricsServer();
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+
+    // Reports the load times of assets as well. Call before Start().
+    inline void SetAssetLoader(const AssetLoader* assets){
+        m_assets = assets;
+    }
+    // Listens on port and starts answering scrapes; training adds the
+    // simulation metrics
+    bool Start(int port, bool training);
+    void Stop();
+    inline bool IsRunning() const{
+        return m_thread.joinable();
+    }
+    // Port listened on
+    inline int GetPort() const{
+        return m_listener.GetPort();
+    }
+    // The frame loop's latest values: frames per second, GPU time of a
+    // frame in milliseconds and bytes of the GL objects it tracks
+    inline void Publish(double framesPerSecond, double gpuMilliseconds, uint64_t gpuBytes){
+        m_framesPerSecond.store(framesPerSecond, std::memory_order_relaxed);
+        m_gpuMilliseconds.store(gpuMilliseconds, std::memory_order_relaxed);
+        m_gpuBytes.store(gpuBytes, std::memory_order_relaxed);
+    }
+    // Scrapes answered so far
+    inline uint64_t GetScrapeCount() const{
+        return m_scrapes.load(std::memory_order_relaxed);
+    }
+private:
+    void ServerThread();
+    // Reads one request from connection and answers it
+    void Serve(TcpSocket& connection);
+    // The body of a /metrics answer
+    std::string Format();
+
+    TcpSocket m_listener;
+    std::thread m_thread;
+    std::atomic<bool> m_stop{false};
+    bool m_training{false};
+    const AssetLoader* m_assets{nullptr};
+
+    std::atomic<double> m_framesPerSecond{0.0};
+    std::atomic<double> m_gpuMilliseconds{0.0};
+    std::atomic<uint64_t> m_gpuBytes{0};
+    std::atomic<uint64_t> m_scrapes{0};
+    // The previous scrape, for the steps per second; server thread only
+    TelemetrySnapshot m_previous;
+    bool m_hasPrevious{false};
+};
+
+#endif
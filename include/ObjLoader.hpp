@@ -1,8 +1,19 @@
 #ifndef OBJLOADER_HPP
 #define OBJLOADER_HPP
 
+#include "AABB.hpp"
+#include "MaterialTable.hpp"
+#include "MemoryTags.hpp"
+#include "Span.hpp"
+
 #include <vector>
 #include <string>
+#include <cstdint>
+#include <functional>
+
+// What a loader holds counts as MEMORY_MESHES
+template<typename T>
+using MeshVector = TaggedVector<T, MEMORY_MESHES>;
 
 struct Vertex{
     float x,y,z;    // position
@@ -25,29 +36,116 @@ struct Triangle{
     TextureCoords textures[3]; // 3 texture coordinates per triangle
 };
 
+// 0-based indices, -1 when the corner has no such element (e.g. 'v//vn')
 struct Face {
     int vertexIndices[3];    // indices for the vertices
     int textureIndices[3];   // indices for the texture coordinates
     int normalIndices[3];    // indices for the normals
 };
 
+// A run of faces drawn with one material, as a range of the indices of
+// getIndexedMesh() (three per face, so firstIndex / 3 is the first of
+// getTriangles()). Runs follow the file's usemtl lines in file order; a
+// material used twice apart gets two runs with the same id.
+struct ObjSubmesh {
+    MaterialId material;
+    uint32_t firstIndex;
+    uint32_t indexCount;
+};
+
 class ObjLoader {
 public:
     ObjLoader(const std::string& filename, int type);
+    // A loader owns everything it parsed: it moves, and copies only
+    // through clone(), so a stray copy does not compile
+    ObjLoader(ObjLoader&&) = default;
+    ObjLoader& operator=(ObjLoader&&) = default;
+    ObjLoader& operator=(const ObjLoader&) = delete;
+    ObjLoader clone() const;
+    // Diffuse map of the first submesh whose material has one, empty if none
     std::string getTextureName() const;
-    std::vector<Vertex> getVertices() const;
-    std::vector<TextureCoords> getTextures() const;
-    std::vector<Normal> getNormals() const;
-    std::vector<Triangle> getTriangles() const;
+    // Runs of faces by material, covering every face; their materials
+    // are in MaterialTable::Get()
+    Span<ObjSubmesh> getSubmeshes() const;
+    // Views of the parsed data, valid while the loader lives
+    Span<Vertex> getVertices() const;
+    Span<TextureCoords> getTextures() const;
+    Span<Normal> getNormals() const;
+    // Every face expanded into its three corners, built once while loading
+    Span<Triangle> getTriangles() const;
+    // Deduplicates (position, uv, normal) corners into a unique interleaved
+    // vertex stream (x,y,z,nx,ny,nz,u,v) and a triangle index list.
+    void getIndexedMesh(std::vector<float>& stream, std::vector<uint32_t>& indices) const;
+    // Bounds of every vertex position, computed while loading
+    const AABB& getBounds() const;
+    // Normals made while loading for corners the file gave none, or an
+    // unusable one (see generateNormals())
+    inline size_t getGeneratedNormalCount() const {
+        return generatedNormals;
+    }
+    // Most threads a load parses a large file on, 0 (the default) for
+    // every thread of the job system; for measuring how loads scale
+    static void setParseThreads(unsigned int threads);
     int modelType;
 
 private:
-    std::vector<Vertex> vertices;
-    std::vector<TextureCoords> textures;
-    std::vector<Normal> normals;
-    std::vector<Face> faces;
+    ObjLoader(const ObjLoader&) = default;
+    MeshVector<Vertex> vertices;
+    MeshVector<TextureCoords> textures;
+    MeshVector<Normal> normals;
+    MeshVector<Face> faces;
+    MeshVector<Triangle> triangles;
+    MeshVector<ObjSubmesh> submeshes;
     std::string textureName;
+    AABB bounds;
+    size_t generatedNormals = 0;
     void load(const std::string& filename);
+    // Gives every corner without a usable normal one: the area weighted
+    // mean of the faces around its position, or the face's own for faces
+    // in flatFaces (an 's off' smoothing group). The new normals are
+    // appended to normals.
+    void generateNormals(const std::vector<uint8_t>& flatFaces);
+    void buildTriangles();
+};
+
+// Where StreamObj() sends the mesh as it reads it: every new corner as
+// the 8 floats of an interleaved vertex (x,y,z,nx,ny,nz,u,v), numbered
+// from 0 in the order sent, and every triangle as its three corners.
+// Returning false stops the import.
+struct ObjStreamSink {
+    std::function<bool(const float* vertex)> addVertex;
+    std::function<bool(const uint32_t* indices)> addTriangle;
 };
 
+// What a streamed import saw
+struct ObjStreamResult {
+    uint64_t vertexCount = 0;
+    uint64_t triangleCount = 0;
+    // Corners the cache evicted to make room; each may be sent again
+    uint64_t evictedCorners = 0;
+    // Bytes of positions, texture coordinates and normals held, and of
+    // the read buffer and the corner cache
+    size_t attributeBytes = 0;
+    size_t workingBytes = 0;
+    // Bounds of every position and the diffuse map, as ObjLoader has them
+    AABB bounds;
+    std::string textureName;
+};
+
+// Corner cache entries and read block size StreamObj() uses by default:
+// 16 MB of cache and 8 MB blocks, whatever the size of the file
+const size_t OBJ_STREAM_CACHE_ENTRIES = 1 << 20;
+const size_t OBJ_STREAM_BLOCK_BYTES = 8 << 20;
+
+// Imports the OBJ at filename without holding it: the file is read a
+// block at a time, and its faces are never stored. Only the positions,
+// texture coordinates and normals are kept, in binary, since any later
+// face may use any of them. Corners are deduplicated through a cache of
+// cacheEntries (rounded up to a power of two) recently sent ones, which
+// never grows; a corner used again after it was evicted is sent again as
+// a new vertex, so the output is exact but may repeat a few vertices.
+// Returns false if the file cannot be read or the sink stops the import.
+bool StreamObj(const std::string& filename, const ObjStreamSink& sink, ObjStreamResult& result,
+               size_t cacheEntries = OBJ_STREAM_CACHE_ENTRIES, size_t blockBytes = OBJ_STREAM_BLOCK_BYTES);
+
 #endif // OBJLOADER_HPP
@@ -0,0 +1,97 @@
+/** @file ObstacleLane.hpp
+ *  @brief Obstacles on the lane, kept sorted by position.
+ *
+ *  Obstacles only move along x, so the lane keeps them in a fixed-size
+ *  ring ordered by x: new obstacles spawn on the right and are pushed
+ *  at the back, obstacles that scroll off on the left are popped from
+ *  the front. Every query then touches only the obstacles inside its x
+ *  window, found by binary search, instead of every obstacle on the
+ *  lane. Positions are stored as columns so a window can be handed to
+ *  FindFirstOverlap() and tested several obstacles at a time.
+ *
+ *  When every obstacle moves at the same speed the order never changes.
+ *  Obstacles moved individually are put back in order with
+ *  ResortObstacleLane(), an insertion sort that is linear for a lane
+ *  that is already nearly sorted.
+ *
+ *  The lane is plain data of fixed size, so a GameState can hold one
+ *  and still be copied with memcpy, and nothing here allocates.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef OBSTACLELANE_HPP
+#define OBSTACLELANE_HPP
+
+#include "Collision.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+// Most obstacles on one lane at a time, a power of two. The spawner's
+// gaps keep at most two groups (six obstacles) alive at once; eight
+// keeps a GameState within two cache lines.
+const uint32_t OBSTACLE_LANE_CAPACITY = 8;
+const uint32_t OBSTACLE_LANE_MASK = OBSTACLE_LANE_CAPACITY - 1;
+
+struct ObstacleLane{
+    // Positions by ring slot; slot (head + i) & OBSTACLE_LANE_MASK holds
+    // the i-th obstacle from the left
+    int x[OBSTACLE_LANE_CAPACITY] = {};
+    int y[OBSTACLE_LANE_CAPACITY] = {};
+    uint32_t head = 0;
+    uint32_t count = 0;
+};
+
+// A run of obstacles in lane order: the indices first .. first + count - 1
+struct LaneWindow{
+    uint32_t first;
+    uint32_t count;
+};
+
+// Ring slot of the i-th obstacle from the left
+inline uint32_t GetLaneSlot(const ObstacleLane& lane, uint32_t i){
+    return (lane.head + i) & OBSTACLE_LANE_MASK;
+}
+
+inline void ClearObstacleLane(ObstacleLane& lane){
+    lane.head = 0;
+    lane.count = 0;
+}
+
+// Adds an obstacle in order, false if the lane is full. Spawns are to the
+// right of everything else, so this is normally a push at the back.
+bool InsertObstacle(ObstacleLane& lane, int x, int y);
+
+// Pops obstacles from the left while they are left of minX, returns how many
+uint32_t RemoveObstaclesBefore(ObstacleLane& lane, int minX);
+
+// Height of the highest obstacle, 0 for an empty lane
+int GetLaneTop(const ObstacleLane& lane);
+
+// Moves every obstacle by dx; the order does not change
+void AdvanceObstacleLane(ObstacleLane& lane, int dx);
+
+// Restores the order after obstacles were moved one by one
+void ResortObstacleLane(ObstacleLane& lane);
+
+// The obstacles with minX <= x <= maxX
+LaneWindow FindLaneWindow(const ObstacleLane& lane, int minX, int maxX);
+
+// Lane index of the first obstacle (all using obstacleBox) overlapping box
+// at (x, y), or lane.count if none. Only the obstacles that can reach the
+// box along x are tested.
+uint32_t FindFirstLaneHit(const ObstacleLane& lane, const CollisionBox& box, int x, int y,
+                          const CollisionBox& obstacleBox);
+
+// Lane index of the first obstacle (all using obstacleBox) that box
+// touches while moving in a straight line from (x0, y0) to (x1, y1), or
+// lane.count if none. Only the obstacles within reach of the path along
+// x are tested.
+uint32_t FindFirstSweptLaneHit(const ObstacleLane& lane, const CollisionBox& box, int x0, int y0, int x1, int y1,
+                               const CollisionBox& obstacleBox);
+
+// The same for the dino's path under rules, the silhouettes included
+// (see SweptHit())
+uint32_t FindFirstSweptLaneHit(const ObstacleLane& lane, const CollisionRules& rules, int x0, int y0, int x1, int y1);
+
+#endif
@@ -0,0 +1,58 @@
+/** @file PaletteTexture.hpp
+ *  @brief The colour schemes of the flat-coloured meshes, a small
+ *  lookup texture indexed by palette and time of day.
+ *
+ *  The dinos and the cacti are coloured by one swatch each instead of a
+ *  texture of their own. Every colour scheme is a column of a tiny RGBA
+ *  texture, the day colours in row 0 and the night colours in row 1,
+ *  and the fragment shader fetches the texel of the instance's palette
+ *  column, u_PaletteIndex plus its own. An instance whose layer is
+ *  PALETTE_DAY_LAYER or PALETTE_NIGHT_LAYER reads the lookup instead of
+ *  the texture array, so adding a scheme is one more column of
+ *  palette.ppm rather than more swatches in every scene texture.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef PALETTETEXTURE_HPP
+#define PALETTETEXTURE_HPP
+
+#include <glad/glad.h>
+
+#include <string>
+
+// Texture unit the scene programs read u_Palette from
+const unsigned int PALETTE_TEXTURE_UNIT = 4;
+// Instance layers that select a row of the palette, -1 minus the row,
+// instead of a layer of the texture array
+const float PALETTE_DAY_LAYER   = -1.0f;
+const float PALETTE_NIGHT_LAYER = -2.0f;
+
+class PaletteTexture{
+public:
+    // Constructor
+    PaletteTexture();
+    // Destructor
+    // Note: Call Release() while the GL context is alive.
+    ~PaletteTexture();
+    PaletteTexture(const PaletteTexture&) = delete;
+    PaletteTexture& operator=(const PaletteTexture&) = delete;
+    // Uploads the palettes of a PPM, one column per palette. If it
+    // cannot be read every palette is white, and false is returned.
+    bool Load(const std::string& filepath);
+    // Binds the texture to PALETTE_TEXTURE_UNIT
+    void Bind();
+    inline GLuint GetTexture() const{
+        return m_texture;
+    }
+    // Palettes in the texture, its columns
+    inline int GetCount() const{
+        return m_count;
+    }
+    // Deletes the texture
+    void Release();
+private:
+    GLuint m_texture{0};
+    int m_count{0};
+};
+
+#endif
@@ -0,0 +1,157 @@
+/** @file ParticleSystem.hpp
+ *  @brief Dust and sand particles simulated and drawn entirely on the GPU.
+ *
+ *  Particles live in two buffers of MAX_PARTICLES each. Every frame a
+ *  vertex shader reads one buffer, moves every particle (gravity, drag,
+ *  the ground, the scrolling track) and writes it into the other through
+ *  transform feedback, with rasterization off; then the buffers swap.
+ *  The context has no compute shaders, and this keeps the pool on the
+ *  GPU from the start: nothing is read back and nothing is uploaded per
+ *  frame but a handful of uniforms.
+ *
+ *  Emit() takes a burst and hands it the next count slots of the pool,
+ *  as a ring. The update pass respawns the particles of the slots in a
+ *  burst from the burst's uniforms and a hash of the slot, so the CPU
+ *  never writes a particle. A slot reused before its particle died
+ *  simply cuts that particle short.
+ *
+ *  Particles are drawn as camera-facing quads, one instance per
+ *  particle, straight from the buffer the update just wrote. Dead ones
+ *  are moved outside the clip volume. Once every particle emitted is
+ *  certainly dead, neither pass runs.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef PARTICLESYSTEM_HPP
+#define PARTICLESYSTEM_HPP
+
+#include "ShaderProgram.hpp"
+
+#include <glad/glad.h>
+#include "glm/glm.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// A puff of particles, spawned at the next update
+struct ParticleBurst{
+    glm::vec3 origin{0.0f};
+    // Particles start within this distance of origin on x and z
+    float radius{0.0f};
+    // Mean starting velocity, in units per second
+    glm::vec3 velocity{0.0f};
+    // Added to each component of the velocity at random, up to this much
+    glm::vec3 spread{0.0f};
+    // Seconds the longest lived particle lasts; each lasts half to all of it
+    float life{1.0f};
+    // Half the width of a particle's quad
+    float size{0.05f};
+    unsigned int count{0};
+};
+
+class ParticleSystem{
+public:
+    // Particles in the pool
+    static constexpr size_t MAX_PARTICLES = 32768;
+    // Bursts one update can spawn; more in a frame are dropped
+    static const size_t MAX_BURSTS = 8;
+
+    // Constructor
+    ParticleSystem();
+    // Destructor
+    // Note: Call Release() while the GL context is alive.
+    ~ParticleSystem();
+    // Builds the shaders and the two particle buffers, all particles dead.
+    // Must be called after the GL loader is initialized.
+    bool Initialize(const std::string& updatePath, const std::string& vertexPath, const std::string& fragmentPath);
+    // Rebuilds the shaders from their files; the previous ones stay in
+    // use if the new ones do not build
+    bool ReloadShaders(const std::string& updatePath, const std::string& vertexPath, const std::string& fragmentPath);
+    // Queues a burst for the next update
+    void Emit(const ParticleBurst& burst);
+    // Lets seconds of particle time pass at the next update, while the
+    // track moves scroll units towards -x under them. Adds up until then.
+    void Advance(float seconds, float scroll);
+    // Height particles come to rest at
+    inline void SetGroundHeight(float height){
+        m_groundHeight = height;
+    }
+    // Runs the update pass and draws the particles with color (alpha
+    // included) into the bound framebuffer, seen by the camera of the
+    // frame's FrameUniforms. Expects depth testing on; blends without
+    // writing depth.
+    void Draw(const glm::vec4& color);
+    // Draws the particles as the last Draw() left them, without updating
+    // them again: the further views of a split screen frame
+    void Redraw(const glm::vec4& color);
+    // Runs both passes once though no particle is alive, so the driver
+    // has finished with their programs before the first burst
+    void WarmUp();
+    // True while a particle emitted may still be alive
+    inline bool IsActive() const{
+        return m_secondsActive > 0.0f || m_burstCount > 0;
+    }
+    // Bursts spawned since Initialize()
+    inline size_t GetBurstCount() const{
+        return m_burstsEmitted;
+    }
+    // Deletes the GL objects
+    void Release();
+private:
+    // The update and the draw pass of Draw()
+    void RunPasses(const glm::vec4& color);
+    void DrawPass(const glm::vec4& color);
+
+    // One particle as the buffers store it
+    struct Particle{
+        GLfloat position[3];
+        GLfloat life;           // Seconds left, dead at 0
+        GLfloat velocity[3];
+        GLfloat size;
+    };
+    struct UpdateLocations{
+        GLint deltaTime{-1};
+        GLint scroll{-1};
+        GLint groundHeight{-1};
+        GLint seed{-1};
+        GLint particleCount{-1};
+        GLint burstCount{-1};
+        GLint burstRange{-1};
+        GLint burstOrigin{-1};
+        GLint burstVelocity{-1};
+        GLint burstSpread{-1};
+    };
+
+    ShaderProgram m_updateProgram;
+    ShaderProgram m_drawProgram;
+    UpdateLocations m_update;
+    GLint m_colorLocation{-1};
+    GLint m_fadeLocation{-1};
+
+    // Ping-pong pair; m_current holds the particles of the last update
+    GLuint m_buffers[2] = {0, 0};
+    // Each buffer read per vertex by the update, and per instance by the draw
+    GLuint m_updateVao[2] = {0, 0};
+    GLuint m_drawVao[2] = {0, 0};
+    int m_current{0};
+
+    // Bursts queued for the next update, as uniform arrays
+    GLint m_burstRange[MAX_BURSTS * 2] = {};
+    GLfloat m_burstOrigin[MAX_BURSTS * 4] = {};
+    GLfloat m_burstVelocity[MAX_BURSTS * 4] = {};
+    GLfloat m_burstSpread[MAX_BURSTS * 4] = {};
+    size_t m_burstCount{0};
+    size_t m_burstsEmitted{0};
+    // Next slot a burst takes
+    size_t m_cursor{0};
+
+    float m_pendingSeconds{0.0f};
+    float m_pendingScroll{0.0f};
+    float m_groundHeight{0.0f};
+    // Longest any emitted particle can still live
+    float m_secondsActive{0.0f};
+    uint32_t m_seed{0};
+};
+
+#endif
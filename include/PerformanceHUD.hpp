@@ -0,0 +1,109 @@
+/** @file PerformanceHUD.hpp
+ *  @brief Toggleable on-screen overlay of frame timings, drawn in one call.
+ *
+ *  Text and boxes are screen-space quads in pixels. They are collected
+ *  into one vertex array on the CPU between Begin() and Draw(), then
+ *  uploaded into a single dynamic vertex buffer (orphaned every frame,
+ *  so the upload never waits on the GPU) and drawn with one
+ *  glDrawArrays. Every quad samples the same texture: a font atlas
+ *  baked at startup from a built-in 5x7 bitmap font, whose last cell
+ *  is solid for boxes and graph bars.
+ *
+ *  Nothing is allocated while the overlay is drawn: the vertex array is
+ *  reserved for MAX_QUADS quads up front and quads beyond that are
+ *  dropped. The HUD also keeps a short history of frame times for its
+ *  frame-time graph.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef PERFORMANCEHUD_HPP
+#define PERFORMANCEHUD_HPP
+
+#include "ShaderProgram.hpp"
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Pixels of one character at the overlay's scale
+const float HUD_CHARACTER_WIDTH = 12.0f;
+const float HUD_LINE_HEIGHT = 18.0f;
+
+// Colors are 0xRRGGBBAA
+const uint32_t HUD_WHITE  = 0xFFFFFFFF;
+const uint32_t HUD_YELLOW = 0xFFE040FF;
+const uint32_t HUD_RED    = 0xFF5040FF;
+const uint32_t HUD_GREEN  = 0x60FF60FF;
+const uint32_t HUD_PANEL  = 0x000000A0;
+
+class PerformanceHUD{
+public:
+    // Constructor
+    PerformanceHUD();
+    // Destructor
+    // Note: Call Release() while the GL context is alive.
+    ~PerformanceHUD();
+    // Builds the shader, the font atlas and the vertex buffer.
+    // Must be called after the GL loader is initialized.
+    bool Initialize(const std::string& vertexPath, const std::string& fragmentPath);
+    // Rebuilds the overlay shader from its files; the previous one stays
+    // in use if the new one does not build
+    bool ReloadShaders(const std::string& vertexPath, const std::string& fragmentPath);
+    inline bool IsVisible() const{
+        return m_visible;
+    }
+    inline void SetVisible(bool visible){
+        m_visible = visible;
+    }
+    // Adds a frame to the frame-time graph, whether or not it is shown
+    void AddFrameTime(double milliseconds);
+    // Starts collecting the quads of a new overlay
+    void Begin();
+    // Draws text with its top left corner at x, y; returns the x after it
+    float Text(float x, float y, const char* text, uint32_t color);
+    // A filled box
+    void Box(float x, float y, float width, float height, uint32_t color);
+    // The recent frame times as bars, full height at maxMilliseconds, with
+    // a line at markMilliseconds
+    void FrameGraph(float x, float y, float width, float height,
+                    double maxMilliseconds, double markMilliseconds);
+    // Uploads the collected quads and draws them over the window
+    void Draw(int screenWidth, int screenHeight);
+    // Quads of the last Draw()
+    inline size_t GetQuadCount() const{
+        return m_quadCount;
+    }
+    // Deletes the GL objects
+    void Release();
+private:
+    // Quads one overlay can hold
+    static const size_t MAX_QUADS = 2048;
+    // Frames of history in the graph
+    static const size_t GRAPH_FRAMES = 120;
+
+    struct Vertex{
+        GLfloat x, y;
+        GLfloat u, v;
+        GLubyte color[4];
+    };
+
+    // Adds a quad with the atlas rectangle u0, v0 to u1, v1
+    void Quad(float x, float y, float width, float height,
+              float u0, float v0, float u1, float v1, uint32_t color);
+
+    ShaderProgram m_program;
+    GLint m_screenSizeLocation{-1};
+    GLuint m_atlas{0};
+    GLuint m_vao{0};
+    GLuint m_vbo{0};
+    std::vector<Vertex> m_vertices;
+    size_t m_quadCount{0};
+    bool m_visible{false};
+    std::vector<float> m_frameTimes;
+    size_t m_nextFrame{0};
+};
+
+#endif
@@ -0,0 +1,120 @@
+/** @file PerformanceTier.hpp
+ *  @brief Quality tier of this machine, from a short probe at first launch.
+ *
+ *  The same build runs on very different kiosks, so rather than settings
+ *  tuned by hand per site, the game measures the hardware once and picks
+ *  one of a few tiers. Probe() takes a fraction of a second and needs
+ *  the GL context:
+ *
+ *  - simulation: steps per second of the benchmark game (FrameBenchmark's
+ *    scripted input, collisions off) on this thread
+ *  - draw calls: CPU time per draw call, from a run of tiny triangles
+ *    that each change a uniform, so the driver cannot merge them
+ *  - fill rate: pixels per second of blended full screen triangles into
+ *    an offscreen target the size of the window, timed on the GPU with a
+ *    GL_TIME_ELAPSED query
+ *
+ *  Each measure calls for a tier of its own, and the machine gets the
+ *  lowest of them: a fast GPU does not help a kiosk whose CPU cannot
+ *  keep up with the draw calls. A tier's QualitySettings are where the
+ *  resolution, the level of detail, the particles and the textures
+ *  start; options given on the command line still win.
+ *
+ *  The result is written as text to tier.txt in the shader program
+ *  cache directory, keyed by the GL vendor, renderer and version and the
+ *  CPU's thread count. Later launches read it instead of probing, and a
+ *  new GPU, driver or CPU is probed again.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef PERFORMANCETIER_HPP
+#define PERFORMANCETIER_HPP
+
+#include "ShaderProgram.hpp"
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <string>
+
+enum PerformanceTierLevel{
+    TIER_LOW,
+    TIER_MEDIUM,
+    TIER_HIGH,
+    TIER_COUNT
+};
+
+// What a tier sets
+struct QualitySettings{
+    // Largest scale of the scene's resolution; below 1 the scene is drawn
+    // with dynamic resolution from there
+    float resolutionScale;
+    // Largest error in pixels of a simplified level of detail
+    float lodPixelError;
+    // Share of each dust burst's particles spawned
+    float particleBudget;
+    // Mip levels of the scene textures left out beyond those never sampled
+    int textureLevelBias;
+};
+
+// What Probe() measured
+struct HardwareMeasures{
+    double simStepsPerSecond = 0.0;
+    double drawCallMicroseconds = 0.0;
+    double fillGigapixelsPerSecond = 0.0;
+};
+
+class PerformanceTier{
+public:
+    // Constructor
+    PerformanceTier();
+    // Destructor
+    ~PerformanceTier();
+    // Reads the tier of this machine from tier.txt in directory; false if
+    // there is none, or it was measured on other hardware. Must be called
+    // after the GL loader is initialized.
+    bool Load(const std::string& directory);
+    // Measures this machine, drawing into a width x height target, and
+    // picks its tier. Returns false, keeping TIER_HIGH, if the probe's
+    // shaders or target cannot be made.
+    bool Probe(int width, int height);
+    // Writes the tier and the measures to tier.txt in directory
+    bool Save(const std::string& directory) const;
+
+    inline PerformanceTierLevel GetLevel() const{
+        return m_level;
+    }
+    inline void SetLevel(PerformanceTierLevel level){
+        m_level = level;
+    }
+    inline const HardwareMeasures& GetMeasures() const{
+        return m_measures;
+    }
+    inline const QualitySettings& GetSettings() const{
+        return GetSettings(m_level);
+    }
+    static const QualitySettings& GetSettings(PerformanceTierLevel level);
+    // low, medium or high
+    static const char* GetName(PerformanceTierLevel level);
+    // The level called name; false if there is none
+    static bool ParseName(const std::string& name, PerformanceTierLevel& level);
+private:
+    // The measures
+    static double ProbeSimulation();
+    double ProbeDrawCalls();
+    double ProbeFillRate(int width, int height);
+    // Hash of the hardware a tier file holds for
+    static uint64_t GetMachineKey();
+
+    PerformanceTierLevel m_level{TIER_HIGH};
+    HardwareMeasures m_measures;
+    // Probe program, its uniforms and an empty vertex array, only alive
+    // during Probe()
+    ShaderProgram m_program;
+    GLint m_offsetLocation{-1};
+    GLint m_sizeLocation{-1};
+    GLint m_colorLocation{-1};
+    GLuint m_vao{0};
+};
+
+#endif
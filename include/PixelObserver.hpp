@@ -0,0 +1,142 @@
+/** @file PixelObserver.hpp
+ *  @brief Low-resolution offscreen frames read back for pixel-based agents.
+ *
+ *  The scene is rendered into a framebuffer object instead of the
+ *  window, supersample times the observation size (e.g. 84x84) on each
+ *  side. Capture() first reduces it on the GPU: a fullscreen triangle
+ *  averages each supersample x supersample block, converts it to
+ *  grayscale (Rec. 601 luma) and, with maxPool set, takes the maximum
+ *  with the previous frame, as Atari agents see flickering sprites.
+ *  The result lands in a GL_R8 target (GL_RGBA8 in color), so a
+ *  grayscale readback moves one byte per observed pixel instead of
+ *  four per rendered one.
+ *
+ *  The reduced frame is then copied by an asynchronous glReadPixels
+ *  into one of a ring of pixel buffer objects and fenced; the copy is
+ *  only mapped once its fence has signalled, usually one or two frames
+ *  later, so the CPU never waits for the GPU to finish the frame. The
+ *  newest completed frame is kept as tightly packed 8-bit grayscale or
+ *  RGB rows, bottom row first.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef PIXELOBSERVER_HPP
+#define PIXELOBSERVER_HPP
+
+#include "ShaderProgram.hpp"
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class PixelObserver{
+public:
+    // Constructor
+    PixelObserver();
+    // Destructor
+    // Note: Call Release() while the GL context is alive.
+    ~PixelObserver();
+    // Creates the framebuffers, the reduction shaders and the readback
+    // ring for observations of width x height, rendered supersample
+    // times larger on each side
+    bool Initialize(int width, int height, bool grayscale, int supersample, bool maxPool,
+                    const std::string& vertexPath, const std::string& fragmentPath, unsigned int ringSize=3);
+    // Directs rendering (and the viewport) to the offscreen framebuffer
+    void Bind() const;
+    // Reduces the frame just rendered, starts reading it back and
+    // collects finished readbacks
+    void Capture();
+    // Shows the rendered frame, before the reduction, scaled up in the
+    // window's framebuffer
+    void BlitToWindow(int windowWidth, int windowHeight) const;
+    // Directs rendering back to the window
+    void Unbind() const;
+
+    inline int GetWidth() const{
+        return m_width;
+    }
+    inline int GetHeight() const{
+        return m_height;
+    }
+    // Size the scene is rendered at
+    inline int GetRenderWidth() const{
+        return m_width * m_supersample;
+    }
+    inline int GetRenderHeight() const{
+        return m_height * m_supersample;
+    }
+    // 1 for grayscale, 3 for RGB
+    inline int GetChannels() const{
+        return m_grayscale ? 1 : 3;
+    }
+    // The newest completed frame, GetWidth()*GetHeight()*GetChannels() bytes
+    inline const uint8_t* GetLatest() const{
+        return m_latest.data();
+    }
+    // Capture() count of the newest completed frame, -1 before the first
+    inline long GetLatestFrame() const{
+        return m_latestFrame;
+    }
+    // Frames read back so far, and how often Capture() had to wait
+    inline unsigned long GetReadbackCount() const{
+        return m_readbacks;
+    }
+    inline unsigned long GetStallCount() const{
+        return m_stalls;
+    }
+    // Bytes read back a frame
+    inline size_t GetReadbackBytes() const{
+        return (size_t)m_width * m_height * (m_grayscale ? 1 : 4);
+    }
+    // Deletes the framebuffers, textures, buffers and shaders
+    void Release();
+private:
+    struct Slot{
+        GLuint buffer;
+        GLsync fence;   // Set while a readback is in flight
+        long frame;
+    };
+    // Creates a width x height texture sampled texel by texel
+    static GLuint CreateTarget(GLenum internalFormat, int width, int height, const char* name);
+    // Draws the reduction of the rendered frame into the reduced target
+    void Reduce();
+    // Maps a slot's finished readback into m_latest. With wait set it
+    // blocks until the GPU is done, otherwise it gives up if not done yet.
+    bool Collect(Slot& slot, bool wait);
+
+    // The scene is rendered into m_framebuffer
+    GLuint m_framebuffer{0};
+    GLuint m_colorTexture{0};
+    GLuint m_depthBuffer{0};
+    // The reduction writes m_reducedTexture, and with max pooling also this
+    // frame's unpooled value into m_historyTextures[m_history], through
+    // m_reduceFramebuffers[m_history], while it samples the other one
+    GLuint m_reduceFramebuffers[2]{0, 0};
+    GLuint m_reducedTexture{0};
+    GLuint m_historyTextures[2]{0, 0};
+    unsigned int m_history{0};
+    ShaderProgram m_reduceProgram;
+    GLint m_sceneLocation{-1};
+    GLint m_previousLocation{-1};
+    GLint m_supersampleLocation{-1};
+    GLint m_grayscaleLocation{-1};
+    GLint m_maxPoolLocation{-1};
+    // Core profiles draw nothing without a vertex array, even an empty one
+    GLuint m_vao{0};
+    int m_supersample{1};
+    bool m_maxPool{false};
+    std::vector<Slot> m_slots;
+    unsigned int m_nextSlot{0};
+    int m_width{0};
+    int m_height{0};
+    bool m_grayscale{true};
+    long m_frame{0};
+    std::vector<uint8_t> m_latest;
+    long m_latestFrame{-1};
+    unsigned long m_readbacks{0};
+    unsigned long m_stalls{0};
+};
+
+#endif
@@ -0,0 +1,56 @@
+/** @file PixelUnpackBuffer.hpp
+ *  @brief Staging buffer that texture uploads read from asynchronously.
+ *
+ *  Map() creates (or orphans) a GL_PIXEL_UNPACK_BUFFER of the requested
+ *  size and maps it for writing. The mapped memory is plain memory: it
+ *  may be filled from any thread, e.g. by the asset loader's worker,
+ *  while the GL thread goes on rendering. Once it is filled and
+ *  unmapped, texture uploads issued while the buffer is bound take byte
+ *  offsets into it instead of client pointers, so the driver copies
+ *  the texels to the GPU on its own time instead of during the call.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef PIXELUNPACKBUFFER_HPP
+#define PIXELUNPACKBUFFER_HPP
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+
+class PixelUnpackBuffer{
+public:
+    // Constructor
+    PixelUnpackBuffer();
+    // Destructor
+    // Note: Call Release() while the GL context is alive.
+    ~PixelUnpackBuffer();
+    // Allocates bytes of storage and maps all of it for writing. Returns
+    // nullptr if the buffer could not be mapped. GL thread only.
+    uint8_t* Map(size_t bytes);
+    // Unmaps the buffer once it is filled. Returns false if the driver
+    // lost its contents in the meantime. GL thread only.
+    bool Unmap();
+    // Makes texture uploads read from the buffer
+    void Bind() const;
+    // Makes texture uploads read from client memory again
+    static void Unbind();
+    inline size_t GetSize() const{
+        return m_size;
+    }
+    inline bool IsMapped() const{
+        return m_mapped != nullptr;
+    }
+    // Deletes the buffer, unmapping it first if needed
+    void Release();
+private:
+    PixelUnpackBuffer(const PixelUnpackBuffer&) = delete;
+    PixelUnpackBuffer& operator=(const PixelUnpackBuffer&) = delete;
+
+    GLuint m_buffer{0};
+    uint8_t* m_mapped{nullptr};
+    size_t m_size{0};
+};
+
+#endif
@@ -0,0 +1,81 @@
+/** @file PolicyPlugin.hpp
+ *  @brief A policy in a shared library, called in process with every
+ *  lane of a step at once.
+ *
+ *  Bots used to ask a policy server over TCP, a round trip per step. A
+ *  policy library is loaded into the engine instead (dlopen, or
+ *  LoadLibrary on MINGW) and called once per step over the feature rows
+ *  of all its lanes (see FeatureObservation.hpp), contiguous, so a
+ *  network evaluates the whole batch in one go. The library may wrap any
+ *  runtime, an ONNX session or a hand-written network; it exports these
+ *  functions with C linkage:
+ *
+ *      uint32_t dino_policy_abi()
+ *          DINO_POLICY_ABI, which the loader checks
+ *      void* dino_policy_create(const char* options, uint32_t rowSize)
+ *          a policy for rows of rowSize floats, nullptr if it cannot be
+ *          made. options is what followed the library on the command
+ *          line, empty if nothing did.
+ *      int dino_policy_act(void* policy, const float* rows, uint32_t rowCount,
+ *                          uint32_t rowSize, uint8_t* jumps)
+ *          writes a jump (1) or not (0) for each of rowCount rows;
+ *          0 on success
+ *      void dino_policy_destroy(void* policy)
+ *
+ *  A policy is called from one thread at a time, not always the one
+ *  that created it. tools/heuristicpolicy.cpp is a complete example.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef POLICYPLUGIN_HPP
+#define POLICYPLUGIN_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Version of the functions above
+const uint32_t DINO_POLICY_ABI = 1;
+
+extern "C"{
+typedef uint32_t (*DinoPolicyAbiFunction)();
+typedef void* (*DinoPolicyCreateFunction)(const char* options, uint32_t rowSize);
+typedef int (*DinoPolicyActFunction)(void* policy, const float* rows, uint32_t rowCount, uint32_t rowSize,
+                                     uint8_t* jumps);
+typedef void (*DinoPolicyDestroyFunction)(void* policy);
+}
+
+class PolicyPlugin{
+public:
+    // Constructor
+    PolicyPlugin();
+    // Destructor, destroys the policy and unloads the library
+    ~PolicyPlugin();
+    PolicyPlugin(const PolicyPlugin&) = delete;
+    PolicyPlugin& operator=(const PolicyPlugin&) = delete;
+    // Loads the library at path and creates its policy for rows of
+    // rowSize floats. False, with nothing loaded, if the library, one
+    // of its functions or the policy is missing, or its ABI differs.
+    bool Load(const std::string& path, const std::string& options, uint32_t rowSize);
+    // Splits "<library>[:<options>]" and loads it
+    bool LoadSpec(const std::string& spec, uint32_t rowSize);
+    // Destroys the policy and unloads the library
+    void Unload();
+    inline bool IsLoaded() const{
+        return m_policy != nullptr;
+    }
+    inline uint32_t GetRowSize() const{
+        return m_rowSize;
+    }
+    // Picks an action for each of rowCount contiguous rows of GetRowSize()
+    // floats, 1 to jump; false if the policy failed
+    bool Act(const float* rows, uint32_t rowCount, uint8_t* jumps);
+private:
+    void* m_library{nullptr};
+    void* m_policy{nullptr};
+    uint32_t m_rowSize{0};
+    DinoPolicyActFunction m_act{nullptr};
+    DinoPolicyDestroyFunction m_destroy{nullptr};
+};
+
+#endif
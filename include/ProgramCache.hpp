@@ -0,0 +1,88 @@
+/** @file ProgramCache.hpp
+ *  @brief On-disk cache of linked shader programs (GL_ARB_get_program_binary).
+ *
+ *  Compiling and linking the shaders is a large part of a cold start on
+ *  slow GPUs. After a program links, its driver binary is written to
+ *  the cache directory; on later launches ShaderProgram::Build() loads
+ *  it with glProgramBinary and compiles nothing.
+ *
+ *  A program is keyed by an FNV-1a hash of its vertex and fragment
+ *  sources together with the GL_VENDOR, GL_RENDERER and GL_VERSION
+ *  strings, so editing a shader or changing the GPU or driver misses
+ *  the cache instead of loading a stale binary. A driver may still
+ *  reject a binary it wrote (e.g. after an in-place update with the same
+ *  version string); the program is then compiled and the entry
+ *  rewritten.
+ *
+ *  File layout (little endian): ProgramCacheHeader, then the binary.
+ *  Files are written to a temporary name and renamed, so two running
+ *  games never read a half-written entry.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef PROGRAMCACHE_HPP
+#define PROGRAMCACHE_HPP
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// On-disk header of a cached program binary
+struct ProgramCacheHeader{
+    char magic[4];          // "DPRG"
+    uint32_t version;       // PROGRAM_CACHE_VERSION
+    uint64_t key;           // Same as the file name, against renamed files
+    uint32_t binaryFormat;  // As returned by glGetProgramBinary
+    uint32_t binaryBytes;
+};
+
+const uint32_t PROGRAM_CACHE_VERSION = 1;
+
+class ProgramCache{
+public:
+    // The one cache of the GL context
+    static ProgramCache& Get();
+    // Sets the directory the binaries are kept in; empty turns the cache off
+    inline void SetDirectory(const std::string& directory){
+        m_directory = directory;
+    }
+    // Reads the driver strings the keys include. Must be called after the
+    // GL loader is initialized; the cache stays off if the driver has no
+    // program binary formats.
+    void Initialize();
+    inline bool IsEnabled() const{
+        return m_enabled;
+    }
+    // Key of a program made of these sources on this driver
+    uint64_t GetKey(const std::string& vertexSource, const std::string& fragmentSource) const;
+    // Loads a cached binary into program and checks that it links.
+    // False if there is none or the driver rejects it.
+    bool Load(uint64_t key, GLuint program);
+    // Writes the binary of a linked program; false on I/O failure
+    bool Store(uint64_t key, GLuint program);
+    // Programs loaded from and written to the cache since startup
+    inline size_t GetHitCount() const{
+        return m_hits;
+    }
+    inline size_t GetStoreCount() const{
+        return m_stores;
+    }
+private:
+    // Constructor
+    ProgramCache();
+    // Destructor
+    ~ProgramCache();
+    // File a key is kept in
+    std::string GetPath(uint64_t key) const;
+
+    std::string m_directory;
+    // GL_VENDOR, GL_RENDERER and GL_VERSION
+    std::string m_driver;
+    bool m_enabled{false};
+    size_t m_hits{0};
+    size_t m_stores{0};
+};
+
+#endif
@@ -0,0 +1,85 @@
+/** @file RenderQueue.hpp
+ *  @brief Draws ordered by a 64-bit sort key, radix sorted per frame.
+ *
+ *  Each draw a frame queues carries a key packed from what it switches
+ *  most expensively first, most significant bits first:
+ *
+ *      pass      5 bits   the order passes run in, never reordered away
+ *      program  10 bits   shader program
+ *      material 16 bits   texture (layer) or material id
+ *      mesh     16 bits   vertex array or mesh range
+ *      depth    17 bits   distance from the eye, see MakeSortKey()
+ *
+ *  Sorting by the key keeps every pass together, then groups the draws
+ *  of one program, then of one texture within it, and so on, so the
+ *  submission order changes the least state without anyone arranging
+ *  it by hand. Within one pass, program, material and mesh, opaque
+ *  draws go front to back so the depth test rejects hidden fragments
+ *  early, and blended ones back to front so they compose correctly.
+ *
+ *  Sort() is a stable least significant digit radix sort, a byte per
+ *  round; a round whose byte is the same in every key is skipped, so
+ *  fields nothing sets cost nothing. Draws with equal keys keep the
+ *  order they were added in.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef RENDERQUEUE_HPP
+#define RENDERQUEUE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+const int SORT_PASS_BITS     = 5;
+const int SORT_PROGRAM_BITS  = 10;
+const int SORT_MATERIAL_BITS = 16;
+const int SORT_MESH_BITS     = 16;
+const int SORT_DEPTH_BITS    = 17;
+
+// Packs a sort key. Fields wider than their bits are clamped to the
+// largest value. depth is any non-negative distance (squared works as
+// well); with backToFront set, farther draws come first.
+uint64_t MakeSortKey(uint32_t pass, uint32_t program, uint32_t material, uint32_t mesh,
+                     float depth = 0.0f, bool backToFront = false);
+
+// The pass field of a key
+inline uint32_t GetSortKeyPass(uint64_t key){
+    return (uint32_t)(key >> (64 - SORT_PASS_BITS));
+}
+
+// One queued draw: its key and whatever the caller indexes draws by
+struct RenderItem{
+    uint64_t key;
+    uint32_t index;
+};
+
+class RenderQueue{
+public:
+    // Constructor
+    RenderQueue();
+    // Destructor
+    ~RenderQueue();
+    // Room for count draws without allocating
+    void Reserve(size_t count);
+    // Forgets the previous frame's draws
+    void Begin();
+    inline void Add(uint64_t key, uint32_t index){
+        m_items.push_back(RenderItem{key, index});
+    }
+    // Orders the draws by key, equal keys in the order they were added
+    void Sort();
+    // The draws, sorted once Sort() ran
+    inline const std::vector<RenderItem>& GetItems() const{
+        return m_items;
+    }
+    inline size_t GetCount() const{
+        return m_items.size();
+    }
+private:
+    std::vector<RenderItem> m_items;
+    // The other buffer of each radix round
+    std::vector<RenderItem> m_scratch;
+};
+
+#endif
@@ -0,0 +1,129 @@
+/** @file RenderWorkers.hpp
+ *  @brief Atlas observations drawn by several threads at once, each with
+ *  a GL context of the main context's share group, --render-workers=<n>.
+ *
+ *  With one context every draw and readback of the atlas is submitted
+ *  by one CPU thread, however idle the GPU is. Each worker here owns a
+ *  context that shares the main one's objects, so the scene mesh and
+ *  textures, loaded once there, are drawn as they are. What contexts do
+ *  not share, vertex arrays and framebuffers, each worker makes for
+ *  itself: an AtlasObserver of its own environments (its framebuffer,
+ *  readback ring, program and draw batch) and a MeshRegistry that
+ *  Adopt()s the scene mesh.
+ *
+ *  The main context keeps the first environments in the caller's own
+ *  AtlasObserver. Render() hands every worker its equal share of the
+ *  rest and returns; the caller draws its share meanwhile, and Wait()
+ *  returns once the workers are done with the frame. The environments,
+ *  scene and textures must stay as they are until then. Render()
+ *  flushes the main context first, so what it uploaded reaches the
+ *  workers.
+ *
+ *  The caller makes the contexts, with SDL or EGL; a worker only makes
+ *  its own current through a callback, on its thread. Workers set up
+ *  and tear down one after the other while the caller waits, so shader
+ *  builds, the program cache and the resource tracker never see two
+ *  threads at once.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef RENDERWORKERS_HPP
+#define RENDERWORKERS_HPP
+
+#include "AtlasObserver.hpp"
+#include "GameStateBatch.hpp"
+#include "MeshRegistry.hpp"
+#include "TextureArray.hpp"
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class RenderWorkers{
+public:
+    // Makes the context of worker current on the calling thread, or with
+    // current false makes none current; false if it could not
+    typedef std::function<bool(size_t worker, bool current)> ContextFunction;
+
+    // Constructor
+    RenderWorkers();
+    // Destructor, stops the workers
+    ~RenderWorkers();
+    RenderWorkers(const RenderWorkers&) = delete;
+    RenderWorkers& operator=(const RenderWorkers&) = delete;
+
+    // Starts workers threads sharing environments [first, first + count)
+    // out, with atlases of width x height tiles drawn from mesh of
+    // registry, the main context's. Stops them all again if any of them
+    // cannot set up.
+    bool Start(size_t workers, size_t first, size_t count, int width, int height, bool grayscale,
+               const std::string& vertexPath, const std::string& fragmentPath,
+               const MeshRegistry& registry, MeshHandle mesh, const ContextFunction& makeCurrent);
+    // Releases every worker's GL objects and context and joins them
+    void Stop();
+    inline bool IsRunning() const{
+        return !m_workers.empty();
+    }
+    // Starts a frame: every worker draws and reads back its share of
+    // environments
+    void Render(const GameStateBatch& environments, const AtlasScene& scene, const TextureArray& textures);
+    // Waits for the workers to finish the frame Render() started
+    void Wait();
+
+    inline size_t GetWorkerCount() const{
+        return m_workers.size();
+    }
+    // The atlas of a worker, and the first environment it draws
+    inline const AtlasObserver& GetObserver(size_t worker) const{
+        return m_workers[worker]->observer;
+    }
+    inline size_t GetFirst(size_t worker) const{
+        return m_workers[worker]->first;
+    }
+private:
+    struct Worker{
+        std::thread thread;
+        AtlasObserver observer;
+        // Vertex arrays of the worker's context over the adopted mesh
+        MeshRegistry registry;
+        MeshHandle mesh{INVALID_MESH};
+        size_t first{0};
+        size_t count{0};
+        // Set up, and whether that worked
+        bool started{false};
+        bool ready{false};
+        bool stop{false};
+    };
+
+    void WorkerMain(Worker* worker, size_t index);
+
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    ContextFunction m_makeCurrent;
+    const MeshRegistry* m_registry{nullptr};
+    MeshHandle m_mesh{INVALID_MESH};
+    int m_width{0};
+    int m_height{0};
+    bool m_grayscale{true};
+    std::string m_vertexPath;
+    std::string m_fragmentPath;
+
+    // The frame handed out by Render()
+    const GameStateBatch* m_environments{nullptr};
+    AtlasScene m_scene;
+    const TextureArray* m_textures{nullptr};
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+    uint64_t m_frame{0};
+    // Workers still drawing the frame
+    size_t m_pending{0};
+};
+
+#endif
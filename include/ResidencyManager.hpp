@@ -0,0 +1,120 @@
+/** @file ResidencyManager.hpp
+ *  @brief Keeps what is on the GPU within a budget, evicting what was
+ *  used longest ago.
+ *
+ *  Owners of GPU assets that can be let go and brought back register
+ *  each one with a callback that frees it. Every use Touch()es the asset
+ *  with the current frame, and once it is on the GPU SetResident() gives
+ *  its bytes. EndFrame() is handed what the GPU holds in all (the
+ *  GPUResourceTracker total, so the scene arena, the texture array and
+ *  the render targets count too, without being evictable) and, while
+ *  that is over the budget, evicts the resident asset used the longest
+ *  ago. An asset used this frame is never evicted: a working set larger
+ *  than the budget stays over it, reported once, rather than thrashing.
+ *
+ *  An evicted asset stays registered. Its owner streams it back in the
+ *  background the next time it is wanted (SetStreaming(), then
+ *  SetResident() once it arrived) and draws a placeholder meanwhile;
+ *  the manager never loads anything itself.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef RESIDENCYMANAGER_HPP
+#define RESIDENCYMANAGER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+typedef uint32_t ResidencyId;
+const ResidencyId INVALID_RESIDENCY = 0xFFFFFFFFu;
+
+enum ResidencyState{
+    // Not on the GPU; wanted or not
+    RESIDENCY_EVICTED,
+    // Being parsed and uploaded
+    RESIDENCY_STREAMING,
+    // On the GPU
+    RESIDENCY_RESIDENT
+};
+
+// Frees an asset's GPU storage; runs on the GL thread inside EndFrame()
+typedef std::function<void()> ResidencyEvict;
+
+class ResidencyManager{
+public:
+    // Constructor
+    ResidencyManager();
+    // Destructor
+    ~ResidencyManager();
+    // Most bytes the GPU may hold at the end of a frame, 0 for no limit
+    inline void SetBudget(size_t bytes){
+        m_budget = bytes;
+        m_reportedOver = false;
+    }
+    inline size_t GetBudget() const{
+        return m_budget;
+    }
+    // A new asset, not on the GPU yet; name is for the report
+    ResidencyId Register(const std::string& name, ResidencyEvict evict);
+    // Forgets an asset; its owner frees it
+    void Unregister(ResidencyId id);
+    // The asset is on its way back: requested and being streamed
+    void SetStreaming(ResidencyId id);
+    // The asset arrived and takes bytes on the GPU
+    void SetResident(ResidencyId id, size_t bytes);
+    // The asset is used this frame
+    void Touch(ResidencyId id);
+    ResidencyState GetState(ResidencyId id) const;
+
+    // Ends the frame the GPU holds totalBytes at: evicts resident assets
+    // not used this frame, those used longest ago first, until the total
+    // is within the budget. Returns the bytes evicted.
+    size_t EndFrame(size_t totalBytes);
+
+    // Frames ended so far, what Touch() stamps
+    inline uint64_t GetFrame() const{
+        return m_frame;
+    }
+    // Bytes of the registered assets on the GPU
+    inline size_t GetResidentBytes() const{
+        return m_residentBytes;
+    }
+    // Evictions, and streams back of evicted assets, so far
+    inline uint64_t GetEvictionCount() const{
+        return m_evictions;
+    }
+    inline uint64_t GetRestreamCount() const{
+        return m_restreams;
+    }
+    // Prints the budget and the registered assets
+    void Report() const;
+private:
+    struct Resource{
+        std::string name;
+        ResidencyEvict evict;
+        size_t bytes{0};
+        uint64_t lastUsed{0};
+        ResidencyState state{RESIDENCY_EVICTED};
+        // Evicted at least once, so the next stream is a restream
+        bool evicted{false};
+        bool registered{false};
+    };
+
+    std::vector<Resource> m_resources;
+    // Ids of unregistered resources, reused first
+    std::vector<ResidencyId> m_free;
+    // Scratch of EndFrame(): the eviction candidates
+    std::vector<ResidencyId> m_candidates;
+    size_t m_budget{0};
+    size_t m_residentBytes{0};
+    uint64_t m_frame{0};
+    uint64_t m_evictions{0};
+    uint64_t m_restreams{0};
+    // The working set was over the budget since the budget was set
+    bool m_reportedOver{false};
+};
+
+#endif
@@ -0,0 +1,68 @@
+/** @file RingBuffer.hpp
+ *  @brief Streaming buffer for data that changes every frame.
+ *
+ *  The buffer is split into regionCount regions (three by default).
+ *  Each frame writes into the next region while the GPU may still be
+ *  reading the previous ones. With GL_ARB_buffer_storage the buffer
+ *  is allocated immutable and mapped once, persistently and
+ *  coherently; a fence per region makes sure a region is not
+ *  overwritten before the GPU is done with it. Without the extension
+ *  the data is uploaded with glBufferSubData and the storage is
+ *  orphaned every time the ring wraps around, so the driver never has
+ *  to stall on a buffer that is still in use.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef RINGBUFFER_HPP
+#define RINGBUFFER_HPP
+
+#include <glad/glad.h>
+
+#include <vector>
+#include <cstddef>
+
+// Returned by Write() when the current region has no room left
+const size_t RING_BUFFER_FULL = (size_t)-1;
+
+class RingBuffer{
+public:
+    // Constructor
+    RingBuffer();
+    // Destructor
+    // Note: Call Release() while the GL context is alive.
+    ~RingBuffer();
+    // Creates the buffer, returns false if it could not be mapped
+    bool Initialize(size_t regionSize, unsigned int regionCount=3);
+    // Moves to the next region, waiting for the GPU if it still reads it
+    void BeginRegion();
+    // Copies data into the current region. Returns the byte offset of the
+    // data in the buffer, or RING_BUFFER_FULL if it does not fit.
+    size_t Write(const void* data, size_t bytes, size_t alignment=4);
+    // Fences the current region once the draws reading it are submitted
+    void EndRegion();
+    // The buffer object, bind it to whatever target reads the data
+    inline GLuint GetBuffer() const{
+        return m_buffer;
+    }
+    // True if the buffer is persistently mapped
+    inline bool IsPersistent() const{
+        return m_persistent;
+    }
+    // Bytes available to a single region
+    inline size_t GetRegionSize() const{
+        return m_regionSize;
+    }
+    // Unmaps and deletes the buffer
+    void Release();
+private:
+    GLuint m_buffer{0};
+    char* m_mapped{nullptr};
+    size_t m_regionSize{0};
+    unsigned int m_regionCount{0};
+    unsigned int m_region{0};
+    size_t m_writeOffset{0};    // Bytes used in the current region
+    std::vector<GLsync> m_fences;
+    bool m_persistent{false};
+};
+
+#endif
@@ -0,0 +1,56 @@
+/** @file ScoreDistribution.hpp
+ *  @brief The scores of many evaluated episodes and their summary.
+ *
+ *  Keeps every score (4 bytes an episode, so millions fit easily),
+ *  which makes merging the results of any number of shards exact and
+ *  lets percentiles be read off the sorted scores rather than
+ *  estimated. WriteJson() saves the summary and a histogram.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef SCOREDISTRIBUTION_HPP
+#define SCOREDISTRIBUTION_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+struct ScoreSummary{
+    size_t count = 0;
+    double mean = 0.0;
+    double deviation = 0.0;     // Standard deviation
+    int min = 0;
+    int p10 = 0;
+    int p50 = 0;
+    int p90 = 0;
+    int p99 = 0;
+    int max = 0;
+};
+
+class ScoreDistribution{
+public:
+    // Constructor
+    ScoreDistribution();
+    // Destructor
+    ~ScoreDistribution();
+    inline void Add(int score){
+        m_scores.push_back(score);
+        m_sorted = false;
+    }
+    void Merge(const ScoreDistribution& other);
+    inline size_t GetCount() const{
+        return m_scores.size();
+    }
+    // Sorts the scores if needed, all zero when there are none
+    ScoreSummary Summarize();
+    // Writes the summary and the counts of scores in buckets of
+    // bucketWidth; note is copied in as is, to say what was evaluated
+    bool WriteJson(const std::string& filepath, int bucketWidth, const std::string& note);
+private:
+    void Sort();
+
+    std::vector<int> m_scores;
+    bool m_sorted{true};
+};
+
+#endif
@@ -0,0 +1,80 @@
+/** @file ScreenshotCapture.hpp
+ *  @brief Screenshots taken without a readback stall or file I/O on the
+ *  frame loop, F12.
+ *
+ *  Capture() queues an asynchronous glReadPixels of the back buffer into
+ *  a free pixel buffer object of a small ring and fences it, right
+ *  after the frame asked for is drawn. Collect(), on later frames, maps
+ *  the readbacks whose fences have signalled, never waiting for one,
+ *  copies the pixels out and hands them to a job that writes the PPM
+ *  (see Image::SavePPM()), so neither the GPU nor the disk holds the
+ *  frame up. A request while every buffer is still in flight is
+ *  refused rather than waited for.
+ *
+ *  The GL calls, buffer mapping included, stay on the main thread:
+ *  the context is only current there.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef SCREENSHOTCAPTURE_HPP
+#define SCREENSHOTCAPTURE_HPP
+
+#include "JobSystem.hpp"
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <string>
+
+class ScreenshotCapture{
+public:
+    // Screenshots that can be in flight at once
+    static const unsigned int SLOTS = 4;
+
+    // Constructor
+    ScreenshotCapture();
+    // Destructor
+    // Note: Call Release() while the GL context is alive.
+    ~ScreenshotCapture();
+    // Screenshots are written into directory, the working one by default
+    inline void SetDirectory(const std::string& directory){
+        m_directory = directory;
+    }
+    // Asks for the next frame drawn to be saved
+    inline void Request(){
+        m_requested = true;
+    }
+    // Reads back the lower left width x height pixels of the back buffer,
+    // if a screenshot was asked for; call after the frame is drawn
+    void Capture(int width, int height);
+    // Hands every readback the GPU has finished to a writing job
+    void Collect();
+    // True while a readback is in flight
+    bool IsBusy() const;
+    // Waits for the readbacks in flight and the files being written, then
+    // deletes the buffers
+    void Release();
+private:
+    struct Slot{
+        GLuint buffer;
+        size_t bytes;       // Allocated size of the buffer
+        GLsync fence;       // Set while a readback is in flight
+        int width;
+        int height;
+        std::string path;
+    };
+    // Maps a slot's finished readback and queues its file. With wait set
+    // it blocks until the GPU is done, otherwise it gives up if not done.
+    bool Finish(Slot& slot, bool wait);
+    // File name of the next screenshot
+    std::string NextPath();
+
+    Slot m_slots[SLOTS] = {};
+    std::string m_directory{"."};
+    bool m_requested{false};
+    unsigned int m_taken{0};
+    // Counts the files being written
+    JobCounter m_writes;
+};
+
+#endif
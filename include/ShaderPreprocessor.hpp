@@ -0,0 +1,33 @@
+/** @file ShaderPreprocessor.hpp
+ *  @brief Expands #include and injects #define lines into GLSL sources.
+ *
+ *  GLSL has no #include, so shaders that share declarations would have
+ *  to repeat them. PreprocessShader() reads a shader and replaces every
+ *  line #include "file" with that file, resolved relative to the file
+ *  that includes it. This is a textual pass before the GLSL
+ *  preprocessor runs: an #include inside #ifdef is expanded anyway.
+ *  Every file is included once, so a file including itself, or two
+ *  files including each other, cannot recurse.
+ *
+ *  The defines, each a NAME or NAME VALUE, are inserted as #define lines
+ *  right after the #version line, which has to stay first. #line
+ *  directives keep the compiler's messages pointing at the right line:
+ *  the source string number of a message is the file's index in the
+ *  list PreprocessShader() returns, 0 for the shader itself.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef SHADERPREPROCESSOR_HPP
+#define SHADERPREPROCESSOR_HPP
+
+#include <string>
+#include <vector>
+
+// Reads the shader at path into source with every #include expanded and
+// the defines inserted. files, if given, receives every file read, path
+// first. Returns false if the shader or one of its includes cannot be
+// read, or an #include names no file.
+bool PreprocessShader(const std::string& path, const std::vector<std::string>& defines,
+                      std::string& source, std::vector<std::string>* files = nullptr);
+
+#endif
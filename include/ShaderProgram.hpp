@@ -0,0 +1,140 @@
+/** @file ShaderProgram.hpp
+ *  @brief Compiles and links a graphics pipeline once.
+ *
+ *  A ShaderProgram owns its GL program object. All active uniform
+ *  locations are looked up a single time right after linking, so the
+ *  frame loop never has to query the driver by name. When the
+ *  ProgramCache is enabled, a program linked on an earlier launch is
+ *  loaded from its driver binary instead of being compiled.
+ *
+ *  A program may capture vertex shader outputs with transform feedback:
+ *  name them with SetFeedbackVaryings() before building. Such a program
+ *  may also leave out the fragment shader, for passes that only write
+ *  buffers. SetGeometryShader() adds a geometry stage between the two,
+ *  which is how a pass emits fewer primitives than it reads.
+ *
+ *  LoadFromFiles() reads its files through the ShaderPreprocessor, so
+ *  they may #include shared files, and takes the defines that select
+ *  one variant of them; ShaderVariants keeps every variant a pipeline
+ *  needs.
+ *
+ *  A build may also be split in two: BeginBuild() hands the sources to
+ *  the driver and returns without asking how it went, FinishBuild()
+ *  asks. Nothing in between waits, so many programs begun one after the
+ *  other compile together on a driver that compiles on its own threads.
+ *  With GL_KHR_parallel_shader_compile (see EnableParallelCompile())
+ *  IsBuildComplete() tells when FinishBuild() will not block; without
+ *  it, it always says yes and FinishBuild() waits as Build() did.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef SHADERPROGRAM_HPP
+#define SHADERPROGRAM_HPP
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class ShaderProgram{
+public:
+    // Constructor
+    ShaderProgram();
+    // Destructor
+    // Note: Call Release() while the GL context is alive.
+    ~ShaderProgram();
+    // Shader programs own a GL handle, so they are not copyable.
+    ShaderProgram(const ShaderProgram&) = delete;
+    ShaderProgram& operator=(const ShaderProgram&) = delete;
+    // Loads, compiles and links a vertex and a fragment shader from disk,
+    // with their includes expanded and the defines inserted into both.
+    // Returns false if any stage fails.
+    bool LoadFromFiles(const std::string& vertexPath, const std::string& fragmentPath,
+                       const std::vector<std::string>& defines = std::vector<std::string>());
+    // Compiles and links from source strings, or loads the program from
+    // the ProgramCache if these sources were linked before. An empty
+    // fragmentSource links the vertex shader alone.
+    bool Build(const std::string& vertexSource, const std::string& fragmentSource);
+    // LoadFromFiles() and Build() up to the point where they would wait on
+    // the driver; false if a file could not be read. FinishBuild() ends it.
+    bool BeginLoadFromFiles(const std::string& vertexPath, const std::string& fragmentPath,
+                            const std::vector<std::string>& defines = std::vector<std::string>());
+    bool BeginBuild(const std::string& vertexSource, const std::string& fragmentSource);
+    // True unless a begun build is still compiling or linking. Never waits.
+    bool IsBuildComplete() const;
+    // Waits for the begun build, then replaces the program with it.
+    // Returns false, keeping the previous program, if any stage failed.
+    bool FinishBuild();
+    // Vertex shader outputs captured, interleaved in this order, into the
+    // buffer bound to GL_TRANSFORM_FEEDBACK_BUFFER; applies from the next
+    // build on
+    inline void SetFeedbackVaryings(const std::vector<std::string>& varyings){
+        m_feedbackVaryings = varyings;
+    }
+    // Geometry shader linked between the vertex and fragment shaders, or
+    // none if empty (the default); applies from the next build on. With
+    // feedback varyings, they name its outputs.
+    inline void SetGeometryShader(const std::string& source){
+        m_geometrySource = source;
+    }
+    // Make this the active program
+    void Use() const;
+    // Returns the cached location of a uniform, or -1 if the
+    // uniform does not exist (or was optimised away).
+    GLint GetUniformLocation(const std::string& name) const;
+    // Returns the GL program object
+    inline GLuint GetID() const{
+        return m_programID;
+    }
+    // Every file the last LoadFromFiles() read, includes too; what an
+    // edit has to rebuild this program for
+    inline const std::vector<std::string>& GetSourceFiles() const{
+        return m_sourceFiles;
+    }
+    // True once a program has been linked successfully
+    inline bool IsValid() const{
+        return m_programID != 0;
+    }
+    // Delete the GL program object
+    void Release();
+
+    // Reads a shader file and returns it as a single string
+    static std::string LoadShaderAsString(const std::string& filename);
+    // Lets the driver compile and link on as many threads as it likes,
+    // where it has GL_KHR_parallel_shader_compile or the ARB one. Call
+    // once after the GL loader is initialized; false if it has neither.
+    static bool EnableParallelCompile();
+private:
+    // Starts compiling a single shader stage
+    static GLuint CompileShader(GLuint type, const std::string& source);
+    // Reports the log of a stage that did not compile, true if it did
+    static bool CheckShader(GLuint type, GLuint shaderObject);
+    // Deletes the objects of a begun build; its program too unless
+    // deleteProgram is false, once it became this one
+    void DiscardBuild(bool deleteProgram = true);
+    // Queries every active uniform once after linking
+    void CacheUniformLocations();
+
+    // Unique id for the program object
+    GLuint m_programID{0};
+    // Uniform name -> location, filled once at link time
+    std::unordered_map<std::string, GLint> m_uniformLocations;
+    // Outputs captured by transform feedback, none for most programs
+    std::vector<std::string> m_feedbackVaryings;
+    std::string m_geometrySource;
+    std::vector<std::string> m_sourceFiles;
+    // A build begun and not finished, if m_pendingProgram is not 0: its
+    // stages (none for a program from the ProgramCache), key and files
+    GLuint m_pendingProgram{0};
+    GLuint m_pendingVertex{0};
+    GLuint m_pendingFragment{0};
+    GLuint m_pendingGeometry{0};
+    uint64_t m_pendingKey{0};
+    std::vector<std::string> m_pendingVertexFiles;
+    std::vector<std::string> m_pendingFragmentFiles;
+    bool m_pendingCached{false};
+};
+
+#endif
@@ -0,0 +1,89 @@
+/** @file ShaderVariants.hpp
+ *  @brief Every permutation of one pair of shaders, built up front.
+ *
+ *  A pipeline whose shaders branch on #ifdef FEATURE instead of on a
+ *  uniform needs one program per combination of features. Features are
+ *  named once with SetFeatures(); bit i of a variant's mask defines the
+ *  i-th feature. Build() compiles every mask a pipeline will use, at
+ *  load time, and Get() then only looks a mask up: switching variants
+ *  in the frame loop binds another program and never compiles one.
+ *  A mask that was not built returns nullptr rather than stalling.
+ *
+ *  Build() and Rebuild() replace the variants only once all of them
+ *  built, so a shader edit that breaks one variant keeps them all.
+ *
+ *  BeginBuild() starts every variant before any is waited for, so they
+ *  compile side by side where the driver compiles in parallel (see
+ *  ShaderProgram::EnableParallelCompile()). The loading screen polls
+ *  IsBuildComplete() between frames and calls FinishBuild() once it is
+ *  true; Build() is the two back to back.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef SHADERVARIANTS_HPP
+#define SHADERVARIANTS_HPP
+
+#include "ShaderProgram.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class ShaderVariants{
+public:
+    // Constructor
+    ShaderVariants();
+    // Destructor
+    // Note: Call Release() while the GL context is alive.
+    ~ShaderVariants();
+    // Defines, each a NAME or NAME VALUE, that bit i of a mask stands for
+    inline void SetFeatures(const std::vector<std::string>& features){
+        m_features = features;
+    }
+    // Builds the variant of vertexPath and fragmentPath for every mask.
+    // Returns false, keeping the previous variants, if any fails.
+    bool Build(const std::string& vertexPath, const std::string& fragmentPath,
+               const std::vector<uint32_t>& masks);
+    // Starts building every mask without waiting for any. Returns false,
+    // with nothing begun, if a file could not be read.
+    bool BeginBuild(const std::string& vertexPath, const std::string& fragmentPath,
+                    const std::vector<uint32_t>& masks);
+    // True once FinishBuild() would not wait on the driver
+    bool IsBuildComplete() const;
+    // Ends the begun build as Build() would
+    bool FinishBuild();
+    // Builds the same masks again after an edit to the shaders
+    bool Rebuild();
+    // The variant for mask, nullptr if it was not built
+    const ShaderProgram* Get(uint32_t mask) const;
+    // Variants built
+    inline size_t GetCount() const{
+        return m_programs.size();
+    }
+    // Every file the variants were built from, includes too
+    inline const std::vector<std::string>& GetSourceFiles() const{
+        return m_sourceFiles;
+    }
+    // Deletes every variant
+    void Release();
+private:
+    // The defines of a mask
+    std::vector<std::string> GetDefines(uint32_t mask) const;
+
+    std::vector<std::string> m_features;
+    std::string m_vertexPath;
+    std::string m_fragmentPath;
+    std::vector<uint32_t> m_masks;
+    // The build begun and not finished, and what it was begun for
+    std::unordered_map<uint32_t, std::unique_ptr<ShaderProgram>> m_pending;
+    std::string m_pendingVertexPath;
+    std::string m_pendingFragmentPath;
+    std::vector<uint32_t> m_pendingMasks;
+    // Mask -> its program
+    std::unordered_map<uint32_t, std::unique_ptr<ShaderProgram>> m_programs;
+    std::vector<std::string> m_sourceFiles;
+};
+
+#endif
@@ -0,0 +1,171 @@
+/** @file SharedEnvironment.hpp
+ *  @brief Observation/action exchange with an external trainer through
+ *         shared memory.
+ *
+ *  A server (tools/dinoserve.cpp) creates a POSIX shared memory object
+ *  holding a SharedEnvironmentHeader followed by fixed-layout arrays
+ *  for a batch of environments: observations, rewards, done flags and
+ *  actions. Nothing is serialised; both sides read and write the arrays
+ *  in place. A step is a doorbell handshake on two sequence numbers in
+ *  the header: the trainer writes actions and bumps requestSequence,
+ *  the server steps every environment, writes the results and bumps
+ *  responseSequence. A waiting side spins briefly and only then sleeps
+ *  on a futex, and a futex wake is only issued when the other side is
+ *  actually asleep, so a busy training loop makes no syscalls per step.
+ *
+ *  Layout (all offsets in bytes from the start of the mapping, every
+ *  array 64-byte aligned, little endian):
+ *    observations  int32[environmentCount][OBSERVATION_SIZE]
+ *    rewards       float32[environmentCount]
+ *    dones         uint8[environmentCount]
+ *    actions       int32[environmentCount] (GameAction)
+ *    pixels        uint8[environmentCount][pixelHeight][pixelWidth][pixelChannels]
+ *    features      float32[environmentCount][featureSize]
+ *
+ *  The pixels are only there when the server renders observations
+ *  (pixelWidth is 0 otherwise): grayscale or RGB rows, bottom row first.
+ *  The features are only there when the server writes feature rows
+ *  (featureSize is 0 otherwise), laid out as in FeatureObservation.hpp
+ *  with featureObstacles obstacle distances.
+ *
+ *  The server advises the mapping for huge pages, which Linux grants to
+ *  shared memory when /sys/kernel/mm/transparent_hugepage/shmem_enabled
+ *  is advise or always.
+ *
+ *  Only implemented on Linux; elsewhere Create() and Open() fail.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef SHAREDENVIRONMENT_HPP
+#define SHAREDENVIRONMENT_HPP
+
+#include "GameState.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// "DINO"
+const uint32_t SHARED_ENVIRONMENT_MAGIC = 0x4f4e4944;
+const uint32_t SHARED_ENVIRONMENT_VERSION = 3;
+
+// Columns of one environment's observation row
+enum ObservationField{
+    OBS_DINO_HEIGHT,
+    OBS_IS_JUMPING,         // 0 or 1
+    OBS_JUMPING_SPEED,
+    OBS_CACTUS_POSITION,    // Lead obstacle, see GetLeadObstacle()
+    OBS_CACTUS_SPEED,
+    OBS_TICK,
+    OBSERVATION_SIZE
+};
+
+// Writes the OBSERVATION_SIZE columns of state into row
+void WriteObservation(const GameState& state, int32_t* row);
+
+struct SharedEnvironmentHeader{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t environmentCount;
+    uint32_t observationSize;
+    uint64_t observationOffset;
+    uint64_t rewardOffset;
+    uint64_t doneOffset;
+    uint64_t actionOffset;
+    uint64_t pixelOffset;
+    uint32_t pixelWidth;
+    uint32_t pixelHeight;
+    uint32_t pixelChannels;
+    uint32_t pixelPadding;
+    uint64_t featureOffset;
+    uint32_t featureSize;
+    uint32_t featureObstacles;
+    uint64_t totalSize;
+    // Bumped by the trainer when the actions are ready
+    uint32_t requestSequence;
+    // Bumped by the server when the step results are ready
+    uint32_t responseSequence;
+    // Non-zero while that side sleeps on the futex and needs a wake
+    uint32_t requestWaiting;
+    uint32_t responseWaiting;
+    // Set by the trainer (followed by a request) to stop the server
+    uint32_t shutdown;
+    uint32_t padding;
+};
+
+class SharedEnvironment{
+public:
+    // Constructor
+    SharedEnvironment();
+    // Destructor
+    ~SharedEnvironment();
+    // Server side: creates (or replaces) the object, name starts with '/'.
+    // A pixel size of 0 leaves out the pixel observations, and 0
+    // featureObstacles the feature rows.
+    bool Create(const std::string& name, size_t environmentCount,
+                int pixelWidth=0, int pixelHeight=0, int pixelChannels=0, size_t featureObstacles=0);
+    // Trainer side: maps an object created by a server
+    bool Open(const std::string& name);
+
+    // Server: waits for the trainer's next request, false on shutdown
+    bool WaitForRequest();
+    // Server: announces that the results of the step are written
+    void Respond();
+    // Trainer: announces that the actions are written
+    void Request();
+    // Trainer: waits until the server answered the last Request()
+    void WaitForResponse();
+
+    inline size_t GetEnvironmentCount() const{
+        return m_header ? m_header->environmentCount : 0;
+    }
+    inline int32_t* GetObservations() const{
+        return (int32_t*)(m_memory + m_header->observationOffset);
+    }
+    inline float* GetRewards() const{
+        return (float*)(m_memory + m_header->rewardOffset);
+    }
+    inline uint8_t* GetDones() const{
+        return m_memory + m_header->doneOffset;
+    }
+    inline int32_t* GetActions() const{
+        return (int32_t*)(m_memory + m_header->actionOffset);
+    }
+    // One environment's frame after another, nullptr without pixels
+    inline uint8_t* GetPixels() const{
+        return (m_header && m_header->pixelWidth > 0) ? m_memory + m_header->pixelOffset : nullptr;
+    }
+    inline size_t GetPixelFrameSize() const{
+        return (size_t)m_header->pixelWidth * m_header->pixelHeight * m_header->pixelChannels;
+    }
+    // One environment's feature row after another, nullptr without them
+    inline float* GetFeatures() const{
+        return (m_header && m_header->featureSize > 0) ? (float*)(m_memory + m_header->featureOffset) : nullptr;
+    }
+    inline size_t GetFeatureSize() const{
+        return m_header ? m_header->featureSize : 0;
+    }
+    inline SharedEnvironmentHeader* GetHeader() const{
+        return m_header;
+    }
+    // Unmaps the memory, the creator also removes the object
+    void Release();
+private:
+    SharedEnvironment(const SharedEnvironment&) = delete;
+    SharedEnvironment& operator=(const SharedEnvironment&) = delete;
+
+    // Waits until *word differs from seen. waiting is raised while asleep.
+    static void WaitForChange(uint32_t* word, uint32_t seen, uint32_t* waiting);
+    // Increments *word and wakes the other side if it is asleep
+    static void Ring(uint32_t* word, uint32_t* waiting);
+
+    uint8_t* m_memory{nullptr};
+    SharedEnvironmentHeader* m_header{nullptr};
+    size_t m_size{0};
+    std::string m_name;
+    bool m_owner{false};
+    // Last sequence number this side has seen from the other
+    uint32_t m_seen{0};
+};
+
+#endif
@@ -0,0 +1,120 @@
+/** @file SimdLanes.hpp
+ *  @brief Thin wrappers over 32-bit integer vector instructions.
+ *
+ *  Branch-free kernels are written once against these wrappers and
+ *  instantiated for VectorLanes (AVX2 with 8 lanes when compiled with
+ *  -mavx2, SSE2 with 4 lanes on any x86-64, NEON with 4 lanes on
+ *  AArch64) and for ScalarLanes, which handles the remainder that does
+ *  not fill a vector. Mul keeps the low 32 bits of the product. Masks are lanes of all zeros or all ones;
+ *  AndNot(a, b) is (~a & b) and Select(m, a, b) picks a where m is set.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef SIMDLANES_HPP
+#define SIMDLANES_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+// One lane, for whatever is left over after the vector blocks
+struct ScalarLanes{
+    typedef int V;
+    static const size_t WIDTH = 1;
+    static inline V Load(const void* p){ V v; std::memcpy(&v, p, sizeof(v)); return v; }
+    static inline void Store(void* p, V v){ std::memcpy(p, &v, sizeof(v)); }
+    static inline V Set(int x){ return x; }
+    static inline V Add(V a, V b){ return a + b; }
+    static inline V Sub(V a, V b){ return a - b; }
+    static inline V Mul(V a, V b){ return (int)((uint32_t)a * (uint32_t)b); }
+    static inline V And(V a, V b){ return a & b; }
+    static inline V Or(V a, V b){ return a | b; }
+    static inline V Xor(V a, V b){ return a ^ b; }
+    static inline V AndNot(V a, V b){ return ~a & b; }
+    static inline V Eq(V a, V b){ return -(int)(a == b); }
+    static inline V Gt(V a, V b){ return -(int)(a > b); }
+    static inline V Select(V m, V a, V b){ return (m & a) | (~m & b); }
+    static inline bool Any(V m){ return m != 0; }
+};
+
+#if defined(__AVX2__)
+struct VectorLanes{
+    typedef __m256i V;
+    static const size_t WIDTH = 8;
+    static inline V Load(const void* p){ return _mm256_loadu_si256((const __m256i*)p); }
+    static inline void Store(void* p, V v){ _mm256_storeu_si256((__m256i*)p, v); }
+    static inline V Set(int x){ return _mm256_set1_epi32(x); }
+    static inline V Add(V a, V b){ return _mm256_add_epi32(a, b); }
+    static inline V Sub(V a, V b){ return _mm256_sub_epi32(a, b); }
+    static inline V Mul(V a, V b){ return _mm256_mullo_epi32(a, b); }
+    static inline V And(V a, V b){ return _mm256_and_si256(a, b); }
+    static inline V Or(V a, V b){ return _mm256_or_si256(a, b); }
+    static inline V Xor(V a, V b){ return _mm256_xor_si256(a, b); }
+    static inline V AndNot(V a, V b){ return _mm256_andnot_si256(a, b); }
+    static inline V Eq(V a, V b){ return _mm256_cmpeq_epi32(a, b); }
+    static inline V Gt(V a, V b){ return _mm256_cmpgt_epi32(a, b); }
+    static inline V Select(V m, V a, V b){ return _mm256_blendv_epi8(b, a, m); }
+    static inline bool Any(V m){ return _mm256_movemask_epi8(m) != 0; }
+    static const char* Name(){ return "AVX2"; }
+};
+#elif defined(__SSE2__)
+struct VectorLanes{
+    typedef __m128i V;
+    static const size_t WIDTH = 4;
+    static inline V Load(const void* p){ return _mm_loadu_si128((const __m128i*)p); }
+    static inline void Store(void* p, V v){ _mm_storeu_si128((__m128i*)p, v); }
+    static inline V Set(int x){ return _mm_set1_epi32(x); }
+    static inline V Add(V a, V b){ return _mm_add_epi32(a, b); }
+    static inline V Sub(V a, V b){ return _mm_sub_epi32(a, b); }
+    // SSE2 only multiplies the even lanes into 64 bits; do both halves
+    // and keep the low words
+    static inline V Mul(V a, V b){
+        V even = _mm_mul_epu32(a, b);
+        V odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+        return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                                  _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+    }
+    static inline V And(V a, V b){ return _mm_and_si128(a, b); }
+    static inline V Or(V a, V b){ return _mm_or_si128(a, b); }
+    static inline V Xor(V a, V b){ return _mm_xor_si128(a, b); }
+    static inline V AndNot(V a, V b){ return _mm_andnot_si128(a, b); }
+    static inline V Eq(V a, V b){ return _mm_cmpeq_epi32(a, b); }
+    static inline V Gt(V a, V b){ return _mm_cmpgt_epi32(a, b); }
+    // SSE2 has no blend instruction
+    static inline V Select(V m, V a, V b){ return _mm_or_si128(_mm_and_si128(m, a), _mm_andnot_si128(m, b)); }
+    static inline bool Any(V m){ return _mm_movemask_epi8(m) != 0; }
+    static const char* Name(){ return "SSE2"; }
+};
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+struct VectorLanes{
+    typedef int32x4_t V;
+    static const size_t WIDTH = 4;
+    static inline V Load(const void* p){ return vld1q_s32((const int32_t*)p); }
+    static inline void Store(void* p, V v){ vst1q_s32((int32_t*)p, v); }
+    static inline V Set(int x){ return vdupq_n_s32(x); }
+    static inline V Add(V a, V b){ return vaddq_s32(a, b); }
+    static inline V Sub(V a, V b){ return vsubq_s32(a, b); }
+    static inline V Mul(V a, V b){ return vmulq_s32(a, b); }
+    static inline V And(V a, V b){ return vandq_s32(a, b); }
+    static inline V Or(V a, V b){ return vorrq_s32(a, b); }
+    static inline V Xor(V a, V b){ return veorq_s32(a, b); }
+    static inline V AndNot(V a, V b){ return vbicq_s32(b, a); }
+    static inline V Eq(V a, V b){ return vreinterpretq_s32_u32(vceqq_s32(a, b)); }
+    static inline V Gt(V a, V b){ return vreinterpretq_s32_u32(vcgtq_s32(a, b)); }
+    static inline V Select(V m, V a, V b){ return vbslq_s32(vreinterpretq_u32_s32(m), a, b); }
+    static inline bool Any(V m){ return vmaxvq_u32(vreinterpretq_u32_s32(m)) != 0; }
+    static const char* Name(){ return "NEON"; }
+};
+#else
+struct VectorLanes : ScalarLanes{
+    static const char* Name(){ return "scalar"; }
+};
+#endif
+
+#endif
@@ -0,0 +1,120 @@
+/** @file Skeleton.hpp
+ *  @brief Joints and animation clips of a rig, and a mesh skinned to it.
+ *
+ *  A rig (.rig, a text file next to its model) names the joints of a
+ *  mesh in the mesh's own model space and the clips that rotate them:
+ *
+ *      joint <name> <parent or -> <head x y z> <tail x y z>
+ *      clip <name> <seconds>
+ *      key <joint> <seconds> <rotation x y z degrees> [<offset x y z>]
+ *
+ *  A joint turns about its head; the bone from head to tail is what
+ *  vertices are bound to. Parents come before their children. Keys
+ *  belong to the clip above them and are in time order per joint; a
+ *  clip loops, from its last key of a joint back to the first, and a
+ *  joint without keys keeps its rest pose.
+ *
+ *  OBJ carries no weights, so BindVertices() works them out: every
+ *  vertex follows the SKIN_INFLUENCES bones nearest to it, weighted by
+ *  the inverse square of the squared distance, so a vertex well inside
+ *  one part follows that part alone and vertices between two parts
+ *  blend. Sample() evaluates a clip into the skinning transform of every
+ *  joint, three rows of an affine matrix each, which is the whole
+ *  per-frame cost of a pose: 48 bytes a joint.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef SKELETON_HPP
+#define SKELETON_HPP
+
+#include "glm/glm.hpp"
+#include "glm/gtc/quaternion.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Most joints a rig may have, as many as the FrameData block holds
+const size_t MAX_SKIN_JOINTS = 16;
+// Joints a vertex follows
+const size_t SKIN_INFLUENCES = 4;
+
+// The joints one vertex follows, heaviest first, and their weights in
+// 255ths summing to 255. All weights are 0 for a vertex no joint moves.
+struct SkinVertex{
+    uint8_t joints[SKIN_INFLUENCES];
+    uint8_t weights[SKIN_INFLUENCES];
+};
+
+static_assert(sizeof(SkinVertex) == 8, "SkinVertex must stay tightly packed");
+
+struct SkeletonJoint{
+    std::string name;
+    // Index of the parent, always lower than the joint's; -1 for a root
+    int32_t parent{-1};
+    // The pivot and the end of the bone, in model space at rest
+    glm::vec3 head{0.0f};
+    glm::vec3 tail{0.0f};
+};
+
+// A joint's pose at one time, relative to its rest pose
+struct JointKey{
+    float time{0.0f};
+    glm::quat rotation{1.0f, 0.0f, 0.0f, 0.0f};
+    glm::vec3 offset{0.0f};
+};
+
+struct AnimationClip{
+    std::string name;
+    float duration{0.0f};
+    // Keys of every joint in time order, empty for joints it leaves at rest
+    std::vector<std::vector<JointKey>> keys;
+};
+
+class Skeleton{
+public:
+    // Constructor
+    Skeleton();
+    // Destructor
+    ~Skeleton();
+    // Reads a rig, replacing the current one. Returns false, leaving the
+    // skeleton empty, if it is missing or malformed.
+    bool Load(const std::string& filepath);
+    // Removes every joint and clip
+    void Clear();
+
+    inline bool IsEmpty() const{
+        return m_joints.empty();
+    }
+    inline size_t GetJointCount() const{
+        return m_joints.size();
+    }
+    inline const SkeletonJoint& GetJoint(size_t joint) const{
+        return m_joints[joint];
+    }
+    inline size_t GetClipCount() const{
+        return m_clips.size();
+    }
+    inline const AnimationClip& GetClip(size_t clip) const{
+        return m_clips[clip];
+    }
+    // Index of the clip called name, -1 if there is none
+    int FindClip(const std::string& name) const;
+
+    // Binds vertexCount interleaved vertices (FLOATS_PER_VERTEX floats,
+    // position first) to the bones nearest to them
+    void BindVertices(const float* interleaved, size_t vertexCount, SkinVertex* out) const;
+    // Writes the skinning transform of every joint at time seconds into
+    // clip to rows, three rows of the affine matrix a joint: 3 *
+    // GetJointCount() entries
+    void Sample(size_t clip, float time, glm::vec4* rows) const;
+private:
+    // Index of the joint called name, -1 if there is none
+    int FindJoint(const std::string& name) const;
+
+    std::vector<SkeletonJoint> m_joints;
+    std::vector<AnimationClip> m_clips;
+};
+
+#endif
@@ -0,0 +1,50 @@
+/** @file SkinBuffer.hpp
+ *  @brief The joints and weights of every vertex of the scene arena,
+ *  read by the vertex shader from a buffer texture.
+ *
+ *  Skinned and unskinned meshes share the arena and its one vertex
+ *  format, so the skin does not go into the vertex stream. It sits in a
+ *  buffer of its own, one SkinVertex for every arena vertex at the same
+ *  index, read as a GL_RG32UI buffer texture: the vertex shader fetches
+ *  texel gl_VertexID, which includes the draw's base vertex. Vertices of
+ *  unskinned meshes have all weights 0 and are left where they are.
+ *  The joint transforms themselves come with the FrameData block.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef SKINBUFFER_HPP
+#define SKINBUFFER_HPP
+
+#include "Skeleton.hpp"
+
+#include <glad/glad.h>
+
+#include <cstddef>
+
+// Texture unit the scene programs read u_SkinVertices from
+const unsigned int SKIN_VERTEX_UNIT = 2;
+
+class SkinBuffer{
+public:
+    // Constructor
+    SkinBuffer();
+    // Destructor
+    // Note: Call Release() while the GL context is alive.
+    ~SkinBuffer();
+    // Uploads the skin of count arena vertices, replacing the previous
+    void Upload(const SkinVertex* vertices, size_t count);
+    // Binds the buffer texture to SKIN_VERTEX_UNIT. Before any upload
+    // it is bound with nothing in it, so every vertex stays unskinned.
+    void Bind();
+    // Deletes the buffer and its texture
+    void Release();
+private:
+    // Creates the buffer and its texture
+    void Create();
+
+    GLuint m_buffer{0};
+    GLuint m_texture{0};
+    size_t m_bytes{0};
+};
+
+#endif
@@ -0,0 +1,99 @@
+/** @file SkyPass.hpp
+ *  @brief The sky, drawn as one fullscreen triangle after the scene.
+ *
+ *  The backdrop behind the game is a box: a wall at its back and a floor
+ *  along its bottom, textured from the upper and the lower half of one
+ *  texture array layer. Instead of drawing it as geometry, a triangle
+ *  covering the screen is made from gl_VertexID, with no vertex buffer,
+ *  and its fragment shader casts each pixel's view ray at the wall and
+ *  the floor to find what the geometry would have shown there.
+ *
+ *  The triangle sits on the far plane and is drawn after the opaque
+ *  scene with the depth test on and depth writes off, so only pixels
+ *  nothing else covered are shaded; early depth rejection throws the
+ *  rest away before the fragment shader runs.
+ *
+ *  With a VirtualPanorama set, the wall shows the panorama instead of
+ *  the layer's repeating texture, as high as the wall and scrolled
+ *  along with it, wrapping only once its whole width went by. Tiles
+ *  not streamed in yet show the layer as before; the floor and the
+ *  night always do.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef SKYPASS_HPP
+#define SKYPASS_HPP
+
+#include "AABB.hpp"
+#include "ShaderProgram.hpp"
+
+#include <glad/glad.h>
+#include "glm/glm.hpp"
+
+#include <string>
+
+class VirtualPanorama;
+
+// What the sky samples in a frame
+struct SkyLayers{
+    // Texture array layers by day and by night
+    float day{0.0f};
+    float night{0.0f};
+};
+
+class SkyPass{
+public:
+    // Constructor
+    SkyPass();
+    // Destructor
+    // Note: Call Release() while the GL context is alive.
+    ~SkyPass();
+    // Builds the shaders and the empty vertex array the triangle is
+    // drawn with. Must be called after the GL loader is initialized.
+    bool Initialize(const std::string& vertexPath, const std::string& fragmentPath);
+    // Rebuilds the shaders from their files; the previous ones stay in
+    // use if the new ones do not build
+    bool ReloadShaders(const std::string& vertexPath, const std::string& fragmentPath);
+    // The box the wall and the floor span, in world units
+    inline void SetBounds(const AABB& bounds){
+        m_bounds = bounds;
+    }
+    // True once Initialize() succeeded
+    inline bool IsReady() const{
+        return m_vao != 0;
+    }
+    // Draws the wall from panorama, nullptr for the layer again
+    inline void SetPanorama(VirtualPanorama* panorama){
+        m_panorama = panorama;
+    }
+    // Moves the panorama to wallScroll wall widths along and streams the
+    // tiles it shows and those ahead; once a frame, before Draw(). Goes
+    // back to the layer if the panorama's cache cannot hold the wall.
+    void StreamPanorama(double wallScroll);
+    // Draws the sky behind what the bound framebuffer holds, sampling the
+    // texture array bound to slot 0, with the camera, time of day and
+    // scroll of the frame's FrameUniforms. Expects depth testing on.
+    void Draw(const SkyLayers& layers);
+    // Deletes the GL objects
+    void Release();
+private:
+    ShaderProgram m_program;
+    GLint m_textureLocation{-1};
+    GLint m_layersLocation{-1};
+    GLint m_boundsMinLocation{-1};
+    GLint m_boundsMaxLocation{-1};
+    GLint m_panoramaLocation{-1};
+    GLint m_panoramaTableLocation{-1};
+    GLint m_panoramaSizeLocation{-1};
+    GLint m_panoramaViewLocation{-1};
+    GLint m_panoramaTilesLocation{-1};
+    // Core profiles draw nothing without a vertex array, even an empty one
+    GLuint m_vao{0};
+    AABB m_bounds;
+    VirtualPanorama* m_panorama{nullptr};
+    // Panorama texel at the wall's left edge, and the wall's width in them
+    float m_panoramaFirst{0.0f};
+    float m_panoramaWidth{0.0f};
+};
+
+#endif
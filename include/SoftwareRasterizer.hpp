@@ -0,0 +1,190 @@
+/** @file SoftwareRasterizer.hpp
+ *  @brief CPU renderer of the scene for observations on nodes without a GPU.
+ *
+ *  Draws the same meshes (ObjLoader triangles) with the same textures
+ *  (Image pixels, bottom row first, padded to RGBA) as the game, into a
+ *  small frame such as 84x84 or 160x120. Every instance is transformed
+ *  and clipped against the near and far planes and a guard band on one
+ *  thread, snapped to 28.4 fixed point and binned into 16x16 pixel
+ *  tiles in submission order. The tiles are then shaded as ThreadPool
+ *  tasks: integer edge functions with a top-left fill rule decide the
+ *  coverage of several pixels at a time (see SimdLanes.hpp), and the
+ *  covered pixels get a depth test and a perspective-correct, nearest
+ *  texel fetch. Both windings are drawn, as the game does not cull.
+ *
+ *  No pixel depends on how the tiles were spread over the threads, so
+ *  the same frame comes out byte for byte the same on every run. The
+ *  result is packed like PixelObserver's: 8-bit grayscale or RGB rows,
+ *  bottom row first.
+ *
+ *  Meshes and textures are either copied in (AddMesh(), AddTexture()) or,
+ *  cooked by ./dinopack into the asset pack, drawn straight from the
+ *  pack's mapping (AddCookedMesh(), AddCookedTexture()). Every training
+ *  process on a host then shares one copy of the scene in the page
+ *  cache, and the rasterizer itself keeps no asset bytes. Cooked files
+ *  sit next to their sources under CookedMeshPathFor() and
+ *  CookedTexturePathFor(). A mesh keeps its positions apart from its
+ *  texture coordinates, so the transform and the rejection of triangles
+ *  outside the view read 12 bytes a corner and only the triangles left
+ *  read their texture coordinates. Cooked files are laid out as:
+ *
+ *      CookedAssetHeader ("DCRN": width is the corner count, height 0)
+ *      float positions[width][3], x, y, z
+ *      float uvs[width][2], u, v
+ *
+ *      CookedAssetHeader ("DRGB": width and height of the texture)
+ *      uint8_t rgba[height][width][4], bottom row first
+ *
+ *  @bug No known bugs.
+ */
+#ifndef SOFTWARERASTERIZER_HPP
+#define SOFTWARERASTERIZER_HPP
+
+#include "ObjLoader.hpp"
+#include "ThreadPool.hpp"
+
+#include "glm/glm.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Leads a cooked mesh or texture; 16 bytes, so what follows it keeps the
+// pack's alignment
+struct CookedAssetHeader{
+    char magic[4];      // "DCRN" or "DRGB"
+    uint32_t version;   // COOKED_ASSET_VERSION
+    uint32_t width;
+    uint32_t height;
+};
+
+const uint32_t COOKED_ASSET_VERSION = 2;
+
+// One mesh to draw: where, how large and with which texture
+struct SoftwareInstance{
+    int mesh;
+    int texture;
+    // Offset and uniform scale of the mesh, like a scene Transform
+    float x, y, z, scale;
+    // Subtracted from every texture U, like the shader's palette and
+    // scroll offsets
+    float uShift;
+};
+
+class SoftwareRasterizer{
+public:
+    // Largest frame side, which keeps the edge functions within 32 bits
+    static const int MAX_SIZE = 512;
+
+    // Constructor
+    SoftwareRasterizer();
+    // Destructor
+    ~SoftwareRasterizer();
+    // Keeps a copy of a mesh, returns its id
+    int AddMesh(Span<Triangle> triangles);
+    // Keeps a copy of RGBA pixels, bottom row first, returns its id
+    int AddTexture(const uint8_t* rgba, int width, int height);
+    // Draws a cooked mesh or texture in place; the size bytes at data must
+    // outlive the rasterizer. Returns its id, -1 if it is not one.
+    int AddCookedMesh(const char* data, size_t size);
+    int AddCookedTexture(const char* data, size_t size);
+    // The cooked forms of a mesh and of RGBA pixels
+    static std::vector<char> CookMesh(Span<Triangle> triangles);
+    static std::vector<char> CookTexture(const uint8_t* rgba, int width, int height);
+    // Where the cooked form of an .obj or a .ppm is packed
+    static std::string CookedMeshPathFor(const std::string& objPath);
+    static std::string CookedTexturePathFor(const std::string& imagePath);
+    // Bytes of the meshes and textures copied in, not those drawn in place
+    size_t GetOwnedBytes() const;
+    // Sets the frame size and format, false if the size is out of range
+    bool SetSize(int width, int height, bool grayscale);
+    inline void SetClearColor(uint8_t r, uint8_t g, uint8_t b){
+        m_clear[0] = r;
+        m_clear[1] = g;
+        m_clear[2] = b;
+    }
+    // Draws the instances in order over the clear color. Tiles run on the
+    // pool if there is one, otherwise on the calling thread.
+    void Render(const glm::mat4& viewProjection, const SoftwareInstance* instances,
+                size_t instanceCount, ThreadPool* pool);
+    // The last frame, GetChannels() bytes per pixel
+    inline const uint8_t* GetPixels() const{
+        return m_pixels.data();
+    }
+    inline int GetWidth() const{
+        return m_width;
+    }
+    inline int GetHeight() const{
+        return m_height;
+    }
+    inline int GetChannels() const{
+        return m_grayscale ? 1 : 3;
+    }
+private:
+    static const int TILE_SIZE = 16;
+    // Fractional bits of the screen positions
+    static const int SUBPIXEL_BITS = 4;
+
+    // A clip space corner with its texture coordinates
+    struct ClipVertex{
+        float x, y, z, w;
+        float u, v;
+    };
+    // Three corners a triangle, their positions and then their texture
+    // coordinates, in owned or in the cooked file
+    struct Mesh{
+        const float* positions;
+        const float* uvs;
+        size_t cornerCount;
+        std::vector<float> owned;
+    };
+    struct Texture{
+        const uint8_t* rgba;
+        int width;
+        int height;
+        std::vector<uint8_t> owned;
+    };
+    // A triangle ready to rasterize, counter-clockwise on the screen
+    struct ScreenTriangle{
+        // Fixed point position of every corner
+        int32_t x[3], y[3];
+        // Depth and attributes over w, interpolated linearly on the screen
+        float z[3];
+        float invW[3];
+        float uOverW[3];
+        float vOverW[3];
+        float invArea;
+        int texture;
+        // Pixels the triangle may cover, inclusive
+        int minX, minY, maxX, maxY;
+    };
+
+    // Clips a triangle and queues what is left as screen triangles
+    void AddClipTriangle(const ClipVertex* corners, int texture);
+    // Snaps a clipped triangle to the screen and bins it into its tiles
+    void AddScreenTriangle(const ClipVertex& a, const ClipVertex& b, const ClipVertex& c, int texture);
+    // Clears, draws and packs one tile
+    void RenderTile(size_t tile);
+    // Draws the part of a triangle inside a pixel rectangle (inclusive)
+    void RasterizeTriangle(const ScreenTriangle& triangle, int x0, int y0, int x1, int y1);
+
+    std::vector<Mesh> m_meshes;
+    std::vector<Texture> m_textures;
+    int m_width{0};
+    int m_height{0};
+    bool m_grayscale{true};
+    uint8_t m_clear[3]{0, 0, 0};
+    int m_tilesX{0};
+    int m_tilesY{0};
+    // Triangles of the frame being drawn and the ones touching each tile,
+    // kept between frames so steady frames do not allocate
+    std::vector<ScreenTriangle> m_triangles;
+    std::vector<std::vector<uint32_t>> m_bins;
+    // RGB and depth of every pixel, and the packed frame
+    std::vector<uint8_t> m_color;
+    std::vector<float> m_depth;
+    std::vector<uint8_t> m_pixels;
+};
+
+#endif
@@ -0,0 +1,62 @@
+/** @file Span.hpp
+ *  @brief Read-only view of contiguous elements owned by someone else.
+ *
+ *  A stand-in for C++20's std::span<const T>, as the build is C++17: a
+ *  pointer and a count that can be indexed and iterated like the vector
+ *  it usually points into, without copying it. The view is only valid
+ *  while its owner keeps the elements where they are, so keep a Span
+ *  for as long as the call that reads it, not in a member.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef SPAN_HPP
+#define SPAN_HPP
+
+#include <cstddef>
+#include <vector>
+
+template<typename T>
+class Span{
+public:
+    // Constructor
+    Span(){
+
+    }
+    // Views count elements starting at data
+    Span(const T* data, size_t count) : m_data(data), m_size(count){
+
+    }
+    // Views every element of a vector, whatever its allocator
+    template<typename Allocator>
+    Span(const std::vector<T, Allocator>& elements) : m_data(elements.data()), m_size(elements.size()){
+
+    }
+    // Lower case like the standard containers, so range-for works
+    inline const T* begin() const{
+        return m_data;
+    }
+    inline const T* end() const{
+        return m_data + m_size;
+    }
+    inline const T* data() const{
+        return m_data;
+    }
+    inline size_t size() const{
+        return m_size;
+    }
+    inline bool empty() const{
+        return m_size == 0;
+    }
+    inline const T& operator[](size_t i) const{
+        return m_data[i];
+    }
+    // A copy, for the callers that need to own the elements
+    inline std::vector<T> ToVector() const{
+        return std::vector<T>(m_data, m_data + m_size);
+    }
+private:
+    const T* m_data{nullptr};
+    size_t m_size{0};
+};
+
+#endif
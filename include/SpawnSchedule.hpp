@@ -0,0 +1,108 @@
+/** @file SpawnSchedule.hpp
+ *  @brief Upcoming random spawns of many games, drawn ahead in blocks.
+ *
+ *  The spawns of a game are the only thing its RNG decides, so where
+ *  its obstacles come from is fixed from the moment its RNG is: every
+ *  group picked at random takes an archetype, a gap and a speed roll,
+ *  in that order, from the state's GameRandom. A SpawnSchedule draws
+ *  those ahead, BLOCK_DRAWS spawns at a time, into a fixed block per
+ *  game. A spawn then reads its draws and the RNG after them from the
+ *  block instead of walking the generator, and the block is filled
+ *  again from the RNG once it runs out.
+ *
+ *  A block only stands for the RNG it was drawn from: each game's
+ *  schedule remembers the state its next draw starts from and is
+ *  refilled the moment the game's RNG is anywhere else. A game that is
+ *  reset, set, cloned or loaded from a checkpoint, or whose spawn
+ *  script drew numbers of its own, so simply starts a new block at its
+ *  next spawn: a reset is a cursor that no longer matches, with nothing
+ *  drawn until a spawn needs it. Games stepped from a schedule and
+ *  alone therefore stay identical, RNG included, and a schedule never
+ *  needs saving.
+ *
+ *  Only the draws are scheduled; the rolls that depend on the game, the
+ *  gap within its parameters and the speed below the current one, are
+ *  reduced to their range when the spawn takes them.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef SPAWNSCHEDULE_HPP
+#define SPAWNSCHEDULE_HPP
+
+#include "GameRandom.hpp"
+#include "HugePages.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// The draws of one group picked at random, and the RNG after them
+struct SpawnDraw{
+    GameRandom rng;
+    // Index into GetObstacleArchetypes()
+    int32_t archetype;
+    uint32_t gapRoll;
+    uint32_t speedRoll;
+};
+
+// Draws the next random group from rng, as SpawnObstacles() does
+// (defined in GameState.cpp, with the archetypes)
+SpawnDraw DrawSpawn(GameRandom& rng);
+
+class SpawnSchedule{
+public:
+    // Spawns drawn ahead per game
+    static constexpr uint32_t BLOCK_DRAWS = 8;
+
+    // Constructor
+    SpawnSchedule();
+    // Destructor
+    ~SpawnSchedule();
+    // Changes the number of games; new ones start with nothing drawn
+    void Resize(size_t count);
+    inline size_t GetCount() const{
+        return m_cursor.size();
+    }
+    // DrawSpawn() of game index from rng, out of its block when that
+    // was drawn from where rng stands
+    inline SpawnDraw Take(size_t index, GameRandom& rng){
+        if(m_cursor[index] == BLOCK_DRAWS || !IsSameRandom(m_next[index], rng)){
+            Fill(index, rng);
+        }
+        const SpawnDraw& draw = m_draws[index * BLOCK_DRAWS + m_cursor[index]++];
+        m_next[index] = draw.rng;
+        rng = draw.rng;
+        return draw;
+    }
+    // Blocks drawn so far, to see how far ahead the schedule runs
+    inline uint64_t GetFillCount() const{
+        return m_fills;
+    }
+private:
+    static inline bool IsSameRandom(const GameRandom& a, const GameRandom& b){
+        return a.state == b.state && a.increment == b.increment;
+    }
+    // Draws a new block for game index from rng
+    inline void Fill(size_t index, const GameRandom& rng){
+        GameRandom ahead = rng;
+        SpawnDraw* block = m_draws.data() + index * BLOCK_DRAWS;
+        for(uint32_t i = 0; i < BLOCK_DRAWS; ++i){
+            block[i] = DrawSpawn(ahead);
+        }
+        m_next[index] = rng;
+        m_cursor[index] = 0;
+        ++m_fills;
+    }
+
+    template<typename T>
+    using Column = std::vector<T, HugePageAllocator<T>>;
+
+    // BLOCK_DRAWS per game, the game's draws from m_cursor on still to come
+    Column<SpawnDraw> m_draws;
+    // Where the RNG stands when the next draw of the block is due
+    Column<GameRandom> m_next;
+    Column<uint32_t> m_cursor;
+    uint64_t m_fills{0};
+};
+
+#endif
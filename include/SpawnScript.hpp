@@ -0,0 +1,141 @@
+/** @file SpawnScript.hpp
+ *  @brief Scripted obstacle sequences, resumed once per spawn.
+ *
+ *  A spawn script is a designer's sequence of obstacle groups: "three
+ *  cacti, pause, bird". SpawnObstacles() resumes a game's script
+ *  whenever the lane is due a group, takes the group it yields instead
+ *  of rolling an archetype, and goes back to the random spawner once
+ *  the script returns.
+ *
+ *  Scripts are stackless generators written as plain functions between
+ *  SPAWN_SCRIPT_BEGIN and SPAWN_SCRIPT_END: each SPAWN_YIELD records
+ *  where it stopped in the frame and returns, and the next resume jumps
+ *  back there through a switch, like a coroutine without the compiler's
+ *  help (the build is C++17). Locals do not survive a yield; what a
+ *  script needs across yields lives in the frame's counter and local,
+ *  and random choices come from the game's own RNG, so a scripted game
+ *  replays like any other.
+ *
+ *  A frame is 12 bytes of plain data. SpawnScriptPool hands frames out
+ *  of a fixed array sized up front, so the thousands of environments of
+ *  a GameStateBatch can each run a script with nothing allocated when
+ *  one starts, resumes or ends.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef SPAWNSCRIPT_HPP
+#define SPAWNSCRIPT_HPP
+
+#include "GameRandom.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// The script of a frame that runs none, or whose script returned
+const uint16_t SPAWN_SCRIPT_NONE = 0;
+// Height of a bird: a dino on the ground runs under it, one in the air
+// hits it
+const int SPAWN_BIRD_HEIGHT = 60;
+
+// What a script yields: count obstacles spacing apart at height, then
+// gap of clear lane. A group of no obstacles is a pause of gap.
+struct SpawnGroup{
+    int count;
+    int spacing;
+    int height;
+    int gap;
+};
+
+// Where a script stopped and what it keeps across yields
+struct SpawnScriptFrame{
+    uint16_t script = SPAWN_SCRIPT_NONE;
+    // The yield to go on after, 0 to start from the top
+    uint16_t resume = 0;
+    // Loop counter and a spare value, the script's to use
+    int32_t counter = 0;
+    int32_t local = 0;
+};
+
+static_assert(std::is_trivially_copyable<SpawnScriptFrame>::value, "SpawnScriptFrame must stay plain data");
+
+// Yields the next group through group and returns true, or returns false
+// once the sequence is over
+typedef bool (*SpawnScriptFunction)(SpawnScriptFrame& frame, GameRandom& rng, SpawnGroup& group);
+
+// Opens the body of a script whose frame is frame
+#define SPAWN_SCRIPT_BEGIN(frame) switch((frame).resume){ case 0:
+// Hands out a group {count, spacing, height, gap} and goes on from here
+// at the next resume; only one per line
+#define SPAWN_YIELD(frame, group, ...) \
+    do{ (group) = SpawnGroup{__VA_ARGS__}; (frame).resume = (uint16_t)__LINE__; return true; \
+        case __LINE__:; }while(0)
+// Closes the body: the script is over
+#define SPAWN_SCRIPT_END(frame) } (frame).resume = 0; return false;
+
+struct SpawnScript{
+    const char* name;
+    SpawnScriptFunction run;
+};
+
+// The built-in scripts; script i + 1 of a frame is entry i
+const SpawnScript* GetSpawnScripts(int& count);
+// The script called name, SPAWN_SCRIPT_NONE if there is none
+uint16_t FindSpawnScript(const std::string& name);
+// The names of the built-in scripts, comma separated, for help texts
+std::string ListSpawnScripts();
+
+// Starts script from the top in frame
+inline void StartSpawnScript(SpawnScriptFrame& frame, uint16_t script){
+    frame = SpawnScriptFrame();
+    frame.script = script;
+}
+
+// Resumes the script of frame for the next group. False, with the frame
+// set to SPAWN_SCRIPT_NONE, once it returns or if it runs none.
+bool ResumeSpawnScript(SpawnScriptFrame& frame, GameRandom& rng, SpawnGroup& group);
+
+// Frames of a fixed capacity, handed out and taken back without
+// allocating. Frames are referred to by index, which stays valid while
+// the frame is acquired.
+class SpawnScriptPool{
+public:
+    // The index of no frame
+    static constexpr uint32_t NO_FRAME = 0xffffffffu;
+
+    // Constructor
+    SpawnScriptPool();
+    // Destructor
+    ~SpawnScriptPool();
+    // Makes room for capacity frames; acquired ones keep their index.
+    // Never shrinks.
+    void Reserve(size_t capacity);
+    // Takes a free frame with script started in it, NO_FRAME if none is left
+    uint32_t Acquire(uint16_t script);
+    // Gives a frame back, NO_FRAME is ignored
+    void Release(uint32_t frame);
+    // Gives every frame back
+    void Clear();
+    inline SpawnScriptFrame& Get(uint32_t frame){
+        return m_frames[frame];
+    }
+    inline const SpawnScriptFrame& Get(uint32_t frame) const{
+        return m_frames[frame];
+    }
+    inline size_t GetCapacity() const{
+        return m_frames.size();
+    }
+    inline size_t GetUsedCount() const{
+        return m_frames.size() - m_free.size();
+    }
+private:
+    std::vector<SpawnScriptFrame> m_frames;
+    // Indices of the free frames, taken from the back
+    std::vector<uint32_t> m_free;
+    // Guards against giving a frame back twice
+    std::vector<bool> m_used;
+};
+
+#endif
@@ -0,0 +1,220 @@
+/** @file SpectatorStream.hpp
+ *  @brief Tournament spectators: the kiosk's game streamed as tiny
+ *  delta-encoded snapshots over UDP, --spectator-port=<port>, and
+ *  watched elsewhere with --spectate=<host>:<port>.
+ *
+ *  A SpectatorFrame is what a viewer draws of a step: the score and
+ *  time of day, the dino's height and jump, how far the track has run
+ *  and the obstacles by lane slot, relative to the dino. The game is
+ *  integer throughout, so these are kept in its own units and arrive
+ *  exactly. Every step is encoded against the two before it: each
+ *  channel is predicted to carry on moving as it did (the score goes up
+ *  by one, obstacles come closer by the scroll speed), and only the
+ *  channels that did something else are sent, as zigzag varints behind
+ *  a bitmask. A step where nothing surprising happens costs one byte.
+ *
+ *  SpectatorServer encodes each step once and sends the same datagram
+ *  to every viewer, one every ticksPerPacket steps holding the steps
+ *  since the last datagram and, again, the ones of the datagram before,
+ *  so a single lost datagram costs nothing. Every KEYFRAME_INTERVAL
+ *  steps, and on the step after a viewer joins, a keyframe carries every
+ *  channel in full, from which a newcomer, or a viewer that lost more
+ *  than the repetition covers, picks up the stream. Viewers join by
+ *  sending a datagram to the port and keep sending one every second;
+ *  one not heard from for VIEWER_TIMEOUT_SECONDS is dropped.
+ *
+ *  SpectatorViewer joins, decodes into a short buffer and hands out a
+ *  frame per step once it holds a datagram's worth, which evens out
+ *  how datagrams arrive; it skips ahead when it falls far behind.
+ *
+ *  Nothing here touches SDL or GL. UDP is only implemented on Linux.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef SPECTATORSTREAM_HPP
+#define SPECTATORSTREAM_HPP
+
+#include "GameState.hpp"
+#include "UdpSocket.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+// The channels of a frame, by index
+enum SpectatorChannel{
+    SPECTATOR_GAME,
+    SPECTATOR_TICK,
+    SPECTATOR_DAY_TICK,
+    // SPECTATOR_FLAG_* bits
+    SPECTATOR_FLAGS,
+    SPECTATOR_DINO_HEIGHT,
+    SPECTATOR_JUMP_SPEED,
+    SPECTATOR_TRACK,
+    SPECTATOR_OBSTACLE_HEAD,
+    SPECTATOR_OBSTACLE_COUNT,
+    // Obstacle positions by lane slot, relative to the scroll; 0 for the
+    // free slots
+    SPECTATOR_OBSTACLE_X,
+    SPECTATOR_OBSTACLE_Y = SPECTATOR_OBSTACLE_X + OBSTACLE_LANE_CAPACITY,
+    SPECTATOR_CHANNELS = SPECTATOR_OBSTACLE_Y + OBSTACLE_LANE_CAPACITY
+};
+
+enum SpectatorFlag{
+    SPECTATOR_FLAG_DAYTIME    = 1 << 0,
+    SPECTATOR_FLAG_GAME_OVER  = 1 << 1,
+    SPECTATOR_FLAG_JUMPING    = 1 << 2,
+    SPECTATOR_FLAG_JUMPING_UP = 1 << 3
+};
+
+struct SpectatorFrame{
+    int64_t channels[SPECTATOR_CHANNELS] = {};
+};
+
+// What a viewer draws of game, the gamesPlayed-th game since the start
+void CaptureSpectatorFrame(const GameState& game, uint64_t gamesPlayed, int64_t trackDistance,
+                           SpectatorFrame& frame);
+// Puts frame into game, enough to draw it (the spawn state and RNG are
+// not streamed, so game cannot be stepped on from it)
+void ApplySpectatorFrame(const SpectatorFrame& frame, GameState& game, uint64_t& gamesPlayed,
+                         int64_t& trackDistance);
+
+// Encodes or decodes consecutive frames, each against the ones before
+class SpectatorCodec{
+public:
+    // Appends frame to out, in full if keyframe
+    void Encode(const SpectatorFrame& frame, bool keyframe, std::vector<uint8_t>& out);
+    // Reads one encoded frame from [data, end) and moves data past it.
+    // With apply the frame is decoded into frame, and must follow the
+    // last one decoded unless it is a keyframe; without, it is only
+    // skipped. False if the bytes are not a frame.
+    bool Decode(const uint8_t*& data, const uint8_t* end, bool apply, SpectatorFrame& frame,
+                bool& keyframe);
+private:
+    // Predicts a channel of the next frame from the last two
+    int64_t Predict(int channel) const;
+    // Makes frame the last one; a keyframe has no motion to go on
+    void Push(const SpectatorFrame& frame, bool keyframe);
+
+    SpectatorFrame m_last;
+    SpectatorFrame m_before;
+};
+
+class SpectatorServer{
+public:
+    static const size_t MAX_VIEWERS = 1024;
+    // Steps between two keyframes
+    static const uint32_t KEYFRAME_INTERVAL = 120;
+    static const int VIEWER_TIMEOUT_SECONDS = 10;
+
+    // Constructor
+    SpectatorServer();
+    // Destructor
+    ~SpectatorServer();
+
+    // Listens for viewers on port, sending a datagram every
+    // ticksPerPacket steps
+    bool Start(int port, int ticksPerPacket);
+    inline bool IsRunning() const{
+        return m_socket.IsOpen();
+    }
+    // The frame of the step just taken, once per step
+    void AddTick(const SpectatorFrame& frame);
+
+    inline size_t GetViewerCount() const{
+        return m_viewers.size();
+    }
+    // Steps streamed and bytes sent to all viewers so far
+    inline uint64_t GetTicks() const{
+        return m_sequence;
+    }
+    inline uint64_t GetBytesSent() const{
+        return m_bytesSent;
+    }
+private:
+    struct Viewer{
+        UdpAddress address;
+        uint32_t lastHeardMs;
+    };
+
+    // Takes the join requests waiting and drops the viewers gone silent
+    void AcceptViewers(uint32_t now);
+    void SendPacket();
+    uint32_t GetMilliseconds() const;
+
+    UdpSocket m_socket;
+    SpectatorCodec m_codec;
+    std::vector<Viewer> m_viewers;
+    uint32_t m_ticksPerPacket{1};
+    // Sequence number of the next step
+    uint32_t m_sequence{0};
+    bool m_keyframePending{true};
+    // The encoded steps of the last datagram, repeated in the next, and
+    // those since
+    std::vector<uint8_t> m_previous;
+    std::vector<uint8_t> m_current;
+    uint32_t m_previousFirst{0};
+    uint32_t m_previousCount{0};
+    uint32_t m_currentCount{0};
+    uint64_t m_bytesSent{0};
+    std::chrono::steady_clock::time_point m_epoch;
+};
+
+class SpectatorViewer{
+public:
+    // Frames buffered at most before the oldest are skipped, as a
+    // multiple of a datagram's worth
+    static const size_t MAX_BUFFERED_PACKETS = 4;
+
+    // Constructor
+    SpectatorViewer();
+    // Destructor
+    ~SpectatorViewer();
+
+    // Joins the stream of the kiosk at host:port
+    bool Start(const std::string& host, int port);
+    inline bool IsRunning() const{
+        return m_socket.IsOpen();
+    }
+    // Keeps the membership alive and decodes whatever has arrived, once
+    // per step
+    void Poll();
+    // The frame to show this step; false while there is none, then the
+    // last one stays up
+    bool NextFrame(SpectatorFrame& frame);
+
+    // Steps decoded, lost to missing datagrams, and bytes received
+    inline uint64_t GetDecodedTicks() const{
+        return m_decoded;
+    }
+    inline uint64_t GetLostTicks() const{
+        return m_lost;
+    }
+    inline uint64_t GetBytesReceived() const{
+        return m_bytesReceived;
+    }
+private:
+    void ReadPacket(const uint8_t* data, size_t size);
+    uint32_t GetMilliseconds() const;
+
+    UdpSocket m_socket;
+    SpectatorCodec m_codec;
+    // Whether the codec follows the stream, and the step it expects next
+    bool m_synced{false};
+    uint32_t m_expected{0};
+    std::deque<SpectatorFrame> m_buffer;
+    // Steps a datagram carries that were new, as last seen
+    size_t m_packetTicks{1};
+    // Handing out frames, rather than filling the buffer
+    bool m_playing{false};
+    uint32_t m_lastJoinMs{0};
+    uint64_t m_decoded{0};
+    uint64_t m_lost{0};
+    uint64_t m_bytesReceived{0};
+    std::chrono::steady_clock::time_point m_epoch;
+};
+
+#endif
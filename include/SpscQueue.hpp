@@ -0,0 +1,75 @@
+/** @file SpscQueue.hpp
+ *  @brief Fixed-size queue from one producer thread to one consumer.
+ *
+ *  A ring of CAPACITY slots (a power of two) with a head only the
+ *  consumer moves and a tail only the producer moves, each an atomic.
+ *  Push() and Pop() never block: a full queue refuses the push and an
+ *  empty one the pop, and the caller decides what to do instead. Unlike
+ *  TripleBuffer, every value pushed is popped, in order.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef SPSCQUEUE_HPP
+#define SPSCQUEUE_HPP
+
+#include <atomic>
+#include <cstddef>
+
+template<typename T, size_t CAPACITY>
+class SpscQueue{
+public:
+    static_assert(CAPACITY > 0 && (CAPACITY & (CAPACITY - 1)) == 0, "SpscQueue capacity must be a power of two");
+
+    // Constructor
+    SpscQueue(){
+
+    }
+    // Destructor
+    ~SpscQueue(){
+
+    }
+    // Producer: appends value, false if the queue is full
+    bool Push(const T& value){
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        if(tail - m_head.load(std::memory_order_acquire) == CAPACITY){
+            return false;
+        }
+        m_values[tail & (CAPACITY - 1)] = value;
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+    // Consumer: takes the oldest value, false if the queue is empty
+    bool Pop(T& value){
+        size_t head = m_head.load(std::memory_order_relaxed);
+        if(head == m_tail.load(std::memory_order_acquire)){
+            return false;
+        }
+        value = m_values[head & (CAPACITY - 1)];
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+    // Consumer: copies the oldest value without taking it, false if the
+    // queue is empty
+    bool Peek(T& value) const{
+        size_t head = m_head.load(std::memory_order_relaxed);
+        if(head == m_tail.load(std::memory_order_acquire)){
+            return false;
+        }
+        value = m_values[head & (CAPACITY - 1)];
+        return true;
+    }
+    // Either side: true if nothing is queued at the moment
+    inline bool IsEmpty() const{
+        return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+    }
+private:
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    T m_values[CAPACITY];
+    // Apart, so the two sides do not share a cache line
+    alignas(64) std::atomic<size_t> m_head{0};
+    alignas(64) std::atomic<size_t> m_tail{0};
+};
+
+#endif
@@ -0,0 +1,104 @@
+/** @file StressTest.hpp
+ *  @brief Frame time against scene size, --stress=<n>.
+ *
+ *  A stress run fills the scene with moving cacti and ghost dinos, on
+ *  top of the game, and grows their number in levels: n/16, n/8, n/4,
+ *  n/2 and n entities (fewer levels for small n), each held for a fixed
+ *  number of frames. The entities go through everything the game's own
+ *  obstacles do: one instanced draw per range and level of detail, LOD
+ *  selection, frustum culling and a collision test against the dino. A
+ *  few frames after each change of level are not measured, so entities
+ *  coming into the batch and the GPU timings catching up stay out of
+ *  the results.
+ *
+ *  Entities are placed from their index and the frame number alone, so
+ *  every run moves the same scene past the same camera. Report() prints
+ *  a line per level: frame, CPU and GPU times, what was drawn and hit,
+ *  and the cost of every entity added since the level before, which is
+ *  where the scaling curve bends. With readable power counters (see
+ *  EnergyMeter.hpp) a level also gets its millijoules per frame, which
+ *  with one simulation step a frame are its joules per thousand steps.
+ *
+ *  Nothing here touches GL or the entity store; the game places and
+ *  draws the entities.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef STRESSTEST_HPP
+#define STRESSTEST_HPP
+
+#include <cstddef>
+#include <vector>
+
+// Where one stress entity is in a frame, in world units
+struct StressPlacement{
+    float x;
+    float y;
+    float z;
+};
+
+class StressTest{
+public:
+    // Frames measured at each level
+    static const int LEVEL_FRAMES = 240;
+    // Every this many entities, one is a ghost dino; the rest are cacti
+    static const size_t GHOST_DINO_EVERY = 4;
+
+    // Constructor
+    StressTest();
+    // Destructor
+    ~StressTest();
+    // Starts a run that ends at maxEntities entities
+    void Begin(size_t maxEntities);
+    inline bool IsRunning() const{
+        return !m_levels.empty();
+    }
+    // True once the last level has been measured
+    inline bool IsFinished() const{
+        return m_level >= m_levels.size();
+    }
+    // Entities in the scene this frame
+    size_t GetEntityCount() const;
+    // Most entities the run ever has
+    inline size_t GetMaxEntities() const{
+        return m_levels.empty() ? 0 : m_levels.back().entities;
+    }
+    // Ghost dinos and cacti among count entities
+    static size_t GetGhostDinoCount(size_t count);
+    static size_t GetCactusCount(size_t count);
+    // Where entity index is this frame; ghost dinos hop, cacti slide
+    StressPlacement Place(size_t index, bool ghostDino) const;
+    // Ends a frame: its times in milliseconds, the instances it drew and
+    // the entities that overlapped the dino
+    void AddFrame(double frameMilliseconds, double cpuMilliseconds, size_t instances, size_t collisions);
+    // The GPU time of an earlier frame, as it becomes available
+    void AddGPUFrame(double milliseconds);
+    // Joules used over the frame just added
+    void AddEnergy(double joules);
+    // Prints a line per level
+    void Report() const;
+private:
+    // Frames after a level change that are not measured
+    static const int SETTLE_FRAMES = 30;
+
+    struct Level{
+        size_t entities;
+        std::vector<double> frameTimes;
+        std::vector<double> cpuTimes;
+        std::vector<double> gpuTimes;
+        double instances{0.0};
+        double collisions{0.0};
+        double joules{0.0};
+        int energyFrames{0};
+    };
+
+    std::vector<Level> m_levels;
+    size_t m_level{0};
+    // The level of the frame AddFrame() last measured, -1 if none
+    int m_measuredLevel{-1};
+    // Frames run at the current level, and in the whole run
+    int m_levelFrame{0};
+    int m_frame{0};
+};
+
+#endif
@@ -0,0 +1,80 @@
+/** @file TcpSocket.hpp
+ *  @brief A blocking TCP connection or listening socket, for the tools
+ *  that talk to other processes and machines.
+ *
+ *  ListenLocal() and ConnectLocal() make the same kind of socket on a
+ *  Unix domain path instead, for processes of one host.
+ *
+ *  Messages are either raw bytes (SendAll(), ReceiveAll()) or lines of
+ *  text ending in '\n'. A socket collects what it has received but not
+ *  yet handed out, so a server can poll() many of them, call
+ *  ReadAvailable() on the readable ones and take whole lines with
+ *  TakeLine() without ever blocking, while a client simply calls
+ *  ReceiveLine(). Writes never raise SIGPIPE; a peer that went away is
+ *  reported as a failed send.
+ *
+ *  Only implemented on Linux; elsewhere Listen() and Connect() fail.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef TCPSOCKET_HPP
+#define TCPSOCKET_HPP
+
+#include <cstddef>
+#include <string>
+
+class TcpSocket{
+public:
+    // Constructor
+    TcpSocket();
+    // Destructor, closes the socket
+    ~TcpSocket();
+    TcpSocket(const TcpSocket&) = delete;
+    TcpSocket& operator=(const TcpSocket&) = delete;
+    TcpSocket(TcpSocket&& other);
+    TcpSocket& operator=(TcpSocket&& other);
+
+    // Listens on every interface, port 0 picks a free one (see GetPort())
+    bool Listen(int port);
+    // Takes the next connection waiting on a listening socket; the
+    // returned socket is closed if there was none
+    TcpSocket Accept();
+    // Connects to host ("localhost", a name or an address) on port
+    bool Connect(const std::string& host, int port);
+    // Listens on, or connects to, the Unix domain socket at path. A
+    // listener replaces whatever was left at path; nothing removes it.
+    bool ListenLocal(const std::string& path);
+    bool ConnectLocal(const std::string& path);
+    void Close();
+    inline bool IsOpen() const{
+        return m_fd >= 0;
+    }
+    // For poll()
+    inline int GetFd() const{
+        return m_fd;
+    }
+    // Local port, of a listening socket the one it listens on
+    int GetPort() const;
+
+    // Sends or receives exactly size bytes, false if the connection failed
+    bool SendAll(const void* data, size_t size);
+    bool ReceiveAll(void* data, size_t size);
+    // Sends line followed by '\n'
+    bool SendLine(const std::string& line);
+    // Reads whatever has arrived, blocking only if nothing has; false once
+    // the peer closed the connection or it failed
+    bool ReadAvailable();
+    // Takes the next complete line received, without its '\n'
+    bool TakeLine(std::string& line);
+    // Blocks until a whole line is there, false if the connection ends first
+    bool ReceiveLine(std::string& line);
+private:
+    int m_fd{-1};
+    // Received bytes not yet taken
+    std::string m_pending;
+};
+
+// Splits "<host>:<port>", false if there is no valid port
+bool ParseHostPort(const std::string& address, std::string& host, int& port);
+
+#endif
@@ -0,0 +1,104 @@
+/** @file Telemetry.hpp
+ *  @brief Run statistics counted on every thread without contention.
+ *
+ *  Each thread counts into a block of its own: episodes finished, the
+ *  sum and the best of their scores, collisions by the formation that
+ *  was hit, simulation steps (and how many of them ran on a NUMA node
+ *  other than the one holding their environments) and frame times in
+ *  buckets, with their sum. Only the
+ *  owning thread ever writes a block, with a relaxed load and store
+ *  (no read-modify-write, so no locked instruction), and blocks are
+ *  cache line aligned, so thousands of environments stepped on many
+ *  cores share nothing. The first count a thread makes registers its
+ *  block, which is the only time a lock is taken; blocks belong to
+ *  the Telemetry and outlive their thread.
+ *
+ *  Snapshot() sums every block with relaxed loads, from any thread at
+ *  any time. A snapshot taken while others are counting may be a few
+ *  counts behind, but never tears a value.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef TELEMETRY_HPP
+#define TELEMETRY_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Formations tracked apart: one, two and three or more cacti
+const int TELEMETRY_FORMATIONS = 3;
+// Frame time buckets; bucket i holds frames shorter than
+// TELEMETRY_FRAME_EDGES[i] milliseconds, the last one every longer frame
+const int TELEMETRY_FRAME_BUCKETS = 6;
+const double TELEMETRY_FRAME_EDGES[TELEMETRY_FRAME_BUCKETS - 1] = {4.0, 8.5, 17.0, 34.0, 67.0};
+
+// The statistics summed over every thread
+struct TelemetrySnapshot{
+    uint64_t episodes = 0;
+    uint64_t scoreSum = 0;
+    uint64_t scoreMax = 0;
+    uint64_t collisions[TELEMETRY_FORMATIONS] = {};
+    uint64_t steps = 0;
+    uint64_t remoteSteps = 0;
+    uint64_t frames[TELEMETRY_FRAME_BUCKETS] = {};
+    // Every frame's time added up
+    uint64_t frameMicroseconds = 0;
+    // Seconds since the Telemetry started
+    double seconds = 0.0;
+
+    inline double GetMeanScore() const{
+        return (episodes > 0) ? (double)scoreSum / (double)episodes : 0.0;
+    }
+    // Steps per second since earlier, or since the start without one
+    double GetStepsPerSecond(const TelemetrySnapshot* earlier = nullptr) const;
+    // One line for the console
+    std::string Format(const TelemetrySnapshot* earlier = nullptr) const;
+};
+
+class Telemetry{
+public:
+    // The statistics of the whole process
+    static Telemetry& Get();
+
+    // Counts a finished episode. formation is the number of cacti in
+    // the group that ended it (see GetLeadFormation()), 0 if it did not
+    // end in a collision.
+    void AddEpisode(int score, int formation);
+    void AddSteps(uint64_t steps);
+    // Counts steps, already added, whose environments live on another
+    // NUMA node than the core that stepped them
+    void AddRemoteSteps(uint64_t steps);
+    void AddFrame(double milliseconds);
+    // Sums every thread's counts
+    TelemetrySnapshot Snapshot() const;
+private:
+    // Constructor
+    Telemetry();
+    // Destructor
+    ~Telemetry();
+
+    struct alignas(64) Block{
+        std::atomic<uint64_t> episodes{0};
+        std::atomic<uint64_t> scoreSum{0};
+        std::atomic<uint64_t> scoreMax{0};
+        std::atomic<uint64_t> collisions[TELEMETRY_FORMATIONS] = {};
+        std::atomic<uint64_t> steps{0};
+        std::atomic<uint64_t> remoteSteps{0};
+        std::atomic<uint64_t> frames[TELEMETRY_FRAME_BUCKETS] = {};
+        std::atomic<uint64_t> frameMicroseconds{0};
+    };
+    // The calling thread's block, registered on first use
+    Block& GetThreadBlock();
+
+    std::chrono::steady_clock::time_point m_start;
+    mutable std::mutex m_blocksMutex;
+    std::vector<std::unique_ptr<Block>> m_blocks;
+};
+
+#endif
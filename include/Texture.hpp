@@ -1,7 +1,9 @@
 /** @file Texture.hpp
  *  @brief Loads an image and creates an OpenGL texture on the GPU..
  *  
- *  More...
+ *  The decoded pixels are freed as soon as Upload() has handed them to
+ *  GL, so a texture is only resident once, on the GPU. SetKeepPixels()
+ *  keeps them for code that reads them back or draws in software.
  *
  *  @author Mike
  *  @bug No known bugs.
@@ -12,7 +14,11 @@
 #include "Image.hpp"
 
 #include <glad/glad.h>
+#include <cstddef>
 #include <string>
+#include <vector>
+
+class KTXFile;
 
 class Texture{
 public:
@@ -20,8 +26,39 @@ public:
     Texture();
     // Destructor
     ~Texture();
-	// Loads and sets up an actual texture
+    // Textures own a GL handle, so they are not copyable.
+    Texture(const Texture&) = delete;
+    Texture& operator=(const Texture&) = delete;
+	// Loads and sets up an actual texture. A .ktx path is uploaded
+    // as it is stored, block-compressed with its own mip levels.
     void LoadTexture(const std::string filepath);
+    // The two halves of LoadTexture(): Decode() reads the file and touches
+    // no GL, so it may run as a job; Upload() then creates the texture on
+    // the GL thread and returns the bytes it took on the GPU
+    void Decode(const std::string& filepath);
+    size_t Upload();
+    // Keeps the decoded pixels after Upload() instead of freeing them.
+    // Off by default; set it before the upload.
+    inline void SetKeepPixels(bool keep){
+        m_keepPixels = keep;
+    }
+    // The decoded image, nullptr once the upload freed it
+    inline Image* GetImage() const{
+        return m_image;
+    }
+    // True once an upload created the texture
+    inline bool IsLoaded() const{
+        return m_textureID != 0;
+    }
+    // Bytes the last upload took on the GPU
+    inline size_t GetBytes() const{
+        return m_bytes;
+    }
+    // Whether the current context can sample a compressed internal format
+    static bool IsFormatSupported(GLenum internalFormat);
+    // Suffixes of the compressed variants of a texture the current context
+    // can use, best first, e.g. ".bc7.ktx" to try <name>.bc7.ktx
+    static std::vector<std::string> GetCompressedSuffixes();
 	// slot tells us which slot we want to bind to.
     // We can have multiple slots. By default, we
     // will set our slot to 0 if it is not specified.
@@ -29,12 +66,22 @@ public:
     // Be done with our texture
     void Unbind();
 private:
+    // Uploads the levels of a .ktx, returns their bytes
+    size_t UploadCompressed(const KTXFile& ktx);
+    // Uploads the decoded image, returns its bytes
+    size_t UploadImage();
     // Store a unique ID for the texture
-    GLuint m_textureID;
+    GLuint m_textureID{0};
 	// Filepath to the image loaded
     std::string m_filepath;
     // Store whatever image data inside of our texture class.
-    Image* m_image;
+    Image* m_image{nullptr};
+    // A decoded .ktx until it is uploaded
+    KTXFile* m_ktx{nullptr};
+    // What Upload() returned
+    size_t m_bytes{0};
+    // Whether m_image outlives the upload
+    bool m_keepPixels{false};
 };
 
 
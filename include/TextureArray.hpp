@@ -0,0 +1,118 @@
+/** @file TextureArray.hpp
+ *  @brief Packs material textures into the layers of one GL_TEXTURE_2D_ARRAY.
+ *
+ *  Images are queued by path at load time and uploaded together by
+ *  Build(). Each distinct path becomes one layer; meshes select their
+ *  image by layer index, so the whole scene is drawn with a single
+ *  texture bind. Every layer must have the same size and format, which
+ *  is RGBA8 (a .ppm padded with opaque alpha, so its rows upload 4-byte
+ *  aligned) or, for layers uploaded from .ktx files, a block-compressed
+ *  format with the file's mip levels. The storage is immutable
+ *  (glTexStorage3D) where the driver has GL_ARB_texture_storage, and
+ *  sampled trilinearly when it has more than one level.
+ *
+ *  With GL_ARB_bindless_texture the array also has a resident handle,
+ *  GetBindlessHandle(), that a shader samples without the array being
+ *  bound to any unit. Making the handle freezes the texture's storage
+ *  and parameters (its texels can still be uploaded), so a new
+ *  Allocate() starts a new texture and a new handle.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef TEXTUREARRAY_HPP
+#define TEXTUREARRAY_HPP
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class TextureArray{
+public:
+    // Constructor
+    TextureArray();
+    // Destructor
+    // Note: Call Release() while the GL context is alive.
+    ~TextureArray();
+    // Texture arrays own a GL handle, so they are not copyable.
+    TextureArray(const TextureArray&) = delete;
+    TextureArray& operator=(const TextureArray&) = delete;
+    // Queues an image and returns its layer. Adding the same path
+    // twice returns the same layer.
+    int AddImage(const std::string& filepath);
+    // Adds a layer no file fills, only CopyFramebuffer(); name tells it
+    // apart like a path
+    inline int AddLayer(const std::string& name){
+        return AddImage(name);
+    }
+    // Loads every queued image and uploads them as layers.
+    // Returns false if an image is missing or the sizes differ.
+    bool Build();
+    // Creates the storage of every queued layer at width x height with
+    // levels mip levels without filling it, for layers uploaded piece by
+    // piece with UploadRows() or, for a compressed internalFormat,
+    // UploadCompressedRows()
+    void Allocate(int width, int height, GLenum internalFormat=GL_RGBA8, int levels=1);
+    // Uploads rowCount rows of RGBA texels into a layer,
+    // starting at firstRow. The array must be allocated.
+    void UploadRows(int layer, int firstRow, int rowCount, const uint8_t* texels);
+    // Uploads the blocks of rowCount texel rows into a mip level of a
+    // compressed layer, starting at firstRow. Both must be multiples of 4
+    // unless the rows end at the bottom of the level.
+    void UploadCompressedRows(int layer, int level, int firstRow, int rowCount, const char* blocks, size_t bytes);
+    // Note: While a PixelUnpackBuffer is bound, texels and blocks of the
+    // two uploads above are byte offsets into it instead of pointers.
+    // Copies the bottom left width x height texels of the bound read
+    // framebuffer into level 0 of a layer of an RGBA8 array
+    void CopyFramebuffer(int layer, int width, int height);
+    inline bool IsAllocated() const{
+        return m_textureID != 0;
+    }
+    // Binds the array to a texture slot
+    void Bind(unsigned int slot=0) const;
+    // The resident bindless handle of the allocated array, made on the
+    // first call; 0 without GL_ARB_bindless_texture or storage
+    GLuint64 GetBindlessHandle();
+    // Layer of a queued path, -1 if it was never added
+    int GetLayer(const std::string& filepath) const;
+    // Path a layer was queued with
+    inline const std::string& GetFilepath(int layer) const{
+        return m_filepaths[layer];
+    }
+    // Number of layers
+    inline int GetLayerCount() const{
+        return (int)m_filepaths.size();
+    }
+    // Size of every layer in texels
+    inline int GetWidth() const{
+        return m_width;
+    }
+    inline int GetHeight() const{
+        return m_height;
+    }
+    // Internal format of every layer
+    inline GLenum GetInternalFormat() const{
+        return m_internalFormat;
+    }
+    // Mip levels of every layer
+    inline int GetLevelCount() const{
+        return m_levels;
+    }
+    // Deletes the GL texture
+    void Release();
+private:
+    // Allocate() by name (direct state access) or by binding the texture
+    void AllocateDirect(GLsizei layers);
+    void AllocateBound(GLsizei layers, bool compressed);
+
+    GLuint m_textureID{0};
+    GLuint64 m_bindlessHandle{0};
+    std::vector<std::string> m_filepaths;
+    int m_width{0};
+    int m_height{0};
+    GLenum m_internalFormat{GL_RGBA8};
+    int m_levels{1};
+};
+
+#endif
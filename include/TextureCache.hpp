@@ -0,0 +1,91 @@
+/** @file TextureCache.hpp
+ *  @brief Reference-counted cache of streamed GPU textures keyed by file
+ *  path, kept within a VRAM budget.
+ *
+ *  A texture is requested from the AssetLoader the first time its path
+ *  is acquired: it is decoded as a job and uploaded on the GL thread
+ *  under the loader's budget, never on the frame that asks for it.
+ *  Later requests for the same path return the same handle, so
+ *  switching between resident textures only means binding a different
+ *  handle. Until a texture is in, Bind() binds a 1x1 placeholder.
+ *
+ *  Every texture is registered with the ResidencyManager, and every
+ *  Bind() touches it. When the budget is exceeded the manager evicts the
+ *  texture bound longest ago, freeing its GL texture; the handle stays
+ *  valid, and the next Bind() streams it back through the loader,
+ *  showing the placeholder until it arrives.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef TEXTURECACHE_HPP
+#define TEXTURECACHE_HPP
+
+#include "AssetFuture.hpp"
+#include "ResidencyManager.hpp"
+#include "Texture.hpp"
+
+#include <glad/glad.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class AssetLoader;
+
+// Stable handle to a texture owned by the cache.
+typedef unsigned int TextureHandle;
+
+// Returned when a texture could not be acquired
+const TextureHandle INVALID_TEXTURE = 0xFFFFFFFFu;
+
+class TextureCache{
+public:
+    // Constructor
+    TextureCache();
+    // Destructor
+    // Note: Call Clear() while the GL context is alive.
+    ~TextureCache();
+    // Streams through loader, within the budget of residency, and makes
+    // the placeholder. Call with the GL context current, before Acquire.
+    void Initialize(AssetLoader& loader, ResidencyManager& residency);
+    // Returns a handle to the texture at filepath, requesting it on first
+    // use. Every Acquire must be matched by a Release.
+    TextureHandle Acquire(const std::string& filepath);
+    // Drops one reference. The texture is freed when no references remain.
+    void Release(TextureHandle handle);
+    // Binds the texture behind a handle to a texture slot, or the
+    // placeholder while it streams in; streams it back if it was evicted
+    void Bind(TextureHandle handle, unsigned int slot=0);
+    // Returns the texture behind a handle, or nullptr until it is in
+    Texture* Get(TextureHandle handle) const;
+    // Marks the textures uploaded since the last call resident. Call once
+    // a frame after AssetLoader::Update().
+    void Update();
+    // Number of textures currently resident
+    size_t GetResidentCount() const;
+    // Frees every texture regardless of its reference count, and the
+    // placeholder
+    void Clear();
+private:
+    struct Entry{
+        AssetFuture<Texture> texture;         // Invalid once freed or evicted
+        std::string filepath;                 // Key this entry was loaded from
+        unsigned int refCount{0};             // Outstanding Acquire calls
+        ResidencyId residency{INVALID_RESIDENCY};
+    };
+
+    // Requests the texture of an entry from the loader
+    void Stream(TextureHandle handle);
+
+    AssetLoader* m_loader{nullptr};
+    ResidencyManager* m_residency{nullptr};
+    std::vector<Entry> m_entries;
+    // Path -> index into m_entries
+    std::unordered_map<std::string, TextureHandle> m_lookup;
+    // Entries streaming, checked by Update()
+    std::vector<TextureHandle> m_streaming;
+    // What is bound for a texture not in yet
+    GLuint m_placeholder{0};
+};
+
+#endif
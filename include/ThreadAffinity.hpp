@@ -0,0 +1,68 @@
+/** @file ThreadAffinity.hpp
+ *  @brief Pins worker threads to cores in a compact or scatter order.
+ *
+ *  Threads left to the scheduler migrate between cores, and a worker
+ *  that stepped a shard on one core finds its lanes cold in the next
+ *  core's L2. An AffinityConfig names a policy and the cores to keep
+ *  clear; GetAffinityOrder() turns it into the order in which a pool's
+ *  threads take cores, and thread i of a pool pins itself to
+ *  order[i % order.size()].
+ *
+ *  AFFINITY_COMPACT fills a physical core's hardware threads, then the
+ *  next core of the same package, so threads that share data share
+ *  cache. AFFINITY_SCATTER takes one hardware thread of every physical
+ *  core, alternating packages, before any second sibling, so every
+ *  thread gets a core and an L2 of its own. Only cores the process may
+ *  run on are used (taskset, cgroups), less the excluded ones.
+ *
+ *  The topology comes from /sys/devices/system/cpu on Linux. Elsewhere,
+ *  or when it cannot be read, hardware threads 2k and 2k+1 are taken to
+ *  be siblings, which is how Windows numbers them. Pinning works on
+ *  Linux and Windows; on macOS threads are never pinned.
+ *
+ *  GetCurrentNumaNode() tells a thread which memory node it runs on,
+ *  so data it first touches lands there and can be told apart from
+ *  data it reaches across the interconnect.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef THREADAFFINITY_HPP
+#define THREADAFFINITY_HPP
+
+#include <string>
+#include <vector>
+
+enum AffinityPolicy{
+    // Nothing is pinned
+    AFFINITY_NONE,
+    AFFINITY_COMPACT,
+    AFFINITY_SCATTER
+};
+
+struct AffinityConfig{
+    AffinityPolicy policy{AFFINITY_NONE};
+    // Hardware threads no pinned thread may use
+    std::vector<unsigned int> excluded;
+    // Pins the thread that starts a pool, thread 0, as well; otherwise
+    // only the pool's own workers are pinned
+    bool pinCaller{false};
+};
+
+// Reads "none", "compact" or "scatter"
+bool ParseAffinityPolicy(const std::string& text, AffinityPolicy& policy);
+// Reads a list of hardware threads such as "0,2,8-11"
+bool ParseCoreList(const std::string& text, std::vector<unsigned int>& cores);
+// The cores thread 0, 1, 2... of a pool take, empty for AFFINITY_NONE
+// or when every core is excluded
+std::vector<unsigned int> GetAffinityOrder(const AffinityConfig& config);
+// Pins the calling thread to one hardware thread; false if that failed
+// or the platform cannot pin
+bool PinCurrentThread(unsigned int core);
+// Pins the calling thread, thread index of a pool, to its core of order.
+// Does nothing for an empty order, or for thread 0 unless pinCaller.
+void PinPoolThread(const AffinityConfig& config, const std::vector<unsigned int>& order,
+                   unsigned int index);
+// The NUMA node of the core the calling thread runs on, -1 if unknown
+int GetCurrentNumaNode();
+
+#endif
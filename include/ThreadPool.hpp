@@ -0,0 +1,90 @@
+/** @file ThreadPool.hpp
+ *  @brief Fixed set of worker threads with per-thread work stealing.
+ *
+ *  Run() hands out a number of independent tasks and returns once all
+ *  of them are done, so it acts as a barrier. Every thread has its own
+ *  deque of task indices, filled with a contiguous range up front. A
+ *  thread takes work from the back of its own deque, and when that is
+ *  empty steals from the front of the others, so uneven tasks still
+ *  keep every core busy. The calling thread works too, as thread 0.
+ *
+ *  With an AffinityConfig, every worker pins itself to its core of the
+ *  config's order (see ThreadAffinity.hpp) before it runs a task, and
+ *  the constructing thread too if pinCaller is set.
+ *
+ *  Run() without stealing leaves every thread exactly its own range,
+ *  task i going to thread GetOwner(taskCount, i). Pinned threads can so
+ *  first-touch the memory they will keep working on, which puts it on
+ *  their own NUMA node.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef THREADPOOL_HPP
+#define THREADPOOL_HPP
+
+#include "ThreadAffinity.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool{
+public:
+    // Constructor, threadCount includes the calling thread, 0 means one
+    // per hardware thread. affinity pins the threads to cores.
+    explicit ThreadPool(unsigned int threadCount = 0, const AffinityConfig& affinity = AffinityConfig());
+    // Destructor, stops and joins the workers
+    ~ThreadPool();
+    // Calls task(i) for every i in [0, taskCount) and waits for all of
+    // them. Without steal, each thread runs only the tasks it owns.
+    void Run(size_t taskCount, const std::function<void(size_t)>& task, bool steal = true);
+    // The thread that starts out with task i of taskCount
+    inline unsigned int GetOwner(size_t taskCount, size_t task) const{
+        size_t threads = m_queues.size();
+        return (unsigned int)(((task + 1) * threads - 1) / taskCount);
+    }
+    // Threads running tasks, the caller included
+    inline unsigned int GetThreadCount() const{
+        return (unsigned int)m_queues.size();
+    }
+private:
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    struct Queue{
+        std::mutex mutex;
+        std::deque<size_t> tasks;
+    };
+
+    void WorkerMain(unsigned int index);
+    // Runs tasks until every deque is empty
+    void Work(unsigned int index);
+    // Takes a task from the back of the thread's own deque
+    bool PopLocal(unsigned int index, size_t& task);
+    // Takes a task from the front of another thread's deque
+    bool Steal(unsigned int thief, size_t& task);
+
+    // One deque per thread, index 0 belongs to the caller of Run()
+    std::vector<std::unique_ptr<Queue>> m_queues;
+    std::vector<std::thread> m_threads;
+    AffinityConfig m_affinity;
+    // Core of thread i is m_cores[i % size], empty when nothing is pinned
+    std::vector<unsigned int> m_cores;
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;     // A Run() started, or the pool stops
+    std::condition_variable m_done;     // The last task of a Run() finished
+    const std::function<void(size_t)>* m_task{nullptr};
+    unsigned long m_generation{0};      // Incremented by every Run()
+    bool m_steal{true};                 // Whether this Run() steals
+    std::atomic<size_t> m_remaining{0};
+    bool m_stop{false};
+};
+
+#endif
@@ -0,0 +1,131 @@
+/** @file TraceRecorder.hpp
+ *  @brief Chrome trace-event capture of CPU zones, GPU passes and loads.
+ *
+ *  While recording, the profilers hand every zone and pass they
+ *  collect to the recorder: CPU zones land on the track of the thread
+ *  that ran them, GPU passes on a track of their own, and asset loads
+ *  become async events. Events go into a buffer reserved up front, and
+ *  recording stops after a fixed number of frames or when the buffer
+ *  is full, whichever comes first, so a trace never grows without
+ *  bound. Nothing is written until Write(), called at exit, so tracing
+ *  adds no I/O to a frame.
+ *
+ *  The file is the JSON trace-event format that chrome://tracing and
+ *  ui.perfetto.dev open. GPU timestamps are moved onto the CPU clock
+ *  with one pair of readings taken by SyncGPUClock().
+ *
+ *  @bug No known bugs.
+ */
+#ifndef TRACERECORDER_HPP
+#define TRACERECORDER_HPP
+
+#include "MemoryTags.hpp"
+
+#include <SDL2/SDL.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class TraceRecorder{
+public:
+    // Constructor
+    TraceRecorder();
+    // Destructor
+    ~TraceRecorder();
+    // Starts recording for maxFrames frames, to be written to filepath
+    void Begin(const std::string& filepath, int maxFrames);
+    // Same with room for maxEvents events, and times counted from the
+    // performance counter value startCounter rather than from now
+    // (FlightRecorder writes events of the past)
+    void Begin(const std::string& filepath, int maxFrames, size_t maxEvents, uint64_t startCounter);
+    inline bool IsRecording() const{
+        return m_recording;
+    }
+    // True if there is something for Write() to do
+    inline bool IsOpen() const{
+        return !m_filepath.empty();
+    }
+    // Names events, returns the id the Add functions take
+    int AddName(const std::string& name);
+    // Pairs a GPU timestamp (nanoseconds) with the CPU clock right now,
+    // or with the performance counter value counter
+    void SyncGPUClock(int64_t gpuNanoseconds);
+    void SyncGPUClock(int64_t gpuNanoseconds, uint64_t counter);
+
+    // A CPU zone run on thread, in performance counter values
+    void AddZone(int name, int thread, uint64_t start, uint64_t end);
+    // A GPU pass, in GPU timestamp nanoseconds
+    void AddGPUPass(int name, uint64_t start, uint64_t end);
+    // An asset load, in performance counter values
+    void AddAsync(int name, uint64_t start, uint64_t end);
+    // A value of the counter track name at a performance counter value
+    void AddCounter(int name, uint64_t counter, double value);
+    // Counts a frame, the recording stops after maxFrames of them
+    void EndFrame();
+
+    // Writes everything recorded to the file given to Begin()
+    bool Write();
+private:
+    // Most events kept per recorded frame, on average
+    static const size_t EVENTS_PER_FRAME = 64;
+
+    enum EventType{
+        EVENT_ZONE,
+        EVENT_GPU_PASS,
+        EVENT_ASYNC,
+        EVENT_COUNTER
+    };
+    struct Event{
+        EventType type;
+        int name;
+        int thread;
+        // Microseconds since Begin(); a counter's value is its end
+        double start;
+        double end;
+    };
+
+    // Microseconds since Begin() of a performance counter value
+    double CounterToMicroseconds(uint64_t counter) const;
+    void Push(const Event& event);
+
+    std::string m_filepath;
+    bool m_recording{false};
+    int m_frame{0};
+    int m_maxFrames{0};
+    std::vector<std::string> m_names;
+    TaggedVector<Event, MEMORY_TELEMETRY> m_events;
+    size_t m_maxEvents{0};
+    uint64_t m_startCounter{0};
+    double m_microsecondsPerCount{0.0};
+    // GPU clock minus CPU clock, both in microseconds since Begin()
+    double m_gpuOffset{0.0};
+    bool m_gpuSynced{false};
+    int m_highestThread{0};
+};
+
+// Records the scope it lives in as an asset load of the trace
+class TraceLoad{
+public:
+    // Constructor
+    TraceLoad(TraceRecorder& trace, const std::string& name)
+        : m_trace(trace), m_name(trace.IsRecording() ? trace.AddName(name) : -1),
+          m_start(SDL_GetPerformanceCounter()){
+
+    }
+    // Destructor
+    ~TraceLoad(){
+        if(m_name >= 0){
+            m_trace.AddAsync(m_name, m_start, SDL_GetPerformanceCounter());
+        }
+    }
+    TraceLoad(const TraceLoad&) = delete;
+    TraceLoad& operator=(const TraceLoad&) = delete;
+private:
+    TraceRecorder& m_trace;
+    int m_name;
+    uint64_t m_start;
+};
+
+#endif
@@ -0,0 +1,93 @@
+/** @file TransformHierarchy.hpp
+ *  @brief Parts placed relative to each other, updated where they moved.
+ *
+ *  A model made of parts (a body with a head, a tail and legs) places
+ *  each part by a Transform relative to its parent's. The nodes are
+ *  kept in arrays indexed by node, a parent always before its children,
+ *  which Add() guarantees by only taking parents that already exist.
+ *  Update() is then one pass front to back: a node is recomputed when
+ *  it was set since the last update or its parent was recomputed in
+ *  this one, and the parent's world transform is always ready by then.
+ *
+ *  The pass starts at the first node set since the last update and
+ *  returns at once when there is none, so a hierarchy nothing moved in
+ *  costs nothing, and nodes before the first change are never read.
+ *  Clean nodes after it cost a flag test each. Which nodes the last
+ *  update changed stays readable until the next one, for systems that
+ *  copy world transforms on (EntityStore::ApplyHierarchy()).
+ *
+ *  Transforms compose as the renderer draws them, an offset and a
+ *  uniform scale: a child at local offset o and scale s under a parent
+ *  at P with scale S sits at P + o*S with scale s*S.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef TRANSFORMHIERARCHY_HPP
+#define TRANSFORMHIERARCHY_HPP
+
+#include "EntityStore.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// The parent of a root
+const uint32_t NO_TRANSFORM_NODE = 0xFFFFFFFFu;
+
+class TransformHierarchy{
+public:
+    // Constructor
+    TransformHierarchy();
+    // Destructor
+    ~TransformHierarchy();
+    // Room for count nodes without allocating
+    void Reserve(size_t count);
+    // Removes every node
+    void Clear();
+    // Adds a node placed by local relative to parent, an existing node or
+    // NO_TRANSFORM_NODE for a root. Returns the node, or NO_TRANSFORM_NODE
+    // if parent does not exist yet.
+    uint32_t Add(uint32_t parent, const Transform& local = Transform());
+    // Moves a node relative to its parent; its subtree follows at the
+    // next Update()
+    void SetLocal(uint32_t node, const Transform& local);
+    // Recomputes the world transform of every node set since the last
+    // call and of everything below them. Returns how many changed.
+    size_t Update();
+
+    inline size_t GetCount() const{
+        return m_parents.size();
+    }
+    inline uint32_t GetParent(uint32_t node) const{
+        return m_parents[node];
+    }
+    inline const Transform& GetLocal(uint32_t node) const{
+        return m_local[node];
+    }
+    // As of the last Update()
+    inline const Transform& GetWorld(uint32_t node) const{
+        return m_world[node];
+    }
+    // Whether the last Update() changed the world transform of node
+    inline bool IsChanged(uint32_t node) const{
+        return m_updated[node] == m_generation;
+    }
+    // Nodes the last Update() changed
+    inline size_t GetChangedCount() const{
+        return m_changedCount;
+    }
+private:
+    std::vector<uint32_t> m_parents;
+    std::vector<Transform> m_local;
+    std::vector<Transform> m_world;
+    // Set since the last update
+    std::vector<uint8_t> m_dirty;
+    // The update that last changed each node; no clearing between updates
+    std::vector<uint32_t> m_updated;
+    uint32_t m_generation{0};
+    // No node before this one is dirty
+    size_t m_firstDirty{0};
+    size_t m_changedCount{0};
+};
+
+#endif
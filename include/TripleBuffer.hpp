@@ -0,0 +1,69 @@
+/** @file TripleBuffer.hpp
+ *  @brief Latest-value handoff from one writer thread to one reader.
+ *
+ *  Three copies of T: the writer fills its back copy and Publish()
+ *  swaps it with the middle one, the reader's Acquire() swaps the
+ *  middle one with its front copy if anything was published since. A
+ *  single atomic holds which copy is in the middle and whether it is
+ *  new, so neither side ever blocks or waits for the other: the writer
+ *  never waits for a slow reader, and the reader always gets the most
+ *  recent complete copy. Copies published in between two Acquire()
+ *  calls are overwritten, never queued.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef TRIPLEBUFFER_HPP
+#define TRIPLEBUFFER_HPP
+
+#include <atomic>
+#include <cstdint>
+
+template<typename T>
+class TripleBuffer{
+public:
+    // Constructor
+    TripleBuffer(){
+
+    }
+    // Destructor
+    ~TripleBuffer(){
+
+    }
+    // The copy the writer fills before publishing it
+    inline T& GetBack(){
+        return m_copies[m_back];
+    }
+    // Writer: makes the back copy the latest one
+    void Publish(){
+        m_back = m_middle.exchange(m_back | FRESH, std::memory_order_acq_rel) & INDEX_MASK;
+    }
+    // Reader: takes the latest copy if one was published since the last
+    // call, returns false (keeping the old copy) if not
+    bool Acquire(){
+        if((m_middle.load(std::memory_order_relaxed) & FRESH) == 0){
+            return false;
+        }
+        m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & INDEX_MASK;
+        return true;
+    }
+    // The copy the reader acquired last
+    inline const T& GetFront() const{
+        return m_copies[m_front];
+    }
+private:
+    TripleBuffer(const TripleBuffer&) = delete;
+    TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+    // The middle copy was published and not acquired yet
+    static const uint32_t FRESH = 4;
+    static const uint32_t INDEX_MASK = 3;
+
+    T m_copies[3];
+    // Owned by the writer
+    uint32_t m_back{0};
+    std::atomic<uint32_t> m_middle{1};
+    // Owned by the reader
+    uint32_t m_front{2};
+};
+
+#endif
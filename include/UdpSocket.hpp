@@ -0,0 +1,67 @@
+/** @file UdpSocket.hpp
+ *  @brief A non-blocking UDP socket, for the game's versus mode and its
+ *  spectators.
+ *
+ *  Opened with a peer, the socket talks to that peer alone: Send() goes
+ *  to it and Receive() hands out only the datagrams that came from it,
+ *  dropping anything else. Opened without one, SendTo() and
+ *  ReceiveFrom() talk to anybody, by UdpAddress. Nothing ever blocks, so
+ *  the simulation step can poll it every tick. Datagrams may be lost,
+ *  repeated or reordered; what is sent over it has to cope with that.
+ *
+ *  Only IPv4, and only implemented on Linux; elsewhere Open() fails.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef UDPSOCKET_HPP
+#define UDPSOCKET_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// An IPv4 address and port, in host byte order
+struct UdpAddress{
+    uint32_t ip{0};
+    uint16_t port{0};
+};
+
+inline bool operator==(const UdpAddress& a, const UdpAddress& b){
+    return a.ip == b.ip && a.port == b.port;
+}
+
+class UdpSocket{
+public:
+    // Constructor
+    UdpSocket();
+    // Destructor, closes the socket
+    ~UdpSocket();
+    UdpSocket(const UdpSocket&) = delete;
+    UdpSocket& operator=(const UdpSocket&) = delete;
+
+    // Binds every interface on port, port 0 picking a free one
+    bool Open(int port);
+    // Binds port and resolves the one peer, host being "localhost", a
+    // name or an address
+    bool Open(int port, const std::string& host, int peerPort);
+    void Close();
+    inline bool IsOpen() const{
+        return m_fd >= 0;
+    }
+
+    // Sends one datagram; false if it could not be queued
+    bool SendTo(const UdpAddress& address, const void* data, size_t size);
+    // Takes the next datagram waiting, up to capacity bytes of it, and
+    // who sent it; false once nothing is waiting
+    bool ReceiveFrom(void* data, size_t capacity, size_t& size, UdpAddress& sender);
+    // The same with the peer
+    inline bool Send(const void* data, size_t size){
+        return SendTo(m_peer, data, size);
+    }
+    bool Receive(void* data, size_t capacity, size_t& size);
+private:
+    int m_fd{-1};
+    UdpAddress m_peer;
+};
+
+#endif
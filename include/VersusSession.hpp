@@ -0,0 +1,181 @@
+/** @file VersusSession.hpp
+ *  @brief Head-to-head races between two kiosks, --versus=<host>:<port>,
+ *  with input delay and rollback.
+ *
+ *  Both kiosks run the same seed, so their games meet the same obstacles
+ *  in the same order and only the inputs need to cross the network: every
+ *  simulation step each side sends its latest inputs to the other over
+ *  UDP and simulates the opponent's game from the ones it has received.
+ *  A packet repeats every input the peer has not acknowledged yet, so a
+ *  lost one is made up for by the next.
+ *
+ *  The local player's inputs take effect an input delay of a few steps
+ *  after they are read, which gives them that long to reach the peer
+ *  before it needs them. When the opponent's input for a step has not
+ *  arrived in time, the last one received (without its restart) is
+ *  assumed and the opponent's game carries on. Should the real input
+ *  turn out different, the opponent's game is put back to its state
+ *  before that step and simulated again up to the present, all within
+ *  one step: games are plain values, so a snapshot is a copy. Steps
+ *  wait rather than predict more than MAX_PREDICTION steps ahead, and
+ *  the side that runs ahead of the other now and then waits a step so
+ *  both stay level.
+ *
+ *  The games never touch each other, so the local game is the player's
+ *  game as ever; the session only delays its inputs and keeps the
+ *  opponent's game (drawn as a ghost) beside it. Nothing here touches
+ *  SDL or GL.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef VERSUSSESSION_HPP
+#define VERSUSSESSION_HPP
+
+#include "GameState.hpp"
+#include "JumpTrajectory.hpp"
+#include "UdpSocket.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+class VersusSession{
+public:
+    // Steps of inputs kept, for resending and rolling back
+    static const uint32_t HISTORY = 128;
+    // Steps the opponent's game may run on predicted inputs
+    static const uint32_t MAX_PREDICTION = 12;
+    static const int MAX_INPUT_DELAY = 8;
+    // Inputs one packet carries at most
+    static const uint32_t PACKET_INPUTS = 32;
+    // Seconds without a packet after which the opponent is given up on
+    static const int TIMEOUT_SECONDS = 5;
+
+    // Constructor
+    VersusSession();
+    // Destructor
+    ~VersusSession();
+    VersusSession(const VersusSession&) = delete;
+    VersusSession& operator=(const VersusSession&) = delete;
+
+    // Listens on port for the peer at host:peerPort; both sides need the
+    // same seed. The race starts once the peer answers.
+    bool Start(int port, const std::string& host, int peerPort, uint64_t seed, int inputDelay);
+    // Until the peer stopped answering; safe from any thread
+    inline bool IsActive() const{
+        return m_active.load(std::memory_order_acquire);
+    }
+    // Once the peer has answered
+    inline bool IsConnected() const{
+        return m_connected;
+    }
+
+    // Exchanges inputs with the peer, once per simulation step before
+    // Advance(). False if this step has to wait: for the peer to answer,
+    // for its inputs, or for it to catch up.
+    bool Poll();
+    // Takes the local input read this step and returns the one to apply
+    // to the local game now, from an input delay ago; advances the
+    // opponent's game by a step, rolling it back first if a prediction
+    // was wrong
+    uint8_t Advance(uint8_t localInput);
+    // Records inputs of the opponent for steps first, first + 1...
+    void AddRemoteInputs(uint32_t first, const uint8_t* inputs, uint32_t count);
+
+    // Steps taken since the race started
+    inline uint32_t GetFrame() const{
+        return m_frame;
+    }
+    // The opponent's game as of GetFrame(), its jump on the GetFrame()
+    // clock and the palette of its last input
+    inline const GameState& GetRemoteGame() const{
+        return m_remote;
+    }
+    inline const JumpAnchor& GetRemoteJump() const{
+        return m_remoteJump;
+    }
+    inline uint8_t GetRemotePalette() const{
+        return m_remotePalette;
+    }
+    // Like gamesPlayed of StepLoggedInput()
+    inline uint64_t GetRemoteGamesPlayed() const{
+        return m_remoteGamesPlayed;
+    }
+    // True while the opponent's game has only been stepped with inputs it
+    // really sent, so nothing about it can change any more
+    inline bool IsRemoteConfirmed() const{
+        return m_remoteConfirmed >= m_frame;
+    }
+    // Rollbacks so far and the steps they simulated again
+    inline uint64_t GetRollbacks() const{
+        return m_rollbacks;
+    }
+    inline uint64_t GetResimulatedSteps() const{
+        return m_resimulated;
+    }
+    // Round trip to the peer, in milliseconds
+    inline uint32_t GetRoundTripMs() const{
+        return m_roundTripMs;
+    }
+private:
+    // The opponent's game before a step
+    struct Snapshot{
+        GameState game;
+        uint64_t gamesPlayed{0};
+        JumpAnchor jump;
+        uint8_t palette{0};
+    };
+
+    // Steps the opponent's game over step frame, with its real input if
+    // that has arrived and the predicted one otherwise
+    void StepRemote(uint32_t frame);
+    void SendInputs();
+    uint32_t GetMilliseconds() const;
+
+    UdpSocket m_socket;
+    uint64_t m_seed{0};
+    uint32_t m_inputDelay{0};
+    std::atomic<bool> m_active{false};
+    bool m_connected{false};
+    bool m_seedWarned{false};
+
+    // The next step to take
+    uint32_t m_frame{0};
+    // Inputs by step modulo HISTORY: the player's, the opponent's as
+    // received and the opponent's as simulated
+    uint8_t m_localInputs[HISTORY] = {};
+    uint8_t m_remoteInputs[HISTORY] = {};
+    uint8_t m_usedInputs[HISTORY] = {};
+    // The opponent's inputs are known for the steps below this one
+    uint32_t m_remoteConfirmed{0};
+    // The peer has the player's inputs for the steps below this one
+    uint32_t m_peerAck{0};
+    // First step simulated with a wrong prediction, or NO_MISMATCH
+    uint32_t m_mismatch;
+
+    GameState m_remote;
+    uint64_t m_remoteGamesPlayed{0};
+    JumpAnchor m_remoteJump;
+    uint8_t m_remotePalette{0};
+    Snapshot m_snapshots[HISTORY];
+
+    // The peer's next step and how far it was ahead of the player, as of
+    // its last packet
+    uint32_t m_remoteFrame{0};
+    int m_remoteAdvantage{0};
+    // Steps left before the frame advantage is looked at again
+    uint32_t m_syncCooldown{0};
+
+    std::chrono::steady_clock::time_point m_epoch;
+    uint32_t m_lastReceiveMs{0};
+    // Send time of the peer's last packet, echoed back in ours
+    uint32_t m_echoMs{0};
+    uint32_t m_roundTripMs{0};
+
+    uint64_t m_rollbacks{0};
+    uint64_t m_resimulated{0};
+};
+
+#endif
@@ -0,0 +1,68 @@
+/** @file VertexFormat.hpp
+ *  @brief Packed vertex layout used for the GPU vertex stream.
+ *
+ *  Meshes are loaded as 8 float interleaved vertices
+ *  (x,y,z,nx,ny,nz,u,v, 32 bytes). Before upload they are converted
+ *  to a 20 byte PackedVertex: full float positions, normals packed
+ *  into GL_INT_2_10_10_10_REV and half-float texture coordinates.
+ *  Instanced meshes additionally read one InstanceData per instance.
+ *  Passes that only need where the vertices are read a position stream
+ *  of 12 bytes a vertex instead, see ExtractPositions().
+ *
+ *  @bug No known bugs.
+ */
+#ifndef VERTEXFORMAT_HPP
+#define VERTEXFORMAT_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// Floats per vertex in the unpacked interleaved stream
+const size_t FLOATS_PER_VERTEX = 8;
+
+struct PackedVertex{
+    float x, y, z;      // position
+    uint32_t normal;    // nx,ny,nz as signed normalised 10:10:10, w unused
+    uint16_t u, v;      // texture coordinates as half floats
+};
+
+static_assert(sizeof(PackedVertex) == 20, "PackedVertex must stay tightly packed");
+
+// Per-instance attributes, advanced once per instance (divisor 1)
+struct InstanceData{
+    float x, y, z;      // offset added to the mesh position
+    float scale;        // uniform scale of the mesh
+    float palette;      // palette column added to u_PaletteIndex
+    float uOffset;      // texture U offset added to u_UVOffset
+    float layer;        // texture array layer to sample by day, or a
+                        // palette row if negative
+    float nightLayer;   // layer blended in as u_TimeOfDay goes to 1
+    // Cosmetic motion the vertex shader works out from u_Time, all 0 for
+    // none: the step a jump took off at and its speed, the run bob height
+    // and how much the mesh squashes and stretches around a jump
+    float jumpStart;
+    float jumpSpeed;
+    float bobHeight;
+    float squash;
+};
+
+static_assert(sizeof(InstanceData) == 48, "InstanceData must stay tightly packed");
+
+// Converts a float to an IEEE 754 half float (round to nearest even)
+uint16_t FloatToHalf(float value);
+
+// Converts a half float back to a float
+float HalfToFloat(uint16_t value);
+
+// Packs a normal into GL_INT_2_10_10_10_REV layout (x in the low bits)
+uint32_t PackNormal(float nx, float ny, float nz);
+
+// Converts vertexCount interleaved 8 float vertices into packed vertices
+void PackVertices(const float* interleaved, size_t vertexCount, std::vector<PackedVertex>& out);
+
+// Copies the x,y,z of vertexCount interleaved 8 float vertices into a
+// tightly packed position stream, 3 floats per vertex
+void ExtractPositions(const float* interleaved, size_t vertexCount, std::vector<float>& out);
+
+#endif
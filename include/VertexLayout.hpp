@@ -0,0 +1,111 @@
+/** @file VertexLayout.hpp
+ *  @brief Vertex attribute setup derived from a compile-time description.
+ *
+ *  A VertexLayout lists the attributes of one interleaved vertex in
+ *  memory order, each as its shader location, component count, GL type
+ *  and whether it is normalized. The byte size of every attribute,
+ *  the offsets and the stride are all computed at compile time, and
+ *  Setup() emits the glVertexAttribPointer calls from them, so the
+ *  calls cannot drift from the layout. With direct state access,
+ *  SetupFormat() describes the same attributes in a vertex array by
+ *  name instead, read from one buffer binding point; the buffer is
+ *  attached to that point on its own, with STRIDE. Checking STRIDE and Offset()
+ *  against the C++ vertex struct with static_assert catches a struct
+ *  and a layout that disagree before anything runs.
+ *
+ *  Packed types are sized by what they are, not by their component
+ *  count: GL_INT_2_10_10_10_REV is four components in four bytes.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef VERTEXLAYOUT_HPP
+#define VERTEXLAYOUT_HPP
+
+#include <glad/glad.h>
+
+#include <cstddef>
+
+// Bytes of an attribute with components of type, 0 for unsupported types
+constexpr size_t VertexAttributeBytes(GLenum type, GLint components){
+    return (type == GL_INT_2_10_10_10_REV || type == GL_UNSIGNED_INT_2_10_10_10_REV) ? 4 :
+           (type == GL_FLOAT || type == GL_INT || type == GL_UNSIGNED_INT) ? 4 * (size_t)components :
+           (type == GL_HALF_FLOAT || type == GL_SHORT || type == GL_UNSIGNED_SHORT) ? 2 * (size_t)components :
+           (type == GL_BYTE || type == GL_UNSIGNED_BYTE) ? (size_t)components : 0;
+}
+
+// One attribute read as floats by the shader
+template<GLuint Location, GLint Components, GLenum Type, bool Normalized = false>
+struct VertexAttribute{
+    static constexpr GLuint LOCATION = Location;
+    static constexpr GLint COMPONENTS = Components;
+    static constexpr GLenum TYPE = Type;
+    static constexpr GLboolean NORMALIZED = Normalized ? GL_TRUE : GL_FALSE;
+    static constexpr size_t BYTES = VertexAttributeBytes(Type, Components);
+
+    static_assert(Components >= 1 && Components <= 4, "An attribute has one to four components");
+    static_assert(BYTES > 0, "Unsupported attribute type");
+    static_assert((Type != GL_INT_2_10_10_10_REV && Type != GL_UNSIGNED_INT_2_10_10_10_REV) || Components == 4,
+                  "Packed 2_10_10_10 attributes have four components");
+};
+
+// The attribute types used by the renderer
+template<GLuint Location, GLint Components>
+using FloatAttribute = VertexAttribute<Location, Components, GL_FLOAT>;
+template<GLuint Location, GLint Components>
+using HalfFloatAttribute = VertexAttribute<Location, Components, GL_HALF_FLOAT>;
+// Signed normalized 10:10:10 in the low bits, 2 bits of w on top
+template<GLuint Location>
+using Snorm10Attribute = VertexAttribute<Location, 4, GL_INT_2_10_10_10_REV, true>;
+// Bytes mapped to [0,1]
+template<GLuint Location, GLint Components>
+using Unorm8Attribute = VertexAttribute<Location, Components, GL_UNSIGNED_BYTE, true>;
+
+template<typename... Attributes>
+struct VertexLayout{
+    static constexpr size_t ATTRIBUTE_COUNT = sizeof...(Attributes);
+    static constexpr size_t STRIDE = (Attributes::BYTES + ... + 0);
+
+    // Byte offset of the attribute at index within a vertex
+    static constexpr size_t Offset(size_t index){
+        const size_t bytes[] = {Attributes::BYTES...};
+        size_t offset = 0;
+        for(size_t i = 0; i < index; ++i){
+            offset += bytes[i];
+        }
+        return offset;
+    }
+
+    // Enables and points every attribute at the buffer bound to
+    // GL_ARRAY_BUFFER, with the first vertex at byteOffset. A divisor of
+    // 1 advances the attributes once per instance instead of per vertex.
+    static void Setup(size_t byteOffset = 0, GLuint divisor = 0){
+        size_t offset = byteOffset;
+        (SetupAttribute<Attributes>(offset, divisor), ...);
+    }
+    // Direct state access: enables every attribute of vao and reads it
+    // from binding, which advances once per instance with a divisor of 1
+    static void SetupFormat(GLuint vao, GLuint binding, GLuint divisor = 0){
+        GLuint offset = 0;
+        (SetupFormatAttribute<Attributes>(vao, binding, offset), ...);
+        glVertexArrayBindingDivisor(vao, binding, divisor);
+    }
+private:
+    template<typename Attribute>
+    static void SetupFormatAttribute(GLuint vao, GLuint binding, GLuint& offset){
+        glEnableVertexArrayAttrib(vao, Attribute::LOCATION);
+        glVertexArrayAttribFormat(vao, Attribute::LOCATION, Attribute::COMPONENTS, Attribute::TYPE,
+                                  Attribute::NORMALIZED, offset);
+        glVertexArrayAttribBinding(vao, Attribute::LOCATION, binding);
+        offset += (GLuint)Attribute::BYTES;
+    }
+    template<typename Attribute>
+    static void SetupAttribute(size_t& offset, GLuint divisor){
+        glEnableVertexAttribArray(Attribute::LOCATION);
+        glVertexAttribPointer(Attribute::LOCATION, Attribute::COMPONENTS, Attribute::TYPE,
+                              Attribute::NORMALIZED, (GLsizei)STRIDE, (const GLvoid*)offset);
+        glVertexAttribDivisor(Attribute::LOCATION, divisor);
+        offset += Attribute::BYTES;
+    }
+};
+
+#endif
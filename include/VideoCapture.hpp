@@ -0,0 +1,123 @@
+/** @file VideoCapture.hpp
+ *  @brief Gameplay video recorded without holding the frame loop up,
+ *  --capture=<file>.
+ *
+ *  Each frame due at the capture rate is read out of the back buffer,
+ *  after everything is drawn and before the swap, with an asynchronous
+ *  glReadPixels into one of a ring of three pixel buffer objects, and
+ *  fenced. A readback is only mapped at a later capture, once its
+ *  fence has signalled; with two more behind it before its buffer is
+ *  needed again, the CPU does not wait for the GPU to finish a frame.
+ *  The pixels are copied into one of a fixed pool of frames and handed
+ *  to an encoder thread through a lock-free queue; the thread converts
+ *  them to YUV 4:2:0, writes them out as a Y4M stream and gives each
+ *  frame back to the pool through another. When the encoder falls so far
+ *  behind that no pool frame is free, the frame is dropped rather than
+ *  waited for, and counted.
+ *
+ *  A file ending in .y4m is written as is; for any other name the
+ *  stream is piped into ffmpeg, which picks the format from the
+ *  extension. Frames are timed by the clock passed to Capture(): a
+ *  frame covering more than one capture period (a slow frame, the game
+ *  over screen waiting for a key) is repeated in the video, up to a
+ *  second's worth.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef VIDEOCAPTURE_HPP
+#define VIDEOCAPTURE_HPP
+
+#include "SpscQueue.hpp"
+
+#include <glad/glad.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+class VideoCapture{
+public:
+    // Frames read back but not yet written; more waiting are dropped
+    static const unsigned int POOL_FRAMES = 8;
+
+    // Constructor
+    VideoCapture();
+    // Destructor
+    // Note: Call End() while the GL context is alive.
+    ~VideoCapture();
+    // Starts capturing the lower left width x height pixels of the
+    // window at fps frames per second into filepath. Odd sizes are
+    // rounded down, as 4:2:0 needs them even.
+    bool Begin(const std::string& filepath, int width, int height, int fps);
+    inline bool IsCapturing() const{
+        return m_file != nullptr;
+    }
+    // Reads back the frame in the back buffer if one is due at seconds,
+    // and hands readbacks that finished in the meantime to the encoder
+    void Capture(double seconds);
+    // Collects the readbacks still in flight, lets the encoder write
+    // every frame and closes the file. Deletes the buffers.
+    void End();
+
+    // Frames handed to the encoder, and dropped for want of a free one
+    inline unsigned long GetFrameCount() const{
+        return m_frames;
+    }
+    inline unsigned long GetDroppedCount() const{
+        return m_dropped;
+    }
+private:
+    // Readbacks in flight on the GPU
+    static const unsigned int READBACK_SLOTS = 3;
+
+    struct Slot{
+        GLuint buffer;
+        GLsync fence;       // Set while a readback is in flight
+        unsigned int repeat;
+    };
+    struct Frame{
+        std::vector<uint8_t> pixels;    // RGBA, bottom row first
+        unsigned int repeat;            // Times it is written
+    };
+    // Maps a slot's finished readback into a free frame and queues it.
+    // With wait set it blocks until the GPU is done, otherwise it gives
+    // up if not done yet.
+    bool Collect(Slot& slot, bool wait);
+    // The encoder thread: writes queued frames until End() and the queue
+    // is empty
+    void EncoderMain();
+    void WriteFrame(const Frame& frame);
+
+    std::string m_path;
+    FILE* m_file{nullptr};
+    bool m_piped{false};
+    int m_width{0};
+    int m_height{0};
+    double m_period{0.0};
+    int m_maxRepeat{1};
+    // When the next frame is due, negative before the first
+    double m_nextSeconds{-1.0};
+
+    Slot m_slots[READBACK_SLOTS] = {};
+    unsigned int m_nextSlot{0};
+
+    Frame m_pool[POOL_FRAMES];
+    // Frame indices: queued for the encoder, and given back by it
+    SpscQueue<unsigned int, POOL_FRAMES> m_encodeQueue;
+    SpscQueue<unsigned int, POOL_FRAMES> m_freeQueue;
+    std::thread m_encoder;
+    std::atomic<bool> m_stopping{false};
+    // Set by the encoder once a write fails; nothing more is written
+    std::atomic<bool> m_failed{false};
+    // The encoder's Y, U and V planes
+    std::vector<uint8_t> m_planes;
+
+    unsigned long m_frames{0};
+    unsigned long m_dropped{0};
+    unsigned long m_stalls{0};
+};
+
+#endif
@@ -0,0 +1,33 @@
+/** @file ViewportLayout.hpp
+ *  @brief Splits a render target into the views of split screen.
+ *
+ *  Every local player gets one rectangle of the target. The runner is
+ *  wide and short, so two and three players get rows the full width of
+ *  the target, top to bottom, and four a 2x2 grid, left to right and top
+ *  to bottom. Rectangles are in GL window coordinates, origin at the
+ *  bottom left, and cover the target without gaps or overlaps: the rows
+ *  and columns that do not divide evenly take the rounding.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef VIEWPORTLAYOUT_HPP
+#define VIEWPORTLAYOUT_HPP
+
+#include <cstddef>
+
+// Most views a target is split into, one per local player
+const size_t MAX_VIEWPORTS = 4;
+
+// A view's rectangle, as glViewport and glScissor take it
+struct ViewportRect{
+    int x = 0;
+    int y = 0;
+    int width = 0;
+    int height = 0;
+};
+
+// Lays count views (clamped to 1 .. MAX_VIEWPORTS) out over a target of
+// width by height pixels into rects, player 1 first. Returns the count.
+size_t LayOutViewports(int width, int height, size_t count, ViewportRect* rects);
+
+#endif
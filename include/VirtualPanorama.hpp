@@ -0,0 +1,171 @@
+/** @file VirtualPanorama.hpp
+ *  @brief A scrolling backdrop tens of thousands of texels wide, streamed
+ *  into a fixed cache of tiles.
+ *
+ *  The panorama is a binary PPM (P6) that is never loaded whole: it is
+ *  mapped with FileView and cut into square tiles of tileSize texels,
+ *  which jobs of the JobSystem decode from the mapping on demand. The
+ *  GPU holds a tile cache, one RGBA8 texture of cacheColumns x
+ *  cacheRows slots, each a tile with a border of one texel copied from
+ *  its neighbours so filtering never bleeds across slots. An
+ *  indirection table, one RGBA8 texel per tile of the panorama, tells
+ *  the fragment shader which slot holds a tile ((r, g) the slot's
+ *  column and row, a 1 if the tile is in the cache); see
+ *  shaders/sky_frag.glsl.
+ *
+ *  Update() is handed the range of panorama columns the view shows.
+ *  It uploads a few tiles that finished decoding, keeps those in view
+ *  and the prefetchColumns tile columns further along the direction
+ *  the view last moved, and has the missing ones decoded, evicting the
+ *  slots used longest ago. What the GPU holds stays the size of the
+ *  cache however wide the panorama is, and a frame uploads at most
+ *  uploadsPerFrame tiles. The panorama repeats once it ends, along x
+ *  only.
+ *
+ *  @bug No known bugs.
+ */
+#ifndef VIRTUALPANORAMA_HPP
+#define VIRTUALPANORAMA_HPP
+
+#include "FileView.hpp"
+#include "JobSystem.hpp"
+
+#include <glad/glad.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Texture units the sky reads the tile cache and its table from
+const unsigned int PANORAMA_CACHE_UNIT = 5;
+const unsigned int PANORAMA_TABLE_UNIT = 6;
+
+struct VirtualPanoramaConfig{
+    // Texels across a tile
+    int tileSize{128};
+    // Tile slots across and down the cache texture
+    int cacheColumns{16};
+    int cacheRows{8};
+    // Columns of tiles streamed in ahead of the view
+    int prefetchColumns{4};
+    // Tiles decoded at once, and uploaded in a frame at most
+    int decodesInFlight{8};
+    int uploadsPerFrame{4};
+};
+
+class VirtualPanorama{
+public:
+    // Constructor
+    VirtualPanorama();
+    // Destructor
+    // Note: Call Release() while the GL context is alive.
+    ~VirtualPanorama();
+    VirtualPanorama(const VirtualPanorama&) = delete;
+    VirtualPanorama& operator=(const VirtualPanorama&) = delete;
+    // Maps the P6 PPM at filepath and creates the cache and the table,
+    // with no tile in it yet. False if the file is not one or its tiles
+    // do not fit the cache.
+    bool Initialize(const std::string& filepath, const VirtualPanoramaConfig& config = VirtualPanoramaConfig());
+    // True once Initialize() succeeded
+    inline bool IsReady() const{
+        return m_cache != 0;
+    }
+    // Size of the panorama in texels
+    inline int GetWidth() const{
+        return m_width;
+    }
+    inline int GetHeight() const{
+        return m_height;
+    }
+    // Size of a tile, of a slot and of the cache in texels
+    inline int GetTileSize() const{
+        return m_config.tileSize;
+    }
+    inline int GetSlotSize() const{
+        return m_config.tileSize + 2;
+    }
+    inline int GetCacheWidth() const{
+        return m_config.cacheColumns * GetSlotSize();
+    }
+    inline int GetCacheHeight() const{
+        return m_config.cacheRows * GetSlotSize();
+    }
+    // True if the tiles of a view widthTexels wide and the columns ahead
+    // of it fit the cache at once; a view that does not leaves the tiles
+    // past the cache missing for good
+    bool Fits(double widthTexels) const;
+    // Streams for a view of the columns from firstTexel on, widthTexels
+    // wide, any number of panorama widths along. Once a frame, GL thread.
+    void Update(double firstTexel, double widthTexels);
+    // Binds the cache and the table to their units
+    void Bind() const;
+    // Tiles uploaded so far, and tiles a frame showed before they were in
+    inline uint64_t GetUploadCount() const{
+        return m_uploads;
+    }
+    inline uint64_t GetMissCount() const{
+        return m_misses;
+    }
+    // Waits for the decodes in flight and deletes the GL objects
+    void Release();
+private:
+    // A slot of the cache and the tile in it
+    struct Slot{
+        // Tile index, -1 if the slot is free
+        int32_t tile{-1};
+        // Frame the tile was last wanted in
+        uint64_t lastUsed{0};
+        // Still being decoded, not in the table yet
+        bool pending{false};
+    };
+    // A tile being decoded by a job into texels of its own
+    struct Decode{
+        int32_t tile{-1};
+        uint32_t slot{0};
+        std::vector<uint8_t> texels;
+        std::atomic<bool> done{false};
+    };
+
+    // Copies a tile and its border out of the mapping, as RGBA8, bottom
+    // row first
+    void DecodeTile(int32_t tile, uint8_t* texels) const;
+    // Uploads the tiles decoded since the last frame, up to the per-frame
+    // number
+    void UploadDecoded();
+    // Keeps a tile for this frame, starting its decode if it is missing;
+    // false once no slot or decode is left
+    bool Want(int32_t tile);
+    // A slot not wanted this frame and not decoding, the one used longest
+    // ago, or -1
+    int FindVictim() const;
+
+    VirtualPanoramaConfig m_config;
+    FileView m_file;
+    // First texel of the top row in the mapping
+    const uint8_t* m_texels{nullptr};
+    int m_width{0};
+    int m_height{0};
+    int m_tileColumns{0};
+    int m_tileRows{0};
+    GLuint m_cache{0};
+    GLuint m_table{0};
+    std::vector<Slot> m_slots;
+    // Slot of every tile, -1 when it is not in the cache
+    std::vector<int32_t> m_tileSlots;
+    // The table as uploaded, re-uploaded whole when a tile comes or goes
+    std::vector<uint8_t> m_tableTexels;
+    bool m_tableDirty{false};
+    std::unique_ptr<Decode[]> m_decodes;
+    JobCounter m_decoding;
+    uint64_t m_frame{0};
+    // Where the view started last frame, and which way it went
+    double m_lastFirst{0.0};
+    int m_direction{1};
+    uint64_t m_uploads{0};
+    uint64_t m_misses{0};
+};
+
+#endif
@@ -0,0 +1,38 @@
+#version 410 core
+#
+// The scene's vertex shader for the observation atlas. Every instance
+// belongs to one environment, and is drawn into that environment's tile
+// of the atlas as if the tile had a viewport of its own.
+
+// Attributes, the per-draw palette uniforms and the outputs. x of
+// instanceMaterial is the tile (the environment's index) here; every
+// environment shares the palette column u_PaletteIndex.
+#include "instance_common.glsl"
+
+// Projection and view of one tile
+uniform mat4 u_ViewProjection;
+// Tiles across and down the atlas
+uniform vec2 u_AtlasGrid;
+
+void main()
+{
+    PassMaterial(0.0f);
+
+    vec4 clip = u_ViewProjection * vec4(InstancePosition(), 1.0f);
+
+    // Clipped against the left, right, bottom and top edge of the tile
+    // camera's own view first, so nothing spills into the neighbours
+    gl_ClipDistance[0] = clip.w + clip.x;
+    gl_ClipDistance[1] = clip.w - clip.x;
+    gl_ClipDistance[2] = clip.w + clip.y;
+    gl_ClipDistance[3] = clip.w - clip.y;
+
+    // Then its [-w, w] range is squeezed into the tile's share of the
+    // atlas; tiles run left to right, then bottom to top. Half a tile
+    // keeps the division off the row boundary.
+    float tile = instanceMaterial.x;
+    float row = floor((tile + 0.5f) / u_AtlasGrid.x);
+    vec2 cell = vec2(tile - row*u_AtlasGrid.x, row);
+    clip.xy = ((clip.xy + clip.w)*0.5f + cell*clip.w) / u_AtlasGrid * 2.0f - clip.w;
+    gl_Position = clip;
+}
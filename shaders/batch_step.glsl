@@ -0,0 +1,418 @@
+#version 410 core
+
+// One environment per vertex, read from the buffer the last step wrote;
+// the layout is GPUGameState in GPUGameBatch.hpp
+layout(location=0) in ivec4 state0;     // tick, dayTick, dinoHeight, flags
+layout(location=1) in ivec4 state1;     // jumpingSpeed, scroll, spawnDistance, cactusSpeed
+layout(location=2) in ivec4 lane0;      // obstacle x of ring slots 0-3
+layout(location=3) in ivec4 lane1;      // and 4-7
+layout(location=4) in uvec4 rng;        // state, increment, low half first
+layout(location=5) in ivec4 result;     // head | count << 8, events, reward bits, episodes
+// GameParameters: cactusSpeed, jumpingSpeed, jumpApex, dayLength, then
+// daySpeedup, spawnGapMin, spawnGapRange, spawnSpeedMin
+layout(location=6) in ivec4 parameters0;
+layout(location=7) in ivec4 parameters1;
+layout(location=8) in int action;
+
+// Captured by transform feedback into the other buffer
+flat out ivec4 v_state0;
+flat out ivec4 v_state1;
+flat out ivec4 v_lane0;
+flat out ivec4 v_lane1;
+flat out uvec4 v_rng;
+flat out ivec4 v_result;
+
+uniform int u_Ticks;
+uniform int u_Repeat;
+// Finished games start over on stream index + episodes * u_Count
+uniform bool u_AutoReset;
+uniform uvec2 u_Seed;               // low, high
+uniform uint u_Count;
+// GetCollisionRules().hitRange: minX, maxX, minY, maxY
+uniform ivec4 u_HitRange;
+// GetCollisionRules().silhouettes, and the silhouettes' boxes and rows,
+// two rows per element as (low, high) halves
+const int SILHOUETTE_SIZE = 64;
+uniform bool u_Silhouettes;
+uniform ivec4 u_DinoBox;
+uniform ivec4 u_ObstacleBox;
+uniform uvec4 u_DinoRows[SILHOUETTE_SIZE / 2];
+uniform uvec4 u_ObstacleRows[SILHOUETTE_SIZE / 2];
+// The spawner's formations: count, spacing, weight
+const int MAX_ARCHETYPES = 8;
+uniform int u_ArchetypeCount;
+uniform ivec3 u_Archetypes[MAX_ARCHETYPES];
+
+// As in GameState.hpp and ObstacleLane.hpp
+const int ACTION_JUMP = 1;
+const int EVENT_DAY_CHANGED = 1;
+const int EVENT_GAME_OVER = 2;
+const int OBSTACLE_SPAWN_X = 400;
+const int OBSTACLE_DESPAWN_X = -800;
+const int LANE_CAPACITY = 8;
+const int LANE_MASK = 7;
+// GPUGameFlag
+const int FLAG_DAYTIME = 1;
+const int FLAG_JUMPING = 2;
+const int FLAG_JUMPING_UP = 4;
+const int FLAG_GAME_OVER = 8;
+const int FLAG_INVINCIBLE = 16;
+
+// The game being stepped, unpacked
+int tick;
+int dayTick;
+bool isDaytime;
+int dinoHeight;
+bool isJumping;
+bool jumpingUp;
+int jumpingSpeed;
+int scroll;
+int spawnDistance;
+int cactusSpeed;
+int laneX[LANE_CAPACITY];
+int laneHead;
+int laneCount;
+bool gameOver;
+bool invincible;
+uvec2 rngState;
+uvec2 rngIncrement;
+
+int startCactusSpeed;
+int startJumpingSpeed;
+int jumpApex;
+int dayLength;
+int daySpeedup;
+int spawnGapMin;
+int spawnGapRange;
+int spawnSpeedMin;
+
+// 64-bit numbers are (low, high) pairs; both wrap modulo 2^64
+uvec2 Add64(uvec2 a, uvec2 b){
+    uint carry;
+    uint low = uaddCarry(a.x, b.x, carry);
+    return uvec2(low, a.y + b.y + carry);
+}
+
+uvec2 Mul64(uvec2 a, uvec2 b){
+    uint high;
+    uint low;
+    umulExtended(a.x, b.x, high, low);
+    return uvec2(low, high + a.x * b.y + a.y * b.x);
+}
+
+// NextGameRandom() in GameRandom.hpp
+uint NextRandom(){
+    uvec2 old = rngState;
+    // 6364136223846793005
+    rngState = Add64(Mul64(old, uvec2(0x4C957F2Du, 0x5851F42Du)), rngIncrement);
+    // ((old >> 18) ^ old) >> 27, of which the low 32 bits are kept
+    uvec2 mixed = uvec2((old.x >> 18) | (old.y << 14), old.y >> 18) ^ old;
+    uint xorshifted = (mixed.x >> 27) | (mixed.y << 5);
+    uint rotation = old.y >> 27;
+    return (xorshifted >> rotation) | (xorshifted << ((32u - rotation) & 31u));
+}
+
+// SeedGameRandom()
+void SeedRandom(uvec2 seed, uvec2 stream){
+    rngState = uvec2(0u);
+    rngIncrement = uvec2((stream.x << 1) | 1u, (stream.y << 1) | (stream.x >> 31));
+    NextRandom();
+    rngState = Add64(rngState, seed);
+    NextRandom();
+}
+
+// ResetGameState()
+void ResetGame(uvec2 stream){
+    tick = 0;
+    dayTick = 0;
+    isDaytime = true;
+    dinoHeight = 0;
+    isJumping = false;
+    jumpingUp = true;
+    jumpingSpeed = startJumpingSpeed;
+    scroll = 0;
+    spawnDistance = 0;
+    cactusSpeed = startCactusSpeed;
+    for(int slot = 0; slot < LANE_CAPACITY; ++slot){
+        laneX[slot] = 0;
+    }
+    laneHead = 0;
+    laneCount = 0;
+    gameOver = false;
+    invincible = false;
+    SeedRandom(u_Seed, stream);
+}
+
+// InsertObstacle(), every obstacle at y 0
+void InsertObstacle(int x){
+    if(laneCount == LANE_CAPACITY){
+        return;
+    }
+    int i = laneCount;
+    while(i > 0 && laneX[(laneHead + i - 1) & LANE_MASK] > x){
+        laneX[(laneHead + i) & LANE_MASK] = laneX[(laneHead + i - 1) & LANE_MASK];
+        --i;
+    }
+    laneX[(laneHead + i) & LANE_MASK] = x;
+    ++laneCount;
+}
+
+// SpawnObstacles(), random numbers drawn in the same order
+void SpawnObstacles(){
+    for(int slot = 0; slot < LANE_CAPACITY; ++slot){
+        laneX[slot] -= scroll;
+    }
+    scroll = 0;
+    while(laneCount > 0 && laneX[laneHead] < OBSTACLE_DESPAWN_X){
+        laneHead = (laneHead + 1) & LANE_MASK;
+        --laneCount;
+    }
+    int totalWeight = 0;
+    for(int i = 0; i < u_ArchetypeCount; ++i){
+        totalWeight += u_Archetypes[i].z;
+    }
+    while(spawnDistance <= 0){
+        int roll = int(NextRandom() % uint(totalWeight));
+        int pick = 0;
+        while(roll >= u_Archetypes[pick].z){
+            roll -= u_Archetypes[pick].z;
+            ++pick;
+        }
+        ivec3 archetype = u_Archetypes[pick];
+        int x = OBSTACLE_SPAWN_X + spawnDistance;
+        for(int i = 0; i < archetype.x; ++i){
+            InsertObstacle(x + i*archetype.y);
+        }
+        int gap = int(NextRandom() % uint(spawnGapRange)) + spawnGapMin;
+        spawnDistance += (archetype.x - 1)*archetype.y + gap;
+        cactusSpeed = int(NextRandom() % uint(cactusSpeed)) + spawnSpeedMin;
+    }
+}
+
+// a*b > c*d, with the products in 64 bits as ClipAxis() has them
+bool ProductGreater(int a, int b, int c, int d){
+    int highAB;
+    int lowAB;
+    int highCD;
+    int lowCD;
+    imulExtended(a, b, highAB, lowAB);
+    imulExtended(c, d, highCD, lowCD);
+    return (highAB != highCD) ? (highAB > highCD) : (uint(lowAB) > uint(lowCD));
+}
+
+// ClipAxis() in Collision.cpp; times are (numerator, denominator)
+bool ClipAxis(int low, int high, int p0, int p1, inout ivec2 entry, inout ivec2 leave){
+    int delta = p1 - p0;
+    if(delta == 0){
+        return low <= p0 && p0 <= high;
+    }
+    int nearNum = (delta > 0) ? low - p0 : p0 - high;
+    int farNum = (delta > 0) ? high - p0 : p0 - low;
+    int den = abs(delta);
+    if(ProductGreater(nearNum, entry.y, entry.x, den)){
+        entry = ivec2(nearNum, den);
+    }
+    if(ProductGreater(leave.x, den, farNum, leave.y)){
+        leave = ivec2(farNum, den);
+    }
+    return !ProductGreater(entry.x, leave.y, leave.x, entry.y);
+}
+
+// Row of a silhouette as (low, high) halves
+uvec2 DinoRow(int row){
+    uvec4 pair = u_DinoRows[row >> 1];
+    return ((row & 1) == 0) ? pair.xy : pair.zw;
+}
+
+uvec2 ObstacleRow(int row){
+    uvec4 pair = u_ObstacleRows[row >> 1];
+    return ((row & 1) == 0) ? pair.xy : pair.zw;
+}
+
+// A 64-bit row shifted towards higher bits by shift, lower if negative
+uvec2 ShiftRow(uvec2 row, int shift){
+    if(shift == 0){
+        return row;
+    }
+    if(shift >= 32){
+        return uvec2(0u, row.x << uint(shift - 32));
+    }
+    if(shift > 0){
+        return uvec2(row.x << uint(shift), (row.y << uint(shift)) | (row.x >> uint(32 - shift)));
+    }
+    if(shift <= -32){
+        return uvec2(row.y >> uint(-shift - 32), 0u);
+    }
+    return uvec2((row.x >> uint(-shift)) | (row.y << uint(32 + shift)), row.y >> uint(-shift));
+}
+
+// SilhouettesOverlap() in Collision.cpp, of the dino's and an obstacle's
+bool SilhouettesOverlap(int x, int y){
+    int shift = x + u_ObstacleBox.x - u_DinoBox.x;
+    if(shift <= -SILHOUETTE_SIZE || shift >= SILHOUETTE_SIZE){
+        return false;
+    }
+    int first = max(0, y + u_ObstacleBox.z - u_DinoBox.z);
+    int last = min(u_DinoBox.w - u_DinoBox.z, y + u_ObstacleBox.w - u_DinoBox.z);
+    for(int row = first; row <= last; ++row){
+        uvec2 other = ShiftRow(ObstacleRow(row + u_DinoBox.z - y - u_ObstacleBox.z), shift);
+        uvec2 mine = DinoRow(row);
+        if(((mine.x & other.x) | (mine.y & other.y)) != 0u){
+            return true;
+        }
+    }
+    return false;
+}
+
+// a*k/steps with the division of non-negative numbers, as SweptHit()
+// in Collision.cpp has it
+int PathStep(int a, int k, int steps){
+    return (a >= 0) ? (a * k / steps) : -(-a * k / steps);
+}
+
+// Whether the dino, moving from (x0, y0) to (x1, y1), touches any
+// obstacle: FindFirstSweptLaneHit() < count
+bool SweptHit(int x0, int y0, int x1, int y1){
+    int left = min(x0, x1);
+    int right = max(x0, x1);
+    for(int i = 0; i < laneCount; ++i){
+        int x = laneX[(laneHead + i) & LANE_MASK];
+        if(x < left + u_HitRange.x || x > right + u_HitRange.y){
+            continue;
+        }
+        ivec2 entry = ivec2(0, 1);
+        ivec2 leave = ivec2(1, 1);
+        if(!ClipAxis(u_HitRange.x, u_HitRange.y, x - x0, x - x1, entry, leave) ||
+           !ClipAxis(u_HitRange.z, u_HitRange.w, -y0, -y1, entry, leave)){
+            continue;
+        }
+        if(!u_Silhouettes){
+            return true;
+        }
+        // The obstacle's offset from the dino walked a game unit at a time
+        int dx = x0 - x1;
+        int dy = y0 - y1;
+        int steps = max(abs(dx), abs(dy));
+        for(int k = 0; k <= steps; ++k){
+            int ox = x - x0;
+            int oy = -y0;
+            if(steps > 0){
+                ox += PathStep(dx, k, steps);
+                oy += PathStep(dy, k, steps);
+            }
+            if(ox >= u_HitRange.x && ox <= u_HitRange.y && oy >= u_HitRange.z && oy <= u_HitRange.w &&
+               SilhouettesOverlap(ox, oy)){
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// Step() in GameState.cpp
+int Step(int ticks){
+    if(gameOver){
+        return 0;
+    }
+    int events = 0;
+    int startHeight = dinoHeight;
+
+    tick += ticks;
+    dayTick += ticks;
+    if(dayTick >= dayLength){
+        dayTick -= dayLength;
+        isDaytime = !isDaytime;
+        cactusSpeed += daySpeedup;
+        jumpingSpeed += daySpeedup;
+        events |= EVENT_DAY_CHANGED;
+    }
+
+    int moved = cactusSpeed * ticks;
+    scroll += moved;
+    spawnDistance -= moved;
+    if(spawnDistance <= 0){
+        SpawnObstacles();
+    }
+
+    if(action == ACTION_JUMP && !isJumping){
+        isJumping = true;
+        dinoHeight = 1;
+    }
+    if(isJumping){
+        if(jumpingUp){
+            dinoHeight += jumpingSpeed * ticks;
+            if(dinoHeight >= jumpApex){
+                jumpingUp = false;
+            }
+        }else{
+            dinoHeight -= jumpingSpeed * ticks;
+            if(dinoHeight <= 0){
+                jumpingUp = true;
+                isJumping = false;
+            }
+        }
+    }
+    if(!invincible && SweptHit(scroll - moved, startHeight, scroll, dinoHeight)){
+        gameOver = true;
+        events |= EVENT_GAME_OVER;
+    }
+    return events;
+}
+
+void main()
+{
+    tick = state0.x;
+    dayTick = state0.y;
+    dinoHeight = state0.z;
+    isDaytime = (state0.w & FLAG_DAYTIME) != 0;
+    isJumping = (state0.w & FLAG_JUMPING) != 0;
+    jumpingUp = (state0.w & FLAG_JUMPING_UP) != 0;
+    gameOver = (state0.w & FLAG_GAME_OVER) != 0;
+    invincible = (state0.w & FLAG_INVINCIBLE) != 0;
+    jumpingSpeed = state1.x;
+    scroll = state1.y;
+    spawnDistance = state1.z;
+    cactusSpeed = state1.w;
+    for(int slot = 0; slot < 4; ++slot){
+        laneX[slot] = lane0[slot];
+        laneX[slot + 4] = lane1[slot];
+    }
+    laneHead = result.x & 0xff;
+    laneCount = result.x >> 8;
+    rngState = rng.xy;
+    rngIncrement = rng.zw;
+    int episodes = result.w;
+    startCactusSpeed = parameters0.x;
+    startJumpingSpeed = parameters0.y;
+    jumpApex = parameters0.z;
+    dayLength = parameters0.w;
+    daySpeedup = parameters1.x;
+    spawnGapMin = parameters1.y;
+    spawnGapRange = parameters1.z;
+    spawnSpeedMin = parameters1.w;
+
+    // StepRepeated(): finished games raise nothing and earn nothing
+    int events = 0;
+    float reward = 0.0;
+    for(int i = 0; i < u_Repeat && !gameOver; ++i){
+        int stepEvents = Step(u_Ticks);
+        reward += ((stepEvents & EVENT_GAME_OVER) != 0) ? -1.0 : 1.0;
+        events |= stepEvents;
+    }
+    if(u_AutoReset && (events & EVENT_GAME_OVER) != 0){
+        ++episodes;
+        uint high;
+        uint low;
+        umulExtended(uint(episodes), u_Count, high, low);
+        ResetGame(Add64(uvec2(low, high), uvec2(uint(gl_VertexID), 0u)));
+    }
+
+    int flags = (isDaytime ? FLAG_DAYTIME : 0) | (isJumping ? FLAG_JUMPING : 0) | (jumpingUp ? FLAG_JUMPING_UP : 0) |
+                (gameOver ? FLAG_GAME_OVER : 0) | (invincible ? FLAG_INVINCIBLE : 0);
+    v_state0 = ivec4(tick, dayTick, dinoHeight, flags);
+    v_state1 = ivec4(jumpingSpeed, scroll, spawnDistance, cactusSpeed);
+    v_lane0 = ivec4(laneX[0], laneX[1], laneX[2], laneX[3]);
+    v_lane1 = ivec4(laneX[4], laneX[5], laneX[6], laneX[7]);
+    v_rng = uvec4(rngState, rngIncrement);
+    v_result = ivec4(laneHead | (laneCount << 8), events, floatBitsToInt(reward), episodes);
+}
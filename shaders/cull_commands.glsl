@@ -0,0 +1,25 @@
+#version 410 core
+
+// One command per vertex, the batch's DrawElementsIndirectCommand
+layout(location=0) in uvec4 command;        // count, instanceCount, firstIndex, baseVertex
+layout(location=1) in uint baseInstance;
+
+// Captured by transform feedback into the culled commands
+flat out uvec4 v_command;
+flat out uint v_baseInstance;
+
+// Survivors of every command, a texel each
+uniform sampler2D u_Counts;
+uniform ivec2 u_CountSize;
+
+void main()
+{
+    // gl_VertexID counts from the first command drawn, so it is the
+    // command's index in the batch
+    ivec2 texel = ivec2(gl_VertexID % u_CountSize.x, gl_VertexID / u_CountSize.x);
+    uint survivors = uint(texelFetch(u_Counts, texel, 0).r + 0.5);
+    // The survivors start at the command's own baseInstance
+    v_command = uvec4(command.x, survivors, command.z, command.w);
+    v_baseInstance = baseInstance;
+    gl_Position = vec4(0.0);
+}
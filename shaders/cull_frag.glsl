@@ -0,0 +1,9 @@
+#version 410 core
+
+// Added into the command's texel: one more instance survived
+layout(location=0) out float count;
+
+void main()
+{
+    count = 1.0;
+}
@@ -0,0 +1,34 @@
+#version 410 core
+
+// Passes on the instances the vertex shader found in the frustum, in
+// order, and drops the rest
+layout(points) in;
+layout(points, max_vertices = 1) out;
+
+in vec4 g_positionScale[];
+in vec4 g_material[];
+in vec4 g_motion[];
+flat in int g_visible[];
+
+// Captured by transform feedback as the InstanceData they came from
+out vec4 v_positionScale;
+out vec4 v_material;
+out vec4 v_motion;
+
+// The command culled, whose texel of the count target the point lands on
+uniform int u_Command;
+uniform ivec2 u_CountSize;
+
+void main()
+{
+    if(g_visible[0] == 0){
+        return;
+    }
+    v_positionScale = g_positionScale[0];
+    v_material = g_material[0];
+    v_motion = g_motion[0];
+    ivec2 texel = ivec2(u_Command % u_CountSize.x, u_Command / u_CountSize.x);
+    gl_Position = vec4((vec2(texel) + 0.5) / vec2(u_CountSize) * 2.0 - 1.0, 0.0, 1.0);
+    EmitVertex();
+    EndPrimitive();
+}
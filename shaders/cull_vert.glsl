@@ -0,0 +1,34 @@
+#version 410 core
+
+// One instance per vertex, the InstanceData of the batch as uploaded
+layout(location=0) in vec4 positionScale;   // offset xyz, uniform scale
+layout(location=1) in vec4 material;        // palette, U offset, day and night layers
+layout(location=2) in vec4 motion;          // jump start and speed, bob height, squash
+
+out vec4 g_positionScale;
+out vec4 g_material;
+out vec4 g_motion;
+flat out int g_visible;
+
+// The mesh's sphere, center and radius, placed and scaled as the instance
+uniform vec4 u_Sphere;
+// Inside is where dot(plane.xyz, p) + plane.w >= 0 for all six
+uniform vec4 u_Planes[6];
+
+void main()
+{
+    // As CullSpheres() does it on the CPU
+    vec3 center = positionScale.xyz + u_Sphere.xyz * positionScale.w;
+    float radius = u_Sphere.w * positionScale.w;
+    int visible = 1;
+    for(int i = 0; i < 6; ++i){
+        if(dot(u_Planes[i].xyz, center) + u_Planes[i].w < -radius){
+            visible = 0;
+        }
+    }
+    g_positionScale = positionScale;
+    g_material = material;
+    g_motion = motion;
+    g_visible = visible;
+    gl_Position = vec4(0.0, 0.0, 0.0, 1.0);
+}
@@ -1,24 +1,103 @@
 #version 410 core
+// Variants, defined by the ShaderVariants that builds this shader:
+//   DAY_NIGHT_BLEND  crossfades the day and the night layer by
+//                    u_TimeOfDay; without it one layer is sampled,
+//                    exact while u_TimeOfDay is 0 or 1
+//   WIREFRAME        draws every fragment in one flat colour, for the
+//                    debug wireframe, transparent texels included
+//   BINDLESS         samples the texture array through its resident
+//                    GL_ARB_bindless_texture handle instead of a unit
+//   CROSSFADE        dissolves obstacles between their mesh and their
+//                    impostor over u_CrossfadeBand, see vert.glsl
+#ifdef BINDLESS
+#extension GL_ARB_bindless_texture : require
+#endif
 
 in vec3 v_vertexColors;
 in vec2 v_textureCoordinates;
+flat in vec2 v_textureLayers;
+flat in float v_palette;
 
 // Setup our texture Map.
 // Recall that textures are uniform.
-uniform sampler2D u_DiffuseTexture;
+// Every material is one layer of the array.
+#ifdef BINDLESS
+layout(bindless_sampler) uniform sampler2DArray u_DiffuseTexture;
+#else
+uniform sampler2DArray u_DiffuseTexture;
+#endif
+// Colour schemes of the flat-coloured meshes, a column each, the day in
+// row 0 and the night in row 1
+uniform sampler2D u_Palette;
+// 0 by day, 1 by night, in between while one fades into the other
+uniform float u_TimeOfDay;
+// 1 for the opaque scene, less for the blended ghost runners
+uniform float u_Opacity;
+
+#ifdef CROSSFADE
+// 1 while drawing impostor quads, 0 while drawing the meshes they replace
+uniform float u_Impostor;
+flat in float v_crossfade;
+
+// Thresholds of a 4x4 ordered dither
+const float DITHER[16] = float[16](0.0f, 8.0f, 2.0f, 10.0f, 12.0f, 4.0f, 14.0f, 6.0f,
+                                   3.0f, 11.0f, 1.0f, 9.0f, 15.0f, 7.0f, 13.0f, 5.0f);
+#endif
 
 out vec4 color;
 
+#ifndef WIREFRAME
+// The texel of one layer; a negative layer is row -1 - layer of the
+// palette texture, at this instance's column
+vec4 SampleLayer(float layer)
+{
+	if(layer < 0.0f){
+		return texelFetch(u_Palette, ivec2(int(v_palette), int(-1.0f - layer)), 0);
+	}
+	return texture(u_DiffuseTexture, vec3(v_textureCoordinates, layer));
+}
+#endif
+
 // Entry point of program
 void main()
 {
-	vec3 diffuseColor = vec3(0.0f,0.0f,0.0f);
-	diffuseColor = texture(u_DiffuseTexture, v_textureCoordinates).rgb;
+#ifdef CROSSFADE
+	// A screen door: the mesh keeps the pixels whose threshold is at or
+	// above the crossfade, the impostor the others, so the two together
+	// cover the obstacle once and stay opaque
+	ivec2 cell = ivec2(gl_FragCoord.xy) & 3;
+	float threshold = (DITHER[cell.y*4 + cell.x] + 0.5f)/16.0f;
+	if((threshold < v_crossfade) != (u_Impostor > 0.5f)){
+		discard;
+	}
+#endif
+#ifdef WIREFRAME
+	// Edges of the quads around a sprite show too, so nothing is discarded
+	color = vec4(1.0f, 0.25f, 0.5f, u_Opacity);
+#else
+#ifdef DAY_NIGHT_BLEND
+	vec4 texel = SampleLayer(v_textureLayers.x);
+	// Both layers are bound, so the crossfade is one more sample; an
+	// instance drawn the same by night samples only once
+	if(v_textureLayers.y != v_textureLayers.x){
+		vec4 night = SampleLayer(v_textureLayers.y);
+		texel = mix(texel, night, u_TimeOfDay);
+	}
+#else
+	float layer = (u_TimeOfDay < 0.5f) ? v_textureLayers.x : v_textureLayers.y;
+	vec4 texel = SampleLayer(layer);
+#endif
+	// Transparent texels let the parallax layers behind show through
+	if(texel.a < 0.5f){
+		discard;
+	}
+	vec3 diffuseColor = texel.rgb;
 
 	// Instead of using vertex colors, we will
 	// instead output a texture.
 	vec4 VertexColors = vec4(v_vertexColors.r,v_vertexColors.g, v_vertexColors.b, 1.0f);
 
 	// Output color based on our texture
-	color = vec4(diffuseColor,1.0f);
+	color = vec4(diffuseColor,u_Opacity);
+#endif
 }
@@ -0,0 +1,23 @@
+// The values every scene program shares in a frame, written once a frame
+// into one buffer: the std140 FrameData block of FrameUniforms.hpp, keep
+// the two in step. #include "frame_common.glsl" after the #version line.
+
+// MAX_SKIN_JOINTS of Skeleton.hpp
+#define MAX_SKIN_JOINTS 16
+
+layout(std140) uniform FrameData
+{
+    mat4 viewMatrix;
+    mat4 projection;
+    // Inverse of projection times view, to turn points on the screen
+    // into view rays
+    mat4 inverseViewProjection;
+    // The camera's position, w unused
+    vec4 eye;
+    // 0 by day, 1 by night, in between while one fades into the other
+    float timeOfDay;
+    // Scroll of the sky in texture space, subtracted from U
+    float skyOffset;
+    // Rows of the skinning transform of every joint, three a joint
+    vec4 joints[MAX_SKIN_JOINTS*3];
+} frame;
@@ -0,0 +1,15 @@
+#version 410 core
+
+in vec2 v_textureCoordinates;
+in vec4 v_vertexColor;
+
+// One channel font atlas: glyph coverage, and a solid cell for boxes
+uniform sampler2D u_FontAtlas;
+
+out vec4 color;
+
+void main()
+{
+    float coverage = texture(u_FontAtlas, v_textureCoordinates).r;
+    color = vec4(v_vertexColor.rgb, v_vertexColor.a * coverage);
+}
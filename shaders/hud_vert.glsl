@@ -0,0 +1,19 @@
+#version 410 core
+// Performance overlay: screen-space quads in pixels, origin top left
+layout(location=0) in vec2 position;
+layout(location=1) in vec2 textureCoordinates;
+layout(location=2) in vec4 vertexColor;
+
+// Size of the window in pixels
+uniform vec2 u_ScreenSize;
+
+out vec2 v_textureCoordinates;
+out vec4 v_vertexColor;
+
+void main()
+{
+    v_textureCoordinates = textureCoordinates;
+    v_vertexColor = vertexColor;
+    vec2 clip = position / u_ScreenSize * 2.0f - 1.0f;
+    gl_Position = vec4(clip.x, -clip.y, 0.0f, 1.0f);
+}
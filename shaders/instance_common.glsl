@@ -0,0 +1,151 @@
+// Declarations shared by the vertex shaders of instanced scene meshes,
+// #include "instance_common.glsl" after the #version line. Shaders that
+// #define SKINNING include frame_common.glsl before it.
+
+// From Vertex Buffer Object (VBO)
+layout(location=0) in vec3 position;
+layout(location=1) in vec3 vertexColors;
+layout(location=2) in vec2 textureCoordinates;
+// Per-instance attributes. Non-instanced draws leave these arrays
+// disabled and read the defaults (0,0,0,1): no offset, scale 1, layer 0
+// by day and layer 1 by night, and no animation.
+layout(location=3) in vec4 instanceOffsetScale;
+// x: palette column (or what the including shader makes of it), y:
+// texture U offset, z: texture array layer by day, w: by night
+layout(location=4) in vec4 instanceMaterial;
+// x: step on the u_Time clock a jump took off at, y: its jumping speed
+// per step, 0 for none, z: run bob height, w: squash and stretch. Heights
+// are in game units, like the game's dinoHeight.
+layout(location=5) in vec4 instanceAnimation;
+
+// Per-draw texture coordinate offset (background scrolling)
+uniform vec2 u_UVOffset;
+// Per-draw colour scheme, selects a column of the palette texture
+uniform int u_PaletteIndex;
+// Steps of the clock the instances' jumps are anchored on, with the
+// fraction of the step the frame is interpolated to
+uniform float u_Time;
+// The game's JUMP_APEX, a jump rises until it reaches it
+uniform float u_JumpApex;
+// Model space height the mesh squashes towards, its feet
+uniform float u_SquashPivot;
+
+// Pass vertex colors into the fragment shader
+out vec3 v_vertexColors;
+// Pass texture coordinates to the fragment shader
+out vec2 v_textureCoordinates;
+// Texture array layers of this instance, by day and by night; negative
+// ones are rows of the palette texture, see PaletteTexture.hpp
+flat out vec2 v_textureLayers;
+// Column of the palette texture this instance is coloured by
+flat out float v_palette;
+
+// Writes the outputs for the fragment shader, colouring palette meshes
+// by column u_PaletteIndex + instanceColumn
+void PassMaterial(float instanceColumn)
+{
+    v_vertexColors = vertexColors;
+    // The scrolling offset counts from the right edge of the texture
+    // towards the left
+    v_textureCoordinates = textureCoordinates + u_UVOffset - vec2(instanceMaterial.y, 0.0f);
+    v_textureLayers = instanceMaterial.zw;
+    v_palette = float(u_PaletteIndex) + instanceColumn;
+}
+
+#ifdef SKINNING
+// Joints and weights of every arena vertex, a texel per vertex: the four
+// joint indices in the bytes of x, the weights in those of y. See
+// SkinBuffer.hpp.
+uniform usamplerBuffer u_SkinVertices;
+
+// The model space position in this frame's pose, position itself for
+// vertices of unskinned meshes
+vec3 SkinnedPosition()
+{
+    uvec2 skin = texelFetch(u_SkinVertices, gl_VertexID).xy;
+    vec4 weights = unpackUnorm4x8(skin.y);
+    // The heaviest weight comes first
+    if(weights.x == 0.0f){
+        return position;
+    }
+    vec4 rows[3] = vec4[3](vec4(0.0f), vec4(0.0f), vec4(0.0f));
+    for(int i = 0; i < 4; ++i){
+        int joint = int((skin.x >> uint(8*i)) & 0xFFu)*3;
+        rows[0] += weights[i]*frame.joints[joint];
+        rows[1] += weights[i]*frame.joints[joint + 1];
+        rows[2] += weights[i]*frame.joints[joint + 2];
+    }
+    vec4 rest = vec4(position, 1.0f);
+    return vec3(dot(rows[0], rest), dot(rows[1], rest), dot(rows[2], rest));
+}
+#else
+vec3 SkinnedPosition()
+{
+    return position;
+}
+#endif
+
+// The vertex placed by its instance, in world space
+vec3 InstancePosition()
+{
+    return position*instanceOffsetScale.w + instanceOffsetScale.xyz;
+}
+
+// World units per game height unit, as the game places its dinos
+const float HEIGHT_SCALE = 0.01f;
+// The run frame changes every 15 steps, one bob per footfall
+const float RUN_FRAME_STEPS = 15.0f;
+// Steps a squash or stretch takes to settle
+const float SQUASH_STEPS = 6.0f;
+
+// Height at whole step t of a jump, as GetJumpHeight() in
+// JumpTrajectory.cpp works it out; the landing height outside the jump
+float JumpStepHeight(float t, float speed, float riseSteps, float peakHeight, float fallSteps)
+{
+    if(t > 0.0f && t <= riseSteps){
+        return 1.0f + t*speed;
+    }
+    if(t > riseSteps && t <= riseSteps + fallSteps){
+        return peakHeight - (t - riseSteps)*speed;
+    }
+    return peakHeight - fallSteps*speed;
+}
+
+// The skinned position placed by its instance, with the instance's
+// jump, run bob and squash and stretch applied, all in closed form from
+// u_Time: the instance data only changes when a jump takes off. Steps are interpolated linearly,
+// as the game interpolates its heights between two steps.
+vec3 AnimatedPosition()
+{
+    vec3 local = SkinnedPosition();
+    float speed = instanceAnimation.y;
+    float height = 0.0f;
+    float stretch = 0.0f;
+    bool grounded = true;
+    if(speed > 0.0f){
+        float riseSteps = ceil((u_JumpApex - 1.0f)/speed);
+        float peakHeight = 1.0f + riseSteps*speed;
+        float fallSteps = ceil(peakHeight/speed);
+        float duration = riseSteps + fallSteps;
+        float t = u_Time - instanceAnimation.x;
+        float whole = floor(t);
+        height = mix(JumpStepHeight(whole, speed, riseSteps, peakHeight, fallSteps),
+                     JumpStepHeight(whole + 1.0f, speed, riseSteps, peakHeight, fallSteps), t - whole);
+        grounded = t <= 0.0f || t >= duration;
+        // Stretched leaving the ground, squashed landing
+        if(t > 0.0f){
+            stretch += 1.0f - smoothstep(0.0f, SQUASH_STEPS, t);
+        }
+        if(t >= duration){
+            stretch -= 1.0f - smoothstep(duration, duration + SQUASH_STEPS, t);
+        }
+    }
+    if(grounded){
+        height += instanceAnimation.z*abs(sin(u_Time*(3.14159265f/RUN_FRAME_STEPS)));
+    }
+    // Taller and thinner or shorter and wider, keeping the volume
+    float scaleY = 1.0f + instanceAnimation.w*stretch;
+    local.y = u_SquashPivot + (local.y - u_SquashPivot)*scaleY;
+    local.xz *= inversesqrt(scaleY);
+    return local*instanceOffsetScale.w + instanceOffsetScale.xyz + vec3(0.0f, height*HEIGHT_SCALE, 0.0f);
+}
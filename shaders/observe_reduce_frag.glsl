@@ -0,0 +1,33 @@
+#version 410 core
+
+// The rendered frame, u_Supersample times the observation on each side
+uniform sampler2D u_Scene;
+// The previous frame's unpooled observation, read with u_MaxPool set
+uniform sampler2D u_Previous;
+uniform int u_Supersample;
+uniform int u_Grayscale;
+uniform int u_MaxPool;
+
+// The observation, into the GL_R8 (or GL_RGBA8) target read back
+layout(location=0) out vec4 observation;
+// This frame before pooling, for the next one to pool with
+layout(location=1) out vec4 unpooled;
+
+void main()
+{
+    // The block of rendered texels under this observed one, averaged
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+    ivec2 first = texel * u_Supersample;
+    vec3 sum = vec3(0.0);
+    for(int y = 0; y < u_Supersample; ++y){
+        for(int x = 0; x < u_Supersample; ++x){
+            sum += texelFetch(u_Scene, first + ivec2(x, y), 0).rgb;
+        }
+    }
+    vec3 rgb = sum / float(u_Supersample * u_Supersample);
+    // Rec. 601 luma, with the 8.8 fixed point weights the CPU used
+    vec4 value = (u_Grayscale != 0) ? vec4(vec3(dot(rgb, vec3(77.0, 150.0, 29.0) / 256.0)), 1.0)
+                                    : vec4(rgb, 1.0);
+    unpooled = value;
+    observation = (u_MaxPool != 0) ? max(value, texelFetch(u_Previous, texel, 0)) : value;
+}
@@ -0,0 +1,10 @@
+#version 410 core
+
+// A triangle covering the whole observation, made from the vertex index
+// alone: nothing is read from a buffer
+
+void main()
+{
+    vec2 corner = vec2(float((gl_VertexID << 1) & 2), float(gl_VertexID & 2)) * 2.0 - 1.0;
+    gl_Position = vec4(corner, 0.0, 1.0);
+}
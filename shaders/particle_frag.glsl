@@ -0,0 +1,19 @@
+#version 410 core
+
+in vec2 v_corner;
+in float v_opacity;
+
+// Dust color, alpha included
+uniform vec4 u_Color;
+
+out vec4 color;
+
+void main()
+{
+    // A soft round dot in the square quad
+    float distance = dot(v_corner, v_corner);
+    if(distance > 1.0){
+        discard;
+    }
+    color = vec4(u_Color.rgb, u_Color.a * v_opacity * (1.0 - distance));
+}
@@ -0,0 +1,83 @@
+#version 410 core
+
+// One particle per vertex, read from the buffer the last update wrote
+layout(location=0) in vec4 positionLife;    // xyz, seconds left
+layout(location=1) in vec4 velocitySize;    // xyz per second, quad half size
+
+// Captured by transform feedback into the other buffer
+out vec4 v_positionLife;
+out vec4 v_velocitySize;
+
+uniform float u_DeltaTime;
+// Distance the track moved towards -x since the last update
+uniform float u_Scroll;
+uniform float u_GroundHeight;
+uniform uint u_Seed;
+uniform int u_ParticleCount;
+
+// Bursts to spawn: the first slot and slot count of each, then
+// origin and radius, velocity and life, spread and size
+const int MAX_BURSTS = 8;
+uniform int u_BurstCount;
+uniform ivec2 u_BurstRange[MAX_BURSTS];
+uniform vec4 u_BurstOrigin[MAX_BURSTS];
+uniform vec4 u_BurstVelocity[MAX_BURSTS];
+uniform vec4 u_BurstSpread[MAX_BURSTS];
+
+const float GRAVITY = 6.0;
+const float DRAG = 1.5;
+// Of the vertical speed kept when a particle hits the ground
+const float BOUNCE = 0.25;
+
+// PCG hash, plenty for scattering particles
+uint Hash(uint x){
+    uint state = x * 747796405u + 2891336453u;
+    uint word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+    return (word >> 22u) ^ word;
+}
+
+// Next number in [0, 1) of the sequence in state
+float Random(inout uint state){
+    state = Hash(state);
+    return float(state >> 8) * (1.0 / 16777216.0);
+}
+
+void main()
+{
+    int slot = gl_VertexID;
+    for(int i = 0; i < u_BurstCount; ++i){
+        // Slots past the end of the pool wrap around to its start
+        if((slot - u_BurstRange[i].x + u_ParticleCount) % u_ParticleCount < u_BurstRange[i].y){
+            uint random = Hash(uint(slot) ^ Hash(u_Seed));
+            float angle = Random(random) * 6.2831853;
+            float distance = sqrt(Random(random)) * u_BurstOrigin[i].w;
+            vec3 position = u_BurstOrigin[i].xyz + vec3(cos(angle), 0.0, sin(angle)) * distance;
+            vec3 jitter = vec3(Random(random), Random(random), Random(random)) * 2.0 - 1.0;
+            vec3 velocity = u_BurstVelocity[i].xyz + jitter * u_BurstSpread[i].xyz;
+            float life = u_BurstVelocity[i].w * (0.5 + 0.5 * Random(random));
+            float size = u_BurstSpread[i].w * (0.5 + Random(random));
+            v_positionLife = vec4(position, life);
+            v_velocitySize = vec4(velocity, size);
+            return;
+        }
+    }
+
+    float life = positionLife.w - u_DeltaTime;
+    if(life <= 0.0){
+        v_positionLife = vec4(0.0);
+        v_velocitySize = vec4(0.0);
+        return;
+    }
+    vec3 velocity = velocitySize.xyz * exp(-DRAG * u_DeltaTime);
+    velocity.y -= GRAVITY * u_DeltaTime;
+    vec3 position = positionLife.xyz + velocity * u_DeltaTime;
+    // The particles lie on the track, which scrolls away under the dino
+    position.x -= u_Scroll;
+    if(position.y < u_GroundHeight){
+        position.y = u_GroundHeight;
+        velocity.y = -velocity.y * BOUNCE;
+        velocity.xz *= 0.5;
+    }
+    v_positionLife = vec4(position, life);
+    v_velocitySize = vec4(velocity, velocitySize.w);
+}
@@ -0,0 +1,31 @@
+#version 410 core
+
+// One particle per instance, from the buffer the update just wrote
+layout(location=0) in vec4 positionLife;    // xyz, seconds left
+layout(location=1) in vec4 velocitySize;    // xyz per second, quad half size
+
+// The view and projection of the frame
+#include "frame_common.glsl"
+
+// Seconds before its death a particle starts fading out
+uniform float u_FadeSeconds;
+
+// Position on the quad, -1 to 1 on both axes
+out vec2 v_corner;
+out float v_opacity;
+
+void main()
+{
+    // Four corners of a triangle strip, taken from the vertex index
+    v_corner = vec2(float(gl_VertexID & 1), float(gl_VertexID >> 1)) * 2.0 - 1.0;
+    v_opacity = clamp(positionLife.w / u_FadeSeconds, 0.0, 1.0);
+    if(positionLife.w <= 0.0){
+        // Outside the clip volume, so the quad of a dead particle is culled
+        gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+        return;
+    }
+    // Facing the camera: the corner is offset in view space
+    vec4 viewPosition = frame.viewMatrix * vec4(positionLife.xyz, 1.0);
+    viewPosition.xy += v_corner * velocitySize.w;
+    gl_Position = frame.projection * viewPosition;
+}
@@ -0,0 +1,10 @@
+#version 410 core
+
+uniform vec4 u_Color;
+
+out vec4 color;
+
+void main()
+{
+    color = u_Color;
+}
@@ -0,0 +1,13 @@
+#version 410 core
+
+// The hardware probe's triangle, made from the vertex index alone: at a
+// size of 1 it covers the whole target, smaller it is a speck at u_Offset
+
+uniform vec2 u_Offset;
+uniform float u_Size;
+
+void main()
+{
+    vec2 corner = vec2(float((gl_VertexID << 1) & 2), float(gl_VertexID & 2)) * 2.0 - 1.0;
+    gl_Position = vec4(corner * u_Size + u_Offset, 0.0, 1.0);
+}
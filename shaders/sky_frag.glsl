@@ -0,0 +1,94 @@
+#version 410 core
+// The time of day and the sky's scroll
+#include "frame_common.glsl"
+
+in vec3 v_near;
+in vec3 v_far;
+
+// The scene texture array, and the sky's layers in it by day and by night
+uniform sampler2DArray u_DiffuseTexture;
+uniform vec2 u_Layers;
+// The box the backdrop spans: a wall across its back (the upper half of
+// the texture) and a floor along its bottom (the lower half)
+uniform vec3 u_BoundsMin;
+uniform vec3 u_BoundsMax;
+// The panorama the wall shows instead, when its size is not 0: the tile
+// cache, and a texel per tile saying where in it the tile is (rg the
+// slot, a 1 once it is in), see VirtualPanorama.hpp
+uniform sampler2D u_Panorama;
+uniform sampler2D u_PanoramaTable;
+uniform vec2 u_PanoramaSize;
+// The panorama texel at the wall's left edge, and the wall's width in texels
+uniform vec2 u_PanoramaView;
+// Texels of a tile, of its slot with the border, and of the cache
+uniform vec4 u_PanoramaTiles;
+
+out vec4 color;
+
+// The panorama at a point of the wall, (0, 0) its bottom left and (1, 1)
+// its top right; false while the tile there is not streamed in
+bool SamplePanorama(vec2 wall, out vec3 texel)
+{
+    vec2 position = vec2(mod(u_PanoramaView.x + wall.x * u_PanoramaView.y, u_PanoramaSize.x),
+                         clamp(wall.y, 0.0, 1.0) * u_PanoramaSize.y);
+    vec2 tile = min(floor(position / u_PanoramaTiles.x), ceil(u_PanoramaSize / u_PanoramaTiles.x) - 1.0);
+    vec4 entry = texelFetch(u_PanoramaTable, ivec2(tile), 0);
+    if(entry.a < 0.5){
+        return false;
+    }
+    // Past the slot's border texel, where the tile starts
+    vec2 slot = floor(entry.rg * 255.0 + 0.5) * u_PanoramaTiles.y + 1.0;
+    vec2 local = position - tile * u_PanoramaTiles.x;
+    texel = textureLod(u_Panorama, (slot + local) / u_PanoramaTiles.zw, 0.0).rgb;
+    return true;
+}
+
+void main()
+{
+    vec3 origin = v_near;
+    vec3 direction = v_far - v_near;
+    vec3 size = u_BoundsMax - u_BoundsMin;
+
+    // The nearest of the wall and the floor the view ray hits
+    float nearest = 1.0e30;
+    vec2 uv = vec2(0.0);
+    // Where on the wall the ray hit, if the wall is what it hit
+    bool onWall = false;
+    vec2 wall = vec2(0.0);
+    if(direction.z < 0.0){
+        float t = (u_BoundsMin.z - origin.z) / direction.z;
+        vec3 hit = origin + direction * t;
+        if(t > 0.0 && hit.x >= u_BoundsMin.x && hit.x <= u_BoundsMax.x &&
+           hit.y >= u_BoundsMin.y && hit.y <= u_BoundsMax.y){
+            nearest = t;
+            wall = (hit.xy - u_BoundsMin.xy) / size.xy;
+            onWall = true;
+            uv = vec2(wall.x, 1.0 + wall.y) * 0.5;
+        }
+    }
+    if(direction.y < 0.0){
+        float t = (u_BoundsMin.y - origin.y) / direction.y;
+        vec3 hit = origin + direction * t;
+        if(t > 0.0 && t < nearest && hit.x >= u_BoundsMin.x && hit.x <= u_BoundsMax.x &&
+           hit.z >= u_BoundsMin.z && hit.z <= u_BoundsMax.z){
+            nearest = t;
+            onWall = false;
+            uv = vec2((hit.x - u_BoundsMin.x) / size.x, (u_BoundsMax.z - hit.z) / size.z) * 0.5;
+        }
+    }
+    // Past the backdrop the clear color shows
+    if(nearest == 1.0e30){
+        discard;
+    }
+    uv.x -= frame.skyOffset;
+
+    vec3 day;
+    if(!onWall || u_PanoramaSize.x <= 0.0 || !SamplePanorama(wall, day)){
+        day = texture(u_DiffuseTexture, vec3(uv, u_Layers.x)).rgb;
+    }
+    if(frame.timeOfDay > 0.0 && u_Layers.y != u_Layers.x){
+        vec3 night = texture(u_DiffuseTexture, vec3(uv, u_Layers.y)).rgb;
+        day = mix(day, night, frame.timeOfDay);
+    }
+    color = vec4(day, 1.0);
+}
@@ -0,0 +1,22 @@
+#version 410 core
+
+// A triangle covering the whole screen, made from the vertex index alone:
+// nothing is read from a buffer
+
+// Its inverse view projection turns the corners into view rays
+#include "frame_common.glsl"
+
+// Points on the near and far planes the pixel's view ray passes through
+out vec3 v_near;
+out vec3 v_far;
+
+void main()
+{
+    vec2 corner = vec2(float((gl_VertexID << 1) & 2), float(gl_VertexID & 2)) * 2.0 - 1.0;
+    vec4 near = frame.inverseViewProjection * vec4(corner, -1.0, 1.0);
+    vec4 far = frame.inverseViewProjection * vec4(corner, 1.0, 1.0);
+    v_near = near.xyz / near.w;
+    v_far = far.xyz / far.w;
+    // On the far plane, so anything drawn before covers it
+    gl_Position = vec4(corner, 1.0, 1.0);
+}
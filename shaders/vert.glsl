@@ -1,32 +1,45 @@
 #version 410 core
 #
-// From Vertex Buffer Object (VBO)
-// The only thing that can come 'in', that is
-// what our shader reads, the first part of the
-// graphics pipeline.
-layout(location=0) in vec3 position;
-layout(location=1) in vec3 vertexColors;
-layout(location=2) in vec2 textureCoordinates;
+// The view and projection of the frame, and its pose of the skinned meshes
+#include "frame_common.glsl"
+// Attributes, the per-draw palette and animation uniforms and the outputs,
+// with the skinned meshes posed
+#define SKINNING
+#include "instance_common.glsl"
 
 // Uniform variables
 uniform mat4 u_ModelMatrix;
-uniform mat4 u_ViewMatrix;
-// We'll use a perspective projection
-uniform mat4 u_Projection;
 
-// Pass vertex colors into the fragment shader
-out vec3 v_vertexColors;
-// Pass texture coordinates to the fragment shader
-out vec2 v_textureCoordinates;
+#ifdef CROSSFADE
+// Distances from the eye over which an obstacle turns from its mesh into
+// its impostor
+uniform vec2 u_CrossfadeBand;
+// 1 while drawing impostor quads, 0 while drawing the meshes they replace
+uniform float u_Impostor;
+// Model space point the impostor quads are offsets from, the center of
+// the mesh's bounding sphere
+uniform vec3 u_ImpostorPivot;
+// 0 while the instance is all mesh, 1 once it is all impostor
+flat out float v_crossfade;
+#endif
 
 void main()
 {
+    PassMaterial(instanceMaterial.x);
+#ifdef CROSSFADE
+    float band = max(u_CrossfadeBand.y - u_CrossfadeBand.x, 1e-4f);
+    v_crossfade = clamp((distance(instanceOffsetScale.xyz, frame.eye.xyz) - u_CrossfadeBand.x)/band, 0.0f, 1.0f);
+    if(u_Impostor > 0.5f){
+        // Turned to face the camera: the view's right and up in world space
+        vec3 right = vec3(frame.viewMatrix[0][0], frame.viewMatrix[1][0], frame.viewMatrix[2][0]);
+        vec3 up = vec3(frame.viewMatrix[0][1], frame.viewMatrix[1][1], frame.viewMatrix[2][1]);
+        vec3 corner = u_ImpostorPivot + right*position.x + up*position.y;
+        gl_Position = frame.projection * frame.viewMatrix * u_ModelMatrix * vec4(corner*instanceOffsetScale.w + instanceOffsetScale.xyz, 1.0f);
+        return;
+    }
+#endif
 
-    v_vertexColors 	 = vertexColors;
-		v_textureCoordinates = textureCoordinates;
-
-    vec4 newPosition = u_Projection * u_ViewMatrix * u_ModelMatrix * vec4(position,1.0f);
+    vec4 newPosition = frame.projection * frame.viewMatrix * u_ModelMatrix * vec4(AnimatedPosition(),1.0f);
                                                                     // Don't forget 'w'
 		gl_Position = vec4(newPosition.x, newPosition.y, newPosition.z, newPosition.w);
 }
-
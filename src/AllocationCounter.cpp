@@ -0,0 +1,205 @@
+#include "AllocationCounter.hpp"
+#include "CPUProfiler.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+
+// Counters of the hooks, one slot per zone and the last for outside zones.
+// Plain arrays of atomics are constant-initialized, so they work before
+// any constructor runs, as early allocations need.
+static std::atomic<uint64_t> sAllocations[AllocationCounter::MAX_ZONES + 1];
+static std::atomic<uint64_t> sBytes[AllocationCounter::MAX_ZONES + 1];
+static std::atomic<uint64_t> sFrees{0};
+
+static void CountAllocation(size_t bytes){
+    int zone = CPUProfiler::GetCurrentZone();
+    if(zone < 0 || zone >= AllocationCounter::MAX_ZONES){
+        zone = AllocationCounter::MAX_ZONES;
+    }
+    sAllocations[zone].fetch_add(1, std::memory_order_relaxed);
+    sBytes[zone].fetch_add(bytes, std::memory_order_relaxed);
+}
+
+static void* Allocate(size_t bytes){
+    CountAllocation(bytes);
+    // malloc(0) may return nullptr, new never does
+    void* memory = malloc(bytes > 0 ? bytes : 1);
+    if(memory == nullptr){
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+static void Free(void* memory){
+    if(memory != nullptr){
+        sFrees.fetch_add(1, std::memory_order_relaxed);
+        free(memory);
+    }
+}
+
+void* operator new(size_t bytes){
+    return Allocate(bytes);
+}
+
+void* operator new[](size_t bytes){
+    return Allocate(bytes);
+}
+
+void* operator new(size_t bytes, const std::nothrow_t&) noexcept{
+    CountAllocation(bytes);
+    return malloc(bytes > 0 ? bytes : 1);
+}
+
+void* operator new[](size_t bytes, const std::nothrow_t&) noexcept{
+    CountAllocation(bytes);
+    return malloc(bytes > 0 ? bytes : 1);
+}
+
+void operator delete(void* memory) noexcept{
+    Free(memory);
+}
+
+void operator delete[](void* memory) noexcept{
+    Free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept{
+    Free(memory);
+}
+
+void operator delete[](void* memory, size_t) noexcept{
+    Free(memory);
+}
+
+void operator delete(void* memory, const std::nothrow_t&) noexcept{
+    Free(memory);
+}
+
+void operator delete[](void* memory, const std::nothrow_t&) noexcept{
+    Free(memory);
+}
+
+AllocationCounter& AllocationCounter::Get(){
+    static AllocationCounter counter;
+    return counter;
+}
+
+// Constructor
+AllocationCounter::AllocationCounter(){
+    for(int zone = 0; zone <= MAX_ZONES; ++zone){
+        m_seenAllocations[zone] = 0;
+        m_seenBytes[zone] = 0;
+        m_totals[zone] = ZoneTotals{0, 0, 0};
+    }
+}
+
+// Destructor
+AllocationCounter::~AllocationCounter(){
+
+}
+
+void AllocationCounter::SetBudget(int allocationsPerFrame){
+    m_budget = allocationsPerFrame;
+}
+
+uint64_t AllocationCounter::GetAllocationCount() const{
+    uint64_t total = 0;
+    for(int zone = 0; zone <= MAX_ZONES; ++zone){
+        total += sAllocations[zone].load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+uint64_t AllocationCounter::GetFreeCount() const{
+    return sFrees.load(std::memory_order_relaxed);
+}
+
+void AllocationCounter::TakeDeltas(uint64_t* allocations, uint64_t* bytes){
+    for(int zone = 0; zone <= MAX_ZONES; ++zone){
+        uint64_t count = sAllocations[zone].load(std::memory_order_relaxed);
+        uint64_t size = sBytes[zone].load(std::memory_order_relaxed);
+        allocations[zone] = count - m_seenAllocations[zone];
+        bytes[zone] = size - m_seenBytes[zone];
+        m_seenAllocations[zone] = count;
+        m_seenBytes[zone] = size;
+    }
+}
+
+void AllocationCounter::PrintZones(const uint64_t* allocations, const uint64_t* bytes) const{
+    const CPUProfiler& profiler = CPUProfiler::Get();
+    for(int zone = 0; zone <= MAX_ZONES; ++zone){
+        if(allocations[zone] == 0){
+            continue;
+        }
+        const char* name = (zone < profiler.GetZoneCount()) ? profiler.GetZoneName(zone).c_str() : "outside zones";
+        std::cout << "\n  " << name << " " << allocations[zone] << " (" << bytes[zone] << " bytes)";
+    }
+}
+
+void AllocationCounter::EndFrame(){
+    uint64_t allocations[MAX_ZONES + 1];
+    uint64_t bytes[MAX_ZONES + 1];
+    TakeDeltas(allocations, bytes);
+
+    uint64_t frameAllocations = 0;
+    uint64_t frameBytes = 0;
+    for(int zone = 0; zone <= MAX_ZONES; ++zone){
+        ZoneTotals& totals = m_totals[zone];
+        totals.allocations += allocations[zone];
+        totals.bytes += bytes[zone];
+        if(allocations[zone] > totals.peak){
+            totals.peak = allocations[zone];
+        }
+        frameAllocations += allocations[zone];
+        frameBytes += bytes[zone];
+    }
+    ++m_reportFrames;
+    m_frameAllocations = frameAllocations;
+    m_frameBytes = frameBytes;
+
+    if(m_budget >= 0 && m_frame >= (uint64_t)WARMUP_FRAMES && frameAllocations > (uint64_t)m_budget){
+        ++m_overBudgetFrames;
+        // The first offender and then one every WARNING_INTERVAL frames
+        if(!m_warned || m_frame - m_lastWarning >= (uint64_t)WARNING_INTERVAL){
+            std::cout << "Frame " << m_frame << " made " << frameAllocations << " allocations ("
+                      << frameBytes << " bytes), over the budget of " << m_budget << ":";
+            PrintZones(allocations, bytes);
+            std::cout << std::endl;
+            m_warned = true;
+            m_lastWarning = m_frame;
+        }
+    }
+    ++m_frame;
+}
+
+void AllocationCounter::Report(){
+    if(m_reportFrames == 0){
+        return;
+    }
+    const CPUProfiler& profiler = CPUProfiler::Get();
+    std::cout << "Heap allocations per frame over " << m_reportFrames << " frames:";
+    for(int zone = 0; zone <= MAX_ZONES; ++zone){
+        const ZoneTotals& totals = m_totals[zone];
+        if(totals.allocations == 0){
+            continue;
+        }
+        const char* name = (zone < profiler.GetZoneCount()) ? profiler.GetZoneName(zone).c_str() : "outside zones";
+        std::cout << "\n  " << name << " mean " << (double)totals.allocations / m_reportFrames
+                  << " (" << totals.bytes / m_reportFrames << " bytes) max " << totals.peak;
+    }
+    if(m_budget >= 0){
+        std::cout << "\n  " << m_overBudgetFrames << " frames over the budget of " << m_budget;
+    }
+    std::cout << std::endl;
+    for(int zone = 0; zone <= MAX_ZONES; ++zone){
+        m_totals[zone] = ZoneTotals{0, 0, 0};
+    }
+    m_reportFrames = 0;
+    m_overBudgetFrames = 0;
+    // The report's own allocations are not the next frame's
+    uint64_t allocations[MAX_ZONES + 1];
+    uint64_t bytes[MAX_ZONES + 1];
+    TakeDeltas(allocations, bytes);
+}
@@ -0,0 +1,123 @@
+#include "AssetLoader.hpp"
+#include "FileReader.hpp"
+#include "Texture.hpp"
+#include "TraceRecorder.hpp"
+
+#include <SDL2/SDL.h>
+
+#include <algorithm>
+
+// Constructor
+AssetLoader::AssetLoader(){
+
+}
+
+// Destructor
+AssetLoader::~AssetLoader(){
+    Stop();
+}
+
+void AssetLoader::Start(){
+    if(m_started){
+        return;
+    }
+    m_started = true;
+    m_stop = false;
+    for(Asset* asset : m_waiting){
+        SubmitParse(asset);
+    }
+    m_waiting.clear();
+}
+
+void AssetLoader::Stop(){
+    if(!m_started){
+        return;
+    }
+    m_started = false;
+    m_stop = true;
+    JobSystem::Get().Wait(m_parses);
+    m_waiting.clear();
+    m_uploadQueue.clear();
+    m_loaded = m_queued;
+}
+
+void AssetLoader::Load(const std::string& name, AssetParse parse, AssetUpload upload){
+    Load(name, std::vector<std::string>(), std::move(parse), std::move(upload));
+}
+
+void AssetLoader::Load(const std::string& name, std::vector<std::string> files, AssetParse parse, AssetUpload upload){
+    std::unique_ptr<Asset> asset(new Asset());
+    asset->name = name;
+    asset->files = std::move(files);
+    asset->parse = std::move(parse);
+    asset->upload = std::move(upload);
+    asset->queued = SDL_GetPerformanceCounter();
+    if(m_started){
+        SubmitParse(asset.get());
+    }else{
+        m_waiting.push_back(asset.get());
+    }
+    m_uploadQueue.push_back(std::move(asset));
+    ++m_queued;
+}
+
+AssetFuture<Texture> AssetLoader::RequestTexture(const std::string& filepath){
+    return Request<Texture>(filepath,
+        [filepath](Texture& texture){
+            texture.Decode(filepath);
+        },
+        [](Texture& texture, size_t& budget){
+            budget -= std::min(budget, texture.Upload());
+            return true;
+        },
+        {filepath});
+}
+
+double AssetLoader::GetLoadSeconds() const{
+    return (double)m_loadCounts.load(std::memory_order_relaxed) / (double)SDL_GetPerformanceFrequency();
+}
+
+size_t AssetLoader::Update(size_t budgetBytes){
+    size_t budget = budgetBytes;
+    while(budget > 0 && !m_uploadQueue.empty()){
+        Asset& asset = *m_uploadQueue.front();
+        if(!asset.parsed.load(std::memory_order_acquire)){
+            break;
+        }
+        if(!asset.upload(budget)){
+            break;
+        }
+        if(m_trace != nullptr && m_trace->IsRecording()){
+            m_trace->AddAsync(m_trace->AddName(asset.name), asset.parseStart, asset.parseEnd);
+        }
+        uint64_t loadCounts = SDL_GetPerformanceCounter() - asset.queued;
+        m_loadCounts.store(m_loadCounts.load(std::memory_order_relaxed) + loadCounts, std::memory_order_relaxed);
+        m_timedLoads.store(m_timedLoads.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        // The upload may have queued more assets behind this one
+        m_uploadQueue.pop_front();
+        ++m_loaded;
+    }
+    return budgetBytes - budget;
+}
+
+void AssetLoader::SubmitParse(Asset* asset){
+    if(asset->files.empty()){
+        JobSystem::Get().Submit([this, asset]{ Parse(asset); }, &m_parses);
+        return;
+    }
+    // Parsed once every file is in memory, m_parses counting it from now
+    FileReader::Get().Read(asset->files, [this, asset]{ Parse(asset); }, &m_parses);
+}
+
+void AssetLoader::Parse(Asset* asset){
+    if(m_stop.load(std::memory_order_acquire)){
+        FileReader::Get().Release(asset->files);
+        return;
+    }
+    asset->parseStart = SDL_GetPerformanceCounter();
+    asset->parse();
+    asset->parseEnd = SDL_GetPerformanceCounter();
+    // Views the parse keeps hold on to their files themselves
+    FileReader::Get().Release(asset->files);
+    asset->parsed.store(true, std::memory_order_release);
+}
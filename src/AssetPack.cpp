@@ -0,0 +1,341 @@
+#include "AssetPack.hpp"
+#include "HugePages.hpp"
+#include "JobSystem.hpp"
+#include "LZ4Block.hpp"
+#include "MemoryTags.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#ifdef EMBED_ASSETS
+// EMBEDDED_ASSET_PACK, written by ./dinopack --embed=include/EmbeddedAssets.inc
+#include "EmbeddedAssets.inc"
+#endif
+
+AssetPack& AssetPack::Get(){
+    static AssetPack pack;
+    return pack;
+}
+
+// Constructor
+AssetPack::AssetPack(){
+
+}
+
+// Destructor
+AssetPack::~AssetPack(){
+
+}
+
+bool AssetPack::Open(const std::string& filepath){
+    Close();
+    if(!m_file.Open(filepath)){
+        return false;
+    }
+    if(!Parse(m_file.Data(), m_file.Size(), filepath)){
+        m_file.Close();
+        return false;
+    }
+    // Every asset is read from the one mapping, a few TLB entries for all
+    AdviseHugePages(m_file.Data(), m_file.Size());
+    return true;
+}
+
+bool AssetPack::OpenEmbedded(){
+    Close();
+#ifdef EMBED_ASSETS
+    return Parse(reinterpret_cast<const char*>(EMBEDDED_ASSET_PACK), sizeof(EMBEDDED_ASSET_PACK), "the embedded pack");
+#else
+    return false;
+#endif
+}
+
+void AssetPack::Close(){
+    FileView::SetLookup(nullptr);
+    m_file.Close();
+    m_data = nullptr;
+    m_entries = nullptr;
+    m_entryCount = 0;
+    m_names = nullptr;
+    m_blockBytes = 0;
+}
+
+bool AssetPack::Parse(const char* data, size_t size, const std::string& name){
+    AssetPackHeader header;
+    if(size < sizeof(header)){
+        std::cout << "AssetPack.cpp: " << name << " is truncated\n";
+        return false;
+    }
+    memcpy(&header, data, sizeof(header));
+    if(memcmp(header.magic, "DPAK", 4) != 0 || header.version != ASSET_PACK_VERSION){
+        std::cout << "AssetPack.cpp: " << name << " is not a supported asset pack\n";
+        return false;
+    }
+    size_t tableBytes = sizeof(header) + (size_t)header.entryCount * sizeof(AssetPackEntry) + header.namesBytes;
+    if(size < tableBytes){
+        std::cout << "AssetPack.cpp: " << name << " is truncated\n";
+        return false;
+    }
+    const AssetPackEntry* entries = reinterpret_cast<const AssetPackEntry*>(data + sizeof(header));
+    for(uint32_t i = 0; i < header.entryCount; ++i){
+        const AssetPackEntry& entry = entries[i];
+        if(entry.offset > size || entry.storedSize > size - entry.offset ||
+           (uint64_t)entry.nameOffset + entry.nameLength > header.namesBytes){
+            std::cout << "AssetPack.cpp: " << name << " has an entry outside the file\n";
+            return false;
+        }
+        if(entry.codec == ASSET_CODEC_NONE){
+            if(entry.storedSize != entry.size){
+                std::cout << "AssetPack.cpp: " << name << " has an entry of the wrong size\n";
+                return false;
+            }
+            continue;
+        }
+        if(entry.codec != ASSET_CODEC_LZ4 || header.blockBytes == 0){
+            std::cout << "AssetPack.cpp: " << name << " has an entry in an unknown format\n";
+            return false;
+        }
+        // The block table must be there and every block inside the entry
+        uint64_t blockCount = (entry.size + header.blockBytes - 1) / header.blockBytes;
+        if(entry.storedSize < blockCount * sizeof(uint32_t) || entry.offset % sizeof(uint32_t) != 0){
+            std::cout << "AssetPack.cpp: " << name << " has a truncated block table\n";
+            return false;
+        }
+        const uint32_t* blockEnds = reinterpret_cast<const uint32_t*>(data + entry.offset);
+        uint64_t blocksBytes = entry.storedSize - blockCount * sizeof(uint32_t);
+        uint32_t previous = 0;
+        for(uint64_t block = 0; block < blockCount; ++block){
+            if(blockEnds[block] < previous || blockEnds[block] > blocksBytes){
+                std::cout << "AssetPack.cpp: " << name << " has a block outside its entry\n";
+                return false;
+            }
+            previous = blockEnds[block];
+        }
+    }
+
+    m_data = data;
+    m_entries = entries;
+    m_entryCount = header.entryCount;
+    m_names = data + sizeof(header) + (size_t)header.entryCount * sizeof(AssetPackEntry);
+    m_blockBytes = header.blockBytes;
+    FileView::SetLookup(&AssetPack::Lookup);
+    return true;
+}
+
+const AssetPackEntry* AssetPack::FindEntry(const std::string& filepath) const{
+    if(m_entryCount == 0){
+        return nullptr;
+    }
+    std::string name = NormalizePath(filepath);
+    // Entries are sorted by name
+    const AssetPackEntry* end = m_entries + m_entryCount;
+    const AssetPackEntry* entry = std::lower_bound(m_entries, end, name,
+        [this](const AssetPackEntry& candidate, const std::string& key){
+            return key.compare(0, std::string::npos, m_names + candidate.nameOffset, candidate.nameLength) > 0;
+        });
+    if(entry == end || name.compare(0, std::string::npos, m_names + entry->nameOffset, entry->nameLength) != 0){
+        return nullptr;
+    }
+    return entry;
+}
+
+bool AssetPack::Find(const std::string& filepath, const char*& data, size_t& size) const{
+    const AssetPackEntry* entry = FindEntry(filepath);
+    if(entry == nullptr || entry->codec != ASSET_CODEC_NONE){
+        return false;
+    }
+    data = m_data + entry->offset;
+    size = (size_t)entry->size;
+    return true;
+}
+
+bool AssetPack::Stat(const std::string& filepath, size_t& size, bool& compressed) const{
+    const AssetPackEntry* entry = FindEntry(filepath);
+    if(entry == nullptr){
+        return false;
+    }
+    size = (size_t)entry->size;
+    compressed = entry->codec != ASSET_CODEC_NONE;
+    return true;
+}
+
+bool AssetPack::DecompressBlocks(const AssetPackEntry& entry, size_t first, size_t last, char* destination) const{
+    size_t blockCount = (size_t)((entry.size + m_blockBytes - 1) / m_blockBytes);
+    const uint32_t* blockEnds = reinterpret_cast<const uint32_t*>(m_data + entry.offset);
+    const char* blocks = m_data + entry.offset + blockCount * sizeof(uint32_t);
+    for(size_t block = first; block < last; ++block){
+        size_t begin = block == 0 ? 0 : blockEnds[block - 1];
+        size_t storedBytes = blockEnds[block] - begin;
+        size_t offset = block * m_blockBytes;
+        size_t bytes = std::min<size_t>(m_blockBytes, (size_t)entry.size - offset);
+        // A block that would not shrink is stored as it is
+        if(storedBytes == bytes){
+            memcpy(destination + offset, blocks + begin, bytes);
+        }else if(!LZ4DecompressBlock(blocks + begin, storedBytes, destination + offset, bytes)){
+            return false;
+        }
+    }
+    return true;
+}
+
+bool AssetPack::Decompress(const std::string& filepath, char* destination, size_t size) const{
+    const AssetPackEntry* entry = FindEntry(filepath);
+    if(entry == nullptr || entry->size != size){
+        return false;
+    }
+    if(entry->codec == ASSET_CODEC_NONE){
+        memcpy(destination, m_data + entry->offset, size);
+        return true;
+    }
+    size_t blockCount = (size_t)((entry->size + m_blockBytes - 1) / m_blockBytes);
+    std::atomic<bool> ok{true};
+    // A few blocks a piece, a block takes some tens of microseconds
+    JobSystem::Get().ParallelFor(blockCount, 4, [this, entry, destination, &ok](size_t first, size_t last){
+        if(!DecompressBlocks(*entry, first, last, destination)){
+            ok.store(false, std::memory_order_relaxed);
+        }
+    });
+    if(!ok.load(std::memory_order_relaxed)){
+        std::cout << "AssetPack.cpp: " << NormalizePath(filepath) << " is corrupt in the pack\n";
+        return false;
+    }
+    return true;
+}
+
+bool AssetPack::Lookup(const std::string& filepath, const char*& data, size_t& size,
+                       std::shared_ptr<const void>& owner){
+    AssetPack& pack = Get();
+    const AssetPackEntry* entry = pack.FindEntry(filepath);
+    if(entry == nullptr){
+        return false;
+    }
+    if(entry->codec == ASSET_CODEC_NONE){
+        data = pack.m_data + entry->offset;
+        size = (size_t)entry->size;
+        return true;
+    }
+    // Decompressed for this view, and freed with it
+    size_t bytes = (size_t)entry->size;
+    std::shared_ptr<char> memory(new char[std::max<size_t>(bytes, 1)], [bytes](char* memory){
+        delete[] memory;
+        MemoryTags::Remove(MEMORY_ASSETS, bytes);
+    });
+    MemoryTags::Add(MEMORY_ASSETS, bytes);
+    if(!pack.Decompress(filepath, memory.get(), bytes)){
+        return false;
+    }
+    data = memory.get();
+    size = bytes;
+    owner = std::move(memory);
+    return true;
+}
+
+std::string AssetPack::NormalizePath(const std::string& filepath){
+    std::string name = filepath;
+    while(name.compare(0, 2, "./") == 0){
+        name.erase(0, 2);
+    }
+    size_t dot;
+    while((dot = name.find("/./")) != std::string::npos){
+        name.erase(dot, 2);
+    }
+    return name;
+}
+
+// The stored bytes of a file cut into blocks of blockBytes, each
+// compressed on its own: the table of where they end, then the blocks
+static std::vector<char> CompressBlocks(const std::vector<char>& data, size_t blockBytes){
+    size_t blockCount = (data.size() + blockBytes - 1) / blockBytes;
+    std::vector<uint32_t> blockEnds(blockCount);
+    std::vector<char> blocks;
+    for(size_t block = 0; block < blockCount; ++block){
+        size_t offset = block * blockBytes;
+        size_t bytes = std::min(blockBytes, data.size() - offset);
+        size_t start = blocks.size();
+        if(LZ4CompressBlock(data.data() + offset, bytes, blocks) >= bytes){
+            blocks.resize(start);
+            blocks.insert(blocks.end(), data.begin() + offset, data.begin() + offset + bytes);
+        }
+        blockEnds[block] = (uint32_t)blocks.size();
+    }
+    std::vector<char> stored(blockCount * sizeof(uint32_t));
+    memcpy(stored.data(), blockEnds.data(), stored.size());
+    stored.insert(stored.end(), blocks.begin(), blocks.end());
+    return stored;
+}
+
+std::vector<char> AssetPack::Build(std::vector<File> files, const AssetPackOptions& options){
+    for(File& file : files){
+        file.name = NormalizePath(file.name);
+    }
+    std::sort(files.begin(), files.end(), [](const File& a, const File& b){
+        return a.name < b.name;
+    });
+
+    std::string names;
+    std::vector<AssetPackEntry> entries(files.size());
+    for(size_t i = 0; i < files.size(); ++i){
+        memset(&entries[i], 0, sizeof(entries[i]));
+        entries[i].nameOffset = (uint32_t)names.size();
+        entries[i].nameLength = (uint32_t)files[i].name.size();
+        names += files[i].name;
+    }
+    AssetPackHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "DPAK", 4);
+    header.version = ASSET_PACK_VERSION;
+    header.entryCount = (uint32_t)files.size();
+    header.namesBytes = (uint32_t)names.size();
+    header.blockBytes = options.blockBytes;
+
+    // What each file is stored as, compressed if that saves an eighth
+    std::vector<std::vector<char>> stored(files.size());
+    for(size_t i = 0; i < files.size(); ++i){
+        entries[i].size = files[i].data.size();
+        entries[i].codec = ASSET_CODEC_NONE;
+        if(options.codec != ASSET_CODEC_LZ4 || options.blockBytes == 0 || files[i].raw ||
+           files[i].data.size() < std::max<size_t>(options.minimumBytes, 1)){
+            continue;
+        }
+        std::vector<char> compressed = CompressBlocks(files[i].data, options.blockBytes);
+        if(compressed.size() <= files[i].data.size() - files[i].data.size() / 8){
+            stored[i] = std::move(compressed);
+            entries[i].codec = ASSET_CODEC_LZ4;
+        }
+    }
+
+    uint64_t offset = sizeof(header) + entries.size() * sizeof(AssetPackEntry) + names.size();
+    for(size_t i = 0; i < files.size(); ++i){
+        offset = (offset + DATA_ALIGNMENT - 1) & ~(uint64_t)(DATA_ALIGNMENT - 1);
+        entries[i].offset = offset;
+        entries[i].storedSize = entries[i].codec == ASSET_CODEC_NONE ? files[i].data.size() : stored[i].size();
+        offset += entries[i].storedSize;
+    }
+
+    // Zero-filled, which pads every file up to its offset
+    std::vector<char> pack((size_t)offset, 0);
+    char* out = pack.data();
+    memcpy(out, &header, sizeof(header));
+    memcpy(out + sizeof(header), entries.data(), entries.size() * sizeof(AssetPackEntry));
+    memcpy(out + sizeof(header) + entries.size() * sizeof(AssetPackEntry), names.data(), names.size());
+    for(size_t i = 0; i < files.size(); ++i){
+        const std::vector<char>& bytes = entries[i].codec == ASSET_CODEC_NONE ? files[i].data : stored[i];
+        if(!bytes.empty()){
+            memcpy(out + entries[i].offset, bytes.data(), bytes.size());
+        }
+    }
+    return pack;
+}
+
+bool AssetPack::Write(const std::string& filepath, std::vector<File> files, const AssetPackOptions& options){
+    std::vector<char> pack = Build(std::move(files), options);
+    std::ofstream out(filepath.c_str(), std::ios::binary | std::ios::trunc);
+    if(!out.is_open()){
+        return false;
+    }
+    out.write(pack.data(), (std::streamsize)pack.size());
+    return out.good();
+}
@@ -0,0 +1,322 @@
+#include "AtlasObserver.hpp"
+#include "GLStateCache.hpp"
+#include "GPUResourceTracker.hpp"
+#include "PaletteTexture.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+// Commands of the atlas batch, one per mesh range
+enum AtlasCommand{
+    ATLAS_DAY_BACKGROUND,
+    ATLAS_NIGHT_BACKGROUND,
+    ATLAS_DINO_FRAME_0,
+    ATLAS_DINO_FRAME_1,
+    ATLAS_CACTUS,
+    ATLAS_COMMAND_COUNT
+};
+
+// Constructor
+AtlasObserver::AtlasObserver(){
+
+}
+
+// Destructor
+AtlasObserver::~AtlasObserver(){
+    if(m_framebuffer != 0){
+        std::cout << "AtlasObserver.cpp: framebuffer was never released\n";
+    }
+}
+
+bool AtlasObserver::Initialize(size_t count, int width, int height, bool grayscale,
+                               const std::string& vertexPath, const std::string& fragmentPath, unsigned int ringSize){
+    Release();
+    if(count == 0 || width <= 0 || height <= 0){
+        std::cout << "AtlasObserver.cpp: invalid atlas of " << count << " tiles of " << width << "x" << height << "\n";
+        return false;
+    }
+    if(ringSize < 2){
+        ringSize = 2;
+    }
+    int columns = (int)std::ceil(std::sqrt((double)count));
+    int rows = (int)((count + columns - 1) / columns);
+    GLint maxSize = 0;
+    glGetIntegerv(GL_MAX_RENDERBUFFER_SIZE, &maxSize);
+    if((long)columns * width > maxSize || (long)rows * height > maxSize){
+        std::cout << "AtlasObserver.cpp: " << count << " tiles of " << width << "x" << height
+                  << " need a " << columns * width << "x" << rows * height << " atlas, larger than the "
+                  << maxSize << " pixels the driver allows\n";
+        return false;
+    }
+    if(!m_program.LoadFromFiles(vertexPath, fragmentPath)){
+        std::cout << "AtlasObserver.cpp: could not build " << vertexPath << " and " << fragmentPath << "\n";
+        return false;
+    }
+    m_viewProjectionLocation = m_program.GetUniformLocation("u_ViewProjection");
+    m_gridLocation = m_program.GetUniformLocation("u_AtlasGrid");
+    m_textureLocation = m_program.GetUniformLocation("u_DiffuseTexture");
+    m_paletteIndexLocation = m_program.GetUniformLocation("u_PaletteIndex");
+    m_paletteLocation = m_program.GetUniformLocation("u_Palette");
+    m_uvOffsetLocation = m_program.GetUniformLocation("u_UVOffset");
+    m_timeOfDayLocation = m_program.GetUniformLocation("u_TimeOfDay");
+    m_opacityLocation = m_program.GetUniformLocation("u_Opacity");
+    if(m_viewProjectionLocation < 0 || m_gridLocation < 0){
+        std::cout << "AtlasObserver.cpp: " << vertexPath << " lacks u_ViewProjection or u_AtlasGrid\n";
+        m_program.Release();
+        return false;
+    }
+
+    m_count = count;
+    m_width = width;
+    m_height = height;
+    m_columns = columns;
+    m_rows = rows;
+    m_grayscale = grayscale;
+    int atlasWidth = columns * width;
+    int atlasHeight = rows * height;
+
+    glGenRenderbuffers(1, &m_colorBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_colorBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, atlasWidth, atlasHeight);
+    GPUResourceTracker::Get().Created(GPU_RENDERBUFFER, m_colorBuffer, "atlas color", (size_t)atlasWidth * atlasHeight * 4);
+    glGenRenderbuffers(1, &m_depthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_depthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, atlasWidth, atlasHeight);
+    GPUResourceTracker::Get().Created(GPU_RENDERBUFFER, m_depthBuffer, "atlas depth", (size_t)atlasWidth * atlasHeight * 4);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &m_framebuffer);
+    GPUResourceTracker::Get().Created(GPU_FRAMEBUFFER, m_framebuffer, "atlas framebuffer");
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_colorBuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_depthBuffer);
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if(status != GL_FRAMEBUFFER_COMPLETE){
+        std::cout << "AtlasObserver.cpp: framebuffer incomplete (0x" << std::hex << status << std::dec << ")\n";
+        Release();
+        return false;
+    }
+
+    size_t bytes = (size_t)atlasWidth * atlasHeight * 4;
+    m_slots.resize(ringSize);
+    for(Slot& slot : m_slots){
+        glGenBuffers(1, &slot.buffer);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+        glBufferData(GL_PIXEL_PACK_BUFFER, bytes, nullptr, GL_STREAM_READ);
+        GPUResourceTracker::Get().Created(GPU_BUFFER, slot.buffer, "atlas readback", bytes);
+        slot.fence = nullptr;
+        slot.frame = -1;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    // Backgrounds and dinos are one instance per environment, cacti up
+    // to a full lane each
+    m_batch.Initialize(count * (2 + OBSTACLE_LANE_CAPACITY), ATLAS_COMMAND_COUNT);
+    for(std::vector<InstanceData>& instances : m_instances){
+        instances.reserve(count);
+    }
+    m_instances[ATLAS_CACTUS].reserve(count * OBSTACLE_LANE_CAPACITY);
+    m_camera.SetViewportSize(width, height);
+
+    m_latest.assign(count * width * height * GetChannels(), 0);
+    m_latestFrame = -1;
+    m_nextSlot = 0;
+    m_frame = 0;
+    m_readbacks = 0;
+    m_stalls = 0;
+    return true;
+}
+
+void AtlasObserver::AddInstances(const GameStateBatch& environments, const AtlasScene& scene, size_t first){
+    for(std::vector<InstanceData>& instances : m_instances){
+        instances.clear();
+    }
+    size_t count = (environments.GetCount() > first) ? std::min(environments.GetCount() - first, m_count) : 0;
+    for(size_t i = 0; i < count; ++i){
+        GameState state = environments.Get(first + i);
+        // The palette slot holds the tile; every environment is drawn in
+        // palette 0. Game units are hundredths of world units.
+        float tile = (float)i;
+        float layer = state.isDaytime ? scene.dayLayer : scene.nightLayer;
+        float palette = state.isDaytime ? PALETTE_DAY_LAYER : PALETTE_NIGHT_LAYER;
+        // The background scrolls 0.004 of the texture a tick and wraps
+        // every 125 ticks, like the game's TextureScroll. Nothing here
+        // jumps, bobs or squashes, that motion is left to the game.
+        InstanceData background = {0.0f, 0.0f, 0.0f, 1.0f, tile, -(float)(state.tick % 125) * 0.004f, layer, layer,
+                                   0.0f, 0.0f, 0.0f, 0.0f};
+        m_instances[state.isDaytime ? ATLAS_DAY_BACKGROUND : ATLAS_NIGHT_BACKGROUND].push_back(background);
+        InstanceData dino = {0.0f, state.dinoHeight * 0.01f, 0.0f, 1.0f, tile, 0.0f, palette, palette,
+                             0.0f, 0.0f, 0.0f, 0.0f};
+        m_instances[(state.tick % 30 < 15) ? ATLAS_DINO_FRAME_1 : ATLAS_DINO_FRAME_0].push_back(dino);
+        for(uint32_t k = 0; k < state.obstacles.count; ++k){
+            uint32_t slot = GetLaneSlot(state.obstacles, k);
+            InstanceData cactus = {(state.obstacles.x[slot] - state.scroll) * 0.01f, 0.0f, 0.0f, 1.0f,
+                                   tile, 0.0f, palette, palette, 0.0f, 0.0f, 0.0f, 0.0f};
+            m_instances[ATLAS_CACTUS].push_back(cactus);
+        }
+    }
+    const DrawRange* ranges[ATLAS_COMMAND_COUNT] = {&scene.dayBackground, &scene.nightBackground,
+                                                     &scene.dinoFrames[0], &scene.dinoFrames[1], &scene.cactus};
+    m_batch.Begin();
+    for(int command = 0; command < ATLAS_COMMAND_COUNT; ++command){
+        m_batch.Add(*ranges[command], m_instances[command].data(), m_instances[command].size());
+    }
+}
+
+void AtlasObserver::Render(const GameStateBatch& environments, const AtlasScene& scene,
+                           MeshRegistry& registry, MeshHandle mesh, const TextureArray& textures, size_t first){
+    GLStateCache& state = GLStateCache::Get();
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+    state.Viewport(0, 0, m_columns * m_width, m_rows * m_height);
+    state.ClearColor(0.0f, 1.0f, 0.0f, 1.0f);
+    glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
+
+    AddInstances(environments, scene, first);
+    m_program.Use();
+    const glm::mat4& viewProjection = m_camera.GetViewProjectionMatrix();
+    glUniformMatrix4fv(m_viewProjectionLocation, 1, GL_FALSE, &viewProjection[0][0]);
+    glUniform2f(m_gridLocation, (float)m_columns, (float)m_rows);
+    glUniform2f(m_uvOffsetLocation, 0.0f, 0.0f);
+    glUniform1i(m_paletteIndexLocation, 0);
+    glUniform1f(m_timeOfDayLocation, 0.0f);
+    glUniform1f(m_opacityLocation, 1.0f);
+    textures.Bind(0);
+    glUniform1i(m_textureLocation, 0);
+    state.BindTexture(PALETTE_TEXTURE_UNIT, GL_TEXTURE_2D, scene.palette);
+    glUniform1i(m_paletteLocation, (GLint)PALETTE_TEXTURE_UNIT);
+
+    // The four planes keep each environment inside its own tile
+    state.Enable(GL_DEPTH_TEST);
+    for(int plane = 0; plane < 4; ++plane){
+        state.Enable(GL_CLIP_DISTANCE0 + plane);
+    }
+    if(m_batch.Upload(registry, mesh)){
+        m_batch.DrawCommands(0, m_batch.GetCommandCount());
+    }
+    m_batch.Finish();
+    for(int plane = 0; plane < 4; ++plane){
+        state.Disable(GL_CLIP_DISTANCE0 + plane);
+    }
+    Capture();
+}
+
+void AtlasObserver::Capture(){
+    // Pick up every readback that has finished in the meantime, oldest first
+    for(size_t i = 0; i < m_slots.size(); ++i){
+        Slot& slot = m_slots[(m_nextSlot + i) % m_slots.size()];
+        // Fences signal in order, so the rest are not done either
+        if(slot.fence != nullptr && !Collect(slot, false)){
+            break;
+        }
+    }
+    // The slot to reuse holds the oldest readback; if the GPU is that far
+    // behind there is nothing for it but to wait.
+    Slot& slot = m_slots[m_nextSlot];
+    if(slot.fence != nullptr){
+        ++m_stalls;
+        if(!Collect(slot, true)){
+            // Lost after a second of waiting, drop it
+            glDeleteSync(slot.fence);
+            slot.fence = nullptr;
+        }
+    }
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_framebuffer);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    // The whole atlas in one copy, queued on the GPU
+    glReadPixels(0, 0, m_columns * m_width, m_rows * m_height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.frame = m_frame++;
+    m_nextSlot = (m_nextSlot + 1) % m_slots.size();
+}
+
+bool AtlasObserver::Collect(Slot& slot, bool wait){
+    GLenum result = glClientWaitSync(slot.fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0,
+                                     wait ? (GLuint64)1000000000 : 0);
+    if(result == GL_TIMEOUT_EXPIRED || result == GL_WAIT_FAILED){
+        return false;
+    }
+    glDeleteSync(slot.fence);
+    slot.fence = nullptr;
+
+    size_t atlasWidth = (size_t)m_columns * m_width;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    const uint8_t* pixels = (const uint8_t*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0,
+                                                             (GLsizeiptr)(atlasWidth * m_rows * m_height * 4),
+                                                             GL_MAP_READ_BIT);
+    if(pixels != nullptr){
+        // A frame older than the newest one collected is not worth copying
+        if(slot.frame > m_latestFrame){
+            int channels = GetChannels();
+            size_t frameBytes = (size_t)m_width * m_height * channels;
+            for(size_t i = 0; i < m_count; ++i){
+                // Tile i is column i % cols of row i / cols, rows counted
+                // from the bottom like the pixels
+                size_t left = (i % m_columns) * m_width;
+                size_t bottom = (i / m_columns) * m_height;
+                uint8_t* frame = m_latest.data() + i * frameBytes;
+                for(int y = 0; y < m_height; ++y){
+                    const uint8_t* row = pixels + ((bottom + y) * atlasWidth + left) * 4;
+                    uint8_t* out = frame + (size_t)y * m_width * channels;
+                    if(m_grayscale){
+                        // Rec. 601 luma in 8.8 fixed point
+                        for(int x = 0; x < m_width; ++x){
+                            const uint8_t* p = row + x*4;
+                            out[x] = (uint8_t)((77*p[0] + 150*p[1] + 29*p[2]) >> 8);
+                        }
+                    }else{
+                        for(int x = 0; x < m_width; ++x){
+                            out[x*3 + 0] = row[x*4 + 0];
+                            out[x*3 + 1] = row[x*4 + 1];
+                            out[x*3 + 2] = row[x*4 + 2];
+                        }
+                    }
+                }
+            }
+            m_latestFrame = slot.frame;
+            ++m_readbacks;
+        }
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    return true;
+}
+
+void AtlasObserver::BlitToWindow(int windowWidth, int windowHeight) const{
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_framebuffer);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    // Nearest filtering shows the pixels the agents actually get
+    glBlitFramebuffer(0, 0, m_columns * m_width, m_rows * m_height, 0, 0, windowWidth, windowHeight,
+                      GL_COLOR_BUFFER_BIT, GL_NEAREST);
+}
+
+void AtlasObserver::Release(){
+    for(Slot& slot : m_slots){
+        if(slot.fence != nullptr){
+            glDeleteSync(slot.fence);
+        }
+        glDeleteBuffers(1, &slot.buffer);
+        GPUResourceTracker::Get().Deleted(GPU_BUFFER, slot.buffer);
+    }
+    m_slots.clear();
+    if(m_framebuffer != 0){
+        glDeleteFramebuffers(1, &m_framebuffer);
+        GPUResourceTracker::Get().Deleted(GPU_FRAMEBUFFER, m_framebuffer);
+        m_framebuffer = 0;
+    }
+    if(m_colorBuffer != 0){
+        glDeleteRenderbuffers(1, &m_colorBuffer);
+        GPUResourceTracker::Get().Deleted(GPU_RENDERBUFFER, m_colorBuffer);
+        m_colorBuffer = 0;
+    }
+    if(m_depthBuffer != 0){
+        glDeleteRenderbuffers(1, &m_depthBuffer);
+        GPUResourceTracker::Get().Deleted(GPU_RENDERBUFFER, m_depthBuffer);
+        m_depthBuffer = 0;
+    }
+    m_batch.Release();
+    m_program.Release();
+}
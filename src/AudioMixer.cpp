@@ -0,0 +1,203 @@
+#include "AudioMixer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+// The device mixes float stereo; SDL converts if the hardware does not
+static const SDL_AudioFormat MIX_FORMAT = AUDIO_F32SYS;
+static const int MIX_CHANNELS = 2;
+static const int MIX_RATE = 48000;
+// Seconds a synthesized sound takes to fade in, so it starts without a click
+static const float SWEEP_ATTACK = 0.004f;
+
+// Constructor
+AudioMixer::AudioMixer(){
+
+}
+
+// Destructor
+AudioMixer::~AudioMixer(){
+    Close();
+}
+
+bool AudioMixer::Open(int bufferFrames){
+    Close();
+    if(SDL_InitSubSystem(SDL_INIT_AUDIO) != 0){
+        std::cout << "AudioMixer.cpp: no audio: " << SDL_GetError() << "\n";
+        return false;
+    }
+    SDL_AudioSpec desired;
+    SDL_zero(desired);
+    desired.freq = MIX_RATE;
+    desired.format = MIX_FORMAT;
+    desired.channels = MIX_CHANNELS;
+    desired.samples = (Uint16)bufferFrames;
+    desired.callback = Callback;
+    desired.userdata = this;
+    // Whatever rate the device runs at, the sounds are converted to it.
+    // Format, channels and buffer size stay ours, SDL converts and
+    // rebuffers for hardware with others.
+    m_device = SDL_OpenAudioDevice(nullptr, 0, &desired, &m_spec, SDL_AUDIO_ALLOW_FREQUENCY_CHANGE);
+    if(m_device == 0){
+        std::cout << "AudioMixer.cpp: could not open an audio device: " << SDL_GetError() << "\n";
+        SDL_QuitSubSystem(SDL_INIT_AUDIO);
+        m_spec = SDL_AudioSpec();
+        return false;
+    }
+    return true;
+}
+
+int AudioMixer::LoadWav(const std::string& filepath){
+    if(m_device == 0 || m_started){
+        return -1;
+    }
+    SDL_RWops* file = SDL_RWFromFile(filepath.c_str(), "rb");
+    if(file == nullptr){
+        return -1;
+    }
+    SDL_AudioSpec spec;
+    Uint8* data = nullptr;
+    Uint32 length = 0;
+    if(SDL_LoadWAV_RW(file, 1, &spec, &data, &length) == nullptr){
+        std::cout << "AudioMixer.cpp: could not decode " << filepath << ": " << SDL_GetError() << "\n";
+        return -1;
+    }
+    SDL_AudioCVT convert;
+    if(SDL_BuildAudioCVT(&convert, spec.format, spec.channels, spec.freq, AUDIO_F32SYS, 1, m_spec.freq) < 0){
+        std::cout << "AudioMixer.cpp: could not convert " << filepath << ": " << SDL_GetError() << "\n";
+        SDL_FreeWAV(data);
+        return -1;
+    }
+    std::vector<Uint8> buffer((size_t)length * (size_t)std::max(convert.len_mult, 1));
+    memcpy(buffer.data(), data, length);
+    SDL_FreeWAV(data);
+    convert.buf = buffer.data();
+    convert.len = (int)length;
+    if(convert.needed && SDL_ConvertAudio(&convert) != 0){
+        std::cout << "AudioMixer.cpp: could not convert " << filepath << ": " << SDL_GetError() << "\n";
+        return -1;
+    }
+    int bytes = convert.needed ? convert.len_cvt : (int)length;
+    std::vector<float> samples((size_t)bytes / sizeof(float));
+    memcpy(samples.data(), buffer.data(), samples.size() * sizeof(float));
+    return AddSound(samples);
+}
+
+int AudioMixer::AddSound(const std::vector<float>& samples){
+    if(m_device == 0 || m_started || samples.empty()){
+        return -1;
+    }
+    m_sounds.push_back(samples);
+    return (int)m_sounds.size() - 1;
+}
+
+void AudioMixer::Start(){
+    if(m_device == 0 || m_started){
+        return;
+    }
+    m_started = true;
+    SDL_PauseAudioDevice(m_device, 0);
+}
+
+bool AudioMixer::Play(int sound, float volume){
+    if(!m_started || sound < 0 || sound >= (int)m_sounds.size()){
+        return false;
+    }
+    Command command;
+    command.sound = sound;
+    command.volume = volume;
+    if(!m_commands.Push(command)){
+        ++m_droppedSounds;
+        return false;
+    }
+    return true;
+}
+
+void AudioMixer::Close(){
+    if(m_device == 0){
+        return;
+    }
+    // Waits for a callback in progress, after which none runs again
+    SDL_CloseAudioDevice(m_device);
+    SDL_QuitSubSystem(SDL_INIT_AUDIO);
+    m_device = 0;
+    m_started = false;
+    m_sounds.clear();
+    for(Voice& voice : m_voices){
+        voice = Voice();
+    }
+    m_spec = SDL_AudioSpec();
+}
+
+void SDLCALL AudioMixer::Callback(void* userdata, Uint8* stream, int bytes){
+    AudioMixer* mixer = (AudioMixer*)userdata;
+    mixer->Mix((float*)stream, bytes / (int)(sizeof(float) * MIX_CHANNELS));
+}
+
+void AudioMixer::Mix(float* output, int frames){
+    // The sounds were fixed by Start(), so the voices may point into them
+    Command command;
+    while(m_commands.Pop(command)){
+        Voice* free = nullptr;
+        for(Voice& voice : m_voices){
+            if(voice.samples == nullptr){
+                free = &voice;
+                break;
+            }
+        }
+        if(free == nullptr){
+            m_droppedVoices.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        const std::vector<float>& sound = m_sounds[command.sound];
+        free->samples = sound.data();
+        free->length = sound.size();
+        free->position = 0;
+        free->volume = command.volume;
+    }
+
+    memset(output, 0, (size_t)frames * MIX_CHANNELS * sizeof(float));
+    for(Voice& voice : m_voices){
+        if(voice.samples == nullptr){
+            continue;
+        }
+        size_t count = std::min((size_t)frames, voice.length - voice.position);
+        const float* source = voice.samples + voice.position;
+        for(size_t i = 0; i < count; ++i){
+            float sample = source[i] * voice.volume;
+            output[i*2] += sample;
+            output[i*2 + 1] += sample;
+        }
+        voice.position += count;
+        if(voice.position >= voice.length){
+            voice = Voice();
+        }
+    }
+    // Sounds that overlap may add up past full scale
+    for(int i = 0; i < frames * MIX_CHANNELS; ++i){
+        output[i] = std::min(std::max(output[i], -1.0f), 1.0f);
+    }
+    m_mixedBuffers.fetch_add(1, std::memory_order_relaxed);
+}
+
+std::vector<float> AudioMixer::MakeSweep(int sampleRate, float fromHertz, float toHertz, float seconds, float noise){
+    size_t count = (size_t)std::max(1.0f, seconds * (float)sampleRate);
+    std::vector<float> samples(count);
+    // A fixed seed, so every run sounds the same
+    uint32_t random = 0x9E3779B9u;
+    double phase = 0.0;
+    for(size_t i = 0; i < count; ++i){
+        float t = (float)i / (float)count;
+        float hertz = fromHertz + (toHertz - fromHertz) * t;
+        phase += 2.0 * M_PI * hertz / (double)sampleRate;
+        random = random * 1664525u + 1013904223u;
+        float white = (float)(random >> 8) / (float)(1u << 23) - 1.0f;
+        float tone = (float)std::sin(phase);
+        float attack = std::min(1.0f, (float)i / (SWEEP_ATTACK * (float)sampleRate));
+        float decay = (1.0f - t) * (1.0f - t);
+        samples[i] = (tone * (1.0f - noise) + white * noise) * attack * decay * 0.5f;
+    }
+    return samples;
+}
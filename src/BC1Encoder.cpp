@@ -0,0 +1,211 @@
+#include "BC1Encoder.hpp"
+#include "KTXFile.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+// An RGB color packed into 5:6:5 bits, rounded to nearest
+static uint16_t PackRGB565(const float color[3]){
+    int r = std::min(31, std::max(0, (int)std::lround(color[0] * 31.0f / 255.0f)));
+    int g = std::min(63, std::max(0, (int)std::lround(color[1] * 63.0f / 255.0f)));
+    int b = std::min(31, std::max(0, (int)std::lround(color[2] * 31.0f / 255.0f)));
+    return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+// The color a 5:6:5 value decodes to
+static void UnpackRGB565(uint16_t packed, float color[3]){
+    color[0] = (float)((packed >> 11) & 31) * 255.0f / 31.0f;
+    color[1] = (float)((packed >> 5) & 63) * 255.0f / 63.0f;
+    color[2] = (float)(packed & 31) * 255.0f / 31.0f;
+}
+
+// Texels with less alpha than this are transparent in a block
+static const float OPAQUE_ALPHA = 128.0f;
+
+/**
+* Encodes 16 RGBA texels as one BC1 block. The endpoints are the extremes
+* of the opaque texels along their principal axis, then every texel takes
+* the nearest of the four palette colors. A block with a transparent
+* texel uses the three color mode, whose fourth index is transparent.
+*
+* @return void
+*/
+static void EncodeBC1Block(const float texels[16][4], uint8_t block[8]){
+    int opaqueCount = 0;
+    float mean[3] = {0.0f, 0.0f, 0.0f};
+    for(int i = 0; i < 16; ++i){
+        if(texels[i][3] < OPAQUE_ALPHA){
+            continue;
+        }
+        ++opaqueCount;
+        for(int c = 0; c < 3; ++c){
+            mean[c] += texels[i][c];
+        }
+    }
+    bool transparent = (opaqueCount < 16);
+    for(int c = 0; c < 3; ++c){
+        mean[c] /= (float)std::max(1, opaqueCount);
+    }
+    float covariance[3][3] = {};
+    for(int i = 0; i < 16; ++i){
+        if(texels[i][3] < OPAQUE_ALPHA){
+            continue;
+        }
+        float d[3] = {texels[i][0] - mean[0], texels[i][1] - mean[1], texels[i][2] - mean[2]};
+        for(int a = 0; a < 3; ++a){
+            for(int b = 0; b < 3; ++b){
+                covariance[a][b] += d[a] * d[b];
+            }
+        }
+    }
+    // Principal axis by power iteration
+    float axis[3] = {1.0f, 1.0f, 1.0f};
+    for(int iteration = 0; iteration < 8; ++iteration){
+        float next[3];
+        for(int a = 0; a < 3; ++a){
+            next[a] = covariance[a][0] * axis[0] + covariance[a][1] * axis[1] + covariance[a][2] * axis[2];
+        }
+        float length = std::sqrt(next[0] * next[0] + next[1] * next[1] + next[2] * next[2]);
+        if(length < 1e-6f){
+            break;
+        }
+        for(int a = 0; a < 3; ++a){
+            axis[a] = next[a] / length;
+        }
+    }
+    float lowest = 0.0f;
+    float highest = 0.0f;
+    for(int i = 0; i < 16; ++i){
+        if(texels[i][3] < OPAQUE_ALPHA){
+            continue;
+        }
+        float t = (texels[i][0] - mean[0]) * axis[0] + (texels[i][1] - mean[1]) * axis[1] + (texels[i][2] - mean[2]) * axis[2];
+        lowest = std::min(lowest, t);
+        highest = std::max(highest, t);
+    }
+    float high[3];
+    float low[3];
+    for(int c = 0; c < 3; ++c){
+        high[c] = mean[c] + axis[c] * highest;
+        low[c] = mean[c] + axis[c] * lowest;
+    }
+    uint16_t color0 = PackRGB565(high);
+    uint16_t color1 = PackRGB565(low);
+    // color0 > color1 selects the four color mode, color0 <= color1 the
+    // three color mode with transparency
+    if((color0 < color1) != transparent){
+        std::swap(color0, color1);
+    }
+
+    float palette[4][3];
+    UnpackRGB565(color0, palette[0]);
+    UnpackRGB565(color1, palette[1]);
+    for(int c = 0; c < 3; ++c){
+        if(transparent){
+            palette[2][c] = (palette[0][c] + palette[1][c]) / 2.0f;
+            palette[3][c] = 0.0f;
+        }else{
+            palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+            palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+        }
+    }
+    uint32_t indices = 0;
+    if(color0 != color1 || transparent){
+        for(int i = 0; i < 16; ++i){
+            if(texels[i][3] < OPAQUE_ALPHA){
+                indices |= 3u << (2 * i);
+                continue;
+            }
+            int best = 0;
+            float bestDistance = 1e30f;
+            for(int p = 0; p < (transparent ? 3 : 4); ++p){
+                float dr = texels[i][0] - palette[p][0];
+                float dg = texels[i][1] - palette[p][1];
+                float db = texels[i][2] - palette[p][2];
+                float distance = dr * dr + dg * dg + db * db;
+                if(distance < bestDistance){
+                    bestDistance = distance;
+                    best = p;
+                }
+            }
+            indices |= (uint32_t)best << (2 * i);
+        }
+    }
+    block[0] = (uint8_t)(color0 & 0xFF);
+    block[1] = (uint8_t)(color0 >> 8);
+    block[2] = (uint8_t)(color1 & 0xFF);
+    block[3] = (uint8_t)(color1 >> 8);
+    for(int i = 0; i < 4; ++i){
+        block[4 + i] = (uint8_t)(indices >> (8 * i));
+    }
+}
+
+// sRGB 8-bit value to linear light and back, approximated by a 2.2 gamma
+static float ToLinear(float value){
+    return std::pow(value / 255.0f, 2.2f);
+}
+static float FromLinear(float value){
+    return std::pow(value, 1.0f / 2.2f) * 255.0f;
+}
+
+std::vector<uint8_t> HalveImage(const std::vector<uint8_t>& rgba, int& width, int& height){
+    int halfWidth = std::max(1, width / 2);
+    int halfHeight = std::max(1, height / 2);
+    std::vector<uint8_t> half((size_t)halfWidth * halfHeight * 4);
+    for(int y = 0; y < halfHeight; ++y){
+        for(int x = 0; x < halfWidth; ++x){
+            int x0 = std::min(width - 1, 2 * x);
+            int x1 = std::min(width - 1, 2 * x + 1);
+            int y0 = std::min(height - 1, 2 * y);
+            int y1 = std::min(height - 1, 2 * y + 1);
+            for(int c = 0; c < 3; ++c){
+                float sum = ToLinear(rgba[((size_t)y0 * width + x0) * 4 + c]) +
+                            ToLinear(rgba[((size_t)y0 * width + x1) * 4 + c]) +
+                            ToLinear(rgba[((size_t)y1 * width + x0) * 4 + c]) +
+                            ToLinear(rgba[((size_t)y1 * width + x1) * 4 + c]);
+                half[((size_t)y * halfWidth + x) * 4 + c] = (uint8_t)std::min(255.0f, FromLinear(sum / 4.0f) + 0.5f);
+            }
+            int alpha = rgba[((size_t)y0 * width + x0) * 4 + 3] + rgba[((size_t)y0 * width + x1) * 4 + 3] +
+                        rgba[((size_t)y1 * width + x0) * 4 + 3] + rgba[((size_t)y1 * width + x1) * 4 + 3];
+            half[((size_t)y * halfWidth + x) * 4 + 3] = (uint8_t)((alpha + 2) / 4);
+        }
+    }
+    width = halfWidth;
+    height = halfHeight;
+    return half;
+}
+
+std::vector<uint8_t> EncodeBC1(const uint8_t* rgba, int width, int height){
+    std::vector<uint8_t> blocks(KTXFile::GetImageBytes(GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, width, height));
+    uint8_t* out = blocks.data();
+    for(int by = 0; by < height; by += 4){
+        for(int bx = 0; bx < width; bx += 4){
+            float texels[16][4];
+            for(int i = 0; i < 16; ++i){
+                // Blocks over the edge repeat the last row or column
+                int x = std::min(width - 1, bx + (i & 3));
+                int y = std::min(height - 1, by + (i >> 2));
+                const uint8_t* texel = rgba + ((size_t)y * width + x) * 4;
+                for(int c = 0; c < 4; ++c){
+                    texels[i][c] = (float)texel[c];
+                }
+            }
+            EncodeBC1Block(texels, out);
+            out += 8;
+        }
+    }
+    return blocks;
+}
+
+std::vector<std::vector<uint8_t>> EncodeBC1MipChain(const uint8_t* rgba, int width, int height){
+    std::vector<std::vector<uint8_t>> levels;
+    std::vector<uint8_t> level(rgba, rgba + (size_t)width * height * 4);
+    for(;;){
+        levels.push_back(EncodeBC1(level.data(), width, height));
+        if(width == 1 && height == 1){
+            break;
+        }
+        level = HalveImage(level, width, height);
+    }
+    return levels;
+}
@@ -0,0 +1,73 @@
+#include "BatchTransform.hpp"
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+// The record at index of an array of stride bytes each
+static inline const float* Record(const float* first, size_t stride, size_t index){
+    return (const float*)((const char*)first + index*stride);
+}
+
+#if !defined(__SSE2__) && defined(__ARM_NEON) && defined(__aarch64__)
+// Loads the four records from index on, lanes[k] holding their k-th floats
+static inline void LoadTransposed(const float* first, size_t stride, size_t index, float32x4_t lanes[4]){
+    float32x4_t r0 = vld1q_f32(Record(first, stride, index));
+    float32x4_t r1 = vld1q_f32(Record(first, stride, index + 1));
+    float32x4_t r2 = vld1q_f32(Record(first, stride, index + 2));
+    float32x4_t r3 = vld1q_f32(Record(first, stride, index + 3));
+    // (x0 x1 z0 z1, y0 y1 w0 w1) and the same for records 2 and 3
+    float32x4x2_t low = vtrnq_f32(r0, r1);
+    float32x4x2_t high = vtrnq_f32(r2, r3);
+    lanes[0] = vcombine_f32(vget_low_f32(low.val[0]), vget_low_f32(high.val[0]));
+    lanes[1] = vcombine_f32(vget_low_f32(low.val[1]), vget_low_f32(high.val[1]));
+    lanes[2] = vcombine_f32(vget_high_f32(low.val[0]), vget_high_f32(high.val[0]));
+    lanes[3] = vcombine_f32(vget_high_f32(low.val[1]), vget_high_f32(high.val[1]));
+}
+#endif
+
+void PlaceSpheres(const float* transforms, size_t transformStride,
+                  const float* spheres, size_t sphereStride, size_t count,
+                  float* x, float* y, float* z, float* radius){
+    size_t i = 0;
+#if defined(__SSE2__)
+    for(; i + 4 <= count; i += 4){
+        // Four records in, one lane per record out
+        __m128 tx = _mm_load_ps(Record(transforms, transformStride, i));
+        __m128 ty = _mm_load_ps(Record(transforms, transformStride, i + 1));
+        __m128 tz = _mm_load_ps(Record(transforms, transformStride, i + 2));
+        __m128 ts = _mm_load_ps(Record(transforms, transformStride, i + 3));
+        _MM_TRANSPOSE4_PS(tx, ty, tz, ts);
+        __m128 cx = _mm_load_ps(Record(spheres, sphereStride, i));
+        __m128 cy = _mm_load_ps(Record(spheres, sphereStride, i + 1));
+        __m128 cz = _mm_load_ps(Record(spheres, sphereStride, i + 2));
+        __m128 cr = _mm_load_ps(Record(spheres, sphereStride, i + 3));
+        _MM_TRANSPOSE4_PS(cx, cy, cz, cr);
+        _mm_storeu_ps(x + i, _mm_add_ps(tx, _mm_mul_ps(cx, ts)));
+        _mm_storeu_ps(y + i, _mm_add_ps(ty, _mm_mul_ps(cy, ts)));
+        _mm_storeu_ps(z + i, _mm_add_ps(tz, _mm_mul_ps(cz, ts)));
+        _mm_storeu_ps(radius + i, _mm_mul_ps(cr, ts));
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    for(; i + 4 <= count; i += 4){
+        float32x4_t t[4];
+        float32x4_t c[4];
+        LoadTransposed(transforms, transformStride, i, t);
+        LoadTransposed(spheres, sphereStride, i, c);
+        vst1q_f32(x + i, vfmaq_f32(t[0], c[0], t[3]));
+        vst1q_f32(y + i, vfmaq_f32(t[1], c[1], t[3]));
+        vst1q_f32(z + i, vfmaq_f32(t[2], c[2], t[3]));
+        vst1q_f32(radius + i, vmulq_f32(c[3], t[3]));
+    }
+#endif
+    for(; i < count; ++i){
+        const float* transform = Record(transforms, transformStride, i);
+        const float* sphere = Record(spheres, sphereStride, i);
+        x[i] = transform[0] + sphere[0]*transform[3];
+        y[i] = transform[1] + sphere[1]*transform[3];
+        z[i] = transform[2] + sphere[2]*transform[3];
+        radius[i] = sphere[3]*transform[3];
+    }
+}
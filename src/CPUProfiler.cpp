@@ -0,0 +1,171 @@
+#include "CPUProfiler.hpp"
+#include "FlightRecorder.hpp"
+#include "TraceRecorder.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+// Innermost ProfileZone of each thread
+static thread_local int tCurrentZone = -1;
+
+CPUProfiler& CPUProfiler::Get(){
+    static CPUProfiler profiler;
+    return profiler;
+}
+
+// Constructor
+CPUProfiler::CPUProfiler(){
+    m_millisecondsPerCount = 1000.0/(double)SDL_GetPerformanceFrequency();
+}
+
+// Destructor
+CPUProfiler::~CPUProfiler(){
+
+}
+
+int CPUProfiler::AddZone(const std::string& name){
+    Zone zone;
+    zone.name = name;
+    zone.samples.reserve(WINDOW_SIZE);
+    m_zones.push_back(zone);
+    return (int)m_zones.size() - 1;
+}
+
+int CPUProfiler::GetCurrentZone(){
+    return tCurrentZone;
+}
+
+int CPUProfiler::EnterZone(int zone){
+    int previous = tCurrentZone;
+    tCurrentZone = zone;
+    return previous;
+}
+
+void CPUProfiler::LeaveZone(int previous){
+    tCurrentZone = previous;
+}
+
+CPUProfiler::ThreadRing& CPUProfiler::GetThreadRing(){
+    thread_local ThreadRing* ring = nullptr;
+    if(ring == nullptr){
+        // Rings belong to the profiler, so they outlive their thread and
+        // whatever it left behind is still collected
+        std::lock_guard<std::mutex> lock(m_ringsMutex);
+        m_rings.push_back(std::unique_ptr<ThreadRing>(new ThreadRing()));
+        ring = m_rings.back().get();
+    }
+    return *ring;
+}
+
+void CPUProfiler::Record(int zone, uint64_t start, uint64_t end){
+    ThreadRing& ring = GetThreadRing();
+    uint32_t head = ring.head.load(std::memory_order_relaxed);
+    uint32_t tail = ring.tail.load(std::memory_order_acquire);
+    if(head - tail >= RING_SIZE){
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    Sample& sample = ring.samples[head & (RING_SIZE - 1)];
+    sample.zone = zone;
+    sample.start = start;
+    sample.end = end;
+    // Publishes the sample to Collect()
+    ring.head.store(head + 1, std::memory_order_release);
+}
+
+void CPUProfiler::SetTrace(TraceRecorder* trace){
+    m_trace = trace;
+    if(m_trace != nullptr){
+        for(Zone& zone : m_zones){
+            zone.traceName = m_trace->AddName(zone.name);
+        }
+    }
+}
+
+void CPUProfiler::SetFlightRecorder(FlightRecorder* flight){
+    m_flight = flight;
+    if(m_flight != nullptr){
+        for(Zone& zone : m_zones){
+            zone.flightName = m_flight->AddName(zone.name);
+        }
+    }
+}
+
+void CPUProfiler::Collect(){
+    std::lock_guard<std::mutex> lock(m_ringsMutex);
+    bool tracing = (m_trace != nullptr && m_trace->IsRecording());
+    bool flying = (m_flight != nullptr && m_flight->IsRecording());
+    for(size_t thread = 0; thread < m_rings.size(); ++thread){
+        ThreadRing* ring = m_rings[thread].get();
+        uint32_t tail = ring->tail.load(std::memory_order_relaxed);
+        uint32_t head = ring->head.load(std::memory_order_acquire);
+        for(; tail != head; ++tail){
+            const Sample& sample = ring->samples[tail & (RING_SIZE - 1)];
+            if(sample.zone < 0 || sample.zone >= (int)m_zones.size()){
+                continue;
+            }
+            Zone& zone = m_zones[sample.zone];
+            if(tracing){
+                // Tracks count from 1, the first thread to record is main
+                m_trace->AddZone(zone.traceName, (int)thread + 1, sample.start, sample.end);
+            }
+            if(flying){
+                m_flight->AddZone(zone.flightName, (int)thread + 1, sample.start, sample.end);
+            }
+            double milliseconds = (double)(sample.end - sample.start)*m_millisecondsPerCount;
+            if(zone.samples.size() < WINDOW_SIZE){
+                zone.samples.push_back(milliseconds);
+            }else{
+                zone.samples[zone.nextSample] = milliseconds;
+            }
+            zone.nextSample = (zone.nextSample + 1) % WINDOW_SIZE;
+        }
+        // Hands the slots back to the writer
+        ring->tail.store(tail, std::memory_order_release);
+    }
+}
+
+// Value below which percent of the sorted samples lie
+static double Percentile(const std::vector<double>& sorted, size_t percent){
+    size_t index = (sorted.size() * percent) / 100;
+    if(index >= sorted.size()){
+        index = sorted.size() - 1;
+    }
+    return sorted[index];
+}
+
+double CPUProfiler::GetZoneMean(int zone) const{
+    if(zone < 0 || zone >= (int)m_zones.size() || m_zones[zone].samples.empty()){
+        return -1.0;
+    }
+    double total = 0.0;
+    for(double sample : m_zones[zone].samples){
+        total += sample;
+    }
+    return total / m_zones[zone].samples.size();
+}
+
+void CPUProfiler::Report() const{
+    std::cout << "CPU zones (ms):";
+    for(const Zone& zone : m_zones){
+        if(zone.samples.empty()){
+            continue;
+        }
+        double total = 0.0;
+        for(double sample : zone.samples){
+            total += sample;
+        }
+        std::vector<double> sorted = zone.samples;
+        std::sort(sorted.begin(), sorted.end());
+        std::cout << "\n  " << zone.name << " min " << sorted.front()
+                  << " mean " << total / sorted.size()
+                  << " p95 " << Percentile(sorted, 95)
+                  << " p99 " << Percentile(sorted, 99)
+                  << " (" << sorted.size() << " runs)";
+    }
+    uint64_t dropped = GetDroppedCount();
+    if(dropped > 0){
+        std::cout << "\n  " << dropped << " samples dropped";
+    }
+    std::cout << "\n";
+}
@@ -1,4 +1,5 @@
 #include "Camera.hpp"
+#include "Logger.hpp"
 
 #include "glm/gtx/transform.hpp"
 #include "glm/gtx/rotate_vector.hpp"
@@ -25,6 +26,9 @@ void Camera::MouseLook(int mouseX, int mouseY){
     // Rotate about the upVector; commented out code to rotate about the x-axis
     m_viewDirection = glm::rotate(m_viewDirection, -mouseDelta.x, m_upVector);
     m_viewDirection = glm::rotate(m_viewDirection, mouseDelta.y, glm::cross(m_upVector, m_viewDirection));
+    if(mouseDelta != glm::vec2(0.0f)){
+        m_viewDirty = true;
+    }
     
     // Update our old position after we have made changes 
     m_oldMousePosition = newMousePosition;
@@ -37,28 +41,34 @@ void Camera::MouseLook(int mouseX, int mouseY){
 
 void Camera::MoveForward(float speed){
     m_eyePosition += speed * m_viewDirection;
+    m_viewDirty = true;
 }
 
 void Camera::MoveBackward(float speed){
     m_eyePosition -= speed * m_viewDirection;
+    m_viewDirty = true;
 }
 
 void Camera::MoveLeft(float speed){
     glm::vec3 leftVector = glm::cross(m_upVector, m_viewDirection);
     m_eyePosition += speed * leftVector;
+    m_viewDirty = true;
 }
 
 void Camera::MoveRight(float speed){
     glm::vec3 rightVector = glm::cross(m_viewDirection, m_upVector);
     m_eyePosition += speed * rightVector;
+    m_viewDirty = true;
 }
 
 void Camera::MoveUp(float speed){
     m_eyePosition.y += speed;
+    m_viewDirty = true;
 }
 
 void Camera::MoveDown(float speed){
     m_eyePosition.y -= speed;
+    m_viewDirty = true;
 }
 
 // Set the position for the camera
@@ -66,6 +76,15 @@ void Camera::SetCameraEyePosition(float x, float y, float z){
     m_eyePosition.x = x;
     m_eyePosition.y = y;
     m_eyePosition.z = z;
+    m_viewDirty = true;
+}
+
+// Set the direction the camera looks in
+void Camera::SetViewDirection(float x, float y, float z){
+    m_viewDirection.x = x;
+    m_viewDirection.y = y;
+    m_viewDirection.z = z;
+    m_viewDirty = true;
 }
 
 float Camera::GetEyeXPosition(){
@@ -94,7 +113,7 @@ float Camera::GetViewZDirection(){
 
 
 Camera::Camera(){
-    std::cout << "Camera.cpp: (Constructor) Created a Camera!\n";
+    LOG_DEBUG("Camera.cpp: (Constructor) Created a Camera!");
 	// Position us around the origin.
     m_eyePosition = glm::vec3(0.0f,2.0f, 5.0f);
 	// Looking down along the z-axis initially.
@@ -104,10 +123,55 @@ Camera::Camera(){
     m_upVector = glm::vec3(0.0f, 1.0f, 0.0f);
 }
 
-glm::mat4 Camera::GetViewMatrix() const{
-    // Think about the second argument and why that is
-    // setup as it is.
-    return glm::lookAt( m_eyePosition,
-                        m_eyePosition + m_viewDirection,
-                        m_upVector);
+const glm::mat4& Camera::GetViewMatrix() const{
+    if(m_viewDirty){
+        // Think about the second argument and why that is
+        // setup as it is.
+        m_viewMatrix = glm::lookAt( m_eyePosition,
+                                    m_eyePosition + m_viewDirection,
+                                    m_upVector);
+        m_viewDirty = false;
+        m_viewProjectionDirty = true;
+    }
+    return m_viewMatrix;
+}
+
+const glm::mat4& Camera::GetProjectionMatrix() const{
+    if(m_projectionDirty){
+        m_projectionMatrix = glm::perspective(glm::radians(m_fovDegrees), m_aspectRatio, m_nearPlane, m_farPlane);
+        m_projectionDirty = false;
+        m_viewProjectionDirty = true;
+    }
+    return m_projectionMatrix;
+}
+
+const glm::mat4& Camera::GetViewProjectionMatrix() const{
+    // Either getter may mark the product stale, so ask both first
+    const glm::mat4& view = GetViewMatrix();
+    const glm::mat4& projection = GetProjectionMatrix();
+    if(m_viewProjectionDirty){
+        m_viewProjectionMatrix = projection * view;
+        m_viewProjectionDirty = false;
+    }
+    return m_viewProjectionMatrix;
+}
+
+void Camera::SetViewportSize(int width, int height){
+    if(width <= 0 || height <= 0){
+        return;
+    }
+    float aspectRatio = (float)width/(float)height;
+    if(aspectRatio != m_aspectRatio){
+        m_aspectRatio = aspectRatio;
+        m_projectionDirty = true;
+    }
+}
+
+void Camera::SetPerspective(float fovDegrees, float nearPlane, float farPlane){
+    if(fovDegrees != m_fovDegrees || nearPlane != m_nearPlane || farPlane != m_farPlane){
+        m_fovDegrees = fovDegrees;
+        m_nearPlane = nearPlane;
+        m_farPlane = farPlane;
+        m_projectionDirty = true;
+    }
 }
@@ -0,0 +1,266 @@
+#include "Collision.hpp"
+#include "FixedPoint.hpp"
+#include "SimdLanes.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+
+// Baked with AddSilhouetteTriangles() from the shipped meshes, at their
+// boxes; row 0 is the bottom of the box, bit 0 its left
+const CollisionSilhouette DEFAULT_DINO_SILHOUETTE = {
+    {-167, -123, -80, -43},
+    {
+        0x00001fffffffffffull, 0x00001fffffffffffull, 0x00001fffffffffffull, 0x00001fffffffffffull,
+        0x00001fffffffffffull, 0x00001fffffffffffull, 0x00001fffffffffffull, 0x00001fffffffffffull,
+        0x00001fffffffffffull, 0x00001fffffffffffull, 0x00001fffffffffffull, 0x00001fffffffffffull,
+        0x00001fffffffffffull, 0x00001fffffffffffull, 0x00001fffffffffffull, 0x00001fffffffffffull,
+        0x00001fffffffffffull, 0x00001fffffffffffull, 0x00001fffffffffffull, 0x00001fffffffffffull,
+        0x00001fffffffffffull, 0x00001fffffffffffull, 0x00001fffffffffffull, 0x00001fffffffffffull,
+        0x00001fffc000001full, 0x00001fffc000001full, 0x00001fffc000000full, 0x00001fffc0000007ull,
+        0x00001fffc0000007ull, 0x00001fffc0000003ull, 0x00001fffc0000003ull, 0x00001fffc0000001ull,
+        0x00001fffc0000001ull, 0x00001fffc0000000ull, 0x00001fffc0000000ull, 0x00001fffc0000000ull,
+        0x00001fffc0000000ull, 0x00001fffc0000000ull,
+    }
+};
+const CollisionSilhouette DEFAULT_OBSTACLE_SILHOUETTE = {
+    {-18, 15, -71, -22},
+    {
+        0x000000003fffffffull, 0x000000003fffffffull, 0x000000003fffffffull, 0x000000003fffffffull,
+        0x000000003fffffffull, 0x000000003fffffffull, 0x000000003fffffffull, 0x000000003fffffffull,
+        0x000000003fffffc0ull, 0x000000003fffffc0ull, 0x000000003fffffc0ull, 0x000000003fffffc0ull,
+        0x000000003fffffc0ull, 0x000000003fffffc0ull, 0x000000003fffffc0ull, 0x000000003fffffc0ull,
+        0x000000003fffffc0ull, 0x000000003fffffc0ull, 0x000000003fffffc0ull, 0x000000003fffffc0ull,
+        0x000000003fffffc0ull, 0x000000003fffffc0ull, 0x000000003fffffc0ull, 0x000000003fffffc0ull,
+        0x000000003fffffc0ull, 0x000000003fffffc0ull, 0x000000003fffffc0ull, 0x000000003fffffc0ull,
+        0x000000003fffffc0ull, 0x000000003fffffc0ull, 0x000000003fffffc0ull, 0x000000003fffffc0ull,
+        0x000000003fffffc0ull, 0x000000003fffffc0ull, 0x000000003fffffc0ull, 0x000000003fffffc0ull,
+        0x000000003fffffc0ull, 0x000000003fffffc0ull, 0x000000003fffffc0ull, 0x000000003fffffc0ull,
+        0x000000003fffffc0ull, 0x000000003fffffc0ull, 0x000000003fffffc0ull, 0x000000003fffffc0ull,
+        0x000000003fffffc0ull, 0x000000003fffffc0ull, 0x000000003fffffc0ull, 0x000000003fffffc0ull,
+        0x000000003fffffc0ull, 0x000000003fffffc0ull,
+    }
+};
+
+static CollisionRules gCollisionRules = {DEFAULT_DINO_BOX, DEFAULT_OBSTACLE_BOX,
+                                         OverlapRange(DEFAULT_DINO_BOX, DEFAULT_OBSTACLE_BOX),
+                                         true, DEFAULT_DINO_SILHOUETTE, DEFAULT_OBSTACLE_SILHOUETTE};
+
+const CollisionRules& GetCollisionRules(){
+    return gCollisionRules;
+}
+
+void SetCollisionRules(const CollisionBox& dino, const CollisionBox& obstacle){
+    gCollisionRules.dino = dino;
+    gCollisionRules.obstacle = obstacle;
+    gCollisionRules.hitRange = OverlapRange(dino, obstacle);
+    gCollisionRules.silhouettes = false;
+}
+
+void SetCollisionRules(const CollisionSilhouette& dino, const CollisionSilhouette& obstacle){
+    SetCollisionRules(dino.box, obstacle.box);
+    gCollisionRules.silhouettes = true;
+    gCollisionRules.dinoSilhouette = dino;
+    gCollisionRules.obstacleSilhouette = obstacle;
+}
+
+bool FitsSilhouette(const CollisionBox& box){
+    return box.maxX - box.minX < SILHOUETTE_SIZE && box.maxY - box.minY < SILHOUETTE_SIZE;
+}
+
+CollisionSilhouette MakeCollisionSilhouette(const CollisionBox& box){
+    CollisionSilhouette silhouette;
+    silhouette.box = box;
+    for(int row = 0; row < SILHOUETTE_SIZE; ++row){
+        silhouette.rows[row] = 0;
+    }
+    return silhouette;
+}
+
+void AddSilhouetteTriangles(CollisionSilhouette& silhouette, const float* corners, size_t triangleCount){
+    const CollisionBox& box = silhouette.box;
+    if(box.minX > box.maxX || box.minY > box.maxY || !FitsSilhouette(box)){
+        return;
+    }
+    const int units = (int)GAME_UNITS_PER_WORLD_UNIT;
+    for(size_t t = 0; t < triangleCount; ++t){
+        // Corners in game units, Q16.16
+        int64_t x[3], y[3];
+        for(int corner = 0; corner < 3; ++corner){
+            x[corner] = FixedScale(FixedFromFloat(corners[t * 6 + corner * 2]), units);
+            y[corner] = FixedScale(FixedFromFloat(corners[t * 6 + corner * 2 + 1]), units);
+        }
+        // Either winding: the cell is in if no edge has it strictly outside
+        int64_t area = (x[1] - x[0]) * (y[2] - y[0]) - (y[1] - y[0]) * (x[2] - x[0]);
+        if(area == 0){
+            continue;
+        }
+        int64_t sign = (area > 0) ? 1 : -1;
+        int minX = std::max(box.minX, FixedCeil(std::min(x[0], std::min(x[1], x[2]))));
+        int maxX = std::min(box.maxX, FixedFloor(std::max(x[0], std::max(x[1], x[2]))));
+        int minY = std::max(box.minY, FixedCeil(std::min(y[0], std::min(y[1], y[2]))));
+        int maxY = std::min(box.maxY, FixedFloor(std::max(y[0], std::max(y[1], y[2]))));
+        for(int py = minY; py <= maxY; ++py){
+            for(int px = minX; px <= maxX; ++px){
+                const int64_t fx = (int64_t)px << FIXED_SHIFT;
+                const int64_t fy = (int64_t)py << FIXED_SHIFT;
+                bool inside = true;
+                for(int edge = 0; edge < 3 && inside; ++edge){
+                    int next = (edge + 1) % 3;
+                    int64_t side = (x[next] - x[edge]) * (fy - y[edge]) - (y[next] - y[edge]) * (fx - x[edge]);
+                    inside = side * sign >= 0;
+                }
+                if(inside){
+                    silhouette.rows[py - box.minY] |= (uint64_t)1 << (px - box.minX);
+                }
+            }
+        }
+    }
+}
+
+bool SilhouettesOverlap(const CollisionSilhouette& a, const CollisionSilhouette& b, int x, int y){
+    // Bit i of a row of b lines up with bit i + shift of a's
+    const int shift = x + b.box.minX - a.box.minX;
+    if(shift <= -SILHOUETTE_SIZE || shift >= SILHOUETTE_SIZE){
+        return false;
+    }
+    // Rows of a that b's rows reach
+    const int first = std::max(0, y + b.box.minY - a.box.minY);
+    const int last = std::min(a.box.maxY - a.box.minY, y + b.box.maxY - a.box.minY);
+    for(int row = first; row <= last; ++row){
+        uint64_t other = b.rows[row + a.box.minY - y - b.box.minY];
+        other = (shift >= 0) ? (other << shift) : (other >> -shift);
+        if(a.rows[row] & other){
+            return true;
+        }
+    }
+    return false;
+}
+
+bool SweptHit(const CollisionRules& rules, int x0, int y0, int x1, int y1){
+    if(!SegmentInRange(rules.hitRange, x0, y0, x1, y1)){
+        return false;
+    }
+    if(!rules.silhouettes){
+        return true;
+    }
+    // Every game unit along the longer axis, so no cell is stepped over
+    // along it; the boxes need not overlap at every one
+    const int dx = x1 - x0;
+    const int dy = y1 - y0;
+    const int steps = std::max(std::abs(dx), std::abs(dy));
+    for(int k = 0; k <= steps; ++k){
+        // Divisions of non-negative numbers, which round the same everywhere
+        int x = x0;
+        int y = y0;
+        if(steps > 0){
+            x += (dx >= 0) ? (dx * k / steps) : -(-dx * k / steps);
+            y += (dy >= 0) ? (dy * k / steps) : -(-dy * k / steps);
+        }
+        if(InRange(rules.hitRange, x, y) &&
+           SilhouettesOverlap(rules.dinoSilhouette, rules.obstacleSilhouette, x, y)){
+            return true;
+        }
+    }
+    return false;
+}
+
+CollisionBox MakeCollisionBox(const AABB& bounds, float inset){
+    CollisionBox box = {0, -1, 0, -1};
+    if(bounds.IsEmpty()){
+        return box;
+    }
+    // The floats become fixed point once and the rest is integer math,
+    // so every platform rounds the box the same way (see FixedPoint.hpp)
+    const Fixed fixedInset = FixedFromFloat(inset);
+    const int units = (int)GAME_UNITS_PER_WORLD_UNIT;
+    Fixed low[2], high[2];
+    for(int axis = 0; axis < 2; ++axis){
+        Fixed min = FixedFromFloat(bounds.min[axis]);
+        Fixed max = FixedFromFloat(bounds.max[axis]);
+        Fixed trim = FixedMul(max - min, fixedInset);
+        low[axis] = min + trim;
+        high[axis] = max - trim;
+    }
+    box.minX = FixedCeil(FixedScale(low[0], units));
+    box.maxX = FixedFloor(FixedScale(high[0], units));
+    box.minY = FixedCeil(FixedScale(low[1], units));
+    box.maxY = FixedFloor(FixedScale(high[1], units));
+    return box;
+}
+
+// Narrows [enter, exit], times along the segment as fractions of it kept
+// as numerator/denominator pairs, to when p0 + (p1 - p0)*t lies in
+// [low, high]. False once the interval is empty.
+static bool ClipAxis(int low, int high, int p0, int p1,
+                     int64_t& enterNum, int64_t& enterDen, int64_t& exitNum, int64_t& exitDen){
+    int64_t delta = (int64_t)p1 - p0;
+    if(delta == 0){
+        return low <= p0 && p0 <= high;
+    }
+    // Times at which the axis reaches each bound, with a positive denominator
+    int64_t nearNum = (delta > 0) ? (int64_t)low - p0 : (int64_t)p0 - high;
+    int64_t farNum = (delta > 0) ? (int64_t)high - p0 : (int64_t)p0 - low;
+    int64_t den = (delta > 0) ? delta : -delta;
+    // a/b > c/d with positive denominators is a*d > c*b
+    if(nearNum * enterDen > enterNum * den){
+        enterNum = nearNum;
+        enterDen = den;
+    }
+    if(farNum * exitDen < exitNum * den){
+        exitNum = farNum;
+        exitDen = den;
+    }
+    return enterNum * exitDen <= exitNum * enterDen;
+}
+
+bool SegmentInRange(const CollisionBox& range, int x0, int y0, int x1, int y1){
+    // Liang-Barsky clipping of the segment against the range
+    int64_t enterNum = 0, enterDen = 1;
+    int64_t exitNum = 1, exitDen = 1;
+    return ClipAxis(range.minX, range.maxX, x0, x1, enterNum, enterDen, exitNum, exitDen) &&
+           ClipAxis(range.minY, range.maxY, y0, y1, enterNum, enterDen, exitNum, exitDen);
+}
+
+// Lanes of obstacle positions within the range, as a mask
+template<typename Lanes>
+static typename Lanes::V InRangeMask(typename Lanes::V obstacleX, typename Lanes::V obstacleY,
+                                     const CollisionBox& range){
+    typedef Lanes L;
+    typename Lanes::V outside = L::Or(L::Gt(L::Set(range.minX), obstacleX), L::Gt(obstacleX, L::Set(range.maxX)));
+    outside = L::Or(outside, L::Or(L::Gt(L::Set(range.minY), obstacleY), L::Gt(obstacleY, L::Set(range.maxY))));
+    return L::AndNot(outside, L::Set(~0));
+}
+
+size_t FindFirstOverlap(const CollisionBox& box, int x, int y,
+                        const CollisionBox& obstacleBox, const int* obstacleX, const int* obstacleY,
+                        size_t count){
+    // Absolute obstacle positions that overlap the box where it is
+    CollisionBox range = OverlapRange(box, obstacleBox);
+    range.minX += x;
+    range.maxX += x;
+    range.minY += y;
+    range.maxY += y;
+
+    size_t i = 0;
+    for(; i + VectorLanes::WIDTH <= count; i += VectorLanes::WIDTH){
+        VectorLanes::V hit = InRangeMask<VectorLanes>(VectorLanes::Load(obstacleX + i),
+                                                      VectorLanes::Load(obstacleY + i), range);
+        if(VectorLanes::Any(hit)){
+            // Rare: find which lane it was
+            int hits[VectorLanes::WIDTH];
+            VectorLanes::Store(hits, hit);
+            for(size_t lane = 0; lane < VectorLanes::WIDTH; ++lane){
+                if(hits[lane]){
+                    return i + lane;
+                }
+            }
+        }
+    }
+    for(; i < count; ++i){
+        if(InRangeMask<ScalarLanes>(obstacleX[i], obstacleY[i], range)){
+            return i;
+        }
+    }
+    return count;
+}
@@ -0,0 +1,139 @@
+#include "CommandBuffer.hpp"
+#include "DrawBatch.hpp"
+#include "GLStateCache.hpp"
+#include "GPUProfiler.hpp"
+
+#include <algorithm>
+
+// Constructor
+CommandBuffer::CommandBuffer(){
+
+}
+
+// Destructor
+CommandBuffer::~CommandBuffer(){
+
+}
+
+void CommandBuffer::Reserve(size_t count){
+    m_commands.reserve(count);
+}
+
+void CommandBuffer::Clear(){
+    m_commands.clear();
+}
+
+void CommandBuffer::UseProgram(GLuint program){
+    Add(RENDER_COMMAND_USE_PROGRAM).program.program = program;
+}
+
+void CommandBuffer::BindUniformBlock(GLuint binding, GLuint buffer, size_t offset, size_t size){
+    RenderCommand& command = Add(RENDER_COMMAND_BIND_UNIFORM_BLOCK);
+    command.block.binding = binding;
+    command.block.buffer = buffer;
+    command.block.offset = (uint32_t)offset;
+    command.block.size = (uint32_t)size;
+}
+
+void CommandBuffer::SetUniform(GLint location, const GLfloat* value, int count){
+    RenderCommand& command = Add(RENDER_COMMAND_SET_UNIFORM);
+    command.uniform.location = location;
+    command.uniform.count = std::min(std::max(count, 1), 4);
+    for(int i = 0; i < 4; ++i){
+        command.uniform.value[i] = (i < command.uniform.count) ? value[i] : 0.0f;
+    }
+}
+
+void CommandBuffer::SetCapability(GLenum capability, bool enabled){
+    RenderCommand& command = Add(RENDER_COMMAND_SET_CAPABILITY);
+    command.capability.capability = capability;
+    command.capability.enabled = enabled ? GL_TRUE : GL_FALSE;
+}
+
+void CommandBuffer::BlendFunc(GLenum source, GLenum destination){
+    RenderCommand& command = Add(RENDER_COMMAND_BLEND_FUNC);
+    command.blend.source = source;
+    command.blend.destination = destination;
+}
+
+void CommandBuffer::DepthMask(bool write){
+    Add(RENDER_COMMAND_DEPTH_MASK).depth.write = write ? GL_TRUE : GL_FALSE;
+}
+
+void CommandBuffer::DrawBatchCommands(DrawBatch& batch, size_t first, size_t count){
+    if(count == 0){
+        return;
+    }
+    RenderCommand& command = Add(RENDER_COMMAND_DRAW_BATCH);
+    command.draw.batch = &batch;
+    command.draw.first = (uint32_t)first;
+    command.draw.count = (uint32_t)count;
+}
+
+void CommandBuffer::BeginPass(int pass){
+    Add(RENDER_COMMAND_BEGIN_PASS).pass.pass = pass;
+}
+
+void CommandBuffer::EndPass(int pass){
+    Add(RENDER_COMMAND_END_PASS).pass.pass = pass;
+}
+
+void CommandBuffer::Call(RenderCallFunction function, void* data){
+    RenderCommand& command = Add(RENDER_COMMAND_CALL);
+    command.call.function = function;
+    command.call.data = data;
+}
+
+void CommandBuffer::Append(const CommandBuffer& other){
+    m_commands.insert(m_commands.end(), other.m_commands.begin(), other.m_commands.end());
+}
+
+void CommandBuffer::Execute(GPUProfiler* profiler) const{
+    GLStateCache& state = GLStateCache::Get();
+    for(const RenderCommand& command : m_commands){
+        switch(command.type){
+        case RENDER_COMMAND_USE_PROGRAM:
+            state.UseProgram(command.program.program);
+            break;
+        case RENDER_COMMAND_BIND_UNIFORM_BLOCK:
+            glBindBufferRange(GL_UNIFORM_BUFFER, command.block.binding, command.block.buffer,
+                              (GLintptr)command.block.offset, (GLsizeiptr)command.block.size);
+            break;
+        case RENDER_COMMAND_SET_UNIFORM:{
+            const GLfloat* value = command.uniform.value;
+            switch(command.uniform.count){
+            case 1: glUniform1f(command.uniform.location, value[0]); break;
+            case 2: glUniform2f(command.uniform.location, value[0], value[1]); break;
+            case 3: glUniform3f(command.uniform.location, value[0], value[1], value[2]); break;
+            default: glUniform4f(command.uniform.location, value[0], value[1], value[2], value[3]); break;
+            }
+            break;
+        }
+        case RENDER_COMMAND_SET_CAPABILITY:
+            state.SetEnabled(command.capability.capability, command.capability.enabled == GL_TRUE);
+            break;
+        case RENDER_COMMAND_BLEND_FUNC:
+            glBlendFunc(command.blend.source, command.blend.destination);
+            break;
+        case RENDER_COMMAND_DEPTH_MASK:
+            glDepthMask(command.depth.write);
+            break;
+        case RENDER_COMMAND_DRAW_BATCH:
+            command.draw.batch->DrawCommands(command.draw.first, command.draw.count);
+            break;
+        case RENDER_COMMAND_BEGIN_PASS:
+            if(profiler != nullptr){
+                profiler->BeginPass(command.pass.pass);
+            }
+            break;
+        case RENDER_COMMAND_END_PASS:
+            if(profiler != nullptr){
+                profiler->EndPass(command.pass.pass);
+            }
+            break;
+        case RENDER_COMMAND_CALL:
+            command.call.function(command.call.data);
+            break;
+        }
+    }
+}
@@ -0,0 +1,176 @@
+#include "DrawBatch.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+// Constructor
+DrawBatch::DrawBatch(){
+
+}
+
+// Destructor
+DrawBatch::~DrawBatch(){
+
+}
+
+void DrawBatch::Initialize(size_t maxInstances, size_t maxCommands){
+    // baseInstance is what selects each command's InstanceData, without
+    // GL_ARB_base_instance the field must be zero.
+    m_multiDrawIndirect = GLAD_GL_ARB_multi_draw_indirect && GLAD_GL_ARB_base_instance;
+    m_maxInstances = maxInstances;
+    m_maxCommands = maxCommands;
+    m_commands.reserve(maxCommands);
+    m_sortedCommands.reserve(maxCommands);
+    m_queue.Reserve(maxCommands);
+    m_instances.reserve(maxInstances);
+
+    // Room for both streams plus their alignment
+    size_t regionSize = maxInstances * sizeof(InstanceData)
+                      + maxCommands * sizeof(DrawElementsIndirectCommand)
+                      + sizeof(InstanceData);
+    m_ring.Initialize(regionSize);
+    std::cout << "DrawBatch.cpp: submitting with "
+              << (m_multiDrawIndirect ? "glMultiDrawElementsIndirect" : "glDrawElementsInstancedBaseVertex")
+              << (m_ring.IsPersistent() ? " from a persistent ring buffer" : " from an orphaned ring buffer")
+              << "\n";
+}
+
+void DrawBatch::Begin(){
+    m_commands.clear();
+    m_queue.Begin();
+    m_instances.clear();
+    m_drawCalls = 0;
+}
+
+void DrawBatch::Add(const DrawRange& range, const InstanceData* instances, size_t instanceCount,
+                    uint64_t sortKey){
+    if(instanceCount == 0 || range.indexCount == 0){
+        return;
+    }
+    if(m_commands.size() >= m_maxCommands || m_instances.size() + instanceCount > m_maxInstances){
+        std::cout << "DrawBatch.cpp: batch is full, draw dropped\n";
+        return;
+    }
+    DrawElementsIndirectCommand command;
+    command.count = (GLuint)range.indexCount;
+    command.instanceCount = (GLuint)instanceCount;
+    command.firstIndex = (GLuint)range.firstIndex;
+    command.baseVertex = range.baseVertex;
+    command.baseInstance = (GLuint)m_instances.size();
+    m_queue.Add(sortKey, (uint32_t)m_commands.size());
+    m_commands.push_back(command);
+    m_sorted = false;
+    m_instances.insert(m_instances.end(), instances, instances + instanceCount);
+}
+
+void DrawBatch::Submit(MeshRegistry& registry, MeshHandle mesh){
+    if(Upload(registry, mesh)){
+        DrawCommands(0, m_commands.size());
+    }
+    Finish();
+}
+
+bool DrawBatch::Upload(MeshRegistry& registry, MeshHandle mesh){
+    m_uploaded = false;
+    if(m_commands.empty()){
+        return false;
+    }
+    // Every command keeps its baseInstance, so only the commands move.
+    // Once is enough however often the batch is uploaded.
+    if(!m_sorted){
+        m_queue.Sort();
+        m_sortedCommands.clear();
+        for(const RenderItem& item : m_queue.GetItems()){
+            m_sortedCommands.push_back(m_commands[item.index]);
+        }
+        m_commands.swap(m_sortedCommands);
+        m_sorted = true;
+    }
+    m_ring.BeginRegion();
+    m_instanceOffset = m_ring.Write(m_instances.data(), m_instances.size() * sizeof(InstanceData));
+    m_commandOffset = 0;
+    if(m_multiDrawIndirect){
+        m_commandOffset = m_ring.Write(m_commands.data(), m_commands.size() * sizeof(DrawElementsIndirectCommand));
+    }
+    if(m_instanceOffset == RING_BUFFER_FULL || m_commandOffset == RING_BUFFER_FULL){
+        std::cout << "DrawBatch.cpp: ring buffer region is too small\n";
+        m_ring.EndRegion();
+        return false;
+    }
+    m_registry = &registry;
+    m_mesh = mesh;
+    m_uploaded = true;
+    return true;
+}
+
+void DrawBatch::DrawCommands(size_t first, size_t count){
+    if(!m_uploaded || first >= m_commands.size()){
+        return;
+    }
+    if(count > m_commands.size() - first){
+        count = m_commands.size() - first;
+    }
+    if(count == 0){
+        return;
+    }
+    m_registry->Bind(m_mesh);
+    GLenum indexType = m_registry->GetIndexType(m_mesh);
+
+    if(m_multiDrawIndirect){
+        m_registry->BindInstanceBuffer(m_mesh, m_ring.GetBuffer(), m_instanceOffset);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_ring.GetBuffer());
+        glMultiDrawElementsIndirect(GL_TRIANGLES, indexType,
+                                    (void*)(m_commandOffset + first * sizeof(DrawElementsIndirectCommand)),
+                                    (GLsizei)count, sizeof(DrawElementsIndirectCommand));
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        ++m_drawCalls;
+        return;
+    }
+
+    // Fallback: point the instance attributes at each command's instances
+    size_t indexSize = (indexType == GL_UNSIGNED_SHORT) ? sizeof(uint16_t) : sizeof(uint32_t);
+    for(size_t i = first; i < first + count; ++i){
+        const DrawElementsIndirectCommand& command = m_commands[i];
+        m_registry->BindInstanceBuffer(m_mesh, m_ring.GetBuffer(),
+                                       m_instanceOffset + command.baseInstance * sizeof(InstanceData));
+        glDrawElementsInstancedBaseVertex(GL_TRIANGLES,
+                                          (GLsizei)command.count,
+                                          indexType,
+                                          (void*)(command.firstIndex * indexSize),
+                                          (GLsizei)command.instanceCount,
+                                          command.baseVertex);
+    }
+    m_drawCalls += count;
+}
+
+bool DrawBatch::DrawCommandsFrom(GLuint instanceBuffer, GLuint commandBuffer, size_t first, size_t count){
+    if(!m_uploaded || !m_multiDrawIndirect || first >= m_commands.size()){
+        return false;
+    }
+    count = std::min(count, m_commands.size() - first);
+    if(count == 0){
+        return true;
+    }
+    m_registry->Bind(m_mesh);
+    m_registry->BindInstanceBuffer(m_mesh, instanceBuffer, 0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+    glMultiDrawElementsIndirect(GL_TRIANGLES, m_registry->GetIndexType(m_mesh),
+                                (void*)(first * sizeof(DrawElementsIndirectCommand)),
+                                (GLsizei)count, sizeof(DrawElementsIndirectCommand));
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    ++m_drawCalls;
+    return true;
+}
+
+void DrawBatch::Finish(){
+    if(m_uploaded){
+        m_ring.EndRegion();
+        m_uploaded = false;
+    }
+}
+
+void DrawBatch::Release(){
+    m_ring.Release();
+    m_commands.clear();
+    m_instances.clear();
+}
@@ -0,0 +1,135 @@
+#include "DynamicResolution.hpp"
+#include "GLStateCache.hpp"
+#include "GPUResourceTracker.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+// GPU timings arrive this many frames after the frame they time, so the
+// first ones after a change still measure the previous scale
+static const int RESULT_LATENCY_FRAMES = 3;
+// Frames a scale holds before it may change again
+static const int SETTLE_FRAMES = 12;
+// Weight of a new sample in the smoothed GPU time
+static const double SMOOTHING = 0.2;
+// The scale only climbs while frames take less than this share of the
+// budget, so it does not bounce between two steps
+static const double HEADROOM = 0.8;
+
+// Constructor
+DynamicResolution::DynamicResolution(){
+
+}
+
+// Destructor
+DynamicResolution::~DynamicResolution(){
+    if(m_framebuffer != 0){
+        std::cout << "DynamicResolution.cpp: framebuffer was never released\n";
+    }
+}
+
+bool DynamicResolution::Initialize(int width, int height, float minScale, double budgetMilliseconds, float maxScale){
+    Release();
+    if(width <= 0 || height <= 0){
+        std::cout << "DynamicResolution.cpp: invalid size " << width << "x" << height << "\n";
+        return false;
+    }
+    m_width = width;
+    m_height = height;
+    m_maxScale = std::min(1.0f, std::max(SCALE_STEP, maxScale));
+    m_minScale = std::min(m_maxScale, std::max(SCALE_STEP, minScale));
+    m_budget = budgetMilliseconds;
+
+    glGenRenderbuffers(1, &m_colorBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_colorBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    GPUResourceTracker::Get().Created(GPU_RENDERBUFFER, m_colorBuffer, "scaled scene color", (size_t)width * height * 4);
+    glGenRenderbuffers(1, &m_depthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_depthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    GPUResourceTracker::Get().Created(GPU_RENDERBUFFER, m_depthBuffer, "scaled scene depth", (size_t)width * height * 4);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &m_framebuffer);
+    GPUResourceTracker::Get().Created(GPU_FRAMEBUFFER, m_framebuffer, "scaled scene framebuffer");
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_colorBuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_depthBuffer);
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if(status != GL_FRAMEBUFFER_COMPLETE){
+        std::cout << "DynamicResolution.cpp: framebuffer incomplete (0x" << std::hex << status << std::dec << ")\n";
+        Release();
+        return false;
+    }
+
+    SetScale(m_maxScale);
+    return true;
+}
+
+void DynamicResolution::SetScale(float scale){
+    m_scale = scale;
+    m_renderWidth = std::max(1, (int)std::lround(m_width * scale));
+    m_renderHeight = std::max(1, (int)std::lround(m_height * scale));
+    m_smoothed = -1.0;
+    m_framesSinceChange = 0;
+}
+
+void DynamicResolution::Update(double gpuMilliseconds){
+    if(m_framebuffer == 0){
+        return;
+    }
+    ++m_framesSinceChange;
+    if(gpuMilliseconds < 0.0 || m_framesSinceChange <= RESULT_LATENCY_FRAMES){
+        return;
+    }
+    m_smoothed = (m_smoothed < 0.0) ? gpuMilliseconds : m_smoothed + (gpuMilliseconds - m_smoothed) * SMOOTHING;
+    if(m_framesSinceChange < SETTLE_FRAMES){
+        return;
+    }
+
+    float scale = m_scale;
+    if(m_smoothed > m_budget){
+        // The scene's cost goes with its area, so with the square of the scale
+        scale = m_scale * (float)std::sqrt(m_budget / m_smoothed);
+        scale = std::floor(scale / SCALE_STEP) * SCALE_STEP;
+    }else if(m_smoothed < m_budget * HEADROOM){
+        scale = std::round(m_scale / SCALE_STEP) * SCALE_STEP + SCALE_STEP;
+    }
+    scale = std::min(m_maxScale, std::max(m_minScale, scale));
+    if(std::fabs(scale - m_scale) >= SCALE_STEP * 0.5f){
+        SetScale(scale);
+    }
+}
+
+void DynamicResolution::Bind() const{
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+    GLStateCache::Get().Viewport(0, 0, m_renderWidth, m_renderHeight);
+}
+
+void DynamicResolution::BlitToWindow() const{
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_framebuffer);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    glBlitFramebuffer(0, 0, m_renderWidth, m_renderHeight, 0, 0, m_width, m_height,
+                      GL_COLOR_BUFFER_BIT, GL_LINEAR);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void DynamicResolution::Release(){
+    if(m_framebuffer != 0){
+        glDeleteFramebuffers(1, &m_framebuffer);
+        GPUResourceTracker::Get().Deleted(GPU_FRAMEBUFFER, m_framebuffer);
+        m_framebuffer = 0;
+    }
+    if(m_colorBuffer != 0){
+        glDeleteRenderbuffers(1, &m_colorBuffer);
+        GPUResourceTracker::Get().Deleted(GPU_RENDERBUFFER, m_colorBuffer);
+        m_colorBuffer = 0;
+    }
+    if(m_depthBuffer != 0){
+        glDeleteRenderbuffers(1, &m_depthBuffer);
+        GPUResourceTracker::Get().Deleted(GPU_RENDERBUFFER, m_depthBuffer);
+        m_depthBuffer = 0;
+    }
+}
@@ -0,0 +1,163 @@
+#include "EnergyMeter.hpp"
+
+#if defined(LINUX) || defined(__linux__)
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <filesystem>
+    #include <fstream>
+#endif
+
+#include <algorithm>
+#include <cstdlib>
+#include <sstream>
+
+#if defined(LINUX) || defined(__linux__)
+// The first line of a small sysfs file, empty if it cannot be read
+static std::string ReadLine(const std::string& path){
+    std::ifstream file(path.c_str());
+    std::string line;
+    std::getline(file, line);
+    return line;
+}
+
+// The directories in directory whose names start with prefix, sorted
+static std::vector<std::string> ListDirectories(const std::string& directory, const std::string& prefix){
+    std::vector<std::string> paths;
+    std::error_code error;
+    for(std::filesystem::directory_iterator it(directory, error), end; !error && it != end; it.increment(error)){
+        std::string name = it->path().filename().string();
+        if(name.compare(0, prefix.size(), prefix) == 0){
+            paths.push_back(it->path().string());
+        }
+    }
+    std::sort(paths.begin(), paths.end());
+    return paths;
+}
+#endif
+
+// Constructor
+EnergyMeter::EnergyMeter(){
+
+}
+
+// Destructor
+EnergyMeter::~EnergyMeter(){
+    Close();
+}
+
+bool EnergyMeter::Open(){
+    Close();
+#if defined(LINUX) || defined(__linux__)
+    // Packages only: their subzones (core, uncore, dram) are parts of
+    // them, and psys covers the packages as well
+    for(const std::string& zone : ListDirectories("/sys/class/powercap", "intel-rapl:")){
+        std::string name = std::filesystem::path(zone).filename().string();
+        if(name.find(':') != name.rfind(':') || ReadLine(zone + "/name").compare(0, 7, "package") != 0){
+            continue;
+        }
+        uint64_t range = strtoull(ReadLine(zone + "/max_energy_range_uj").c_str(), nullptr, 10);
+        AddCounter(zone + "/energy_uj", COUNTER_ENERGY, false, range);
+    }
+    for(const std::string& card : ListDirectories("/sys/class/drm", "card")){
+        // card0-DP-1 and the like are connectors of card0
+        if(std::filesystem::path(card).filename().string().find('-') != std::string::npos){
+            continue;
+        }
+        for(const std::string& hwmon : ListDirectories(card + "/device/hwmon", "hwmon")){
+            if(!AddCounter(hwmon + "/energy1_input", COUNTER_ENERGY, true, 0) &&
+               !AddCounter(hwmon + "/power1_average", COUNTER_POWER, true, 0)){
+                AddCounter(hwmon + "/power1_input", COUNTER_POWER, true, 0);
+            }
+        }
+    }
+#endif
+    m_lastSample = std::chrono::steady_clock::now();
+    return IsOpen();
+}
+
+void EnergyMeter::Close(){
+#if defined(LINUX) || defined(__linux__)
+    for(Counter& counter : m_counters){
+        close(counter.file);
+    }
+#endif
+    m_counters.clear();
+}
+
+bool EnergyMeter::AddCounter(const std::string& path, CounterKind kind, bool gpu, uint64_t range){
+#if defined(LINUX) || defined(__linux__)
+    Counter counter;
+    counter.path = path;
+    counter.kind = kind;
+    counter.gpu = gpu;
+    counter.range = range;
+    // Kept open and read with pread(), a few microseconds a sample
+    counter.file = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if(counter.file < 0){
+        return false;
+    }
+    if(!Read(counter, counter.last)){
+        close(counter.file);
+        return false;
+    }
+    m_counters.push_back(counter);
+    return true;
+#else
+    (void)path;
+    (void)kind;
+    (void)gpu;
+    (void)range;
+    return false;
+#endif
+}
+
+bool EnergyMeter::Read(const Counter& counter, uint64_t& value){
+#if defined(LINUX) || defined(__linux__)
+    char text[32];
+    ssize_t length = pread(counter.file, text, sizeof(text) - 1, 0);
+    if(length <= 0){
+        return false;
+    }
+    text[length] = '\0';
+    char* end = nullptr;
+    value = strtoull(text, &end, 10);
+    return end != text;
+#else
+    (void)counter;
+    (void)value;
+    return false;
+#endif
+}
+
+void EnergyMeter::Sample(double& cpuJoules, double& gpuJoules){
+    cpuJoules = 0.0;
+    gpuJoules = 0.0;
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(now - m_lastSample).count();
+    m_lastSample = now;
+    for(Counter& counter : m_counters){
+        uint64_t value = 0;
+        if(!Read(counter, value)){
+            continue;
+        }
+        double joules = 0.0;
+        if(counter.kind == COUNTER_POWER){
+            joules = (double)value * 1e-6 * seconds;
+        }else{
+            // A counter without a range only goes back if it was reset
+            uint64_t delta = (value >= counter.last) ? value - counter.last
+                           : (counter.range > counter.last) ? value + (counter.range - counter.last) : 0;
+            joules = (double)delta * 1e-6;
+            counter.last = value;
+        }
+        (counter.gpu ? gpuJoules : cpuJoules) += joules;
+    }
+}
+
+std::string EnergyMeter::Describe() const{
+    std::ostringstream text;
+    for(const Counter& counter : m_counters){
+        text << (counter.gpu ? "gpu " : "cpu ") << counter.path << "\n";
+    }
+    return text.str();
+}
@@ -0,0 +1,266 @@
+#include "EntityStore.hpp"
+#include "BatchTransform.hpp"
+#include "JobSystem.hpp"
+#include "TransformHierarchy.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+// Nearest an entity is taken to be, so one around the eye picks level 0
+// instead of dividing by zero
+static const float LOD_MIN_DISTANCE = 0.01f;
+// Rows placed and culled per job; smaller archetypes are culled in one go
+static const size_t CULL_JOB_ROWS = 4096;
+
+// Constructor
+EntityStore::EntityStore(){
+
+}
+
+// Destructor
+EntityStore::~EntityStore(){
+
+}
+
+ArchetypeId EntityStore::CreateArchetype(uint32_t components, size_t capacity){
+    Archetype archetype;
+    archetype.components = components;
+    archetype.capacity = capacity;
+    // Absent components keep empty arrays
+    if(components & COMPONENT_TRANSFORM){
+        archetype.transforms.resize(capacity);
+    }
+    if(components & COMPONENT_RENDERABLE){
+        archetype.renderables.resize(capacity);
+    }
+    if(components & COMPONENT_COLLIDER){
+        archetype.colliders.resize(capacity);
+    }
+    if(components & COMPONENT_SCROLL){
+        archetype.scrolls.resize(capacity);
+    }
+    if(components & COMPONENT_LOD){
+        archetype.lods.resize(capacity);
+    }
+    if(components & COMPONENT_NODE){
+        archetype.nodes.resize(capacity, NO_TRANSFORM_NODE);
+    }
+    m_archetypes.push_back(archetype);
+    return (ArchetypeId)(m_archetypes.size() - 1);
+}
+
+size_t EntityStore::Add(ArchetypeId id){
+    Archetype& archetype = m_archetypes[id];
+    if(archetype.count == archetype.capacity){
+        return archetype.capacity;
+    }
+    size_t row = archetype.count;
+    Resize(id, row + 1);
+    return row;
+}
+
+void EntityStore::Remove(ArchetypeId id, size_t row){
+    Archetype& archetype = m_archetypes[id];
+    if(row >= archetype.count){
+        return;
+    }
+    size_t last = archetype.count - 1;
+    if(archetype.components & COMPONENT_TRANSFORM){
+        archetype.transforms[row] = archetype.transforms[last];
+    }
+    if(archetype.components & COMPONENT_RENDERABLE){
+        archetype.renderables[row] = archetype.renderables[last];
+    }
+    if(archetype.components & COMPONENT_COLLIDER){
+        archetype.colliders[row] = archetype.colliders[last];
+    }
+    if(archetype.components & COMPONENT_SCROLL){
+        archetype.scrolls[row] = archetype.scrolls[last];
+    }
+    if(archetype.components & COMPONENT_LOD){
+        archetype.lods[row] = archetype.lods[last];
+    }
+    if(archetype.components & COMPONENT_NODE){
+        archetype.nodes[row] = archetype.nodes[last];
+    }
+    archetype.count = last;
+}
+
+void EntityStore::Resize(ArchetypeId id, size_t count){
+    Archetype& archetype = m_archetypes[id];
+    if(count > archetype.capacity){
+        count = archetype.capacity;
+    }
+    // Rows coming back into use start from defaults
+    for(size_t row = archetype.count; row < count; ++row){
+        if(archetype.components & COMPONENT_TRANSFORM){
+            archetype.transforms[row] = Transform();
+        }
+        if(archetype.components & COMPONENT_RENDERABLE){
+            archetype.renderables[row] = Renderable();
+        }
+        if(archetype.components & COMPONENT_COLLIDER){
+            archetype.colliders[row] = Collider();
+        }
+        if(archetype.components & COMPONENT_SCROLL){
+            archetype.scrolls[row] = TextureScroll();
+        }
+        if(archetype.components & COMPONENT_LOD){
+            archetype.lods[row] = LodRanges();
+        }
+        if(archetype.components & COMPONENT_NODE){
+            archetype.nodes[row] = NO_TRANSFORM_NODE;
+        }
+    }
+    archetype.count = count;
+}
+
+void EntityStore::UpdateTextureScroll(int tick, float fraction){
+    const uint32_t required = COMPONENT_RENDERABLE | COMPONENT_SCROLL;
+    for(size_t i = 0; i < m_archetypes.size(); ++i){
+        Archetype& archetype = m_archetypes[i];
+        if((archetype.components & required) != required){
+            continue;
+        }
+        for(size_t row = 0; row < archetype.count; ++row){
+            const TextureScroll& scroll = archetype.scrolls[row];
+            // Wrapped in integers so the offset stays precise in long games
+            float wrapped = (float)(tick % scroll.periodTicks) + fraction;
+            archetype.renderables[row].uOffset = -wrapped * scroll.uPerTick;
+        }
+    }
+}
+
+void EntityStore::ApplyHierarchy(ArchetypeId id, const TransformHierarchy& hierarchy){
+    Archetype& archetype = m_archetypes[id];
+    const uint32_t required = COMPONENT_TRANSFORM | COMPONENT_NODE;
+    if((archetype.components & required) != required || hierarchy.GetChangedCount() == 0){
+        return;
+    }
+    for(size_t row = 0; row < archetype.count; ++row){
+        uint32_t node = archetype.nodes[row];
+        if(node < hierarchy.GetCount() && hierarchy.IsChanged(node)){
+            archetype.transforms[row] = hierarchy.GetWorld(node);
+        }
+    }
+}
+
+void EntityStore::SelectLods(ArchetypeId id, const glm::vec3& eye, float pixelsPerUnit, float maxPixelError){
+    Archetype& archetype = m_archetypes[id];
+    const uint32_t required = COMPONENT_TRANSFORM | COMPONENT_RENDERABLE | COMPONENT_LOD;
+    if((archetype.components & required) != required){
+        return;
+    }
+    for(size_t row = 0; row < archetype.count; ++row){
+        LodRanges& lods = archetype.lods[row];
+        if(lods.count == 0){
+            continue;
+        }
+        const Transform& transform = archetype.transforms[row];
+        Renderable& renderable = archetype.renderables[row];
+        glm::vec3 center = glm::vec3(transform.x, transform.y, transform.z)
+                         + glm::vec3(renderable.sphere.center[0], renderable.sphere.center[1], renderable.sphere.center[2]) * transform.scale;
+        float distance = std::max(glm::length(center - eye) - renderable.sphere.radius * transform.scale, LOD_MIN_DISTANCE);
+        // Pixels one model unit covers at the nearest point of the sphere
+        float pixels = pixelsPerUnit * transform.scale / distance;
+        uint32_t level = 0;
+        while(level + 1 < lods.count && lods.errors[level + 1] * pixels <= maxPixelError){
+            ++level;
+        }
+        lods.selected = level;
+        renderable.range = lods.ranges[level];
+    }
+}
+
+// The sort key of a run of draws starting at renderable and transform
+static uint64_t GetDrawSortKey(const DrawSortKeys* keys, const Renderable& renderable, const Transform& transform){
+    if(keys == nullptr){
+        return 0;
+    }
+    glm::vec3 offset = glm::vec3(transform.x, transform.y, transform.z) - keys->eye;
+    // Every mesh of the arena starts at its own vertex; folded to the
+    // field's 16 bits, draws of one mesh still sort together
+    uint32_t mesh = (uint32_t)renderable.range.baseVertex;
+    mesh = (mesh ^ (mesh >> 16)) & 0xFFFFu;
+    // Palette rows are negative layers and all read the one palette
+    // texture, so they share material 0 below every array layer
+    uint32_t material = (renderable.layer < 0.0f) ? 0u : (uint32_t)renderable.layer + 1u;
+    return MakeSortKey(keys->pass, keys->program, material, mesh,
+                       glm::dot(offset, offset), keys->backToFront);
+}
+
+void EntityStore::AppendDraws(ArchetypeId id, DrawBatch& batch, FrameArena& arena, const Frustum* frustum,
+                              const DrawSortKeys* keys){
+    const Archetype& archetype = m_archetypes[id];
+    const uint32_t required = COMPONENT_TRANSFORM | COMPONENT_RENDERABLE;
+    if((archetype.components & required) != required){
+        return;
+    }
+    const uint8_t* inFrustum = nullptr;
+    if(frustum && archetype.count > 0){
+        // Place every sphere, then cull them all in one pass. The columns
+        // are scratch of this frame.
+        float* sphereX = arena.Allocate<float>(archetype.count);
+        float* sphereY = arena.Allocate<float>(archetype.count);
+        float* sphereZ = arena.Allocate<float>(archetype.count);
+        float* sphereRadius = arena.Allocate<float>(archetype.count);
+        uint8_t* culled = arena.Allocate<uint8_t>(archetype.count);
+        // Large archetypes are split over the job threads. The task only
+        // captures this, so it is stored without allocating.
+        struct CullTask{
+            const Archetype& archetype;
+            const Frustum& frustum;
+            float* x;
+            float* y;
+            float* z;
+            float* radius;
+            uint8_t* culled;
+        };
+        const CullTask task = {archetype, *frustum, sphereX, sphereY, sphereZ, sphereRadius, culled};
+        JobSystem::Get().ParallelFor(archetype.count, CULL_JOB_ROWS, [&task](size_t first, size_t last){
+            PlaceSpheres(&task.archetype.transforms[first].x, sizeof(Transform),
+                         task.archetype.renderables[first].sphere.center, sizeof(Renderable), last - first,
+                         task.x + first, task.y + first, task.z + first, task.radius + first);
+            CullSpheres(task.frustum, task.x + first, task.y + first, task.z + first, task.radius + first,
+                        last - first, task.culled + first);
+        });
+        inFrustum = culled;
+    }
+    // Instances of the draw being built; the batch copies them
+    ArenaVector<InstanceData> instances{ArenaAllocator<InstanceData>(arena)};
+    instances.reserve(archetype.count);
+    const bool hasLods = (archetype.components & COMPONENT_LOD) != 0;
+    const uint32_t levels = hasLods ? MAX_MESH_LODS : 1;
+    for(uint32_t level = 0; level < levels; ++level){
+        const Renderable* runStart = nullptr;
+        uint64_t runKey = 0;
+        for(size_t row = 0; row < archetype.count; ++row){
+            const Renderable& renderable = archetype.renderables[row];
+            if(!renderable.visible || (inFrustum && !inFrustum[row]) ||
+               (hasLods && archetype.lods[row].selected != level)){
+                continue;
+            }
+            // A different range ends the run
+            if(runStart && (renderable.range.firstIndex != runStart->range.firstIndex ||
+                            renderable.range.indexCount != runStart->range.indexCount ||
+                            renderable.range.baseVertex != runStart->range.baseVertex)){
+                batch.Add(runStart->range, instances.data(), instances.size(), runKey);
+                instances.clear();
+            }
+            const Transform& transform = archetype.transforms[row];
+            if(instances.empty()){
+                runStart = &renderable;
+                runKey = GetDrawSortKey(keys, renderable, transform);
+            }
+            InstanceData instance = {transform.x, transform.y, transform.z, transform.scale,
+                                     renderable.palette, renderable.uOffset, renderable.layer,
+                                     renderable.nightLayer, renderable.jumpStart, renderable.jumpSpeed,
+                                     renderable.bobHeight, renderable.squash};
+            instances.push_back(instance);
+        }
+        if(!instances.empty()){
+            batch.Add(runStart->range, instances.data(), instances.size(), runKey);
+            instances.clear();
+        }
+    }
+}
@@ -0,0 +1,179 @@
+#include "EnvironmentPool.hpp"
+#include "Telemetry.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+static const char CHECKPOINT_MAGIC[4] = {'D', 'E', 'N', 'V'};
+static const uint32_t CHECKPOINT_VERSION = 1;
+
+// Constructor
+EnvironmentPool::EnvironmentPool(unsigned int threadCount, const AffinityConfig& affinity)
+    : m_pool(threadCount, affinity){
+
+}
+
+// Destructor
+EnvironmentPool::~EnvironmentPool(){
+
+}
+
+void EnvironmentPool::Resize(size_t count, size_t shardSize){
+    if(shardSize == 0){
+        shardSize = 1024;
+    }
+    m_count = count;
+    m_shardSize = shardSize;
+    m_shards.resize((count + shardSize - 1) / shardSize);
+    PlaceShards();
+}
+
+void EnvironmentPool::PlaceShards(){
+    m_shardNodes.assign(m_shards.size(), -1);
+    ForEachShard([this](size_t shard){
+        // The copy's columns are allocated and filled on this thread,
+        // so first touch puts them on its node
+        GameStateBatch placed(m_shards[shard]);
+        placed.Resize(std::min(m_shardSize, m_count - shard * m_shardSize));
+        m_shards[shard] = std::move(placed);
+        m_shardNodes[shard] = GetCurrentNumaNode();
+    });
+}
+
+void EnvironmentPool::ForEachShard(const std::function<void(size_t)>& task){
+    m_pool.Run(m_shards.size(), task, false);
+}
+
+void EnvironmentPool::ResetAll(uint64_t seed){
+    for(size_t shard = 0; shard < m_shards.size(); ++shard){
+        GameStateBatch& batch = m_shards[shard];
+        for(size_t lane = 0; lane < batch.GetCount(); ++lane){
+            batch.Reset(lane, seed, shard * m_shardSize + lane);
+        }
+    }
+}
+
+void EnvironmentPool::Reset(size_t index, uint64_t seed, uint64_t stream){
+    m_shards[index / m_shardSize].Reset(index % m_shardSize, seed, stream);
+}
+
+void EnvironmentPool::SetSpawnScript(uint16_t script){
+    for(GameStateBatch& batch : m_shards){
+        for(size_t lane = 0; lane < batch.GetCount(); ++lane){
+            batch.SetSpawnScript(lane, script);
+        }
+    }
+}
+
+GameState EnvironmentPool::Get(size_t index) const{
+    return m_shards[index / m_shardSize].Get(index % m_shardSize);
+}
+
+void EnvironmentPool::Set(size_t index, const GameState& state){
+    m_shards[index / m_shardSize].Set(index % m_shardSize, state);
+}
+
+void EnvironmentPool::StepAll(const GameAction* actions, int ticks){
+    m_pool.Run(m_shards.size(), [this, actions, ticks](size_t shard){
+        GameStateBatch& batch = m_shards[shard];
+        size_t running = batch.CountRunning();
+        batch.Step(actions + shard * m_shardSize, ticks);
+        Telemetry::Get().AddSteps(running);
+        RecordNode(shard, running);
+        RecordEpisodes(shard);
+    });
+}
+
+void EnvironmentPool::StepAllRepeated(const GameAction* actions, int repeat, int ticks){
+    m_pool.Run(m_shards.size(), [this, actions, repeat, ticks](size_t shard){
+        size_t taken = m_shards[shard].StepRepeated(actions + shard * m_shardSize, repeat, ticks);
+        Telemetry::Get().AddSteps(taken);
+        RecordNode(shard, taken);
+        RecordEpisodes(shard);
+    });
+}
+
+void EnvironmentPool::RecordNode(size_t shard, size_t steps){
+    int node = m_shardNodes[shard];
+    if(node >= 0 && steps > 0 && GetCurrentNumaNode() != node){
+        Telemetry::Get().AddRemoteSteps(steps);
+    }
+}
+
+void EnvironmentPool::RecordEpisodes(size_t shard){
+    const GameStateBatch& batch = m_shards[shard];
+    const int* events = batch.GetEvents();
+    Telemetry& telemetry = Telemetry::Get();
+    for(size_t lane = 0; lane < batch.GetCount(); ++lane){
+        if(events[lane] & EVENT_GAME_OVER){
+            // Rare enough to copy the state out
+            GameState state = batch.Get(lane);
+            telemetry.AddEpisode(state.tick, GetLeadFormation(state.obstacles, state.scroll));
+        }
+    }
+}
+
+bool EnvironmentPool::SaveCheckpoint(const std::string& filepath, uint64_t tag) const{
+    std::string temporary = filepath + ".tmp";
+    {
+        std::ofstream file(temporary.c_str(), std::ios::binary | std::ios::trunc);
+        if(!file.is_open()){
+            std::cout << "EnvironmentPool.cpp: could not write " << temporary << "\n";
+            return false;
+        }
+        uint32_t version = CHECKPOINT_VERSION;
+        uint64_t header[3] = {m_count, m_shardSize, tag};
+        file.write(CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+        file.write((const char*)&version, sizeof(version));
+        file.write((const char*)header, sizeof(header));
+        for(const GameStateBatch& batch : m_shards){
+            batch.Save(file);
+        }
+        file.flush();
+        if(!file.good()){
+            std::cout << "EnvironmentPool.cpp: could not write " << temporary << "\n";
+            return false;
+        }
+    }
+    if(std::rename(temporary.c_str(), filepath.c_str()) != 0){
+        std::cout << "EnvironmentPool.cpp: could not replace " << filepath << "\n";
+        return false;
+    }
+    return true;
+}
+
+bool EnvironmentPool::LoadCheckpoint(const std::string& filepath, uint64_t& tag){
+    std::ifstream file(filepath.c_str(), std::ios::binary);
+    if(!file.is_open()){
+        std::cout << "EnvironmentPool.cpp: could not open " << filepath << "\n";
+        return false;
+    }
+    char magic[4];
+    uint32_t version = 0;
+    uint64_t header[3] = {};
+    if(!file.read(magic, sizeof(magic)) || std::memcmp(magic, CHECKPOINT_MAGIC, sizeof(magic)) != 0 ||
+       !file.read((char*)&version, sizeof(version)) || version != CHECKPOINT_VERSION ||
+       !file.read((char*)header, sizeof(header)) || header[1] == 0){
+        std::cout << "EnvironmentPool.cpp: " << filepath << " is not an environment checkpoint\n";
+        return false;
+    }
+    size_t count = (size_t)header[0];
+    size_t shardSize = (size_t)header[1];
+    std::vector<GameStateBatch> shards((count + shardSize - 1) / shardSize);
+    for(size_t shard = 0; shard < shards.size(); ++shard){
+        if(!shards[shard].Load(file) || shards[shard].GetCount() != std::min(shardSize, count - shard * shardSize)){
+            std::cout << "EnvironmentPool.cpp: " << filepath << " is truncated or corrupt\n";
+            return false;
+        }
+    }
+    m_shards.swap(shards);
+    m_count = count;
+    m_shardSize = shardSize;
+    // Read on this thread, so moved to their owners' nodes
+    PlaceShards();
+    tag = header[2];
+    return true;
+}
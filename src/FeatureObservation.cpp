@@ -0,0 +1,38 @@
+#include "FeatureObservation.hpp"
+#include "Collision.hpp"
+
+#include <cstdint>
+
+// Ticks per second of play, which speeds are given in
+static const float FEATURE_TICKS_PER_SECOND = 60.0f;
+
+void WriteFeatureObservation(const GameState& state, size_t obstacleCount, float* row){
+    const float heightScale = 1.0f / (float)JUMP_APEX;
+    const float distanceScale = 1.0f / (float)OBSTACLE_SPAWN_X;
+    float height = (float)state.dinoHeight * heightScale;
+
+    // What the next tick does to the height, as Step() moves it
+    float velocity = 0.0f;
+    float phase = 0.0f;
+    if(state.isJumping){
+        velocity = (float)(state.jumpingUp ? state.jumpingSpeed : -state.jumpingSpeed) * heightScale * FEATURE_TICKS_PER_SECOND;
+        phase = state.jumpingUp ? 0.5f * height : 1.0f - 0.5f * height;
+    }
+    row[FEATURE_DINO_HEIGHT] = height;
+    row[FEATURE_DINO_VELOCITY] = velocity;
+    row[FEATURE_JUMP_PHASE] = phase;
+    row[FEATURE_OBSTACLE_SPEED] = (float)state.cactusSpeed * distanceScale * FEATURE_TICKS_PER_SECOND;
+    row[FEATURE_TIME_OF_DAY] = (float)(state.dayTick + (state.isDaytime ? 0 : DAY_LENGTH)) / (float)(2 * DAY_LENGTH);
+
+    // The obstacles that have not yet passed the dino's hit box, the
+    // first being GetLeadObstacle()
+    LaneWindow ahead = FindLaneWindow(state.obstacles, GetCollisionRules().hitRange.minX + state.scroll, INT32_MAX);
+    for(size_t i = 0; i < obstacleCount; ++i){
+        float distance = FEATURE_NO_OBSTACLE;
+        if(i < ahead.count){
+            uint32_t slot = GetLaneSlot(state.obstacles, ahead.first + (uint32_t)i);
+            distance = (float)(state.obstacles.x[slot] - state.scroll) * distanceScale;
+        }
+        row[FEATURE_OBSTACLES + i] = distance;
+    }
+}
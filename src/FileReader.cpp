@@ -0,0 +1,628 @@
+#include "FileReader.hpp"
+#include "AssetPack.hpp"
+#include "FileView.hpp"
+#include "MemoryTags.hpp"
+
+#if defined(MINGW) || defined(_WIN32)
+    #include <cstdio>
+    #include <filesystem>
+#else
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+#if defined(__linux__) && defined(__has_include)
+    #if __has_include(<linux/io_uring.h>)
+        #include <linux/io_uring.h>
+        #include <sys/eventfd.h>
+        #include <sys/mman.h>
+        #include <sys/syscall.h>
+        #include <sys/uio.h>
+        #if defined(__NR_io_uring_setup) && defined(IORING_FEAT_FAST_POLL)
+            #define FILEREADER_IO_URING 1
+        #endif
+    #endif
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+// O_DIRECT wants buffers, offsets and lengths on this boundary
+static const size_t DIRECT_ALIGNMENT = 4096;
+
+static size_t AlignUp(size_t bytes){
+    return (bytes + DIRECT_ALIGNMENT - 1) / DIRECT_ALIGNMENT * DIRECT_ALIGNMENT;
+}
+
+static char* AllocateAligned(size_t bytes){
+#if defined(MINGW) || defined(_WIN32)
+    return new char[bytes];
+#else
+    void* memory = nullptr;
+    if(posix_memalign(&memory, DIRECT_ALIGNMENT, bytes) != 0){
+        return nullptr;
+    }
+    return (char*)memory;
+#endif
+}
+
+static void FreeAligned(char* memory){
+#if defined(MINGW) || defined(_WIN32)
+    delete[] memory;
+#else
+    free(memory);
+#endif
+}
+
+FileReader& FileReader::Get(){
+    static FileReader reader;
+    return reader;
+}
+
+// Constructor
+FileReader::FileReader(){
+
+}
+
+// Destructor
+FileReader::~FileReader(){
+    Stop();
+}
+
+bool FileReader::Start(const FileReaderConfig& config){
+    if(m_started){
+        return UsesIoUring();
+    }
+    m_config = config;
+    m_config.slotBytes = AlignUp(std::max<size_t>(m_config.slotBytes, 1));
+    m_stop = false;
+    m_ringFailed = false;
+#ifdef FILEREADER_IO_URING
+    if(m_config.ioUring && CreateRing(std::max(2u, m_config.queueDepth))){
+        m_thread = std::thread(&FileReader::RingMain, this);
+    }
+#endif
+    FileView::SetReadLookup(&FileReader::Lookup);
+    m_started = true;
+    return UsesIoUring();
+}
+
+void FileReader::Stop(){
+    if(!m_started){
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+#ifdef FILEREADER_IO_URING
+    if(m_thread.joinable()){
+        uint64_t one = 1;
+        if(write(m_wake, &one, sizeof(one)) < 0){
+            std::cout << "FileReader.cpp: could not wake the ring thread\n";
+        }
+        m_thread.join();
+    }
+#endif
+    FileView::SetReadLookup(nullptr);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for(auto& entry : m_files){
+            FreeFile(*entry.second);
+        }
+        m_files.clear();
+        m_queue.clear();
+    }
+    DestroyRing();
+    m_started = false;
+}
+
+void FileReader::Read(const std::vector<std::string>& paths, Job done, JobCounter* counter){
+    JobSystem& jobs = JobSystem::Get();
+    if(!m_started){
+        jobs.Submit(std::move(done), counter);
+        return;
+    }
+    Batch* batch = new Batch();
+    batch->done = std::move(done);
+    std::vector<File*> jobReads;
+    std::vector<File*> unpacks;
+    bool queued = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for(const std::string& path : paths){
+            // Packed files are mapped already, those stored compressed
+            // are decompressed here instead of read
+            size_t packedSize = 0;
+            bool compressed = false;
+            bool packed = AssetPack::Get().Stat(path, packedSize, compressed);
+            if(packed && !compressed){
+                continue;
+            }
+            std::unique_ptr<File>& entry = m_files[AssetPack::NormalizePath(path)];
+            bool found = entry != nullptr;
+            if(!found){
+                entry.reset(new File());
+                entry->path = path;
+                entry->packed = packed;
+                entry->size = packedSize;
+            }
+            File& file = *entry;
+            ++file.references;
+            if(found){
+                // Read or being read for another batch already
+                if(!file.ready){
+                    file.waiters.push_back(&batch->reads);
+                    jobs.Hold(batch->reads);
+                }
+                continue;
+            }
+            if(!OpenFile(file)){
+                file.ready = true;
+                file.failed = true;
+                continue;
+            }
+            if(file.size == 0){
+                FreeFile(file);
+                file.ready = true;
+                continue;
+            }
+            file.waiters.push_back(&batch->reads);
+            jobs.Hold(batch->reads);
+            if(file.packed){
+                unpacks.push_back(&file);
+            }else if(UsesIoUring() && !m_ringFailed){
+                m_queue.push_back(&file);
+                queued = true;
+            }else{
+                jobReads.push_back(&file);
+            }
+        }
+    }
+#ifdef FILEREADER_IO_URING
+    // The ring thread picks up everything queued since it last woke
+    if(queued){
+        uint64_t one = 1;
+        if(write(m_wake, &one, sizeof(one)) < 0){
+            std::cout << "FileReader.cpp: could not wake the ring thread\n";
+        }
+    }
+#else
+    (void)queued;
+#endif
+    for(File* file : jobReads){
+        jobs.Submit([this, file]{ ReadInJob(file); });
+    }
+    for(File* file : unpacks){
+        jobs.Submit([this, file]{
+            Complete(file, AssetPack::Get().Decompress(file->path, file->data, file->size));
+        });
+    }
+    jobs.SubmitAfter(batch->reads, [batch]{
+        batch->done();
+        delete batch;
+    }, counter);
+}
+
+void FileReader::Release(const std::vector<std::string>& paths){
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for(const std::string& path : paths){
+        auto it = m_files.find(AssetPack::NormalizePath(path));
+        if(it == m_files.end()){
+            continue;
+        }
+        if(--it->second->references == 0){
+            FreeFile(*it->second);
+            m_files.erase(it);
+        }
+    }
+}
+
+bool FileReader::Lookup(const std::string& filepath, const char*& data, size_t& size,
+                        std::shared_ptr<const void>& owner){
+    FileReader& reader = Get();
+    std::lock_guard<std::mutex> lock(reader.m_mutex);
+    auto it = reader.m_files.find(AssetPack::NormalizePath(filepath));
+    if(it == reader.m_files.end() || !it->second->ready || it->second->failed){
+        return false;
+    }
+    data = it->second->data;
+    size = it->second->size;
+    owner = it->second->memory;
+    return true;
+}
+
+bool FileReader::OpenOnDisk(File& file){
+#if defined(MINGW) || defined(_WIN32)
+    // Opened and read by its job
+    std::error_code error;
+    uintmax_t size = std::filesystem::file_size(file.path, error);
+    if(error){
+        return false;
+    }
+    file.size = (size_t)size;
+    file.capacity = file.size;
+#else
+    int flags = O_RDONLY | O_CLOEXEC;
+    int descriptor = -1;
+#ifdef O_DIRECT
+    // Not every filesystem takes O_DIRECT, tmpfs for one
+    if(m_config.direct){
+        descriptor = open(file.path.c_str(), flags | O_DIRECT);
+    }
+#endif
+    if(descriptor < 0){
+        descriptor = open(file.path.c_str(), flags);
+    }
+    if(descriptor < 0){
+        return false;
+    }
+    struct stat status;
+    if(fstat(descriptor, &status) != 0 || !S_ISREG(status.st_mode)){
+        close(descriptor);
+        return false;
+    }
+    file.descriptor = descriptor;
+    file.size = (size_t)status.st_size;
+    file.capacity = AlignUp(file.size);
+#endif
+    return true;
+}
+
+bool FileReader::OpenFile(File& file){
+    if(file.packed){
+        // Sized by the pack
+        file.capacity = AlignUp(file.size);
+    }else if(!OpenOnDisk(file)){
+        return false;
+    }
+    if(file.size == 0){
+        return true;
+    }
+    if(m_slots != nullptr && file.capacity <= m_config.slotBytes){
+        std::lock_guard<std::mutex> lock(m_slotMutex);
+        for(size_t slot = 0; slot < m_slotUsed.size(); ++slot){
+            if(!m_slotUsed[slot]){
+                m_slotUsed[slot] = true;
+                file.slot = (int)slot;
+                file.data = m_slots + slot * m_config.slotBytes;
+                file.memory = std::shared_ptr<char>(file.data, [this, slot](char*){
+                    std::lock_guard<std::mutex> lock(m_slotMutex);
+                    if(slot < m_slotUsed.size()){
+                        m_slotUsed[slot] = false;
+                    }
+                });
+                return true;
+            }
+        }
+    }
+    file.data = AllocateAligned(file.capacity);
+    if(file.data == nullptr){
+        FreeFile(file);
+        return false;
+    }
+    size_t capacity = file.capacity;
+    file.memory = std::shared_ptr<char>(file.data, [capacity](char* data){
+        FreeAligned(data);
+        MemoryTags::Remove(MEMORY_ASSETS, capacity);
+    });
+    MemoryTags::Add(MEMORY_ASSETS, file.capacity);
+    return true;
+}
+
+void FileReader::FreeFile(File& file){
+#if !defined(MINGW) && !defined(_WIN32)
+    if(file.descriptor >= 0){
+        close(file.descriptor);
+    }
+#endif
+    file.descriptor = -1;
+    // Freed here unless a view still has it
+    file.memory.reset();
+    file.slot = -1;
+    file.data = nullptr;
+}
+
+void FileReader::Complete(File* file, bool ok){
+    std::vector<JobCounter*> waiters;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+#if !defined(MINGW) && !defined(_WIN32)
+        if(file->descriptor >= 0){
+            close(file->descriptor);
+            file->descriptor = -1;
+        }
+#endif
+        file->ready = true;
+        file->failed = !ok;
+        if(ok){
+            m_fileCount.fetch_add(1, std::memory_order_relaxed);
+            m_byteCount.fetch_add(file->size, std::memory_order_relaxed);
+        }else{
+            FreeFile(*file);
+        }
+        waiters.swap(file->waiters);
+    }
+    for(JobCounter* waiter : waiters){
+        JobSystem::Get().Release(*waiter);
+    }
+}
+
+void FileReader::ReadInJob(File* file){
+#if defined(MINGW) || defined(_WIN32)
+    std::FILE* stream = std::fopen(file->path.c_str(), "rb");
+    if(stream != nullptr){
+        file->bytesRead = std::fread(file->data, 1, file->size, stream);
+        std::fclose(stream);
+    }
+#else
+    // Up to the aligned capacity, which O_DIRECT needs; the file ends
+    // before it
+    while(file->bytesRead < file->size){
+        ssize_t bytes = pread(file->descriptor, file->data + file->bytesRead,
+                              file->capacity - file->bytesRead, (off_t)file->bytesRead);
+        if(bytes < 0 && errno == EINTR){
+            continue;
+        }
+        if(bytes <= 0){
+            break;
+        }
+        file->bytesRead += (size_t)bytes;
+    }
+#endif
+    Complete(file, file->bytesRead >= file->size);
+}
+
+#ifdef FILEREADER_IO_URING
+
+static int SetUpRing(unsigned int entries, io_uring_params& params){
+    return (int)syscall(__NR_io_uring_setup, entries, &params);
+}
+
+static int EnterRing(int ring, unsigned int submit, unsigned int complete, unsigned int flags){
+    return (int)syscall(__NR_io_uring_enter, ring, submit, complete, flags, nullptr, 0);
+}
+
+static int RegisterWithRing(int ring, unsigned int opcode, const void* arguments, unsigned int count){
+    return (int)syscall(__NR_io_uring_register, ring, opcode, arguments, count);
+}
+
+// Completions carry the file they read; this one is the wake-up eventfd
+static const uint64_t WAKE_DATA = 0;
+
+bool FileReader::CreateRing(unsigned int entries){
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    int ring = SetUpRing(entries, params);
+    if(ring < 0){
+        std::cout << "FileReader.cpp: no io_uring (" << strerror(errno) << "), files are read by jobs\n";
+        return false;
+    }
+    // 5.7, by which IORING_OP_READ is there too
+    if(!(params.features & IORING_FEAT_FAST_POLL)){
+        std::cout << "FileReader.cpp: io_uring is too old, files are read by jobs\n";
+        close(ring);
+        return false;
+    }
+    m_ring = ring;
+    m_submitMapBytes = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+    m_completeMapBytes = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool singleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if(singleMap){
+        m_submitMapBytes = m_completeMapBytes = std::max(m_submitMapBytes, m_completeMapBytes);
+    }
+    m_submitMap = mmap(nullptr, m_submitMapBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                       ring, IORING_OFF_SQ_RING);
+    m_completeMap = singleMap ? m_submitMap
+                  : mmap(nullptr, m_completeMapBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         ring, IORING_OFF_CQ_RING);
+    m_entryBytes = params.sq_entries * sizeof(io_uring_sqe);
+    m_entries = mmap(nullptr, m_entryBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                     ring, IORING_OFF_SQES);
+    m_wake = eventfd(0, EFD_CLOEXEC);
+    if(m_submitMap == MAP_FAILED || m_completeMap == MAP_FAILED || m_entries == MAP_FAILED || m_wake < 0){
+        std::cout << "FileReader.cpp: could not map the io_uring queues, files are read by jobs\n";
+        DestroyRing();
+        return false;
+    }
+    char* submit = (char*)m_submitMap;
+    m_submitHead = (unsigned int*)(submit + params.sq_off.head);
+    m_submitTail = (unsigned int*)(submit + params.sq_off.tail);
+    m_submitMask = *(unsigned int*)(submit + params.sq_off.ring_mask);
+    m_submitArray = (unsigned int*)(submit + params.sq_off.array);
+    char* complete = (char*)m_completeMap;
+    m_completeHead = (unsigned int*)(complete + params.cq_off.head);
+    m_completeTail = (unsigned int*)(complete + params.cq_off.tail);
+    m_completeMask = *(unsigned int*)(complete + params.cq_off.ring_mask);
+    m_completions = complete + params.cq_off.cqes;
+    m_entryCount = params.sq_entries;
+    m_prepared = 0;
+
+    // The slots are pinned once here instead of on every read. A
+    // locked memory limit too low for them leaves every file its own
+    // memory.
+    size_t slotBytes = m_config.slotBytes * m_config.slotCount;
+    if(slotBytes > 0){
+        void* slots = mmap(nullptr, slotBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        std::vector<iovec> buffers(m_config.slotCount);
+        for(size_t slot = 0; slot < m_config.slotCount; ++slot){
+            buffers[slot].iov_base = (char*)slots + slot * m_config.slotBytes;
+            buffers[slot].iov_len = m_config.slotBytes;
+        }
+        if(slots != MAP_FAILED &&
+           RegisterWithRing(ring, IORING_REGISTER_BUFFERS, buffers.data(), (unsigned int)buffers.size()) == 0){
+            m_slots = (char*)slots;
+            m_slotUsed.assign(m_config.slotCount, false);
+            MemoryTags::Add(MEMORY_ASSETS, slotBytes);
+        }else if(slots != MAP_FAILED){
+            std::cout << "FileReader.cpp: could not register " << slotBytes << " bytes of buffers ("
+                      << strerror(errno) << "), reading into plain memory\n";
+            munmap(slots, slotBytes);
+        }
+    }
+    return true;
+}
+
+void FileReader::DestroyRing(){
+    if(m_slots != nullptr){
+        std::lock_guard<std::mutex> lock(m_slotMutex);
+        // A view still open keeps the whole buffer mapped
+        if(std::find(m_slotUsed.begin(), m_slotUsed.end(), true) == m_slotUsed.end()){
+            size_t slotBytes = m_config.slotBytes * m_config.slotCount;
+            munmap(m_slots, slotBytes);
+            MemoryTags::Remove(MEMORY_ASSETS, slotBytes);
+        }else{
+            std::cout << "FileReader.cpp: files are still viewed, the read buffer stays mapped\n";
+        }
+        m_slots = nullptr;
+        m_slotUsed.clear();
+    }
+    if(m_entries != nullptr && m_entries != MAP_FAILED){
+        munmap(m_entries, m_entryBytes);
+    }
+    if(m_completeMap != nullptr && m_completeMap != MAP_FAILED && m_completeMap != m_submitMap){
+        munmap(m_completeMap, m_completeMapBytes);
+    }
+    if(m_submitMap != nullptr && m_submitMap != MAP_FAILED){
+        munmap(m_submitMap, m_submitMapBytes);
+    }
+    m_entries = nullptr;
+    m_completeMap = nullptr;
+    m_submitMap = nullptr;
+    if(m_wake >= 0){
+        close(m_wake);
+        m_wake = -1;
+    }
+    if(m_ring >= 0){
+        close(m_ring);
+        m_ring = -1;
+    }
+}
+
+void FileReader::PrepareRead(int descriptor, void* buffer, unsigned int bytes, uint64_t offset, int slot, uint64_t data){
+    // Only this thread fills the queue, the kernel only moves its head
+    unsigned int tail = *m_submitTail;
+    unsigned int index = tail & m_submitMask;
+    io_uring_sqe& entry = ((io_uring_sqe*)m_entries)[index];
+    memset(&entry, 0, sizeof(entry));
+    entry.opcode = (slot >= 0) ? IORING_OP_READ_FIXED : IORING_OP_READ;
+    entry.fd = descriptor;
+    entry.off = offset;
+    entry.addr = (uint64_t)(uintptr_t)buffer;
+    entry.len = bytes;
+    entry.buf_index = (uint16_t)std::max(slot, 0);
+    entry.user_data = data;
+    m_submitArray[index] = index;
+    __atomic_store_n(m_submitTail, tail + 1, __ATOMIC_RELEASE);
+    ++m_prepared;
+}
+
+void FileReader::RingMain(){
+    // One entry is kept for the eventfd read that wakes the thread
+    std::vector<File*> inFlight;
+    bool waking = false;
+    for(;;){
+        if(!waking){
+            PrepareRead(m_wake, &m_wakeValue, sizeof(m_wakeValue), 0, -1, WAKE_DATA);
+            waking = true;
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            while(!m_queue.empty() && inFlight.size() + 1 < m_entryCount){
+                File* file = m_queue.front();
+                m_queue.pop_front();
+                size_t bytes = std::min<size_t>(file->capacity - file->bytesRead, 1u << 30);
+                PrepareRead(file->descriptor, file->data + file->bytesRead, (unsigned int)bytes,
+                            file->bytesRead, file->slot, (uint64_t)(uintptr_t)file);
+                inFlight.push_back(file);
+            }
+            if(m_stop && inFlight.empty() && m_queue.empty()){
+                return;
+            }
+        }
+        // Everything prepared goes in with the one call, which then
+        // sleeps until something completes
+        unsigned int prepared = m_prepared;
+        int submitted = EnterRing(m_ring, prepared, 1, IORING_ENTER_GETEVENTS);
+        if(submitted < 0){
+            if(errno == EINTR || errno == EAGAIN || errno == EBUSY){
+                continue;
+            }
+            std::cout << "FileReader.cpp: io_uring_enter failed (" << strerror(errno) << "), files are read by jobs\n";
+            // Whatever the ring still had is read again by jobs, into
+            // the same memory
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_ringFailed = true;
+            inFlight.insert(inFlight.end(), m_queue.begin(), m_queue.end());
+            m_queue.clear();
+            for(File* file : inFlight){
+                JobSystem::Get().Submit([this, file]{ ReadInJob(file); });
+            }
+            return;
+        }
+        if(prepared > 0){
+            m_submitCount.fetch_add(1, std::memory_order_relaxed);
+        }
+        m_prepared -= std::min(prepared, (unsigned int)submitted);
+
+        unsigned int head = *m_completeHead;
+        unsigned int tail = __atomic_load_n(m_completeTail, __ATOMIC_ACQUIRE);
+        std::vector<File*> again;
+        for(; head != tail; ++head){
+            const io_uring_cqe& completion = ((const io_uring_cqe*)m_completions)[head & m_completeMask];
+            if(completion.user_data == WAKE_DATA){
+                waking = false;
+                continue;
+            }
+            File* file = (File*)(uintptr_t)completion.user_data;
+            inFlight.erase(std::find(inFlight.begin(), inFlight.end(), file));
+            int result = completion.res;
+            if(result == -EINTR || result == -EAGAIN){
+                again.push_back(file);
+            }else if(result <= 0){
+                Complete(file, result == 0 && file->bytesRead >= file->size);
+            }else{
+                file->bytesRead += (size_t)result;
+                if(file->bytesRead >= file->size){
+                    Complete(file, true);
+                }else{
+                    again.push_back(file);
+                }
+            }
+        }
+        __atomic_store_n(m_completeHead, head, __ATOMIC_RELEASE);
+        if(!again.empty()){
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_queue.insert(m_queue.begin(), again.begin(), again.end());
+        }
+    }
+}
+
+#else
+
+bool FileReader::CreateRing(unsigned int entries){
+    (void)entries;
+    return false;
+}
+
+void FileReader::DestroyRing(){
+
+}
+
+void FileReader::PrepareRead(int descriptor, void* buffer, unsigned int bytes, uint64_t offset, int slot, uint64_t data){
+    (void)descriptor;
+    (void)buffer;
+    (void)bytes;
+    (void)offset;
+    (void)slot;
+    (void)data;
+}
+
+void FileReader::RingMain(){
+
+}
+
+#endif
@@ -0,0 +1,191 @@
+#include "FileView.hpp"
+#include "MemoryTags.hpp"
+
+#if defined(MINGW) || defined(_WIN32)
+    #ifndef WIN32_LEAN_AND_MEAN
+    #define WIN32_LEAN_AND_MEAN 1
+    #endif
+    #include <windows.h>
+#else
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+#include <utility>
+
+static FileViewLookup sLookup = nullptr;
+static FileViewLookup sReadLookup = nullptr;
+
+void FileView::SetLookup(FileViewLookup lookup){
+    sLookup = lookup;
+}
+
+void FileView::SetReadLookup(FileViewLookup lookup){
+    sReadLookup = lookup;
+}
+
+// Opens a view of memory a lookup owns, if one knows the path. The files
+// read ahead go first: a compressed packed file is there decompressed.
+static bool OpenFromLookup(const std::string& filepath, const char*& data, size_t& size,
+                           std::shared_ptr<const void>& owner){
+    return (sReadLookup != nullptr && sReadLookup(filepath, data, size, owner)) ||
+           (sLookup != nullptr && sLookup(filepath, data, size, owner));
+}
+
+// Constructor
+FileView::FileView(){
+
+}
+
+FileView::FileView(const std::string& filepath){
+    Open(filepath);
+}
+
+// Destructor
+FileView::~FileView(){
+    Close();
+}
+
+FileView::FileView(FileView&& other) noexcept{
+    *this = std::move(other);
+}
+
+FileView& FileView::operator=(FileView&& other) noexcept{
+    if(this != &other){
+        Close();
+        m_data = other.m_data;
+        m_size = other.m_size;
+        m_isOpen = other.m_isOpen;
+        m_borrowed = other.m_borrowed;
+        m_owner = std::move(other.m_owner);
+#if defined(MINGW) || defined(_WIN32)
+        m_fileHandle = other.m_fileHandle;
+        m_mappingHandle = other.m_mappingHandle;
+        other.m_fileHandle = nullptr;
+        other.m_mappingHandle = nullptr;
+#endif
+        other.m_data = nullptr;
+        other.m_size = 0;
+        other.m_isOpen = false;
+        other.m_borrowed = false;
+    }
+    return *this;
+}
+
+#if defined(MINGW) || defined(_WIN32)
+
+bool FileView::Open(const std::string& filepath){
+    Close();
+    if(OpenFromLookup(filepath, m_data, m_size, m_owner)){
+        m_isOpen = true;
+        m_borrowed = true;
+        return true;
+    }
+    HANDLE file = CreateFileA(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if(file == INVALID_HANDLE_VALUE){
+        return false;
+    }
+    LARGE_INTEGER size;
+    if(!GetFileSizeEx(file, &size)){
+        CloseHandle(file);
+        return false;
+    }
+    m_fileHandle = file;
+    m_size = (size_t)size.QuadPart;
+    m_isOpen = true;
+    // Zero length files cannot be mapped, they are simply empty views.
+    if(m_size == 0){
+        return true;
+    }
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if(mapping == nullptr){
+        Close();
+        return false;
+    }
+    m_mappingHandle = mapping;
+    m_data = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if(m_data == nullptr){
+        Close();
+        return false;
+    }
+    MemoryTags::Add(MEMORY_ASSETS, m_size);
+    return true;
+}
+
+void FileView::Close(){
+    if(m_data != nullptr && !m_borrowed){
+        UnmapViewOfFile(m_data);
+        MemoryTags::Remove(MEMORY_ASSETS, m_size);
+    }
+    if(m_mappingHandle != nullptr){
+        CloseHandle((HANDLE)m_mappingHandle);
+    }
+    if(m_fileHandle != nullptr){
+        CloseHandle((HANDLE)m_fileHandle);
+    }
+    m_data = nullptr;
+    m_mappingHandle = nullptr;
+    m_fileHandle = nullptr;
+    m_size = 0;
+    m_isOpen = false;
+    m_borrowed = false;
+    m_owner.reset();
+}
+
+#else
+
+bool FileView::Open(const std::string& filepath){
+    Close();
+    if(OpenFromLookup(filepath, m_data, m_size, m_owner)){
+        m_isOpen = true;
+        m_borrowed = true;
+        return true;
+    }
+    int fd = open(filepath.c_str(), O_RDONLY);
+    if(fd < 0){
+        return false;
+    }
+    struct stat info;
+    if(fstat(fd, &info) != 0){
+        close(fd);
+        return false;
+    }
+    m_size = (size_t)info.st_size;
+    m_isOpen = true;
+    // Zero length files cannot be mapped, they are simply empty views.
+    if(m_size > 0){
+        // Shared, so every process mapping the same file reads the same
+        // page cache pages instead of each faulting in its own
+        void* mapped = mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0);
+        if(mapped == MAP_FAILED){
+            close(fd);
+            m_size = 0;
+            m_isOpen = false;
+            return false;
+        }
+        // Parsers walk the file front to back
+        madvise(mapped, m_size, MADV_SEQUENTIAL);
+        m_data = (const char*)mapped;
+        MemoryTags::Add(MEMORY_ASSETS, m_size);
+    }
+    // The mapping stays valid after the descriptor is closed
+    close(fd);
+    return true;
+}
+
+void FileView::Close(){
+    if(m_data != nullptr && !m_borrowed){
+        munmap((void*)m_data, m_size);
+        MemoryTags::Remove(MEMORY_ASSETS, m_size);
+    }
+    m_data = nullptr;
+    m_size = 0;
+    m_isOpen = false;
+    m_borrowed = false;
+    m_owner.reset();
+}
+
+#endif
@@ -0,0 +1,242 @@
+#include "FileWatcher.hpp"
+
+#if defined(MINGW) || defined(_WIN32)
+    #ifndef WIN32_LEAN_AND_MEAN
+    #define WIN32_LEAN_AND_MEAN 1
+    #endif
+    #include <windows.h>
+#elif defined(LINUX) || defined(__linux__)
+    #include <sys/inotify.h>
+    #include <unistd.h>
+    #define FILEWATCHER_INOTIFY 1
+#endif
+
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+#if defined(MINGW) || defined(_WIN32)
+// One outstanding ReadDirectoryChangesW per directory
+struct DirectoryWatch{
+    HANDLE directory{INVALID_HANDLE_VALUE};
+    OVERLAPPED overlapped;
+    // FILE_NOTIFY_INFORMATION records, DWORD aligned
+    DWORD buffer[4096];
+};
+
+// Queues the next read of a directory's changes
+static bool RequestChanges(DirectoryWatch& watch){
+    memset(&watch.overlapped, 0, sizeof(watch.overlapped));
+    return ReadDirectoryChangesW(watch.directory, watch.buffer, sizeof(watch.buffer), FALSE,
+                                 FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME,
+                                 nullptr, &watch.overlapped, nullptr) != 0;
+}
+#endif
+
+struct FileWatcher::Platform{
+#if defined(MINGW) || defined(_WIN32)
+    std::vector<std::unique_ptr<DirectoryWatch>> watches;
+#elif defined(FILEWATCHER_INOTIFY)
+    int fd{-1};
+    // Watch descriptor of every directory, by directory index
+    std::vector<int> watches;
+#endif
+};
+
+// Modification time of a file as a number, 0 if it does not exist
+static long long GetModifiedTime(const std::string& filepath){
+    std::error_code error;
+    auto time = std::filesystem::last_write_time(filepath, error);
+    return error ? 0 : (long long)time.time_since_epoch().count();
+}
+
+// Constructor
+FileWatcher::FileWatcher(){
+
+}
+
+// Destructor
+FileWatcher::~FileWatcher(){
+    Stop();
+}
+
+bool FileWatcher::Start(){
+    if(m_running){
+        return true;
+    }
+    m_platform.reset(new Platform());
+#if defined(FILEWATCHER_INOTIFY)
+    m_platform->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if(m_platform->fd < 0){
+        std::cout << "FileWatcher.cpp: inotify is not available\n";
+        m_platform.reset();
+        return false;
+    }
+#endif
+    m_lastScan = Clock::now();
+    m_running = true;
+    return true;
+}
+
+size_t FileWatcher::AddDirectory(const std::string& directory){
+    for(size_t i = 0; i < m_directories.size(); ++i){
+        if(m_directories[i] == directory){
+            return i;
+        }
+    }
+    m_directories.push_back(directory);
+#if defined(MINGW) || defined(_WIN32)
+    std::unique_ptr<DirectoryWatch> watch(new DirectoryWatch());
+    watch->directory = CreateFileA(directory.c_str(), FILE_LIST_DIRECTORY,
+                                   FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+                                   OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+    if(watch->directory == INVALID_HANDLE_VALUE || !RequestChanges(*watch)){
+        std::cout << "FileWatcher.cpp: could not watch " << directory << "\n";
+    }
+    m_platform->watches.push_back(std::move(watch));
+#elif defined(FILEWATCHER_INOTIFY)
+    int watch = inotify_add_watch(m_platform->fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+    if(watch < 0){
+        std::cout << "FileWatcher.cpp: could not watch " << directory << "\n";
+    }
+    m_platform->watches.push_back(watch);
+#endif
+    return m_directories.size() - 1;
+}
+
+void FileWatcher::Watch(const std::string& filepath, FileChanged onChange){
+    if(!m_running){
+        return;
+    }
+    std::filesystem::path path(filepath);
+    std::string directory = path.parent_path().string();
+    Entry entry;
+    entry.directory = AddDirectory(directory.empty() ? "." : directory);
+    entry.name = path.filename().string();
+    entry.onChange = onChange;
+    entry.modified = GetModifiedTime(filepath);
+    m_entries.push_back(entry);
+}
+
+void FileWatcher::MarkChanged(size_t directory, const std::string& name){
+    Clock::time_point now = Clock::now();
+    for(Entry& entry : m_entries){
+        if(entry.directory == directory && (name.empty() || entry.name == name)){
+            entry.pending = true;
+            entry.lastEvent = now;
+        }
+    }
+}
+
+void FileWatcher::ReadEvents(){
+#if defined(MINGW) || defined(_WIN32)
+    for(size_t i = 0; i < m_platform->watches.size(); ++i){
+        DirectoryWatch& watch = *m_platform->watches[i];
+        DWORD bytes = 0;
+        if(watch.directory == INVALID_HANDLE_VALUE ||
+           !GetOverlappedResult(watch.directory, &watch.overlapped, &bytes, FALSE)){
+            continue;
+        }
+        if(bytes == 0){
+            // The buffer overflowed, so anything in it may have changed
+            MarkChanged(i, "");
+        }
+        const char* record = reinterpret_cast<const char*>(watch.buffer);
+        while(bytes > 0){
+            const FILE_NOTIFY_INFORMATION* change = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(record);
+            int wideLength = (int)(change->FileNameLength / sizeof(WCHAR));
+            int length = WideCharToMultiByte(CP_UTF8, 0, change->FileName, wideLength, nullptr, 0, nullptr, nullptr);
+            std::string name(length, '\0');
+            WideCharToMultiByte(CP_UTF8, 0, change->FileName, wideLength, &name[0], length, nullptr, nullptr);
+            MarkChanged(i, name);
+            if(change->NextEntryOffset == 0){
+                break;
+            }
+            record += change->NextEntryOffset;
+        }
+        RequestChanges(watch);
+    }
+#elif defined(FILEWATCHER_INOTIFY)
+    alignas(struct inotify_event) char buffer[4096];
+    for(;;){
+        ssize_t bytes = read(m_platform->fd, buffer, sizeof(buffer));
+        if(bytes <= 0){
+            // EAGAIN: nothing more queued
+            return;
+        }
+        for(ssize_t offset = 0; offset < bytes; ){
+            const struct inotify_event* event = reinterpret_cast<const struct inotify_event*>(buffer + offset);
+            offset += sizeof(struct inotify_event) + event->len;
+            if(event->mask & IN_Q_OVERFLOW){
+                for(size_t i = 0; i < m_directories.size(); ++i){
+                    MarkChanged(i, "");
+                }
+                continue;
+            }
+            for(size_t i = 0; i < m_platform->watches.size(); ++i){
+                if(m_platform->watches[i] == event->wd && event->len > 0){
+                    MarkChanged(i, event->name);
+                }
+            }
+        }
+    }
+#else
+    Clock::time_point now = Clock::now();
+    if(now - m_lastScan < std::chrono::milliseconds(POLL_INTERVAL_MS)){
+        return;
+    }
+    m_lastScan = now;
+    for(Entry& entry : m_entries){
+        long long modified = GetModifiedTime(m_directories[entry.directory] + "/" + entry.name);
+        if(modified != entry.modified){
+            entry.modified = modified;
+            entry.pending = true;
+            entry.lastEvent = now;
+        }
+    }
+#endif
+}
+
+size_t FileWatcher::Poll(){
+    if(!m_running){
+        return 0;
+    }
+    ReadEvents();
+    Clock::time_point now = Clock::now();
+    size_t reported = 0;
+    // Callbacks may Watch() more files, so index instead of iterating
+    for(size_t i = 0; i < m_entries.size(); ++i){
+        if(!m_entries[i].pending || now - m_entries[i].lastEvent < std::chrono::milliseconds(SETTLE_MS)){
+            continue;
+        }
+        m_entries[i].pending = false;
+        FileChanged onChange = m_entries[i].onChange;
+        onChange();
+        ++reported;
+    }
+    return reported;
+}
+
+void FileWatcher::Stop(){
+    if(!m_running){
+        return;
+    }
+#if defined(MINGW) || defined(_WIN32)
+    for(std::unique_ptr<DirectoryWatch>& watch : m_platform->watches){
+        if(watch->directory != INVALID_HANDLE_VALUE){
+            // The buffer must outlive the cancelled read
+            DWORD bytes = 0;
+            CancelIo(watch->directory);
+            GetOverlappedResult(watch->directory, &watch->overlapped, &bytes, TRUE);
+            CloseHandle(watch->directory);
+        }
+    }
+#elif defined(FILEWATCHER_INOTIFY)
+    // Closing the descriptor drops its watches
+    close(m_platform->fd);
+#endif
+    m_platform.reset();
+    m_directories.clear();
+    m_entries.clear();
+    m_running = false;
+}
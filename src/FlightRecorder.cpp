@@ -0,0 +1,174 @@
+#include "FlightRecorder.hpp"
+#include "TraceRecorder.hpp"
+
+#include <SDL2/SDL.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+#include <iostream>
+
+// Constructor
+FlightRecorder::FlightRecorder(){
+
+}
+
+// Destructor
+FlightRecorder::~FlightRecorder(){
+
+}
+
+void FlightRecorder::Initialize(double seconds, double budgetMilliseconds, const std::string& directory){
+    seconds = std::max(seconds, 0.5);
+    m_events.assign((size_t)(seconds * EVENTS_PER_SECOND), Event());
+    m_next = 0;
+    m_stored = 0;
+    m_directory = directory.empty() ? "." : directory;
+    double frequency = (double)SDL_GetPerformanceFrequency();
+    m_budgetCounts = (budgetMilliseconds > 0.0) ? (uint64_t)(budgetMilliseconds * frequency / 1000.0) : 0;
+    m_windowCounts = (uint64_t)(seconds * frequency);
+    m_frame = 0;
+    m_hitches = 0;
+    m_dumps = 0;
+    m_dumpPending = false;
+    m_quietUntil = 0;
+}
+
+int FlightRecorder::AddName(const std::string& name){
+    for(size_t i = 0; i < m_names.size(); ++i){
+        if(m_names[i] == name){
+            return (int)i;
+        }
+    }
+    m_names.push_back(name);
+    return (int)m_names.size() - 1;
+}
+
+void FlightRecorder::SyncGPUClock(int64_t gpuNanoseconds){
+    m_gpuNanoseconds = gpuNanoseconds;
+    m_gpuCounter = SDL_GetPerformanceCounter();
+    m_gpuSynced = true;
+}
+
+void FlightRecorder::AddZone(int name, int thread, uint64_t start, uint64_t end){
+    if(m_events.empty()){
+        return;
+    }
+    Event event = {EVENT_ZONE, name, thread, 0, start, end, 0};
+    Push(event);
+}
+
+void FlightRecorder::AddGPUPass(int name, uint64_t start, uint64_t end){
+    if(m_events.empty()){
+        return;
+    }
+    Event event = {EVENT_GPU_PASS, name, 0, 0, start, end, 0};
+    Push(event);
+}
+
+void FlightRecorder::EndFrame(uint64_t start, uint64_t end, uint64_t allocations, uint64_t bytes){
+    if(m_events.empty()){
+        return;
+    }
+    Event event = {EVENT_FRAME, -1, 1, (uint32_t)std::min<uint64_t>(allocations, 0xFFFFFFFFu), start, end, bytes};
+    Push(event);
+    ++m_frame;
+    if(m_dumpPending && m_frame >= m_dumpFrame){
+        m_dumpPending = false;
+        StartDump();
+    }
+    if(m_budgetCounts == 0 || m_frame <= WARMUP_FRAMES || end - start <= m_budgetCounts){
+        return;
+    }
+    ++m_hitches;
+    // One dump per window: the frames right after a hitch are in it already
+    if(!m_dumpPending && m_dumps < MAX_DUMPS && end >= m_quietUntil){
+        m_dumpPending = true;
+        m_dumpFrame = m_frame + DUMP_DELAY_FRAMES;
+        m_hitchStart = start;
+        m_hitchEnd = end;
+        m_quietUntil = end + m_windowCounts;
+    }
+}
+
+void FlightRecorder::StartDump(){
+    // Named by the time of the dump, numbered within the run
+    char name[64];
+    time_t now = time(nullptr);
+    size_t length = strftime(name, sizeof(name), "hitch_%Y%m%d_%H%M%S", localtime(&now));
+    snprintf(name + length, sizeof(name) - length, "_%02d.json", m_dumps++);
+
+    Dump* dump = new Dump;
+    dump->path = m_directory + "/" + name;
+    dump->names = m_names;
+    // Oldest first: once the ring has wrapped that is the next slot
+    dump->events.reserve(m_stored);
+    size_t first = (m_stored < m_events.size()) ? 0 : m_next;
+    for(size_t i = 0; i < m_stored; ++i){
+        dump->events.push_back(m_events[(first + i) % m_events.size()]);
+    }
+    dump->hitchStart = m_hitchStart;
+    dump->hitchEnd = m_hitchEnd;
+    dump->gpuNanoseconds = m_gpuNanoseconds;
+    dump->gpuCounter = m_gpuCounter;
+    dump->gpuSynced = m_gpuSynced;
+    JobSystem::Get().Submit([dump](){
+        WriteDump(*dump);
+        delete dump;
+    }, &m_writes);
+}
+
+void FlightRecorder::WriteDump(const Dump& dump){
+    // The window starts at the oldest CPU event still in it
+    uint64_t start = dump.hitchStart;
+    for(const Event& event : dump.events){
+        if(event.type != EVENT_GPU_PASS){
+            start = std::min(start, event.start);
+        }
+    }
+    size_t frames = 0;
+    for(const Event& event : dump.events){
+        frames += (event.type == EVENT_FRAME) ? 1 : 0;
+    }
+    // A frame becomes three counter values, the hitch one more event
+    TraceRecorder trace;
+    trace.Begin(dump.path, (int)frames + 1, dump.events.size() + frames * 2 + 1, start);
+    for(const std::string& name : dump.names){
+        trace.AddName(name);
+    }
+    int frameName = trace.AddName("frame ms");
+    int allocationName = trace.AddName("allocations");
+    int bytesName = trace.AddName("allocated KiB");
+    int hitchName = trace.AddName("hitch");
+    if(dump.gpuSynced){
+        trace.SyncGPUClock(dump.gpuNanoseconds, dump.gpuCounter);
+    }
+    double millisecondsPerCount = 1000.0 / (double)SDL_GetPerformanceFrequency();
+    for(const Event& event : dump.events){
+        switch(event.type){
+        case EVENT_ZONE:
+            trace.AddZone(event.name, event.thread, event.start, event.end);
+            break;
+        case EVENT_GPU_PASS:
+            trace.AddGPUPass(event.name, event.start, event.end);
+            break;
+        case EVENT_FRAME:
+            trace.AddCounter(frameName, event.start, (double)(event.end - event.start) * millisecondsPerCount);
+            trace.AddCounter(allocationName, event.start, (double)event.allocations);
+            trace.AddCounter(bytesName, event.start, (double)event.bytes / 1024.0);
+            trace.EndFrame();
+            break;
+        }
+    }
+    trace.AddAsync(hitchName, dump.hitchStart, dump.hitchEnd);
+    std::cout << "Frame of " << (double)(dump.hitchEnd - dump.hitchStart) * millisecondsPerCount
+              << " ms over the budget, ";
+    trace.Write();
+}
+
+void FlightRecorder::Release(){
+    JobSystem::Get().Wait(m_writes);
+    m_events.clear();
+    m_events.shrink_to_fit();
+    m_dumpPending = false;
+}
@@ -0,0 +1,69 @@
+#include "FrameArena.hpp"
+
+#include <algorithm>
+
+// Smallest overflow block, so a run of small allocations past the end
+// of the block does not go to the heap one by one
+static const size_t MIN_OVERFLOW_BYTES = 64 * 1024;
+
+// Constructor
+FrameArena::FrameArena(MemoryTag tag) : m_tag(tag){
+
+}
+
+// Destructor
+FrameArena::~FrameArena(){
+    MemoryTags::Remove(m_tag, m_heldBytes);
+}
+
+void FrameArena::Initialize(size_t bytes){
+    m_overflow.clear();
+    m_overflowCursor = nullptr;
+    m_overflowEnd = nullptr;
+    m_block.reset(bytes > 0 ? new char[bytes] : nullptr);
+    MemoryTags::Remove(m_tag, m_heldBytes);
+    MemoryTags::Add(m_tag, bytes);
+    m_heldBytes = bytes;
+    m_capacity = bytes;
+    m_offset = 0;
+    m_used = 0;
+}
+
+void* FrameArena::Allocate(size_t bytes, size_t alignment){
+    // Aligned by address, so any power of two works whatever the block's
+    uintptr_t base = (uintptr_t)m_block.get();
+    uintptr_t aligned = (base + m_offset + alignment - 1) & ~(uintptr_t)(alignment - 1);
+    size_t end = (size_t)(aligned - base) + bytes;
+    m_used += bytes;
+    m_peak = std::max(m_peak, m_used);
+    if(m_block && end <= m_capacity){
+        m_offset = end;
+        return (void*)aligned;
+    }
+    // Past the block: bump through overflow blocks until the next reset
+    uintptr_t cursor = (uintptr_t)m_overflowCursor;
+    uintptr_t overflow = (cursor + alignment - 1) & ~(uintptr_t)(alignment - 1);
+    if(m_overflowCursor == nullptr || overflow + bytes > (uintptr_t)m_overflowEnd){
+        size_t overflowBytes = std::max(bytes + alignment, MIN_OVERFLOW_BYTES);
+        m_overflow.emplace_back(new char[overflowBytes]);
+        MemoryTags::Add(m_tag, overflowBytes);
+        m_heldBytes += overflowBytes;
+        m_overflowCursor = m_overflow.back().get();
+        m_overflowEnd = m_overflowCursor + overflowBytes;
+        cursor = (uintptr_t)m_overflowCursor;
+        overflow = (cursor + alignment - 1) & ~(uintptr_t)(alignment - 1);
+    }
+    m_overflowCursor = (char*)(overflow + bytes);
+    return (void*)overflow;
+}
+
+void FrameArena::Reset(){
+    if(!m_overflow.empty()){
+        // Next frames get everything this one needed in one block, with
+        // room for alignment padding
+        size_t peak = m_peak;
+        Initialize(peak + peak / 4);
+    }
+    m_offset = 0;
+    m_used = 0;
+}
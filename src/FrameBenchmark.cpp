@@ -0,0 +1,362 @@
+#include "FrameBenchmark.hpp"
+#include "InputLog.hpp"
+#include "MemoryTags.hpp"
+
+#if defined(MINGW) || defined(_WIN32)
+    #ifndef WIN32_LEAN_AND_MEAN
+    #define WIN32_LEAN_AND_MEAN 1
+    #endif
+    #ifndef PSAPI_VERSION
+    #define PSAPI_VERSION 2
+    #endif
+    #include <windows.h>
+    #include <psapi.h>
+#else
+    #include <sys/resource.h>
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+// An obstacle closer than this starts a jump
+const int BENCHMARK_JUMP_DISTANCE = 90;
+
+// The camera path: poses at fractions of the run, flown through linearly.
+// It starts and ends at the game's own view and swings around the scene
+// in between, so the frustum culling sees changing visibility.
+struct CameraKey{
+    float progress;
+    glm::vec3 eye;
+    glm::vec3 direction;
+};
+static const CameraKey CAMERA_PATH[] = {
+    {0.00f, glm::vec3( 0.0f, 2.0f, 5.0f), glm::vec3( 0.0f, -0.5f, -1.0f)},
+    {0.25f, glm::vec3( 3.0f, 2.5f, 4.0f), glm::vec3(-0.6f, -0.5f, -1.0f)},
+    {0.50f, glm::vec3( 0.0f, 4.5f, 8.0f), glm::vec3( 0.0f, -0.6f, -1.0f)},
+    {0.75f, glm::vec3(-3.0f, 1.5f, 4.0f), glm::vec3( 0.6f, -0.3f, -1.0f)},
+    {1.00f, glm::vec3( 0.0f, 2.0f, 5.0f), glm::vec3( 0.0f, -0.5f, -1.0f)}
+};
+static const size_t CAMERA_KEY_COUNT = sizeof(CAMERA_PATH)/sizeof(CAMERA_PATH[0]);
+
+// Constructor
+FrameBenchmark::FrameBenchmark(){
+
+}
+
+// Destructor
+FrameBenchmark::~FrameBenchmark(){
+
+}
+
+void FrameBenchmark::Begin(int frames){
+    m_frames = (frames > 0) ? frames : 1;
+    m_frame = 0;
+    m_frameTimes.clear();
+    m_cpuTimes.clear();
+    m_gpuTimes.clear();
+    m_inputLatencies.clear();
+    m_frameTimes.reserve(m_frames);
+    m_cpuTimes.reserve(m_frames);
+    m_gpuTimes.reserve(m_frames);
+    m_simulationMilliseconds = 0.0;
+    m_simulationSteps = 0;
+    m_cpuJoules = 0.0;
+    m_gpuJoules = 0.0;
+    m_energyFrames = 0;
+}
+
+uint8_t FrameBenchmark::GetInput(const GameState& state) const{
+    bool jump = GetLeadObstacle(state.obstacles, state.scroll) < BENCHMARK_JUMP_DISTANCE;
+    // Collisions off, so the run never ends early
+    return EncodeInput(jump, false, true, 0);
+}
+
+void FrameBenchmark::GetCameraPose(glm::vec3& eye, glm::vec3& direction) const{
+    // Warm-up frames hold the first pose
+    float progress = (float)std::max(0, m_frame - WARMUP_FRAMES) / (float)m_frames;
+    size_t key = 1;
+    while(key + 1 < CAMERA_KEY_COUNT && CAMERA_PATH[key].progress < progress){
+        ++key;
+    }
+    const CameraKey& from = CAMERA_PATH[key - 1];
+    const CameraKey& to = CAMERA_PATH[key];
+    float t = glm::clamp((progress - from.progress) / (to.progress - from.progress), 0.0f, 1.0f);
+    eye = glm::mix(from.eye, to.eye, t);
+    direction = glm::normalize(glm::mix(from.direction, to.direction, t));
+}
+
+void FrameBenchmark::AddFrame(double frameMilliseconds, double cpuMilliseconds){
+    if(m_frame++ < WARMUP_FRAMES){
+        return;
+    }
+    m_frameTimes.push_back(frameMilliseconds);
+    m_cpuTimes.push_back(cpuMilliseconds);
+}
+
+void FrameBenchmark::AddSimulation(double milliseconds, int steps){
+    if(m_frame >= WARMUP_FRAMES){
+        m_simulationMilliseconds += milliseconds;
+        m_simulationSteps += steps;
+    }
+}
+
+void FrameBenchmark::AddGPUFrame(double milliseconds){
+    if(m_frame >= WARMUP_FRAMES){
+        m_gpuTimes.push_back(milliseconds);
+    }
+}
+
+void FrameBenchmark::AddInputLatency(double milliseconds){
+    // AddFrame() has counted the frame already
+    if(m_frame > WARMUP_FRAMES){
+        m_inputLatencies.push_back(milliseconds);
+    }
+}
+
+void FrameBenchmark::AddEnergy(double cpuJoules, double gpuJoules){
+    // AddFrame() has counted the frame already
+    if(m_frame > WARMUP_FRAMES){
+        m_cpuJoules += cpuJoules;
+        m_gpuJoules += gpuJoules;
+        ++m_energyFrames;
+    }
+}
+
+struct TimeStatistics{
+    double average;
+    double p50;
+    double p99;
+    double max;
+};
+
+// Statistics of a list of times, all zero if it is empty
+static TimeStatistics GetStatistics(std::vector<double> times){
+    TimeStatistics statistics = {0.0, 0.0, 0.0, 0.0};
+    if(times.empty()){
+        return statistics;
+    }
+    std::sort(times.begin(), times.end());
+    double total = 0.0;
+    for(double time : times){
+        total += time;
+    }
+    size_t p99 = std::min(times.size() - 1, (times.size() * 99) / 100);
+    statistics.average = total / times.size();
+    statistics.p50 = times[times.size() / 2];
+    statistics.p99 = times[p99];
+    statistics.max = times.back();
+    return statistics;
+}
+
+// Prints one line of statistics of a list of times
+static void ReportTimes(const char* label, const std::vector<double>& times, const char* unit = "frames"){
+    std::cout << "  " << label;
+    if(times.empty()){
+        std::cout << " not measured\n";
+        return;
+    }
+    TimeStatistics statistics = GetStatistics(times);
+    std::cout << " avg " << statistics.average
+              << " p50 " << statistics.p50
+              << " p99 " << statistics.p99
+              << " max " << statistics.max
+              << " (" << times.size() << " " << unit << ")\n";
+}
+
+void FrameBenchmark::Report() const{
+    std::cout << "Benchmark finished after " << m_frameTimes.size() << " frames (ms):\n";
+    ReportTimes("frame", m_frameTimes);
+    ReportTimes("cpu  ", m_cpuTimes);
+    ReportTimes("gpu  ", m_gpuTimes);
+    ReportTimes("input", m_inputLatencies, "jumps");
+    std::cout << "  load " << m_loadMilliseconds << ", first frame at " << m_firstFrameMilliseconds << "\n";
+    if(m_simulationMilliseconds > 0.0){
+        std::cout << "  simulation " << m_simulationSteps * 1000.0 / m_simulationMilliseconds << " steps/s\n";
+    }
+    if(m_energyFrames > 0){
+        double joules = m_cpuJoules + m_gpuJoules;
+        double seconds = 0.0;
+        for(double time : m_frameTimes){
+            seconds += time / 1000.0;
+        }
+        std::cout << "  energy " << joules / m_energyFrames << " J/frame (cpu " << m_cpuJoules / m_energyFrames
+                  << ", gpu " << m_gpuJoules / m_energyFrames << ")";
+        if(m_simulationSteps > 0){
+            std::cout << ", " << joules * 1000.0 / m_simulationSteps << " J per 1000 steps";
+        }
+        if(seconds > 0.0){
+            std::cout << ", " << joules / seconds << " W";
+        }
+        std::cout << "\n";
+    }else{
+        std::cout << "  energy not measured, no readable power counters\n";
+    }
+    std::cout << "  peak rss " << GetPeakResidentBytes() / 1024 << " KiB\n";
+}
+
+std::vector<FrameBenchmark::Metric> FrameBenchmark::GetMetrics() const{
+    std::vector<Metric> metrics;
+    metrics.push_back(Metric{"frames", (double)m_frameTimes.size(), INFORMATION});
+    const char* labels[] = {"frame", "cpu", "gpu", "input_latency"};
+    const std::vector<double>* lists[] = {&m_frameTimes, &m_cpuTimes, &m_gpuTimes, &m_inputLatencies};
+    for(int i = 0; i < 4; ++i){
+        TimeStatistics statistics = GetStatistics(*lists[i]);
+        std::string label = labels[i];
+        metrics.push_back(Metric{label + "_avg_ms", statistics.average, LOWER_IS_BETTER});
+        metrics.push_back(Metric{label + "_p50_ms", statistics.p50, LOWER_IS_BETTER});
+        metrics.push_back(Metric{label + "_p99_ms", statistics.p99, LOWER_IS_BETTER});
+        metrics.push_back(Metric{label + "_max_ms", statistics.max, LOWER_IS_BETTER});
+    }
+    metrics.push_back(Metric{"load_ms", m_loadMilliseconds, LOWER_IS_BETTER});
+    metrics.push_back(Metric{"first_frame_ms", m_firstFrameMilliseconds, LOWER_IS_BETTER});
+    double steps = (m_simulationMilliseconds > 0.0) ? m_simulationSteps * 1000.0 / m_simulationMilliseconds : 0.0;
+    metrics.push_back(Metric{"sim_steps_per_second", steps, HIGHER_IS_BETTER});
+    metrics.push_back(Metric{"peak_rss_kib", (double)(GetPeakResidentBytes() / 1024), LOWER_IS_BETTER});
+    if(m_energyFrames > 0){
+        double frames = (double)m_energyFrames;
+        metrics.push_back(Metric{"energy_j_per_frame", (m_cpuJoules + m_gpuJoules) / frames, LOWER_IS_BETTER});
+        metrics.push_back(Metric{"energy_cpu_j_per_frame", m_cpuJoules / frames, LOWER_IS_BETTER});
+        metrics.push_back(Metric{"energy_gpu_j_per_frame", m_gpuJoules / frames, LOWER_IS_BETTER});
+        if(m_simulationSteps > 0){
+            metrics.push_back(Metric{"energy_j_per_1000_steps", (m_cpuJoules + m_gpuJoules) * 1000.0 / m_simulationSteps,
+                                     LOWER_IS_BETTER});
+        }
+    }
+    // Who the memory belongs to, at the end and at its most
+    for(int i = 0; i < MEMORY_TAGS; ++i){
+        MemoryTag tag = (MemoryTag)i;
+        std::string name = std::string("memory_") + MemoryTags::GetName(tag);
+        metrics.push_back(Metric{name + "_kib", (double)(MemoryTags::GetCurrent(tag) / 1024), INFORMATION});
+        metrics.push_back(Metric{name + "_peak_kib", (double)(MemoryTags::GetPeak(tag) / 1024), INFORMATION});
+    }
+    return metrics;
+}
+
+bool FrameBenchmark::WriteResults(const std::string& filepath) const{
+    std::ofstream file(filepath.c_str(), std::ios::trunc);
+    if(!file.is_open()){
+        std::cout << "FrameBenchmark.cpp: could not open " << filepath << "\n";
+        return false;
+    }
+    std::vector<Metric> metrics = GetMetrics();
+    file.precision(6);
+    file << "{\n";
+    for(size_t i = 0; i < metrics.size(); ++i){
+        file << "  \"" << metrics[i].name << "\": " << metrics[i].value
+             << ((i + 1 < metrics.size()) ? ",\n" : "\n");
+    }
+    file << "}\n";
+    std::cout << "Wrote benchmark results to " << filepath << "\n";
+    return true;
+}
+
+bool FrameBenchmark::SetTolerance(const std::string& metric, double percent){
+    if(metric.empty()){
+        m_frameTolerance = percent;
+        m_loadTolerance = percent;
+        m_stepsTolerance = percent;
+    }else if(metric == "frame_p99_ms"){
+        m_frameTolerance = percent;
+    }else if(metric == "load_ms"){
+        m_loadTolerance = percent;
+    }else if(metric == "sim_steps_per_second"){
+        m_stepsTolerance = percent;
+    }else{
+        return false;
+    }
+    return true;
+}
+
+double FrameBenchmark::GetTolerance(const std::string& metric) const{
+    if(metric == "frame_p99_ms"){
+        return m_frameTolerance;
+    }
+    if(metric == "load_ms"){
+        return m_loadTolerance;
+    }
+    if(metric == "sim_steps_per_second"){
+        return m_stepsTolerance;
+    }
+    return -1.0;
+}
+
+// Finds "name": <number> in a flat JSON object
+static bool FindJSONNumber(const std::string& text, const std::string& name, double& value){
+    size_t key = text.find("\"" + name + "\"");
+    if(key == std::string::npos){
+        return false;
+    }
+    size_t colon = text.find(':', key + name.size() + 2);
+    if(colon == std::string::npos){
+        return false;
+    }
+    const char* start = text.c_str() + colon + 1;
+    char* end = nullptr;
+    value = strtod(start, &end);
+    return end != start;
+}
+
+bool FrameBenchmark::Compare(const std::string& baselinePath) const{
+    std::ifstream file(baselinePath.c_str());
+    if(!file.is_open()){
+        std::cout << "FrameBenchmark.cpp: could not open the baseline " << baselinePath << "\n";
+        return false;
+    }
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    std::string baseline = buffer.str();
+
+    bool passed = true;
+    std::cout << "Compared with " << baselinePath << ":\n";
+    for(const Metric& metric : GetMetrics()){
+        double previous = 0.0;
+        if(!FindJSONNumber(baseline, metric.name, previous)){
+            std::cout << "  " << metric.name << " " << metric.value << " (not in the baseline)\n";
+            continue;
+        }
+        double change = (previous != 0.0) ? (metric.value - previous) / std::fabs(previous) * 100.0 : 0.0;
+        // Positive when the metric got worse
+        double regression = (metric.kind == HIGHER_IS_BETTER) ? -change : (metric.kind == LOWER_IS_BETTER) ? change : 0.0;
+        double tolerance = GetTolerance(metric.name);
+        std::ostringstream percent;
+        percent.setf(std::ios::fixed);
+        percent.precision(1);
+        percent << ((change >= 0.0) ? "+" : "") << change << "%";
+        std::cout << "  " << metric.name << " " << previous << " -> " << metric.value
+                  << " (" << percent.str() << ")";
+        if(tolerance >= 0.0){
+            bool failed = regression > tolerance;
+            std::cout << (failed ? " REGRESSED" : " ok") << ", tolerance " << tolerance << "%";
+            passed = passed && !failed;
+        }
+        std::cout << "\n";
+    }
+    std::cout << (passed ? "Benchmark within tolerance of the baseline\n" : "Benchmark regressed against the baseline\n");
+    return passed;
+}
+
+uint64_t FrameBenchmark::GetPeakResidentBytes(){
+#if defined(MINGW) || defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    if(GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))){
+        return (uint64_t)counters.PeakWorkingSetSize;
+    }
+    return 0;
+#else
+    struct rusage usage;
+    if(getrusage(RUSAGE_SELF, &usage) != 0){
+        return 0;
+    }
+    #if defined(MAC) || defined(__APPLE__)
+    // Bytes on macOS
+    return (uint64_t)usage.ru_maxrss;
+    #else
+    // Kilobytes on Linux
+    return (uint64_t)usage.ru_maxrss * 1024;
+    #endif
+#endif
+}
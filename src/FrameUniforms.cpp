@@ -0,0 +1,81 @@
+#include "FrameUniforms.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+// Frames the GPU may still be reading a block of
+static const unsigned int FRAME_UNIFORM_REGIONS = 3;
+
+// Constructor
+FrameUniforms::FrameUniforms(){
+
+}
+
+// Destructor
+FrameUniforms::~FrameUniforms(){
+
+}
+
+bool FrameUniforms::Initialize(){
+    // A bound range has to start at a multiple of the alignment
+    GLint alignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    m_alignment = (alignment > 0) ? (size_t)alignment : 256;
+    m_stride = (sizeof(FrameUniformData) + m_alignment - 1) / m_alignment * m_alignment;
+    if(!m_ring.Initialize(m_stride * MAX_VIEWPORTS, FRAME_UNIFORM_REGIONS)){
+        std::cout << "FrameUniforms.cpp: could not create the frame uniform buffer\n";
+        return false;
+    }
+    return true;
+}
+
+void FrameUniforms::Update(const FrameUniformData* views, size_t count){
+    m_viewCount = 0;
+    if(m_ring.GetBuffer() == 0){
+        return;
+    }
+    // A frame that never finished (an early return) fences its block now
+    Finish();
+    m_ring.BeginRegion();
+    m_open = true;
+    count = std::min(count, MAX_VIEWPORTS);
+    for(size_t view = 0; view < count; ++view){
+        // Views follow each other at the alignment, so each can be bound
+        size_t offset = m_ring.Write(&views[view], sizeof(FrameUniformData), m_alignment);
+        if(offset == RING_BUFFER_FULL){
+            return;
+        }
+        if(view == 0){
+            m_offset = offset;
+        }
+    }
+    m_viewCount = count;
+    BindView(0);
+}
+
+void FrameUniforms::BindView(size_t view){
+    if(view >= m_viewCount){
+        return;
+    }
+    glBindBufferRange(GL_UNIFORM_BUFFER, FRAME_UNIFORM_BINDING, m_ring.GetBuffer(), (GLintptr)(m_offset + view * m_stride),
+                      (GLsizeiptr)sizeof(FrameUniformData));
+}
+
+void FrameUniforms::Finish(){
+    if(m_open){
+        m_ring.EndRegion();
+        m_open = false;
+    }
+}
+
+void FrameUniforms::BindBlock(GLuint program){
+    GLuint block = glGetUniformBlockIndex(program, FRAME_UNIFORM_BLOCK);
+    if(block != GL_INVALID_INDEX){
+        glUniformBlockBinding(program, block, FRAME_UNIFORM_BINDING);
+    }
+}
+
+void FrameUniforms::Release(){
+    m_ring.Release();
+    m_open = false;
+}
@@ -0,0 +1,113 @@
+#include "Frustum.hpp"
+
+#include <cmath>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+BoundingSphere MakeBoundingSphere(const AABB& bounds){
+    BoundingSphere sphere;
+    if(bounds.IsEmpty()){
+        return sphere;
+    }
+    float lengthSquared = 0.0f;
+    for(int axis = 0; axis < 3; ++axis){
+        sphere.center[axis] = 0.5f*(bounds.min[axis] + bounds.max[axis]);
+        float half = 0.5f*(bounds.max[axis] - bounds.min[axis]);
+        lengthSquared += half*half;
+    }
+    sphere.radius = std::sqrt(lengthSquared);
+    return sphere;
+}
+
+Frustum ExtractFrustum(const glm::mat4& viewProjection){
+    // glm is column major: row i is (m[0][i], m[1][i], m[2][i], m[3][i])
+    const glm::mat4& m = viewProjection;
+    // Left, right, bottom, top, near, far: row 3 plus or minus rows 0, 1, 2
+    Frustum frustum;
+    for(int plane = 0; plane < 6; ++plane){
+        int row = plane / 2;
+        float sign = (plane % 2 == 0) ? 1.0f : -1.0f;
+        float length = 0.0f;
+        for(int column = 0; column < 4; ++column){
+            frustum.planes[plane][column] = m[column][3] + sign*m[column][row];
+        }
+        for(int axis = 0; axis < 3; ++axis){
+            length += frustum.planes[plane][axis]*frustum.planes[plane][axis];
+        }
+        length = std::sqrt(length);
+        if(length > 0.0f){
+            for(int column = 0; column < 4; ++column){
+                frustum.planes[plane][column] /= length;
+            }
+        }
+    }
+    return frustum;
+}
+
+// True if the sphere is not entirely behind a plane
+static inline bool SphereVisible(const Frustum& frustum, float x, float y, float z, float radius){
+    for(int plane = 0; plane < 6; ++plane){
+        const float* p = frustum.planes[plane];
+        if(p[0]*x + p[1]*y + p[2]*z + p[3] < -radius){
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t CullSpheres(const Frustum& frustum, const float* x, const float* y, const float* z,
+                   const float* radius, size_t count, uint8_t* visible){
+    size_t visibleCount = 0;
+    size_t i = 0;
+#if defined(__SSE2__)
+    for(; i + 4 <= count; i += 4){
+        __m128 px = _mm_loadu_ps(x + i);
+        __m128 py = _mm_loadu_ps(y + i);
+        __m128 pz = _mm_loadu_ps(z + i);
+        __m128 negativeRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(radius + i));
+        __m128 outside = _mm_setzero_ps();
+        for(int plane = 0; plane < 6; ++plane){
+            const float* p = frustum.planes[plane];
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(p[0]), px), _mm_mul_ps(_mm_set1_ps(p[1]), py)),
+                                         _mm_add_ps(_mm_mul_ps(_mm_set1_ps(p[2]), pz), _mm_set1_ps(p[3])));
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, negativeRadius));
+        }
+        int outsideMask = _mm_movemask_ps(outside);
+        for(int lane = 0; lane < 4; ++lane){
+            visible[i + lane] = (outsideMask & (1 << lane)) ? 0 : 1;
+            visibleCount += visible[i + lane];
+        }
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    for(; i + 4 <= count; i += 4){
+        float32x4_t px = vld1q_f32(x + i);
+        float32x4_t py = vld1q_f32(y + i);
+        float32x4_t pz = vld1q_f32(z + i);
+        float32x4_t negativeRadius = vnegq_f32(vld1q_f32(radius + i));
+        uint32x4_t outside = vdupq_n_u32(0);
+        for(int plane = 0; plane < 6; ++plane){
+            const float* p = frustum.planes[plane];
+            float32x4_t distance = vdupq_n_f32(p[3]);
+            distance = vfmaq_n_f32(distance, px, p[0]);
+            distance = vfmaq_n_f32(distance, py, p[1]);
+            distance = vfmaq_n_f32(distance, pz, p[2]);
+            outside = vorrq_u32(outside, vcltq_f32(distance, negativeRadius));
+        }
+        uint32_t lanes[4];
+        vst1q_u32(lanes, outside);
+        for(int lane = 0; lane < 4; ++lane){
+            visible[i + lane] = lanes[lane] ? 0 : 1;
+            visibleCount += visible[i + lane];
+        }
+    }
+#endif
+    for(; i < count; ++i){
+        visible[i] = SphereVisible(frustum, x[i], y[i], z[i], radius[i]) ? 1 : 0;
+        visibleCount += visible[i];
+    }
+    return visibleCount;
+}
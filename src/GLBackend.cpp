@@ -0,0 +1,88 @@
+#include "GLBackend.hpp"
+
+GLBackend& GLBackend::Get(){
+    static GLBackend backend;
+    return backend;
+}
+
+// Constructor
+GLBackend::GLBackend(){
+
+}
+
+void GLBackend::Initialize(bool allowDirectStateAccess){
+    m_directStateAccess = allowDirectStateAccess && GLAD_GL_ARB_direct_state_access != 0;
+}
+
+GLuint GLBackend::CreateBuffer(){
+    GLuint buffer = 0;
+    if(m_directStateAccess){
+        glCreateBuffers(1, &buffer);
+    }else{
+        glGenBuffers(1, &buffer);
+    }
+    return buffer;
+}
+
+GLuint GLBackend::CreateVertexArray(){
+    GLuint vao = 0;
+    if(m_directStateAccess){
+        glCreateVertexArrays(1, &vao);
+    }else{
+        glGenVertexArrays(1, &vao);
+    }
+    return vao;
+}
+
+GLuint GLBackend::CreateTexture(GLenum target){
+    GLuint texture = 0;
+    if(m_directStateAccess){
+        glCreateTextures(target, 1, &texture);
+    }else{
+        glGenTextures(1, &texture);
+    }
+    return texture;
+}
+
+void GLBackend::BufferData(GLuint buffer, size_t bytes, const void* data, GLenum usage){
+    if(m_directStateAccess){
+        glNamedBufferData(buffer, (GLsizeiptr)bytes, data, usage);
+        return;
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr)bytes, data, usage);
+}
+
+void GLBackend::BufferSubData(GLuint buffer, size_t offset, size_t bytes, const void* data){
+    if(m_directStateAccess){
+        glNamedBufferSubData(buffer, (GLintptr)offset, (GLsizeiptr)bytes, data);
+        return;
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)offset, (GLsizeiptr)bytes, data);
+}
+
+void GLBackend::BufferStorage(GLuint buffer, size_t bytes, const void* data, GLbitfield flags){
+    if(m_directStateAccess){
+        glNamedBufferStorage(buffer, (GLsizeiptr)bytes, data, flags);
+        return;
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glBufferStorage(GL_COPY_WRITE_BUFFER, (GLsizeiptr)bytes, data, flags);
+}
+
+void* GLBackend::MapBufferRange(GLuint buffer, size_t offset, size_t bytes, GLbitfield access){
+    if(m_directStateAccess){
+        return glMapNamedBufferRange(buffer, (GLintptr)offset, (GLsizeiptr)bytes, access);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    return glMapBufferRange(GL_COPY_WRITE_BUFFER, (GLintptr)offset, (GLsizeiptr)bytes, access);
+}
+
+bool GLBackend::UnmapBuffer(GLuint buffer){
+    if(m_directStateAccess){
+        return glUnmapNamedBuffer(buffer) == GL_TRUE;
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    return glUnmapBuffer(GL_COPY_WRITE_BUFFER) == GL_TRUE;
+}
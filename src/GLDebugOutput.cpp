@@ -0,0 +1,105 @@
+#include "GLDebugOutput.hpp"
+#include "Logger.hpp"
+
+#include <atomic>
+#include <iostream>
+#include <mutex>
+#include <unordered_map>
+
+// The callback may run on a driver thread
+static std::mutex sMessageMutex;
+static std::unordered_map<GLuint, int> sRepeats;
+static std::atomic<size_t> sMessageCount{0};
+
+static const char* GetSourceName(GLenum source){
+    switch(source){
+        case GL_DEBUG_SOURCE_API:             return "api";
+        case GL_DEBUG_SOURCE_WINDOW_SYSTEM:   return "window system";
+        case GL_DEBUG_SOURCE_SHADER_COMPILER: return "shader compiler";
+        case GL_DEBUG_SOURCE_THIRD_PARTY:     return "third party";
+        case GL_DEBUG_SOURCE_APPLICATION:     return "application";
+        default:                              return "other";
+    }
+}
+
+static const char* GetTypeName(GLenum type){
+    switch(type){
+        case GL_DEBUG_TYPE_ERROR:               return "error";
+        case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR: return "deprecated";
+        case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR:  return "undefined behavior";
+        case GL_DEBUG_TYPE_PORTABILITY:         return "portability";
+        case GL_DEBUG_TYPE_PERFORMANCE:         return "performance";
+        default:                                return "other";
+    }
+}
+
+static const char* GetSeverityName(GLenum severity){
+    switch(severity){
+        case GL_DEBUG_SEVERITY_HIGH:   return "high";
+        case GL_DEBUG_SEVERITY_MEDIUM: return "medium";
+        case GL_DEBUG_SEVERITY_LOW:    return "low";
+        default:                       return "notification";
+    }
+}
+
+GLDebugOutput& GLDebugOutput::Get(){
+    static GLDebugOutput output;
+    return output;
+}
+
+// Constructor
+GLDebugOutput::GLDebugOutput(){
+
+}
+
+// Destructor
+GLDebugOutput::~GLDebugOutput(){
+
+}
+
+bool GLDebugOutput::Enable(bool synchronous){
+    GLint flags = 0;
+    glGetIntegerv(GL_CONTEXT_FLAGS, &flags);
+    if(!GLAD_GL_KHR_debug || !(flags & GL_CONTEXT_FLAG_DEBUG_BIT)){
+        std::cout << "GLDebugOutput.cpp: the context has no debug output (KHR_debug)\n";
+        return false;
+    }
+    glEnable(GL_DEBUG_OUTPUT);
+    if(synchronous){
+        glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+    }else{
+        glDisable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+    }
+    glDebugMessageCallback(Callback, nullptr);
+
+    // Everything off, then errors and the two upper severities back on
+    glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, nullptr, GL_FALSE);
+    glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DEBUG_SEVERITY_HIGH, 0, nullptr, GL_TRUE);
+    glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DEBUG_SEVERITY_MEDIUM, 0, nullptr, GL_TRUE);
+    glDebugMessageControl(GL_DONT_CARE, GL_DEBUG_TYPE_ERROR, GL_DONT_CARE, 0, nullptr, GL_TRUE);
+    glDebugMessageControl(GL_DONT_CARE, GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR, GL_DONT_CARE, 0, nullptr, GL_TRUE);
+
+    m_enabled = true;
+    std::cout << "GL debug output on (" << (synchronous ? "synchronous" : "asynchronous") << ")\n";
+    return true;
+}
+
+size_t GLDebugOutput::GetMessageCount() const{
+    return sMessageCount.load(std::memory_order_relaxed);
+}
+
+void APIENTRY GLDebugOutput::Callback(GLenum source, GLenum type, GLuint id, GLenum severity,
+                                      GLsizei length, const GLchar* message, const void* /*userParam*/){
+    sMessageCount.fetch_add(1, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(sMessageMutex);
+    int repeats = ++sRepeats[id];
+    if(repeats > MAX_REPEATS){
+        return;
+    }
+    // Asynchronous messages arrive on a driver thread, the logger never
+    // makes it wait for the console
+    int messageLength = (length >= 0) ? (int)length : (int)std::char_traits<char>::length(message);
+    LOG_WARNING("OpenGL %s %s (%s, id %u): %.*s%s", GetSeverityName(severity), GetTypeName(type),
+                GetSourceName(source), id, messageLength, message,
+                (repeats == MAX_REPEATS) ? " (repeated, muting it)" : "");
+}
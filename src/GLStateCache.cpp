@@ -0,0 +1,131 @@
+#include "GLStateCache.hpp"
+#include "GLBackend.hpp"
+
+GLStateCache& GLStateCache::Get(){
+    static thread_local GLStateCache cache;
+    return cache;
+}
+
+// Constructor
+GLStateCache::GLStateCache(){
+
+}
+
+void GLStateCache::UseProgram(GLuint program){
+    if(Changed(!m_programKnown || m_program != program)){
+        glUseProgram(program);
+        m_program = program;
+        m_programKnown = true;
+    }
+}
+
+void GLStateCache::BindVertexArray(GLuint vao){
+    if(Changed(!m_vaoKnown || m_vao != vao)){
+        glBindVertexArray(vao);
+        m_vao = vao;
+        m_vaoKnown = true;
+    }
+}
+
+void GLStateCache::BindTexture(unsigned int unit, GLenum target, GLuint texture){
+    if(unit >= m_textures.size()){
+        m_textures.resize(unit + 1, TextureBinding{false, 0, 0});
+    }
+    TextureBinding& binding = m_textures[unit];
+    if(!Changed(!binding.known || binding.target != target || binding.texture != texture)){
+        return;
+    }
+    binding.known = true;
+    binding.target = target;
+    binding.texture = texture;
+    // Binds by unit, the active unit stays as it is
+    if(texture != 0 && GLBackend::Get().HasDirectStateAccess()){
+        glBindTextureUnit(unit, texture);
+        return;
+    }
+    if(!m_activeUnitKnown || m_activeUnit != unit){
+        glActiveTexture(GL_TEXTURE0 + unit);
+        m_activeUnit = unit;
+        m_activeUnitKnown = true;
+    }
+    glBindTexture(target, texture);
+}
+
+void GLStateCache::ActiveTexture(unsigned int unit){
+    if(Changed(!m_activeUnitKnown || m_activeUnit != unit)){
+        glActiveTexture(GL_TEXTURE0 + unit);
+        m_activeUnit = unit;
+        m_activeUnitKnown = true;
+    }
+}
+
+void GLStateCache::SetEnabled(GLenum capability, bool enabled){
+    for(Capability& entry : m_capabilities){
+        if(entry.capability == capability){
+            if(Changed(entry.enabled != enabled)){
+                if(enabled){ glEnable(capability); }else{ glDisable(capability); }
+                entry.enabled = enabled;
+            }
+            return;
+        }
+    }
+    Changed(true);
+    if(enabled){ glEnable(capability); }else{ glDisable(capability); }
+    m_capabilities.push_back(Capability{capability, enabled});
+}
+
+void GLStateCache::PolygonMode(GLenum mode){
+    if(Changed(!m_polygonModeKnown || m_polygonMode != mode)){
+        glPolygonMode(GL_FRONT_AND_BACK, mode);
+        m_polygonMode = mode;
+        m_polygonModeKnown = true;
+    }
+}
+
+void GLStateCache::Viewport(GLint x, GLint y, GLsizei width, GLsizei height){
+    if(Changed(!m_viewportKnown || m_viewport[0] != x || m_viewport[1] != y ||
+               m_viewport[2] != width || m_viewport[3] != height)){
+        glViewport(x, y, width, height);
+        m_viewport[0] = x;
+        m_viewport[1] = y;
+        m_viewport[2] = width;
+        m_viewport[3] = height;
+        m_viewportKnown = true;
+    }
+}
+
+void GLStateCache::Scissor(GLint x, GLint y, GLsizei width, GLsizei height){
+    if(Changed(!m_scissorKnown || m_scissor[0] != x || m_scissor[1] != y ||
+               m_scissor[2] != width || m_scissor[3] != height)){
+        glScissor(x, y, width, height);
+        m_scissor[0] = x;
+        m_scissor[1] = y;
+        m_scissor[2] = width;
+        m_scissor[3] = height;
+        m_scissorKnown = true;
+    }
+}
+
+void GLStateCache::ClearColor(GLfloat r, GLfloat g, GLfloat b, GLfloat a){
+    if(Changed(!m_clearColorKnown || m_clearColor[0] != r || m_clearColor[1] != g ||
+               m_clearColor[2] != b || m_clearColor[3] != a)){
+        glClearColor(r, g, b, a);
+        m_clearColor[0] = r;
+        m_clearColor[1] = g;
+        m_clearColor[2] = b;
+        m_clearColor[3] = a;
+        m_clearColorKnown = true;
+    }
+}
+
+void GLStateCache::Invalidate(){
+    m_programKnown = false;
+    m_vaoKnown = false;
+    m_activeUnitKnown = false;
+    m_textures.clear();
+    m_capabilities.clear();
+    m_polygonModeKnown = false;
+    m_viewportKnown = false;
+    m_scissorKnown = false;
+    m_clearColorKnown = false;
+}
@@ -0,0 +1,307 @@
+#include "GPUGameBatch.hpp"
+#include "Collision.hpp"
+#include "GLBackend.hpp"
+#include "GLStateCache.hpp"
+#include "GPUResourceTracker.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+// Attribute locations of batch_step.glsl
+static const GLuint STATE_ATTRIBUTES = 6;
+static const GLuint PARAMETER_LOCATION = 6;
+static const GLuint ACTION_LOCATION = 8;
+// Formations the shader has room for
+static const int MAX_ARCHETYPES = 8;
+
+// Constructor
+GPUGameBatch::GPUGameBatch(){
+
+}
+
+// Destructor
+GPUGameBatch::~GPUGameBatch(){
+
+}
+
+bool GPUGameBatch::Initialize(const std::string& stepPath){
+    // The step only writes the buffer, so it has no fragment shader
+    m_stepProgram.SetFeedbackVaryings({"v_state0", "v_state1", "v_lane0", "v_lane1", "v_rng", "v_result"});
+    if(!m_stepProgram.Build(ShaderProgram::LoadShaderAsString(stepPath), "")){
+        std::cout << "GPUGameBatch.cpp: could not build the batch step shader\n";
+        return false;
+    }
+    m_step.ticks          = m_stepProgram.GetUniformLocation("u_Ticks");
+    m_step.repeat         = m_stepProgram.GetUniformLocation("u_Repeat");
+    m_step.autoReset      = m_stepProgram.GetUniformLocation("u_AutoReset");
+    m_step.seed           = m_stepProgram.GetUniformLocation("u_Seed");
+    m_step.count          = m_stepProgram.GetUniformLocation("u_Count");
+    m_step.hitRange       = m_stepProgram.GetUniformLocation("u_HitRange");
+    m_step.silhouettes    = m_stepProgram.GetUniformLocation("u_Silhouettes");
+    m_step.dinoBox        = m_stepProgram.GetUniformLocation("u_DinoBox");
+    m_step.obstacleBox    = m_stepProgram.GetUniformLocation("u_ObstacleBox");
+    m_step.dinoRows       = m_stepProgram.GetUniformLocation("u_DinoRows[0]");
+    m_step.obstacleRows   = m_stepProgram.GetUniformLocation("u_ObstacleRows[0]");
+    m_step.archetypeCount = m_stepProgram.GetUniformLocation("u_ArchetypeCount");
+    m_step.archetypes     = m_stepProgram.GetUniformLocation("u_Archetypes[0]");
+
+    GLBackend& backend = GLBackend::Get();
+    GPUResourceTracker& tracker = GPUResourceTracker::Get();
+    for(int i = 0; i < 2; ++i){
+        m_states[i] = backend.CreateBuffer();
+        tracker.Created(GPU_BUFFER, m_states[i], "batch states");
+        m_stepVao[i] = backend.CreateVertexArray();
+        tracker.Created(GPU_VERTEX_ARRAY, m_stepVao[i], "batch step vertex array");
+    }
+    m_parameters = backend.CreateBuffer();
+    tracker.Created(GPU_BUFFER, m_parameters, "batch parameters");
+    m_actions = backend.CreateBuffer();
+    tracker.Created(GPU_BUFFER, m_actions, "batch actions");
+    for(int i = 0; i < 2; ++i){
+        SetupVertexArray(i);
+    }
+    m_current = 0;
+    m_count = 0;
+    return true;
+}
+
+void GPUGameBatch::SetupVertexArray(int i){
+    // Integer attributes, so the shader sees the bits as they are
+    GLStateCache::Get().BindVertexArray(m_stepVao[i]);
+    glBindBuffer(GL_ARRAY_BUFFER, m_states[i]);
+    for(GLuint location = 0; location < STATE_ATTRIBUTES; ++location){
+        glEnableVertexAttribArray(location);
+        glVertexAttribIPointer(location, 4, (location == 4) ? GL_UNSIGNED_INT : GL_INT, (GLsizei)sizeof(GPUGameState),
+                               (const GLvoid*)(size_t)(location * 4 * sizeof(GLint)));
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, m_parameters);
+    for(GLuint half = 0; half < 2; ++half){
+        glEnableVertexAttribArray(PARAMETER_LOCATION + half);
+        glVertexAttribIPointer(PARAMETER_LOCATION + half, 4, GL_INT, (GLsizei)(8 * sizeof(GLint)),
+                               (const GLvoid*)(size_t)(half * 4 * sizeof(GLint)));
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, m_actions);
+    glEnableVertexAttribArray(ACTION_LOCATION);
+    glVertexAttribIPointer(ACTION_LOCATION, 1, GL_INT, (GLsizei)sizeof(GLint), (const GLvoid*)0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    GLStateCache::Get().BindVertexArray(0);
+}
+
+void GPUGameBatch::Load(const GameStateBatch& batch){
+    if(m_states[0] == 0){
+        return;
+    }
+    m_count = batch.GetCount();
+    std::vector<GPUGameState> states(m_count);
+    std::vector<GLint> parameters(m_count * 8);
+    for(size_t i = 0; i < m_count; ++i){
+        GameState state = batch.Get(i);
+        GPUGameState& record = states[i];
+        record.tick = state.tick;
+        record.dayTick = state.dayTick;
+        record.dinoHeight = state.dinoHeight;
+        record.flags = (state.isDaytime ? GPU_GAME_DAYTIME : 0) | (state.isJumping ? GPU_GAME_JUMPING : 0) |
+                       (state.jumpingUp ? GPU_GAME_JUMPING_UP : 0) | (state.gameOver ? GPU_GAME_OVER : 0) |
+                       (state.invincible ? GPU_GAME_INVINCIBLE : 0);
+        record.jumpingSpeed = state.jumpingSpeed;
+        record.scroll = state.scroll;
+        record.spawnDistance = state.spawnDistance;
+        record.cactusSpeed = state.cactusSpeed;
+        std::memcpy(record.obstacleX, state.obstacles.x, sizeof(record.obstacleX));
+        record.rng[0] = (GLuint)state.rng.state;
+        record.rng[1] = (GLuint)(state.rng.state >> 32);
+        record.rng[2] = (GLuint)state.rng.increment;
+        record.rng[3] = (GLuint)(state.rng.increment >> 32);
+        record.lane = (GLint)(state.obstacles.head | (state.obstacles.count << 8));
+        record.events = EVENT_NONE;
+        record.reward = 0.0f;
+        record.episodes = 0;
+
+        GameParameters rules = batch.GetParameters(i);
+        const GLint values[8] = {rules.cactusSpeed, rules.jumpingSpeed, rules.jumpApex, rules.dayLength,
+                                 rules.daySpeedup, rules.spawnGapMin, rules.spawnGapRange, rules.spawnSpeedMin};
+        std::memcpy(&parameters[i * 8], values, sizeof(values));
+    }
+    GLBackend& backend = GLBackend::Get();
+    GPUResourceTracker& tracker = GPUResourceTracker::Get();
+    size_t stateBytes = m_count * sizeof(GPUGameState);
+    for(int i = 0; i < 2; ++i){
+        backend.BufferData(m_states[i], stateBytes, states.data(), GL_DYNAMIC_COPY);
+        tracker.Resized(GPU_BUFFER, m_states[i], stateBytes);
+    }
+    backend.BufferData(m_parameters, parameters.size() * sizeof(GLint), parameters.data(), GL_STATIC_DRAW);
+    tracker.Resized(GPU_BUFFER, m_parameters, parameters.size() * sizeof(GLint));
+    std::vector<GLint> actions(m_count, ACTION_NONE);
+    backend.BufferData(m_actions, actions.size() * sizeof(GLint), actions.data(), GL_STREAM_DRAW);
+    tracker.Resized(GPU_BUFFER, m_actions, actions.size() * sizeof(GLint));
+    m_current = 0;
+}
+
+void GPUGameBatch::Store(GameStateBatch& batch) const{
+    batch.Resize(m_count);
+    if(m_count == 0){
+        return;
+    }
+    GLBackend& backend = GLBackend::Get();
+    const GPUGameState* states = (const GPUGameState*)backend.MapBufferRange(m_states[m_current], 0,
+                                                                              m_count * sizeof(GPUGameState), GL_MAP_READ_BIT);
+    const GLint* parameters = (const GLint*)backend.MapBufferRange(m_parameters, 0, m_count * 8 * sizeof(GLint),
+                                                                   GL_MAP_READ_BIT);
+    if(states != nullptr && parameters != nullptr){
+        for(size_t i = 0; i < m_count; ++i){
+            const GPUGameState& record = states[i];
+            GameState state;
+            state.tick = record.tick;
+            state.dayTick = record.dayTick;
+            state.isDaytime = (record.flags & GPU_GAME_DAYTIME) != 0;
+            state.dinoHeight = record.dinoHeight;
+            state.isJumping = (record.flags & GPU_GAME_JUMPING) != 0;
+            state.jumpingUp = (record.flags & GPU_GAME_JUMPING_UP) != 0;
+            state.jumpingSpeed = record.jumpingSpeed;
+            state.scroll = record.scroll;
+            state.spawnDistance = record.spawnDistance;
+            state.cactusSpeed = record.cactusSpeed;
+            std::memcpy(state.obstacles.x, record.obstacleX, sizeof(record.obstacleX));
+            state.obstacles.head = (uint32_t)record.lane & 0xff;
+            state.obstacles.count = (uint32_t)record.lane >> 8;
+            state.gameOver = (record.flags & GPU_GAME_OVER) != 0;
+            state.invincible = (record.flags & GPU_GAME_INVINCIBLE) != 0;
+            state.rng.state = (uint64_t)record.rng[0] | ((uint64_t)record.rng[1] << 32);
+            state.rng.increment = (uint64_t)record.rng[2] | ((uint64_t)record.rng[3] << 32);
+            batch.Set(i, state);
+
+            const GLint* values = &parameters[i * 8];
+            GameParameters rules;
+            rules.cactusSpeed = values[0];
+            rules.jumpingSpeed = values[1];
+            rules.jumpApex = values[2];
+            rules.dayLength = values[3];
+            rules.daySpeedup = values[4];
+            rules.spawnGapMin = values[5];
+            rules.spawnGapRange = values[6];
+            rules.spawnSpeedMin = values[7];
+            batch.SetParameters(i, rules);
+        }
+    }else{
+        std::cout << "GPUGameBatch.cpp: could not read the batch back\n";
+    }
+    if(states != nullptr){
+        backend.UnmapBuffer(m_states[m_current]);
+    }
+    if(parameters != nullptr){
+        backend.UnmapBuffer(m_parameters);
+    }
+}
+
+void GPUGameBatch::SetActions(const GameAction* actions){
+    if(m_count == 0){
+        return;
+    }
+    static_assert(sizeof(GameAction) == sizeof(GLint), "actions are uploaded as they are");
+    GLBackend::Get().BufferSubData(m_actions, 0, m_count * sizeof(GLint), actions);
+}
+
+void GPUGameBatch::SetAutoReset(bool enabled, uint64_t seed){
+    m_autoReset = enabled;
+    m_seed = seed;
+}
+
+void GPUGameBatch::StepRepeated(int repeat, int ticks){
+    if(m_count == 0){
+        return;
+    }
+    GLStateCache& state = GLStateCache::Get();
+    int next = 1 - m_current;
+
+    m_stepProgram.Use();
+    glUniform1i(m_step.ticks, ticks);
+    glUniform1i(m_step.repeat, repeat);
+    glUniform1i(m_step.autoReset, m_autoReset ? 1 : 0);
+    glUniform2ui(m_step.seed, (GLuint)m_seed, (GLuint)(m_seed >> 32));
+    glUniform1ui(m_step.count, (GLuint)m_count);
+    // The rules can change between steps (SetCollisionRules()), they
+    // are cheap enough to set every time
+    const CollisionRules& rules = GetCollisionRules();
+    const CollisionBox& range = rules.hitRange;
+    glUniform4i(m_step.hitRange, range.minX, range.maxX, range.minY, range.maxY);
+    glUniform1i(m_step.silhouettes, rules.silhouettes ? 1 : 0);
+    if(rules.silhouettes){
+        const CollisionSilhouette* silhouettes[2] = {&rules.dinoSilhouette, &rules.obstacleSilhouette};
+        const GLint boxes[2] = {m_step.dinoBox, m_step.obstacleBox};
+        const GLint rows[2] = {m_step.dinoRows, m_step.obstacleRows};
+        for(int i = 0; i < 2; ++i){
+            const CollisionBox& box = silhouettes[i]->box;
+            glUniform4i(boxes[i], box.minX, box.maxX, box.minY, box.maxY);
+            // Two rows per uvec4, each as its low then high half
+            GLuint halves[SILHOUETTE_SIZE * 2];
+            for(int row = 0; row < SILHOUETTE_SIZE; ++row){
+                halves[row * 2] = (GLuint)silhouettes[i]->rows[row];
+                halves[row * 2 + 1] = (GLuint)(silhouettes[i]->rows[row] >> 32);
+            }
+            glUniform4uiv(rows[i], SILHOUETTE_SIZE / 2, halves);
+        }
+    }
+    int archetypeCount = 0;
+    const ObstacleArchetype* archetypes = GetObstacleArchetypes(archetypeCount);
+    archetypeCount = std::min(archetypeCount, MAX_ARCHETYPES);
+    GLint formations[MAX_ARCHETYPES * 3];
+    for(int i = 0; i < archetypeCount; ++i){
+        formations[i*3 + 0] = archetypes[i].count;
+        formations[i*3 + 1] = archetypes[i].spacing;
+        formations[i*3 + 2] = archetypes[i].weight;
+    }
+    glUniform1i(m_step.archetypeCount, archetypeCount);
+    glUniform3iv(m_step.archetypes, archetypeCount, formations);
+
+    state.BindVertexArray(m_stepVao[m_current]);
+    state.Enable(GL_RASTERIZER_DISCARD);
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, m_states[next]);
+    glBeginTransformFeedback(GL_POINTS);
+    glDrawArrays(GL_POINTS, 0, (GLsizei)m_count);
+    glEndTransformFeedback();
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+    state.Disable(GL_RASTERIZER_DISCARD);
+    m_current = next;
+}
+
+void GPUGameBatch::ReadResults(int* events, float* rewards) const{
+    if(m_count == 0){
+        return;
+    }
+    GLBackend& backend = GLBackend::Get();
+    const GPUGameState* states = (const GPUGameState*)backend.MapBufferRange(m_states[m_current], 0,
+                                                                              m_count * sizeof(GPUGameState), GL_MAP_READ_BIT);
+    if(states == nullptr){
+        std::cout << "GPUGameBatch.cpp: could not read the step results back\n";
+        return;
+    }
+    for(size_t i = 0; i < m_count; ++i){
+        events[i] = states[i].events;
+        rewards[i] = states[i].reward;
+    }
+    backend.UnmapBuffer(m_states[m_current]);
+}
+
+void GPUGameBatch::Release(){
+    m_stepProgram.Release();
+    GPUResourceTracker& tracker = GPUResourceTracker::Get();
+    GLuint* buffers[4] = {&m_states[0], &m_states[1], &m_parameters, &m_actions};
+    for(GLuint* buffer : buffers){
+        if(*buffer != 0){
+            glDeleteBuffers(1, buffer);
+            tracker.Deleted(GPU_BUFFER, *buffer);
+            *buffer = 0;
+        }
+    }
+    for(int i = 0; i < 2; ++i){
+        if(m_stepVao[i] != 0){
+            glDeleteVertexArrays(1, &m_stepVao[i]);
+            tracker.Deleted(GPU_VERTEX_ARRAY, m_stepVao[i]);
+            m_stepVao[i] = 0;
+        }
+    }
+    m_count = 0;
+    GLStateCache::Get().Invalidate();
+}
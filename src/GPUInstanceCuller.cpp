@@ -0,0 +1,257 @@
+#include "GPUInstanceCuller.hpp"
+#include "GLBackend.hpp"
+#include "GLStateCache.hpp"
+#include "GPUResourceTracker.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+
+// Texture unit the command pass reads the counts from
+const unsigned int CULL_COUNT_UNIT = 3;
+// Texels per row of the count target, rows as many as the commands need
+const GLsizei CULL_COUNT_WIDTH = 256;
+
+// Constructor
+GPUInstanceCuller::GPUInstanceCuller(){
+
+}
+
+// Destructor
+GPUInstanceCuller::~GPUInstanceCuller(){
+    if(m_instances != 0){
+        std::cout << "GPUInstanceCuller.cpp: buffers were never released\n";
+    }
+}
+
+bool GPUInstanceCuller::BuildShaders(const GPUCullShaders& shaders){
+    // The geometry shader drops the culled instances and writes the rest
+    m_cullProgram.SetGeometryShader(ShaderProgram::LoadShaderAsString(shaders.cullGeometry));
+    m_cullProgram.SetFeedbackVaryings({"v_positionScale", "v_material", "v_motion"});
+    if(!m_cullProgram.Build(ShaderProgram::LoadShaderAsString(shaders.cullVertex),
+                            ShaderProgram::LoadShaderAsString(shaders.cullFragment))){
+        std::cout << "GPUInstanceCuller.cpp: could not build the cull shaders\n";
+        return false;
+    }
+    // The commands only write the buffer, so they have no fragment shader
+    m_commandProgram.SetFeedbackVaryings({"v_command", "v_baseInstance"});
+    if(!m_commandProgram.Build(ShaderProgram::LoadShaderAsString(shaders.commands), "")){
+        std::cout << "GPUInstanceCuller.cpp: could not build the cull command shader\n";
+        return false;
+    }
+    m_cull.sphere      = m_cullProgram.GetUniformLocation("u_Sphere");
+    m_cull.planes      = m_cullProgram.GetUniformLocation("u_Planes[0]");
+    m_cull.command     = m_cullProgram.GetUniformLocation("u_Command");
+    m_cull.countSize   = m_cullProgram.GetUniformLocation("u_CountSize");
+    m_commandCounts    = m_commandProgram.GetUniformLocation("u_Counts");
+    m_commandCountSize = m_commandProgram.GetUniformLocation("u_CountSize");
+    return true;
+}
+
+bool GPUInstanceCuller::ReloadShaders(const GPUCullShaders& shaders){
+    return BuildShaders(shaders);
+}
+
+bool GPUInstanceCuller::Initialize(const DrawBatch& batch, size_t maxInstances, size_t maxCommands,
+                                   const GPUCullShaders& shaders){
+    Release();
+    if(!batch.UsesMultiDrawIndirect() || maxInstances == 0 || maxCommands == 0){
+        return false;
+    }
+    if(!BuildShaders(shaders)){
+        Release();
+        return false;
+    }
+    GLBackend& backend = GLBackend::Get();
+    GPUResourceTracker& tracker = GPUResourceTracker::Get();
+    m_maxInstances = maxInstances;
+    m_maxCommands = maxCommands;
+    size_t instanceBytes = maxInstances * sizeof(InstanceData);
+    size_t commandBytes = maxCommands * sizeof(DrawElementsIndirectCommand);
+    m_instances = backend.CreateBuffer();
+    backend.BufferData(m_instances, instanceBytes, nullptr, GL_DYNAMIC_COPY);
+    tracker.Created(GPU_BUFFER, m_instances, "culled instances", instanceBytes);
+    m_commands = backend.CreateBuffer();
+    backend.BufferData(m_commands, commandBytes, nullptr, GL_DYNAMIC_COPY);
+    tracker.Created(GPU_BUFFER, m_commands, "culled commands", commandBytes);
+
+    // Counts up to 2^24 add up exactly in a float
+    m_countWidth = CULL_COUNT_WIDTH;
+    m_countHeight = (GLsizei)((maxCommands + CULL_COUNT_WIDTH - 1) / CULL_COUNT_WIDTH);
+    glGenTextures(1, &m_countTexture);
+    GLStateCache::Get().BindTexture(CULL_COUNT_UNIT, GL_TEXTURE_2D, m_countTexture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, m_countWidth, m_countHeight, 0, GL_RED, GL_FLOAT, nullptr);
+    tracker.Created(GPU_TEXTURE, m_countTexture, "cull counts", (size_t)m_countWidth * m_countHeight * 4);
+    glGenFramebuffers(1, &m_countFramebuffer);
+    tracker.Created(GPU_FRAMEBUFFER, m_countFramebuffer, "cull counts framebuffer");
+    glBindFramebuffer(GL_FRAMEBUFFER, m_countFramebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_countTexture, 0);
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if(status != GL_FRAMEBUFFER_COMPLETE){
+        std::cout << "GPUInstanceCuller.cpp: count framebuffer incomplete (0x" << std::hex << status << std::dec << ")\n";
+        Release();
+        return false;
+    }
+
+    // Pointed at the batch's streams by Begin(), as they move every frame
+    m_cullVao = backend.CreateVertexArray();
+    tracker.Created(GPU_VERTEX_ARRAY, m_cullVao, "cull vertex array");
+    m_commandVao = backend.CreateVertexArray();
+    tracker.Created(GPU_VERTEX_ARRAY, m_commandVao, "cull command vertex array");
+    m_ranges.reserve(maxCommands);
+    std::cout << "GPUInstanceCuller.cpp: culling instances on the GPU\n";
+    return true;
+}
+
+void GPUInstanceCuller::Begin(const DrawBatch& batch){
+    m_ranges.clear();
+    m_culling = false;
+    if(!IsReady() || !batch.IsUploaded()){
+        return;
+    }
+    GLStateCache& state = GLStateCache::Get();
+    // Both passes read the batch's vertices as they were uploaded: three
+    // vec4s per instance, and the five integers of every command
+    state.BindVertexArray(m_cullVao);
+    glBindBuffer(GL_ARRAY_BUFFER, batch.GetBuffer());
+    for(GLuint location = 0; location < 3; ++location){
+        glEnableVertexAttribArray(location);
+        glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, (GLsizei)sizeof(InstanceData),
+                              (const GLvoid*)(batch.GetInstanceOffset() + location * 4 * sizeof(float)));
+    }
+    state.BindVertexArray(m_commandVao);
+    glEnableVertexAttribArray(0);
+    glVertexAttribIPointer(0, 4, GL_UNSIGNED_INT, (GLsizei)sizeof(DrawElementsIndirectCommand),
+                           (const GLvoid*)batch.GetCommandOffset());
+    glEnableVertexAttribArray(1);
+    glVertexAttribIPointer(1, 1, GL_UNSIGNED_INT, (GLsizei)sizeof(DrawElementsIndirectCommand),
+                           (const GLvoid*)(batch.GetCommandOffset() + offsetof(DrawElementsIndirectCommand, baseInstance)));
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // The counts start at zero and every survivor adds one
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &m_previousFramebuffer);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_countFramebuffer);
+    state.Disable(GL_SCISSOR_TEST);
+    state.Viewport(0, 0, m_countWidth, m_countHeight);
+    const GLfloat zero[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    glClearBufferfv(GL_COLOR, 0, zero);
+    state.Enable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE);
+    glDepthMask(GL_FALSE);
+    m_cullProgram.Use();
+    glUniform2i(m_cull.countSize, m_countWidth, m_countHeight);
+    state.BindVertexArray(m_cullVao);
+    m_culling = true;
+}
+
+void GPUInstanceCuller::Cull(const DrawBatch& batch, size_t first, size_t count, const BoundingSphere& sphere,
+                             const Frustum& frustum){
+    if(!m_culling || first >= batch.GetCommandCount()){
+        return;
+    }
+    count = std::min(count, batch.GetCommandCount() - first);
+    if(count == 0){
+        return;
+    }
+    glUniform4f(m_cull.sphere, sphere.center[0], sphere.center[1], sphere.center[2], sphere.radius);
+    glUniform4fv(m_cull.planes, 6, &frustum.planes[0][0]);
+    // Each command's survivors go to its own part of the buffer, so the
+    // captured range moves from one to the next
+    for(size_t i = first; i < first + count; ++i){
+        const DrawElementsIndirectCommand& command = batch.GetCommand(i);
+        glUniform1i(m_cull.command, (GLint)i);
+        glBindBufferRange(GL_TRANSFORM_FEEDBACK_BUFFER, 0, m_instances,
+                          (GLintptr)(command.baseInstance * sizeof(InstanceData)),
+                          (GLsizeiptr)(command.instanceCount * sizeof(InstanceData)));
+        glBeginTransformFeedback(GL_POINTS);
+        glDrawArrays(GL_POINTS, (GLint)command.baseInstance, (GLsizei)command.instanceCount);
+        glEndTransformFeedback();
+    }
+    m_ranges.push_back(CulledRange{first, count});
+}
+
+void GPUInstanceCuller::End(){
+    if(!m_culling){
+        return;
+    }
+    m_culling = false;
+    GLStateCache& state = GLStateCache::Get();
+    glDepthMask(GL_TRUE);
+    state.Disable(GL_BLEND);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, (GLuint)m_previousFramebuffer);
+
+    // One vertex per command: the command again, with its count
+    m_commandProgram.Use();
+    glUniform1i(m_commandCounts, (GLint)CULL_COUNT_UNIT);
+    glUniform2i(m_commandCountSize, m_countWidth, m_countHeight);
+    state.BindTexture(CULL_COUNT_UNIT, GL_TEXTURE_2D, m_countTexture);
+    state.BindVertexArray(m_commandVao);
+    state.Enable(GL_RASTERIZER_DISCARD);
+    for(const CulledRange& range : m_ranges){
+        glBindBufferRange(GL_TRANSFORM_FEEDBACK_BUFFER, 0, m_commands,
+                          (GLintptr)(range.first * sizeof(DrawElementsIndirectCommand)),
+                          (GLsizeiptr)(range.count * sizeof(DrawElementsIndirectCommand)));
+        glBeginTransformFeedback(GL_POINTS);
+        glDrawArrays(GL_POINTS, (GLint)range.first, (GLsizei)range.count);
+        glEndTransformFeedback();
+    }
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+    state.Disable(GL_RASTERIZER_DISCARD);
+    state.BindVertexArray(0);
+}
+
+bool GPUInstanceCuller::WasCulled(size_t first, size_t count) const{
+    for(const CulledRange& range : m_ranges){
+        if(first >= range.first && first + count <= range.first + range.count){
+            return true;
+        }
+    }
+    return false;
+}
+
+bool GPUInstanceCuller::DrawCommands(DrawBatch& batch, size_t first, size_t count){
+    if(count == 0){
+        return true;
+    }
+    if(!IsReady() || !WasCulled(first, count)){
+        return false;
+    }
+    return batch.DrawCommandsFrom(m_instances, m_commands, first, count);
+}
+
+void GPUInstanceCuller::Release(){
+    m_cullProgram.Release();
+    m_commandProgram.Release();
+    GPUResourceTracker& tracker = GPUResourceTracker::Get();
+    for(GLuint* buffer : {&m_instances, &m_commands}){
+        if(*buffer != 0){
+            glDeleteBuffers(1, buffer);
+            tracker.Deleted(GPU_BUFFER, *buffer);
+            *buffer = 0;
+        }
+    }
+    if(m_countFramebuffer != 0){
+        glDeleteFramebuffers(1, &m_countFramebuffer);
+        tracker.Deleted(GPU_FRAMEBUFFER, m_countFramebuffer);
+        m_countFramebuffer = 0;
+    }
+    if(m_countTexture != 0){
+        glDeleteTextures(1, &m_countTexture);
+        tracker.Deleted(GPU_TEXTURE, m_countTexture);
+        m_countTexture = 0;
+    }
+    for(GLuint* vao : {&m_cullVao, &m_commandVao}){
+        if(*vao != 0){
+            glDeleteVertexArrays(1, vao);
+            tracker.Deleted(GPU_VERTEX_ARRAY, *vao);
+            *vao = 0;
+        }
+    }
+    m_ranges.clear();
+    m_culling = false;
+    GLStateCache::Get().Invalidate();
+}
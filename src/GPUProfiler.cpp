@@ -0,0 +1,222 @@
+#include "GPUProfiler.hpp"
+#include "FlightRecorder.hpp"
+#include "GPUResourceTracker.hpp"
+#include "TraceRecorder.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+// Constructor
+GPUProfiler::GPUProfiler(){
+
+}
+
+// Destructor
+GPUProfiler::~GPUProfiler(){
+    if(m_initialized){
+        std::cout << "GPUProfiler.cpp: queries were never released\n";
+    }
+}
+
+int GPUProfiler::AddPass(const std::string& name){
+    Pass pass;
+    pass.name = name;
+    for(int set = 0; set < QUERY_FRAMES; ++set){
+        pass.queries[set][0] = 0;
+        pass.queries[set][1] = 0;
+        pass.issued[set] = false;
+    }
+    pass.samples.reserve(WINDOW_SIZE);
+    pass.nextSample = 0;
+    pass.traceName = -1;
+    pass.flightName = -1;
+    m_passes.push_back(pass);
+    return (int)m_passes.size() - 1;
+}
+
+void GPUProfiler::Initialize(){
+    for(Pass& pass : m_passes){
+        for(int set = 0; set < QUERY_FRAMES; ++set){
+            glGenQueries(2, pass.queries[set]);
+            GPUResourceTracker::Get().Created(GPU_QUERY, pass.queries[set][0], "pass begin timestamp");
+            GPUResourceTracker::Get().Created(GPU_QUERY, pass.queries[set][1], "pass end timestamp");
+        }
+    }
+    if(m_trace != nullptr){
+        GLint64 now = 0;
+        glGetInteger64v(GL_TIMESTAMP, &now);
+        m_trace->SyncGPUClock(now);
+    }
+    if(m_flight != nullptr){
+        GLint64 now = 0;
+        glGetInteger64v(GL_TIMESTAMP, &now);
+        m_flight->SyncGPUClock(now);
+    }
+    m_frame = 0;
+    m_initialized = true;
+}
+
+void GPUProfiler::SetTrace(TraceRecorder* trace){
+    m_trace = trace;
+    if(m_trace != nullptr){
+        for(Pass& pass : m_passes){
+            pass.traceName = m_trace->AddName(pass.name);
+        }
+    }
+}
+
+void GPUProfiler::SetFlightRecorder(FlightRecorder* flight){
+    m_flight = flight;
+    if(m_flight != nullptr){
+        for(Pass& pass : m_passes){
+            pass.flightName = m_flight->AddName(pass.name);
+        }
+    }
+}
+
+bool GPUProfiler::OpenCSV(const std::string& filepath){
+    m_csv.open(filepath.c_str(), std::ios::trunc);
+    if(!m_csv.is_open()){
+        std::cout << "GPUProfiler.cpp: could not open " << filepath << "\n";
+        return false;
+    }
+    m_csv << "frame";
+    for(const Pass& pass : m_passes){
+        m_csv << "," << pass.name << "_ms";
+    }
+    m_csv << "\n";
+    return true;
+}
+
+void GPUProfiler::BeginFrame(){
+    if(!m_initialized){
+        return;
+    }
+    int set = m_frame % QUERY_FRAMES;
+    m_frameTimes.assign(m_passes.size(), -1.0);
+    bool collected = false;
+    for(size_t i = 0; i < m_passes.size(); ++i){
+        Pass& pass = m_passes[i];
+        if(!pass.issued[set]){
+            continue;
+        }
+        pass.issued[set] = false;
+        // Never wait: a result that is not ready yet is dropped
+        GLint available = 0;
+        glGetQueryObjectiv(pass.queries[set][1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if(!available){
+            continue;
+        }
+        GLuint64 begin = 0;
+        GLuint64 end = 0;
+        glGetQueryObjectui64v(pass.queries[set][0], GL_QUERY_RESULT, &begin);
+        glGetQueryObjectui64v(pass.queries[set][1], GL_QUERY_RESULT, &end);
+        if(m_trace != nullptr){
+            m_trace->AddGPUPass(pass.traceName, begin, end);
+        }
+        if(m_flight != nullptr){
+            m_flight->AddGPUPass(pass.flightName, begin, end);
+        }
+        double milliseconds = (end - begin) / 1000000.0;
+        if(pass.samples.size() < WINDOW_SIZE){
+            pass.samples.push_back(milliseconds);
+        }else{
+            pass.samples[pass.nextSample] = milliseconds;
+        }
+        pass.nextSample = (pass.nextSample + 1) % WINDOW_SIZE;
+        m_frameTimes[i] = milliseconds;
+        collected = true;
+    }
+
+    if(collected && m_csv.is_open()){
+        m_csv << (m_frame - QUERY_FRAMES);
+        for(double milliseconds : m_frameTimes){
+            m_csv << ",";
+            if(milliseconds >= 0.0){
+                m_csv << milliseconds;
+            }
+        }
+        m_csv << "\n";
+    }
+}
+
+void GPUProfiler::BeginPass(int pass){
+    if(!m_initialized || pass < 0 || pass >= (int)m_passes.size()){
+        return;
+    }
+    glQueryCounter(m_passes[pass].queries[m_frame % QUERY_FRAMES][0], GL_TIMESTAMP);
+}
+
+void GPUProfiler::EndPass(int pass){
+    if(!m_initialized || pass < 0 || pass >= (int)m_passes.size()){
+        return;
+    }
+    int set = m_frame % QUERY_FRAMES;
+    glQueryCounter(m_passes[pass].queries[set][1], GL_TIMESTAMP);
+    m_passes[pass].issued[set] = true;
+}
+
+void GPUProfiler::EndFrame(){
+    ++m_frame;
+}
+
+double GPUProfiler::GetCollectedFrameTime() const{
+    double total = -1.0;
+    for(double milliseconds : m_frameTimes){
+        if(milliseconds >= 0.0){
+            total = (total < 0.0) ? milliseconds : total + milliseconds;
+        }
+    }
+    return total;
+}
+
+double GPUProfiler::GetPassMean(int pass) const{
+    if(pass < 0 || pass >= (int)m_passes.size() || m_passes[pass].samples.empty()){
+        return -1.0;
+    }
+    double total = 0.0;
+    for(double sample : m_passes[pass].samples){
+        total += sample;
+    }
+    return total / m_passes[pass].samples.size();
+}
+
+void GPUProfiler::Report() const{
+    std::cout << "GPU passes (ms):";
+    for(const Pass& pass : m_passes){
+        if(pass.samples.empty()){
+            std::cout << " " << pass.name << " n/a";
+            continue;
+        }
+        double total = 0.0;
+        for(double sample : pass.samples){
+            total += sample;
+        }
+        std::vector<double> sorted = pass.samples;
+        size_t p99 = (sorted.size() * 99) / 100;
+        if(p99 >= sorted.size()){
+            p99 = sorted.size() - 1;
+        }
+        std::nth_element(sorted.begin(), sorted.begin() + p99, sorted.end());
+        std::cout << " " << pass.name << " mean " << total / pass.samples.size()
+                  << " p99 " << sorted[p99];
+    }
+    std::cout << "\n";
+}
+
+void GPUProfiler::Release(){
+    if(m_initialized){
+        for(Pass& pass : m_passes){
+            for(int set = 0; set < QUERY_FRAMES; ++set){
+                glDeleteQueries(2, pass.queries[set]);
+                GPUResourceTracker::Get().Deleted(GPU_QUERY, pass.queries[set][0]);
+                GPUResourceTracker::Get().Deleted(GPU_QUERY, pass.queries[set][1]);
+                pass.issued[set] = false;
+            }
+        }
+        m_initialized = false;
+    }
+    if(m_csv.is_open()){
+        m_csv.close();
+    }
+}
@@ -0,0 +1,134 @@
+#include "GPUResourceTracker.hpp"
+
+#include <iostream>
+
+static const char* TYPE_NAMES[GPU_RESOURCE_TYPES] = {
+    "buffers", "textures", "vertex arrays", "programs",
+    "shaders", "renderbuffers", "framebuffers", "queries"
+};
+
+const char* GPUResourceTracker::GetTypeName(GPUResourceType type){
+    return TYPE_NAMES[type];
+}
+
+// Context of the calling thread's objects
+static thread_local unsigned int sContext = 0;
+
+GPUResourceTracker& GPUResourceTracker::Get(){
+    static GPUResourceTracker tracker;
+    return tracker;
+}
+
+void GPUResourceTracker::SetContext(unsigned int context){
+    sContext = context;
+}
+
+uint64_t GPUResourceTracker::GetKey(GPUResourceType type, GLuint name){
+    bool shared = type != GPU_VERTEX_ARRAY && type != GPU_FRAMEBUFFER && type != GPU_QUERY;
+    return shared ? (uint64_t)name : ((uint64_t)sContext << 32 | name);
+}
+
+// Constructor
+GPUResourceTracker::GPUResourceTracker(){
+    for(int type = 0; type < GPU_RESOURCE_TYPES; ++type){
+        m_bytes[type] = 0;
+        m_created[type] = 0;
+    }
+}
+
+// Destructor
+GPUResourceTracker::~GPUResourceTracker(){
+
+}
+
+void GPUResourceTracker::Created(GPUResourceType type, GLuint name, const char* label, size_t bytes){
+    if(name == 0){
+        return;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Resource& resource = m_resources[type][GetKey(type, name)];
+    // A name the driver handed out again without us seeing the delete
+    m_bytes[type] -= resource.bytes;
+    resource.label = label;
+    resource.bytes = bytes;
+    m_bytes[type] += bytes;
+    ++m_created[type];
+}
+
+void GPUResourceTracker::Resized(GPUResourceType type, GLuint name, size_t bytes){
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_resources[type].find(GetKey(type, name));
+    if(it == m_resources[type].end()){
+        return;
+    }
+    m_bytes[type] = m_bytes[type] - it->second.bytes + bytes;
+    it->second.bytes = bytes;
+}
+
+void GPUResourceTracker::Deleted(GPUResourceType type, GLuint name){
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_resources[type].find(GetKey(type, name));
+    if(it == m_resources[type].end()){
+        return;
+    }
+    m_bytes[type] -= it->second.bytes;
+    m_resources[type].erase(it);
+}
+
+size_t GPUResourceTracker::GetCount(GPUResourceType type) const{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_resources[type].size();
+}
+
+size_t GPUResourceTracker::GetBytes(GPUResourceType type) const{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_bytes[type];
+}
+
+size_t GPUResourceTracker::GetTotalBytes() const{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return SumBytes();
+}
+
+size_t GPUResourceTracker::SumBytes() const{
+    size_t total = 0;
+    for(int type = 0; type < GPU_RESOURCE_TYPES; ++type){
+        total += m_bytes[type];
+    }
+    return total;
+}
+
+void GPUResourceTracker::Report() const{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::cout << "GPU objects: " << SumBytes() / 1024 << " KiB live";
+    for(int type = 0; type < GPU_RESOURCE_TYPES; ++type){
+        if(m_created[type] == 0){
+            continue;
+        }
+        std::cout << "\n  " << TYPE_NAMES[type] << " " << m_resources[type].size()
+                  << " live (" << m_bytes[type] / 1024 << " KiB), " << m_created[type] << " created";
+    }
+    std::cout << "\n";
+}
+
+size_t GPUResourceTracker::ReportLeaks() const{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    size_t leaks = 0;
+    for(int type = 0; type < GPU_RESOURCE_TYPES; ++type){
+        for(const auto& entry : m_resources[type]){
+            if(leaks == 0){
+                std::cout << "GPUResourceTracker.cpp: GL objects never deleted:\n";
+            }
+            std::cout << "  " << TYPE_NAMES[type] << " " << (GLuint)entry.first;
+            if((entry.first >> 32) != 0){
+                std::cout << " of context " << (entry.first >> 32);
+            }
+            std::cout << " (" << entry.second.label << ", " << entry.second.bytes << " bytes)\n";
+            ++leaks;
+        }
+    }
+    if(leaks > 0){
+        std::cout << "  " << leaks << " objects, " << SumBytes() << " bytes\n";
+    }
+    return leaks;
+}
@@ -0,0 +1,343 @@
+#include "GameState.hpp"
+#include "Collision.hpp"
+#include "SpawnSchedule.hpp"
+
+#include <algorithm>
+
+// Formations the spawner picks from, all made of the one cactus mesh
+static const ObstacleArchetype OBSTACLE_ARCHETYPES[] = {
+    {1, 0, 5},      // Lone cactus
+    {2, 40, 2},     // Pair
+    {3, 36, 1},     // Cluster, jumpable at the highest point of a jump
+};
+static const int ARCHETYPE_COUNT = sizeof(OBSTACLE_ARCHETYPES)/sizeof(OBSTACLE_ARCHETYPES[0]);
+
+const ObstacleArchetype* GetObstacleArchetypes(int& count){
+    count = ARCHETYPE_COUNT;
+    return OBSTACLE_ARCHETYPES;
+}
+
+// Index of the archetype a roll picks, by weight
+static int PickArchetype(uint32_t roll){
+    int totalWeight = 0;
+    for(int i = 0; i < ARCHETYPE_COUNT; ++i){
+        totalWeight += OBSTACLE_ARCHETYPES[i].weight;
+    }
+    int weight = (int)(roll % (uint32_t)totalWeight);
+    int i = 0;
+    while(weight >= OBSTACLE_ARCHETYPES[i].weight){
+        weight -= OBSTACLE_ARCHETYPES[i].weight;
+        ++i;
+    }
+    return i;
+}
+
+SpawnDraw DrawSpawn(GameRandom& rng){
+    SpawnDraw draw;
+    draw.archetype = PickArchetype(NextGameRandom(rng));
+    draw.gapRoll = NextGameRandom(rng);
+    draw.speedRoll = NextGameRandom(rng);
+    draw.rng = rng;
+    return draw;
+}
+
+void SpawnObstacles(ObstacleLane& obstacles, int& scroll, int& spawnDistance, int& cactusSpeed, GameRandom& rng,
+                    const GameParameters& parameters, SpawnScriptFrame* script, SpawnSchedule* schedule,
+                    size_t index){
+    AdvanceObstacleLane(obstacles, -scroll);
+    scroll = 0;
+    RemoveObstaclesBefore(obstacles, OBSTACLE_DESPAWN_X);
+    while(spawnDistance <= 0){
+        SpawnGroup group;
+        uint32_t speedRoll;
+        if(script != nullptr && ResumeSpawnScript(*script, rng, group)){
+            speedRoll = NextGameRandom(rng);
+        }else{
+            SpawnDraw draw = (schedule != nullptr) ? schedule->Take(index, rng) : DrawSpawn(rng);
+            const ObstacleArchetype& archetype = OBSTACLE_ARCHETYPES[draw.archetype];
+            int gap = (int)(draw.gapRoll % (uint32_t)parameters.spawnGapRange) + parameters.spawnGapMin;
+            group = SpawnGroup{archetype.count, archetype.spacing, 0, gap};
+            speedRoll = draw.speedRoll;
+        }
+        // Keep what the lane overshot, so gaps do not depend on the speed
+        int x = OBSTACLE_SPAWN_X + spawnDistance;
+        for(int i = 0; i < group.count; ++i){
+            // The lane holds more than the screen can show; a full lane
+            // just drops the rest of the group
+            InsertObstacle(obstacles, x + i*group.spacing, group.height);
+        }
+        // A script's pause of no length would spawn forever
+        spawnDistance += std::max(0, group.count - 1)*group.spacing + std::max(1, group.gap);
+        cactusSpeed = (int)(speedRoll % (uint32_t)cactusSpeed) + parameters.spawnSpeedMin;
+    }
+}
+
+int GetLeadObstacle(const ObstacleLane& obstacles, int scroll){
+    LaneWindow ahead = FindLaneWindow(obstacles, GetCollisionRules().hitRange.minX + scroll, INT32_MAX);
+    if(ahead.count == 0){
+        return NO_OBSTACLE;
+    }
+    return obstacles.x[GetLaneSlot(obstacles, ahead.first)] - scroll;
+}
+
+int GetLeadFormation(const ObstacleLane& obstacles, int scroll){
+    LaneWindow ahead = FindLaneWindow(obstacles, GetCollisionRules().hitRange.minX + scroll, INT32_MAX);
+    if(ahead.count == 0){
+        return 0;
+    }
+    // The gaps between groups are far wider than any spacing within one,
+    // so the group is the run of obstacles at most that far apart
+    int spacing = 0;
+    for(int i = 0; i < ARCHETYPE_COUNT; ++i){
+        spacing = std::max(spacing, OBSTACLE_ARCHETYPES[i].spacing);
+    }
+    uint32_t first = ahead.first;
+    while(first > 0 && obstacles.x[GetLaneSlot(obstacles, first)] - obstacles.x[GetLaneSlot(obstacles, first - 1)] <= spacing){
+        --first;
+    }
+    uint32_t last = ahead.first;
+    while(last + 1 < obstacles.count && obstacles.x[GetLaneSlot(obstacles, last + 1)] - obstacles.x[GetLaneSlot(obstacles, last)] <= spacing){
+        ++last;
+    }
+    return (int)(last - first + 1);
+}
+
+void ResetGameState(GameState& state, uint64_t seed, uint64_t stream, const GameParameters& parameters){
+    state = GameState();
+    state.cactusSpeed = parameters.cactusSpeed;
+    state.jumpingSpeed = parameters.jumpingSpeed;
+    SeedGameRandom(state.rng, seed, stream);
+}
+
+template<typename Rules>
+unsigned int Step(GameState& state, GameAction action, int ticks, const GameParameters& runtime,
+                  SpawnScriptFrame* script){
+    // Constants for fixed rules, so every compare against them folds
+    const GameParameters& parameters = GetRuleParameters<Rules>(runtime);
+    if(state.gameOver){
+        return EVENT_NONE;
+    }
+    unsigned int events = EVENT_NONE;
+    const int startHeight = state.dinoHeight;
+
+    state.tick = state.tick + ticks;
+    state.dayTick += ticks;
+
+    if(state.dayTick >= parameters.dayLength) {
+        state.dayTick -= parameters.dayLength;
+        state.isDaytime = !state.isDaytime;
+        state.cactusSpeed += parameters.daySpeedup;
+        state.jumpingSpeed += parameters.daySpeedup;
+        events |= EVENT_DAY_CHANGED;
+    }
+
+    const int moved = state.cactusSpeed * ticks;
+    state.scroll = state.scroll + moved;
+    state.spawnDistance = state.spawnDistance - moved;
+
+    if (state.spawnDistance <= 0) {
+        SpawnObstacles(state.obstacles, state.scroll, state.spawnDistance, state.cactusSpeed, state.rng, parameters,
+                       script);
+    }
+
+    // Jump logic
+    if (action == ACTION_JUMP && !state.isJumping) {
+        state.isJumping = true;
+        state.dinoHeight = 1;
+    }
+    if (state.isJumping) {
+        if (state.jumpingUp) {
+            state.dinoHeight = state.dinoHeight + state.jumpingSpeed * ticks;
+            if (state.dinoHeight >= parameters.jumpApex) {
+                state.jumpingUp = false;
+            }
+        } else {
+            state.dinoHeight = state.dinoHeight - state.jumpingSpeed * ticks;
+            if (state.dinoHeight <= 0) {
+                state.jumpingUp = true;
+                state.isJumping = false;
+            }
+        }
+    }
+    // Collision logic, swept over the step: along the lane the dino went
+    // from scroll - moved to scroll (spawning may have rebased both) and
+    // from startHeight to dinoHeight
+    const CollisionRules& rules = GetCollisionRules();
+    if (!state.invincible &&
+        FindFirstSweptLaneHit(state.obstacles, rules, state.scroll - moved, startHeight,
+                              state.scroll, state.dinoHeight) < state.obstacles.count) {
+        state.gameOver = true;
+        events |= EVENT_GAME_OVER;
+    }
+    return events;
+}
+
+template<typename Rules>
+unsigned int StepRepeated(GameState& state, GameAction action, int repeat, float* reward, int ticks,
+                          const GameParameters& parameters){
+    unsigned int events = EVENT_NONE;
+    float total = 0.0f;
+    for(int i = 0; i < repeat && !state.gameOver; ++i){
+        unsigned int stepEvents = Step<Rules>(state, action, ticks, parameters);
+        total += (stepEvents & EVENT_GAME_OVER) ? REWARD_GAME_OVER : REWARD_SURVIVED;
+        events |= stepEvents;
+    }
+    if(reward != nullptr){
+        *reward += total;
+    }
+    return events;
+}
+
+template unsigned int Step<RuntimeGameRules>(GameState&, GameAction, int, const GameParameters&, SpawnScriptFrame*);
+template unsigned int Step<ShippedGameRules>(GameState&, GameAction, int, const GameParameters&, SpawnScriptFrame*);
+template unsigned int StepRepeated<RuntimeGameRules>(GameState&, GameAction, int, float*, int, const GameParameters&);
+template unsigned int StepRepeated<ShippedGameRules>(GameState&, GameAction, int, float*, int, const GameParameters&);
+
+unsigned int Step(GameState& state, GameAction action, int ticks, const GameParameters& parameters,
+                  SpawnScriptFrame* script){
+    return Step<RuntimeGameRules>(state, action, ticks, parameters, script);
+}
+
+unsigned int StepRepeated(GameState& state, GameAction action, int repeat, float* reward, int ticks,
+                          const GameParameters& parameters){
+    return StepRepeated<RuntimeGameRules>(state, action, repeat, reward, ticks, parameters);
+}
+
+int GetJumpTicks(const GameState& state, const GameParameters& parameters){
+    const int speed = std::max(1, state.jumpingSpeed);
+    // The first tick lifts the dino to 1 and rises from there, as Step()
+    // does; it then rises until it reaches the apex and falls back to 0
+    const int rising = std::max(1, (parameters.jumpApex - 1 + speed - 1) / speed);
+    const int apex = 1 + rising * speed;
+    const int falling = (apex + speed - 1) / speed;
+    return rising + falling;
+}
+
+int GetEventHorizon(const GameState& state, const GameParameters& parameters){
+    if(state.gameOver || state.isJumping){
+        return 0;
+    }
+    const int speed = state.cactusSpeed;
+    // The tick the day changes at is stepped as usual
+    int horizon = parameters.dayLength - state.dayTick - 1;
+    // So is the tick the lane spawns at: after k ticks spawnDistance is
+    // spawnDistance - k*speed, which must stay above 0
+    if(speed > 0){
+        horizon = std::min(horizon, (state.spawnDistance - 1) / speed);
+    }
+    // Obstacles that passed the dino's hit box cannot be hit any more.
+    // The lead one must stay further than a jump started on the last
+    // skipped tick could reach, which keeps it out of the hit range too.
+    int lead = GetLeadObstacle(state.obstacles, state.scroll);
+    if(lead != NO_OBSTACLE){
+        const int reach = GetCollisionRules().hitRange.maxX + speed * GetJumpTicks(state, parameters);
+        if(lead <= reach){
+            return 0;
+        }
+        if(speed > 0){
+            horizon = std::min(horizon, (lead - reach - 1) / speed);
+        }
+    }
+    return std::max(0, horizon);
+}
+
+int FastForward(GameState& state, int ticks, const GameParameters& parameters){
+    ticks = std::min(ticks, GetEventHorizon(state, parameters));
+    if(ticks <= 0){
+        return 0;
+    }
+    state.tick += ticks;
+    state.dayTick += ticks;
+    const int moved = state.cactusSpeed * ticks;
+    state.scroll += moved;
+    state.spawnDistance -= moved;
+    return ticks;
+}
+
+int GetStepDistance(const GameState& state, int ticks, const GameParameters& parameters){
+    if(state.gameOver){
+        return 0;
+    }
+    // Step() speeds up at a day change before it moves
+    int speed = state.cactusSpeed;
+    if(state.dayTick + ticks >= parameters.dayLength){
+        speed += parameters.daySpeedup;
+    }
+    return speed * ticks;
+}
+
+void CloneGameState(const GameState& parent, GameState* children, size_t count){
+    for(size_t i = 0; i < count; ++i){
+        std::memcpy(&children[i], &parent, sizeof(GameState));
+    }
+}
+
+// Mixes the bytes of one value into an FNV-1a hash
+static void HashValue(uint64_t& hash, uint64_t value, int bytes){
+    for(int i = 0; i < bytes; ++i){
+        hash ^= (value >> (8*i)) & 0xff;
+        hash *= 1099511628211ULL;
+    }
+}
+
+uint64_t HashGameState(const GameState& state){
+    // Field by field, so padding never reaches the hash
+    uint64_t hash = 14695981039346656037ULL;
+    HashValue(hash, (uint32_t)state.tick, 4);
+    HashValue(hash, (uint32_t)state.dayTick, 4);
+    HashValue(hash, state.isDaytime, 1);
+    HashValue(hash, (uint32_t)state.dinoHeight, 4);
+    HashValue(hash, state.isJumping, 1);
+    HashValue(hash, state.jumpingUp, 1);
+    HashValue(hash, (uint32_t)state.jumpingSpeed, 4);
+    HashValue(hash, (uint32_t)state.scroll, 4);
+    HashValue(hash, (uint32_t)state.spawnDistance, 4);
+    HashValue(hash, (uint32_t)state.cactusSpeed, 4);
+    // Obstacles in lane order, unused slots never reach the hash
+    HashValue(hash, state.obstacles.count, 4);
+    for(uint32_t i = 0; i < state.obstacles.count; ++i){
+        uint32_t slot = GetLaneSlot(state.obstacles, i);
+        HashValue(hash, (uint32_t)state.obstacles.x[slot], 4);
+        HashValue(hash, (uint32_t)state.obstacles.y[slot], 4);
+    }
+    HashValue(hash, state.gameOver, 1);
+    HashValue(hash, state.invincible, 1);
+    HashValue(hash, state.rng.state, 8);
+    HashValue(hash, state.rng.increment, 8);
+    return hash;
+}
+
+// dest is "<field> <a> vs <b>" if a and b differ and dest is still empty
+template<typename T>
+static void DescribeField(std::string& dest, const std::string& field, T a, T b){
+    if(dest.empty() && a != b){
+        dest = field + " " + std::to_string(a) + " vs " + std::to_string(b);
+    }
+}
+
+std::string DescribeGameStateDifference(const GameState& a, const GameState& b){
+    // In the order HashGameState() mixes them
+    std::string difference;
+    DescribeField(difference, "tick", a.tick, b.tick);
+    DescribeField(difference, "dayTick", a.dayTick, b.dayTick);
+    DescribeField(difference, "isDaytime", (int)a.isDaytime, (int)b.isDaytime);
+    DescribeField(difference, "dinoHeight", a.dinoHeight, b.dinoHeight);
+    DescribeField(difference, "isJumping", (int)a.isJumping, (int)b.isJumping);
+    DescribeField(difference, "jumpingUp", (int)a.jumpingUp, (int)b.jumpingUp);
+    DescribeField(difference, "jumpingSpeed", a.jumpingSpeed, b.jumpingSpeed);
+    DescribeField(difference, "scroll", a.scroll, b.scroll);
+    DescribeField(difference, "spawnDistance", a.spawnDistance, b.spawnDistance);
+    DescribeField(difference, "cactusSpeed", a.cactusSpeed, b.cactusSpeed);
+    DescribeField(difference, "obstacles.count", a.obstacles.count, b.obstacles.count);
+    for(uint32_t i = 0; i < a.obstacles.count && i < b.obstacles.count; ++i){
+        uint32_t slotA = GetLaneSlot(a.obstacles, i);
+        uint32_t slotB = GetLaneSlot(b.obstacles, i);
+        DescribeField(difference, "obstacle " + std::to_string(i) + " x", a.obstacles.x[slotA], b.obstacles.x[slotB]);
+        DescribeField(difference, "obstacle " + std::to_string(i) + " y", a.obstacles.y[slotA], b.obstacles.y[slotB]);
+    }
+    DescribeField(difference, "gameOver", (int)a.gameOver, (int)b.gameOver);
+    DescribeField(difference, "invincible", (int)a.invincible, (int)b.invincible);
+    DescribeField(difference, "rng.state", (unsigned long long)a.rng.state, (unsigned long long)b.rng.state);
+    DescribeField(difference, "rng.increment", (unsigned long long)a.rng.increment, (unsigned long long)b.rng.increment);
+    return difference;
+}
@@ -0,0 +1,490 @@
+#include "GameStateBatch.hpp"
+#include "SimdLanes.hpp"
+#include "Collision.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+static const char CHECKPOINT_MAGIC[4] = {'D', 'B', 'A', 'T'};
+// Bumped whenever a column is added or changes meaning
+static const uint32_t CHECKPOINT_VERSION = 3;
+
+// The mask form of a flag
+static inline int Mask(bool flag){
+    return flag ? ~0 : 0;
+}
+
+// Constructor
+GameStateBatch::GameStateBatch(){
+
+}
+
+// Destructor
+GameStateBatch::~GameStateBatch(){
+
+}
+
+void GameStateBatch::Resize(size_t count){
+    size_t oldCount = m_count;
+    for(size_t i = count; i < oldCount; ++i){
+        m_scripts.Release(m_scriptFrame[i]);
+    }
+    m_count = count;
+    m_tick.resize(count);
+    m_dayTick.resize(count);
+    m_isDaytime.resize(count);
+    m_dinoHeight.resize(count);
+    m_isJumping.resize(count);
+    m_jumpingUp.resize(count);
+    m_jumpingSpeed.resize(count);
+    m_scroll.resize(count);
+    m_spawnDistance.resize(count);
+    m_cactusSpeed.resize(count);
+    m_leadObstacle.resize(count);
+    m_obstacles.resize(count);
+    m_obstacleTop.resize(count);
+    m_gameOver.resize(count);
+    m_invincible.resize(count);
+    m_rng.resize(count);
+    m_startCactusSpeed.resize(count);
+    m_startJumpingSpeed.resize(count);
+    m_jumpApex.resize(count);
+    m_dayLength.resize(count);
+    m_daySpeedup.resize(count);
+    m_spawnGapMin.resize(count);
+    m_spawnGapRange.resize(count);
+    m_spawnSpeedMin.resize(count);
+    m_spawnScript.resize(count, SPAWN_SCRIPT_NONE);
+    m_scriptFrame.resize(count, SpawnScriptPool::NO_FRAME);
+    // A frame for every environment, so Reset() always finds one
+    m_scripts.Reserve(count);
+    m_schedule.Resize(count);
+    m_events.resize(count);
+    m_repeatEvents.resize(count);
+    m_rewards.resize(count);
+    for(size_t i = oldCount; i < count; ++i){
+        SetParameters(i, DEFAULT_GAME_PARAMETERS);
+        Reset(i, 1, i);
+    }
+}
+
+void GameStateBatch::Reset(size_t index, uint64_t seed, uint64_t stream){
+    GameState state;
+    ResetGameState(state, seed, stream, GetParameters(index));
+    Set(index, state);
+    m_scripts.Release(m_scriptFrame[index]);
+    m_scriptFrame[index] = (m_spawnScript[index] != SPAWN_SCRIPT_NONE)
+                         ? m_scripts.Acquire((uint16_t)m_spawnScript[index]) : SpawnScriptPool::NO_FRAME;
+}
+
+SpawnScriptFrame GameStateBatch::GetScriptFrame(size_t index) const{
+    uint32_t frame = m_scriptFrame[index];
+    return (frame != SpawnScriptPool::NO_FRAME) ? m_scripts.Get(frame) : SpawnScriptFrame();
+}
+
+void GameStateBatch::ResetAll(uint64_t seed){
+    for(size_t i = 0; i < m_count; ++i){
+        Reset(i, seed, i);
+    }
+}
+
+void GameStateBatch::SetParameters(size_t index, const GameParameters& parameters){
+    m_startCactusSpeed[index] = parameters.cactusSpeed;
+    m_startJumpingSpeed[index] = parameters.jumpingSpeed;
+    m_jumpApex[index] = parameters.jumpApex;
+    m_dayLength[index] = parameters.dayLength;
+    m_daySpeedup[index] = parameters.daySpeedup;
+    m_spawnGapMin[index] = parameters.spawnGapMin;
+    m_spawnGapRange[index] = parameters.spawnGapRange;
+    m_spawnSpeedMin[index] = parameters.spawnSpeedMin;
+}
+
+GameParameters GameStateBatch::GetParameters(size_t index) const{
+    GameParameters parameters;
+    parameters.cactusSpeed = m_startCactusSpeed[index];
+    parameters.jumpingSpeed = m_startJumpingSpeed[index];
+    parameters.jumpApex = m_jumpApex[index];
+    parameters.dayLength = m_dayLength[index];
+    parameters.daySpeedup = m_daySpeedup[index];
+    parameters.spawnGapMin = m_spawnGapMin[index];
+    parameters.spawnGapRange = m_spawnGapRange[index];
+    parameters.spawnSpeedMin = m_spawnSpeedMin[index];
+    return parameters;
+}
+
+GameState GameStateBatch::Get(size_t index) const{
+    GameState state;
+    state.tick = m_tick[index];
+    state.dayTick = m_dayTick[index];
+    state.isDaytime = m_isDaytime[index] != 0;
+    state.dinoHeight = m_dinoHeight[index];
+    state.isJumping = m_isJumping[index] != 0;
+    state.jumpingUp = m_jumpingUp[index] != 0;
+    state.jumpingSpeed = m_jumpingSpeed[index];
+    state.scroll = m_scroll[index];
+    state.spawnDistance = m_spawnDistance[index];
+    state.cactusSpeed = m_cactusSpeed[index];
+    state.obstacles = m_obstacles[index];
+    state.gameOver = m_gameOver[index] != 0;
+    state.invincible = m_invincible[index] != 0;
+    state.rng = m_rng[index];
+    return state;
+}
+
+void GameStateBatch::Set(size_t index, const GameState& state){
+    m_tick[index] = state.tick;
+    m_dayTick[index] = state.dayTick;
+    m_isDaytime[index] = Mask(state.isDaytime);
+    m_dinoHeight[index] = state.dinoHeight;
+    m_isJumping[index] = Mask(state.isJumping);
+    m_jumpingUp[index] = Mask(state.jumpingUp);
+    m_jumpingSpeed[index] = state.jumpingSpeed;
+    m_scroll[index] = state.scroll;
+    m_spawnDistance[index] = state.spawnDistance;
+    m_cactusSpeed[index] = state.cactusSpeed;
+    m_obstacles[index] = state.obstacles;
+    m_leadObstacle[index] = GetLeadObstacle(state.obstacles, state.scroll);
+    m_obstacleTop[index] = GetLaneTop(state.obstacles);
+    m_gameOver[index] = Mask(state.gameOver);
+    m_invincible[index] = Mask(state.invincible);
+    m_rng[index] = state.rng;
+    m_events[index] = EVENT_NONE;
+}
+
+void GameStateBatch::Clone(const GameState& parent, size_t first, size_t count){
+    size_t last = first + count;
+    std::fill(m_tick.begin() + first, m_tick.begin() + last, parent.tick);
+    std::fill(m_dayTick.begin() + first, m_dayTick.begin() + last, parent.dayTick);
+    std::fill(m_isDaytime.begin() + first, m_isDaytime.begin() + last, Mask(parent.isDaytime));
+    std::fill(m_dinoHeight.begin() + first, m_dinoHeight.begin() + last, parent.dinoHeight);
+    std::fill(m_isJumping.begin() + first, m_isJumping.begin() + last, Mask(parent.isJumping));
+    std::fill(m_jumpingUp.begin() + first, m_jumpingUp.begin() + last, Mask(parent.jumpingUp));
+    std::fill(m_jumpingSpeed.begin() + first, m_jumpingSpeed.begin() + last, parent.jumpingSpeed);
+    std::fill(m_scroll.begin() + first, m_scroll.begin() + last, parent.scroll);
+    std::fill(m_spawnDistance.begin() + first, m_spawnDistance.begin() + last, parent.spawnDistance);
+    std::fill(m_cactusSpeed.begin() + first, m_cactusSpeed.begin() + last, parent.cactusSpeed);
+    std::fill(m_obstacles.begin() + first, m_obstacles.begin() + last, parent.obstacles);
+    std::fill(m_leadObstacle.begin() + first, m_leadObstacle.begin() + last,
+              GetLeadObstacle(parent.obstacles, parent.scroll));
+    std::fill(m_obstacleTop.begin() + first, m_obstacleTop.begin() + last, GetLaneTop(parent.obstacles));
+    std::fill(m_gameOver.begin() + first, m_gameOver.begin() + last, Mask(parent.gameOver));
+    std::fill(m_invincible.begin() + first, m_invincible.begin() + last, Mask(parent.invincible));
+    std::fill(m_rng.begin() + first, m_rng.begin() + last, parent.rng);
+    std::fill(m_events.begin() + first, m_events.begin() + last, (int)EVENT_NONE);
+}
+
+void GameStateBatch::Step(const GameAction* actions, int ticks){
+    Step<RuntimeGameRules>(actions, ticks);
+}
+
+size_t GameStateBatch::StepRepeated(const GameAction* actions, int repeat, int ticks){
+    return StepRepeated<RuntimeGameRules>(actions, repeat, ticks);
+}
+
+template<typename Rules>
+void GameStateBatch::Step(const GameAction* actions, int ticks){
+    size_t i = 0;
+    for(; i + VectorLanes::WIDTH <= m_count; i += VectorLanes::WIDTH){
+        StepLanes<VectorLanes, Rules>(i, actions, ticks);
+    }
+    for(; i < m_count; ++i){
+        StepLanes<ScalarLanes, Rules>(i, actions, ticks);
+    }
+}
+
+template<typename Rules>
+size_t GameStateBatch::StepRepeated(const GameAction* actions, int repeat, int ticks){
+    std::fill(m_repeatEvents.begin(), m_repeatEvents.end(), 0);
+    std::fill(m_rewards.begin(), m_rewards.end(), 0.0f);
+    size_t taken = 0;
+    for(int step = 0; step < repeat; ++step){
+        Step<Rules>(actions, ticks);
+        // Games that were already over raised nothing and earn nothing
+        size_t running = 0;
+        for(size_t i = 0; i < m_count; ++i){
+            m_repeatEvents[i] |= m_events[i];
+            if(m_events[i] & EVENT_GAME_OVER){
+                m_rewards[i] += REWARD_GAME_OVER;
+                ++taken;
+            }else if(m_gameOver[i] == 0){
+                m_rewards[i] += REWARD_SURVIVED;
+                ++running;
+            }
+        }
+        taken += running;
+        if(running == 0){
+            break;
+        }
+    }
+    m_events.swap(m_repeatEvents);
+    return taken;
+}
+
+size_t GameStateBatch::CountRunning() const{
+    size_t running = 0;
+    for(size_t i = 0; i < m_count; ++i){
+        if(m_gameOver[i] == 0){
+            ++running;
+        }
+    }
+    return running;
+}
+
+void GameStateBatch::HashAll(uint64_t* hashes) const{
+    for(size_t i = 0; i < m_count; ++i){
+        hashes[i] = HashGameState(Get(i));
+    }
+}
+
+template<typename Batch, typename Visit>
+void GameStateBatch::VisitColumns(Batch& batch, Visit visit){
+    visit(batch.m_tick);
+    visit(batch.m_dayTick);
+    visit(batch.m_isDaytime);
+    visit(batch.m_dinoHeight);
+    visit(batch.m_isJumping);
+    visit(batch.m_jumpingUp);
+    visit(batch.m_jumpingSpeed);
+    visit(batch.m_scroll);
+    visit(batch.m_spawnDistance);
+    visit(batch.m_cactusSpeed);
+    visit(batch.m_leadObstacle);
+    visit(batch.m_obstacles);
+    visit(batch.m_obstacleTop);
+    visit(batch.m_gameOver);
+    visit(batch.m_invincible);
+    visit(batch.m_rng);
+    visit(batch.m_startCactusSpeed);
+    visit(batch.m_startJumpingSpeed);
+    visit(batch.m_jumpApex);
+    visit(batch.m_dayLength);
+    visit(batch.m_daySpeedup);
+    visit(batch.m_spawnGapMin);
+    visit(batch.m_spawnGapRange);
+    visit(batch.m_spawnSpeedMin);
+    visit(batch.m_spawnScript);
+}
+
+bool GameStateBatch::Save(std::ostream& file) const{
+    uint32_t header[3] = {CHECKPOINT_VERSION, (uint32_t)sizeof(ObstacleLane), (uint32_t)sizeof(GameRandom)};
+    uint64_t count = m_count;
+    file.write(CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+    file.write((const char*)header, sizeof(header));
+    file.write((const char*)&count, sizeof(count));
+    VisitColumns(*this, [&file](const auto& column){
+        file.write((const char*)column.data(), (std::streamsize)(column.size() * sizeof(column[0])));
+    });
+    for(size_t i = 0; i < m_count; ++i){
+        SpawnScriptFrame frame = GetScriptFrame(i);
+        file.write((const char*)&frame, sizeof(frame));
+    }
+    return file.good();
+}
+
+bool GameStateBatch::Load(std::istream& file){
+    char magic[4];
+    uint32_t header[3] = {};
+    uint64_t count = 0;
+    if(!file.read(magic, sizeof(magic)) || std::memcmp(magic, CHECKPOINT_MAGIC, sizeof(magic)) != 0 ||
+       !file.read((char*)header, sizeof(header)) || header[0] != CHECKPOINT_VERSION ||
+       header[1] != sizeof(ObstacleLane) || header[2] != sizeof(GameRandom) ||
+       !file.read((char*)&count, sizeof(count))){
+        std::cout << "GameStateBatch.cpp: not a batch checkpoint of version " << CHECKPOINT_VERSION << "\n";
+        return false;
+    }
+    // Sized directly, Resize() would reset the new environments only to
+    // overwrite them
+    m_count = (size_t)count;
+    bool good = true;
+    VisitColumns(*this, [&file, &good, count](auto& column){
+        column.resize((size_t)count);
+        good = good && file.read((char*)column.data(), (std::streamsize)(column.size() * sizeof(column[0])));
+    });
+    // Running scripts get a frame of the pool each, as Reset() gives them
+    m_scripts.Clear();
+    m_scripts.Reserve(m_count);
+    m_scriptFrame.assign(m_count, SpawnScriptPool::NO_FRAME);
+    for(size_t i = 0; i < m_count && good; ++i){
+        SpawnScriptFrame frame;
+        good = (bool)file.read((char*)&frame, sizeof(frame));
+        if(good && frame.script != SPAWN_SCRIPT_NONE){
+            m_scriptFrame[i] = m_scripts.Acquire(frame.script);
+            m_scripts.Get(m_scriptFrame[i]) = frame;
+        }
+    }
+    // Blocks drawn before stand for RNGs that the games no longer have
+    // and are drawn anew at the first spawn
+    m_schedule.Resize(m_count);
+    m_events.assign(m_count, EVENT_NONE);
+    m_repeatEvents.assign(m_count, EVENT_NONE);
+    m_rewards.assign(m_count, 0.0f);
+    if(!good){
+        std::cout << "GameStateBatch.cpp: batch checkpoint is truncated\n";
+        Resize(0);
+    }
+    return good;
+}
+
+const char* GameStateBatch::GetInstructionSet(){
+    return VectorLanes::Name();
+}
+
+// A parameter of lanes [first, first + Lanes::WIDTH) from its column at
+// first, or the constant of fixed rules
+template<typename Lanes, typename Rules, int GameParameters::*FIELD>
+static inline typename Lanes::V LoadRule(const int* column){
+    if constexpr(Rules::FIXED){
+        return Lanes::Set(Rules::PARAMETERS.*FIELD);
+    }else{
+        return Lanes::Load(column);
+    }
+}
+
+// The same rules as Step() in GameState.cpp, with every branch turned into
+// a mask and every parameter loaded from its column, so lanes with other
+// rules still share the instructions. Finished games have an empty
+// 'active' mask and do not change.
+template<typename Lanes, typename Rules>
+void GameStateBatch::StepLanes(size_t first, const GameAction* actions, int ticks){
+    typedef Lanes L;
+    typedef typename Lanes::V V;
+    const V zero = L::Set(0);
+
+    V gameOver = L::Load(m_gameOver.data() + first);
+    V active = L::AndNot(gameOver, L::Set(~0));
+
+    const V stepTicks = L::Set(ticks);
+    V elapsed = L::And(active, stepTicks);
+    V tick = L::Add(L::Load(m_tick.data() + first), elapsed);
+    V dayTick = L::Add(L::Load(m_dayTick.data() + first), elapsed);
+    const V dayLength = LoadRule<L, Rules, &GameParameters::dayLength>(m_dayLength.data() + first);
+    V dayChanged = L::And(active, L::Gt(dayTick, L::Sub(dayLength, L::Set(1))));
+    dayTick = L::Sub(dayTick, L::And(dayChanged, dayLength));
+    V isDaytime = L::Xor(L::Load(m_isDaytime.data() + first), dayChanged);
+    const V daySpeedup = LoadRule<L, Rules, &GameParameters::daySpeedup>(m_daySpeedup.data() + first);
+    V speedup = L::And(dayChanged, daySpeedup);
+    V cactusSpeed = L::Add(L::Load(m_cactusSpeed.data() + first), speedup);
+    V jumpingSpeed = L::Add(L::Load(m_jumpingSpeed.data() + first), speedup);
+
+    const CollisionBox& range = GetCollisionRules().hitRange;
+    V moved = L::And(active, L::Mul(cactusSpeed, stepTicks));
+    V scroll = L::Add(L::Load(m_scroll.data() + first), moved);
+    V spawnDistance = L::Sub(L::Load(m_spawnDistance.data() + first), moved);
+    V leadObstacle = L::Load(m_leadObstacle.data() + first);
+    // NO_OBSTACLE stays put
+    leadObstacle = L::Sub(leadObstacle, L::And(moved, L::Gt(L::Set(NO_OBSTACLE), leadObstacle)));
+    // spawnDistance <= 0
+    V spawn = L::AndNot(L::Gt(spawnDistance, zero), active);
+    // The lead obstacle left the hit range, the next one takes over
+    V passed = L::Gt(L::Set(range.minX), leadObstacle);
+    L::Store(m_cactusSpeed.data() + first, cactusSpeed);
+    L::Store(m_scroll.data() + first, scroll);
+    L::Store(m_spawnDistance.data() + first, spawnDistance);
+    L::Store(m_leadObstacle.data() + first, leadObstacle);
+    // The old lead, moved, is the first obstacle the dino could have swept
+    // through this step; spawns are checked lane by lane below
+    const V sweptLead = leadObstacle;
+    // Both are rare and walk the lane, they are done one lane at a time
+    V update = L::Or(spawn, passed);
+    if(L::Any(update)){
+        int spawnMask[L::WIDTH];
+        int updateMask[L::WIDTH];
+        L::Store(spawnMask, spawn);
+        L::Store(updateMask, update);
+        for(size_t lane = 0; lane < L::WIDTH; ++lane){
+            if(updateMask[lane]){
+                size_t i = first + lane;
+                if(spawnMask[lane]){
+                    uint32_t frame = m_scriptFrame[i];
+                    SpawnScriptFrame* script = (frame != SpawnScriptPool::NO_FRAME) ? &m_scripts.Get(frame) : nullptr;
+                    SpawnObstacles(m_obstacles[i], m_scroll[i], m_spawnDistance[i], m_cactusSpeed[i], m_rng[i],
+                                   GetRuleParameters<Rules>(GetParameters(i)), script, &m_schedule, i);
+                    // A script that ended gives its frame back
+                    if(script != nullptr && script->script == SPAWN_SCRIPT_NONE){
+                        m_scripts.Release(frame);
+                        m_scriptFrame[i] = SpawnScriptPool::NO_FRAME;
+                    }
+                    m_obstacleTop[i] = GetLaneTop(m_obstacles[i]);
+                }
+                m_leadObstacle[i] = GetLeadObstacle(m_obstacles[i], m_scroll[i]);
+            }
+        }
+        leadObstacle = L::Load(m_leadObstacle.data() + first);
+    }
+
+    // Jump logic
+    V isJumping = L::Load(m_isJumping.data() + first);
+    V jumpingUp = L::Load(m_jumpingUp.data() + first);
+    V dinoHeight = L::Load(m_dinoHeight.data() + first);
+    const V startHeight = dinoHeight;
+    V jump = L::And(active, L::Eq(L::Load(actions + first), L::Set(ACTION_JUMP)));
+    V jumpStart = L::AndNot(isJumping, jump);
+    isJumping = L::Or(isJumping, jumpStart);
+    dinoHeight = L::Select(jumpStart, L::Set(1), dinoHeight);
+
+    V airborne = L::And(active, isJumping);
+    V rising = L::And(airborne, jumpingUp);
+    V falling = L::AndNot(jumpingUp, airborne);
+    V jumpDelta = L::Mul(jumpingSpeed, stepTicks);
+    dinoHeight = L::Add(dinoHeight, L::And(rising, jumpDelta));
+    dinoHeight = L::Sub(dinoHeight, L::And(falling, jumpDelta));
+    const V jumpApex = LoadRule<L, Rules, &GameParameters::jumpApex>(m_jumpApex.data() + first);
+    V apex = L::And(rising, L::Gt(dinoHeight, L::Sub(jumpApex, L::Set(1))));
+    V landed = L::AndNot(L::Gt(dinoHeight, zero), falling);
+    jumpingUp = L::Or(L::AndNot(apex, jumpingUp), landed);
+    isJumping = L::AndNot(landed, isJumping);
+
+    // Collision logic. A lane can only be hit if an obstacle is within
+    // reach of its path along x and the dino's height range during the
+    // step reaches the obstacle's; the few lanes that pass are swept
+    // exactly like Step() does. Offsets from the dino are (x, -height).
+    V lowHeight = L::Select(L::Gt(startHeight, dinoHeight), dinoHeight, startHeight);
+    V highHeight = L::Select(L::Gt(startHeight, dinoHeight), startHeight, dinoHeight);
+    V check = L::AndNot(L::Load(m_invincible.data() + first), active);
+    check = L::And(check, L::Or(spawn, L::AndNot(L::Gt(sweptLead, L::Set(range.maxX)), L::Set(~0))));
+    // Up to the lane's highest obstacle, a scripted bird say
+    check = L::AndNot(L::Gt(lowHeight, L::Add(L::Set(-range.minY), L::Load(m_obstacleTop.data() + first))), check);
+    check = L::AndNot(L::Gt(L::Set(-range.maxY), highHeight), check);
+    V hit = zero;
+    if(L::Any(check)){
+        int checkMask[L::WIDTH];
+        int hitMask[L::WIDTH];
+        int movedLanes[L::WIDTH];
+        int startHeights[L::WIDTH];
+        int endHeights[L::WIDTH];
+        L::Store(checkMask, check);
+        L::Store(movedLanes, moved);
+        L::Store(startHeights, startHeight);
+        L::Store(endHeights, dinoHeight);
+        const CollisionRules& rules = GetCollisionRules();
+        for(size_t lane = 0; lane < L::WIDTH; ++lane){
+            hitMask[lane] = 0;
+            if(checkMask[lane]){
+                size_t i = first + lane;
+                const ObstacleLane& obstacles = m_obstacles[i];
+                uint32_t obstacle = FindFirstSweptLaneHit(obstacles, rules, m_scroll[i] - movedLanes[lane], startHeights[lane],
+                                                          m_scroll[i], endHeights[lane]);
+                hitMask[lane] = Mask(obstacle < obstacles.count);
+            }
+        }
+        hit = L::Load(hitMask);
+    }
+    gameOver = L::Or(gameOver, hit);
+    V events = L::Or(L::And(dayChanged, L::Set(EVENT_DAY_CHANGED)), L::And(hit, L::Set(EVENT_GAME_OVER)));
+
+    L::Store(m_tick.data() + first, tick);
+    L::Store(m_dayTick.data() + first, dayTick);
+    L::Store(m_isDaytime.data() + first, isDaytime);
+    L::Store(m_jumpingSpeed.data() + first, jumpingSpeed);
+    L::Store(m_isJumping.data() + first, isJumping);
+    L::Store(m_jumpingUp.data() + first, jumpingUp);
+    L::Store(m_dinoHeight.data() + first, dinoHeight);
+    L::Store(m_gameOver.data() + first, gameOver);
+    L::Store(m_events.data() + first, events);
+}
+
+template void GameStateBatch::Step<RuntimeGameRules>(const GameAction*, int);
+template void GameStateBatch::Step<ShippedGameRules>(const GameAction*, int);
+template size_t GameStateBatch::StepRepeated<RuntimeGameRules>(const GameAction*, int, int);
+template size_t GameStateBatch::StepRepeated<ShippedGameRules>(const GameAction*, int, int);
@@ -0,0 +1,156 @@
+#include "GameplayLog.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+// Bytes the file is written in at most, one flush of every ring fits
+const size_t GAMEPLAY_FILE_BUFFER = 1 << 20;
+
+GameplayLog& GameplayLog::Get(){
+    static GameplayLog log;
+    return log;
+}
+
+// Constructor
+GameplayLog::GameplayLog(){
+
+}
+
+// Destructor
+GameplayLog::~GameplayLog(){
+    Close();
+}
+
+GameplayLog::Ring& GameplayLog::GetThreadRing(){
+    thread_local Ring* ring = nullptr;
+    if(ring == nullptr){
+        std::lock_guard<std::mutex> lock(m_ringsMutex);
+        m_rings.push_back(std::unique_ptr<Ring>(new Ring()));
+        // Rings stay for the rest of the run
+        MemoryTags::Add(MEMORY_TELEMETRY, sizeof(Ring));
+        ring = m_rings.back().get();
+        ring->thread = (uint16_t)(m_rings.size() - 1);
+    }
+    return *ring;
+}
+
+bool GameplayLog::Open(const std::string& filepath){
+    Close();
+    m_file = std::fopen(filepath.c_str(), "ab");
+    if(m_file == nullptr){
+        std::cout << "GameplayLog.cpp: could not open " << filepath << "\n";
+        return false;
+    }
+    m_fileBuffer.resize(GAMEPLAY_FILE_BUFFER);
+    std::setvbuf(m_file, m_fileBuffer.data(), _IOFBF, m_fileBuffer.size());
+
+    GameplayRecord header = {};
+    header.microseconds = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    header.type = GAMEPLAY_SESSION_START;
+    header.values[0] = GAMEPLAY_LOG_VERSION;
+    header.values[1] = (int32_t)sizeof(GameplayRecord);
+    if(std::fwrite(&header, sizeof(header), 1, m_file) != 1){
+        std::cout << "GameplayLog.cpp: could not write to " << filepath << "\n";
+        std::fclose(m_file);
+        m_file = nullptr;
+        return false;
+    }
+    m_start = std::chrono::steady_clock::now();
+    m_written = 1;
+    {
+        std::lock_guard<std::mutex> lock(m_ringsMutex);
+        for(std::unique_ptr<Ring>& ring : m_rings){
+            ring->dropped.store(0, std::memory_order_relaxed);
+        }
+    }
+    m_stop = false;
+    m_open.store(true, std::memory_order_release);
+    m_thread = std::thread(&GameplayLog::FlushThread, this);
+    return true;
+}
+
+void GameplayLog::Add(GameplayRecordType type, uint32_t game, int32_t tick,
+                      int32_t value0, int32_t value1, int32_t value2){
+    if(!m_open.load(std::memory_order_acquire)){
+        return;
+    }
+    Ring& ring = GetThreadRing();
+    uint64_t head = ring.head.load(std::memory_order_relaxed);
+    if(head - ring.tail.load(std::memory_order_acquire) >= GAMEPLAY_RING_RECORDS){
+        ring.dropped.store(ring.dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return;
+    }
+    GameplayRecord& record = ring.records[head % GAMEPLAY_RING_RECORDS];
+    record.microseconds = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - m_start).count();
+    record.type = (uint16_t)type;
+    record.thread = ring.thread;
+    record.game = game;
+    record.tick = tick;
+    record.values[0] = value0;
+    record.values[1] = value1;
+    record.values[2] = value2;
+    // The flush thread may take the record once the head has moved past it
+    ring.head.store(head + 1, std::memory_order_release);
+}
+
+void GameplayLog::Flush(){
+    std::lock_guard<std::mutex> lock(m_ringsMutex);
+    for(std::unique_ptr<Ring>& ring : m_rings){
+        uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+        uint64_t head = ring->head.load(std::memory_order_acquire);
+        // At most two pieces, before and after the ring wraps
+        while(tail < head){
+            size_t first = (size_t)(tail % GAMEPLAY_RING_RECORDS);
+            size_t count = (size_t)std::min<uint64_t>(head - tail, GAMEPLAY_RING_RECORDS - first);
+            std::fwrite(&ring->records[first], sizeof(GameplayRecord), count, m_file);
+            tail += count;
+            m_written += count;
+        }
+        // Hands the slots back to the writer
+        ring->tail.store(tail, std::memory_order_release);
+    }
+    std::fflush(m_file);
+}
+
+void GameplayLog::FlushThread(){
+    std::unique_lock<std::mutex> lock(m_stopMutex);
+    while(!m_stop){
+        m_stopCondition.wait_for(lock, std::chrono::milliseconds(GAMEPLAY_FLUSH_MILLISECONDS));
+        lock.unlock();
+        Flush();
+        lock.lock();
+    }
+}
+
+uint64_t GameplayLog::GetDroppedCount() const{
+    std::lock_guard<std::mutex> lock(m_ringsMutex);
+    uint64_t dropped = 0;
+    for(const std::unique_ptr<Ring>& ring : m_rings){
+        dropped += ring->dropped.load(std::memory_order_relaxed);
+    }
+    return dropped;
+}
+
+void GameplayLog::Close(){
+    if(m_file == nullptr){
+        return;
+    }
+    m_open.store(false, std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> lock(m_stopMutex);
+        m_stop = true;
+    }
+    m_stopCondition.notify_all();
+    if(m_thread.joinable()){
+        m_thread.join();
+    }
+    Flush();
+    uint64_t dropped = GetDroppedCount();
+    if(dropped > 0){
+        std::cout << "GameplayLog.cpp: " << dropped << " records dropped, the rings filled up between flushes\n";
+    }
+    std::fclose(m_file);
+    m_file = nullptr;
+}
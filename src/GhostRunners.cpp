@@ -0,0 +1,82 @@
+#include "GhostRunners.hpp"
+
+#include <iostream>
+
+// Constructor
+GhostRunners::GhostRunners(){
+
+}
+
+// Destructor
+GhostRunners::~GhostRunners(){
+
+}
+
+size_t GhostRunners::Load(const std::vector<std::string>& filepaths){
+    m_logs.clear();
+    for(const std::string& filepath : filepaths){
+        if(m_logs.size() == MAX_GHOSTS){
+            std::cout << "GhostRunners.cpp: more than " << MAX_GHOSTS << " ghosts, the rest are ignored\n";
+            break;
+        }
+        InputLog log;
+        if(!log.Load(filepath)){
+            std::cout << "GhostRunners.cpp: could not load ghost " << filepath << "\n";
+            continue;
+        }
+        m_logs.push_back(log);
+    }
+    size_t count = m_logs.size();
+    m_batch.Resize(count);
+    m_gamesPlayed.resize(count);
+    m_actions.resize(count);
+    m_palettes.resize(count);
+    m_running.resize(count);
+    m_jumps.resize(count);
+    Rewind();
+    return count;
+}
+
+void GhostRunners::Rewind(){
+    m_step = 0;
+    for(size_t i = 0; i < m_logs.size(); ++i){
+        m_gamesPlayed[i] = 0;
+        m_batch.Reset(i, m_logs[i].GetSeed(), 0);
+        m_palettes[i] = 0;
+        m_running[i] = m_logs[i].GetStepCount() > 0 ? 1 : 0;
+        m_jumps[i] = JumpAnchor();
+    }
+}
+
+void GhostRunners::Step(){
+    if(m_logs.empty()){
+        return;
+    }
+    // The logged input of each ghost, as StepLoggedInput() reads it; a
+    // ghost that has stopped gets no input and its lane is left to idle
+    for(size_t i = 0; i < m_logs.size(); ++i){
+        m_actions[i] = ACTION_NONE;
+        if(m_step >= m_logs[i].GetStepCount()){
+            continue;
+        }
+        uint8_t input = m_logs[i].GetInput(m_step);
+        if(input & INPUT_RESTART){
+            m_batch.Reset(i, m_logs[i].GetSeed(), ++m_gamesPlayed[i]);
+            m_jumps[i] = JumpAnchor();
+        }
+        m_batch.SetInvincible(i, (input & INPUT_INVINCIBLE) != 0);
+        m_actions[i] = (input & INPUT_JUMP) ? ACTION_JUMP : ACTION_NONE;
+        m_palettes[i] = (uint8_t)GetInputPalette(input);
+    }
+    m_batch.Step(m_actions.data());
+    ++m_step;
+
+    const int* gameOver = m_batch.GetGameOverMasks();
+    const int* heights = m_batch.GetDinoHeights();
+    const int* rising = m_batch.GetJumpingUpMasks();
+    const int* speeds = m_batch.GetJumpingSpeeds();
+    for(size_t i = 0; i < m_logs.size(); ++i){
+        m_running[i] = (m_step <= m_logs[i].GetStepCount() && gameOver[i] == 0) ? 1 : 0;
+        UpdateJumpAnchor(m_jumps[i], (int)m_step, heights[i], rising[i] != 0, speeds[i]);
+    }
+}
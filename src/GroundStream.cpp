@@ -0,0 +1,172 @@
+#include "GroundStream.hpp"
+#include "Collision.hpp"
+
+// Quads of the ground line along one chunk, and pebbles scattered on it
+const int LINE_SEGMENTS = 8;
+const int PEBBLES_PER_CHUNK = 6;
+const size_t VERTICES_PER_CHUNK = (LINE_SEGMENTS + 1)*2 + PEBBLES_PER_CHUNK*4;
+const size_t INDICES_PER_CHUNK = LINE_SEGMENTS*6 + PEBBLES_PER_CHUNK*6;
+
+// Chunk layout in world units: the line runs along the front of the lane,
+// just above the background floor at y = -1
+const float CHUNK_WORLD_LENGTH = (float)GROUND_CHUNK_LENGTH / GAME_UNITS_PER_WORLD_UNIT;
+const float GROUND_Y = -0.995f;
+const float LINE_Z = 1.9f;
+const float LINE_HALF_WIDTH = 0.02f;
+const float MAX_BUMP = 0.04f;
+const float PEBBLE_NEAR_Z = 0.9f;
+const float PEBBLE_FAR_Z = 2.1f;
+const float MAX_PEBBLE_SIZE = 0.05f;
+// A solid dark texel of the background texture (on a cloud outline)
+const float DARK_U = 0.119f;
+const float DARK_V = 0.939f;
+
+// Mixes a seed and a number into 64 well spread bits (SplitMix64)
+static uint64_t HashGround(uint64_t seed, uint64_t value){
+    uint64_t z = seed + value*0x9e3779b97f4a7c15ULL;
+    z = (z ^ (z >> 30))*0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27))*0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+// The hash as a float in [0, 1)
+static float HashGroundFloat(uint64_t seed, uint64_t value){
+    return (float)(HashGround(seed, value) >> 40) / (float)(1 << 24);
+}
+
+static void WriteVertex(GLfloat* out, float x, float y, float z){
+    const GLfloat vertex[FLOATS_PER_VERTEX] = {x, y, z, 0.0f, 1.0f, 0.0f, DARK_U, DARK_V};
+    for(size_t i = 0; i < FLOATS_PER_VERTEX; ++i){
+        out[i] = vertex[i];
+    }
+}
+
+// Constructor
+GroundStream::GroundStream(){
+    for(size_t slot = 0; slot < GROUND_CHUNK_SLOTS; ++slot){
+        m_slotChunk[slot] = NO_GROUND_CHUNK;
+    }
+}
+
+// Destructor
+GroundStream::~GroundStream(){
+
+}
+
+void GroundStream::Reserve(std::vector<GLfloat>& vertices, std::vector<uint32_t>& indices){
+    m_firstVertex = vertices.size() / FLOATS_PER_VERTEX;
+    m_staging.assign(GROUND_CHUNK_SLOTS*VERTICES_PER_CHUNK*FLOATS_PER_VERTEX, 0.0f);
+    // The slots of a rebuilt arena start out empty
+    for(size_t slot = 0; slot < GROUND_CHUNK_SLOTS; ++slot){
+        m_slotChunk[slot] = NO_GROUND_CHUNK;
+    }
+    m_pending = 0;
+    vertices.insert(vertices.end(), m_staging.begin(), m_staging.end());
+
+    // Every slot has the same topology, only the vertices move. Quads are
+    // wound counter-clockwise seen from above.
+    DrawRange range;
+    range.indexCount = (GLsizei)INDICES_PER_CHUNK;
+    range.firstIndex = (GLsizei)indices.size();
+    for(uint32_t segment = 0; segment < (uint32_t)LINE_SEGMENTS; ++segment){
+        uint32_t front = segment*2;
+        uint32_t quad[6] = {front, front + 2, front + 1, front + 1, front + 2, front + 3};
+        indices.insert(indices.end(), quad, quad + 6);
+    }
+    for(uint32_t pebble = 0; pebble < (uint32_t)PEBBLES_PER_CHUNK; ++pebble){
+        uint32_t first = (LINE_SEGMENTS + 1)*2 + pebble*4;
+        uint32_t quad[6] = {first, first + 2, first + 1, first + 1, first + 2, first + 3};
+        indices.insert(indices.end(), quad, quad + 6);
+    }
+    for(size_t slot = 0; slot < GROUND_CHUNK_SLOTS; ++slot){
+        m_slotRange[slot] = range;
+        m_slotRange[slot].baseVertex = (GLint)(m_firstVertex + slot*VERTICES_PER_CHUNK);
+    }
+
+    AABB bounds;
+    bounds.min[0] = 0.0f;
+    bounds.min[1] = GROUND_Y;
+    bounds.min[2] = PEBBLE_NEAR_Z;
+    bounds.max[0] = CHUNK_WORLD_LENGTH;
+    bounds.max[1] = GROUND_Y + MAX_BUMP;
+    bounds.max[2] = PEBBLE_FAR_Z + MAX_PEBBLE_SIZE;
+    m_chunkSphere = MakeBoundingSphere(bounds);
+}
+
+void GroundStream::Reset(uint64_t seed){
+    m_seed = seed;
+    for(size_t slot = 0; slot < GROUND_CHUNK_SLOTS; ++slot){
+        m_slotChunk[slot] = NO_GROUND_CHUNK;
+    }
+}
+
+size_t GroundStream::Stream(int64_t trackDistance){
+    if(m_staging.empty()){
+        return 0;
+    }
+    // Chunk c covers [c, c + 1)*GROUND_CHUNK_LENGTH, rounded down for
+    // the negative distances just after a start
+    int64_t start = trackDistance - GROUND_CHUNKS_BEHIND;
+    int64_t first = start / GROUND_CHUNK_LENGTH;
+    if(start % GROUND_CHUNK_LENGTH < 0){
+        first -= 1;
+    }
+    size_t built = 0;
+    for(int64_t chunk = first; chunk < first + (int64_t)GROUND_CHUNK_SLOTS; ++chunk){
+        // A chunk always lands in the same slot, the one its predecessor
+        // GROUND_CHUNK_SLOTS chunks back just left
+        size_t slot = (size_t)(((chunk % (int64_t)GROUND_CHUNK_SLOTS) + GROUND_CHUNK_SLOTS) % GROUND_CHUNK_SLOTS);
+        if(m_slotChunk[slot] != chunk){
+            BuildChunk(slot, chunk);
+            m_slotChunk[slot] = chunk;
+            m_pending |= 1u << slot;
+            ++built;
+        }
+    }
+    return built;
+}
+
+void GroundStream::BuildChunk(size_t slot, int64_t chunk){
+    GLfloat* out = m_staging.data() + slot*VERTICES_PER_CHUNK*FLOATS_PER_VERTEX;
+
+    // The line: bumps are hashed per column of the whole track, so the
+    // last column of a chunk meets the first of the next one
+    for(int column = 0; column <= LINE_SEGMENTS; ++column){
+        uint64_t trackColumn = (uint64_t)(chunk*LINE_SEGMENTS + column);
+        float x = CHUNK_WORLD_LENGTH*(float)column/(float)LINE_SEGMENTS;
+        float bump = HashGroundFloat(m_seed, trackColumn);
+        // Mostly flat, with the odd bump
+        float y = GROUND_Y + ((bump > 0.75f) ? (bump - 0.75f)*4.0f*MAX_BUMP : 0.0f);
+        WriteVertex(out, x, y, LINE_Z + LINE_HALF_WIDTH);
+        out += FLOATS_PER_VERTEX;
+        WriteVertex(out, x, y, LINE_Z - LINE_HALF_WIDTH);
+        out += FLOATS_PER_VERTEX;
+    }
+
+    // Pebbles flat on the ground, anywhere on the chunk
+    for(int pebble = 0; pebble < PEBBLES_PER_CHUNK; ++pebble){
+        uint64_t key = ((uint64_t)chunk << 8) | (uint64_t)pebble;
+        float x = HashGroundFloat(m_seed ^ 0x1, key)*(CHUNK_WORLD_LENGTH - MAX_PEBBLE_SIZE);
+        float z = PEBBLE_NEAR_Z + HashGroundFloat(m_seed ^ 0x2, key)*(PEBBLE_FAR_Z - PEBBLE_NEAR_Z);
+        float size = MAX_PEBBLE_SIZE*(0.25f + 0.75f*HashGroundFloat(m_seed ^ 0x3, key));
+        WriteVertex(out, x, GROUND_Y, z + size);
+        out += FLOATS_PER_VERTEX;
+        WriteVertex(out, x, GROUND_Y, z);
+        out += FLOATS_PER_VERTEX;
+        WriteVertex(out, x + size, GROUND_Y, z + size);
+        out += FLOATS_PER_VERTEX;
+        WriteVertex(out, x + size, GROUND_Y, z);
+        out += FLOATS_PER_VERTEX;
+    }
+}
+
+void GroundStream::Upload(MeshRegistry& registry, MeshHandle arena){
+    for(size_t slot = 0; m_pending != 0 && slot < GROUND_CHUNK_SLOTS; ++slot){
+        if(m_pending & (1u << slot)){
+            registry.UpdateVertexRange(arena, m_firstVertex + slot*VERTICES_PER_CHUNK,
+                                       m_staging.data() + slot*VERTICES_PER_CHUNK*FLOATS_PER_VERTEX,
+                                       VERTICES_PER_CHUNK);
+        }
+    }
+    m_pending = 0;
+}
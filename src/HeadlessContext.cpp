@@ -0,0 +1,331 @@
+#include "HeadlessContext.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+#if defined(__linux__)
+#include <dlfcn.h>
+
+// The little of EGL used here, so its headers are not needed
+typedef int32_t EGLint;
+typedef unsigned int EGLBoolean;
+typedef unsigned int EGLenum;
+typedef void* EGLDisplay;
+typedef void* EGLConfig;
+typedef void* EGLSurface;
+typedef void* EGLContext;
+typedef void* EGLDeviceEXT;
+
+static const EGLint EGL_NONE = 0x3038;
+static const EGLint EGL_SURFACE_TYPE = 0x3033;
+static const EGLint EGL_PBUFFER_BIT = 0x0001;
+static const EGLint EGL_RENDERABLE_TYPE = 0x3040;
+static const EGLint EGL_OPENGL_BIT = 0x0008;
+static const EGLint EGL_RED_SIZE = 0x3024;
+static const EGLint EGL_GREEN_SIZE = 0x3023;
+static const EGLint EGL_BLUE_SIZE = 0x3022;
+static const EGLint EGL_ALPHA_SIZE = 0x3021;
+static const EGLint EGL_DEPTH_SIZE = 0x3025;
+static const EGLint EGL_WIDTH = 0x3057;
+static const EGLint EGL_HEIGHT = 0x3056;
+static const EGLint EGL_VENDOR = 0x3053;
+static const EGLint EGL_EXTENSIONS = 0x3055;
+static const EGLenum EGL_OPENGL_API = 0x30A2;
+static const EGLint EGL_CONTEXT_MAJOR_VERSION = 0x3098;
+static const EGLint EGL_CONTEXT_MINOR_VERSION = 0x30FB;
+static const EGLint EGL_CONTEXT_OPENGL_PROFILE_MASK = 0x30FD;
+static const EGLint EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT = 0x0001;
+static const EGLint EGL_CONTEXT_OPENGL_DEBUG = 0x31B0;
+static const EGLint EGL_TRUE = 1;
+static const EGLenum EGL_PLATFORM_DEVICE_EXT = 0x313F;
+static const EGLenum EGL_PLATFORM_SURFACELESS_MESA = 0x31DD;
+static const int MAX_DEVICES = 16;
+
+struct EGLFunctions{
+    void* library{nullptr};
+    void* (*getProcAddress)(const char*){nullptr};
+    EGLDisplay (*getDisplay)(void*){nullptr};
+    EGLBoolean (*initialize)(EGLDisplay, EGLint*, EGLint*){nullptr};
+    EGLBoolean (*terminate)(EGLDisplay){nullptr};
+    const char* (*queryString)(EGLDisplay, EGLint){nullptr};
+    EGLBoolean (*bindAPI)(EGLenum){nullptr};
+    EGLBoolean (*chooseConfig)(EGLDisplay, const EGLint*, EGLConfig*, EGLint, EGLint*){nullptr};
+    EGLSurface (*createPbufferSurface)(EGLDisplay, EGLConfig, const EGLint*){nullptr};
+    EGLBoolean (*destroySurface)(EGLDisplay, EGLSurface){nullptr};
+    EGLContext (*createContext)(EGLDisplay, EGLConfig, EGLContext, const EGLint*){nullptr};
+    EGLBoolean (*destroyContext)(EGLDisplay, EGLContext){nullptr};
+    EGLBoolean (*makeCurrent)(EGLDisplay, EGLSurface, EGLSurface, EGLContext){nullptr};
+    EGLContext (*getCurrentContext)(){nullptr};
+    EGLBoolean (*swapBuffers)(EGLDisplay, EGLSurface){nullptr};
+    EGLint (*getError)(){nullptr};
+    // Extensions
+    EGLBoolean (*queryDevices)(EGLint, EGLDeviceEXT*, EGLint*){nullptr};
+    EGLDisplay (*getPlatformDisplay)(EGLenum, void*, const EGLint*){nullptr};
+};
+static EGLFunctions sEGL;
+
+template<typename T>
+static bool LoadSymbol(T& function, const char* name){
+    function = (T)dlsym(sEGL.library, name);
+    return function != nullptr;
+}
+
+// Opens libEGL once, false if it or part of it is missing
+static bool LoadEGL(){
+    if(sEGL.library != nullptr){
+        return true;
+    }
+    sEGL.library = dlopen("libEGL.so.1", RTLD_NOW | RTLD_GLOBAL);
+    if(sEGL.library == nullptr){
+        sEGL.library = dlopen("libEGL.so", RTLD_NOW | RTLD_GLOBAL);
+    }
+    if(sEGL.library == nullptr){
+        return false;
+    }
+    bool loaded = LoadSymbol(sEGL.getProcAddress, "eglGetProcAddress") &&
+                  LoadSymbol(sEGL.getDisplay, "eglGetDisplay") &&
+                  LoadSymbol(sEGL.initialize, "eglInitialize") &&
+                  LoadSymbol(sEGL.terminate, "eglTerminate") &&
+                  LoadSymbol(sEGL.queryString, "eglQueryString") &&
+                  LoadSymbol(sEGL.bindAPI, "eglBindAPI") &&
+                  LoadSymbol(sEGL.chooseConfig, "eglChooseConfig") &&
+                  LoadSymbol(sEGL.createPbufferSurface, "eglCreatePbufferSurface") &&
+                  LoadSymbol(sEGL.destroySurface, "eglDestroySurface") &&
+                  LoadSymbol(sEGL.createContext, "eglCreateContext") &&
+                  LoadSymbol(sEGL.destroyContext, "eglDestroyContext") &&
+                  LoadSymbol(sEGL.makeCurrent, "eglMakeCurrent") &&
+                  LoadSymbol(sEGL.getCurrentContext, "eglGetCurrentContext") &&
+                  LoadSymbol(sEGL.swapBuffers, "eglSwapBuffers") &&
+                  LoadSymbol(sEGL.getError, "eglGetError");
+    if(!loaded){
+        dlclose(sEGL.library);
+        sEGL = EGLFunctions();
+        return false;
+    }
+    sEGL.queryDevices = (EGLBoolean (*)(EGLint, EGLDeviceEXT*, EGLint*))sEGL.getProcAddress("eglQueryDevicesEXT");
+    sEGL.getPlatformDisplay = (EGLDisplay (*)(EGLenum, void*, const EGLint*))sEGL.getProcAddress("eglGetPlatformDisplayEXT");
+    return true;
+}
+
+// Whether the space separated list has extension
+static bool HasExtension(const char* list, const char* extension){
+    if(list == nullptr){
+        return false;
+    }
+    size_t length = std::strlen(extension);
+    for(const char* at = std::strstr(list, extension); at != nullptr; at = std::strstr(at + length, extension)){
+        if((at == list || at[-1] == ' ') && (at[length] == ' ' || at[length] == '\0')){
+            return true;
+        }
+    }
+    return false;
+}
+
+// Constructor
+HeadlessContext::HeadlessContext(){
+
+}
+
+// Destructor
+HeadlessContext::~HeadlessContext(){
+    Destroy();
+}
+
+bool HeadlessContext::Create(int device, int major, int minor, bool debug, int width, int height){
+    Destroy();
+    if(!LoadEGL()){
+        std::cout << "HeadlessContext.cpp: libEGL could not be loaded\n";
+        return false;
+    }
+    // Client extensions, asked of no display
+    const char* extensions = sEGL.queryString(nullptr, EGL_EXTENSIONS);
+    EGLDisplay display = nullptr;
+    if(sEGL.queryDevices != nullptr && sEGL.getPlatformDisplay != nullptr &&
+       HasExtension(extensions, "EGL_EXT_platform_device")){
+        EGLDeviceEXT devices[MAX_DEVICES];
+        EGLint count = 0;
+        if(sEGL.queryDevices(MAX_DEVICES, devices, &count) && count > 0){
+            if(device >= count){
+                std::cout << "HeadlessContext.cpp: there is no EGL device " << device << ", only " << count << "\n";
+                return false;
+            }
+            display = sEGL.getPlatformDisplay(EGL_PLATFORM_DEVICE_EXT, devices[device], nullptr);
+            m_description = "EGL device " + std::to_string(device) + " of " + std::to_string(count);
+        }
+    }
+    if(display == nullptr && sEGL.getPlatformDisplay != nullptr &&
+       HasExtension(extensions, "EGL_MESA_platform_surfaceless")){
+        display = sEGL.getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, nullptr, nullptr);
+        m_description = "surfaceless EGL";
+    }
+    if(display == nullptr){
+        display = sEGL.getDisplay(nullptr);
+        m_description = "default EGL display";
+    }
+    EGLint eglMajor = 0;
+    EGLint eglMinor = 0;
+    if(display == nullptr || !sEGL.initialize(display, &eglMajor, &eglMinor)){
+        std::cout << "HeadlessContext.cpp: no EGL display could be initialized (error 0x" << std::hex
+                  << sEGL.getError() << std::dec << ")\n";
+        return false;
+    }
+    m_display = display;
+    const char* vendor = sEGL.queryString(display, EGL_VENDOR);
+    m_description += ", " + std::string(vendor != nullptr ? vendor : "unknown vendor") + " EGL " +
+                     std::to_string(eglMajor) + "." + std::to_string(eglMinor);
+
+    const EGLint configAttributes[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8, EGL_ALPHA_SIZE, 8,
+        EGL_DEPTH_SIZE, 24,
+        EGL_NONE
+    };
+    EGLConfig config = nullptr;
+    EGLint configs = 0;
+    if(!sEGL.bindAPI(EGL_OPENGL_API) || !sEGL.chooseConfig(display, configAttributes, &config, 1, &configs) ||
+       configs < 1){
+        std::cout << "HeadlessContext.cpp: " << m_description << " has no desktop OpenGL pbuffer config\n";
+        Destroy();
+        return false;
+    }
+    m_config = config;
+    m_major = major;
+    m_minor = minor;
+    m_debug = debug;
+    const EGLint surfaceAttributes[] = {EGL_WIDTH, width, EGL_HEIGHT, height, EGL_NONE};
+    m_surface = sEGL.createPbufferSurface(display, config, surfaceAttributes);
+    const EGLint contextAttributes[] = {
+        EGL_CONTEXT_MAJOR_VERSION, major,
+        EGL_CONTEXT_MINOR_VERSION, minor,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_CONTEXT_OPENGL_DEBUG, debug ? EGL_TRUE : 0,
+        EGL_NONE
+    };
+    m_context = sEGL.createContext(display, config, nullptr, contextAttributes);
+    if(m_surface == nullptr || m_context == nullptr || !sEGL.makeCurrent(display, m_surface, m_surface, m_context)){
+        std::cout << "HeadlessContext.cpp: no OpenGL " << major << "." << minor << " core context on "
+                  << m_description << " (error 0x" << std::hex << sEGL.getError() << std::dec << ")\n";
+        Destroy();
+        return false;
+    }
+    return true;
+}
+
+bool HeadlessContext::CreateShared(const HeadlessContext& share){
+    Destroy();
+    if(!share.IsCreated()){
+        return false;
+    }
+    m_display = share.m_display;
+    m_config = share.m_config;
+    m_ownsDisplay = false;
+    m_major = share.m_major;
+    m_minor = share.m_minor;
+    m_debug = share.m_debug;
+    m_description = share.m_description;
+    // Workers draw into framebuffers of their own only
+    const EGLint surfaceAttributes[] = {EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE};
+    m_surface = sEGL.createPbufferSurface(m_display, m_config, surfaceAttributes);
+    const EGLint contextAttributes[] = {
+        EGL_CONTEXT_MAJOR_VERSION, m_major,
+        EGL_CONTEXT_MINOR_VERSION, m_minor,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_CONTEXT_OPENGL_DEBUG, m_debug ? EGL_TRUE : 0,
+        EGL_NONE
+    };
+    m_context = sEGL.createContext(m_display, m_config, share.m_context, contextAttributes);
+    if(m_surface == nullptr || m_context == nullptr){
+        std::cout << "HeadlessContext.cpp: no shared context on " << m_description << " (error 0x" << std::hex
+                  << sEGL.getError() << std::dec << ")\n";
+        Destroy();
+        return false;
+    }
+    return true;
+}
+
+bool HeadlessContext::MakeCurrent(bool current){
+    if(m_context == nullptr){
+        return false;
+    }
+    // The API is chosen per thread
+    sEGL.bindAPI(EGL_OPENGL_API);
+    if(!current){
+        return sEGL.makeCurrent(m_display, nullptr, nullptr, nullptr);
+    }
+    return sEGL.makeCurrent(m_display, m_surface, m_surface, m_context);
+}
+
+void HeadlessContext::Destroy(){
+    if(m_display == nullptr){
+        return;
+    }
+    // Only let go of the calling thread's context if it is this one
+    if(m_context != nullptr && sEGL.getCurrentContext() == m_context){
+        sEGL.makeCurrent(m_display, nullptr, nullptr, nullptr);
+    }
+    if(m_context != nullptr){
+        sEGL.destroyContext(m_display, m_context);
+        m_context = nullptr;
+    }
+    if(m_surface != nullptr){
+        sEGL.destroySurface(m_display, m_surface);
+        m_surface = nullptr;
+    }
+    if(m_ownsDisplay){
+        sEGL.terminate(m_display);
+    }
+    m_display = nullptr;
+    m_config = nullptr;
+    m_ownsDisplay = true;
+}
+
+void* HeadlessContext::GetProcAddress(const char* name){
+    return (sEGL.getProcAddress != nullptr) ? sEGL.getProcAddress(name) : nullptr;
+}
+
+void HeadlessContext::Swap(){
+    if(m_context != nullptr){
+        sEGL.swapBuffers(m_display, m_surface);
+    }
+}
+
+#else
+
+// Constructor
+HeadlessContext::HeadlessContext(){
+
+}
+
+// Destructor
+HeadlessContext::~HeadlessContext(){
+
+}
+
+bool HeadlessContext::Create(int device, int major, int minor, bool debug, int width, int height){
+    std::cout << "HeadlessContext.cpp: headless contexts need Linux and EGL\n";
+    return false;
+}
+
+bool HeadlessContext::CreateShared(const HeadlessContext& share){
+    return false;
+}
+
+bool HeadlessContext::MakeCurrent(bool current){
+    return false;
+}
+
+void HeadlessContext::Destroy(){
+
+}
+
+void* HeadlessContext::GetProcAddress(const char* name){
+    return nullptr;
+}
+
+void HeadlessContext::Swap(){
+
+}
+
+#endif
@@ -0,0 +1,143 @@
+#include "HugePages.hpp"
+
+#if defined(LINUX) || defined(__linux__)
+    #include <sys/mman.h>
+    #define HUGEPAGES_MMAP 1
+#endif
+
+#include <atomic>
+#include <new>
+
+static std::atomic<uint64_t> sMappedBytes{0};
+static std::atomic<uint64_t> sExplicitBytes{0};
+
+uint64_t GetHugePageBytes(){
+    return sMappedBytes.load(std::memory_order_relaxed);
+}
+
+uint64_t GetExplicitHugePageBytes(){
+    return sExplicitBytes.load(std::memory_order_relaxed);
+}
+
+#if defined(HUGEPAGES_MMAP)
+
+static inline uintptr_t RoundUp(uintptr_t value, uintptr_t to){
+    return (value + to - 1) / to * to;
+}
+
+// Maps size bytes, a multiple of HUGE_PAGE_SIZE, aligned to a huge page
+static void* MapHugeRegion(size_t size){
+    void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if(memory != MAP_FAILED){
+        sMappedBytes.fetch_add(size, std::memory_order_relaxed);
+        sExplicitBytes.fetch_add(size, std::memory_order_relaxed);
+        return memory;
+    }
+    // No reserved huge pages: map a page more than needed and trim both
+    // ends, so the region is aligned for transparent huge pages
+    size_t padded = size + HUGE_PAGE_SIZE;
+    char* base = (char*)mmap(nullptr, padded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(base == (char*)MAP_FAILED){
+        throw std::bad_alloc();
+    }
+    char* aligned = (char*)RoundUp((uintptr_t)base, HUGE_PAGE_SIZE);
+    char* end = aligned + size;
+    if(aligned > base){
+        munmap(base, aligned - base);
+    }
+    if(base + padded > end){
+        munmap(end, base + padded - end);
+    }
+    madvise(aligned, size, MADV_HUGEPAGE);
+    sMappedBytes.fetch_add(size, std::memory_order_relaxed);
+    return aligned;
+}
+
+// A chunk starts with its header, allocations follow
+struct ChunkHeader{
+    // Allocations still in the chunk, plus one while a thread carves
+    // from it
+    std::atomic<size_t> users;
+};
+static const size_t CHUNK_HEADER_BYTES = 64;
+static const size_t CHUNK_ALIGNMENT = 64;
+
+static void ReleaseChunk(char* chunk){
+    ChunkHeader* header = (ChunkHeader*)chunk;
+    if(header->users.fetch_sub(1, std::memory_order_acq_rel) == 1){
+        header->~ChunkHeader();
+        munmap(chunk, HUGE_PAGE_SIZE);
+    }
+}
+
+// The chunk the thread allocates from
+struct ThreadChunk{
+    char* chunk{nullptr};
+    size_t used{0};
+
+    // Destructor
+    ~ThreadChunk(){
+        if(chunk != nullptr){
+            ReleaseChunk(chunk);
+        }
+    }
+};
+static thread_local ThreadChunk sThreadChunk;
+
+void* AllocateHugePages(size_t bytes){
+    if(bytes >= HUGE_PAGE_OWN_BYTES){
+        return MapHugeRegion(RoundUp(bytes, HUGE_PAGE_SIZE));
+    }
+    size_t size = RoundUp(bytes, CHUNK_ALIGNMENT);
+    ThreadChunk& current = sThreadChunk;
+    if(current.chunk == nullptr || current.used + size > HUGE_PAGE_SIZE){
+        char* chunk = (char*)MapHugeRegion(HUGE_PAGE_SIZE);
+        new (chunk) ChunkHeader{{1}};
+        if(current.chunk != nullptr){
+            ReleaseChunk(current.chunk);
+        }
+        current.chunk = chunk;
+        current.used = CHUNK_HEADER_BYTES;
+    }
+    ((ChunkHeader*)current.chunk)->users.fetch_add(1, std::memory_order_relaxed);
+    void* memory = current.chunk + current.used;
+    current.used += size;
+    return memory;
+}
+
+void FreeHugePages(void* memory, size_t bytes){
+    if(bytes >= HUGE_PAGE_OWN_BYTES){
+        munmap(memory, RoundUp(bytes, HUGE_PAGE_SIZE));
+        return;
+    }
+    // Chunks are aligned to their size, so the header is found by
+    // rounding down
+    ReleaseChunk((char*)((uintptr_t)memory & ~(uintptr_t)(HUGE_PAGE_SIZE - 1)));
+}
+
+void AdviseHugePages(const void* data, size_t size){
+    uintptr_t begin = RoundUp((uintptr_t)data, HUGE_PAGE_SIZE);
+    uintptr_t end = ((uintptr_t)data + size) & ~(uintptr_t)(HUGE_PAGE_SIZE - 1);
+    if(end > begin){
+        // Fails harmlessly where transparent huge pages are off
+        madvise((void*)begin, end - begin, MADV_HUGEPAGE);
+    }
+}
+
+#else
+
+void* AllocateHugePages(size_t bytes){
+    return ::operator new(bytes, std::align_val_t(64));
+}
+
+void FreeHugePages(void* memory, size_t bytes){
+    (void)bytes;
+    ::operator delete(memory, std::align_val_t(64));
+}
+
+void AdviseHugePages(const void* data, size_t size){
+    (void)data;
+    (void)size;
+}
+
+#endif
@@ -1,9 +1,11 @@
 #include "Image.hpp"
-#include <fstream>
+#include "FileView.hpp"
+#include "MemoryTags.hpp"
 #include <iostream>
 #include <string.h>
 #include <stdio.h>
 #include <memory>
+#include <vector>
 
 // Constructor
 Image::Image(std::string filepath) : m_filepath(filepath){
@@ -17,84 +19,195 @@ Image::~Image (){
     // in our rendering process.
     if(m_pixelData!=NULL){
         delete[] m_pixelData;
+        MemoryTags::Remove(MEMORY_IMAGES, m_pixelBytes);
     }
 }
 
+// Skips whitespace and '#' comments in a PNM header
+static const char* SkipPPMWhitespace(const char* p, const char* end){
+    while(p < end){
+        if(*p == '#'){
+            while(p < end && *p != '\n'){
+                ++p;
+            }
+        }else if(*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'){
+            ++p;
+        }else{
+            break;
+        }
+    }
+    return p;
+}
+
+// Reads one unsigned decimal integer without going through std::string.
+// Returns nullptr if no digits were found.
+static const char* ScanPPMInt(const char* p, const char* end, int& value){
+    p = SkipPPMWhitespace(p, end);
+    if(p >= end || *p < '0' || *p > '9'){
+        return nullptr;
+    }
+    int result = 0;
+    while(p < end && *p >= '0' && *p <= '9'){
+        result = result*10 + (*p - '0');
+        ++p;
+    }
+    value = result;
+    return p;
+}
+
 // Little function for loading the pixel data
 // from a PPM image.
-// TODO: Expects a very specific version of PPM!
+// Supports the ASCII (P3) and binary (P6) layouts with 8-bit channels.
+// The pixels are decoded straight into their final place, so there is
+// one allocation and one pass over the data.
 //
-// flip - Will flip the pixels upside down in the data
+// flip - Stores the rows bottom-up, the first row in memory being the
+//        bottom of the picture, as OpenGL's texture origin expects.
 //        If you use this be consistent.
-void Image::LoadPPM(bool flip){
-
-  // Open an input file stream for reading a file
-  std::ifstream ppmFile(m_filepath.c_str());
-  // If our file successfully opens, begin to process it.
-  if (ppmFile.is_open()){
-      // line will store one line of input
-      std::string line;
-      // Our loop invariant is to continue reading input until
-      // we reach the end of the file and it reads in a NULL character
-      //std::cout << "Reading in ppm file: " << m_filepath << std::endl;
-      unsigned int iteration = 0;
-      unsigned int pos = 0;
-      while ( getline (ppmFile,line) ){
-         // Ignore comments in the file
-         if (line[0]=='#'){
-            continue;
-         }
-         if(line[0]=='P'){
-            magicNumber = line;
-         }else if(iteration==1){
-            // Returns first token 
-            char *token = strtok((char*)line.c_str(), " "); 
-            m_width = atoi(token);
-            token = strtok(NULL, " ");
-            m_height = atoi(token);
-            //std::cout << "PPM width,height=" << m_width << "," << m_height << "\n";
-            if(m_width > 0 && m_height > 0){
-                m_pixelData = new uint8_t[m_width*m_height*3];
-                if(m_pixelData==NULL){
-                    std::cout << "Unable to allocate memory for ppm" << std::endl;
-                    exit(1);
-                 }
-             }else{
-                std::cout << "PPM not parsed correctly, width and/or height dimensions are 0" << std::endl;
-                exit(1);
-             }
-         }else if(iteration==2){
-            // max color range is stored here
-            // TODO: Can be stored optionally
-         }else{
-            m_pixelData[pos] = (uint8_t)atoi(line.c_str());
-            ++pos;
-         }
-          iteration++;
-    }             
-    ppmFile.close();
-  }
-  else{
+// padToRGBA - Stores 4 bytes per pixel with an opaque alpha, so every
+//        row is 4-byte aligned and uploads without a repack.
+// colorKey - With padToRGBA, stores pure magenta texels with alpha 0,
+//        so a PPM can have transparent parts.
+// A file that cannot be read or is malformed leaves no pixels and
+// returns false, so a caller can keep what it had or give up.
+bool Image::LoadPPM(bool flip, bool padToRGBA, bool colorKey){
+
+  // Map the file and parse it in place, no copies into stream buffers.
+  FileView ppmFile(m_filepath);
+  if (!ppmFile.IsOpen()){
       std::cout << "Unable to open ppm file:" << m_filepath << std::endl;
-  } 
-
-    // Flip all of the pixels
-    if(flip){
-        // Copy all of the data to a temporary stack-allocated array
-        uint8_t* copyData = new uint8_t[m_width*m_height*3];
-        for(int i =0; i < m_width*m_height*3; ++i){
-            copyData[i]=m_pixelData[i];
-        }
-        //memcpy(copyData,m_pixelData,(m_width*m_height*3)*sizeof(uint8_t));
-        unsigned int pos = (m_width*m_height*3)-1;
-        for(int i =0; i < m_width*m_height*3; i+=3){
-            m_pixelData[pos]=copyData[i+2];
-            m_pixelData[pos-1]=copyData[i+1];
-            m_pixelData[pos-2]=copyData[i];
-            pos-=3;
-        }
-        delete[] copyData;
-    }
+      FreePixels();
+      return false;
+  }
+
+  const char* p = ppmFile.Data();
+  const char* end = p + ppmFile.Size();
+
+  // Magic number: P3 (ASCII) or P6 (binary)
+  p = SkipPPMWhitespace(p, end);
+  if(end - p < 2 || p[0] != 'P' || (p[1] != '3' && p[1] != '6')){
+      std::cout << "PPM not parsed correctly, unsupported format in " << m_filepath << std::endl;
+      FreePixels();
+      return false;
+  }
+  magicNumber = std::string(p, 2);
+  bool binary = (p[1] == '6');
+  p += 2;
+
+  int maxValue = 0;
+  p = ScanPPMInt(p, end, m_width);
+  if(p != nullptr){ p = ScanPPMInt(p, end, m_height); }
+  if(p != nullptr){ p = ScanPPMInt(p, end, maxValue); }
+  if(p == nullptr || m_width <= 0 || m_height <= 0){
+      std::cout << "PPM not parsed correctly, width and/or height dimensions are 0" << std::endl;
+      FreePixels();
+      return false;
+  }
+  if(maxValue <= 0 || maxValue > 255){
+      std::cout << "PPM not parsed correctly, only 8-bit channels are supported" << std::endl;
+      FreePixels();
+      return false;
+  }
+
+  m_BPP = padToRGBA ? 4 : 3;
+  const size_t sourceRowBytes = (size_t)m_width*3;
+  const size_t rowBytes = (size_t)m_width*m_BPP;
+  if(m_pixelData != nullptr){
+      delete[] m_pixelData;
+      MemoryTags::Remove(MEMORY_IMAGES, m_pixelBytes);
+  }
+  m_pixelBytes = rowBytes*m_height;
+  m_pixelData = new uint8_t[m_pixelBytes];
+  MemoryTags::Add(MEMORY_IMAGES, m_pixelBytes);
+
+  if(binary){
+      // Exactly one whitespace byte separates the header from the pixels
+      ++p;
+      if(p > end || (size_t)(end - p) < sourceRowBytes*m_height){
+          std::cout << "PPM not parsed correctly, pixel data is truncated" << std::endl;
+          FreePixels();
+      return false;
+      }
+  }
+
+  for(int row = 0; row < m_height; ++row){
+      uint8_t* destination = m_pixelData + (size_t)(flip ? m_height - 1 - row : row)*rowBytes;
+      if(binary && !padToRGBA){
+          memcpy(destination, p, sourceRowBytes);
+          p += sourceRowBytes;
+          continue;
+      }
+      for(int x = 0; x < m_width; ++x){
+          for(int channel = 0; channel < 3; ++channel){
+              int value = 0;
+              if(binary){
+                  value = (uint8_t)*p++;
+              }else{
+                  p = ScanPPMInt(p, end, value);
+                  if(p == nullptr){
+                      std::cout << "PPM not parsed correctly, pixel data is truncated" << std::endl;
+                      FreePixels();
+      return false;
+                  }
+              }
+              destination[channel] = (uint8_t)value;
+          }
+          if(padToRGBA){
+              bool keyed = colorKey && destination[0] == 255 && destination[1] == 0 && destination[2] == 255;
+              destination[3] = keyed ? 0 : 255;
+          }
+          destination += m_BPP;
+      }
+  }
+  if(padToRGBA && colorKey){
+      BleedKeyedColumns();
+  }
+  return true;
+}
+
+// Drops the pixels of a load that failed part-way
+void Image::FreePixels(){
+  if(m_pixelData != nullptr){
+      delete[] m_pixelData;
+      MemoryTags::Remove(MEMORY_IMAGES, m_pixelBytes);
+  }
+  m_pixelData = nullptr;
+  m_pixelBytes = 0;
+  m_width = 0;
+  m_height = 0;
+}
+
+// Filtering blends the color of transparent texels into the edges of
+// the opaque ones, so they take the color of the nearest opaque texel
+// above or below them instead of keeping the key's magenta.
+void Image::BleedKeyedColumns(){
+  const int noTexel = -1;
+  std::vector<int> nearest(m_height);
+  for(int x = 0; x < m_width; ++x){
+      // Nearest opaque row scanning down, then whichever is closer up
+      int last = noTexel;
+      for(int y = 0; y < m_height; ++y){
+          if(m_pixelData[((size_t)y*m_width + x)*4 + 3] != 0){
+              last = y;
+          }
+          nearest[y] = last;
+      }
+      last = noTexel;
+      for(int y = m_height - 1; y >= 0; --y){
+          uint8_t* texel = m_pixelData + ((size_t)y*m_width + x)*4;
+          if(texel[3] != 0){
+              last = y;
+              continue;
+          }
+          int source = nearest[y];
+          if(last != noTexel && (source == noTexel || last - y < y - source)){
+              source = last;
+          }
+          if(source != noTexel){
+              memcpy(texel, m_pixelData + ((size_t)source*m_width + x)*4, 3);
+          }
+      }
+  }
 }
 
 /*  ===============================================
@@ -103,7 +216,7 @@ Precondition:
 Post-condition:
 =============================================== */ 
 void Image::SetPixel(int x, int y, uint8_t r, uint8_t g, uint8_t b){
-  if(x > m_width || y > m_height){
+  if(x < 0 || y < 0 || x >= m_width || y >= m_height){
     return;
   }
   else{
@@ -111,9 +224,9 @@ void Image::SetPixel(int x, int y, uint8_t r, uint8_t g, uint8_t b){
               << x << "," << y << "from (" <<
               (int)color[x*y] << "," << (int)color[x*y+1] << "," <<
 (int)color[x*y+2] << ")";*/
-    m_pixelData[(x*3)+m_height*(y*3)] 	= r;
-    m_pixelData[(x*3)+m_height*(y*3)+1] = g;
-    m_pixelData[(x*3)+m_height*(y*3)+2] = b;
+    m_pixelData[(y*m_width+x)*m_BPP] 	= r;
+    m_pixelData[(y*m_width+x)*m_BPP+1] = g;
+    m_pixelData[(y*m_width+x)*m_BPP+2] = b;
 /*    std::cout << " to (" << (int)color[x*y] << "," << (int)color[x*y+1] << ","
 << (int)color[x*y+2] << ")" << std::endl;*/
   }
@@ -125,7 +238,7 @@ Precondition:
 Post-condition:
 =============================================== */ 
 void Image::PrintPixels(){
-    for(int x = 0; x <  m_width*m_height*3; ++x){
+    for(int x = 0; x <  m_width*m_height*m_BPP; ++x){
         //std::cout << " " << (int)m_pixelData[x];
     }
     //std::cout << "\n";
@@ -139,3 +252,64 @@ Post-condition:
 uint8_t* Image::GetPixelDataPtr(){
     return m_pixelData;
 }
+
+/*  ===============================================
+Desc: Writes pixels to a binary PPM (P6), top row first
+Precondition: pixels holds width*height pixels of channels bytes (3, or
+    4 whose alpha is left out), rows tightly packed. bottomRowFirst says
+    they were stored bottom-up, as glReadPixels returns them.
+Post-condition: false, after saying so, if the file could not be written
+=============================================== */ 
+bool Image::SavePPM(const std::string& filepath, const uint8_t* pixels, int width, int height, int channels, bool bottomRowFirst){
+    FILE* file = fopen(filepath.c_str(), "wb");
+    if(file == nullptr){
+        std::cout << "Image.cpp: could not open " << filepath << " for writing\n";
+        return false;
+    }
+    fprintf(file, "P6\n%d %d\n255\n", width, height);
+    std::vector<uint8_t> row((size_t)width * 3);
+    bool written = true;
+    for(int y = 0; y < height && written; ++y){
+        const uint8_t* source = pixels + (size_t)(bottomRowFirst ? height - 1 - y : y) * width * channels;
+        for(int x = 0; x < width; ++x){
+            row[x*3 + 0] = source[x*channels + 0];
+            row[x*3 + 1] = source[x*channels + 1];
+            row[x*3 + 2] = source[x*channels + 2];
+        }
+        written = fwrite(row.data(), 1, row.size(), file) == row.size();
+    }
+    if(fclose(file) != 0 || !written){
+        std::cout << "Image.cpp: could not write " << filepath << "\n";
+        return false;
+    }
+    return true;
+}
+
+/*  ===============================================
+Desc: Finds the pixels of a binary PPM (P6) in memory, e.g. a mapped file
+Precondition: data holds size bytes
+Post-condition: width and height set and the first pixel of the top row
+    returned, or nullptr if the header is not an 8-bit P6 or the pixels
+    are cut short
+=============================================== */ 
+const uint8_t* Image::FindP6Pixels(const char* data, size_t size, int& width, int& height){
+    const char* end = data + size;
+    const char* p = SkipPPMWhitespace(data, end);
+    if(end - p < 2 || p[0] != 'P' || p[1] != '6'){
+        return nullptr;
+    }
+    p += 2;
+    int maxValue = 0;
+    p = ScanPPMInt(p, end, width);
+    if(p != nullptr){ p = ScanPPMInt(p, end, height); }
+    if(p != nullptr){ p = ScanPPMInt(p, end, maxValue); }
+    if(p == nullptr || width <= 0 || height <= 0 || maxValue <= 0 || maxValue > 255){
+        return nullptr;
+    }
+    // Exactly one whitespace byte separates the header from the pixels
+    ++p;
+    if(p > end || (size_t)(end - p) / 3 / (size_t)width < (size_t)height){
+        return nullptr;
+    }
+    return (const uint8_t*)p;
+}
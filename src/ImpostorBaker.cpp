@@ -0,0 +1,123 @@
+#include "ImpostorBaker.hpp"
+#include "GLStateCache.hpp"
+#include "GPUResourceTracker.hpp"
+#include "VertexFormat.hpp"
+
+#include "glm/gtc/matrix_transform.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+// Smallest sphere radius framed, so a degenerate mesh still gets a camera
+static const float MIN_RADIUS = 1e-3f;
+
+// Constructor
+ImpostorBaker::ImpostorBaker(){
+
+}
+
+// Destructor
+ImpostorBaker::~ImpostorBaker(){
+    if(m_framebuffer != 0){
+        std::cout << "ImpostorBaker.cpp: framebuffer was never released\n";
+    }
+}
+
+bool ImpostorBaker::Initialize(int width, int height){
+    Release();
+    if(width <= 0 || height <= 0){
+        std::cout << "ImpostorBaker.cpp: invalid size " << width << "x" << height << "\n";
+        return false;
+    }
+    m_width = width;
+    m_height = height;
+
+    glGenRenderbuffers(1, &m_colorBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_colorBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    GPUResourceTracker::Get().Created(GPU_RENDERBUFFER, m_colorBuffer, "impostor color", (size_t)width * height * 4);
+    glGenRenderbuffers(1, &m_depthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_depthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    GPUResourceTracker::Get().Created(GPU_RENDERBUFFER, m_depthBuffer, "impostor depth", (size_t)width * height * 4);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &m_framebuffer);
+    GPUResourceTracker::Get().Created(GPU_FRAMEBUFFER, m_framebuffer, "impostor framebuffer");
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_colorBuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_depthBuffer);
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if(status != GL_FRAMEBUFFER_COMPLETE){
+        std::cout << "ImpostorBaker.cpp: framebuffer incomplete (0x" << std::hex << status << std::dec << ")\n";
+        Release();
+        return false;
+    }
+    return true;
+}
+
+void ImpostorBaker::Begin(){
+    GLStateCache& state = GLStateCache::Get();
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+    state.Viewport(0, 0, m_width, m_height);
+    // Transparent where the mesh is not, so those texels are discarded
+    state.ClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
+
+void ImpostorBaker::End(TextureArray& array, int layer){
+    // The layers are the size of the framebuffer, or the copy would
+    // leave part of one stale
+    int width = std::min(m_width, array.GetWidth());
+    int height = std::min(m_height, array.GetHeight());
+    array.CopyFramebuffer(layer, width, height);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void ImpostorBaker::Release(){
+    GPUResourceTracker& tracker = GPUResourceTracker::Get();
+    if(m_framebuffer != 0){
+        glDeleteFramebuffers(1, &m_framebuffer);
+        tracker.Deleted(GPU_FRAMEBUFFER, m_framebuffer);
+        m_framebuffer = 0;
+    }
+    for(GLuint* buffer : {&m_colorBuffer, &m_depthBuffer}){
+        if(*buffer != 0){
+            glDeleteRenderbuffers(1, buffer);
+            tracker.Deleted(GPU_RENDERBUFFER, *buffer);
+            *buffer = 0;
+        }
+    }
+}
+
+DrawRange ImpostorBaker::AppendQuad(const BoundingSphere& sphere, std::vector<float>& vertices,
+                                    std::vector<uint32_t>& indices){
+    float r = std::max(sphere.radius, MIN_RADIUS);
+    // Corners as offsets from the center, facing +z, bottom row of the
+    // picture at v = 0
+    const float corners[4][2] = {{-1.0f, -1.0f}, {1.0f, -1.0f}, {1.0f, 1.0f}, {-1.0f, 1.0f}};
+    DrawRange range;
+    range.baseVertex = (GLint)(vertices.size() / FLOATS_PER_VERTEX);
+    range.firstIndex = (GLsizei)indices.size();
+    range.indexCount = 6;
+    for(const float* corner : corners){
+        const float vertex[FLOATS_PER_VERTEX] = {corner[0]*r, corner[1]*r, 0.0f, 0.0f, 0.0f, 1.0f,
+                                                 (corner[0] + 1.0f)*0.5f, (corner[1] + 1.0f)*0.5f};
+        vertices.insert(vertices.end(), vertex, vertex + FLOATS_PER_VERTEX);
+    }
+    const uint32_t quad[6] = {0, 1, 2, 0, 2, 3};
+    indices.insert(indices.end(), quad, quad + 6);
+    return range;
+}
+
+void ImpostorBaker::GetBakeCamera(const BoundingSphere& sphere, const glm::vec3& direction,
+                                  glm::mat4& view, glm::mat4& projection){
+    float r = std::max(sphere.radius, MIN_RADIUS);
+    glm::vec3 center(sphere.center[0], sphere.center[1], sphere.center[2]);
+    glm::vec3 forward = glm::normalize(direction);
+    // Oriented as the game camera is, with the world's +y up, so the
+    // picture's right and up are the ones the quad turns to
+    view = glm::lookAt(center - forward*(2.0f*r), center, glm::vec3(0.0f, 1.0f, 0.0f));
+    projection = glm::ortho(-r, r, -r, r, r, 3.0f*r);
+}
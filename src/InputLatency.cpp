@@ -0,0 +1,97 @@
+#include "InputLatency.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+// Constructor
+InputLatency::InputLatency(){
+
+}
+
+// Destructor
+InputLatency::~InputLatency(){
+
+}
+
+void InputLatency::Initialize(uint64_t countsPerSecond){
+    m_millisecondsPerCount = (countsPerSecond > 0) ? 1000.0 / (double)countsPerSecond : 0.0;
+}
+
+void InputLatency::AddInput(uint64_t counter){
+    if(m_waitingCount < MAX_INPUTS){
+        m_waitingSequence[m_waitingCount] = m_sequence;
+        m_waiting[m_waitingCount++] = counter;
+    }
+}
+
+uint32_t InputLatency::Submit(){
+    return m_sequence++;
+}
+
+void InputLatency::Simulated(){
+    for(int i = 0; i < m_waitingCount && m_simulatedCount < MAX_INPUTS; ++i){
+        m_simulated[m_simulatedCount++] = m_waiting[i];
+    }
+    m_waitingCount = 0;
+}
+
+void InputLatency::Simulated(uint32_t sequence){
+    int kept = 0;
+    for(int i = 0; i < m_waitingCount; ++i){
+        // Sequence numbers wrap around
+        if((int32_t)(m_waitingSequence[i] - sequence) <= 0){
+            if(m_simulatedCount < MAX_INPUTS){
+                m_simulated[m_simulatedCount++] = m_waiting[i];
+            }
+        }else{
+            m_waitingSequence[kept] = m_waitingSequence[i];
+            m_waiting[kept++] = m_waiting[i];
+        }
+    }
+    m_waitingCount = kept;
+}
+
+void InputLatency::Drop(){
+    m_waitingCount = 0;
+}
+
+void InputLatency::Presented(uint64_t counter){
+    m_presentedCount = 0;
+    for(int i = 0; i < m_simulatedCount; ++i){
+        // An event stamped a little after the poll counts as no latency
+        double milliseconds = (counter > m_simulated[i]) ? (counter - m_simulated[i]) * m_millisecondsPerCount : 0.0;
+        m_presented[m_presentedCount++] = milliseconds;
+        m_swap.Add(milliseconds);
+        m_swapped[i] = m_simulated[i];
+    }
+    // Inputs of a frame that is never waited on are replaced here
+    m_swappedCount = m_simulatedCount;
+    m_simulatedCount = 0;
+}
+
+void InputLatency::Completed(uint64_t counter){
+    for(int i = 0; i < m_swappedCount; ++i){
+        m_gpu.Add((counter > m_swapped[i]) ? (counter - m_swapped[i]) * m_millisecondsPerCount : 0.0);
+    }
+    m_swappedCount = 0;
+}
+
+void InputLatency::Window::Add(double milliseconds){
+    samples[next] = milliseconds;
+    next = (next + 1) % WINDOW;
+    if(count < WINDOW){
+        ++count;
+    }
+    ++total;
+}
+
+double InputLatency::Window::GetPercentile(double percent) const{
+    if(count == 0){
+        return -1.0;
+    }
+    double sorted[WINDOW];
+    std::copy(samples, samples + count, sorted);
+    int index = std::min(count - 1, (int)std::floor(count * std::min(100.0, std::max(0.0, percent)) / 100.0));
+    std::nth_element(sorted, sorted + index, sorted + count);
+    return sorted[index];
+}
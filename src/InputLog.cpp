@@ -0,0 +1,219 @@
+#include "InputLog.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+static const char LOG_MAGIC[4] = {'D', 'L', 'O', 'G'};
+static const char KEYFRAME_MAGIC[4] = {'D', 'K', 'E', 'Y'};
+// Bumped whenever the rules change, older logs would not replay the same
+// game: 2 added obstacle groups, 3 swept collisions
+static const uint32_t LOG_VERSION = 3;
+
+unsigned int StepLoggedInput(GameState& state, uint8_t input, uint64_t seed, uint64_t& gamesPlayed){
+    if(input & INPUT_RESTART){
+        ResetGameState(state, seed, ++gamesPlayed);
+    }
+    state.invincible = (input & INPUT_INVINCIBLE) != 0;
+    return Step(state, (input & INPUT_JUMP) ? ACTION_JUMP : ACTION_NONE);
+}
+
+// Little endian helpers
+static void WriteUint(std::ofstream& file, uint64_t value, int bytes){
+    for(int i = 0; i < bytes; ++i){
+        file.put((char)((value >> (8*i)) & 0xff));
+    }
+}
+
+static bool ReadUint(std::istream& file, uint64_t& value, int bytes){
+    value = 0;
+    for(int i = 0; i < bytes; ++i){
+        int byte = file.get();
+        if(byte == EOF){
+            return false;
+        }
+        value |= (uint64_t)byte << (8*i);
+    }
+    return true;
+}
+
+// Constructor
+InputLog::InputLog(){
+
+}
+
+// Destructor
+InputLog::~InputLog(){
+
+}
+
+void InputLog::Begin(uint64_t seed){
+    m_seed = seed;
+    m_inputs.clear();
+    m_keyframes.clear();
+    m_keyframeInterval = KEYFRAME_INTERVAL;
+}
+
+void InputLog::AppendKeyframes(std::vector<ReplayKeyframe>& keyframes) const{
+    ReplayKeyframe keyframe;
+    if(keyframes.empty()){
+        ResetGameState(keyframe.state, m_seed, 0);
+        keyframes.push_back(keyframe);
+    }
+    keyframe = keyframes.back();
+    for(size_t step = (size_t)keyframe.step; step < m_inputs.size(); ++step){
+        StepLoggedInput(keyframe.state, m_inputs[step], m_seed, keyframe.gamesPlayed);
+        if((step + 1) % m_keyframeInterval == 0){
+            keyframe.step = step + 1;
+            keyframes.push_back(keyframe);
+        }
+    }
+}
+
+void InputLog::BuildKeyframes(){
+    AppendKeyframes(m_keyframes);
+}
+
+size_t InputLog::Seek(size_t step, GameState& state, uint64_t& gamesPlayed) const{
+    step = std::min(step, m_inputs.size());
+    // The last keyframe at or before step
+    auto after = std::upper_bound(m_keyframes.begin(), m_keyframes.end(), (uint64_t)step,
+                                  [](uint64_t target, const ReplayKeyframe& keyframe){
+        return target < keyframe.step;
+    });
+    size_t from = 0;
+    if(after == m_keyframes.begin()){
+        gamesPlayed = 0;
+        ResetGameState(state, m_seed, gamesPlayed);
+    }else{
+        const ReplayKeyframe& keyframe = *(after - 1);
+        from = (size_t)keyframe.step;
+        state = keyframe.state;
+        gamesPlayed = keyframe.gamesPlayed;
+    }
+    for(size_t i = from; i < step; ++i){
+        StepLoggedInput(state, m_inputs[i], m_seed, gamesPlayed);
+    }
+    return step - from;
+}
+
+bool InputLog::Save(const std::string& filepath) const{
+    std::ofstream file(filepath.c_str(), std::ios::binary | std::ios::trunc);
+    if(!file.is_open()){
+        std::cout << "InputLog.cpp: could not write " << filepath << "\n";
+        return false;
+    }
+    file.write(LOG_MAGIC, sizeof(LOG_MAGIC));
+    WriteUint(file, LOG_VERSION, 4);
+    WriteUint(file, m_seed, 8);
+    WriteUint(file, m_inputs.size(), 8);
+
+    size_t step = 0;
+    while(step < m_inputs.size()){
+        uint8_t input = m_inputs[step];
+        uint64_t run = 1;
+        while(step + run < m_inputs.size() && m_inputs[step + run] == input){
+            ++run;
+        }
+        step += run;
+        file.put((char)input);
+        // LEB128: seven bits at a time, high bit set while more follow
+        while(run >= 0x80){
+            file.put((char)((run & 0x7f) | 0x80));
+            run >>= 7;
+        }
+        file.put((char)run);
+    }
+
+    std::vector<ReplayKeyframe> keyframes = m_keyframes;
+    AppendKeyframes(keyframes);
+    file.write(KEYFRAME_MAGIC, sizeof(KEYFRAME_MAGIC));
+    WriteUint(file, m_keyframeInterval, 4);
+    WriteUint(file, sizeof(GameState), 4);
+    WriteUint(file, keyframes.size(), 8);
+    for(const ReplayKeyframe& keyframe : keyframes){
+        WriteUint(file, keyframe.step, 8);
+        WriteUint(file, keyframe.gamesPlayed, 8);
+        // Plain data, see GameState.hpp
+        file.write((const char*)&keyframe.state, sizeof(GameState));
+    }
+    return file.good();
+}
+
+bool InputLog::LoadKeyframes(std::istream& file, uint64_t stepCount){
+    char magic[4];
+    uint64_t interval = 0;
+    uint64_t stateBytes = 0;
+    uint64_t count = 0;
+    if(!file.read(magic, sizeof(magic)) || std::memcmp(magic, KEYFRAME_MAGIC, sizeof(magic)) != 0 ||
+       !ReadUint(file, interval, 4) || !ReadUint(file, stateBytes, 4) || !ReadUint(file, count, 8) ||
+       interval == 0 || stateBytes != sizeof(GameState) || count > stepCount / interval + 1){
+        return false;
+    }
+    std::vector<ReplayKeyframe> keyframes((size_t)count);
+    for(size_t i = 0; i < keyframes.size(); ++i){
+        ReplayKeyframe& keyframe = keyframes[i];
+        if(!ReadUint(file, keyframe.step, 8) || !ReadUint(file, keyframe.gamesPlayed, 8) ||
+           !file.read((char*)&keyframe.state, sizeof(GameState))){
+            return false;
+        }
+        // One every interval from step 0, which the rebuilding relies on
+        if(keyframe.step != i * interval || keyframe.step > stepCount){
+            return false;
+        }
+    }
+    m_keyframeInterval = (size_t)interval;
+    m_keyframes.swap(keyframes);
+    return true;
+}
+
+bool InputLog::Load(const std::string& filepath){
+    std::ifstream file(filepath.c_str(), std::ios::binary);
+    if(!file.is_open()){
+        std::cout << "InputLog.cpp: could not open " << filepath << "\n";
+        return false;
+    }
+    char magic[4];
+    uint64_t version = 0;
+    uint64_t seed = 0;
+    uint64_t stepCount = 0;
+    if(!file.read(magic, sizeof(magic)) || std::string(magic, 4) != std::string(LOG_MAGIC, 4) ||
+       !ReadUint(file, version, 4) || version != LOG_VERSION ||
+       !ReadUint(file, seed, 8) || !ReadUint(file, stepCount, 8)){
+        std::cout << "InputLog.cpp: " << filepath << " is not an input log\n";
+        return false;
+    }
+
+    std::vector<uint8_t> inputs;
+    inputs.reserve((size_t)stepCount);
+    while(inputs.size() < stepCount){
+        int input = file.get();
+        uint64_t run = 0;
+        int shift = 0;
+        int byte = 0;
+        do{
+            byte = file.get();
+            if(byte == EOF || shift > 63){
+                byte = EOF;
+                break;
+            }
+            run |= (uint64_t)(byte & 0x7f) << shift;
+            shift += 7;
+        }while(byte & 0x80);
+        if(input == EOF || byte == EOF || run == 0 || run > stepCount - inputs.size()){
+            std::cout << "InputLog.cpp: " << filepath << " is truncated or corrupt\n";
+            return false;
+        }
+        inputs.insert(inputs.end(), (size_t)run, (uint8_t)input);
+    }
+    m_seed = seed;
+    m_inputs.swap(inputs);
+    m_keyframes.clear();
+    m_keyframeInterval = KEYFRAME_INTERVAL;
+    if(!LoadKeyframes(file, stepCount)){
+        m_keyframes.clear();
+        m_keyframeInterval = KEYFRAME_INTERVAL;
+    }
+    return true;
+}
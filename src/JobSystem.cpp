@@ -0,0 +1,285 @@
+#include "JobSystem.hpp"
+
+#include <algorithm>
+
+// Ring of the calling thread: its own for a worker, 0 for any other
+static thread_local unsigned int sRingIndex = 0;
+
+// Constructor
+JobCounter::JobCounter(){
+
+}
+
+// Destructor
+JobCounter::~JobCounter(){
+
+}
+
+JobSystem& JobSystem::Get(){
+    static JobSystem jobs;
+    return jobs;
+}
+
+// Constructor
+JobSystem::JobSystem(){
+
+}
+
+// Destructor
+JobSystem::~JobSystem(){
+    Stop();
+}
+
+void JobSystem::Start(unsigned int threadCount, const AffinityConfig& affinity){
+    std::call_once(m_started, [this, threadCount, &affinity]{
+        unsigned int threads = threadCount;
+        if(threads == 0){
+            threads = std::thread::hardware_concurrency();
+            if(threads == 0){
+                threads = 1;
+            }
+        }
+        m_mainThread = std::this_thread::get_id();
+        m_affinity = affinity;
+        m_cores = GetAffinityOrder(affinity);
+        PinPoolThread(m_affinity, m_cores, 0);
+        for(unsigned int i = 0; i < threads; ++i){
+            m_rings.emplace_back(new Ring());
+        }
+        // The main thread works too, whenever it waits
+        for(unsigned int i = 1; i < threads; ++i){
+            m_threads.emplace_back(&JobSystem::WorkerMain, this, i);
+        }
+    });
+}
+
+void JobSystem::Stop(){
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    for(std::thread& thread : m_threads){
+        thread.join();
+    }
+    m_threads.clear();
+}
+
+void JobSystem::Submit(Job job, JobCounter* counter){
+    Start();
+    if(counter != nullptr){
+        counter->m_pending.fetch_add(1, std::memory_order_relaxed);
+    }
+    Push(std::move(job), counter);
+}
+
+void JobSystem::SubmitAfter(JobCounter& dependency, Job job, JobCounter* counter){
+    Start();
+    if(counter != nullptr){
+        counter->m_pending.fetch_add(1, std::memory_order_relaxed);
+    }
+    {
+        std::lock_guard<std::mutex> lock(dependency.m_mutex);
+        if(dependency.m_pending.load(std::memory_order_acquire) != 0){
+            dependency.m_continuations.push_back(JobCounter::Continuation{std::move(job), counter});
+            return;
+        }
+    }
+    Push(std::move(job), counter);
+}
+
+void JobSystem::Push(Job job, JobCounter* counter){
+    // Without workers, or with the ring full, the job runs right here
+    if(m_threads.empty()){
+        job();
+        Finish(counter);
+        return;
+    }
+    Ring& ring = *m_rings[GetRingIndex()];
+    {
+        std::unique_lock<std::mutex> lock(ring.mutex);
+        if(ring.count == RING_CAPACITY){
+            lock.unlock();
+            job();
+            Finish(counter);
+            return;
+        }
+        Entry& entry = ring.entries[(ring.front + ring.count) % RING_CAPACITY];
+        entry.job = std::move(job);
+        entry.counter = counter;
+        ++ring.count;
+    }
+    m_queued.fetch_add(1, std::memory_order_release);
+    // Taking the lock orders this with a worker that is about to sleep
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+    }
+    m_wake.notify_one();
+}
+
+void JobSystem::Hold(JobCounter& counter){
+    counter.m_pending.fetch_add(1, std::memory_order_relaxed);
+}
+
+void JobSystem::Release(JobCounter& counter){
+    Start();
+    Finish(&counter);
+}
+
+void JobSystem::Wait(JobCounter& counter){
+    Start();
+    unsigned int index = GetRingIndex();
+    bool mainThread = IsMainThread();
+    while(!counter.IsDone()){
+        if(RunOne(index)){
+            continue;
+        }
+        if(mainThread && RunMainThreadJobs() > 0){
+            continue;
+        }
+        std::this_thread::yield();
+    }
+    // The job that finished last is out of the counter once it lets go
+    std::lock_guard<std::mutex> lock(counter.m_mutex);
+}
+
+void JobSystem::ParallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& task){
+    Start();
+    size_t pieces = std::min<size_t>(count / std::max<size_t>(1, grain), GetThreadCount());
+    if(pieces <= 1){
+        task(0, count);
+        return;
+    }
+    // Each job only carries a pointer to this and its piece
+    struct Range{
+        const std::function<void(size_t, size_t)>* task;
+        size_t count;
+        size_t pieces;
+    };
+    const Range range = {&task, count, pieces};
+    JobCounter counter;
+    for(size_t piece = 1; piece < pieces; ++piece){
+        Submit([&range, piece]{
+            (*range.task)(range.count * piece / range.pieces, range.count * (piece + 1) / range.pieces);
+        }, &counter);
+    }
+    task(0, count / pieces);
+    Wait(counter);
+}
+
+void JobSystem::RunOnMainThread(Job job, JobCounter* counter){
+    if(counter != nullptr){
+        counter->m_pending.fetch_add(1, std::memory_order_relaxed);
+    }
+    std::lock_guard<std::mutex> lock(m_mainMutex);
+    m_mainJobs.push_back(Entry{std::move(job), counter});
+}
+
+size_t JobSystem::RunMainThreadJobs(){
+    // A main thread job that waits gets here again; the outer call
+    // finishes the batch
+    if(m_runningMain){
+        return 0;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mainMutex);
+        if(m_mainJobs.empty()){
+            return 0;
+        }
+        m_mainRunning.swap(m_mainJobs);
+    }
+    m_runningMain = true;
+    for(Entry& entry : m_mainRunning){
+        entry.job();
+        Finish(entry.counter);
+    }
+    m_runningMain = false;
+    size_t ran = m_mainRunning.size();
+    // Keeps its capacity for the next batch
+    m_mainRunning.clear();
+    return ran;
+}
+
+bool JobSystem::IsMainThread() const{
+    return std::this_thread::get_id() == m_mainThread;
+}
+
+void JobSystem::WorkerMain(unsigned int index){
+    sRingIndex = index;
+    PinPoolThread(m_affinity, m_cores, index);
+    for(;;){
+        if(RunOne(index)){
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(m_sleepMutex);
+        m_wake.wait(lock, [this]{ return m_stop || m_queued.load(std::memory_order_acquire) > 0; });
+        if(m_stop && m_queued.load(std::memory_order_acquire) == 0){
+            return;
+        }
+    }
+}
+
+bool JobSystem::RunOne(unsigned int index){
+    Entry entry;
+    if(!Pop(index, entry) && !Steal(index, entry)){
+        return false;
+    }
+    m_queued.fetch_sub(1, std::memory_order_relaxed);
+    entry.job();
+    Finish(entry.counter);
+    return true;
+}
+
+bool JobSystem::Pop(unsigned int index, Entry& entry){
+    Ring& ring = *m_rings[index];
+    std::lock_guard<std::mutex> lock(ring.mutex);
+    if(ring.count == 0){
+        return false;
+    }
+    --ring.count;
+    Entry& back = ring.entries[(ring.front + ring.count) % RING_CAPACITY];
+    entry.job = std::move(back.job);
+    entry.counter = back.counter;
+    back.job = nullptr;
+    return true;
+}
+
+bool JobSystem::Steal(unsigned int thief, Entry& entry){
+    size_t rings = m_rings.size();
+    for(size_t offset = 1; offset < rings; ++offset){
+        Ring& ring = *m_rings[(thief + offset) % rings];
+        std::lock_guard<std::mutex> lock(ring.mutex);
+        if(ring.count == 0){
+            continue;
+        }
+        Entry& front = ring.entries[ring.front];
+        entry.job = std::move(front.job);
+        entry.counter = front.counter;
+        front.job = nullptr;
+        ring.front = (ring.front + 1) % RING_CAPACITY;
+        --ring.count;
+        return true;
+    }
+    return false;
+}
+
+void JobSystem::Finish(JobCounter* counter){
+    if(counter == nullptr){
+        return;
+    }
+    std::vector<JobCounter::Continuation> ready;
+    {
+        std::lock_guard<std::mutex> lock(counter->m_mutex);
+        if(counter->m_pending.fetch_sub(1, std::memory_order_acq_rel) == 1){
+            ready.swap(counter->m_continuations);
+        }
+    }
+    // The counter may be gone from here on; its continuations are not
+    for(JobCounter::Continuation& continuation : ready){
+        Push(std::move(continuation.job), continuation.counter);
+    }
+}
+
+unsigned int JobSystem::GetRingIndex() const{
+    return sRingIndex;
+}
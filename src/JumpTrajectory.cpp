@@ -0,0 +1,127 @@
+#include "JumpTrajectory.hpp"
+#include "Collision.hpp"
+#include "GameState.hpp"
+
+// Integer division rounded towards minus and plus infinity, b > 0
+static inline int FloorDivide(int a, int b){
+    return (a >= 0) ? a / b : -((-a + b - 1) / b);
+}
+
+static inline int CeilDivide(int a, int b){
+    return (a >= 0) ? (a + b - 1) / b : -((-a) / b);
+}
+
+JumpProfile MakeJumpProfile(int jumpingSpeed){
+    JumpProfile jump;
+    if(jumpingSpeed <= 0){
+        return jump;
+    }
+    jump.speed = jumpingSpeed;
+    // Rising from 1 until the height reaches the apex
+    jump.riseSteps = CeilDivide(JUMP_APEX - 1, jumpingSpeed);
+    jump.peakHeight = 1 + jump.riseSteps*jumpingSpeed;
+    // Falling until the height is no longer above the ground
+    jump.fallSteps = CeilDivide(jump.peakHeight, jumpingSpeed);
+    jump.landingHeight = jump.peakHeight - jump.fallSteps*jumpingSpeed;
+    return jump;
+}
+
+int GetJumpHeight(const JumpProfile& jump, int t){
+    if(t <= 0 || jump.speed == 0){
+        return 0;
+    }
+    if(t <= jump.riseSteps){
+        return 1 + t*jump.speed;
+    }
+    if(t <= GetJumpDuration(jump)){
+        return jump.peakHeight - (t - jump.riseSteps)*jump.speed;
+    }
+    return jump.landingHeight;
+}
+
+float GetJumpStep(const JumpProfile& jump, int height, bool rising){
+    if(jump.speed == 0){
+        return 0.0f;
+    }
+    if(rising){
+        float t = (float)(height - 1)/(float)jump.speed;
+        return (t < 0.0f) ? 0.0f : t;
+    }
+    // Past the peak. A height above it, left by a slower jump, is the peak.
+    float t = (float)jump.riseSteps + (float)(jump.peakHeight - height)/(float)jump.speed;
+    return (t < (float)jump.riseSteps) ? (float)jump.riseSteps : t;
+}
+
+void UpdateJumpAnchor(JumpAnchor& anchor, int clock, int height, bool rising, int speed){
+    if(height <= 0){
+        return;
+    }
+    anchor.start = (float)clock - GetJumpStep(MakeJumpProfile(speed), height, rising);
+    anchor.speed = speed;
+}
+
+JumpHighSteps GetJumpHighSteps(const JumpProfile& jump){
+    JumpHighSteps high;
+    if(jump.speed == 0){
+        return high;
+    }
+    // A height h is out of reach once the offset -h is below the range
+    const int clearHeight = -GetCollisionRules().hitRange.minY;
+    if(jump.peakHeight <= clearHeight){
+        return high;
+    }
+    // First rising step above clearHeight: 1 + t*speed > clearHeight
+    high.first = FloorDivide(clearHeight - 1, jump.speed) + 1;
+    if(high.first < 1){
+        high.first = 1;
+    }
+    // Last falling step above it: peak - (t - rise)*speed > clearHeight
+    high.last = jump.riseSteps + CeilDivide(jump.peakHeight - clearHeight, jump.speed) - 1;
+    return high;
+}
+
+int GetStepsToImpact(int distance, int speed){
+    const CollisionBox& range = GetCollisionRules().hitRange;
+    if(distance <= range.maxX){
+        return 1;
+    }
+    if(speed <= 0){
+        return ANY_JUMP_STEP;
+    }
+    // First step n with distance - n*speed <= maxX
+    return CeilDivide(distance - range.maxX, speed);
+}
+
+JumpWindow FindJumpWindow(const JumpProfile& jump, int distance, int speed){
+    const CollisionBox& range = GetCollisionRules().hitRange;
+    JumpWindow window;
+    if(speed <= 0){
+        // It never moves: a threat only if it already is within reach
+        if(distance > range.maxX || distance < range.minX){
+            window.latest = ANY_JUMP_STEP;
+        }
+        return window;
+    }
+    // Step n sweeps the obstacle from distance - (n-1)*speed to
+    // distance - n*speed, within reach on the steps firstStep..lastStep
+    int firstStep = GetStepsToImpact(distance, speed);
+    int lastStep = FloorDivide(distance - range.minX, speed) + 1;
+    if(lastStep < 1){
+        // Already behind the dino
+        window.latest = ANY_JUMP_STEP;
+        return window;
+    }
+    // A jump started at step s has the dino at jump height n - s + 1 after
+    // step n and n - s before it. Both ends of every step within reach
+    // have to be high: from jump step firstStep - s to lastStep - s + 1.
+    JumpHighSteps high = GetJumpHighSteps(jump);
+    if(high.first > high.last){
+        return window;
+    }
+    window.earliest = lastStep + 1 - high.last;
+    if(window.earliest < 1){
+        window.earliest = 1;
+    }
+    window.latest = firstStep - high.first;
+    return window;
+}
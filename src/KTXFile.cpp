@@ -0,0 +1,167 @@
+#include "KTXFile.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+static const uint8_t KTX_IDENTIFIER[12] = {
+    0xAB, 0x4B, 0x54, 0x58, 0x20, 0x31, 0x31, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A
+};
+
+// Written into every file, our levels start at the bottom left texel
+static const char KTX_ORIENTATION_KEY[] = "KTXorientation";
+static const char KTX_ORIENTATION_VALUE[] = "S=r,T=u";
+
+// Constructor
+KTXFile::KTXFile(){
+    memset(&m_header, 0, sizeof(m_header));
+}
+
+size_t KTXFile::GetBlockBytes(GLenum internalFormat){
+    switch(internalFormat){
+        case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+        case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+        case GL_COMPRESSED_RGB8_ETC2:
+        case GL_COMPRESSED_SRGB8_ETC2:
+        case GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2:
+            return 8;
+        case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+        case GL_COMPRESSED_RGBA_BPTC_UNORM:
+        case GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM:
+        case GL_COMPRESSED_RGBA8_ETC2_EAC:
+        case GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC:
+            return 16;
+        default:
+            return 0;
+    }
+}
+
+size_t KTXFile::GetImageBytes(GLenum internalFormat, int width, int height){
+    return (size_t)((width + 3) / 4) * (size_t)((height + 3) / 4) * GetBlockBytes(internalFormat);
+}
+
+int KTXFile::GetFullLevelCount(int width, int height){
+    int levels = 1;
+    for(int size = std::max(width, height); size > 1; size >>= 1){
+        ++levels;
+    }
+    return levels;
+}
+
+int KTXFile::GetBaseLevel(int width, int height, int levelCount, int footprintWidth, int footprintHeight){
+    int level = 0;
+    while(level + 1 < levelCount &&
+          (width >> (level + 1)) >= footprintWidth && (height >> (level + 1)) >= footprintHeight){
+        ++level;
+    }
+    return level;
+}
+
+bool KTXFile::Load(const std::string& filepath){
+    m_levels.clear();
+    m_levelSizes.clear();
+    memset(&m_header, 0, sizeof(m_header));
+    if(!m_file.Open(filepath)){
+        return false;
+    }
+
+    KTXHeader header;
+    if(m_file.Size() < sizeof(header)){
+        std::cout << "KTXFile.cpp: " << filepath << " is truncated\n";
+        m_file.Close();
+        return false;
+    }
+    memcpy(&header, m_file.Data(), sizeof(header));
+    if(memcmp(header.identifier, KTX_IDENTIFIER, sizeof(KTX_IDENTIFIER)) != 0 || header.endianness != 0x04030201){
+        std::cout << "KTXFile.cpp: " << filepath << " is not a little endian KTX 1.1 file\n";
+        m_file.Close();
+        return false;
+    }
+    if(header.glType != 0 || GetBlockBytes(header.glInternalFormat) == 0 || header.pixelDepth > 1 ||
+       header.numberOfArrayElements > 0 || header.numberOfFaces != 1 || header.pixelWidth == 0 || header.pixelHeight == 0){
+        std::cout << "KTXFile.cpp: " << filepath << " is not a block-compressed 2D texture\n";
+        m_file.Close();
+        return false;
+    }
+
+    size_t offset = sizeof(header) + header.bytesOfKeyValueData;
+    uint32_t levels = std::max(1u, header.numberOfMipmapLevels);
+    if(levels > (uint32_t)GetFullLevelCount((int)header.pixelWidth, (int)header.pixelHeight)){
+        std::cout << "KTXFile.cpp: " << filepath << " has more levels than a full mip chain\n";
+        m_file.Close();
+        return false;
+    }
+    for(uint32_t level = 0; level < levels; ++level){
+        int width = std::max(1, (int)(header.pixelWidth >> level));
+        int height = std::max(1, (int)(header.pixelHeight >> level));
+        uint32_t imageSize = 0;
+        if(offset + sizeof(imageSize) > m_file.Size()){
+            break;
+        }
+        memcpy(&imageSize, m_file.Data() + offset, sizeof(imageSize));
+        offset += sizeof(imageSize);
+        if(imageSize != GetImageBytes(header.glInternalFormat, width, height) || offset + imageSize > m_file.Size()){
+            break;
+        }
+        m_levels.push_back(m_file.Data() + offset);
+        m_levelSizes.push_back(imageSize);
+        offset += (imageSize + 3u) & ~3u;
+    }
+    if(m_levels.size() != levels){
+        std::cout << "KTXFile.cpp: level " << m_levels.size() << " of " << filepath << " is truncated or the wrong size\n";
+        m_levels.clear();
+        m_levelSizes.clear();
+        m_file.Close();
+        return false;
+    }
+    m_header = header;
+    return true;
+}
+
+bool KTXFile::Write(const std::string& filepath, GLenum internalFormat, GLenum baseFormat,
+                    int width, int height, const std::vector<std::vector<uint8_t>>& levels){
+    // The one key/value pair: its size, key and value null-terminated, padding
+    uint32_t pairBytes = (uint32_t)(sizeof(KTX_ORIENTATION_KEY) + sizeof(KTX_ORIENTATION_VALUE));
+    uint32_t pairPadding = ((pairBytes + 3u) & ~3u) - pairBytes;
+
+    KTXHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.identifier, KTX_IDENTIFIER, sizeof(KTX_IDENTIFIER));
+    header.endianness = 0x04030201;
+    header.glTypeSize = 1;
+    header.glInternalFormat = internalFormat;
+    header.glBaseInternalFormat = baseFormat;
+    header.pixelWidth = (uint32_t)width;
+    header.pixelHeight = (uint32_t)height;
+    header.numberOfFaces = 1;
+    header.numberOfMipmapLevels = (uint32_t)levels.size();
+    header.bytesOfKeyValueData = (uint32_t)sizeof(pairBytes) + pairBytes + pairPadding;
+
+    std::ofstream out(filepath.c_str(), std::ios::binary | std::ios::trunc);
+    if(!out.is_open()){
+        return false;
+    }
+    const char padding[4] = {0, 0, 0, 0};
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(&pairBytes), sizeof(pairBytes));
+    out.write(KTX_ORIENTATION_KEY, sizeof(KTX_ORIENTATION_KEY));
+    out.write(KTX_ORIENTATION_VALUE, sizeof(KTX_ORIENTATION_VALUE));
+    out.write(padding, pairPadding);
+    for(const std::vector<uint8_t>& level : levels){
+        uint32_t imageSize = (uint32_t)level.size();
+        out.write(reinterpret_cast<const char*>(&imageSize), sizeof(imageSize));
+        out.write(reinterpret_cast<const char*>(level.data()), level.size());
+        out.write(padding, ((imageSize + 3u) & ~3u) - imageSize);
+    }
+    return out.good();
+}
+
+std::string KTXFile::VariantPathFor(const std::string& imagePath, const std::string& suffix){
+    size_t dot = imagePath.find_last_of('.');
+    size_t slash = imagePath.find_last_of('/');
+    if(dot == std::string::npos || (slash != std::string::npos && dot < slash)){
+        return imagePath + suffix;
+    }
+    return imagePath.substr(0, dot) + suffix;
+}
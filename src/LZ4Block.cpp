@@ -0,0 +1,182 @@
+#include "LZ4Block.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+// The shortest match a sequence can hold
+static const size_t MIN_MATCH = 4;
+// The last bytes of a block are always literals and no match starts in
+// the bytes before them, as every LZ4 decoder expects
+static const size_t LAST_LITERALS = 5;
+static const size_t MATCH_LIMIT = 12;
+// The farthest a two-byte offset reaches back
+static const size_t MAX_DISTANCE = 65535;
+// Candidates the compressor tries per position
+static const int SEARCH_DEPTH = 256;
+static const int HASH_BITS = 16;
+
+static uint32_t Read32(const unsigned char* data){
+    uint32_t value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+static uint32_t Hash(uint32_t value){
+    return (value * 2654435761u) >> (32 - HASH_BITS);
+}
+
+// The bytes of a length whose nibble is 15
+static void WriteLength(std::vector<char>& out, size_t length){
+    length -= 15;
+    while(length >= 255){
+        out.push_back((char)255);
+        length -= 255;
+    }
+    out.push_back((char)length);
+}
+
+// One sequence: literalCount literals, then a match of matchLength bytes
+// distance back, 0 for the last sequence, which has none
+static void WriteSequence(std::vector<char>& out, const unsigned char* literals, size_t literalCount,
+                          size_t distance, size_t matchLength){
+    size_t matchCode = matchLength > 0 ? matchLength - MIN_MATCH : 0;
+    unsigned char token = (unsigned char)(std::min<size_t>(literalCount, 15) << 4);
+    if(matchLength > 0){
+        token |= (unsigned char)std::min<size_t>(matchCode, 15);
+    }
+    out.push_back((char)token);
+    if(literalCount >= 15){
+        WriteLength(out, literalCount);
+    }
+    out.insert(out.end(), literals, literals + literalCount);
+    if(matchLength > 0){
+        out.push_back((char)(distance & 255));
+        out.push_back((char)(distance >> 8));
+        if(matchCode >= 15){
+            WriteLength(out, matchCode);
+        }
+    }
+}
+
+size_t LZ4CompressBlock(const char* source, size_t size, std::vector<char>& out){
+    size_t start = out.size();
+    const unsigned char* in = reinterpret_cast<const unsigned char*>(source);
+    size_t anchor = 0;
+    if(size > MATCH_LIMIT){
+        // The last position with each hash, and before each position the
+        // previous one with its hash
+        std::vector<int32_t> head((size_t)1 << HASH_BITS, -1);
+        std::vector<int32_t> chain(size, -1);
+        const size_t lastStart = size - MATCH_LIMIT;
+        const size_t matchEnd = size - LAST_LITERALS;
+        size_t position = 0;
+        while(position <= lastStart){
+            uint32_t key = Read32(in + position);
+            uint32_t hash = Hash(key);
+            size_t bestLength = 0;
+            size_t bestDistance = 0;
+            int32_t candidate = head[hash];
+            for(int attempt = 0; candidate >= 0 && attempt < SEARCH_DEPTH; ++attempt, candidate = chain[candidate]){
+                size_t distance = position - (size_t)candidate;
+                if(distance > MAX_DISTANCE){
+                    break;
+                }
+                if(Read32(in + candidate) != key){
+                    continue;
+                }
+                size_t length = MIN_MATCH;
+                while(position + length < matchEnd && in[candidate + length] == in[position + length]){
+                    ++length;
+                }
+                if(length > bestLength){
+                    bestLength = length;
+                    bestDistance = distance;
+                }
+            }
+            chain[position] = head[hash];
+            head[hash] = (int32_t)position;
+            if(bestLength < MIN_MATCH){
+                ++position;
+                continue;
+            }
+            WriteSequence(out, in + anchor, position - anchor, bestDistance, bestLength);
+            // The positions inside the match are candidates for later ones
+            size_t end = position + bestLength;
+            for(++position; position < end && position <= lastStart; ++position){
+                uint32_t inner = Hash(Read32(in + position));
+                chain[position] = head[inner];
+                head[inner] = (int32_t)position;
+            }
+            position = end;
+            anchor = end;
+        }
+    }
+    WriteSequence(out, in + anchor, size - anchor, 0, 0);
+    return out.size() - start;
+}
+
+// Adds the bytes of a length whose nibble is 15, false past the end
+static bool ReadLength(const unsigned char*& in, const unsigned char* end, size_t& length){
+    unsigned char byte;
+    do{
+        if(in == end){
+            return false;
+        }
+        byte = *in++;
+        length += byte;
+    }while(byte == 255);
+    return true;
+}
+
+bool LZ4DecompressBlock(const char* source, size_t sourceBytes, char* destination, size_t size){
+    const unsigned char* in = reinterpret_cast<const unsigned char*>(source);
+    const unsigned char* inEnd = in + sourceBytes;
+    unsigned char* out = reinterpret_cast<unsigned char*>(destination);
+    unsigned char* outStart = out;
+    unsigned char* outEnd = out + size;
+    while(in < inEnd){
+        unsigned int token = *in++;
+        size_t literals = token >> 4;
+        if(literals == 15 && !ReadLength(in, inEnd, literals)){
+            return false;
+        }
+        if((size_t)(inEnd - in) < literals || (size_t)(outEnd - out) < literals){
+            return false;
+        }
+        memcpy(out, in, literals);
+        in += literals;
+        out += literals;
+        // The last sequence ends with its literals
+        if(in == inEnd){
+            break;
+        }
+        if(inEnd - in < 2){
+            return false;
+        }
+        size_t distance = (size_t)in[0] | ((size_t)in[1] << 8);
+        in += 2;
+        if(distance == 0 || distance > (size_t)(out - outStart)){
+            return false;
+        }
+        size_t length = token & 15;
+        if(length == 15 && !ReadLength(in, inEnd, length)){
+            return false;
+        }
+        length += MIN_MATCH;
+        if((size_t)(outEnd - out) < length){
+            return false;
+        }
+        const unsigned char* match = out - distance;
+        if(distance >= length){
+            memcpy(out, match, length);
+            out += length;
+        }else{
+            // Overlapping, a run repeating the last distance bytes
+            for(size_t i = 0; i < length; ++i){
+                *out++ = *match++;
+            }
+        }
+    }
+    return out == outEnd;
+}
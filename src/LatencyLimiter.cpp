@@ -0,0 +1,69 @@
+#include "LatencyLimiter.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+// Added to the slowest recent frame, for the frame that is slower still
+static const double COST_MARGIN_MILLISECONDS = 1.0;
+// Longest wait for a fence before giving up on it, in nanoseconds
+static const GLuint64 FENCE_TIMEOUT = 1000000000;
+
+// Constructor
+LatencyLimiter::LatencyLimiter(){
+
+}
+
+// Destructor
+LatencyLimiter::~LatencyLimiter(){
+    if(m_fence != nullptr){
+        std::cout << "LatencyLimiter.cpp: fence was never released\n";
+    }
+}
+
+double LatencyLimiter::WaitForGPU(){
+    if(m_fence == nullptr){
+        return 0.0;
+    }
+    double waited = 0.0;
+    // Done already is the common case and costs no timing
+    GLenum result = glClientWaitSync(m_fence, 0, 0);
+    if(result == GL_TIMEOUT_EXPIRED){
+        auto start = std::chrono::steady_clock::now();
+        result = glClientWaitSync(m_fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT);
+        waited = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        ++m_waits;
+        m_waitMilliseconds += waited;
+        if(result == GL_TIMEOUT_EXPIRED || result == GL_WAIT_FAILED){
+            std::cout << "LatencyLimiter.cpp: frame fence did not signal, not waiting for it\n";
+        }
+    }
+    glDeleteSync(m_fence);
+    m_fence = nullptr;
+    return waited;
+}
+
+void LatencyLimiter::EndFrame(double costMilliseconds){
+    if(m_fence != nullptr){
+        glDeleteSync(m_fence);
+    }
+    m_fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    m_costs[m_nextCost] = costMilliseconds;
+    m_nextCost = (m_nextCost + 1) % COST_HISTORY;
+    m_costCount = std::min(m_costCount + 1, COST_HISTORY);
+}
+
+double LatencyLimiter::GetPredictedCost() const{
+    double slowest = 0.0;
+    for(int i = 0; i < m_costCount; ++i){
+        slowest = std::max(slowest, m_costs[i]);
+    }
+    return slowest + COST_MARGIN_MILLISECONDS;
+}
+
+void LatencyLimiter::Release(){
+    if(m_fence != nullptr){
+        glDeleteSync(m_fence);
+        m_fence = nullptr;
+    }
+}
@@ -0,0 +1,171 @@
+#include "LiveInspector.hpp"
+
+#include <cstring>
+#include <iostream>
+
+#if defined(__linux__)
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Copies Read() tries before giving up on a game publishing all the time
+static const int READ_ATTEMPTS = 1000;
+
+// Rounds up to the next multiple of 64 (one cache line)
+static size_t AlignToCacheLine(size_t bytes){
+    return (bytes + 63) & ~(size_t)63;
+}
+
+// Constructor
+LiveInspector::LiveInspector(){
+
+}
+
+// Destructor
+LiveInspector::~LiveInspector(){
+    Release();
+}
+
+#if defined(__linux__)
+
+bool LiveInspector::Create(const std::string& name){
+    Release();
+    size_t stateOffset = AlignToCacheLine(sizeof(InspectorHeader));
+    size_t totalSize = stateOffset + AlignToCacheLine(sizeof(InspectorState));
+    int fd = shm_open(name.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0644);
+    if(fd < 0){
+        std::cout << "LiveInspector.cpp: shm_open " << name << " failed: " << strerror(errno) << "\n";
+        return false;
+    }
+    if(ftruncate(fd, (off_t)totalSize) != 0){
+        std::cout << "LiveInspector.cpp: could not size " << name << ": " << strerror(errno) << "\n";
+        close(fd);
+        shm_unlink(name.c_str());
+        return false;
+    }
+    void* memory = mmap(nullptr, totalSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if(memory == MAP_FAILED){
+        std::cout << "LiveInspector.cpp: could not map " << name << ": " << strerror(errno) << "\n";
+        shm_unlink(name.c_str());
+        return false;
+    }
+    m_header = (InspectorHeader*)memory;
+    m_shared = (InspectorState*)((uint8_t*)memory + stateOffset);
+    m_size = totalSize;
+    m_name = name;
+    m_owner = true;
+    m_state = InspectorState();
+
+    // The pages start zeroed, an even sequence over an empty state; the
+    // magic goes last so a reader never sees a half-written header
+    m_header->version = INSPECTOR_VERSION;
+    m_header->stateSize = (uint32_t)sizeof(InspectorState);
+    m_header->stateOffset = (uint32_t)stateOffset;
+    __atomic_store_n(&m_header->magic, INSPECTOR_MAGIC, __ATOMIC_RELEASE);
+    return true;
+}
+
+bool LiveInspector::Open(const std::string& name){
+    Release();
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if(fd < 0){
+        std::cout << "LiveInspector.cpp: shm_open " << name << " failed: " << strerror(errno) << "\n";
+        return false;
+    }
+    struct stat info;
+    if(fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(InspectorHeader)){
+        std::cout << "LiveInspector.cpp: " << name << " is not initialized\n";
+        close(fd);
+        return false;
+    }
+    void* memory = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if(memory == MAP_FAILED){
+        std::cout << "LiveInspector.cpp: could not map " << name << ": " << strerror(errno) << "\n";
+        return false;
+    }
+    InspectorHeader* header = (InspectorHeader*)memory;
+    if(__atomic_load_n(&header->magic, __ATOMIC_ACQUIRE) != INSPECTOR_MAGIC ||
+       header->version != INSPECTOR_VERSION || header->stateSize != sizeof(InspectorState) ||
+       (size_t)header->stateOffset + header->stateSize > (size_t)info.st_size){
+        std::cout << "LiveInspector.cpp: " << name << " has an unknown layout\n";
+        munmap(memory, (size_t)info.st_size);
+        return false;
+    }
+    m_header = header;
+    m_shared = (InspectorState*)((uint8_t*)memory + header->stateOffset);
+    m_size = (size_t)info.st_size;
+    m_name = name;
+    m_owner = false;
+    return true;
+}
+
+void LiveInspector::Release(){
+    if(m_header != nullptr){
+        munmap(m_header, m_size);
+        if(m_owner){
+            shm_unlink(m_name.c_str());
+        }
+    }
+    m_header = nullptr;
+    m_shared = nullptr;
+    m_size = 0;
+    m_owner = false;
+}
+
+#else
+
+bool LiveInspector::Create(const std::string& name){
+    std::cout << "LiveInspector.cpp: the live inspector needs Linux\n";
+    return false;
+}
+
+bool LiveInspector::Open(const std::string& name){
+    std::cout << "LiveInspector.cpp: the live inspector needs Linux\n";
+    return false;
+}
+
+void LiveInspector::Release(){
+
+}
+
+#endif
+
+void LiveInspector::Publish(){
+    if(m_header == nullptr || !m_owner){
+        return;
+    }
+    // Odd first, and the copy may not move above that store
+    uint64_t sequence = __atomic_load_n(&m_header->sequence, __ATOMIC_RELAXED);
+    __atomic_store_n(&m_header->sequence, sequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy(m_shared, &m_state, sizeof(InspectorState));
+    __atomic_store_n(&m_header->sequence, sequence + 2, __ATOMIC_RELEASE);
+}
+
+bool LiveInspector::Read(InspectorState& state) const{
+    if(m_header == nullptr){
+        return false;
+    }
+    for(int attempt = 0; attempt < READ_ATTEMPTS; ++attempt){
+        uint64_t before = __atomic_load_n(&m_header->sequence, __ATOMIC_ACQUIRE);
+        if(before & 1){
+            continue;
+        }
+        memcpy(&state, m_shared, sizeof(InspectorState));
+        // The copy may not move below the second read
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if(__atomic_load_n(&m_header->sequence, __ATOMIC_RELAXED) == before){
+            return true;
+        }
+    }
+    return false;
+}
+
+uint64_t LiveInspector::GetSequence() const{
+    return (m_header != nullptr) ? __atomic_load_n(&m_header->sequence, __ATOMIC_ACQUIRE) / 2 : 0;
+}
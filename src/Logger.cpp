@@ -0,0 +1,105 @@
+#include "Logger.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+
+static_assert((LOG_QUEUE_SLOTS & (LOG_QUEUE_SLOTS - 1)) == 0, "LOG_QUEUE_SLOTS must be a power of two");
+
+Logger& Logger::Get(){
+    static Logger logger;
+    return logger;
+}
+
+// Constructor
+Logger::Logger(){
+    for(size_t i = 0; i < LOG_QUEUE_SLOTS; ++i){
+        m_slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    m_thread = std::thread(&Logger::WriterThread, this);
+}
+
+// Destructor
+Logger::~Logger(){
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    if(m_thread.joinable()){
+        m_thread.join();
+    }
+    Drain();
+}
+
+void Logger::Write(const char* format, ...){
+    // Claim the next slot whose sequence says it is free; a slot still
+    // a lap behind means the queue is full
+    uint64_t position = m_enqueue.load(std::memory_order_relaxed);
+    Slot* slot = nullptr;
+    for(;;){
+        slot = &m_slots[position & (LOG_QUEUE_SLOTS - 1)];
+        uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+        int64_t lag = (int64_t)(sequence - position);
+        if(lag == 0){
+            if(m_enqueue.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)){
+                break;
+            }
+        }else if(lag < 0){
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }else{
+            position = m_enqueue.load(std::memory_order_relaxed);
+        }
+    }
+
+    va_list arguments;
+    va_start(arguments, format);
+    int length = vsnprintf(slot->text, LOG_MESSAGE_BYTES - 1, format, arguments);
+    va_end(arguments);
+    length = std::min(std::max(length, 0), (int)LOG_MESSAGE_BYTES - 2);
+    slot->text[length++] = '\n';
+    slot->length = (uint32_t)length;
+    // Hands the slot to the writer
+    slot->sequence.store(position + 1, std::memory_order_release);
+}
+
+bool Logger::Drain(){
+    bool wrote = false;
+    uint64_t position = m_dequeue.load(std::memory_order_relaxed);
+    for(;;){
+        Slot& slot = m_slots[position & (LOG_QUEUE_SLOTS - 1)];
+        if(slot.sequence.load(std::memory_order_acquire) != position + 1){
+            break;
+        }
+        std::fwrite(slot.text, 1, slot.length, stdout);
+        // Free again one lap later
+        slot.sequence.store(position + LOG_QUEUE_SLOTS, std::memory_order_release);
+        ++position;
+        wrote = true;
+    }
+    m_dequeue.store(position, std::memory_order_release);
+    if(wrote){
+        std::fflush(stdout);
+    }
+    return wrote;
+}
+
+void Logger::Flush(){
+    uint64_t target = m_enqueue.load(std::memory_order_acquire);
+    while(m_dequeue.load(std::memory_order_acquire) < target){
+        m_wake.notify_all();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+void Logger::WriterThread(){
+    std::unique_lock<std::mutex> lock(m_wakeMutex);
+    while(!m_stop){
+        lock.unlock();
+        Drain();
+        lock.lock();
+        m_wake.wait_for(lock, std::chrono::milliseconds(LOG_WRITE_MILLISECONDS));
+    }
+}
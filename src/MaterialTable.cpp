@@ -0,0 +1,52 @@
+#include "MaterialTable.hpp"
+
+#include <cstdio>
+
+// Every field of a material in one string, equal only for equal materials
+static std::string GetKey(const Material& material){
+    char numbers[128];
+    snprintf(numbers, sizeof(numbers), "%.9g %.9g %.9g %.9g", material.diffuse[0], material.diffuse[1],
+             material.diffuse[2], material.opacity);
+    return material.name + '\n' + material.diffuseMap + '\n' + numbers;
+}
+
+MaterialTable& MaterialTable::Get(){
+    static MaterialTable table;
+    return table;
+}
+
+// Constructor
+MaterialTable::MaterialTable(){
+
+}
+
+// Destructor
+MaterialTable::~MaterialTable(){
+
+}
+
+MaterialId MaterialTable::Add(const Material& material){
+    std::string key = GetKey(material);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_lookup.find(key);
+    if(it != m_lookup.end()){
+        return it->second;
+    }
+    MaterialId id = (MaterialId)m_materials.size();
+    m_materials.push_back(material);
+    m_lookup.emplace(key, id);
+    return id;
+}
+
+Material MaterialTable::GetMaterial(MaterialId id) const{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if(id >= m_materials.size()){
+        return Material();
+    }
+    return m_materials[id];
+}
+
+size_t MaterialTable::GetCount() const{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_materials.size();
+}
@@ -0,0 +1,44 @@
+#include "MemoryTags.hpp"
+
+#include <atomic>
+#include <iostream>
+
+// Constant-initialized, so memory reported before main() counts too
+static std::atomic<size_t> sCurrent[MEMORY_TAGS];
+static std::atomic<size_t> sPeak[MEMORY_TAGS];
+
+static const char* const TAG_NAMES[MEMORY_TAGS] = {
+    "assets", "meshes", "images", "sim", "render", "telemetry"
+};
+
+void MemoryTags::Add(MemoryTag tag, size_t bytes){
+    size_t current = sCurrent[tag].fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    size_t peak = sPeak[tag].load(std::memory_order_relaxed);
+    while(current > peak && !sPeak[tag].compare_exchange_weak(peak, current, std::memory_order_relaxed)){
+    }
+}
+
+void MemoryTags::Remove(MemoryTag tag, size_t bytes){
+    sCurrent[tag].fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+size_t MemoryTags::GetCurrent(MemoryTag tag){
+    return sCurrent[tag].load(std::memory_order_relaxed);
+}
+
+size_t MemoryTags::GetPeak(MemoryTag tag){
+    return sPeak[tag].load(std::memory_order_relaxed);
+}
+
+const char* MemoryTags::GetName(MemoryTag tag){
+    return (tag >= 0 && tag < MEMORY_TAGS) ? TAG_NAMES[tag] : "unknown";
+}
+
+void MemoryTags::Report(){
+    std::cout << "CPU memory by tag (KiB now / peak):";
+    for(int i = 0; i < MEMORY_TAGS; ++i){
+        MemoryTag tag = (MemoryTag)i;
+        std::cout << " " << GetName(tag) << " " << GetCurrent(tag) / 1024 << "/" << GetPeak(tag) / 1024;
+    }
+    std::cout << std::endl;
+}
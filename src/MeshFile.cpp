@@ -0,0 +1,244 @@
+#include "MeshFile.hpp"
+#include "MeshOptimizer.hpp"
+#include "ObjLoader.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+// Constructor
+MeshFile::MeshFile(){
+    memset(&m_header, 0, sizeof(m_header));
+}
+
+bool MeshFile::Load(const std::string& filepath){
+    m_vertexData = nullptr;
+    m_indexData = nullptr;
+    m_lods = nullptr;
+    m_material.clear();
+    memset(&m_header, 0, sizeof(m_header));
+
+    if(!m_file.Open(filepath) || m_file.Size() < sizeof(DMeshHeader)){
+        return false;
+    }
+
+    DMeshHeader header;
+    memcpy(&header, m_file.Data(), sizeof(header));
+    if(memcmp(header.magic, "DMSH", 4) != 0 || header.version != DMESH_VERSION ||
+       header.floatsPerVertex != DMESH_FLOATS_PER_VERTEX || header.lodCount < 1 || header.lodCount > MAX_MESH_LODS){
+        std::cout << "MeshFile.cpp: " << filepath << " is not a supported .dmesh\n";
+        m_file.Close();
+        return false;
+    }
+
+    size_t materialBytes = (header.materialLength + 3u) & ~3u;
+    size_t lodBytes = (size_t)header.lodCount * sizeof(MeshLod);
+    size_t vertexBytes = (size_t)header.vertexCount * header.floatsPerVertex * sizeof(float);
+    size_t indexBytes = (size_t)header.indexCount * sizeof(uint32_t);
+    if(m_file.Size() < sizeof(DMeshHeader) + materialBytes + lodBytes + vertexBytes + indexBytes){
+        std::cout << "MeshFile.cpp: " << filepath << " is truncated\n";
+        m_file.Close();
+        return false;
+    }
+
+    m_header = header;
+    const char* material = m_file.Data() + sizeof(DMeshHeader);
+    m_material.assign(material, header.materialLength);
+    m_lods = reinterpret_cast<const MeshLod*>(material + materialBytes);
+    m_vertexData = reinterpret_cast<const float*>(material + materialBytes + lodBytes);
+    m_indexData = reinterpret_cast<const uint32_t*>(material + materialBytes + lodBytes + vertexBytes);
+    for(uint32_t i = 0; i < header.lodCount; ++i){
+        if((uint64_t)m_lods[i].firstIndex + m_lods[i].indexCount > header.indexCount){
+            std::cout << "MeshFile.cpp: " << filepath << " has a LOD outside its indices\n";
+            m_file.Close();
+            memset(&m_header, 0, sizeof(m_header));
+            m_lods = nullptr;
+            m_vertexData = nullptr;
+            m_indexData = nullptr;
+            return false;
+        }
+    }
+    return true;
+}
+
+std::vector<float> MeshFile::Interleave(const ObjLoader& loader){
+    Span<Triangle> mesh = loader.getTriangles();
+
+    std::vector<float> stream;
+    stream.reserve(mesh.size() * 3 * DMESH_FLOATS_PER_VERTEX);
+    for(const Triangle& triangle : mesh){
+        for(int i = 0; i < 3; i++){
+            const Vertex& vertex = triangle.vertices[i];
+            const Normal& normal = triangle.normals[i];
+            const TextureCoords& texture = triangle.textures[i];
+            stream.push_back(vertex.x);
+            stream.push_back(vertex.y);
+            stream.push_back(vertex.z);
+            stream.push_back(normal.nx);
+            stream.push_back(normal.ny);
+            stream.push_back(normal.nz);
+            stream.push_back(texture.u);
+            stream.push_back(texture.v);
+        }
+    }
+    return stream;
+}
+
+std::vector<char> MeshFile::EncodeFromObj(const ObjLoader& loader, DMeshStatistics* statistics){
+    std::vector<float> stream;
+    std::vector<uint32_t> indices;
+    loader.getIndexedMesh(stream, indices);
+    std::vector<MeshLod> lods;
+    BuildMeshLods(stream, DMESH_FLOATS_PER_VERTEX, indices, lods);
+    // Every level is ordered on its own, then the vertices follow the
+    // full mesh's order since that is the level drawn up close
+    size_t vertexCount = stream.size() / DMESH_FLOATS_PER_VERTEX;
+    if(statistics){
+        statistics->acmrBefore = GetACMR(indices.data(), lods[0].indexCount, vertexCount);
+    }
+    for(const MeshLod& lod : lods){
+        uint32_t* range = indices.data() + lod.firstIndex;
+        OptimizeVertexCache(range, lod.indexCount, vertexCount);
+        OptimizeOverdraw(range, lod.indexCount, stream.data(), vertexCount, DMESH_FLOATS_PER_VERTEX);
+    }
+    OptimizeVertexFetch(stream, DMESH_FLOATS_PER_VERTEX, indices);
+    if(statistics){
+        statistics->acmrAfter = GetACMR(indices.data(), lods[0].indexCount, vertexCount);
+    }
+    std::string material = loader.getTextureName();
+
+    DMeshHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "DMSH", 4);
+    header.version = DMESH_VERSION;
+    header.floatsPerVertex = DMESH_FLOATS_PER_VERTEX;
+    header.vertexCount = (uint32_t)(stream.size() / DMESH_FLOATS_PER_VERTEX);
+    header.materialLength = (uint32_t)material.size();
+    header.indexCount = (uint32_t)indices.size();
+    header.lodCount = (uint32_t)lods.size();
+    const AABB& bounds = loader.getBounds();
+    for(int axis = 0; axis < 3; ++axis){
+        header.boundsMin[axis] = bounds.min[axis];
+        header.boundsMax[axis] = bounds.max[axis];
+    }
+
+    size_t materialBytes = (material.size() + 3u) & ~size_t(3);
+    std::vector<char> bytes(sizeof(header) + materialBytes + lods.size() * sizeof(MeshLod)
+                            + stream.size() * sizeof(float) + indices.size() * sizeof(uint32_t), 0);
+    char* out = bytes.data();
+    memcpy(out, &header, sizeof(header));
+    out += sizeof(header);
+    memcpy(out, material.data(), material.size());
+    out += materialBytes;
+    memcpy(out, lods.data(), lods.size() * sizeof(MeshLod));
+    out += lods.size() * sizeof(MeshLod);
+    memcpy(out, stream.data(), stream.size() * sizeof(float));
+    out += stream.size() * sizeof(float);
+    memcpy(out, indices.data(), indices.size() * sizeof(uint32_t));
+    return bytes;
+}
+
+bool MeshFile::WriteFromObj(const ObjLoader& loader, const std::string& filepath, DMeshStatistics* statistics){
+    std::vector<char> bytes = EncodeFromObj(loader, statistics);
+    std::ofstream out(filepath.c_str(), std::ios::binary | std::ios::trunc);
+    if(!out.is_open()){
+        return false;
+    }
+    out.write(bytes.data(), bytes.size());
+    return out.good();
+}
+
+// Appends the file at path to out a block at a time
+static bool AppendFile(std::FILE* out, const std::string& path){
+    std::FILE* in = std::fopen(path.c_str(), "rb");
+    if(in == nullptr){
+        return false;
+    }
+    std::vector<char> block(1 << 20);
+    bool written = true;
+    size_t read;
+    while(written && (read = std::fread(block.data(), 1, block.size(), in)) > 0){
+        written = std::fwrite(block.data(), 1, read, out) == read;
+    }
+    written = written && !std::ferror(in);
+    std::fclose(in);
+    return written;
+}
+
+bool MeshFile::WriteFromObjStream(const std::string& objPath, const std::string& filepath,
+                                  size_t cacheEntries, ObjStreamResult* result){
+    // The vertices and indices go to files of their own as they come, the
+    // header in front of them needs their counts
+    const std::string vertexPath = filepath + ".vertices.tmp";
+    const std::string indexPath = filepath + ".indices.tmp";
+    std::FILE* vertexFile = std::fopen(vertexPath.c_str(), "wb");
+    std::FILE* indexFile = std::fopen(indexPath.c_str(), "wb");
+    ObjStreamResult streamed;
+    bool imported = false;
+    if(vertexFile != nullptr && indexFile != nullptr){
+        ObjStreamSink sink;
+        sink.addVertex = [vertexFile](const float* vertex){
+            return std::fwrite(vertex, sizeof(float), DMESH_FLOATS_PER_VERTEX, vertexFile) == DMESH_FLOATS_PER_VERTEX;
+        };
+        sink.addTriangle = [indexFile](const uint32_t* indices){
+            return std::fwrite(indices, sizeof(uint32_t), 3, indexFile) == 3;
+        };
+        imported = StreamObj(objPath, sink, streamed, cacheEntries);
+    }
+    if(vertexFile != nullptr){
+        imported = (std::fclose(vertexFile) == 0) && imported;
+    }
+    if(indexFile != nullptr){
+        imported = (std::fclose(indexFile) == 0) && imported;
+    }
+    if(result){
+        *result = streamed;
+    }
+    if(imported && (streamed.vertexCount > UINT32_MAX || streamed.triangleCount * 3 > UINT32_MAX)){
+        std::cout << "MeshFile.cpp: " << objPath << " has too many vertices for a .dmesh\n";
+        imported = false;
+    }
+
+    bool written = false;
+    if(imported){
+        const std::string& material = streamed.textureName;
+        DMeshHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, "DMSH", 4);
+        header.version = DMESH_VERSION;
+        header.floatsPerVertex = DMESH_FLOATS_PER_VERTEX;
+        header.vertexCount = (uint32_t)streamed.vertexCount;
+        header.materialLength = (uint32_t)material.size();
+        header.indexCount = (uint32_t)(streamed.triangleCount * 3);
+        header.lodCount = 1;
+        for(int axis = 0; axis < 3; ++axis){
+            header.boundsMin[axis] = streamed.bounds.min[axis];
+            header.boundsMax[axis] = streamed.bounds.max[axis];
+        }
+        MeshLod full = {0, header.indexCount, 0.0f};
+        std::vector<char> material4((material.size() + 3u) & ~size_t(3), 0);
+        memcpy(material4.data(), material.data(), material.size());
+
+        std::FILE* out = std::fopen(filepath.c_str(), "wb");
+        if(out != nullptr){
+            written = std::fwrite(&header, sizeof(header), 1, out) == 1 &&
+                      (material4.empty() || std::fwrite(material4.data(), 1, material4.size(), out) == material4.size()) &&
+                      std::fwrite(&full, sizeof(full), 1, out) == 1 &&
+                      AppendFile(out, vertexPath) && AppendFile(out, indexPath);
+            written = (std::fclose(out) == 0) && written;
+        }
+    }
+    std::remove(vertexPath.c_str());
+    std::remove(indexPath.c_str());
+    return written;
+}
+
+std::string MeshFile::DMeshPathFor(const std::string& objPath){
+    size_t dot = objPath.find_last_of('.');
+    size_t slash = objPath.find_last_of('/');
+    if(dot == std::string::npos || (slash != std::string::npos && dot < slash)){
+        return objPath + ".dmesh";
+    }
+    return objPath.substr(0, dot) + ".dmesh";
+}
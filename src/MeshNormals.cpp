@@ -0,0 +1,178 @@
+#include "MeshNormals.hpp"
+
+#include <cmath>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+// Squared length below which a vector has no usable direction
+static const float MIN_LENGTH_SQUARED = 1e-20f;
+// Floats per vertex of an interleaved stream, and where its parts start
+static const size_t STREAM_FLOATS = 8;
+static const size_t STREAM_NORMAL = 3;
+static const size_t STREAM_UV = 6;
+
+void CrossEdges(const float* ax, const float* ay, const float* az,
+                const float* bx, const float* by, const float* bz, size_t count,
+                float* nx, float* ny, float* nz){
+    size_t i = 0;
+#if defined(__SSE2__)
+    for(; i + 4 <= count; i += 4){
+        __m128 x0 = _mm_loadu_ps(ax + i);
+        __m128 y0 = _mm_loadu_ps(ay + i);
+        __m128 z0 = _mm_loadu_ps(az + i);
+        __m128 x1 = _mm_loadu_ps(bx + i);
+        __m128 y1 = _mm_loadu_ps(by + i);
+        __m128 z1 = _mm_loadu_ps(bz + i);
+        _mm_storeu_ps(nx + i, _mm_sub_ps(_mm_mul_ps(y0, z1), _mm_mul_ps(z0, y1)));
+        _mm_storeu_ps(ny + i, _mm_sub_ps(_mm_mul_ps(z0, x1), _mm_mul_ps(x0, z1)));
+        _mm_storeu_ps(nz + i, _mm_sub_ps(_mm_mul_ps(x0, y1), _mm_mul_ps(y0, x1)));
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    for(; i + 4 <= count; i += 4){
+        float32x4_t x0 = vld1q_f32(ax + i);
+        float32x4_t y0 = vld1q_f32(ay + i);
+        float32x4_t z0 = vld1q_f32(az + i);
+        float32x4_t x1 = vld1q_f32(bx + i);
+        float32x4_t y1 = vld1q_f32(by + i);
+        float32x4_t z1 = vld1q_f32(bz + i);
+        vst1q_f32(nx + i, vfmsq_f32(vmulq_f32(y0, z1), z0, y1));
+        vst1q_f32(ny + i, vfmsq_f32(vmulq_f32(z0, x1), x0, z1));
+        vst1q_f32(nz + i, vfmsq_f32(vmulq_f32(x0, y1), y0, x1));
+    }
+#endif
+    for(; i < count; ++i){
+        nx[i] = ay[i]*bz[i] - az[i]*by[i];
+        ny[i] = az[i]*bx[i] - ax[i]*bz[i];
+        nz[i] = ax[i]*by[i] - ay[i]*bx[i];
+    }
+}
+
+void NormalizeVectors(float* x, float* y, float* z, size_t count){
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128 minimum = _mm_set1_ps(MIN_LENGTH_SQUARED);
+    const __m128 one = _mm_set1_ps(1.0f);
+    for(; i + 4 <= count; i += 4){
+        __m128 vx = _mm_loadu_ps(x + i);
+        __m128 vy = _mm_loadu_ps(y + i);
+        __m128 vz = _mm_loadu_ps(z + i);
+        __m128 squared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)), _mm_mul_ps(vz, vz));
+        // Short lanes are masked to 0 and then get +y; NaN fails the test too
+        __m128 usable = _mm_cmpgt_ps(squared, minimum);
+        __m128 scale = _mm_and_ps(usable, _mm_div_ps(one, _mm_sqrt_ps(_mm_max_ps(squared, minimum))));
+        _mm_storeu_ps(x + i, _mm_and_ps(usable, _mm_mul_ps(vx, scale)));
+        _mm_storeu_ps(y + i, _mm_or_ps(_mm_and_ps(usable, _mm_mul_ps(vy, scale)), _mm_andnot_ps(usable, one)));
+        _mm_storeu_ps(z + i, _mm_and_ps(usable, _mm_mul_ps(vz, scale)));
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    const float32x4_t minimum = vdupq_n_f32(MIN_LENGTH_SQUARED);
+    const float32x4_t zero = vdupq_n_f32(0.0f);
+    const float32x4_t one = vdupq_n_f32(1.0f);
+    for(; i + 4 <= count; i += 4){
+        float32x4_t vx = vld1q_f32(x + i);
+        float32x4_t vy = vld1q_f32(y + i);
+        float32x4_t vz = vld1q_f32(z + i);
+        float32x4_t squared = vfmaq_f32(vfmaq_f32(vmulq_f32(vx, vx), vy, vy), vz, vz);
+        uint32x4_t usable = vcgtq_f32(squared, minimum);
+        float32x4_t scale = vdivq_f32(one, vsqrtq_f32(vmaxq_f32(squared, minimum)));
+        vst1q_f32(x + i, vbslq_f32(usable, vmulq_f32(vx, scale), zero));
+        vst1q_f32(y + i, vbslq_f32(usable, vmulq_f32(vy, scale), one));
+        vst1q_f32(z + i, vbslq_f32(usable, vmulq_f32(vz, scale), zero));
+    }
+#endif
+    for(; i < count; ++i){
+        float squared = x[i]*x[i] + y[i]*y[i] + z[i]*z[i];
+        if(squared > MIN_LENGTH_SQUARED){
+            float scale = 1.0f / std::sqrt(squared);
+            x[i] *= scale;
+            y[i] *= scale;
+            z[i] *= scale;
+        }else{
+            x[i] = 0.0f;
+            y[i] = 1.0f;
+            z[i] = 0.0f;
+        }
+    }
+}
+
+bool IsUsableNormal(float x, float y, float z){
+    float squared = x*x + y*y + z*z;
+    return std::isfinite(squared) && squared > MIN_LENGTH_SQUARED;
+}
+
+void GenerateTangents(const std::vector<float>& stream, const std::vector<uint32_t>& indices,
+                      std::vector<float>& tangents){
+    size_t vertexCount = stream.size() / STREAM_FLOATS;
+    size_t triangleCount = indices.size() / 3;
+    // Sums per vertex of the triangles' tangents and bitangents
+    std::vector<float> tx(vertexCount, 0.0f), ty(vertexCount, 0.0f), tz(vertexCount, 0.0f);
+    std::vector<float> bx(vertexCount, 0.0f), by(vertexCount, 0.0f), bz(vertexCount, 0.0f);
+    for(size_t t = 0; t < triangleCount; ++t){
+        const uint32_t* corner = &indices[t*3];
+        if(corner[0] >= vertexCount || corner[1] >= vertexCount || corner[2] >= vertexCount){
+            continue;
+        }
+        const float* p0 = &stream[corner[0]*STREAM_FLOATS];
+        const float* p1 = &stream[corner[1]*STREAM_FLOATS];
+        const float* p2 = &stream[corner[2]*STREAM_FLOATS];
+        float e1[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+        float e2[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+        float du1 = p1[STREAM_UV] - p0[STREAM_UV];
+        float dv1 = p1[STREAM_UV + 1] - p0[STREAM_UV + 1];
+        float du2 = p2[STREAM_UV] - p0[STREAM_UV];
+        float dv2 = p2[STREAM_UV + 1] - p0[STREAM_UV + 1];
+        // Only the sign of the texture area: the sums stay weighted by
+        // the triangle's area rather than by its texel density
+        float sign = (du1*dv2 - du2*dv1 < 0.0f) ? -1.0f : 1.0f;
+        float tangent[3];
+        float bitangent[3];
+        for(int k = 0; k < 3; ++k){
+            tangent[k] = (e1[k]*dv2 - e2[k]*dv1) * sign;
+            bitangent[k] = (e2[k]*du1 - e1[k]*du2) * sign;
+        }
+        for(int c = 0; c < 3; ++c){
+            uint32_t v = corner[c];
+            tx[v] += tangent[0];
+            ty[v] += tangent[1];
+            tz[v] += tangent[2];
+            bx[v] += bitangent[0];
+            by[v] += bitangent[1];
+            bz[v] += bitangent[2];
+        }
+    }
+    // Gram-Schmidt against the vertex normal; a vertex whose sum lies
+    // along the normal (no usable texture direction) takes any
+    // perpendicular
+    for(size_t v = 0; v < vertexCount; ++v){
+        const float* normal = &stream[v*STREAM_FLOATS + STREAM_NORMAL];
+        float along = normal[0]*tx[v] + normal[1]*ty[v] + normal[2]*tz[v];
+        tx[v] -= normal[0]*along;
+        ty[v] -= normal[1]*along;
+        tz[v] -= normal[2]*along;
+        if(tx[v]*tx[v] + ty[v]*ty[v] + tz[v]*tz[v] <= MIN_LENGTH_SQUARED){
+            bool nearX = std::fabs(normal[0]) > 0.9f;
+            tx[v] = nearX ? -normal[1] : 0.0f;
+            ty[v] = nearX ? normal[0] : -normal[2];
+            tz[v] = nearX ? 0.0f : normal[1];
+        }
+    }
+    NormalizeVectors(tx.data(), ty.data(), tz.data(), vertexCount);
+
+    tangents.resize(vertexCount * 4);
+    for(size_t v = 0; v < vertexCount; ++v){
+        const float* normal = &stream[v*STREAM_FLOATS + STREAM_NORMAL];
+        // Handedness: whether (normal x tangent) points along the bitangent
+        float cx = normal[1]*tz[v] - normal[2]*ty[v];
+        float cy = normal[2]*tx[v] - normal[0]*tz[v];
+        float cz = normal[0]*ty[v] - normal[1]*tx[v];
+        float handedness = (cx*bx[v] + cy*by[v] + cz*bz[v] < 0.0f) ? -1.0f : 1.0f;
+        tangents[v*4] = tx[v];
+        tangents[v*4 + 1] = ty[v];
+        tangents[v*4 + 2] = tz[v];
+        tangents[v*4 + 3] = handedness;
+    }
+}
@@ -0,0 +1,300 @@
+#include "MeshOptimizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+// The LRU cache and the scores of Forsyth's algorithm. The modelled cache
+// is larger than real ones on purpose: the order it gives works well on
+// any cache up to its size.
+static const size_t FORSYTH_CACHE_SIZE = 32;
+static const float CACHE_DECAY_POWER = 1.5f;
+static const float LAST_TRIANGLE_SCORE = 0.75f;
+static const float VALENCE_BOOST_SCALE = 2.0f;
+static const float VALENCE_BOOST_POWER = 0.5f;
+
+// How much emitting a triangle of the vertex is worth now
+static float GetVertexScore(int cachePosition, uint32_t liveTriangles){
+    if(liveTriangles == 0){
+        return -1.0f;
+    }
+    float score = 0.0f;
+    if(cachePosition >= 0){
+        if(cachePosition < 3){
+            // The triangle just emitted: a fixed score, so the next one
+            // does not just reuse its newest edge
+            score = LAST_TRIANGLE_SCORE;
+        }else{
+            const float scale = 1.0f / (float)(FORSYTH_CACHE_SIZE - 3);
+            score = std::pow(1.0f - (float)(cachePosition - 3) * scale, CACHE_DECAY_POWER);
+        }
+    }
+    // Vertices with few triangles left are finished first
+    score += VALENCE_BOOST_SCALE * std::pow((float)liveTriangles, -VALENCE_BOOST_POWER);
+    return score;
+}
+
+void OptimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount){
+    const size_t triangleCount = indexCount / 3;
+    if(triangleCount < 2){
+        return;
+    }
+    for(size_t i = 0; i < triangleCount * 3; ++i){
+        if(indices[i] >= vertexCount){
+            return;
+        }
+    }
+
+    // Triangles of every vertex; the first liveTriangles[v] are not emitted yet
+    std::vector<uint32_t> liveTriangles(vertexCount, 0);
+    for(size_t i = 0; i < triangleCount * 3; ++i){
+        ++liveTriangles[indices[i]];
+    }
+    std::vector<uint32_t> firstTriangle(vertexCount + 1, 0);
+    for(size_t v = 0; v < vertexCount; ++v){
+        firstTriangle[v + 1] = firstTriangle[v] + liveTriangles[v];
+    }
+    std::vector<uint32_t> adjacency(triangleCount * 3);
+    std::vector<uint32_t> filled(vertexCount, 0);
+    for(size_t t = 0; t < triangleCount; ++t){
+        for(int k = 0; k < 3; ++k){
+            uint32_t v = indices[t*3 + k];
+            adjacency[firstTriangle[v] + filled[v]++] = (uint32_t)t;
+        }
+    }
+
+    std::vector<int> cachePositions(vertexCount, -1);
+    std::vector<float> vertexScores(vertexCount);
+    for(size_t v = 0; v < vertexCount; ++v){
+        vertexScores[v] = GetVertexScore(-1, liveTriangles[v]);
+    }
+    std::vector<float> triangleScores(triangleCount);
+    std::vector<uint8_t> emitted(triangleCount, 0);
+    size_t best = 0;
+    for(size_t t = 0; t < triangleCount; ++t){
+        triangleScores[t] = vertexScores[indices[t*3]] + vertexScores[indices[t*3 + 1]] + vertexScores[indices[t*3 + 2]];
+        if(triangleScores[t] > triangleScores[best]){
+            best = t;
+        }
+    }
+
+    std::vector<uint32_t> output;
+    output.reserve(triangleCount * 3);
+    std::vector<uint32_t> cache;
+    std::vector<uint32_t> nextCache;
+    cache.reserve(FORSYTH_CACHE_SIZE + 3);
+    nextCache.reserve(FORSYTH_CACHE_SIZE + 3);
+    // Where to look for a triangle when the cache has nothing left to offer
+    size_t cursor = 0;
+    bool found = true;
+    while(output.size() < triangleCount * 3){
+        if(!found){
+            while(emitted[cursor]){
+                ++cursor;
+            }
+            best = cursor;
+        }
+        const uint32_t* corners = &indices[best*3];
+        output.insert(output.end(), corners, corners + 3);
+        emitted[best] = 1;
+
+        // The triangle's vertices go to the front of the cache
+        nextCache.assign(corners, corners + 3);
+        for(int k = 0; k < 3; ++k){
+            uint32_t v = corners[k];
+            uint32_t* triangles = &adjacency[firstTriangle[v]];
+            for(uint32_t i = 0; i < liveTriangles[v]; ++i){
+                if(triangles[i] == best){
+                    std::swap(triangles[i], triangles[liveTriangles[v] - 1]);
+                    break;
+                }
+            }
+            --liveTriangles[v];
+        }
+        for(uint32_t v : cache){
+            if(v != corners[0] && v != corners[1] && v != corners[2]){
+                nextCache.push_back(v);
+            }
+        }
+        // Positions past the cache's size fall out, scored as uncached
+        for(size_t i = 0; i < nextCache.size(); ++i){
+            uint32_t v = nextCache[i];
+            cachePositions[v] = (i < FORSYTH_CACHE_SIZE) ? (int)i : -1;
+            vertexScores[v] = GetVertexScore(cachePositions[v], liveTriangles[v]);
+        }
+
+        // The next triangle is the best one touching the cache
+        found = false;
+        float bestScore = -1.0f;
+        for(uint32_t v : nextCache){
+            const uint32_t* triangles = &adjacency[firstTriangle[v]];
+            for(uint32_t i = 0; i < liveTriangles[v]; ++i){
+                uint32_t t = triangles[i];
+                float score = vertexScores[indices[t*3]] + vertexScores[indices[t*3 + 1]] + vertexScores[indices[t*3 + 2]];
+                triangleScores[t] = score;
+                if(score > bestScore){
+                    bestScore = score;
+                    best = t;
+                    found = true;
+                }
+            }
+        }
+        if(nextCache.size() > FORSYTH_CACHE_SIZE){
+            nextCache.resize(FORSYTH_CACHE_SIZE);
+        }
+        cache.swap(nextCache);
+    }
+    std::copy(output.begin(), output.end(), indices);
+}
+
+void OptimizeOverdraw(uint32_t* indices, size_t indexCount, const float* vertices,
+                      size_t vertexCount, size_t floatsPerVertex){
+    const size_t triangleCount = indexCount / 3;
+    if(triangleCount < 2 || floatsPerVertex < 3){
+        return;
+    }
+    for(size_t i = 0; i < triangleCount * 3; ++i){
+        if(indices[i] >= vertexCount){
+            return;
+        }
+    }
+
+    // A run starts wherever a triangle misses the cache with all three
+    // vertices: nothing is reused across that point, so runs can be
+    // moved around without costing any vertex shading
+    std::vector<size_t> runStarts;
+    std::vector<size_t> stamps(vertexCount, 0);
+    size_t time = ACMR_CACHE_SIZE + 1;
+    for(size_t t = 0; t < triangleCount; ++t){
+        int misses = 0;
+        for(int k = 0; k < 3; ++k){
+            uint32_t v = indices[t*3 + k];
+            if(time - stamps[v] > ACMR_CACHE_SIZE){
+                stamps[v] = time++;
+                ++misses;
+            }
+        }
+        if(t == 0 || misses == 3){
+            runStarts.push_back(t);
+        }
+    }
+    if(runStarts.size() < 2){
+        return;
+    }
+    runStarts.push_back(triangleCount);
+
+    // Area weighted centroid and normal of every run and of the mesh
+    struct Run{
+        size_t first;
+        size_t end;
+        double centroid[3];
+        double normal[3];
+        double area;
+        double facing;
+    };
+    std::vector<Run> runs(runStarts.size() - 1);
+    double meshCentroid[3] = {0.0, 0.0, 0.0};
+    double meshArea = 0.0;
+    for(size_t r = 0; r < runs.size(); ++r){
+        Run& run = runs[r];
+        run = Run{runStarts[r], runStarts[r + 1], {0.0, 0.0, 0.0}, {0.0, 0.0, 0.0}, 0.0, 0.0};
+        for(size_t t = run.first; t < run.end; ++t){
+            const float* p0 = vertices + (size_t)indices[t*3] * floatsPerVertex;
+            const float* p1 = vertices + (size_t)indices[t*3 + 1] * floatsPerVertex;
+            const float* p2 = vertices + (size_t)indices[t*3 + 2] * floatsPerVertex;
+            double e1[3] = {(double)p1[0] - p0[0], (double)p1[1] - p0[1], (double)p1[2] - p0[2]};
+            double e2[3] = {(double)p2[0] - p0[0], (double)p2[1] - p0[1], (double)p2[2] - p0[2]};
+            double normal[3] = {e1[1]*e2[2] - e1[2]*e2[1], e1[2]*e2[0] - e1[0]*e2[2], e1[0]*e2[1] - e1[1]*e2[0]};
+            double area = std::sqrt(normal[0]*normal[0] + normal[1]*normal[1] + normal[2]*normal[2]);
+            for(int axis = 0; axis < 3; ++axis){
+                run.centroid[axis] += area * ((double)p0[axis] + p1[axis] + p2[axis]) / 3.0;
+                run.normal[axis] += normal[axis];
+            }
+            run.area += area;
+        }
+        for(int axis = 0; axis < 3; ++axis){
+            meshCentroid[axis] += run.centroid[axis];
+        }
+        meshArea += run.area;
+    }
+    if(meshArea <= 0.0){
+        return;
+    }
+    for(int axis = 0; axis < 3; ++axis){
+        meshCentroid[axis] /= meshArea;
+    }
+    // How far a run faces away from the middle of the mesh; the outer
+    // ones are the ones most likely in front from any side
+    for(Run& run : runs){
+        double length = std::sqrt(run.normal[0]*run.normal[0] + run.normal[1]*run.normal[1] + run.normal[2]*run.normal[2]);
+        if(run.area <= 0.0 || length <= 0.0){
+            continue;
+        }
+        for(int axis = 0; axis < 3; ++axis){
+            run.facing += (run.centroid[axis] / run.area - meshCentroid[axis]) * run.normal[axis] / length;
+        }
+    }
+    std::stable_sort(runs.begin(), runs.end(), [](const Run& a, const Run& b){
+        return a.facing > b.facing;
+    });
+
+    std::vector<uint32_t> output;
+    output.reserve(triangleCount * 3);
+    for(const Run& run : runs){
+        output.insert(output.end(), indices + run.first*3, indices + run.end*3);
+    }
+    std::copy(output.begin(), output.end(), indices);
+}
+
+void OptimizeVertexFetch(std::vector<float>& vertices, size_t floatsPerVertex, std::vector<uint32_t>& indices){
+    if(floatsPerVertex == 0){
+        return;
+    }
+    const size_t vertexCount = vertices.size() / floatsPerVertex;
+    const uint32_t unused = 0xFFFFFFFFu;
+    std::vector<uint32_t> remap(vertexCount, unused);
+    uint32_t next = 0;
+    for(uint32_t index : indices){
+        if(index < vertexCount && remap[index] == unused){
+            remap[index] = next++;
+        }
+    }
+    for(size_t v = 0; v < vertexCount; ++v){
+        if(remap[v] == unused){
+            remap[v] = next++;
+        }
+    }
+    std::vector<float> reordered(vertexCount * floatsPerVertex);
+    for(size_t v = 0; v < vertexCount; ++v){
+        std::copy(vertices.begin() + v*floatsPerVertex, vertices.begin() + (v + 1)*floatsPerVertex,
+                  reordered.begin() + (size_t)remap[v]*floatsPerVertex);
+    }
+    vertices.swap(reordered);
+    for(uint32_t& index : indices){
+        if(index < vertexCount){
+            index = remap[index];
+        }
+    }
+}
+
+float GetACMR(const uint32_t* indices, size_t indexCount, size_t vertexCount){
+    const size_t triangleCount = indexCount / 3;
+    if(triangleCount == 0){
+        return 0.0f;
+    }
+    // A vertex is still cached while fewer than ACMR_CACHE_SIZE misses
+    // came after its own
+    std::vector<size_t> stamps(vertexCount, 0);
+    size_t time = ACMR_CACHE_SIZE + 1;
+    size_t misses = 0;
+    for(size_t i = 0; i < triangleCount * 3; ++i){
+        uint32_t v = indices[i];
+        if(v >= vertexCount){
+            continue;
+        }
+        if(time - stamps[v] > ACMR_CACHE_SIZE){
+            stamps[v] = time++;
+            ++misses;
+        }
+    }
+    return (float)misses / (float)triangleCount;
+}
@@ -0,0 +1,337 @@
+#include "MeshRegistry.hpp"
+#include "GLBackend.hpp"
+#include "GLStateCache.hpp"
+#include "GPUResourceTracker.hpp"
+#include "VertexFormat.hpp"
+#include "VertexLayout.hpp"
+
+#include <cstddef>
+#include <iostream>
+
+// Constructor
+MeshRegistry::MeshRegistry(){
+
+}
+
+// Destructor
+MeshRegistry::~MeshRegistry(){
+    if(!m_meshes.empty()){
+        std::cout << "MeshRegistry.cpp: " << m_meshes.size()
+                  << " mesh(es) were never released\n";
+    }
+}
+
+MeshHandle MeshRegistry::Create(const std::vector<GLfloat>& vertexData, const std::vector<uint32_t>& indexData,
+                                GLenum usage){
+    return Create(vertexData.data(), vertexData.size(), indexData.data(), indexData.size(), usage);
+}
+
+MeshHandle MeshRegistry::Create(const GLfloat* vertexData, size_t floatCount,
+                                const uint32_t* indexData, size_t indexCount,
+                                GLenum usage){
+    GLBackend& backend = GLBackend::Get();
+    if(m_vertexArrays[FORMAT_PACKED].vao == 0){
+        CreateVertexArrays();
+    }
+    GPUMesh mesh;
+    mesh.usage = usage;
+
+    // Buffer creation, the vertex arrays are shared
+    mesh.vbo = backend.CreateBuffer();
+    GPUResourceTracker::Get().Created(GPU_BUFFER, mesh.vbo, "mesh vertices");
+    mesh.ebo = backend.CreateBuffer();
+    GPUResourceTracker::Get().Created(GPU_BUFFER, mesh.ebo, "mesh indices");
+
+    // Convert to the packed GPU layout before upload
+    mesh.vertexCount = (GLsizei)(floatCount / FLOATS_PER_VERTEX);
+    PackVertices(vertexData, mesh.vertexCount, m_packedVertices);
+    mesh.vertexCapacity = m_packedVertices.size() * sizeof(PackedVertex);
+    backend.BufferData(mesh.vbo, mesh.vertexCapacity, m_packedVertices.data(), usage);
+    GPUResourceTracker::Get().Resized(GPU_BUFFER, mesh.vbo, mesh.vertexCapacity);
+    UploadIndices(mesh, indexData, indexCount);
+
+    m_meshes.push_back(mesh);
+    return (MeshHandle)(m_meshes.size() - 1);
+}
+
+void MeshRegistry::Update(MeshHandle handle, const std::vector<GLfloat>& vertexData, const std::vector<uint32_t>& indexData){
+    if(handle >= m_meshes.size()){
+        return;
+    }
+    UpdateVertices(handle, vertexData);
+    // Only the contents change, the buffer names stay what is attached
+    UploadIndices(m_meshes[handle], indexData.data(), indexData.size());
+}
+
+void MeshRegistry::UpdateVertices(MeshHandle handle, const std::vector<GLfloat>& vertexData){
+    if(handle >= m_meshes.size()){
+        return;
+    }
+    GPUMesh& mesh = m_meshes[handle];
+    mesh.vertexCount = (GLsizei)(vertexData.size() / FLOATS_PER_VERTEX);
+    PackVertices(vertexData.data(), mesh.vertexCount, m_packedVertices);
+    size_t bytes = m_packedVertices.size() * sizeof(PackedVertex);
+
+    if(bytes > mesh.vertexCapacity){
+        // Grow the storage; the buffer name stays what is attached.
+        GLBackend::Get().BufferData(mesh.vbo, bytes, m_packedVertices.data(), mesh.usage);
+        mesh.vertexCapacity = bytes;
+        GPUResourceTracker::Get().Resized(GPU_BUFFER, mesh.vbo, bytes);
+    }else{
+        GLBackend::Get().BufferSubData(mesh.vbo, 0, bytes, m_packedVertices.data());
+    }
+}
+
+void MeshRegistry::UpdateVertexRange(MeshHandle handle, size_t firstVertex, const GLfloat* vertexData, size_t vertexCount){
+    if(handle >= m_meshes.size()){
+        return;
+    }
+    GPUMesh& mesh = m_meshes[handle];
+    if(firstVertex + vertexCount > (size_t)mesh.vertexCount){
+        std::cout << "MeshRegistry.cpp: vertex range is outside the mesh\n";
+        return;
+    }
+    PackVertices(vertexData, vertexCount, m_packedVertices);
+    GLBackend::Get().BufferSubData(mesh.vbo, firstVertex * sizeof(PackedVertex),
+                                   vertexCount * sizeof(PackedVertex), m_packedVertices.data());
+}
+
+void MeshRegistry::EnableInstancing(MeshHandle handle, size_t maxInstances){
+    if(handle >= m_meshes.size()){
+        return;
+    }
+    GPUMesh& mesh = m_meshes[handle];
+    if(mesh.instanceVbo != 0){
+        return;
+    }
+    mesh.instanceVbo = GLBackend::Get().CreateBuffer();
+    GPUResourceTracker::Get().Created(GPU_BUFFER, mesh.instanceVbo, "mesh instances");
+    mesh.instanceCapacity = maxInstances * sizeof(InstanceData);
+    GLBackend::Get().BufferData(mesh.instanceVbo, mesh.instanceCapacity, nullptr, GL_DYNAMIC_DRAW);
+    GPUResourceTracker::Get().Resized(GPU_BUFFER, mesh.instanceVbo, mesh.instanceCapacity);
+    BindInstanceBuffer(handle, mesh.instanceVbo, 0);
+}
+
+void MeshRegistry::UpdateInstances(MeshHandle handle, const InstanceData* instances, size_t instanceCount){
+    if(handle >= m_meshes.size() || m_meshes[handle].instanceVbo == 0){
+        return;
+    }
+    GPUMesh& mesh = m_meshes[handle];
+    size_t bytes = instanceCount * sizeof(InstanceData);
+
+    if(bytes > mesh.instanceCapacity){
+        GLBackend::Get().BufferData(mesh.instanceVbo, bytes, instances, GL_DYNAMIC_DRAW);
+        mesh.instanceCapacity = bytes;
+        GPUResourceTracker::Get().Resized(GPU_BUFFER, mesh.instanceVbo, bytes);
+    }else if(bytes > 0){
+        GLBackend::Get().BufferSubData(mesh.instanceVbo, 0, bytes, instances);
+    }
+    mesh.instanceCount = (GLsizei)instanceCount;
+}
+
+GLsizei MeshRegistry::GetInstanceCount(MeshHandle handle) const{
+    if(handle >= m_meshes.size()){
+        return 0;
+    }
+    return m_meshes[handle].instanceCount;
+}
+
+void MeshRegistry::BindInstanceBuffer(MeshHandle handle, GLuint buffer, size_t byteOffset){
+    if(handle >= m_meshes.size()){
+        return;
+    }
+    GPUMesh& mesh = m_meshes[handle];
+    mesh.instanceSource = buffer;
+    mesh.instanceOffset = byteOffset;
+    // A bound mesh may move to the instanced VAO here
+    if(handle == m_boundMesh){
+        Bind(handle);
+    }
+}
+
+void MeshRegistry::UploadIndices(GPUMesh& mesh, const uint32_t* indexData, size_t indexCount){
+    const void* data = indexData;
+    size_t bytes = indexCount * sizeof(uint32_t);
+    GLenum type = GL_UNSIGNED_INT;
+
+    // Small meshes only need 16-bit indices
+    if(mesh.vertexCount <= 0xFFFF){
+        m_shortIndices.resize(indexCount);
+        for(size_t i = 0; i < indexCount; ++i){
+            m_shortIndices[i] = (uint16_t)indexData[i];
+        }
+        data = m_shortIndices.data();
+        bytes = indexCount * sizeof(uint16_t);
+        type = GL_UNSIGNED_SHORT;
+    }
+
+    if(bytes > mesh.indexCapacity || type != mesh.indexType){
+        GLBackend::Get().BufferData(mesh.ebo, bytes, data, mesh.usage);
+        mesh.indexCapacity = bytes;
+        GPUResourceTracker::Get().Resized(GPU_BUFFER, mesh.ebo, bytes);
+    }else{
+        GLBackend::Get().BufferSubData(mesh.ebo, 0, bytes, data);
+    }
+    mesh.indexType = type;
+    mesh.indexCount = (GLsizei)indexCount;
+}
+
+MeshHandle MeshRegistry::Adopt(const MeshRegistry& owner, MeshHandle handle){
+    if(handle >= owner.m_meshes.size()){
+        return INVALID_MESH;
+    }
+    if(m_vertexArrays[FORMAT_PACKED].vao == 0){
+        CreateVertexArrays();
+    }
+    GPUMesh mesh = owner.m_meshes[handle];
+    // Instances come from whatever this context binds for them
+    mesh.instanceVbo = 0;
+    mesh.instanceCount = 0;
+    mesh.instanceCapacity = 0;
+    mesh.instanceSource = 0;
+    mesh.instanceOffset = 0;
+    mesh.adopted = true;
+    m_meshes.push_back(mesh);
+    return (MeshHandle)(m_meshes.size() - 1);
+}
+
+void MeshRegistry::Bind(MeshHandle handle){
+    if(handle >= m_meshes.size()){
+        return;
+    }
+    const GPUMesh& mesh = m_meshes[handle];
+    bool instanced = mesh.instanceSource != 0;
+    SharedVertexArray& vertexArray = m_vertexArrays[instanced ? FORMAT_INSTANCED : FORMAT_PACKED];
+    GLStateCache::Get().BindVertexArray(vertexArray.vao);
+    AttachBuffers(vertexArray, mesh, instanced);
+    m_boundMesh = handle;
+}
+
+GLsizei MeshRegistry::GetVertexCount(MeshHandle handle) const{
+    if(handle >= m_meshes.size()){
+        return 0;
+    }
+    return m_meshes[handle].vertexCount;
+}
+
+GLsizei MeshRegistry::GetIndexCount(MeshHandle handle) const{
+    if(handle >= m_meshes.size()){
+        return 0;
+    }
+    return m_meshes[handle].indexCount;
+}
+
+GLenum MeshRegistry::GetIndexType(MeshHandle handle) const{
+    if(handle >= m_meshes.size()){
+        return GL_UNSIGNED_SHORT;
+    }
+    return m_meshes[handle].indexType;
+}
+
+size_t MeshRegistry::GetMeshCount() const{
+    return m_meshes.size();
+}
+
+void MeshRegistry::Release(){
+    GPUResourceTracker& tracker = GPUResourceTracker::Get();
+    for(GPUMesh& mesh : m_meshes){
+        if(mesh.adopted){
+            continue;
+        }
+        if(mesh.instanceVbo != 0){
+            glDeleteBuffers(1, &mesh.instanceVbo);
+            tracker.Deleted(GPU_BUFFER, mesh.instanceVbo);
+        }
+        glDeleteBuffers(1, &mesh.ebo);
+        glDeleteBuffers(1, &mesh.vbo);
+        tracker.Deleted(GPU_BUFFER, mesh.ebo);
+        tracker.Deleted(GPU_BUFFER, mesh.vbo);
+    }
+    m_meshes.clear();
+    for(SharedVertexArray& vertexArray : m_vertexArrays){
+        if(vertexArray.vao != 0){
+            glDeleteVertexArrays(1, &vertexArray.vao);
+            tracker.Deleted(GPU_VERTEX_ARRAY, vertexArray.vao);
+        }
+        vertexArray = SharedVertexArray();
+    }
+    m_boundMesh = INVALID_MESH;
+    GLStateCache::Get().Invalidate();
+}
+
+// =============================
+// PackedVertex, 20 bytes
+//
+// | x,y,z (3 floats) | normal (2_10_10_10) | u,v (2 halves) |
+// 0                  12                    16               20
+//
+// The normal is read by the shader's vertexColors input.
+// ============================
+typedef VertexLayout<FloatAttribute<0, 3>, Snorm10Attribute<1>, HalfFloatAttribute<2, 2>> PackedVertexLayout;
+static_assert(PackedVertexLayout::STRIDE == sizeof(PackedVertex), "PackedVertexLayout does not match PackedVertex");
+static_assert(PackedVertexLayout::Offset(1) == offsetof(PackedVertex, normal), "PackedVertexLayout normal offset");
+static_assert(PackedVertexLayout::Offset(2) == offsetof(PackedVertex, u), "PackedVertexLayout texture offset");
+
+// Instance offset and scale (x,y,z,scale), then palette column, texture
+// U offset and the day and night texture layers, then the animation
+typedef VertexLayout<FloatAttribute<3, 4>, FloatAttribute<4, 4>, FloatAttribute<5, 4>> InstanceLayout;
+static_assert(InstanceLayout::STRIDE == sizeof(InstanceData), "InstanceLayout does not match InstanceData");
+static_assert(InstanceLayout::Offset(1) == offsetof(InstanceData, palette), "InstanceLayout material offset");
+static_assert(InstanceLayout::Offset(2) == offsetof(InstanceData, jumpStart), "InstanceLayout animation offset");
+
+// Buffer binding points of a vertex array with direct state access
+static const GLuint VERTEX_BINDING = 0;
+static const GLuint INSTANCE_BINDING = 1;
+
+void MeshRegistry::CreateVertexArrays(){
+    GLBackend& backend = GLBackend::Get();
+    const char* names[FORMAT_COUNT] = {"shared vertex array", "shared instanced vertex array"};
+    for(int format = 0; format < FORMAT_COUNT; ++format){
+        SharedVertexArray& vertexArray = m_vertexArrays[format];
+        vertexArray.vao = backend.CreateVertexArray();
+        GPUResourceTracker::Get().Created(GPU_VERTEX_ARRAY, vertexArray.vao, names[format]);
+        if(!backend.HasDirectStateAccess()){
+            continue;
+        }
+        // The formats never change, only the buffers behind them
+        PackedVertexLayout::SetupFormat(vertexArray.vao, VERTEX_BINDING);
+        if(format == FORMAT_INSTANCED){
+            InstanceLayout::SetupFormat(vertexArray.vao, INSTANCE_BINDING, 1);
+        }
+    }
+}
+
+void MeshRegistry::AttachBuffers(SharedVertexArray& vertexArray, const GPUMesh& mesh, bool instanced){
+    bool directStateAccess = GLBackend::Get().HasDirectStateAccess();
+    if(vertexArray.vertexBuffer != mesh.vbo){
+        if(directStateAccess){
+            glVertexArrayVertexBuffer(vertexArray.vao, VERTEX_BINDING, mesh.vbo, 0, (GLsizei)PackedVertexLayout::STRIDE);
+        }else{
+            glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo);
+            PackedVertexLayout::Setup();
+        }
+        vertexArray.vertexBuffer = mesh.vbo;
+    }
+    if(vertexArray.elementBuffer != mesh.ebo){
+        // The element buffer binding is stored in the (bound) VAO
+        if(directStateAccess){
+            glVertexArrayElementBuffer(vertexArray.vao, mesh.ebo);
+        }else{
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.ebo);
+        }
+        vertexArray.elementBuffer = mesh.ebo;
+    }
+    if(!instanced || (vertexArray.instanceBuffer == mesh.instanceSource &&
+                      vertexArray.instanceOffset == mesh.instanceOffset)){
+        return;
+    }
+    if(directStateAccess){
+        glVertexArrayVertexBuffer(vertexArray.vao, INSTANCE_BINDING, mesh.instanceSource,
+                                  (GLintptr)mesh.instanceOffset, (GLsizei)InstanceLayout::STRIDE);
+    }else{
+        glBindBuffer(GL_ARRAY_BUFFER, mesh.instanceSource);
+        InstanceLayout::Setup(mesh.instanceOffset, 1);
+    }
+    vertexArray.instanceBuffer = mesh.instanceSource;
+    vertexArray.instanceOffset = mesh.instanceOffset;
+}
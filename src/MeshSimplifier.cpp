@@ -0,0 +1,463 @@
+#include "MeshSimplifier.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include <unordered_map>
+
+// Weight of the planes that hold open borders and texture seams in place,
+// relative to the planes of the triangles themselves
+static const double BORDER_WEIGHT = 10.0;
+// A level is only kept if it has at most this share of the triangles of
+// the level before it
+static const double MIN_LOD_REDUCTION = 0.8;
+// Triangles below which no further level is built
+static const size_t MIN_LOD_TRIANGLES = 8;
+
+namespace{
+
+// Sum of squared distances to a set of planes, the upper triangle of a
+// symmetric 4x4 matrix: aa ab ac ad bb bc bd cc cd dd
+struct Quadric{
+    double m[10] = {};
+
+    void AddPlane(double a, double b, double c, double d, double weight){
+        m[0] += weight*a*a; m[1] += weight*a*b; m[2] += weight*a*c; m[3] += weight*a*d;
+        m[4] += weight*b*b; m[5] += weight*b*c; m[6] += weight*b*d;
+        m[7] += weight*c*c; m[8] += weight*c*d;
+        m[9] += weight*d*d;
+    }
+    void Add(const Quadric& other){
+        for(int i = 0; i < 10; ++i){
+            m[i] += other.m[i];
+        }
+    }
+    double Evaluate(const double* p) const{
+        const double x = p[0], y = p[1], z = p[2];
+        return m[0]*x*x + 2.0*m[1]*x*y + 2.0*m[2]*x*z + 2.0*m[3]*x
+             + m[4]*y*y + 2.0*m[5]*y*z + 2.0*m[6]*y
+             + m[7]*z*z + 2.0*m[8]*z
+             + m[9];
+    }
+};
+
+struct Position{
+    double p[3];
+};
+
+struct SimplifyTriangle{
+    uint32_t vertex[3];
+    uint32_t position[3];
+    bool live;
+};
+
+// Collapsing from into to; stale once either end changed after it was queued
+struct Collapse{
+    double cost;
+    uint32_t from;
+    uint32_t to;
+    uint32_t fromStamp;
+    uint32_t toStamp;
+};
+
+// Orders the queue cheapest first, ties broken by the positions so the
+// result never depends on the queue's internals
+struct CollapseOrder{
+    bool operator()(const Collapse& a, const Collapse& b) const{
+        if(a.cost != b.cost){
+            return a.cost > b.cost;
+        }
+        if(a.from != b.from){
+            return a.from > b.from;
+        }
+        return a.to > b.to;
+    }
+};
+
+void Subtract(const double* a, const double* b, double* out){
+    out[0] = a[0] - b[0];
+    out[1] = a[1] - b[1];
+    out[2] = a[2] - b[2];
+}
+
+void Cross(const double* a, const double* b, double* out){
+    out[0] = a[1]*b[2] - a[2]*b[1];
+    out[1] = a[2]*b[0] - a[0]*b[2];
+    out[2] = a[0]*b[1] - a[1]*b[0];
+}
+
+double Dot(const double* a, const double* b){
+    return a[0]*b[0] + a[1]*b[1] + a[2]*b[2];
+}
+
+// Unnormalized normal of the triangle p0 p1 p2
+void TriangleNormal(const double* p0, const double* p1, const double* p2, double* normal){
+    double e1[3], e2[3];
+    Subtract(p1, p0, e1);
+    Subtract(p2, p0, e2);
+    Cross(e1, e2, normal);
+}
+
+class Simplifier{
+public:
+    Simplifier(const float* vertices, size_t vertexCount, size_t floatsPerVertex,
+               const uint32_t* indices, size_t indexCount)
+        : m_vertices(vertices), m_floatsPerVertex(floatsPerVertex){
+        WeldPositions(vertexCount);
+        m_triangles.resize(indexCount / 3);
+        m_positionTriangles.resize(m_positions.size());
+        for(size_t t = 0; t < m_triangles.size(); ++t){
+            SimplifyTriangle& triangle = m_triangles[t];
+            for(int k = 0; k < 3; ++k){
+                triangle.vertex[k] = indices[t*3 + k];
+                triangle.position[k] = m_vertexPositions[triangle.vertex[k]];
+            }
+            // Corners on one position have no area and nothing to simplify
+            triangle.live = triangle.position[0] != triangle.position[1] &&
+                            triangle.position[1] != triangle.position[2] &&
+                            triangle.position[0] != triangle.position[2];
+            if(triangle.live){
+                ++m_liveCount;
+                for(int k = 0; k < 3; ++k){
+                    m_positionTriangles[triangle.position[k]].push_back((uint32_t)t);
+                }
+            }
+        }
+        BuildQuadrics();
+    }
+
+    std::vector<uint32_t> Run(size_t targetIndexCount, float& error){
+        std::priority_queue<Collapse, std::vector<Collapse>, CollapseOrder> queue;
+        for(const SimplifyTriangle& triangle : m_triangles){
+            if(!triangle.live){
+                continue;
+            }
+            for(int k = 0; k < 3; ++k){
+                uint32_t a = triangle.position[k];
+                uint32_t b = triangle.position[(k + 1) % 3];
+                // Every edge once, from the triangle that has it going up
+                if(a < b || !HasEdge(b, a)){
+                    queue.push(MakeCollapse(a, b));
+                }
+            }
+        }
+
+        double largestCost = 0.0;
+        while(m_liveCount * 3 > targetIndexCount && !queue.empty()){
+            Collapse collapse = queue.top();
+            queue.pop();
+            if(m_dead[collapse.from] || m_dead[collapse.to] ||
+               m_stamps[collapse.from] != collapse.fromStamp || m_stamps[collapse.to] != collapse.toStamp){
+                continue;
+            }
+            if(Flips(collapse.from, collapse.to)){
+                continue;
+            }
+            Apply(collapse.from, collapse.to);
+            largestCost = std::max(largestCost, collapse.cost);
+            // Every edge around the merged position costs something new now
+            ++m_stamps[collapse.to];
+            std::vector<uint32_t> neighbours;
+            for(uint32_t t : m_positionTriangles[collapse.to]){
+                const SimplifyTriangle& triangle = m_triangles[t];
+                for(int k = 0; k < 3; ++k){
+                    if(triangle.position[k] != collapse.to){
+                        neighbours.push_back(triangle.position[k]);
+                    }
+                }
+            }
+            std::sort(neighbours.begin(), neighbours.end());
+            neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+            for(uint32_t neighbour : neighbours){
+                queue.push(MakeCollapse(collapse.to, neighbour));
+            }
+        }
+
+        error = (float)std::sqrt(largestCost);
+        std::vector<uint32_t> result;
+        result.reserve(m_liveCount * 3);
+        for(const SimplifyTriangle& triangle : m_triangles){
+            if(triangle.live){
+                result.insert(result.end(), triangle.vertex, triangle.vertex + 3);
+            }
+        }
+        return result;
+    }
+private:
+    // Gives vertices with exactly the same position one position id
+    void WeldPositions(size_t vertexCount){
+        std::vector<uint32_t> order(vertexCount);
+        for(size_t v = 0; v < vertexCount; ++v){
+            order[v] = (uint32_t)v;
+        }
+        auto position = [this](uint32_t v){
+            return m_vertices + (size_t)v * m_floatsPerVertex;
+        };
+        std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b){
+            const float* pa = position(a);
+            const float* pb = position(b);
+            if(pa[0] != pb[0]) return pa[0] < pb[0];
+            if(pa[1] != pb[1]) return pa[1] < pb[1];
+            if(pa[2] != pb[2]) return pa[2] < pb[2];
+            return a < b;
+        });
+        m_vertexPositions.resize(vertexCount);
+        for(size_t i = 0; i < vertexCount; ++i){
+            const float* p = position(order[i]);
+            if(i == 0 || !std::equal(p, p + 3, position(order[i - 1]))){
+                Position welded = {{p[0], p[1], p[2]}};
+                m_positions.push_back(welded);
+                m_positionVertices.push_back(std::vector<uint32_t>());
+            }
+            m_vertexPositions[order[i]] = (uint32_t)(m_positions.size() - 1);
+            m_positionVertices.back().push_back(order[i]);
+        }
+        m_quadrics.resize(m_positions.size());
+        m_stamps.assign(m_positions.size(), 0);
+        m_dead.assign(m_positions.size(), 0);
+    }
+
+    // The planes of every triangle, and of the borders and seams
+    void BuildQuadrics(){
+        // Edges used by a single triangle are borders, or seams where the
+        // texture coordinates on either side differ. Normals may differ
+        // freely: flat shaded meshes split every vertex by its normal.
+        std::vector<uint32_t> seamIds = GetSeamIds();
+        std::unordered_map<uint64_t, uint32_t> edgeUses;
+        for(const SimplifyTriangle& triangle : m_triangles){
+            if(!triangle.live){
+                continue;
+            }
+            for(int k = 0; k < 3; ++k){
+                ++edgeUses[EdgeKey(seamIds[triangle.vertex[k]], seamIds[triangle.vertex[(k + 1) % 3]])];
+            }
+        }
+        for(const SimplifyTriangle& triangle : m_triangles){
+            if(!triangle.live){
+                continue;
+            }
+            const double* p[3] = {m_positions[triangle.position[0]].p, m_positions[triangle.position[1]].p,
+                                  m_positions[triangle.position[2]].p};
+            double normal[3];
+            TriangleNormal(p[0], p[1], p[2], normal);
+            double length = std::sqrt(Dot(normal, normal));
+            if(length == 0.0){
+                continue;
+            }
+            for(int i = 0; i < 3; ++i){
+                normal[i] /= length;
+            }
+            double d = -Dot(normal, p[0]);
+            for(int k = 0; k < 3; ++k){
+                m_quadrics[triangle.position[k]].AddPlane(normal[0], normal[1], normal[2], d, 1.0);
+            }
+            for(int k = 0; k < 3; ++k){
+                if(edgeUses[EdgeKey(seamIds[triangle.vertex[k]], seamIds[triangle.vertex[(k + 1) % 3]])] != 1){
+                    continue;
+                }
+                // A plane through the edge, upright on the triangle
+                const double* a = p[k];
+                const double* b = p[(k + 1) % 3];
+                double edge[3], across[3];
+                Subtract(b, a, edge);
+                Cross(edge, normal, across);
+                double acrossLength = std::sqrt(Dot(across, across));
+                if(acrossLength == 0.0){
+                    continue;
+                }
+                for(int i = 0; i < 3; ++i){
+                    across[i] /= acrossLength;
+                }
+                double acrossD = -Dot(across, a);
+                m_quadrics[triangle.position[k]].AddPlane(across[0], across[1], across[2], acrossD, BORDER_WEIGHT);
+                m_quadrics[triangle.position[(k + 1) % 3]].AddPlane(across[0], across[1], across[2], acrossD, BORDER_WEIGHT);
+            }
+        }
+    }
+
+    // An id per vertex shared by the vertices with the same position and
+    // texture coordinates, the last two floats of a vertex
+    std::vector<uint32_t> GetSeamIds() const{
+        std::vector<uint32_t> ids(m_vertexPositions.size());
+        uint32_t next = 0;
+        const size_t uv = m_floatsPerVertex - 2;
+        for(const std::vector<uint32_t>& vertices : m_positionVertices){
+            for(size_t i = 0; i < vertices.size(); ++i){
+                const float* a = m_vertices + (size_t)vertices[i] * m_floatsPerVertex + uv;
+                size_t match = i;
+                for(size_t j = 0; j < i && m_floatsPerVertex >= 5; ++j){
+                    const float* b = m_vertices + (size_t)vertices[j] * m_floatsPerVertex + uv;
+                    if(a[0] == b[0] && a[1] == b[1]){
+                        match = j;
+                        break;
+                    }
+                }
+                ids[vertices[i]] = (match == i) ? next++ : ids[vertices[match]];
+            }
+        }
+        return ids;
+    }
+
+    static uint64_t EdgeKey(uint32_t a, uint32_t b){
+        return (a < b) ? ((uint64_t)a << 32 | b) : ((uint64_t)b << 32 | a);
+    }
+
+    // Whether some live triangle has the directed edge a -> b
+    bool HasEdge(uint32_t a, uint32_t b) const{
+        for(uint32_t t : m_positionTriangles[a]){
+            const SimplifyTriangle& triangle = m_triangles[t];
+            for(int k = 0; k < 3; ++k){
+                if(triangle.position[k] == a && triangle.position[(k + 1) % 3] == b){
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    // The cheaper direction of collapsing the edge a b
+    Collapse MakeCollapse(uint32_t a, uint32_t b) const{
+        Quadric sum = m_quadrics[a];
+        sum.Add(m_quadrics[b]);
+        double toB = std::max(0.0, sum.Evaluate(m_positions[b].p));
+        double toA = std::max(0.0, sum.Evaluate(m_positions[a].p));
+        Collapse collapse;
+        if(toB <= toA){
+            collapse = Collapse{toB, a, b, m_stamps[a], m_stamps[b]};
+        }else{
+            collapse = Collapse{toA, b, a, m_stamps[b], m_stamps[a]};
+        }
+        return collapse;
+    }
+
+    // Whether moving from onto to would turn a surviving triangle over
+    bool Flips(uint32_t from, uint32_t to) const{
+        for(uint32_t t : m_positionTriangles[from]){
+            const SimplifyTriangle& triangle = m_triangles[t];
+            if(!triangle.live || Contains(triangle, to)){
+                continue;
+            }
+            const double* before[3];
+            const double* after[3];
+            for(int k = 0; k < 3; ++k){
+                before[k] = m_positions[triangle.position[k]].p;
+                after[k] = (triangle.position[k] == from) ? m_positions[to].p : before[k];
+            }
+            double n0[3], n1[3];
+            TriangleNormal(before[0], before[1], before[2], n0);
+            TriangleNormal(after[0], after[1], after[2], n1);
+            if(Dot(n0, n1) <= 0.0 || Dot(n1, n1) == 0.0){
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static bool Contains(const SimplifyTriangle& triangle, uint32_t position){
+        return triangle.position[0] == position || triangle.position[1] == position || triangle.position[2] == position;
+    }
+
+    // Moves every corner at from onto to and drops the triangles in between
+    void Apply(uint32_t from, uint32_t to){
+        for(uint32_t t : m_positionTriangles[from]){
+            SimplifyTriangle& triangle = m_triangles[t];
+            if(!triangle.live){
+                continue;
+            }
+            if(Contains(triangle, to)){
+                triangle.live = false;
+                --m_liveCount;
+                continue;
+            }
+            for(int k = 0; k < 3; ++k){
+                if(triangle.position[k] == from){
+                    triangle.position[k] = to;
+                    triangle.vertex[k] = GetClosestVertex(to, triangle.vertex[k]);
+                }
+            }
+            m_positionTriangles[to].push_back(t);
+        }
+        m_positionTriangles[from].clear();
+        m_quadrics[to].Add(m_quadrics[from]);
+        m_dead[from] = 1;
+        // Keep the merged position's list to its live triangles
+        std::vector<uint32_t>& list = m_positionTriangles[to];
+        list.erase(std::remove_if(list.begin(), list.end(), [this](uint32_t t){
+            return !m_triangles[t].live;
+        }), list.end());
+    }
+
+    // The vertex at position whose attributes are closest to those of vertex
+    uint32_t GetClosestVertex(uint32_t position, uint32_t vertex) const{
+        const float* attributes = m_vertices + (size_t)vertex * m_floatsPerVertex;
+        uint32_t best = m_positionVertices[position][0];
+        double bestDistance = -1.0;
+        for(uint32_t candidate : m_positionVertices[position]){
+            const float* other = m_vertices + (size_t)candidate * m_floatsPerVertex;
+            double distance = 0.0;
+            for(size_t i = 3; i < m_floatsPerVertex; ++i){
+                double delta = (double)other[i] - attributes[i];
+                distance += delta*delta;
+            }
+            if(bestDistance < 0.0 || distance < bestDistance){
+                best = candidate;
+                bestDistance = distance;
+            }
+        }
+        return best;
+    }
+
+    const float* m_vertices;
+    size_t m_floatsPerVertex;
+    std::vector<Position> m_positions;
+    std::vector<uint32_t> m_vertexPositions;
+    std::vector<std::vector<uint32_t>> m_positionVertices;
+    std::vector<std::vector<uint32_t>> m_positionTriangles;
+    std::vector<Quadric> m_quadrics;
+    // Bumped whenever a position's quadric changes
+    std::vector<uint32_t> m_stamps;
+    std::vector<uint8_t> m_dead;
+    std::vector<SimplifyTriangle> m_triangles;
+    size_t m_liveCount{0};
+};
+
+}
+
+std::vector<uint32_t> SimplifyMesh(const float* vertices, size_t vertexCount, size_t floatsPerVertex,
+                                   const uint32_t* indices, size_t indexCount,
+                                   size_t targetIndexCount, float& error){
+    error = 0.0f;
+    if(floatsPerVertex < 3 || indexCount < 3){
+        return std::vector<uint32_t>(indices, indices + indexCount);
+    }
+    Simplifier simplifier(vertices, vertexCount, floatsPerVertex, indices, indexCount);
+    return simplifier.Run(targetIndexCount, error);
+}
+
+void BuildMeshLods(const std::vector<float>& vertices, size_t floatsPerVertex,
+                   std::vector<uint32_t>& indices, std::vector<MeshLod>& lods){
+    lods.clear();
+    const size_t fullCount = indices.size();
+    lods.push_back(MeshLod{0, (uint32_t)fullCount, 0.0f});
+    if(floatsPerVertex < 3){
+        return;
+    }
+    const size_t vertexCount = vertices.size() / floatsPerVertex;
+    size_t previousCount = fullCount;
+    for(uint32_t level = 1; level < MAX_MESH_LODS; ++level){
+        size_t target = (fullCount / 3 >> level) * 3;
+        if(target < MIN_LOD_TRIANGLES * 3){
+            break;
+        }
+        // Always from the full mesh, so errors do not pile up level on level
+        float error = 0.0f;
+        std::vector<uint32_t> lod = SimplifyMesh(vertices.data(), vertexCount, floatsPerVertex,
+                                                 indices.data(), fullCount, target, error);
+        if(lod.empty() || (double)lod.size() > (double)previousCount * MIN_LOD_REDUCTION){
+            break;
+        }
+        lods.push_back(MeshLod{(uint32_t)indices.size(), (uint32_t)lod.size(), std::max(error, lods.back().error)});
+        indices.insert(indices.end(), lod.begin(), lod.end());
+        previousCount = lod.size();
+    }
+}
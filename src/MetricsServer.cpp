@@ -0,0 +1,207 @@
+#include "MetricsServer.hpp"
+#include "AssetLoader.hpp"
+#include "FileReader.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+
+#if defined(__linux__)
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+// Scrapes wait this long for a connection, and for its request
+static const int ACCEPT_POLL_MILLISECONDS = 250;
+static const int REQUEST_MILLISECONDS = 1000;
+
+// Constructor
+MetricsServer::MetricsServer(){
+
+}
+
+// Destructor
+MetricsServer::~MetricsServer(){
+    Stop();
+}
+
+bool MetricsServer::Start(int port, bool training){
+    Stop();
+#if defined(__linux__)
+    if(!m_listener.Listen(port)){
+        return false;
+    }
+    m_training = training;
+    m_hasPrevious = false;
+    m_stop.store(false, std::memory_order_relaxed);
+    m_thread = std::thread(&MetricsServer::ServerThread, this);
+    return true;
+#else
+    (void)port;
+    (void)training;
+    std::cout << "MetricsServer.cpp: the metrics server is only implemented on Linux\n";
+    return false;
+#endif
+}
+
+void MetricsServer::Stop(){
+    if(m_thread.joinable()){
+        m_stop.store(true, std::memory_order_relaxed);
+        m_thread.join();
+    }
+    m_listener.Close();
+}
+
+void MetricsServer::ServerThread(){
+#if defined(__linux__)
+    while(!m_stop.load(std::memory_order_relaxed)){
+        // Wakes up now and then to see whether it should stop
+        pollfd listening = {m_listener.GetFd(), POLLIN, 0};
+        if(poll(&listening, 1, ACCEPT_POLL_MILLISECONDS) <= 0){
+            continue;
+        }
+        TcpSocket connection = m_listener.Accept();
+        if(connection.IsOpen()){
+            Serve(connection);
+        }
+    }
+#endif
+}
+
+void MetricsServer::Serve(TcpSocket& connection){
+#if defined(__linux__)
+    // The request line, then headers up to an empty line
+    std::string request;
+    std::string line;
+    std::chrono::steady_clock::time_point deadline =
+        std::chrono::steady_clock::now() + std::chrono::milliseconds(REQUEST_MILLISECONDS);
+    bool complete = false;
+    while(!complete){
+        while(connection.TakeLine(line)){
+            if(!line.empty() && line.back() == '\r'){
+                line.pop_back();
+            }
+            if(request.empty()){
+                request = line;
+            }else if(line.empty()){
+                complete = true;
+                break;
+            }
+        }
+        if(complete){
+            break;
+        }
+        int left = (int)std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - std::chrono::steady_clock::now()).count();
+        pollfd readable = {connection.GetFd(), POLLIN, 0};
+        if(left <= 0 || poll(&readable, 1, left) <= 0 || !connection.ReadAvailable()){
+            return;
+        }
+    }
+
+    std::string status = "200 OK";
+    std::string body;
+    if(request.compare(0, 13, "GET /metrics ") == 0 || request == "GET /metrics"){
+        body = Format();
+        m_scrapes.store(m_scrapes.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }else if(request.compare(0, 4, "GET ") == 0){
+        status = "404 Not Found";
+        body = "Metrics are at /metrics\n";
+    }else{
+        status = "405 Method Not Allowed";
+        body = "Only GET is supported\n";
+    }
+    std::string answer = "HTTP/1.1 " + status + "\r\n"
+                         "Content-Type: text/plain; version=0.0.4\r\n"
+                         "Content-Length: " + std::to_string(body.size()) + "\r\n"
+                         "Connection: close\r\n\r\n" + body;
+    connection.SendAll(answer.data(), answer.size());
+#else
+    (void)connection;
+#endif
+}
+
+// Appends one metric with its help and type lines
+static void AddMetric(std::string& out, const char* name, const char* type, const char* help, double value){
+    char line[256];
+    snprintf(line, sizeof(line), "# HELP %s %s\n# TYPE %s %s\n%s %.9g\n", name, help, name, type, name, value);
+    out += line;
+}
+
+// Bytes resident in memory, 0 if /proc cannot tell
+static uint64_t GetResidentBytes(){
+#if defined(__linux__)
+    std::FILE* statm = std::fopen("/proc/self/statm", "r");
+    if(statm == nullptr){
+        return 0;
+    }
+    unsigned long long size = 0;
+    unsigned long long resident = 0;
+    int read = std::fscanf(statm, "%llu %llu", &size, &resident);
+    std::fclose(statm);
+    return (read == 2) ? (uint64_t)resident * (uint64_t)sysconf(_SC_PAGESIZE) : 0;
+#else
+    return 0;
+#endif
+}
+
+std::string MetricsServer::Format(){
+    TelemetrySnapshot snapshot = Telemetry::Get().Snapshot();
+    std::string out;
+    out.reserve(4096);
+
+    // Prometheus buckets count every frame up to their edge, in seconds
+    out += "# HELP dino_frame_seconds Time of a frame of the frame loop\n"
+           "# TYPE dino_frame_seconds histogram\n";
+    char line[256];
+    uint64_t frames = 0;
+    for(int i = 0; i < TELEMETRY_FRAME_BUCKETS; ++i){
+        frames += snapshot.frames[i];
+        if(i < TELEMETRY_FRAME_BUCKETS - 1){
+            snprintf(line, sizeof(line), "dino_frame_seconds_bucket{le=\"%g\"} %llu\n",
+                     TELEMETRY_FRAME_EDGES[i] / 1000.0, (unsigned long long)frames);
+        }else{
+            snprintf(line, sizeof(line), "dino_frame_seconds_bucket{le=\"+Inf\"} %llu\n", (unsigned long long)frames);
+        }
+        out += line;
+    }
+    snprintf(line, sizeof(line), "dino_frame_seconds_sum %.6f\ndino_frame_seconds_count %llu\n",
+             (double)snapshot.frameMicroseconds / 1000000.0, (unsigned long long)frames);
+    out += line;
+
+    AddMetric(out, "dino_frames_per_second", "gauge", "Frame rate over the last frames",
+              m_framesPerSecond.load(std::memory_order_relaxed));
+    AddMetric(out, "dino_gpu_frame_seconds", "gauge", "GPU time of the render passes of the last timed frame",
+              m_gpuMilliseconds.load(std::memory_order_relaxed) / 1000.0);
+    AddMetric(out, "dino_gpu_memory_bytes", "gauge", "Bytes of the GL buffers and textures the game tracks",
+              (double)m_gpuBytes.load(std::memory_order_relaxed));
+    AddMetric(out, "dino_resident_memory_bytes", "gauge", "Resident set size of the process",
+              (double)GetResidentBytes());
+    AddMetric(out, "dino_uptime_seconds", "gauge", "Seconds since startup", snapshot.seconds);
+    if(m_assets != nullptr){
+        out += "# HELP dino_asset_load_seconds Time from queueing an asset to the end of its upload\n"
+               "# TYPE dino_asset_load_seconds summary\n";
+        snprintf(line, sizeof(line), "dino_asset_load_seconds_sum %.6f\ndino_asset_load_seconds_count %llu\n",
+                 m_assets->GetLoadSeconds(), (unsigned long long)m_assets->GetTimedLoadCount());
+        out += line;
+        const FileReader& reader = FileReader::Get();
+        AddMetric(out, "dino_asset_files_read_total", "counter", "Asset files read ahead of their parse",
+                  (double)reader.GetFileCount());
+        AddMetric(out, "dino_asset_read_bytes_total", "counter", "Bytes of the asset files read ahead",
+                  (double)reader.GetByteCount());
+        AddMetric(out, "dino_asset_read_submits_total", "counter", "io_uring_enter calls that submitted asset reads",
+                  (double)reader.GetSubmitCount());
+    }
+
+    if(m_training){
+        AddMetric(out, "dino_steps_total", "counter", "Simulation steps", (double)snapshot.steps);
+        AddMetric(out, "dino_steps_per_second", "gauge", "Simulation steps per second since the previous scrape",
+                  snapshot.GetStepsPerSecond(m_hasPrevious ? &m_previous : nullptr));
+        AddMetric(out, "dino_episodes_total", "counter", "Episodes finished", (double)snapshot.episodes);
+        AddMetric(out, "dino_episode_score_mean", "gauge", "Mean score of the finished episodes",
+                  snapshot.GetMeanScore());
+        m_previous = snapshot;
+        m_hasPrevious = true;
+    }
+    return out;
+}
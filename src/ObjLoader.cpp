@@ -1,77 +1,466 @@
 #include "ObjLoader.hpp"
-#include "globals.hpp"
-#include <fstream>
-#include <sstream>
+#include "FileView.hpp"
+#include "JobSystem.hpp"
+#include "MeshNormals.hpp"
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <functional>
 #include <iostream>
-
-std::string gTextureName;
+#include <unordered_map>
 
 ObjLoader::ObjLoader(const std::string& filename, int type) {
     load(filename);
-    textureName = gTextureName;
     modelType = type;
 }
 
-void ObjLoader::load(const std::string& filename) {
-    std::ifstream file(filename);
-    std::string line;
+ObjLoader ObjLoader::clone() const {
+    return ObjLoader(*this);
+}
 
-    std::string directory = filename.substr(0, filename.find_last_of('/'));
+// Helpers for scanning a mapped file in place.
+// Every token is a [begin,end) range into the file, nothing is copied to the heap.
+namespace{
 
-    std::string mtlFilename;
-    std::string textureName;
-
-    while (std::getline(file, line)) {
-        std::istringstream iss(line);
-        std::string prefix;
-        iss >> prefix;
-
-        if (prefix == "v") { // Vertex position
-            Vertex vertex;
-            iss >> vertex.x >> vertex.y >> vertex.z;
-            vertices.push_back(vertex);
-        } else if (prefix == "vt") { // Texture coordinate
-            TextureCoords texture;
-            iss >> texture.u >> texture.v;
-            textures.push_back(texture);
-        } else if (prefix == "vn") { // Vertex normal
-            Normal normal;
-            iss >> normal.nx >> normal.ny >> normal.nz;
-            normals.push_back(normal);
-        } else if (prefix == "f") { // Face
-            Face face;
-            for (int i = 0; i < 3; ++i) {
-                iss >> face.vertexIndices[i];
-                if (iss.peek() == '/') {
-                    iss.get();
-                    if (iss.peek() != '/') {
-                        iss >> face.textureIndices[i];
-                    }
-                    if (iss.peek() == '/') {
-                        iss.get();
-                        iss >> face.normalIndices[i];
-                    }
+// Pointer to the end of the current line (the '\n' or the end of the data)
+const char* findLineEnd(const char* p, const char* end) {
+    const void* newline = memchr(p, '\n', end - p);
+    return newline ? static_cast<const char*>(newline) : end;
+}
+
+const char* skipSpaces(const char* p, const char* end) {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) {
+        ++p;
+    }
+    return p;
+}
+
+// Returns the next whitespace separated token and advances p past it
+void nextToken(const char*& p, const char* end, const char*& tokenBegin, const char*& tokenEnd) {
+    p = skipSpaces(p, end);
+    tokenBegin = p;
+    while (p < end && *p != ' ' && *p != '\t' && *p != '\r') {
+        ++p;
+    }
+    tokenEnd = p;
+}
+
+bool tokenEquals(const char* begin, const char* end, const char* literal) {
+    size_t length = strlen(literal);
+    return (size_t)(end - begin) == length && memcmp(begin, literal, length) == 0;
+}
+
+// Parses the next float on the line; leaves value untouched on failure
+void readFloat(const char*& p, const char* end, float& value) {
+    p = skipSpaces(p, end);
+    // from_chars does not accept an explicit '+'
+    if (p < end && *p == '+') {
+        ++p;
+    }
+    std::from_chars_result result = std::from_chars(p, end, value);
+    if (result.ec == std::errc()) {
+        p = result.ptr;
+    }
+}
+
+// Parses a (possibly negative) integer at p and advances past it
+bool readInt(const char*& p, const char* end, int& value) {
+    std::from_chars_result result = std::from_chars(p, end, value);
+    if (result.ec != std::errc()) {
+        return false;
+    }
+    p = result.ptr;
+    return true;
+}
+
+// Converts a 1-based (or negative, relative) obj index into a 0-based one.
+// Missing indices (0) become -1.
+int resolveIndex(int index, size_t count) {
+    if (index > 0) {
+        return index - 1;
+    }
+    if (index < 0) {
+        return (int)count + index;
+    }
+    return -1;
+}
+
+// Maximum corners we triangulate on a single 'f' line
+const int MAX_FACE_CORNERS = 64;
+
+// Reads every corner of the polygon after an 'f': v, v/vt, v//vn or
+// v/vt/vn, resolved against the element counts so far. Returns how many.
+int readFaceCorners(const char*& p, const char* lineEnd, size_t vertexCount, size_t textureCount,
+                    size_t normalCount, int corners[MAX_FACE_CORNERS][3]) {
+    int cornerCount = 0;
+    while (cornerCount < MAX_FACE_CORNERS) {
+        p = skipSpaces(p, lineEnd);
+        int v = 0, vt = 0, vn = 0;
+        if (!readInt(p, lineEnd, v)) {
+            break;
+        }
+        if (p < lineEnd && *p == '/') {
+            ++p;
+            if (p < lineEnd && *p != '/') {
+                readInt(p, lineEnd, vt);
+            }
+            if (p < lineEnd && *p == '/') {
+                ++p;
+                readInt(p, lineEnd, vn);
+            }
+        }
+        corners[cornerCount][0] = resolveIndex(v, vertexCount);
+        corners[cornerCount][1] = resolveIndex(vt, textureCount);
+        corners[cornerCount][2] = resolveIndex(vn, normalCount);
+        ++cornerCount;
+    }
+    return cornerCount;
+}
+
+// Files smaller than this per thread are parsed on the calling thread
+const size_t PARALLEL_CHUNK_BYTES = 4 << 20;
+// See ObjLoader::setParseThreads()
+std::atomic<unsigned int> parseThreads{0};
+
+// A line-aligned piece of the file, parsed on its own. Positions, texture
+// coordinates and normals go straight into the loader's arrays, at the
+// chunk's base (the prefix sum of the counts of the chunks before it);
+// faces go into the chunk's own array and are merged afterwards.
+struct ObjChunk {
+    const char* begin;
+    const char* end;
+    size_t vertexCount, textureCount, normalCount, faceLineCount;
+    size_t vertexBase, textureBase, normalBase, faceBase;
+    MeshVector<Face> faces;
+    std::vector<std::string> materialLibraries;
+    // Each usemtl line: the chunk's face count at it and the name
+    std::vector<std::pair<size_t, std::string>> materialUses;
+    // Each s line the same way, and whether it turned smoothing off
+    std::vector<std::pair<size_t, bool>> smoothingUses;
+    AABB bounds;
+};
+
+// First pass: count the elements so every array is allocated once.
+void countChunk(ObjChunk& chunk) {
+    chunk.vertexCount = chunk.textureCount = chunk.normalCount = chunk.faceLineCount = 0;
+    for (const char* p = chunk.begin; p < chunk.end; ) {
+        const char* lineEnd = findLineEnd(p, chunk.end);
+        p = skipSpaces(p, lineEnd);
+        if (lineEnd - p >= 2) {
+            if (p[0] == 'v' && p[1] == ' ') {
+                ++chunk.vertexCount;
+            } else if (p[0] == 'v' && p[1] == 't') {
+                ++chunk.textureCount;
+            } else if (p[0] == 'v' && p[1] == 'n') {
+                ++chunk.normalCount;
+            } else if (p[0] == 'f' && p[1] == ' ') {
+                ++chunk.faceLineCount;
+            }
+        }
+        p = lineEnd + 1;
+    }
+}
+
+// Second pass: parse. Indices are resolved against the element counts up
+// to the line, the chunk's base included, so relative ones stay right.
+void parseChunk(ObjChunk& chunk, Vertex* vertices, TextureCoords* textures, Normal* normals) {
+    size_t vertexCount = chunk.vertexBase;
+    size_t textureCount = chunk.textureBase;
+    size_t normalCount = chunk.normalBase;
+    chunk.faces.reserve(chunk.faceLineCount);
+
+    const char* p = chunk.begin;
+    const char* end = chunk.end;
+    while (p < end) {
+        const char* lineEnd = findLineEnd(p, end);
+        const char* prefixBegin;
+        const char* prefixEnd;
+        nextToken(p, lineEnd, prefixBegin, prefixEnd);
+
+        if (tokenEquals(prefixBegin, prefixEnd, "v")) { // Vertex position
+            Vertex vertex = {};
+            readFloat(p, lineEnd, vertex.x);
+            readFloat(p, lineEnd, vertex.y);
+            readFloat(p, lineEnd, vertex.z);
+            vertices[vertexCount++] = vertex;
+            chunk.bounds.Extend(vertex.x, vertex.y, vertex.z);
+        } else if (tokenEquals(prefixBegin, prefixEnd, "vt")) { // Texture coordinate
+            TextureCoords texture = {};
+            readFloat(p, lineEnd, texture.u);
+            readFloat(p, lineEnd, texture.v);
+            textures[textureCount++] = texture;
+        } else if (tokenEquals(prefixBegin, prefixEnd, "vn")) { // Vertex normal
+            Normal normal = {};
+            readFloat(p, lineEnd, normal.nx);
+            readFloat(p, lineEnd, normal.ny);
+            readFloat(p, lineEnd, normal.nz);
+            normals[normalCount++] = normal;
+        } else if (tokenEquals(prefixBegin, prefixEnd, "f")) { // Face
+            int corners[MAX_FACE_CORNERS][3];
+            int cornerCount = readFaceCorners(p, lineEnd, vertexCount, textureCount, normalCount, corners);
+            // Triangulate quads and n-gons as a fan around the first corner
+            for (int k = 1; k + 1 < cornerCount; ++k) {
+                const int order[3] = {0, k, k + 1};
+                Face face;
+                for (int i = 0; i < 3; ++i) {
+                    face.vertexIndices[i]  = corners[order[i]][0];
+                    face.textureIndices[i] = corners[order[i]][1];
+                    face.normalIndices[i]  = corners[order[i]][2];
                 }
-                --face.vertexIndices[i];  // obj indices start at 1
-                --face.textureIndices[i]; // obj indices start at 1
-                --face.normalIndices[i];  // obj indices start at 1
-            }
-            faces.push_back(face);
-        } else if (prefix == "mtllib") { // Material library
-            iss >> mtlFilename;
-            std::ifstream mtlFile(directory + "/" + mtlFilename);
-            std::string mtlLine;
-            while (std::getline(mtlFile, mtlLine)) {
-                std::istringstream mtlIss(mtlLine);
-                std::string mtlPrefix;
-                mtlIss >> mtlPrefix;
-                if (mtlPrefix == "map_Kd") { // Diffuse texture map
-                    mtlIss >> textureName;
-                    gTextureName = directory + "/" + textureName;
+                chunk.faces.push_back(face);
+            }
+        } else if (tokenEquals(prefixBegin, prefixEnd, "mtllib")) { // Material library
+            const char* nameBegin;
+            const char* nameEnd;
+            nextToken(p, lineEnd, nameBegin, nameEnd);
+            chunk.materialLibraries.push_back(std::string(nameBegin, nameEnd));
+        } else if (tokenEquals(prefixBegin, prefixEnd, "usemtl")) { // Material of the faces that follow
+            const char* nameBegin;
+            const char* nameEnd;
+            nextToken(p, lineEnd, nameBegin, nameEnd);
+            chunk.materialUses.push_back(std::make_pair(chunk.faces.size(), std::string(nameBegin, nameEnd)));
+        } else if (tokenEquals(prefixBegin, prefixEnd, "s")) { // Smoothing group of the faces that follow
+            const char* groupBegin;
+            const char* groupEnd;
+            nextToken(p, lineEnd, groupBegin, groupEnd);
+            bool flat = tokenEquals(groupBegin, groupEnd, "off") || tokenEquals(groupBegin, groupEnd, "0");
+            chunk.smoothingUses.push_back(std::make_pair(chunk.faces.size(), flat));
+        }
+        p = lineEnd + 1;
+    }
+}
+
+// Adds every newmtl block of the .mtl at path to library, replacing
+// materials of the same name. Texture paths are resolved against directory.
+void parseMaterialLibrary(const std::string& path, const std::string& directory,
+                          std::unordered_map<std::string, Material>& library) {
+    FileView file(path);
+    const char* p = file.Data();
+    const char* end = p + file.Size();
+    Material* material = nullptr;
+    while (p < end) {
+        const char* lineEnd = findLineEnd(p, end);
+        const char* prefixBegin;
+        const char* prefixEnd;
+        nextToken(p, lineEnd, prefixBegin, prefixEnd);
+        if (tokenEquals(prefixBegin, prefixEnd, "newmtl")) {
+            const char* nameBegin;
+            const char* nameEnd;
+            nextToken(p, lineEnd, nameBegin, nameEnd);
+            std::string name(nameBegin, nameEnd);
+            material = &library[name];
+            *material = Material();
+            material->name = name;
+        } else if (material == nullptr) {
+            // Nothing before the first newmtl belongs to a material
+        } else if (tokenEquals(prefixBegin, prefixEnd, "Kd")) { // Diffuse colour
+            readFloat(p, lineEnd, material->diffuse[0]);
+            readFloat(p, lineEnd, material->diffuse[1]);
+            readFloat(p, lineEnd, material->diffuse[2]);
+        } else if (tokenEquals(prefixBegin, prefixEnd, "d")) { // Dissolve
+            readFloat(p, lineEnd, material->opacity);
+        } else if (tokenEquals(prefixBegin, prefixEnd, "Tr")) { // Transparency, 1 - d
+            float transparency = 1.0f - material->opacity;
+            readFloat(p, lineEnd, transparency);
+            material->opacity = 1.0f - transparency;
+        } else if (tokenEquals(prefixBegin, prefixEnd, "map_Kd")) { // Diffuse texture map
+            // Options such as -s come first, the file name last
+            const char* textureBegin = nullptr;
+            const char* textureEnd = nullptr;
+            while (true) {
+                const char* tokenBegin;
+                const char* tokenEnd;
+                nextToken(p, lineEnd, tokenBegin, tokenEnd);
+                if (tokenBegin == tokenEnd) {
                     break;
                 }
+                textureBegin = tokenBegin;
+                textureEnd = tokenEnd;
+            }
+            if (textureBegin != nullptr) {
+                material->diffuseMap = directory + "/" + std::string(textureBegin, textureEnd);
             }
         }
+        p = lineEnd + 1;
+    }
+}
+
+// Splits [begin, end) into up to count pieces that end at line breaks
+std::vector<ObjChunk> splitChunks(const char* begin, const char* end, size_t count) {
+    std::vector<ObjChunk> chunks;
+    const size_t target = (size_t)(end - begin) / count;
+    const char* p = begin;
+    while (p < end) {
+        const char* chunkEnd = (chunks.size() + 1 < count && (size_t)(end - p) > target) ? p + target : end;
+        if (chunkEnd < end) {
+            chunkEnd = findLineEnd(chunkEnd, end);
+            chunkEnd = (chunkEnd < end) ? chunkEnd + 1 : end;
+        }
+        ObjChunk chunk = {};
+        chunk.begin = p;
+        chunk.end = chunkEnd;
+        chunks.push_back(std::move(chunk));
+        p = chunkEnd;
+    }
+    return chunks;
+}
+
+} // namespace
+
+void ObjLoader::setParseThreads(unsigned int threads) {
+    parseThreads.store(threads, std::memory_order_relaxed);
+}
+
+void ObjLoader::load(const std::string& filename) {
+    FileView file(filename);
+
+    std::string directory = filename.substr(0, filename.find_last_of('/'));
+
+    const char* begin = file.Data();
+    const char* end = begin + file.Size();
+
+    // Large files are split into one chunk per thread; the chunks are
+    // counted in parallel, then parsed in parallel. Loaders running as
+    // jobs share the threads with everything else.
+    size_t chunkCount = std::max<size_t>(1, file.Size() / PARALLEL_CHUNK_BYTES);
+    if (chunkCount > 1) {
+        // Started with the defaults unless the program started it already
+        JobSystem::Get().Start();
+        chunkCount = std::min<size_t>(chunkCount, JobSystem::Get().GetThreadCount());
+        unsigned int limit = parseThreads.load(std::memory_order_relaxed);
+        if (limit > 0) {
+            chunkCount = std::min<size_t>(chunkCount, limit);
+        }
+    }
+    std::vector<ObjChunk> chunks = splitChunks(begin, end, chunkCount);
+    auto runChunks = [&](const std::function<void(size_t)>& task) {
+        JobSystem::Get().ParallelFor(chunks.size(), 1, [&task](size_t first, size_t last) {
+            for (size_t i = first; i < last; ++i) {
+                task(i);
+            }
+        });
+    };
+
+    runChunks([&](size_t i) { countChunk(chunks[i]); });
+    size_t vertexCount = 0, textureCount = 0, normalCount = 0;
+    for (ObjChunk& chunk : chunks) {
+        chunk.vertexBase = vertexCount;
+        chunk.textureBase = textureCount;
+        chunk.normalBase = normalCount;
+        vertexCount += chunk.vertexCount;
+        textureCount += chunk.textureCount;
+        normalCount += chunk.normalCount;
+    }
+    vertices.resize(vertexCount);
+    textures.resize(textureCount);
+    normals.resize(normalCount);
+
+    runChunks([&](size_t i) {
+        parseChunk(chunks[i], vertices.data(), textures.data(), normals.data());
+    });
+
+    // Merge: faces are appended in file order, their indices are final
+    size_t faceCount = 0;
+    for (ObjChunk& chunk : chunks) {
+        chunk.faceBase = faceCount;
+        faceCount += chunk.faces.size();
+        bounds.Extend(chunk.bounds);
+    }
+    if (chunks.size() == 1) {
+        faces.swap(chunks[0].faces);
+    } else {
+        faces.resize(faceCount);
+        runChunks([&](size_t i) {
+            std::copy(chunks[i].faces.begin(), chunks[i].faces.end(), faces.begin() + chunks[i].faceBase);
+        });
+    }
+
+    // Faces are smooth until an 's off', across chunk boundaries as well
+    std::vector<uint8_t> flatFaces;
+    bool flat = false;
+    size_t flatFrom = 0;
+    for (const ObjChunk& chunk : chunks) {
+        for (const std::pair<size_t, bool>& use : chunk.smoothingUses) {
+            size_t face = chunk.faceBase + use.first;
+            if (flat && face > flatFrom) {
+                flatFaces.resize(faces.size(), 0);
+                std::fill(flatFaces.begin() + flatFrom, flatFaces.begin() + face, 1);
+            }
+            flat = use.second;
+            flatFrom = face;
+        }
+    }
+    if (flat && faces.size() > flatFrom) {
+        flatFaces.resize(faces.size(), 0);
+        std::fill(flatFaces.begin() + flatFrom, flatFaces.end(), 1);
+    }
+    generateNormals(flatFaces);
+    buildTriangles();
+
+    // Every material of every library, by name
+    std::unordered_map<std::string, Material> library;
+    for (const ObjChunk& chunk : chunks) {
+        for (const std::string& mtlFilename : chunk.materialLibraries) {
+            parseMaterialLibrary(directory + "/" + mtlFilename, directory, library);
+        }
+    }
+
+    // Names become table ids once per file; a name no library defines
+    // still tells its faces apart from the others
+    std::unordered_map<std::string, MaterialId> ids;
+    auto resolve = [&](const std::string& name) {
+        if (name.empty()) {
+            return NO_MATERIAL;
+        }
+        auto it = ids.find(name);
+        if (it != ids.end()) {
+            return it->second;
+        }
+        auto known = library.find(name);
+        Material material;
+        if (known != library.end()) {
+            material = known->second;
+        } else {
+            material.name = name;
+        }
+        MaterialId id = MaterialTable::Get().Add(material);
+        ids.emplace(name, id);
+        return id;
+    };
+
+    // A run of faces lasts until the next usemtl, across chunk boundaries
+    submeshes.clear();
+    std::string current;
+    size_t runStart = 0;
+    auto closeRun = [&](size_t runEnd) {
+        if (runEnd == runStart) {
+            return;
+        }
+        MaterialId id = resolve(current);
+        uint32_t indexCount = (uint32_t)((runEnd - runStart) * 3);
+        if (!submeshes.empty() && submeshes.back().material == id) {
+            submeshes.back().indexCount += indexCount;
+        } else {
+            submeshes.push_back(ObjSubmesh{id, (uint32_t)(runStart * 3), indexCount});
+        }
+        runStart = runEnd;
+    };
+    for (const ObjChunk& chunk : chunks) {
+        for (const std::pair<size_t, std::string>& use : chunk.materialUses) {
+            closeRun(chunk.faceBase + use.first);
+            current = use.second;
+        }
+    }
+    closeRun(faces.size());
+
+    textureName.clear();
+    for (const ObjSubmesh& submesh : submeshes) {
+        textureName = MaterialTable::Get().GetMaterial(submesh.material).diffuseMap;
+        if (!textureName.empty()) {
+            break;
+        }
     }
 }
 
@@ -79,28 +468,414 @@ std::string ObjLoader::getTextureName() const {
     return textureName;
 }
 
-std::vector<Vertex> ObjLoader::getVertices() const {
+Span<ObjSubmesh> ObjLoader::getSubmeshes() const {
+    return submeshes;
+}
+
+const AABB& ObjLoader::getBounds() const {
+    return bounds;
+}
+
+Span<Vertex> ObjLoader::getVertices() const {
     return vertices;
 }
 
-std::vector<TextureCoords> ObjLoader::getTextures() const {
+Span<TextureCoords> ObjLoader::getTextures() const {
     return textures;
 }
 
-std::vector<Normal> ObjLoader::getNormals() const {
+Span<Normal> ObjLoader::getNormals() const {
     return normals;
 }
 
-std::vector<Triangle> ObjLoader::getTriangles() const {
-    std::vector<Triangle> triangles;
+Span<Triangle> ObjLoader::getTriangles() const {
+    return triangles;
+}
+
+void ObjLoader::generateNormals(const std::vector<uint8_t>& flatFaces) {
+    generatedNormals = 0;
+    // Judged against the file's own normals, not the ones added below
+    std::vector<uint8_t> usable(normals.size());
+    for (size_t i = 0; i < normals.size(); ++i) {
+        usable[i] = IsUsableNormal(normals[i].nx, normals[i].ny, normals[i].nz) ? 1 : 0;
+    }
+    auto needsNormal = [&usable](int vn) {
+        return vn < 0 || (size_t)vn >= usable.size() || !usable[vn];
+    };
+    bool missing = false;
+    for (size_t f = 0; f < faces.size() && !missing; ++f) {
+        for (int i = 0; i < 3; ++i) {
+            missing = missing || needsNormal(faces[f].normalIndices[i]);
+        }
+    }
+    if (!missing) {
+        return;
+    }
+
+    // Edges of every face as structure of arrays, then all the cross
+    // products at once; faces with normals still count towards the
+    // smooth ones around them
+    size_t faceCount = faces.size();
+    std::vector<float> edges(faceCount * 6);
+    std::vector<float> faceNormals(faceCount * 3);
+    float* ax = edges.data();
+    float* ay = ax + faceCount;
+    float* az = ay + faceCount;
+    float* bx = az + faceCount;
+    float* by = bx + faceCount;
+    float* bz = by + faceCount;
+    float* nx = faceNormals.data();
+    float* ny = nx + faceCount;
+    float* nz = ny + faceCount;
+    const Vertex noVertex = {};
+    auto position = [&](int v) -> const Vertex& {
+        return (v >= 0 && (size_t)v < vertices.size()) ? vertices[v] : noVertex;
+    };
+    for (size_t f = 0; f < faceCount; ++f) {
+        const Vertex& p0 = position(faces[f].vertexIndices[0]);
+        const Vertex& p1 = position(faces[f].vertexIndices[1]);
+        const Vertex& p2 = position(faces[f].vertexIndices[2]);
+        ax[f] = p1.x - p0.x;
+        ay[f] = p1.y - p0.y;
+        az[f] = p1.z - p0.z;
+        bx[f] = p2.x - p0.x;
+        by[f] = p2.y - p0.y;
+        bz[f] = p2.z - p0.z;
+    }
+    CrossEdges(ax, ay, az, bx, by, bz, faceCount, nx, ny, nz);
+
+    // Smooth: the unnormalized face normals summed per position weight
+    // every face by its area
+    std::vector<float> sums;
+    std::vector<int> smoothNormal;
+    size_t vertexCount = vertices.size();
+    if (flatFaces.size() < faceCount || std::find(flatFaces.begin(), flatFaces.end(), 0) != flatFaces.end()) {
+        sums.assign(vertexCount * 3, 0.0f);
+        for (size_t f = 0; f < faceCount; ++f) {
+            if (f < flatFaces.size() && flatFaces[f]) {
+                continue;
+            }
+            for (int i = 0; i < 3; ++i) {
+                int v = faces[f].vertexIndices[i];
+                if (v >= 0 && (size_t)v < vertexCount) {
+                    sums[v] += nx[f];
+                    sums[vertexCount + v] += ny[f];
+                    sums[vertexCount * 2 + v] += nz[f];
+                }
+            }
+        }
+        NormalizeVectors(sums.data(), sums.data() + vertexCount, sums.data() + vertexCount * 2, vertexCount);
+        smoothNormal.assign(vertexCount, -1);
+    }
+    NormalizeVectors(nx, ny, nz, faceCount);
+
+    size_t before = normals.size();
+    for (size_t f = 0; f < faceCount; ++f) {
+        bool flat = f < flatFaces.size() && flatFaces[f];
+        int faceNormal = -1;
+        for (int i = 0; i < 3; ++i) {
+            int& vn = faces[f].normalIndices[i];
+            if (!needsNormal(vn)) {
+                continue;
+            }
+            int v = faces[f].vertexIndices[i];
+            if (!flat && v >= 0 && (size_t)v < vertexCount) {
+                // Corners at one position share its smooth normal
+                if (smoothNormal[v] < 0) {
+                    smoothNormal[v] = (int)normals.size();
+                    normals.push_back(Normal{sums[v], sums[vertexCount + v], sums[vertexCount * 2 + v]});
+                }
+                vn = smoothNormal[v];
+            } else {
+                if (faceNormal < 0) {
+                    faceNormal = (int)normals.size();
+                    normals.push_back(Normal{nx[f], ny[f], nz[f]});
+                }
+                vn = faceNormal;
+            }
+        }
+    }
+    generatedNormals = normals.size() - before;
+}
+
+void ObjLoader::buildTriangles() {
+    // Missing or out of range indices fall back to zeroed data
+    const Vertex noVertex = {};
+    const Normal noNormal = {};
+    const TextureCoords noTexture = {};
+
+    triangles.clear();
+    triangles.reserve(faces.size());
     for (const Face& face : faces) {
         Triangle triangle;
         for (int i = 0; i < 3; ++i) {
-            triangle.vertices[i] = vertices[face.vertexIndices[i]];
-            triangle.normals[i] = normals[face.normalIndices[i]];
-            triangle.textures[i] = textures[face.textureIndices[i]];
+            int v = face.vertexIndices[i];
+            int vn = face.normalIndices[i];
+            int vt = face.textureIndices[i];
+            triangle.vertices[i] = (v >= 0 && (size_t)v < vertices.size()) ? vertices[v] : noVertex;
+            triangle.normals[i] = (vn >= 0 && (size_t)vn < normals.size()) ? normals[vn] : noNormal;
+            triangle.textures[i] = (vt >= 0 && (size_t)vt < textures.size()) ? textures[vt] : noTexture;
         }
         triangles.push_back(triangle);
     }
-    return triangles;
+}
+
+void ObjLoader::getIndexedMesh(std::vector<float>& stream, std::vector<uint32_t>& indices) const {
+    // Key for one unique corner: the (v, vt, vn) index triple
+    struct CornerKey {
+        int v, vt, vn;
+        bool operator==(const CornerKey& other) const {
+            return v == other.v && vt == other.vt && vn == other.vn;
+        }
+    };
+    struct CornerHash {
+        size_t operator()(const CornerKey& key) const {
+            uint64_t h = (uint64_t)(uint32_t)key.v * 0x9E3779B97F4A7C15ull;
+            h ^= (uint64_t)(uint32_t)key.vt * 0xC2B2AE3D27D4EB4Full + (h << 6) + (h >> 2);
+            h ^= (uint64_t)(uint32_t)key.vn * 0x165667B19E3779F9ull + (h << 6) + (h >> 2);
+            return (size_t)h;
+        }
+    };
+
+    const Vertex noVertex = {};
+    const Normal noNormal = {};
+    const TextureCoords noTexture = {};
+
+    std::unordered_map<CornerKey, uint32_t, CornerHash> unique;
+    unique.reserve(faces.size() * 3);
+    stream.clear();
+    indices.clear();
+    indices.reserve(faces.size() * 3);
+
+    for (const Face& face : faces) {
+        for (int i = 0; i < 3; ++i) {
+            CornerKey key = {face.vertexIndices[i], face.textureIndices[i], face.normalIndices[i]};
+            auto inserted = unique.emplace(key, (uint32_t)unique.size());
+            if (inserted.second) {
+                const Vertex& vertex = (key.v >= 0 && (size_t)key.v < vertices.size()) ? vertices[key.v] : noVertex;
+                const Normal& normal = (key.vn >= 0 && (size_t)key.vn < normals.size()) ? normals[key.vn] : noNormal;
+                const TextureCoords& texture = (key.vt >= 0 && (size_t)key.vt < textures.size()) ? textures[key.vt] : noTexture;
+                const float corner[8] = {vertex.x, vertex.y, vertex.z,
+                                         normal.nx, normal.ny, normal.nz,
+                                         texture.u, texture.v};
+                stream.insert(stream.end(), corner, corner + 8);
+            }
+            indices.push_back(inserted.first->second);
+        }
+    }
+}
+
+namespace{
+
+// A corner StreamObj() sent, by its (v, vt, vn) index triple
+struct CachedCorner {
+    int v, vt, vn;
+    uint32_t index;
+};
+
+// v of an empty cache slot; resolved indices are never below -1
+const int NO_CORNER = INT32_MIN;
+// Slots looked at from a corner's hash before one is evicted
+const size_t CORNER_CACHE_PROBES = 8;
+
+// Same mix as getIndexedMesh() uses
+inline size_t hashCorner(int v, int vt, int vn) {
+    uint64_t h = (uint64_t)(uint32_t)v * 0x9E3779B97F4A7C15ull;
+    h ^= (uint64_t)(uint32_t)vt * 0xC2B2AE3D27D4EB4Full + (h << 6) + (h >> 2);
+    h ^= (uint64_t)(uint32_t)vn * 0x165667B19E3779F9ull + (h << 6) + (h >> 2);
+    return (size_t)h;
+}
+
+} // namespace
+
+bool StreamObj(const std::string& filename, const ObjStreamSink& sink, ObjStreamResult& result,
+               size_t cacheEntries, size_t blockBytes) {
+    result = ObjStreamResult();
+    std::FILE* file = std::fopen(filename.c_str(), "rb");
+    if (file == nullptr) {
+        std::cout << "ObjLoader.cpp: unable to open " << filename << "\n";
+        return false;
+    }
+    const std::string directory = filename.substr(0, filename.find_last_of('/'));
+
+    size_t capacity = 1;
+    while (capacity < cacheEntries) {
+        capacity <<= 1;
+    }
+    std::vector<CachedCorner> cache(capacity, CachedCorner{NO_CORNER, 0, 0, 0});
+    std::vector<float> positions;
+    std::vector<TextureCoords> textures;
+    std::vector<Normal> normals;
+    std::vector<std::string> libraries;
+    std::vector<std::string> materialUses;
+    std::vector<char> buffer(std::max<size_t>(blockBytes, 4096));
+    uint32_t vertexCount = 0;
+    bool stopped = false;
+
+    // The index of a corner, sending it first unless the cache has it
+    auto addCorner = [&](const int* corner, uint32_t& index) {
+        size_t home = hashCorner(corner[0], corner[1], corner[2]);
+        size_t victim = home & (capacity - 1);
+        for (size_t probe = 0; probe < CORNER_CACHE_PROBES && probe < capacity; ++probe) {
+            CachedCorner& slot = cache[(home + probe) & (capacity - 1)];
+            if (slot.v == corner[0] && slot.vt == corner[1] && slot.vn == corner[2]) {
+                index = slot.index;
+                return true;
+            }
+            if (slot.v == NO_CORNER) {
+                victim = (home + probe) & (capacity - 1);
+                break;
+            }
+        }
+        int v = corner[0], vt = corner[1], vn = corner[2];
+        bool hasPosition = v >= 0 && (size_t)v * 3 < positions.size();
+        bool hasTexture = vt >= 0 && (size_t)vt < textures.size();
+        bool hasNormal = vn >= 0 && (size_t)vn < normals.size();
+        const float vertex[8] = {hasPosition ? positions[v * 3] : 0.0f,
+                                 hasPosition ? positions[v * 3 + 1] : 0.0f,
+                                 hasPosition ? positions[v * 3 + 2] : 0.0f,
+                                 hasNormal ? normals[vn].nx : 0.0f,
+                                 hasNormal ? normals[vn].ny : 0.0f,
+                                 hasNormal ? normals[vn].nz : 0.0f,
+                                 hasTexture ? textures[vt].u : 0.0f,
+                                 hasTexture ? textures[vt].v : 0.0f};
+        if (!sink.addVertex(vertex)) {
+            return false;
+        }
+        CachedCorner& slot = cache[victim];
+        if (slot.v != NO_CORNER) {
+            ++result.evictedCorners;
+        }
+        slot = CachedCorner{v, vt, vn, vertexCount};
+        index = vertexCount++;
+        return true;
+    };
+
+    // Parses the whole lines of [p, end)
+    auto parseLines = [&](const char* p, const char* end) {
+        while (p < end && !stopped) {
+            const char* lineEnd = findLineEnd(p, end);
+            const char* prefixBegin;
+            const char* prefixEnd;
+            nextToken(p, lineEnd, prefixBegin, prefixEnd);
+            if (tokenEquals(prefixBegin, prefixEnd, "v")) {
+                float position[3] = {0.0f, 0.0f, 0.0f};
+                readFloat(p, lineEnd, position[0]);
+                readFloat(p, lineEnd, position[1]);
+                readFloat(p, lineEnd, position[2]);
+                positions.insert(positions.end(), position, position + 3);
+                result.bounds.Extend(position[0], position[1], position[2]);
+            } else if (tokenEquals(prefixBegin, prefixEnd, "vt")) {
+                TextureCoords texture = {};
+                readFloat(p, lineEnd, texture.u);
+                readFloat(p, lineEnd, texture.v);
+                textures.push_back(texture);
+            } else if (tokenEquals(prefixBegin, prefixEnd, "vn")) {
+                Normal normal = {};
+                readFloat(p, lineEnd, normal.nx);
+                readFloat(p, lineEnd, normal.ny);
+                readFloat(p, lineEnd, normal.nz);
+                normals.push_back(normal);
+            } else if (tokenEquals(prefixBegin, prefixEnd, "f")) {
+                int corners[MAX_FACE_CORNERS][3];
+                int cornerCount = readFaceCorners(p, lineEnd, positions.size() / 3, textures.size(),
+                                                  normals.size(), corners);
+                uint32_t first = 0;
+                uint32_t previous = 0;
+                // Fewer than three corners make no triangle and send nothing
+                for (int k = 0; k < cornerCount && cornerCount >= 3 && !stopped; ++k) {
+                    uint32_t index = 0;
+                    if (!addCorner(corners[k], index)) {
+                        stopped = true;
+                        break;
+                    }
+                    // A fan around the first corner, as the loader makes
+                    if (k == 0) {
+                        first = index;
+                    } else if (k >= 2) {
+                        const uint32_t triangle[3] = {first, previous, index};
+                        if (!sink.addTriangle(triangle)) {
+                            stopped = true;
+                            break;
+                        }
+                        ++result.triangleCount;
+                    }
+                    previous = index;
+                }
+            } else if (tokenEquals(prefixBegin, prefixEnd, "mtllib")) {
+                const char* nameBegin;
+                const char* nameEnd;
+                nextToken(p, lineEnd, nameBegin, nameEnd);
+                libraries.push_back(std::string(nameBegin, nameEnd));
+            } else if (tokenEquals(prefixBegin, prefixEnd, "usemtl")) {
+                const char* nameBegin;
+                const char* nameEnd;
+                nextToken(p, lineEnd, nameBegin, nameEnd);
+                std::string name(nameBegin, nameEnd);
+                if (std::find(materialUses.begin(), materialUses.end(), name) == materialUses.end()) {
+                    materialUses.push_back(name);
+                }
+            }
+            p = lineEnd + 1;
+        }
+    };
+
+    // Blocks are parsed up to their last line break; the partial line
+    // after it moves to the front and is finished by the next block
+    size_t filled = 0;
+    bool failed = false;
+    while (!stopped) {
+        size_t read = std::fread(buffer.data() + filled, 1, buffer.size() - filled, file);
+        filled += read;
+        bool atEnd = read == 0;
+        if (atEnd && std::ferror(file)) {
+            std::cout << "ObjLoader.cpp: could not read " << filename << "\n";
+            failed = true;
+            break;
+        }
+        const char* begin = buffer.data();
+        const char* lineEnd = begin + filled;
+        if (!atEnd) {
+            while (lineEnd > begin && lineEnd[-1] != '\n') {
+                --lineEnd;
+            }
+            if (lineEnd == begin) {
+                // One line longer than the block
+                if (filled == buffer.size()) {
+                    buffer.resize(buffer.size() * 2);
+                }
+                continue;
+            }
+        }
+        parseLines(begin, lineEnd);
+        size_t rest = (size_t)(begin + filled - lineEnd);
+        std::memmove(buffer.data(), lineEnd, rest);
+        filled = rest;
+        if (atEnd) {
+            break;
+        }
+    }
+    std::fclose(file);
+
+    result.vertexCount = vertexCount;
+    result.attributeBytes = positions.capacity() * sizeof(float) + textures.capacity() * sizeof(TextureCoords)
+                          + normals.capacity() * sizeof(Normal);
+    result.workingBytes = buffer.size() + cache.size() * sizeof(CachedCorner);
+    if (failed || stopped) {
+        return false;
+    }
+
+    // The first material used that has a diffuse map, as getTextureName()
+    std::unordered_map<std::string, Material> library;
+    for (const std::string& mtlFilename : libraries) {
+        parseMaterialLibrary(directory + "/" + mtlFilename, directory, library);
+    }
+    for (const std::string& name : materialUses) {
+        auto known = library.find(name);
+        if (known != library.end() && !known->second.diffuseMap.empty()) {
+            result.textureName = known->second.diffuseMap;
+            break;
+        }
+    }
+    return true;
 }
@@ -0,0 +1,146 @@
+#include "ObstacleLane.hpp"
+
+bool InsertObstacle(ObstacleLane& lane, int x, int y){
+    if(lane.count == OBSTACLE_LANE_CAPACITY){
+        return false;
+    }
+    // Shift anything further right up one slot
+    uint32_t i = lane.count;
+    while(i > 0 && lane.x[GetLaneSlot(lane, i - 1)] > x){
+        uint32_t from = GetLaneSlot(lane, i - 1);
+        uint32_t to = GetLaneSlot(lane, i);
+        lane.x[to] = lane.x[from];
+        lane.y[to] = lane.y[from];
+        --i;
+    }
+    uint32_t slot = GetLaneSlot(lane, i);
+    lane.x[slot] = x;
+    lane.y[slot] = y;
+    ++lane.count;
+    return true;
+}
+
+uint32_t RemoveObstaclesBefore(ObstacleLane& lane, int minX){
+    uint32_t removed = 0;
+    while(lane.count > 0 && lane.x[lane.head] < minX){
+        lane.head = (lane.head + 1) & OBSTACLE_LANE_MASK;
+        --lane.count;
+        ++removed;
+    }
+    return removed;
+}
+
+void AdvanceObstacleLane(ObstacleLane& lane, int dx){
+    // Every slot, used or not, so the loop has a fixed trip count
+    for(uint32_t slot = 0; slot < OBSTACLE_LANE_CAPACITY; ++slot){
+        lane.x[slot] += dx;
+    }
+}
+
+void ResortObstacleLane(ObstacleLane& lane){
+    for(uint32_t i = 1; i < lane.count; ++i){
+        uint32_t slot = GetLaneSlot(lane, i);
+        int x = lane.x[slot];
+        int y = lane.y[slot];
+        uint32_t j = i;
+        while(j > 0 && lane.x[GetLaneSlot(lane, j - 1)] > x){
+            uint32_t from = GetLaneSlot(lane, j - 1);
+            uint32_t to = GetLaneSlot(lane, j);
+            lane.x[to] = lane.x[from];
+            lane.y[to] = lane.y[from];
+            --j;
+        }
+        slot = GetLaneSlot(lane, j);
+        lane.x[slot] = x;
+        lane.y[slot] = y;
+    }
+}
+
+// Lane index of the first obstacle with x >= value
+int GetLaneTop(const ObstacleLane& lane){
+    int top = 0;
+    for(uint32_t i = 0; i < lane.count; ++i){
+        int y = lane.y[GetLaneSlot(lane, i)];
+        top = (y > top) ? y : top;
+    }
+    return top;
+}
+
+static uint32_t LowerBound(const ObstacleLane& lane, int value){
+    uint32_t low = 0;
+    uint32_t high = lane.count;
+    while(low < high){
+        uint32_t middle = (low + high) / 2;
+        if(lane.x[GetLaneSlot(lane, middle)] < value){
+            low = middle + 1;
+        }else{
+            high = middle;
+        }
+    }
+    return low;
+}
+
+LaneWindow FindLaneWindow(const ObstacleLane& lane, int minX, int maxX){
+    LaneWindow window = {0, 0};
+    if(minX > maxX){
+        return window;
+    }
+    window.first = LowerBound(lane, minX);
+    // maxX + 1 would overflow at INT_MAX
+    uint32_t end = (maxX == INT32_MAX) ? lane.count : LowerBound(lane, maxX + 1);
+    window.count = end - window.first;
+    return window;
+}
+
+uint32_t FindFirstLaneHit(const ObstacleLane& lane, const CollisionBox& box, int x, int y,
+                          const CollisionBox& obstacleBox){
+    // Obstacle positions along x that can overlap the box
+    CollisionBox range = OverlapRange(box, obstacleBox);
+    LaneWindow window = FindLaneWindow(lane, range.minX + x, range.maxX + x);
+
+    // The window is at most two contiguous runs of the ring
+    uint32_t tested = 0;
+    while(tested < window.count){
+        uint32_t slot = GetLaneSlot(lane, window.first + tested);
+        uint32_t run = OBSTACLE_LANE_CAPACITY - slot;
+        if(run > window.count - tested){
+            run = window.count - tested;
+        }
+        size_t hit = FindFirstOverlap(box, x, y, obstacleBox, lane.x + slot, lane.y + slot, run);
+        if(hit < run){
+            return window.first + tested + (uint32_t)hit;
+        }
+        tested += run;
+    }
+    return lane.count;
+}
+
+uint32_t FindFirstSweptLaneHit(const ObstacleLane& lane, const CollisionBox& box, int x0, int y0, int x1, int y1,
+                               const CollisionBox& obstacleBox){
+    CollisionBox range = OverlapRange(box, obstacleBox);
+    int left = (x0 < x1) ? x0 : x1;
+    int right = (x0 < x1) ? x1 : x0;
+    LaneWindow window = FindLaneWindow(lane, left + range.minX, right + range.maxX);
+    for(uint32_t i = 0; i < window.count; ++i){
+        uint32_t slot = GetLaneSlot(lane, window.first + i);
+        // The obstacle stands still, its offset from the box moves
+        if(SegmentInRange(range, lane.x[slot] - x0, lane.y[slot] - y0, lane.x[slot] - x1, lane.y[slot] - y1)){
+            return window.first + i;
+        }
+    }
+    return lane.count;
+}
+
+uint32_t FindFirstSweptLaneHit(const ObstacleLane& lane, const CollisionRules& rules, int x0, int y0, int x1, int y1){
+    const CollisionBox& range = rules.hitRange;
+    int left = (x0 < x1) ? x0 : x1;
+    int right = (x0 < x1) ? x1 : x0;
+    LaneWindow window = FindLaneWindow(lane, left + range.minX, right + range.maxX);
+    for(uint32_t i = 0; i < window.count; ++i){
+        uint32_t slot = GetLaneSlot(lane, window.first + i);
+        if(SweptHit(rules, lane.x[slot] - x0, lane.y[slot] - y0, lane.x[slot] - x1, lane.y[slot] - y1)){
+            return window.first + i;
+        }
+    }
+    return lane.count;
+}
@@ -0,0 +1,66 @@
+#include "PaletteTexture.hpp"
+#include "GLBackend.hpp"
+#include "GLStateCache.hpp"
+#include "GPUResourceTracker.hpp"
+#include "Image.hpp"
+
+#include <iostream>
+#include <vector>
+
+// Constructor
+PaletteTexture::PaletteTexture(){
+
+}
+
+// Destructor
+PaletteTexture::~PaletteTexture(){
+
+}
+
+bool PaletteTexture::Load(const std::string& filepath){
+    Image image(filepath);
+    // Top row first, so row 0 is the day
+    image.LoadPPM(false, true);
+    const uint8_t* pixels = image.GetPixelDataPtr();
+    int width = image.GetWidth();
+    int height = image.GetHeight();
+    bool loaded = pixels != nullptr && width > 0 && height >= 2;
+    std::vector<uint8_t> white;
+    if(!loaded){
+        std::cout << "PaletteTexture.cpp: " << filepath << " has no day and night row, every palette is white\n";
+        width = 1;
+        height = 2;
+        white.assign(width * height * 4, 255);
+        pixels = white.data();
+    }
+
+    if(m_texture == 0){
+        m_texture = GLBackend::Get().CreateTexture(GL_TEXTURE_2D);
+        GPUResourceTracker::Get().Created(GPU_TEXTURE, m_texture, "palette");
+    }
+    GLStateCache::Get().BindTexture(PALETTE_TEXTURE_UNIT, GL_TEXTURE_2D, m_texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    // Fetched by texel, never filtered or repeated
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    GPUResourceTracker::Get().Resized(GPU_TEXTURE, m_texture, (size_t)width * height * 4);
+    m_count = width;
+    return loaded;
+}
+
+void PaletteTexture::Bind(){
+    GLStateCache::Get().BindTexture(PALETTE_TEXTURE_UNIT, GL_TEXTURE_2D, m_texture);
+}
+
+void PaletteTexture::Release(){
+    if(m_texture != 0){
+        glDeleteTextures(1, &m_texture);
+        GPUResourceTracker::Get().Deleted(GPU_TEXTURE, m_texture);
+        m_texture = 0;
+    }
+    m_count = 0;
+    GLStateCache::Get().Invalidate();
+}
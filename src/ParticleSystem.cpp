@@ -0,0 +1,223 @@
+#include "ParticleSystem.hpp"
+#include "GLBackend.hpp"
+#include "GLStateCache.hpp"
+#include "GPUResourceTracker.hpp"
+#include "VertexLayout.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+#include <vector>
+
+// Position and seconds left, then velocity and size; the update reads
+// one per vertex, the draw one per instance
+typedef VertexLayout<FloatAttribute<0, 4>, FloatAttribute<1, 4>> ParticleLayout;
+
+// Seconds over which a particle fades out before it dies
+static const float PARTICLE_FADE_SECONDS = 0.25f;
+
+// Constructor
+ParticleSystem::ParticleSystem(){
+
+}
+
+// Destructor
+ParticleSystem::~ParticleSystem(){
+
+}
+
+bool ParticleSystem::ReloadShaders(const std::string& updatePath, const std::string& vertexPath, const std::string& fragmentPath){
+    // The update only writes the buffer, so it has no fragment shader
+    m_updateProgram.SetFeedbackVaryings({"v_positionLife", "v_velocitySize"});
+    if(!m_updateProgram.Build(ShaderProgram::LoadShaderAsString(updatePath), "")){
+        std::cout << "ParticleSystem.cpp: could not build the particle update shader\n";
+        return false;
+    }
+    if(!m_drawProgram.LoadFromFiles(vertexPath, fragmentPath)){
+        std::cout << "ParticleSystem.cpp: could not build the particle shaders\n";
+        return false;
+    }
+    m_update.deltaTime     = m_updateProgram.GetUniformLocation("u_DeltaTime");
+    m_update.scroll        = m_updateProgram.GetUniformLocation("u_Scroll");
+    m_update.groundHeight  = m_updateProgram.GetUniformLocation("u_GroundHeight");
+    m_update.seed          = m_updateProgram.GetUniformLocation("u_Seed");
+    m_update.particleCount = m_updateProgram.GetUniformLocation("u_ParticleCount");
+    m_update.burstCount    = m_updateProgram.GetUniformLocation("u_BurstCount");
+    // Arrays are set from their first element on
+    m_update.burstRange    = m_updateProgram.GetUniformLocation("u_BurstRange[0]");
+    m_update.burstOrigin   = m_updateProgram.GetUniformLocation("u_BurstOrigin[0]");
+    m_update.burstVelocity = m_updateProgram.GetUniformLocation("u_BurstVelocity[0]");
+    m_update.burstSpread   = m_updateProgram.GetUniformLocation("u_BurstSpread[0]");
+    m_colorLocation        = m_drawProgram.GetUniformLocation("u_Color");
+    m_fadeLocation         = m_drawProgram.GetUniformLocation("u_FadeSeconds");
+    return true;
+}
+
+bool ParticleSystem::Initialize(const std::string& updatePath, const std::string& vertexPath, const std::string& fragmentPath){
+    if(!ReloadShaders(updatePath, vertexPath, fragmentPath)){
+        return false;
+    }
+    static_assert(ParticleLayout::STRIDE == sizeof(Particle), "ParticleLayout does not match Particle");
+    static_assert(ParticleLayout::Offset(1) == offsetof(Particle, velocity), "ParticleLayout velocity offset");
+
+    // Both buffers start out all dead; the only upload the pool ever gets
+    GLBackend& backend = GLBackend::Get();
+    std::vector<Particle> dead(MAX_PARTICLES, Particle{{0.0f, 0.0f, 0.0f}, 0.0f, {0.0f, 0.0f, 0.0f}, 0.0f});
+    size_t bytes = dead.size() * sizeof(Particle);
+    for(int i = 0; i < 2; ++i){
+        m_buffers[i] = backend.CreateBuffer();
+        backend.BufferData(m_buffers[i], bytes, dead.data(), GL_DYNAMIC_COPY);
+        GPUResourceTracker::Get().Created(GPU_BUFFER, m_buffers[i], "particles", bytes);
+
+        m_updateVao[i] = backend.CreateVertexArray();
+        GPUResourceTracker::Get().Created(GPU_VERTEX_ARRAY, m_updateVao[i], "particle update vertex array");
+        m_drawVao[i] = backend.CreateVertexArray();
+        GPUResourceTracker::Get().Created(GPU_VERTEX_ARRAY, m_drawVao[i], "particle vertex array");
+        const GLuint vaos[2] = {m_updateVao[i], m_drawVao[i]};
+        for(GLuint divisor = 0; divisor < 2; ++divisor){
+            if(backend.HasDirectStateAccess()){
+                ParticleLayout::SetupFormat(vaos[divisor], 0, divisor);
+                glVertexArrayVertexBuffer(vaos[divisor], 0, m_buffers[i], 0, (GLsizei)ParticleLayout::STRIDE);
+            }else{
+                GLStateCache::Get().BindVertexArray(vaos[divisor]);
+                glBindBuffer(GL_ARRAY_BUFFER, m_buffers[i]);
+                ParticleLayout::Setup(0, divisor);
+            }
+        }
+    }
+    GLStateCache::Get().BindVertexArray(0);
+    m_current = 0;
+    m_cursor = 0;
+    m_burstCount = 0;
+    m_secondsActive = 0.0f;
+    return true;
+}
+
+void ParticleSystem::Emit(const ParticleBurst& burst){
+    if(burst.count == 0 || m_buffers[0] == 0){
+        return;
+    }
+    if(m_burstCount == MAX_BURSTS){
+        std::cout << "ParticleSystem.cpp: too many bursts in one update, burst dropped\n";
+        return;
+    }
+    size_t count = std::min<size_t>(burst.count, MAX_PARTICLES);
+    size_t i = m_burstCount++;
+    m_burstRange[i*2 + 0] = (GLint)m_cursor;
+    m_burstRange[i*2 + 1] = (GLint)count;
+    m_cursor = (m_cursor + count) % MAX_PARTICLES;
+
+    const float origin[4] = {burst.origin.x, burst.origin.y, burst.origin.z, burst.radius};
+    const float velocity[4] = {burst.velocity.x, burst.velocity.y, burst.velocity.z, burst.life};
+    const float spread[4] = {burst.spread.x, burst.spread.y, burst.spread.z, burst.size};
+    std::copy(origin, origin + 4, m_burstOrigin + i*4);
+    std::copy(velocity, velocity + 4, m_burstVelocity + i*4);
+    std::copy(spread, spread + 4, m_burstSpread + i*4);
+    m_secondsActive = std::max(m_secondsActive, burst.life);
+    ++m_burstsEmitted;
+}
+
+void ParticleSystem::Advance(float seconds, float scroll){
+    m_pendingSeconds += seconds;
+    m_pendingScroll += scroll;
+}
+
+void ParticleSystem::Draw(const glm::vec4& color){
+    if(m_buffers[0] == 0 || !IsActive()){
+        m_pendingSeconds = 0.0f;
+        m_pendingScroll = 0.0f;
+        return;
+    }
+    RunPasses(color);
+}
+
+void ParticleSystem::Redraw(const glm::vec4& color){
+    if(m_buffers[0] == 0 || !IsActive()){
+        return;
+    }
+    DrawPass(color);
+}
+
+void ParticleSystem::WarmUp(){
+    if(m_buffers[0] == 0){
+        return;
+    }
+    // Nothing alive and nothing spawned: dead particles stay dead and
+    // are drawn outside the clip volume
+    RunPasses(glm::vec4(0.0f));
+}
+
+void ParticleSystem::RunPasses(const glm::vec4& color){
+    GLStateCache& state = GLStateCache::Get();
+    int next = 1 - m_current;
+
+    // Update: every particle of the current buffer into the other one
+    m_updateProgram.Use();
+    glUniform1f(m_update.deltaTime, m_pendingSeconds);
+    glUniform1f(m_update.scroll, m_pendingScroll);
+    glUniform1f(m_update.groundHeight, m_groundHeight);
+    glUniform1ui(m_update.seed, ++m_seed);
+    glUniform1i(m_update.particleCount, (GLint)MAX_PARTICLES);
+    glUniform1i(m_update.burstCount, (GLint)m_burstCount);
+    if(m_burstCount > 0){
+        glUniform2iv(m_update.burstRange, (GLsizei)m_burstCount, m_burstRange);
+        glUniform4fv(m_update.burstOrigin, (GLsizei)m_burstCount, m_burstOrigin);
+        glUniform4fv(m_update.burstVelocity, (GLsizei)m_burstCount, m_burstVelocity);
+        glUniform4fv(m_update.burstSpread, (GLsizei)m_burstCount, m_burstSpread);
+    }
+    state.BindVertexArray(m_updateVao[m_current]);
+    state.Enable(GL_RASTERIZER_DISCARD);
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, m_buffers[next]);
+    glBeginTransformFeedback(GL_POINTS);
+    glDrawArrays(GL_POINTS, 0, (GLsizei)MAX_PARTICLES);
+    glEndTransformFeedback();
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+    state.Disable(GL_RASTERIZER_DISCARD);
+    m_current = next;
+
+    m_secondsActive = std::max(0.0f, m_secondsActive - m_pendingSeconds);
+    m_pendingSeconds = 0.0f;
+    m_pendingScroll = 0.0f;
+    m_burstCount = 0;
+
+    DrawPass(color);
+}
+
+void ParticleSystem::DrawPass(const glm::vec4& color){
+    GLStateCache& state = GLStateCache::Get();
+    // A quad of four corners per particle
+    m_drawProgram.Use();
+    glUniform4f(m_colorLocation, color.r, color.g, color.b, color.a);
+    glUniform1f(m_fadeLocation, PARTICLE_FADE_SECONDS);
+    state.BindVertexArray(m_drawVao[m_current]);
+    state.Enable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glDepthMask(GL_FALSE);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, (GLsizei)MAX_PARTICLES);
+    glDepthMask(GL_TRUE);
+    state.Disable(GL_BLEND);
+}
+
+void ParticleSystem::Release(){
+    m_updateProgram.Release();
+    m_drawProgram.Release();
+    GPUResourceTracker& tracker = GPUResourceTracker::Get();
+    for(int i = 0; i < 2; ++i){
+        if(m_buffers[i] != 0){
+            glDeleteBuffers(1, &m_buffers[i]);
+            tracker.Deleted(GPU_BUFFER, m_buffers[i]);
+            m_buffers[i] = 0;
+        }
+        if(m_updateVao[i] != 0){
+            glDeleteVertexArrays(1, &m_updateVao[i]);
+            tracker.Deleted(GPU_VERTEX_ARRAY, m_updateVao[i]);
+            m_updateVao[i] = 0;
+        }
+        if(m_drawVao[i] != 0){
+            glDeleteVertexArrays(1, &m_drawVao[i]);
+            tracker.Deleted(GPU_VERTEX_ARRAY, m_drawVao[i]);
+            m_drawVao[i] = 0;
+        }
+    }
+    GLStateCache::Get().Invalidate();
+}
@@ -0,0 +1,318 @@
+#include "PerformanceHUD.hpp"
+#include "GLBackend.hpp"
+#include "GLStateCache.hpp"
+#include "GPUResourceTracker.hpp"
+#include "VertexLayout.hpp"
+
+#include <cstddef>
+#include <iostream>
+
+// The atlas holds ASCII 32 to 127 in 16 columns of 8x8 texel cells
+const int ATLAS_COLUMNS = 16;
+const int ATLAS_ROWS = 6;
+const int ATLAS_CELL = 8;
+const int ATLAS_WIDTH = ATLAS_COLUMNS * ATLAS_CELL;
+const int ATLAS_HEIGHT = ATLAS_ROWS * ATLAS_CELL;
+const int FIRST_CHARACTER = 32;
+// The cell of DEL is solid, for boxes
+const int SOLID_CHARACTER = 127;
+// Texels of a cell that a character covers: the glyph and its spacing
+const int GLYPH_CELL_WIDTH = 6;
+// The atlas is drawn at twice its size
+const float HUD_SCALE = HUD_CHARACTER_WIDTH / GLYPH_CELL_WIDTH;
+// Texture unit of the atlas, away from the scene's unit 0
+const unsigned int HUD_TEXTURE_UNIT = 1;
+
+// 5x7 glyphs, one byte per row from the top, bit 4 the leftmost column.
+// Lowercase letters are drawn with the uppercase glyphs.
+struct Glyph{
+    char character;
+    uint8_t rows[7];
+};
+static const Glyph FONT[] = {
+    {'0', {0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E}},
+    {'1', {0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E}},
+    {'2', {0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F}},
+    {'3', {0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E}},
+    {'4', {0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02}},
+    {'5', {0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E}},
+    {'6', {0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E}},
+    {'7', {0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08}},
+    {'8', {0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E}},
+    {'9', {0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C}},
+    {'A', {0x0E, 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11}},
+    {'B', {0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E}},
+    {'C', {0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E}},
+    {'D', {0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C}},
+    {'E', {0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F}},
+    {'F', {0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10}},
+    {'G', {0x0E, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0F}},
+    {'H', {0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11}},
+    {'I', {0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E}},
+    {'J', {0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0C}},
+    {'K', {0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11}},
+    {'L', {0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F}},
+    {'M', {0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11}},
+    {'N', {0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11}},
+    {'O', {0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E}},
+    {'P', {0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10}},
+    {'Q', {0x0E, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0D}},
+    {'R', {0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11}},
+    {'S', {0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E}},
+    {'T', {0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04}},
+    {'U', {0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E}},
+    {'V', {0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04}},
+    {'W', {0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A}},
+    {'X', {0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11}},
+    {'Y', {0x11, 0x11, 0x11, 0x0A, 0x04, 0x04, 0x04}},
+    {'Z', {0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F}},
+    {'.', {0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C}},
+    {',', {0x00, 0x00, 0x00, 0x00, 0x0C, 0x04, 0x08}},
+    {':', {0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00}},
+    {'-', {0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00}},
+    {'+', {0x00, 0x04, 0x04, 0x1F, 0x04, 0x04, 0x00}},
+    {'=', {0x00, 0x00, 0x1F, 0x00, 0x1F, 0x00, 0x00}},
+    {'_', {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1F}},
+    {'/', {0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00}},
+    {'%', {0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03}},
+    {'(', {0x02, 0x04, 0x08, 0x08, 0x08, 0x04, 0x02}},
+    {')', {0x08, 0x04, 0x02, 0x02, 0x02, 0x04, 0x08}},
+    {'[', {0x0E, 0x08, 0x08, 0x08, 0x08, 0x08, 0x0E}},
+    {']', {0x0E, 0x02, 0x02, 0x02, 0x02, 0x02, 0x0E}},
+    {'!', {0x04, 0x04, 0x04, 0x04, 0x04, 0x00, 0x04}},
+    {'?', {0x0E, 0x11, 0x01, 0x02, 0x04, 0x00, 0x04}},
+    {'<', {0x02, 0x04, 0x08, 0x10, 0x08, 0x04, 0x02}},
+    {'>', {0x08, 0x04, 0x02, 0x01, 0x02, 0x04, 0x08}},
+    {'\'', {0x04, 0x04, 0x08, 0x00, 0x00, 0x00, 0x00}}
+};
+static const size_t GLYPH_COUNT = sizeof(FONT)/sizeof(FONT[0]);
+
+// Writes a glyph into the cell of character
+static void BakeGlyph(std::vector<uint8_t>& texels, int character, const uint8_t* rows){
+    int cell = character - FIRST_CHARACTER;
+    int left = (cell % ATLAS_COLUMNS) * ATLAS_CELL;
+    int top = (cell / ATLAS_COLUMNS) * ATLAS_CELL;
+    for(int y = 0; y < 7; ++y){
+        for(int x = 0; x < 5; ++x){
+            if(rows[y] & (0x10 >> x)){
+                texels[(top + y) * ATLAS_WIDTH + left + x] = 255;
+            }
+        }
+    }
+}
+
+// Constructor
+PerformanceHUD::PerformanceHUD(){
+
+}
+
+// Destructor
+PerformanceHUD::~PerformanceHUD(){
+
+}
+
+bool PerformanceHUD::ReloadShaders(const std::string& vertexPath, const std::string& fragmentPath){
+    if(!m_program.LoadFromFiles(vertexPath, fragmentPath)){
+        std::cout << "PerformanceHUD.cpp: could not build the overlay shaders\n";
+        return false;
+    }
+    m_screenSizeLocation = m_program.GetUniformLocation("u_ScreenSize");
+    m_program.Use();
+    glUniform1i(m_program.GetUniformLocation("u_FontAtlas"), HUD_TEXTURE_UNIT);
+    return true;
+}
+
+bool PerformanceHUD::Initialize(const std::string& vertexPath, const std::string& fragmentPath){
+    if(!ReloadShaders(vertexPath, fragmentPath)){
+        return false;
+    }
+
+    // Bake the atlas
+    std::vector<uint8_t> texels(ATLAS_WIDTH * ATLAS_HEIGHT, 0);
+    for(size_t i = 0; i < GLYPH_COUNT; ++i){
+        const Glyph& glyph = FONT[i];
+        BakeGlyph(texels, glyph.character, glyph.rows);
+        if(glyph.character >= 'A' && glyph.character <= 'Z'){
+            BakeGlyph(texels, glyph.character - 'A' + 'a', glyph.rows);
+        }
+    }
+    const uint8_t solid[7] = {0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F};
+    BakeGlyph(texels, SOLID_CHARACTER, solid);
+
+    GLBackend& backend = GLBackend::Get();
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    if(backend.HasDirectStateAccess()){
+        m_atlas = backend.CreateTexture(GL_TEXTURE_2D);
+        glTextureParameteri(m_atlas, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTextureParameteri(m_atlas, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTextureParameteri(m_atlas, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTextureParameteri(m_atlas, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTextureStorage2D(m_atlas, 1, GL_R8, ATLAS_WIDTH, ATLAS_HEIGHT);
+        glTextureSubImage2D(m_atlas, 0, 0, 0, ATLAS_WIDTH, ATLAS_HEIGHT, GL_RED, GL_UNSIGNED_BYTE, texels.data());
+    }else{
+        glGenTextures(1, &m_atlas);
+        GLStateCache::Get().BindTexture(HUD_TEXTURE_UNIT, GL_TEXTURE_2D, m_atlas);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, ATLAS_WIDTH, ATLAS_HEIGHT, 0, GL_RED, GL_UNSIGNED_BYTE, texels.data());
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    GPUResourceTracker::Get().Created(GPU_TEXTURE, m_atlas, "overlay font atlas", texels.size());
+
+    m_vao = backend.CreateVertexArray();
+    GPUResourceTracker::Get().Created(GPU_VERTEX_ARRAY, m_vao, "overlay vertex array");
+    m_vbo = backend.CreateBuffer();
+    size_t bytes = MAX_QUADS * 6 * sizeof(Vertex);
+    backend.BufferData(m_vbo, bytes, nullptr, GL_STREAM_DRAW);
+    GPUResourceTracker::Get().Created(GPU_BUFFER, m_vbo, "overlay vertices", bytes);
+    // Position, atlas coordinates and color
+    typedef VertexLayout<FloatAttribute<0, 2>, FloatAttribute<1, 2>, Unorm8Attribute<2, 4>> OverlayLayout;
+    static_assert(OverlayLayout::STRIDE == sizeof(Vertex), "OverlayLayout does not match the overlay vertex");
+    static_assert(OverlayLayout::Offset(1) == offsetof(Vertex, u), "OverlayLayout atlas offset");
+    static_assert(OverlayLayout::Offset(2) == offsetof(Vertex, color), "OverlayLayout color offset");
+    if(backend.HasDirectStateAccess()){
+        OverlayLayout::SetupFormat(m_vao, 0);
+        glVertexArrayVertexBuffer(m_vao, 0, m_vbo, 0, (GLsizei)OverlayLayout::STRIDE);
+    }else{
+        GLStateCache::Get().BindVertexArray(m_vao);
+        glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+        OverlayLayout::Setup();
+        GLStateCache::Get().BindVertexArray(0);
+    }
+
+    m_vertices.reserve(MAX_QUADS * 6);
+    m_frameTimes.assign(GRAPH_FRAMES, 0.0f);
+    m_nextFrame = 0;
+    return true;
+}
+
+void PerformanceHUD::AddFrameTime(double milliseconds){
+    if(m_frameTimes.empty()){
+        return;
+    }
+    m_frameTimes[m_nextFrame] = (float)milliseconds;
+    m_nextFrame = (m_nextFrame + 1) % m_frameTimes.size();
+}
+
+void PerformanceHUD::Begin(){
+    m_vertices.clear();
+}
+
+void PerformanceHUD::Quad(float x, float y, float width, float height,
+                          float u0, float v0, float u1, float v1, uint32_t color){
+    if(m_vertices.size() + 6 > m_vertices.capacity()){
+        return;
+    }
+    GLubyte r = (GLubyte)(color >> 24);
+    GLubyte g = (GLubyte)(color >> 16);
+    GLubyte b = (GLubyte)(color >> 8);
+    GLubyte a = (GLubyte)color;
+    Vertex topLeft     = {x, y, u0, v0, {r, g, b, a}};
+    Vertex topRight    = {x + width, y, u1, v0, {r, g, b, a}};
+    Vertex bottomLeft  = {x, y + height, u0, v1, {r, g, b, a}};
+    Vertex bottomRight = {x + width, y + height, u1, v1, {r, g, b, a}};
+    m_vertices.push_back(topLeft);
+    m_vertices.push_back(bottomLeft);
+    m_vertices.push_back(topRight);
+    m_vertices.push_back(topRight);
+    m_vertices.push_back(bottomLeft);
+    m_vertices.push_back(bottomRight);
+}
+
+float PerformanceHUD::Text(float x, float y, const char* text, uint32_t color){
+    const float cellWidth = (float)GLYPH_CELL_WIDTH / ATLAS_WIDTH;
+    const float cellHeight = (float)ATLAS_CELL / ATLAS_HEIGHT;
+    for(const char* c = text; *c != '\0'; ++c){
+        int character = (unsigned char)*c;
+        // Spaces and characters the font lacks only advance
+        if(character > FIRST_CHARACTER && character < SOLID_CHARACTER){
+            int cell = character - FIRST_CHARACTER;
+            float u = (float)((cell % ATLAS_COLUMNS) * ATLAS_CELL) / ATLAS_WIDTH;
+            float v = (float)((cell / ATLAS_COLUMNS) * ATLAS_CELL) / ATLAS_HEIGHT;
+            Quad(x, y, HUD_CHARACTER_WIDTH, ATLAS_CELL * HUD_SCALE, u, v, u + cellWidth, v + cellHeight, color);
+        }
+        x += HUD_CHARACTER_WIDTH;
+    }
+    return x;
+}
+
+void PerformanceHUD::Box(float x, float y, float width, float height, uint32_t color){
+    // The middle of the solid cell, away from its empty edges
+    int cell = SOLID_CHARACTER - FIRST_CHARACTER;
+    float u = ((cell % ATLAS_COLUMNS) * ATLAS_CELL + 2.5f) / ATLAS_WIDTH;
+    float v = ((cell / ATLAS_COLUMNS) * ATLAS_CELL + 3.5f) / ATLAS_HEIGHT;
+    Quad(x, y, width, height, u, v, u, v, color);
+}
+
+void PerformanceHUD::FrameGraph(float x, float y, float width, float height,
+                                double maxMilliseconds, double markMilliseconds){
+    Box(x, y, width, height, HUD_PANEL);
+    if(m_frameTimes.empty() || maxMilliseconds <= 0.0){
+        return;
+    }
+    float barWidth = width / m_frameTimes.size();
+    for(size_t i = 0; i < m_frameTimes.size(); ++i){
+        // Oldest on the left
+        float milliseconds = m_frameTimes[(m_nextFrame + i) % m_frameTimes.size()];
+        float fraction = (float)(milliseconds / maxMilliseconds);
+        if(fraction > 1.0f){
+            fraction = 1.0f;
+        }
+        if(fraction <= 0.0f){
+            continue;
+        }
+        uint32_t color = (milliseconds > markMilliseconds) ? HUD_RED : HUD_GREEN;
+        Box(x + i * barWidth, y + height * (1.0f - fraction), barWidth, height * fraction, color);
+    }
+    float mark = (float)(markMilliseconds / maxMilliseconds);
+    if(mark < 1.0f){
+        Box(x, y + height * (1.0f - mark), width, 1.0f, HUD_YELLOW);
+    }
+}
+
+void PerformanceHUD::Draw(int screenWidth, int screenHeight){
+    m_quadCount = m_vertices.size() / 6;
+    if(m_vertices.empty() || m_vao == 0){
+        return;
+    }
+    GLStateCache& state = GLStateCache::Get();
+    state.Disable(GL_DEPTH_TEST);
+    state.Enable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    state.PolygonMode(GL_FILL);
+    state.Viewport(0, 0, screenWidth, screenHeight);
+    m_program.Use();
+    glUniform2f(m_screenSizeLocation, (float)screenWidth, (float)screenHeight);
+    state.BindTexture(HUD_TEXTURE_UNIT, GL_TEXTURE_2D, m_atlas);
+    state.BindVertexArray(m_vao);
+
+    // Orphan last frame's storage rather than wait for the GPU to finish with it
+    GLBackend& backend = GLBackend::Get();
+    backend.BufferData(m_vbo, MAX_QUADS * 6 * sizeof(Vertex), nullptr, GL_STREAM_DRAW);
+    backend.BufferSubData(m_vbo, 0, m_vertices.size() * sizeof(Vertex), m_vertices.data());
+    glDrawArrays(GL_TRIANGLES, 0, (GLsizei)m_vertices.size());
+
+    state.Disable(GL_BLEND);
+}
+
+void PerformanceHUD::Release(){
+    m_program.Release();
+    if(m_vbo != 0){
+        glDeleteBuffers(1, &m_vbo);
+        GPUResourceTracker::Get().Deleted(GPU_BUFFER, m_vbo);
+        m_vbo = 0;
+    }
+    if(m_vao != 0){
+        glDeleteVertexArrays(1, &m_vao);
+        GPUResourceTracker::Get().Deleted(GPU_VERTEX_ARRAY, m_vao);
+        m_vao = 0;
+    }
+    if(m_atlas != 0){
+        glDeleteTextures(1, &m_atlas);
+        GPUResourceTracker::Get().Deleted(GPU_TEXTURE, m_atlas);
+        m_atlas = 0;
+    }
+    GLStateCache::Get().Invalidate();
+}
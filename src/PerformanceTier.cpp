@@ -0,0 +1,296 @@
+#include "PerformanceTier.hpp"
+#include "FrameBenchmark.hpp"
+#include "GLStateCache.hpp"
+#include "GPUResourceTracker.hpp"
+#include "GameState.hpp"
+#include "InputLog.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+// Settings of every tier, lowest first
+static const QualitySettings TIER_SETTINGS[TIER_COUNT] = {
+    {0.6f, 4.0f, 0.25f, 1},
+    {0.8f, 2.0f, 0.5f, 0},
+    {1.0f, 1.0f, 1.0f, 0}
+};
+static const char* const TIER_NAMES[TIER_COUNT] = {"low", "medium", "high"};
+
+// Least a measure needs for the medium and the high tier. The game steps
+// 60 times a second and a frame takes a few hundred draws at most, so
+// these leave a wide margin for the rest of the frame.
+static const double MEDIUM_SIM_STEPS_PER_SECOND = 200000.0;
+static const double HIGH_SIM_STEPS_PER_SECOND   = 1000000.0;
+static const double MEDIUM_DRAW_CALL_MICROSECONDS = 20.0;
+static const double HIGH_DRAW_CALL_MICROSECONDS   = 5.0;
+static const double MEDIUM_FILL_GIGAPIXELS = 1.0;
+static const double HIGH_FILL_GIGAPIXELS   = 4.0;
+
+// How long the simulation is stepped for, and in runs of this many steps
+static const double SIM_PROBE_SECONDS = 0.1;
+static const int SIM_PROBE_STEPS = 1000;
+// Draws timed for the draw call cost, after as many untimed ones
+static const int DRAW_PROBE_CALLS = 2000;
+// Full screen triangles timed for the fill rate
+static const int FILL_PROBE_LAYERS = 16;
+
+static const char* const TIER_FILE = "tier.txt";
+static const uint32_t TIER_FILE_VERSION = 1;
+
+// Mixes bytes into an FNV-1a hash
+static void HashBytes(uint64_t& hash, const char* bytes, size_t size){
+    for(size_t i = 0; i < size; ++i){
+        hash ^= (uint8_t)bytes[i];
+        hash *= 1099511628211ULL;
+    }
+}
+
+static std::string GetString(GLenum name){
+    const GLubyte* value = glGetString(name);
+    return (value != nullptr) ? std::string(reinterpret_cast<const char*>(value)) : std::string();
+}
+
+static double GetSeconds(std::chrono::steady_clock::time_point start){
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Constructor
+PerformanceTier::PerformanceTier(){
+
+}
+
+// Destructor
+PerformanceTier::~PerformanceTier(){
+
+}
+
+const QualitySettings& PerformanceTier::GetSettings(PerformanceTierLevel level){
+    return TIER_SETTINGS[level];
+}
+
+const char* PerformanceTier::GetName(PerformanceTierLevel level){
+    return TIER_NAMES[level];
+}
+
+bool PerformanceTier::ParseName(const std::string& name, PerformanceTierLevel& level){
+    for(int i = 0; i < TIER_COUNT; ++i){
+        if(name == TIER_NAMES[i]){
+            level = (PerformanceTierLevel)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+uint64_t PerformanceTier::GetMachineKey(){
+    uint64_t hash = 14695981039346656037ULL;
+    std::string machine = GetString(GL_VENDOR) + '\n' + GetString(GL_RENDERER) + '\n' + GetString(GL_VERSION) +
+                          '\n' + std::to_string(std::thread::hardware_concurrency());
+    HashBytes(hash, machine.data(), machine.size());
+    return hash;
+}
+
+bool PerformanceTier::Load(const std::string& directory){
+    std::ifstream file((directory + "/" + TIER_FILE).c_str());
+    if(!file.is_open()){
+        return false;
+    }
+    uint32_t version = 0;
+    uint64_t machine = 0;
+    std::string name;
+    HardwareMeasures measures;
+    std::string line;
+    while(std::getline(file, line)){
+        std::istringstream fields(line);
+        std::string keyword;
+        if(!(fields >> keyword) || keyword[0] == '#'){
+            continue;
+        }
+        if(keyword == "version"){
+            fields >> version;
+        }else if(keyword == "machine"){
+            fields >> std::hex >> machine;
+        }else if(keyword == "tier"){
+            fields >> name;
+        }else if(keyword == "sim_steps_per_second"){
+            fields >> measures.simStepsPerSecond;
+        }else if(keyword == "draw_call_us"){
+            fields >> measures.drawCallMicroseconds;
+        }else if(keyword == "fill_gigapixels_per_second"){
+            fields >> measures.fillGigapixelsPerSecond;
+        }
+    }
+    PerformanceTierLevel level = TIER_HIGH;
+    if(version != TIER_FILE_VERSION || machine != GetMachineKey() || !ParseName(name, level)){
+        return false;
+    }
+    m_level = level;
+    m_measures = measures;
+    return true;
+}
+
+bool PerformanceTier::Save(const std::string& directory) const{
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    std::string path = directory + "/" + TIER_FILE;
+    std::ofstream file(path.c_str(), std::ios::trunc);
+    if(!file.is_open()){
+        std::cout << "PerformanceTier.cpp: could not write " << path << "\n";
+        return false;
+    }
+    file << "# Picked at the first launch on this hardware; delete to probe again\n";
+    file << "version " << TIER_FILE_VERSION << "\n";
+    file << "machine " << std::hex << GetMachineKey() << std::dec << "\n";
+    file << "tier " << GetName(m_level) << "\n";
+    file << "sim_steps_per_second " << m_measures.simStepsPerSecond << "\n";
+    file << "draw_call_us " << m_measures.drawCallMicroseconds << "\n";
+    file << "fill_gigapixels_per_second " << m_measures.fillGigapixelsPerSecond << "\n";
+    return file.good();
+}
+
+double PerformanceTier::ProbeSimulation(){
+    FrameBenchmark script;
+    GameState state;
+    ResetGameState(state);
+    uint64_t gamesPlayed = 0;
+    int64_t steps = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    double seconds = 0.0;
+    while(seconds < SIM_PROBE_SECONDS){
+        for(int i = 0; i < SIM_PROBE_STEPS; ++i){
+            StepLoggedInput(state, script.GetInput(state), 1, gamesPlayed);
+        }
+        steps += SIM_PROBE_STEPS;
+        seconds = GetSeconds(start);
+    }
+    // Kept alive, so the loop is not optimized away
+    if(HashGameState(state) == 0){
+        std::cout << "PerformanceTier.cpp: unexpected state hash\n";
+    }
+    return (double)steps / seconds;
+}
+
+double PerformanceTier::ProbeDrawCalls(){
+    GLStateCache& state = GLStateCache::Get();
+    state.Disable(GL_BLEND);
+    glUniform1f(m_sizeLocation, 0.001f);
+    glUniform4f(m_colorLocation, 1.0f, 1.0f, 1.0f, 1.0f);
+    double seconds = 0.0;
+    // The first run lets the driver finish the program
+    for(int run = 0; run < 2; ++run){
+        glFinish();
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for(int i = 0; i < DRAW_PROBE_CALLS; ++i){
+            float x = (float)(i % 64) / 32.0f - 1.0f;
+            float y = (float)(i / 64 % 64) / 32.0f - 1.0f;
+            glUniform2f(m_offsetLocation, x, y);
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+        }
+        glFinish();
+        seconds = GetSeconds(start);
+    }
+    return seconds * 1e6 / DRAW_PROBE_CALLS;
+}
+
+double PerformanceTier::ProbeFillRate(int width, int height){
+    GLStateCache& state = GLStateCache::Get();
+    state.Enable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glUniform1f(m_sizeLocation, 1.0f);
+    glUniform2f(m_offsetLocation, 0.0f, 0.0f);
+    glUniform4f(m_colorLocation, 1.0f, 1.0f, 1.0f, 0.1f);
+    // Once untimed, for the same reason as the draw calls
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    GLuint query = 0;
+    glGenQueries(1, &query);
+    glBeginQuery(GL_TIME_ELAPSED, query);
+    for(int i = 0; i < FILL_PROBE_LAYERS; ++i){
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+    }
+    glEndQuery(GL_TIME_ELAPSED);
+    // Waits for the GPU, which is what the probe is for
+    GLuint64 nanoseconds = 0;
+    glGetQueryObjectui64v(query, GL_QUERY_RESULT, &nanoseconds);
+    glDeleteQueries(1, &query);
+    state.Disable(GL_BLEND);
+    if(nanoseconds == 0){
+        return 0.0;
+    }
+    return (double)width * height * FILL_PROBE_LAYERS / (double)nanoseconds;
+}
+
+bool PerformanceTier::Probe(int width, int height){
+    m_level = TIER_HIGH;
+    m_measures = HardwareMeasures();
+    if(width <= 0 || height <= 0){
+        std::cout << "PerformanceTier.cpp: invalid size " << width << "x" << height << "\n";
+        return false;
+    }
+    if(!m_program.LoadFromFiles("./shaders/probe_vert.glsl", "./shaders/probe_frag.glsl")){
+        std::cout << "PerformanceTier.cpp: the probe shaders did not build\n";
+        return false;
+    }
+    m_offsetLocation = m_program.GetUniformLocation("u_Offset");
+    m_sizeLocation = m_program.GetUniformLocation("u_Size");
+    m_colorLocation = m_program.GetUniformLocation("u_Color");
+
+    // A target of its own, so nothing of the probe reaches the window
+    GLuint color = 0;
+    glGenRenderbuffers(1, &color);
+    glBindRenderbuffer(GL_RENDERBUFFER, color);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    GPUResourceTracker::Get().Created(GPU_RENDERBUFFER, color, "probe color", (size_t)width * height * 4);
+    GLuint framebuffer = 0;
+    glGenFramebuffers(1, &framebuffer);
+    GPUResourceTracker::Get().Created(GPU_FRAMEBUFFER, framebuffer, "probe framebuffer");
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+    bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    glGenVertexArrays(1, &m_vao);
+    GPUResourceTracker::Get().Created(GPU_VERTEX_ARRAY, m_vao, "probe vertex array");
+
+    GLStateCache& state = GLStateCache::Get();
+    if(complete){
+        state.Disable(GL_DEPTH_TEST);
+        state.Disable(GL_CULL_FACE);
+        state.Viewport(0, 0, width, height);
+        state.UseProgram(m_program.GetID());
+        state.BindVertexArray(m_vao);
+        m_measures.simStepsPerSecond = ProbeSimulation();
+        m_measures.drawCallMicroseconds = ProbeDrawCalls();
+        m_measures.fillGigapixelsPerSecond = ProbeFillRate(width, height);
+        state.BindVertexArray(0);
+    }else{
+        std::cout << "PerformanceTier.cpp: probe framebuffer incomplete\n";
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteVertexArrays(1, &m_vao);
+    GPUResourceTracker::Get().Deleted(GPU_VERTEX_ARRAY, m_vao);
+    m_vao = 0;
+    glDeleteFramebuffers(1, &framebuffer);
+    GPUResourceTracker::Get().Deleted(GPU_FRAMEBUFFER, framebuffer);
+    glDeleteRenderbuffers(1, &color);
+    GPUResourceTracker::Get().Deleted(GPU_RENDERBUFFER, color);
+    m_program.Release();
+    if(!complete){
+        return false;
+    }
+
+    // The lowest tier any of the measures calls for
+    const HardwareMeasures& m = m_measures;
+    PerformanceTierLevel sim = (m.simStepsPerSecond >= HIGH_SIM_STEPS_PER_SECOND) ? TIER_HIGH :
+                               (m.simStepsPerSecond >= MEDIUM_SIM_STEPS_PER_SECOND) ? TIER_MEDIUM : TIER_LOW;
+    PerformanceTierLevel draws = (m.drawCallMicroseconds <= HIGH_DRAW_CALL_MICROSECONDS) ? TIER_HIGH :
+                                 (m.drawCallMicroseconds <= MEDIUM_DRAW_CALL_MICROSECONDS) ? TIER_MEDIUM : TIER_LOW;
+    PerformanceTierLevel fill = (m.fillGigapixelsPerSecond >= HIGH_FILL_GIGAPIXELS) ? TIER_HIGH :
+                                (m.fillGigapixelsPerSecond >= MEDIUM_FILL_GIGAPIXELS) ? TIER_MEDIUM : TIER_LOW;
+    m_level = std::min(sim, std::min(draws, fill));
+    return true;
+}
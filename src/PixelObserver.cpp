@@ -0,0 +1,292 @@
+#include "PixelObserver.hpp"
+#include "GLBackend.hpp"
+#include "GLStateCache.hpp"
+#include "GPUResourceTracker.hpp"
+
+#include <cstring>
+#include <iostream>
+
+// Texture units the reduction samples the rendered and the previous frame from
+const unsigned int OBSERVE_SCENE_UNIT = 0;
+const unsigned int OBSERVE_PREVIOUS_UNIT = 1;
+
+// Constructor
+PixelObserver::PixelObserver(){
+
+}
+
+// Destructor
+PixelObserver::~PixelObserver(){
+    if(m_framebuffer != 0){
+        std::cout << "PixelObserver.cpp: framebuffer was never released\n";
+    }
+}
+
+GLuint PixelObserver::CreateTarget(GLenum internalFormat, int width, int height, const char* name){
+    GLuint texture = 0;
+    glGenTextures(1, &texture);
+    GLStateCache::Get().BindTexture(OBSERVE_SCENE_UNIT, GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    GLenum format = (internalFormat == GL_R8) ? GL_RED : GL_RGBA;
+    glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, GL_UNSIGNED_BYTE, nullptr);
+    size_t texelBytes = (internalFormat == GL_R8) ? 1 : 4;
+    GPUResourceTracker::Get().Created(GPU_TEXTURE, texture, name, (size_t)width * height * texelBytes);
+    return texture;
+}
+
+bool PixelObserver::Initialize(int width, int height, bool grayscale, int supersample, bool maxPool,
+                               const std::string& vertexPath, const std::string& fragmentPath, unsigned int ringSize){
+    Release();
+    if(width <= 0 || height <= 0 || supersample <= 0){
+        std::cout << "PixelObserver.cpp: invalid size " << width << "x" << height << " supersampled "
+                  << supersample << " times\n";
+        return false;
+    }
+    if(ringSize < 2){
+        ringSize = 2;
+    }
+    if(!m_reduceProgram.LoadFromFiles(vertexPath, fragmentPath)){
+        std::cout << "PixelObserver.cpp: could not build " << vertexPath << " and " << fragmentPath << "\n";
+        return false;
+    }
+    m_sceneLocation = m_reduceProgram.GetUniformLocation("u_Scene");
+    m_previousLocation = m_reduceProgram.GetUniformLocation("u_Previous");
+    m_supersampleLocation = m_reduceProgram.GetUniformLocation("u_Supersample");
+    m_grayscaleLocation = m_reduceProgram.GetUniformLocation("u_Grayscale");
+    m_maxPoolLocation = m_reduceProgram.GetUniformLocation("u_MaxPool");
+    m_width = width;
+    m_height = height;
+    m_grayscale = grayscale;
+    m_supersample = supersample;
+    m_maxPool = maxPool;
+    int renderWidth = GetRenderWidth();
+    int renderHeight = GetRenderHeight();
+
+    m_colorTexture = CreateTarget(GL_RGBA8, renderWidth, renderHeight, "observation color");
+    glGenRenderbuffers(1, &m_depthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_depthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, renderWidth, renderHeight);
+    GPUResourceTracker::Get().Created(GPU_RENDERBUFFER, m_depthBuffer, "observation depth",
+                                      (size_t)renderWidth * renderHeight * 4);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &m_framebuffer);
+    GPUResourceTracker::Get().Created(GPU_FRAMEBUFFER, m_framebuffer, "observation framebuffer");
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_colorTexture, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_depthBuffer);
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+
+    // The reduced frame, and the two unpooled ones max pooling alternates
+    // between, each with a framebuffer of its own
+    GLenum reducedFormat = grayscale ? GL_R8 : GL_RGBA8;
+    m_reducedTexture = CreateTarget(reducedFormat, width, height, "observation reduced");
+    for(int i = 0; i < (maxPool ? 2 : 1) && status == GL_FRAMEBUFFER_COMPLETE; ++i){
+        glGenFramebuffers(1, &m_reduceFramebuffers[i]);
+        GPUResourceTracker::Get().Created(GPU_FRAMEBUFFER, m_reduceFramebuffers[i], "observation reduction");
+        glBindFramebuffer(GL_FRAMEBUFFER, m_reduceFramebuffers[i]);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_reducedTexture, 0);
+        if(maxPool){
+            m_historyTextures[i] = CreateTarget(reducedFormat, width, height, "observation history");
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, m_historyTextures[i], 0);
+            const GLenum drawBuffers[2] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1};
+            glDrawBuffers(2, drawBuffers);
+            // The first frame is pooled with black, which changes nothing
+            const GLfloat black[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+            glClearBufferfv(GL_COLOR, 1, black);
+        }
+        status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if(status != GL_FRAMEBUFFER_COMPLETE){
+        std::cout << "PixelObserver.cpp: framebuffer incomplete (0x" << std::hex << status << std::dec << ")\n";
+        Release();
+        return false;
+    }
+    m_vao = GLBackend::Get().CreateVertexArray();
+    GPUResourceTracker::Get().Created(GPU_VERTEX_ARRAY, m_vao, "observation vertex array");
+
+    // Reduced rows are read back tightly packed, so only their own bytes
+    size_t bytes = GetReadbackBytes();
+    m_slots.resize(ringSize);
+    for(Slot& slot : m_slots){
+        glGenBuffers(1, &slot.buffer);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+        glBufferData(GL_PIXEL_PACK_BUFFER, bytes, nullptr, GL_STREAM_READ);
+        GPUResourceTracker::Get().Created(GPU_BUFFER, slot.buffer, "observation readback", bytes);
+        slot.fence = nullptr;
+        slot.frame = -1;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    m_latest.assign((size_t)width * height * GetChannels(), 0);
+    m_latestFrame = -1;
+    m_nextSlot = 0;
+    m_history = 0;
+    m_frame = 0;
+    m_readbacks = 0;
+    m_stalls = 0;
+    return true;
+}
+
+void PixelObserver::Bind() const{
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+    GLStateCache::Get().Viewport(0, 0, GetRenderWidth(), GetRenderHeight());
+}
+
+void PixelObserver::Reduce(){
+    GLStateCache& state = GLStateCache::Get();
+    glBindFramebuffer(GL_FRAMEBUFFER, m_reduceFramebuffers[m_history]);
+    state.Viewport(0, 0, m_width, m_height);
+    // Every texel is written, nothing is tested or blended
+    state.Disable(GL_DEPTH_TEST);
+    state.Disable(GL_BLEND);
+    m_reduceProgram.Use();
+    state.BindTexture(OBSERVE_SCENE_UNIT, GL_TEXTURE_2D, m_colorTexture);
+    glUniform1i(m_sceneLocation, OBSERVE_SCENE_UNIT);
+    if(m_maxPool){
+        state.BindTexture(OBSERVE_PREVIOUS_UNIT, GL_TEXTURE_2D, m_historyTextures[1 - m_history]);
+        glUniform1i(m_previousLocation, OBSERVE_PREVIOUS_UNIT);
+    }
+    glUniform1i(m_supersampleLocation, m_supersample);
+    glUniform1i(m_grayscaleLocation, m_grayscale ? 1 : 0);
+    glUniform1i(m_maxPoolLocation, m_maxPool ? 1 : 0);
+    state.BindVertexArray(m_vao);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    state.Enable(GL_DEPTH_TEST);
+    if(m_maxPool){
+        m_history = 1 - m_history;
+    }
+}
+
+void PixelObserver::Capture(){
+    // Pick up every readback that has finished in the meantime, oldest first
+    for(size_t i = 0; i < m_slots.size(); ++i){
+        Slot& slot = m_slots[(m_nextSlot + i) % m_slots.size()];
+        // Fences signal in order, so the rest are not done either
+        if(slot.fence != nullptr && !Collect(slot, false)){
+            break;
+        }
+    }
+    // The slot to reuse holds the oldest readback; if the GPU is that far
+    // behind there is nothing for it but to wait.
+    Slot& slot = m_slots[m_nextSlot];
+    if(slot.fence != nullptr){
+        ++m_stalls;
+        if(!Collect(slot, true)){
+            // Lost after a second of waiting, drop it
+            glDeleteSync(slot.fence);
+            slot.fence = nullptr;
+        }
+    }
+
+    // Every reduction framebuffer has the reduced target first
+    Reduce();
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_reduceFramebuffers[0]);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    // With a pack buffer bound this only queues a copy on the GPU. Single
+    // byte rows of any width are packed without padding.
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, m_width, m_height, m_grayscale ? GL_RED : GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.frame = m_frame++;
+    m_nextSlot = (m_nextSlot + 1) % m_slots.size();
+}
+
+bool PixelObserver::Collect(Slot& slot, bool wait){
+    GLenum result = glClientWaitSync(slot.fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0,
+                                     wait ? (GLuint64)1000000000 : 0);
+    if(result == GL_TIMEOUT_EXPIRED || result == GL_WAIT_FAILED){
+        return false;
+    }
+    glDeleteSync(slot.fence);
+    slot.fence = nullptr;
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    const uint8_t* pixels = (const uint8_t*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0,
+                                                             (GLsizeiptr)GetReadbackBytes(), GL_MAP_READ_BIT);
+    if(pixels != nullptr){
+        // A frame older than the newest one collected is not worth copying
+        if(slot.frame > m_latestFrame){
+            size_t count = (size_t)m_width * m_height;
+            if(m_grayscale){
+                // Already converted on the GPU
+                std::memcpy(m_latest.data(), pixels, count);
+            }else{
+                for(size_t i = 0; i < count; ++i){
+                    m_latest[i*3 + 0] = pixels[i*4 + 0];
+                    m_latest[i*3 + 1] = pixels[i*4 + 1];
+                    m_latest[i*3 + 2] = pixels[i*4 + 2];
+                }
+            }
+            m_latestFrame = slot.frame;
+            ++m_readbacks;
+        }
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    return true;
+}
+
+void PixelObserver::BlitToWindow(int windowWidth, int windowHeight) const{
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_framebuffer);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    // Nearest filtering shows the pixels the observation is averaged from.
+    // A single channel target would blit as shades of red, so this is the
+    // rendered frame.
+    glBlitFramebuffer(0, 0, GetRenderWidth(), GetRenderHeight(), 0, 0, windowWidth, windowHeight,
+                      GL_COLOR_BUFFER_BIT, GL_NEAREST);
+}
+
+void PixelObserver::Unbind() const{
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void PixelObserver::Release(){
+    for(Slot& slot : m_slots){
+        if(slot.fence != nullptr){
+            glDeleteSync(slot.fence);
+        }
+        glDeleteBuffers(1, &slot.buffer);
+        GPUResourceTracker::Get().Deleted(GPU_BUFFER, slot.buffer);
+    }
+    m_slots.clear();
+    if(m_framebuffer != 0){
+        glDeleteFramebuffers(1, &m_framebuffer);
+        GPUResourceTracker::Get().Deleted(GPU_FRAMEBUFFER, m_framebuffer);
+        m_framebuffer = 0;
+    }
+    for(GLuint& framebuffer : m_reduceFramebuffers){
+        if(framebuffer != 0){
+            glDeleteFramebuffers(1, &framebuffer);
+            GPUResourceTracker::Get().Deleted(GPU_FRAMEBUFFER, framebuffer);
+            framebuffer = 0;
+        }
+    }
+    GLuint* textures[4] = {&m_colorTexture, &m_reducedTexture, &m_historyTextures[0], &m_historyTextures[1]};
+    for(GLuint* texture : textures){
+        if(*texture != 0){
+            glDeleteTextures(1, texture);
+            GPUResourceTracker::Get().Deleted(GPU_TEXTURE, *texture);
+            *texture = 0;
+            GLStateCache::Get().Invalidate();
+        }
+    }
+    if(m_vao != 0){
+        glDeleteVertexArrays(1, &m_vao);
+        GPUResourceTracker::Get().Deleted(GPU_VERTEX_ARRAY, m_vao);
+        m_vao = 0;
+    }
+    m_reduceProgram.Release();
+    if(m_depthBuffer != 0){
+        glDeleteRenderbuffers(1, &m_depthBuffer);
+        GPUResourceTracker::Get().Deleted(GPU_RENDERBUFFER, m_depthBuffer);
+        m_depthBuffer = 0;
+    }
+}
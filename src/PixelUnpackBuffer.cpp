@@ -0,0 +1,65 @@
+#include "PixelUnpackBuffer.hpp"
+#include "GLBackend.hpp"
+#include "GPUResourceTracker.hpp"
+
+#include <iostream>
+
+// Constructor
+PixelUnpackBuffer::PixelUnpackBuffer(){
+
+}
+
+// Destructor
+PixelUnpackBuffer::~PixelUnpackBuffer(){
+
+}
+
+uint8_t* PixelUnpackBuffer::Map(size_t bytes){
+    if(m_mapped != nullptr){
+        Unmap();
+    }
+    GLBackend& backend = GLBackend::Get();
+    if(m_buffer == 0){
+        m_buffer = backend.CreateBuffer();
+        GPUResourceTracker::Get().Created(GPU_BUFFER, m_buffer, "pixel unpack buffer");
+    }
+    // Fresh storage every time, so an upload still reading the old
+    // contents never makes the map wait
+    backend.BufferData(m_buffer, bytes, nullptr, GL_STREAM_DRAW);
+    m_size = bytes;
+    GPUResourceTracker::Get().Resized(GPU_BUFFER, m_buffer, bytes);
+    m_mapped = (uint8_t*)backend.MapBufferRange(m_buffer, 0, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if(m_mapped == nullptr){
+        std::cout << "PixelUnpackBuffer.cpp: could not map " << bytes << " bytes\n";
+    }
+    return m_mapped;
+}
+
+bool PixelUnpackBuffer::Unmap(){
+    if(m_mapped == nullptr){
+        return false;
+    }
+    bool intact = GLBackend::Get().UnmapBuffer(m_buffer);
+    m_mapped = nullptr;
+    return intact;
+}
+
+void PixelUnpackBuffer::Bind() const{
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_buffer);
+}
+
+void PixelUnpackBuffer::Unbind(){
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+void PixelUnpackBuffer::Release(){
+    if(m_mapped != nullptr){
+        Unmap();
+    }
+    if(m_buffer != 0){
+        glDeleteBuffers(1, &m_buffer);
+        GPUResourceTracker::Get().Deleted(GPU_BUFFER, m_buffer);
+        m_buffer = 0;
+    }
+    m_size = 0;
+}
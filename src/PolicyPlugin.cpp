@@ -0,0 +1,116 @@
+#include "PolicyPlugin.hpp"
+
+#if defined(MINGW) || defined(_WIN32)
+    #ifndef WIN32_LEAN_AND_MEAN
+    #define WIN32_LEAN_AND_MEAN 1
+    #endif
+    #include <windows.h>
+#else
+    #include <dlfcn.h>
+#endif
+
+#include <iostream>
+
+// The library at path, nullptr if it does not load
+static void* OpenLibrary(const std::string& path){
+#if defined(MINGW) || defined(_WIN32)
+    return (void*)LoadLibraryA(path.c_str());
+#else
+    void* library = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if(library == nullptr){
+        std::cout << "PolicyPlugin.cpp: " << dlerror() << "\n";
+    }
+    return library;
+#endif
+}
+
+static void* FindSymbol(void* library, const char* name){
+#if defined(MINGW) || defined(_WIN32)
+    return (void*)GetProcAddress((HMODULE)library, name);
+#else
+    return dlsym(library, name);
+#endif
+}
+
+static void CloseLibrary(void* library){
+#if defined(MINGW) || defined(_WIN32)
+    FreeLibrary((HMODULE)library);
+#else
+    dlclose(library);
+#endif
+}
+
+// Constructor
+PolicyPlugin::PolicyPlugin(){
+
+}
+
+// Destructor
+PolicyPlugin::~PolicyPlugin(){
+    Unload();
+}
+
+bool PolicyPlugin::Load(const std::string& path, const std::string& options, uint32_t rowSize){
+    Unload();
+    m_library = OpenLibrary(path);
+    if(m_library == nullptr){
+        std::cout << "PolicyPlugin.cpp: could not load " << path << "\n";
+        return false;
+    }
+    DinoPolicyAbiFunction abi = (DinoPolicyAbiFunction)FindSymbol(m_library, "dino_policy_abi");
+    DinoPolicyCreateFunction create = (DinoPolicyCreateFunction)FindSymbol(m_library, "dino_policy_create");
+    m_act = (DinoPolicyActFunction)FindSymbol(m_library, "dino_policy_act");
+    m_destroy = (DinoPolicyDestroyFunction)FindSymbol(m_library, "dino_policy_destroy");
+    if(abi == nullptr || create == nullptr || m_act == nullptr || m_destroy == nullptr){
+        std::cout << "PolicyPlugin.cpp: " << path << " does not export the dino_policy_ functions\n";
+        Unload();
+        return false;
+    }
+    if(abi() != DINO_POLICY_ABI){
+        std::cout << "PolicyPlugin.cpp: " << path << " is built for policy ABI " << abi()
+                  << ", expected " << DINO_POLICY_ABI << "\n";
+        Unload();
+        return false;
+    }
+    m_policy = create(options.c_str(), rowSize);
+    if(m_policy == nullptr){
+        std::cout << "PolicyPlugin.cpp: " << path << " could not create a policy for rows of "
+                  << rowSize << " floats with options '" << options << "'\n";
+        Unload();
+        return false;
+    }
+    m_rowSize = rowSize;
+    return true;
+}
+
+bool PolicyPlugin::LoadSpec(const std::string& spec, uint32_t rowSize){
+    size_t colon = spec.find(':');
+    if(colon == std::string::npos){
+        return Load(spec, "", rowSize);
+    }
+    return Load(spec.substr(0, colon), spec.substr(colon + 1), rowSize);
+}
+
+void PolicyPlugin::Unload(){
+    if(m_policy != nullptr){
+        m_destroy(m_policy);
+        m_policy = nullptr;
+    }
+    if(m_library != nullptr){
+        CloseLibrary(m_library);
+        m_library = nullptr;
+    }
+    m_act = nullptr;
+    m_destroy = nullptr;
+    m_rowSize = 0;
+}
+
+bool PolicyPlugin::Act(const float* rows, uint32_t rowCount, uint8_t* jumps){
+    if(m_policy == nullptr){
+        return false;
+    }
+    if(rowCount == 0){
+        return true;
+    }
+    return m_act(m_policy, rows, rowCount, m_rowSize, jumps) == 0;
+}
@@ -0,0 +1,150 @@
+#include "ProgramCache.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+// Mixes bytes into an FNV-1a hash
+static void HashBytes(uint64_t& hash, const char* bytes, size_t size){
+    for(size_t i = 0; i < size; ++i){
+        hash ^= (uint8_t)bytes[i];
+        hash *= 1099511628211ULL;
+    }
+}
+
+static std::string GetString(GLenum name){
+    const GLubyte* value = glGetString(name);
+    return (value != nullptr) ? std::string(reinterpret_cast<const char*>(value)) : std::string();
+}
+
+ProgramCache& ProgramCache::Get(){
+    static ProgramCache cache;
+    return cache;
+}
+
+// Constructor
+ProgramCache::ProgramCache(){
+
+}
+
+// Destructor
+ProgramCache::~ProgramCache(){
+
+}
+
+void ProgramCache::Initialize(){
+    m_enabled = false;
+    if(m_directory.empty() || !GLAD_GL_ARB_get_program_binary){
+        return;
+    }
+    // Some drivers have the extension but no format to save in
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    if(formats <= 0){
+        return;
+    }
+    std::error_code error;
+    std::filesystem::create_directories(m_directory, error);
+    if(error){
+        std::cout << "ProgramCache.cpp: could not create " << m_directory << ", shaders are not cached\n";
+        return;
+    }
+    m_driver = GetString(GL_VENDOR) + '\n' + GetString(GL_RENDERER) + '\n' + GetString(GL_VERSION);
+    m_enabled = true;
+}
+
+uint64_t ProgramCache::GetKey(const std::string& vertexSource, const std::string& fragmentSource) const{
+    uint64_t hash = 14695981039346656037ULL;
+    // Sizes first, so moving text from one stage to the other changes it
+    uint64_t sizes[2] = {vertexSource.size(), fragmentSource.size()};
+    HashBytes(hash, reinterpret_cast<const char*>(sizes), sizeof(sizes));
+    HashBytes(hash, vertexSource.data(), vertexSource.size());
+    HashBytes(hash, fragmentSource.data(), fragmentSource.size());
+    HashBytes(hash, m_driver.data(), m_driver.size());
+    return hash;
+}
+
+std::string ProgramCache::GetPath(uint64_t key) const{
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.glbin", (unsigned long long)key);
+    return m_directory + "/" + name;
+}
+
+bool ProgramCache::Load(uint64_t key, GLuint program){
+    if(!m_enabled){
+        return false;
+    }
+    std::ifstream file(GetPath(key).c_str(), std::ios::binary);
+    if(!file.is_open()){
+        return false;
+    }
+    ProgramCacheHeader header;
+    if(!file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+       memcmp(header.magic, "DPRG", 4) != 0 || header.version != PROGRAM_CACHE_VERSION || header.key != key){
+        return false;
+    }
+    std::vector<char> binary(header.binaryBytes);
+    if(!file.read(binary.data(), binary.size())){
+        return false;
+    }
+    glProgramBinary(program, header.binaryFormat, binary.data(), (GLsizei)binary.size());
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if(linked == GL_FALSE){
+        std::cout << "ProgramCache.cpp: the driver rejected the cached program " << GetPath(key) << ", compiling it\n";
+        return false;
+    }
+    ++m_hits;
+    return true;
+}
+
+bool ProgramCache::Store(uint64_t key, GLuint program){
+    if(!m_enabled){
+        return false;
+    }
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if(length <= 0){
+        return false;
+    }
+    std::vector<char> binary(length);
+    GLsizei written = 0;
+    GLenum format = 0;
+    glGetProgramBinary(program, length, &written, &format, binary.data());
+    if(written <= 0){
+        return false;
+    }
+
+    ProgramCacheHeader header;
+    memcpy(header.magic, "DPRG", 4);
+    header.version = PROGRAM_CACHE_VERSION;
+    header.key = key;
+    header.binaryFormat = format;
+    header.binaryBytes = (uint32_t)written;
+
+    std::string path = GetPath(key);
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream out(temporary.c_str(), std::ios::binary | std::ios::trunc);
+        if(!out.is_open()){
+            std::cout << "ProgramCache.cpp: could not write " << temporary << "\n";
+            return false;
+        }
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(binary.data(), written);
+        if(!out.good()){
+            return false;
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(temporary, path, error);
+    if(error){
+        std::filesystem::remove(temporary, error);
+        return false;
+    }
+    ++m_stores;
+    return true;
+}
@@ -0,0 +1,79 @@
+#include "RenderQueue.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+// value clamped to bits and moved up by shift
+static inline uint64_t PackField(uint32_t value, int bits, int shift){
+    uint64_t largest = (1ull << bits) - 1ull;
+    return std::min<uint64_t>(value, largest) << shift;
+}
+
+uint64_t MakeSortKey(uint32_t pass, uint32_t program, uint32_t material, uint32_t mesh,
+                     float depth, bool backToFront){
+    // A non-negative float's bits order like the float, so the top
+    // depth bits of them order by distance at any scale
+    uint32_t depthBits = 0;
+    if(depth > 0.0f){
+        std::memcpy(&depthBits, &depth, sizeof(depthBits));
+        depthBits >>= 31 - SORT_DEPTH_BITS;
+    }
+    if(backToFront){
+        depthBits = ((1u << SORT_DEPTH_BITS) - 1u) - depthBits;
+    }
+    int shift = 64;
+    uint64_t key = 0;
+    key |= PackField(pass, SORT_PASS_BITS, shift -= SORT_PASS_BITS);
+    key |= PackField(program, SORT_PROGRAM_BITS, shift -= SORT_PROGRAM_BITS);
+    key |= PackField(material, SORT_MATERIAL_BITS, shift -= SORT_MATERIAL_BITS);
+    key |= PackField(mesh, SORT_MESH_BITS, shift -= SORT_MESH_BITS);
+    key |= PackField(depthBits, SORT_DEPTH_BITS, shift -= SORT_DEPTH_BITS);
+    return key;
+}
+
+// Constructor
+RenderQueue::RenderQueue(){
+
+}
+
+// Destructor
+RenderQueue::~RenderQueue(){
+
+}
+
+void RenderQueue::Reserve(size_t count){
+    m_items.reserve(count);
+    m_scratch.reserve(count);
+}
+
+void RenderQueue::Begin(){
+    m_items.clear();
+}
+
+void RenderQueue::Sort(){
+    const size_t count = m_items.size();
+    if(count < 2){
+        return;
+    }
+    m_scratch.resize(count);
+    for(int shift = 0; shift < 64; shift += 8){
+        size_t offsets[256] = {};
+        for(const RenderItem& item : m_items){
+            ++offsets[(item.key >> shift) & 0xFF];
+        }
+        // Every key has the same byte here: this round would not move anything
+        if(offsets[(m_items[0].key >> shift) & 0xFF] == count){
+            continue;
+        }
+        size_t start = 0;
+        for(size_t& offset : offsets){
+            size_t bucket = offset;
+            offset = start;
+            start += bucket;
+        }
+        for(const RenderItem& item : m_items){
+            m_scratch[offsets[(item.key >> shift) & 0xFF]++] = item;
+        }
+        m_items.swap(m_scratch);
+    }
+}
@@ -0,0 +1,142 @@
+#include "RenderWorkers.hpp"
+#include "GPUResourceTracker.hpp"
+
+#include <iostream>
+
+// Constructor
+RenderWorkers::RenderWorkers(){
+
+}
+
+// Destructor
+RenderWorkers::~RenderWorkers(){
+    Stop();
+}
+
+bool RenderWorkers::Start(size_t workers, size_t first, size_t count, int width, int height, bool grayscale,
+                          const std::string& vertexPath, const std::string& fragmentPath,
+                          const MeshRegistry& registry, MeshHandle mesh, const ContextFunction& makeCurrent){
+    Stop();
+    if(workers == 0 || count < workers){
+        std::cout << "RenderWorkers.cpp: " << count << " environments cannot be shared by " << workers << " workers\n";
+        return false;
+    }
+    m_makeCurrent = makeCurrent;
+    m_registry = &registry;
+    m_mesh = mesh;
+    m_width = width;
+    m_height = height;
+    m_grayscale = grayscale;
+    m_vertexPath = vertexPath;
+    m_fragmentPath = fragmentPath;
+    m_frame = 0;
+    m_pending = 0;
+    // Whatever the main context uploaded has to be done before another
+    // context draws it
+    glFinish();
+
+    for(size_t i = 0; i < workers; ++i){
+        std::unique_ptr<Worker> worker(new Worker());
+        worker->first = first + count * i / workers;
+        worker->count = first + count * (i + 1) / workers - worker->first;
+        m_workers.push_back(std::move(worker));
+        Worker& started = *m_workers.back();
+        started.thread = std::thread(&RenderWorkers::WorkerMain, this, &started, i);
+        // One at a time: setting up builds shaders and reports GL objects
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_done.wait(lock, [&started]{ return started.started; });
+        if(!started.ready){
+            lock.unlock();
+            std::cout << "RenderWorkers.cpp: render worker " << i << " could not set up\n";
+            Stop();
+            return false;
+        }
+    }
+    return true;
+}
+
+void RenderWorkers::Stop(){
+    // One at a time again, each releasing what it made
+    for(std::unique_ptr<Worker>& worker : m_workers){
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            worker->stop = true;
+        }
+        m_wake.notify_all();
+        if(worker->thread.joinable()){
+            worker->thread.join();
+        }
+    }
+    m_workers.clear();
+}
+
+void RenderWorkers::Render(const GameStateBatch& environments, const AtlasScene& scene, const TextureArray& textures){
+    if(m_workers.empty()){
+        return;
+    }
+    // Submits the main context's commands, so streamed textures and the
+    // like reach the other contexts
+    glFlush();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_environments = &environments;
+        m_scene = scene;
+        m_textures = &textures;
+        m_pending = m_workers.size();
+        ++m_frame;
+    }
+    m_wake.notify_all();
+}
+
+void RenderWorkers::Wait(){
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this]{ return m_pending == 0; });
+}
+
+void RenderWorkers::WorkerMain(Worker* self, size_t index){
+    Worker& worker = *self;
+    // Its vertex arrays and framebuffers are the worker context's names
+    GPUResourceTracker::SetContext((unsigned int)index + 1);
+    bool current = m_makeCurrent(index, true);
+    bool ready = current;
+    if(ready){
+        worker.mesh = worker.registry.Adopt(*m_registry, m_mesh);
+        ready = worker.mesh != INVALID_MESH &&
+                worker.observer.Initialize(worker.count, m_width, m_height, m_grayscale, m_vertexPath, m_fragmentPath);
+    }
+    uint64_t frame = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        worker.started = true;
+        worker.ready = ready;
+        frame = m_frame;
+    }
+    m_done.notify_all();
+
+    for(;;){
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [this, &worker, frame]{ return worker.stop || m_frame != frame; });
+            if(worker.stop){
+                break;
+            }
+            frame = m_frame;
+        }
+        if(ready){
+            worker.observer.Render(*m_environments, m_scene, worker.registry, worker.mesh, *m_textures, worker.first);
+            // The readback has to reach the GPU before anyone waits on it
+            glFlush();
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            --m_pending;
+        }
+        m_done.notify_all();
+    }
+
+    if(current){
+        worker.observer.Release();
+        worker.registry.Release();
+        m_makeCurrent(index, false);
+    }
+}
@@ -0,0 +1,142 @@
+#include "ResidencyManager.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+static const double BYTES_PER_MEGABYTE = 1024.0 * 1024.0;
+
+// Constructor
+ResidencyManager::ResidencyManager(){
+
+}
+
+// Destructor
+ResidencyManager::~ResidencyManager(){
+
+}
+
+ResidencyId ResidencyManager::Register(const std::string& name, ResidencyEvict evict){
+    ResidencyId id;
+    if(!m_free.empty()){
+        id = m_free.back();
+        m_free.pop_back();
+    }else{
+        id = (ResidencyId)m_resources.size();
+        m_resources.push_back(Resource());
+    }
+    Resource& resource = m_resources[id];
+    resource = Resource();
+    resource.name = name;
+    resource.evict = std::move(evict);
+    resource.lastUsed = m_frame;
+    resource.registered = true;
+    return id;
+}
+
+void ResidencyManager::Unregister(ResidencyId id){
+    if(id >= m_resources.size() || !m_resources[id].registered){
+        return;
+    }
+    Resource& resource = m_resources[id];
+    if(resource.state == RESIDENCY_RESIDENT){
+        m_residentBytes -= resource.bytes;
+    }
+    resource = Resource();
+    m_free.push_back(id);
+}
+
+void ResidencyManager::SetStreaming(ResidencyId id){
+    if(id >= m_resources.size() || !m_resources[id].registered){
+        return;
+    }
+    Resource& resource = m_resources[id];
+    if(resource.state == RESIDENCY_RESIDENT){
+        m_residentBytes -= resource.bytes;
+        resource.bytes = 0;
+    }
+    if(resource.evicted && resource.state == RESIDENCY_EVICTED){
+        ++m_restreams;
+    }
+    resource.state = RESIDENCY_STREAMING;
+}
+
+void ResidencyManager::SetResident(ResidencyId id, size_t bytes){
+    if(id >= m_resources.size() || !m_resources[id].registered){
+        return;
+    }
+    Resource& resource = m_resources[id];
+    if(resource.state == RESIDENCY_RESIDENT){
+        m_residentBytes -= resource.bytes;
+    }
+    resource.bytes = bytes;
+    resource.state = RESIDENCY_RESIDENT;
+    m_residentBytes += bytes;
+}
+
+void ResidencyManager::Touch(ResidencyId id){
+    if(id < m_resources.size()){
+        m_resources[id].lastUsed = m_frame;
+    }
+}
+
+ResidencyState ResidencyManager::GetState(ResidencyId id) const{
+    if(id >= m_resources.size()){
+        return RESIDENCY_EVICTED;
+    }
+    return m_resources[id].state;
+}
+
+size_t ResidencyManager::EndFrame(size_t totalBytes){
+    size_t evictedBytes = 0;
+    if(m_budget > 0 && totalBytes > m_budget){
+        m_candidates.clear();
+        for(ResidencyId id = 0; id < (ResidencyId)m_resources.size(); ++id){
+            const Resource& resource = m_resources[id];
+            if(resource.registered && resource.state == RESIDENCY_RESIDENT && resource.lastUsed < m_frame){
+                m_candidates.push_back(id);
+            }
+        }
+        // Least recently used first
+        std::sort(m_candidates.begin(), m_candidates.end(), [this](ResidencyId a, ResidencyId b){
+            return m_resources[a].lastUsed < m_resources[b].lastUsed;
+        });
+        for(size_t i = 0; i < m_candidates.size() && totalBytes - evictedBytes > m_budget; ++i){
+            Resource& resource = m_resources[m_candidates[i]];
+            if(resource.evict){
+                resource.evict();
+            }
+            evictedBytes += resource.bytes;
+            m_residentBytes -= resource.bytes;
+            resource.bytes = 0;
+            resource.state = RESIDENCY_EVICTED;
+            resource.evicted = true;
+            ++m_evictions;
+        }
+        if(totalBytes - evictedBytes > m_budget && !m_reportedOver){
+            std::cout << "ResidencyManager.cpp: what frame " << m_frame << " uses takes "
+                      << (double)(totalBytes - evictedBytes) / BYTES_PER_MEGABYTE << " MB, over the budget of "
+                      << (double)m_budget / BYTES_PER_MEGABYTE << " MB\n";
+            m_reportedOver = true;
+        }
+    }
+    ++m_frame;
+    return evictedBytes;
+}
+
+void ResidencyManager::Report() const{
+    std::cout << "Residency: budget ";
+    if(m_budget > 0){
+        std::cout << (double)m_budget / BYTES_PER_MEGABYTE << " MB";
+    }else{
+        std::cout << "none";
+    }
+    std::cout << ", " << (double)m_residentBytes / BYTES_PER_MEGABYTE << " MB resident, "
+              << m_evictions << " evictions, " << m_restreams << " restreams\n";
+    static const char* STATE_NAMES[] = {"evicted", "streaming", "resident"};
+    for(const Resource& resource : m_resources){
+        if(resource.registered){
+            std::cout << "  " << resource.name << ": " << STATE_NAMES[resource.state]
+                      << ", " << resource.bytes << " bytes, last used in frame " << resource.lastUsed << "\n";
+        }
+    }
+}
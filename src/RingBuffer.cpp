@@ -0,0 +1,120 @@
+#include "RingBuffer.hpp"
+#include "GLBackend.hpp"
+#include "GPUResourceTracker.hpp"
+
+#include <cstring>
+#include <iostream>
+
+// Constructor
+RingBuffer::RingBuffer(){
+
+}
+
+// Destructor
+RingBuffer::~RingBuffer(){
+    if(m_buffer != 0){
+        std::cout << "RingBuffer.cpp: buffer was never released\n";
+    }
+}
+
+bool RingBuffer::Initialize(size_t regionSize, unsigned int regionCount){
+    Release();
+    if(regionCount == 0){
+        regionCount = 1;
+    }
+    m_regionSize = regionSize;
+    m_regionCount = regionCount;
+    // The first BeginRegion() wraps around to region 0
+    m_region = regionCount - 1;
+    m_writeOffset = 0;
+    m_fences.assign(regionCount, nullptr);
+
+    size_t totalSize = regionSize * regionCount;
+    GLBackend& backend = GLBackend::Get();
+    m_buffer = backend.CreateBuffer();
+    GPUResourceTracker::Get().Created(GPU_BUFFER, m_buffer, "stream ring", totalSize);
+
+    m_persistent = GLAD_GL_ARB_buffer_storage != 0;
+    if(m_persistent){
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        backend.BufferStorage(m_buffer, totalSize, nullptr, flags);
+        m_mapped = (char*)backend.MapBufferRange(m_buffer, 0, totalSize, flags);
+        if(m_mapped == nullptr){
+            std::cout << "RingBuffer.cpp: could not map the ring buffer\n";
+            Release();
+            return false;
+        }
+    }else{
+        backend.BufferData(m_buffer, totalSize, nullptr, GL_STREAM_DRAW);
+    }
+    return true;
+}
+
+void RingBuffer::BeginRegion(){
+    if(m_buffer == 0){
+        return;
+    }
+    m_region = (m_region + 1) % m_regionCount;
+    m_writeOffset = 0;
+
+    if(m_persistent){
+        GLsync fence = m_fences[m_region];
+        if(fence != nullptr){
+            // Only blocks if the GPU is a full ring behind
+            while(glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED){
+            }
+            glDeleteSync(fence);
+            m_fences[m_region] = nullptr;
+        }
+    }else if(m_region == 0){
+        // Orphan the storage; draws still in flight keep the old copy
+        GLBackend::Get().BufferData(m_buffer, m_regionSize * m_regionCount, nullptr, GL_STREAM_DRAW);
+    }
+}
+
+size_t RingBuffer::Write(const void* data, size_t bytes, size_t alignment){
+    if(m_buffer == 0){
+        return RING_BUFFER_FULL;
+    }
+    size_t start = (m_writeOffset + alignment - 1) / alignment * alignment;
+    if(start + bytes > m_regionSize){
+        return RING_BUFFER_FULL;
+    }
+    size_t offset = m_region * m_regionSize + start;
+    if(m_persistent){
+        memcpy(m_mapped + offset, data, bytes);
+    }else{
+        GLBackend::Get().BufferSubData(m_buffer, offset, bytes, data);
+    }
+    m_writeOffset = start + bytes;
+    return offset;
+}
+
+void RingBuffer::EndRegion(){
+    if(m_persistent && m_buffer != 0 && m_fences[m_region] == nullptr){
+        m_fences[m_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+}
+
+void RingBuffer::Release(){
+    for(GLsync& fence : m_fences){
+        if(fence != nullptr){
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+    }
+    m_fences.clear();
+    if(m_buffer != 0){
+        if(m_mapped != nullptr){
+            GLBackend::Get().UnmapBuffer(m_buffer);
+        }
+        glDeleteBuffers(1, &m_buffer);
+        GPUResourceTracker::Get().Deleted(GPU_BUFFER, m_buffer);
+        m_buffer = 0;
+    }
+    m_mapped = nullptr;
+    m_persistent = false;
+    m_regionSize = 0;
+    m_regionCount = 0;
+    m_writeOffset = 0;
+}
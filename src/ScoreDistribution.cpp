@@ -0,0 +1,111 @@
+#include "ScoreDistribution.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+
+// Constructor
+ScoreDistribution::ScoreDistribution(){
+
+}
+
+// Destructor
+ScoreDistribution::~ScoreDistribution(){
+
+}
+
+void ScoreDistribution::Merge(const ScoreDistribution& other){
+    m_scores.insert(m_scores.end(), other.m_scores.begin(), other.m_scores.end());
+    m_sorted = m_scores.empty();
+}
+
+void ScoreDistribution::Sort(){
+    if(!m_sorted){
+        std::sort(m_scores.begin(), m_scores.end());
+        m_sorted = true;
+    }
+}
+
+ScoreSummary ScoreDistribution::Summarize(){
+    ScoreSummary summary;
+    if(m_scores.empty()){
+        return summary;
+    }
+    Sort();
+    size_t count = m_scores.size();
+    double sum = 0.0;
+    for(int score : m_scores){
+        sum += score;
+    }
+    double mean = sum / (double)count;
+    double squares = 0.0;
+    for(int score : m_scores){
+        squares += (score - mean) * (score - mean);
+    }
+    // Nearest rank
+    auto percentile = [this, count](double p){
+        size_t rank = (size_t)std::ceil(p * (double)count);
+        return m_scores[(rank > 0) ? rank - 1 : 0];
+    };
+    summary.count = count;
+    summary.mean = mean;
+    summary.deviation = std::sqrt(squares / (double)count);
+    summary.min = m_scores.front();
+    summary.p10 = percentile(0.10);
+    summary.p50 = percentile(0.50);
+    summary.p90 = percentile(0.90);
+    summary.p99 = percentile(0.99);
+    summary.max = m_scores.back();
+    return summary;
+}
+
+bool ScoreDistribution::WriteJson(const std::string& filepath, int bucketWidth, const std::string& note){
+    std::ofstream file(filepath.c_str(), std::ios::trunc);
+    if(!file.is_open()){
+        std::cout << "ScoreDistribution.cpp: could not open " << filepath << "\n";
+        return false;
+    }
+    if(bucketWidth < 1){
+        bucketWidth = 1;
+    }
+    ScoreSummary summary = Summarize();
+    std::string escaped;
+    for(char c : note){
+        if(c == '"' || c == '\\'){
+            escaped += '\\';
+        }
+        escaped += c;
+    }
+    file.precision(10);
+    file << "{\n";
+    file << "  \"note\": \"" << escaped << "\",\n";
+    file << "  \"episodes\": " << summary.count << ",\n";
+    file << "  \"mean\": " << summary.mean << ",\n";
+    file << "  \"deviation\": " << summary.deviation << ",\n";
+    file << "  \"min\": " << summary.min << ",\n";
+    file << "  \"p10\": " << summary.p10 << ",\n";
+    file << "  \"p50\": " << summary.p50 << ",\n";
+    file << "  \"p90\": " << summary.p90 << ",\n";
+    file << "  \"p99\": " << summary.p99 << ",\n";
+    file << "  \"max\": " << summary.max << ",\n";
+    // [lowest score of the bucket, episodes], empty buckets left out
+    file << "  \"bucket_width\": " << bucketWidth << ",\n";
+    file << "  \"histogram\": [";
+    size_t i = 0;
+    bool first = true;
+    while(i < m_scores.size()){
+        int bucket = m_scores[i] / bucketWidth;
+        size_t end = i;
+        while(end < m_scores.size() && m_scores[end] / bucketWidth == bucket){
+            ++end;
+        }
+        file << (first ? "\n" : ",\n") << "    [" << bucket * bucketWidth << ", " << (end - i) << "]";
+        first = false;
+        i = end;
+    }
+    file << (first ? "]\n" : "\n  ]\n");
+    file << "}\n";
+    std::cout << "Wrote the score distribution to " << filepath << "\n";
+    return true;
+}
@@ -0,0 +1,153 @@
+#include "ScreenshotCapture.hpp"
+#include "GPUResourceTracker.hpp"
+#include "Image.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <vector>
+
+// A screenshot on its way to the disk, owned by its job
+struct ScreenshotFile{
+    std::string path;
+    std::vector<uint8_t> pixels;    // RGBA, bottom row first
+    int width;
+    int height;
+};
+
+// Constructor
+ScreenshotCapture::ScreenshotCapture(){
+
+}
+
+// Destructor
+ScreenshotCapture::~ScreenshotCapture(){
+    for(const Slot& slot : m_slots){
+        if(slot.buffer != 0){
+            std::cout << "ScreenshotCapture.cpp: buffers were never released\n";
+            break;
+        }
+    }
+}
+
+std::string ScreenshotCapture::NextPath(){
+    // Named by the time they were taken, numbered within the run so a
+    // burst in one second does not overwrite itself
+    char name[64];
+    time_t now = time(nullptr);
+    size_t length = strftime(name, sizeof(name), "screenshot_%Y%m%d_%H%M%S", localtime(&now));
+    snprintf(name + length, sizeof(name) - length, "_%04u.ppm", m_taken++);
+    return m_directory + "/" + name;
+}
+
+void ScreenshotCapture::Capture(int width, int height){
+    if(!m_requested){
+        return;
+    }
+    m_requested = false;
+    Slot* free = nullptr;
+    for(Slot& slot : m_slots){
+        if(slot.fence == nullptr){
+            free = &slot;
+            break;
+        }
+    }
+    if(free == nullptr){
+        std::cout << "ScreenshotCapture.cpp: " << SLOTS << " screenshots still in flight, skipped\n";
+        return;
+    }
+    Slot& slot = *free;
+    size_t bytes = (size_t)width * height * 4;
+    if(slot.buffer == 0){
+        glGenBuffers(1, &slot.buffer);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    if(slot.bytes != bytes){
+        glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)bytes, nullptr, GL_STREAM_READ);
+        if(slot.bytes != 0){
+            GPUResourceTracker::Get().Deleted(GPU_BUFFER, slot.buffer);
+        }
+        GPUResourceTracker::Get().Created(GPU_BUFFER, slot.buffer, "screenshot readback", bytes);
+        slot.bytes = bytes;
+    }
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+    glReadBuffer(GL_BACK);
+    // With a pack buffer bound this only queues a copy on the GPU
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.width = width;
+    slot.height = height;
+    slot.path = NextPath();
+}
+
+void ScreenshotCapture::Collect(){
+    for(Slot& slot : m_slots){
+        if(slot.fence != nullptr){
+            Finish(slot, false);
+        }
+    }
+}
+
+bool ScreenshotCapture::IsBusy() const{
+    for(const Slot& slot : m_slots){
+        if(slot.fence != nullptr){
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ScreenshotCapture::Finish(Slot& slot, bool wait){
+    GLenum result = glClientWaitSync(slot.fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0,
+                                     wait ? (GLuint64)1000000000 : 0);
+    if(result == GL_TIMEOUT_EXPIRED || result == GL_WAIT_FAILED){
+        return false;
+    }
+    glDeleteSync(slot.fence);
+    slot.fence = nullptr;
+
+    size_t bytes = (size_t)slot.width * slot.height * 4;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    const void* pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)bytes, GL_MAP_READ_BIT);
+    if(pixels == nullptr){
+        std::cout << "ScreenshotCapture.cpp: could not map the readback of " << slot.path << "\n";
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        return true;
+    }
+    ScreenshotFile* file = new ScreenshotFile;
+    file->path = slot.path;
+    file->pixels.resize(bytes);
+    std::memcpy(file->pixels.data(), pixels, bytes);
+    file->width = slot.width;
+    file->height = slot.height;
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    JobSystem::Get().Submit([file](){
+        if(Image::SavePPM(file->path, file->pixels.data(), file->width, file->height, 4, true)){
+            std::cout << "Saved screenshot " << file->path << "\n";
+        }
+        delete file;
+    }, &m_writes);
+    return true;
+}
+
+void ScreenshotCapture::Release(){
+    GPUResourceTracker& tracker = GPUResourceTracker::Get();
+    for(Slot& slot : m_slots){
+        if(slot.fence != nullptr && !Finish(slot, true)){
+            glDeleteSync(slot.fence);
+            slot.fence = nullptr;
+        }
+        if(slot.buffer != 0){
+            glDeleteBuffers(1, &slot.buffer);
+            tracker.Deleted(GPU_BUFFER, slot.buffer);
+            slot.buffer = 0;
+            slot.bytes = 0;
+        }
+    }
+    JobSystem::Get().Wait(m_writes);
+}
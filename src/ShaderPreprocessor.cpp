@@ -0,0 +1,114 @@
+#include "ShaderPreprocessor.hpp"
+#include "FileView.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+// The directory part of path including its last '/', empty if none
+static std::string DirectoryOf(const std::string& path){
+    size_t slash = path.find_last_of("/\\");
+    return (slash == std::string::npos) ? std::string() : path.substr(0, slash + 1);
+}
+
+// True if line, after leading blanks, starts with directive
+static bool IsDirective(const std::string& line, const char* directive, size_t& end){
+    size_t first = line.find_first_not_of(" \t");
+    size_t length = std::strlen(directive);
+    if(first == std::string::npos || line.compare(first, length, directive) != 0){
+        return false;
+    }
+    end = first + length;
+    return true;
+}
+
+/**
+* Appends the file at path to out, expanding its includes in place. The
+* file becomes source string number files.size() and is added to files.
+*
+* @param path File to expand
+* @param defines Inserted after the #version line of the first file
+* @param files Every file expanded so far, extended by this one
+* @param out Expanded source so far
+* @param defined Set once the defines have been inserted
+* @return false if a file could not be read or an #include is malformed
+*/
+static bool Expand(const std::string& path, const std::vector<std::string>& defines,
+                   std::vector<std::string>& files, std::string& out, bool& defined){
+    FileView file(path);
+    if(!file.IsOpen()){
+        std::cout << "ShaderPreprocessor.cpp: unable to open " << path << "\n";
+        return false;
+    }
+    const std::string source = std::to_string(files.size());
+    const bool isShader = files.empty();
+    files.push_back(path);
+    const std::string directory = DirectoryOf(path);
+
+    const char* data = file.Data();
+    size_t size = file.Size();
+    size_t begin = 0;
+    int lineNumber = 1;
+    while(begin < size){
+        const char* newline = (const char*)std::memchr(data + begin, '\n', size - begin);
+        size_t end = (newline != nullptr) ? (size_t)(newline - data) : size;
+        std::string line(data + begin, end - begin);
+        if(!line.empty() && line.back() == '\r'){
+            line.pop_back();
+        }
+
+        size_t rest = 0;
+        if(IsDirective(line, "#include", rest)){
+            size_t open = line.find('"', rest);
+            size_t close = (open == std::string::npos) ? std::string::npos : line.find('"', open + 1);
+            if(close == std::string::npos || close == open + 1){
+                std::cout << "ShaderPreprocessor.cpp: " << path << ":" << lineNumber << ": #include needs a \"file\"\n";
+                return false;
+            }
+            std::string included = directory + line.substr(open + 1, close - open - 1);
+            if(std::find(files.begin(), files.end(), included) == files.end()){
+                out += "#line 1 " + std::to_string(files.size()) + "\n";
+                if(!Expand(included, defines, files, out, defined)){
+                    return false;
+                }
+                out += "#line " + std::to_string(lineNumber + 1) + " " + source + "\n";
+            }else{
+                // Included before; an empty line keeps the numbering
+                out += "\n";
+            }
+        }else if(isShader && !defined && IsDirective(line, "#version", rest)){
+            out += line + "\n";
+            for(const std::string& define : defines){
+                out += "#define " + define + "\n";
+            }
+            out += "#line " + std::to_string(lineNumber + 1) + " 0\n";
+            defined = true;
+        }else{
+            out += line;
+            out += '\n';
+        }
+        begin = end + 1;
+        ++lineNumber;
+    }
+    return true;
+}
+
+bool PreprocessShader(const std::string& path, const std::vector<std::string>& defines,
+                      std::string& source, std::vector<std::string>* files){
+    std::vector<std::string> read;
+    source.clear();
+    bool defined = false;
+    bool expanded = Expand(path, defines, read, source, defined);
+    if(expanded && !defined && !defines.empty()){
+        // Without a #version line the defines go first
+        std::string header;
+        for(const std::string& define : defines){
+            header += "#define " + define + "\n";
+        }
+        source = header + "#line 1 0\n" + source;
+    }
+    if(files != nullptr){
+        *files = read;
+    }
+    return expanded;
+}
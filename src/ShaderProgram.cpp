@@ -0,0 +1,319 @@
+#include "ShaderProgram.hpp"
+#include "GLStateCache.hpp"
+#include "FileView.hpp"
+#include "FrameUniforms.hpp"
+#include "GPUResourceTracker.hpp"
+#include "ProgramCache.hpp"
+#include "ShaderPreprocessor.hpp"
+
+#include <iostream>
+#include <vector>
+
+// Constructor
+ShaderProgram::ShaderProgram(){
+
+}
+
+// Destructor
+ShaderProgram::~ShaderProgram(){
+    if(m_programID != 0 || m_pendingProgram != 0){
+        std::cout << "ShaderProgram.cpp: program " << m_programID << " was never released\n";
+    }
+}
+
+/**
+* LoadShaderAsString takes a filepath as an argument and will read line by line a file and return a string that is meant to be compiled at runtime for a vertex, fragment, geometry, tesselation, or compute shader.
+* e.g.
+*       LoadShaderAsString("./shaders/filepath");
+*
+* @param filename Path to the shader file
+* @return Entire file stored as a single string
+*/
+std::string ShaderProgram::LoadShaderAsString(const std::string& filename){
+    // Resulting shader program loaded as a single string
+    std::string result = "";
+
+    // Read through FileView, so a shader in the asset pack opens no file
+    FileView file(filename);
+    if(file.IsOpen()){
+        result.assign(file.Data(), file.Size());
+    }else{
+        std::cout << "Unable to open shader file: " << filename << "\n";
+    }
+
+    return result;
+}
+
+/**
+* CompileShader will compile any valid vertex, fragment, geometry, tesselation, or compute shader.
+* It only hands the source to the driver; CheckShader() asks how it went.
+*
+* @param type We use the 'type' field to determine which shader we are going to compile.
+* @param source : The shader source code.
+* @return id of the shaderObject
+*/
+GLuint ShaderProgram::CompileShader(GLuint type, const std::string& source){
+    GLuint shaderObject = glCreateShader(type);
+    GPUResourceTracker::Get().Created(GPU_SHADER, shaderObject, (type == GL_VERTEX_SHADER) ? "vertex shader"
+                                                              : (type == GL_GEOMETRY_SHADER) ? "geometry shader"
+                                                              : "fragment shader");
+
+    const char* src = source.c_str();
+    // The source of our shader
+    glShaderSource(shaderObject, 1, &src, nullptr);
+    // Now compile our shader
+    glCompileShader(shaderObject);
+    return shaderObject;
+}
+
+bool ShaderProgram::CheckShader(GLuint type, GLuint shaderObject){
+    // Retrieve the result of our compilation
+    int result;
+    glGetShaderiv(shaderObject, GL_COMPILE_STATUS, &result);
+
+    if(result == GL_FALSE){
+        int length;
+        glGetShaderiv(shaderObject, GL_INFO_LOG_LENGTH, &length);
+        std::vector<char> errorMessages(length > 0 ? length : 1, '\0');
+        glGetShaderInfoLog(shaderObject, (GLsizei)errorMessages.size(), &length, errorMessages.data());
+
+        if(type == GL_VERTEX_SHADER){
+            std::cout << "ERROR: GL_VERTEX_SHADER compilation failed!\n" << errorMessages.data() << "\n";
+        }else if(type == GL_FRAGMENT_SHADER){
+            std::cout << "ERROR: GL_FRAGMENT_SHADER compilation failed!\n" << errorMessages.data() << "\n";
+        }else if(type == GL_GEOMETRY_SHADER){
+            std::cout << "ERROR: GL_GEOMETRY_SHADER compilation failed!\n" << errorMessages.data() << "\n";
+        }
+        return false;
+    }
+    return true;
+}
+
+bool ShaderProgram::EnableParallelCompile(){
+    // The most threads the driver allows
+    if(GLAD_GL_KHR_parallel_shader_compile){
+        glMaxShaderCompilerThreadsKHR(0xFFFFFFFFu);
+        return true;
+    }
+    if(GLAD_GL_ARB_parallel_shader_compile){
+        glMaxShaderCompilerThreadsARB(0xFFFFFFFFu);
+        return true;
+    }
+    return false;
+}
+
+bool ShaderProgram::LoadFromFiles(const std::string& vertexPath, const std::string& fragmentPath,
+                                  const std::vector<std::string>& defines){
+    return BeginLoadFromFiles(vertexPath, fragmentPath, defines) && FinishBuild();
+}
+
+bool ShaderProgram::Build(const std::string& vertexSource, const std::string& fragmentSource){
+    return BeginBuild(vertexSource, fragmentSource) && FinishBuild();
+}
+
+bool ShaderProgram::BeginLoadFromFiles(const std::string& vertexPath, const std::string& fragmentPath,
+                                       const std::vector<std::string>& defines){
+    std::string vertexSource;
+    std::string fragmentSource;
+    std::vector<std::string> vertexFiles;
+    std::vector<std::string> fragmentFiles;
+    if(!PreprocessShader(vertexPath, defines, vertexSource, &vertexFiles) ||
+       !PreprocessShader(fragmentPath, defines, fragmentSource, &fragmentFiles)){
+        return false;
+    }
+    if(!BeginBuild(vertexSource, fragmentSource)){
+        return false;
+    }
+    m_pendingVertexFiles = vertexFiles;
+    m_pendingFragmentFiles = fragmentFiles;
+    return true;
+}
+
+bool ShaderProgram::BeginBuild(const std::string& vertexSource, const std::string& fragmentSource){
+    DiscardBuild();
+    // A program linked on an earlier launch needs no compiling at all
+    ProgramCache& cache = ProgramCache::Get();
+    if(cache.IsEnabled()){
+        // The captured outputs are part of the link, so of the key, and
+        // so is a geometry stage
+        std::string keySource = vertexSource;
+        if(!m_geometrySource.empty()){
+            keySource += "\n//geometry\n" + m_geometrySource;
+        }
+        for(const std::string& varying : m_feedbackVaryings){
+            keySource += "\n//feedback " + varying;
+        }
+        m_pendingKey = cache.GetKey(keySource, fragmentSource);
+        GLuint cachedProgram = glCreateProgram();
+        GPUResourceTracker::Get().Created(GPU_PROGRAM, cachedProgram, "shader program");
+        if(cache.Load(m_pendingKey, cachedProgram)){
+            m_pendingProgram = cachedProgram;
+            m_pendingCached = true;
+            return true;
+        }
+        glDeleteProgram(cachedProgram);
+        GPUResourceTracker::Get().Deleted(GPU_PROGRAM, cachedProgram);
+    }
+
+    // Compile our shaders
+    m_pendingVertex = CompileShader(GL_VERTEX_SHADER, vertexSource);
+    bool hasFragmentShader = !fragmentSource.empty();
+    m_pendingFragment = hasFragmentShader ? CompileShader(GL_FRAGMENT_SHADER, fragmentSource) : 0;
+    m_pendingGeometry = m_geometrySource.empty() ? 0 : CompileShader(GL_GEOMETRY_SHADER, m_geometrySource);
+
+    // Link our two shader programs together. A stage that failed fails
+    // the link, which is only looked at in FinishBuild().
+    GLuint programObject = glCreateProgram();
+    GPUResourceTracker::Get().Created(GPU_PROGRAM, programObject, "shader program");
+    if(cache.IsEnabled()){
+        // Asks the driver to keep a binary we can save after linking
+        glProgramParameteri(programObject, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+    glAttachShader(programObject, m_pendingVertex);
+    if(hasFragmentShader){
+        glAttachShader(programObject, m_pendingFragment);
+    }
+    if(m_pendingGeometry != 0){
+        glAttachShader(programObject, m_pendingGeometry);
+    }
+    if(!m_feedbackVaryings.empty()){
+        std::vector<const GLchar*> varyings;
+        for(const std::string& varying : m_feedbackVaryings){
+            varyings.push_back(varying.c_str());
+        }
+        glTransformFeedbackVaryings(programObject, (GLsizei)varyings.size(), varyings.data(), GL_INTERLEAVED_ATTRIBS);
+    }
+    glLinkProgram(programObject);
+    m_pendingProgram = programObject;
+    return true;
+}
+
+bool ShaderProgram::IsBuildComplete() const{
+    if(m_pendingProgram == 0 || m_pendingCached){
+        return true;
+    }
+    if(!GLAD_GL_KHR_parallel_shader_compile && !GLAD_GL_ARB_parallel_shader_compile){
+        return true;
+    }
+    GLint complete = GL_TRUE;
+    glGetProgramiv(m_pendingProgram, GL_COMPLETION_STATUS_KHR, &complete);
+    return complete != GL_FALSE;
+}
+
+bool ShaderProgram::FinishBuild(){
+    if(m_pendingProgram == 0){
+        return false;
+    }
+    GLuint programObject = m_pendingProgram;
+    if(!m_pendingCached){
+        int linked;
+        glGetProgramiv(programObject, GL_LINK_STATUS, &linked);
+        if(linked == GL_FALSE){
+            // A stage that did not compile explains the link
+            bool compiled = CheckShader(GL_VERTEX_SHADER, m_pendingVertex);
+            compiled = (m_pendingFragment == 0 || CheckShader(GL_FRAGMENT_SHADER, m_pendingFragment)) && compiled;
+            compiled = (m_pendingGeometry == 0 || CheckShader(GL_GEOMETRY_SHADER, m_pendingGeometry)) && compiled;
+            if(compiled){
+                int length;
+                glGetProgramiv(programObject, GL_INFO_LOG_LENGTH, &length);
+                std::vector<char> errorMessages(length > 0 ? length : 1, '\0');
+                glGetProgramInfoLog(programObject, (GLsizei)errorMessages.size(), &length, errorMessages.data());
+                std::cout << "ERROR: program link failed!\n" << errorMessages.data() << "\n";
+            }
+            // Messages name their file by source string number
+            for(size_t i = 1; i < m_pendingVertexFiles.size(); ++i){
+                std::cout << "  vertex source " << i << ": " << m_pendingVertexFiles[i] << "\n";
+            }
+            for(size_t i = 1; i < m_pendingFragmentFiles.size(); ++i){
+                std::cout << "  fragment source " << i << ": " << m_pendingFragmentFiles[i] << "\n";
+            }
+            DiscardBuild();
+            return false;
+        }
+        if(ProgramCache::Get().IsEnabled()){
+            ProgramCache::Get().Store(m_pendingKey, programObject);
+        }
+    }
+
+    std::vector<std::string> sourceFiles = m_pendingVertexFiles;
+    sourceFiles.insert(sourceFiles.end(), m_pendingFragmentFiles.begin(), m_pendingFragmentFiles.end());
+    DiscardBuild(false);
+
+    // Replace any previous program we owned
+    Release();
+    m_programID = programObject;
+    if(!sourceFiles.empty()){
+        m_sourceFiles = sourceFiles;
+    }
+    FrameUniforms::BindBlock(m_programID);
+    CacheUniformLocations();
+    return true;
+}
+
+void ShaderProgram::DiscardBuild(bool deleteProgram){
+    // Once linked, the program no longer needs its stages
+    for(GLuint shaderObject : {m_pendingVertex, m_pendingFragment, m_pendingGeometry}){
+        if(shaderObject != 0){
+            if(m_pendingProgram != 0){
+                glDetachShader(m_pendingProgram, shaderObject);
+            }
+            glDeleteShader(shaderObject);
+            GPUResourceTracker::Get().Deleted(GPU_SHADER, shaderObject);
+        }
+    }
+    if(m_pendingProgram != 0 && deleteProgram){
+        glDeleteProgram(m_pendingProgram);
+        GPUResourceTracker::Get().Deleted(GPU_PROGRAM, m_pendingProgram);
+    }
+    m_pendingProgram = 0;
+    m_pendingVertex = 0;
+    m_pendingFragment = 0;
+    m_pendingGeometry = 0;
+    m_pendingKey = 0;
+    m_pendingVertexFiles.clear();
+    m_pendingFragmentFiles.clear();
+    m_pendingCached = false;
+}
+
+void ShaderProgram::CacheUniformLocations(){
+    m_uniformLocations.clear();
+
+    GLint count = 0;
+    GLint maxLength = 0;
+    glGetProgramiv(m_programID, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(m_programID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+    std::vector<char> name(maxLength > 0 ? maxLength : 1, '\0');
+    for(GLint i = 0; i < count; ++i){
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(m_programID, (GLuint)i, (GLsizei)name.size(), &length, &size, &type, name.data());
+        std::string uniformName(name.data(), length);
+        m_uniformLocations[uniformName] = glGetUniformLocation(m_programID, uniformName.c_str());
+    }
+}
+
+void ShaderProgram::Use() const{
+    GLStateCache::Get().UseProgram(m_programID);
+}
+
+GLint ShaderProgram::GetUniformLocation(const std::string& name) const{
+    auto it = m_uniformLocations.find(name);
+    if(it == m_uniformLocations.end()){
+        return -1;
+    }
+    return it->second;
+}
+
+void ShaderProgram::Release(){
+    DiscardBuild();
+    if(m_programID != 0){
+        glDeleteProgram(m_programID);
+        GPUResourceTracker::Get().Deleted(GPU_PROGRAM, m_programID);
+        m_programID = 0;
+        // The deleted name may be reused by a later program
+        GLStateCache::Get().Invalidate();
+    }
+    m_uniformLocations.clear();
+}
@@ -0,0 +1,122 @@
+#include "ShaderVariants.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+// Constructor
+ShaderVariants::ShaderVariants(){
+
+}
+
+// Destructor
+ShaderVariants::~ShaderVariants(){
+
+}
+
+std::vector<std::string> ShaderVariants::GetDefines(uint32_t mask) const{
+    std::vector<std::string> defines;
+    for(size_t i = 0; i < m_features.size() && i < 32; ++i){
+        if(mask & (1u << i)){
+            defines.push_back(m_features[i]);
+        }
+    }
+    return defines;
+}
+
+bool ShaderVariants::Build(const std::string& vertexPath, const std::string& fragmentPath,
+                           const std::vector<uint32_t>& masks){
+    return BeginBuild(vertexPath, fragmentPath, masks) && FinishBuild();
+}
+
+bool ShaderVariants::BeginBuild(const std::string& vertexPath, const std::string& fragmentPath,
+                                const std::vector<uint32_t>& masks){
+    for(auto& entry : m_pending){
+        entry.second->Release();
+    }
+    m_pending.clear();
+    for(uint32_t mask : masks){
+        if(m_pending.count(mask) != 0){
+            continue;
+        }
+        std::unique_ptr<ShaderProgram> program(new ShaderProgram());
+        if(!program->BeginLoadFromFiles(vertexPath, fragmentPath, GetDefines(mask))){
+            std::cout << "ShaderVariants.cpp: could not read variant " << mask << " of " << vertexPath
+                      << " and " << fragmentPath << "\n";
+            program->Release();
+            for(auto& entry : m_pending){
+                entry.second->Release();
+            }
+            m_pending.clear();
+            return false;
+        }
+        m_pending[mask] = std::move(program);
+    }
+    m_pendingVertexPath = vertexPath;
+    m_pendingFragmentPath = fragmentPath;
+    m_pendingMasks = masks;
+    return true;
+}
+
+bool ShaderVariants::IsBuildComplete() const{
+    for(const auto& entry : m_pending){
+        if(!entry.second->IsBuildComplete()){
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ShaderVariants::FinishBuild(){
+    std::unordered_map<uint32_t, std::unique_ptr<ShaderProgram>> programs;
+    programs.swap(m_pending);
+    std::vector<std::string> sourceFiles;
+    bool built = !programs.empty();
+    // Every variant is finished, so none is left compiling after a failure
+    for(auto& entry : programs){
+        if(!entry.second->FinishBuild()){
+            std::cout << "ShaderVariants.cpp: variant " << entry.first << " of " << m_pendingVertexPath
+                      << " and " << m_pendingFragmentPath << " did not build\n";
+            built = false;
+            continue;
+        }
+        for(const std::string& file : entry.second->GetSourceFiles()){
+            if(std::find(sourceFiles.begin(), sourceFiles.end(), file) == sourceFiles.end()){
+                sourceFiles.push_back(file);
+            }
+        }
+    }
+    if(!built){
+        for(auto& entry : programs){
+            entry.second->Release();
+        }
+        return false;
+    }
+
+    Release();
+    m_vertexPath = m_pendingVertexPath;
+    m_fragmentPath = m_pendingFragmentPath;
+    m_masks = m_pendingMasks;
+    m_programs = std::move(programs);
+    m_sourceFiles = sourceFiles;
+    return true;
+}
+
+bool ShaderVariants::Rebuild(){
+    return Build(m_vertexPath, m_fragmentPath, m_masks);
+}
+
+const ShaderProgram* ShaderVariants::Get(uint32_t mask) const{
+    auto it = m_programs.find(mask);
+    return (it != m_programs.end()) ? it->second.get() : nullptr;
+}
+
+void ShaderVariants::Release(){
+    for(auto& entry : m_programs){
+        entry.second->Release();
+    }
+    m_programs.clear();
+    for(auto& entry : m_pending){
+        entry.second->Release();
+    }
+    m_pending.clear();
+}
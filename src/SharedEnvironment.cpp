@@ -0,0 +1,230 @@
+#include "SharedEnvironment.hpp"
+#include "FeatureObservation.hpp"
+#include "HugePages.hpp"
+
+#include <iostream>
+
+#if defined(__linux__)
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Polls before going to sleep on the futex. A trainer that answers
+// within this window never causes a syscall.
+static const int SPIN_COUNT = 1 << 14;
+
+// Rounds up to the next multiple of 64 (one cache line)
+static size_t AlignToCacheLine(size_t bytes){
+    return (bytes + 63) & ~(size_t)63;
+}
+
+void WriteObservation(const GameState& state, int32_t* row){
+    row[OBS_DINO_HEIGHT] = state.dinoHeight;
+    row[OBS_IS_JUMPING] = state.isJumping ? 1 : 0;
+    row[OBS_JUMPING_SPEED] = state.jumpingSpeed;
+    row[OBS_CACTUS_POSITION] = GetLeadObstacle(state.obstacles, state.scroll);
+    row[OBS_CACTUS_SPEED] = state.cactusSpeed;
+    row[OBS_TICK] = state.tick;
+}
+
+// Constructor
+SharedEnvironment::SharedEnvironment(){
+
+}
+
+// Destructor
+SharedEnvironment::~SharedEnvironment(){
+    Release();
+}
+
+#if defined(__linux__)
+
+bool SharedEnvironment::Create(const std::string& name, size_t environmentCount,
+                               int pixelWidth, int pixelHeight, int pixelChannels, size_t featureObstacles){
+    Release();
+    size_t pixelFrameSize = (size_t)pixelWidth * pixelHeight * pixelChannels;
+    size_t featureSize = (featureObstacles > 0) ? ::GetFeatureSize(featureObstacles) : 0;
+    size_t observationOffset = AlignToCacheLine(sizeof(SharedEnvironmentHeader));
+    size_t rewardOffset = observationOffset + AlignToCacheLine(environmentCount * OBSERVATION_SIZE * sizeof(int32_t));
+    size_t doneOffset = rewardOffset + AlignToCacheLine(environmentCount * sizeof(float));
+    size_t actionOffset = doneOffset + AlignToCacheLine(environmentCount * sizeof(uint8_t));
+    size_t pixelOffset = actionOffset + AlignToCacheLine(environmentCount * sizeof(int32_t));
+    size_t featureOffset = pixelOffset + AlignToCacheLine(environmentCount * pixelFrameSize);
+    size_t totalSize = featureOffset + AlignToCacheLine(environmentCount * featureSize * sizeof(float));
+
+    int fd = shm_open(name.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0600);
+    if(fd < 0){
+        std::cout << "SharedEnvironment.cpp: shm_open " << name << " failed: " << strerror(errno) << "\n";
+        return false;
+    }
+    if(ftruncate(fd, (off_t)totalSize) != 0){
+        std::cout << "SharedEnvironment.cpp: could not size " << name << ": " << strerror(errno) << "\n";
+        close(fd);
+        shm_unlink(name.c_str());
+        return false;
+    }
+    void* memory = mmap(nullptr, totalSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if(memory == MAP_FAILED){
+        std::cout << "SharedEnvironment.cpp: could not map " << name << ": " << strerror(errno) << "\n";
+        shm_unlink(name.c_str());
+        return false;
+    }
+    // Observations of a million environments span thousands of 4 KB pages;
+    // shared memory gets huge pages where shmem_enabled allows advising
+    AdviseHugePages(memory, totalSize);
+    m_memory = (uint8_t*)memory;
+    m_header = (SharedEnvironmentHeader*)memory;
+    m_size = totalSize;
+    m_name = name;
+    m_owner = true;
+    m_seen = 0;
+
+    // The pages start zeroed; the magic is written last so a trainer
+    // never sees a half-initialized header.
+    m_header->version = SHARED_ENVIRONMENT_VERSION;
+    m_header->environmentCount = (uint32_t)environmentCount;
+    m_header->observationSize = OBSERVATION_SIZE;
+    m_header->observationOffset = observationOffset;
+    m_header->rewardOffset = rewardOffset;
+    m_header->doneOffset = doneOffset;
+    m_header->actionOffset = actionOffset;
+    if(pixelFrameSize > 0){
+        m_header->pixelOffset = pixelOffset;
+        m_header->pixelWidth = (uint32_t)pixelWidth;
+        m_header->pixelHeight = (uint32_t)pixelHeight;
+        m_header->pixelChannels = (uint32_t)pixelChannels;
+    }
+    if(featureSize > 0){
+        m_header->featureOffset = featureOffset;
+        m_header->featureSize = (uint32_t)featureSize;
+        m_header->featureObstacles = (uint32_t)featureObstacles;
+    }
+    m_header->totalSize = totalSize;
+    __atomic_store_n(&m_header->magic, SHARED_ENVIRONMENT_MAGIC, __ATOMIC_RELEASE);
+    return true;
+}
+
+bool SharedEnvironment::Open(const std::string& name){
+    Release();
+    int fd = shm_open(name.c_str(), O_RDWR, 0600);
+    if(fd < 0){
+        std::cout << "SharedEnvironment.cpp: shm_open " << name << " failed: " << strerror(errno) << "\n";
+        return false;
+    }
+    struct stat info;
+    if(fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(SharedEnvironmentHeader)){
+        std::cout << "SharedEnvironment.cpp: " << name << " is not initialized\n";
+        close(fd);
+        return false;
+    }
+    void* memory = mmap(nullptr, (size_t)info.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if(memory == MAP_FAILED){
+        std::cout << "SharedEnvironment.cpp: could not map " << name << ": " << strerror(errno) << "\n";
+        return false;
+    }
+    SharedEnvironmentHeader* header = (SharedEnvironmentHeader*)memory;
+    if(__atomic_load_n(&header->magic, __ATOMIC_ACQUIRE) != SHARED_ENVIRONMENT_MAGIC ||
+       header->version != SHARED_ENVIRONMENT_VERSION || header->totalSize > (size_t)info.st_size){
+        std::cout << "SharedEnvironment.cpp: " << name << " has an unknown layout\n";
+        munmap(memory, (size_t)info.st_size);
+        return false;
+    }
+    m_memory = (uint8_t*)memory;
+    m_header = header;
+    m_size = (size_t)info.st_size;
+    m_name = name;
+    m_owner = false;
+    m_seen = __atomic_load_n(&m_header->responseSequence, __ATOMIC_ACQUIRE);
+    return true;
+}
+
+void SharedEnvironment::WaitForChange(uint32_t* word, uint32_t seen, uint32_t* waiting){
+    for(int spin = 0; spin < SPIN_COUNT; ++spin){
+        if(__atomic_load_n(word, __ATOMIC_ACQUIRE) != seen){
+            return;
+        }
+    }
+    // Announce the sleep before the last check, so that Ring() either
+    // sees the flag or its increment is seen here.
+    __atomic_store_n(waiting, 1, __ATOMIC_SEQ_CST);
+    while(__atomic_load_n(word, __ATOMIC_SEQ_CST) == seen){
+        // Returns at once if *word no longer equals seen
+        syscall(SYS_futex, word, FUTEX_WAIT, seen, nullptr, nullptr, 0);
+    }
+    __atomic_store_n(waiting, 0, __ATOMIC_RELAXED);
+}
+
+void SharedEnvironment::Ring(uint32_t* word, uint32_t* waiting){
+    __atomic_add_fetch(word, 1, __ATOMIC_SEQ_CST);
+    if(__atomic_load_n(waiting, __ATOMIC_SEQ_CST) != 0){
+        syscall(SYS_futex, word, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+    }
+}
+
+void SharedEnvironment::Release(){
+    if(m_memory != nullptr){
+        munmap(m_memory, m_size);
+        if(m_owner){
+            shm_unlink(m_name.c_str());
+        }
+    }
+    m_memory = nullptr;
+    m_header = nullptr;
+    m_size = 0;
+    m_owner = false;
+}
+
+#else
+
+bool SharedEnvironment::Create(const std::string& name, size_t environmentCount,
+                               int pixelWidth, int pixelHeight, int pixelChannels, size_t featureObstacles){
+    std::cout << "SharedEnvironment.cpp: shared memory environments need Linux\n";
+    return false;
+}
+
+bool SharedEnvironment::Open(const std::string& name){
+    std::cout << "SharedEnvironment.cpp: shared memory environments need Linux\n";
+    return false;
+}
+
+void SharedEnvironment::WaitForChange(uint32_t* word, uint32_t seen, uint32_t* waiting){
+
+}
+
+void SharedEnvironment::Ring(uint32_t* word, uint32_t* waiting){
+
+}
+
+void SharedEnvironment::Release(){
+
+}
+
+#endif
+
+bool SharedEnvironment::WaitForRequest(){
+    WaitForChange(&m_header->requestSequence, m_seen, &m_header->requestWaiting);
+    m_seen = __atomic_load_n(&m_header->requestSequence, __ATOMIC_ACQUIRE);
+    return __atomic_load_n(&m_header->shutdown, __ATOMIC_ACQUIRE) == 0;
+}
+
+void SharedEnvironment::Respond(){
+    Ring(&m_header->responseSequence, &m_header->responseWaiting);
+}
+
+void SharedEnvironment::Request(){
+    Ring(&m_header->requestSequence, &m_header->requestWaiting);
+}
+
+void SharedEnvironment::WaitForResponse(){
+    WaitForChange(&m_header->responseSequence, m_seen, &m_header->responseWaiting);
+    m_seen = __atomic_load_n(&m_header->responseSequence, __ATOMIC_ACQUIRE);
+}
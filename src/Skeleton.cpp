@@ -0,0 +1,238 @@
+#include "Skeleton.hpp"
+#include "FileView.hpp"
+#include "VertexFormat.hpp"
+
+#include "glm/gtc/matrix_transform.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+// Keeps a vertex on a bone from dividing by zero
+static const float BIND_EPSILON = 1e-6f;
+
+// Constructor
+Skeleton::Skeleton(){
+
+}
+
+// Destructor
+Skeleton::~Skeleton(){
+
+}
+
+void Skeleton::Clear(){
+    m_joints.clear();
+    m_clips.clear();
+}
+
+int Skeleton::FindJoint(const std::string& name) const{
+    for(size_t i = 0; i < m_joints.size(); ++i){
+        if(m_joints[i].name == name){
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+int Skeleton::FindClip(const std::string& name) const{
+    for(size_t i = 0; i < m_clips.size(); ++i){
+        if(m_clips[i].name == name){
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+bool Skeleton::Load(const std::string& filepath){
+    Clear();
+    FileView file(filepath);
+    if(!file.IsOpen()){
+        std::cout << "Skeleton.cpp: unable to open " << filepath << "\n";
+        return false;
+    }
+    const char* data = file.Data();
+    size_t size = file.Size();
+    size_t begin = 0;
+    int lineNumber = 0;
+    std::string error;
+    while(begin < size && error.empty()){
+        const char* newline = (const char*)std::memchr(data + begin, '\n', size - begin);
+        size_t end = (newline != nullptr) ? (size_t)(newline - data) : size;
+        std::istringstream line(std::string(data + begin, end - begin));
+        begin = end + 1;
+        ++lineNumber;
+
+        std::string keyword;
+        if(!(line >> keyword) || keyword[0] == '#'){
+            continue;
+        }
+        if(keyword == "joint"){
+            SkeletonJoint joint;
+            std::string parent;
+            if(!(line >> joint.name >> parent >> joint.head.x >> joint.head.y >> joint.head.z
+                      >> joint.tail.x >> joint.tail.y >> joint.tail.z)){
+                error = "a joint needs a name, a parent and a head and tail";
+            }else if(FindJoint(joint.name) >= 0){
+                error = "joint " + joint.name + " is named twice";
+            }else if(m_joints.size() == MAX_SKIN_JOINTS){
+                error = "more than " + std::to_string(MAX_SKIN_JOINTS) + " joints";
+            }else if(!m_clips.empty()){
+                error = "joints must come before the clips";
+            }else{
+                joint.parent = (parent == "-") ? -1 : FindJoint(parent);
+                if(parent != "-" && joint.parent < 0){
+                    error = "parent " + parent + " of " + joint.name + " is not a joint above it";
+                }
+                m_joints.push_back(joint);
+            }
+        }else if(keyword == "clip"){
+            AnimationClip clip;
+            if(!(line >> clip.name >> clip.duration) || !(clip.duration > 0.0f)){
+                error = "a clip needs a name and a length in seconds";
+            }else{
+                clip.keys.resize(m_joints.size());
+                m_clips.push_back(clip);
+            }
+        }else if(keyword == "key"){
+            std::string name;
+            JointKey key;
+            glm::vec3 degrees(0.0f);
+            if(!(line >> name >> key.time >> degrees.x >> degrees.y >> degrees.z)){
+                error = "a key needs a joint, a time and a rotation";
+            }else if(m_clips.empty()){
+                error = "a key must follow a clip";
+            }else{
+                // The offset is optional
+                glm::vec3 offset(0.0f);
+                if(line >> offset.x >> offset.y >> offset.z){
+                    key.offset = offset;
+                }
+                AnimationClip& clip = m_clips.back();
+                int joint = FindJoint(name);
+                if(joint < 0){
+                    error = "no joint " + name;
+                }else if(key.time < 0.0f || key.time > clip.duration ||
+                         (!clip.keys[joint].empty() && key.time <= clip.keys[joint].back().time)){
+                    error = "keys of " + name + " must be in time order within the clip";
+                }else{
+                    key.rotation = glm::quat(glm::radians(degrees));
+                    clip.keys[joint].push_back(key);
+                }
+            }
+        }else{
+            error = "unknown keyword " + keyword;
+        }
+    }
+    if(error.empty() && m_joints.empty()){
+        error = "no joints";
+    }
+    if(!error.empty()){
+        std::cout << "Skeleton.cpp: " << filepath << ":" << lineNumber << ": " << error << "\n";
+        Clear();
+        return false;
+    }
+    return true;
+}
+
+// Squared distance from point to the segment from a to b
+static float SegmentDistanceSquared(const glm::vec3& point, const glm::vec3& a, const glm::vec3& b){
+    glm::vec3 bone = b - a;
+    float length = glm::dot(bone, bone);
+    float t = (length > 0.0f) ? glm::clamp(glm::dot(point - a, bone) / length, 0.0f, 1.0f) : 0.0f;
+    glm::vec3 nearest = a + bone * t;
+    return glm::dot(point - nearest, point - nearest);
+}
+
+void Skeleton::BindVertices(const float* interleaved, size_t vertexCount, SkinVertex* out) const{
+    for(size_t v = 0; v < vertexCount; ++v){
+        const float* vertex = interleaved + v * FLOATS_PER_VERTEX;
+        glm::vec3 position(vertex[0], vertex[1], vertex[2]);
+        // The heaviest bones so far, heaviest first
+        float weights[SKIN_INFLUENCES] = {};
+        uint8_t joints[SKIN_INFLUENCES] = {};
+        for(size_t j = 0; j < m_joints.size(); ++j){
+            float distance = SegmentDistanceSquared(position, m_joints[j].head, m_joints[j].tail);
+            float weight = 1.0f / ((distance + BIND_EPSILON) * (distance + BIND_EPSILON));
+            size_t slot = SKIN_INFLUENCES;
+            while(slot > 0 && weights[slot - 1] < weight){
+                if(slot < SKIN_INFLUENCES){
+                    weights[slot] = weights[slot - 1];
+                    joints[slot] = joints[slot - 1];
+                }
+                --slot;
+            }
+            if(slot < SKIN_INFLUENCES){
+                weights[slot] = weight;
+                joints[slot] = (uint8_t)j;
+            }
+        }
+        float total = 0.0f;
+        for(size_t i = 0; i < SKIN_INFLUENCES; ++i){
+            total += weights[i];
+        }
+        SkinVertex& skin = out[v];
+        int remaining = 255;
+        for(size_t i = 0; i < SKIN_INFLUENCES; ++i){
+            int weight = (total > 0.0f) ? (int)(weights[i] / total * 255.0f) : 0;
+            skin.joints[i] = joints[i];
+            skin.weights[i] = (uint8_t)weight;
+            remaining -= weight;
+        }
+        // What rounding left over goes to the heaviest, so they sum to 255
+        if(total > 0.0f){
+            skin.weights[0] = (uint8_t)(skin.weights[0] + remaining);
+        }
+    }
+}
+
+// The pose keys give a joint at time, looping over a clip of duration
+static JointKey SampleKeys(const std::vector<JointKey>& keys, float duration, float time){
+    if(keys.empty()){
+        return JointKey();
+    }
+    if(keys.size() == 1){
+        return keys[0];
+    }
+    // The last key at or before time, the last of the loop before the first
+    size_t from = keys.size() - 1;
+    for(size_t i = 0; i < keys.size() && keys[i].time <= time; ++i){
+        from = i;
+    }
+    size_t to = (from + 1) % keys.size();
+    float elapsed = time - keys[from].time;
+    float span = keys[to].time - keys[from].time;
+    if(to == 0){
+        span += duration;
+        if(elapsed < 0.0f){
+            elapsed += duration;
+        }
+    }
+    float fraction = (span > 0.0f) ? glm::clamp(elapsed / span, 0.0f, 1.0f) : 0.0f;
+    JointKey pose;
+    pose.rotation = glm::slerp(keys[from].rotation, keys[to].rotation, fraction);
+    pose.offset = glm::mix(keys[from].offset, keys[to].offset, fraction);
+    return pose;
+}
+
+void Skeleton::Sample(size_t clipIndex, float time, glm::vec4* rows) const{
+    const AnimationClip& clip = m_clips[clipIndex];
+    float looped = std::fmod(time, clip.duration);
+    if(looped < 0.0f){
+        looped += clip.duration;
+    }
+    glm::mat4 skins[MAX_SKIN_JOINTS];
+    for(size_t j = 0; j < m_joints.size(); ++j){
+        const SkeletonJoint& joint = m_joints[j];
+        JointKey pose = SampleKeys(clip.keys[j], clip.duration, looped);
+        // Turned about the head, then moved, relative to the parent
+        glm::mat4 local = glm::translate(glm::mat4(1.0f), joint.head + pose.offset)
+                        * glm::mat4_cast(pose.rotation)
+                        * glm::translate(glm::mat4(1.0f), -joint.head);
+        skins[j] = (joint.parent >= 0) ? skins[joint.parent] * local : local;
+        for(int row = 0; row < 3; ++row){
+            rows[j * 3 + row] = glm::vec4(skins[j][0][row], skins[j][1][row], skins[j][2][row], skins[j][3][row]);
+        }
+    }
+}
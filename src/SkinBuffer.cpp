@@ -0,0 +1,69 @@
+#include "SkinBuffer.hpp"
+#include "GLBackend.hpp"
+#include "GLStateCache.hpp"
+#include "GPUResourceTracker.hpp"
+
+// Constructor
+SkinBuffer::SkinBuffer(){
+
+}
+
+// Destructor
+SkinBuffer::~SkinBuffer(){
+
+}
+
+void SkinBuffer::Create(){
+    GLBackend& backend = GLBackend::Get();
+    m_buffer = backend.CreateBuffer();
+    // A buffer texture needs a data store to be attached to
+    SkinVertex empty = {};
+    backend.BufferData(m_buffer, sizeof(empty), &empty, GL_STATIC_DRAW);
+    m_bytes = sizeof(empty);
+    m_texture = backend.CreateTexture(GL_TEXTURE_BUFFER);
+    if(backend.HasDirectStateAccess()){
+        glTextureBuffer(m_texture, GL_RG32UI, m_buffer);
+    }else{
+        GLStateCache::Get().BindTexture(SKIN_VERTEX_UNIT, GL_TEXTURE_BUFFER, m_texture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RG32UI, m_buffer);
+    }
+    GPUResourceTracker& tracker = GPUResourceTracker::Get();
+    tracker.Created(GPU_BUFFER, m_buffer, "skin vertices", m_bytes);
+    tracker.Created(GPU_TEXTURE, m_texture, "skin vertex texture");
+}
+
+void SkinBuffer::Upload(const SkinVertex* vertices, size_t count){
+    if(m_buffer == 0){
+        Create();
+    }
+    if(count == 0){
+        return;
+    }
+    // The texture follows its buffer's new data store
+    m_bytes = count * sizeof(SkinVertex);
+    GLBackend::Get().BufferData(m_buffer, m_bytes, vertices, GL_STATIC_DRAW);
+    GPUResourceTracker::Get().Resized(GPU_BUFFER, m_buffer, m_bytes);
+}
+
+void SkinBuffer::Bind(){
+    if(m_buffer == 0){
+        Create();
+    }
+    GLStateCache::Get().BindTexture(SKIN_VERTEX_UNIT, GL_TEXTURE_BUFFER, m_texture);
+}
+
+void SkinBuffer::Release(){
+    GPUResourceTracker& tracker = GPUResourceTracker::Get();
+    if(m_texture != 0){
+        glDeleteTextures(1, &m_texture);
+        tracker.Deleted(GPU_TEXTURE, m_texture);
+        m_texture = 0;
+    }
+    if(m_buffer != 0){
+        glDeleteBuffers(1, &m_buffer);
+        tracker.Deleted(GPU_BUFFER, m_buffer);
+        m_buffer = 0;
+    }
+    m_bytes = 0;
+    GLStateCache::Get().Invalidate();
+}
@@ -0,0 +1,107 @@
+#include "SkyPass.hpp"
+#include "GLBackend.hpp"
+#include "GLStateCache.hpp"
+#include "GPUResourceTracker.hpp"
+#include "VirtualPanorama.hpp"
+
+#include <cmath>
+#include <iostream>
+
+// Constructor
+SkyPass::SkyPass(){
+
+}
+
+// Destructor
+SkyPass::~SkyPass(){
+
+}
+
+bool SkyPass::ReloadShaders(const std::string& vertexPath, const std::string& fragmentPath){
+    if(!m_program.LoadFromFiles(vertexPath, fragmentPath)){
+        std::cout << "SkyPass.cpp: could not build the sky shaders\n";
+        return false;
+    }
+    m_textureLocation   = m_program.GetUniformLocation("u_DiffuseTexture");
+    m_layersLocation    = m_program.GetUniformLocation("u_Layers");
+    m_boundsMinLocation = m_program.GetUniformLocation("u_BoundsMin");
+    m_boundsMaxLocation = m_program.GetUniformLocation("u_BoundsMax");
+    m_panoramaLocation      = m_program.GetUniformLocation("u_Panorama");
+    m_panoramaTableLocation = m_program.GetUniformLocation("u_PanoramaTable");
+    m_panoramaSizeLocation  = m_program.GetUniformLocation("u_PanoramaSize");
+    m_panoramaViewLocation  = m_program.GetUniformLocation("u_PanoramaView");
+    m_panoramaTilesLocation = m_program.GetUniformLocation("u_PanoramaTiles");
+    return true;
+}
+
+bool SkyPass::Initialize(const std::string& vertexPath, const std::string& fragmentPath){
+    if(!ReloadShaders(vertexPath, fragmentPath)){
+        return false;
+    }
+    m_vao = GLBackend::Get().CreateVertexArray();
+    GPUResourceTracker::Get().Created(GPU_VERTEX_ARRAY, m_vao, "sky vertex array");
+    return true;
+}
+
+void SkyPass::StreamPanorama(double wallScroll){
+    if(m_panorama == nullptr || !m_panorama->IsReady() || m_bounds.IsEmpty()){
+        return;
+    }
+    // As high as the wall, so as wide as the wall's shape makes it
+    const double wallWidth = m_panorama->GetHeight() * (double)(m_bounds.max[0] - m_bounds.min[0]) /
+                             (double)(m_bounds.max[1] - m_bounds.min[1]);
+    // A wall the cache cannot hold would lose its right part for good
+    if(!m_panorama->Fits(wallWidth)){
+        std::cout << "SkyPass.cpp: a wall " << (int)wallWidth << " texels wide does not fit the panorama's tile "
+                  << "cache, the sky keeps its layer\n";
+        m_panorama = nullptr;
+        m_panoramaWidth = 0.0f;
+        return;
+    }
+    const double first = wallScroll * wallWidth;
+    m_panorama->Update(first, wallWidth);
+    // Wrapped in double, so the shader's floats stay precise in long games
+    m_panoramaFirst = (float)(first - std::floor(first / m_panorama->GetWidth()) * m_panorama->GetWidth());
+    m_panoramaWidth = (float)wallWidth;
+}
+
+void SkyPass::Draw(const SkyLayers& layers){
+    if(m_vao == 0 || m_bounds.IsEmpty()){
+        return;
+    }
+    m_program.Use();
+    glUniform1i(m_textureLocation, 0);
+    glUniform2f(m_layersLocation, layers.day, layers.night);
+    glUniform3fv(m_boundsMinLocation, 1, m_bounds.min);
+    glUniform3fv(m_boundsMaxLocation, 1, m_bounds.max);
+    // Set even without a panorama, so they never share unit 0 with the array
+    glUniform1i(m_panoramaLocation, PANORAMA_CACHE_UNIT);
+    glUniform1i(m_panoramaTableLocation, PANORAMA_TABLE_UNIT);
+    if(m_panorama != nullptr && m_panorama->IsReady() && m_panoramaWidth > 0.0f){
+        m_panorama->Bind();
+        glUniform2f(m_panoramaSizeLocation, (float)m_panorama->GetWidth(), (float)m_panorama->GetHeight());
+        glUniform2f(m_panoramaViewLocation, m_panoramaFirst, m_panoramaWidth);
+        glUniform4f(m_panoramaTilesLocation, (float)m_panorama->GetTileSize(), (float)m_panorama->GetSlotSize(),
+                    (float)m_panorama->GetCacheWidth(), (float)m_panorama->GetCacheHeight());
+    }else{
+        glUniform2f(m_panoramaSizeLocation, 0.0f, 0.0f);
+    }
+
+    // On the far plane: passes only where the depth buffer is still clear
+    GLStateCache::Get().BindVertexArray(m_vao);
+    glDepthFunc(GL_LEQUAL);
+    glDepthMask(GL_FALSE);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glDepthMask(GL_TRUE);
+    glDepthFunc(GL_LESS);
+}
+
+void SkyPass::Release(){
+    m_program.Release();
+    if(m_vao != 0){
+        glDeleteVertexArrays(1, &m_vao);
+        GPUResourceTracker::Get().Deleted(GPU_VERTEX_ARRAY, m_vao);
+        m_vao = 0;
+    }
+    GLStateCache::Get().Invalidate();
+}
@@ -0,0 +1,489 @@
+#include "SoftwareRasterizer.hpp"
+#include "SimdLanes.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+// Clip space x and y are kept within this many times w. Triangles inside
+// the band are rasterized as they are and the tiles drop what is off the
+// frame, so only the rare triangle far off the side gets clipped.
+static const float GUARD_BAND = 1.5f;
+// Clipping a triangle by the six planes adds at most one corner per plane
+static const int MAX_CLIP_VERTICES = 3 + 6;
+
+// Signed distance of a corner to clipping plane p, inside where >= 0
+static float GetPlaneDistance(const float* clip, int plane){
+    const float x = clip[0], y = clip[1], z = clip[2], w = clip[3];
+    switch(plane){
+        case 0: return z + w;               // Near
+        case 1: return w - z;               // Far
+        case 2: return GUARD_BAND*w + x;
+        case 3: return GUARD_BAND*w - x;
+        case 4: return GUARD_BAND*w + y;
+        default: return GUARD_BAND*w - y;
+    }
+}
+
+// True if all three corners of a triangle lie outside one clipping plane.
+// Corners are x, y, z, w at a stride of stride floats.
+static bool IsOutsidePlane(const float* corners, size_t stride){
+    for(int plane = 0; plane < 6; ++plane){
+        if(GetPlaneDistance(corners, plane) < 0.0f && GetPlaneDistance(corners + stride, plane) < 0.0f &&
+           GetPlaneDistance(corners + 2 * stride, plane) < 0.0f){
+            return true;
+        }
+    }
+    return false;
+}
+
+// a / 2^bits rounded down, for negative values too
+static int32_t FloorToPixel(int32_t a, int bits){
+    return (a >= 0) ? (a >> bits) : -((((int32_t)1 << bits) - 1 - a) >> bits);
+}
+
+// Constructor
+SoftwareRasterizer::SoftwareRasterizer(){
+
+}
+
+// Destructor
+SoftwareRasterizer::~SoftwareRasterizer(){
+
+}
+
+// Floats of a corner: x, y, z, then u, v in the second block
+static const size_t CORNER_FLOATS = 5;
+
+// The positions of every corner of triangles, then their texture
+// coordinates, into corners
+static void BuildCorners(Span<Triangle> triangles, std::vector<float>& corners){
+    const size_t cornerCount = triangles.size() * 3;
+    corners.resize(cornerCount * CORNER_FLOATS);
+    float* positions = corners.data();
+    float* uvs = positions + cornerCount * 3;
+    for(const Triangle& triangle : triangles){
+        for(int i = 0; i < 3; ++i){
+            *positions++ = triangle.vertices[i].x;
+            *positions++ = triangle.vertices[i].y;
+            *positions++ = triangle.vertices[i].z;
+            *uvs++ = triangle.textures[i].u;
+            *uvs++ = triangle.textures[i].v;
+        }
+    }
+}
+
+// The header of a cooked file of kind, nullptr if data is not one
+static const CookedAssetHeader* GetCookedHeader(const char* data, size_t size, const char* magic){
+    if(data == nullptr || size < sizeof(CookedAssetHeader) ||
+       ((uintptr_t)data % alignof(float)) != 0){
+        return nullptr;
+    }
+    const CookedAssetHeader* header = (const CookedAssetHeader*)data;
+    if(std::memcmp(header->magic, magic, 4) != 0 || header->version != COOKED_ASSET_VERSION){
+        return nullptr;
+    }
+    return header;
+}
+
+// A cooked file of header and payload bytes
+static std::vector<char> BuildCooked(const char* magic, uint32_t width, uint32_t height,
+                                     const void* payload, size_t bytes){
+    CookedAssetHeader header;
+    std::memcpy(header.magic, magic, 4);
+    header.version = COOKED_ASSET_VERSION;
+    header.width = width;
+    header.height = height;
+    std::vector<char> data(sizeof(header) + bytes);
+    std::memcpy(data.data(), &header, sizeof(header));
+    if(bytes > 0){
+        std::memcpy(data.data() + sizeof(header), payload, bytes);
+    }
+    return data;
+}
+
+int SoftwareRasterizer::AddMesh(Span<Triangle> triangles){
+    m_meshes.push_back(Mesh());
+    Mesh& mesh = m_meshes.back();
+    BuildCorners(triangles, mesh.owned);
+    mesh.cornerCount = triangles.size() * 3;
+    mesh.positions = mesh.owned.data();
+    mesh.uvs = mesh.positions + mesh.cornerCount * 3;
+    return (int)m_meshes.size() - 1;
+}
+
+int SoftwareRasterizer::AddTexture(const uint8_t* rgba, int width, int height){
+    m_textures.push_back(Texture());
+    Texture& texture = m_textures.back();
+    texture.owned.assign(rgba, rgba + (size_t)width * height * 4);
+    texture.rgba = texture.owned.data();
+    texture.width = width;
+    texture.height = height;
+    return (int)m_textures.size() - 1;
+}
+
+int SoftwareRasterizer::AddCookedMesh(const char* data, size_t size){
+    const CookedAssetHeader* header = GetCookedHeader(data, size, "DCRN");
+    if(header == nullptr || header->height != 0 ||
+       (size - sizeof(CookedAssetHeader)) / sizeof(float) / CORNER_FLOATS < header->width){
+        return -1;
+    }
+    Mesh mesh;
+    mesh.cornerCount = header->width;
+    mesh.positions = (const float*)(data + sizeof(CookedAssetHeader));
+    mesh.uvs = mesh.positions + mesh.cornerCount * 3;
+    m_meshes.push_back(std::move(mesh));
+    return (int)m_meshes.size() - 1;
+}
+
+int SoftwareRasterizer::AddCookedTexture(const char* data, size_t size){
+    const CookedAssetHeader* header = GetCookedHeader(data, size, "DRGB");
+    if(header == nullptr || header->width == 0 || header->height == 0 ||
+       (size - sizeof(CookedAssetHeader)) / 4 / header->width < header->height){
+        return -1;
+    }
+    Texture texture;
+    texture.rgba = (const uint8_t*)(data + sizeof(CookedAssetHeader));
+    texture.width = (int)header->width;
+    texture.height = (int)header->height;
+    m_textures.push_back(std::move(texture));
+    return (int)m_textures.size() - 1;
+}
+
+std::vector<char> SoftwareRasterizer::CookMesh(Span<Triangle> triangles){
+    std::vector<float> corners;
+    BuildCorners(triangles, corners);
+    return BuildCooked("DCRN", (uint32_t)(corners.size() / CORNER_FLOATS), 0,
+                       corners.data(), corners.size() * sizeof(float));
+}
+
+std::vector<char> SoftwareRasterizer::CookTexture(const uint8_t* rgba, int width, int height){
+    return BuildCooked("DRGB", (uint32_t)width, (uint32_t)height, rgba, (size_t)width * height * 4);
+}
+
+std::string SoftwareRasterizer::CookedMeshPathFor(const std::string& objPath){
+    return objPath + ".corners";
+}
+
+std::string SoftwareRasterizer::CookedTexturePathFor(const std::string& imagePath){
+    return imagePath + ".rgba";
+}
+
+size_t SoftwareRasterizer::GetOwnedBytes() const{
+    size_t bytes = 0;
+    for(const Mesh& mesh : m_meshes){
+        bytes += mesh.owned.size() * sizeof(float);
+    }
+    for(const Texture& texture : m_textures){
+        bytes += texture.owned.size();
+    }
+    return bytes;
+}
+
+bool SoftwareRasterizer::SetSize(int width, int height, bool grayscale){
+    if(width < 1 || height < 1 || width > MAX_SIZE || height > MAX_SIZE){
+        std::cout << "SoftwareRasterizer.cpp: frame size " << width << "x" << height
+                  << " is outside 1 to " << MAX_SIZE << "\n";
+        return false;
+    }
+    m_width = width;
+    m_height = height;
+    m_grayscale = grayscale;
+    m_tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+    m_tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+    m_bins.assign((size_t)m_tilesX * m_tilesY, std::vector<uint32_t>());
+    m_color.assign((size_t)width * height * 3, 0);
+    m_depth.assign((size_t)width * height, 1.0f);
+    m_pixels.assign((size_t)width * height * GetChannels(), 0);
+    return true;
+}
+
+void SoftwareRasterizer::Render(const glm::mat4& viewProjection, const SoftwareInstance* instances,
+                                size_t instanceCount, ThreadPool* pool){
+    m_triangles.clear();
+    for(std::vector<uint32_t>& bin : m_bins){
+        bin.clear();
+    }
+    for(size_t i = 0; i < instanceCount; ++i){
+        const SoftwareInstance& instance = instances[i];
+        if(instance.mesh < 0 || (size_t)instance.mesh >= m_meshes.size() ||
+           instance.texture < 0 || (size_t)instance.texture >= m_textures.size()){
+            continue;
+        }
+        const Mesh& mesh = m_meshes[instance.mesh];
+        const glm::vec3 offset(instance.x, instance.y, instance.z);
+        for(size_t c = 0; c + 3 <= mesh.cornerCount; c += 3){
+            ClipVertex clip[3];
+            for(int k = 0; k < 3; ++k){
+                const float* corner = &mesh.positions[(c + k) * 3];
+                glm::vec3 position = glm::vec3(corner[0], corner[1], corner[2]) * instance.scale + offset;
+                glm::vec4 projected = viewProjection * glm::vec4(position, 1.0f);
+                clip[k].x = projected.x;
+                clip[k].y = projected.y;
+                clip[k].z = projected.z;
+                clip[k].w = projected.w;
+            }
+            // The clipper would leave nothing of it
+            if(IsOutsidePlane(&clip[0].x, sizeof(ClipVertex) / sizeof(float))){
+                continue;
+            }
+            for(int k = 0; k < 3; ++k){
+                const float* uv = &mesh.uvs[(c + k) * 2];
+                clip[k].u = uv[0] - instance.uShift;
+                clip[k].v = uv[1];
+            }
+            AddClipTriangle(clip, instance.texture);
+        }
+    }
+
+    size_t tileCount = m_bins.size();
+    if(pool){
+        pool->Run(tileCount, [this](size_t tile){
+            RenderTile(tile);
+        });
+    }else{
+        for(size_t tile = 0; tile < tileCount; ++tile){
+            RenderTile(tile);
+        }
+    }
+}
+
+void SoftwareRasterizer::AddClipTriangle(const ClipVertex* corners, int texture){
+    // Most triangles are inside every plane and skip the clipper
+    bool inside = true;
+    for(int plane = 0; plane < 6 && inside; ++plane){
+        for(int k = 0; k < 3; ++k){
+            inside = inside && GetPlaneDistance(&corners[k].x, plane) >= 0.0f;
+        }
+    }
+    if(inside){
+        AddScreenTriangle(corners[0], corners[1], corners[2], texture);
+        return;
+    }
+
+    // Sutherland-Hodgman, one plane at a time
+    ClipVertex buffers[2][MAX_CLIP_VERTICES];
+    int count = 3;
+    std::copy(corners, corners + 3, buffers[0]);
+    int current = 0;
+    for(int plane = 0; plane < 6 && count > 0; ++plane){
+        const ClipVertex* in = buffers[current];
+        ClipVertex* out = buffers[current ^ 1];
+        int outCount = 0;
+        for(int k = 0; k < count; ++k){
+            const ClipVertex& a = in[k];
+            const ClipVertex& b = in[(k + 1) % count];
+            float da = GetPlaneDistance(&a.x, plane);
+            float db = GetPlaneDistance(&b.x, plane);
+            if(da >= 0.0f){
+                out[outCount++] = a;
+            }
+            if((da >= 0.0f) != (db >= 0.0f)){
+                float t = da / (da - db);
+                ClipVertex& split = out[outCount++];
+                split.x = a.x + (b.x - a.x)*t;
+                split.y = a.y + (b.y - a.y)*t;
+                split.z = a.z + (b.z - a.z)*t;
+                split.w = a.w + (b.w - a.w)*t;
+                split.u = a.u + (b.u - a.u)*t;
+                split.v = a.v + (b.v - a.v)*t;
+            }
+        }
+        count = outCount;
+        current ^= 1;
+    }
+    for(int k = 1; k + 1 < count; ++k){
+        AddScreenTriangle(buffers[current][0], buffers[current][k], buffers[current][k + 1], texture);
+    }
+}
+
+void SoftwareRasterizer::AddScreenTriangle(const ClipVertex& a, const ClipVertex& b, const ClipVertex& c, int texture){
+    const ClipVertex* corners[3] = {&a, &b, &c};
+    ScreenTriangle triangle;
+    const float subpixels = (float)(1 << SUBPIXEL_BITS);
+    for(int k = 0; k < 3; ++k){
+        const ClipVertex& corner = *corners[k];
+        if(corner.w <= 0.0f){
+            return;
+        }
+        float invW = 1.0f / corner.w;
+        float sx = (corner.x*invW*0.5f + 0.5f) * (float)m_width * subpixels;
+        float sy = (corner.y*invW*0.5f + 0.5f) * (float)m_height * subpixels;
+        triangle.x[k] = (int32_t)std::floor(sx + 0.5f);
+        triangle.y[k] = (int32_t)std::floor(sy + 0.5f);
+        triangle.z[k] = corner.z*invW;
+        triangle.invW[k] = invW;
+        triangle.uOverW[k] = corner.u*invW;
+        triangle.vOverW[k] = corner.v*invW;
+    }
+
+    // Twice the signed area; clockwise triangles are turned around
+    int64_t area = (int64_t)(triangle.x[1] - triangle.x[0]) * (triangle.y[2] - triangle.y[0])
+                 - (int64_t)(triangle.y[1] - triangle.y[0]) * (triangle.x[2] - triangle.x[0]);
+    if(area == 0){
+        return;
+    }
+    if(area < 0){
+        std::swap(triangle.x[1], triangle.x[2]);
+        std::swap(triangle.y[1], triangle.y[2]);
+        std::swap(triangle.z[1], triangle.z[2]);
+        std::swap(triangle.invW[1], triangle.invW[2]);
+        std::swap(triangle.uOverW[1], triangle.uOverW[2]);
+        std::swap(triangle.vOverW[1], triangle.vOverW[2]);
+        area = -area;
+    }
+    triangle.invArea = 1.0f / (float)area;
+    triangle.texture = texture;
+
+    // Pixels whose centers can lie inside
+    const int32_t half = 1 << (SUBPIXEL_BITS - 1);
+    int32_t minX = std::min(triangle.x[0], std::min(triangle.x[1], triangle.x[2]));
+    int32_t maxX = std::max(triangle.x[0], std::max(triangle.x[1], triangle.x[2]));
+    int32_t minY = std::min(triangle.y[0], std::min(triangle.y[1], triangle.y[2]));
+    int32_t maxY = std::max(triangle.y[0], std::max(triangle.y[1], triangle.y[2]));
+    const int32_t roundUp = (1 << SUBPIXEL_BITS) - 1;
+    triangle.minX = std::max(0, FloorToPixel(minX - half + roundUp, SUBPIXEL_BITS));
+    triangle.minY = std::max(0, FloorToPixel(minY - half + roundUp, SUBPIXEL_BITS));
+    triangle.maxX = std::min(m_width - 1, FloorToPixel(maxX - half, SUBPIXEL_BITS));
+    triangle.maxY = std::min(m_height - 1, FloorToPixel(maxY - half, SUBPIXEL_BITS));
+    if(triangle.minX > triangle.maxX || triangle.minY > triangle.maxY){
+        return;
+    }
+
+    uint32_t index = (uint32_t)m_triangles.size();
+    m_triangles.push_back(triangle);
+    for(int tileY = triangle.minY / TILE_SIZE; tileY <= triangle.maxY / TILE_SIZE; ++tileY){
+        for(int tileX = triangle.minX / TILE_SIZE; tileX <= triangle.maxX / TILE_SIZE; ++tileX){
+            m_bins[(size_t)tileY * m_tilesX + tileX].push_back(index);
+        }
+    }
+}
+
+void SoftwareRasterizer::RenderTile(size_t tile){
+    int x0 = (int)(tile % m_tilesX) * TILE_SIZE;
+    int y0 = (int)(tile / m_tilesX) * TILE_SIZE;
+    int x1 = std::min(x0 + TILE_SIZE, m_width) - 1;
+    int y1 = std::min(y0 + TILE_SIZE, m_height) - 1;
+
+    for(int y = y0; y <= y1; ++y){
+        for(int x = x0; x <= x1; ++x){
+            size_t pixel = (size_t)y * m_width + x;
+            m_color[pixel*3 + 0] = m_clear[0];
+            m_color[pixel*3 + 1] = m_clear[1];
+            m_color[pixel*3 + 2] = m_clear[2];
+            m_depth[pixel] = 1.0f;
+        }
+    }
+
+    // In submission order, so equal depths resolve the same way every time
+    for(uint32_t index : m_bins[tile]){
+        const ScreenTriangle& triangle = m_triangles[index];
+        RasterizeTriangle(triangle, std::max(x0, triangle.minX), std::max(y0, triangle.minY),
+                          std::min(x1, triangle.maxX), std::min(y1, triangle.maxY));
+    }
+
+    for(int y = y0; y <= y1; ++y){
+        for(int x = x0; x <= x1; ++x){
+            size_t pixel = (size_t)y * m_width + x;
+            const uint8_t* color = &m_color[pixel*3];
+            if(m_grayscale){
+                // Rec. 601 luma in 8.8 fixed point, the weights PixelObserver reduces with
+                m_pixels[pixel] = (uint8_t)((77*color[0] + 150*color[1] + 29*color[2]) >> 8);
+            }else{
+                m_pixels[pixel*3 + 0] = color[0];
+                m_pixels[pixel*3 + 1] = color[1];
+                m_pixels[pixel*3 + 2] = color[2];
+            }
+        }
+    }
+}
+
+void SoftwareRasterizer::RasterizeTriangle(const ScreenTriangle& triangle, int x0, int y0, int x1, int y1){
+    typedef VectorLanes L;
+    const int LANES = (int)L::WIDTH;
+    const int32_t half = 1 << (SUBPIXEL_BITS - 1);
+    const int32_t px = (x0 << SUBPIXEL_BITS) + half;
+    const int32_t py = (y0 << SUBPIXEL_BITS) + half;
+
+    // Edge k runs between the two corners other than k and is positive on
+    // the inside, so its value at a pixel weighs corner k. Pixels exactly
+    // on an edge belong to the triangle only if the edge is a top or a
+    // left one, so a pixel on an edge shared by two triangles is drawn once.
+    int32_t rowStart[3], stepX[3], stepY[3], bias[3];
+    for(int k = 0; k < 3; ++k){
+        int a = (k + 1) % 3;
+        int b = (k + 2) % 3;
+        int32_t dx = triangle.x[b] - triangle.x[a];
+        int32_t dy = triangle.y[b] - triangle.y[a];
+        bool topLeft = (dy < 0) || (dy == 0 && dx < 0);
+        bias[k] = topLeft ? 0 : 1;
+        rowStart[k] = dx*(py - triangle.y[a]) - dy*(px - triangle.x[a]) - bias[k];
+        stepX[k] = -dy * (1 << SUBPIXEL_BITS);
+        stepY[k] = dx * (1 << SUBPIXEL_BITS);
+    }
+
+    int32_t laneIndices[L::WIDTH];
+    for(int lane = 0; lane < LANES; ++lane){
+        laneIndices[lane] = lane;
+    }
+    const L::V laneIndex = L::Load(laneIndices);
+    const L::V minusOne = L::Set(-1);
+    const L::V end = L::Set(x1 + 1);
+    L::V laneOffsets[3], blockSteps[3];
+    for(int k = 0; k < 3; ++k){
+        laneOffsets[k] = L::Mul(laneIndex, L::Set(stepX[k]));
+        blockSteps[k] = L::Set(stepX[k] * LANES);
+    }
+
+    const Texture& texture = m_textures[triangle.texture];
+    int32_t edges[3][L::WIDTH];
+    int32_t covered[L::WIDTH];
+    for(int y = y0; y <= y1; ++y){
+        L::V e[3];
+        for(int k = 0; k < 3; ++k){
+            e[k] = L::Add(L::Set(rowStart[k]), laneOffsets[k]);
+            rowStart[k] += stepY[k];
+        }
+        for(int x = x0; x <= x1; x += LANES){
+            L::V mask = L::Gt(end, L::Add(L::Set(x), laneIndex));
+            mask = L::And(mask, L::And(L::Gt(e[0], minusOne), L::And(L::Gt(e[1], minusOne), L::Gt(e[2], minusOne))));
+            if(L::Any(mask)){
+                L::Store(covered, mask);
+                for(int k = 0; k < 3; ++k){
+                    L::Store(edges[k], e[k]);
+                }
+                for(int lane = 0; lane < LANES; ++lane){
+                    if(!covered[lane]){
+                        continue;
+                    }
+                    // The weights leave out the fill rule bias
+                    float w0 = (float)(edges[0][lane] + bias[0]) * triangle.invArea;
+                    float w1 = (float)(edges[1][lane] + bias[1]) * triangle.invArea;
+                    float w2 = (float)(edges[2][lane] + bias[2]) * triangle.invArea;
+                    size_t pixel = (size_t)y * m_width + x + lane;
+                    float z = w0*triangle.z[0] + w1*triangle.z[1] + w2*triangle.z[2];
+                    if(!(z < m_depth[pixel])){
+                        continue;
+                    }
+                    m_depth[pixel] = z;
+                    float invW = w0*triangle.invW[0] + w1*triangle.invW[1] + w2*triangle.invW[2];
+                    float u = (w0*triangle.uOverW[0] + w1*triangle.uOverW[1] + w2*triangle.uOverW[2]) / invW;
+                    float v = (w0*triangle.vOverW[0] + w1*triangle.vOverW[1] + w2*triangle.vOverW[2]) / invW;
+                    // Clamped to the edge like the scene textures
+                    u = std::min(std::max(u, 0.0f), 1.0f);
+                    v = std::min(std::max(v, 0.0f), 1.0f);
+                    int tx = std::min((int)(u * texture.width), texture.width - 1);
+                    int ty = std::min((int)(v * texture.height), texture.height - 1);
+                    const uint8_t* texel = &texture.rgba[((size_t)ty * texture.width + tx) * 4];
+                    m_color[pixel*3 + 0] = texel[0];
+                    m_color[pixel*3 + 1] = texel[1];
+                    m_color[pixel*3 + 2] = texel[2];
+                }
+            }
+            for(int k = 0; k < 3; ++k){
+                e[k] = L::Add(e[k], blockSteps[k]);
+            }
+        }
+    }
+}
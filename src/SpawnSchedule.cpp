@@ -0,0 +1,17 @@
+#include "SpawnSchedule.hpp"
+
+// Constructor
+SpawnSchedule::SpawnSchedule(){
+
+}
+
+// Destructor
+SpawnSchedule::~SpawnSchedule(){
+
+}
+
+void SpawnSchedule::Resize(size_t count){
+    m_draws.resize(count * BLOCK_DRAWS);
+    m_next.resize(count);
+    m_cursor.resize(count, BLOCK_DRAWS);
+}
@@ -0,0 +1,131 @@
+#include "SpawnScript.hpp"
+
+// Three lone cacti, a pause, then a bird to run under
+static bool ThreeCactiPauseBird(SpawnScriptFrame& frame, GameRandom& rng, SpawnGroup& group){
+    (void)rng;
+    SPAWN_SCRIPT_BEGIN(frame)
+    for(frame.counter = 0; frame.counter < 3; ++frame.counter){
+        SPAWN_YIELD(frame, group, 1, 0, 0, 1000);
+    }
+    SPAWN_YIELD(frame, group, 0, 0, 0, 1500);
+    SPAWN_YIELD(frame, group, 1, 0, SPAWN_BIRD_HEIGHT, 1200);
+    SPAWN_SCRIPT_END(frame)
+}
+
+// A lone cactus, a pair and a cluster, spaced like the archetypes, twice
+static bool Staircase(SpawnScriptFrame& frame, GameRandom& rng, SpawnGroup& group){
+    (void)rng;
+    SPAWN_SCRIPT_BEGIN(frame)
+    for(frame.local = 0; frame.local < 2; ++frame.local){
+        for(frame.counter = 1; frame.counter <= 3; ++frame.counter){
+            SPAWN_YIELD(frame, group, frame.counter, frame.counter == 2 ? 40 : 36, 0, 1100);
+        }
+    }
+    SPAWN_SCRIPT_END(frame)
+}
+
+// Cacti and birds in turn, at gaps rolled from the game's RNG
+static bool BirdVolley(SpawnScriptFrame& frame, GameRandom& rng, SpawnGroup& group){
+    SPAWN_SCRIPT_BEGIN(frame)
+    for(frame.counter = 0; frame.counter < 4; ++frame.counter){
+        SPAWN_YIELD(frame, group, 1, 0, 0, 900 + (int)(NextGameRandom(rng) % 600u));
+        SPAWN_YIELD(frame, group, 1, 0, SPAWN_BIRD_HEIGHT, 900 + (int)(NextGameRandom(rng) % 600u));
+    }
+    SPAWN_SCRIPT_END(frame)
+}
+
+static const SpawnScript SPAWN_SCRIPTS[] = {
+    {"three_cacti_pause_bird", ThreeCactiPauseBird},
+    {"staircase", Staircase},
+    {"bird_volley", BirdVolley},
+};
+static const int SPAWN_SCRIPT_COUNT = sizeof(SPAWN_SCRIPTS)/sizeof(SPAWN_SCRIPTS[0]);
+
+const SpawnScript* GetSpawnScripts(int& count){
+    count = SPAWN_SCRIPT_COUNT;
+    return SPAWN_SCRIPTS;
+}
+
+uint16_t FindSpawnScript(const std::string& name){
+    for(int i = 0; i < SPAWN_SCRIPT_COUNT; ++i){
+        if(name == SPAWN_SCRIPTS[i].name){
+            return (uint16_t)(i + 1);
+        }
+    }
+    return SPAWN_SCRIPT_NONE;
+}
+
+std::string ListSpawnScripts(){
+    std::string names;
+    for(int i = 0; i < SPAWN_SCRIPT_COUNT; ++i){
+        names += (i > 0 ? ", " : "");
+        names += SPAWN_SCRIPTS[i].name;
+    }
+    return names;
+}
+
+bool ResumeSpawnScript(SpawnScriptFrame& frame, GameRandom& rng, SpawnGroup& group){
+    if(frame.script == SPAWN_SCRIPT_NONE || frame.script > SPAWN_SCRIPT_COUNT){
+        frame = SpawnScriptFrame();
+        return false;
+    }
+    if(!SPAWN_SCRIPTS[frame.script - 1].run(frame, rng, group)){
+        frame = SpawnScriptFrame();
+        return false;
+    }
+    return true;
+}
+
+// Constructor
+SpawnScriptPool::SpawnScriptPool(){
+
+}
+
+// Destructor
+SpawnScriptPool::~SpawnScriptPool(){
+
+}
+
+void SpawnScriptPool::Reserve(size_t capacity){
+    size_t oldCapacity = m_frames.size();
+    if(capacity <= oldCapacity){
+        return;
+    }
+    m_frames.resize(capacity);
+    m_used.resize(capacity, false);
+    // Room for every index, so Release() never allocates
+    m_free.reserve(capacity);
+    for(size_t frame = capacity; frame > oldCapacity; --frame){
+        m_free.push_back((uint32_t)(frame - 1));
+    }
+}
+
+uint32_t SpawnScriptPool::Acquire(uint16_t script){
+    if(m_free.empty()){
+        return NO_FRAME;
+    }
+    uint32_t frame = m_free.back();
+    m_free.pop_back();
+    m_used[frame] = true;
+    StartSpawnScript(m_frames[frame], script);
+    return frame;
+}
+
+void SpawnScriptPool::Release(uint32_t frame){
+    if(frame >= m_frames.size() || !m_used[frame]){
+        return;
+    }
+    m_used[frame] = false;
+    m_frames[frame] = SpawnScriptFrame();
+    m_free.push_back(frame);
+}
+
+void SpawnScriptPool::Clear(){
+    size_t capacity = m_frames.size();
+    m_frames.assign(capacity, SpawnScriptFrame());
+    m_used.assign(capacity, false);
+    m_free.clear();
+    for(size_t frame = capacity; frame > 0; --frame){
+        m_free.push_back((uint32_t)(frame - 1));
+    }
+}
@@ -0,0 +1,374 @@
+#include "SpectatorStream.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+// Datagrams start with the magic and their kind. A tick datagram goes on
+// with the sequence number of its first step (4 bytes, little endian),
+// the step count and the encoded steps.
+static const uint8_t PACKET_MAGIC[2] = {'D', 'S'};
+enum SpectatorPacket : uint8_t{
+    SPECTATOR_JOIN = 1,
+    SPECTATOR_TICKS = 2
+};
+static const size_t TICKS_HEADER_BYTES = 8;
+static const size_t MAX_PACKET_BYTES = 1400;
+// A viewer asks again this often, which keeps it on the list
+static const uint32_t JOIN_INTERVAL_MS = 1000;
+
+static void PutVarint(std::vector<uint8_t>& out, uint64_t value){
+    while(value >= 0x80){
+        out.push_back((uint8_t)(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back((uint8_t)value);
+}
+
+static bool GetVarint(const uint8_t*& data, const uint8_t* end, uint64_t& value){
+    value = 0;
+    for(int shift = 0; shift < 64 && data < end; shift += 7){
+        uint8_t byte = *data++;
+        value |= (uint64_t)(byte & 0x7f) << shift;
+        if((byte & 0x80) == 0){
+            return true;
+        }
+    }
+    return false;
+}
+
+static inline uint64_t ZigZag(int64_t value){
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static inline int64_t UnZigZag(uint64_t value){
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+// Channels that move steadily are predicted from their last change,
+// the others to stay as they are
+static bool IsMoving(int channel){
+    return channel == SPECTATOR_TICK || channel == SPECTATOR_DAY_TICK || channel == SPECTATOR_DINO_HEIGHT ||
+           channel == SPECTATOR_TRACK ||
+           (channel >= SPECTATOR_OBSTACLE_X && channel < SPECTATOR_OBSTACLE_X + (int)OBSTACLE_LANE_CAPACITY);
+}
+
+void CaptureSpectatorFrame(const GameState& game, uint64_t gamesPlayed, int64_t trackDistance,
+                           SpectatorFrame& frame){
+    int64_t* channels = frame.channels;
+    std::memset(channels, 0, sizeof(frame.channels));
+    channels[SPECTATOR_GAME] = (int64_t)gamesPlayed;
+    channels[SPECTATOR_TICK] = game.tick;
+    channels[SPECTATOR_DAY_TICK] = game.dayTick;
+    channels[SPECTATOR_FLAGS] = (game.isDaytime ? SPECTATOR_FLAG_DAYTIME : 0) |
+                                (game.gameOver ? SPECTATOR_FLAG_GAME_OVER : 0) |
+                                (game.isJumping ? SPECTATOR_FLAG_JUMPING : 0) |
+                                (game.jumpingUp ? SPECTATOR_FLAG_JUMPING_UP : 0);
+    channels[SPECTATOR_DINO_HEIGHT] = game.dinoHeight;
+    channels[SPECTATOR_JUMP_SPEED] = game.jumpingSpeed;
+    channels[SPECTATOR_TRACK] = trackDistance;
+    channels[SPECTATOR_OBSTACLE_HEAD] = game.obstacles.head;
+    channels[SPECTATOR_OBSTACLE_COUNT] = game.obstacles.count;
+    for(uint32_t i = 0; i < game.obstacles.count; ++i){
+        uint32_t slot = GetLaneSlot(game.obstacles, i);
+        channels[SPECTATOR_OBSTACLE_X + slot] = game.obstacles.x[slot] - game.scroll;
+        channels[SPECTATOR_OBSTACLE_Y + slot] = game.obstacles.y[slot];
+    }
+}
+
+void ApplySpectatorFrame(const SpectatorFrame& frame, GameState& game, uint64_t& gamesPlayed,
+                         int64_t& trackDistance){
+    const int64_t* channels = frame.channels;
+    gamesPlayed = (uint64_t)channels[SPECTATOR_GAME];
+    game.tick = (int)channels[SPECTATOR_TICK];
+    game.dayTick = (int)channels[SPECTATOR_DAY_TICK];
+    int flags = (int)channels[SPECTATOR_FLAGS];
+    game.isDaytime = (flags & SPECTATOR_FLAG_DAYTIME) != 0;
+    game.gameOver = (flags & SPECTATOR_FLAG_GAME_OVER) != 0;
+    game.isJumping = (flags & SPECTATOR_FLAG_JUMPING) != 0;
+    game.jumpingUp = (flags & SPECTATOR_FLAG_JUMPING_UP) != 0;
+    game.dinoHeight = (int)channels[SPECTATOR_DINO_HEIGHT];
+    game.jumpingSpeed = (int)channels[SPECTATOR_JUMP_SPEED];
+    trackDistance = channels[SPECTATOR_TRACK];
+    // Positions arrive relative to the scroll
+    game.scroll = 0;
+    game.obstacles.head = (uint32_t)channels[SPECTATOR_OBSTACLE_HEAD] & OBSTACLE_LANE_MASK;
+    game.obstacles.count = std::min((uint32_t)channels[SPECTATOR_OBSTACLE_COUNT], OBSTACLE_LANE_CAPACITY);
+    for(uint32_t slot = 0; slot < OBSTACLE_LANE_CAPACITY; ++slot){
+        game.obstacles.x[slot] = (int)channels[SPECTATOR_OBSTACLE_X + slot];
+        game.obstacles.y[slot] = (int)channels[SPECTATOR_OBSTACLE_Y + slot];
+    }
+}
+
+int64_t SpectatorCodec::Predict(int channel) const{
+    int64_t last = m_last.channels[channel];
+    if(!IsMoving(channel)){
+        return last;
+    }
+    return last + (last - m_before.channels[channel]);
+}
+
+void SpectatorCodec::Push(const SpectatorFrame& frame, bool keyframe){
+    m_before = keyframe ? frame : m_last;
+    m_last = frame;
+}
+
+void SpectatorCodec::Encode(const SpectatorFrame& frame, bool keyframe, std::vector<uint8_t>& out){
+    // A keyframe sends the values themselves, leaving out the zeros
+    int64_t residuals[SPECTATOR_CHANNELS];
+    uint64_t mask = 0;
+    for(int channel = 0; channel < SPECTATOR_CHANNELS; ++channel){
+        residuals[channel] = frame.channels[channel] - (keyframe ? 0 : Predict(channel));
+        if(residuals[channel] != 0){
+            mask |= (uint64_t)1 << channel;
+        }
+    }
+    PutVarint(out, (mask << 1) | (keyframe ? 1 : 0));
+    for(int channel = 0; channel < SPECTATOR_CHANNELS; ++channel){
+        if(mask & ((uint64_t)1 << channel)){
+            PutVarint(out, ZigZag(residuals[channel]));
+        }
+    }
+    Push(frame, keyframe);
+}
+
+bool SpectatorCodec::Decode(const uint8_t*& data, const uint8_t* end, bool apply, SpectatorFrame& frame,
+                            bool& keyframe){
+    uint64_t header = 0;
+    if(!GetVarint(data, end, header) || (header >> (SPECTATOR_CHANNELS + 1)) != 0){
+        return false;
+    }
+    keyframe = (header & 1) != 0;
+    uint64_t mask = header >> 1;
+    SpectatorFrame decoded;
+    for(int channel = 0; channel < SPECTATOR_CHANNELS; ++channel){
+        int64_t residual = 0;
+        if(mask & ((uint64_t)1 << channel)){
+            uint64_t value = 0;
+            if(!GetVarint(data, end, value)){
+                return false;
+            }
+            residual = UnZigZag(value);
+        }
+        decoded.channels[channel] = residual + (keyframe ? 0 : Predict(channel));
+    }
+    if(apply){
+        Push(decoded, keyframe);
+        frame = decoded;
+    }
+    return true;
+}
+
+// Constructor
+SpectatorServer::SpectatorServer(){
+
+}
+
+// Destructor
+SpectatorServer::~SpectatorServer(){
+
+}
+
+uint32_t SpectatorServer::GetMilliseconds() const{
+    auto elapsed = std::chrono::steady_clock::now() - m_epoch;
+    return (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count();
+}
+
+bool SpectatorServer::Start(int port, int ticksPerPacket){
+    if(!m_socket.Open(port)){
+        return false;
+    }
+    // The repeated steps and the new ones share the count byte
+    m_ticksPerPacket = (uint32_t)std::max(1, std::min(ticksPerPacket, 127));
+    m_epoch = std::chrono::steady_clock::now();
+    return true;
+}
+
+void SpectatorServer::AcceptViewers(uint32_t now){
+    uint8_t packet[16];
+    size_t size = 0;
+    UdpAddress sender;
+    while(m_socket.ReceiveFrom(packet, sizeof(packet), size, sender)){
+        if(size < 3 || std::memcmp(packet, PACKET_MAGIC, sizeof(PACKET_MAGIC)) != 0 || packet[2] != SPECTATOR_JOIN){
+            continue;
+        }
+        auto viewer = std::find_if(m_viewers.begin(), m_viewers.end(), [&](const Viewer& v){
+            return v.address == sender;
+        });
+        if(viewer != m_viewers.end()){
+            viewer->lastHeardMs = now;
+        }else if(m_viewers.size() < MAX_VIEWERS){
+            m_viewers.push_back(Viewer{sender, now});
+            // Newcomers start from a keyframe
+            m_keyframePending = true;
+            std::cout << "Spectator joined, " << m_viewers.size() << " watching\n";
+        }
+    }
+    size_t before = m_viewers.size();
+    m_viewers.erase(std::remove_if(m_viewers.begin(), m_viewers.end(), [&](const Viewer& v){
+        return now - v.lastHeardMs > (uint32_t)VIEWER_TIMEOUT_SECONDS*1000;
+    }), m_viewers.end());
+    if(m_viewers.size() < before){
+        std::cout << "Spectator left, " << m_viewers.size() << " watching\n";
+    }
+}
+
+void SpectatorServer::AddTick(const SpectatorFrame& frame){
+    if(!IsRunning()){
+        return;
+    }
+    AcceptViewers(GetMilliseconds());
+    bool keyframe = m_keyframePending || m_sequence % KEYFRAME_INTERVAL == 0;
+    m_keyframePending = false;
+    m_codec.Encode(frame, keyframe, m_current);
+    ++m_currentCount;
+    ++m_sequence;
+    if(m_currentCount >= m_ticksPerPacket){
+        SendPacket();
+    }
+}
+
+void SpectatorServer::SendPacket(){
+    uint32_t currentFirst = m_sequence - m_currentCount;
+    // The steps of the last datagram go again, unless they would not fit
+    bool repeat = m_previousCount > 0 && TICKS_HEADER_BYTES + m_previous.size() + m_current.size() <= MAX_PACKET_BYTES;
+    uint32_t first = repeat ? m_previousFirst : currentFirst;
+    uint32_t count = (repeat ? m_previousCount : 0) + m_currentCount;
+    std::vector<uint8_t> packet;
+    packet.reserve(TICKS_HEADER_BYTES + m_previous.size() + m_current.size());
+    packet.insert(packet.end(), PACKET_MAGIC, PACKET_MAGIC + sizeof(PACKET_MAGIC));
+    packet.push_back(SPECTATOR_TICKS);
+    for(int i = 0; i < 4; ++i){
+        packet.push_back((uint8_t)(first >> (8*i)));
+    }
+    packet.push_back((uint8_t)count);
+    if(repeat){
+        packet.insert(packet.end(), m_previous.begin(), m_previous.end());
+    }
+    packet.insert(packet.end(), m_current.begin(), m_current.end());
+    for(const Viewer& viewer : m_viewers){
+        if(m_socket.SendTo(viewer.address, packet.data(), packet.size())){
+            m_bytesSent += packet.size();
+        }
+    }
+    m_previous.swap(m_current);
+    m_current.clear();
+    m_previousFirst = currentFirst;
+    m_previousCount = m_currentCount;
+    m_currentCount = 0;
+}
+
+// Constructor
+SpectatorViewer::SpectatorViewer(){
+
+}
+
+// Destructor
+SpectatorViewer::~SpectatorViewer(){
+
+}
+
+uint32_t SpectatorViewer::GetMilliseconds() const{
+    auto elapsed = std::chrono::steady_clock::now() - m_epoch;
+    return (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count();
+}
+
+bool SpectatorViewer::Start(const std::string& host, int port){
+    if(!m_socket.Open(0, host, port)){
+        return false;
+    }
+    m_epoch = std::chrono::steady_clock::now();
+    const uint8_t join[3] = {PACKET_MAGIC[0], PACKET_MAGIC[1], SPECTATOR_JOIN};
+    m_socket.Send(join, sizeof(join));
+    m_lastJoinMs = 0;
+    return true;
+}
+
+void SpectatorViewer::Poll(){
+    if(!IsRunning()){
+        return;
+    }
+    uint32_t now = GetMilliseconds();
+    if(now - m_lastJoinMs >= JOIN_INTERVAL_MS){
+        const uint8_t join[3] = {PACKET_MAGIC[0], PACKET_MAGIC[1], SPECTATOR_JOIN};
+        m_socket.Send(join, sizeof(join));
+        m_lastJoinMs = now;
+    }
+    uint8_t packet[MAX_PACKET_BYTES];
+    size_t size = 0;
+    while(m_socket.Receive(packet, sizeof(packet), size)){
+        m_bytesReceived += size;
+        ReadPacket(packet, size);
+    }
+}
+
+void SpectatorViewer::ReadPacket(const uint8_t* data, size_t size){
+    if(size < TICKS_HEADER_BYTES || std::memcmp(data, PACKET_MAGIC, sizeof(PACKET_MAGIC)) != 0 ||
+       data[2] != SPECTATOR_TICKS){
+        return;
+    }
+    uint32_t first = 0;
+    for(int i = 0; i < 4; ++i){
+        first |= (uint32_t)data[3 + i] << (8*i);
+    }
+    uint32_t count = data[7];
+    const uint8_t* next = data + TICKS_HEADER_BYTES;
+    const uint8_t* end = data + size;
+    size_t added = 0;
+    SpectatorFrame frame;
+    for(uint32_t i = 0; i < count; ++i){
+        uint32_t sequence = first + i;
+        const uint8_t* tick = next;
+        bool keyframe = false;
+        if(m_synced && sequence == m_expected){
+            if(!m_codec.Decode(next, end, true, frame, keyframe)){
+                return;
+            }
+        }else{
+            // Already seen, or past a gap only a keyframe gets over
+            if(!m_codec.Decode(next, end, false, frame, keyframe)){
+                return;
+            }
+            bool started = m_decoded > 0;
+            if(started && (int32_t)(sequence - m_expected) < 0){
+                continue;
+            }
+            if(!keyframe){
+                m_synced = false;
+                continue;
+            }
+            if(started){
+                m_lost += sequence - m_expected;
+            }
+            m_codec.Decode(tick, end, true, frame, keyframe);
+            m_synced = true;
+        }
+        m_expected = sequence + 1;
+        m_buffer.push_back(frame);
+        ++m_decoded;
+        ++added;
+    }
+    if(added > 0){
+        m_packetTicks = added;
+    }
+}
+
+bool SpectatorViewer::NextFrame(SpectatorFrame& frame){
+    if(!m_playing){
+        // A datagram's worth in hand covers the wait for the next one
+        if(m_buffer.size() <= m_packetTicks){
+            return false;
+        }
+        m_playing = true;
+    }
+    if(m_buffer.empty()){
+        m_playing = false;
+        return false;
+    }
+    while(m_buffer.size() > MAX_BUFFERED_PACKETS*m_packetTicks){
+        m_buffer.pop_front();
+    }
+    frame = m_buffer.front();
+    m_buffer.pop_front();
+    return true;
+}
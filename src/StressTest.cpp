@@ -0,0 +1,193 @@
+#include "StressTest.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+
+// Levels of a run, each double the one before, the last at the maximum
+static const int STRESS_LEVELS = 5;
+// Entities move by a 60 Hz clock of frames, not by real time
+static const double STRESS_FRAME_SECONDS = 1.0/60.0;
+// The region entities move through: x wraps around within half this
+// width of the dino, z lies between the dino's lane and STRESS_DEPTH
+// behind it. Part of it is always off the screen.
+static const float STRESS_WIDTH = 60.0f;
+static const float STRESS_DEPTH = 30.0f;
+// Height of a ghost dino's hop
+static const float STRESS_HOP_HEIGHT = 1.2f;
+
+// A number in [0, 1) from an entity index and a salt
+static float StressRandom(uint32_t index, uint32_t salt){
+    uint32_t x = index * 0x9E3779B9u ^ salt * 0x85EBCA6Bu;
+    x ^= x >> 16;
+    x *= 0x7FEB352Du;
+    x ^= x >> 15;
+    x *= 0x846CA68Bu;
+    x ^= x >> 16;
+    return (float)(x >> 8) * (1.0f / 16777216.0f);
+}
+
+// Constructor
+StressTest::StressTest(){
+
+}
+
+// Destructor
+StressTest::~StressTest(){
+
+}
+
+void StressTest::Begin(size_t maxEntities){
+    m_levels.clear();
+    m_level = 0;
+    m_levelFrame = 0;
+    m_frame = 0;
+    m_measuredLevel = -1;
+    if(maxEntities == 0){
+        return;
+    }
+    // Halving down from the maximum, smallest level first
+    std::vector<size_t> counts;
+    for(size_t count = maxEntities; count > 0 && counts.size() < (size_t)STRESS_LEVELS; count /= 2){
+        counts.push_back(count);
+    }
+    std::reverse(counts.begin(), counts.end());
+    for(size_t count : counts){
+        Level level;
+        level.entities = count;
+        m_levels.push_back(level);
+    }
+}
+
+size_t StressTest::GetEntityCount() const{
+    if(m_levels.empty()){
+        return 0;
+    }
+    return m_levels[std::min(m_level, m_levels.size() - 1)].entities;
+}
+
+size_t StressTest::GetGhostDinoCount(size_t count){
+    return count / GHOST_DINO_EVERY;
+}
+
+size_t StressTest::GetCactusCount(size_t count){
+    return count - GetGhostDinoCount(count);
+}
+
+StressPlacement StressTest::Place(size_t index, bool ghostDino) const{
+    uint32_t salt = ghostDino ? 2 : 1;
+    float seconds = (float)(m_frame * STRESS_FRAME_SECONDS);
+    float startX = (StressRandom((uint32_t)index, salt) - 0.5f) * STRESS_WIDTH;
+    float speed = 1.0f + 3.0f * StressRandom((uint32_t)index, salt + 16);
+    float phase = StressRandom((uint32_t)index, salt + 32);
+
+    StressPlacement placement;
+    // Towards -x like the track, wrapping around at the far side
+    float travelled = std::fmod(speed * seconds + (STRESS_WIDTH * 0.5f - startX), STRESS_WIDTH);
+    placement.x = STRESS_WIDTH * 0.5f - travelled;
+    placement.z = -StressRandom((uint32_t)index, salt + 48) * STRESS_DEPTH;
+    placement.y = 0.0f;
+    if(ghostDino){
+        placement.y = std::fabs(std::sin((seconds * speed * 0.5f + phase) * 3.14159265f)) * STRESS_HOP_HEIGHT;
+    }
+    return placement;
+}
+
+void StressTest::AddFrame(double frameMilliseconds, double cpuMilliseconds, size_t instances, size_t collisions){
+    m_measuredLevel = -1;
+    if(IsFinished()){
+        return;
+    }
+    ++m_frame;
+    Level& level = m_levels[m_level];
+    if(++m_levelFrame > SETTLE_FRAMES){
+        m_measuredLevel = (int)m_level;
+        level.frameTimes.push_back(frameMilliseconds);
+        level.cpuTimes.push_back(cpuMilliseconds);
+        level.instances += (double)instances;
+        level.collisions += (double)collisions;
+    }
+    if(m_levelFrame >= SETTLE_FRAMES + LEVEL_FRAMES){
+        ++m_level;
+        m_levelFrame = 0;
+    }
+}
+
+void StressTest::AddGPUFrame(double milliseconds){
+    // Results arrive frames late, those of the level before included
+    if(IsFinished() || m_levelFrame <= SETTLE_FRAMES){
+        return;
+    }
+    m_levels[m_level].gpuTimes.push_back(milliseconds);
+}
+
+void StressTest::AddEnergy(double joules){
+    if(m_measuredLevel < 0){
+        return;
+    }
+    m_levels[m_measuredLevel].joules += joules;
+    ++m_levels[m_measuredLevel].energyFrames;
+}
+
+// Mean of a list of times, 0 if it is empty
+static double Mean(const std::vector<double>& times){
+    if(times.empty()){
+        return 0.0;
+    }
+    double total = 0.0;
+    for(double time : times){
+        total += time;
+    }
+    return total / times.size();
+}
+
+// The p95 of a list of times, 0 if it is empty
+static double Percentile95(std::vector<double> times){
+    if(times.empty()){
+        return 0.0;
+    }
+    std::sort(times.begin(), times.end());
+    return times[std::min(times.size() - 1, (times.size() * 95) / 100)];
+}
+
+void StressTest::Report() const{
+    std::cout << "Stress test, " << LEVEL_FRAMES << " frames per level (ms, drawn and hit per frame):\n";
+    bool energy = false;
+    for(const Level& level : m_levels){
+        energy = energy || level.energyFrames > 0;
+    }
+    std::cout << "  entities     frame       p95       cpu       gpu     drawn       hit"
+              << (energy ? "  mJ/frame" : "") << "  us/added\n";
+    std::ios::fmtflags flags = std::cout.flags();
+    std::streamsize precision = std::cout.precision();
+    std::cout << std::fixed << std::setprecision(3);
+    double previousEntities = 0.0;
+    double previousFrame = 0.0;
+    for(const Level& level : m_levels){
+        double frames = (double)std::max<size_t>(1, level.frameTimes.size());
+        double frame = Mean(level.frameTimes);
+        std::cout << "  " << std::setw(8) << level.entities
+                  << std::setw(10) << frame
+                  << std::setw(10) << Percentile95(level.frameTimes)
+                  << std::setw(10) << Mean(level.cpuTimes)
+                  << std::setw(10) << Mean(level.gpuTimes)
+                  << std::setprecision(0)
+                  << std::setw(10) << level.instances / frames
+                  << std::setw(10) << level.collisions / frames
+                  << std::setprecision(3);
+        if(energy){
+            std::cout << std::setw(10) << level.joules * 1000.0 / std::max(1, level.energyFrames);
+        }
+        // What each entity added since the level before cost
+        if(previousEntities > 0.0 && (double)level.entities > previousEntities){
+            std::cout << std::setw(10) << (frame - previousFrame) * 1000.0 / ((double)level.entities - previousEntities);
+        }
+        std::cout << "\n";
+        previousEntities = (double)level.entities;
+        previousFrame = frame;
+    }
+    std::cout.flags(flags);
+    std::cout.precision(precision);
+}
@@ -0,0 +1,310 @@
+#include "TcpSocket.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#if defined(__linux__)
+#include <cerrno>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+// Constructor
+TcpSocket::TcpSocket(){
+
+}
+
+// Destructor
+TcpSocket::~TcpSocket(){
+    Close();
+}
+
+TcpSocket::TcpSocket(TcpSocket&& other)
+    : m_fd(other.m_fd), m_pending(std::move(other.m_pending)){
+    other.m_fd = -1;
+}
+
+TcpSocket& TcpSocket::operator=(TcpSocket&& other){
+    if(this != &other){
+        Close();
+        m_fd = other.m_fd;
+        m_pending = std::move(other.m_pending);
+        other.m_fd = -1;
+    }
+    return *this;
+}
+
+bool TcpSocket::TakeLine(std::string& line){
+    size_t end = m_pending.find('\n');
+    if(end == std::string::npos){
+        return false;
+    }
+    line.assign(m_pending, 0, end);
+    m_pending.erase(0, end + 1);
+    return true;
+}
+
+bool TcpSocket::SendLine(const std::string& line){
+    std::string message = line + "\n";
+    return SendAll(message.data(), message.size());
+}
+
+bool TcpSocket::ReceiveLine(std::string& line){
+    while(!TakeLine(line)){
+        if(!ReadAvailable()){
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ParseHostPort(const std::string& address, std::string& host, int& port){
+    size_t colon = address.rfind(':');
+    if(colon == std::string::npos || colon + 1 >= address.size()){
+        return false;
+    }
+    char* end = nullptr;
+    long value = strtol(address.c_str() + colon + 1, &end, 10);
+    if(*end != '\0' || value < 1 || value > 65535){
+        return false;
+    }
+    host = address.substr(0, colon);
+    port = (int)value;
+    return true;
+}
+
+#if defined(__linux__)
+
+bool TcpSocket::Listen(int port){
+    Close();
+    m_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if(m_fd < 0){
+        std::cout << "TcpSocket.cpp: socket failed: " << strerror(errno) << "\n";
+        return false;
+    }
+    // A restarted coordinator can take its port straight back
+    int reuse = 1;
+    setsockopt(m_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons((uint16_t)port);
+    if(bind(m_fd, (const sockaddr*)&address, sizeof(address)) != 0 || listen(m_fd, 64) != 0){
+        std::cout << "TcpSocket.cpp: could not listen on port " << port << ": " << strerror(errno) << "\n";
+        Close();
+        return false;
+    }
+    return true;
+}
+
+TcpSocket TcpSocket::Accept(){
+    TcpSocket connection;
+    int fd = accept(m_fd, nullptr, nullptr);
+    if(fd >= 0){
+        // Messages are short requests waiting on answers
+        int noDelay = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+        connection.m_fd = fd;
+    }
+    return connection;
+}
+
+bool TcpSocket::Connect(const std::string& host, int port){
+    Close();
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* addresses = nullptr;
+    std::string service = std::to_string(port);
+    int result = getaddrinfo(host.c_str(), service.c_str(), &hints, &addresses);
+    if(result != 0){
+        std::cout << "TcpSocket.cpp: could not resolve " << host << ": " << gai_strerror(result) << "\n";
+        return false;
+    }
+    for(addrinfo* address = addresses; address != nullptr; address = address->ai_next){
+        int fd = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+        if(fd < 0){
+            continue;
+        }
+        if(connect(fd, address->ai_addr, address->ai_addrlen) == 0){
+            int noDelay = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+            m_fd = fd;
+            break;
+        }
+        close(fd);
+    }
+    freeaddrinfo(addresses);
+    return m_fd >= 0;
+}
+
+// Fills address with path, false if it is too long for one
+static bool GetLocalAddress(const std::string& path, sockaddr_un& address){
+    address = sockaddr_un{};
+    address.sun_family = AF_UNIX;
+    if(path.empty() || path.size() >= sizeof(address.sun_path)){
+        std::cout << "TcpSocket.cpp: " << path << " is not a usable socket path\n";
+        return false;
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+
+bool TcpSocket::ListenLocal(const std::string& path){
+    Close();
+    sockaddr_un address;
+    if(!GetLocalAddress(path, address)){
+        return false;
+    }
+    m_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(m_fd < 0){
+        std::cout << "TcpSocket.cpp: socket failed: " << strerror(errno) << "\n";
+        return false;
+    }
+    // The socket a listener that went away left behind
+    unlink(path.c_str());
+    if(bind(m_fd, (const sockaddr*)&address, sizeof(address)) != 0 || listen(m_fd, 64) != 0){
+        std::cout << "TcpSocket.cpp: could not listen on " << path << ": " << strerror(errno) << "\n";
+        Close();
+        return false;
+    }
+    return true;
+}
+
+bool TcpSocket::ConnectLocal(const std::string& path){
+    Close();
+    sockaddr_un address;
+    if(!GetLocalAddress(path, address)){
+        return false;
+    }
+    m_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(m_fd < 0 || connect(m_fd, (const sockaddr*)&address, sizeof(address)) != 0){
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void TcpSocket::Close(){
+    if(m_fd >= 0){
+        close(m_fd);
+        m_fd = -1;
+    }
+    m_pending.clear();
+}
+
+int TcpSocket::GetPort() const{
+    sockaddr_in address{};
+    socklen_t length = sizeof(address);
+    if(m_fd < 0 || getsockname(m_fd, (sockaddr*)&address, &length) != 0){
+        return 0;
+    }
+    return ntohs(address.sin_port);
+}
+
+bool TcpSocket::SendAll(const void* data, size_t size){
+    const char* bytes = (const char*)data;
+    while(size > 0){
+        ssize_t sent = send(m_fd, bytes, size, MSG_NOSIGNAL);
+        if(sent < 0 && errno == EINTR){
+            continue;
+        }
+        if(sent <= 0){
+            return false;
+        }
+        bytes += sent;
+        size -= (size_t)sent;
+    }
+    return true;
+}
+
+bool TcpSocket::ReceiveAll(void* data, size_t size){
+    char* bytes = (char*)data;
+    // A line may have been read together with what follows it
+    size_t buffered = std::min(size, m_pending.size());
+    std::memcpy(bytes, m_pending.data(), buffered);
+    m_pending.erase(0, buffered);
+    bytes += buffered;
+    size -= buffered;
+    while(size > 0){
+        ssize_t received = recv(m_fd, bytes, size, 0);
+        if(received < 0 && errno == EINTR){
+            continue;
+        }
+        if(received <= 0){
+            return false;
+        }
+        bytes += received;
+        size -= (size_t)received;
+    }
+    return true;
+}
+
+bool TcpSocket::ReadAvailable(){
+    char buffer[4096];
+    for(;;){
+        ssize_t received = recv(m_fd, buffer, sizeof(buffer), 0);
+        if(received < 0 && errno == EINTR){
+            continue;
+        }
+        if(received <= 0){
+            return false;
+        }
+        m_pending.append(buffer, (size_t)received);
+        return true;
+    }
+}
+
+#else
+
+bool TcpSocket::Listen(int port){
+    std::cout << "TcpSocket.cpp: sockets need Linux\n";
+    return false;
+}
+
+TcpSocket TcpSocket::Accept(){
+    return TcpSocket();
+}
+
+bool TcpSocket::Connect(const std::string& host, int port){
+    std::cout << "TcpSocket.cpp: sockets need Linux\n";
+    return false;
+}
+
+bool TcpSocket::ListenLocal(const std::string& path){
+    std::cout << "TcpSocket.cpp: sockets need Linux\n";
+    return false;
+}
+
+bool TcpSocket::ConnectLocal(const std::string& path){
+    std::cout << "TcpSocket.cpp: sockets need Linux\n";
+    return false;
+}
+
+void TcpSocket::Close(){
+    m_pending.clear();
+}
+
+int TcpSocket::GetPort() const{
+    return 0;
+}
+
+bool TcpSocket::SendAll(const void* data, size_t size){
+    return false;
+}
+
+bool TcpSocket::ReceiveAll(void* data, size_t size){
+    return false;
+}
+
+bool TcpSocket::ReadAvailable(){
+    return false;
+}
+
+#endif
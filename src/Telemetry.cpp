@@ -0,0 +1,120 @@
+#include "Telemetry.hpp"
+
+#include <algorithm>
+#include <cstdio>
+
+// Adds to a counter only the calling thread writes
+static inline void Bump(std::atomic<uint64_t>& counter, uint64_t amount){
+    counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+Telemetry& Telemetry::Get(){
+    static Telemetry telemetry;
+    return telemetry;
+}
+
+// Constructor
+Telemetry::Telemetry()
+    : m_start(std::chrono::steady_clock::now()){
+
+}
+
+// Destructor
+Telemetry::~Telemetry(){
+
+}
+
+Telemetry::Block& Telemetry::GetThreadBlock(){
+    thread_local Block* block = nullptr;
+    if(block == nullptr){
+        std::lock_guard<std::mutex> lock(m_blocksMutex);
+        m_blocks.push_back(std::unique_ptr<Block>(new Block()));
+        block = m_blocks.back().get();
+    }
+    return *block;
+}
+
+void Telemetry::AddEpisode(int score, int formation){
+    Block& block = GetThreadBlock();
+    uint64_t value = (uint64_t)std::max(score, 0);
+    Bump(block.episodes, 1);
+    Bump(block.scoreSum, value);
+    if(value > block.scoreMax.load(std::memory_order_relaxed)){
+        block.scoreMax.store(value, std::memory_order_relaxed);
+    }
+    if(formation > 0){
+        Bump(block.collisions[std::min(formation, TELEMETRY_FORMATIONS) - 1], 1);
+    }
+}
+
+void Telemetry::AddSteps(uint64_t steps){
+    Bump(GetThreadBlock().steps, steps);
+}
+
+void Telemetry::AddRemoteSteps(uint64_t steps){
+    Bump(GetThreadBlock().remoteSteps, steps);
+}
+
+void Telemetry::AddFrame(double milliseconds){
+    int bucket = 0;
+    while(bucket < TELEMETRY_FRAME_BUCKETS - 1 && milliseconds >= TELEMETRY_FRAME_EDGES[bucket]){
+        ++bucket;
+    }
+    Block& block = GetThreadBlock();
+    Bump(block.frames[bucket], 1);
+    Bump(block.frameMicroseconds, (uint64_t)(std::max(milliseconds, 0.0) * 1000.0));
+}
+
+TelemetrySnapshot Telemetry::Snapshot() const{
+    TelemetrySnapshot snapshot;
+    std::lock_guard<std::mutex> lock(m_blocksMutex);
+    for(const std::unique_ptr<Block>& block : m_blocks){
+        snapshot.episodes += block->episodes.load(std::memory_order_relaxed);
+        snapshot.scoreSum += block->scoreSum.load(std::memory_order_relaxed);
+        snapshot.scoreMax = std::max(snapshot.scoreMax, block->scoreMax.load(std::memory_order_relaxed));
+        for(int i = 0; i < TELEMETRY_FORMATIONS; ++i){
+            snapshot.collisions[i] += block->collisions[i].load(std::memory_order_relaxed);
+        }
+        snapshot.steps += block->steps.load(std::memory_order_relaxed);
+        snapshot.remoteSteps += block->remoteSteps.load(std::memory_order_relaxed);
+        for(int i = 0; i < TELEMETRY_FRAME_BUCKETS; ++i){
+            snapshot.frames[i] += block->frames[i].load(std::memory_order_relaxed);
+        }
+        snapshot.frameMicroseconds += block->frameMicroseconds.load(std::memory_order_relaxed);
+    }
+    snapshot.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+    return snapshot;
+}
+
+double TelemetrySnapshot::GetStepsPerSecond(const TelemetrySnapshot* earlier) const{
+    double elapsed = seconds - (earlier != nullptr ? earlier->seconds : 0.0);
+    uint64_t stepped = steps - (earlier != nullptr ? earlier->steps : 0);
+    return (elapsed > 0.0) ? (double)stepped / elapsed : 0.0;
+}
+
+std::string TelemetrySnapshot::Format(const TelemetrySnapshot* earlier) const{
+    char line[512];
+    int length = snprintf(line, sizeof(line),
+                          "%llu episodes, mean score %.1f, best %llu, collisions 1/2/3+ cacti %llu/%llu/%llu, %.0f steps/s",
+                          (unsigned long long)episodes, GetMeanScore(), (unsigned long long)scoreMax,
+                          (unsigned long long)collisions[0], (unsigned long long)collisions[1],
+                          (unsigned long long)collisions[2], GetStepsPerSecond(earlier));
+    uint64_t stepped = steps - (earlier != nullptr ? earlier->steps : 0);
+    uint64_t remote = remoteSteps - (earlier != nullptr ? earlier->remoteSteps : 0);
+    if(remote > 0 && stepped > 0 && length > 0 && (size_t)length < sizeof(line)){
+        length += snprintf(line + length, sizeof(line) - length, " (%.1f%% on a remote NUMA node)",
+                           100.0 * (double)remote / (double)stepped);
+    }
+    uint64_t frameCount = 0;
+    for(int i = 0; i < TELEMETRY_FRAME_BUCKETS; ++i){
+        frameCount += frames[i];
+    }
+    if(frameCount > 0 && length > 0 && (size_t)length < sizeof(line)){
+        length += snprintf(line + length, sizeof(line) - length, ", frames <4/8.5/17/34/67/more ms");
+        for(int i = 0; i < TELEMETRY_FRAME_BUCKETS && (size_t)length < sizeof(line); ++i){
+            length += snprintf(line + length, sizeof(line) - length, "%c%llu", (i == 0) ? ' ' : '/',
+                               (unsigned long long)frames[i]);
+        }
+    }
+    return line;
+}
@@ -6,10 +6,15 @@
 
 
 #include "Texture.hpp"
+#include "GLBackend.hpp"
+#include "GLStateCache.hpp"
+#include "GPUResourceTracker.hpp"
+#include "KTXFile.hpp"
 
 #include <stdio.h>
 #include <string.h>
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <glad/glad.h>
@@ -24,30 +29,107 @@ Texture::Texture(){
 // Default Destructor
 Texture::~Texture(){
 	// Delete our texture from the GPU
-	glDeleteTextures(1,&m_textureID);
+	if(m_textureID != 0){
+		glDeleteTextures(1,&m_textureID);
+		GPUResourceTracker::Get().Deleted(GPU_TEXTURE, m_textureID);
+		GLStateCache::Get().Invalidate();
+	}
 
     // Delete our image
     if(m_image != nullptr){
         delete m_image;
     }
+    if(m_ktx != nullptr){
+        delete m_ktx;
+    }
 
 }
 
 void Texture::LoadTexture(const std::string filepath){
+    Decode(filepath);
+    Upload();
+}
+
+void Texture::Decode(const std::string& filepath){
+	// Free the data of a previous load so it does not leak
+	if(m_image != nullptr){
+		delete m_image;
+		m_image = nullptr;
+	}
+	if(m_ktx != nullptr){
+		delete m_ktx;
+		m_ktx = nullptr;
+	}
+
 	// Set member variable
     m_filepath = filepath;
+    if(filepath.size() > 4 && filepath.compare(filepath.size() - 4, 4, ".ktx") == 0){
+        m_ktx = new KTXFile();
+        if(!m_ktx->Load(filepath)){
+            delete m_ktx;
+            m_ktx = nullptr;
+        }
+        return;
+    }
     // Load our actual image data
     // This method loads .ppm files of pixel data
     m_image = new Image(filepath);
-    m_image->LoadPPM(true);
+    // Padded to RGBA, so the rows upload as they are
+    m_image->LoadPPM(true, true);
+}
+
+size_t Texture::Upload(){
+    // Nothing decoded since the last upload, which stays
+    bool hasPixels = m_image != nullptr && m_image->GetPixelDataPtr() != nullptr;
+    if(m_ktx == nullptr && !hasPixels){
+        return 0;
+    }
+	// Free the texture of a previous load so it does not leak
+	if(m_textureID != 0){
+		glDeleteTextures(1,&m_textureID);
+		GPUResourceTracker::Get().Deleted(GPU_TEXTURE, m_textureID);
+		m_textureID = 0;
+		GLStateCache::Get().Invalidate();
+	}
+    if(m_ktx != nullptr){
+        m_bytes = UploadCompressed(*m_ktx);
+        // The levels are on the GPU, the mapped file is not needed anymore
+        delete m_ktx;
+        m_ktx = nullptr;
+        return m_bytes;
+    }
+    m_bytes = UploadImage();
+    // GL has its own copy now; a 4K background would otherwise be
+    // resident twice
+    if(!m_keepPixels){
+        delete m_image;
+        m_image = nullptr;
+    }
+    return m_bytes;
+}
+
+size_t Texture::UploadImage(){
+    size_t bytes = (size_t)m_image->GetWidth() * m_image->GetHeight() * 4;
+    if(GLBackend::Get().HasDirectStateAccess()){
+        // Created, set up and filled by name, nothing is bound
+        m_textureID = GLBackend::Get().CreateTexture(GL_TEXTURE_2D);
+        glTextureParameteri(m_textureID, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTextureParameteri(m_textureID, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTextureParameteri(m_textureID, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTextureParameteri(m_textureID, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTextureStorage2D(m_textureID, 1, GL_RGBA8, m_image->GetWidth(), m_image->GetHeight());
+        glTextureSubImage2D(m_textureID, 0, 0, 0, m_image->GetWidth(), m_image->GetHeight(),
+                            GL_RGBA, GL_UNSIGNED_BYTE, m_image->GetPixelDataPtr());
+        GPUResourceTracker::Get().Created(GPU_TEXTURE, m_textureID, "texture", bytes);
+        return bytes;
+    }
 
-    glEnable(GL_TEXTURE_2D); 
 		// Generate a buffer for our texture
     glGenTextures(1,&m_textureID);
     // Similar to our vertex buffers, we now 'select'
     // a texture we want to bind to.
     // Note the type of data is 'GL_TEXTURE_2D'
-    glBindTexture(GL_TEXTURE_2D, m_textureID);
+    GLStateCache::Get().BindTexture(0, GL_TEXTURE_2D, m_textureID);
 		// Now we are going to setup some information about
 	 	// our textures.
 	 	// There are four parameters that must be set.
@@ -59,23 +141,131 @@ void Texture::LoadTexture(const std::string filepath){
   	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE); 
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE); 
 		// At this point, we are now ready to load and send some data to OpenGL.
-		glTexImage2D(GL_TEXTURE_2D,
+		// A .ppm has no mips and the filter above never samples any, so
+		// only level 0 is allocated, immutable where the driver allows.
+		if(GLAD_GL_ARB_texture_storage){
+			glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, m_image->GetWidth(), m_image->GetHeight());
+			glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0,
+							m_image->GetWidth(),
+							m_image->GetHeight(),
+							GL_RGBA,
+							GL_UNSIGNED_BYTE,
+							m_image->GetPixelDataPtr()); // Here is the raw pixel data
+		}else{
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+			glTexImage2D(GL_TEXTURE_2D,
 							0 ,
-	  					GL_RGB,
+	  					GL_RGBA8,
                         m_image->GetWidth(),
                         m_image->GetHeight(),
 		  				0,
-			  			GL_RGB,
+			  			GL_RGBA,
 				  		GL_UNSIGNED_BYTE,
 					  	m_image->GetPixelDataPtr()); // Here is the raw pixel data
-    // We are done with our texture data so we can unbind.
-    // Generate a mipmap
-    glGenerateMipmap(GL_TEXTURE_2D);                        
+		}
+    GPUResourceTracker::Get().Created(GPU_TEXTURE, m_textureID, "texture", bytes);
 		// We are done with our texture data so we can unbind.    
-		glBindTexture(GL_TEXTURE_2D, 0);
+		GLStateCache::Get().BindTexture(0, GL_TEXTURE_2D, 0);
+    return bytes;
 }
 
 
+size_t Texture::UploadCompressed(const KTXFile& ktx){
+    if(!IsFormatSupported(ktx.GetInternalFormat())){
+        std::cout << "Texture.cpp: " << m_filepath << " is in a compressed format this GPU cannot sample\n";
+        return 0;
+    }
+
+    // Trilinear only with a stored mip chain, nothing is generated here
+    bool mipmapped = ktx.GetLevelCount() > 1;
+    size_t bytes = 0;
+    if(GLBackend::Get().HasDirectStateAccess()){
+        m_textureID = GLBackend::Get().CreateTexture(GL_TEXTURE_2D);
+        glTextureParameteri(m_textureID, GL_TEXTURE_MIN_FILTER, mipmapped ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+        glTextureParameteri(m_textureID, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTextureParameteri(m_textureID, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTextureParameteri(m_textureID, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTextureStorage2D(m_textureID, ktx.GetLevelCount(), ktx.GetInternalFormat(), ktx.GetWidth(), ktx.GetHeight());
+        for(int level = 0; level < ktx.GetLevelCount(); ++level){
+            GLsizei width = std::max(1, ktx.GetWidth() >> level);
+            GLsizei height = std::max(1, ktx.GetHeight() >> level);
+            glCompressedTextureSubImage2D(m_textureID, level, 0, 0, width, height, ktx.GetInternalFormat(),
+                                          (GLsizei)ktx.GetLevelSize(level), ktx.GetLevelData(level));
+            bytes += ktx.GetLevelSize(level);
+        }
+        GPUResourceTracker::Get().Created(GPU_TEXTURE, m_textureID, "compressed texture", bytes);
+        return bytes;
+    }
+
+    glGenTextures(1,&m_textureID);
+    GLStateCache::Get().BindTexture(0, GL_TEXTURE_2D, m_textureID);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, mipmapped ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    // The stored levels, uploaded one by one into storage made for exactly
+    // that many; mutable storage needs the last level named instead
+    bool immutable = GLAD_GL_ARB_texture_storage != 0;
+    if(immutable){
+        glTexStorage2D(GL_TEXTURE_2D, ktx.GetLevelCount(), ktx.GetInternalFormat(), ktx.GetWidth(), ktx.GetHeight());
+    }else{
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, ktx.GetLevelCount() - 1);
+    }
+    for(int level = 0; level < ktx.GetLevelCount(); ++level){
+        GLsizei width = std::max(1, ktx.GetWidth() >> level);
+        GLsizei height = std::max(1, ktx.GetHeight() >> level);
+        if(immutable){
+            glCompressedTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, width, height, ktx.GetInternalFormat(),
+                                      (GLsizei)ktx.GetLevelSize(level), ktx.GetLevelData(level));
+        }else{
+            glCompressedTexImage2D(GL_TEXTURE_2D, level, ktx.GetInternalFormat(), width, height, 0,
+                                   (GLsizei)ktx.GetLevelSize(level), ktx.GetLevelData(level));
+        }
+        bytes += ktx.GetLevelSize(level);
+    }
+    GPUResourceTracker::Get().Created(GPU_TEXTURE, m_textureID, "compressed texture", bytes);
+    GLStateCache::Get().BindTexture(0, GL_TEXTURE_2D, 0);
+    return bytes;
+}
+
+bool Texture::IsFormatSupported(GLenum internalFormat){
+    switch(internalFormat){
+        case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+        case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+        case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+            return GLAD_GL_EXT_texture_compression_s3tc != 0;
+        case GL_COMPRESSED_RGBA_BPTC_UNORM:
+        case GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM:
+            return GLAD_GL_ARB_texture_compression_bptc != 0 ||
+                   GLVersion.major > 4 || (GLVersion.major == 4 && GLVersion.minor >= 2);
+        case GL_COMPRESSED_RGB8_ETC2:
+        case GL_COMPRESSED_SRGB8_ETC2:
+        case GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2:
+        case GL_COMPRESSED_RGBA8_ETC2_EAC:
+        case GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC:
+            return GLAD_GL_ARB_ES3_compatibility != 0 ||
+                   GLVersion.major > 4 || (GLVersion.major == 4 && GLVersion.minor >= 3);
+        default:
+            return false;
+    }
+}
+
+std::vector<std::string> Texture::GetCompressedSuffixes(){
+    // BC7 keeps the most detail at 8 bits per texel, BC1 is half of that.
+    // Desktop drivers often decode ETC2 in software, so it comes last.
+    std::vector<std::string> suffixes;
+    if(IsFormatSupported(GL_COMPRESSED_RGBA_BPTC_UNORM)){
+        suffixes.push_back(".bc7.ktx");
+    }
+    if(IsFormatSupported(GL_COMPRESSED_RGB_S3TC_DXT1_EXT)){
+        suffixes.push_back(".bc1.ktx");
+    }
+    if(IsFormatSupported(GL_COMPRESSED_RGB8_ETC2)){
+        suffixes.push_back(".etc2.ktx");
+    }
+    return suffixes;
+}
+
 // slot tells us which slot we want to bind to.
 // We can have multiple slots. By default, we
 // will set our slot to 0 if it is not specified.
@@ -85,13 +275,11 @@ void Texture::Bind(unsigned int slot) const{
 	// be multiple at once.
 	// At the time of writing, OpenGL supports 8-32 depending
 	// on your hardware.
-  glEnable(GL_TEXTURE_2D);
-	glActiveTexture(GL_TEXTURE0+slot);
-	glBindTexture(GL_TEXTURE_2D, m_textureID);
+	GLStateCache::Get().BindTexture(slot, GL_TEXTURE_2D, m_textureID);
 }
 
 void Texture::Unbind(){
-	glBindTexture(GL_TEXTURE_2D, 0);
+	GLStateCache::Get().BindTexture(0, GL_TEXTURE_2D, 0);
 }
 
 
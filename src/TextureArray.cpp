@@ -0,0 +1,204 @@
+#include "TextureArray.hpp"
+#include "GLBackend.hpp"
+#include "GLStateCache.hpp"
+#include "GPUResourceTracker.hpp"
+#include "Image.hpp"
+#include "KTXFile.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <memory>
+
+// Constructor
+TextureArray::TextureArray(){
+
+}
+
+// Destructor
+TextureArray::~TextureArray(){
+    if(m_textureID != 0){
+        std::cout << "TextureArray.cpp: texture array was never released\n";
+    }
+}
+
+int TextureArray::AddImage(const std::string& filepath){
+    int layer = GetLayer(filepath);
+    if(layer >= 0){
+        return layer;
+    }
+    m_filepaths.push_back(filepath);
+    return (int)m_filepaths.size() - 1;
+}
+
+int TextureArray::GetLayer(const std::string& filepath) const{
+    for(size_t i = 0; i < m_filepaths.size(); ++i){
+        if(m_filepaths[i] == filepath){
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+bool TextureArray::Build(){
+    if(m_filepaths.empty()){
+        return false;
+    }
+
+    // Decode every layer first so the sizes can be checked
+    std::vector<std::unique_ptr<Image>> images;
+    images.reserve(m_filepaths.size());
+    for(const std::string& filepath : m_filepaths){
+        std::unique_ptr<Image> image(new Image(filepath));
+        image->LoadPPM(true, true);
+        if(image->GetPixelDataPtr() == nullptr){
+            std::cout << "TextureArray.cpp: could not load " << filepath << "\n";
+            return false;
+        }
+        if(!images.empty() && (image->GetWidth() != images[0]->GetWidth() ||
+                               image->GetHeight() != images[0]->GetHeight())){
+            std::cout << "TextureArray.cpp: " << filepath << " is "
+                      << image->GetWidth() << "x" << image->GetHeight()
+                      << ", every layer must be " << images[0]->GetWidth()
+                      << "x" << images[0]->GetHeight() << "\n";
+            return false;
+        }
+        images.push_back(std::move(image));
+    }
+    Allocate(images[0]->GetWidth(), images[0]->GetHeight());
+    for(size_t layer = 0; layer < images.size(); ++layer){
+        UploadRows((int)layer, 0, m_height, images[layer]->GetPixelDataPtr());
+    }
+    return true;
+}
+
+void TextureArray::Allocate(int width, int height, GLenum internalFormat, int levels){
+    m_width = width;
+    m_height = height;
+    m_internalFormat = internalFormat;
+    m_levels = levels;
+    GLsizei layers = (GLsizei)m_filepaths.size();
+    bool compressed = KTXFile::GetBlockBytes(internalFormat) > 0;
+    size_t bytes = 0;
+    for(int level = 0; level < levels; ++level){
+        GLsizei levelWidth = std::max(1, m_width >> level);
+        GLsizei levelHeight = std::max(1, m_height >> level);
+        bytes += (compressed ? KTXFile::GetImageBytes(internalFormat, levelWidth, levelHeight)
+                             : (size_t)levelWidth * levelHeight * 4) * layers;
+    }
+    if(GLBackend::Get().HasDirectStateAccess()){
+        AllocateDirect(layers);
+    }else{
+        AllocateBound(layers, compressed);
+    }
+    GPUResourceTracker::Get().Resized(GPU_TEXTURE, m_textureID, bytes);
+}
+
+void TextureArray::AllocateDirect(GLsizei layers){
+    // Storage is always immutable here, so a new size is a new texture
+    Release();
+    m_textureID = GLBackend::Get().CreateTexture(GL_TEXTURE_2D_ARRAY);
+    GPUResourceTracker::Get().Created(GPU_TEXTURE, m_textureID, "texture array");
+    glTextureParameteri(m_textureID, GL_TEXTURE_MIN_FILTER, (m_levels > 1) ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTextureParameteri(m_textureID, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTextureParameteri(m_textureID, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(m_textureID, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTextureStorage3D(m_textureID, m_levels, m_internalFormat, m_width, m_height, layers);
+}
+
+void TextureArray::AllocateBound(GLsizei layers, bool compressed){
+    if(GLAD_GL_ARB_texture_storage || m_bindlessHandle != 0){
+        // Immutable storage, or a texture with a handle, cannot be
+        // respecified, so start a new texture
+        Release();
+    }
+    if(m_textureID == 0){
+        glGenTextures(1, &m_textureID);
+        GPUResourceTracker::Get().Created(GPU_TEXTURE, m_textureID, "texture array");
+    }
+    GLStateCache::Get().BindTexture(0, GL_TEXTURE_2D_ARRAY, m_textureID);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, (m_levels > 1) ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    if(GLAD_GL_ARB_texture_storage){
+        glTexStorage3D(GL_TEXTURE_2D_ARRAY, m_levels, m_internalFormat, m_width, m_height, layers);
+    }else{
+        for(int level = 0; level < m_levels; ++level){
+            GLsizei levelWidth = std::max(1, m_width >> level);
+            GLsizei levelHeight = std::max(1, m_height >> level);
+            if(compressed){
+                size_t layerBytes = KTXFile::GetImageBytes(m_internalFormat, levelWidth, levelHeight);
+                glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, level, m_internalFormat, levelWidth, levelHeight, layers,
+                                       0, (GLsizei)(layerBytes * layers), nullptr);
+            }else{
+                glTexImage3D(GL_TEXTURE_2D_ARRAY, level, m_internalFormat, levelWidth, levelHeight, layers,
+                             0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+            }
+        }
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, m_levels - 1);
+    }
+    GLStateCache::Get().BindTexture(0, GL_TEXTURE_2D_ARRAY, 0);
+}
+
+void TextureArray::UploadRows(int layer, int firstRow, int rowCount, const uint8_t* texels){
+    if(GLBackend::Get().HasDirectStateAccess()){
+        glTextureSubImage3D(m_textureID, 0, 0, firstRow, layer, m_width, rowCount, 1,
+                            GL_RGBA, GL_UNSIGNED_BYTE, texels);
+        return;
+    }
+    GLStateCache::Get().BindTexture(0, GL_TEXTURE_2D_ARRAY, m_textureID);
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, firstRow, layer, m_width, rowCount, 1,
+                    GL_RGBA, GL_UNSIGNED_BYTE, texels);
+    GLStateCache::Get().BindTexture(0, GL_TEXTURE_2D_ARRAY, 0);
+}
+
+void TextureArray::UploadCompressedRows(int layer, int level, int firstRow, int rowCount, const char* blocks, size_t bytes){
+    GLsizei levelWidth = std::max(1, m_width >> level);
+    if(GLBackend::Get().HasDirectStateAccess()){
+        glCompressedTextureSubImage3D(m_textureID, level, 0, firstRow, layer, levelWidth, rowCount, 1,
+                                      m_internalFormat, (GLsizei)bytes, blocks);
+        return;
+    }
+    GLStateCache::Get().BindTexture(0, GL_TEXTURE_2D_ARRAY, m_textureID);
+    glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, firstRow, layer, levelWidth, rowCount, 1,
+                              m_internalFormat, (GLsizei)bytes, blocks);
+    GLStateCache::Get().BindTexture(0, GL_TEXTURE_2D_ARRAY, 0);
+}
+
+void TextureArray::CopyFramebuffer(int layer, int width, int height){
+    if(GLBackend::Get().HasDirectStateAccess()){
+        glCopyTextureSubImage3D(m_textureID, 0, 0, 0, layer, 0, 0, width, height);
+        return;
+    }
+    GLStateCache::Get().BindTexture(0, GL_TEXTURE_2D_ARRAY, m_textureID);
+    glCopyTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, 0, 0, width, height);
+    GLStateCache::Get().BindTexture(0, GL_TEXTURE_2D_ARRAY, 0);
+}
+
+void TextureArray::Bind(unsigned int slot) const{
+    GLStateCache::Get().BindTexture(slot, GL_TEXTURE_2D_ARRAY, m_textureID);
+}
+
+GLuint64 TextureArray::GetBindlessHandle(){
+    if(m_bindlessHandle == 0 && m_textureID != 0 && GLAD_GL_ARB_bindless_texture){
+        m_bindlessHandle = glGetTextureHandleARB(m_textureID);
+        if(m_bindlessHandle != 0){
+            glMakeTextureHandleResidentARB(m_bindlessHandle);
+        }
+    }
+    return m_bindlessHandle;
+}
+
+void TextureArray::Release(){
+    if(m_bindlessHandle != 0){
+        // The handle goes with the texture, but must not stay resident
+        glMakeTextureHandleNonResidentARB(m_bindlessHandle);
+        m_bindlessHandle = 0;
+    }
+    if(m_textureID != 0){
+        glDeleteTextures(1, &m_textureID);
+        GPUResourceTracker::Get().Deleted(GPU_TEXTURE, m_textureID);
+        m_textureID = 0;
+        GLStateCache::Get().Invalidate();
+    }
+}
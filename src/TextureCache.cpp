@@ -0,0 +1,166 @@
+#include "TextureCache.hpp"
+#include "AssetLoader.hpp"
+#include "GLStateCache.hpp"
+#include "GPUResourceTracker.hpp"
+
+#include <iostream>
+
+// Constructor
+TextureCache::TextureCache(){
+
+}
+
+// Destructor
+TextureCache::~TextureCache(){
+    if(GetResidentCount() != 0){
+        std::cout << "TextureCache.cpp: " << GetResidentCount()
+                  << " texture(s) were never released\n";
+        // The GL context is most likely gone by now, so leak the
+        // names instead of calling glDeleteTextures on a dead context.
+        new std::vector<Entry>(std::move(m_entries));
+    }
+}
+
+void TextureCache::Initialize(AssetLoader& loader, ResidencyManager& residency){
+    m_loader = &loader;
+    m_residency = &residency;
+    if(m_placeholder != 0){
+        return;
+    }
+    // Mid grey, so a missing texture reads as neither lit nor dark
+    const unsigned char pixel[4] = {128, 128, 128, 255};
+    glGenTextures(1, &m_placeholder);
+    GLStateCache::Get().BindTexture(0, GL_TEXTURE_2D, m_placeholder);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixel);
+    GPUResourceTracker::Get().Created(GPU_TEXTURE, m_placeholder, "texture placeholder", sizeof(pixel));
+    GLStateCache::Get().BindTexture(0, GL_TEXTURE_2D, 0);
+}
+
+TextureHandle TextureCache::Acquire(const std::string& filepath){
+    if(m_loader == nullptr){
+        std::cout << "TextureCache.cpp: " << filepath << " acquired before Initialize()\n";
+        return INVALID_TEXTURE;
+    }
+    auto it = m_lookup.find(filepath);
+    if(it != m_lookup.end()){
+        Entry& entry = m_entries[it->second];
+        if(entry.refCount > 0){
+            ++entry.refCount;
+            return it->second;
+        }
+    }
+
+    // First use (or previously freed), so request it now.
+    TextureHandle handle;
+    if(it != m_lookup.end()){
+        handle = it->second;
+    }else{
+        handle = (TextureHandle)m_entries.size();
+        m_entries.push_back(Entry());
+        m_lookup[filepath] = handle;
+    }
+    Entry& entry = m_entries[handle];
+    entry.filepath = filepath;
+    entry.refCount = 1;
+    // Eviction only drops the future: the texture frees its GL name
+    // once the loader is done with it too
+    entry.residency = m_residency->Register(filepath, [this, handle]{
+        m_entries[handle].texture = AssetFuture<Texture>();
+    });
+    Stream(handle);
+    return handle;
+}
+
+void TextureCache::Stream(TextureHandle handle){
+    Entry& entry = m_entries[handle];
+    entry.texture = m_loader->RequestTexture(entry.filepath);
+    m_residency->SetStreaming(entry.residency);
+    m_streaming.push_back(handle);
+}
+
+void TextureCache::Release(TextureHandle handle){
+    if(handle >= m_entries.size()){
+        return;
+    }
+    Entry& entry = m_entries[handle];
+    if(entry.refCount == 0){
+        return;
+    }
+    --entry.refCount;
+    if(entry.refCount == 0){
+        entry.texture = AssetFuture<Texture>();
+        m_residency->Unregister(entry.residency);
+        entry.residency = INVALID_RESIDENCY;
+    }
+}
+
+void TextureCache::Bind(TextureHandle handle, unsigned int slot){
+    if(handle >= m_entries.size() || m_entries[handle].refCount == 0){
+        return;
+    }
+    Entry& entry = m_entries[handle];
+    m_residency->Touch(entry.residency);
+    if(entry.texture.IsReady()){
+        entry.texture.Get().Bind(slot);
+        return;
+    }
+    if(!entry.texture.IsValid()){
+        // Evicted; wanted again, so it comes back in the background
+        Stream(handle);
+    }
+    GLStateCache::Get().BindTexture(slot, GL_TEXTURE_2D, m_placeholder);
+}
+
+Texture* TextureCache::Get(TextureHandle handle) const{
+    if(handle >= m_entries.size() || !m_entries[handle].texture.IsReady()){
+        return nullptr;
+    }
+    return &m_entries[handle].texture.Get();
+}
+
+void TextureCache::Update(){
+    size_t kept = 0;
+    for(size_t i = 0; i < m_streaming.size(); ++i){
+        Entry& entry = m_entries[m_streaming[i]];
+        if(!entry.texture.IsValid()){
+            // Released while it streamed
+            continue;
+        }
+        if(entry.texture.IsReady()){
+            m_residency->SetResident(entry.residency, entry.texture.Get().GetBytes());
+            continue;
+        }
+        m_streaming[kept++] = m_streaming[i];
+    }
+    m_streaming.resize(kept);
+}
+
+size_t TextureCache::GetResidentCount() const{
+    size_t count = 0;
+    for(const Entry& entry : m_entries){
+        if(entry.texture.IsReady()){
+            ++count;
+        }
+    }
+    return count;
+}
+
+void TextureCache::Clear(){
+    for(Entry& entry : m_entries){
+        if(entry.residency != INVALID_RESIDENCY){
+            m_residency->Unregister(entry.residency);
+        }
+    }
+    m_entries.clear();
+    m_lookup.clear();
+    m_streaming.clear();
+    if(m_placeholder != 0){
+        glDeleteTextures(1, &m_placeholder);
+        GPUResourceTracker::Get().Deleted(GPU_TEXTURE, m_placeholder);
+        m_placeholder = 0;
+        GLStateCache::Get().Invalidate();
+    }
+}
@@ -0,0 +1,238 @@
+#include "ThreadAffinity.hpp"
+
+#if defined(MINGW) || defined(_WIN32)
+    #ifndef WIN32_LEAN_AND_MEAN
+    #define WIN32_LEAN_AND_MEAN 1
+    #endif
+    #include <windows.h>
+#elif defined(LINUX) || defined(__linux__)
+    #include <pthread.h>
+    #include <sched.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+    #define AFFINITY_PTHREAD 1
+#endif
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+// Where a hardware thread sits
+struct CoreInfo{
+    unsigned int cpu;
+    int package;
+    int core;
+    // Index of the hardware thread among its core's, and of the core
+    // among its package's
+    unsigned int sibling{0};
+    unsigned int coreRank{0};
+};
+
+// The hardware threads the process may run on
+static std::vector<unsigned int> GetAllowedCores(){
+    std::vector<unsigned int> cores;
+#if defined(MINGW) || defined(_WIN32)
+    DWORD_PTR process = 0;
+    DWORD_PTR system = 0;
+    if(GetProcessAffinityMask(GetCurrentProcess(), &process, &system)){
+        for(unsigned int cpu = 0; cpu < sizeof(DWORD_PTR) * 8; ++cpu){
+            if(process & ((DWORD_PTR)1 << cpu)){
+                cores.push_back(cpu);
+            }
+        }
+    }
+#elif defined(AFFINITY_PTHREAD)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if(sched_getaffinity(0, sizeof(set), &set) == 0){
+        for(unsigned int cpu = 0; cpu < CPU_SETSIZE; ++cpu){
+            if(CPU_ISSET(cpu, &set)){
+                cores.push_back(cpu);
+            }
+        }
+    }
+#endif
+    if(cores.empty()){
+        unsigned int count = std::max(1u, std::thread::hardware_concurrency());
+        for(unsigned int cpu = 0; cpu < count; ++cpu){
+            cores.push_back(cpu);
+        }
+    }
+    return cores;
+}
+
+// Reads a number from a sysfs file, -1 if there is none
+static int ReadTopology(unsigned int cpu, const char* name){
+    std::ifstream file("/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/" + name);
+    int value = -1;
+    if(!(file >> value)){
+        return -1;
+    }
+    return value;
+}
+
+// The package and physical core of cpu
+static void FindCore(CoreInfo& info){
+#if defined(AFFINITY_PTHREAD)
+    info.package = ReadTopology(info.cpu, "physical_package_id");
+    info.core = ReadTopology(info.cpu, "core_id");
+    if(info.package >= 0 && info.core >= 0){
+        return;
+    }
+#endif
+    info.package = 0;
+    info.core = (int)(info.cpu / 2);
+}
+
+bool ParseAffinityPolicy(const std::string& text, AffinityPolicy& policy){
+    if(text == "none"){
+        policy = AFFINITY_NONE;
+    }else if(text == "compact"){
+        policy = AFFINITY_COMPACT;
+    }else if(text == "scatter"){
+        policy = AFFINITY_SCATTER;
+    }else{
+        return false;
+    }
+    return true;
+}
+
+bool ParseCoreList(const std::string& text, std::vector<unsigned int>& cores){
+    cores.clear();
+    size_t begin = 0;
+    while(begin < text.size()){
+        size_t end = text.find(',', begin);
+        if(end == std::string::npos){
+            end = text.size();
+        }
+        std::string item = text.substr(begin, end - begin);
+        size_t dash = item.find('-');
+        char* rest = nullptr;
+        unsigned long first = std::strtoul(item.c_str(), &rest, 10);
+        unsigned long last = first;
+        if(rest == item.c_str() || (dash == std::string::npos && *rest != '\0')){
+            return false;
+        }
+        if(dash != std::string::npos){
+            const char* second = item.c_str() + dash + 1;
+            last = std::strtoul(second, &rest, 10);
+            if(rest == second || *rest != '\0' || last < first){
+                return false;
+            }
+        }
+        for(unsigned long core = first; core <= last; ++core){
+            cores.push_back((unsigned int)core);
+        }
+        begin = end + 1;
+    }
+    return !cores.empty();
+}
+
+std::vector<unsigned int> GetAffinityOrder(const AffinityConfig& config){
+    std::vector<unsigned int> order;
+    if(config.policy == AFFINITY_NONE){
+        return order;
+    }
+    std::vector<CoreInfo> cores;
+    for(unsigned int cpu : GetAllowedCores()){
+        if(std::find(config.excluded.begin(), config.excluded.end(), cpu) != config.excluded.end()){
+            continue;
+        }
+        CoreInfo info;
+        info.cpu = cpu;
+        FindCore(info);
+        cores.push_back(info);
+    }
+
+    // Compact order: package by package, each core's siblings together
+    std::sort(cores.begin(), cores.end(), [](const CoreInfo& a, const CoreInfo& b){
+        if(a.package != b.package){
+            return a.package < b.package;
+        }
+        if(a.core != b.core){
+            return a.core < b.core;
+        }
+        return a.cpu < b.cpu;
+    });
+    for(size_t i = 1; i < cores.size(); ++i){
+        const CoreInfo& previous = cores[i - 1];
+        if(cores[i].package != previous.package){
+            continue;
+        }
+        if(cores[i].core == previous.core){
+            cores[i].sibling = previous.sibling + 1;
+            cores[i].coreRank = previous.coreRank;
+        }else{
+            cores[i].coreRank = previous.coreRank + 1;
+        }
+    }
+    if(config.policy == AFFINITY_SCATTER){
+        // First siblings of every core before any second one, the
+        // packages taking turns
+        std::stable_sort(cores.begin(), cores.end(), [](const CoreInfo& a, const CoreInfo& b){
+            if(a.sibling != b.sibling){
+                return a.sibling < b.sibling;
+            }
+            if(a.coreRank != b.coreRank){
+                return a.coreRank < b.coreRank;
+            }
+            return a.package < b.package;
+        });
+    }
+    for(const CoreInfo& info : cores){
+        order.push_back(info.cpu);
+    }
+    return order;
+}
+
+bool PinCurrentThread(unsigned int core){
+#if defined(MINGW) || defined(_WIN32)
+    if(core >= sizeof(DWORD_PTR) * 8){
+        return false;
+    }
+    return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << core) != 0;
+#elif defined(AFFINITY_PTHREAD)
+    if(core >= CPU_SETSIZE){
+        return false;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(core, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)core;
+    return false;
+#endif
+}
+
+void PinPoolThread(const AffinityConfig& config, const std::vector<unsigned int>& order,
+                   unsigned int index){
+    if(order.empty() || (index == 0 && !config.pinCaller)){
+        return;
+    }
+    unsigned int core = order[index % order.size()];
+    if(!PinCurrentThread(core)){
+        std::cout << "ThreadAffinity.cpp: unable to pin thread " << index << " to core " << core << "\n";
+    }
+}
+
+int GetCurrentNumaNode(){
+#if defined(MINGW) || defined(_WIN32)
+    UCHAR node = 0;
+    if(!GetNumaProcessorNode((UCHAR)GetCurrentProcessorNumber(), &node) || node == 0xFF){
+        return -1;
+    }
+    return (int)node;
+#elif defined(AFFINITY_PTHREAD) && defined(SYS_getcpu)
+    unsigned int cpu = 0;
+    unsigned int node = 0;
+    if(syscall(SYS_getcpu, &cpu, &node, nullptr) != 0){
+        return -1;
+    }
+    return (int)node;
+#else
+    return -1;
+#endif
+}
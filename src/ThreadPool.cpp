@@ -0,0 +1,116 @@
+#include "ThreadPool.hpp"
+
+// Constructor
+ThreadPool::ThreadPool(unsigned int threadCount, const AffinityConfig& affinity)
+    : m_affinity(affinity), m_cores(GetAffinityOrder(affinity)){
+    if(threadCount == 0){
+        threadCount = std::thread::hardware_concurrency();
+        if(threadCount == 0){
+            threadCount = 1;
+        }
+    }
+    for(unsigned int i = 0; i < threadCount; ++i){
+        m_queues.emplace_back(new Queue());
+    }
+    // Thread 0 is whoever calls Run()
+    PinPoolThread(m_affinity, m_cores, 0);
+    for(unsigned int i = 1; i < threadCount; ++i){
+        m_threads.emplace_back(&ThreadPool::WorkerMain, this, i);
+    }
+}
+
+// Destructor
+ThreadPool::~ThreadPool(){
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    for(std::thread& thread : m_threads){
+        thread.join();
+    }
+}
+
+void ThreadPool::Run(size_t taskCount, const std::function<void(size_t)>& task, bool steal){
+    if(taskCount == 0){
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_task = &task;
+        m_steal = steal;
+        m_remaining = taskCount;
+        // Every thread starts with a contiguous range of tasks
+        size_t threads = m_queues.size();
+        for(size_t t = 0; t < threads; ++t){
+            size_t begin = taskCount * t / threads;
+            size_t end = taskCount * (t + 1) / threads;
+            std::lock_guard<std::mutex> queueLock(m_queues[t]->mutex);
+            for(size_t i = begin; i < end; ++i){
+                m_queues[t]->tasks.push_back(i);
+            }
+        }
+        ++m_generation;
+    }
+    m_wake.notify_all();
+
+    Work(0);
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this]{ return m_remaining == 0; });
+    m_task = nullptr;
+}
+
+void ThreadPool::WorkerMain(unsigned int index){
+    PinPoolThread(m_affinity, m_cores, index);
+    unsigned long seen = 0;
+    while(true){
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [&]{ return m_stop || m_generation != seen; });
+            if(m_stop){
+                return;
+            }
+            seen = m_generation;
+        }
+        Work(index);
+    }
+}
+
+void ThreadPool::Work(unsigned int index){
+    size_t task;
+    // Tasks are only added by Run(), so once every deque is empty there is
+    // nothing left to find; tasks still running are finished by their thread.
+    while(PopLocal(index, task) || (m_steal && Steal(index, task))){
+        (*m_task)(task);
+        if(--m_remaining == 0){
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_done.notify_all();
+        }
+    }
+}
+
+bool ThreadPool::PopLocal(unsigned int index, size_t& task){
+    Queue& queue = *m_queues[index];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if(queue.tasks.empty()){
+        return false;
+    }
+    task = queue.tasks.back();
+    queue.tasks.pop_back();
+    return true;
+}
+
+bool ThreadPool::Steal(unsigned int thief, size_t& task){
+    size_t threads = m_queues.size();
+    for(size_t offset = 1; offset < threads; ++offset){
+        Queue& queue = *m_queues[(thief + offset) % threads];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if(!queue.tasks.empty()){
+            task = queue.tasks.front();
+            queue.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,177 @@
+#include "TraceRecorder.hpp"
+
+#include <fstream>
+#include <iostream>
+
+// Track ids in the file: threads are 1, 2, ..., the GPU comes after them
+const int TRACE_PROCESS = 1;
+const int GPU_TRACK_OFFSET = 1000;
+
+// Constructor
+TraceRecorder::TraceRecorder(){
+
+}
+
+// Destructor
+TraceRecorder::~TraceRecorder(){
+
+}
+
+void TraceRecorder::Begin(const std::string& filepath, int maxFrames){
+    // Startup (loads, one-off zones) gets room for a few frames' worth
+    size_t frames = (maxFrames > 0) ? (size_t)maxFrames : 1;
+    Begin(filepath, maxFrames, (frames + 16) * EVENTS_PER_FRAME, SDL_GetPerformanceCounter());
+}
+
+void TraceRecorder::Begin(const std::string& filepath, int maxFrames, size_t maxEvents, uint64_t startCounter){
+    m_filepath = filepath;
+    m_maxFrames = (maxFrames > 0) ? maxFrames : 1;
+    m_frame = 0;
+    m_maxEvents = maxEvents;
+    m_events.clear();
+    m_events.reserve(m_maxEvents);
+    m_startCounter = startCounter;
+    m_microsecondsPerCount = 1000000.0/(double)SDL_GetPerformanceFrequency();
+    m_recording = true;
+}
+
+int TraceRecorder::AddName(const std::string& name){
+    for(size_t i = 0; i < m_names.size(); ++i){
+        if(m_names[i] == name){
+            return (int)i;
+        }
+    }
+    m_names.push_back(name);
+    return (int)m_names.size() - 1;
+}
+
+void TraceRecorder::SyncGPUClock(int64_t gpuNanoseconds){
+    SyncGPUClock(gpuNanoseconds, SDL_GetPerformanceCounter());
+}
+
+void TraceRecorder::SyncGPUClock(int64_t gpuNanoseconds, uint64_t counter){
+    double cpu = CounterToMicroseconds(counter);
+    m_gpuOffset = gpuNanoseconds / 1000.0 - cpu;
+    m_gpuSynced = true;
+}
+
+double TraceRecorder::CounterToMicroseconds(uint64_t counter) const{
+    return (double)(int64_t)(counter - m_startCounter) * m_microsecondsPerCount;
+}
+
+void TraceRecorder::Push(const Event& event){
+    if(!m_recording){
+        return;
+    }
+    if(m_events.size() == m_maxEvents){
+        std::cout << "TraceRecorder.cpp: trace buffer full after " << m_frame << " frames\n";
+        m_recording = false;
+        return;
+    }
+    m_events.push_back(event);
+}
+
+void TraceRecorder::AddZone(int name, int thread, uint64_t start, uint64_t end){
+    Event event = {EVENT_ZONE, name, thread, CounterToMicroseconds(start), CounterToMicroseconds(end)};
+    if(thread > m_highestThread){
+        m_highestThread = thread;
+    }
+    Push(event);
+}
+
+void TraceRecorder::AddGPUPass(int name, uint64_t start, uint64_t end){
+    if(!m_gpuSynced){
+        return;
+    }
+    Event event = {EVENT_GPU_PASS, name, 0, start / 1000.0 - m_gpuOffset, end / 1000.0 - m_gpuOffset};
+    Push(event);
+}
+
+void TraceRecorder::AddAsync(int name, uint64_t start, uint64_t end){
+    Event event = {EVENT_ASYNC, name, 0, CounterToMicroseconds(start), CounterToMicroseconds(end)};
+    Push(event);
+}
+
+void TraceRecorder::AddCounter(int name, uint64_t counter, double value){
+    Event event = {EVENT_COUNTER, name, 0, CounterToMicroseconds(counter), value};
+    Push(event);
+}
+
+void TraceRecorder::EndFrame(){
+    if(m_recording && ++m_frame >= m_maxFrames){
+        m_recording = false;
+    }
+}
+
+// Writes a string as a JSON string literal
+static void WriteJSONString(std::ofstream& file, const std::string& text){
+    file << '"';
+    for(char c : text){
+        if(c == '"' || c == '\\'){
+            file << '\\' << c;
+        }else if((unsigned char)c < 0x20){
+            file << ' ';
+        }else{
+            file << c;
+        }
+    }
+    file << '"';
+}
+
+// Writes the track name metadata event
+static void WriteTrackName(std::ofstream& file, int track, const std::string& name){
+    file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << TRACE_PROCESS
+         << ",\"tid\":" << track << ",\"args\":{\"name\":";
+    WriteJSONString(file, name);
+    file << "}},\n";
+}
+
+bool TraceRecorder::Write(){
+    if(m_filepath.empty()){
+        return false;
+    }
+    m_recording = false;
+    std::ofstream file(m_filepath.c_str(), std::ios::trunc);
+    if(!file.is_open()){
+        std::cout << "TraceRecorder.cpp: could not open " << m_filepath << "\n";
+        return false;
+    }
+    file.precision(3);
+    file << std::fixed;
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    WriteTrackName(file, 1, "main");
+    for(int thread = 2; thread <= m_highestThread; ++thread){
+        WriteTrackName(file, thread, "thread " + std::to_string(thread));
+    }
+    WriteTrackName(file, GPU_TRACK_OFFSET, "GPU");
+
+    for(size_t i = 0; i < m_events.size(); ++i){
+        const Event& event = m_events[i];
+        file << "{\"name\":";
+        WriteJSONString(file, m_names[event.name]);
+        if(event.type == EVENT_COUNTER){
+            file << ",\"ph\":\"C\",\"pid\":" << TRACE_PROCESS << ",\"ts\":" << event.start
+                 << ",\"args\":{\"value\":" << event.end << "}}";
+        }else if(event.type == EVENT_ASYNC){
+            // A begin/end pair, matched by id
+            file << ",\"cat\":\"load\",\"ph\":\"b\",\"id\":" << i << ",\"pid\":" << TRACE_PROCESS
+                 << ",\"tid\":1,\"ts\":" << event.start << "},\n";
+            file << "{\"name\":";
+            WriteJSONString(file, m_names[event.name]);
+            file << ",\"cat\":\"load\",\"ph\":\"e\",\"id\":" << i << ",\"pid\":" << TRACE_PROCESS
+                 << ",\"tid\":1,\"ts\":" << event.end << "}";
+        }else{
+            int track = (event.type == EVENT_GPU_PASS) ? GPU_TRACK_OFFSET : event.thread;
+            file << ",\"cat\":\"" << ((event.type == EVENT_GPU_PASS) ? "gpu" : "cpu")
+                 << "\",\"ph\":\"X\",\"pid\":" << TRACE_PROCESS << ",\"tid\":" << track
+                 << ",\"ts\":" << event.start << ",\"dur\":" << (event.end - event.start) << "}";
+        }
+        file << ",\n";
+    }
+    // The format allows no trailing comma, so end on an empty metadata event
+    file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << TRACE_PROCESS
+         << ",\"args\":{\"name\":\"dino\"}}\n]}\n";
+    std::cout << "Wrote " << m_events.size() << " trace events over " << m_frame << " frames to "
+              << m_filepath << "\n";
+    return true;
+}
@@ -0,0 +1,82 @@
+#include "TransformHierarchy.hpp"
+
+#include <algorithm>
+
+// Constructor
+TransformHierarchy::TransformHierarchy(){
+
+}
+
+// Destructor
+TransformHierarchy::~TransformHierarchy(){
+
+}
+
+void TransformHierarchy::Reserve(size_t count){
+    m_parents.reserve(count);
+    m_local.reserve(count);
+    m_world.reserve(count);
+    m_dirty.reserve(count);
+    m_updated.reserve(count);
+}
+
+void TransformHierarchy::Clear(){
+    m_parents.clear();
+    m_local.clear();
+    m_world.clear();
+    m_dirty.clear();
+    m_updated.clear();
+    m_firstDirty = 0;
+    m_changedCount = 0;
+}
+
+uint32_t TransformHierarchy::Add(uint32_t parent, const Transform& local){
+    if(parent != NO_TRANSFORM_NODE && parent >= m_parents.size()){
+        return NO_TRANSFORM_NODE;
+    }
+    uint32_t node = (uint32_t)m_parents.size();
+    m_parents.push_back(parent);
+    m_local.push_back(local);
+    m_world.push_back(local);
+    m_dirty.push_back(1);
+    // Not changed by any update so far
+    m_updated.push_back(m_generation - 1);
+    m_firstDirty = std::min(m_firstDirty, (size_t)node);
+    return node;
+}
+
+void TransformHierarchy::SetLocal(uint32_t node, const Transform& local){
+    m_local[node] = local;
+    m_dirty[node] = 1;
+    m_firstDirty = std::min(m_firstDirty, (size_t)node);
+}
+
+size_t TransformHierarchy::Update(){
+    ++m_generation;
+    m_changedCount = 0;
+    const size_t count = m_parents.size();
+    for(size_t node = m_firstDirty; node < count; ++node){
+        uint32_t parent = m_parents[node];
+        bool moved = m_dirty[node] != 0 || (parent != NO_TRANSFORM_NODE && m_updated[parent] == m_generation);
+        if(!moved){
+            continue;
+        }
+        const Transform& local = m_local[node];
+        Transform& world = m_world[node];
+        if(parent == NO_TRANSFORM_NODE){
+            world = local;
+        }else{
+            // The parent comes first, so it is up to date already
+            const Transform& above = m_world[parent];
+            world.x = above.x + local.x*above.scale;
+            world.y = above.y + local.y*above.scale;
+            world.z = above.z + local.z*above.scale;
+            world.scale = local.scale*above.scale;
+        }
+        m_dirty[node] = 0;
+        m_updated[node] = m_generation;
+        ++m_changedCount;
+    }
+    m_firstDirty = count;
+    return m_changedCount;
+}
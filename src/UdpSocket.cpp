@@ -0,0 +1,145 @@
+#include "UdpSocket.hpp"
+
+#include <cstring>
+#include <iostream>
+
+#if defined(__linux__)
+#include <cerrno>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+// Constructor
+UdpSocket::UdpSocket(){
+
+}
+
+// Destructor
+UdpSocket::~UdpSocket(){
+    Close();
+}
+
+bool UdpSocket::Receive(void* data, size_t capacity, size_t& size){
+    UdpAddress sender;
+    while(ReceiveFrom(data, capacity, size, sender)){
+        if(sender == m_peer){
+            return true;
+        }
+    }
+    return false;
+}
+
+#if defined(__linux__)
+
+bool UdpSocket::Open(int port){
+    Close();
+    m_fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if(m_fd < 0){
+        std::cout << "UdpSocket.cpp: socket failed: " << strerror(errno) << "\n";
+        return false;
+    }
+    int reuse = 1;
+    setsockopt(m_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons((uint16_t)port);
+    if(bind(m_fd, (const sockaddr*)&address, sizeof(address)) != 0){
+        std::cout << "UdpSocket.cpp: could not bind port " << port << ": " << strerror(errno) << "\n";
+        Close();
+        return false;
+    }
+    fcntl(m_fd, F_SETFL, fcntl(m_fd, F_GETFL) | O_NONBLOCK);
+    return true;
+}
+
+bool UdpSocket::Open(int port, const std::string& host, int peerPort){
+    addrinfo hints{};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    addrinfo* addresses = nullptr;
+    std::string service = std::to_string(peerPort);
+    int result = getaddrinfo(host.c_str(), service.c_str(), &hints, &addresses);
+    if(result != 0 || addresses == nullptr){
+        std::cout << "UdpSocket.cpp: could not resolve " << host << ": " << gai_strerror(result) << "\n";
+        return false;
+    }
+    const sockaddr_in* peer = (const sockaddr_in*)addresses->ai_addr;
+    m_peer.ip = ntohl(peer->sin_addr.s_addr);
+    m_peer.port = ntohs(peer->sin_port);
+    freeaddrinfo(addresses);
+    return Open(port);
+}
+
+void UdpSocket::Close(){
+    if(m_fd >= 0){
+        close(m_fd);
+        m_fd = -1;
+    }
+}
+
+bool UdpSocket::SendTo(const UdpAddress& address, const void* data, size_t size){
+    if(m_fd < 0){
+        return false;
+    }
+    sockaddr_in target{};
+    target.sin_family = AF_INET;
+    target.sin_addr.s_addr = htonl(address.ip);
+    target.sin_port = htons(address.port);
+    ssize_t sent = sendto(m_fd, data, size, MSG_NOSIGNAL, (const sockaddr*)&target, sizeof(target));
+    return sent == (ssize_t)size;
+}
+
+bool UdpSocket::ReceiveFrom(void* data, size_t capacity, size_t& size, UdpAddress& sender){
+    if(m_fd < 0){
+        return false;
+    }
+    for(;;){
+        sockaddr_in source{};
+        socklen_t length = sizeof(source);
+        ssize_t received = recvfrom(m_fd, data, capacity, 0, (sockaddr*)&source, &length);
+        if(received < 0 && errno == EINTR){
+            continue;
+        }
+        if(received < 0){
+            // EAGAIN: nothing waiting. A peer that is not up yet shows as
+            // ECONNREFUSED, which is only a lost datagram here.
+            if(errno == ECONNREFUSED){
+                continue;
+            }
+            return false;
+        }
+        sender.ip = ntohl(source.sin_addr.s_addr);
+        sender.port = ntohs(source.sin_port);
+        size = (size_t)received;
+        return true;
+    }
+}
+
+#else
+
+bool UdpSocket::Open(int port){
+    std::cout << "UdpSocket.cpp: sockets need Linux\n";
+    return false;
+}
+
+bool UdpSocket::Open(int port, const std::string& host, int peerPort){
+    return Open(port);
+}
+
+void UdpSocket::Close(){
+
+}
+
+bool UdpSocket::SendTo(const UdpAddress& address, const void* data, size_t size){
+    return false;
+}
+
+bool UdpSocket::ReceiveFrom(void* data, size_t capacity, size_t& size, UdpAddress& sender){
+    return false;
+}
+
+#endif
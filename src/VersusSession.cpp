@@ -0,0 +1,228 @@
+#include "VersusSession.hpp"
+#include "InputLog.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+// Packet layout, little endian: magic, seed, the sender's next step, the
+// receiver's inputs it holds, the step of the first input carried, the
+// input count, the sender's frame advantage, its send time and the echo
+// of the receiver's, then the inputs
+static const char PACKET_MAGIC[4] = {'D', 'V', 'S', '1'};
+static const size_t PACKET_HEADER_BYTES = 34;
+static const size_t PACKET_MAX_BYTES = PACKET_HEADER_BYTES + VersusSession::PACKET_INPUTS;
+static const uint32_t NO_MISMATCH = 0xFFFFFFFFu;
+// Steps between two waits that bring the sides level
+static const uint32_t SYNC_INTERVAL = 10;
+
+static void PutUint(uint8_t* bytes, uint64_t value, int count){
+    for(int i = 0; i < count; ++i){
+        bytes[i] = (uint8_t)((value >> (8*i)) & 0xff);
+    }
+}
+
+static uint64_t GetUint(const uint8_t* bytes, int count){
+    uint64_t value = 0;
+    for(int i = 0; i < count; ++i){
+        value |= (uint64_t)bytes[i] << (8*i);
+    }
+    return value;
+}
+
+// Constructor
+VersusSession::VersusSession() : m_mismatch(NO_MISMATCH){
+
+}
+
+// Destructor
+VersusSession::~VersusSession(){
+
+}
+
+bool VersusSession::Start(int port, const std::string& host, int peerPort, uint64_t seed, int inputDelay){
+    if(!m_socket.Open(port, host, peerPort)){
+        return false;
+    }
+    m_seed = seed;
+    m_inputDelay = (uint32_t)std::max(0, std::min(inputDelay, (int)MAX_INPUT_DELAY));
+    m_connected = false;
+    m_frame = 0;
+    std::memset(m_localInputs, 0, sizeof(m_localInputs));
+    std::memset(m_remoteInputs, 0, sizeof(m_remoteInputs));
+    std::memset(m_usedInputs, 0, sizeof(m_usedInputs));
+    m_remoteConfirmed = 0;
+    m_peerAck = 0;
+    m_mismatch = NO_MISMATCH;
+    ResetGameState(m_remote, seed, 0);
+    m_remoteGamesPlayed = 0;
+    m_remoteJump = JumpAnchor();
+    m_remotePalette = 0;
+    m_epoch = std::chrono::steady_clock::now();
+    m_active.store(true, std::memory_order_release);
+    return true;
+}
+
+uint32_t VersusSession::GetMilliseconds() const{
+    auto elapsed = std::chrono::steady_clock::now() - m_epoch;
+    // Never 0, which stands for no echo
+    return (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count() + 1;
+}
+
+bool VersusSession::Poll(){
+    if(!IsActive()){
+        return false;
+    }
+    uint8_t packet[PACKET_MAX_BYTES + 1];
+    size_t size = 0;
+    uint32_t now = GetMilliseconds();
+    while(m_socket.Receive(packet, sizeof(packet), size)){
+        if(size < PACKET_HEADER_BYTES || size > PACKET_MAX_BYTES ||
+           std::memcmp(packet, PACKET_MAGIC, sizeof(PACKET_MAGIC)) != 0){
+            continue;
+        }
+        uint64_t seed = GetUint(packet + 4, 8);
+        if(seed != m_seed){
+            if(!m_seedWarned){
+                std::cout << "VersusSession.cpp: the opponent races seed " << seed << ", not " << m_seed
+                          << "; start both with the same --seed\n";
+                m_seedWarned = true;
+            }
+            continue;
+        }
+        uint32_t count = packet[24];
+        if(PACKET_HEADER_BYTES + count > size){
+            continue;
+        }
+        if(!m_connected){
+            m_connected = true;
+            std::cout << "Opponent connected, the race is on\n";
+        }
+        m_lastReceiveMs = now;
+        uint32_t frame = (uint32_t)GetUint(packet + 12, 4);
+        // Packets may come out of order, only newer ones move these
+        if(frame >= m_remoteFrame){
+            m_remoteFrame = frame;
+            m_remoteAdvantage = (int8_t)packet[25];
+            m_echoMs = (uint32_t)GetUint(packet + 26, 4);
+            uint32_t echo = (uint32_t)GetUint(packet + 30, 4);
+            if(echo != 0 && echo <= now){
+                m_roundTripMs = now - echo;
+            }
+        }
+        m_peerAck = std::max(m_peerAck, (uint32_t)GetUint(packet + 16, 4));
+        AddRemoteInputs((uint32_t)GetUint(packet + 20, 4), packet + PACKET_HEADER_BYTES, count);
+    }
+    if(m_connected && now - m_lastReceiveMs > (uint32_t)TIMEOUT_SECONDS*1000){
+        std::cout << "The opponent stopped answering, the race is over\n";
+        m_active.store(false, std::memory_order_release);
+        m_socket.Close();
+        return false;
+    }
+    SendInputs();
+
+    if(!m_connected){
+        return false;
+    }
+    // The opponent's inputs may be ahead of this side as well as behind
+    if(m_frame >= m_remoteConfirmed + MAX_PREDICTION || m_frame + m_inputDelay - m_peerAck >= HISTORY - PACKET_INPUTS){
+        return false;
+    }
+    // Both sides see the other behind by the one-way latency, so half
+    // the difference of the two advantages is how far this side leads
+    if(m_syncCooldown > 0){
+        --m_syncCooldown;
+    }else if((int)(m_frame - m_remoteFrame) - m_remoteAdvantage >= 2){
+        m_syncCooldown = SYNC_INTERVAL;
+        return false;
+    }
+    return true;
+}
+
+void VersusSession::SendInputs(){
+    uint8_t packet[PACKET_MAX_BYTES];
+    // Inputs are known up to an input delay past the last step
+    uint32_t first = m_peerAck;
+    uint32_t known = m_frame + m_inputDelay;
+    uint32_t count = std::min(known - std::min(first, known), (uint32_t)PACKET_INPUTS);
+    std::memcpy(packet, PACKET_MAGIC, sizeof(PACKET_MAGIC));
+    PutUint(packet + 4, m_seed, 8);
+    PutUint(packet + 12, m_frame, 4);
+    PutUint(packet + 16, m_remoteConfirmed, 4);
+    PutUint(packet + 20, first, 4);
+    packet[24] = (uint8_t)count;
+    int advantage = m_connected ? (int)(m_frame - m_remoteFrame) : 0;
+    packet[25] = (uint8_t)(int8_t)std::max(-127, std::min(advantage, 127));
+    PutUint(packet + 26, GetMilliseconds(), 4);
+    PutUint(packet + 30, m_echoMs, 4);
+    for(uint32_t i = 0; i < count; ++i){
+        packet[PACKET_HEADER_BYTES + i] = m_localInputs[(first + i) % HISTORY];
+    }
+    // A lost packet is made up for by the next one
+    m_socket.Send(packet, PACKET_HEADER_BYTES + count);
+}
+
+void VersusSession::AddRemoteInputs(uint32_t first, const uint8_t* inputs, uint32_t count){
+    for(uint32_t i = 0; i < count; ++i){
+        uint32_t frame = first + i;
+        if(frame < m_remoteConfirmed){
+            continue;
+        }
+        // Only in order, and never over inputs a rollback may still need
+        if(frame > m_remoteConfirmed || frame >= m_frame + HISTORY - MAX_PREDICTION){
+            break;
+        }
+        m_remoteInputs[frame % HISTORY] = inputs[i];
+        if(frame < m_frame && m_usedInputs[frame % HISTORY] != inputs[i] && m_mismatch == NO_MISMATCH){
+            m_mismatch = frame;
+        }
+        ++m_remoteConfirmed;
+    }
+}
+
+void VersusSession::StepRemote(uint32_t frame){
+    Snapshot& snapshot = m_snapshots[frame % HISTORY];
+    snapshot.game = m_remote;
+    snapshot.gamesPlayed = m_remoteGamesPlayed;
+    snapshot.jump = m_remoteJump;
+    snapshot.palette = m_remotePalette;
+
+    uint8_t input = 0;
+    if(frame < m_remoteConfirmed){
+        input = m_remoteInputs[frame % HISTORY];
+    }else if(m_remoteConfirmed > 0){
+        // The opponent is taken to keep doing what it did, but not to
+        // start another game
+        input = m_remoteInputs[(m_remoteConfirmed - 1) % HISTORY] & ~INPUT_RESTART;
+    }
+    m_usedInputs[frame % HISTORY] = input;
+    if(input & INPUT_RESTART){
+        m_remoteJump = JumpAnchor();
+    }
+    StepLoggedInput(m_remote, input, m_seed, m_remoteGamesPlayed);
+    UpdateJumpAnchor(m_remoteJump, (int)frame + 1, m_remote.dinoHeight, m_remote.jumpingUp, m_remote.jumpingSpeed);
+    m_remotePalette = (uint8_t)GetInputPalette(input);
+}
+
+uint8_t VersusSession::Advance(uint8_t localInput){
+    if(m_mismatch != NO_MISMATCH){
+        // Back to before the first wrong step, then forward again with
+        // what is known now
+        const Snapshot& snapshot = m_snapshots[m_mismatch % HISTORY];
+        m_remote = snapshot.game;
+        m_remoteGamesPlayed = snapshot.gamesPlayed;
+        m_remoteJump = snapshot.jump;
+        m_remotePalette = snapshot.palette;
+        for(uint32_t frame = m_mismatch; frame < m_frame; ++frame){
+            StepRemote(frame);
+        }
+        ++m_rollbacks;
+        m_resimulated += m_frame - m_mismatch;
+        m_mismatch = NO_MISMATCH;
+    }
+    m_localInputs[(m_frame + m_inputDelay) % HISTORY] = localInput;
+    uint8_t input = m_localInputs[m_frame % HISTORY];
+    StepRemote(m_frame);
+    ++m_frame;
+    return input;
+}
@@ -0,0 +1,111 @@
+#include "VertexFormat.hpp"
+
+#include <cmath>
+#include <cstring>
+
+uint16_t FloatToHalf(float value){
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    uint32_t sign = (bits >> 16) & 0x8000u;
+    int32_t exponent = (int32_t)((bits >> 23) & 0xFFu) - 127 + 15;
+    uint32_t mantissa = bits & 0x007FFFFFu;
+
+    // NaN and infinity
+    if(((bits >> 23) & 0xFFu) == 0xFFu){
+        return (uint16_t)(sign | 0x7C00u | (mantissa ? 0x200u : 0u));
+    }
+    // Too large, clamp to infinity
+    if(exponent >= 31){
+        return (uint16_t)(sign | 0x7C00u);
+    }
+    // Subnormal or zero
+    if(exponent <= 0){
+        if(exponent < -10){
+            return (uint16_t)sign;
+        }
+        mantissa |= 0x00800000u;
+        uint32_t shift = (uint32_t)(14 - exponent);
+        uint32_t half = mantissa >> shift;
+        uint32_t remainder = mantissa & ((1u << shift) - 1u);
+        uint32_t halfway = 1u << (shift - 1u);
+        if(remainder > halfway || (remainder == halfway && (half & 1u))){
+            ++half;
+        }
+        return (uint16_t)(sign | half);
+    }
+
+    uint32_t half = sign | ((uint32_t)exponent << 10) | (mantissa >> 13);
+    uint32_t remainder = mantissa & 0x1FFFu;
+    // Round to nearest even; a carry correctly bumps the exponent
+    if(remainder > 0x1000u || (remainder == 0x1000u && (half & 1u))){
+        ++half;
+    }
+    return (uint16_t)half;
+}
+
+float HalfToFloat(uint16_t value){
+    uint32_t sign = ((uint32_t)value & 0x8000u) << 16;
+    uint32_t exponent = ((uint32_t)value >> 10) & 0x1Fu;
+    uint32_t mantissa = (uint32_t)value & 0x3FFu;
+    uint32_t bits;
+
+    if(exponent == 0){
+        if(mantissa == 0){
+            bits = sign;
+        }else{
+            // Normalise the subnormal
+            exponent = 127 - 15 + 1;
+            while((mantissa & 0x400u) == 0){
+                mantissa <<= 1;
+                --exponent;
+            }
+            mantissa &= 0x3FFu;
+            bits = sign | (exponent << 23) | (mantissa << 13);
+        }
+    }else if(exponent == 0x1Fu){
+        bits = sign | 0x7F800000u | (mantissa << 13);
+    }else{
+        bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+    }
+
+    float result;
+    memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+// Maps [-1,1] to a signed 10-bit integer
+static uint32_t PackSnorm10(float value){
+    if(value > 1.0f){ value = 1.0f; }
+    if(value < -1.0f){ value = -1.0f; }
+    int32_t scaled = (int32_t)std::lround(value * 511.0f);
+    return (uint32_t)scaled & 0x3FFu;
+}
+
+uint32_t PackNormal(float nx, float ny, float nz){
+    return PackSnorm10(nx) | (PackSnorm10(ny) << 10) | (PackSnorm10(nz) << 20);
+}
+
+void PackVertices(const float* interleaved, size_t vertexCount, std::vector<PackedVertex>& out){
+    out.resize(vertexCount);
+    for(size_t i = 0; i < vertexCount; ++i){
+        const float* v = interleaved + i*FLOATS_PER_VERTEX;
+        PackedVertex& packed = out[i];
+        packed.x = v[0];
+        packed.y = v[1];
+        packed.z = v[2];
+        packed.normal = PackNormal(v[3], v[4], v[5]);
+        packed.u = FloatToHalf(v[6]);
+        packed.v = FloatToHalf(v[7]);
+    }
+}
+
+void ExtractPositions(const float* interleaved, size_t vertexCount, std::vector<float>& out){
+    out.resize(vertexCount * 3);
+    for(size_t i = 0; i < vertexCount; ++i){
+        const float* v = interleaved + i*FLOATS_PER_VERTEX;
+        out[i*3] = v[0];
+        out[i*3 + 1] = v[1];
+        out[i*3 + 2] = v[2];
+    }
+}
@@ -0,0 +1,268 @@
+#include "VideoCapture.hpp"
+#include "GPUResourceTracker.hpp"
+
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+
+// Constructor
+VideoCapture::VideoCapture(){
+
+}
+
+// Destructor
+VideoCapture::~VideoCapture(){
+    if(m_file != nullptr){
+        std::cout << "VideoCapture.cpp: capture was never ended\n";
+    }
+}
+
+// True if path ends with suffix
+static bool EndsWith(const std::string& path, const std::string& suffix){
+    return path.size() >= suffix.size() && path.compare(path.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+bool VideoCapture::Begin(const std::string& filepath, int width, int height, int fps){
+    width &= ~1;
+    height &= ~1;
+    if(width <= 0 || height <= 0 || fps <= 0){
+        std::cout << "VideoCapture.cpp: invalid capture of " << width << "x" << height << " at " << fps << " fps\n";
+        return false;
+    }
+    m_piped = !EndsWith(filepath, ".y4m");
+    if(m_piped){
+        // ffmpeg reads the Y4M stream on its standard input
+        std::string command = "ffmpeg -y -loglevel error -f yuv4mpegpipe -i - \"" + filepath + "\"";
+#if defined(MINGW)
+        m_file = _popen(command.c_str(), "wb");
+#else
+        // An ffmpeg that exits early must not take the game with it
+        signal(SIGPIPE, SIG_IGN);
+        m_file = popen(command.c_str(), "w");
+#endif
+    }else{
+        m_file = fopen(filepath.c_str(), "wb");
+    }
+    if(m_file == nullptr){
+        std::cout << "VideoCapture.cpp: could not open " << filepath << "\n";
+        return false;
+    }
+    fprintf(m_file, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", width, height, fps);
+
+    m_path = filepath;
+    m_width = width;
+    m_height = height;
+    m_period = 1.0 / (double)fps;
+    m_maxRepeat = fps;
+    m_nextSeconds = -1.0;
+    m_frames = 0;
+    m_dropped = 0;
+    m_stalls = 0;
+
+    size_t bytes = (size_t)width * height * 4;
+    for(Slot& slot : m_slots){
+        glGenBuffers(1, &slot.buffer);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+        glBufferData(GL_PIXEL_PACK_BUFFER, bytes, nullptr, GL_STREAM_READ);
+        GPUResourceTracker::Get().Created(GPU_BUFFER, slot.buffer, "capture readback", bytes);
+        slot.fence = nullptr;
+        slot.repeat = 0;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    m_nextSlot = 0;
+
+    for(unsigned int i = 0; i < POOL_FRAMES; ++i){
+        m_pool[i].pixels.resize(bytes);
+        m_freeQueue.Push(i);
+    }
+    m_planes.resize((size_t)width * height * 3 / 2);
+    m_stopping = false;
+    m_failed = false;
+    m_encoder = std::thread(&VideoCapture::EncoderMain, this);
+    return true;
+}
+
+void VideoCapture::Capture(double seconds){
+    if(m_file == nullptr){
+        return;
+    }
+    // Pick up every readback that has finished in the meantime, oldest first
+    for(unsigned int i = 0; i < READBACK_SLOTS; ++i){
+        Slot& slot = m_slots[(m_nextSlot + i) % READBACK_SLOTS];
+        // Fences signal in order, so the rest are not done either
+        if(slot.fence != nullptr && !Collect(slot, false)){
+            break;
+        }
+    }
+
+    if(m_nextSeconds < 0.0){
+        m_nextSeconds = seconds;
+    }
+    if(seconds < m_nextSeconds){
+        return;
+    }
+    // Every period this frame stands for, the one it is due in included
+    int repeat = 1 + (int)((seconds - m_nextSeconds) / m_period);
+    if(repeat > m_maxRepeat){
+        repeat = m_maxRepeat;
+        m_nextSeconds = seconds + m_period;
+    }else{
+        m_nextSeconds += repeat * m_period;
+    }
+
+    // The slot to reuse holds the oldest readback; if the GPU is that far
+    // behind there is nothing for it but to wait.
+    Slot& slot = m_slots[m_nextSlot];
+    if(slot.fence != nullptr){
+        ++m_stalls;
+        if(!Collect(slot, true)){
+            // Lost after a second of waiting, drop it
+            glDeleteSync(slot.fence);
+            slot.fence = nullptr;
+            ++m_dropped;
+        }
+    }
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+    glReadBuffer(GL_BACK);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    // With a pack buffer bound this only queues a copy on the GPU
+    glReadPixels(0, 0, m_width, m_height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.repeat = (unsigned int)repeat;
+    m_nextSlot = (m_nextSlot + 1) % READBACK_SLOTS;
+}
+
+bool VideoCapture::Collect(Slot& slot, bool wait){
+    GLenum result = glClientWaitSync(slot.fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0,
+                                     wait ? (GLuint64)1000000000 : 0);
+    if(result == GL_TIMEOUT_EXPIRED || result == GL_WAIT_FAILED){
+        return false;
+    }
+    glDeleteSync(slot.fence);
+    slot.fence = nullptr;
+
+    unsigned int index = 0;
+    if(!m_freeQueue.Pop(index)){
+        // The encoder is behind by the whole pool; the game does not wait
+        ++m_dropped;
+        return true;
+    }
+    size_t bytes = (size_t)m_width * m_height * 4;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    const void* pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)bytes, GL_MAP_READ_BIT);
+    if(pixels != nullptr){
+        Frame& frame = m_pool[index];
+        std::memcpy(frame.pixels.data(), pixels, bytes);
+        frame.repeat = slot.repeat;
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        m_encodeQueue.Push(index);
+        ++m_frames;
+    }else{
+        m_freeQueue.Push(index);
+        ++m_dropped;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    return true;
+}
+
+void VideoCapture::EncoderMain(){
+    for(;;){
+        unsigned int index = 0;
+        if(!m_encodeQueue.Pop(index)){
+            if(m_stopping.load(std::memory_order_acquire) && m_encodeQueue.IsEmpty()){
+                return;
+            }
+            // A frame takes a few milliseconds to come; no need to spin
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+        if(!m_failed.load(std::memory_order_relaxed)){
+            WriteFrame(m_pool[index]);
+        }
+        m_freeQueue.Push(index);
+    }
+}
+
+void VideoCapture::WriteFrame(const Frame& frame){
+    // BT.601 studio range, the rows flipped to top first. Chroma is the
+    // average of each 2x2 block.
+    const int width = m_width;
+    const int height = m_height;
+    uint8_t* yPlane = m_planes.data();
+    uint8_t* uPlane = yPlane + (size_t)width * height;
+    uint8_t* vPlane = uPlane + (size_t)width * height / 4;
+    for(int y = 0; y < height; y += 2){
+        const uint8_t* rows[2] = {frame.pixels.data() + (size_t)(height - 1 - y) * width * 4,
+                                  frame.pixels.data() + (size_t)(height - 2 - y) * width * 4};
+        for(int x = 0; x < width; x += 2){
+            int r = 0;
+            int g = 0;
+            int b = 0;
+            for(int dy = 0; dy < 2; ++dy){
+                for(int dx = 0; dx < 2; ++dx){
+                    const uint8_t* p = rows[dy] + (x + dx) * 4;
+                    yPlane[(size_t)(y + dy) * width + x + dx] = (uint8_t)(((66*p[0] + 129*p[1] + 25*p[2] + 128) >> 8) + 16);
+                    r += p[0];
+                    g += p[1];
+                    b += p[2];
+                }
+            }
+            r >>= 2;
+            g >>= 2;
+            b >>= 2;
+            size_t chroma = (size_t)(y / 2) * (width / 2) + x / 2;
+            uPlane[chroma] = (uint8_t)(((-38*r - 74*g + 112*b + 128) >> 8) + 128);
+            vPlane[chroma] = (uint8_t)(((112*r - 94*g - 18*b + 128) >> 8) + 128);
+        }
+    }
+    for(unsigned int i = 0; i < frame.repeat; ++i){
+        if(fputs("FRAME\n", m_file) < 0 || fwrite(m_planes.data(), 1, m_planes.size(), m_file) != m_planes.size()){
+            m_failed = true;
+            return;
+        }
+    }
+}
+
+void VideoCapture::End(){
+    if(m_file == nullptr){
+        return;
+    }
+    // The last frames are waited for; the game is over anyway
+    for(unsigned int i = 0; i < READBACK_SLOTS; ++i){
+        Slot& slot = m_slots[(m_nextSlot + i) % READBACK_SLOTS];
+        if(slot.fence != nullptr && !Collect(slot, true)){
+            glDeleteSync(slot.fence);
+            slot.fence = nullptr;
+        }
+    }
+    m_stopping = true;
+    m_encoder.join();
+
+    bool failed = m_failed.load();
+#if defined(MINGW)
+    int status = m_piped ? _pclose(m_file) : fclose(m_file);
+#else
+    int status = m_piped ? pclose(m_file) : fclose(m_file);
+#endif
+    m_file = nullptr;
+    if(failed || status != 0){
+        std::cout << "VideoCapture.cpp: writing " << m_path << " failed" << (m_piped ? ", is ffmpeg installed?" : "") << "\n";
+    }else{
+        std::cout << "Captured " << m_frames << " frames to " << m_path << " (" << m_dropped << " dropped, "
+                  << m_stalls << " readback stalls)\n";
+    }
+
+    for(Slot& slot : m_slots){
+        glDeleteBuffers(1, &slot.buffer);
+        GPUResourceTracker::Get().Deleted(GPU_BUFFER, slot.buffer);
+        slot.buffer = 0;
+    }
+    unsigned int index = 0;
+    while(m_freeQueue.Pop(index)){
+    }
+    for(Frame& frame : m_pool){
+        std::vector<uint8_t>().swap(frame.pixels);
+    }
+}
@@ -0,0 +1,20 @@
+#include "ViewportLayout.hpp"
+
+#include <algorithm>
+
+size_t LayOutViewports(int width, int height, size_t count, ViewportRect* rects){
+    count = std::min(std::max(count, (size_t)1), MAX_VIEWPORTS);
+    const int columns = (count == 4) ? 2 : 1;
+    const int rows = (int)((count + columns - 1) / columns);
+    for(size_t view = 0; view < count; ++view){
+        int column = (int)view % columns;
+        // Row 0 is the top one, and GL counts from the bottom
+        int row = rows - 1 - (int)view / columns;
+        ViewportRect& rect = rects[view];
+        rect.x = width * column / columns;
+        rect.y = height * row / rows;
+        rect.width = width * (column + 1) / columns - rect.x;
+        rect.height = height * (row + 1) / rows - rect.y;
+    }
+    return count;
+}
@@ -0,0 +1,306 @@
+#include "VirtualPanorama.hpp"
+#include "GLBackend.hpp"
+#include "GLStateCache.hpp"
+#include "GPUResourceTracker.hpp"
+#include "Image.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+// Creates an RGBA8 texture of width x height bound to unit, filled with
+// texels unless they are nullptr, neither repeated nor mipmapped
+static GLuint CreateTileTexture(unsigned int unit, int width, int height, GLint filter, const uint8_t* texels){
+    GLuint texture = GLBackend::Get().CreateTexture(GL_TEXTURE_2D);
+    if(GLBackend::Get().HasDirectStateAccess()){
+        // Created, set up and filled by name, nothing is bound
+        glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, filter);
+        glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, filter);
+        glTextureParameteri(texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTextureParameteri(texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTextureStorage2D(texture, 1, GL_RGBA8, width, height);
+        if(texels != nullptr){
+            glTextureSubImage2D(texture, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, texels);
+        }
+        return texture;
+    }
+    GLStateCache::Get().BindTexture(unit, GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, texels);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    return texture;
+}
+
+// Uploads a rectangle of RGBA8 texels into a texture of unit
+static void UploadTexels(GLuint texture, unsigned int unit, int x, int y, int width, int height, const uint8_t* texels){
+    if(GLBackend::Get().HasDirectStateAccess()){
+        glTextureSubImage2D(texture, 0, x, y, width, height, GL_RGBA, GL_UNSIGNED_BYTE, texels);
+        return;
+    }
+    GLStateCache& state = GLStateCache::Get();
+    state.BindTexture(unit, GL_TEXTURE_2D, texture);
+    state.ActiveTexture(unit);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, height, GL_RGBA, GL_UNSIGNED_BYTE, texels);
+}
+
+// Constructor
+VirtualPanorama::VirtualPanorama(){
+
+}
+
+// Destructor
+VirtualPanorama::~VirtualPanorama(){
+    if(m_cache != 0){
+        std::cout << "VirtualPanorama.cpp: panorama was never released\n";
+    }
+}
+
+bool VirtualPanorama::Initialize(const std::string& filepath, const VirtualPanoramaConfig& config){
+    Release();
+    if(config.tileSize < 8 || config.cacheColumns < 1 || config.cacheRows < 1 || config.cacheColumns > 255 ||
+       config.cacheRows > 255 || config.prefetchColumns < 0 || config.decodesInFlight < 1 || config.uploadsPerFrame < 1){
+        std::cout << "VirtualPanorama.cpp: invalid tile cache configuration\n";
+        return false;
+    }
+    m_config = config;
+    if(!m_file.Open(filepath)){
+        std::cout << "VirtualPanorama.cpp: could not open " << filepath << "\n";
+        return false;
+    }
+    m_texels = Image::FindP6Pixels(m_file.Data(), m_file.Size(), m_width, m_height);
+    if(m_texels == nullptr){
+        std::cout << "VirtualPanorama.cpp: " << filepath << " is not a binary 8-bit PPM (P6)\n";
+        m_file.Close();
+        return false;
+    }
+    const int tileSize = m_config.tileSize;
+    m_tileColumns = (m_width + tileSize - 1) / tileSize;
+    m_tileRows = (m_height + tileSize - 1) / tileSize;
+    const size_t slotCount = (size_t)m_config.cacheColumns * m_config.cacheRows;
+    GLint maxSize = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+    // At least a view a tile wide must fit; how wide the view really is
+    // is up to the caller to check with Fits()
+    if(!Fits(tileSize) || GetCacheWidth() > maxSize ||
+       GetCacheHeight() > maxSize || m_tileColumns > maxSize || m_tileRows > maxSize){
+        std::cout << "VirtualPanorama.cpp: the " << m_width << "x" << m_height << " " << filepath
+                  << " does not fit a cache of " << m_config.cacheColumns << "x" << m_config.cacheRows << " tiles\n";
+        m_file.Close();
+        return false;
+    }
+
+    // The borders of the slots make filtering inside a slot safe
+    m_cache = CreateTileTexture(PANORAMA_CACHE_UNIT, GetCacheWidth(), GetCacheHeight(), GL_LINEAR, nullptr);
+    GPUResourceTracker::Get().Created(GPU_TEXTURE, m_cache, "panorama tile cache",
+                                      (size_t)GetCacheWidth() * GetCacheHeight() * 4);
+    // The table is fetched by texel, never filtered
+    const size_t tileCount = (size_t)m_tileColumns * m_tileRows;
+    m_tableTexels.assign(tileCount * 4, 0);
+    m_table = CreateTileTexture(PANORAMA_TABLE_UNIT, m_tileColumns, m_tileRows, GL_NEAREST, m_tableTexels.data());
+    GPUResourceTracker::Get().Created(GPU_TEXTURE, m_table, "panorama tile table", tileCount * 4);
+
+    m_slots.assign(slotCount, Slot());
+    m_tileSlots.assign(tileCount, -1);
+    m_tableDirty = false;
+    // Every decode has its texels up front, so streaming never allocates
+    m_decodes.reset(new Decode[m_config.decodesInFlight]);
+    for(int i = 0; i < m_config.decodesInFlight; ++i){
+        m_decodes[i].texels.resize((size_t)GetSlotSize() * GetSlotSize() * 4);
+    }
+    m_frame = 0;
+    m_lastFirst = 0.0;
+    m_direction = 1;
+    m_uploads = 0;
+    m_misses = 0;
+    return true;
+}
+
+bool VirtualPanorama::Fits(double widthTexels) const{
+    if(m_tileColumns == 0){
+        return false;
+    }
+    // A view starting anywhere in a tile touches one column more than it
+    // spans, and Update() wants the prefetched columns on top; columns
+    // past the panorama's end wrap onto those already wanted
+    const double spanned = std::ceil(std::max(widthTexels, 0.0) / m_config.tileSize);
+    const int64_t columns = std::min((int64_t)spanned + 1 + m_config.prefetchColumns, (int64_t)m_tileColumns);
+    return (int64_t)m_config.cacheColumns * m_config.cacheRows >= columns * m_tileRows;
+}
+
+void VirtualPanorama::DecodeTile(int32_t tile, uint8_t* texels) const{
+    const int tileSize = m_config.tileSize;
+    const int slotSize = GetSlotSize();
+    const int column = tile % m_tileColumns;
+    const int row = tile / m_tileColumns;
+    // The border texel left of the tile, the panorama wrapping along x
+    int firstX = column * tileSize - 1;
+    if(firstX < 0){
+        firstX += m_width;
+    }
+    for(int sy = 0; sy < slotSize; ++sy){
+        // Rows count from the bottom and stop at the top and bottom edges
+        int y = std::min(std::max(row * tileSize + sy - 1, 0), m_height - 1);
+        const uint8_t* source = m_texels + (size_t)(m_height - 1 - y) * m_width * 3;
+        uint8_t* out = texels + (size_t)sy * slotSize * 4;
+        int x = firstX;
+        for(int sx = 0; sx < slotSize; ++sx){
+            out[sx*4 + 0] = source[x*3 + 0];
+            out[sx*4 + 1] = source[x*3 + 1];
+            out[sx*4 + 2] = source[x*3 + 2];
+            out[sx*4 + 3] = 255;
+            if(++x == m_width){
+                x = 0;
+            }
+        }
+    }
+}
+
+void VirtualPanorama::UploadDecoded(){
+    const int slotSize = GetSlotSize();
+    int uploaded = 0;
+    for(int i = 0; i < m_config.decodesInFlight && uploaded < m_config.uploadsPerFrame; ++i){
+        Decode& decode = m_decodes[i];
+        if(decode.tile < 0 || !decode.done.load(std::memory_order_acquire)){
+            continue;
+        }
+        const int column = (int)decode.slot % m_config.cacheColumns;
+        const int row = (int)decode.slot / m_config.cacheColumns;
+        UploadTexels(m_cache, PANORAMA_CACHE_UNIT, column * slotSize, row * slotSize, slotSize, slotSize,
+                     decode.texels.data());
+        m_slots[decode.slot].pending = false;
+        uint8_t* entry = &m_tableTexels[(size_t)decode.tile * 4];
+        entry[0] = (uint8_t)column;
+        entry[1] = (uint8_t)row;
+        entry[3] = 255;
+        m_tableDirty = true;
+        decode.tile = -1;
+        decode.done.store(false, std::memory_order_relaxed);
+        ++uploaded;
+        ++m_uploads;
+    }
+}
+
+int VirtualPanorama::FindVictim() const{
+    int victim = -1;
+    for(size_t i = 0; i < m_slots.size(); ++i){
+        const Slot& slot = m_slots[i];
+        if(slot.tile < 0){
+            return (int)i;
+        }
+        if(slot.pending || slot.lastUsed == m_frame){
+            continue;
+        }
+        if(victim < 0 || slot.lastUsed < m_slots[victim].lastUsed){
+            victim = (int)i;
+        }
+    }
+    return victim;
+}
+
+bool VirtualPanorama::Want(int32_t tile){
+    if(m_tileSlots[tile] >= 0){
+        m_slots[m_tileSlots[tile]].lastUsed = m_frame;
+        return true;
+    }
+    Decode* decode = nullptr;
+    for(int i = 0; i < m_config.decodesInFlight && decode == nullptr; ++i){
+        if(m_decodes[i].tile < 0){
+            decode = &m_decodes[i];
+        }
+    }
+    int victim = (decode != nullptr) ? FindVictim() : -1;
+    if(victim < 0){
+        return false;
+    }
+    Slot& slot = m_slots[victim];
+    if(slot.tile >= 0){
+        m_tileSlots[slot.tile] = -1;
+        m_tableTexels[(size_t)slot.tile * 4 + 3] = 0;
+        m_tableDirty = true;
+    }
+    slot.tile = tile;
+    slot.lastUsed = m_frame;
+    slot.pending = true;
+    m_tileSlots[tile] = victim;
+    decode->tile = tile;
+    decode->slot = (uint32_t)victim;
+    JobSystem::Get().Submit([this, decode]{
+        DecodeTile(decode->tile, decode->texels.data());
+        decode->done.store(true, std::memory_order_release);
+    }, &m_decoding);
+    return true;
+}
+
+void VirtualPanorama::Update(double firstTexel, double widthTexels){
+    if(!IsReady()){
+        return;
+    }
+    ++m_frame;
+    if(firstTexel > m_lastFirst){
+        m_direction = 1;
+    }else if(firstTexel < m_lastFirst){
+        m_direction = -1;
+    }
+    m_lastFirst = firstTexel;
+    UploadDecoded();
+
+    // Tile columns counted from the panorama's start, before wrapping
+    const int64_t firstColumn = (int64_t)std::floor(firstTexel / m_config.tileSize);
+    const int64_t lastColumn = (int64_t)std::floor((firstTexel + std::max(widthTexels, 0.0)) / m_config.tileSize);
+    const int64_t columns = m_tileColumns;
+    bool room = true;
+    // What is in view first, then the columns it moves into
+    for(int64_t column = firstColumn; column <= lastColumn && room; ++column){
+        int32_t x = (int32_t)(((column % columns) + columns) % columns);
+        for(int row = 0; row < m_tileRows && room; ++row){
+            int32_t tile = row * m_tileColumns + x;
+            if(m_tileSlots[tile] < 0 || m_slots[m_tileSlots[tile]].pending){
+                ++m_misses;
+            }
+            room = Want(tile);
+        }
+    }
+    for(int ahead = 1; ahead <= m_config.prefetchColumns && room; ++ahead){
+        int64_t column = (m_direction > 0) ? lastColumn + ahead : firstColumn - ahead;
+        int32_t x = (int32_t)(((column % columns) + columns) % columns);
+        for(int row = 0; row < m_tileRows && room; ++row){
+            room = Want(row * m_tileColumns + x);
+        }
+    }
+
+    if(m_tableDirty){
+        UploadTexels(m_table, PANORAMA_TABLE_UNIT, 0, 0, m_tileColumns, m_tileRows, m_tableTexels.data());
+        m_tableDirty = false;
+    }
+}
+
+void VirtualPanorama::Bind() const{
+    GLStateCache& state = GLStateCache::Get();
+    state.BindTexture(PANORAMA_CACHE_UNIT, GL_TEXTURE_2D, m_cache);
+    state.BindTexture(PANORAMA_TABLE_UNIT, GL_TEXTURE_2D, m_table);
+}
+
+void VirtualPanorama::Release(){
+    // The jobs read the mapping and write the decodes
+    JobSystem::Get().Wait(m_decoding);
+    if(m_cache != 0){
+        glDeleteTextures(1, &m_cache);
+        GPUResourceTracker::Get().Deleted(GPU_TEXTURE, m_cache);
+        m_cache = 0;
+    }
+    if(m_table != 0){
+        glDeleteTextures(1, &m_table);
+        GPUResourceTracker::Get().Deleted(GPU_TEXTURE, m_table);
+        m_table = 0;
+    }
+    m_decodes.reset();
+    m_slots.clear();
+    m_tileSlots.clear();
+    m_tableTexels.clear();
+    m_file.Close();
+    m_texels = nullptr;
+    GLStateCache::Get().Invalidate();
+}
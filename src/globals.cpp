@@ -1,4 +0,0 @@
-#include "globals.hpp"
-
-// Initialize our global object
-Global g;
\ No newline at end of file
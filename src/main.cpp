@@ -11,17 +11,102 @@
 #include <glm/gtc/matrix_transform.hpp> 
 
 // C++ Standard Template Library (STL)
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
 #include <iostream>
+#include <memory>
+#include <thread>
 #include <vector>
 #include <string>
 #include <fstream>
 #include <stdlib.h>
 
 // Our libraries
+#include "AllocationCounter.hpp"
+#include "AssetLoader.hpp"
+#include "AssetPack.hpp"
+#include "AtlasObserver.hpp"
+#include "AudioMixer.hpp"
 #include "Camera.hpp"
+#include "CPUProfiler.hpp"
+#include "Collision.hpp"
+#include "CommandBuffer.hpp"
+#include "DrawBatch.hpp"
+#include "FrameUniforms.hpp"
+#include "DynamicResolution.hpp"
+#include "EntityStore.hpp"
+#include "FeatureObservation.hpp"
+#include "FileReader.hpp"
+#include "FileWatcher.hpp"
+#include "FrameArena.hpp"
+#include "EnergyMeter.hpp"
+#include "FrameBenchmark.hpp"
+#include "Frustum.hpp"
+#include "GLBackend.hpp"
+#include "GLDebugOutput.hpp"
+#include "GLStateCache.hpp"
+#include "GPUGameBatch.hpp"
+#include "GPUInstanceCuller.hpp"
+#include "GPUProfiler.hpp"
+#include "GPUResourceTracker.hpp"
+#include "HeadlessContext.hpp"
+#include "ImpostorBaker.hpp"
+#include "GroundStream.hpp"
+#include "Image.hpp"
+#include "Mesh.hpp"
+#include "MeshFile.hpp"
+#include "LiveInspector.hpp"
+#include "MemoryTags.hpp"
+#include "MeshRegistry.hpp"
+#include "MetricsServer.hpp"
+#include "ParticleSystem.hpp"
+#include "PaletteTexture.hpp"
+#include "PerformanceTier.hpp"
 #include "ObjLoader.hpp"
+#include "PerformanceHUD.hpp"
+#include "PixelObserver.hpp"
+#include "PixelUnpackBuffer.hpp"
+#include "PolicyPlugin.hpp"
+#include "ProgramCache.hpp"
+#include "RenderWorkers.hpp"
+#include "ResidencyManager.hpp"
+#include "ShaderProgram.hpp"
+#include "ShaderVariants.hpp"
+#include "Skeleton.hpp"
+#include "SkinBuffer.hpp"
+#include "SkyPass.hpp"
+#include "VirtualPanorama.hpp"
+#include "StressTest.hpp"
+#include "Telemetry.hpp"
+#include "GhostRunners.hpp"
+#include "VersusSession.hpp"
+#include "SpectatorStream.hpp"
+#include "TcpSocket.hpp"
+#include "VideoCapture.hpp"
+#include "ViewportLayout.hpp"
+#include "ScreenshotCapture.hpp"
+#include "GameState.hpp"
+#include "GameStateBatch.hpp"
+#include "GameplayLog.hpp"
+#include "InputLog.hpp"
+#include "JobSystem.hpp"
+#include "JumpTrajectory.hpp"
+#include "Logger.hpp"
+#include "KTXFile.hpp"
+#include "InputLatency.hpp"
+#include "LatencyLimiter.hpp"
 #include "Texture.hpp"
-#include "globals.hpp"
+#include "TextureArray.hpp"
+#include "TextureCache.hpp"
+#include "TraceRecorder.hpp"
+#include "TransformHierarchy.hpp"
+#include "FlightRecorder.hpp"
+#include "SpscQueue.hpp"
+#include "TripleBuffer.hpp"
 
 // vvvvvvvvvvvvvvvvvvvvvvvvvv Globals vvvvvvvvvvvvvvvvvvvvvvvvvv
 // Globals generally are prefixed with 'g' in this application.
@@ -34,23 +119,265 @@ SDL_GLContext gOpenGLContext			= nullptr;
 
 // Main loop flag
 bool gQuit = false; // If this is quit = 'true' then the program terminates.
+// Something on the game over screen changed, it is drawn once more
+bool gIdleRedraw = false;
+// Another window has the focus, or ours is minimised or hidden: the game
+// pauses, and nothing is drawn while it cannot be seen
+bool gFocusLost = false;
+bool gWindowHidden = false;
+// Either of the above, for the simulation thread
+std::atomic<bool> gPaused{false};
+
+// Frame pacing, selected on the command line
+enum SwapMode{
+    SWAP_VSYNC,     // --vsync (default): wait for every vertical blank
+    SWAP_ADAPTIVE,  // --adaptive: vsync, but late frames tear instead of waiting
+    SWAP_UNCAPPED,  // --uncapped: no waiting at all, for benchmarking
+    SWAP_CAPPED     // --cap=<hz>: no vsync, limited by a sleep/spin frame limiter
+};
+SwapMode gSwapMode = SWAP_VSYNC;
+// --low-latency: at most one frame queued for the GPU and, with a frame
+// cap, input sampled as late as the frame's cost allows
+LatencyLimiter gLatency;
+bool gLowLatency = false;
+// Time from each key or button press (or scripted jump) to the swap of
+// the first frame that shows it, and with --low-latency to the GPU
+// finishing that frame
+InputLatency gInputLatency;
+// Target rate of SWAP_CAPPED
+int gFrameCap = 30;
+
+// Pixel observations, --observe=<w>x<h>: the scene is rendered offscreen at
+// that size and read back every frame. Grayscale unless --observe-color.
+// --offscreen also hides the window.
+PixelObserver gObserver;
+bool gObserving = false;
+int gObserveWidth = 84;
+int gObserveHeight = 84;
+bool gObserveGrayscale = true;
+// The scene is rendered --observe-supersample=<k> times the observation
+// size and reduced on the GPU, --observe-maxpool takes the maximum of the
+// last two frames
+int gObserveSupersample = 1;
+bool gObserveMaxPool = false;
+// --observe-envs=<n>: n more environments, each rendered into a tile of
+// the --observe size of one atlas and read back together every frame,
+// in place of the single observation. They take a step a frame with the
+// player's jump, and finished ones start over on a new stream.
+AtlasObserver gAtlas;
+size_t gObserveEnvCount = 0;
+GameStateBatch gObserveEnvs;
+std::vector<GameAction> gObserveActions;
+uint64_t gObserveNextStream = 0;
+// --gpu-sim-check=<n>: before anything else, n environments are stepped
+// both on the GPU (GPUGameBatch) and the CPU, compared and timed, and the
+// program quits
+size_t gGPUSimulationCheckEnvs = 0;
+// Steps of that check
+const int GPU_CHECK_STEPS = 2000;
+// --render-workers=<n>: the atlas is split between the main context and n
+// threads with contexts of its share group, each drawing and reading back
+// its part at the same time (RenderWorkers)
+size_t gRenderWorkerCount = 0;
+RenderWorkers gRenderWorkers;
+std::vector<SDL_GLContext> gWorkerContexts;
+std::vector<std::unique_ptr<HeadlessContext>> gHeadlessWorkerContexts;
+
+// Scene rendered at a fraction of the window that follows the GPU frame
+// time (--dynamic-resolution). Observations keep their own fixed size.
+DynamicResolution gResolution;
+bool gDynamicResolution = false;
+float gMinResolutionScale = 0.5f;
+// GPU time a frame aims for, a little under a 60 Hz frame
+double gGPUBudgetMilliseconds = 15.0;
+bool gOffscreen = false;
+// --headless[=<device>]: no window or display at all, the context is made
+// through EGL on that GPU instead (HeadlessContext). Implies --offscreen.
+bool gHeadless = false;
+int gHeadlessDevice = 0;
+HeadlessContext gHeadlessContext;
+
+// --gl-debug asks for a debug context and reports driver errors through
+// KHR_debug, asynchronously, or on the failing call with --gl-debug=sync
+bool gGLDebug = false;
+bool gGLDebugSynchronous = false;
+// --gl-no-error asks for a KHR_no_error context, in which the driver
+// skips validating every call; ignored with --gl-debug
+bool gGLNoError = false;
+// GL objects are edited by name where the context allows it (GLBackend),
+// --no-dsa binds to edit everywhere
+bool gDirectStateAccess = true;
+// --no-bindless binds the scene textures even where GL_ARB_bindless_texture exists
+bool gAllowBindless = true;
+
+// Asset pack every file is read from when it exists (tools/dinopack.cpp),
+// --pack=<file> to use another, --no-pack for the loose files. A build
+// with the assets embedded reads those instead of the default pack.
+const char* const DEFAULT_PACK_PATH = "./assets.dpak";
+std::string gPackPath = DEFAULT_PACK_PATH;
+// Loose files are read ahead of their parse in batches, through io_uring
+// on Linux; --no-io-uring reads them with jobs, --direct-io bypasses the
+// page cache
+FileReaderConfig gFileReads;
+
+// Directory linked shader programs are cached in (ProgramCache),
+// --shader-cache=<dir> to use another, --no-shader-cache to always compile
+std::string gShaderCachePath = "./shadercache";
+
+// --hot-reload: rebuild a shader program, the scene meshes or a texture
+// when its file changes. Off by default, so a normal run watches nothing.
+bool gHotReload = false;
+FileWatcher gWatcher;
+
+// Largest error in pixels a simplified level of detail may show,
+// --lod-error=<pixels>; 0 always draws the full meshes
+float gLodPixelError = 1.0f;
+
+// Quality tier of this machine (PerformanceTier), probed at its first
+// launch and cached next to the shader programs. --tier=<low|medium|high>
+// picks one instead, --probe measures again and --no-tier keeps the
+// defaults. Settings given on the command line are left as they are.
+PerformanceTier gTier;
+std::string gTierName;
+bool gTierProbe = false;
+bool gTierEnabled = true;
+const uint32_t TIER_SET_RESOLUTION = 1u << 0;
+const uint32_t TIER_SET_LOD        = 1u << 1;
+uint32_t gTierSetByArguments = 0;
+// What the tier sets besides: the largest scale of dynamic resolution,
+// the share of each dust burst spawned, and mip levels of the scene
+// textures left out
+float gMaxResolutionScale = 1.0f;
+float gParticleBudget = 1.0f;
+int gTextureLevelBias = 0;
+
+// Obstacles at least this far from the eye are drawn as impostors,
+// --impostor-distance=<units>; 0 always draws their meshes
+float gImpostorDistance = 8.0f;
+// Distance over which an obstacle dissolves from its mesh into its
+// impostor, ending at gImpostorDistance
+const float IMPOSTOR_FADE_DISTANCE = 2.0f;
 
 // shader
-// The following stores the a unique id for the graphics pipeline
-// program object that will be used for our OpenGL draw calls.
-GLuint gGraphicsPipelineShaderProgram	= 0;
+// Features the scene shaders are built with, bits of a variant mask; see
+// shaders/frag.glsl
+const uint32_t SCENE_DAY_NIGHT_BLEND = 1u << 0;
+const uint32_t SCENE_WIREFRAME       = 1u << 1;
+const uint32_t SCENE_BINDLESS        = 1u << 2;
+const uint32_t SCENE_CROSSFADE       = 1u << 3;
+const uint32_t SCENE_VARIANTS        = 16;
+// Every variant of the graphics pipeline. All of them are compiled once
+// at startup, so a feature toggled at runtime only binds another one.
+ShaderVariants gSceneVariants;
+// The variant our OpenGL draw calls use this frame, see SelectSceneVariant()
+const ShaderProgram* gShaderProgram = nullptr;
+uint32_t gSceneVariant = 0;
+// SCENE_BINDLESS when every variant samples through a bindless handle
+uint32_t gSceneBindless = 0;
+
+// Uniform locations, looked up once after the program is linked
+struct UniformLocations{
+    GLint modelMatrix    = -1;
+    GLint diffuseTexture = -1;
+    GLint uvOffset       = -1;
+    GLint paletteIndex   = -1;
+    GLint timeOfDay      = -1;
+    GLint opacity        = -1;
+    GLint time           = -1;
+    GLint jumpApex       = -1;
+    GLint squashPivot    = -1;
+    // Only in the CROSSFADE variants
+    GLint crossfadeBand  = -1;
+    GLint impostor       = -1;
+    GLint impostorPivot  = -1;
+    // Only where the vertex shader skins
+    GLint skinVertices   = -1;
+    // Only where the fragment shader samples
+    GLint palette        = -1;
+};
+// Locations in each variant, and in the one selected
+UniformLocations gVariantUniforms[SCENE_VARIANTS];
+UniformLocations gUniforms;
 
 // OpenGL Objects
-// Vertex Array Object (VAO)
-// Vertex array objects encapsulate all of the items needed to render an object.
-// For example, we may have multiple vertex buffer objects (VBO) related to rendering one
-// object. The VAO allows us to setup the OpenGL state to render that object using the
-// correct layout and correct buffers with one call after being setup.
-GLuint gVertexArrayObjectFloor= 0;
-// Vertex Buffer Object (VBO)
-// Vertex Buffer Objects store information relating to vertices (e.g. positions, normals, textures)
-// VBOs are our mechanism for arranging geometry on the GPU.
-GLuint  gVertexBufferObjectFloor            = 0;
+// Every Vertex Array Object (VAO) and Vertex Buffer Object (VBO) lives in the
+// mesh registry. They are created once at startup and the frame loop only
+// binds them through their handles.
+MeshRegistry gMeshRegistry;
+
+// All static scene meshes share one vertex/index arena and are drawn as
+// ranges of it by a single batch.
+MeshHandle gSceneArena = INVALID_MESH;
+DrawBatch gSceneBatch;
+// The scene's passes over gSceneBatch, recorded with the draw list and
+// replayed by Draw()
+CommandBuffer gSceneCommands;
+// The camera, time of day and sky scroll every scene program reads
+FrameUniforms gFrameUniforms;
+
+// Scratch memory of the frame being built, taken back at the start of
+// every frame. Grows to what a frame needs if this is not enough.
+const size_t FRAME_ARENA_BYTES = 64 * 1024;
+FrameArena gFrameArena;
+
+// GPU timings of the render passes
+GPUProfiler gGPUProfiler;
+int gClearPass      = -1;
+int gBackgroundPass = -1;
+int gCharacterPass  = -1;
+int gCullPass       = -1;
+int gGhostPass      = -1;
+int gSkyPass        = -1;
+int gParticlePass   = -1;
+int gHUDPass        = -1;
+
+// CPU timings of the frame loop and of the startup steps worth watching
+int gInputZone               = -1;
+int gSimulateZone            = -1;
+int gBuildZone               = -1;
+int gPreDrawZone             = -1;
+int gDrawZone                = -1;
+int gSwapZone                = -1;
+int gLatencyZone             = -1;
+int gFrameZone               = -1;
+int gVertexSpecificationZone = -1;
+int gPipelineZone            = -1;
+int gHUDZone                 = -1;
+int gSDLInitZone             = -1;
+int gWindowZone              = -1;
+int gContextZone             = -1;
+int gLoaderZone              = -1;
+int gLoadingZone             = -1;
+int gRendererSetupZone       = -1;
+
+// Performance counter at the start of main(), for the load time and the
+// time to the first frame
+Uint64 gStartCounter = 0;
+
+// Performance overlay, toggled with H or shown from the start with --hud
+PerformanceHUD gHUD;
+
+// Dust puffs on landing and sand kicked up while running, simulated on
+// the GPU
+ParticleSystem gParticles;
+
+// The backdrop behind everything, one fullscreen triangle after the scene
+SkyPass gSky;
+// A wide P6 PPM its wall shows instead, streamed in tiles, --panorama=<file>
+std::string gPanoramaPath;
+VirtualPanorama gPanorama;
+
+// Chrome trace of the startup and the first frames, --trace=<file> and
+// --trace-frames=<n>. Kept in memory and written at exit.
+TraceRecorder gTrace;
+std::string gTracePath;
+int gTraceFrames = 600;
+// The last seconds of profiling, dumped as a trace whenever a frame takes
+// longer than --hitch-budget=<ms>, --hitch-seconds=<s>, --hitch-dir=<dir>
+FlightRecorder gFlight;
+double gHitchBudgetMilliseconds = 0.0;
+double gHitchSeconds = 5.0;
+std::string gHitchDirectory = ".";
 
 // Camera
 Camera gCamera;
@@ -58,210 +385,539 @@ Camera gCamera;
 // Draw wireframe mode
 GLenum gPolygonMode = GL_FILL;
 
-// Floor triangles
-size_t gFloorTriangles  = 0;
-
-// Texture
-Texture gTexture;
+// Textures
+// Every material is a layer of one texture array, bound once per frame.
+// Instances carry a day and a night layer and the shader crossfades them,
+// so night falls without a bind or a load.
+TextureArray gSceneTextures;
+int gDayLayer   = 0;
+int gNightLayer = 0;
+// Set once every texel of the layer is uploaded. The game starts with the
+// day layer; night falls once its layer has streamed in.
+bool gDayLayerReady   = false;
+bool gNightLayerReady = false;
+// Compressed texture variants the GPU can sample, best first. Found on the
+// main thread before loading starts, read by the parse jobs.
+std::vector<std::string> gTextureSuffixes;
+// Largest size in pixels a scene texture can cover on screen, from the
+// drawable size and the models' footprints. Mip levels larger than this
+// are never sampled, so they are not loaded.
+int gTextureFootprintWidth  = 0;
+int gTextureFootprintHeight = 0;
+
+// Models and textures are parsed as jobs on the worker threads and
+// uploaded on this one: up to LOADING_UPLOAD_BUDGET bytes per frame of
+// the loading screen, then ASSET_UPLOAD_BUDGET per game frame for what
+// is still streaming, so no upload stalls a frame.
+AssetLoader gAssets;
+// What the GPU may hold, --vram-budget=<MB>; 0 (the default) is no limit.
+// Textures streamed through gTextureCache are evicted, those bound longest
+// ago first, to stay within it and streamed back when bound again. The
+// scene arena and texture array are one allocation each, so they count
+// against the budget but are never evicted.
+ResidencyManager gResidency;
+TextureCache gTextureCache;
+// Threads of the job system, --jobs=<n> with the main thread counted; 0
+// is one per hardware thread
+unsigned int gJobThreads = 0;
+// Pinning of the job system's threads: --affinity=<compact|scatter>,
+// --exclude-cores=<list> and --pin-main for the main thread as well
+AffinityConfig gAffinity;
+const size_t LOADING_UPLOAD_BUDGET = 16u << 20;
+const size_t ASSET_UPLOAD_BUDGET   = 256u << 10;
 
 // Debug flag to see if camera controls can be activated
 bool gDebug = false;
 
-// Ticker value to determine player score and object+texture positions
-int tick = 0;
-
-// Day-night ticker, resets every 5000 ticks.
-int dayTick = 0;
-
-// Indicates whether the dino has collided with an obstacle
-bool hasCollided = false;
-
-// Determines whether the dinosaur is in a jump state; used to determine jump paths and avoids multiple jump inputs at once
-bool isJumping = false;
-
-// Determines the jump velocity
-bool jumpingUp = true;
-
-// Determines whether the game is over (and subsequently halts movement and scrolling)
-bool gameOver = false;
-
-// initial cactus speed
-int cactusSpeed = 5;
-
-// initial jumping speed
-int jumpingSpeed = 4;
-
-// initial cactus position
-int cactusStart = 400;
+// The game being played. Everything the rules touch lives here; the
+// rest of this file only reads it for drawing.
+GameState gGame;
+// Seed of the obstacle sequence, --seed=<n>. Restarts continue from it, so
+// a run is replayed exactly by starting with the same seed.
+uint64_t gSeed = 1;
+// Games started so far, the stream of the next one
+uint64_t gGamesPlayed = 0;
+// Game units the lane has scrolled since the game started, which the
+// ground chunks are laid out along
+int64_t gTrackDistance = 0;
+
+// Held down this frame, applied to the next simulation step
+bool gJumpHeld = false;
+// R was pressed, the next simulation step starts a new game
+std::atomic<bool> gRestartPending{false};
+// What the last input poll handed to the simulation: the input sequence
+// (see InputLatency::Submit()) above the EncodeInput() bits of the held
+// keys. A restart is taken from gRestartPending instead.
+std::atomic<uint64_t> gHeldInput{0};
+// Sequence of the input the last simulation step read
+uint32_t gSimulatedInputSequence = 0;
+
+// A jump key press, stamped with the counter of the moment it happened
+struct JumpPress{
+    Uint64 counter;
+};
+// Presses queued by an SDL event watch as soon as events are pumped,
+// which the frame loop does several times a frame, not only in Input().
+// The next simulation step takes every press due by its time and jumps,
+// so a slow frame no longer holds a press back and a tap shorter than a
+// frame is not lost. The pumping thread is the only producer and the
+// stepping thread the only consumer.
+SpscQueue<JumpPress, 64> gJumpPresses;
+
+// A game being played steps on its own thread, at its own fixed rate,
+// and the frame loop draws the latest step it has published; a slow
+// frame or a stalled swap does not hold the game back. --no-sim-thread
+// steps in the frame loop, as replays and benchmark runs always do.
+bool gSimulationThread = true;
+std::thread gSimulationWorker;
+std::atomic<bool> gSimulationRunning{false};
+
+// Input recording (--record=<file>) and replay (--replay=<file>). A replay
+// takes every step's input from the log, runs gReplayStepsPerFrame steps
+// per rendered frame (--replay-every=<n>) and quits at the end of the log.
+// --replay-from=<step> starts it at that step, restored from the log's
+// keyframes.
+InputLog gInputLog;
+std::string gRecordPath;
+std::string gReplayPath;
+bool gReplaying = false;
+size_t gReplayStep = 0;
+int gReplayStepsPerFrame = 1;
+size_t gReplayFrom = 0;
+
+// Render benchmark, --benchmark=<frames>: a scripted game with collisions
+// off, one step per frame along a fixed camera path, uncapped, that quits
+// after that many measured frames and prints their timings
+FrameBenchmark gBenchmark;
+int gBenchmarkFrames = 0;
+// --benchmark-out=<file> writes the results as JSON; --benchmark-baseline=<file>
+// compares them with an earlier such file and makes the exit code non-zero
+// on a regression beyond --benchmark-tolerance=[<metric>=]<percent>
+std::string gBenchmarkOutPath;
+std::string gBenchmarkBaselinePath;
+
+// Stress test, --stress=<n>: up to n moving cacti and ghost dinos drawn,
+// culled and collided with on top of a scripted game, uncapped, timed at
+// growing counts and printed as a curve before quitting
+StressTest gStress;
+size_t gStressEntities = 0;
+// The stress entities are culled on the GPU where the batch draws with
+// multi-draw-indirect; --cpu-cull culls them on the CPU as the rest
+GPUInstanceCuller gInstanceCuller;
+bool gAllowGPUCulling = true;
+const GPUCullShaders CULL_SHADERS = {"./shaders/cull_vert.glsl", "./shaders/cull_geom.glsl",
+                                     "./shaders/cull_frag.glsl", "./shaders/cull_commands.glsl"};
+
+// Power counters read every frame of --benchmark and --stress, for their
+// joules per frame; open only when one of them runs
+EnergyMeter gEnergy;
+
+// Ghost runners, --ghosts=<file>[,<file>...]: recorded runs replayed in
+// step with the player's game and drawn as translucent dinos over it
+GhostRunners gGhosts;
+std::vector<std::string> gGhostPaths;
+
+// Versus mode, --versus=<host>:<port> with --versus-port=<port> and
+// --input-delay=<steps>: a race against the kiosk at host, inputs
+// exchanged over UDP and the opponent drawn as a ghost (see
+// VersusSession.hpp)
+VersusSession gVersus;
+std::string gVersusPeer;
+int gVersusPort = 7777;
+int gInputDelay = 2;
+// Whether the result of the current game was announced
+bool gVersusAnnounced = false;
+
+// Local split screen, --split-screen=<n>: n players (2 to 4) race the same
+// track on one machine, each in a view of its own. Player 1 plays gGame
+// with the space bar; the others play these games, started with the same
+// seed and stream, so every running player sees the same obstacles, and
+// jump with LOCAL_PLAYER_KEYS. The lane drawn is the leading player's,
+// the view's own dino solid and the other players as ghosts; a player
+// who is out watches the rest until the last one is. The stepping thread
+// owns the games, like gGame.
+const size_t MAX_LOCAL_PLAYERS = MAX_VIEWPORTS;
+const SDL_Scancode LOCAL_PLAYER_KEYS[MAX_LOCAL_PLAYERS] = {SDL_SCANCODE_SPACE, SDL_SCANCODE_Q, SDL_SCANCODE_P,
+                                                           SDL_SCANCODE_RETURN};
+size_t gLocalPlayers = 1;
+struct LocalPlayer{
+    GameState game;
+    JumpAnchor jump;
+};
+LocalPlayer gOtherPlayers[MAX_LOCAL_PLAYERS - 1];
+// Bit p - 1 for player p: the key held at the last poll, and pressed since
+// the last step
+std::atomic<uint32_t> gLocalPlayerHeld{0};
+std::atomic<uint32_t> gLocalPlayerPressed{0};
+// Whether a player other than player 1 is still running, which keeps the
+// game stepping after player 1 is out
+std::atomic<bool> gOtherPlayersRunning{false};
+// Demo mode, --bots=<library>[:<options>]: a policy library (see
+// PolicyPlugin.hpp) plays every local player in process, called once a
+// step with the feature rows of all of them, and a new game starts
+// BOT_RESTART_STEPS after the last one is out. The stepping thread owns
+// the policy; gBotJumps holds its jumps for the players after player 1,
+// bit p - 1 for player p like the keys.
+PolicyPlugin gBots;
+std::string gBotsSpec;
+const size_t BOT_FEATURE_OBSTACLES = 3;
+const size_t BOT_ROW_SIZE = FEATURE_OBSTACLES + BOT_FEATURE_OBSTACLES;
+const int BOT_RESTART_STEPS = 120;
+uint32_t gBotJumps = 0;
+int gBotStepsOver = 0;
+// Palettes the number keys pick from; the other players take the ones
+// after player 1's
+const int PALETTE_COUNT = 5;
+
+// Spectators, --spectator-port=<port> with --spectator-rate=<hz>: the game
+// streamed as delta-encoded snapshots to every viewer that joins, and
+// --spectate=<host>:<port>: the game of that kiosk watched here instead
+// of played (see SpectatorStream.hpp)
+SpectatorServer gSpectators;
+int gSpectatorPort = 0;
+int gSpectatorRate = 20;
+SpectatorViewer gSpectating;
+std::string gSpectatePeer;
+
+// Prometheus metrics served over HTTP, --metrics-port=<port>; the frame
+// loop publishes its values every METRICS_PUBLISH_FRAMES frames
+MetricsServer gMetrics;
+int gMetricsPort = 0;
+const int METRICS_PUBLISH_FRAMES = 30;
+int gMetricsFrames = 0;
+Uint64 gMetricsSince = 0;
+double gMetricsGPUMilliseconds = 0.0;
+
+// The game state and profiler summaries in shared memory for
+// tools/dinoinspect.cpp, --inspect[=<name>]; the summaries are refreshed
+// every INSPECTOR_SUMMARY_FRAMES frames, the rest every frame
+LiveInspector gInspector;
+std::string gInspectName;
+const uint64_t INSPECTOR_SUMMARY_FRAMES = 30;
+
+// Video capture, --capture=<file> with --capture-fps=<n>: the window read
+// back and encoded on a thread of its own, the game never waiting for it
+VideoCapture gCapture;
+std::string gCapturePath;
+int gCaptureFps = 60;
+// Screenshots, F12, written to --screenshot-dir=<dir> by a job
+ScreenshotCapture gScreenshots;
+// --stats: prints the run statistics (see Telemetry.hpp) on quitting
+bool gPrintStats = false;
+// --gameplay-log=<file>: jumps, deaths and sessions appended as binary
+// records (see GameplayLog.hpp), written by a thread of their own
+std::string gGameplayLogPath;
+// Sound effects, mixed on SDL's audio thread (see AudioMixer.hpp) from
+// --audio-buffer=<frames> frames at a time; --no-audio runs silent
+bool gAudioEnabled = true;
+int gAudioBufferFrames = 256;
+AudioMixer gAudio;
+// The game's sounds, -1 while there is no audio
+int gJumpSound = -1;
+int gLandSound = -1;
+int gHitSound = -1;
+// What the sounds were last played for, see PlayGameSounds()
+int gSoundTick = 0;
+bool gSoundAirborne = false;
+bool gSoundGameOver = false;
 
 // color offset
 int colorOffset = 0;
 
-// day-night specification
-bool isDaytime = true;
-
 // ^^^^^^^^^^^^^^^^^^^^^^^^ Globals ^^^^^^^^^^^^^^^^^^^^^^^^^^^
 
 
 
-// vvvvvvvvvvvvvvvvvvv Error Handling Routines vvvvvvvvvvvvvvv
-static void GLClearAllErrors(){
-    while(glGetError() != GL_NO_ERROR){
+// Looks up the uniform locations used every frame in program. With
+// report set, returns false, after naming it, if one is missing; a
+// variant may leave out what it does not use, and GL ignores location -1.
+bool FindUniforms(const ShaderProgram& program, UniformLocations& uniforms, bool report){
+    const std::pair<const char*, GLint*> names[] = {
+        {"u_ModelMatrix",    &uniforms.modelMatrix},
+        {"u_DiffuseTexture", &uniforms.diffuseTexture},
+        {"u_UVOffset",       &uniforms.uvOffset},
+        {"u_PaletteIndex",   &uniforms.paletteIndex},
+        {"u_TimeOfDay",      &uniforms.timeOfDay},
+        {"u_Opacity",        &uniforms.opacity},
+        {"u_Time",           &uniforms.time},
+        {"u_JumpApex",       &uniforms.jumpApex},
+        {"u_SquashPivot",    &uniforms.squashPivot},
+    };
+    // Declared by some features only, so never reported
+    const std::pair<const char*, GLint*> featureNames[] = {
+        {"u_CrossfadeBand",  &uniforms.crossfadeBand},
+        {"u_Impostor",       &uniforms.impostor},
+        {"u_ImpostorPivot",  &uniforms.impostorPivot},
+        {"u_SkinVertices",   &uniforms.skinVertices},
+        {"u_Palette",        &uniforms.palette},
+    };
+    bool found = true;
+    for(const std::pair<const char*, GLint*>& name : names){
+        *name.second = program.GetUniformLocation(name.first);
+        if(*name.second < 0 && report){
+            std::cout << "Could not find " << name.first << ", maybe a misspelling?\n";
+            found = false;
+        }
     }
-}
-
-// Returns true if we have an error
-static bool GLCheckErrorStatus(const char* function, int line){
-    while(GLenum error = glGetError()){
-        std::cout << "OpenGL Error:" << error 
-                  << "\tLine: " << line 
-                  << "\tfunction: " << function << std::endl;
-        return true;
+    for(const std::pair<const char*, GLint*>& name : featureNames){
+        *name.second = program.GetUniformLocation(name.first);
     }
-    return false;
+    return found;
 }
 
-#define GLCheck(x) GLClearAllErrors(); x; GLCheckErrorStatus(#x,__LINE__);
-// ^^^^^^^^^^^^^^^^^^^ Error Handling Routines ^^^^^^^^^^^^^^^
+// Makes the variant for mask the one drawn with, a lookup of a program
+// built at startup
+void SelectSceneVariant(uint32_t mask){
+    gSceneVariant = mask;
+    gShaderProgram = gSceneVariants.Get(mask);
+    gUniforms = gVariantUniforms[mask];
+}
 
+// Looks up the uniforms of every variant built. The plain variant uses
+// all of them, so only its missing ones are reported.
+bool FindVariantUniforms(){
+    bool found = true;
+    for(uint32_t mask = 0; mask < SCENE_VARIANTS; ++mask){
+        const ShaderProgram* program = gSceneVariants.Get(mask);
+        if(program != nullptr){
+            found = FindUniforms(*program, gVariantUniforms[mask], mask == gSceneBindless) && found;
+        }
+    }
+    SelectSceneVariant(gSceneVariant);
+    return found;
+}
 
+// The scene variants to build: every mask below SCENE_BINDLESS, all of
+// them bindless or none, and each of them with SCENE_CROSSFADE unless
+// --impostor-distance=0 turned the impostors off
+std::vector<uint32_t> GetSceneVariantMasks(){
+    std::vector<uint32_t> masks;
+    for(uint32_t mask = 0; mask < SCENE_BINDLESS; ++mask){
+        masks.push_back(mask | gSceneBindless);
+        if(gImpostorDistance > 0.0f){
+            masks.push_back(mask | gSceneBindless | SCENE_CROSSFADE);
+        }
+    }
+    return masks;
+}
 
 /**
-* LoadShaderAsString takes a filepath as an argument and will read line by line a file and return a string that is meant to be compiled at runtime for a vertex, fragment, geometry, tesselation, or compute shader.
-* e.g.
-*       LoadShaderAsString("./shaders/filepath");
+* Create the graphics pipeline.
+* Every variant of the program starts compiling here, side by side,
+* while the loading screen runs; FinishGraphicsPipeline() links them
+* and looks up the uniform locations used every frame instead of in
+* PreDraw().
 *
-* @param filename Path to the shader file
-* @return Entire file stored as a single string 
+* @return void
 */
-std::string LoadShaderAsString(const std::string& filename){
-    // Resulting shader program loaded as a single string
-    std::string result = "";
+void CreateGraphicsPipeline(){
+    TraceLoad load(gTrace, "shaders");
+    gSceneVariants.SetFeatures({"DAY_NIGHT_BLEND", "WIREFRAME", "BINDLESS", "CROSSFADE"});
+    gSceneBindless = (gAllowBindless && GLAD_GL_ARB_bindless_texture) ? SCENE_BINDLESS : 0;
+    if(!gSceneVariants.BeginBuild("./shaders/vert.glsl", "./shaders/frag.glsl", GetSceneVariantMasks())){
+        std::cout << "Could not build the graphics pipeline\n";
+        exit(EXIT_FAILURE);
+    }
+}
 
-    std::string line = "";
-    std::ifstream myFile(filename.c_str());
+// Ends the build CreateGraphicsPipeline() began. A driver that lists the
+// bindless extension but fails the shaders gets the bound ones, built
+// then and there.
+void FinishGraphicsPipeline(){
+    TraceLoad load(gTrace, "shader link");
+    bool built = gSceneVariants.FinishBuild();
+    if(!built && gSceneBindless){
+        gSceneBindless = 0;
+        built = gSceneVariants.Build("./shaders/vert.glsl", "./shaders/frag.glsl", GetSceneVariantMasks());
+    }
+    if(!built){
+        std::cout << "Could not build the graphics pipeline\n";
+        exit(EXIT_FAILURE);
+    }
+    gSceneVariant = gSceneBindless;
+    std::cout << "Scene textures are " << (gSceneBindless ? "bindless" : "bound to a unit") << "\n";
+    if(!FindVariantUniforms()){
+        exit(EXIT_FAILURE);
+    }
+}
 
-    if(myFile.is_open()){
-        while(std::getline(myFile, line)){
-            result += line + '\n';
-        }
-        myFile.close();
+void RecordSceneCommands();
 
+// Rebuilds the graphics pipeline after an edit to its shaders. A shader
+// that does not build leaves the running program in place; a missing
+// uniform is reported, and ignored by GL, until the next edit.
+void ReloadGraphicsPipeline(){
+    if(!gSceneVariants.Rebuild()){
+        std::cout << "Kept the previous graphics pipeline\n";
+        return;
     }
-
-    return result;
+    FindVariantUniforms();
+    // The frame's commands name the programs just replaced
+    RecordSceneCommands();
+    std::cout << "Reloaded the graphics pipeline\n";
 }
 
 
 /**
-* CompileShader will compile any valid vertex, fragment, geometry, tesselation, or compute shader.
-* e.g.
-*	    Compile a vertex shader: 	CompileShader(GL_VERTEX_SHADER, vertexShaderSource);
-*       Compile a fragment shader: 	CompileShader(GL_FRAGMENT_SHADER, fragmentShaderSource);
+* Creates the application window and an OpenGL 4.5 core context on it,
+* or 4.1 where that is all there is.
 *
-* @param type We use the 'type' field to determine which shader we are going to compile.
-* @param source : The shader source code.
-* @return id of the shaderObject
+* @return void
 */
-GLuint CompileShader(GLuint type, const std::string& source){
-	// Compile our shaders
-	GLuint shaderObject;
-
-	// Based on the type passed in, we create a shader object specifically for that
-	// type.
-	if(type == GL_VERTEX_SHADER){
-		shaderObject = glCreateShader(GL_VERTEX_SHADER);
-	}else if(type == GL_FRAGMENT_SHADER){
-		shaderObject = glCreateShader(GL_FRAGMENT_SHADER);
+void CreateWindowContext(){
+	// Setup the OpenGL Context
+	// Use OpenGL 4.5 core for direct state access, see below for 4.1
+	SDL_GL_SetAttribute( SDL_GL_CONTEXT_MAJOR_VERSION, 4 );
+	SDL_GL_SetAttribute( SDL_GL_CONTEXT_MINOR_VERSION, gDirectStateAccess ? 5 : 1 );
+	SDL_GL_SetAttribute( SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE );
+	// We want to request a double buffer for smooth updating.
+	SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
+	SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, 24);
+	// Driver errors come through KHR_debug, which needs a debug context
+	if(gGLDebug){
+		SDL_GL_SetAttribute(SDL_GL_CONTEXT_FLAGS, SDL_GL_CONTEXT_DEBUG_FLAG);
+	}else if(gGLNoError){
+		SDL_GL_SetAttribute(SDL_GL_CONTEXT_NO_ERROR, 1);
 	}
 
-	const char* src = source.c_str();
-	// The source of our shader
-	glShaderSource(shaderObject, 1, &src, nullptr);
-	// Now compile our shader
-	glCompileShader(shaderObject);
-
-	// Retrieve the result of our compilation
-	int result;
-	// Our goal with glGetShaderiv is to retrieve the compilation status
-	glGetShaderiv(shaderObject, GL_COMPILE_STATUS, &result);
+	// Create an application window using OpenGL that supports SDL
+	{
+		ProfileZone zone(gWindowZone);
+		gGraphicsApplicationWindow = SDL_CreateWindow( "Dino Run 3D",
+														SDL_WINDOWPOS_UNDEFINED,
+														SDL_WINDOWPOS_UNDEFINED,
+														gScreenWidth,
+														gScreenHeight,
+														SDL_WINDOW_OPENGL | (gOffscreen ? SDL_WINDOW_HIDDEN : SDL_WINDOW_SHOWN) );
+	}
 
-	if(result == GL_FALSE){
-		int length;
-		glGetShaderiv(shaderObject, GL_INFO_LOG_LENGTH, &length);
-		char* errorMessages = new char[length]; // Could also use alloca here.
-		glGetShaderInfoLog(shaderObject, length, &length, errorMessages);
+	// Check if Window did not create.
+	if( gGraphicsApplicationWindow == nullptr ){
+		std::cout << "Window could not be created! SDL Error: " << SDL_GetError() << "\n";
+		exit(1);
+	}
 
-		if(type == GL_VERTEX_SHADER){
-			std::cout << "ERROR: GL_VERTEX_SHADER compilation failed!\n" << errorMessages << "\n";
-		}else if(type == GL_FRAGMENT_SHADER){
-			std::cout << "ERROR: GL_FRAGMENT_SHADER compilation failed!\n" << errorMessages << "\n";
+	// Create an OpenGL Graphics Context
+	{
+		ProfileZone zone(gContextZone);
+		gOpenGLContext = SDL_GL_CreateContext( gGraphicsApplicationWindow );
+		// 4.1 core or greater is all the renderer needs (and all macOS has)
+		if(gOpenGLContext == nullptr && gDirectStateAccess){
+			SDL_GL_SetAttribute( SDL_GL_CONTEXT_MINOR_VERSION, 1 );
+			gOpenGLContext = SDL_GL_CreateContext( gGraphicsApplicationWindow );
+		}
+		// Drivers without KHR_no_error refuse the whole context, at
+		// either version
+		if(gOpenGLContext == nullptr && gGLNoError && !gGLDebug){
+			SDL_GL_SetAttribute(SDL_GL_CONTEXT_NO_ERROR, 0);
+			SDL_GL_SetAttribute( SDL_GL_CONTEXT_MINOR_VERSION, gDirectStateAccess ? 5 : 1 );
+			gOpenGLContext = SDL_GL_CreateContext( gGraphicsApplicationWindow );
+			if(gOpenGLContext == nullptr && gDirectStateAccess){
+				SDL_GL_SetAttribute( SDL_GL_CONTEXT_MINOR_VERSION, 1 );
+				gOpenGLContext = SDL_GL_CreateContext( gGraphicsApplicationWindow );
+			}
 		}
-		// Reclaim our memory
-		delete[] errorMessages;
-
-		// Delete our broken shader
-		glDeleteShader(shaderObject);
-
-		return 0;
 	}
-
-  return shaderObject;
+	if( gOpenGLContext == nullptr){
+		std::cout << "OpenGL context could not be created! SDL Error: " << SDL_GetError() << "\n";
+		exit(1);
+	}
 }
 
-
-
 /**
-* Creates a graphics program object (i.e. graphics pipeline) with a Vertex Shader and a Fragment Shader
+* Creates the --headless context: no window, an EGL pbuffer of the window
+* size as framebuffer 0 on device gHeadlessDevice.
 *
-* @param vertexShaderSource Vertex source code as a string
-* @param fragmentShaderSource Fragment shader source code as a string
-* @return id of the program Object
+* @return void
 */
-GLuint CreateShaderProgram(const std::string& vertexShaderSource, const std::string& fragmentShaderSource){
-
-    // Create a new program object
-    GLuint programObject = glCreateProgram();
-
-    // Compile our shaders
-    GLuint myVertexShader   = CompileShader(GL_VERTEX_SHADER, vertexShaderSource);
-    GLuint myFragmentShader = CompileShader(GL_FRAGMENT_SHADER, fragmentShaderSource);
-
-    // Link our two shader programs together.
-	// Consider this the equivalent of taking two .cpp files, and linking them into
-	// one executable file.
-    glAttachShader(programObject,myVertexShader);
-    glAttachShader(programObject,myFragmentShader);
-    glLinkProgram(programObject);
-
-    // Validate our program
-    glValidateProgram(programObject);
-
-    // Once our final program Object has been created, we can
-	// detach and then delete our individual shaders.
-    glDetachShader(programObject,myVertexShader);
-    glDetachShader(programObject,myFragmentShader);
-	// Delete the individual shaders once we are done
-    glDeleteShader(myVertexShader);
-    glDeleteShader(myFragmentShader);
-
-    return programObject;
+void CreateHeadlessContext(){
+	ProfileZone zone(gContextZone);
+	bool created = gHeadlessContext.Create(gHeadlessDevice, 4, gDirectStateAccess ? 5 : 1, gGLDebug,
+	                                       gScreenWidth, gScreenHeight);
+	// 4.1 core or greater is all the renderer needs
+	if(!created && gDirectStateAccess){
+		created = gHeadlessContext.Create(gHeadlessDevice, 4, 1, gGLDebug, gScreenWidth, gScreenHeight);
+	}
+	if(!created){
+		std::cout << "Headless OpenGL context could not be created\n";
+		exit(1);
+	}
+	std::cout << "Headless on " << gHeadlessContext.GetDescription() << "\n";
 }
 
-
 /**
-* Create the graphics pipeline
+* Ends a frame: swaps the window, or the pbuffer of --headless.
 *
 * @return void
 */
-void CreateGraphicsPipeline(){
-
-    std::string vertexShaderSource      = LoadShaderAsString("./shaders/vert.glsl");
-    std::string fragmentShaderSource    = LoadShaderAsString("./shaders/frag.glsl");
+void PresentFrame(){
+	if(gHeadless){
+		gHeadlessContext.Swap();
+	}else{
+		SDL_GL_SwapWindow(gGraphicsApplicationWindow);
+	}
+}
 
-	gGraphicsPipelineShaderProgram = CreateShaderProgram(vertexShaderSource,fragmentShaderSource);
+/**
+* Stops the render workers and deletes their contexts.
+*
+* @return void
+*/
+void StopRenderWorkers(){
+	gRenderWorkers.Stop();
+	for(SDL_GLContext context : gWorkerContexts){
+		SDL_GL_DeleteContext(context);
+	}
+	gWorkerContexts.clear();
+	gHeadlessWorkerContexts.clear();
 }
 
+/**
+* Makes a context of the main context's share group for every render
+* worker and starts the workers on the environments from first on.
+*
+* @param first Environments the main context draws itself
+* @return Whether the workers run
+*/
+bool StartRenderWorkers(size_t first){
+	for(size_t i = 0; i < gRenderWorkerCount; ++i){
+		if(gHeadless){
+			std::unique_ptr<HeadlessContext> context(new HeadlessContext());
+			if(!context->CreateShared(gHeadlessContext)){
+				break;
+			}
+			gHeadlessWorkerContexts.push_back(std::move(context));
+		}else{
+			// A new context is made current, the main one is put back
+			SDL_GL_SetAttribute(SDL_GL_SHARE_WITH_CURRENT_CONTEXT, 1);
+			SDL_GLContext context = SDL_GL_CreateContext(gGraphicsApplicationWindow);
+			SDL_GL_MakeCurrent(gGraphicsApplicationWindow, gOpenGLContext);
+			if(context == nullptr){
+				std::cout << "Render worker context could not be created! SDL Error: " << SDL_GetError() << "\n";
+				break;
+			}
+			gWorkerContexts.push_back(context);
+		}
+	}
+	size_t contexts = gHeadless ? gHeadlessWorkerContexts.size() : gWorkerContexts.size();
+	bool started = contexts == gRenderWorkerCount &&
+	               gRenderWorkers.Start(gRenderWorkerCount, first, gObserveEnvCount - first, gObserveWidth,
+	                                    gObserveHeight, gObserveGrayscale, "./shaders/atlas_vert.glsl",
+	                                    "./shaders/frag.glsl", gMeshRegistry, gSceneArena,
+	                                    [](size_t worker, bool current){
+		if(gHeadless){
+			return gHeadlessWorkerContexts[worker]->MakeCurrent(current);
+		}
+		return SDL_GL_MakeCurrent(gGraphicsApplicationWindow, current ? gWorkerContexts[worker] : nullptr) == 0;
+	});
+	if(!started){
+		StopRenderWorkers();
+		return false;
+	}
+	std::cout << gRenderWorkerCount << " render workers draw " << gObserveEnvCount - first << " of the "
+	          << gObserveEnvCount << " environments\n";
+	return true;
+}
 
 /**
 * Initialization of the graphics application. Typically this will involve setting up a window
@@ -270,46 +926,59 @@ void CreateGraphicsPipeline(){
 * @return void
 */
 void InitializeProgram(){
-	// Initialize SDL
-	if(SDL_Init(SDL_INIT_VIDEO)< 0){
-		std::cout << "SDL could not initialize! SDL Error: " << SDL_GetError() << "\n";
-		exit(1);
+	// Initialize SDL; without a window only its events and timers are used
+	{
+		ProfileZone zone(gSDLInitZone);
+		if(SDL_Init(gHeadless ? (SDL_INIT_EVENTS | SDL_INIT_TIMER) : SDL_INIT_VIDEO)< 0){
+			std::cout << "SDL could not initialize! SDL Error: " << SDL_GetError() << "\n";
+			exit(1);
+		}
 	}
 	
-	// Setup the OpenGL Context
-	// Use OpenGL 4.1 core or greater
-	SDL_GL_SetAttribute( SDL_GL_CONTEXT_MAJOR_VERSION, 4 );
-	SDL_GL_SetAttribute( SDL_GL_CONTEXT_MINOR_VERSION, 1 );
-	SDL_GL_SetAttribute( SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE );
-	// We want to request a double buffer for smooth updating.
-	SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
-	SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, 24);
-
-	// Create an application window using OpenGL that supports SDL
-	gGraphicsApplicationWindow = SDL_CreateWindow( "Dino Run 3D",
-													SDL_WINDOWPOS_UNDEFINED,
-													SDL_WINDOWPOS_UNDEFINED,
-													gScreenWidth,
-													gScreenHeight,
-													SDL_WINDOW_OPENGL | SDL_WINDOW_SHOWN );
-
-	// Check if Window did not create.
-	if( gGraphicsApplicationWindow == nullptr ){
-		std::cout << "Window could not be created! SDL Error: " << SDL_GetError() << "\n";
-		exit(1);
+	// Create the window and its context, or the context alone
+	if(gHeadless){
+		CreateHeadlessContext();
+	}else{
+		CreateWindowContext();
 	}
 
-	// Create an OpenGL Graphics Context
-	gOpenGLContext = SDL_GL_CreateContext( gGraphicsApplicationWindow );
-	if( gOpenGLContext == nullptr){
-		std::cout << "OpenGL context could not be created! SDL Error: " << SDL_GetError() << "\n";
-		exit(1);
+	// Initialize GLAD Library
+	{
+		ProfileZone zone(gLoaderZone);
+		if(!gladLoadGLLoader(gHeadless ? HeadlessContext::GetProcAddress : SDL_GL_GetProcAddress)){
+			std::cout << "glad did not initialize" << std::endl;
+			exit(1);
+		}
 	}
 
-	// Initialize GLAD Library
-	if(!gladLoadGLLoader(SDL_GL_GetProcAddress)){
-		std::cout << "glad did not initialize" << std::endl;
-		exit(1);
+	if(gGLDebug){
+		GLDebugOutput::Get().Enable(gGLDebugSynchronous);
+	}
+	GLBackend::Get().Initialize(gDirectStateAccess);
+	// GL_CONTEXT_FLAG_NO_ERROR_BIT, which the loader predates
+	GLint contextFlags = 0;
+	glGetIntegerv(GL_CONTEXT_FLAGS, &contextFlags);
+	bool parallelCompile = ShaderProgram::EnableParallelCompile();
+	std::cout << "OpenGL " << GLVersion.major << "." << GLVersion.minor << ", "
+	          << (GLBackend::Get().HasDirectStateAccess() ? "direct state access" : "bind to edit")
+	          << ((contextFlags & 0x8) ? ", no error checking" : "")
+	          << (parallelCompile ? ", parallel shader compiles" : "") << "\n";
+
+	ProgramCache::Get().SetDirectory(gShaderCachePath);
+	ProgramCache::Get().Initialize();
+
+	// Set the swap interval explicitly instead of relying on the driver default;
+	// a pbuffer has nothing to wait for
+	if(gHeadless){
+		return;
+	}
+	int swapInterval = (gSwapMode == SWAP_VSYNC) ? 1 : (gSwapMode == SWAP_ADAPTIVE) ? -1 : 0;
+	if(SDL_GL_SetSwapInterval(swapInterval) != 0){
+		if(gSwapMode == SWAP_ADAPTIVE && SDL_GL_SetSwapInterval(1) == 0){
+			std::cout << "Adaptive vsync is not supported, using vsync" << std::endl;
+		}else{
+			std::cout << "Could not set the swap interval: " << SDL_GetError() << std::endl;
+		}
 	}
 	
 }
@@ -320,446 +989,3839 @@ float map_linear(float x, float in_min, float in_max, float out_min, float out_m
     return (x-in_min) * (out_max - out_min) / (in_max - in_min) + out_min;;
 }
 
-// Regenerate our model data
-void GenerateModelBufferData(const std::vector<ObjLoader>& loaders){
+// A mesh that stays resident on the GPU. Its vertices are never rewritten:
+// entities draw it through their Renderable and Transform components.
+// Every object is a range of the scene arena.
+struct SceneObject{
+    // The full mesh, and every level of detail including it
+    DrawRange range;
+    LodRanges lods;
+    // Model space bounds, the source of the entity colliders, and the
+    // sphere around them that entities are culled with
+    AABB bounds;
+    BoundingSphere sphere;
+    // The full mesh's triangles seen from the side, x, y per corner in
+    // model space, which the collision silhouettes are baked from
+    std::vector<float> profile;
+};
+
+// Number of run-cycle frames of the dino
+const int DINO_FRAME_COUNT = 2;
+
+// Resident scene objects, created once in VertexSpecification()
+SceneObject gDayBackground;
+SceneObject gNightBackground;
+SceneObject gDinoFrames[DINO_FRAME_COUNT];
+SceneObject gCactus;
+
+// Obstacles are drawn as instances of the cactus range, at most a full lane
+const size_t MAX_OBSTACLES = OBSTACLE_LANE_CAPACITY;
+
+// The cactus's impostor quad in the scene arena, and the texture layers
+// its pictures by day and by night are baked into; -1 while impostors
+// are off
+DrawRange gCactusImpostor;
+int gImpostorDayLayer = -1;
+int gImpostorNightLayer = -1;
+ImpostorBaker gImpostorBaker;
+// The one cactus of a bake, apart from the frame's scene batch
+DrawBatch gImpostorBatch;
+// Set once the pictures exist, from then on distant obstacles are drawn
+// as impostors; cleared when the scene textures cannot be copied into
+bool gImpostorsBaked = false;
+bool gImpostorsUnavailable = false;
+// What the pictures were baked from. Any change, a rebuilt arena or a
+// scene texture that finished uploading bakes them again.
+bool gImpostorsStale = true;
+int gImpostorPalette = -1;
+
+// Everything drawn, by archetype. The background archetype holds a row
+// per dune layer; the sky's one row is scrolled like them but drawn by
+// the sky pass.
+EntityStore gEntities;
+ArchetypeId gBackgroundArchetype = 0;
+ArchetypeId gSkyArchetype = 0;
+// Set once CreateSceneEntities() has run
+bool gSceneEntitiesCreated = false;
+ArchetypeId gDinoArchetype = 0;
+// Where entities made of parts are placed. The track is the root; the dino
+// hangs under it, and parts of a model split into pieces would hang under
+// the dino. Rows of archetypes with COMPONENT_NODE follow their node.
+TransformHierarchy gSceneHierarchy;
+uint32_t gTrackNode = NO_TRANSFORM_NODE;
+uint32_t gDinoNode = NO_TRANSFORM_NODE;
+ArchetypeId gObstacleArchetype = 0;
+// A row per obstacle far enough to be drawn as an impostor
+ArchetypeId gImpostorArchetype = 0;
+// The entities of --stress, empty without it
+ArchetypeId gStressCactusArchetype = 0;
+ArchetypeId gStressDinoArchetype = 0;
+// Stress entities that overlapped the dino in the last frame
+size_t gStressCollisions = 0;
+// A row per ghost runner, grouped by run frame. Ghosts run a little
+// behind the dino's lane, so the dino covers them where they overlap.
+ArchetypeId gGhostArchetype = 0;
+const float GHOST_Z_OFFSET = -0.05f;
+// The ghost runners, in versus mode the opponent and in split screen the
+// other local players
+const size_t GHOST_SLOTS = GhostRunners::MAX_GHOSTS + 1 + MAX_LOCAL_PLAYERS - 1;
+inline size_t GetGhostSlots(){
+    return gGhosts.GetCount() + (gVersusPeer.empty() ? 0 : 1) + gLocalPlayers - 1;
+}
+// How much of a ghost shows over what is behind it
+const float GHOST_OPACITY = 0.35f;
+// Cosmetic motion of the dino and the ghosts, drawn by the vertex shader:
+// run bob height in game units and squash and stretch around a jump
+const float DINO_BOB_HEIGHT = 3.0f;
+const float DINO_SQUASH = 0.12f;
+// The step clocks of this frame, which u_Time is set to: the player's
+// game tick for the dino and the ghosts' own for theirs, each
+// interpolated like the rest of the render state
+float gDinoClock = 0.0f;
+float gGhostClock = 0.0f;
+// The game tick in double, as far as the sky's panorama has scrolled
+double gSkyClock = 0.0;
+// The dino's rig. With its run clip, the dino and the ghosts draw the
+// first run frame skinned to the clip's pose of the frame instead of
+// swapping between the frames' meshes.
+const char* const DINO_RIG_PATH = "./common/objects/dino.rig";
+const char* const PALETTE_PATH = "./common/objects/palette.ppm";
+Skeleton gDinoSkeleton;
+int gDinoRunClip = -1;
+// Joints of this frame's pose, sampled on the dino's clock
+glm::vec4 gDinoPose[MAX_SKIN_JOINTS * 3];
+// Which joints the arena's vertices follow
+SkinBuffer gSkinBuffer;
+// Colour schemes of the dinos and cacti, see PaletteTexture.hpp
+PaletteTexture gPalette;
+// The player's jump, re-anchored after every step by Simulate()
+JumpAnchor gDinoJump;
+
+// A texture of the parallax background; no path for the sky, whose
+// textures are the background models' own
+struct ParallaxTexture{
+    const char* path;
+    int* layer;
+    bool* ready;
+};
+
+// A layer of the parallax background. The sky is drawn by the sky pass,
+// every other layer is an instance of the background quad sampling its
+// day and night texture array layers, moved towards the camera by z, so
+// all of them go out as one instanced draw. Each scrolls at its own rate.
+struct ParallaxLayer{
+    ParallaxTexture day;
+    ParallaxTexture night;
+    // Scrolled in texture space, wrapping every periodTicks where the
+    // layer's texture repeats, half of its width
+    float uPerTick;
+    int periodTicks;
+    float z;
+};
+
+// Texture layers of the dunes, far then near, day then night
+int gDuneLayers[4] = {0, 0, 0, 0};
+bool gDuneLayersReady[4] = {false, false, false, false};
+
+// The sky moves with the ground beneath it, the dunes, back to front,
+// slower the further away they are
+const ParallaxLayer SKY_LAYER =
+    {{nullptr, &gDayLayer, &gDayLayerReady}, {nullptr, &gNightLayer, &gNightLayerReady}, 0.004f, 125, 0.0f};
+const ParallaxLayer PARALLAX_LAYERS[] = {
+    {{"./common/objects/dunes_far.ppm", &gDuneLayers[0], &gDuneLayersReady[0]},
+     {"./common/objects/dunes_far_night.ppm", &gDuneLayers[1], &gDuneLayersReady[1]}, 0.001f, 500, 0.5f},
+    {{"./common/objects/dunes_near.ppm", &gDuneLayers[2], &gDuneLayersReady[2]},
+     {"./common/objects/dunes_near_night.ppm", &gDuneLayers[3], &gDuneLayersReady[3]}, 0.002f, 250, 1.0f},
+};
+const size_t PARALLAX_LAYER_COUNT = sizeof(PARALLAX_LAYERS)/sizeof(PARALLAX_LAYERS[0]);
+
+// Ticks before the end of a day or a night over which it fades into the
+// other one
+const int TIME_OF_DAY_FADE_TICKS = 120;
+// How far into night the frame being built is, for u_TimeOfDay
+float gTimeOfDay = 0.0f;
+
+// The track, streamed in chunks; row i of the ground archetype draws slot i
+GroundStream gGround;
+ArchetypeId gGroundArchetype = 0;
+
+// Per-frame capacity of the scene batch: dune layers, ground chunks,
+// dino, obstacles and their impostors. Every chunk is its own range, so
+// its own command.
+const size_t MAX_SCENE_INSTANCES = PARALLAX_LAYER_COUNT + GROUND_CHUNK_SLOTS + 1 + 2*MAX_OBSTACLES;
+// Obstacles take a command per level of detail, their impostors one.
+const size_t MAX_SCENE_COMMANDS = 1 + GROUND_CHUNK_SLOTS + 1 + MAX_MESH_LODS + 1;
+
+// One view of the scene, the whole target unless the screen is split:
+// where it is drawn and which commands of gSceneBatch it draws in each
+// pass. The character pass draws the characters, the stress entities,
+// then the obstacles and their impostors. Set by BuildDrawList().
+struct SceneCommandRange{
+    size_t first = 0;
+    size_t count = 0;
+};
+struct SceneView{
+    size_t index = 0;
+    ViewportRect rect;
+    SceneCommandRange background;
+    SceneCommandRange characters;
+    // A range for each mesh, as the GPU culls a range with one sphere
+    SceneCommandRange stressCacti;
+    SceneCommandRange stressDinos;
+    SceneCommandRange obstacles;
+    SceneCommandRange impostors;
+    SceneCommandRange ghosts;
+    // What the stress entities are culled against on the GPU
+    Frustum frustum;
+};
+SceneView gSceneViews[MAX_VIEWPORTS];
+size_t gSceneViewCount = 1;
+// The pass field of the scene's sort keys, in the order they are drawn.
+// Every view has a key of its own in each, pass*MAX_VIEWPORTS + view,
+// so the sort keeps a pass's views apart and in order.
+const uint32_t SCENE_PASS_BACKGROUND   = 0;
+const uint32_t SCENE_PASS_CHARACTERS   = 1;
+const uint32_t SCENE_PASS_STRESS_CACTI = 2;
+const uint32_t SCENE_PASS_STRESS_DINOS = 3;
+const uint32_t SCENE_PASS_OBSTACLES    = 4;
+const uint32_t SCENE_PASS_IMPOSTORS    = 5;
+const uint32_t SCENE_PASS_GHOSTS       = 6;
+// Draw calls the scene took in the last frame, for the overlay
+size_t gSceneDrawCalls = 0;
+
+// Loads the vertex stream for an OBJ path. A precompiled .dmesh next to the
+// OBJ is used when present, otherwise the OBJ is parsed. Runs as an asset
+// parse job.
+Mesh LoadSceneModel(const std::string& objPath){
+    Mesh model;
+
+    MeshFile meshFile;
+    if(meshFile.Load(MeshFile::DMeshPathFor(objPath))){
+        model.vertices.assign(meshFile.GetVertexData(),
+                              meshFile.GetVertexData() + meshFile.GetFloatCount());
+        model.indices.assign(meshFile.GetIndexData(),
+                             meshFile.GetIndexData() + meshFile.GetIndexCount());
+        model.lods.assign(meshFile.GetLods(), meshFile.GetLods() + meshFile.GetLodCount());
+        model.bounds = meshFile.GetBounds();
+        model.texture = meshFile.GetMaterial();
+    }else{
+        ObjLoader loader(objPath, 0);
+        loader.getIndexedMesh(model.vertices, model.indices);
+        model.bounds = loader.getBounds();
+        model.texture = loader.getTextureName();
+        // Levels of detail are only built with the .dmesh
+        model.lods.push_back(MeshLod{0, (uint32_t)model.indices.size(), 0.0f});
+    }
+    ExtractPositions(model.vertices.data(), model.vertices.size() / FLOATS_PER_VERTEX, model.positions);
+    return model;
+}
 
-    std::vector<GLfloat> vertexDataFloor;
+// The first of candidates that exists, for the asset loader to read ahead
+// of the parse that picks it the same way; none if none does or if the
+// first one found is in the asset pack and mapped already, not compressed
+std::vector<std::string> GetFileToRead(const std::vector<std::string>& candidates){
+    std::error_code error;
+    for(const std::string& path : candidates){
+        size_t size = 0;
+        bool compressed = false;
+        if(AssetPack::Get().Stat(path, size, compressed)){
+            // Mapped already unless it has to be decompressed
+            return compressed ? std::vector<std::string>{path} : std::vector<std::string>();
+        }
+        if(std::filesystem::is_regular_file(path, error)){
+            return {path};
+        }
+    }
+    return {};
+}
 
-    for(const ObjLoader& loader: loaders){
-        // Generate a model with the resolution
-    std::vector<Triangle> mesh = loader.getTriangles();
+// Requests the vertex stream of an OBJ path, see LoadSceneModel(). Its
+// upload only hands the stream to the future's continuations, which copy
+// it where it goes on the GPU.
+AssetFuture<Mesh> RequestSceneModel(const std::string& objPath){
+    return gAssets.Request<Mesh>(objPath,
+        [objPath](Mesh& model){
+            model = LoadSceneModel(objPath);
+        },
+        [](Mesh& model, size_t& budget){
+            return true;
+        },
+        GetFileToRead({MeshFile::DMeshPathFor(objPath), objPath}));
+}
 
-    int xModifier = 0;
-    int yModifier = 0;
-    int uModifier = 0;
-    int colorModifier = 0;
-    // Dino type
-    if (loader.modelType == 1) {
-        yModifier = g.currentDinoHeight;
-        colorModifier = colorOffset;
+// A scene texture as its parse job decoded it: a compressed .ktx variant if
+// one the GPU supports exists, otherwise the .ppm. Once its size is
+// checked a job copies it into a pixel unpack buffer, the staging
+// copy, and the bands are uploaded from there.
+struct LayerTexture{
+    std::string path;
+    KTXFile ktx;
+    bool compressed{false};
+    std::unique_ptr<Image> image;
+    PixelUnpackBuffer staging;
+    uint8_t* mapped{nullptr};
+    bool staged{false};
+    // First level of the .ktx that is uploaded
+    int baseLevel{0};
+    // Where each mip level starts in the staging copy
+    std::vector<size_t> levelOffsets;
+    int nextLevel{0};
+    int nextRow{0};
+};
+
+// Start of a mip level of a scene texture for the upload calls: an
+// offset into the staging copy while it is bound, otherwise the decoded
+// bytes themselves
+static const uint8_t* GetLayerLevelSource(const LayerTexture& texture, int level){
+    if(texture.staged){
+        return reinterpret_cast<const uint8_t*>(texture.levelOffsets[level]);
     }
-    // Obstacle type
-    if (loader.modelType == 2) {
-        xModifier = g.cactusPosition;
-        colorModifier = colorOffset;
+    if(texture.compressed){
+        return (const uint8_t*)texture.ktx.GetLevelData(texture.baseLevel + level);
     }
-    // Background type
-    if (loader.modelType == 3) {
-        uModifier = tick % 125;
-    }
-
-    // Iterate over each triangle in the mesh
-    for(const Triangle& triangle : mesh){
-        // Iterate over each vertex in the triangle
-        for(int i = 0; i < 3; i++) {
-            const Vertex& vertex = triangle.vertices[i];
-            const Normal& normal = triangle.normals[i];
-            const TextureCoords& texture = triangle.textures[i];
+    return texture.image->GetPixelDataPtr();
+}
 
-            vertexDataFloor.push_back(vertex.x+(xModifier*0.01f));
-            vertexDataFloor.push_back(vertex.y+(yModifier*0.01f));
-            vertexDataFloor.push_back(vertex.z);
-            vertexDataFloor.push_back(normal.nx);
-            vertexDataFloor.push_back(normal.ny);
-            vertexDataFloor.push_back(normal.nz);
-            vertexDataFloor.push_back(texture.u-(uModifier*0.004f)+(colorModifier*0.003906f));
-            vertexDataFloor.push_back(texture.v);
+// Uploads as many bands of rows of a scene texture as the budget allows.
+// Returns true once every level is uploaded.
+static bool UploadLayerBands(LayerTexture& texture, int layer, size_t& budget){
+    const int width = gSceneTextures.GetWidth();
+    const int height = gSceneTextures.GetHeight();
+    const GLenum format = gSceneTextures.GetInternalFormat();
+    const int levels = gSceneTextures.GetLevelCount();
+    int& nextLevel = texture.nextLevel;
+    int& nextRow = texture.nextRow;
+    if(texture.staged){
+        texture.staging.Bind();
+    }
+    if(texture.compressed){
+        // The small levels take less than a band, so keep going
+        // through them while there is budget left
+        while(nextLevel < levels && budget > 0){
+            int levelWidth = std::max(1, width >> nextLevel);
+            int levelHeight = std::max(1, height >> nextLevel);
+            // Four texel rows per row of blocks
+            size_t blockRowBytes = KTXFile::GetImageBytes(format, levelWidth, 4);
+            int blockRows = (int)std::max<size_t>(1, budget / blockRowBytes);
+            int rows = std::min(levelHeight - nextRow, blockRows * 4);
+            size_t uploaded = KTXFile::GetImageBytes(format, levelWidth, rows);
+            const char* source = (const char*)GetLayerLevelSource(texture, nextLevel);
+            gSceneTextures.UploadCompressedRows(layer, nextLevel, nextRow, rows,
+                source + (nextRow / 4) * blockRowBytes, uploaded);
+            budget -= std::min(budget, uploaded);
+            nextRow += rows;
+            if(nextRow >= levelHeight){
+                ++nextLevel;
+                nextRow = 0;
+            }
+        }
+    }else{
+        size_t rowBytes = (size_t)width * 4;
+        int rows = (int)std::min<size_t>(height - nextRow, std::max<size_t>(1, budget / rowBytes));
+        gSceneTextures.UploadRows(layer, nextRow, rows, GetLayerLevelSource(texture, 0) + nextRow * rowBytes);
+        budget -= std::min(budget, rows * rowBytes);
+        nextRow += rows;
+        if(nextRow >= height){
+            nextLevel = levels;
         }
     }
+    if(texture.staged){
+        PixelUnpackBuffer::Unbind();
     }
-
-
-		// Store size in a global so you can later determine how many
-		// vertices to draw in glDrawArrays;
-    gFloorTriangles = vertexDataFloor.size();
-
-		glBindBuffer(GL_ARRAY_BUFFER, gVertexBufferObjectFloor);
-		glBufferData(GL_ARRAY_BUFFER, 						// Kind of buffer we are working with 
-																							// (e.g. GL_ARRAY_BUFFER or GL_ELEMENT_ARRAY_BUFFER)
-							 vertexDataFloor.size() * sizeof(GL_FLOAT), 	// Size of data in bytes
-							 vertexDataFloor.data(), 											// Raw array of data
-							 GL_STATIC_DRAW);															// How we intend to use the data
+    return nextLevel >= levels;
 }
 
 /**
-* Setup your geometry during the vertex specification step
+* Queues a texture of the scene texture array. It is decoded by a job
+* and its size checked on the GL thread, which maps a pixel unpack buffer
+* for it. A second asset then copies the texels into that buffer in a
+* job and uploads them from it a band of rows at a time within the
+* frame's budget, so the driver moves them to the GPU asynchronously;
+* ready is set once the whole layer is on the GPU. Without a buffer the
+* bands are uploaded from the decoded memory. The first texture uploaded
+* sizes the array and picks its format and mip levels, every later one
+* must match it. Compressed variants are uploaded as stored, level by
+* level in bands of whole block rows. Queued again for a layer that is
+* ready (a hot reload), the layer is overwritten in place, and a file
+* that cannot be used leaves it as it was.
 *
 * @return void
 */
-void VertexSpecification(){
+void QueueLayerTexture(const std::string& filepath, int layer, bool* ready){
+    std::shared_ptr<LayerTexture> texture = std::make_shared<LayerTexture>();
+    std::vector<std::string> candidates;
+    for(const std::string& suffix : gTextureSuffixes){
+        candidates.push_back(KTXFile::VariantPathFor(filepath, suffix));
+    }
+    candidates.push_back(filepath);
+    gAssets.Load(filepath, GetFileToRead(candidates),
+        [texture, filepath]{
+            for(const std::string& suffix : gTextureSuffixes){
+                texture->path = KTXFile::VariantPathFor(filepath, suffix);
+                if(texture->ktx.Load(texture->path)){
+                    texture->compressed = true;
+                    return;
+                }
+            }
+            texture->path = filepath;
+            texture->image.reset(new Image(filepath));
+            // Padded to RGBA, so the rows upload 4-byte aligned; magenta
+            // is transparent, where a parallax layer shows the ones behind
+            texture->image->LoadPPM(true, true, true);
+        },
+        [texture, filepath, layer, ready](size_t& budget){
+            int width = 0;
+            int height = 0;
+            GLenum format = GL_RGBA8;
+            int levels = 1;
+            if(texture->compressed){
+                // Levels too large to ever be sampled stay in the file
+                texture->baseLevel = KTXFile::GetBaseLevel(texture->ktx.GetWidth(), texture->ktx.GetHeight(),
+                                                           texture->ktx.GetLevelCount(),
+                                                           gTextureFootprintWidth, gTextureFootprintHeight);
+                width = std::max(1, texture->ktx.GetWidth() >> texture->baseLevel);
+                height = std::max(1, texture->ktx.GetHeight() >> texture->baseLevel);
+                format = texture->ktx.GetInternalFormat();
+                levels = texture->ktx.GetLevelCount() - texture->baseLevel;
+            }else if(texture->image->GetPixelDataPtr() != nullptr){
+                width = texture->image->GetWidth();
+                height = texture->image->GetHeight();
+            }else{
+                std::cout << "Could not load the scene texture " << texture->path << "\n";
+                // A hot reload keeps the layer it had
+                if(*ready){
+                    return true;
+                }
+                exit(EXIT_FAILURE);
+            }
+            if(!gSceneTextures.IsAllocated()){
+                gSceneTextures.Allocate(width, height, format, levels);
+            }else if(width != gSceneTextures.GetWidth() || height != gSceneTextures.GetHeight() ||
+                     format != gSceneTextures.GetInternalFormat() || levels != gSceneTextures.GetLevelCount()){
+                std::cout << texture->path << " is " << width << "x" << height << " with " << levels
+                          << " levels in format 0x" << std::hex << format << ", every scene texture must be "
+                          << std::dec << gSceneTextures.GetWidth() << "x" << gSceneTextures.GetHeight()
+                          << " with " << gSceneTextures.GetLevelCount() << " levels in format 0x"
+                          << std::hex << gSceneTextures.GetInternalFormat() << std::dec << "\n";
+                if(*ready){
+                    return true;
+                }
+                exit(EXIT_FAILURE);
+            }
 
-	// Vertex Arrays Object (VAO) Setup
-	glGenVertexArrays(1, &gVertexArrayObjectFloor);
-	// We bind (i.e. select) to the Vertex Array Object (VAO) that we want to work withn.
-	glBindVertexArray(gVertexArrayObjectFloor);
-	// Vertex Buffer Object (VBO) creation
-	glGenBuffers(1, &gVertexBufferObjectFloor);
-
-    // Load the background
-    std::string backgroundPath;
-    if (isDaytime) {
-        backgroundPath = "./common/objects/bg.obj";
-    } else {
-        backgroundPath = "./common/objects/bg_night.obj";
-    }
-    ObjLoader loader1(backgroundPath, 3);
-    gTexture.LoadTexture(loader1.getTextureName());
-
-    // Load the dino
-    std::string dinoName = "./common/objects/dino.obj";
-    if (tick % 30 < 15) {
-        dinoName = "./common/objects/dino2.obj";
-    }
-    ObjLoader loader2(dinoName, 1);
-
-    // Load the obstacle
-    ObjLoader loader3("./common/objects/cactus.obj", 2);
-
-    GenerateModelBufferData({loader1, loader2, loader3});
- 
-    // =============================
-    // offsets every 3 floats
-    // v     v     v
-    // 
-    // x,y,z,r,g,b,nx,ny,nz
-    //
-    // |------------------| strides is '9' floats
-    //
-    // ============================
-    // Position information (x,y,z)
-	glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE,sizeof(GL_FLOAT)*8,(void*)0);
-    // Color information (r,g,b)
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE,sizeof(GL_FLOAT)*8,(GLvoid*)(sizeof(GL_FLOAT)*3));
-    // Normal information (nx,ny,nz)
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE,sizeof(GL_FLOAT)*8, (GLvoid*)(sizeof(GL_FLOAT)*6));
-
-	// Unbind our currently bound Vertex Array Object
-	glBindVertexArray(0);
-	// Disable any attributes we opened in our Vertex Attribute Arrray,
-	// as we do not want to leave them open. 
-	glDisableVertexAttribArray(0);
-	glDisableVertexAttribArray(1);
-	glDisableVertexAttribArray(2);
+            if(texture->levelOffsets.empty()){
+                if(texture->baseLevel > 0){
+                    std::cout << texture->path << ": " << width << "x" << height << " is enough for a "
+                              << gTextureFootprintWidth << "x" << gTextureFootprintHeight
+                              << " footprint, skipping " << texture->baseLevel << " mip levels\n";
+                }
+                // Lay the levels out back to back in one staging copy
+                size_t stagingBytes = 0;
+                for(int level = 0; level < levels; ++level){
+                    texture->levelOffsets.push_back(stagingBytes);
+                    stagingBytes += texture->compressed ? texture->ktx.GetLevelSize(texture->baseLevel + level)
+                                                        : (size_t)width * height * 4;
+                }
+                texture->mapped = texture->staging.Map(stagingBytes);
+            }
+            if(texture->mapped == nullptr){
+                if(!UploadLayerBands(*texture, layer, budget)){
+                    return false;
+                }
+                texture->staging.Release();
+                *ready = true;
+                gImpostorsStale = true;
+                return true;
+            }
+            gAssets.Load(filepath,
+                [texture]{
+                    // Plain memory, no GL: the copy stays off the GL thread
+                    int levelCount = (int)texture->levelOffsets.size();
+                    for(int level = 0; level < levelCount; ++level){
+                        const uint8_t* source = GetLayerLevelSource(*texture, level);
+                        size_t bytes = texture->compressed ? texture->ktx.GetLevelSize(texture->baseLevel + level)
+                                                           : texture->staging.GetSize();
+                        memcpy(texture->mapped + texture->levelOffsets[level], source, bytes);
+                    }
+                },
+                [texture, layer, ready](size_t& budget){
+                    if(texture->staging.IsMapped()){
+                        // Lost contents are uploaded from the decoded copy instead
+                        texture->staged = texture->staging.Unmap();
+                        texture->mapped = nullptr;
+                        // The staging copy has the texels, the decoded
+                        // ones need not wait out the bands
+                        if(texture->staged){
+                            texture->image.reset();
+                        }
+                    }
+                    if(!UploadLayerBands(*texture, layer, budget)){
+                        return false;
+                    }
+                    texture->staging.Release();
+                    *ready = true;
+                    gImpostorsStale = true;
+                    return true;
+                });
+            return true;
+        });
 }
 
+// A model to pack into the scene arena, the object that will draw it and,
+// for textured models, where its texture layer goes
+struct SceneModelSource{
+    const char* objPath;
+    SceneObject* object;
+    int* layer;
+    bool* layerReady;
+    // Size of the model's whole texture on screen, in drawables, with the
+    // model as close as the camera gets; 0 for untextured models
+    float textureFootprint;
+    // Rig the model is skinned to, nullptr for none
+    const Skeleton* skeleton;
+};
+
+// Vertices and indices of the scene arena, collected as the models upload,
+// and where each model will sit in it
+struct SceneArenaStaging{
+    std::vector<GLfloat> vertices;
+    std::vector<uint32_t> indices;
+    std::vector<SceneObject> objects;
+    // Joints of every vertex, all weights 0 for unskinned models
+    std::vector<SkinVertex> skin;
+};
+
+// Every model of the scene, in arena order
+const SceneModelSource SCENE_MODELS[] = {
+    // A background face fills the view with half of the texture each way
+    {"./common/objects/bg.obj",         &gDayBackground,   &gDayLayer,   &gDayLayerReady,   2.0f, nullptr},
+    {"./common/objects/bg_night.obj",   &gNightBackground, &gNightLayer, &gNightLayerReady, 2.0f, nullptr},
+    {"./common/objects/dino.obj",       &gDinoFrames[0],   nullptr,      nullptr,           0.0f, &gDinoSkeleton},
+    {"./common/objects/dino2.obj",      &gDinoFrames[1],   nullptr,      nullptr,           0.0f, nullptr},
+    {"./common/objects/cactus.obj",     &gCactus,          nullptr,      nullptr,           0.0f, nullptr},
+};
+const size_t SCENE_MODEL_COUNT = sizeof(SCENE_MODELS)/sizeof(SCENE_MODELS[0]);
+
+void UpdateSceneEntityShapes();
 
 /**
-* PreDraw
-* Typically we will use this for setting some sort of 'state'
-* Note: some of the calls may take place at different stages (post-processing) of the
-* 		 pipeline.
+* Queues every model of one shared vertex/index arena. Each model keeps its
+* own indices and is selected at draw time by its index range and base
+* vertex, so all of them can be submitted as one batch. Models are
+* requested as futures, parsed as jobs and appended by their continuations
+* in order; the arena is created on the GPU
+* once the last one is in, and gSceneArena is set then. A textured model
+* queues its texture when it is appended.
+*
+* Queued again after gSceneArena exists (a hot reload), the arena is
+* rebuilt in place and the objects and entities only switch to the new
+* ranges once it is, so no frame draws a range the buffers do not hold.
+*
 * @return void
 */
-void PreDraw(){
-	// Disable depth test and face culling.
-    glEnable(GL_DEPTH_TEST);                    // NOTE: Need to enable DEPTH Test
-    glDisable(GL_CULL_FACE);
-
-    // Set the polygon fill mode
-    glPolygonMode(GL_FRONT_AND_BACK,gPolygonMode);
-
-    // Initialize clear color
-    // This is the background of the screen.
-    glViewport(0, 0, gScreenWidth, gScreenHeight);
-    glClearColor( 0.0f, 1.0f, 0.0f, 1.0f );
-
-    //Clear color buffer and Depth Buffer
-  	glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
-
-    // Use our shader
-	glUseProgram(gGraphicsPipelineShaderProgram);
-
-    // Model transformation by translating our object into world space
-    glm::mat4 model = glm::translate(glm::mat4(1.0f),glm::vec3(0.0f,0.0f,0.0f)); 
-
-
-    // Retrieve our location of our Model Matrix
-    GLint u_ModelMatrixLocation = glGetUniformLocation( gGraphicsPipelineShaderProgram,"u_ModelMatrix");
-    if(u_ModelMatrixLocation >=0){
-        glUniformMatrix4fv(u_ModelMatrixLocation,1,GL_FALSE,&model[0][0]);
-    }else{
-        std::cout << "Could not find u_ModelMatrix, maybe a mispelling?\n";
-        exit(EXIT_FAILURE);
+void QueueSceneArena(const SceneModelSource* sources, size_t sourceCount){
+    std::shared_ptr<SceneArenaStaging> staging = std::make_shared<SceneArenaStaging>();
+    staging->objects.resize(sourceCount);
+    for(size_t i = 0; i < sourceCount; ++i){
+        const SceneModelSource source = sources[i];
+        RequestSceneModel(source.objPath).Then([source, staging, i](Mesh& model){
+            SceneObject& object = staging->objects[i];
+            object.bounds = model.bounds;
+            object.sphere = MakeBoundingSphere(model.bounds);
+            object.lods = LodRanges();
+            for(const MeshLod& lod : model.lods){
+                DrawRange& range = object.lods.ranges[object.lods.count];
+                range.indexCount = (GLsizei)lod.indexCount;
+                range.firstIndex = (GLsizei)(staging->indices.size() + lod.firstIndex);
+                range.baseVertex = (GLint)(staging->vertices.size() / FLOATS_PER_VERTEX);
+                object.lods.errors[object.lods.count] = lod.error;
+                ++object.lods.count;
+            }
+            object.range = object.lods.ranges[0];
+            object.profile.clear();
+            const MeshLod& full = model.lods[0];
+            for(uint32_t index = 0; index < full.indexCount; ++index){
+                const float* position = &model.positions[model.indices[full.firstIndex + index] * 3];
+                object.profile.push_back(position[0]);
+                object.profile.push_back(position[1]);
+            }
+            size_t firstVertex = staging->vertices.size() / FLOATS_PER_VERTEX;
+            size_t vertexCount = model.vertices.size() / FLOATS_PER_VERTEX;
+            staging->skin.resize(firstVertex + vertexCount, SkinVertex());
+            if(source.skeleton != nullptr && !source.skeleton->IsEmpty()){
+                source.skeleton->BindVertices(model.vertices.data(), vertexCount, &staging->skin[firstVertex]);
+            }
+            staging->vertices.insert(staging->vertices.end(), model.vertices.begin(), model.vertices.end());
+            staging->indices.insert(staging->indices.end(), model.indices.begin(), model.indices.end());
+            // A reload keeps the layers it has, see ReloadSceneTexture()
+            if(source.layer != nullptr && gSceneTextures.GetLayer(model.texture) < 0){
+                *source.layer = gSceneTextures.AddImage(model.texture);
+                QueueLayerTexture(model.texture, *source.layer, source.layerReady);
+            }
+            // Only copied here, the GPU sees it with the arena
+        });
     }
-
-
-    // Update the View Matrix
-    GLint u_ViewMatrixLocation = glGetUniformLocation(gGraphicsPipelineShaderProgram,"u_ViewMatrix");
-    if(u_ViewMatrixLocation>=0){
-        glm::mat4 viewMatrix = gCamera.GetViewMatrix();
-        glUniformMatrix4fv(u_ViewMatrixLocation,1,GL_FALSE,&viewMatrix[0][0]);
-    }else{
-        std::cout << "Could not find u_ModelMatrix, maybe a mispelling?\n";
-        exit(EXIT_FAILURE);
+    std::vector<SceneObject*> targets;
+    for(size_t i = 0; i < sourceCount; ++i){
+        targets.push_back(sources[i].object);
     }
+    gAssets.Load("scene arena",
+        []{},
+        [staging, targets](size_t& budget){
+            // The cactus's impostor quad, sized by the sphere it came with
+            DrawRange impostor;
+            for(size_t i = 0; i < targets.size(); ++i){
+                if(targets[i] == &gCactus && gImpostorDayLayer >= 0){
+                    impostor = ImpostorBaker::AppendQuad(staging->objects[i].sphere, staging->vertices, staging->indices);
+                }
+            }
+            // Followed by the ground chunk slots, rewritten as the track streams by
+            gGround.Reserve(staging->vertices, staging->indices);
+            if(gSceneArena == INVALID_MESH){
+                gSceneArena = gMeshRegistry.Create(staging->vertices, staging->indices, GL_STATIC_DRAW);
+            }else{
+                gMeshRegistry.Update(gSceneArena, staging->vertices, staging->indices);
+            }
+            // The quad and the ground are never skinned
+            staging->skin.resize(staging->vertices.size() / FLOATS_PER_VERTEX, SkinVertex());
+            gSkinBuffer.Upload(staging->skin.data(), staging->skin.size());
+            for(size_t i = 0; i < targets.size(); ++i){
+                *targets[i] = staging->objects[i];
+            }
+            gCactusImpostor = impostor;
+            // Entities exist only once the scene is set up
+            if(gSceneEntitiesCreated){
+                UpdateSceneEntityShapes();
+                std::cout << "Reloaded the scene meshes\n";
+            }
+            size_t bytes = staging->vertices.size() * sizeof(GLfloat) + staging->indices.size() * sizeof(uint32_t);
+            budget -= std::min(budget, bytes);
+            return true;
+        });
+}
 
-
-    // Projection matrix (in perspective) 
-    glm::mat4 perspective = glm::perspective(glm::radians(45.0f),
-                                             (float)gScreenWidth/(float)gScreenHeight,
-                                             0.1f,
-                                             20.0f);
-
-    // Retrieve our location of our perspective matrix uniform 
-    GLint u_ProjectionLocation= glGetUniformLocation( gGraphicsPipelineShaderProgram,"u_Projection");
-    if(u_ProjectionLocation>=0){
-        glUniformMatrix4fv(u_ProjectionLocation,1,GL_FALSE,&perspective[0][0]);
+/**
+* Works out how large the scene textures can get on screen: the largest
+* footprint of a textured model times the size of what the scene is drawn
+* into, the drawable in pixels (larger than the window on high-DPI
+* displays) or the observation framebuffer.
+*
+* @return void
+*/
+void SetTextureFootprint(){
+    int width = 0;
+    int height = 0;
+    if(gObserving){
+        width = gObserveWidth;
+        height = gObserveHeight;
     }else{
-        std::cout << "Could not find u_Perspective, maybe a mispelling?\n";
-        exit(EXIT_FAILURE);
+        SDL_GL_GetDrawableSize(gGraphicsApplicationWindow, &width, &height);
     }
-
-    // Bind our texture to slot number 0
-		gTexture.Bind(0);
-
-		// Setup our uniform for our texture
-		GLint u_textureLocation = glGetUniformLocation(gGraphicsPipelineShaderProgram,"u_DiffuseTexture");
-		//std::cout << u_textureLocation << std::endl;
-		if(u_textureLocation>=0){
-			// Setup the slot for the texture
-			glUniform1i(u_textureLocation,0);
-		}else{
-			std::cout << "Could not find u_DiffuseTexture, maybe a misspelling?" << std::endl;
-     	exit(EXIT_FAILURE);
-		}
+    float footprint = 0.0f;
+    for(size_t i = 0; i < SCENE_MODEL_COUNT; ++i){
+        footprint = std::max(footprint, SCENE_MODELS[i].textureFootprint);
+    }
+    // The tier may leave out levels that would still be sampled
+    gTextureFootprintWidth = std::max(1, (int)std::ceil(width * footprint) >> gTextureLevelBias);
+    gTextureFootprintHeight = std::max(1, (int)std::ceil(height * footprint) >> gTextureLevelBias);
 }
 
+// Reads the dino's rig before the models that are bound to it. Without
+// it, or without a clip called run, the dino swaps its run frames.
+void LoadDinoRig(){
+    gDinoRunClip = -1;
+    if(!gDinoSkeleton.Load(DINO_RIG_PATH)){
+        return;
+    }
+    gDinoRunClip = gDinoSkeleton.FindClip("run");
+    if(gDinoRunClip < 0){
+        std::cout << DINO_RIG_PATH << " has no run clip, the dino swaps its run frames\n";
+        gDinoSkeleton.Clear();
+        return;
+    }
+    std::cout << "Skinning the dino to " << gDinoSkeleton.GetJointCount() << " joints\n";
+}
 
 /**
-* Draw
-* The render function gets called once per loop.
-* Typically this includes 'glDraw' related calls, and the relevant setup of buffers
-* for those calls.
+* Picks the quality tier of this machine and starts the scene from its
+* settings: read from the cache next to the shader programs, or probed
+* and cached at the first launch on this hardware. Benchmarks, stress
+* runs, replays and observations keep the defaults, so they measure and
+* see the same thing on every machine.
 *
 * @return void
 */
-void Draw(){
-    // Enable our attributes
-	glBindVertexArray(gVertexArrayObjectFloor);
-
-    //Render data
-    glDrawArrays(GL_TRIANGLES,0,gFloorTriangles);
-
-	// Stop using our current graphics pipeline
-	// Note: This is not necessary if we only have one graphics pipeline.
-    glUseProgram(0);
+void SelectPerformanceTier(){
+    if(!gTierEnabled || gBenchmark.IsRunning() || gStress.IsRunning() || gReplaying || gObserving ||
+       gObserveEnvCount > 0){
+        return;
+    }
+    PerformanceTierLevel level = TIER_HIGH;
+    if(!gTierName.empty()){
+        if(!PerformanceTier::ParseName(gTierName, level)){
+            std::cout << "Invalid tier " << gTierName << ", expected low, medium or high\n";
+            return;
+        }
+        gTier.SetLevel(level);
+        std::cout << "Quality tier " << gTierName << "\n";
+    }else if(!gTierProbe && !gShaderCachePath.empty() && gTier.Load(gShaderCachePath)){
+        std::cout << "Quality tier " << PerformanceTier::GetName(gTier.GetLevel()) << ", as probed before\n";
+    }else{
+        TraceLoad load(gTrace, "tier probe");
+        if(!gTier.Probe(gScreenWidth, gScreenHeight)){
+            return;
+        }
+        const HardwareMeasures& measures = gTier.GetMeasures();
+        std::cout << "Quality tier " << PerformanceTier::GetName(gTier.GetLevel()) << ": "
+                  << measures.simStepsPerSecond / 1e6 << " M simulation steps/s, "
+                  << measures.drawCallMicroseconds << " us per draw call, "
+                  << measures.fillGigapixelsPerSecond << " Gpixels/s\n";
+        if(!gShaderCachePath.empty()){
+            gTier.Save(gShaderCachePath);
+        }
+    }
+    const QualitySettings& settings = gTier.GetSettings();
+    if(!(gTierSetByArguments & TIER_SET_RESOLUTION) && settings.resolutionScale < 1.0f){
+        gDynamicResolution = true;
+        gMaxResolutionScale = settings.resolutionScale;
+        gMinResolutionScale = std::min(gMinResolutionScale, settings.resolutionScale);
+    }
+    if(!(gTierSetByArguments & TIER_SET_LOD)){
+        gLodPixelError = settings.lodPixelError;
+    }
+    gParticleBudget = settings.particleBudget;
+    gTextureLevelBias = settings.textureLevelBias;
 }
 
 /**
-* Helper Function to get OpenGL Version Information
+* Starts loading every model and texture of the scene as asset
+* parse jobs. Nothing is uploaded yet; see LoadingScreen().
 *
 * @return void
 */
-void getOpenGLVersionInfo(){
-  std::cout << "Vendor: " << glGetString(GL_VENDOR) << "\n";
-  std::cout << "Renderer: " << glGetString(GL_RENDERER) << "\n";
-  std::cout << "Version: " << glGetString(GL_VERSION) << "\n";
-  std::cout << "Shading language: " << glGetString(GL_SHADING_LANGUAGE_VERSION) << "\n";
+void QueueSceneAssets(){
+    if(gTrace.IsRecording()){
+        gAssets.SetTrace(&gTrace);
+    }
+    gTextureSuffixes = Texture::GetCompressedSuffixes();
+    SetTextureFootprint();
+    gAssets.Start();
+    gTextureCache.Initialize(gAssets, gResidency);
+    // Baked into, never loaded; reserved before any upload sizes the array
+    if(gImpostorDistance > 0.0f){
+        gImpostorDayLayer = gSceneTextures.AddLayer("impostor:cactus:day");
+        gImpostorNightLayer = gSceneTextures.AddLayer("impostor:cactus:night");
+    }
+    LoadDinoRig();
+    gPalette.Load(PALETTE_PATH);
+    QueueSceneArena(SCENE_MODELS, SCENE_MODEL_COUNT);
+    // Queued after the models, so their layers are in the array before
+    // the first texture upload sizes it
+    for(const ParallaxLayer& layer : PARALLAX_LAYERS){
+        for(const ParallaxTexture* texture : {&layer.day, &layer.night}){
+            if(texture->path != nullptr){
+                *texture->layer = gSceneTextures.AddImage(texture->path);
+                QueueLayerTexture(texture->path, *texture->layer, texture->ready);
+            }
+        }
+    }
 }
 
+// Uploads a scene texture layer again from whichever variant is best now
+void ReloadSceneTexture(int layer, bool* ready){
+    const std::string& filepath = gSceneTextures.GetFilepath(layer);
+    std::cout << "Reloading " << filepath << "\n";
+    QueueLayerTexture(filepath, layer, ready);
+}
 
 /**
-* Function called in the Main application loop to handle user input
+* Watches the files the scene was built from (--hot-reload) and rebuilds
+* only what a change affects: the program whose shader changed, the scene
+* arena when a mesh changed, or the one texture layer whose image changed.
+* Meshes share one arena, so any mesh edit rebuilds all of them.
+* Everything rebuilt goes through the asset loader like the first load.
 *
 * @return void
 */
-void Input(){
-    // Two static variables to hold the mouse position
-    static int mouseX=gScreenWidth/2;
-    static int mouseY=gScreenHeight/2; 
-
-	// Event handler that handles various events in SDL
-	// that are related to input and output
-	SDL_Event e;
-	//Handle events on queue
-	while(SDL_PollEvent( &e ) != 0){
-		// If users posts an event to quit
-		// An example is hitting the "x" in the corner of the window.
-		if(e.type == SDL_QUIT){
-			std::cout << "Goodbye! (Leaving MainApplicationLoop())" << std::endl;
-			gQuit = true;
-		}
-        if(e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_ESCAPE){
-			std::cout << "ESC: Goodbye! (Leaving MainApplicationLoop())" << std::endl;
-            gQuit = true;
+void WatchSceneAssets(){
+    if(!gWatcher.Start()){
+        return;
+    }
+    // The shaders and what they include; an include added later is
+    // watched from the next launch on
+    for(const std::string& file : gSceneVariants.GetSourceFiles()){
+        gWatcher.Watch(file, ReloadGraphicsPipeline);
+    }
+    FileChanged reloadHUD = []{
+        if(gHUD.ReloadShaders("./shaders/hud_vert.glsl", "./shaders/hud_frag.glsl")){
+            std::cout << "Reloaded the overlay shaders\n";
         }
-        if(e.type==SDL_MOUSEMOTION && gDebug){
-            // Capture the change in the mouse position
-            mouseX+=e.motion.xrel;
-            mouseY+=e.motion.yrel;
-            gCamera.MouseLook(mouseX,mouseY);
+    };
+    gWatcher.Watch("./shaders/hud_vert.glsl", reloadHUD);
+    gWatcher.Watch("./shaders/hud_frag.glsl", reloadHUD);
+    FileChanged reloadParticles = []{
+        if(gParticles.ReloadShaders("./shaders/particle_update.glsl", "./shaders/particle_vert.glsl", "./shaders/particle_frag.glsl")){
+            std::cout << "Reloaded the particle shaders\n";
         }
-	}
-
-    // Retrieve keyboard state
-    const Uint8 *state = SDL_GetKeyboardState(NULL);
-
-    // Camera
+    };
+    gWatcher.Watch("./shaders/particle_update.glsl", reloadParticles);
+    gWatcher.Watch("./shaders/particle_vert.glsl", reloadParticles);
+    gWatcher.Watch("./shaders/particle_frag.glsl", reloadParticles);
+    if(gInstanceCuller.IsReady()){
+        FileChanged reloadCulling = []{
+            if(gInstanceCuller.ReloadShaders(CULL_SHADERS)){
+                std::cout << "Reloaded the culling shaders\n";
+            }
+        };
+        for(const std::string& path : {CULL_SHADERS.cullVertex, CULL_SHADERS.cullGeometry,
+                                       CULL_SHADERS.cullFragment, CULL_SHADERS.commands}){
+            gWatcher.Watch(path, reloadCulling);
+        }
+    }
+    FileChanged reloadSky = []{
+        if(gSky.ReloadShaders("./shaders/sky_vert.glsl", "./shaders/sky_frag.glsl")){
+            std::cout << "Reloaded the sky shaders\n";
+        }
+    };
+    gWatcher.Watch("./shaders/sky_vert.glsl", reloadSky);
+    gWatcher.Watch("./shaders/sky_frag.glsl", reloadSky);
+
+    FileChanged reloadMeshes = []{
+        QueueSceneArena(SCENE_MODELS, SCENE_MODEL_COUNT);
+    };
+    std::vector<std::pair<int, bool*>> textures;
+    for(const SceneModelSource& source : SCENE_MODELS){
+        gWatcher.Watch(source.objPath, reloadMeshes);
+        gWatcher.Watch(MeshFile::DMeshPathFor(source.objPath), reloadMeshes);
+        if(source.layer != nullptr){
+            textures.push_back(std::make_pair(*source.layer, source.layerReady));
+        }
+    }
+    for(const ParallaxLayer& layer : PARALLAX_LAYERS){
+        for(const ParallaxTexture* texture : {&layer.day, &layer.night}){
+            if(texture->path != nullptr){
+                textures.push_back(std::make_pair(*texture->layer, texture->ready));
+            }
+        }
+    }
+    for(const std::pair<int, bool*>& texture : textures){
+        int layer = texture.first;
+        bool* ready = texture.second;
+        FileChanged reloadTexture = [layer, ready]{
+            ReloadSceneTexture(layer, ready);
+        };
+        const std::string& texturePath = gSceneTextures.GetFilepath(layer);
+        gWatcher.Watch(texturePath, reloadTexture);
+        for(const std::string& suffix : gTextureSuffixes){
+            gWatcher.Watch(KTXFile::VariantPathFor(texturePath, suffix), reloadTexture);
+        }
+    }
+    std::cout << "Watching the shaders, meshes and textures for changes\n";
+}
+
+/**
+* Shows a progress bar while the assets the game needs to start upload:
+* the scene arena and the day texture. The scene shaders compile
+* meanwhile, and are linked once the driver says they are done.
+* Everything else keeps streaming in during the game. Returns false if
+* the window was closed meanwhile.
+*
+* @return true once the scene can be drawn
+*/
+bool LoadingScreen(){
+    while(gSceneArena == INVALID_MESH || !gDayLayerReady || !gSceneVariants.IsBuildComplete()){
+        SDL_Event e;
+        while(SDL_PollEvent(&e) != 0){
+            if(e.type == SDL_QUIT){
+                return false;
+            }
+        }
+        JobSystem::Get().RunMainThreadJobs();
+        gAssets.Update(LOADING_UPLOAD_BUDGET);
+
+        GLStateCache::Get().Viewport(0, 0, gScreenWidth, gScreenHeight);
+        glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        float progress = (float)gAssets.GetLoadedCount() / (float)std::max<size_t>(1, gAssets.GetQueuedCount());
+        float width = gScreenWidth * 0.5f;
+        float x = (gScreenWidth - width) * 0.5f;
+        float y = gScreenHeight * 0.5f;
+        gHUD.Begin();
+        gHUD.Text(x, y - HUD_LINE_HEIGHT * 1.5f, "LOADING", HUD_WHITE);
+        gHUD.Box(x, y, width, HUD_LINE_HEIGHT, HUD_PANEL);
+        gHUD.Box(x, y, width * progress, HUD_LINE_HEIGHT, HUD_GREEN);
+        gHUD.Draw(gScreenWidth, gScreenHeight);
+        PresentFrame();
+    }
+    FinishGraphicsPipeline();
+    return true;
+}
+
+// Creates the archetypes and the entities that live for the whole run.
+// Obstacle rows follow the game's obstacle lane, see SyncSceneEntities().
+void CreateSceneEntities(){
+    gBackgroundArchetype = gEntities.CreateArchetype(COMPONENT_TRANSFORM | COMPONENT_RENDERABLE | COMPONENT_SCROLL,
+                                                     PARALLAX_LAYER_COUNT);
+    gGroundArchetype = gEntities.CreateArchetype(COMPONENT_TRANSFORM | COMPONENT_RENDERABLE, GROUND_CHUNK_SLOTS);
+    gDinoArchetype = gEntities.CreateArchetype(COMPONENT_TRANSFORM | COMPONENT_RENDERABLE | COMPONENT_COLLIDER | COMPONENT_LOD |
+                                               COMPONENT_NODE, 1);
+    gObstacleArchetype = gEntities.CreateArchetype(COMPONENT_TRANSFORM | COMPONENT_RENDERABLE | COMPONENT_COLLIDER | COMPONENT_LOD,
+                                                   MAX_OBSTACLES);
+    gImpostorArchetype = gEntities.CreateArchetype(COMPONENT_TRANSFORM | COMPONENT_RENDERABLE, MAX_OBSTACLES);
+
+    for(const ParallaxLayer& layer : PARALLAX_LAYERS){
+        size_t row = gEntities.Add(gBackgroundArchetype);
+        gEntities.GetTransforms(gBackgroundArchetype)[row].z = layer.z;
+        TextureScroll& scroll = gEntities.GetScrolls(gBackgroundArchetype)[row];
+        scroll.uPerTick = layer.uPerTick;
+        scroll.periodTicks = layer.periodTicks;
+    }
+    gSkyArchetype = gEntities.CreateArchetype(COMPONENT_RENDERABLE | COMPONENT_SCROLL, 1);
+    gEntities.Add(gSkyArchetype);
+    TextureScroll& skyScroll = gEntities.GetScrolls(gSkyArchetype)[0];
+    skyScroll.uPerTick = SKY_LAYER.uPerTick;
+    skyScroll.periodTicks = SKY_LAYER.periodTicks;
+    gEntities.Resize(gGroundArchetype, GROUND_CHUNK_SLOTS);
+    gEntities.Add(gDinoArchetype);
+    gTrackNode = gSceneHierarchy.Add(NO_TRANSFORM_NODE);
+    gDinoNode = gSceneHierarchy.Add(gTrackNode);
+    gEntities.GetNodes(gDinoArchetype)[0] = gDinoNode;
+    // Stress entities are made like the obstacles, rows fill in as the run grows
+    size_t stressEntities = gStress.GetMaxEntities();
+    const uint32_t stressComponents = COMPONENT_TRANSFORM | COMPONENT_RENDERABLE | COMPONENT_COLLIDER | COMPONENT_LOD;
+    gStressCactusArchetype = gEntities.CreateArchetype(stressComponents, StressTest::GetCactusCount(stressEntities));
+    gStressDinoArchetype = gEntities.CreateArchetype(stressComponents, StressTest::GetGhostDinoCount(stressEntities));
+    gGhostArchetype = gEntities.CreateArchetype(COMPONENT_TRANSFORM | COMPONENT_RENDERABLE | COMPONENT_LOD, GetGhostSlots());
+    gSceneEntitiesCreated = true;
+    UpdateSceneEntityShapes();
+}
+
+// Copies the arena ranges, bounds and colliders of the scene objects into
+// the entities that keep them. Run again whenever the arena is rebuilt.
+void UpdateSceneEntityShapes(){
+    // Every dune layer shares the day quad, so they share a draw; the
+    // night model only brings its texture. The sky spans the same box.
+    Renderable* renderables = gEntities.GetRenderables(gBackgroundArchetype);
+    for(size_t i = 0; i < PARALLAX_LAYER_COUNT; ++i){
+        renderables[i].range = gDayBackground.range;
+        renderables[i].sphere = gDayBackground.sphere;
+    }
+    gSky.SetBounds(gDayBackground.bounds);
+
+    Renderable* chunks = gEntities.GetRenderables(gGroundArchetype);
+    for(size_t slot = 0; slot < GROUND_CHUNK_SLOTS; ++slot){
+        chunks[slot].range = gGround.GetSlotRange(slot);
+        chunks[slot].sphere = gGround.GetChunkSphere();
+    }
+
+    // The dino's hit box covers every run-cycle frame
+    Collider& dinoCollider = gEntities.GetColliders(gDinoArchetype)[0];
+    dinoCollider.bounds = AABB();
+    for(int frame = 0; frame < DINO_FRAME_COUNT; ++frame){
+        dinoCollider.bounds.Extend(gDinoFrames[frame].bounds);
+    }
+    // Narrowed to what the meshes cover within the boxes, where they fit
+    CollisionBox dinoBox = MakeCollisionBox(dinoCollider.bounds);
+    CollisionBox cactusBox = MakeCollisionBox(gCactus.bounds);
+    if(FitsSilhouette(dinoBox) && FitsSilhouette(cactusBox)){
+        CollisionSilhouette dinoSilhouette = MakeCollisionSilhouette(dinoBox);
+        for(int frame = 0; frame < DINO_FRAME_COUNT; ++frame){
+            AddSilhouetteTriangles(dinoSilhouette, gDinoFrames[frame].profile.data(), gDinoFrames[frame].profile.size() / 6);
+        }
+        CollisionSilhouette cactusSilhouette = MakeCollisionSilhouette(cactusBox);
+        AddSilhouetteTriangles(cactusSilhouette, gCactus.profile.data(), gCactus.profile.size() / 6);
+        SetCollisionRules(dinoSilhouette, cactusSilhouette);
+    }else{
+        SetCollisionRules(dinoBox, cactusBox);
+    }
+    // The cactus may look different now
+    gImpostorsStale = true;
+    // Dust settles where the dino stands
+    gParticles.SetGroundHeight(dinoCollider.bounds.min[1]);
+}
+
+/**
+* Setup your geometry during the vertex specification step.
+* Every mesh is packed once into the scene arena and never rebuilt;
+* objects move through their per-instance data.
+*
+* @return void
+*/
+void VertexSpecification(){
+    CreateSceneEntities();
+    // A stress run adds an instance per entity and a command per level
+    // of detail of each of its two meshes
+    size_t stressEntities = gStress.GetMaxEntities();
+    size_t stressCommands = (stressEntities > 0) ? 2*MAX_MESH_LODS : 0;
+    // Ghosts add an instance each and a command per level of detail of
+    // each of the two run frames
+    size_t extraEntities = stressEntities + GetGhostSlots();
+    size_t ghostCommands = (GetGhostSlots() > 0) ? DINO_FRAME_COUNT*MAX_MESH_LODS : 0;
+    // Every view of a split screen queues the draws of its own
+    size_t maxInstances = (MAX_SCENE_INSTANCES + extraEntities)*gLocalPlayers;
+    size_t maxCommands = (MAX_SCENE_COMMANDS + stressCommands + ghostCommands)*gLocalPlayers;
+    gSceneBatch.Initialize(maxInstances, maxCommands);
+    if(stressEntities > 0 && gAllowGPUCulling){
+        gInstanceCuller.Initialize(gSceneBatch, maxInstances, maxCommands, CULL_SHADERS);
+    }
+    gFrameUniforms.Initialize();
+    gImpostorBatch.Initialize(1, 1);
+    // Culling results and instances of the stress entities and ghosts
+    // included, for every view
+    gFrameArena.Initialize((FRAME_ARENA_BYTES + extraEntities*(sizeof(InstanceData) + sizeof(uint32_t)))*gLocalPlayers);
+}
+
+
+// Size of what the scene is drawn into: the window, or the observation
+// framebuffer
+void GetRenderTargetSize(int& width, int& height){
+    width = gScreenWidth;
+    height = gScreenHeight;
+    if(gObserving){
+        width = gObserver.GetRenderWidth();
+        height = gObserver.GetRenderHeight();
+    }else if(gDynamicResolution){
+        width = gResolution.GetWidth();
+        height = gResolution.GetHeight();
+    }
+}
+
+// Splits the render target into one view per local player
+void LayOutSceneViews(){
+    int width = 0;
+    int height = 0;
+    GetRenderTargetSize(width, height);
+    ViewportRect rects[MAX_VIEWPORTS];
+    gSceneViewCount = LayOutViewports(width, height, (size_t)gLocalPlayers, rects);
+    for(size_t v = 0; v < gSceneViewCount; ++v){
+        gSceneViews[v].index = v;
+        gSceneViews[v].rect = rects[v];
+    }
+}
+
+// Sets the uniforms of the selected scene variant, which must be in use
+void SetSceneUniforms(){
+    // Objects are placed by their instance data, these only apply globally
+    glm::mat4 model = glm::mat4(1.0f);
+    glUniformMatrix4fv(gUniforms.modelMatrix,1,GL_FALSE,&model[0][0]);
+    glUniform2f(gUniforms.uvOffset, 0.0f, 0.0f);
+    glUniform1i(gUniforms.paletteIndex, 0);
+    glUniform1f(gUniforms.timeOfDay, gTimeOfDay);
+    glUniform1f(gUniforms.opacity, 1.0f);
+    glUniform1f(gUniforms.time, gDinoClock);
+    glUniform1f(gUniforms.jumpApex, (float)JUMP_APEX);
+    glUniform1f(gUniforms.squashPivot, gDinoFrames[0].bounds.min[1]);
+    gSkinBuffer.Bind();
+    glUniform1i(gUniforms.skinVertices, SKIN_VERTEX_UNIT);
+    gPalette.Bind();
+    glUniform1i(gUniforms.palette, PALETTE_TEXTURE_UNIT);
+
+    if(gSceneBindless){
+        // Sampled through the array's resident handle, bound to no unit.
+        // There is none until the array is allocated.
+        GLuint64 handle = gSceneTextures.GetBindlessHandle();
+        if(handle != 0){
+            glUniformHandleui64ARB(gUniforms.diffuseTexture, handle);
+        }
+        return;
+    }
+
+    // Bind every scene texture to slot number 0
+		gSceneTextures.Bind(0);
+
+		// Setup the slot for the texture
+		glUniform1i(gUniforms.diffuseTexture,0);
+}
+
+
+/**
+* PreDraw
+* Typically we will use this for setting some sort of 'state'
+* Note: some of the calls may take place at different stages (post-processing) of the
+* 		 pipeline.
+* @return void
+*/
+// True once the cactus can be baked into its impostor layers: its arena
+// quad and day texture are in, and the scene textures can be copied
+// into. Compressed arrays cannot, and keep every obstacle a mesh.
+bool CanBakeImpostors(){
+    if(gImpostorDayLayer < 0 || gImpostorsUnavailable || gCactusImpostor.indexCount == 0 ||
+       !gDayLayerReady || !gSceneTextures.IsAllocated() ||
+       gSceneVariants.Get(gSceneBindless | SCENE_CROSSFADE) == nullptr){
+        return false;
+    }
+    if(gSceneTextures.GetInternalFormat() != GL_RGBA8 || gSceneTextures.GetLevelCount() != 1){
+        std::cout << "Impostors need uncompressed scene textures, distant obstacles stay meshes\n";
+        gImpostorsUnavailable = true;
+        return false;
+    }
+    if(!gImpostorBaker.IsReady() &&
+       !gImpostorBaker.Initialize(gSceneTextures.GetWidth(), gSceneTextures.GetHeight())){
+        gImpostorsUnavailable = true;
+        return false;
+    }
+    return true;
+}
+
+/**
+* Bakes the cactus into its impostor layers, by day and by night, when
+* it looks different from the last bake: another palette column, the
+* night texture streamed in, a rebuilt arena or a reloaded texture. The
+* plain scene program draws it through the bake camera, looking the way
+* the game camera does, so the pictures match the meshes they replace.
+* Leaves the default framebuffer bound.
+*
+* @return void
+*/
+void BakeImpostors(){
+    if(!gImpostorsStale && gImpostorPalette == colorOffset){
+        return;
+    }
+    if(!CanBakeImpostors()){
+        return;
+    }
+    GLStateCache& state = GLStateCache::Get();
+    state.PolygonMode(GL_FILL);
+    SelectSceneVariant(gSceneBindless);
+    gShaderProgram->Use();
+    SetSceneUniforms();
+    // Each picture is of one layer, the shader picks the day one
+    glUniform1f(gUniforms.timeOfDay, 0.0f);
+
+    FrameUniformData frame = {};
+    glm::vec3 direction(gCamera.GetViewXDirection(), gCamera.GetViewYDirection(), gCamera.GetViewZDirection());
+    ImpostorBaker::GetBakeCamera(gCactus.sphere, direction, frame.view, frame.projection);
+    frame.inverseViewProjection = glm::inverse(frame.projection * frame.view);
+    frame.eye = glm::inverse(frame.view)[3];
+    gFrameUniforms.Update(frame);
+
+    // The cactus is coloured by the palette's day row, then its night row
+    const float sources[2] = {PALETTE_DAY_LAYER, PALETTE_NIGHT_LAYER};
+    const int targets[2] = {gImpostorDayLayer, gImpostorNightLayer};
+    for(int i = 0; i < 2; ++i){
+        InstanceData instance = {};
+        instance.scale = 1.0f;
+        instance.palette = (float)colorOffset;
+        instance.layer = sources[i];
+        instance.nightLayer = sources[i];
+        gImpostorBatch.Begin();
+        gImpostorBatch.Add(gCactus.range, &instance, 1);
+        gImpostorBaker.Begin();
+        if(gImpostorBatch.Upload(gMeshRegistry, gSceneArena)){
+            gImpostorBatch.DrawCommands(0, 1);
+        }
+        gImpostorBatch.Finish();
+        gImpostorBaker.End(gSceneTextures, targets[i]);
+    }
+    gFrameUniforms.Finish();
+    state.PolygonMode(gPolygonMode);
+
+    gImpostorsBaked = true;
+    gImpostorsStale = false;
+    gImpostorPalette = colorOffset;
+}
+
+void PreDraw(){
+    // State goes through the cache, so calls that change nothing
+    // never reach the driver.
+    GLStateCache& state = GLStateCache::Get();
+
+	// Enable depth test and disable face culling.
+    state.Enable(GL_DEPTH_TEST);                // NOTE: Need to enable DEPTH Test
+    state.Disable(GL_CULL_FACE);
+
+    // Before the frame's target is bound, the bake binds its own
+    BakeImpostors();
+
+    // Set the polygon fill mode
+    state.PolygonMode(gPolygonMode);
+
+    // Initialize clear color
+    // This is the background of the screen.
+    int targetWidth = 0;
+    int targetHeight = 0;
+    GetRenderTargetSize(targetWidth, targetHeight);
+    if(gObserving){
+        gObserver.Bind();
+    }else if(gDynamicResolution){
+        gResolution.Bind();
+    }
+    state.Viewport(0, 0, targetWidth, targetHeight);
+    state.ClearColor( 0.0f, 1.0f, 0.0f, 1.0f );
+
+    //Clear color buffer and Depth Buffer
+    gGPUProfiler.BeginPass(gClearPass);
+  	glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
+    gGPUProfiler.EndPass(gClearPass);
+
+    // Use our shader, the prebuilt variant for this frame's features
+    uint32_t variant = gSceneBindless;
+    if(gTimeOfDay > 0.0f && gTimeOfDay < 1.0f){
+        variant |= SCENE_DAY_NIGHT_BLEND;
+    }
+    if(gPolygonMode == GL_LINE){
+        variant |= SCENE_WIREFRAME;
+    }
+    SelectSceneVariant(variant);
+	gShaderProgram->Use();
+
+    // The camera and everything else every program reads this frame,
+    // written once for all of them, a block per view
+    LayOutSceneViews();
+    FrameUniformData frames[MAX_VIEWPORTS] = {};
+    for(size_t v = 0; v < gSceneViewCount; ++v){
+        const ViewportRect& rect = gSceneViews[v].rect;
+        gCamera.SetViewportSize(rect.width, rect.height);
+        FrameUniformData& frame = frames[v];
+        frame.view = gCamera.GetViewMatrix();
+        frame.projection = gCamera.GetProjectionMatrix();
+        frame.inverseViewProjection = glm::inverse(gCamera.GetViewProjectionMatrix());
+        frame.eye = glm::vec4(gCamera.GetEyeXPosition(), gCamera.GetEyeYPosition(), gCamera.GetEyeZPosition(), 1.0f);
+        frame.timeOfDay = gTimeOfDay;
+        frame.skyOffset = gEntities.GetRenderables(gSkyArchetype)[0].uOffset;
+        std::copy(gDinoPose, gDinoPose + MAX_SKIN_JOINTS * 3, frame.joints);
+    }
+    // The wall shows half of the sky texture's width, so it scrolls by
+    // twice the texture's u a tick in wall widths
+    gSky.StreamPanorama(gSkyClock * SKY_LAYER.uPerTick * 2.0);
+    gFrameUniforms.Update(frames, gSceneViewCount);
+    SetSceneUniforms();
+}
+
+
+// Simulation rate. The game was tuned for one tick per frame at 60 Hz.
+const double SIM_STEP_SECONDS = 1.0/60.0;
+// Longest frame the simulation catches up on, so a hitch cannot snowball
+const double MAX_FRAME_SECONDS = 0.25;
+// Longest the game over screen sleeps for events before it looks at the
+// watched files again, and while assets are still streaming in
+const int IDLE_WAIT_MS = 100;
+const int IDLE_STREAMING_WAIT_MS = 16;
+
+// The parts of the game state that moving objects are drawn from
+struct RenderState{
+    int tick = 0;
+    bool gameOver = false;
+    bool isDaytime = true;
+    int dayTick = 0;
+    // The game the state belongs to, which the ground is generated for
+    uint64_t game = 0;
+    double trackDistance = 0.0;
+    float dinoHeight = 0.0f;
+    // The dino's jump on the tick clock, which the dino is drawn from;
+    // dinoHeight is what the particles and collisions go by
+    JumpAnchor dinoJump;
+    // Screen position of each obstacle by lane slot. An obstacle keeps its
+    // slot while it is on the lane, which pairs it up across two states.
+    float obstacleX[OBSTACLE_LANE_CAPACITY] = {};
+    uint32_t obstacleHead = 0;
+    uint32_t obstacleCount = 0;
+    // Ghost runners by index, the versus opponent after them: jump on the
+    // ghosts' step clock, run frame, palette and whether it is drawn at all
+    uint32_t ghostCount = 0;
+    int ghostStep = 0;
+    JumpAnchor ghostJump[GHOST_SLOTS] = {};
+    uint8_t ghostFrame[GHOST_SLOTS] = {};
+    uint8_t ghostPalette[GHOST_SLOTS] = {};
+    uint8_t ghostRunning[GHOST_SLOTS] = {};
+    // The local players of a split screen, player 1 first: jump on the
+    // dino's clock, score and whether each is still running. The lane and
+    // the dino above are those of the leading one, see GetLeadingPlayer().
+    uint32_t playerCount = 1;
+    uint32_t leader = 0;
+    JumpAnchor playerJump[MAX_LOCAL_PLAYERS] = {};
+    int playerTick[MAX_LOCAL_PLAYERS] = {};
+    uint8_t playerRunning[MAX_LOCAL_PLAYERS] = {};
+};
+
+// State before and after the last simulation step. Frames between two
+// steps are drawn interpolated between them.
+RenderState gPreviousState;
+RenderState gCurrentState;
+
+// What the simulation thread publishes after every step
+struct SimulationSnapshot{
+    RenderState previous;
+    RenderState current;
+    // Performance counter the step was due at
+    Uint64 stepCounter = 0;
+    // Input sequence the step read
+    uint32_t inputSequence = 0;
+    // The game as the step left it, for running ahead of it
+    GameState game;
+};
+TripleBuffer<SimulationSnapshot> gSnapshots;
+// The game gCurrentState was captured from, while the simulation thread
+// runs; the frame loop never reads gGame then
+GameState gSnapshotGame;
+
+// Run-ahead, --run-ahead=<k>: every frame draws the game k steps past the
+// latest real step, stepped from a copy of it with the keys held now,
+// and throws the copy away. A press shows up k steps sooner; when the
+// keys change in the meantime, the real steps differ from what was drawn
+// and the next frame corrects it. Ghosts are drawn as the real steps had
+// them.
+int gRunAhead = 0;
+const int MAX_RUN_AHEAD = 8;
+// The game whose ground is streamed, none before the first frame
+uint64_t gGroundGame = UINT64_MAX;
+
+// What the particles were last emitted for: the game time and track
+// distance of the last frame, and the last step seen
+double gParticleTime = 0.0;
+double gParticleDistance = 0.0;
+int gParticleTick = 0;
+bool gParticleAirborne = false;
+// Sand particles per simulation step on the ground, dust per landing
+const unsigned int SAND_PER_STEP = 48;
+const unsigned int DUST_PER_LANDING = 1536;
+
+// Copies the render state out of the game state
+// Fills in everything of state that comes from the player's game
+void CapturePlayerState(RenderState& state, const GameState& game, double trackDistance,
+                        const JumpAnchor& dinoJump){
+    state.tick = game.tick;
+    state.gameOver = game.gameOver;
+    state.isDaytime = game.isDaytime;
+    state.dayTick = game.dayTick;
+    state.trackDistance = trackDistance;
+    state.dinoHeight = (float)game.dinoHeight;
+    state.dinoJump = dinoJump;
+    state.obstacleHead = game.obstacles.head;
+    state.obstacleCount = game.obstacles.count;
+    for(uint32_t i = 0; i < game.obstacles.count; ++i){
+        uint32_t slot = GetLaneSlot(game.obstacles, i);
+        state.obstacleX[slot] = (float)(game.obstacles.x[slot] - game.scroll);
+    }
+}
+
+// A local player's game and jump, player 0 being gGame and gDinoJump
+inline GameState& GetLocalPlayerGame(size_t player){
+    return (player == 0) ? gGame : gOtherPlayers[player - 1].game;
+}
+
+inline JumpAnchor& GetLocalPlayerJump(size_t player){
+    return (player == 0) ? gDinoJump : gOtherPlayers[player - 1].jump;
+}
+
+// The local player furthest into the game, the first of those tied: one
+// still running while anyone is, since running players share every tick
+size_t GetLeadingPlayer(){
+    size_t leader = 0;
+    for(size_t player = 1; player < gLocalPlayers; ++player){
+        if(GetLocalPlayerGame(player).tick > GetLocalPlayerGame(leader).tick){
+            leader = player;
+        }
+    }
+    return leader;
+}
+
+RenderState CaptureRenderState(){
+    RenderState state;
+    state.game = gGamesPlayed;
+    size_t leader = GetLeadingPlayer();
+    CapturePlayerState(state, GetLocalPlayerGame(leader), (double)gTrackDistance, GetLocalPlayerJump(leader));
+    state.playerCount = (uint32_t)gLocalPlayers;
+    state.leader = (uint32_t)leader;
+    for(size_t player = 0; player < gLocalPlayers; ++player){
+        const GameState& game = GetLocalPlayerGame(player);
+        state.playerJump[player] = GetLocalPlayerJump(player);
+        state.playerTick[player] = game.tick;
+        state.playerRunning[player] = game.gameOver ? 0 : 1;
+    }
+    state.ghostCount = (uint32_t)gGhosts.GetCount();
+    state.ghostStep = (int)gGhosts.GetStep();
+    const int* ghostTicks = gGhosts.GetTicks();
+    for(uint32_t i = 0; i < state.ghostCount; ++i){
+        state.ghostJump[i] = gGhosts.GetJumpAnchors()[i];
+        state.ghostFrame[i] = (ghostTicks[i] % 30 < 15) ? 1 : 0;
+        state.ghostPalette[i] = gGhosts.GetPalettes()[i];
+        state.ghostRunning[i] = gGhosts.GetRunning()[i];
+    }
+    if(gVersus.IsConnected()){
+        // The opponent's jump moves from the session's clock to the ghosts'
+        const GameState& opponent = gVersus.GetRemoteGame();
+        uint32_t i = state.ghostCount++;
+        state.ghostJump[i] = gVersus.GetRemoteJump();
+        state.ghostJump[i].start += (float)(state.ghostStep - (int)gVersus.GetFrame());
+        state.ghostFrame[i] = (opponent.tick % 30 < 15) ? 1 : 0;
+        state.ghostPalette[i] = gVersus.GetRemotePalette();
+        state.ghostRunning[i] = opponent.gameOver ? 0 : 1;
+    }
+    return state;
+}
+
+// Drops the interpolation history, used when the game state jumps
+void SnapRenderState(){
+    // The game may be somewhere else entirely, mid-air even
+    for(size_t player = 0; player < gLocalPlayers; ++player){
+        const GameState& game = GetLocalPlayerGame(player);
+        JumpAnchor& jump = GetLocalPlayerJump(player);
+        jump = JumpAnchor();
+        UpdateJumpAnchor(jump, game.tick, game.dinoHeight, game.jumpingUp, game.jumpingSpeed);
+    }
+    gCurrentState = CaptureRenderState();
+    gPreviousState = gCurrentState;
+}
+
+/**
+* Replaces gPreviousState and gCurrentState with the states gRunAhead
+* steps past the latest real step, stepped from a copy of its game with
+* the jump key as it is now. The caller draws them and puts the real
+* states back. Nothing is run ahead past the end of a game.
+*
+* @param latest The game of gCurrentState
+* @return void
+*/
+void RunAhead(const GameState& latest){
+    // A queued press will be taken by the next real step
+    bool jump = (gHeldInput.load(std::memory_order_acquire) & INPUT_JUMP) != 0 || !gJumpPresses.IsEmpty();
+    GameState game = latest;
+    double trackDistance = gCurrentState.trackDistance;
+    JumpAnchor dinoJump = gCurrentState.dinoJump;
+    for(int step = 0; step < gRunAhead && !game.gameOver; ++step){
+        int distance = GetStepDistance(game);
+        Step(game, jump ? ACTION_JUMP : ACTION_NONE);
+        trackDistance += distance;
+        UpdateJumpAnchor(dinoJump, game.tick, game.dinoHeight, game.jumpingUp, game.jumpingSpeed);
+        gPreviousState = gCurrentState;
+        CapturePlayerState(gCurrentState, game, trackDistance, dinoJump);
+    }
+}
+
+// The render state a fraction alpha of a step after gPreviousState
+RenderState InterpolateRenderState(float alpha){
+    RenderState state = gCurrentState;
+    state.trackDistance = gPreviousState.trackDistance + (gCurrentState.trackDistance - gPreviousState.trackDistance)*alpha;
+    state.dinoHeight = gPreviousState.dinoHeight + (gCurrentState.dinoHeight - gPreviousState.dinoHeight)*alpha;
+    for(uint32_t i = 0; i < state.obstacleCount; ++i){
+        uint32_t slot = (state.obstacleHead + i) & OBSTACLE_LANE_MASK;
+        // Obstacles spawned this step have nothing to come from, and a
+        // reused slot would sweep back across the screen
+        bool wasOnLane = ((slot - gPreviousState.obstacleHead) & OBSTACLE_LANE_MASK) < gPreviousState.obstacleCount;
+        if(wasOnLane && gCurrentState.obstacleX[slot] <= gPreviousState.obstacleX[slot]){
+            state.obstacleX[slot] = gPreviousState.obstacleX[slot]
+                                  + (gCurrentState.obstacleX[slot] - gPreviousState.obstacleX[slot])*alpha;
+        }
+    }
+    return state;
+}
+
+// How far into night a state is a fraction alpha of a step past the one
+// before it: 0 by day and 1 by night, except over the last
+// TIME_OF_DAY_FADE_TICKS of either, which fade into the other
+float GetTimeOfDay(const RenderState& state, float alpha){
+    float fade = ((float)(state.dayTick - (DAY_LENGTH - TIME_OF_DAY_FADE_TICKS)) + alpha - 1.0f)
+               / (float)TIME_OF_DAY_FADE_TICKS;
+    fade = std::min(std::max(fade, 0.0f), 1.0f);
+    return state.isDaytime ? fade : 1.0f - fade;
+}
+
+// Moves the stress entities of this frame into place: cacti with the
+// cactus mesh, ghost dinos in the dino's current run frame
+void SyncStressEntities(const SceneObject& dinoFrame, float layer, float nightLayer){
+    size_t count = gStress.GetEntityCount();
+    const ArchetypeId archetypes[2] = {gStressCactusArchetype, gStressDinoArchetype};
+    const size_t counts[2] = {StressTest::GetCactusCount(count), StressTest::GetGhostDinoCount(count)};
+    for(int kind = 0; kind < 2; ++kind){
+        bool ghostDino = (kind == 1);
+        const SceneObject& object = ghostDino ? dinoFrame : gCactus;
+        gEntities.Resize(archetypes[kind], counts[kind]);
+        Transform* transforms = gEntities.GetTransforms(archetypes[kind]);
+        Renderable* renderables = gEntities.GetRenderables(archetypes[kind]);
+        Collider* colliders = gEntities.GetColliders(archetypes[kind]);
+        LodRanges* lods = gEntities.GetLods(archetypes[kind]);
+        for(size_t i = 0; i < counts[kind]; ++i){
+            StressPlacement placement = gStress.Place(i, ghostDino);
+            transforms[i].x = placement.x;
+            transforms[i].y = placement.y;
+            transforms[i].z = placement.z;
+            renderables[i].range = object.range;
+            renderables[i].sphere = object.sphere;
+            renderables[i].palette = (float)colorOffset;
+            renderables[i].layer = layer;
+            renderables[i].nightLayer = nightLayer;
+            lods[i] = object.lods;
+            colliders[i].bounds = object.bounds;
+        }
+    }
+}
+
+// Collision system of the stress entities: counts those whose hit box
+// overlaps the dino's, in x and y like the game's own obstacles
+size_t CollideStressEntities(const RenderState& state){
+    const CollisionRules& rules = GetCollisionRules();
+    int dinoY = (int)state.dinoHeight;
+    const ArchetypeId archetypes[2] = {gStressCactusArchetype, gStressDinoArchetype};
+    const CollisionBox* boxes[2] = {&rules.obstacle, &rules.dino};
+    size_t hits = 0;
+    for(int kind = 0; kind < 2; ++kind){
+        size_t count = gEntities.GetCount(archetypes[kind]);
+        const Transform* transforms = gEntities.GetTransforms(archetypes[kind]);
+        int* x = gFrameArena.Allocate<int>(count);
+        int* y = gFrameArena.Allocate<int>(count);
+        for(size_t i = 0; i < count; ++i){
+            x[i] = (int)(transforms[i].x*GAME_UNITS_PER_WORLD_UNIT);
+            y[i] = (int)(transforms[i].y*GAME_UNITS_PER_WORLD_UNIT);
+        }
+        size_t first = 0;
+        while(first < count){
+            size_t hit = first + FindFirstOverlap(rules.dino, 0, dinoY, *boxes[kind], x + first, y + first, count - first);
+            if(hit == count){
+                break;
+            }
+            ++hits;
+            first = hit + 1;
+        }
+    }
+    return hits;
+}
+
+// Moves the ghost runners of this frame into place, written grouped by
+// run frame so each frame's ghosts make one run of rows and one draw.
+// Ghosts that stopped running keep their row but are not drawn.
+void SyncGhostEntities(const RenderState& state, float layer, float nightLayer, size_t view){
+    // The ghosts, then the other local players of the view still running,
+    // their jumps moved from the dino's clock onto the ghosts'
+    JumpAnchor jumps[GHOST_SLOTS];
+    uint8_t frames[GHOST_SLOTS];
+    uint8_t palettes[GHOST_SLOTS];
+    uint8_t running[GHOST_SLOTS];
+    uint32_t count = state.ghostCount;
+    std::copy(state.ghostJump, state.ghostJump + count, jumps);
+    std::copy(state.ghostFrame, state.ghostFrame + count, frames);
+    std::copy(state.ghostPalette, state.ghostPalette + count, palettes);
+    std::copy(state.ghostRunning, state.ghostRunning + count, running);
+    for(uint32_t player = 0; player < state.playerCount; ++player){
+        if(player == view || !state.playerRunning[player]){
+            continue;
+        }
+        jumps[count] = state.playerJump[player];
+        jumps[count].start += (float)(state.ghostStep - state.tick);
+        frames[count] = (state.tick % 30 < 15) ? 1 : 0;
+        palettes[count] = (uint8_t)((colorOffset + (int)player) % PALETTE_COUNT);
+        running[count] = 1;
+        ++count;
+    }
+    gEntities.Resize(gGhostArchetype, count);
+    Transform* transforms = gEntities.GetTransforms(gGhostArchetype);
+    Renderable* renderables = gEntities.GetRenderables(gGhostArchetype);
+    LodRanges* lods = gEntities.GetLods(gGhostArchetype);
+    const Transform& dino = gEntities.GetTransforms(gDinoArchetype)[0];
+    size_t row = 0;
+    for(int frame = 0; frame < DINO_FRAME_COUNT; ++frame){
+        // The skinned frame takes every pose
+        const SceneObject& object = gDinoFrames[(gDinoRunClip < 0) ? frame : 0];
+        for(uint32_t i = 0; i < count; ++i){
+            if(frames[i] != frame){
+                continue;
+            }
+            // Raised off the ground by the vertex shader
+            transforms[row].x = dino.x;
+            transforms[row].y = 0.0f;
+            transforms[row].z = dino.z + GHOST_Z_OFFSET;
+            renderables[row].range = object.range;
+            renderables[row].sphere = object.sphere;
+            renderables[row].palette = (float)palettes[i];
+            renderables[row].layer = layer;
+            renderables[row].nightLayer = nightLayer;
+            renderables[row].visible = running[i] != 0;
+            renderables[row].jumpStart = jumps[i].start;
+            renderables[row].jumpSpeed = (float)jumps[i].speed;
+            renderables[row].bobHeight = DINO_BOB_HEIGHT;
+            renderables[row].squash = DINO_SQUASH;
+            lods[row] = object.lods;
+            ++row;
+        }
+    }
+}
+
+// Puts a split screen view's player in the dino's row: its jump and
+// palette, hidden once it is out unless its game is the lane drawn.
+// With one view the row stays as SyncSceneEntities() left it.
+void SyncViewPlayer(const RenderState& state, size_t view){
+    if(state.playerCount < 2){
+        return;
+    }
+    Renderable& dino = gEntities.GetRenderables(gDinoArchetype)[0];
+    dino.palette = (float)((colorOffset + (int)view) % PALETTE_COUNT);
+    dino.jumpStart = state.playerJump[view].start;
+    dino.jumpSpeed = (float)state.playerJump[view].speed;
+    dino.visible = state.playerRunning[view] != 0 || view == state.leader;
+}
+
+// Copies what moved in the game into the entity components. Everything
+// is drawn with the palette and the day and night texture layers, which
+// the shader crossfades by gTimeOfDay.
+/**
+* Gives every obstacle past the start of the crossfade band an impostor
+* row, once the impostors are baked. Obstacles past its end are all
+* impostor, so their mesh rows are hidden; the collider rows stay.
+* Distances are measured from the eye to the obstacle's offset, as in
+* shaders/vert.glsl.
+*
+* @return void
+*/
+void SyncImpostorEntities(uint32_t obstacleCount){
+    gEntities.Resize(gImpostorArchetype, 0);
+    if(!gImpostorsBaked){
+        return;
+    }
+    float farDistance = gImpostorDistance;
+    float nearDistance = std::max(farDistance - IMPOSTOR_FADE_DISTANCE, 0.0f);
+    glm::vec3 eye(gCamera.GetEyeXPosition(), gCamera.GetEyeYPosition(), gCamera.GetEyeZPosition());
+    // The quad turns about the sphere's center, its corners reach
+    // sqrt(2) radii out
+    BoundingSphere sphere = gCactus.sphere;
+    sphere.radius *= 1.4143f;
+    const Transform* obstacles = gEntities.GetTransforms(gObstacleArchetype);
+    Renderable* meshes = gEntities.GetRenderables(gObstacleArchetype);
+    for(uint32_t i = 0; i < obstacleCount; ++i){
+        float distance = glm::distance(glm::vec3(obstacles[i].x, obstacles[i].y, obstacles[i].z), eye);
+        if(distance < nearDistance){
+            continue;
+        }
+        meshes[i].visible = (distance < farDistance);
+        size_t row = gEntities.Add(gImpostorArchetype);
+        gEntities.GetTransforms(gImpostorArchetype)[row] = obstacles[i];
+        Renderable& impostor = gEntities.GetRenderables(gImpostorArchetype)[row];
+        impostor.range = gCactusImpostor;
+        impostor.sphere = sphere;
+        impostor.layer = (float)gImpostorDayLayer;
+        impostor.nightLayer = (float)gImpostorNightLayer;
+    }
+}
+
+void SyncSceneEntities(const RenderState& state){
+    // Night is drawn in day colors until its texture has streamed in
+    float layer = (float)gDayLayer;
+    float nightLayer = (float)(gNightLayerReady ? gNightLayer : gDayLayer);
+
+    // A dune layer shows up once its day texture has streamed in, and
+    // fades to its night one once that has
+    Renderable* backgrounds = gEntities.GetRenderables(gBackgroundArchetype);
+    for(size_t i = 0; i < PARALLAX_LAYER_COUNT; ++i){
+        const ParallaxLayer& parallax = PARALLAX_LAYERS[i];
+        backgrounds[i].visible = *parallax.day.ready;
+        backgrounds[i].layer = (float)*parallax.day.layer;
+        backgrounds[i].nightLayer = (float)(*parallax.night.ready ? *parallax.night.layer : *parallax.day.layer);
+    }
+    Renderable& sky = gEntities.GetRenderables(gSkyArchetype)[0];
+    sky.layer = layer;
+    sky.nightLayer = nightLayer;
+
+    // Ground chunks around the dino, placed along the track. Each game's
+    // terrain follows from the seed, like its obstacles.
+    if(state.game != gGroundGame){
+        gGround.Reset(gSeed ^ (state.game << 32));
+        gGroundGame = state.game;
+    }
+    gGround.Stream((int64_t)state.trackDistance);
+    Transform* chunkTransforms = gEntities.GetTransforms(gGroundArchetype);
+    Renderable* chunks = gEntities.GetRenderables(gGroundArchetype);
+    for(size_t slot = 0; slot < GROUND_CHUNK_SLOTS; ++slot){
+        int64_t chunk = gGround.GetSlotChunk(slot);
+        chunks[slot].visible = (chunk != NO_GROUND_CHUNK);
+        chunks[slot].layer = layer;
+        chunks[slot].nightLayer = nightLayer;
+        chunkTransforms[slot].x = (float)(((double)chunk*GROUND_CHUNK_LENGTH - state.trackDistance)*0.01);
+    }
+
+    // Dino, alternating between the two run frames unless it is skinned
+    Renderable& dino = gEntities.GetRenderables(gDinoArchetype)[0];
+    const SceneObject& dinoFrame = gDinoFrames[(gDinoRunClip < 0 && state.tick % 30 < 15) ? 1 : 0];
+    dino.range = dinoFrame.range;
+    dino.sphere = dinoFrame.sphere;
+    gEntities.GetLods(gDinoArchetype)[0] = dinoFrame.lods;
+    dino.palette = (float)colorOffset;
+    dino.layer = PALETTE_DAY_LAYER;
+    dino.nightLayer = PALETTE_NIGHT_LAYER;
+    // The vertex shader draws the jump, the dino's row stays on the ground
+    dino.jumpStart = state.dinoJump.start;
+    dino.jumpSpeed = (float)state.dinoJump.speed;
+    dino.bobHeight = DINO_BOB_HEIGHT;
+    dino.squash = DINO_SQUASH;
+    // Only what moved since the last frame is placed again, which is
+    // nothing once the scene has settled
+    gSceneHierarchy.Update();
+    gEntities.ApplyHierarchy(gDinoArchetype, gSceneHierarchy);
+    if(gStress.IsRunning()){
+        SyncStressEntities(dinoFrame, PALETTE_DAY_LAYER, PALETTE_NIGHT_LAYER);
+    }
+    // The ghosts are synced by BuildDrawList(), as every view has its own
+
+    gEntities.Resize(gObstacleArchetype, state.obstacleCount);
+    Transform* transforms = gEntities.GetTransforms(gObstacleArchetype);
+    Renderable* renderables = gEntities.GetRenderables(gObstacleArchetype);
+    Collider* colliders = gEntities.GetColliders(gObstacleArchetype);
+    LodRanges* lods = gEntities.GetLods(gObstacleArchetype);
+    for(uint32_t i = 0; i < state.obstacleCount; ++i){
+        uint32_t slot = (state.obstacleHead + i) & OBSTACLE_LANE_MASK;
+        transforms[i].x = state.obstacleX[slot]*0.01f;
+        renderables[i].range = gCactus.range;
+        lods[i] = gCactus.lods;
+        renderables[i].sphere = gCactus.sphere;
+        renderables[i].palette = (float)colorOffset;
+        renderables[i].layer = PALETTE_DAY_LAYER;
+        renderables[i].nightLayer = PALETTE_NIGHT_LAYER;
+        renderables[i].visible = true;
+        colliders[i].bounds = gCactus.bounds;
+    }
+    SyncImpostorEntities(state.obstacleCount);
+}
+
+// Queues the particles the dino kicked up since the last frame and lets
+// them move on by the game time and track distance that passed. Only
+// the CPU side; the particles update when they are drawn.
+void EmitParticles(const RenderState& state, float alpha){
+    // Game time, so particles stop with the game and keep pace with replays
+    double time = (gPreviousState.tick + (gCurrentState.tick - gPreviousState.tick)*alpha)*SIM_STEP_SECONDS;
+    double seconds = std::min(std::max(time - gParticleTime, 0.0), MAX_FRAME_SECONDS);
+    double scroll = std::max(state.trackDistance - gParticleDistance, 0.0)*0.01;
+    gParticles.Advance((float)seconds, (float)scroll);
+    gParticleTime = time;
+    gParticleDistance = state.trackDistance;
+
+    int steps = gCurrentState.tick - gParticleTick;
+    if(steps == 0){
+        return;
+    }
+    // A new game starts with nothing to catch up on
+    if(steps < 0){
+        steps = 0;
+    }
+    gParticleTick = gCurrentState.tick;
+    bool grounded = gCurrentState.dinoHeight <= 0.0f;
+    const AABB& feet = gEntities.GetColliders(gDinoArchetype)[0].bounds;
+    float width = feet.max[0] - feet.min[0];
+    float centerX = (feet.min[0] + feet.max[0])*0.5f;
+    float centerZ = (feet.min[2] + feet.max[2])*0.5f;
+    if(grounded && gParticleAirborne){
+        ParticleBurst dust;
+        dust.origin = glm::vec3(centerX, feet.min[1], centerZ);
+        dust.radius = width*0.5f;
+        dust.velocity = glm::vec3(0.0f, 0.9f, 0.0f);
+        dust.spread = glm::vec3(1.6f, 0.5f, 1.6f);
+        dust.life = 0.9f;
+        dust.size = 0.045f;
+        dust.count = (unsigned int)(DUST_PER_LANDING*gParticleBudget);
+        gParticles.Emit(dust);
+    }
+    if(grounded && !gCurrentState.gameOver && steps > 0){
+        // Thrown back from behind the feet
+        ParticleBurst sand;
+        sand.origin = glm::vec3(feet.min[0] + width*0.3f, feet.min[1] + 0.02f, centerZ);
+        sand.radius = width*0.15f;
+        sand.velocity = glm::vec3(-1.5f, 1.2f, 0.0f);
+        sand.spread = glm::vec3(0.8f, 0.6f, 0.6f);
+        sand.life = 0.6f;
+        sand.size = 0.025f;
+        sand.count = (unsigned int)(SAND_PER_STEP*std::min(steps, 8)*gParticleBudget);
+        gParticles.Emit(sand);
+    }
+    gParticleAirborne = !grounded;
+}
+
+// The game's sounds, a WAV file under ./common/sounds each or, without
+// one, a sweep made up here
+struct GameSound{
+    const char* path;
+    int* id;
+    float fromHertz;
+    float toHertz;
+    float seconds;
+    float noise;
+};
+const GameSound GAME_SOUNDS[] = {
+    {"./common/sounds/jump.wav", &gJumpSound, 420.0f, 880.0f, 0.12f, 0.0f},
+    {"./common/sounds/land.wav", &gLandSound, 140.0f, 60.0f, 0.08f, 0.6f},
+    {"./common/sounds/hit.wav",  &gHitSound,  300.0f, 70.0f, 0.35f, 0.4f},
+};
+
+/**
+* Opens the audio device and decodes every sound into memory before the
+* callback starts; nothing is loaded while the game plays. Without a
+* device, or a window to play for, the game runs silent.
+*
+* @return void
+*/
+void InitializeAudio(){
+    if(!gAudioEnabled || gHeadless || gOffscreen || !gAudio.Open(gAudioBufferFrames)){
+        return;
+    }
+    for(const GameSound& sound : GAME_SOUNDS){
+        *sound.id = gAudio.LoadWav(sound.path);
+        if(*sound.id < 0){
+            *sound.id = gAudio.AddSound(AudioMixer::MakeSweep(gAudio.GetSampleRate(), sound.fromHertz, sound.toHertz,
+                                                              sound.seconds, sound.noise));
+        }
+    }
+    gAudio.Start();
+    std::cout << "Mixing audio at " << gAudio.GetSampleRate() << " Hz, " << gAudio.GetBufferFrames()
+              << " frames per buffer\n";
+}
+
+// Starts the --gpu-sim-check games over: every environment with rules
+// of its own, the same in cpu and gpu
+void ResetGPUSimulationCheck(GameStateBatch& cpu, GPUGameBatch& gpu, size_t count){
+    cpu.Resize(count);
+    for(size_t i = 0; i < count; ++i){
+        GameParameters rules;
+        rules.cactusSpeed += (int)(i % 3);
+        rules.jumpingSpeed += (int)(i % 2);
+        rules.jumpApex -= (int)(i % 5) * 8;
+        rules.dayLength -= (int)(i % 7) * 100;
+        rules.spawnGapMin -= (int)(i % 4) * 100;
+        cpu.SetParameters(i, rules);
+    }
+    cpu.ResetAll(gSeed);
+    gpu.Load(cpu);
+    gpu.SetAutoReset(true, gSeed);
+}
+
+// One --gpu-sim-check step of cpu, finished games starting over on the
+// streams GPUGameBatch::SetAutoReset() plays. Set() clears the events of
+// a game it resets, they are kept in events.
+void StepGPUSimulationCheck(GameStateBatch& cpu, const GameAction* actions, std::vector<uint64_t>& episodes,
+                            std::vector<int>& events){
+    cpu.StepRepeated(actions, 1);
+    const size_t count = cpu.GetCount();
+    for(size_t i = 0; i < count; ++i){
+        events[i] = cpu.GetEvents()[i];
+        if(events[i] & EVENT_GAME_OVER){
+            ++episodes[i];
+            GameState state;
+            ResetGameState(state, gSeed, i + episodes[i] * count, cpu.GetParameters(i));
+            cpu.Set(i, state);
+        }
+    }
+}
+
+// Replays the --gpu-sim-check run comparing every step, reading the GPU
+// back each time, and prints the first step and lane that differ
+void LocateGPUSimulationDivergence(GPUGameBatch& gpu){
+    const size_t count = gGPUSimulationCheckEnvs;
+    GameStateBatch cpu;
+    ResetGPUSimulationCheck(cpu, gpu, count);
+    std::vector<GameAction> actions(count);
+    std::vector<uint64_t> episodes(count, 0);
+    std::vector<int> cpuEvents(count);
+    std::vector<int> gpuEvents(count);
+    std::vector<float> gpuRewards(count);
+    std::vector<uint64_t> cpuHashes(count);
+    std::vector<uint64_t> gpuHashes(count);
+    GameStateBatch stepped;
+    GameRandom random;
+    SeedGameRandom(random, gSeed, count);
+    for(int step = 0; step < GPU_CHECK_STEPS; ++step){
+        for(size_t i = 0; i < count; ++i){
+            actions[i] = (NextGameRandom(random) % 16 == 0) ? ACTION_JUMP : ACTION_NONE;
+        }
+        StepGPUSimulationCheck(cpu, actions.data(), episodes, cpuEvents);
+        gpu.SetActions(actions.data());
+        gpu.StepRepeated(1);
+        gpu.Store(stepped);
+        gpu.ReadResults(gpuEvents.data(), gpuRewards.data());
+        cpu.HashAll(cpuHashes.data());
+        stepped.HashAll(gpuHashes.data());
+        for(size_t i = 0; i < count; ++i){
+            if(cpuHashes[i] == gpuHashes[i] && cpuEvents[i] == gpuEvents[i] &&
+               cpu.GetRewards()[i] == gpuRewards[i]){
+                continue;
+            }
+            std::string difference = DescribeGameStateDifference(cpu.Get(i), stepped.Get(i));
+            if(difference.empty()){
+                difference = "events " + std::to_string(cpuEvents[i]) + " vs " + std::to_string(gpuEvents[i]) +
+                             ", reward " + std::to_string(cpu.GetRewards()[i]) + " vs " +
+                             std::to_string(gpuRewards[i]);
+            }
+            std::cout << "GPU simulation check: first divergence at step " << step << ", lane " << i
+                      << " in episode " << episodes[i] << ", CPU vs GPU " << difference << "\n";
+            return;
+        }
+    }
+    std::cout << "GPU simulation check: the games agree when stepped one at a time\n";
+}
+
+// The --gpu-sim-check run: gGPUSimulationCheckEnvs environments, each
+// with rules of its own, play the same random jumps on the GPU and in a
+// GameStateBatch, finished games starting over as GPUGameBatch resets
+// them. Prints both step rates and returns whether every state and the
+// last step's results came out equal; if not, the run is replayed in
+// lockstep to find where they parted.
+bool RunGPUSimulationCheck(){
+    GPUGameBatch gpu;
+    if(!gpu.Initialize("./shaders/batch_step.glsl")){
+        return false;
+    }
+    const size_t count = gGPUSimulationCheckEnvs;
+    GameStateBatch cpu;
+    ResetGPUSimulationCheck(cpu, gpu, count);
+    std::vector<GameAction> actions(count, ACTION_NONE);
+    std::vector<uint64_t> episodes(count, 0);
+    std::vector<int> cpuEvents(count, EVENT_NONE);
+    GameRandom random;
+    SeedGameRandom(random, gSeed, count);
+
+    const double secondsPerCount = 1.0 / (double)SDL_GetPerformanceFrequency();
+    uint64_t cpuCounts = 0;
+    uint64_t gpuCounts = 0;
+    glFinish();
+    for(int step = 0; step < GPU_CHECK_STEPS; ++step){
+        for(size_t i = 0; i < count; ++i){
+            actions[i] = (NextGameRandom(random) % 16 == 0) ? ACTION_JUMP : ACTION_NONE;
+        }
+        uint64_t start = SDL_GetPerformanceCounter();
+        StepGPUSimulationCheck(cpu, actions.data(), episodes, cpuEvents);
+        uint64_t middle = SDL_GetPerformanceCounter();
+        gpu.SetActions(actions.data());
+        gpu.StepRepeated(1);
+        cpuCounts += middle - start;
+        gpuCounts += SDL_GetPerformanceCounter() - middle;
+    }
+    uint64_t start = SDL_GetPerformanceCounter();
+    glFinish();
+    gpuCounts += SDL_GetPerformanceCounter() - start;
+
+    GameStateBatch stepped;
+    gpu.Store(stepped);
+    std::vector<int> gpuEvents(count);
+    std::vector<float> gpuRewards(count);
+    gpu.ReadResults(gpuEvents.data(), gpuRewards.data());
+    std::vector<uint64_t> cpuHashes(count);
+    std::vector<uint64_t> gpuHashes(count);
+    cpu.HashAll(cpuHashes.data());
+    stepped.HashAll(gpuHashes.data());
+    size_t differ = 0;
+    for(size_t i = 0; i < count; ++i){
+        if(cpuHashes[i] != gpuHashes[i] || gpuEvents[i] != cpuEvents[i] || gpuRewards[i] != cpu.GetRewards()[i]){
+            ++differ;
+        }
+    }
+    double steps = (double)count * GPU_CHECK_STEPS;
+    std::cout << "GPU simulation check: " << count << " environments, " << GPU_CHECK_STEPS << " steps, "
+              << steps / (gpuCounts * secondsPerCount) / 1e6 << " M steps/s on the GPU, "
+              << steps / (cpuCounts * secondsPerCount) / 1e6 << " M steps/s on the CPU ("
+              << GameStateBatch::GetInstructionSet() << "), ";
+    if(differ == 0){
+        std::cout << "every game equal\n";
+    }else{
+        std::cout << differ << " games differ\n";
+        LocateGPUSimulationDivergence(gpu);
+    }
+    gpu.Release();
+    return differ == 0;
+}
+
+// Plays the sounds of what the latest step changed: a take-off, a
+// landing or a collision. Runs once a frame on the main thread, the
+// mixer's one producer; Play() only queues a command.
+void PlaySoundsForSteps(){
+    if(!gAudio.IsRunning()){
+        return;
+    }
+    const RenderState& state = gCurrentState;
+    // A new game starts on the ground, with nothing to make a sound of
+    if(state.tick < gSoundTick){
+        gSoundAirborne = false;
+        gSoundGameOver = false;
+    }
+    gSoundTick = state.tick;
+    bool airborne = state.dinoHeight > 0.0f;
+    if(airborne && !gSoundAirborne){
+        gAudio.Play(gJumpSound);
+    }else if(!airborne && gSoundAirborne){
+        gAudio.Play(gLandSound, 0.8f);
+    }
+    if(state.gameOver && !gSoundGameOver){
+        gAudio.Play(gHitSound);
+    }
+    gSoundAirborne = airborne;
+    gSoundGameOver = state.gameOver;
+}
+
+/**
+* BuildDrawList
+* Records this frame's draws (ranges and instance data) from the game
+* state, interpolated a fraction alpha of a step past the previous
+* simulation step. No GL calls are made here.
+*
+* @return void
+*/
+void BuildDrawList(float alpha){
+    RenderState state = InterpolateRenderState(alpha);
+    gTimeOfDay = GetTimeOfDay(state, alpha);
+    gDinoClock = (float)gPreviousState.tick + (float)(state.tick - gPreviousState.tick)*alpha;
+    gGhostClock = (float)gPreviousState.ghostStep + (float)(state.ghostStep - gPreviousState.ghostStep)*alpha;
+    gSkyClock = (double)gPreviousState.tick + (double)(state.tick - gPreviousState.tick)*alpha;
+    // Everything skinned shares the run cycle's pose on the dino's clock
+    if(gDinoRunClip >= 0){
+        gDinoSkeleton.Sample((size_t)gDinoRunClip, (float)(gDinoClock*SIM_STEP_SECONDS), gDinoPose);
+    }
+    SyncSceneEntities(state);
+    EmitParticles(state, alpha);
+    gEntities.UpdateTextureScroll(gPreviousState.tick, (float)(state.tick - gPreviousState.tick)*alpha);
+
+    // Every view culls and picks levels of detail from its own rectangle;
+    // the eye is the same for all of them
+    LayOutSceneViews();
+    Frustum frusta[MAX_VIEWPORTS];
+    float pixelsPerUnit[MAX_VIEWPORTS] = {};
+    for(size_t v = 0; v < gSceneViewCount; ++v){
+        // Obstacles far off either end of the lane are never written out
+        const ViewportRect& rect = gSceneViews[v].rect;
+        gCamera.SetViewportSize(rect.width, rect.height);
+        frusta[v] = ExtractFrustum(gCamera.GetViewProjectionMatrix());
+        // Characters far away draw a simpler level of detail
+        pixelsPerUnit[v] = (gLodPixelError > 0.0f) ? gCamera.GetProjectionMatrix()[1][1] * 0.5f * (float)rect.height : 0.0f;
+    }
+    glm::vec3 eye(gCamera.GetEyeXPosition(), gCamera.GetEyeYPosition(), gCamera.GetEyeZPosition());
+    if(gStress.IsRunning()){
+        gStressCollisions = CollideStressEntities(state);
+    }
+
+    // The batch sorts its draws by key when it uploads them: by pass and
+    // view, then by texture layer and mesh, opaque ones near to far.
+    // Passes are queued in their order and views in theirs within each,
+    // so the ranges below still bound them.
+    DrawSortKeys keys;
+    keys.eye = eye;
+    gSceneBatch.Begin();
+    for(size_t v = 0; v < gSceneViewCount; ++v){
+        SceneView& view = gSceneViews[v];
+        view.background.first = gSceneBatch.GetCommandCount();
+        keys.pass = SCENE_PASS_BACKGROUND*MAX_VIEWPORTS + (uint32_t)v;
+        gEntities.AppendDraws(gBackgroundArchetype, gSceneBatch, gFrameArena, &frusta[v], &keys);
+        gEntities.AppendDraws(gGroundArchetype, gSceneBatch, gFrameArena, &frusta[v], &keys);
+        view.background.count = gSceneBatch.GetCommandCount() - view.background.first;
+    }
+    // Obstacles are one command however many there are
+    for(size_t v = 0; v < gSceneViewCount; ++v){
+        SceneView& view = gSceneViews[v];
+        SyncViewPlayer(state, v);
+        gEntities.SelectLods(gDinoArchetype, eye, pixelsPerUnit[v], gLodPixelError);
+        gEntities.SelectLods(gStressCactusArchetype, eye, pixelsPerUnit[v], gLodPixelError);
+        gEntities.SelectLods(gStressDinoArchetype, eye, pixelsPerUnit[v], gLodPixelError);
+        view.characters.first = gSceneBatch.GetCommandCount();
+        keys.pass = SCENE_PASS_CHARACTERS*MAX_VIEWPORTS + (uint32_t)v;
+        gEntities.AppendDraws(gDinoArchetype, gSceneBatch, gFrameArena, &frusta[v], &keys);
+        view.characters.count = gSceneBatch.GetCommandCount() - view.characters.first;
+    }
+    // The stress entities go to the GPU unculled when it culls them
+    const bool gpuCulled = gInstanceCuller.IsReady();
+    for(size_t v = 0; v < gSceneViewCount; ++v){
+        SceneView& view = gSceneViews[v];
+        view.frustum = frusta[v];
+        const Frustum* frustum = gpuCulled ? nullptr : &frusta[v];
+        view.stressCacti.first = gSceneBatch.GetCommandCount();
+        keys.pass = SCENE_PASS_STRESS_CACTI*MAX_VIEWPORTS + (uint32_t)v;
+        gEntities.AppendDraws(gStressCactusArchetype, gSceneBatch, gFrameArena, frustum, &keys);
+        view.stressCacti.count = gSceneBatch.GetCommandCount() - view.stressCacti.first;
+    }
+    for(size_t v = 0; v < gSceneViewCount; ++v){
+        SceneView& view = gSceneViews[v];
+        const Frustum* frustum = gpuCulled ? nullptr : &frusta[v];
+        view.stressDinos.first = gSceneBatch.GetCommandCount();
+        keys.pass = SCENE_PASS_STRESS_DINOS*MAX_VIEWPORTS + (uint32_t)v;
+        gEntities.AppendDraws(gStressDinoArchetype, gSceneBatch, gFrameArena, frustum, &keys);
+        view.stressDinos.count = gSceneBatch.GetCommandCount() - view.stressDinos.first;
+    }
+    // Obstacles and their impostors crossfade, with a program of their own
+    for(size_t v = 0; v < gSceneViewCount; ++v){
+        SceneView& view = gSceneViews[v];
+        gEntities.SelectLods(gObstacleArchetype, eye, pixelsPerUnit[v], gLodPixelError);
+        view.obstacles.first = gSceneBatch.GetCommandCount();
+        keys.pass = SCENE_PASS_OBSTACLES*MAX_VIEWPORTS + (uint32_t)v;
+        gEntities.AppendDraws(gObstacleArchetype, gSceneBatch, gFrameArena, &frusta[v], &keys);
+        view.obstacles.count = gSceneBatch.GetCommandCount() - view.obstacles.first;
+    }
+    for(size_t v = 0; v < gSceneViewCount; ++v){
+        SceneView& view = gSceneViews[v];
+        view.impostors.first = gSceneBatch.GetCommandCount();
+        keys.pass = SCENE_PASS_IMPOSTORS*MAX_VIEWPORTS + (uint32_t)v;
+        gEntities.AppendDraws(gImpostorArchetype, gSceneBatch, gFrameArena, &frusta[v], &keys);
+        view.impostors.count = gSceneBatch.GetCommandCount() - view.impostors.first;
+    }
+    // Ghosts are blended, so they are drawn after everything opaque,
+    // far to near. Every view's ghosts are the other players besides.
+    keys.backToFront = true;
+    for(size_t v = 0; v < gSceneViewCount; ++v){
+        SceneView& view = gSceneViews[v];
+        SyncGhostEntities(state, PALETTE_DAY_LAYER, PALETTE_NIGHT_LAYER, v);
+        gEntities.SelectLods(gGhostArchetype, eye, pixelsPerUnit[v], gLodPixelError);
+        view.ghosts.first = gSceneBatch.GetCommandCount();
+        keys.pass = SCENE_PASS_GHOSTS*MAX_VIEWPORTS + (uint32_t)v;
+        gEntities.AppendDraws(gGhostArchetype, gSceneBatch, gFrameArena, &frusta[v], &keys);
+        view.ghosts.count = gSceneBatch.GetCommandCount() - view.ghosts.first;
+    }
+    RecordSceneCommands();
+}
+
+
+// Steps the atlas environments once with the player's jump held or not,
+// and starts the finished ones over on streams not used before
+void StepObservedEnvironments(){
+    if(gPaused.load(std::memory_order_relaxed)){
+        return;
+    }
+    size_t count = gObserveEnvs.GetCount();
+    gObserveActions.assign(count, gJumpHeld ? ACTION_JUMP : ACTION_NONE);
+    gObserveEnvs.Step(gObserveActions.data());
+    const int* gameOver = gObserveEnvs.GetGameOverMasks();
+    for(size_t i = 0; i < count; ++i){
+        if(gameOver[i] != 0){
+            gObserveEnvs.Reset(i, gSeed, gObserveNextStream++);
+        }
+    }
+}
+
+// Draws the obstacle and impostor passes of the scene batch. With the
+// impostors baked both go through the CROSSFADE variant of this frame's
+// one, meshes near and impostors far dithered into each other across
+// the band; before that, the meshes are drawn as they are. Run by the
+// scene commands for one SceneView, as it switches the variant globals.
+void DrawObstacles(void* data){
+    const SceneView& view = *(const SceneView*)data;
+    if(!gImpostorsBaked){
+        gSceneBatch.DrawCommands(view.obstacles.first, view.obstacles.count);
+        return;
+    }
+    uint32_t variant = gSceneVariant;
+    SelectSceneVariant(variant | SCENE_CROSSFADE);
+    gShaderProgram->Use();
+    SetSceneUniforms();
+    glUniform2f(gUniforms.crossfadeBand, std::max(gImpostorDistance - IMPOSTOR_FADE_DISTANCE, 0.0f), gImpostorDistance);
+    glUniform1f(gUniforms.impostor, 0.0f);
+    gSceneBatch.DrawCommands(view.obstacles.first, view.obstacles.count);
+    glUniform1f(gUniforms.impostor, 1.0f);
+    glUniform3fv(gUniforms.impostorPivot, 1, gCactus.sphere.center);
+    gSceneBatch.DrawCommands(view.impostors.first, view.impostors.count);
+    SelectSceneVariant(variant);
+    gShaderProgram->Use();
+}
+
+// Draws the stress entities of one SceneView, from what the GPU kept of
+// them when it culled them
+void DrawStressEntities(void* data){
+    const SceneView& view = *(const SceneView*)data;
+    for(const SceneCommandRange* range : {&view.stressCacti, &view.stressDinos}){
+        if(!gInstanceCuller.DrawCommands(gSceneBatch, range->first, range->count)){
+            gSceneBatch.DrawCommands(range->first, range->count);
+        }
+    }
+}
+
+// Culls the stress entities of every view on the GPU, each archetype
+// with the sphere all its rows share, before the passes draw them
+void CullStressEntities(){
+    gGPUProfiler.BeginPass(gCullPass);
+    gInstanceCuller.Begin(gSceneBatch);
+    const ArchetypeId archetypes[2] = {gStressCactusArchetype, gStressDinoArchetype};
+    for(size_t v = 0; v < gSceneViewCount; ++v){
+        const SceneView& view = gSceneViews[v];
+        const SceneCommandRange* ranges[2] = {&view.stressCacti, &view.stressDinos};
+        for(int kind = 0; kind < 2; ++kind){
+            if(ranges[kind]->count > 0){
+                const BoundingSphere& sphere = gEntities.GetRenderables(archetypes[kind])[0].sphere;
+                gInstanceCuller.Cull(gSceneBatch, ranges[kind]->first, ranges[kind]->count, sphere, view.frustum);
+            }
+        }
+    }
+    gInstanceCuller.End();
+    gGPUProfiler.EndPass(gCullPass);
+    // Back to the frame's program for the passes
+    if(gShaderProgram != nullptr){
+        gShaderProgram->Use();
+    }
+}
+
+// The sky last of the opaque scene, only where nothing covers it
+void DrawSky(void*){
+    const Renderable& sky = gEntities.GetRenderables(gSkyArchetype)[0];
+    SkyLayers skyLayers;
+    skyLayers.day = sky.layer;
+    skyLayers.night = sky.nightLayer;
+    gSky.Draw(skyLayers);
+}
+
+// Moves drawing to one SceneView: its rectangle, clipped to it when the
+// screen is split, and its block of the frame's uniforms
+void BeginSceneView(void* data){
+    const SceneView& view = *(const SceneView*)data;
+    GLStateCache& state = GLStateCache::Get();
+    state.Viewport(view.rect.x, view.rect.y, view.rect.width, view.rect.height);
+    if(gSceneViewCount > 1){
+        state.Enable(GL_SCISSOR_TEST);
+        state.Scissor(view.rect.x, view.rect.y, view.rect.width, view.rect.height);
+    }
+    gFrameUniforms.BindView(view.index);
+}
+
+// Back to the whole render target and the first view's uniforms
+void EndSceneViews(){
+    int width = 0;
+    int height = 0;
+    GetRenderTargetSize(width, height);
+    GLStateCache& state = GLStateCache::Get();
+    state.Disable(GL_SCISSOR_TEST);
+    state.Viewport(0, 0, width, height);
+    gFrameUniforms.BindView(0);
+}
+
+// Records the scene's passes over the draws BuildDrawList() queued into
+// gSceneCommands: no GL call is made, Draw() replays them once the
+// batch is uploaded. Recorded again when the programs are rebuilt. Each
+// pass draws every view in turn, so a split screen is timed as one.
+void RecordSceneCommands(){
+    CommandBuffer& commands = gSceneCommands;
+    commands.Clear();
+    commands.BeginPass(gBackgroundPass);
+    for(size_t v = 0; v < gSceneViewCount; ++v){
+        const SceneView& view = gSceneViews[v];
+        commands.Call(BeginSceneView, &gSceneViews[v]);
+        commands.DrawBatchCommands(gSceneBatch, view.background.first, view.background.count);
+    }
+    commands.EndPass(gBackgroundPass);
+
+    commands.BeginPass(gCharacterPass);
+    for(size_t v = 0; v < gSceneViewCount; ++v){
+        const SceneView& view = gSceneViews[v];
+        commands.Call(BeginSceneView, &gSceneViews[v]);
+        commands.DrawBatchCommands(gSceneBatch, view.characters.first, view.characters.count);
+        if(view.stressCacti.count + view.stressDinos.count > 0){
+            commands.Call(DrawStressEntities, &gSceneViews[v]);
+        }
+        commands.Call(DrawObstacles, &gSceneViews[v]);
+    }
+    commands.EndPass(gCharacterPass);
+
+    commands.BeginPass(gSkyPass);
+    for(size_t v = 0; v < gSceneViewCount; ++v){
+        commands.Call(BeginSceneView, &gSceneViews[v]);
+        commands.Call(DrawSky);
+    }
+    commands.EndPass(gSkyPass);
+
+    // Ghosts over the finished scene, blended without writing depth so
+    // ghosts behind ghosts still show
+    size_t ghosts = 0;
+    for(size_t v = 0; v < gSceneViewCount; ++v){
+        ghosts += gSceneViews[v].ghosts.count;
+    }
+    if(ghosts > 0 && gShaderProgram != nullptr){
+        commands.BeginPass(gGhostPass);
+        commands.UseProgram(gShaderProgram->GetID());
+        commands.SetUniform(gUniforms.opacity, GHOST_OPACITY);
+        commands.SetUniform(gUniforms.time, gGhostClock);
+        commands.SetCapability(GL_BLEND, true);
+        commands.BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        commands.DepthMask(false);
+        for(size_t v = 0; v < gSceneViewCount; ++v){
+            const SceneView& view = gSceneViews[v];
+            commands.Call(BeginSceneView, &gSceneViews[v]);
+            commands.DrawBatchCommands(gSceneBatch, view.ghosts.first, view.ghosts.count);
+        }
+        commands.DepthMask(true);
+        commands.SetCapability(GL_BLEND, false);
+        commands.SetUniform(gUniforms.opacity, 1.0f);
+        commands.SetUniform(gUniforms.time, gDinoClock);
+        commands.EndPass(gGhostPass);
+    }
+}
+
+/**
+* Draw
+* The render function gets called once per loop.
+* Typically this includes 'glDraw' related calls, and the relevant setup of buffers
+* for those calls.
+*
+* @return void
+*/
+void Draw(){
+    // Ground chunks that came into view since the last frame
+    gGround.Upload(gMeshRegistry, gSceneArena);
+    // Everything is streamed once, then drawn as the recorded passes; a
+    // batch that could not upload draws nothing, the sky still does
+    if(gSceneBatch.Upload(gMeshRegistry, gSceneArena) && gInstanceCuller.IsReady()){
+        CullStressEntities();
+    }
+    gSceneCommands.Execute(&gGPUProfiler);
+    gSceneBatch.Finish();
+    gSceneDrawCalls = gSceneBatch.GetDrawCallCount();
+
+    // Dust over the scene, tinted for the time of day
+    gGPUProfiler.BeginPass(gParticlePass);
+    glm::vec4 dustColor = glm::mix(glm::vec4(0.76f, 0.66f, 0.48f, 0.7f), glm::vec4(0.45f, 0.45f, 0.55f, 0.5f), gTimeOfDay);
+    for(size_t v = 0; v < gSceneViewCount; ++v){
+        // Stepped once, for the first view
+        BeginSceneView(&gSceneViews[v]);
+        if(v == 0){
+            gParticles.Draw(dustColor);
+        }else{
+            gParticles.Redraw(dustColor);
+        }
+    }
+    EndSceneViews();
+    gGPUProfiler.EndPass(gParticlePass);
+    gFrameUniforms.Finish();
+
+    // Read the observation back and show it in the window
+    if(gObserving){
+        gObserver.Capture();
+        if(!gOffscreen){
+            gObserver.BlitToWindow(gScreenWidth, gScreenHeight);
+        }
+        gObserver.Unbind();
+    }else if(gDynamicResolution){
+        gResolution.BlitToWindow();
+    }
+    // Every observed environment in one pass and one readback
+    if(gAtlas.IsReady()){
+        StepObservedEnvironments();
+        AtlasScene scene;
+        scene.dayBackground = gDayBackground.range;
+        scene.nightBackground = gNightBackground.range;
+        scene.dinoFrames[0] = gDinoFrames[0].range;
+        scene.dinoFrames[1] = gDinoFrames[1].range;
+        scene.cactus = gCactus.range;
+        scene.dayLayer = (float)gDayLayer;
+        scene.nightLayer = (float)(gNightLayerReady ? gNightLayer : gDayLayer);
+        scene.palette = gPalette.GetTexture();
+        // The workers draw their parts while this context draws the first
+        gRenderWorkers.Render(gObserveEnvs, scene, gSceneTextures);
+        gAtlas.Render(gObserveEnvs, scene, gMeshRegistry, gSceneArena, gSceneTextures);
+        if(!gOffscreen){
+            gAtlas.BlitToWindow(gScreenWidth, gScreenHeight);
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        gRenderWorkers.Wait();
+    }
+
+    // The overlay goes over whatever the window shows
+    if(gHUD.IsVisible()){
+        gGPUProfiler.BeginPass(gHUDPass);
+        gHUD.Draw(gScreenWidth, gScreenHeight);
+        gGPUProfiler.EndPass(gHUDPass);
+    }
+
+	// The program stays bound: there is only one graphics pipeline and the
+	// state cache skips re-binding it next frame.
+}
+
+/**
+* Draws one pixel with every program the game can switch to, in the
+* state each is drawn with, before the first frame. Drivers finish a
+* program only at its first draw, for the vertex layout, blending and
+* target formats it meets there; without this the day/night blend
+* variant would compile at the first dusk and the particle programs at
+* the first jump's dust. Every frame clears what this draws.
+*
+* @return void
+*/
+void WarmUpPipelines(){
+    TraceLoad load(gTrace, "warm-up");
+    GLStateCache& state = GLStateCache::Get();
+    PreDraw();
+    state.Enable(GL_SCISSOR_TEST);
+    state.Scissor(0, 0, 1, 1);
+
+    // One dino, in front of the camera or not: only the draw matters
+    InstanceData instance = {};
+    instance.scale = 1.0f;
+    instance.layer = PALETTE_DAY_LAYER;
+    instance.nightLayer = PALETTE_DAY_LAYER;
+    gSceneBatch.Begin();
+    gSceneBatch.Add(gDinoFrames[0].range, &instance, 1);
+    if(gSceneBatch.Upload(gMeshRegistry, gSceneArena)){
+        for(uint32_t mask = 0; mask < SCENE_VARIANTS; ++mask){
+            if(gSceneVariants.Get(mask) == nullptr){
+                continue;
+            }
+            SelectSceneVariant(mask);
+            state.PolygonMode((mask & SCENE_WIREFRAME) ? GL_LINE : GL_FILL);
+            gShaderProgram->Use();
+            SetSceneUniforms();
+            gSceneBatch.DrawCommands(0, 1);
+            // As the ghosts are drawn
+            state.Enable(GL_BLEND);
+            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            glDepthMask(GL_FALSE);
+            gSceneBatch.DrawCommands(0, 1);
+            glDepthMask(GL_TRUE);
+            state.Disable(GL_BLEND);
+        }
+    }
+    gSceneBatch.Finish();
+    state.PolygonMode(gPolygonMode);
+
+    SkyLayers skyLayers;
+    skyLayers.day = (float)gDayLayer;
+    skyLayers.night = (float)gDayLayer;
+    gSky.Draw(skyLayers);
+    gParticles.WarmUp();
+    gFrameUniforms.Finish();
+
+    state.Disable(GL_SCISSOR_TEST);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    SelectSceneVariant(gSceneBindless);
+    // Waits here rather than in the first frame
+    glFinish();
+}
+
+/**
+* Helper Function to get OpenGL Version Information
+*
+* @return void
+*/
+void getOpenGLVersionInfo(){
+  std::cout << "Vendor: " << glGetString(GL_VENDOR) << "\n";
+  std::cout << "Renderer: " << glGetString(GL_RENDERER) << "\n";
+  std::cout << "Version: " << glGetString(GL_VERSION) << "\n";
+  std::cout << "Shading language: " << glGetString(GL_SHADING_LANGUAGE_VERSION) << "\n";
+}
+
+
+// Starts a new game at the next simulation step. Replays restart when
+// the log says so.
+void RestartGame(){
+    if(!gReplaying){
+        gRestartPending = true;
+    }
+}
+
+// Switches debug mode (free camera, no collision) on or off
+void ToggleDebug(){
+    if (gDebug) {
+        gDebug = false;
+        SDL_SetRelativeMouseMode(SDL_FALSE);
+        LOG_INFO("Debug mode off");
+    }else{
+        gDebug = true;
+        SDL_SetRelativeMouseMode(SDL_TRUE);
+        LOG_INFO("Debug mode on");
+    }
+}
+
+// Switches between filled and wireframe rendering
+void TogglePolygonMode(){
+    if(gPolygonMode== GL_FILL){
+        gPolygonMode = GL_LINE;
+        LOG_INFO("Mode: GL_LINE");
+    }else{
+        gPolygonMode = GL_FILL;
+        LOG_INFO("Mode: GL_FILL");
+    }
+}
+
+// The performance counter at the moment an event happened. Events carry
+// their time in milliseconds of SDL_GetTicks(), so the counter is taken
+// back by the event's age on that clock.
+static Uint64 GetEventCounter(const SDL_Event& e){
+    Uint64 now = SDL_GetPerformanceCounter();
+    Uint32 age = SDL_GetTicks() - e.common.timestamp;
+    Uint64 counts = (Uint64)age * SDL_GetPerformanceFrequency() / 1000;
+    return (counts < now) ? now - counts : 0;
+}
+
+// SDL event watch: queues a jump press for the simulation the moment the
+// event is pumped, on whichever thread pumps it. Presses while paused are
+// not queued; the held key still counts once the game resumes.
+static int QueueJumpPress(void* userdata, SDL_Event* e){
+    (void)userdata;
+    if(e->type == SDL_KEYDOWN && e->key.repeat == 0 && e->key.keysym.scancode == SDL_SCANCODE_SPACE &&
+       !gPaused.load(std::memory_order_relaxed)){
+        // A full queue only loses the early jump, the key is held anyway
+        gJumpPresses.Push(JumpPress{GetEventCounter(*e)});
+    }
+    // The other players of a split screen, on their own keys
+    if(e->type == SDL_KEYDOWN && e->key.repeat == 0 && !gPaused.load(std::memory_order_relaxed)){
+        for(size_t player = 1; player < gLocalPlayers; ++player){
+            if(e->key.keysym.scancode == LOCAL_PLAYER_KEYS[player]){
+                gLocalPlayerPressed.fetch_or(1u << (player - 1));
+            }
+        }
+    }
+    return 0;
+}
+
+/**
+* Function called in the Main application loop to handle user input
+*
+* @return void
+*/
+void Input(){
+    // Two static variables to hold the mouse position
+    static int mouseX=gScreenWidth/2;
+    static int mouseY=gScreenHeight/2; 
+
+	// Event handler that handles various events in SDL
+	// that are related to input and output
+	SDL_Event e;
+	//Handle events on queue
+	while(SDL_PollEvent( &e ) != 0){
+		// If users posts an event to quit
+		// An example is hitting the "x" in the corner of the window.
+		if(e.type == SDL_QUIT){
+			LOG_INFO("Goodbye! (Leaving MainApplicationLoop())");
+			gQuit = true;
+		}
+        if(e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_ESCAPE){
+			LOG_INFO("ESC: Goodbye! (Leaving MainApplicationLoop())");
+            gQuit = true;
+        }
+        if(((e.type == SDL_KEYDOWN && e.key.repeat == 0) || e.type == SDL_MOUSEBUTTONDOWN) &&
+           !gBenchmark.IsRunning() && !gStress.IsRunning() && !gReplaying){
+            gInputLatency.AddInput(GetEventCounter(e));
+        }
+        if(e.type == SDL_WINDOWEVENT){
+            switch(e.window.event){
+                // The window was uncovered or resized, its contents are stale
+                case SDL_WINDOWEVENT_SHOWN:
+                case SDL_WINDOWEVENT_EXPOSED:
+                case SDL_WINDOWEVENT_RESTORED:
+                case SDL_WINDOWEVENT_MAXIMIZED:
+                    gWindowHidden = false;
+                    gIdleRedraw = true;
+                    break;
+                case SDL_WINDOWEVENT_SIZE_CHANGED:
+                    gIdleRedraw = true;
+                    break;
+                case SDL_WINDOWEVENT_MINIMIZED:
+                case SDL_WINDOWEVENT_HIDDEN:
+                    gWindowHidden = true;
+                    break;
+                case SDL_WINDOWEVENT_FOCUS_LOST:
+                    gFocusLost = true;
+                    break;
+                case SDL_WINDOWEVENT_FOCUS_GAINED:
+                    gFocusLost = false;
+                    break;
+                default:
+                    break;
+            }
+        }
+        // Toggles and restarts fire once per key press; key repeat
+        // events from holding the key down are ignored.
+        if(e.type == SDL_KEYDOWN && e.key.repeat == 0){
+            // Only the toggles below change the game over screen
+            gIdleRedraw = true;
+            switch(e.key.keysym.scancode){
+                case SDL_SCANCODE_R:
+                    RestartGame();
+                    break;
+                case SDL_SCANCODE_T:
+                    ToggleDebug();
+                    break;
+                case SDL_SCANCODE_H:
+                    gHUD.SetVisible(!gHUD.IsVisible());
+                    break;
+                case SDL_SCANCODE_F12:
+                    gScreenshots.Request();
+                    break;
+                case SDL_SCANCODE_TAB:
+                    if(gDebug){
+                        TogglePolygonMode();
+                    }
+                    break;
+                default:
+                    break;
+            }
+        }
+        if(e.type==SDL_MOUSEMOTION && gDebug){
+            // Capture the change in the mouse position
+            mouseX+=e.motion.xrel;
+            mouseY+=e.motion.yrel;
+            gCamera.MouseLook(mouseX,mouseY);
+        }
+	}
+
+    // Retrieve keyboard state for the keys that act while held
+    const Uint8 *state = SDL_GetKeyboardState(NULL);
+
+    // Camera
     // Update our position of the camera
     if (state[SDL_SCANCODE_W] && gDebug) {
         gCamera.MoveForward(0.1f);
     }
-    if (state[SDL_SCANCODE_S] && gDebug) {
-        gCamera.MoveBackward(0.1f);
+    if (state[SDL_SCANCODE_S] && gDebug) {
+        gCamera.MoveBackward(0.1f);
+    }
+    if (state[SDL_SCANCODE_A] && gDebug) {
+        gCamera.MoveLeft(0.1f);
+    }
+    if (state[SDL_SCANCODE_D] && gDebug) {
+        gCamera.MoveRight(0.1f);
+    }
+    // Game
+    // Used to update the game state
+    gJumpHeld = state[SDL_SCANCODE_SPACE] != 0;
+    uint32_t playersHeld = 0;
+    for(size_t player = 1; player < gLocalPlayers; ++player){
+        if(state[LOCAL_PLAYER_KEYS[player]]){
+            playersHeld |= 1u << (player - 1);
+        }
+    }
+    gLocalPlayerHeld.store(playersHeld, std::memory_order_relaxed);
+    if (state[SDL_SCANCODE_0]) {
+        colorOffset = 0;
+    }
+    if (state[SDL_SCANCODE_1]) {
+        colorOffset = 1;
+    }
+    if (state[SDL_SCANCODE_2]) {
+        colorOffset = 2;
+    }
+    if (state[SDL_SCANCODE_3]) {
+        colorOffset = 3;
+    }
+    if (state[SDL_SCANCODE_4]) {
+        colorOffset = 4;
+    }
+    // Runs that must replay exactly, the hidden window of --offscreen and
+    // a race the opponent goes on with never pause
+    gPaused.store((gFocusLost || gWindowHidden) && !gOffscreen && !gReplaying && !gBenchmark.IsRunning() &&
+                 !gStress.IsRunning() && !gVersus.IsActive(),
+                  std::memory_order_relaxed);
+    // Handed over whole, so a step never sees half of a poll
+    uint64_t sequence = gInputLatency.Submit();
+    gHeldInput.store((sequence << 8) | EncodeInput(gJumpHeld, false, gDebug, colorOffset), std::memory_order_release);
+}
+
+
+/**
+* Reads the options from the command line: frame pacing (--vsync,
+* --adaptive, --uncapped or --cap=<hz>, and --low-latency), --seed=<n>
+* and the pixel observation options --observe=<w>x<h>, --observe-color,
+* --observe-supersample=<k>, --observe-maxpool, --observe-envs=<n> with
+* --render-workers=<n>, and --offscreen, --headless[=<device>],
+* --gpu-sim-check=<n>,
+* input logs: --record=<file>, --replay=<file>, --replay-every=<n>,
+* --replay-from=<step>,
+* tracing: --trace=<file>, --trace-frames=<n>, --alloc-budget=<n>,
+* --hitch-budget=<ms> with --hitch-seconds=<s> and --hitch-dir=<dir>,
+* --benchmark=<frames> with --benchmark-out=<file>,
+* --benchmark-baseline=<file> and --benchmark-tolerance=[<metric>=]<percent>,
+* --stress=<n>, --ghosts=<file>[,<file>...], --versus=<host>:<port> with
+* --versus-port=<port> and --input-delay=<steps>, --split-screen=<n>,
+* --bots=<library>[:<options>], --spectator-port=<port>
+* with --spectator-rate=<hz>, --spectate=<host>:<port>, --metrics-port=<port>,
+* --inspect[=<name>],
+* --capture=<file> with --capture-fps=<n>, --screenshot-dir=<dir>, --stats,
+* --gameplay-log=<file>, --no-audio, --audio-buffer=<frames>,
+* --gl-debug[=sync], --gl-no-error, --pack=<file>, --no-pack, --panorama=<file>, --shader-cache=<dir>,
+* --no-shader-cache, --hot-reload, --lod-error=<pixels>, --impostor-distance=<units>,
+* --tier=<low|medium|high>, --probe, --no-tier, --vram-budget=<MB>,
+* --dynamic-resolution[=<min percent>] with --gpu-budget=<ms>, --hud,
+* --no-sim-thread, --run-ahead=<k>, --jobs=<n>, --affinity=<compact|scatter>,
+* --exclude-cores=<list>, --pin-main, --no-dsa, --no-bindless, --cpu-cull,
+* --no-io-uring and --direct-io.
+*
+* @return void
+*/
+void ParseArguments(int argc, char* args[]){
+    for(int i = 1; i < argc; ++i){
+        std::string argument = args[i];
+        if(argument == "--vsync"){
+            gSwapMode = SWAP_VSYNC;
+        }else if(argument == "--adaptive"){
+            gSwapMode = SWAP_ADAPTIVE;
+        }else if(argument == "--low-latency"){
+            gLowLatency = true;
+        }else if(argument == "--uncapped"){
+            gSwapMode = SWAP_UNCAPPED;
+        }else if(argument.compare(0, 6, "--cap=") == 0){
+            gSwapMode = SWAP_CAPPED;
+            gFrameCap = atoi(argument.c_str() + 6);
+            if(gFrameCap <= 0){
+                std::cout << "Invalid frame cap " << argument << ", using 30 Hz\n";
+                gFrameCap = 30;
+            }
+        }else if(argument.compare(0, 10, "--observe=") == 0){
+            gObserving = true;
+            if(sscanf(argument.c_str() + 10, "%dx%d", &gObserveWidth, &gObserveHeight) != 2 ||
+               gObserveWidth <= 0 || gObserveHeight <= 0){
+                std::cout << "Invalid observation size " << argument << ", using 84x84\n";
+                gObserveWidth = 84;
+                gObserveHeight = 84;
+            }
+        }else if(argument.compare(0, 15, "--observe-envs=") == 0){
+            long count = atol(argument.c_str() + 15);
+            if(count <= 0){
+                std::cout << "Invalid environment count " << argument << ", observing the game alone\n";
+                count = 0;
+            }
+            gObserveEnvCount = (size_t)count;
+        }else if(argument.compare(0, 16, "--gpu-sim-check=") == 0){
+            long count = atol(argument.c_str() + 16);
+            if(count <= 0){
+                std::cout << "Invalid environment count " << argument << ", no GPU simulation check\n";
+                count = 0;
+            }
+            gGPUSimulationCheckEnvs = (size_t)count;
+        }else if(argument.compare(0, 17, "--render-workers=") == 0){
+            long count = atol(argument.c_str() + 17);
+            if(count < 0){
+                std::cout << "Invalid render worker count " << argument << ", rendering on one context\n";
+                count = 0;
+            }
+            gRenderWorkerCount = (size_t)count;
+        }else if(argument.compare(0, 22, "--observe-supersample=") == 0){
+            gObserveSupersample = atoi(argument.c_str() + 22);
+            if(gObserveSupersample <= 0){
+                std::cout << "Invalid supersampling " << argument << ", rendering at the observation size\n";
+                gObserveSupersample = 1;
+            }
+        }else if(argument == "--observe-maxpool"){
+            gObserveMaxPool = true;
+        }else if(argument == "--observe-color"){
+            gObserveGrayscale = false;
+        }else if(argument == "--offscreen"){
+            gOffscreen = true;
+            gObserving = true;
+        }else if(argument == "--headless" || argument.compare(0, 11, "--headless=") == 0){
+            gHeadless = true;
+            gOffscreen = true;
+            gObserving = true;
+            gHeadlessDevice = (argument.size() > 11) ? std::max(0, atoi(argument.c_str() + 11)) : 0;
+        }else if(argument.compare(0, 9, "--record=") == 0){
+            gRecordPath = argument.substr(9);
+        }else if(argument.compare(0, 9, "--replay=") == 0){
+            gReplayPath = argument.substr(9);
+        }else if(argument.compare(0, 14, "--replay-from=") == 0){
+            gReplayFrom = (size_t)strtoull(argument.c_str() + 14, nullptr, 10);
+        }else if(argument.compare(0, 15, "--replay-every=") == 0){
+            gReplayStepsPerFrame = std::max(1, atoi(argument.c_str() + 15));
+        }else if(argument.compare(0, 8, "--trace=") == 0){
+            gTracePath = argument.substr(8);
+        }else if(argument.compare(0, 15, "--trace-frames=") == 0){
+            gTraceFrames = std::max(1, atoi(argument.c_str() + 15));
+        }else if(argument == "--gl-debug" || argument == "--gl-debug=sync"){
+            gGLDebug = true;
+            gGLDebugSynchronous = (argument == "--gl-debug=sync");
+        }else if(argument == "--gl-no-error"){
+            gGLNoError = true;
+        }else if(argument.compare(0, 7, "--pack=") == 0){
+            gPackPath = argument.substr(7);
+        }else if(argument.compare(0, 11, "--panorama=") == 0){
+            gPanoramaPath = argument.substr(11);
+        }else if(argument == "--no-pack"){
+            gPackPath.clear();
+        }else if(argument == "--no-sim-thread"){
+            gSimulationThread = false;
+        }else if(argument == "--no-dsa"){
+            gDirectStateAccess = false;
+        }else if(argument == "--no-bindless"){
+            gAllowBindless = false;
+        }else if(argument == "--cpu-cull"){
+            gAllowGPUCulling = false;
+        }else if(argument == "--no-io-uring"){
+            gFileReads.ioUring = false;
+        }else if(argument == "--direct-io"){
+            gFileReads.direct = true;
+        }else if(argument.compare(0, 15, "--shader-cache=") == 0){
+            gShaderCachePath = argument.substr(15);
+        }else if(argument == "--no-shader-cache"){
+            gShaderCachePath.clear();
+        }else if(argument == "--hot-reload"){
+            gHotReload = true;
+        }else if(argument.compare(0, 12, "--run-ahead=") == 0){
+            gRunAhead = std::min(std::max(0, atoi(argument.c_str() + 12)), MAX_RUN_AHEAD);
+        }else if(argument.compare(0, 7, "--jobs=") == 0){
+            gJobThreads = (unsigned int)std::max(0, atoi(argument.c_str() + 7));
+        }else if(argument.compare(0, 11, "--affinity=") == 0){
+            if(!ParseAffinityPolicy(argument.substr(11), gAffinity.policy)){
+                std::cout << "Invalid affinity " << argument << ", expected none, compact or scatter\n";
+            }
+        }else if(argument.compare(0, 16, "--exclude-cores=") == 0){
+            if(!ParseCoreList(argument.substr(16), gAffinity.excluded)){
+                std::cout << "Invalid core list " << argument << ", expected e.g. 0,2,8-11\n";
+            }
+        }else if(argument == "--pin-main"){
+            gAffinity.pinCaller = true;
+        }else if(argument == "--hud"){
+            gHUD.SetVisible(true);
+        }else if(argument == "--dynamic-resolution" || argument.compare(0, 21, "--dynamic-resolution=") == 0){
+            gDynamicResolution = true;
+            gTierSetByArguments |= TIER_SET_RESOLUTION;
+            if(argument.size() > 20){
+                int percent = atoi(argument.c_str() + 21);
+                if(percent < 10 || percent > 100){
+                    std::cout << "Invalid minimum resolution " << argument << ", using 50%\n";
+                    percent = 50;
+                }
+                gMinResolutionScale = (float)percent / 100.0f;
+            }
+        }else if(argument.compare(0, 13, "--gpu-budget=") == 0){
+            gGPUBudgetMilliseconds = atof(argument.c_str() + 13);
+            if(gGPUBudgetMilliseconds <= 0.0){
+                std::cout << "Invalid GPU budget " << argument << ", using 15 ms\n";
+                gGPUBudgetMilliseconds = 15.0;
+            }
+        }else if(argument.compare(0, 12, "--lod-error=") == 0){
+            gLodPixelError = std::max(0.0f, (float)atof(argument.c_str() + 12));
+            gTierSetByArguments |= TIER_SET_LOD;
+        }else if(argument.compare(0, 7, "--tier=") == 0){
+            gTierName = argument.substr(7);
+        }else if(argument == "--probe"){
+            gTierProbe = true;
+        }else if(argument == "--no-tier"){
+            gTierEnabled = false;
+        }else if(argument.compare(0, 14, "--vram-budget=") == 0){
+            int megabytes = atoi(argument.c_str() + 14);
+            if(megabytes < 0){
+                std::cout << "Invalid VRAM budget " << argument << ", using no limit\n";
+                megabytes = 0;
+            }
+            gResidency.SetBudget((size_t)megabytes << 20);
+        }else if(argument.compare(0, 20, "--impostor-distance=") == 0){
+            gImpostorDistance = std::max(0.0f, (float)atof(argument.c_str() + 20));
+        }else if(argument.compare(0, 15, "--alloc-budget=") == 0){
+            AllocationCounter::Get().SetBudget(std::max(0, atoi(argument.c_str() + 15)));
+        }else if(argument.compare(0, 15, "--hitch-budget=") == 0){
+            gHitchBudgetMilliseconds = atof(argument.c_str() + 15);
+            if(gHitchBudgetMilliseconds <= 0.0){
+                std::cout << "Invalid hitch budget " << argument << ", using 20 ms\n";
+                gHitchBudgetMilliseconds = 20.0;
+            }
+        }else if(argument.compare(0, 16, "--hitch-seconds=") == 0){
+            gHitchSeconds = std::max(0.5, atof(argument.c_str() + 16));
+        }else if(argument.compare(0, 12, "--hitch-dir=") == 0){
+            gHitchDirectory = argument.substr(12);
+        }else if(argument.compare(0, 16, "--benchmark-out=") == 0){
+            gBenchmarkOutPath = argument.substr(16);
+        }else if(argument.compare(0, 21, "--benchmark-baseline=") == 0){
+            gBenchmarkBaselinePath = argument.substr(21);
+        }else if(argument.compare(0, 22, "--benchmark-tolerance=") == 0){
+            std::string value = argument.substr(22);
+            size_t equals = value.find('=');
+            std::string metric = (equals == std::string::npos) ? "" : value.substr(0, equals);
+            double percent = atof(value.c_str() + ((equals == std::string::npos) ? 0 : equals + 1));
+            if(!gBenchmark.SetTolerance(metric, percent)){
+                std::cout << "Unknown metric " << metric << ", the gated ones are frame_p99_ms, load_ms and sim_steps_per_second\n";
+            }
+        }else if(argument.compare(0, 12, "--benchmark=") == 0){
+            gBenchmarkFrames = std::max(1, atoi(argument.c_str() + 12));
+        }else if(argument.compare(0, 9, "--stress=") == 0){
+            gStressEntities = (size_t)std::max(1, atoi(argument.c_str() + 9));
+        }else if(argument.compare(0, 9, "--ghosts=") == 0){
+            std::string list = argument.substr(9);
+            size_t start = 0;
+            while(start <= list.size()){
+                size_t comma = list.find(',', start);
+                if(comma == std::string::npos){
+                    comma = list.size();
+                }
+                if(comma > start){
+                    gGhostPaths.push_back(list.substr(start, comma - start));
+                }
+                start = comma + 1;
+            }
+        }else if(argument.compare(0, 9, "--versus=") == 0){
+            gVersusPeer = argument.substr(9);
+        }else if(argument.compare(0, 14, "--versus-port=") == 0){
+            gVersusPort = atoi(argument.c_str() + 14);
+        }else if(argument.compare(0, 14, "--input-delay=") == 0){
+            gInputDelay = std::max(0, std::min(atoi(argument.c_str() + 14), (int)VersusSession::MAX_INPUT_DELAY));
+        }else if(argument.compare(0, 7, "--bots=") == 0){
+            gBotsSpec = argument.substr(7);
+        }else if(argument.compare(0, 15, "--split-screen=") == 0){
+            gLocalPlayers = (size_t)std::max(2, std::min(atoi(argument.c_str() + 15), (int)MAX_LOCAL_PLAYERS));
+        }else if(argument.compare(0, 17, "--spectator-port=") == 0){
+            gSpectatorPort = atoi(argument.c_str() + 17);
+        }else if(argument.compare(0, 17, "--spectator-rate=") == 0){
+            gSpectatorRate = std::max(1, std::min(atoi(argument.c_str() + 17), 60));
+        }else if(argument.compare(0, 15, "--metrics-port=") == 0){
+            gMetricsPort = atoi(argument.c_str() + 15);
+        }else if(argument == "--inspect"){
+            gInspectName = "/dino-inspect";
+        }else if(argument.compare(0, 10, "--inspect=") == 0){
+            gInspectName = argument.substr(10);
+            if(gInspectName.empty() || gInspectName[0] != '/'){
+                gInspectName = "/" + gInspectName;
+            }
+        }else if(argument.compare(0, 11, "--spectate=") == 0){
+            gSpectatePeer = argument.substr(11);
+        }else if(argument.compare(0, 14, "--capture-fps=") == 0){
+            gCaptureFps = atoi(argument.c_str() + 14);
+            if(gCaptureFps <= 0){
+                std::cout << "Invalid capture rate " << argument << ", using 60 fps\n";
+                gCaptureFps = 60;
+            }
+        }else if(argument == "--stats"){
+            gPrintStats = true;
+        }else if(argument.compare(0, 15, "--gameplay-log=") == 0){
+            gGameplayLogPath = argument.substr(15);
+        }else if(argument == "--no-audio"){
+            gAudioEnabled = false;
+        }else if(argument.compare(0, 15, "--audio-buffer=") == 0){
+            gAudioBufferFrames = atoi(argument.c_str() + 15);
+            // SDL wants a power of two
+            if(gAudioBufferFrames < 64 || gAudioBufferFrames > 4096 ||
+               (gAudioBufferFrames & (gAudioBufferFrames - 1)) != 0){
+                std::cout << "Invalid audio buffer " << argument << ", using 256 frames\n";
+                gAudioBufferFrames = 256;
+            }
+        }else if(argument.compare(0, 17, "--screenshot-dir=") == 0){
+            gScreenshots.SetDirectory(argument.substr(17));
+        }else if(argument.compare(0, 10, "--capture=") == 0){
+            gCapturePath = argument.substr(10);
+        }else if(argument.compare(0, 7, "--seed=") == 0){
+            gSeed = strtoull(argument.c_str() + 7, nullptr, 10);
+        }else{
+            std::cout << "Unknown option " << argument << "\n";
+        }
+    }
+}
+
+/**
+* Waits until lead counts before nextFrame (a performance counter value)
+* and schedules the one after it. A lead of 0 waits for the deadline
+* itself, after a frame is done; the frame's expected cost as the lead
+* waits before it, so the frame still ends on time. Sleeps while the
+* deadline is far away and spins for the last stretch, because SDL_Delay
+* is only accurate to a millisecond or two.
+*
+* @return void
+*/
+void LimitFrameRate(Uint64& nextFrame, Uint64 period, Uint64 lead){
+    const Uint64 frequency = SDL_GetPerformanceFrequency();
+    // Spin for the last 2 ms
+    const Uint64 spinCounts = frequency / 500;
+
+    Uint64 now = SDL_GetPerformanceCounter();
+    if(now + lead >= nextFrame){
+        // Running late: start a new schedule rather than racing to catch up
+        nextFrame = now + lead + period;
+        return;
+    }
+    const Uint64 wakeUp = nextFrame - lead;
+    if(wakeUp - now > spinCounts){
+        SDL_Delay((Uint32)((wakeUp - now - spinCounts) * 1000 / frequency));
+    }
+    while(SDL_GetPerformanceCounter() < wakeUp){
+    }
+    nextFrame += period;
+}
+
+/**
+* Registers the GPU-timed render passes. Setting DINO_GPU_CSV to a file
+* path also records every frame's pass timings to that file.
+*
+* @return void
+*/
+void InitializeProfiling(){
+    gClearPass      = gGPUProfiler.AddPass("clear");
+    gBackgroundPass = gGPUProfiler.AddPass("background");
+    gCharacterPass  = gGPUProfiler.AddPass("characters");
+    gCullPass       = gGPUProfiler.AddPass("culling");
+    gSkyPass        = gGPUProfiler.AddPass("sky");
+    gGhostPass      = gGPUProfiler.AddPass("ghosts");
+    gParticlePass   = gGPUProfiler.AddPass("particles");
+    gHUDPass        = gGPUProfiler.AddPass("hud");
+    if(gTrace.IsRecording()){
+        gGPUProfiler.SetTrace(&gTrace);
+    }
+    if(gFlight.IsRecording()){
+        gGPUProfiler.SetFlightRecorder(&gFlight);
     }
-    if (state[SDL_SCANCODE_A] && gDebug) {
-        gCamera.MoveLeft(0.1f);
+    gGPUProfiler.Initialize();
+
+    const char* csvPath = getenv("DINO_GPU_CSV");
+    if(csvPath != nullptr){
+        gGPUProfiler.OpenCSV(csvPath);
     }
-    if (state[SDL_SCANCODE_D] && gDebug) {
-        gCamera.MoveRight(0.1f);
+}
+
+// Whether steps go on after the game is over: a race goes on, spectators
+// keep getting keyframes, a watched game goes on elsewhere, and the other
+// players of a split screen may still be running
+bool StepsWhileOver(){
+    return gVersus.IsActive() || gSpectators.IsRunning() || gSpectating.IsRunning() ||
+           gOtherPlayersRunning.load(std::memory_order_relaxed);
+}
+
+// Steps the other players of a split screen alongside player 1, each on
+// their own key: held at the last poll, or pressed since the last step.
+// Player 1's restart and invincibility go for everyone, and a restart
+// starts their games on player 1's new stream, so the lanes stay one.
+void StepOtherPlayers(uint8_t input){
+    const bool restart = (input & INPUT_RESTART) != 0;
+    const uint32_t held = gLocalPlayerHeld.load(std::memory_order_relaxed);
+    const uint32_t pressed = gLocalPlayerPressed.exchange(0) & (restart ? 0u : ~0u);
+    bool running = false;
+    for(size_t player = 1; player < gLocalPlayers; ++player){
+        LocalPlayer& other = gOtherPlayers[player - 1];
+        const uint32_t key = 1u << (player - 1);
+        if(restart){
+            ResetGameState(other.game, gSeed, gGamesPlayed);
+            other.jump = JumpAnchor();
+        }
+        bool wasOver = other.game.gameOver;
+        other.game.invincible = (input & INPUT_INVINCIBLE) != 0;
+        unsigned int events = Step(other.game, ((held | pressed | gBotJumps) & key) ? ACTION_JUMP : ACTION_NONE);
+        UpdateJumpAnchor(other.jump, other.game.tick, other.game.dinoHeight, other.game.jumpingUp,
+                         other.game.jumpingSpeed);
+        if((events & EVENT_GAME_OVER) && !wasOver){
+            LOG_INFO("Player %d is out with %d points", (int)player + 1, other.game.tick);
+        }
+        running = running || !other.game.gameOver;
     }
-    // Game
-    // Used to update the game state
-    if (state[SDL_SCANCODE_R]) {
-        SDL_Delay(250);
-        dayTick = 0;
-        isDaytime = true;
-        tick = 0;
-        gameOver = false;
-        g.currentDinoHeight = 0;
-        g.cactusPosition = 400;
-        cactusSpeed = 5;
-        jumpingSpeed = 4;
-        isJumping = false;
-        std::cout << "Restarted game" << std::endl;
-    }
-    if (state[SDL_SCANCODE_SPACE] && !isJumping) {
-        isJumping = true;
-        g.currentDinoHeight = 1;
+    gOtherPlayersRunning.store(running, std::memory_order_relaxed);
+}
+
+// Plays the step of every local player for the bots, in one call of the
+// policy over their feature rows: player 1's jump and a restart once
+// everyone has been out for a while go into input, the other players'
+// jumps into gBotJumps. A failing policy leaves the players to the keys.
+uint8_t PlayBots(uint8_t input){
+    gBotJumps = 0;
+    if(!gBots.IsLoaded()){
+        return input;
     }
-    if (state[SDL_SCANCODE_0]) {
-        colorOffset = 0;
+    float rows[MAX_LOCAL_PLAYERS * BOT_ROW_SIZE];
+    uint8_t jumps[MAX_LOCAL_PLAYERS] = {};
+    for(size_t player = 0; player < gLocalPlayers; ++player){
+        WriteFeatureObservation(GetLocalPlayerGame(player), BOT_FEATURE_OBSTACLES, rows + player * BOT_ROW_SIZE);
     }
-    if (state[SDL_SCANCODE_1]) {
-        colorOffset = 1;
+    if(!gBots.Act(rows, (uint32_t)gLocalPlayers, jumps)){
+        LOG_ERROR("The bots' policy failed, the keys play again");
+        gBots.Unload();
+        return input;
     }
-    if (state[SDL_SCANCODE_2]) {
-        colorOffset = 2;
+    input = (uint8_t)(input & ~INPUT_JUMP) | (jumps[0] ? INPUT_JUMP : 0);
+    for(size_t player = 1; player < gLocalPlayers; ++player){
+        gBotJumps |= jumps[player] ? (1u << (player - 1)) : 0u;
     }
-    if (state[SDL_SCANCODE_3]) {
-        colorOffset = 3;
+    if(gGame.gameOver && !gOtherPlayersRunning.load(std::memory_order_relaxed)){
+        if(++gBotStepsOver >= BOT_RESTART_STEPS){
+            input |= INPUT_RESTART;
+        }
+    }else{
+        gBotStepsOver = 0;
     }
-    if (state[SDL_SCANCODE_4]) {
-        colorOffset = 4;
+    if(input & INPUT_RESTART){
+        gBotStepsOver = 0;
     }
+    return input;
+}
 
-    if (state[SDL_SCANCODE_T]) {
-        if (gDebug) {
-            SDL_Delay(250);
-            gDebug = false;
-            SDL_SetRelativeMouseMode(SDL_FALSE);
-            std::cout << "Debug mode off" << std::endl;
-        }else{
-            SDL_Delay(250);
-            gDebug = true;
-            SDL_SetRelativeMouseMode(SDL_TRUE);
-            std::cout << "Debug mode on" << std::endl;
+// Starts a new game from the beginning of its track. The ground follows
+// once a state of the new game is drawn.
+void ResetTrack(){
+    gTrackDistance = 0;
+}
+
+// Shows the next step of the watched kiosk's game. Keys do nothing.
+// Returns true when it started a new game.
+bool WatchSpectatedStep(){
+    gRestartPending = false;
+    gSpectating.Poll();
+    SpectatorFrame frame;
+    if(!gSpectating.NextFrame(frame)){
+        return false;
+    }
+    uint64_t game = gGamesPlayed;
+    ApplySpectatorFrame(frame, gGame, gGamesPlayed, gTrackDistance);
+    bool restarted = gGamesPlayed != game;
+    if(restarted){
+        gDinoJump = JumpAnchor();
+    }
+    UpdateJumpAnchor(gDinoJump, gGame.tick, gGame.dinoHeight, gGame.jumpingUp, gGame.jumpingSpeed);
+    return restarted;
+}
+
+/**
+* Advances the game by one tick and reports what happened. The input is
+* the player's (and is recorded with --record) or the next one of the
+* replayed log. The rules themselves are in GameState.cpp.
+*
+* @param due Counter the step is scheduled at; it takes the jump presses
+*            queued up to then
+* @return true if a new game was started
+*/
+bool Simulate(Uint64 due){
+    if(gSpectating.IsRunning()){
+        return WatchSpectatedStep();
+    }
+    uint8_t input = 0;
+    if(gBenchmark.IsRunning() || gStress.IsRunning()){
+        // A scripted jump is pressed when its step reads it
+        static bool jumpHeld = false;
+        input = gBenchmark.GetInput(gGame);
+        bool jump = (input & INPUT_JUMP) != 0;
+        if(jump && !jumpHeld){
+            gInputLatency.AddInput(SDL_GetPerformanceCounter());
+        }
+        jumpHeld = jump;
+    }else if(gReplaying){
+        if(gReplayStep >= gInputLog.GetStepCount()){
+            LOG_INFO("Replay finished after %zu steps: tick %d, %llu games, state hash %llx", gReplayStep,
+                     gGame.tick, (unsigned long long)(gGamesPlayed + 1), (unsigned long long)HashGameState(gGame));
+            gQuit = true;
+            return false;
+        }
+        input = gInputLog.GetInput(gReplayStep++);
+        colorOffset = GetInputPalette(input);
+    }else{
+        // A race waits for the opponent rather than run away from it
+        if(gVersus.IsActive() && !gVersus.Poll()){
+            return false;
+        }
+        uint64_t held = gHeldInput.load(std::memory_order_acquire);
+        bool restart = gRestartPending.exchange(false);
+        // Presses pumped since the last step; those a game over screen
+        // left waiting do not jump in the new game
+        bool pressed = false;
+        JumpPress press;
+        while(gJumpPresses.Peek(press) && press.counter <= due){
+            gJumpPresses.Pop(press);
+            pressed = !restart;
+        }
+        input = (uint8_t)held | (restart ? INPUT_RESTART : 0) | (pressed ? INPUT_JUMP : 0);
+        input = PlayBots(input);
+        gSimulatedInputSequence = (uint32_t)(held >> 8);
+        if(gVersus.IsActive()){
+            input = gVersus.Advance(input);
+        }
+        if(!gRecordPath.empty()){
+            gInputLog.Record(input);
+        }
+    }
+
+    // The track moves with the leading player, player 1 or not
+    int distance = GetStepDistance(GetLocalPlayerGame(GetLeadingPlayer()));
+    bool wasJumping = gGame.isJumping;
+    unsigned int events = StepLoggedInput(gGame, input, gSeed, gGamesPlayed);
+    GameplayLog& gameplay = GameplayLog::Get();
+    if(input & INPUT_RESTART){
+        gameplay.Add(GAMEPLAY_RUN_START, (uint32_t)gGamesPlayed, 0, (int32_t)gSeed);
+    }
+    if(gGame.isJumping && !wasJumping){
+        gameplay.Add(GAMEPLAY_JUMP, (uint32_t)gGamesPlayed, gGame.tick, gGame.cactusSpeed,
+                     GetLeadObstacle(gGame.obstacles, gGame.scroll));
+    }
+    if(!gGame.gameOver || (events & EVENT_GAME_OVER)){
+        Telemetry::Get().AddSteps(1);
+    }
+    if(input & INPUT_RESTART){
+        gDinoJump = JumpAnchor();
+    }
+    UpdateJumpAnchor(gDinoJump, gGame.tick, gGame.dinoHeight, gGame.jumpingUp, gGame.jumpingSpeed);
+    StepOtherPlayers(input);
+    // Ghosts start over with every game of the player's
+    if(input & INPUT_RESTART){
+        gGhosts.Rewind();
+    }
+    gGhosts.Step();
+    if(input & INPUT_RESTART){
+        ResetTrack();
+        LOG_INFO("Restarted game");
+    }else{
+        gTrackDistance += distance;
+    }
+    if(events & EVENT_DAY_CHANGED){
+        LOG_INFO("Time of day changed!");
+    }
+    if(events & EVENT_GAME_OVER){
+        int formation = GetLeadFormation(gGame.obstacles, gGame.scroll);
+        Telemetry::Get().AddEpisode(gGame.tick, formation);
+        gameplay.Add(GAMEPLAY_DEATH, (uint32_t)gGamesPlayed, gGame.tick, gGame.cactusSpeed, formation,
+                     gGame.isDaytime ? 1 : 0);
+        LOG_INFO("Game over! You scored %d points", gGame.tick);
+        LOG_INFO("Press 'r' to restart");
+    }
+    if(input & INPUT_RESTART){
+        gVersusAnnounced = false;
+    }
+    if(gSpectators.IsRunning()){
+        SpectatorFrame frame;
+        CaptureSpectatorFrame(gGame, gGamesPlayed, gTrackDistance, frame);
+        gSpectators.AddTick(frame);
+    }
+    if(gVersus.IsActive() && gGame.gameOver && !gVersusAnnounced && gVersus.IsRemoteConfirmed()){
+        // Once the opponent's game of the same number is over for certain
+        const GameState& opponent = gVersus.GetRemoteGame();
+        if(gVersus.GetRemoteGamesPlayed() == gGamesPlayed && opponent.gameOver){
+            const char* result = (gGame.tick > opponent.tick) ? "You win" :
+                                 (gGame.tick < opponent.tick) ? "You lose" : "A draw";
+            LOG_INFO("%s, %d points to %d (%llu rollbacks so far, %llu steps simulated again, %u ms round trip)",
+                     result, gGame.tick, opponent.tick, (unsigned long long)gVersus.GetRollbacks(),
+                     (unsigned long long)gVersus.GetResimulatedSteps(), gVersus.GetRoundTripMs());
+            gVersusAnnounced = true;
+        }
+    }
+    return (input & INPUT_RESTART) != 0;
+}
+
+// Runs one simulation step and keeps the interpolation history up to date
+void RunSimulationStep(){
+    gPreviousState = gCurrentState;
+    bool restarted = Simulate(SDL_GetPerformanceCounter());
+    gCurrentState = CaptureRenderState();
+    gInputLatency.Simulated();
+    // A new game is not interpolated from the old one
+    if(restarted){
+        gPreviousState = gCurrentState;
+    }
+}
+
+/**
+* The simulation thread. Steps the game every SIM_STEP_SECONDS on its own
+* clock and publishes the states before and after each step, whatever
+* the frame loop is doing. It idles after a game over until a restart
+* is asked for, and skips ahead rather than catching up when it fell far
+* behind, as the frame loop does. The frame loop only reads the game
+* through the published states while this runs.
+*
+* @return void
+*/
+void SimulationThreadMain(){
+    const Uint64 frequency = SDL_GetPerformanceFrequency();
+    const Uint64 period = (Uint64)(SIM_STEP_SECONDS*(double)frequency);
+    const Uint64 maxLag = (Uint64)(MAX_FRAME_SECONDS*(double)frequency);
+    RenderState previous = CaptureRenderState();
+    RenderState current = previous;
+    Uint64 due = SDL_GetPerformanceCounter() + period;
+    while(gSimulationRunning.load(std::memory_order_relaxed)){
+        Uint64 now = SDL_GetPerformanceCounter();
+        if(now < due){
+            // A step is short, so oversleeping a millisecond only delays
+            // it, the schedule stays put
+            SDL_Delay((Uint32)((due - now)*1000/frequency));
+            continue;
+        }
+        if((gGame.gameOver && !gRestartPending && !StepsWhileOver()) || gPaused.load(std::memory_order_relaxed)){
+            due = now + period;
+            continue;
+        }
+        if(now - due > maxLag){
+            due = now;
+        }
+        previous = current;
+        bool restarted = Simulate(due);
+        current = CaptureRenderState();
+        if(restarted){
+            previous = current;
+        }
+        SimulationSnapshot& snapshot = gSnapshots.GetBack();
+        snapshot.previous = previous;
+        snapshot.current = current;
+        snapshot.stepCounter = due;
+        snapshot.inputSequence = gSimulatedInputSequence;
+        snapshot.game = gGame;
+        gSnapshots.Publish();
+        due += period;
+    }
+}
+
+// Starts the simulation thread from the current game state
+void StartSimulationThread(){
+    gSnapshotGame = gGame;
+    gSimulationRunning = true;
+    gSimulationWorker = std::thread(SimulationThreadMain);
+}
+
+// Stops the simulation thread after its current step
+void StopSimulationThread(){
+    if(gSimulationWorker.joinable()){
+        gSimulationRunning = false;
+        gSimulationWorker.join();
+    }
+}
+
+// Takes the latest published step, if there is a new one, as the states
+// frames are drawn between. Returns how far, as a fraction of a step, the
+// counter now is past the time that step was due.
+float AcquireSimulationSnapshot(Uint64 now){
+    if(gSnapshots.Acquire()){
+        const SimulationSnapshot& snapshot = gSnapshots.GetFront();
+        gPreviousState = snapshot.previous;
+        gCurrentState = snapshot.current;
+        gSnapshotGame = snapshot.game;
+        gInputLatency.Simulated(snapshot.inputSequence);
+    }
+    Uint64 stepCounter = gSnapshots.GetFront().stepCounter;
+    if(stepCounter == 0 || now <= stepCounter){
+        return 0.0f;
+    }
+    double steps = (double)(now - stepCounter)/(SIM_STEP_SECONDS*(double)SDL_GetPerformanceFrequency());
+    return (float)std::min(1.0, steps);
+}
+
+// Hands the frame rate, GPU time and GL memory to the metrics server
+// every METRICS_PUBLISH_FRAMES frames, the last ending at now
+void PublishMetrics(Uint64 now){
+    if(gGPUProfiler.GetCollectedFrameTime() >= 0.0){
+        gMetricsGPUMilliseconds = gGPUProfiler.GetCollectedFrameTime();
+    }
+    if(++gMetricsFrames < METRICS_PUBLISH_FRAMES){
+        return;
+    }
+    double seconds = (double)(now - gMetricsSince)/(double)SDL_GetPerformanceFrequency();
+    if(gMetricsSince != 0 && seconds > 0.0){
+        gMetrics.Publish(gMetricsFrames/seconds, gMetricsGPUMilliseconds, GPUResourceTracker::Get().GetTotalBytes());
+    }
+    gMetricsFrames = 0;
+    gMetricsSince = now;
+}
+
+// Copies a profiler name into a fixed-size field of the inspector
+static void CopyInspectorName(char* field, size_t size, const std::string& name){
+    size_t length = std::min(name.size(), size - 1);
+    memcpy(field, name.data(), length);
+    field[length] = '\0';
+}
+
+// Publishes the frame that ran from frameStart to frameEnd to the inspector
+void PublishInspector(Uint64 frameStart, Uint64 frameEnd){
+    InspectorState& state = gInspector.GetState();
+    const double millisecondsPerCount = 1000.0/(double)SDL_GetPerformanceFrequency();
+    ++state.frame;
+    state.seconds = (frameEnd - gStartCounter)*millisecondsPerCount/1000.0;
+    state.frameMilliseconds = (frameEnd - frameStart)*millisecondsPerCount;
+    state.game = gSimulationWorker.joinable() ? gSnapshotGame : gGame;
+    state.seed = gSeed;
+    state.gamesPlayed = gGamesPlayed;
+    state.paused = gPaused.load(std::memory_order_relaxed) ? 1 : 0;
+    state.frameAllocations = AllocationCounter::Get().GetFrameAllocations();
+    state.frameAllocatedBytes = AllocationCounter::Get().GetFrameBytes();
+    if(state.frame % INSPECTOR_SUMMARY_FRAMES == 1){
+        // Means over whole windows, and the tracker's lock, only now and then
+        CPUProfiler& profiler = CPUProfiler::Get();
+        state.meanFrameMilliseconds = profiler.GetZoneMean(gFrameZone);
+        state.zoneCount = (uint32_t)std::min(profiler.GetZoneCount(), INSPECTOR_MAX_ZONES);
+        for(uint32_t i = 0; i < state.zoneCount; ++i){
+            CopyInspectorName(state.zones[i].name, sizeof(state.zones[i].name), profiler.GetZoneName((int)i));
+            state.zones[i].meanMilliseconds = (float)profiler.GetZoneMean((int)i);
+        }
+        state.passCount = (uint32_t)std::min(gGPUProfiler.GetPassCount(), INSPECTOR_MAX_PASSES);
+        for(uint32_t i = 0; i < state.passCount; ++i){
+            CopyInspectorName(state.passes[i].name, sizeof(state.passes[i].name), gGPUProfiler.GetPassName((int)i));
+            state.passes[i].meanMilliseconds = (float)gGPUProfiler.GetPassMean((int)i);
+        }
+        state.resourceCount = (uint32_t)std::min((int)GPU_RESOURCE_TYPES, INSPECTOR_MAX_RESOURCES);
+        for(uint32_t i = 0; i < state.resourceCount; ++i){
+            GPUResourceType type = (GPUResourceType)i;
+            CopyInspectorName(state.resources[i].name, sizeof(state.resources[i].name),
+                              GPUResourceTracker::GetTypeName(type));
+            state.resources[i].count = GPUResourceTracker::Get().GetCount(type);
+            state.resources[i].bytes = GPUResourceTracker::Get().GetBytes(type);
+        }
+        TelemetrySnapshot telemetry = Telemetry::Get().Snapshot();
+        state.episodes = telemetry.episodes;
+        state.steps = telemetry.steps;
+        state.bestScore = telemetry.scoreMax;
+    }
+    gInspector.Publish();
+}
+
+// Frames between two reports of the profilers in debug mode
+const int PROFILE_REPORT_FRAMES = 600;
+
+// Prints the CPU and GPU timings in debug mode
+void ReportProfiling(){
+    if(gDebug){
+        CPUProfiler::Get().Report();
+        gGPUProfiler.Report();
+        GPUResourceTracker::Get().Report();
+        gResidency.Report();
+        MemoryTags::Report();
+        if(gObserving){
+            std::cout << "Observations: " << gObserver.GetReadbackCount() << " read back, "
+                      << gObserver.GetStallCount() << " stalls, " << gObserver.GetReadbackBytes()
+                      << " bytes a frame\n";
+        }
+        if(gAtlas.IsReady()){
+            std::cout << "Atlas of " << gAtlas.GetCount() << " environments (" << gAtlas.GetColumns() << "x"
+                      << gAtlas.GetRows() << " tiles): " << gAtlas.GetReadbackCount() << " read back, "
+                      << gAtlas.GetStallCount() << " stalls, " << gAtlas.GetDrawCallCount() << " draw calls\n";
+            for(size_t i = 0; i < gRenderWorkers.GetWorkerCount(); ++i){
+                const AtlasObserver& atlas = gRenderWorkers.GetObserver(i);
+                std::cout << "  render worker " << i << ": " << atlas.GetCount() << " environments from "
+                          << gRenderWorkers.GetFirst(i) << ", " << atlas.GetReadbackCount() << " read back, "
+                          << atlas.GetStallCount() << " stalls, " << atlas.GetDrawCallCount() << " draw calls\n";
+            }
+        }
+        if(gLowLatency){
+            std::cout << "Low latency: " << gLatency.GetWaitCount() << " waits for the GPU, "
+                      << gLatency.GetWaitMilliseconds() << " ms in total, frames predicted to take "
+                      << gLatency.GetPredictedCost() << " ms\n";
+        }
+        if(gInputLatency.GetSwapCount() > 0){
+            std::cout << "Input latency to swap (ms): p50 " << gInputLatency.GetSwapPercentile(50.0)
+                      << " p95 " << gInputLatency.GetSwapPercentile(95.0)
+                      << " p99 " << gInputLatency.GetSwapPercentile(99.0)
+                      << " over the last " << std::min(gInputLatency.GetSwapCount(), (unsigned long)InputLatency::WINDOW)
+                      << " inputs\n";
+        }
+        if(gInputLatency.GetGPUCount() > 0){
+            std::cout << "Input latency to GPU done (ms): p50 " << gInputLatency.GetGPUPercentile(50.0)
+                      << " p95 " << gInputLatency.GetGPUPercentile(95.0)
+                      << " p99 " << gInputLatency.GetGPUPercentile(99.0) << "\n";
         }
+        // Last, so the reports before it are not counted as allocations
+        AllocationCounter::Get().Report();
     }
+}
 
-    if (state[SDL_SCANCODE_TAB] && gDebug) {
-        SDL_Delay(250); // This is hacky in the name of simplicity,
-                       // but we just delay the
-                       // system by a few milli-seconds to process the 
-                       // keyboard input once at a time.
-        if(gPolygonMode== GL_FILL){
-            gPolygonMode = GL_LINE;
-            std::cout << "Mode: GL_LINE" << std::endl;
+// Writes a list of profiler timings as "NAME 0.00" pairs on one line
+static float HUDTimings(float x, float y, const char* label, const int* ids, size_t count, bool gpu){
+    char text[32];
+    x = gHUD.Text(x, y, label, HUD_YELLOW);
+    for(size_t i = 0; i < count; ++i){
+        const std::string& name = gpu ? gGPUProfiler.GetPassName(ids[i]) : CPUProfiler::Get().GetZoneName(ids[i]);
+        double mean = gpu ? gGPUProfiler.GetPassMean(ids[i]) : CPUProfiler::Get().GetZoneMean(ids[i]);
+        if(mean < 0.0){
+            snprintf(text, sizeof(text), " %s -", name.c_str());
         }else{
-            gPolygonMode = GL_FILL;
-            std::cout << "Mode: GL_FILL" << std::endl;
+            snprintf(text, sizeof(text), " %s %.2f", name.c_str(), mean);
+        }
+        x = gHUD.Text(x, y, text, HUD_WHITE);
+    }
+    return x;
+}
+
+/**
+* Lays out the performance overlay: frame rate and frame-time graph, the
+* rolling mean of every frame-loop zone and render pass, draw calls, the
+* input latency and the score. Text is formatted into stack buffers, so
+* building it does not allocate.
+*
+* @return void
+*/
+void BuildHUD(){
+    const float left = 8.0f;
+    float y = 8.0f;
+    char text[96];
+    gHUD.Begin();
+    gHUD.Box(0.0f, 0.0f, (float)gScreenWidth, 10*HUD_LINE_HEIGHT + 72.0f, HUD_PANEL);
+
+    double frame = CPUProfiler::Get().GetZoneMean(gFrameZone);
+    snprintf(text, sizeof(text), "FPS %.1f  FRAME %.2f MS", (frame > 0.0) ? 1000.0/frame : 0.0, frame);
+    gHUD.Text(left, y, text, HUD_WHITE);
+    y += HUD_LINE_HEIGHT;
+    // Full height at 33 ms, the line at a 60 Hz frame
+    gHUD.FrameGraph(left, y, 240.0f, 60.0f, 1000.0/30.0, 1000.0/60.0);
+    y += 64.0f;
+
+    const int loopZones[] = {gInputZone, gSimulateZone, gBuildZone, gHUDZone};
+    const int renderZones[] = {gPreDrawZone, gDrawZone, gSwapZone};
+    const int passes[] = {gClearPass, gBackgroundPass, gCharacterPass, gSkyPass, gGhostPass, gParticlePass, gHUDPass};
+    HUDTimings(left, y, "CPU", loopZones, sizeof(loopZones)/sizeof(loopZones[0]), false);
+    y += HUD_LINE_HEIGHT;
+    HUDTimings(left + 4*HUD_CHARACTER_WIDTH, y, "", renderZones, sizeof(renderZones)/sizeof(renderZones[0]), false);
+    y += HUD_LINE_HEIGHT;
+    HUDTimings(left, y, "GPU", passes, 3, true);
+    y += HUD_LINE_HEIGHT;
+    HUDTimings(left + 4*HUD_CHARACTER_WIDTH, y, "", passes + 3, 4, true);
+    y += HUD_LINE_HEIGHT;
+
+    // The sky's and the overlay's own draw calls count too
+    snprintf(text, sizeof(text), "DRAWS %d  INSTANCES %d  OVERLAY QUADS %d",
+             (int)gSceneDrawCalls + (gSky.IsReady() ? 2 : 1), (int)gSceneBatch.GetInstanceCount(), (int)gHUD.GetQuadCount());
+    float x = gHUD.Text(left, y, text, HUD_WHITE);
+    if(gDynamicResolution){
+        snprintf(text, sizeof(text), "  SCENE %dX%d", gResolution.GetWidth(), gResolution.GetHeight());
+        gHUD.Text(x, y, text, HUD_YELLOW);
+    }
+    y += HUD_LINE_HEIGHT;
+
+    // CPU memory of each tag now and at its peak, three tags a line
+    for(int line = 0; line < 2; ++line){
+        x = gHUD.Text(left, y, line == 0 ? "MEM MB" : "      ", HUD_YELLOW);
+        for(int i = line*3; i < line*3 + 3 && i < MEMORY_TAGS; ++i){
+            MemoryTag tag = (MemoryTag)i;
+            snprintf(text, sizeof(text), "  %s %.1f/%.1f", MemoryTags::GetName(tag), MemoryTags::GetCurrent(tag)/1048576.0,
+                     MemoryTags::GetPeak(tag)/1048576.0);
+            x = gHUD.Text(x, y, text, HUD_WHITE);
+        }
+        y += HUD_LINE_HEIGHT;
+    }
+
+    // Percentiles of the recent presses, "-" before the first one
+    x = gHUD.Text(left, y, "LATENCY", HUD_YELLOW);
+    if(gInputLatency.GetSwapCount() == 0){
+        gHUD.Text(x, y, " -", HUD_WHITE);
+    }else{
+        snprintf(text, sizeof(text), " P50 %.1f  P99 %.1f MS", gInputLatency.GetSwapPercentile(50.0),
+                 gInputLatency.GetSwapPercentile(99.0));
+        x = gHUD.Text(x, y, text, HUD_WHITE);
+        if(gInputLatency.GetGPUCount() > 0){
+            snprintf(text, sizeof(text), "  GPU DONE P50 %.1f  P99 %.1f", gInputLatency.GetGPUPercentile(50.0),
+                     gInputLatency.GetGPUPercentile(99.0));
+            gHUD.Text(x, y, text, HUD_WHITE);
         }
     }
+    y += HUD_LINE_HEIGHT;
+
+    snprintf(text, sizeof(text), "SCORE %d", gCurrentState.tick);
+    x = gHUD.Text(left, y, text, HUD_WHITE);
+    if(gCurrentState.gameOver){
+        gHUD.Text(x, y, "  GAME OVER - PRESS R", HUD_RED);
+    }else if(gBenchmark.IsRunning()){
+        gHUD.Text(x, y, "  BENCHMARK", HUD_YELLOW);
+    }else if(gStress.IsRunning()){
+        snprintf(text, sizeof(text), "  STRESS %d", (int)gStress.GetEntityCount());
+        gHUD.Text(x, y, text, HUD_YELLOW);
+    }else if(gReplaying){
+        gHUD.Text(x, y, "  REPLAY", HUD_YELLOW);
+    }else if(gDebug){
+        gHUD.Text(x, y, "  DEBUG", HUD_YELLOW);
+    }
+}
+
+// Registers the CPU zones. Startup zones run once and keep that one sample.
+void AddProfileZones(){
+    CPUProfiler& profiler = CPUProfiler::Get();
+    gInputZone               = profiler.AddZone("input");
+    gSimulateZone            = profiler.AddZone("simulate");
+    gBuildZone               = profiler.AddZone("build");
+    gPreDrawZone             = profiler.AddZone("predraw");
+    gDrawZone                = profiler.AddZone("draw");
+    gSwapZone                = profiler.AddZone("swap");
+    gLatencyZone             = profiler.AddZone("latency");
+    gFrameZone               = profiler.AddZone("frame");
+    gVertexSpecificationZone = profiler.AddZone("vertex specification");
+    gPipelineZone            = profiler.AddZone("graphics pipeline");
+    gHUDZone                 = profiler.AddZone("hud");
+    gSDLInitZone             = profiler.AddZone("sdl init");
+    gWindowZone              = profiler.AddZone("window");
+    gContextZone             = profiler.AddZone("gl context");
+    gLoaderZone              = profiler.AddZone("gl loader");
+    gLoadingZone             = profiler.AddZone("loading");
+    gRendererSetupZone       = profiler.AddZone("renderer setup");
 }
 
+/**
+* Prints how long each startup step took, the rest of the startup that no
+* step covers, the first frame and the time from the start of main() until
+* the first frame was handed to the window (its swap returned).
+*
+* @return void
+*/
+void ReportStartup(Uint64 mainLoopStart, Uint64 firstFrameEnd){
+    const CPUProfiler& profiler = CPUProfiler::Get();
+    const double millisecondsPerCount = 1000.0/(double)SDL_GetPerformanceFrequency();
+    const int steps[] = {gSDLInitZone, gWindowZone, gContextZone, gLoaderZone, gPipelineZone,
+                         gRendererSetupZone, gLoadingZone, gVertexSpecificationZone};
+    double loading = (mainLoopStart - gStartCounter)*millisecondsPerCount;
+    double accounted = 0.0;
+    std::cout << "Startup (ms):\n";
+    for(int step : steps){
+        double milliseconds = std::max(0.0, profiler.GetZoneMean(step));
+        accounted += milliseconds;
+        std::cout << "  " << profiler.GetZoneName(step) << " " << milliseconds << "\n";
+    }
+    std::cout << "  other " << std::max(0.0, loading - accounted) << "\n";
+    std::cout << "  first frame " << (firstFrameEnd - mainLoopStart)*millisecondsPerCount << "\n";
+    std::cout << "  time to first frame " << (firstFrameEnd - gStartCounter)*millisecondsPerCount << "\n";
+    if(ProgramCache::Get().IsEnabled()){
+        std::cout << "  shader programs: " << ProgramCache::Get().GetHitCount() << " from the cache, "
+                  << ProgramCache::Get().GetStoreCount() << " compiled and cached\n";
+    }
+}
 
 /**
 * Main Application Loop
 * This is an infinite loop in our graphics application
+* Every displayed frame runs the stages input -> simulate -> build draw
+* list -> render -> present exactly once. The simulation advances in fixed
+* SIM_STEP_SECONDS steps and frames are drawn interpolated between the
+* last two steps, so game speed does not depend on the frame rate.
+*
+* @return void
+*/
+/**
+* Sleeps on the game over screen, or while the game is paused, until an
+* event arrives, leaving it queued for Input(). File changes and streaming assets are looked at
+* every IDLE_WAIT_MS meanwhile (IDLE_STREAMING_WAIT_MS while assets are
+* still uploading), and whatever they change is drawn.
 *
 * @return void
 */
+void WaitWhileIdle(){
+    JobSystem::Get().RunMainThreadJobs();
+    // The last screenshot is still written while nothing is drawn
+    gScreenshots.Collect();
+    if(gWatcher.Poll() > 0){
+        gIdleRedraw = true;
+    }
+    if(!gAssets.IsIdle()){
+        if(gAssets.Update(ASSET_UPLOAD_BUDGET) > 0){
+            gIdleRedraw = true;
+        }
+    }
+    if(gIdleRedraw){
+        return;
+    }
+    SDL_WaitEventTimeout(nullptr, gAssets.IsIdle() ? IDLE_WAIT_MS : IDLE_STREAMING_WAIT_MS);
+}
+
 void MainLoop(){
 
     // Little trick to map mouse to center of screen always.
     // Useful for handling 'mouselook'
     // This works because we effectively 're-center' our mouse at the start
     // of every frame prior to detecting any mouse motion.
-    SDL_WarpMouseInWindow(gGraphicsApplicationWindow,gScreenWidth/2,gScreenHeight/2);
-    SDL_SetRelativeMouseMode(SDL_TRUE);
+    if(!gHeadless){
+        SDL_WarpMouseInWindow(gGraphicsApplicationWindow,gScreenWidth/2,gScreenHeight/2);
+        SDL_SetRelativeMouseMode(SDL_TRUE);
+    }
 
+    const double secondsPerCount = 1.0/(double)SDL_GetPerformanceFrequency();
+    int framesSinceReport = 0;
+    gInputLatency.Initialize(SDL_GetPerformanceFrequency());
+
+    // Real time not yet consumed by simulation steps
+    double accumulator = 0.0;
+    Uint64 lastFrame = SDL_GetPerformanceCounter();
+    const Uint64 mainLoopStart = lastFrame;
+    bool firstFrame = true;
+    SnapRenderState();
+
+    // Deadline of the next frame in SWAP_CAPPED mode
+    const Uint64 capPeriod = SDL_GetPerformanceFrequency() / (Uint64)gFrameCap;
+    Uint64 nextFrame = lastFrame + capPeriod;
+
+    // Replays and benchmark runs step in lockstep with their frames
+    const bool live = !gReplaying && !gBenchmark.IsRunning() && !gStress.IsRunning();
+    const bool threaded = gSimulationThread && live;
+    if(live){
+        SDL_AddEventWatch(QueueJumpPress, nullptr);
+    }
+    if(threaded){
+        StartSimulationThread();
+    }
+    // The frame that first shows the game over screen is drawn
+    bool wasGameOver = false;
 
 	// While application is running
 	while(!gQuit){
-        Input();
-        if (!gameOver) {
-                    // 2. Setup our geometry
-    VertexSpecification();
+        Uint64 frameStart = SDL_GetPerformanceCounter();
+        gFrameArena.Reset();
+        if(gLowLatency){
+            ProfileZone zone(gLatencyZone);
+            // The GPU catches up first, then a capped frame sleeps until
+            // just its expected cost before it is due
+            gLatency.WaitForGPU();
+            gInputLatency.Completed(SDL_GetPerformanceCounter());
+            if(gSwapMode == SWAP_CAPPED){
+                Uint64 lead = (Uint64)(gLatency.GetPredictedCost()*0.001*(double)SDL_GetPerformanceFrequency());
+                LimitFrameRate(nextFrame, capPeriod, std::min(lead, capPeriod));
+            }
+        }
+        // Simulated time runs from input sample to input sample
+        const Uint64 inputStart = gLowLatency ? SDL_GetPerformanceCounter() : frameStart;
+        double frameSeconds = (inputStart - lastFrame)*secondsPerCount;
+        lastFrame = inputStart;
+        {
+            ProfileZone zone(gInputZone);
+            Input();
+        }
+        // How far the frame is between the two states it is drawn from
+        float alpha = 1.0f;
+        if(threaded){
+            ProfileZone zone(gSimulateZone);
+            alpha = AcquireSimulationSnapshot(SDL_GetPerformanceCounter());
+        }
+        // The game over screen, and a paused game, are drawn once and then
+        // only when they change; a window that cannot be seen not at all
+        const bool paused = gPaused.load(std::memory_order_relaxed);
+        const bool idle = (gCurrentState.gameOver && !gRestartPending && !gReplaying && !StepsWhileOver()) || paused;
+        if(idle){
+            accumulator = 0.0;
+            // Presses that do not restart change nothing the timing sees
+            gInputLatency.Drop();
+            if(gWindowHidden || (!gIdleRedraw && gCurrentState.gameOver == wasGameOver)){
+                WaitWhileIdle();
+                // Nothing else runs while waiting, but the input zones still add up
+                CPUProfiler::Get().Collect();
+                AllocationCounter::Get().EndFrame();
+                // The wait is not time the next game has to catch up on
+                lastFrame = SDL_GetPerformanceCounter();
+                continue;
+            }
+            gIdleRedraw = false;
+        }
+        wasGameOver = gCurrentState.gameOver;
 
-	// 3. Create our graphics pipeline
-	// 	- At a minimum, this means the vertex and fragment shader
-	CreateGraphicsPipeline();
-		// Setup anything (i.e. OpenGL State) that needs to take
-		// place before draw calls
-		PreDraw();
-		// Draw Calls in OpenGL
+        // Main game loop here
+        // Run as many fixed steps as real time has passed, independent of
+        // how fast frames are rendered. Replays run a fixed number of steps
+        // per frame instead, as fast as frames can be drawn.
+        if(!threaded && !idle){
+            ProfileZone zone(gSimulateZone);
+            if(gBenchmark.IsRunning()){
+                Uint64 stepStart = SDL_GetPerformanceCounter();
+                RunSimulationStep();
+                gBenchmark.AddSimulation((SDL_GetPerformanceCounter() - stepStart)*secondsPerCount*1000.0, 1);
+            }else if(gStress.IsRunning()){
+                // Every level sees the same game, whatever its frame rate
+                RunSimulationStep();
+            }else if(gReplaying){
+                for(int step = 0; step < gReplayStepsPerFrame && !gQuit; ++step){
+                    RunSimulationStep();
+                }
+            }else{
+                accumulator += std::min(frameSeconds, MAX_FRAME_SECONDS);
+                while(accumulator >= SIM_STEP_SECONDS && (!gGame.gameOver || gRestartPending || StepsWhileOver())){
+                    RunSimulationStep();
+                    accumulator -= SIM_STEP_SECONDS;
+                }
+                alpha = (float)(accumulator/SIM_STEP_SECONDS);
+            }
+        }
+        PlaySoundsForSteps();
+        {
+            ProfileZone zone(gBuildZone);
+            if(gBenchmark.IsRunning()){
+                glm::vec3 eye;
+                glm::vec3 direction;
+                gBenchmark.GetCameraPose(eye, direction);
+                gCamera.SetCameraEyePosition(eye.x, eye.y, eye.z);
+                gCamera.SetViewDirection(direction.x, direction.y, direction.z);
+            }
+            if(gRunAhead > 0 && live && !gCurrentState.gameOver){
+                // Drawn from the future, then put back for the real steps
+                RenderState previous = gPreviousState;
+                RenderState current = gCurrentState;
+                RunAhead(threaded ? gSnapshotGame : gGame);
+                BuildDrawList(alpha);
+                gPreviousState = previous;
+                gCurrentState = current;
+            }else{
+                BuildDrawList(alpha);
+            }
+        }
+        if(gHUD.IsVisible()){
+            ProfileZone zone(gHUDZone);
+            BuildHUD();
+        }
+        // Jump presses go straight to the simulation thread's queue; the
+        // other events wait in SDL's for the next Input()
+        if(threaded){
+            SDL_PumpEvents();
+        }
+
+        // Setup anything (i.e. OpenGL State) that needs to take
+        // place before draw calls, then submit the draw list once.
         // When we 'draw' in OpenGL, this activates the graphics pipeline.
         // i.e. when we use glDrawElements or glDrawArrays,
         //      The pipeline that is utilized is whatever 'glUseProgram' is
         //      currently binded.
-		Draw();
-
-		//Update screen of our specified window
-		SDL_GL_SwapWindow(gGraphicsApplicationWindow);
-
-        // Main game loop here
-        tick = tick + 1;
-        ++dayTick;
-
-        if(dayTick == 1000) {
-            std::cout << "Time of day changed!" << std::endl;
-            dayTick = 0;
-            isDaytime = !isDaytime;
-            cactusSpeed += 2;
-            jumpingSpeed += 2;
+        gGPUProfiler.BeginFrame();
+        if(gBenchmark.IsRunning() && gGPUProfiler.GetCollectedFrameTime() >= 0.0){
+            gBenchmark.AddGPUFrame(gGPUProfiler.GetCollectedFrameTime());
         }
-
-        g.cactusPosition = g.cactusPosition - cactusSpeed;
-
-
-        if (g.cactusPosition <= -(cactusStart * 2)) {
-            cactusStart = rand() % 500 + 400;
-            cactusSpeed = rand() % cactusSpeed + 6;
-            g.cactusPosition = cactusStart;
+        if(gStress.IsRunning() && gGPUProfiler.GetCollectedFrameTime() >= 0.0){
+            gStress.AddGPUFrame(gGPUProfiler.GetCollectedFrameTime());
         }
-
-        // Jump logic
-        if (isJumping) {
-            if (jumpingUp) {
-                g.currentDinoHeight = g.currentDinoHeight + jumpingSpeed;
-                if (g.currentDinoHeight >= 152) {
-                    jumpingUp = false;
-                }
-            } else {
-                g.currentDinoHeight = g.currentDinoHeight - jumpingSpeed;
-                if (g.currentDinoHeight <= 0) {
-                    jumpingUp = true;
-                    isJumping = false;
-                }
+        if(gDynamicResolution){
+            gResolution.Update(gGPUProfiler.GetCollectedFrameTime());
+        }
+        {
+            ProfileZone zone(gPreDrawZone);
+            // GL work the jobs handed back
+            JobSystem::Get().RunMainThreadJobs();
+            // Edited files queue their rebuilds here
+            gWatcher.Poll();
+            // Whatever is still streaming in, within the frame's budget
+            if(!gAssets.IsIdle()){
+                gAssets.Update(ASSET_UPLOAD_BUDGET);
             }
+            gTextureCache.Update();
             PreDraw();
+        }
+        {
+            ProfileZone zone(gDrawZone);
             Draw();
+            // The finished frame, overlay included, as the window shows it
+            gCapture.Capture((double)SDL_GetPerformanceCounter()*secondsPerCount);
+            gScreenshots.Collect();
+            gScreenshots.Capture(gScreenWidth, gScreenHeight);
+        }
+
+        if(threaded){
+            SDL_PumpEvents();
+        }
+        //Update screen of our specified window
+        Uint64 swapStart = SDL_GetPerformanceCounter();
+        {
+            ProfileZone zone(gSwapZone);
+            PresentFrame();
+        }
+        gInputLatency.Presented(SDL_GetPerformanceCounter());
+        if(gLowLatency){
+            gLatency.EndFrame((SDL_GetPerformanceCounter() - inputStart)*secondsPerCount*1000.0);
+        }
+        gGPUProfiler.EndFrame();
+        // Streamed textures not bound this frame go if the GPU is over budget
+        gResidency.EndFrame(GPUResourceTracker::Get().GetTotalBytes());
+        if(gSwapMode == SWAP_CAPPED && !gLowLatency){
+            LimitFrameRate(nextFrame, capPeriod, 0);
+        }
+        // The whole frame, waiting for the frame cap included
+        Uint64 frameEnd = SDL_GetPerformanceCounter();
+        CPUProfiler::Get().Record(gFrameZone, frameStart, frameEnd);
+        gHUD.AddFrameTime((frameEnd - frameStart)*secondsPerCount*1000.0);
+        Telemetry::Get().AddFrame((frameEnd - frameStart)*secondsPerCount*1000.0);
+        double cpuJoules = 0.0;
+        double gpuJoules = 0.0;
+        if(gEnergy.IsOpen()){
+            gEnergy.Sample(cpuJoules, gpuJoules);
+        }
+        if(gBenchmark.IsRunning()){
+            gBenchmark.AddFrame((frameEnd - frameStart)*secondsPerCount*1000.0,
+                                (swapStart - frameStart)*secondsPerCount*1000.0);
+            if(gEnergy.IsOpen()){
+                gBenchmark.AddEnergy(cpuJoules, gpuJoules);
+            }
+            for(int i = 0; i < gInputLatency.GetPresentedCount(); ++i){
+                gBenchmark.AddInputLatency(gInputLatency.GetPresented(i));
+            }
+            if(gBenchmark.IsFinished()){
+                gBenchmark.Report();
+                gQuit = true;
+            }
+        }
+        if(gStress.IsRunning()){
+            gStress.AddFrame((frameEnd - frameStart)*secondsPerCount*1000.0,
+                             (swapStart - frameStart)*secondsPerCount*1000.0,
+                             gSceneBatch.GetInstanceCount(), gStressCollisions);
+            if(gEnergy.IsOpen()){
+                gStress.AddEnergy(cpuJoules + gpuJoules);
+            }
+            if(gStress.IsFinished()){
+                gStress.Report();
+                gQuit = true;
+            }
+        }
+
+        CPUProfiler::Get().Collect();
+        if(firstFrame){
+            gBenchmark.SetFirstFrameTime((frameEnd - gStartCounter)*secondsPerCount*1000.0);
+            ReportStartup(mainLoopStart, frameEnd);
+            firstFrame = false;
         }
-        // Collision logic
-        if (g.currentDinoHeight < 75 && g.cactusPosition <= -100 && g.cactusPosition >= -150 && !gDebug) {
-            gameOver = true;
-            std::cout << "Game over! You scored " << tick << " points\n" << "Press \'r\' to restart" << std::endl;
+        gTrace.EndFrame();
+        AllocationCounter::Get().EndFrame();
+        gFlight.EndFrame(frameStart, frameEnd, AllocationCounter::Get().GetFrameAllocations(),
+                         AllocationCounter::Get().GetFrameBytes());
+        if(gMetrics.IsRunning()){
+            PublishMetrics(frameEnd);
         }
+        if(gInspector.IsOpen()){
+            PublishInspector(frameStart, frameEnd);
+        }
+        if(++framesSinceReport == PROFILE_REPORT_FRAMES){
+            ReportProfiling();
+            framesSinceReport = 0;
         }
 	}
+    StopSimulationThread();
+    if(live){
+        SDL_DelEventWatch(QueueJumpPress, nullptr);
+    }
 }
 
 
@@ -772,16 +4834,58 @@ void MainLoop(){
 * @return void
 */
 void CleanUp(){
-	//Destroy our SDL2 Window
-	SDL_DestroyWindow(gGraphicsApplicationWindow );
-	gGraphicsApplicationWindow = nullptr;
-
-    // Delete our OpenGL Objects
-    glDeleteBuffers(1, &gVertexBufferObjectFloor);
-    glDeleteVertexArrays(1, &gVertexArrayObjectFloor);
+    gMetrics.Stop();
+    gInspector.Release();
+    // Screenshots and hitch traces still in flight are written first, by
+    // the jobs
+    gScreenshots.Release();
+    gFlight.Release();
+    // No upload may run once the objects are gone
+    gWatcher.Stop();
+    gAssets.Stop();
+    JobSystem::Get().Stop();
+    // The workers draw the scene's mesh and textures, they go first
+    StopRenderWorkers();
+    // Delete our OpenGL Objects while the context is still alive
+    gSceneBatch.Release();
+    gImpostorBatch.Release();
+    gImpostorBaker.Release();
+    gFrameUniforms.Release();
+    gSkinBuffer.Release();
+    gPalette.Release();
+    gMeshRegistry.Release();
+    gSceneTextures.Release();
+    gTextureCache.Clear();
+    // The textures were the last views of files read ahead
+    FileReader::Get().Stop();
+    gGPUProfiler.Release();
+    gObserver.Release();
+    gAtlas.Release();
+    gResolution.Release();
+    gLatency.Release();
+    gHUD.Release();
+    gParticles.Release();
+    gInstanceCuller.Release();
+    gSky.SetPanorama(nullptr);
+    gPanorama.Release();
+    gSky.Release();
 
 	// Delete our Graphics pipeline
-    glDeleteProgram(gGraphicsPipelineShaderProgram);
+    gSceneVariants.Release();
+    gShaderProgram = nullptr;
+    // Everything the engine created should be gone by now
+    GPUResourceTracker::Get().ReportLeaks();
+
+	//Destroy our SDL2 Window, or the headless context
+	if(gHeadless){
+		gHeadlessContext.Destroy();
+	}else{
+		SDL_DestroyWindow(gGraphicsApplicationWindow );
+		gGraphicsApplicationWindow = nullptr;
+	}
+
+    // The audio thread stops before SDL does
+    gAudio.Close();
 
 	//Quit SDL subsystems
 	SDL_Quit();
@@ -794,20 +4898,335 @@ void CleanUp(){
 * @return program status
 */
 int main( int argc, char* args[] ){
+    gStartCounter = SDL_GetPerformanceCounter();
     std::cout << "Use T to activate debug mode (collision off, below commands activated)\n";
     std::cout << "Use wasd keys to move forward and back, left and right\n";
     std::cout << "Use mouse to pan the camera\n";
     std::cout << "Use Tab to toggle wireframe\n";
+    std::cout << "Use H to toggle the performance overlay\n";
     std::cout << "Press ESC to quit\n";
+    std::cout << "Start with --vsync, --adaptive, --uncapped or --cap=<hz> to choose frame pacing\n";
+    std::cout << "Start with --seed=<n> to replay a particular obstacle sequence\n";
+    std::cout << "Start with --record=<file> to log your input, --replay=<file> [--replay-every=<n>] [--replay-from=<step>] to play it back\n";
+    std::cout << "Start with --observe=84x84 [--observe-color] [--observe-supersample=<k>] [--observe-maxpool] [--offscreen] to render pixel observations\n";
+    std::cout << "Start with --headless[=<device>] to render on a GPU without a window or display, through EGL\n";
+    std::cout << "Start with --observe-envs=<n> [--render-workers=<k>] to render n environments at the --observe size in one atlas, split over k more threads\n";
+    std::cout << "Start with --gpu-sim-check=<n> to step n environments on the GPU and the CPU, compare them and quit\n";
+    std::cout << "Start with --trace=<file> [--trace-frames=<n>] to write a Chrome trace of startup and the first frames\n";
+    std::cout << "Start with --alloc-budget=<n> to warn about frames making more than n heap allocations\n";
+    std::cout << "Start with --hitch-budget=<ms> [--hitch-seconds=<s>] [--hitch-dir=<dir>] to write a trace of the last seconds whenever a frame takes longer\n";
+    std::cout << "Start with --pack=<file> to read the assets from another pack, --no-pack for the loose files\n";
+    std::cout << "Start with --panorama=<file.ppm> to scroll a wide binary PPM behind the dunes, streamed in tiles\n";
+    std::cout << "Start with --hot-reload to rebuild shaders, meshes and textures when their files change\n";
+    std::cout << "Start with --tier=<low|medium|high> to pick the quality tier, --probe to measure this machine again, --no-tier for the defaults\n";
+    std::cout << "Start with --vram-budget=<MB> to keep streamed textures within what the GPU has, evicting the least recently used\n";
+    std::cout << "Start with --impostor-distance=<units> to set where obstacles turn into billboards, 0 to keep their meshes\n";
+    std::cout << "Start with --run-ahead=<k> to draw the game k steps ahead of the simulation, up to " << MAX_RUN_AHEAD << "\n";
+    std::cout << "Start with --jobs=<n> to run jobs (asset parsing, culling) on n threads instead of one per core\n";
+    std::cout << "Start with --affinity=<compact|scatter> [--exclude-cores=<list>] [--pin-main] to pin the job threads to cores\n";
+    std::cout << "Start with --shader-cache=<dir> to keep linked shaders elsewhere, --no-shader-cache to always compile them\n";
+    std::cout << "Start with --gl-debug (or --gl-debug=sync) to report OpenGL errors through a debug context\n";
+    std::cout << "Start with --gl-no-error to have the driver skip validating GL calls (KHR_no_error)\n";
+    std::cout << "Start with --no-dsa to edit GL objects by binding them even where direct state access exists\n";
+    std::cout << "Start with --no-bindless to bind the scene textures even where bindless textures exist\n";
+    std::cout << "Start with --no-io-uring to read asset files with jobs instead of io_uring, --direct-io to bypass the page cache\n";
+    std::cout << "Start with --benchmark=<frames> to time a scripted run of that many frames and quit\n";
+    std::cout << "  with --benchmark-out=<file>, --benchmark-baseline=<file> and --benchmark-tolerance=[<metric>=]<percent> to gate regressions\n";
+    std::cout << "Start with --stress=<n> to time frames against up to n moving cacti and ghost dinos\n";
+    std::cout << "Start with --ghosts=<file>[,<file>...] to race translucent ghosts replayed from recorded logs\n";
+    std::cout << "Start with --versus=<host>:<port> [--versus-port=<port>] [--input-delay=<steps>] to race the kiosk at host\n";
+    std::cout << "Start with --bots=<library>[:<options>] for demo mode, a policy library playing every player\n";
+    std::cout << "Start with --split-screen=<n> to race 2 to 4 players on this machine, jumping with space, Q, P and return\n";
+    std::cout << "Start with --spectator-port=<port> [--spectator-rate=<hz>] to stream the game to spectators, --spectate=<host>:<port> to watch one\n";
+    std::cout << "Start with --metrics-port=<port> to serve Prometheus metrics at http://<host>:<port>/metrics\n";
+    std::cout << "Start with --inspect[=<name>] to publish the game's internals to ./dinoinspect through shared memory\n";
+    std::cout << "Start with --capture=<file.y4m or file.mp4> [--capture-fps=<n>] to record a video of the window\n";
+    std::cout << "Start with --screenshot-dir=<dir> to save the screenshots F12 takes there\n";
+    std::cout << "Start with --gameplay-log=<file> to append jumps, deaths and session lengths to a binary log\n";
+    std::cout << "Start with --no-audio to run silent, --audio-buffer=<frames> to mix more or fewer frames per callback\n";
+    std::cout << "Start with --stats to print episodes, scores, collisions, step rate and frame times on quitting\n";
+
+    ParseArguments(argc, args);
+    JobSystem::Get().Start(gJobThreads, gAffinity);
+    if(gHotReload && !gPackPath.empty()){
+        // The pack would shadow the files being edited
+        gPackPath.clear();
+    }
+    if(gPackPath == DEFAULT_PACK_PATH && AssetPack::Get().OpenEmbedded()){
+        std::cout << "Reading " << AssetPack::Get().GetEntryCount() << " assets built into the executable\n";
+    }else if(!gPackPath.empty() && AssetPack::Get().Open(gPackPath)){
+        std::cout << "Reading " << AssetPack::Get().GetEntryCount() << " assets from " << gPackPath << "\n";
+    }
+    if(FileReader::Get().Start(gFileReads)){
+        std::cout << "Reading loose asset files through io_uring\n";
+    }
+    if(gStressEntities > 0){
+        if(gBenchmarkFrames > 0 || !gReplayPath.empty() || !gRecordPath.empty()){
+            std::cout << "--stress ignores --benchmark, --record and --replay\n";
+            gBenchmarkFrames = 0;
+            gReplayPath.clear();
+            gRecordPath.clear();
+        }
+        gSwapMode = SWAP_UNCAPPED;
+        gStress.Begin(gStressEntities);
+        std::cout << "Stress testing up to " << gStressEntities << " entities with seed " << gSeed << "\n";
+    }
+    if(gBenchmarkFrames > 0){
+        if(!gReplayPath.empty() || !gRecordPath.empty()){
+            std::cout << "--benchmark ignores --record and --replay\n";
+            gReplayPath.clear();
+            gRecordPath.clear();
+        }
+        gSwapMode = SWAP_UNCAPPED;
+        gBenchmark.Begin(gBenchmarkFrames);
+        std::cout << "Benchmarking " << gBenchmarkFrames << " frames with seed " << gSeed << "\n";
+    }
+    if(gBenchmark.IsRunning() || gStress.IsRunning()){
+        if(gEnergy.Open()){
+            std::cout << "Measuring energy with:\n" << gEnergy.Describe();
+        }else{
+            std::cout << "No readable power counters, energy is not measured (RAPL's energy_uj may need root)\n";
+        }
+    }
+    if(!gReplayPath.empty()){
+        if(!gInputLog.Load(gReplayPath)){
+            exit(1);
+        }
+        gReplaying = true;
+        gSeed = gInputLog.GetSeed();
+        std::cout << "Replaying " << gInputLog.GetStepCount() << " steps from " << gReplayPath << "\n";
+    }else if(!gRecordPath.empty()){
+        gInputLog.Begin(gSeed);
+    }
+    ResetGameState(gGame, gSeed, gGamesPlayed);
+    for(LocalPlayer& other : gOtherPlayers){
+        ResetGameState(other.game, gSeed, gGamesPlayed);
+    }
+    ResetTrack();
+    if(gReplaying && gReplayFrom > 0){
+        // Logs saved without keyframes get them here
+        gInputLog.BuildKeyframes();
+        size_t simulated = gInputLog.Seek(gReplayFrom, gGame, gGamesPlayed);
+        gReplayStep = std::min(gReplayFrom, gInputLog.GetStepCount());
+        std::cout << "Starting the replay at step " << gReplayStep << ", " << simulated << " steps past its keyframe\n";
+    }
+    if(!gGameplayLogPath.empty() && GameplayLog::Get().Open(gGameplayLogPath)){
+        GameplayLog::Get().Add(GAMEPLAY_RUN_START, (uint32_t)gGamesPlayed, 0, (int32_t)gSeed);
+    }
+    if(!gGhostPaths.empty() && gGhosts.Load(gGhostPaths) > 0){
+        std::cout << "Racing " << gGhosts.GetCount() << " ghosts\n";
+    }
+    if(!gSpectatePeer.empty()){
+        std::string host;
+        int port = 0;
+        if(gReplaying || gBenchmark.IsRunning() || gStress.IsRunning()){
+            std::cout << "--spectate cannot be combined with a replay, benchmark or stress run\n";
+        }else if(!ParseHostPort(gSpectatePeer, host, port)){
+            std::cout << "Invalid kiosk " << gSpectatePeer << ", expected --spectate=<host>:<port>\n";
+        }else if(gSpectating.Start(host, port)){
+            std::cout << "Watching the kiosk at " << gSpectatePeer << "\n";
+            // What arrives is drawn as it is; there is no game here to
+            // race or to run ahead of
+            gVersusPeer.clear();
+            gRunAhead = 0;
+        }
+    }
+    if(!gInspectName.empty() && gInspector.Create(gInspectName)){
+        std::cout << "Publishing to the inspector at " << gInspectName << "\n";
+    }
+    if(gMetricsPort > 0){
+        gMetrics.SetAssetLoader(&gAssets);
+        if(gMetrics.Start(gMetricsPort, gOffscreen)){
+            std::cout << "Serving metrics on port " << gMetrics.GetPort() << "\n";
+        }
+    }
+    if(gSpectatorPort > 0 && gSpectators.Start(gSpectatorPort, (int)(1.0/(SIM_STEP_SECONDS*gSpectatorRate) + 0.5))){
+        std::cout << "Streaming to spectators on port " << gSpectatorPort << " at " << gSpectatorRate << " Hz\n";
+    }
+    if(!gVersusPeer.empty()){
+        std::string host;
+        int port = 0;
+        if(gReplaying || gBenchmark.IsRunning() || gStress.IsRunning()){
+            std::cout << "--versus needs a game being played, not a replay, benchmark or stress run\n";
+            gVersusPeer.clear();
+        }else if(!ParseHostPort(gVersusPeer, host, port)){
+            std::cout << "Invalid opponent " << gVersusPeer << ", expected --versus=<host>:<port>\n";
+            gVersusPeer.clear();
+        }else if(!gVersus.Start(gVersusPort, host, port, gSeed, gInputDelay)){
+            gVersusPeer.clear();
+        }else{
+            std::cout << "Waiting on port " << gVersusPort << " for the opponent at " << gVersusPeer
+                      << ", seed " << gSeed << ", input delay " << gInputDelay << " steps\n";
+        }
+    }
+    if(gLocalPlayers > 1 && (gReplaying || gBenchmark.IsRunning() || gStress.IsRunning() || gVersus.IsActive() ||
+                             gSpectating.IsRunning() || gObserving || gRunAhead > 0)){
+        std::cout << "--split-screen needs players at this machine, not a replay, benchmark, stress run, race, "
+                     "watched kiosk, observation or run-ahead\n";
+        gLocalPlayers = 1;
+    }else if(gLocalPlayers > 1){
+        std::cout << "Split screen for " << gLocalPlayers << " players, jumping with space, Q, P and return\n";
+    }
+    if(!gBotsSpec.empty()){
+        if(gReplaying || gBenchmark.IsRunning() || gStress.IsRunning() || gVersus.IsActive() || gSpectating.IsRunning()){
+            std::cout << "--bots ignored: a replay, benchmark, stress run, race or watched kiosk plays itself\n";
+        }else if(gBots.LoadSpec(gBotsSpec, (uint32_t)BOT_ROW_SIZE)){
+            std::cout << "Demo mode: " << gBotsSpec << " plays " << gLocalPlayers << " player(s)\n";
+        }
+    }
+    gSceneViewCount = gLocalPlayers;
+
+    AddProfileZones();
+    if(!gTracePath.empty()){
+        gTrace.Begin(gTracePath, gTraceFrames);
+        CPUProfiler::Get().SetTrace(&gTrace);
+    }
+    if(gHitchBudgetMilliseconds > 0.0){
+        gFlight.Initialize(gHitchSeconds, gHitchBudgetMilliseconds, gHitchDirectory);
+        CPUProfiler::Get().SetFlightRecorder(&gFlight);
+    }
 
 	// 1. Setup the graphics program
 	InitializeProgram();
+	InitializeAudio();
+	if(gGPUSimulationCheckEnvs > 0){
+		// The check is the whole run
+		bool equal = RunGPUSimulationCheck();
+		CleanUp();
+		return equal ? 0 : 1;
+	}
+
+	// The tier decides how detailed the textures loaded next are
+	SelectPerformanceTier();
+
+	// 2. Start loading our geometry and textures in the background
+	QueueSceneAssets();
+
+	// 3. Create our graphics pipeline
+	// 	- At a minimum, this means the vertex and fragment shader
+	{
+		ProfileZone zone(gPipelineZone);
+		CreateGraphicsPipeline();
+	}
+	{
+		ProfileZone zone(gRendererSetupZone);
+		InitializeProfiling();
+		if(!gHUD.Initialize("./shaders/hud_vert.glsl", "./shaders/hud_frag.glsl")){
+			gHUD.SetVisible(false);
+		}
+		// Without its shaders the game runs without dust
+		gParticles.Initialize("./shaders/particle_update.glsl", "./shaders/particle_vert.glsl", "./shaders/particle_frag.glsl");
+		// Without its shaders the clear color shows behind the dunes
+		gSky.Initialize("./shaders/sky_vert.glsl", "./shaders/sky_frag.glsl");
+		// Without it the sky repeats its layer
+		if(!gPanoramaPath.empty() && gSky.IsReady() && gPanorama.Initialize(gPanoramaPath)){
+			gSky.SetPanorama(&gPanorama);
+		}
+		// The atlas takes over from the single observation
+		if(gObserveEnvCount > 0){
+			gObserving = false;
+			// With workers this context keeps an equal share, the first
+			gRenderWorkerCount = std::min(gRenderWorkerCount, gObserveEnvCount - 1);
+			size_t mainCount = gObserveEnvCount / (gRenderWorkerCount + 1);
+			if(gAtlas.Initialize(mainCount, gObserveWidth, gObserveHeight, gObserveGrayscale,
+			                     "./shaders/atlas_vert.glsl", "./shaders/frag.glsl")){
+				gObserveEnvs.Resize(gObserveEnvCount);
+				gObserveEnvs.ResetAll(gSeed);
+				gObserveNextStream = gObserveEnvCount;
+				if(gRenderWorkerCount > 0 && !StartRenderWorkers(mainCount)){
+					// This context draws them all after all
+					gAtlas.Initialize(gObserveEnvCount, gObserveWidth, gObserveHeight, gObserveGrayscale,
+					                  "./shaders/atlas_vert.glsl", "./shaders/frag.glsl");
+				}
+			}
+		}
+		if(gObserving && !gObserver.Initialize(gObserveWidth, gObserveHeight, gObserveGrayscale, gObserveSupersample,
+		                                       gObserveMaxPool, "./shaders/observe_reduce_vert.glsl",
+		                                       "./shaders/observe_reduce_frag.glsl")){
+			gObserving = false;
+		}
+		gDynamicResolution = gDynamicResolution && !gObserving &&
+		                     gResolution.Initialize(gScreenWidth, gScreenHeight, gMinResolutionScale, gGPUBudgetMilliseconds,
+		                                            gMaxResolutionScale);
+	}
+	{
+		ProfileZone zone(gLoadingZone);
+		gQuit = !LoadingScreen();
+	}
+	if(!gQuit){
+		ProfileZone zone(gVertexSpecificationZone);
+		VertexSpecification();
+		WarmUpPipelines();
+	}
+	if(!gQuit && gHotReload){
+		WatchSceneAssets();
+	}
+	if(!gQuit && !gCapturePath.empty()){
+		if(gOffscreen){
+			std::cout << "--capture records the window, there is none with --offscreen\n";
+		}else if(gCapture.Begin(gCapturePath, gScreenWidth, gScreenHeight, gCaptureFps)){
+			std::cout << "Capturing " << gScreenWidth << "x" << gScreenHeight << " at " << gCaptureFps << " fps to " << gCapturePath << "\n";
+		}
+	}
 	
 	// 4. Call the main application loop
+	gBenchmark.SetLoadTime((SDL_GetPerformanceCounter() - gStartCounter)*1000.0/(double)SDL_GetPerformanceFrequency());
 	MainLoop();	
+	// What the loop logged comes before the summaries printed below
+	Logger::Get().Flush();
+
+	// A benchmark that regressed, or was cut short, fails the run
+	int status = 0;
+	if(gBenchmark.IsRunning()){
+		if(!gBenchmark.IsFinished()){
+			std::cout << "Benchmark stopped before it finished\n";
+			status = 1;
+		}else{
+			if(!gBenchmarkOutPath.empty() && !gBenchmark.WriteResults(gBenchmarkOutPath)){
+				status = 1;
+			}
+			if(!gBenchmarkBaselinePath.empty() && !gBenchmark.Compare(gBenchmarkBaselinePath)){
+				status = 1;
+			}
+		}
+	}
+	if(!gRecordPath.empty() && !gReplaying && gInputLog.Save(gRecordPath)){
+		std::cout << "Recorded " << gInputLog.GetStepCount() << " steps to " << gRecordPath << "\n";
+	}
+	gCapture.End();
+	if(GameplayLog::Get().IsOpen()){
+		TelemetrySnapshot snapshot = Telemetry::Get().Snapshot();
+		uint64_t frames = 0;
+		for(uint64_t count : snapshot.frames){
+			frames += count;
+		}
+		GameplayLog::Get().Add(GAMEPLAY_SESSION_END, (uint32_t)gGamesPlayed, gGame.tick,
+		                       (int32_t)(gGamesPlayed + 1), (int32_t)frames);
+		GameplayLog::Get().Close();
+		std::cout << "Logged " << GameplayLog::Get().GetWrittenCount() << " gameplay records to " << gGameplayLogPath << "\n";
+	}
+	if(gPrintStats){
+		std::cout << "Stats: " << Telemetry::Get().Snapshot().Format() << "\n";
+		if(gFlight.IsRecording()){
+			std::cout << gFlight.GetHitchCount() << " frames over the " << gHitchBudgetMilliseconds
+			          << " ms hitch budget, " << gFlight.GetDumpCount() << " traces written\n";
+		}
+		if(gSpectators.IsRunning() && gSpectators.GetTicks() > 0){
+			std::cout << "Streamed " << gSpectators.GetTicks() << " steps to " << gSpectators.GetViewerCount()
+			          << " spectators, " << gSpectators.GetBytesSent() << " bytes sent\n";
+		}
+		if(gSpectating.IsRunning()){
+			std::cout << "Watched " << gSpectating.GetDecodedTicks() << " steps, " << gSpectating.GetLostTicks()
+			          << " lost, " << gSpectating.GetBytesReceived() << " bytes received\n";
+		}
+	}
+	if(gTrace.IsOpen()){
+		CPUProfiler::Get().Collect();
+		gTrace.Write();
+	}
 
 	// 5. Call the cleanup function when our program terminates
 	CleanUp();
 
-	return 0;
+	return status;
 }
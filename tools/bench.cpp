@@ -0,0 +1,780 @@
+/* Microbenchmarks of the asset loaders, the mesh build and the simulation.
+ Build with: python3 build.py bench
+ Run with:   ./bench [--filter=<text>] [--min-time=<seconds>] [--out=<file.json>]
+                     [--corpus=<dir>] [--corpus-full] [--threads=<n,n,...>]
+ Every benchmark runs a warm-up pass and then repeats until it has run
+ for at least --min-time (0.5 s by default) and 5 times. The inputs are
+ fixed (the files in common/objects, fixed seeds), so two runs on the same
+ machine measure the same work. Results are printed as JSON, one entry
+ per benchmark with the per-run min, median and mean in nanoseconds and
+ the items processed per second, to stdout or to --out.
+
+ --corpus=<dir> adds the scaling benchmarks, over synthetic assets far
+ larger than the game's: grid meshes of 10k, 100k and 1M triangles, each
+ with positions only (v), with texture coordinates (vt) and with normals
+ too (vtvn), and P3 and P6 images of 1K, 4K and 8K (P3 up to 4K). They are
+ generated into dir the first time, the same bytes on every machine, and
+ reused after that. --corpus-full adds 10M triangle meshes and the 8K P3
+ image, several GB between them. The OBJ loads run once per --threads
+ count (1, 2, 4, ... up to every hardware thread by default); the .dmesh
+ cooking, streaming and loading and the PPM loads run on one thread
+ only, which they are. Their JSON entries carry a series, a size and a
+ thread count to plot, and a table of the rates per size and thread
+ count goes to stderr at the end.
+*/
+#include "GameState.hpp"
+#include "GameStateBatch.hpp"
+#include "Image.hpp"
+#include "JobSystem.hpp"
+#include "MeshFile.hpp"
+#include "ObjLoader.hpp"
+#include "VertexFormat.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Where the assets are, relative to the repository root
+const char* OBJECTS_DIRECTORY = "./common/objects";
+// Steps per run of the simulation benchmarks
+const int SCALAR_STEPS = 200000;
+const size_t BATCH_ENVIRONMENTS = 1024;
+const int BATCH_STEPS = 200;
+// Fewest timed runs of every benchmark
+const int MIN_RUNS = 5;
+// Triangles of the generated meshes; the last only with --corpus-full
+const size_t CORPUS_TRIANGLES[] = {10000, 100000, 1000000, 10000000};
+const size_t CORPUS_FULL_TRIANGLES = 10000000;
+// Largest mesh cooked whole, with levels of detail and the reordering;
+// every size is also cooked the streaming way
+const size_t CORPUS_MAX_COOKED = 1000000;
+
+// A generated mesh's attributes: positions, then texture coordinates,
+// then normals
+enum CorpusAttributes{
+    CORPUS_V,
+    CORPUS_VT,
+    CORPUS_VTVN
+};
+const char* CORPUS_ATTRIBUTE_NAMES[] = {"v", "vt", "vtvn"};
+
+struct CorpusImage{
+    const char* name;
+    int width;
+    int height;
+};
+const CorpusImage CORPUS_IMAGES[] = {{"1k", 1024, 1024}, {"4k", 3840, 2160}, {"8k", 7680, 4320}};
+// P3 stores about four times the bytes of P6; its 8K image needs --corpus-full
+const int CORPUS_P3_IMAGES = 2;
+
+struct Benchmark{
+    std::string name;
+    // Items one run processes (bytes, triangles, steps), for the rate
+    double items;
+    std::string itemName;
+    std::function<void()> run;
+    // Run before the warm-up and after the last run, untimed, for inputs
+    // too large to keep for the whole program
+    std::function<void()> setUp;
+    std::function<void()> tearDown;
+    // For the scaling benchmarks: the curve it is a point of, the size of
+    // its input and its thread count (0 if it has none to choose)
+    std::string series;
+    double size = 0.0;
+    unsigned int threads = 0;
+};
+
+struct Result{
+    std::string name;
+    int runs;
+    double minNs;
+    double medianNs;
+    double meanNs;
+    double itemsPerSecond;
+    std::string itemName;
+    std::string series;
+    double size;
+    unsigned int threads;
+};
+
+// Keeps the optimizer from dropping work whose result is never used
+static volatile uint64_t gSink = 0;
+
+static Result Measure(const Benchmark& benchmark, double minSeconds){
+    typedef std::chrono::steady_clock Clock;
+    if(benchmark.setUp){
+        benchmark.setUp();
+    }
+    benchmark.run();
+    std::vector<double> times;
+    double total = 0.0;
+    while((int)times.size() < MIN_RUNS || total < minSeconds){
+        Clock::time_point start = Clock::now();
+        benchmark.run();
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        times.push_back(seconds);
+        total += seconds;
+    }
+    if(benchmark.tearDown){
+        benchmark.tearDown();
+    }
+    std::vector<double> sorted = times;
+    std::sort(sorted.begin(), sorted.end());
+    Result result;
+    result.name = benchmark.name;
+    result.runs = (int)times.size();
+    result.minNs = sorted.front() * 1e9;
+    result.medianNs = sorted[sorted.size() / 2] * 1e9;
+    result.meanNs = total / times.size() * 1e9;
+    result.itemsPerSecond = (sorted[sorted.size() / 2] > 0.0) ? benchmark.items / sorted[sorted.size() / 2] : 0.0;
+    result.itemName = benchmark.itemName;
+    result.series = benchmark.series;
+    result.size = benchmark.size;
+    result.threads = benchmark.threads;
+    return result;
+}
+
+// Files in OBJECTS_DIRECTORY with the extension, sorted so the order is fixed
+static std::vector<std::string> ListObjects(const std::string& extension){
+    std::vector<std::string> paths;
+    std::error_code error;
+    for(const auto& entry : std::filesystem::directory_iterator(OBJECTS_DIRECTORY, error)){
+        if(entry.is_regular_file() && entry.path().extension() == extension){
+            paths.push_back(entry.path().generic_string());
+        }
+    }
+    std::sort(paths.begin(), paths.end());
+    return paths;
+}
+
+static std::string FileName(const std::string& path){
+    return std::filesystem::path(path).filename().string();
+}
+
+// The headless game at one step per tick, jumping whenever the lead
+// obstacle gets close and restarting after every game over, stepped by
+// Rules (see RuntimeGameRules in GameState.hpp)
+template<typename Rules>
+static void RunScalarGames(){
+    GameState state;
+    ResetGameState(state, 1, 0);
+    uint64_t games = 0;
+    for(int step = 0; step < SCALAR_STEPS; ++step){
+        int lead = GetLeadObstacle(state.obstacles, state.scroll);
+        GameAction action = (lead < 100) ? ACTION_JUMP : ACTION_NONE;
+        if(Step<Rules>(state, action) & EVENT_GAME_OVER){
+            ResetGameState(state, 1, ++games);
+        }
+    }
+    gSink = gSink + HashGameState(state);
+}
+
+template<typename Rules>
+static void RunBatchGames(){
+    static GameStateBatch environments;
+    static std::vector<GameAction> actions(BATCH_ENVIRONMENTS);
+    environments.Resize(BATCH_ENVIRONMENTS);
+    environments.ResetAll(1);
+    for(int step = 0; step < BATCH_STEPS; ++step){
+        const int* leads = environments.GetLeadObstacles();
+        const int* gameOver = environments.GetGameOverMasks();
+        for(size_t i = 0; i < BATCH_ENVIRONMENTS; ++i){
+            if(gameOver[i]){
+                environments.Reset(i, 1, i + BATCH_ENVIRONMENTS*(size_t)step);
+            }
+            actions[i] = (leads[i] < 100) ? ACTION_JUMP : ACTION_NONE;
+        }
+        environments.Step<Rules>(actions.data());
+    }
+    gSink = gSink + (uint64_t)environments.GetTicks()[0];
+}
+
+// The same games with the rules read at run time and fixed at compile
+// time, the _fixed entries
+static void AddSimulationBenchmarks(std::vector<Benchmark>& benchmarks){
+    Benchmark scalar;
+    scalar.name = "step/scalar";
+    scalar.items = SCALAR_STEPS;
+    scalar.itemName = "steps";
+    scalar.run = RunScalarGames<RuntimeGameRules>;
+    benchmarks.push_back(scalar);
+    scalar.name = "step/scalar_fixed";
+    scalar.run = RunScalarGames<ShippedGameRules>;
+    benchmarks.push_back(scalar);
+
+    Benchmark batch;
+    batch.name = std::string("step/batch_") + GameStateBatch::GetInstructionSet();
+    batch.items = (double)BATCH_ENVIRONMENTS * BATCH_STEPS;
+    batch.itemName = "steps";
+    batch.run = RunBatchGames<RuntimeGameRules>;
+    benchmarks.push_back(batch);
+    batch.name += "_fixed";
+    batch.run = RunBatchGames<ShippedGameRules>;
+    benchmarks.push_back(batch);
+}
+
+static void AddAssetBenchmarks(std::vector<Benchmark>& benchmarks){
+    for(const std::string& path : ListObjects(".obj")){
+        std::error_code error;
+        double bytes = (double)std::filesystem::file_size(path, error);
+        ObjLoader loaded(path, 0);
+        double triangles = (double)loaded.getTriangles().size();
+
+        Benchmark parse;
+        parse.name = "obj_parse/" + FileName(path);
+        parse.items = bytes;
+        parse.itemName = "bytes";
+        parse.run = [path](){
+            ObjLoader loader(path, 0);
+            gSink = gSink + (uint64_t)loader.getVertices().size();
+        };
+        benchmarks.push_back(parse);
+
+        // Shared between the runs, so only the conversion is timed
+        std::shared_ptr<ObjLoader> loader = std::make_shared<ObjLoader>(path, 0);
+
+        Benchmark unindexed;
+        unindexed.name = "obj_triangles/" + FileName(path);
+        unindexed.items = triangles;
+        unindexed.itemName = "triangles";
+        unindexed.run = [loader](){
+            // Reads the cached triangles in place; nothing is copied
+            float sum = 0.0f;
+            for(const Triangle& triangle : loader->getTriangles()){
+                sum += triangle.vertices[0].x;
+            }
+            gSink = gSink + (uint64_t)sum;
+        };
+        benchmarks.push_back(unindexed);
+
+        // What the game uploads: the deduplicated stream, packed for the GPU
+        Benchmark build;
+        build.name = "mesh_build/" + FileName(path);
+        build.items = triangles;
+        build.itemName = "triangles";
+        build.run = [loader](){
+            std::vector<float> stream;
+            std::vector<uint32_t> indices;
+            std::vector<PackedVertex> packed;
+            loader->getIndexedMesh(stream, indices);
+            PackVertices(stream.data(), stream.size() / FLOATS_PER_VERTEX, packed);
+            gSink = gSink + (uint64_t)packed.size() + indices.size();
+        };
+        benchmarks.push_back(build);
+    }
+
+    for(const std::string& path : ListObjects(".ppm")){
+        std::error_code error;
+        Benchmark load;
+        load.name = "ppm_load/" + FileName(path);
+        load.items = (double)std::filesystem::file_size(path, error);
+        load.itemName = "bytes";
+        load.run = [path](){
+            Image image(path);
+            image.LoadPPM(true);
+            gSink = gSink + (uint64_t)image.GetWidth();
+        };
+        benchmarks.push_back(load);
+    }
+}
+
+// Appends text to a file through a buffer, so writing a corpus file of
+// hundreds of MB takes seconds rather than a call per number
+class CorpusWriter{
+public:
+    explicit CorpusWriter(FILE* file) : m_file(file){
+        m_buffer.reserve(BUFFER_BYTES + 256);
+    }
+    ~CorpusWriter(){
+        Flush();
+    }
+    void Append(const char* format, ...) __attribute__((format(printf, 2, 3))){
+        char line[256];
+        va_list arguments;
+        va_start(arguments, format);
+        int length = vsnprintf(line, sizeof(line), format, arguments);
+        va_end(arguments);
+        m_buffer.append(line, (size_t)std::min<int>(std::max(length, 0), (int)sizeof(line) - 1));
+        if(m_buffer.size() >= BUFFER_BYTES){
+            Flush();
+        }
+    }
+    void Flush(){
+        if(!m_buffer.empty() && fwrite(m_buffer.data(), 1, m_buffer.size(), m_file) != m_buffer.size()){
+            m_failed = true;
+        }
+        m_buffer.clear();
+    }
+    inline bool Failed() const{
+        return m_failed;
+    }
+private:
+    static const size_t BUFFER_BYTES = 1 << 20;
+    FILE* m_file;
+    std::string m_buffer;
+    bool m_failed{false};
+};
+
+// Quads along each side of a grid of about triangles triangles
+static void GridSize(size_t triangles, size_t& columns, size_t& rows){
+    columns = std::max<size_t>(1, (size_t)std::sqrt((double)triangles / 2.0));
+    rows = std::max<size_t>(1, triangles / 2 / columns);
+}
+
+// Height of the generated terrain at (x, z), two crossed waves, and its
+// slopes along x and z
+static float GridHeight(float x, float z, float& slopeX, float& slopeZ){
+    slopeX = 0.37f * 0.5f * std::cos(x * 0.37f) * std::cos(z * 0.23f);
+    slopeZ = -0.23f * 0.5f * std::sin(x * 0.37f) * std::sin(z * 0.23f);
+    return 0.5f * std::sin(x * 0.37f) * std::cos(z * 0.23f);
+}
+
+// Writes to path + ".tmp" and renames it, so an interrupted run leaves no
+// truncated file behind to be benchmarked next time
+static bool WriteCorpusFile(const std::string& path, const std::function<bool(FILE*)>& write){
+    std::string temporary = path + ".tmp";
+    FILE* file = fopen(temporary.c_str(), "wb");
+    if(file == nullptr){
+        std::cerr << "Could not create " << temporary << "\n";
+        return false;
+    }
+    std::cerr << "Generating " << path << "...\n";
+    bool written = write(file);
+    written = (fclose(file) == 0) && written;
+    std::error_code error;
+    if(written){
+        std::filesystem::rename(temporary, path, error);
+    }
+    if(!written || error){
+        std::cerr << "Could not write " << path << "\n";
+        std::filesystem::remove(temporary, error);
+        return false;
+    }
+    return true;
+}
+
+// A terrain of columns x rows quads, two triangles each, one unit apart
+static bool WriteGridObj(FILE* file, size_t columns, size_t rows, CorpusAttributes attributes){
+    CorpusWriter out(file);
+    out.Append("# %zux%zu quad grid generated by bench\n", columns, rows);
+    for(size_t j = 0; j <= rows; ++j){
+        for(size_t i = 0; i <= columns; ++i){
+            float slopeX, slopeZ;
+            float height = GridHeight((float)i, (float)j, slopeX, slopeZ);
+            out.Append("v %.4f %.4f %.4f\n", (float)i, height, (float)j);
+        }
+    }
+    if(attributes != CORPUS_V){
+        for(size_t j = 0; j <= rows; ++j){
+            for(size_t i = 0; i <= columns; ++i){
+                out.Append("vt %.5f %.5f\n", (float)i / columns, (float)j / rows);
+            }
+        }
+    }
+    if(attributes == CORPUS_VTVN){
+        for(size_t j = 0; j <= rows; ++j){
+            for(size_t i = 0; i <= columns; ++i){
+                float slopeX, slopeZ;
+                GridHeight((float)i, (float)j, slopeX, slopeZ);
+                float scale = 1.0f / std::sqrt(slopeX*slopeX + 1.0f + slopeZ*slopeZ);
+                out.Append("vn %.4f %.4f %.4f\n", -slopeX * scale, scale, -slopeZ * scale);
+            }
+        }
+    }
+    // Counter-clockwise seen from above; texture coordinates and normals
+    // are numbered like the positions
+    for(size_t j = 0; j < rows; ++j){
+        for(size_t i = 0; i < columns; ++i){
+            size_t a = j*(columns + 1) + i + 1;
+            size_t b = a + 1;
+            size_t c = a + columns + 1;
+            size_t d = c + 1;
+            if(attributes == CORPUS_V){
+                out.Append("f %zu %zu %zu\nf %zu %zu %zu\n", a, c, b, b, c, d);
+            }else if(attributes == CORPUS_VT){
+                out.Append("f %zu/%zu %zu/%zu %zu/%zu\nf %zu/%zu %zu/%zu %zu/%zu\n", a, a, c, c, b, b, b, b, c, c, d, d);
+            }else{
+                out.Append("f %zu/%zu/%zu %zu/%zu/%zu %zu/%zu/%zu\nf %zu/%zu/%zu %zu/%zu/%zu %zu/%zu/%zu\n",
+                           a, a, a, c, c, c, b, b, b, b, b, b, c, c, c, d, d, d);
+            }
+        }
+    }
+    out.Flush();
+    return !out.Failed();
+}
+
+// The generated image's pixel: gradients with a hashed grain on top, so
+// no two rows are alike
+static void CorpusPixel(int x, int y, int width, int height, uint8_t* rgb){
+    uint32_t hash = (uint32_t)x * 0x9e3779b1u ^ (uint32_t)y * 0x85ebca77u;
+    hash ^= hash >> 15;
+    rgb[0] = (uint8_t)(x * 255 / width);
+    rgb[1] = (uint8_t)(y * 255 / height);
+    rgb[2] = (uint8_t)(hash & 0xff);
+}
+
+static bool WritePPM(FILE* file, int width, int height, bool binary){
+    CorpusWriter out(file);
+    out.Append("%s\n%d %d\n255\n", binary ? "P6" : "P3", width, height);
+    std::vector<uint8_t> row((size_t)width * 3);
+    for(int y = 0; y < height; ++y){
+        for(int x = 0; x < width; ++x){
+            CorpusPixel(x, y, width, height, &row[(size_t)x * 3]);
+        }
+        if(binary){
+            out.Flush();
+            if(fwrite(row.data(), 1, row.size(), file) != row.size()){
+                return false;
+            }
+            continue;
+        }
+        for(int x = 0; x < width; ++x){
+            out.Append("%d %d %d\n", row[x*3], row[x*3 + 1], row[x*3 + 2]);
+        }
+    }
+    out.Flush();
+    return !out.Failed();
+}
+
+// Writes the file at path unless an earlier run did
+static bool EnsureCorpusFile(const std::string& path, const std::function<bool(FILE*)>& write){
+    std::error_code error;
+    if(std::filesystem::is_regular_file(path, error)){
+        return true;
+    }
+    return WriteCorpusFile(path, write);
+}
+
+// "10k", "1m"
+static std::string CountName(size_t count){
+    if(count >= 1000000){
+        return std::to_string(count / 1000000) + "m";
+    }
+    return std::to_string(count / 1000) + "k";
+}
+
+// The thread counts to load with: 1, 2, 4, ... and every hardware thread
+static std::vector<unsigned int> DefaultThreadCounts(){
+    unsigned int hardware = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<unsigned int> counts;
+    for(unsigned int threads = 1; threads < hardware; threads *= 2){
+        counts.push_back(threads);
+    }
+    counts.push_back(hardware);
+    return counts;
+}
+
+// The loaders against the size of their input, over the corpus in
+// directory; the OBJ loads also against the thread count
+static bool AddCorpusBenchmarks(std::vector<Benchmark>& benchmarks, const std::string& directory, bool full,
+                                const std::vector<unsigned int>& threadCounts){
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    // The loader splits the file over the job system's threads; the
+    // thread count only lowers how many of them it takes
+    JobSystem::Get().Start();
+
+    for(size_t nominal : CORPUS_TRIANGLES){
+        if(nominal == CORPUS_FULL_TRIANGLES && !full){
+            continue;
+        }
+        size_t columns, rows;
+        GridSize(nominal, columns, rows);
+        double triangles = (double)(columns * rows * 2);
+        for(int attributes = CORPUS_V; attributes <= CORPUS_VTVN; ++attributes){
+            const std::string variant = CORPUS_ATTRIBUTE_NAMES[attributes];
+            const std::string name = "grid_" + CountName(nominal) + "_" + variant + ".obj";
+            const std::string path = directory + "/" + name;
+            bool generated = EnsureCorpusFile(path, [columns, rows, attributes](FILE* file){
+                return WriteGridObj(file, columns, rows, (CorpusAttributes)attributes);
+            });
+            if(!generated){
+                return false;
+            }
+
+            for(unsigned int threads : threadCounts){
+                Benchmark parse;
+                parse.name = "corpus_obj_parse/" + name + "/threads_" + std::to_string(threads);
+                parse.items = triangles;
+                parse.itemName = "triangles";
+                parse.series = "corpus_obj_parse/" + variant;
+                parse.size = triangles;
+                parse.threads = threads;
+                parse.run = [path, threads](){
+                    ObjLoader::setParseThreads(threads);
+                    ObjLoader loader(path, 0);
+                    ObjLoader::setParseThreads(0);
+                    gSink = gSink + (uint64_t)loader.getTriangles().size();
+                };
+                benchmarks.push_back(parse);
+            }
+
+            // The cooker as dmeshconv runs it: levels of detail and the
+            // reordering, from a mesh loaded before the timing starts
+            if(nominal <= CORPUS_MAX_COOKED){
+                std::shared_ptr<std::unique_ptr<ObjLoader>> loaded = std::make_shared<std::unique_ptr<ObjLoader>>();
+                Benchmark cook;
+                cook.name = "corpus_dmesh_cook/" + name;
+                cook.items = triangles;
+                cook.itemName = "triangles";
+                cook.series = "corpus_dmesh_cook/" + variant;
+                cook.size = triangles;
+                cook.setUp = [loaded, path](){
+                    loaded->reset(new ObjLoader(path, 0));
+                };
+                cook.tearDown = [loaded](){
+                    loaded->reset();
+                };
+                cook.run = [loaded](){
+                    std::vector<char> bytes = MeshFile::EncodeFromObj(**loaded);
+                    gSink = gSink + (uint64_t)bytes.size();
+                };
+                benchmarks.push_back(cook);
+            }
+
+            // The bounded memory cooker, file to file, and then loading
+            // what it wrote
+            const std::string dmeshPath = directory + "/" + name + ".dmesh";
+            Benchmark stream;
+            stream.name = "corpus_dmesh_stream/" + name;
+            stream.items = triangles;
+            stream.itemName = "triangles";
+            stream.series = "corpus_dmesh_stream/" + variant;
+            stream.size = triangles;
+            stream.run = [path, dmeshPath](){
+                ObjStreamResult result;
+                MeshFile::WriteFromObjStream(path, dmeshPath, OBJ_STREAM_CACHE_ENTRIES, &result);
+                gSink = gSink + result.triangleCount;
+            };
+            benchmarks.push_back(stream);
+
+            Benchmark load;
+            load.name = "corpus_dmesh_load/" + name;
+            load.items = triangles;
+            load.itemName = "triangles";
+            load.series = "corpus_dmesh_load/" + variant;
+            load.size = triangles;
+            load.setUp = [path, dmeshPath](){
+                std::error_code missing;
+                if(!std::filesystem::is_regular_file(dmeshPath, missing)){
+                    MeshFile::WriteFromObjStream(path, dmeshPath, OBJ_STREAM_CACHE_ENTRIES);
+                }
+            };
+            load.run = [dmeshPath](){
+                // Mapping alone reads nothing; the sum touches every index
+                // page, as the upload would
+                MeshFile mesh;
+                uint64_t sum = 0;
+                if(mesh.Load(dmeshPath)){
+                    const uint32_t* indices = mesh.GetIndexData();
+                    for(uint32_t i = 0; i < mesh.GetIndexCount(); ++i){
+                        sum += indices[i];
+                    }
+                }
+                gSink = gSink + sum;
+            };
+            benchmarks.push_back(load);
+        }
+    }
+
+    for(int binary = 0; binary <= 1; ++binary){
+        int imageCount = binary ? (int)(sizeof(CORPUS_IMAGES) / sizeof(CORPUS_IMAGES[0])) : CORPUS_P3_IMAGES;
+        if(full){
+            imageCount = (int)(sizeof(CORPUS_IMAGES) / sizeof(CORPUS_IMAGES[0]));
+        }
+        for(int i = 0; i < imageCount; ++i){
+            const CorpusImage image = CORPUS_IMAGES[i];
+            const std::string format = binary ? "p6" : "p3";
+            const std::string path = directory + "/noise_" + image.name + "_" + format + ".ppm";
+            bool generated = EnsureCorpusFile(path, [image, binary](FILE* file){
+                return WritePPM(file, image.width, image.height, binary != 0);
+            });
+            if(!generated){
+                return false;
+            }
+            Benchmark load;
+            load.name = "corpus_ppm_load/" + FileName(path);
+            load.items = (double)image.width * image.height;
+            load.itemName = "pixels";
+            load.series = "corpus_ppm_load/" + format;
+            load.size = load.items;
+            load.run = [path](){
+                Image loaded(path);
+                loaded.LoadPPM(true);
+                gSink = gSink + (uint64_t)loaded.GetWidth();
+            };
+            benchmarks.push_back(load);
+        }
+    }
+    return true;
+}
+
+static void WriteJSONString(std::ostream& out, const std::string& text){
+    out << '"';
+    for(char c : text){
+        if(c == '"' || c == '\\'){
+            out << '\\';
+        }
+        out << c;
+    }
+    out << '"';
+}
+
+static void WriteResults(std::ostream& out, const std::vector<Result>& results){
+    out << "{\n  \"benchmarks\": [\n";
+    for(size_t i = 0; i < results.size(); ++i){
+        const Result& result = results[i];
+        out << "    {\"name\": ";
+        WriteJSONString(out, result.name);
+        out << ", \"runs\": " << result.runs
+            << ", \"min_ns\": " << (uint64_t)result.minNs
+            << ", \"median_ns\": " << (uint64_t)result.medianNs
+            << ", \"mean_ns\": " << (uint64_t)result.meanNs
+            << ", \"" << result.itemName << "_per_second\": " << (uint64_t)result.itemsPerSecond;
+        if(!result.series.empty()){
+            out << ", \"series\": ";
+            WriteJSONString(out, result.series);
+            out << ", \"size\": " << (uint64_t)result.size << ", \"threads\": " << result.threads;
+        }
+        out << "}" << ((i + 1 < results.size()) ? ",\n" : "\n");
+    }
+    out << "  ]\n}\n";
+}
+
+// Every series as a table of its rates in millions of items per second,
+// a row per size and a column per thread count, so the scaling reads
+// off the terminal without plotting the JSON
+static void PrintScaling(std::ostream& out, const std::vector<Result>& results){
+    std::map<std::string, std::map<double, std::map<unsigned int, double>>> series;
+    std::map<std::string, std::string> itemNames;
+    for(const Result& result : results){
+        if(!result.series.empty()){
+            series[result.series][result.size][result.threads] = result.itemsPerSecond;
+            itemNames[result.series] = result.itemName;
+        }
+    }
+    for(const auto& curve : series){
+        std::vector<unsigned int> threadCounts;
+        for(const auto& row : curve.second){
+            for(const auto& point : row.second){
+                if(std::find(threadCounts.begin(), threadCounts.end(), point.first) == threadCounts.end()){
+                    threadCounts.push_back(point.first);
+                }
+            }
+        }
+        std::sort(threadCounts.begin(), threadCounts.end());
+        char line[64];
+        out << "\n" << curve.first << ", M" << itemNames[curve.first] << "/s\n";
+        snprintf(line, sizeof(line), "%12s", "size");
+        out << line;
+        for(unsigned int threads : threadCounts){
+            // Single threaded loaders have the one column
+            std::string heading = threads ? std::to_string(threads) + " thr" : "rate";
+            snprintf(line, sizeof(line), "%13s", heading.c_str());
+            out << line;
+        }
+        out << "\n";
+        for(const auto& row : curve.second){
+            snprintf(line, sizeof(line), "%12llu", (unsigned long long)row.first);
+            out << line;
+            for(unsigned int threads : threadCounts){
+                auto point = row.second.find(threads);
+                if(point == row.second.end()){
+                    snprintf(line, sizeof(line), "%13s", "-");
+                }else{
+                    snprintf(line, sizeof(line), "%13.2f", point->second / 1e6);
+                }
+                out << line;
+            }
+            out << "\n";
+        }
+    }
+}
+
+int main(int argc, char* argv[]){
+    std::string filter;
+    std::string outPath;
+    std::string corpus;
+    bool corpusFull = false;
+    std::vector<unsigned int> threadCounts = DefaultThreadCounts();
+    double minSeconds = 0.5;
+    bool usage = false;
+    for(int i = 1; i < argc; ++i){
+        std::string argument = argv[i];
+        if(argument.compare(0, 9, "--filter=") == 0){
+            filter = argument.substr(9);
+        }else if(argument.compare(0, 11, "--min-time=") == 0){
+            minSeconds = atof(argument.c_str() + 11);
+        }else if(argument.compare(0, 6, "--out=") == 0){
+            outPath = argument.substr(6);
+        }else if(argument.compare(0, 9, "--corpus=") == 0){
+            corpus = argument.substr(9);
+            usage = usage || corpus.empty();
+        }else if(argument == "--corpus-full"){
+            corpusFull = true;
+        }else if(argument.compare(0, 10, "--threads=") == 0){
+            threadCounts.clear();
+            std::stringstream list(argument.substr(10));
+            std::string count;
+            while(std::getline(list, count, ',')){
+                int threads = atoi(count.c_str());
+                usage = usage || threads < 1;
+                threadCounts.push_back((unsigned int)std::max(threads, 1));
+            }
+            usage = usage || threadCounts.empty();
+        }else{
+            usage = true;
+        }
+    }
+    if(usage){
+        std::cout << "Usage: bench [--filter=<text>] [--min-time=<seconds>] [--out=<file.json>]\n"
+                  << "             [--corpus=<dir>] [--corpus-full] [--threads=<n,n,...>]\n";
+        return 1;
+    }
+
+    std::vector<Benchmark> benchmarks;
+    AddAssetBenchmarks(benchmarks);
+    AddSimulationBenchmarks(benchmarks);
+    if(benchmarks.size() <= 2){
+        std::cerr << "No assets found in " << OBJECTS_DIRECTORY << ", run from the repository root\n";
+    }
+    if(!corpus.empty() && !AddCorpusBenchmarks(benchmarks, corpus, corpusFull, threadCounts)){
+        return 1;
+    }
+
+    // Progress goes to stderr so stdout stays valid JSON
+    std::vector<Result> results;
+    for(const Benchmark& benchmark : benchmarks){
+        if(!filter.empty() && benchmark.name.find(filter) == std::string::npos){
+            continue;
+        }
+        std::cerr << benchmark.name << "...\n";
+        results.push_back(Measure(benchmark, minSeconds));
+    }
+    PrintScaling(std::cerr, results);
+
+    if(outPath.empty()){
+        WriteResults(std::cout, results);
+        return 0;
+    }
+    std::ofstream file(outPath.c_str(), std::ios::trunc);
+    if(!file.is_open()){
+        std::cout << "Could not open " << outPath << "\n";
+        return 1;
+    }
+    WriteResults(file, results);
+    return 0;
+}
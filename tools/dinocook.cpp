@@ -0,0 +1,409 @@
+/* Incremental asset cooker: every source asset to what the game loads.
+ Build with: python3 build.py dinocook
+ Run with:   ./dinocook [--force] [--cache=dinocook.cache]
+ Run it from the repository root. Cooks, in parallel on every core:
+   each .obj in common/objects to its .dmesh (see MeshFile.hpp), with
+   levels of detail and the vertex cache reordering, as dmeshconv does;
+   each .ppm there to its .bc1.ktx with the full mip chain, as texconv
+   does, the palette excepted, which is a lookup table read texel for
+   texel (see PaletteTexture.hpp) that BC1 would blend;
+   both scene shaders to every variant of their features, preprocessed
+   (see ShaderPreprocessor.hpp), as shaders/cooked/<name>.<mask>.<stage>.glsl:
+   the exact text each variant compiles, for offline validation and
+   diffing. The game still preprocesses its own at load, so that hot
+   reloading follows the sources.
+ An output is skipped when the content hash of every file it was cooked
+ from and the cooker's version are what the cache recorded for it last
+ time, and the output is still there. The files an output depends on
+ are the ones its last cook read, the .mtl of an .obj and the includes
+ of a shader too, so an edit to any of them cooks it again. --force
+ cooks everything.
+*/
+#include "BC1Encoder.hpp"
+#include "Image.hpp"
+#include "JobSystem.hpp"
+#include "KTXFile.hpp"
+#include "MeshFile.hpp"
+#include "ObjLoader.hpp"
+#include "ShaderPreprocessor.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Bump whenever a cooker writes something else for the same input, so
+// that every output is cooked again
+const uint32_t DINOCOOK_VERSION = 1;
+
+// The shaders with variants and their features, bit i of a mask
+// defining the i-th, as CreateGraphicsPipeline() in main.cpp names them
+struct ShaderSet{
+    const char* name;
+    const char* vertexPath;
+    const char* fragmentPath;
+    std::vector<std::string> features;
+};
+
+enum CookKind{
+    COOK_MESH,
+    COOK_TEXTURE,
+    COOK_SHADER
+};
+
+struct CookTask{
+    CookKind kind;
+    std::string source;
+    std::string output;
+    // The defines of a shader variant
+    std::vector<std::string> defines;
+    // Every file the output was cooked from, source first, and their hash
+    std::vector<std::string> inputs;
+    uint64_t hash{0};
+    bool cooked{false};
+    bool failed{false};
+    // What the cook printed
+    std::string message;
+};
+
+// What the cache recorded for an output
+struct CacheEntry{
+    uint32_t version{0};
+    uint64_t hash{0};
+    std::vector<std::string> inputs;
+};
+
+// Every regular file directly in a directory with one of the extensions
+static std::vector<std::string> ListFiles(const std::string& directory, const std::vector<std::string>& extensions){
+    std::vector<std::string> paths;
+    std::error_code error;
+    for(const auto& entry : std::filesystem::directory_iterator(directory, error)){
+        if(!entry.is_regular_file()){
+            continue;
+        }
+        std::string extension = entry.path().extension().string();
+        if(std::find(extensions.begin(), extensions.end(), extension) != extensions.end()){
+            paths.push_back(directory + "/" + entry.path().filename().string());
+        }
+    }
+    std::sort(paths.begin(), paths.end());
+    return paths;
+}
+
+static bool ReadFile(const std::string& filepath, std::vector<char>& data){
+    std::ifstream file(filepath.c_str(), std::ios::binary);
+    if(!file.is_open()){
+        return false;
+    }
+    data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    return true;
+}
+
+// Mixes bytes into an FNV-1a hash
+static void HashBytes(uint64_t& hash, const void* data, size_t size){
+    const unsigned char* bytes = (const unsigned char*)data;
+    for(size_t i = 0; i < size; ++i){
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+}
+
+static void HashString(uint64_t& hash, const std::string& text){
+    uint64_t size = text.size();
+    HashBytes(hash, &size, sizeof(size));
+    HashBytes(hash, text.data(), text.size());
+}
+
+// The hash of what task is cooked with and from: its kind, the versions
+// of the formats it writes, its defines and the path and bytes of each
+// input. An input that is not there is hashed as missing, as an .mtl an
+// .obj names but nobody wrote is, so that writing it cooks again.
+static uint64_t HashInputs(const CookTask& task, const std::vector<std::string>& inputs){
+    uint64_t hash = 14695981039346656037ULL;
+    uint32_t kind = (uint32_t)task.kind;
+    HashBytes(hash, &kind, sizeof(kind));
+    if(task.kind == COOK_MESH){
+        HashBytes(hash, &DMESH_VERSION, sizeof(DMESH_VERSION));
+    }
+    for(const std::string& define : task.defines){
+        HashString(hash, define);
+    }
+    std::vector<char> data;
+    for(const std::string& input : inputs){
+        HashString(hash, input);
+        if(!ReadFile(input, data)){
+            HashString(hash, "missing");
+            continue;
+        }
+        uint64_t size = data.size();
+        HashBytes(hash, &size, sizeof(size));
+        HashBytes(hash, data.data(), data.size());
+    }
+    return hash;
+}
+
+// The .mtl files an .obj names with mtllib, as ObjLoader resolves them
+static std::vector<std::string> FindMaterialLibraries(const std::string& objPath){
+    std::vector<std::string> libraries;
+    std::ifstream file(objPath.c_str());
+    std::string directory = std::filesystem::path(objPath).parent_path().string();
+    std::string line;
+    while(std::getline(file, line)){
+        std::istringstream tokens(line);
+        std::string keyword;
+        std::string name;
+        if(tokens >> keyword >> name && keyword == "mtllib"){
+            libraries.push_back(directory + "/" + name);
+        }
+    }
+    return libraries;
+}
+
+static void CookMesh(CookTask& task){
+    ObjLoader loader(task.source, 0);
+    if(loader.getTriangles().empty()){
+        task.message = "could not load " + task.source + ": no triangles";
+        task.failed = true;
+        return;
+    }
+    DMeshStatistics statistics;
+    if(!MeshFile::WriteFromObj(loader, task.output, &statistics)){
+        task.message = "could not write " + task.output;
+        task.failed = true;
+        return;
+    }
+    task.inputs.push_back(task.source);
+    for(const std::string& library : FindMaterialLibraries(task.source)){
+        task.inputs.push_back(library);
+    }
+    std::ostringstream message;
+    message << loader.getTriangles().size() << " triangles, ACMR " << statistics.acmrBefore << " -> " << statistics.acmrAfter;
+    task.message = message.str();
+}
+
+static void CookTexture(CookTask& task){
+    Image image(task.source);
+    // Flipped and keyed like the game loads it, so the blocks upload as
+    // they are
+    image.LoadPPM(true, true, true);
+    if(image.GetPixelDataPtr() == nullptr){
+        task.message = "could not load " + task.source;
+        task.failed = true;
+        return;
+    }
+    std::vector<std::vector<uint8_t>> levels = EncodeBC1MipChain(image.GetPixelDataPtr(), image.GetWidth(), image.GetHeight());
+    if(!KTXFile::Write(task.output, GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, GL_RGBA, image.GetWidth(), image.GetHeight(), levels)){
+        task.message = "could not write " + task.output;
+        task.failed = true;
+        return;
+    }
+    task.inputs.push_back(task.source);
+    std::ostringstream message;
+    message << image.GetWidth() << "x" << image.GetHeight() << ", " << levels.size() << " levels";
+    task.message = message.str();
+}
+
+static void CookShader(CookTask& task){
+    std::string source;
+    std::vector<std::string> files;
+    if(!PreprocessShader(task.source, task.defines, source, &files)){
+        task.message = "could not preprocess " + task.source;
+        task.failed = true;
+        return;
+    }
+    std::ofstream out(task.output.c_str(), std::ios::binary | std::ios::trunc);
+    out << source;
+    if(!out.good()){
+        task.message = "could not write " + task.output;
+        task.failed = true;
+        return;
+    }
+    task.inputs = files;
+    task.message = std::to_string(source.size()) + " bytes from " + std::to_string(files.size()) +
+                   (files.size() == 1 ? " file" : " files");
+}
+
+// Cooks task unless the cache shows its output is up to date
+static void RunTask(CookTask& task, const CacheEntry* entry, bool force){
+    std::error_code error;
+    if(!force && entry != nullptr && entry->version == DINOCOOK_VERSION &&
+       std::filesystem::exists(task.output, error)){
+        uint64_t hash = HashInputs(task, entry->inputs);
+        if(hash == entry->hash){
+            task.inputs = entry->inputs;
+            task.hash = hash;
+            return;
+        }
+    }
+    task.cooked = true;
+    switch(task.kind){
+        case COOK_MESH:
+            CookMesh(task);
+            break;
+        case COOK_TEXTURE:
+            CookTexture(task);
+            break;
+        case COOK_SHADER:
+            CookShader(task);
+            break;
+    }
+    // Hashed after the cook, from what it read, so an edit during this
+    // cook is picked up by the next one at worst
+    if(!task.failed){
+        task.hash = HashInputs(task, task.inputs);
+    }
+}
+
+// Cache lines: output, version, hash, then its inputs, tab separated
+static std::unordered_map<std::string, CacheEntry> ReadCache(const std::string& filepath){
+    std::unordered_map<std::string, CacheEntry> cache;
+    std::ifstream file(filepath.c_str());
+    std::string line;
+    while(std::getline(file, line)){
+        std::vector<std::string> fields;
+        std::istringstream tokens(line);
+        std::string field;
+        while(std::getline(tokens, field, '\t')){
+            fields.push_back(field);
+        }
+        if(fields.size() < 4){
+            continue;
+        }
+        CacheEntry entry;
+        entry.version = (uint32_t)std::strtoul(fields[1].c_str(), nullptr, 10);
+        entry.hash = std::strtoull(fields[2].c_str(), nullptr, 16);
+        entry.inputs.assign(fields.begin() + 3, fields.end());
+        cache[fields[0]] = entry;
+    }
+    return cache;
+}
+
+// Writes the cache for the tasks that did not fail, through a temporary
+// file, so an interrupted cook leaves the last cache in place
+static bool WriteCache(const std::string& filepath, const std::vector<CookTask>& tasks){
+    std::string temporary = filepath + ".tmp";
+    {
+        std::ofstream out(temporary.c_str(), std::ios::trunc);
+        for(const CookTask& task : tasks){
+            if(task.failed){
+                continue;
+            }
+            out << task.output << '\t' << DINOCOOK_VERSION << '\t' << std::hex << task.hash << std::dec;
+            for(const std::string& input : task.inputs){
+                out << '\t' << input;
+            }
+            out << '\n';
+        }
+        if(!out.good()){
+            return false;
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(temporary, filepath, error);
+    return !error;
+}
+
+int main(int argc, char* argv[]){
+    std::string cachePath = "dinocook.cache";
+    bool force = false;
+    for(int i = 1; i < argc; ++i){
+        std::string argument = argv[i];
+        if(argument == "--force"){
+            force = true;
+        }else if(argument.compare(0, 8, "--cache=") == 0){
+            cachePath = argument.substr(8);
+        }else{
+            std::cout << "Unknown option " << argument << "\n";
+            return 1;
+        }
+    }
+
+    std::vector<CookTask> tasks;
+    for(const std::string& objPath : ListFiles("./common/objects", {".obj"})){
+        CookTask task;
+        task.kind = COOK_MESH;
+        task.source = objPath;
+        task.output = MeshFile::DMeshPathFor(objPath);
+        tasks.push_back(task);
+    }
+    for(const std::string& ppmPath : ListFiles("./common/objects", {".ppm"})){
+        if(std::filesystem::path(ppmPath).filename() == "palette.ppm"){
+            continue;
+        }
+        CookTask task;
+        task.kind = COOK_TEXTURE;
+        task.source = ppmPath;
+        task.output = KTXFile::VariantPathFor(ppmPath, ".bc1.ktx");
+        tasks.push_back(task);
+    }
+    const std::vector<ShaderSet> shaderSets = {
+        {"scene", "./shaders/vert.glsl", "./shaders/frag.glsl", {"DAY_NIGHT_BLEND", "WIREFRAME", "BINDLESS", "CROSSFADE"}},
+    };
+    const std::string shaderDirectory = "./shaders/cooked";
+    std::error_code error;
+    std::filesystem::create_directories(shaderDirectory, error);
+    for(const ShaderSet& set : shaderSets){
+        for(uint32_t mask = 0; mask < (1u << set.features.size()); ++mask){
+            CookTask task;
+            task.kind = COOK_SHADER;
+            for(size_t i = 0; i < set.features.size(); ++i){
+                if(mask & (1u << i)){
+                    task.defines.push_back(set.features[i]);
+                }
+            }
+            for(const char* stage : {"vert", "frag"}){
+                task.source = stage[0] == 'v' ? set.vertexPath : set.fragmentPath;
+                task.output = shaderDirectory + "/" + set.name + "." + std::to_string(mask) + "." + stage + ".glsl";
+                tasks.push_back(task);
+            }
+        }
+    }
+
+    std::unordered_map<std::string, CacheEntry> cache = ReadCache(cachePath);
+    auto start = std::chrono::steady_clock::now();
+    // One job per output, the largest meshes spreading their own parse
+    // over the idle workers
+    JobSystem::Get().Start();
+    JobCounter counter;
+    for(CookTask& task : tasks){
+        auto found = cache.find(task.output);
+        const CacheEntry* entry = (found != cache.end()) ? &found->second : nullptr;
+        CookTask* pointer = &task;
+        JobSystem::Get().Submit([pointer, entry, force]{
+            RunTask(*pointer, entry, force);
+        }, &counter);
+    }
+    JobSystem::Get().Wait(counter);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    int cooked = 0;
+    int upToDate = 0;
+    int failures = 0;
+    for(const CookTask& task : tasks){
+        if(task.failed){
+            std::cout << "dinocook: " << task.message << "\n";
+            ++failures;
+        }else if(task.cooked){
+            std::cout << task.source << " -> " << task.output << " (" << task.message << ")\n";
+            ++cooked;
+        }else{
+            ++upToDate;
+        }
+    }
+    if(!WriteCache(cachePath, tasks)){
+        std::cout << "dinocook: could not write " << cachePath << "\n";
+        ++failures;
+    }
+    std::cout << cooked << " cooked, " << upToDate << " up to date, " << failures
+              << " failed in " << seconds << " s on " << JobSystem::Get().GetThreadCount() << " threads\n";
+    JobSystem::Get().Stop();
+    return failures == 0 ? 0 : 1;
+}
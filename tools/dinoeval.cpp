@@ -0,0 +1,581 @@
+/* Seed-sharded evaluation of a policy over many processes and machines.
+ Build with: python3 build.py dinoeval
+ Run with:   ./dinoeval --seeds=<first>-<last> [--policy=heuristic[:<seconds>] | --policy=<host>:<port> |
+                                                --policy=plugin:<library>[:<options>]]
+                        [--port=0] [--local-workers=<n>] [--shard=256] [--retries=3]
+                        [--shard-timeout=600] [--repeat=1] [--max-ticks=100000]
+                        [--features=3] [--fast-forward] [--out=<file.json>] [--bucket=100]
+ and on any other machine, one per core:
+             ./dinoeval --worker=<coordinator host>:<port>
+ Plays one game for every seed of the range, as ./prog --seed=<n> would
+ start it, and merges the scores (ticks survived) into one distribution:
+ mean, deviation, percentiles and, with --out, a JSON histogram in
+ buckets of --bucket ticks. Linux only.
+
+ The coordinator listens on --port (0 picks one and prints it) and
+ starts --local-workers worker processes itself, one per hardware thread
+ unless given. Work is pulled: a worker asks for a shard of --shard seeds
+ only when it is free, so no worker is sent more than it can take, and
+ the coordinator only ever holds the shards in flight. A shard whose
+ worker disconnects, reports a failure or does not answer within
+ --shard-timeout seconds is handed out again, up to --retries more
+ times; shards that still fail are reported and make the exit code 1.
+
+ Workers step their shard's games together in a GameStateBatch, each
+ action played for --repeat steps, and stop games that reach --max-ticks.
+ The policy sees the games' feature rows (see
+ include/FeatureObservation.hpp) with --features obstacle distances.
+ "heuristic" jumps when the next obstacle is less than <seconds> away
+ (0.2 unless given). "<host>:<port>" is a policy server the workers
+ connect to; for every step of a shard a worker sends uint32 rows,
+ uint32 floats per row and the rows of float32, and reads back one byte
+ per row, 1 to jump, all in the machine's byte order.
+ "plugin:<library>[:<options>]" loads a policy library into every worker
+ instead (see include/PolicyPlugin.hpp), the same path on every machine,
+ and calls it once per step with the rows of the whole shard: no round
+ trips, and a network runs the shard as one batch.
+
+ --fast-forward skips ahead, in one go, over the ticks of a game that
+ chose not to jump during which nothing can happen but scrolling (see
+ GetEventHorizon() in include/GameState.hpp), rather than asking the
+ policy at each of them. The scores are those of single steps for any
+ policy that does not jump while no obstacle is within a jump's reach,
+ as the heuristic does not; with --repeat above 1 the ticks the policy
+ is asked at shift along with the skips.
+
+ Coordinator protocol, lines of text:
+   worker: HELLO                         coordinator: CONFIG <repeat> <max ticks> <features> <fast forward> <policy>
+   worker: READY                         coordinator: SHARD <id> <first seed> <seeds>, or DONE
+   worker: RESULT <id> <seeds> <score>...  or  FAILED <id> <reason>
+*/
+#include "FeatureObservation.hpp"
+#include "GameStateBatch.hpp"
+#include "PolicyPlugin.hpp"
+#include "ScoreDistribution.hpp"
+#include "TcpSocket.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <poll.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// What every worker is told on connecting
+struct EvalConfig{
+    int repeat{1};
+    int maxTicks{100000};
+    size_t featureObstacles{3};
+    int fastForward{0};         // 1 to skip the uneventful ticks of games not jumping
+    std::string policy{"heuristic"};
+};
+
+// A worker's policy: the heuristic, a connection to a policy server or
+// a policy library
+struct EvalPolicy{
+    std::string host;           // Empty for the heuristic and a library
+    int port{0};
+    float jumpSeconds{0.2f};
+    TcpSocket server;
+    std::string library;        // <library>[:<options>], loaded on first use
+    PolicyPlugin plugin;
+};
+
+static bool ParsePolicy(const std::string& text, EvalPolicy& policy){
+    if(text == "heuristic"){
+        return true;
+    }
+    if(text.compare(0, 7, "plugin:") == 0){
+        policy.library = text.substr(7);
+        return !policy.library.empty();
+    }
+    if(text.compare(0, 10, "heuristic:") == 0){
+        policy.jumpSeconds = (float)atof(text.c_str() + 10);
+        return policy.jumpSeconds > 0.0f;
+    }
+    return ParseHostPort(text, policy.host, policy.port);
+}
+
+// Picks an action for each of count feature rows, false if the policy
+// server could not be reached or went away, or the library failed
+static bool DecideActions(EvalPolicy& policy, const float* rows, uint32_t count, uint32_t rowSize,
+                          std::vector<uint8_t>& jumps){
+    jumps.resize(count);
+    if(!policy.library.empty()){
+        if(!policy.plugin.IsLoaded() && !policy.plugin.LoadSpec(policy.library, rowSize)){
+            return false;
+        }
+        return policy.plugin.Act(rows, count, jumps.data());
+    }
+    if(policy.host.empty()){
+        for(uint32_t i = 0; i < count; ++i){
+            const float* row = rows + (size_t)i * rowSize;
+            // Seconds until the next obstacle reaches the dino
+            float seconds = row[FEATURE_OBSTACLES] / row[FEATURE_OBSTACLE_SPEED];
+            jumps[i] = (seconds < policy.jumpSeconds) ? 1 : 0;
+        }
+        return true;
+    }
+    if(!policy.server.IsOpen() && !policy.server.Connect(policy.host, policy.port)){
+        return false;
+    }
+    uint32_t header[2] = {count, rowSize};
+    if(!policy.server.SendAll(header, sizeof(header)) ||
+       !policy.server.SendAll(rows, (size_t)count * rowSize * sizeof(float)) ||
+       !policy.server.ReceiveAll(jumps.data(), count)){
+        policy.server.Close();
+        return false;
+    }
+    return true;
+}
+
+// Plays the games of seeds first .. first + count - 1 to the end, their
+// scores into scores. False if the policy failed along the way.
+static bool EvaluateShard(EvalPolicy& policy, const EvalConfig& config, uint64_t first, size_t count,
+                          GameStateBatch& batch, std::vector<int>& scores){
+    batch.Resize(count);
+    for(size_t lane = 0; lane < count; ++lane){
+        batch.Reset(lane, first + lane, 0);
+    }
+    scores.assign(count, 0);
+    const size_t rowSize = GetFeatureSize(config.featureObstacles);
+    std::vector<uint32_t> running(count);
+    std::vector<float> rows(count * rowSize);
+    std::vector<GameAction> actions(count, ACTION_NONE);
+    std::vector<uint8_t> jumps;
+    for(size_t lane = 0; lane < count; ++lane){
+        running[lane] = (uint32_t)lane;
+    }
+    while(!running.empty()){
+        for(size_t i = 0; i < running.size(); ++i){
+            WriteFeatureObservation(batch.Get(running[i]), config.featureObstacles, rows.data() + i * rowSize);
+        }
+        if(!DecideActions(policy, rows.data(), (uint32_t)running.size(), (uint32_t)rowSize, jumps)){
+            return false;
+        }
+        for(size_t i = 0; i < running.size(); ++i){
+            uint32_t lane = running[i];
+            actions[lane] = jumps[i] ? ACTION_JUMP : ACTION_NONE;
+            if(config.fastForward == 0 || jumps[i]){
+                continue;
+            }
+            // Leaves room for the step below within --max-ticks
+            GameState state = batch.Get(lane);
+            if(FastForward(state, config.maxTicks - state.tick - config.repeat) > 0){
+                batch.Set(lane, state);
+            }
+        }
+        batch.StepRepeated(actions.data(), config.repeat);
+
+        const int* ticks = batch.GetTicks();
+        const int* gameOver = batch.GetGameOverMasks();
+        size_t kept = 0;
+        for(size_t i = 0; i < running.size(); ++i){
+            uint32_t lane = running[i];
+            if(gameOver[lane] == 0 && ticks[lane] < config.maxTicks){
+                running[kept++] = lane;
+                continue;
+            }
+            scores[lane] = ticks[lane];
+            if(gameOver[lane] == 0){
+                // Out of time; ended so the batch skips it
+                GameState state = batch.Get(lane);
+                state.gameOver = true;
+                batch.Set(lane, state);
+            }
+            actions[lane] = ACTION_NONE;
+        }
+        running.resize(kept);
+    }
+    return true;
+}
+
+static int WorkerMain(const std::string& address){
+    std::string host;
+    int port = 0;
+    if(!ParseHostPort(address, host, port)){
+        std::cout << "--worker wants <host>:<port>\n";
+        return 1;
+    }
+    TcpSocket coordinator;
+    // The coordinator may still be starting up
+    for(int attempt = 0; !coordinator.Connect(host, port); ++attempt){
+        if(attempt == 20){
+            std::cout << "dinoeval: no coordinator at " << address << "\n";
+            return 1;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(250));
+    }
+    std::string line;
+    if(!coordinator.SendLine("HELLO") || !coordinator.ReceiveLine(line)){
+        std::cout << "dinoeval: lost the coordinator\n";
+        return 1;
+    }
+    EvalConfig config;
+    EvalPolicy policy;
+    std::istringstream configLine(line);
+    std::string word;
+    configLine >> word >> config.repeat >> config.maxTicks >> config.featureObstacles >> config.fastForward
+               >> config.policy;
+    if(word != "CONFIG" || !configLine || !ParsePolicy(config.policy, policy)){
+        std::cout << "dinoeval: bad configuration from the coordinator: " << line << "\n";
+        return 1;
+    }
+
+    GameStateBatch batch;
+    std::vector<int> scores;
+    while(coordinator.SendLine("READY") && coordinator.ReceiveLine(line)){
+        std::istringstream request(line);
+        unsigned long long id = 0;
+        unsigned long long first = 0;
+        size_t count = 0;
+        request >> word >> id >> first >> count;
+        if(word == "DONE"){
+            return 0;
+        }
+        if(word != "SHARD" || !request){
+            std::cout << "dinoeval: unexpected request: " << line << "\n";
+            return 1;
+        }
+        std::string response;
+        if(EvaluateShard(policy, config, first, count, batch, scores)){
+            std::ostringstream result;
+            result << "RESULT " << id << " " << count;
+            for(int score : scores){
+                result << " " << score;
+            }
+            response = result.str();
+        }else{
+            response = "FAILED " + std::to_string(id) + (policy.library.empty() ? " no policy server at " : " policy failed: ")
+                     + config.policy;
+        }
+        if(!coordinator.SendLine(response)){
+            break;
+        }
+    }
+    std::cout << "dinoeval: lost the coordinator\n";
+    return 1;
+}
+
+struct EvalShard{
+    unsigned long long id;
+    unsigned long long first;
+    size_t count;
+    int attempts;
+};
+
+struct WorkerConnection{
+    TcpSocket socket;
+    bool ready{false};
+    bool busy{false};
+    EvalShard shard{};
+    std::chrono::steady_clock::time_point deadline;
+};
+
+// Hands out the shards of a seed range, failed ones again first
+struct ShardQueue{
+    unsigned long long firstSeed{0};
+    unsigned long long seedCount{0};
+    size_t shardSize{256};
+    int retries{3};
+    unsigned long long nextId{0};
+    unsigned long long total{0};
+    unsigned long long completed{0};
+    unsigned long long failed{0};
+    std::deque<EvalShard> again;
+
+    bool Next(EvalShard& shard){
+        if(!again.empty()){
+            shard = again.front();
+            again.pop_front();
+            return true;
+        }
+        if(nextId == total){
+            return false;
+        }
+        unsigned long long offset = nextId * shardSize;
+        shard = EvalShard{nextId, firstSeed + offset, (size_t)std::min<unsigned long long>(shardSize, seedCount - offset), 0};
+        ++nextId;
+        return true;
+    }
+    void Retry(EvalShard shard, const std::string& reason){
+        ++shard.attempts;
+        if(shard.attempts > retries){
+            std::cout << "Shard " << shard.id << " (seeds " << shard.first << "-" << shard.first + shard.count - 1
+                      << ") failed for good: " << reason << "\n";
+            ++failed;
+            return;
+        }
+        std::cout << "Retrying shard " << shard.id << ": " << reason << "\n";
+        again.push_back(shard);
+    }
+    bool IsFinished() const{
+        return completed + failed == total;
+    }
+};
+
+// Takes a RESULT line for the worker's shard, false if it does not match
+static bool TakeResult(WorkerConnection& worker, const std::string& line, ScoreDistribution& scores){
+    std::istringstream result(line);
+    std::string word;
+    unsigned long long id = 0;
+    size_t count = 0;
+    result >> word >> id >> count;
+    if(!worker.busy || id != worker.shard.id || count != worker.shard.count){
+        return false;
+    }
+    std::vector<int> shardScores(count);
+    for(size_t i = 0; i < count; ++i){
+        if(!(result >> shardScores[i])){
+            return false;
+        }
+    }
+    for(int score : shardScores){
+        scores.Add(score);
+    }
+    return true;
+}
+
+// Handles the lines a worker sent, false if it has to be dropped
+static bool HandleWorker(WorkerConnection& worker, const EvalConfig& config, ShardQueue& queue,
+                         ScoreDistribution& scores){
+    std::string line;
+    while(worker.socket.TakeLine(line)){
+        if(line == "HELLO"){
+            std::ostringstream reply;
+            reply << "CONFIG " << config.repeat << " " << config.maxTicks << " "
+                  << config.featureObstacles << " " << config.fastForward << " " << config.policy;
+            if(!worker.socket.SendLine(reply.str())){
+                return false;
+            }
+        }else if(line == "READY"){
+            worker.ready = true;
+        }else if(line.compare(0, 7, "RESULT ") == 0){
+            if(!TakeResult(worker, line, scores)){
+                std::cout << "Dropping a worker that sent a result for another shard\n";
+                return false;
+            }
+            worker.busy = false;
+            ++queue.completed;
+        }else if(line.compare(0, 7, "FAILED ") == 0 && worker.busy){
+            worker.busy = false;
+            size_t reason = line.find(' ', 7);
+            queue.Retry(worker.shard, (reason != std::string::npos) ? line.substr(reason + 1) : "its worker failed");
+        }else{
+            std::cout << "Dropping a worker that sent: " << line << "\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+static int CoordinatorMain(const EvalConfig& config, ShardQueue& queue, int port, int localWorkers,
+                           double shardTimeout, const std::string& outPath, int bucketWidth){
+    TcpSocket listener;
+    if(!listener.Listen(port)){
+        return 1;
+    }
+    port = listener.GetPort();
+    std::cout << "Evaluating seeds " << queue.firstSeed << "-" << queue.firstSeed + queue.seedCount - 1
+              << " in " << queue.total << " shards with policy " << config.policy
+              << "; workers join with --worker=<this host>:" << port << "\n";
+
+    std::vector<pid_t> children;
+    std::string localAddress = "127.0.0.1:" + std::to_string(port);
+    std::cout.flush();
+    for(int i = 0; i < localWorkers; ++i){
+        pid_t child = fork();
+        if(child == 0){
+            listener.Close();
+            std::cout.flush();
+            _exit(WorkerMain(localAddress));
+        }
+        if(child > 0){
+            children.push_back(child);
+        }else{
+            std::cout << "dinoeval: could not start local worker " << i << "\n";
+        }
+    }
+
+    auto timeout = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(shardTimeout));
+    std::vector<WorkerConnection> workers;
+    std::vector<pollfd> polled;
+    ScoreDistribution scores;
+    unsigned long long reported = 0;
+    while(!queue.IsFinished()){
+        polled.clear();
+        polled.push_back(pollfd{listener.GetFd(), POLLIN, 0});
+        for(const WorkerConnection& worker : workers){
+            polled.push_back(pollfd{worker.socket.GetFd(), POLLIN, 0});
+        }
+        if(poll(polled.data(), polled.size(), 500) < 0 && errno != EINTR){
+            std::cout << "dinoeval: poll failed\n";
+            break;
+        }
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        // Walked backwards so dropping a worker keeps the rest in step with polled
+        for(size_t i = workers.size(); i-- > 0;){
+            WorkerConnection& worker = workers[i];
+            bool keep = true;
+            std::string reason = "its worker disconnected";
+            if(polled[i + 1].revents != 0){
+                keep = worker.socket.ReadAvailable() && HandleWorker(worker, config, queue, scores);
+            }
+            if(keep && worker.busy && now > worker.deadline){
+                keep = false;
+                reason = "its worker timed out";
+            }
+            if(!keep){
+                if(worker.busy){
+                    queue.Retry(worker.shard, reason);
+                }
+                workers.erase(workers.begin() + i);
+            }
+        }
+        if(polled[0].revents & POLLIN){
+            TcpSocket connection = listener.Accept();
+            if(connection.IsOpen()){
+                workers.emplace_back();
+                workers.back().socket = std::move(connection);
+            }
+        }
+        // Only free workers that asked get a shard
+        for(size_t i = 0; i < workers.size(); ++i){
+            WorkerConnection& worker = workers[i];
+            if(!worker.ready || worker.busy || !queue.Next(worker.shard)){
+                continue;
+            }
+            std::ostringstream request;
+            request << "SHARD " << worker.shard.id << " " << worker.shard.first << " " << worker.shard.count;
+            if(!worker.socket.SendLine(request.str())){
+                // Noticed as a disconnect on the next poll
+                queue.Retry(worker.shard, "its worker disconnected");
+                continue;
+            }
+            worker.ready = false;
+            worker.busy = true;
+            worker.deadline = now + timeout;
+        }
+        if(queue.completed * 20 / queue.total > reported){
+            reported = queue.completed * 20 / queue.total;
+            std::cout << "Evaluated " << scores.GetCount() << " episodes, " << queue.completed << " of "
+                      << queue.total << " shards, " << workers.size() << " workers\n";
+        }
+    }
+    for(WorkerConnection& worker : workers){
+        worker.socket.SendLine("DONE");
+        worker.socket.Close();
+    }
+    listener.Close();
+    for(pid_t child : children){
+        waitpid(child, nullptr, 0);
+    }
+
+    ScoreSummary summary = scores.Summarize();
+    std::cout << summary.count << " episodes: mean " << summary.mean << " (deviation " << summary.deviation
+              << "), min " << summary.min << ", p10 " << summary.p10 << ", median " << summary.p50
+              << ", p90 " << summary.p90 << ", p99 " << summary.p99 << ", max " << summary.max << "\n";
+    if(!outPath.empty()){
+        std::ostringstream note;
+        note << "seeds " << queue.firstSeed << "-" << queue.firstSeed + queue.seedCount - 1 << ", policy "
+             << config.policy << ", repeat " << config.repeat << ", max ticks " << config.maxTicks
+             << (config.fastForward ? ", fast forward" : "");
+        scores.WriteJson(outPath, bucketWidth, note.str());
+    }
+    if(queue.failed > 0){
+        std::cout << queue.failed << " shards failed, their seeds are missing from the scores\n";
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[]){
+    EvalConfig config;
+    ShardQueue queue;
+    std::string workerAddress;
+    std::string outPath;
+    bool haveSeeds = false;
+    int port = 0;
+    int localWorkers = (int)std::thread::hardware_concurrency();
+    double shardTimeout = 600.0;
+    int bucketWidth = 100;
+    for(int i = 1; i < argc; ++i){
+        std::string argument = argv[i];
+        if(argument.compare(0, 9, "--worker=") == 0){
+            workerAddress = argument.substr(9);
+        }else if(argument.compare(0, 8, "--seeds=") == 0){
+            unsigned long long first = 0;
+            unsigned long long last = 0;
+            if(sscanf(argument.c_str() + 8, "%llu-%llu", &first, &last) != 2 || last < first){
+                std::cout << "--seeds wants <first>-<last>\n";
+                return 1;
+            }
+            queue.firstSeed = first;
+            queue.seedCount = last - first + 1;
+            haveSeeds = true;
+        }else if(argument.compare(0, 9, "--policy=") == 0){
+            config.policy = argument.substr(9);
+        }else if(argument.compare(0, 7, "--port=") == 0){
+            port = atoi(argument.c_str() + 7);
+        }else if(argument.compare(0, 16, "--local-workers=") == 0){
+            localWorkers = atoi(argument.c_str() + 16);
+        }else if(argument.compare(0, 8, "--shard=") == 0){
+            queue.shardSize = strtoull(argument.c_str() + 8, nullptr, 10);
+        }else if(argument.compare(0, 10, "--retries=") == 0){
+            queue.retries = atoi(argument.c_str() + 10);
+        }else if(argument.compare(0, 16, "--shard-timeout=") == 0){
+            shardTimeout = atof(argument.c_str() + 16);
+        }else if(argument.compare(0, 9, "--repeat=") == 0){
+            config.repeat = atoi(argument.c_str() + 9);
+        }else if(argument.compare(0, 12, "--max-ticks=") == 0){
+            config.maxTicks = atoi(argument.c_str() + 12);
+        }else if(argument.compare(0, 11, "--features=") == 0){
+            config.featureObstacles = (size_t)atoi(argument.c_str() + 11);
+        }else if(argument == "--fast-forward"){
+            config.fastForward = 1;
+        }else if(argument.compare(0, 6, "--out=") == 0){
+            outPath = argument.substr(6);
+        }else if(argument.compare(0, 9, "--bucket=") == 0){
+            bucketWidth = atoi(argument.c_str() + 9);
+        }else{
+            std::cout << "Unknown option " << argument << "\n";
+            return 1;
+        }
+    }
+    if(!workerAddress.empty()){
+        return WorkerMain(workerAddress);
+    }
+
+    EvalPolicy policy;
+    if(!haveSeeds){
+        std::cout << "Usage: dinoeval --seeds=<first>-<last> [--policy=...] or dinoeval --worker=<host>:<port>\n";
+        return 1;
+    }
+    if(!ParsePolicy(config.policy, policy) || config.policy.find(' ') != std::string::npos){
+        std::cout << "--policy wants heuristic[:<seconds>], <host>:<port> or plugin:<library>[:<options>]\n";
+        return 1;
+    }
+    if(queue.shardSize < 1 || queue.retries < 0 || shardTimeout <= 0.0 || localWorkers < 0 ||
+       config.repeat < 1 || config.maxTicks < 1 || bucketWidth < 1){
+        std::cout << "--shard, --shard-timeout, --repeat, --max-ticks and --bucket must be positive, "
+                     "--retries and --local-workers at least 0\n";
+        return 1;
+    }
+    if(config.featureObstacles < 1 || config.featureObstacles > MAX_FEATURE_OBSTACLES){
+        std::cout << "--features wants between 1 and " << MAX_FEATURE_OBSTACLES << " obstacles\n";
+        return 1;
+    }
+    queue.total = (queue.seedCount + queue.shardSize - 1) / queue.shardSize;
+    return CoordinatorMain(config, queue, port, localWorkers, shardTimeout, outPath, bucketWidth);
+}
@@ -0,0 +1,111 @@
+/* Live view of a running game, started with ./prog --inspect[=<name>].
+ Build with: python3 build.py dinoinspect
+ Run with:   ./dinoinspect [<name>] [--interval=<ms>] [--once]
+ Attaches to the shared memory block the game publishes (name as given
+ to --inspect, /dino-inspect by default) and redraws its state every
+ --interval milliseconds (500 by default): the game, the frame time, the
+ CPU zones and GPU passes, the live GL objects and the run statistics.
+ --once prints it a single time. Reading never stops or slows the game;
+ the block is described in include/LiveInspector.hpp.
+*/
+#include "LiveInspector.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+
+// Prints a state read from the block
+static void Print(const InspectorState& state, uint64_t published){
+    const GameState& game = state.game;
+    printf("Frame %llu, %.1f s up, %llu states published\n", (unsigned long long)state.frame, state.seconds,
+           (unsigned long long)published);
+    printf("  frame %.2f ms, mean %.2f ms\n", state.frameMilliseconds, state.meanFrameMilliseconds);
+    printf("Game %llu, seed %llu%s%s\n", (unsigned long long)state.gamesPlayed, (unsigned long long)state.seed,
+           game.gameOver ? ", over" : "", state.paused ? ", paused" : "");
+    printf("  tick %d, %s (%d ticks in), scroll speed %d\n", game.tick, game.isDaytime ? "day" : "night",
+           game.dayTick, game.cactusSpeed);
+    printf("  dino height %d, %s, jumping speed %d\n", game.dinoHeight,
+           game.isJumping ? (game.jumpingUp ? "rising" : "falling") : "on the ground", game.jumpingSpeed);
+    printf("  %u obstacles, next group in %d\n", game.obstacles.count, game.spawnDistance);
+
+    printf("CPU zones (mean ms)\n");
+    for(uint32_t i = 0; i < state.zoneCount && i < (uint32_t)INSPECTOR_MAX_ZONES; ++i){
+        if(state.zones[i].meanMilliseconds >= 0.0f){
+            printf("  %-28.28s %8.3f\n", state.zones[i].name, state.zones[i].meanMilliseconds);
+        }
+    }
+    printf("GPU passes (mean ms)\n");
+    for(uint32_t i = 0; i < state.passCount && i < (uint32_t)INSPECTOR_MAX_PASSES; ++i){
+        if(state.passes[i].meanMilliseconds >= 0.0f){
+            printf("  %-28.28s %8.3f\n", state.passes[i].name, state.passes[i].meanMilliseconds);
+        }
+    }
+    printf("GL objects\n");
+    for(uint32_t i = 0; i < state.resourceCount && i < (uint32_t)INSPECTOR_MAX_RESOURCES; ++i){
+        printf("  %-16.16s %6llu %12llu bytes\n", state.resources[i].name,
+               (unsigned long long)state.resources[i].count, (unsigned long long)state.resources[i].bytes);
+    }
+    printf("Last frame allocated %llu times, %llu bytes\n", (unsigned long long)state.frameAllocations,
+           (unsigned long long)state.frameAllocatedBytes);
+    printf("%llu episodes, best score %llu, %llu steps\n", (unsigned long long)state.episodes,
+           (unsigned long long)state.bestScore, (unsigned long long)state.steps);
+}
+
+int main(int argc, char* argv[]){
+    std::string name = "/dino-inspect";
+    int interval = 500;
+    bool once = false;
+    for(int i = 1; i < argc; ++i){
+        std::string argument = argv[i];
+        if(argument.compare(0, 11, "--interval=") == 0){
+            interval = atoi(argument.c_str() + 11);
+        }else if(argument == "--once"){
+            once = true;
+        }else if(argument.compare(0, 2, "--") != 0){
+            name = argument;
+        }else{
+            std::cout << "Unknown option " << argument << "\n";
+            return 1;
+        }
+    }
+    if(interval < 1){
+        std::cout << "Usage: dinoinspect [<name>] [--interval=<ms>] [--once]\n";
+        return 1;
+    }
+    if(name[0] != '/'){
+        name = "/" + name;
+    }
+    LiveInspector inspector;
+    if(!inspector.Open(name)){
+        std::cout << "Is the game running with --inspect=" << name << "?\n";
+        return 1;
+    }
+
+    InspectorState state;
+    uint64_t last = 0;
+    for(;;){
+        if(!inspector.Read(state)){
+            std::cout << "The game kept publishing, no consistent state read\n";
+            if(once){
+                return 1;
+            }
+        }else if(once){
+            Print(state, inspector.GetSequence());
+            return 0;
+        }else{
+            uint64_t published = inspector.GetSequence();
+            // Clears the terminal and draws from the top
+            printf("\033[H\033[2J");
+            Print(state, published);
+            if(published == last){
+                printf("(no new state: the game is stopped or gone)\n");
+            }
+            fflush(stdout);
+            last = published;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(interval));
+    }
+}
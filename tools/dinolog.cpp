@@ -0,0 +1,151 @@
+/* Summary of the gameplay logs ./prog --gameplay-log=<file> appends to.
+ Build with: python3 build.py dinolog
+ Run with:   ./dinolog <file> [--bucket=<units>]
+ Prints the sessions and their lengths, the games and their scores, the
+ deaths at each scroll speed, and how far ahead of the lead obstacle the
+ jumps were made, in buckets of --bucket game units (20 by default).
+ The record format is described in include/GameplayLog.hpp.
+*/
+#include "GameState.hpp"
+#include "GameplayLog.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+// Deaths at one scroll speed
+struct SpeedDeaths{
+    unsigned long deaths = 0;
+    double scoreSum = 0.0;
+    unsigned long formations[3] = {};
+};
+
+int main(int argc, char* argv[]){
+    std::string path;
+    int bucket = 20;
+    for(int i = 1; i < argc; ++i){
+        std::string argument = argv[i];
+        if(argument.compare(0, 9, "--bucket=") == 0){
+            bucket = atoi(argument.c_str() + 9);
+        }else if(path.empty()){
+            path = argument;
+        }else{
+            std::cout << "Unknown option " << argument << "\n";
+            return 1;
+        }
+    }
+    if(path.empty() || bucket < 1){
+        std::cout << "Usage: dinolog <file> [--bucket=<units>]\n";
+        return 1;
+    }
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if(file == nullptr){
+        std::cout << "Could not open " << path << "\n";
+        return 1;
+    }
+
+    unsigned long sessions = 0;
+    double sessionSeconds = 0.0;
+    double sessionEnd = 0.0;            // Latest record time of the current session
+    unsigned long runs = 0;
+    unsigned long jumps = 0;
+    std::vector<int> jumpDistances;
+    std::map<int, SpeedDeaths> deaths;
+    unsigned long bad = 0;
+    GameplayRecord records[1024];
+    size_t read = 0;
+    while((read = std::fread(records, sizeof(GameplayRecord), 1024, file)) > 0){
+        for(size_t i = 0; i < read; ++i){
+            const GameplayRecord& record = records[i];
+            double seconds = (double)record.microseconds / 1000000.0;
+            switch(record.type){
+            case GAMEPLAY_SESSION_START:
+                if(record.values[0] != GAMEPLAY_LOG_VERSION || record.values[1] != (int32_t)sizeof(GameplayRecord)){
+                    std::cout << "Record " << i << " starts a session of version " << record.values[0]
+                              << " with records of " << record.values[1] << " bytes, this reads version "
+                              << GAMEPLAY_LOG_VERSION << "\n";
+                    std::fclose(file);
+                    return 1;
+                }
+                sessionSeconds += sessionEnd;
+                sessionEnd = 0.0;
+                ++sessions;
+                continue;
+            case GAMEPLAY_SESSION_END:
+                break;
+            case GAMEPLAY_RUN_START:
+                ++runs;
+                break;
+            case GAMEPLAY_JUMP:
+                ++jumps;
+                if(record.values[1] != NO_OBSTACLE){
+                    jumpDistances.push_back(record.values[1]);
+                }
+                break;
+            case GAMEPLAY_DEATH:{
+                SpeedDeaths& speed = deaths[record.values[0]];
+                ++speed.deaths;
+                speed.scoreSum += record.tick;
+                if(record.values[1] > 0){
+                    ++speed.formations[std::min(record.values[1], 3) - 1];
+                }
+                break;
+            }
+            default:
+                ++bad;
+                continue;
+            }
+            sessionEnd = std::max(sessionEnd, seconds);
+        }
+    }
+    sessionSeconds += sessionEnd;
+    std::fclose(file);
+    if(sessions == 0){
+        std::cout << path << " holds no session\n";
+        return 1;
+    }
+
+    unsigned long deathCount = 0;
+    double scoreSum = 0.0;
+    for(const auto& speed : deaths){
+        deathCount += speed.second.deaths;
+        scoreSum += speed.second.scoreSum;
+    }
+    printf("%lu sessions, %.1f s on average, %.1f s in all\n", sessions, sessionSeconds / sessions, sessionSeconds);
+    printf("%lu games, %lu deaths, mean score %.1f, %.1f jumps a game\n", runs, deathCount,
+           deathCount > 0 ? scoreSum / deathCount : 0.0, runs > 0 ? (double)jumps / runs : 0.0);
+    if(bad > 0){
+        printf("%lu records of unknown types skipped\n", bad);
+    }
+
+    printf("\nDeaths by scroll speed\n");
+    printf("  speed  deaths  mean score  1/2/3+ cacti\n");
+    for(const auto& speed : deaths){
+        printf("  %5d  %6lu  %10.1f  %lu/%lu/%lu\n", speed.first, speed.second.deaths,
+               speed.second.scoreSum / speed.second.deaths, speed.second.formations[0],
+               speed.second.formations[1], speed.second.formations[2]);
+    }
+
+    if(!jumpDistances.empty()){
+        std::sort(jumpDistances.begin(), jumpDistances.end());
+        size_t count = jumpDistances.size();
+        printf("\nDistance to the lead obstacle at take-off: p10 %d, p50 %d, p90 %d\n",
+               jumpDistances[count / 10], jumpDistances[count / 2], jumpDistances[count * 9 / 10]);
+        size_t i = 0;
+        while(i < count){
+            // Floor division, so negative distances bucket the same way
+            int first = jumpDistances[i] - ((jumpDistances[i] % bucket) + bucket) % bucket;
+            size_t end = i;
+            while(end < count && jumpDistances[end] < first + bucket){
+                ++end;
+            }
+            printf("  %6d..%-6d %lu\n", first, first + bucket - 1, (unsigned long)(end - i));
+            i = end;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,189 @@
+/* Builds the single-file asset pack the game maps at startup.
+ Build with: python3 build.py dinopack
+ Run with:   ./dinopack [--out=assets.dpak] [--embed=include/EmbeddedAssets.inc]
+                        [--compress=lz4|none]
+ Run it from the repository root. Every .obj in common/objects is packed
+ as a .dmesh, next to the textures (.ppm, and .ktx from texconv), the
+ materials (.mtl) and rigs (.rig) there and the shader sources in shaders. Names are the paths from the repository
+ root, so the game finds them under the same paths it opens today.
+ --embed writes the pack as a C++ byte array instead, for
+ python3 build.py --embed-assets to build into the game. The .ppm
+ textures are left out of it to keep the executable small; run texconv
+ first so the compressed ones are there.
+ A pack file also holds every mesh and .ppm cooked for the training
+ server's software rasterizer (<name>.obj.corners, <name>.ppm.rgba; see
+ include/SoftwareRasterizer.hpp), which draws them straight from the
+ mapping instead of parsing a copy per process.
+ Files of 16 KB and more are stored compressed in 64 KB LZ4 blocks
+ (--compress=lz4, the default) where that saves an eighth of them, the
+ cooked ones excepted, which the servers read in place; --compress=none
+ stores every file as it is.
+*/
+#include "AssetPack.hpp"
+#include "Image.hpp"
+#include "MeshFile.hpp"
+#include "ObjLoader.hpp"
+#include "SoftwareRasterizer.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+// Every regular file directly in a directory with one of the extensions
+static std::vector<std::string> ListFiles(const std::string& directory, const std::vector<std::string>& extensions){
+    std::vector<std::string> paths;
+    std::error_code error;
+    for(const auto& entry : std::filesystem::directory_iterator(directory, error)){
+        if(!entry.is_regular_file()){
+            continue;
+        }
+        std::string extension = entry.path().extension().string();
+        if(std::find(extensions.begin(), extensions.end(), extension) != extensions.end()){
+            paths.push_back(directory + "/" + entry.path().filename().string());
+        }
+    }
+    std::sort(paths.begin(), paths.end());
+    return paths;
+}
+
+// Writes pack as the constexpr array EMBEDDED_ASSET_PACK, see AssetPack.hpp
+static bool WriteEmbedded(const std::string& filepath, const std::vector<char>& pack){
+    std::ofstream out(filepath.c_str(), std::ios::trunc);
+    if(!out.is_open()){
+        return false;
+    }
+    out << "// Generated by ./dinopack --embed, do not edit. Included by AssetPack.cpp.\n";
+    out << "alignas(16) constexpr unsigned char EMBEDDED_ASSET_PACK[" << pack.size() << "] = {\n";
+    static const char HEX[] = "0123456789abcdef";
+    std::string line;
+    for(size_t i = 0; i < pack.size(); ++i){
+        unsigned char byte = (unsigned char)pack[i];
+        line += "0x";
+        line += HEX[byte >> 4];
+        line += HEX[byte & 15];
+        line += ',';
+        if(i % 16 == 15 || i + 1 == pack.size()){
+            out << line << "\n";
+            line.clear();
+        }
+    }
+    out << "};\n";
+    return out.good();
+}
+
+static bool ReadFile(const std::string& filepath, std::vector<char>& data){
+    std::ifstream file(filepath.c_str(), std::ios::binary);
+    if(!file.is_open()){
+        return false;
+    }
+    data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    return true;
+}
+
+int main(int argc, char* argv[]){
+    std::string output = "assets.dpak";
+    std::string embedded;
+    AssetPackOptions options;
+    for(int i = 1; i < argc; ++i){
+        std::string argument = argv[i];
+        if(argument.compare(0, 6, "--out=") == 0){
+            output = argument.substr(6);
+        }else if(argument.compare(0, 8, "--embed=") == 0){
+            embedded = argument.substr(8);
+        }else if(argument == "--compress=lz4"){
+            options.codec = ASSET_CODEC_LZ4;
+        }else if(argument == "--compress=none"){
+            options.codec = ASSET_CODEC_NONE;
+        }else{
+            std::cout << "Unknown option " << argument << "\n";
+            return 1;
+        }
+    }
+
+    std::vector<AssetPack::File> files;
+    size_t bytes = 0;
+    for(const std::string& objPath : ListFiles("./common/objects", {".obj"})){
+        ObjLoader loader(objPath, 0);
+        if(loader.getTriangles().empty()){
+            std::cout << "Could not convert " << objPath << ": no triangles\n";
+            return 1;
+        }
+        AssetPack::File file;
+        file.name = MeshFile::DMeshPathFor(objPath);
+        DMeshStatistics statistics;
+        file.data = MeshFile::EncodeFromObj(loader, &statistics);
+        std::cout << objPath << " -> " << AssetPack::NormalizePath(file.name) << " (" << file.data.size() << " bytes, ACMR "
+                  << statistics.acmrBefore << " -> " << statistics.acmrAfter << ")\n";
+        bytes += file.data.size();
+        files.push_back(std::move(file));
+        if(embedded.empty()){
+            AssetPack::File cooked;
+            cooked.name = SoftwareRasterizer::CookedMeshPathFor(objPath);
+            cooked.data = SoftwareRasterizer::CookMesh(loader.getTriangles());
+            cooked.raw = true;
+            bytes += cooked.data.size();
+            files.push_back(std::move(cooked));
+        }
+    }
+    if(embedded.empty()){
+        // Decoded as dinoserve samples them: bottom row first, RGBA
+        for(const std::string& ppmPath : ListFiles("./common/objects", {".ppm"})){
+            Image image(ppmPath);
+            image.LoadPPM(true, true);
+            if(image.GetWidth() <= 0 || image.GetHeight() <= 0 || image.GetPixelDataPtr() == nullptr){
+                std::cout << "Could not decode " << ppmPath << "\n";
+                return 1;
+            }
+            AssetPack::File cooked;
+            cooked.name = SoftwareRasterizer::CookedTexturePathFor(ppmPath);
+            cooked.data = SoftwareRasterizer::CookTexture(image.GetPixelDataPtr(), image.GetWidth(), image.GetHeight());
+            cooked.raw = true;
+            std::cout << ppmPath << " -> " << AssetPack::NormalizePath(cooked.name) << " (" << cooked.data.size() << " bytes)\n";
+            bytes += cooked.data.size();
+            files.push_back(std::move(cooked));
+        }
+    }
+    std::vector<std::string> rawFiles = embedded.empty() ? ListFiles("./common/objects", {".ppm", ".ktx", ".mtl", ".rig"})
+                                                         : ListFiles("./common/objects", {".ktx", ".mtl", ".rig"});
+    std::vector<std::string> shaders = ListFiles("./shaders", {".glsl"});
+    rawFiles.insert(rawFiles.end(), shaders.begin(), shaders.end());
+    for(const std::string& filepath : rawFiles){
+        AssetPack::File file;
+        file.name = filepath;
+        if(!ReadFile(filepath, file.data)){
+            std::cout << "Could not read " << filepath << "\n";
+            return 1;
+        }
+        std::cout << AssetPack::NormalizePath(filepath) << " (" << file.data.size() << " bytes)\n";
+        bytes += file.data.size();
+        files.push_back(std::move(file));
+    }
+    if(files.empty()){
+        std::cout << "Nothing to pack, run dinopack from the repository root\n";
+        return 1;
+    }
+
+    size_t count = files.size();
+    std::vector<char> pack = AssetPack::Build(std::move(files), options);
+    if(!embedded.empty()){
+        output = embedded;
+        if(!WriteEmbedded(output, pack)){
+            std::cout << "Could not write " << output << "\n";
+            return 1;
+        }
+    }else{
+        std::ofstream out(output.c_str(), std::ios::binary | std::ios::trunc);
+        out.write(pack.data(), (std::streamsize)pack.size());
+        if(!out.good()){
+            std::cout << "Could not write " << output << "\n";
+            return 1;
+        }
+    }
+    std::cout << "Packed " << count << " files (" << bytes << " bytes) into " << output
+              << " (" << pack.size() << " bytes)\n";
+    return 0;
+}
@@ -0,0 +1,400 @@
+/* In-process Python module stepping a batch of games, for a trainer on
+ the same host that does not need dinoserve's process boundary.
+ Build with: python3 build.py dinopy   (writes dino<extension suffix>,
+             e.g. dino.cpython-311-x86_64-linux-gnu.so, with the headers
+             of the python3 that runs build.py)
+ Use with:
+   import dino, numpy as np
+   batch = dino.Batch(envs=1024, seed=1, ticks=1, repeat=1, features=0)
+   observations = np.asarray(batch.observations)  # int32 [envs][OBSERVATION_SIZE]
+   rewards = np.asarray(batch.rewards)            # float32 [envs]
+   dones = np.asarray(batch.dones)                # uint8 [envs]
+   actions = np.asarray(batch.actions)            # int32 [envs], writable
+   while training:
+       actions[:] = policy(observations)
+       batch.step_all()
+ The arrays are views of the batch's own buffers through the buffer
+ protocol, so np.asarray() wraps them without a copy and step_all()
+ rewrites them in place; actions are read from where the trainer wrote
+ them. They stay valid as long as any view is alive, even after the
+ Batch object itself is dropped. The layout and the rules are those of
+ dinoserve and include/SharedEnvironment.hpp: observation rows by
+ ObservationField (dino.OBS_*), rewards of 1 for a survived step and -1
+ for the step that ends a game, summed over --repeat, and a finished game
+ is reset right away on a fresh obstacle stream. features=<n> adds
+ batch.features, float32 [envs][5 + n], rows as in
+ include/FeatureObservation.hpp; without it batch.features is None.
+ step_all() releases the GIL while the games step, so other Python
+ threads keep running; one step_all() per Batch at a time. The games
+ are one GameStateBatch stepped on the calling thread with its SIMD
+ kernel (dino.instruction_set() names it).
+*/
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include "FeatureObservation.hpp"
+#include "GameStateBatch.hpp"
+#include "SharedEnvironment.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// The engine side of a Batch: the games and the arrays the trainer sees
+struct BatchData{
+    GameStateBatch games;
+    std::vector<int32_t> observations;
+    std::vector<float> rewards;
+    std::vector<uint8_t> dones;
+    std::vector<int32_t> actions;
+    std::vector<float> features;
+    size_t featureObstacles = 0;
+    uint64_t seed = 1;
+    // Stream of the next game started, see ResetGameState()
+    uint64_t nextStream = 0;
+    int ticks = 1;
+    int repeat = 1;
+    // Set while a step_all() runs without the GIL
+    bool stepping = false;
+};
+
+struct BatchObject{
+    PyObject_HEAD
+    BatchData* data;
+};
+
+// One array of a batch as the buffer protocol describes it. Holds the
+// batch, which never reallocates its arrays, for as long as it lives.
+struct ArrayObject{
+    PyObject_HEAD
+    PyObject* owner;
+    void* memory;
+    const char* format;
+    Py_ssize_t itemSize;
+    int ndim;
+    Py_ssize_t shape[2];
+    Py_ssize_t strides[2];
+    bool readonly;
+};
+
+static PyTypeObject ArrayType = {PyVarObject_HEAD_INIT(nullptr, 0)};
+static PyTypeObject BatchType = {PyVarObject_HEAD_INIT(nullptr, 0)};
+
+// Writes every environment's observation row and, with them, features
+static void WriteRows(BatchData& data){
+    for(size_t i = 0; i < data.games.GetCount(); ++i){
+        GameState state = data.games.Get(i);
+        WriteObservation(state, &data.observations[i * OBSERVATION_SIZE]);
+        if(!data.features.empty()){
+            WriteFeatureObservation(state, data.featureObstacles, &data.features[i * GetFeatureSize(data.featureObstacles)]);
+        }
+    }
+}
+
+// Starts every game over, game i on stream i, as dinoserve does
+static void ResetAll(BatchData& data, uint64_t seed){
+    data.seed = seed;
+    data.games.ResetAll(seed);
+    data.nextStream = data.games.GetCount();
+    std::fill(data.rewards.begin(), data.rewards.end(), 0.0f);
+    std::fill(data.dones.begin(), data.dones.end(), 0);
+    WriteRows(data);
+}
+
+// One step of every game with the actions as they are; no Python
+// object is touched, so it runs without the GIL
+static void StepAll(BatchData& data){
+    data.games.StepRepeated((const GameAction*)data.actions.data(), data.repeat, data.ticks);
+    const int* events = data.games.GetEvents();
+    const float* rewards = data.games.GetRewards();
+    for(size_t i = 0; i < data.games.GetCount(); ++i){
+        bool done = (events[i] & EVENT_GAME_OVER) != 0;
+        data.rewards[i] = rewards[i];
+        data.dones[i] = done ? 1 : 0;
+        if(done){
+            // In order, so the streams are those of dinoserve
+            GameState state;
+            ResetGameState(state, data.seed, data.nextStream++);
+            data.games.Set(i, state);
+        }
+    }
+    WriteRows(data);
+}
+
+static int ArrayGetBuffer(PyObject* object, Py_buffer* view, int flags){
+    ArrayObject* array = (ArrayObject*)object;
+    if((flags & PyBUF_WRITABLE) && array->readonly){
+        PyErr_SetString(PyExc_BufferError, "this array of the batch is read-only, only actions are written");
+        return -1;
+    }
+    Py_ssize_t count = array->shape[0] * (array->ndim > 1 ? array->shape[1] : 1);
+    view->obj = object;
+    Py_INCREF(object);
+    view->buf = array->memory;
+    view->len = count * array->itemSize;
+    view->readonly = array->readonly ? 1 : 0;
+    view->itemsize = array->itemSize;
+    view->format = (flags & PyBUF_FORMAT) ? (char*)array->format : nullptr;
+    view->ndim = array->ndim;
+    // Rows are contiguous, so a consumer asking for no shape gets the
+    // same memory as one flat run
+    view->shape = (flags & PyBUF_ND) ? array->shape : nullptr;
+    view->strides = ((flags & PyBUF_STRIDES) == PyBUF_STRIDES) ? array->strides : nullptr;
+    view->suboffsets = nullptr;
+    view->internal = nullptr;
+    return 0;
+}
+
+static void ArrayDealloc(PyObject* object){
+    ArrayObject* array = (ArrayObject*)object;
+    Py_XDECREF(array->owner);
+    Py_TYPE(object)->tp_free(object);
+}
+
+static PyBufferProcs ArrayBuffer = {ArrayGetBuffer, nullptr};
+
+// A memoryview of rows x columns items of memory (columns 0 for a flat
+// array), owned by batch
+static PyObject* MakeView(BatchObject* batch, void* memory, const char* format, Py_ssize_t itemSize,
+                          Py_ssize_t rows, Py_ssize_t columns, bool readonly){
+    ArrayObject* array = PyObject_New(ArrayObject, &ArrayType);
+    if(array == nullptr){
+        return nullptr;
+    }
+    array->owner = (PyObject*)batch;
+    Py_INCREF(batch);
+    array->memory = memory;
+    array->format = format;
+    array->itemSize = itemSize;
+    array->ndim = (columns > 0) ? 2 : 1;
+    array->shape[0] = rows;
+    array->shape[1] = columns;
+    array->strides[0] = itemSize * (columns > 0 ? columns : 1);
+    array->strides[1] = itemSize;
+    array->readonly = readonly;
+    PyObject* view = PyMemoryView_FromObject((PyObject*)array);
+    Py_DECREF(array);
+    return view;
+}
+
+static int BatchInit(PyObject* object, PyObject* args, PyObject* kwargs){
+    BatchObject* batch = (BatchObject*)object;
+    static const char* keywords[] = {"envs", "seed", "ticks", "repeat", "features", nullptr};
+    Py_ssize_t envs = 1024;
+    unsigned long long seed = 1;
+    int ticks = 1;
+    int repeat = 1;
+    Py_ssize_t featureObstacles = 0;
+    if(!PyArg_ParseTupleAndKeywords(args, kwargs, "|nKiin", (char**)keywords,
+                                    &envs, &seed, &ticks, &repeat, &featureObstacles)){
+        return -1;
+    }
+    if(batch->data != nullptr){
+        PyErr_SetString(PyExc_RuntimeError, "a Batch is set up once, make a new one instead");
+        return -1;
+    }
+    if(envs < 1 || ticks < 1 || repeat < 1){
+        PyErr_SetString(PyExc_ValueError, "envs, ticks and repeat must be at least 1");
+        return -1;
+    }
+    // Step() advances at most a day at once
+    if(ticks > DAY_LENGTH){
+        PyErr_Format(PyExc_ValueError, "ticks must be between 1 and %d", DAY_LENGTH);
+        return -1;
+    }
+    if(featureObstacles < 0 || (size_t)featureObstacles > MAX_FEATURE_OBSTACLES){
+        PyErr_Format(PyExc_ValueError, "features must be 0 to %zu obstacles", MAX_FEATURE_OBSTACLES);
+        return -1;
+    }
+    BatchData* data = new BatchData();
+    data->ticks = ticks;
+    data->repeat = repeat;
+    data->featureObstacles = (size_t)featureObstacles;
+    data->games.Resize((size_t)envs);
+    data->observations.resize((size_t)envs * OBSERVATION_SIZE);
+    data->rewards.resize((size_t)envs);
+    data->dones.resize((size_t)envs);
+    data->actions.resize((size_t)envs, ACTION_NONE);
+    if(featureObstacles > 0){
+        data->features.resize((size_t)envs * GetFeatureSize((size_t)featureObstacles));
+    }
+    ResetAll(*data, seed);
+    batch->data = data;
+    return 0;
+}
+
+static void BatchDealloc(PyObject* object){
+    BatchObject* batch = (BatchObject*)object;
+    delete batch->data;
+    batch->data = nullptr;
+    Py_TYPE(object)->tp_free(object);
+}
+
+// The batch's data, or nullptr after raising if it cannot be used now
+static BatchData* GetData(PyObject* object){
+    BatchData* data = ((BatchObject*)object)->data;
+    if(data == nullptr){
+        PyErr_SetString(PyExc_RuntimeError, "the Batch was never set up");
+        return nullptr;
+    }
+    if(data->stepping){
+        PyErr_SetString(PyExc_RuntimeError, "step_all() is running on another thread");
+        return nullptr;
+    }
+    return data;
+}
+
+static PyObject* BatchStepAll(PyObject* object, PyObject*){
+    BatchData* data = GetData(object);
+    if(data == nullptr){
+        return nullptr;
+    }
+    data->stepping = true;
+    Py_BEGIN_ALLOW_THREADS
+    StepAll(*data);
+    Py_END_ALLOW_THREADS
+    data->stepping = false;
+    Py_RETURN_NONE;
+}
+
+static PyObject* BatchReset(PyObject* object, PyObject* args){
+    BatchData* data = GetData(object);
+    if(data == nullptr){
+        return nullptr;
+    }
+    unsigned long long seed = data->seed;
+    if(!PyArg_ParseTuple(args, "|K", &seed)){
+        return nullptr;
+    }
+    ResetAll(*data, seed);
+    Py_RETURN_NONE;
+}
+
+static PyObject* BatchObservations(PyObject* object, void*){
+    BatchData* data = GetData(object);
+    if(data == nullptr){
+        return nullptr;
+    }
+    return MakeView((BatchObject*)object, data->observations.data(), "i", sizeof(int32_t),
+                    (Py_ssize_t)data->games.GetCount(), OBSERVATION_SIZE, true);
+}
+
+static PyObject* BatchRewards(PyObject* object, void*){
+    BatchData* data = GetData(object);
+    if(data == nullptr){
+        return nullptr;
+    }
+    return MakeView((BatchObject*)object, data->rewards.data(), "f", sizeof(float),
+                    (Py_ssize_t)data->games.GetCount(), 0, true);
+}
+
+static PyObject* BatchDones(PyObject* object, void*){
+    BatchData* data = GetData(object);
+    if(data == nullptr){
+        return nullptr;
+    }
+    return MakeView((BatchObject*)object, data->dones.data(), "B", sizeof(uint8_t),
+                    (Py_ssize_t)data->games.GetCount(), 0, true);
+}
+
+static PyObject* BatchActions(PyObject* object, void*){
+    BatchData* data = GetData(object);
+    if(data == nullptr){
+        return nullptr;
+    }
+    return MakeView((BatchObject*)object, data->actions.data(), "i", sizeof(int32_t),
+                    (Py_ssize_t)data->games.GetCount(), 0, false);
+}
+
+static PyObject* BatchFeatures(PyObject* object, void*){
+    BatchData* data = GetData(object);
+    if(data == nullptr){
+        return nullptr;
+    }
+    if(data->features.empty()){
+        Py_RETURN_NONE;
+    }
+    return MakeView((BatchObject*)object, data->features.data(), "f", sizeof(float),
+                    (Py_ssize_t)data->games.GetCount(), (Py_ssize_t)GetFeatureSize(data->featureObstacles), true);
+}
+
+static PyObject* BatchCount(PyObject* object, void*){
+    BatchData* data = ((BatchObject*)object)->data;
+    return PyLong_FromSize_t(data != nullptr ? data->games.GetCount() : 0);
+}
+
+static PyObject* InstructionSet(PyObject*, PyObject*){
+    return PyUnicode_FromString(GameStateBatch::GetInstructionSet());
+}
+
+static PyMethodDef BatchMethods[] = {
+    {"step_all", BatchStepAll, METH_NOARGS,
+     "Steps every game with the actions array and rewrites observations, rewards, dones and features."},
+    {"reset", BatchReset, METH_VARARGS, "reset([seed]): starts every game over, game i on obstacle stream i."},
+    {nullptr, nullptr, 0, nullptr}
+};
+
+static PyGetSetDef BatchProperties[] = {
+    {"observations", BatchObservations, nullptr, "int32 [envs][OBSERVATION_SIZE], read-only view", nullptr},
+    {"rewards", BatchRewards, nullptr, "float32 [envs], read-only view", nullptr},
+    {"dones", BatchDones, nullptr, "uint8 [envs], read-only view", nullptr},
+    {"actions", BatchActions, nullptr, "int32 [envs] of dino.ACTION_*, writable view", nullptr},
+    {"features", BatchFeatures, nullptr, "float32 [envs][feature size] read-only view, or None", nullptr},
+    {"count", BatchCount, nullptr, "Number of games", nullptr},
+    {nullptr, nullptr, nullptr, nullptr, nullptr}
+};
+
+static PyMethodDef ModuleMethods[] = {
+    {"instruction_set", InstructionSet, METH_NOARGS, "Name of the instruction set the games are stepped with."},
+    {nullptr, nullptr, 0, nullptr}
+};
+
+static PyModuleDef Module = {
+    PyModuleDef_HEAD_INIT, "dino", "Batches of dino games stepped in process, with zero-copy array views.",
+    -1, ModuleMethods
+};
+
+PyMODINIT_FUNC PyInit_dino(){
+    ArrayType.tp_name = "dino.Array";
+    ArrayType.tp_basicsize = sizeof(ArrayObject);
+    ArrayType.tp_flags = Py_TPFLAGS_DEFAULT;
+    ArrayType.tp_doc = "An array of a Batch, exported through the buffer protocol";
+    ArrayType.tp_dealloc = ArrayDealloc;
+    ArrayType.tp_as_buffer = &ArrayBuffer;
+    BatchType.tp_name = "dino.Batch";
+    BatchType.tp_basicsize = sizeof(BatchObject);
+    BatchType.tp_flags = Py_TPFLAGS_DEFAULT;
+    BatchType.tp_doc = "Batch(envs=1024, seed=1, ticks=1, repeat=1, features=0): games stepped together";
+    BatchType.tp_new = PyType_GenericNew;
+    BatchType.tp_init = BatchInit;
+    BatchType.tp_dealloc = BatchDealloc;
+    BatchType.tp_methods = BatchMethods;
+    BatchType.tp_getset = BatchProperties;
+    if(PyType_Ready(&ArrayType) < 0 || PyType_Ready(&BatchType) < 0){
+        return nullptr;
+    }
+    PyObject* module = PyModule_Create(&Module);
+    if(module == nullptr){
+        return nullptr;
+    }
+    Py_INCREF(&BatchType);
+    if(PyModule_AddObject(module, "Batch", (PyObject*)&BatchType) < 0){
+        Py_DECREF(&BatchType);
+        Py_DECREF(module);
+        return nullptr;
+    }
+    const std::pair<const char*, long> constants[] = {
+        {"ACTION_NONE", ACTION_NONE}, {"ACTION_JUMP", ACTION_JUMP},
+        {"OBS_DINO_HEIGHT", OBS_DINO_HEIGHT}, {"OBS_IS_JUMPING", OBS_IS_JUMPING},
+        {"OBS_JUMPING_SPEED", OBS_JUMPING_SPEED}, {"OBS_CACTUS_POSITION", OBS_CACTUS_POSITION},
+        {"OBS_CACTUS_SPEED", OBS_CACTUS_SPEED}, {"OBS_TICK", OBS_TICK},
+        {"OBSERVATION_SIZE", OBSERVATION_SIZE}, {"NO_OBSTACLE", NO_OBSTACLE},
+    };
+    for(const std::pair<const char*, long>& constant : constants){
+        if(PyModule_AddIntConstant(module, constant.first, constant.second) < 0){
+            Py_DECREF(module);
+            return nullptr;
+        }
+    }
+    return module;
+}
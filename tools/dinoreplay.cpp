@@ -0,0 +1,94 @@
+/* Headless playback of input logs recorded with ./prog --record=<file>.
+ Build with: python3 build.py dinoreplay
+ Run with:   ./dinoreplay <file.dlog> [--repeat=<n>] [--seek=<step>[,<step>...]]
+ Runs the log through the simulation as fast as possible and prints the
+ final state hash, which matches the one ./prog --replay=<file> prints, and
+ the step rate. --repeat runs the whole log n times, as a repeatable load
+ for performance regression runs. --seek jumps to each step given from the
+ log's keyframes instead and prints the state there, with how many steps
+ that took and how long.
+*/
+#include "InputLog.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+int main(int argc, char* argv[]){
+    std::string path;
+    int repeat = 1;
+    std::vector<size_t> seeks;
+    for(int i = 1; i < argc; ++i){
+        std::string argument = argv[i];
+        if(argument.compare(0, 9, "--repeat=") == 0){
+            repeat = atoi(argument.c_str() + 9);
+        }else if(argument.compare(0, 7, "--seek=") == 0){
+            const char* list = argument.c_str() + 7;
+            char* end = nullptr;
+            do{
+                seeks.push_back((size_t)strtoull(list, &end, 10));
+                list = end + 1;
+            }while(*end == ',');
+        }else if(path.empty()){
+            path = argument;
+        }else{
+            std::cout << "Unknown option " << argument << "\n";
+            return 1;
+        }
+    }
+    if(path.empty() || repeat < 1){
+        std::cout << "Usage: dinoreplay <file.dlog> [--repeat=<n>] [--seek=<step>[,<step>...]]\n";
+        return 1;
+    }
+
+    InputLog log;
+    if(!log.Load(path)){
+        return 1;
+    }
+    if(!seeks.empty()){
+        // Only replays what the file has no keyframes for
+        auto start = std::chrono::steady_clock::now();
+        size_t stored = log.GetKeyframes().size();
+        log.BuildKeyframes();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << log.GetKeyframes().size() << " keyframes, " << log.GetKeyframes().size() - stored
+                  << " rebuilt in " << seconds * 1000.0 << " ms\n";
+        for(size_t target : seeks){
+            GameState state;
+            uint64_t gamesPlayed = 0;
+            start = std::chrono::steady_clock::now();
+            size_t simulated = log.Seek(target, state, gamesPlayed);
+            seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            std::cout << "Step " << std::min(target, log.GetStepCount()) << ": tick " << state.tick << ", game "
+                      << gamesPlayed + 1 << ", state hash " << std::hex << HashGameState(state) << std::dec
+                      << " (" << simulated << " steps from a keyframe, " << seconds * 1000000.0 << " us)\n";
+        }
+        return 0;
+    }
+
+    GameState state;
+    uint64_t gamesPlayed = 0;
+    unsigned long gameOvers = 0;
+    auto start = std::chrono::steady_clock::now();
+    for(int run = 0; run < repeat; ++run){
+        gamesPlayed = 0;
+        ResetGameState(state, log.GetSeed(), gamesPlayed);
+        for(size_t step = 0; step < log.GetStepCount(); ++step){
+            if(StepLoggedInput(state, log.GetInput(step), log.GetSeed(), gamesPlayed) & EVENT_GAME_OVER){
+                ++gameOvers;
+            }
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    double steps = (double)log.GetStepCount() * repeat;
+    std::cout << "Replayed " << log.GetStepCount() << " steps x" << repeat << ": tick " << state.tick
+              << ", " << gamesPlayed + 1 << " games, " << gameOvers / repeat << " game overs, state hash "
+              << std::hex << HashGameState(state) << std::dec << "\n";
+    std::cout << seconds * 1000.0 << " ms, " << (seconds > 0.0 ? steps / seconds / 1000000.0 : 0.0)
+              << " M steps/s\n";
+    return 0;
+}
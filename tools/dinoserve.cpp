@@ -0,0 +1,541 @@
+/* Headless training server: steps a batch of games for an external trainer
+ through shared memory (see include/SharedEnvironment.hpp for the layout).
+ Build with: python3 build.py dinoserve
+ Run with:   ./dinoserve [--name=/dino] [--envs=1024] [--threads=0] [--seed=1] [--ticks=1]
+                         [--affinity=<compact|scatter>] [--exclude-cores=<list>]
+                         [--repeat=1] [--pixels=84x84] [--pixels-color] [--features[=<n>]]
+                         [--stats=<seconds>] [--checkpoint=<file> [--checkpoint-every=<n>]]
+                         [--pack=assets.dpak] [--no-pack] [--spawn-script=<name>]
+                         [--zygote=<socket>]
+ Every request steps all environments once with the actions in the shared
+ actions array. --ticks makes each step that many ticks long: a coarser
+ game, but collisions are swept so none are missed, and an episode takes
+ that many times fewer requests. --repeat=<k> instead plays each action
+ for k exact steps in one request (frame skip), stopping at the end of the
+ game, so the handshake and the observations are paid once per k steps.
+ Rewards are 1 for a survived step and -1 for the step that ends the game,
+ summed over the repeats. A finished environment is reset right away with
+ a fresh obstacle stream, so the observation after a done flag is the new game's.
+ --pixels=<w>x<h> also renders every environment's frame on the CPU (see
+ include/SoftwareRasterizer.hpp) into the shared pixels array, grayscale
+ unless --pixels-color is given, so no GPU is needed. Its meshes and
+ textures are drawn in place from the cooked copies in the asset pack
+ (./dinopack writes them), mapped read-only and shared: the 64 servers of
+ a host hold one copy of the scene between them in the page cache, and
+ none of their own. Without a pack (--no-pack, or none at --pack) every
+ server parses the loose .obj and .ppm files into a copy of its own.
+ --features also writes a row of floats per environment into the shared
+ features array (see include/FeatureObservation.hpp): dino height,
+ velocity and jump phase, obstacle speed, time of day and the distances to
+ the next n obstacles, 3 unless given. Nothing is rendered for it.
+ --stats prints the run statistics (see include/Telemetry.hpp) every that
+ many seconds: episodes, mean and best score, collisions by formation and
+ the step rate since the last line. They are printed on shutdown either way.
+ --checkpoint resumes every environment from that file when it exists
+ (it must hold --envs environments) and saves them to it on shutdown and,
+ with --checkpoint-every, after every n requests; see
+ include/EnvironmentPool.hpp. A preempted server picks up where the last
+ checkpoint left off instead of starting every game over.
+ --affinity pins every stepping thread, this one included, to a core of
+ its own: compact fills each core's hardware threads in turn, scatter
+ takes one per physical core first (see include/ThreadAffinity.hpp).
+ --exclude-cores=0,2,8-11 keeps those hardware threads free. Pinned
+ workers keep their shards in their own L2 from step to step, and each
+ shard and its observations are allocated on its worker's NUMA node;
+ --stats then also reports the share of steps taken on a remote node.
+ --spawn-script=<name> starts every game with a scripted obstacle
+ sequence (see include/SpawnScript.hpp), three_cacti_pause_bird say,
+ after which it spawns at random as usual.
+ --zygote=<socket> loads the pack and the pixel scene once and then, instead
+ of serving, listens on that Unix domain socket. Every line a client sends
+ there, such as "--envs=256 --seed=7", forks a worker that serves with the
+ zygote's options and those on top of it, on <name>-<pid> unless the line
+ gives a --name. The worker answers "ready <pid> <name>" once its shared
+ memory is there to open, or "error <why>", and closes the connection:
+   echo "--envs=256 --seed=7" | nc -U /tmp/dino.zygote
+ Workers share the pack's mapping and every page of the scene with the
+ zygote copy-on-write, so one starts in the milliseconds it takes to make
+ its games and shared memory, with nothing parsed. The scene's options,
+ --pixels, --pixels-color, --pack and --no-pack, are the zygote's. Give
+ each worker its own --seed, or they all play the same games.
+*/
+#include "AssetPack.hpp"
+#include "Camera.hpp"
+#include "EnvironmentPool.hpp"
+#include "FeatureObservation.hpp"
+#include "HugePages.hpp"
+#include "Image.hpp"
+#include "ObjLoader.hpp"
+#include "SharedEnvironment.hpp"
+#include "Telemetry.hpp"
+#include "SoftwareRasterizer.hpp"
+#include "TcpSocket.hpp"
+
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+// The scene of pixel observations: the game's meshes and textures, placed
+// as the game places them. The ground is left out, its chunks are only
+// ever built on the GPU.
+struct PixelScene{
+    SoftwareRasterizer rasterizer;
+    Camera camera;
+    int dayBackground{-1};
+    int nightBackground{-1};
+    int dinoFrames[2]{-1, -1};
+    int cactus{-1};
+    int dayTexture{-1};
+    int nightTexture{-1};
+    // Width of one palette column in texture space
+    float paletteStep{0.0f};
+    std::vector<SoftwareInstance> instances;
+};
+
+// Adds an OBJ's triangles to the rasterizer, -1 if it has none. The
+// cooked copy in the pack is drawn in place.
+static int LoadPixelMesh(SoftwareRasterizer& rasterizer, const char* path){
+    const char* data = nullptr;
+    size_t size = 0;
+    if(AssetPack::Get().Find(SoftwareRasterizer::CookedMeshPathFor(path), data, size)){
+        int mesh = rasterizer.AddCookedMesh(data, size);
+        if(mesh >= 0){
+            return mesh;
+        }
+        std::cout << "dinoserve: the cooked " << path << " in the pack is invalid, parsing the file\n";
+    }
+    ObjLoader loader(path, 0);
+    Span<Triangle> triangles = loader.getTriangles();
+    if(triangles.empty()){
+        std::cout << "dinoserve: could not load " << path << "\n";
+        return -1;
+    }
+    return rasterizer.AddMesh(triangles);
+}
+
+// Adds a PPM as a texture, -1 if it does not load. The cooked copy in
+// the pack is drawn in place.
+static int LoadPixelTexture(SoftwareRasterizer& rasterizer, const char* path, int& width){
+    const char* data = nullptr;
+    size_t size = 0;
+    if(AssetPack::Get().Find(SoftwareRasterizer::CookedTexturePathFor(path), data, size)){
+        int texture = rasterizer.AddCookedTexture(data, size);
+        if(texture >= 0){
+            width = (int)((const CookedAssetHeader*)data)->width;
+            return texture;
+        }
+        std::cout << "dinoserve: the cooked " << path << " in the pack is invalid, decoding the file\n";
+    }
+    Image image(path);
+    image.LoadPPM(true, true);
+    if(image.GetWidth() <= 0 || image.GetHeight() <= 0 || image.GetPixelDataPtr() == nullptr){
+        std::cout << "dinoserve: could not load " << path << "\n";
+        return -1;
+    }
+    width = image.GetWidth();
+    return rasterizer.AddTexture(image.GetPixelDataPtr(), image.GetWidth(), image.GetHeight());
+}
+
+static bool LoadPixelScene(PixelScene& scene, int width, int height, bool grayscale){
+    if(!scene.rasterizer.SetSize(width, height, grayscale)){
+        return false;
+    }
+    // The game clears to green
+    scene.rasterizer.SetClearColor(0, 255, 0);
+    scene.camera.SetViewportSize(width, height);
+    int textureWidth = 0;
+    scene.dayBackground = LoadPixelMesh(scene.rasterizer, "./common/objects/bg.obj");
+    scene.nightBackground = LoadPixelMesh(scene.rasterizer, "./common/objects/bg_night.obj");
+    scene.dinoFrames[0] = LoadPixelMesh(scene.rasterizer, "./common/objects/dino.obj");
+    scene.dinoFrames[1] = LoadPixelMesh(scene.rasterizer, "./common/objects/dino2.obj");
+    scene.cactus = LoadPixelMesh(scene.rasterizer, "./common/objects/cactus.obj");
+    scene.dayTexture = LoadPixelTexture(scene.rasterizer, "./common/objects/bg.ppm", textureWidth);
+    scene.nightTexture = LoadPixelTexture(scene.rasterizer, "./common/objects/bg_night.ppm", textureWidth);
+    if(scene.dayBackground < 0 || scene.nightBackground < 0 || scene.dinoFrames[0] < 0 ||
+       scene.dinoFrames[1] < 0 || scene.cactus < 0 || scene.dayTexture < 0 || scene.nightTexture < 0){
+        return false;
+    }
+    scene.paletteStep = 1.0f / (float)textureWidth;
+    scene.instances.reserve(2 + OBSTACLE_LANE_CAPACITY);
+    std::cout << "dinoserve: the pixel scene keeps " << scene.rasterizer.GetOwnedBytes()
+              << " bytes of assets of its own\n";
+    return true;
+}
+
+// Renders one environment's frame into frame, in palette 0
+static void RenderPixels(PixelScene& scene, const GameState& state, ThreadPool* pool, uint8_t* frame){
+    int texture = state.isDaytime ? scene.dayTexture : scene.nightTexture;
+    scene.instances.clear();
+    // The background scrolls 0.004 of the texture a tick and wraps every
+    // 125 ticks, like the game's TextureScroll
+    SoftwareInstance background = {state.isDaytime ? scene.dayBackground : scene.nightBackground,
+                                   texture, 0.0f, 0.0f, 0.0f, 1.0f, -(float)(state.tick % 125) * 0.004f};
+    scene.instances.push_back(background);
+    // Game units are hundredths of world units
+    SoftwareInstance dino = {scene.dinoFrames[(state.tick % 30 < 15) ? 1 : 0],
+                             texture, 0.0f, state.dinoHeight * 0.01f, 0.0f, 1.0f, 0.0f};
+    scene.instances.push_back(dino);
+    for(uint32_t i = 0; i < state.obstacles.count; ++i){
+        uint32_t slot = GetLaneSlot(state.obstacles, i);
+        SoftwareInstance cactus = {scene.cactus, texture, (state.obstacles.x[slot] - state.scroll) * 0.01f,
+                                   state.obstacles.y[slot] * 0.01f, 0.0f, 1.0f, 0.0f};
+        scene.instances.push_back(cactus);
+    }
+    scene.rasterizer.Render(scene.camera.GetViewProjectionMatrix(), scene.instances.data(),
+                            scene.instances.size(), pool);
+    size_t bytes = (size_t)scene.rasterizer.GetWidth() * scene.rasterizer.GetHeight() * scene.rasterizer.GetChannels();
+    std::memcpy(frame, scene.rasterizer.GetPixels(), bytes);
+}
+
+// Everything a server is run with
+struct ServeOptions{
+    std::string name{"/dino"};
+    size_t environmentCount{1024};
+    unsigned int threadCount{0};
+    AffinityConfig affinity;
+    unsigned long long seed{1};
+    int ticks{1};
+    int repeat{1};
+    int pixelWidth{0};
+    int pixelHeight{0};
+    bool pixelColor{false};
+    size_t featureObstacles{0};
+    double statsSeconds{0.0};
+    std::string checkpointPath;
+    unsigned long long checkpointEvery{0};
+    std::string packPath{"./assets.dpak"};
+    uint16_t spawnScript{SPAWN_SCRIPT_NONE};
+    std::string zygotePath;
+};
+
+// Applies one command line argument to options; what is wrong with it,
+// or an empty string
+static std::string ParseOption(const std::string& argument, ServeOptions& options){
+    if(argument.compare(0, 7, "--name=") == 0){
+        options.name = argument.substr(7);
+    }else if(argument.compare(0, 7, "--envs=") == 0){
+        options.environmentCount = strtoull(argument.c_str() + 7, nullptr, 10);
+    }else if(argument.compare(0, 10, "--threads=") == 0){
+        options.threadCount = (unsigned int)atoi(argument.c_str() + 10);
+    }else if(argument.compare(0, 11, "--affinity=") == 0){
+        if(!ParseAffinityPolicy(argument.substr(11), options.affinity.policy)){
+            return "--affinity wants none, compact or scatter";
+        }
+    }else if(argument.compare(0, 16, "--exclude-cores=") == 0){
+        if(!ParseCoreList(argument.substr(16), options.affinity.excluded)){
+            return "--exclude-cores wants a list such as 0,2,8-11";
+        }
+    }else if(argument.compare(0, 7, "--seed=") == 0){
+        options.seed = strtoull(argument.c_str() + 7, nullptr, 10);
+    }else if(argument.compare(0, 8, "--ticks=") == 0){
+        options.ticks = atoi(argument.c_str() + 8);
+    }else if(argument.compare(0, 9, "--repeat=") == 0){
+        options.repeat = atoi(argument.c_str() + 9);
+    }else if(argument.compare(0, 9, "--pixels=") == 0){
+        if(sscanf(argument.c_str() + 9, "%dx%d", &options.pixelWidth, &options.pixelHeight) != 2){
+            return "--pixels wants <width>x<height>";
+        }
+    }else if(argument == "--pixels-color"){
+        options.pixelColor = true;
+    }else if(argument == "--features"){
+        options.featureObstacles = 3;
+    }else if(argument.compare(0, 11, "--features=") == 0){
+        options.featureObstacles = (size_t)atoi(argument.c_str() + 11);
+        if(options.featureObstacles < 1 || options.featureObstacles > MAX_FEATURE_OBSTACLES){
+            return "--features wants between 1 and " + std::to_string(MAX_FEATURE_OBSTACLES) + " obstacles";
+        }
+    }else if(argument.compare(0, 13, "--checkpoint=") == 0){
+        options.checkpointPath = argument.substr(13);
+    }else if(argument.compare(0, 19, "--checkpoint-every=") == 0){
+        options.checkpointEvery = strtoull(argument.c_str() + 19, nullptr, 10);
+    }else if(argument.compare(0, 8, "--stats=") == 0){
+        options.statsSeconds = atof(argument.c_str() + 8);
+    }else if(argument.compare(0, 7, "--pack=") == 0){
+        options.packPath = argument.substr(7);
+    }else if(argument == "--no-pack"){
+        options.packPath.clear();
+    }else if(argument.compare(0, 15, "--spawn-script=") == 0){
+        options.spawnScript = FindSpawnScript(argument.substr(15));
+        if(options.spawnScript == SPAWN_SCRIPT_NONE){
+            return "--spawn-script wants one of " + ListSpawnScripts();
+        }
+    }else if(argument.compare(0, 9, "--zygote=") == 0){
+        options.zygotePath = argument.substr(9);
+    }else{
+        return "Unknown option " + argument;
+    }
+    return std::string();
+}
+
+// What is wrong with options as a whole, or an empty string
+static std::string CheckOptions(const ServeOptions& options){
+    if(options.environmentCount == 0){
+        return "--envs must be at least 1";
+    }
+    if(options.ticks < 1 || options.ticks > DAY_LENGTH){
+        return "--ticks must be between 1 and " + std::to_string(DAY_LENGTH);
+    }
+    if(options.repeat < 1){
+        return "--repeat must be at least 1";
+    }
+    return std::string();
+}
+
+// True for the options a zygote's workers share with it, fixed when it
+// loaded the scene
+static bool IsSceneOption(const std::string& argument){
+    return argument.compare(0, 9, "--pixels=") == 0 || argument == "--pixels-color" ||
+           argument.compare(0, 7, "--pack=") == 0 || argument == "--no-pack" ||
+           argument.compare(0, 9, "--zygote=") == 0;
+}
+
+/**
+* Listens on the zygote's socket and forks a worker for every line of
+* options that arrives. The zygote has loaded the scene and started no
+* thread: each worker starts its own stepping threads once forked, and
+* shares the pack's mapping and every page of the scene with the zygote
+* until one of them writes to it.
+*
+* @return true in a forked worker, with its options and the connection
+* to answer once it serves; false in the zygote if its socket fails
+*/
+static bool RunZygote(const ServeOptions& base, ServeOptions& worker, TcpSocket& request){
+    TcpSocket listener;
+    if(!listener.ListenLocal(base.zygotePath)){
+        return false;
+    }
+    // The kernel reaps the workers, the zygote never waits on one
+    signal(SIGCHLD, SIG_IGN);
+    std::cout << "dinoserve: zygote listening on " << base.zygotePath << ", send a line of options per worker\n";
+    for(;;){
+        TcpSocket connection = listener.Accept();
+        if(!connection.IsOpen()){
+            if(errno == EINTR || errno == ECONNABORTED){
+                continue;
+            }
+            std::cout << "dinoserve: the zygote could not accept: " << strerror(errno) << "\n";
+            return false;
+        }
+        std::string line;
+        if(!connection.ReceiveLine(line)){
+            continue;
+        }
+        std::cout.flush();
+        pid_t child = fork();
+        if(child < 0){
+            connection.SendLine(std::string("error fork failed: ") + strerror(errno));
+            continue;
+        }
+        if(child > 0){
+            continue;
+        }
+        signal(SIGCHLD, SIG_DFL);
+        worker = base;
+        // Each worker gets its own shared memory unless it names one
+        worker.name = base.name + "-" + std::to_string(getpid());
+        std::istringstream arguments(line);
+        std::string argument;
+        std::string error;
+        while(error.empty() && arguments >> argument){
+            error = IsSceneOption(argument) ? argument + " is fixed by the zygote" : ParseOption(argument, worker);
+        }
+        if(error.empty()){
+            error = CheckOptions(worker);
+        }
+        if(!error.empty()){
+            connection.SendLine("error " + error);
+            _exit(1);
+        }
+        request = std::move(connection);
+        return true;
+    }
+}
+
+// Serves options.environmentCount games on options.name until the
+// trainer shuts the server down. request, if open, is told "ready <pid>
+// <name>" once the shared memory is there, or "error ..." if not.
+static int Serve(const ServeOptions& options, PixelScene& scene, TcpSocket& request){
+    std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+    const std::string& name = options.name;
+    size_t environmentCount = options.environmentCount;
+    unsigned long long seed = options.seed;
+    bool pixels = options.pixelWidth > 0 || options.pixelHeight > 0;
+    EnvironmentPool environments(options.threadCount, options.affinity);
+    environments.Resize(environmentCount);
+    environments.SetSpawnScript(options.spawnScript);
+    environments.ResetAll(seed);
+    // Streams below environmentCount belong to the first games
+    unsigned long long nextStream = environmentCount;
+    const std::string& checkpointPath = options.checkpointPath;
+    if(!checkpointPath.empty() && std::ifstream(checkpointPath.c_str()).is_open()){
+        uint64_t tag = 0;
+        if(!environments.LoadCheckpoint(checkpointPath, tag)){
+            request.SendLine("error could not load " + checkpointPath);
+            return 1;
+        }
+        if(environments.GetCount() != environmentCount){
+            std::cout << checkpointPath << " holds " << environments.GetCount() << " environments, not "
+                      << environmentCount << "\n";
+            request.SendLine("error " + checkpointPath + " holds another number of environments");
+            return 1;
+        }
+        nextStream = tag;
+        std::cout << "Resumed from " << checkpointPath << "\n";
+    }
+
+    SharedEnvironment shared;
+    if(!shared.Create(name, environmentCount, pixels ? options.pixelWidth : 0, pixels ? options.pixelHeight : 0,
+                      pixels ? scene.rasterizer.GetChannels() : 0, options.featureObstacles)){
+        request.SendLine("error could not create " + name);
+        return 1;
+    }
+    int32_t* observations = shared.GetObservations();
+    float* rewards = shared.GetRewards();
+    uint8_t* dones = shared.GetDones();
+    const GameAction* actions = (const GameAction*)shared.GetActions();
+    uint8_t* frames = shared.GetPixels();
+    size_t frameSize = pixels ? shared.GetPixelFrameSize() : 0;
+    float* features = shared.GetFeatures();
+    size_t featureSize = shared.GetFeatureSize();
+    size_t featureObstacles = options.featureObstacles;
+    ThreadPool* pool = &environments.GetThreadPool();
+    // Writes a shard's observations and features. Run on the shard's own
+    // thread, the first write puts those pages on its NUMA node too.
+    auto writeShard = [&](size_t shard){
+        size_t first = shard * environments.GetShardSize();
+        size_t count = environments.GetShard(shard).GetCount();
+        for(size_t i = first; i < first + count; ++i){
+            GameState state = environments.Get(i);
+            WriteObservation(state, observations + i * OBSERVATION_SIZE);
+            if(features != nullptr){
+                WriteFeatureObservation(state, featureObstacles, features + i * featureSize);
+            }
+        }
+    };
+    // Pixel frames are rendered by the pool itself, one at a time
+    auto writeAll = [&](){
+        if(!pixels){
+            environments.ForEachShard(writeShard);
+            return;
+        }
+        for(size_t shard = 0; shard < environments.GetShardCount(); ++shard){
+            writeShard(shard);
+        }
+        for(size_t i = 0; i < environmentCount; ++i){
+            RenderPixels(scene, environments.Get(i), pool, frames + i * frameSize);
+        }
+    };
+    writeAll();
+    if(request.IsOpen()){
+        request.SendLine("ready " + std::to_string(getpid()) + " " + name);
+        request.Close();
+        std::cout << "dinoserve: worker " << getpid() << " ready "
+                  << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count()
+                  << " ms after its fork\n";
+    }
+    std::cout << "Serving " << environmentCount << " environments on " << name << " with "
+              << environments.GetThreadCount() << " threads";
+    if(pixels){
+        std::cout << ", rendering " << options.pixelWidth << "x" << options.pixelHeight
+                  << (options.pixelColor ? " RGB" : " grayscale") << " frames";
+    }
+    if(features != nullptr){
+        std::cout << ", " << featureSize << " features each";
+    }
+    if(GetHugePageBytes() > 0){
+        std::cout << ", state on " << (GetHugePageBytes() >> 20) << " MB of "
+                  << (GetExplicitHugePageBytes() > 0 ? "explicit" : "transparent") << " huge pages";
+    }
+    std::cout << "\n";
+
+    unsigned long long steps = 0;
+    Telemetry& telemetry = Telemetry::Get();
+    TelemetrySnapshot lastStats = telemetry.Snapshot();
+    double statsSeconds = options.statsSeconds;
+    std::chrono::steady_clock::time_point nextStats = std::chrono::steady_clock::now() +
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(statsSeconds));
+    while(shared.WaitForRequest()){
+        environments.StepAllRepeated(actions, options.repeat, options.ticks);
+        for(size_t shard = 0; shard < environments.GetShardCount(); ++shard){
+            const GameStateBatch& batch = environments.GetShard(shard);
+            const int* events = batch.GetEvents();
+            const float* stepRewards = batch.GetRewards();
+            size_t first = shard * environments.GetShardSize();
+            for(size_t lane = 0; lane < batch.GetCount(); ++lane){
+                size_t i = first + lane;
+                bool done = (events[lane] & EVENT_GAME_OVER) != 0;
+                rewards[i] = stepRewards[lane];
+                dones[i] = done ? 1 : 0;
+                if(done){
+                    // In order, so the streams do not depend on threads
+                    environments.Reset(i, seed, nextStream++);
+                }
+            }
+        }
+        writeAll();
+        shared.Respond();
+        ++steps;
+        if(!checkpointPath.empty() && options.checkpointEvery > 0 && steps % options.checkpointEvery == 0){
+            environments.SaveCheckpoint(checkpointPath, nextStream);
+        }
+        if(statsSeconds > 0.0 && std::chrono::steady_clock::now() >= nextStats){
+            TelemetrySnapshot stats = telemetry.Snapshot();
+            std::cout << stats.Format(&lastStats) << "\n";
+            lastStats = stats;
+            nextStats += std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(statsSeconds));
+        }
+    }
+    if(!checkpointPath.empty() && environments.SaveCheckpoint(checkpointPath, nextStream)){
+        std::cout << "Saved a checkpoint to " << checkpointPath << "\n";
+    }
+    std::cout << "Shutting down after " << steps << " steps: " << telemetry.Snapshot().Format() << "\n";
+    shared.Release();
+    return 0;
+}
+
+int main(int argc, char* argv[]){
+    ServeOptions options;
+    // The server's own thread steps shards too
+    options.affinity.pinCaller = true;
+    for(int i = 1; i < argc; ++i){
+        std::string error = ParseOption(argv[i], options);
+        if(!error.empty()){
+            std::cout << error << "\n";
+            return 1;
+        }
+    }
+    std::string error = CheckOptions(options);
+    if(!error.empty()){
+        std::cout << error << "\n";
+        return 1;
+    }
+
+    PixelScene scene;
+    bool pixels = options.pixelWidth > 0 || options.pixelHeight > 0;
+    if(pixels && !options.packPath.empty() && AssetPack::Get().Open(options.packPath)){
+        std::cout << "dinoserve: drawing from the " << AssetPack::Get().GetEntryCount() << " assets of " << options.packPath << "\n";
+    }
+    if(pixels && !LoadPixelScene(scene, options.pixelWidth, options.pixelHeight, !options.pixelColor)){
+        return 1;
+    }
+
+    TcpSocket request;
+    if(options.zygotePath.empty()){
+        return Serve(options, scene, request);
+    }
+    ServeOptions worker;
+    if(!RunZygote(options, worker, request)){
+        return 1;
+    }
+    return Serve(worker, scene, request);
+}
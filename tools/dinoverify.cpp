@@ -0,0 +1,231 @@
+/* Lockstep check of the simulation backends against each other.
+ Build with: python3 build.py dinoverify
+ Run with:   ./dinoverify [--envs=<n>] [--steps=<n>] [--seed=<n>] [--ticks=<n>]
+                          [--repeat=<k>] [--vary] [--write=<file>] [--against=<file>]
+ Steps n environments (256 by default) with the same random jumps twice:
+ one GameState at a time with Step(), the reference, and together in a
+ GameStateBatch with its SIMD kernel. Finished games start over on
+ stream index + episode * n on both sides. After every step each
+ environment's HashGameState() is compared, with its events and reward,
+ and the run stops at the first step and lane that differ, printing the
+ field that went first. --vary gives every environment rules of its own
+ (GameParameters), drawn from the seed.
+ --write=<file> records the per-step hashes, 8 bytes per environment and
+ step; --against=<file> compares this run's with such a recording, from
+ another build (-mavx2, AArch64) or machine. The recording holds every
+ option but --steps, and a run with other options is refused.
+ The GPU backend needs a GL context and is checked by ./prog --gpu-sim-check.
+*/
+#include "GameStateBatch.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+static const char RECORDING_MAGIC[4] = {'D', 'V', 'R', 'F'};
+static const uint32_t RECORDING_VERSION = 1;
+
+// What a recording has to agree on with the run it is compared to
+struct RecordingHeader{
+    uint32_t version;
+    uint32_t ticks;
+    uint32_t repeat;
+    uint32_t vary;
+    uint64_t seed;
+    uint64_t count;
+};
+
+// Rules of environment i for --vary, all within the ranges Step() takes
+static GameParameters DrawParameters(GameRandom& random, int ticks){
+    GameParameters rules;
+    rules.cactusSpeed = 3 + (int)(NextGameRandom(random) % 6);
+    rules.jumpingSpeed = 3 + (int)(NextGameRandom(random) % 4);
+    rules.jumpApex = 100 + (int)(NextGameRandom(random) % 81);
+    rules.dayLength = std::max(ticks, 200 + (int)(NextGameRandom(random) % 1001));
+    rules.daySpeedup = (int)(NextGameRandom(random) % 4);
+    rules.spawnGapMin = 400 + (int)(NextGameRandom(random) % 801);
+    rules.spawnGapRange = 200 + (int)(NextGameRandom(random) % 801);
+    rules.spawnSpeedMin = 4 + (int)(NextGameRandom(random) % 5);
+    return rules;
+}
+
+int main(int argc, char* argv[]){
+    size_t count = 256;
+    long steps = 10000;
+    unsigned long long seed = 1;
+    int ticks = 1;
+    int repeat = 1;
+    bool vary = false;
+    std::string writePath;
+    std::string againstPath;
+    for(int i = 1; i < argc; ++i){
+        std::string argument = argv[i];
+        if(argument.compare(0, 7, "--envs=") == 0){
+            count = (size_t)std::max(1L, atol(argument.c_str() + 7));
+        }else if(argument.compare(0, 8, "--steps=") == 0){
+            steps = std::max(1L, atol(argument.c_str() + 8));
+        }else if(argument.compare(0, 7, "--seed=") == 0){
+            seed = strtoull(argument.c_str() + 7, nullptr, 10);
+        }else if(argument.compare(0, 8, "--ticks=") == 0){
+            ticks = atoi(argument.c_str() + 8);
+        }else if(argument.compare(0, 9, "--repeat=") == 0){
+            repeat = atoi(argument.c_str() + 9);
+        }else if(argument == "--vary"){
+            vary = true;
+        }else if(argument.compare(0, 8, "--write=") == 0){
+            writePath = argument.substr(8);
+        }else if(argument.compare(0, 10, "--against=") == 0){
+            againstPath = argument.substr(10);
+        }else{
+            std::cout << "Unknown option " << argument << "\n";
+            std::cout << "Usage: dinoverify [--envs=<n>] [--steps=<n>] [--seed=<n>] [--ticks=<n>] [--repeat=<k>] [--vary]"
+                         " [--write=<file>] [--against=<file>]\n";
+            return 1;
+        }
+    }
+    if(ticks < 1 || ticks > DAY_LENGTH || repeat < 1){
+        std::cout << "--ticks must be between 1 and " << DAY_LENGTH << ", --repeat at least 1\n";
+        return 1;
+    }
+    RecordingHeader header = {RECORDING_VERSION, (uint32_t)ticks, (uint32_t)repeat, vary ? 1u : 0u, seed, count};
+
+    std::ofstream write;
+    if(!writePath.empty()){
+        write.open(writePath, std::ios::binary | std::ios::trunc);
+        write.write(RECORDING_MAGIC, sizeof(RECORDING_MAGIC));
+        write.write((const char*)&header, sizeof(header));
+        if(!write){
+            std::cout << "Could not write " << writePath << "\n";
+            return 1;
+        }
+    }
+    std::ifstream against;
+    if(!againstPath.empty()){
+        against.open(againstPath, std::ios::binary);
+        char magic[4];
+        RecordingHeader recorded;
+        if(!against.read(magic, sizeof(magic)) || std::memcmp(magic, RECORDING_MAGIC, sizeof(magic)) != 0 ||
+           !against.read((char*)&recorded, sizeof(recorded))){
+            std::cout << againstPath << " is not a dinoverify recording\n";
+            return 1;
+        }
+        if(std::memcmp(&recorded, &header, sizeof(header)) != 0){
+            std::cout << againstPath << " was recorded with other options: --envs=" << recorded.count << " --seed="
+                      << recorded.seed << " --ticks=" << recorded.ticks << " --repeat=" << recorded.repeat
+                      << (recorded.vary ? " --vary" : "") << " (version " << recorded.version << ")\n";
+            return 1;
+        }
+    }
+
+    // The reference: one state at a time
+    std::vector<GameState> states(count);
+    std::vector<GameParameters> rules(count);
+    std::vector<int> events(count);
+    std::vector<float> rewards(count);
+    GameStateBatch batch;
+    batch.Resize(count);
+    GameRandom random;
+    SeedGameRandom(random, seed, count);
+    for(size_t i = 0; i < count; ++i){
+        if(vary){
+            rules[i] = DrawParameters(random, ticks);
+        }
+        ResetGameState(states[i], seed, i, rules[i]);
+        batch.SetParameters(i, rules[i]);
+    }
+    batch.ResetAll(seed);
+    std::vector<uint64_t> episodes(count, 0);
+    std::vector<GameAction> actions(count);
+    std::vector<uint64_t> expected(count);
+    std::vector<uint64_t> actual(count);
+    std::vector<uint64_t> recorded(count);
+    bool recordingEnded = againstPath.empty();
+    double scalarSeconds = 0.0;
+    double batchSeconds = 0.0;
+
+    for(long step = 0; step < steps; ++step){
+        for(size_t i = 0; i < count; ++i){
+            actions[i] = (NextGameRandom(random) % 16 == 0) ? ACTION_JUMP : ACTION_NONE;
+        }
+        auto start = std::chrono::steady_clock::now();
+        for(size_t i = 0; i < count; ++i){
+            rewards[i] = 0.0f;
+            events[i] = (int)StepRepeated(states[i], actions[i], repeat, &rewards[i], ticks, rules[i]);
+        }
+        auto middle = std::chrono::steady_clock::now();
+        batch.StepRepeated(actions.data(), repeat, ticks);
+        auto end = std::chrono::steady_clock::now();
+        scalarSeconds += std::chrono::duration<double>(middle - start).count();
+        batchSeconds += std::chrono::duration<double>(end - middle).count();
+
+        // Compared before the resets, which clear the batch's events
+        for(size_t i = 0; i < count; ++i){
+            expected[i] = HashGameState(states[i]);
+        }
+        batch.HashAll(actual.data());
+        for(size_t i = 0; i < count; ++i){
+            if(expected[i] == actual[i] && events[i] == batch.GetEvents()[i] && rewards[i] == batch.GetRewards()[i]){
+                continue;
+            }
+            std::string difference = DescribeGameStateDifference(states[i], batch.Get(i));
+            if(difference.empty()){
+                difference = "events " + std::to_string(events[i]) + " vs " + std::to_string(batch.GetEvents()[i]) +
+                             ", reward " + std::to_string(rewards[i]) + " vs " + std::to_string(batch.GetRewards()[i]);
+            }
+            std::cout << "Scalar and batch (" << GameStateBatch::GetInstructionSet() << ") diverge at step " << step
+                      << ", lane " << i << ", tick " << states[i].tick << " of episode " << episodes[i]
+                      << ": " << difference << "\n";
+            return 1;
+        }
+        if(write.is_open()){
+            write.write((const char*)actual.data(), (std::streamsize)(count * sizeof(uint64_t)));
+        }
+        if(!recordingEnded){
+            if(!against.read((char*)recorded.data(), (std::streamsize)(count * sizeof(uint64_t)))){
+                std::cout << againstPath << " ends after " << step << " steps, the rest is checked without it\n";
+                recordingEnded = true;
+            }else{
+                for(size_t i = 0; i < count; ++i){
+                    if(recorded[i] != actual[i]){
+                        std::cout << "This build (" << GameStateBatch::GetInstructionSet() << ") and " << againstPath
+                                  << " diverge at step " << step << ", lane " << i << ", tick " << states[i].tick
+                                  << " of episode " << episodes[i] << "\n";
+                        return 1;
+                    }
+                }
+            }
+        }
+
+        for(size_t i = 0; i < count; ++i){
+            if(events[i] & EVENT_GAME_OVER){
+                ++episodes[i];
+                uint64_t stream = i + episodes[i] * count;
+                ResetGameState(states[i], seed, stream, rules[i]);
+                batch.Reset(i, seed, stream);
+            }
+        }
+    }
+    if(write.is_open() && !write.flush()){
+        std::cout << "Could not write " << writePath << "\n";
+        return 1;
+    }
+
+    uint64_t sum = 0;
+    uint64_t games = 0;
+    for(size_t i = 0; i < count; ++i){
+        sum = sum * 1099511628211ULL + expected[i];
+        games += episodes[i];
+    }
+    double environmentSteps = (double)count * (double)steps;
+    std::cout << "Scalar and batch (" << GameStateBatch::GetInstructionSet() << ") agree on " << count
+              << " environments for " << steps << " steps, " << games << " games finished"
+              << (againstPath.empty() ? "" : ", and with " + againstPath) << "\n";
+    std::cout << "Final hash " << std::hex << sum << std::dec << ", " << environmentSteps / scalarSeconds / 1e6
+              << " M steps/s scalar, " << environmentSteps / batchSeconds / 1e6 << " M steps/s batch\n";
+    return 0;
+}
@@ -0,0 +1,93 @@
+/* Offline converter from .obj to the binary .dmesh format.
+ Build with: python3 build.py dmeshconv
+ Run with:   ./dmeshconv [--stream[=<cache entries>]] [file.obj ...]
+ With no arguments every mesh used by the game is converted. Each .dmesh is
+ written next to its .obj, where the game picks it up automatically, with
+ the simplified levels of detail of the mesh after the full one.
+ --stream converts meshes too large to load, such as scanned props of
+ gigabytes: the OBJ is read a block at a time and written out as it is
+ read, with corners deduplicated through a cache of that many entries
+ (a million by default). Memory then stays at the file's positions,
+ texture coordinates and normals in binary, and the .dmesh holds the full
+ mesh only, without levels of detail or reordering.
+ Corners the OBJ gives no usable normal get one generated (see
+ ObjLoader::generateNormals()), except with --stream, which writes zero.
+*/
+#include "MeshFile.hpp"
+#include "ObjLoader.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+int main(int argc, char* argv[]){
+    std::vector<std::string> inputs;
+    bool stream = false;
+    size_t cacheEntries = OBJ_STREAM_CACHE_ENTRIES;
+    for(int i = 1; i < argc; ++i){
+        std::string argument = argv[i];
+        if(argument == "--stream"){
+            stream = true;
+        }else if(argument.compare(0, 9, "--stream=") == 0){
+            stream = true;
+            cacheEntries = std::max(1L, std::atol(argument.c_str() + 9));
+        }else{
+            inputs.push_back(argument);
+        }
+    }
+    if(inputs.empty()){
+        inputs = { "./common/objects/bg.obj",
+                   "./common/objects/bg_night.obj",
+                   "./common/objects/dino.obj",
+                   "./common/objects/dino2.obj",
+                   "./common/objects/cactus.obj" };
+    }
+
+    int failures = 0;
+    for(const std::string& input : inputs){
+        std::string output = MeshFile::DMeshPathFor(input);
+        if(stream){
+            ObjStreamResult result;
+            if(!MeshFile::WriteFromObjStream(input, output, cacheEntries, &result) || result.triangleCount == 0){
+                std::cout << "Could not convert " << input << "\n";
+                ++failures;
+                continue;
+            }
+            std::cout << input << " -> " << output << " (" << result.triangleCount << " triangles, "
+                      << result.vertexCount << " vertices, " << result.evictedCorners << " evicted from the cache, "
+                      << (result.attributeBytes + result.workingBytes) / (1 << 20) << " MB held)\n";
+            continue;
+        }
+        ObjLoader loader(input, 0);
+        if(loader.getTriangles().empty()){
+            std::cout << "Skipping " << input << ": no triangles\n";
+            ++failures;
+            continue;
+        }
+        DMeshStatistics statistics;
+        if(!MeshFile::WriteFromObj(loader, output, &statistics)){
+            std::cout << "Could not write " << output << "\n";
+            ++failures;
+            continue;
+        }
+        std::cout << input << " -> " << output << " (";
+        // Read back, which also checks what was written
+        MeshFile written;
+        if(!written.Load(output)){
+            std::cout << "unreadable)\n";
+            ++failures;
+            continue;
+        }
+        for(uint32_t lod = 0; lod < written.GetLodCount(); ++lod){
+            std::cout << (lod > 0 ? ", " : "") << written.GetLods()[lod].indexCount / 3;
+        }
+        std::cout << " triangles, ACMR " << statistics.acmrBefore << " -> " << statistics.acmrAfter;
+        if(loader.getGeneratedNormalCount() > 0){
+            std::cout << ", " << loader.getGeneratedNormalCount() << " normals generated";
+        }
+        std::cout << ")\n";
+    }
+    return failures == 0 ? 0 : 1;
+}
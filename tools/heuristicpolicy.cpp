@@ -0,0 +1,55 @@
+/* Example policy library, loaded in process by ./prog --bots and
+ ./dinoeval --policy=plugin:<library>.
+ Build with: python3 build.py heuristicpolicy
+ Run with:   ./prog --bots=./heuristicpolicy.so[:<seconds>]
+ Jumps when the next obstacle is less than <seconds> away (0.2 unless
+ given), like dinoeval's built-in heuristic. A network would keep its
+ weights in the policy and evaluate all rows of dino_policy_act() as one
+ batch; see include/PolicyPlugin.hpp for the functions.
+*/
+#include "FeatureObservation.hpp"
+#include "PolicyPlugin.hpp"
+
+#include <cstdlib>
+
+#if defined(MINGW) || defined(_WIN32)
+    #define DINO_POLICY_EXPORT extern "C" __declspec(dllexport)
+#else
+    #define DINO_POLICY_EXPORT extern "C" __attribute__((visibility("default")))
+#endif
+
+struct HeuristicPolicy{
+    float jumpSeconds;
+};
+
+DINO_POLICY_EXPORT uint32_t dino_policy_abi(){
+    return DINO_POLICY_ABI;
+}
+
+DINO_POLICY_EXPORT void* dino_policy_create(const char* options, uint32_t rowSize){
+    // Needs at least the next obstacle
+    if(rowSize < GetFeatureSize(1)){
+        return nullptr;
+    }
+    float seconds = (options != nullptr && options[0] != '\0') ? (float)atof(options) : 0.2f;
+    if(!(seconds > 0.0f)){
+        return nullptr;
+    }
+    return new HeuristicPolicy{seconds};
+}
+
+DINO_POLICY_EXPORT int dino_policy_act(void* policy, const float* rows, uint32_t rowCount, uint32_t rowSize,
+                                       uint8_t* jumps){
+    const HeuristicPolicy& heuristic = *(const HeuristicPolicy*)policy;
+    for(uint32_t i = 0; i < rowCount; ++i){
+        const float* row = rows + (size_t)i * rowSize;
+        // Seconds until the next obstacle reaches the dino
+        float seconds = row[FEATURE_OBSTACLES] / row[FEATURE_OBSTACLE_SPEED];
+        jumps[i] = (seconds < heuristic.jumpSeconds) ? 1 : 0;
+    }
+    return 0;
+}
+
+DINO_POLICY_EXPORT void dino_policy_destroy(void* policy){
+    delete (HeuristicPolicy*)policy;
+}
@@ -0,0 +1,62 @@
+/* Offline converter from .ppm textures to block-compressed .ktx files.
+ Build with: python3 build.py texconv
+ Run with:   ./texconv [file.ppm ...]
+ With no arguments every scene texture is converted. Each texture is
+ written next to its .ppm as <name>.bc1.ktx (BC1, 4 bits per texel, 6x
+ smaller than RGB8), where the game picks it up automatically. Magenta
+ texels, transparent in the game, become BC1's transparent texels, so
+ every file is written as RGBA BC1 and all of them can share the array. The file
+ holds the full mip chain down to 1x1, box filtered in linear light, so
+ the game samples it trilinearly without generating mips at load time. BC7 and
+ ETC2 variants (<name>.bc7.ktx, <name>.etc2.ktx) can be made with an
+ external encoder from the image flipped upside down.
+*/
+#include "BC1Encoder.hpp"
+#include "Image.hpp"
+#include "KTXFile.hpp"
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+int main(int argc, char* argv[]){
+    std::vector<std::string> inputs;
+    for(int i = 1; i < argc; ++i){
+        inputs.push_back(argv[i]);
+    }
+    if(inputs.empty()){
+        inputs = { "./common/objects/bg.ppm",
+                   "./common/objects/bg_night.ppm",
+                   "./common/objects/dunes_far.ppm",
+                   "./common/objects/dunes_near.ppm",
+                   "./common/objects/dunes_far_night.ppm",
+                   "./common/objects/dunes_near_night.ppm" };
+    }
+
+    int failures = 0;
+    for(const std::string& input : inputs){
+        Image image(input);
+        // Flipped and keyed like the game loads it, so the blocks upload
+        // as they are
+        image.LoadPPM(true, true, true);
+        if(image.GetPixelDataPtr() == nullptr){
+            std::cout << "Could not load " << input << "\n";
+            ++failures;
+            continue;
+        }
+        std::vector<std::vector<uint8_t>> levels = EncodeBC1MipChain(image.GetPixelDataPtr(), image.GetWidth(), image.GetHeight());
+        size_t bytes = 0;
+        for(const std::vector<uint8_t>& level : levels){
+            bytes += level.size();
+        }
+        std::string output = KTXFile::VariantPathFor(input, ".bc1.ktx");
+        if(!KTXFile::Write(output, GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, GL_RGBA, image.GetWidth(), image.GetHeight(), levels)){
+            std::cout << "Could not write " << output << "\n";
+            ++failures;
+            continue;
+        }
+        std::cout << input << " -> " << output << " (" << image.GetWidth() << "x" << image.GetHeight()
+                  << ", " << levels.size() << " levels, " << bytes << " bytes)\n";
+    }
+    return failures == 0 ? 0 : 1;
+}